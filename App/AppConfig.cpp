@@ -60,6 +60,7 @@ AppConfig::serialize(void)
   obj.setField("colors", this->colors.serialize());
   obj.setField("guiConfig", this->guiConfig.serialize());
   obj.setField("tleSourceConfig", this->tleSourceConfig.serialize());
+  obj.setField("threadConfig", this->threadConfig.serialize());
   obj.setField("panoramicSpectrum", this->panSpectrumConfig->serialize());
 
   obj.setField("bandPlans", bandPlans);
@@ -102,12 +103,17 @@ AppConfig::getComponentConfig(const char *obj)
 }
 
 void
-AppConfig::setComponentConfig(const char *field, Suscan::Object const &obj)
+AppConfig::setComponentConfig(const char *field, Suscan::Object &&obj)
 {
-  if (!obj.isHollow()) {
+  if (obj.isHollow())
+    return;
+
+  if (obj.isBorrowed()) {
     Suscan::Object dup;
     dup.copyFrom(obj);
-    this->cachedComponentConfig.setField(field, dup);
+    this->cachedComponentConfig.setField(field, std::move(dup));
+  } else {
+    this->cachedComponentConfig.setField(field, std::move(obj));
   }
 }
 
@@ -123,6 +129,7 @@ AppConfig::deserialize(Suscan::Object const &conf)
     TRYSILENT(this->colors.deserialize(conf.getField("colors")));
     TRYSILENT(this->guiConfig.deserialize(conf.getField("guiConfig")));
     TRYSILENT(this->tleSourceConfig.deserialize(conf.getField("tleSourceConfig")));
+    TRYSILENT(this->threadConfig.deserialize(conf.getField("threadConfig")));
     TRYSILENT(this->panSpectrumConfig->deserialize(conf.getField("panoramicSpectrum")));
 
     TRYSILENT(this->version    = conf.get("version", SIGDIGGER_UICONFIG_DEFAULT_VERSION));
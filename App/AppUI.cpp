@@ -20,23 +20,17 @@
 
 #include "AboutDialog.h"
 #include "MainSpectrum.h"
-#include "ConfigDialog.h"
 #include "Palette.h"
 #include "AutoGain.h"
 #include "Averager.h"
 #include "DeviceGain.h"
 #include "ui_MainWindow.h"
-#include "ConfigDialog.h"
-#include "DeviceDialog.h"
 #include "PanoramicDialog.h"
 #include "LogDialog.h"
-#include "BackgroundTasksDialog.h"
-#include "AddBookmarkDialog.h"
-#include "BookmarkManagerDialog.h"
+#include "DiagnosticsDialog.h"
 #include <QToolBar>
 #include "QTimeSlider.h"
 #include "AppUI.h"
-#include "QuickConnectDialog.h"
 
 #include "SigDiggerHelpers.h"
 #include <QToolBar>
@@ -68,15 +62,14 @@ AppUI::AppUI(QMainWindow *owner)
   this->main->action_Full_screen = nullptr;
 #endif // __APPLE__
   
+  // The log dialog collects messages from the start, and the panoramic
+  // dialog holds configuration and sweep state. The rest of the dialogs
+  // are created by the mediator when first opened.
   this->spectrum = new MainSpectrum(owner);
-  this->quickConnectDialog = new QuickConnectDialog(owner);
   this->aboutDialog = new AboutDialog(owner);
-  this->deviceDialog = new DeviceDialog(owner);
   this->panoramicDialog = new PanoramicDialog(owner);
   this->logDialog = new LogDialog(owner);
-  this->backgroundTasksDialog = new BackgroundTasksDialog(owner);
-  this->addBookmarkDialog = new AddBookmarkDialog(owner);
-  this->bookmarkManagerDialog = new BookmarkManagerDialog(owner);
+  this->diagnosticsDialog = new DiagnosticsDialog(owner);
 }
 
 void
@@ -85,7 +78,6 @@ AppUI::postLoadInit(QMainWindow *owner)
   // Singleton config has been deserialized. Refresh UI with these changes.
   SigDiggerHelpers::instance()->deserializePalettes();
 
-  this->configDialog = new ConfigDialog(owner);
   this->spectrum->deserializeFATs();
 
   this->spectrum->adjustSizes();
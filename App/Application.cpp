@@ -24,9 +24,12 @@
 #include "Scanner.h"
 
 #include <QMessageBox>
+#include <QFileInfo>
 #include <SuWidgetsHelpers.h>
 
 #include "MainSpectrum.h"
+#include "SigDiggerHelpers.h"
+#include "ShutdownWatchdog.h"
 
 using namespace SigDigger;
 
@@ -59,6 +62,11 @@ Application::Application(QWidget *parent) : QMainWindow(parent), ui(this)
   this->deviceDetectWorker = new DeviceDetectWorker();
   this->deviceDetectWorker->moveToThread(this->deviceDetectThread);
   this->deviceDetectThread->start();
+
+  this->deviceDetectTimer.setSingleShot(true);
+  this->deviceDetectTimer.setInterval(SIGDIGGER_DEVICE_DETECT_TIMEOUT_MS);
+
+  this->reconnectTimer.setSingleShot(true);
 }
 
 Suscan::Object &&
@@ -94,18 +102,31 @@ Application::run(Suscan::Object const &config)
 
   this->mediator->setState(UIMediator::HALTED);
 
-  // New devices may have been discovered after config deserialization
+  // Start with whatever suscan found on init, and detect again in the
+  // background: some drivers are slow to show their devices.
   sing->refreshDevices();
   this->mediator->refreshDevicesDone();
 
   this->connectUI();
   this->connectDeviceDetect();
+  this->startDeviceDetect(false);
   this->updateRecent();
 
   this->show();
 
   this->uiTimer.start(250);
 
+  this->instanceServer = new InstanceServer(this);
+  if (this->instanceServer->listen())
+    connect(
+          this->instanceServer,
+          SIGNAL(launchRequested(SigDigger::LaunchRequest const &)),
+          this,
+          SLOT(onLaunchRequested(SigDigger::LaunchRequest const &)));
+
+  if (!this->launchRequest.isEmpty())
+    this->applyLaunchRequest(this->launchRequest);
+
   //this->mediator->notifyStartupErrors();
 }
 
@@ -226,6 +247,12 @@ Application::connectUI(void)
         SIGNAL(timeout(void)),
         this,
         SLOT(onTick(void)));
+
+  connect(
+        &this->reconnectTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onReconnectTimeout(void)));
 }
 
 void
@@ -304,6 +331,32 @@ Application::connectDeviceDetect(void)
         SIGNAL(finished()),
         this,
         SLOT(onDetectFinished()));
+
+  connect(
+        &this->deviceDetectTimer,
+        SIGNAL(timeout()),
+        this,
+        SLOT(onDetectTimeout()));
+}
+
+void
+Application::startDeviceDetect(bool requested)
+{
+  this->detectRequested = this->detectRequested || requested;
+
+  if (this->detecting) {
+    // Some driver is still stuck in the previous detection. Do not keep
+    // the device dialog waiting for it.
+    if (requested && this->detectTimedOut)
+      this->mediator->refreshDevicesDone();
+    return;
+  }
+
+  this->detecting = true;
+  this->detectTimedOut = false;
+  this->deviceDetectTimer.start();
+
+  emit detectDevices();
 }
 
 QString
@@ -369,9 +422,10 @@ Application::startCapture(void)
     this->filterInstalled = false;
 
     if (this->mediator->getState() == UIMediator::HALTED) {
-      Suscan::AnalyzerParams params = *this->mediator->getAnalyzerParams();
+      Suscan::AnalyzerParams params = this->mediator->requestAnalyzerParams();
       std::unique_ptr<Suscan::Analyzer> analyzer;
       Suscan::Source::Config profile = *this->mediator->getProfile();
+      std::string host, address;
 
       if (profile.getType() == SUSCAN_SOURCE_TYPE_SDR) {
         if (profile.getDecimatedSampleRate() > SIGDIGGER_MAX_SAMPLE_RATE) {
@@ -414,7 +468,27 @@ Application::startCapture(void)
       // Ensure we run this analyzer in channel mode.
       params.mode = Suscan::AnalyzerParams::Mode::CHANNEL;
 
-      analyzer = std::make_unique<Suscan::Analyzer>(params, profile);
+      // Skip the lookup if the host was resolved while it was typed. The
+      // profile itself keeps the name, and later connections (including
+      // reconnections) look it up again.
+      if (profile.isRemote()) {
+        host    = profile.getParam("host");
+        address = this->mediator->takeResolvedHost(host);
+
+        if (!address.empty())
+          profile.setParam("host", address);
+      }
+
+      try {
+        analyzer = std::make_unique<Suscan::Analyzer>(params, profile);
+      } catch (Suscan::Exception &) {
+        // The address may be stale. Give the host name a chance.
+        if (address.empty())
+          throw;
+
+        profile.setParam("host", host);
+        analyzer = std::make_unique<Suscan::Analyzer>(params, profile);
+      }
 
       this->sourceInfoReceived = false;
 
@@ -426,13 +500,15 @@ Application::startCapture(void)
       this->mediator->setState(UIMediator::RUNNING, this->analyzer.get());
     }
   } catch (Suscan::Exception &) {
-    (void)  QMessageBox::critical(
-          this,
-          "SigDigger error",
-          "Failed to start capture due to errors:<p /><pre>"
-          + getLogText().toHtmlEscaped()
-          + "</pre>",
-          QMessageBox::Ok);
+    // Failed reconnection attempts are reported by scheduleReconnect()
+    if (!this->reconnecting)
+      (void)  QMessageBox::critical(
+            this,
+            "SigDigger error",
+            "Failed to start capture due to errors:<p /><pre>"
+            + getLogText().toHtmlEscaped()
+            + "</pre>",
+            QMessageBox::Ok);
     this->mediator->setState(UIMediator::HALTED);
   }
 }
@@ -454,6 +530,39 @@ Application::stopCapture(void)
   }
 }
 
+void
+Application::beginShutdown(void)
+{
+  this->uiTimer.stop();
+
+  this->stopCapture();
+}
+
+void
+Application::shutdown(void)
+{
+  this->uiTimer.stop();
+
+  if (this->scanner != nullptr) {
+    ShutdownTracker stage("Panoramic scanner");
+    delete this->scanner;
+    this->scanner = nullptr;
+  }
+
+  // Waits for the analyzer thread, and for the source to be released
+  {
+    ShutdownTracker stage("Analyzer");
+    this->analyzer = nullptr;
+  }
+
+  // Inspectors, audio and recorders go with the UI
+  if (this->mediator != nullptr) {
+    ShutdownTracker stage("User interface");
+    delete this->mediator;
+    this->mediator = nullptr;
+  }
+}
+
 void
 Application::restartCapture(void)
 {
@@ -463,14 +572,100 @@ Application::restartCapture(void)
   }
 }
 
+//
+// A lost source (a dropped connection to a remote analyzer, an unplugged
+// device) is treated as a restart: the UI and the inspectors are kept,
+// and new analyzers are attempted with an increasing delay. Once one of
+// them is running, the inspectors are opened again in it.
+//
+bool
+Application::canReconnect(void) const
+{
+  Suscan::Source::Config *profile = this->mediator->getProfile();
+
+  // Files do not come back by trying again
+  return profile->getType() == SUSCAN_SOURCE_TYPE_SDR
+      || profile->getInterface() == SUSCAN_SOURCE_REMOTE_INTERFACE;
+}
+
+void
+Application::scheduleReconnect(void)
+{
+  int delay;
+
+  if (this->mediator->getState() == UIMediator::RUNNING)
+    this->mediator->setState(UIMediator::RESTARTING);
+
+  if (this->analyzer != nullptr)
+    this->orderedHalt();
+
+  if (this->reconnectAttempts >= SIGDIGGER_RECONNECT_MAX_ATTEMPTS) {
+    this->reconnectAttempts = 0;
+    this->mediator->setStatusMessage("Source lost");
+    (void)  QMessageBox::critical(
+          this,
+          "Source error",
+          "Connection to the source was lost and could not be restored "
+          "after "
+          + QString::number(SIGDIGGER_RECONNECT_MAX_ATTEMPTS)
+          + " attempts. Last errors were:<p /><pre>"
+          + getLogText()
+          + "</pre>",
+          QMessageBox::Ok);
+    return;
+  }
+
+  delay = SIGDIGGER_RECONNECT_INITIAL_DELAY_MS << this->reconnectAttempts;
+  if (delay > SIGDIGGER_RECONNECT_MAX_DELAY_MS)
+    delay = SIGDIGGER_RECONNECT_MAX_DELAY_MS;
+
+  ++this->reconnectAttempts;
+
+  this->mediator->setStatusMessage(
+        QString::asprintf(
+          "Source lost, reconnecting in %g s (attempt %u of %u)",
+          delay * 1e-3,
+          this->reconnectAttempts,
+          SIGDIGGER_RECONNECT_MAX_ATTEMPTS));
+
+  this->reconnectTimer.start(delay);
+}
+
+void
+Application::cancelReconnect(void)
+{
+  this->reconnectTimer.stop();
+  this->reconnectAttempts = 0;
+}
+
+void
+Application::onReconnectTimeout(void)
+{
+  if (this->mediator->getState() != UIMediator::HALTED)
+    return;
+
+  this->reconnecting = true;
+  this->startCapture();
+  this->reconnecting = false;
+
+  if (this->mediator->getState() != UIMediator::RUNNING)
+    this->scheduleReconnect();
+}
+
 void
 Application::onAnalyzerHalted(void)
 {
-  bool restart = this->mediator->getState() == UIMediator::RESTARTING;
+  UIMediator::State state = this->mediator->getState();
+
+  // Not asked for: the source went away
+  if (state == UIMediator::RUNNING && this->canReconnect()) {
+    this->scheduleReconnect();
+    return;
+  }
 
   this->orderedHalt();
 
-  if (restart)
+  if (state == UIMediator::RESTARTING)
     this->startCapture();
 }
 
@@ -499,8 +694,12 @@ Application::onSourceInfoMessage(const Suscan::SourceInfoMessage &msg)
 {
   this->mediator->notifySourceInfo(*msg.info());
 
-  if (!this->sourceInfoReceived)
+  if (!this->sourceInfoReceived) {
     this->sourceInfoReceived = true;
+
+    // The source is back for real
+    this->reconnectAttempts = 0;
+  }
 }
 
 void
@@ -526,6 +725,11 @@ Application::onAnalyzerParams(const Suscan::AnalyzerParams &params)
 void
 Application::onAnalyzerReadError(void)
 {
+  if (this->canReconnect()) {
+    this->scheduleReconnect();
+    return;
+  }
+
   (void)  QMessageBox::critical(
         this,
         "Source error",
@@ -572,12 +776,14 @@ Application::quit(void)
 void
 Application::onCaptureStart(void)
 {
+  this->cancelReconnect();
   this->startCapture();
 }
 
 void
 Application::onCaptureStop(void)
 {
+  this->cancelReconnect();
   this->stopCapture();
 }
 
@@ -607,12 +813,96 @@ Application::onFrequencyChanged(qint64 freq, qint64 lnb)
 }
 
 void
-Application::hotApplyProfile(Suscan::Source::Config const *profile)
+Application::hotApplyProfile(Suscan::Source::Config *profile)
 {
+  auto const &device = profile->getDevice();
+
   this->analyzer->setFrequency(profile->getFreq(), profile->getLnbFreq());
   this->analyzer->setBandwidth(profile->getBandwidth());
+  this->analyzer->setPPM(profile->getPPM());
   this->analyzer->setDCRemove(profile->getDCRemove());
   this->analyzer->setAntenna(profile->getAntenna());
+
+  for (auto p = device.getFirstGain(); p != device.getLastGain(); ++p)
+    this->analyzer->setGain(p->getName(), profile->getGain(p->getName()));
+}
+
+void
+Application::applyLaunchRequest(LaunchRequest const &req)
+{
+  Suscan::Singleton *sing = Suscan::Singleton::get_instance();
+  Suscan::Source::Config config = *this->mediator->getProfile();
+  bool start = false;
+
+  if (!req.profile.isEmpty()) {
+    Suscan::Source::Config *profile = sing->getProfile(req.profile.toStdString());
+
+    if (profile == nullptr) {
+      QMessageBox::warning(
+            this,
+            "Failed to load profile",
+            "There is no source profile named <b>"
+            + req.profile.toHtmlEscaped()
+            + "</b>.",
+            QMessageBox::Ok);
+      return;
+    }
+
+    config = *profile;
+    start  = true;
+  }
+
+  if (!req.file.isEmpty()) {
+    QFileInfo fi(req.file);
+
+    if (!fi.isReadable()) {
+      QMessageBox::warning(
+            this,
+            "Failed to open capture",
+            "Cannot open <b>" + req.file.toHtmlEscaped() + "</b> for reading.",
+            QMessageBox::Ok);
+      return;
+    }
+
+    // The named profile (if any) provides the rest of the parameters
+    if (req.profile.isEmpty())
+      config = Suscan::Source::Config(
+            SUSCAN_SOURCE_TYPE_FILE,
+            SUSCAN_SOURCE_FORMAT_AUTO);
+
+    config.setType(SUSCAN_SOURCE_TYPE_FILE);
+    config.setPath(req.file.toStdString());
+    config.setLabel(fi.fileName().toStdString());
+    SigDiggerHelpers::instance()->guessCaptureParams(config);
+    start = true;
+  }
+
+  if (req.haveFreq)
+    config.setFreq(req.freq);
+
+  start = start && this->mediator->getState() == UIMediator::HALTED;
+  this->mediator->setProfile(config);
+
+  if (start)
+    this->startCapture();
+}
+
+void
+Application::setLaunchRequest(LaunchRequest const &req)
+{
+  this->launchRequest = req;
+}
+
+void
+Application::onLaunchRequested(SigDigger::LaunchRequest const &req)
+{
+  if (this->isMinimized())
+    this->showNormal();
+
+  this->raise();
+  this->activateWindow();
+
+  this->applyLaunchRequest(req);
 }
 
 void
@@ -634,13 +924,39 @@ Application::onSeek(struct timeval tv)
 void
 Application::onDeviceRefresh(void)
 {
-  emit detectDevices();
+  this->startDeviceDetect(true);
 }
 
 void
 Application::onDetectFinished(void)
 {
-  this->mediator->refreshDevicesDone();
+  Suscan::Singleton *sing = Suscan::Singleton::get_instance();
+  quint64 revision = sing->getDeviceRevision();
+
+  this->deviceDetectTimer.stop();
+  this->detecting = false;
+
+  sing->commitDetectedDevices();
+
+  // Background detections only bother the UI if they found something new
+  if (this->detectRequested || revision != sing->getDeviceRevision())
+    this->mediator->refreshDevicesDone();
+
+  this->detectRequested = false;
+}
+
+void
+Application::onDetectTimeout(void)
+{
+  this->detectTimedOut = true;
+
+  SU_WARNING(
+        "Device detection is taking longer than %d ms, "
+        "showing the devices found so far\n",
+        SIGDIGGER_DEVICE_DETECT_TIMEOUT_MS);
+
+  if (this->detectRequested)
+    this->mediator->refreshDevicesDone();
 }
 
 void
@@ -683,32 +999,67 @@ Application::onPanSpectrumStart(void)
 
     if (this->mediator->getPanSpectrumRange(freqMin, freqMax)
         && this->mediator->getPanSpectrumDevice(device)) {
-      Suscan::Source::Config config(
-            SUSCAN_SOURCE_TYPE_SDR,
-            SUSCAN_SOURCE_FORMAT_AUTO);
+      std::vector<Suscan::Source::Device> devices =
+          this->mediator->getPanSpectrumExtraDevices();
+      std::vector<Suscan::Source::Config> configs;
 
       this->scanMinFreq = static_cast<SUFREQ>(freqMin);
       this->scanMaxFreq = static_cast<SUFREQ>(freqMax);
 
-      config.setDevice(device);
-      config.setSampleRate(
-            static_cast<unsigned int>(
-              this->mediator->getPanSpectrumPreferredSampleRate()));
-      config.setDCRemove(true);
-      config.setBandwidth(this->mediator->getPanSpectrumPreferredSampleRate());
-      config.setLnbFreq(this->mediator->getPanSpectrumLnbOffset());
-      config.setFreq(.5 * (this->scanMinFreq + this->scanMaxFreq));
+      devices.insert(devices.begin(), device);
+
+      for (auto &dev : devices) {
+        Suscan::Source::Config config(
+              SUSCAN_SOURCE_TYPE_SDR,
+              SUSCAN_SOURCE_FORMAT_AUTO);
+
+        config.setDevice(dev);
+        config.setSampleRate(
+              static_cast<unsigned int>(
+                this->mediator->getPanSpectrumPreferredSampleRate()));
+        config.setDCRemove(true);
+        config.setBandwidth(this->mediator->getPanSpectrumPreferredSampleRate());
+        config.setLnbFreq(this->mediator->getPanSpectrumLnbOffset());
+        config.setFreq(.5 * (this->scanMinFreq + this->scanMaxFreq));
+
+        configs.push_back(config);
+      }
 
       try {
         Suscan::Logger::getInstance()->flush();
-        this->scanner = new Scanner(this, freqMin, freqMax, config);
+        this->scanner = new Scanner(
+              this,
+              freqMin,
+              freqMax,
+              configs,
+              this->mediator->getPanSpectrumResolution());
         this->scanner->setRelativeBw(this->mediator->getPanSpectrumRelBw());
         this->scanner->setRttMs(this->mediator->getPanSpectrumRttMs());
+        for (unsigned int i = 0; i < devices.size(); ++i)
+          this->scanner->setSettleMs(
+                i,
+                this->mediator->getPanSpectrumSettleMs(devices[i]));
         this->onPanSpectrumStrategyChanged(
               this->mediator->getPanSpectrumStrategy());
         this->onPanSpectrumPartitioningChanged(
               this->mediator->getPanSpectrumPartition());
 
+        if (this->mediator->getPanSpectrumRelayMode() == "Send") {
+          this->scanner->relayTo(
+                this->mediator->getPanSpectrumRelayHost(),
+                this->mediator->getPanSpectrumRelayPort());
+        } else if (this->mediator->getPanSpectrumRelayMode() == "Aggregate") {
+          if (!this->scanner->aggregate(
+                this->mediator->getPanSpectrumRelayPort()))
+            (void) QMessageBox::warning(
+                  this,
+                  "Panoramic spectrum",
+                  "Cannot listen for other nodes on port "
+                  + QString::number(this->mediator->getPanSpectrumRelayPort())
+                  + ". Scanning without them.",
+                  QMessageBox::Ok);
+        }
+
         for (auto p = device.getFirstGain();
              p != device.getLastGain();
              ++p) {
@@ -780,6 +1131,8 @@ void
 Application::onPanSpectrumStrategyChanged(QString strategy)
 {
   if (this->scanner != nullptr) {
+    this->scanner->setAdaptive(strategy.toStdString() == "Adaptive");
+
     if (strategy.toStdString() == "Stochastic")
       this->scanner->setStrategy(Suscan::Analyzer::STOCHASTIC);
     else if (strategy.toStdString() == "Progressive")
@@ -832,14 +1185,21 @@ void
 Application::onScannerUpdated(void)
 {
   SpectrumView &view = this->scanner->getSpectrumView();
+  unsigned int dirtyStart, dirtyEnd;
 
   this->mediator->setMinPanSpectrumBw(this->scanner->getFs());
 
+  // A hop only changes a slice of the view
+  if (!view.takeDirty(dirtyStart, dirtyEnd))
+    return;
+
   this->mediator->feedPanSpectrum(
         static_cast<quint64>(view.freqMin),
         static_cast<quint64>(view.freqMax),
-        view.psd,
-        SIGDIGGER_SCANNER_SPECTRUM_SIZE);
+        view.psd.data(),
+        view.size,
+        dirtyStart,
+        dirtyEnd);
 }
 
 void
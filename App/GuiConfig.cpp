@@ -18,6 +18,8 @@
 //
 
 #include "GuiConfig.h"
+#include "RenderScheduler.h"
+#include <Suscan/Analyzer.h>
 
 using namespace SigDigger;
 
@@ -39,8 +41,18 @@ GuiConfig::loadDefaults(void)
   this->useGLWaterfall = false;
   this->useGlInWindows = false;
   this->useMaxBlending = false;
+  this->useGLConstellation = false;
+  this->useGLTVDisplay = false;
   this->enableMsgTTL   = true;
   this->msgTTL         = 15; // in milliseconds
+  this->enablePsdGovernor = false;
+  this->enableLoadGovernor = true;
+  this->matchRemotePsdSize = true;
+  this->maxFps         = SIGDIGGER_RENDER_SCHEDULER_DEFAULT_FPS;
+  this->memoryBudget   = 0;
+  this->waterfallSpill = 0;
+  this->msgBatchSize   = SIGDIGGER_ANALYZER_DEFAULT_BATCH_SIZE;
+  this->msgBatchDeadline = SIGDIGGER_ANALYZER_DEFAULT_BATCH_DEADLINE_MS;
 }
 
 #define STRINGFY(x) #x
@@ -59,8 +71,18 @@ GuiConfig::serialize(void)
   STORE(useGLWaterfall);
   STORE(useMaxBlending);
   STORE(useGlInWindows);
+  STORE(useGLConstellation);
+  STORE(useGLTVDisplay);
   STORE(enableMsgTTL);
   STORE(msgTTL);
+  STORE(enablePsdGovernor);
+  STORE(enableLoadGovernor);
+  STORE(matchRemotePsdSize);
+  STORE(maxFps);
+  STORE(memoryBudget);
+  STORE(waterfallSpill);
+  STORE(msgBatchSize);
+  STORE(msgBatchDeadline);
 
   return this->persist(obj);
 }
@@ -73,6 +95,16 @@ GuiConfig::deserialize(Suscan::Object const &conf)
   LOAD(useGLWaterfall);
   LOAD(useMaxBlending);
   LOAD(useGlInWindows);
+  LOAD(useGLConstellation);
+  LOAD(useGLTVDisplay);
   LOAD(enableMsgTTL);
   LOAD(msgTTL);
+  LOAD(enablePsdGovernor);
+  LOAD(enableLoadGovernor);
+  LOAD(matchRemotePsdSize);
+  LOAD(maxFps);
+  LOAD(memoryBudget);
+  LOAD(waterfallSpill);
+  LOAD(msgBatchSize);
+  LOAD(msgBatchDeadline);
 }
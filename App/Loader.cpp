@@ -18,10 +18,12 @@
 //
 
 #include <iostream>
+#include <thread>
 
 #include <QThread>
 #include <QMessageBox>
 #include <SigDiggerHelpers.h>
+#include <FFTPlanCache.h>
 
 #include <Loader.h>
 
@@ -40,38 +42,22 @@ InitThread::run()
   Suscan::Singleton *sing = Suscan::Singleton::get_instance();
   QString verString;
 
+  // FFTW wisdom has nothing to do with Suscan: load it meanwhile
+  std::thread wisdom([] () { FFTPlanCache::instance()->loadWisdom(); });
+
   try {
-    emit change("Loading signal sources");
-    sing->init_sources();
-    emit change("Loading spectrum sources");
-    sing->init_spectrum_sources();
-    emit change("Loading estimators");
-    sing->init_estimators();
-    emit change("Loading inspectors");
-    sing->init_inspectors();
-    emit change("Loading palettes");
-    sing->init_palettes();
-    emit change("Loading frequency tables");
-    sing->init_fats();
-    emit change("Loading bookmarks");
-    sing->init_bookmarks();
-    emit change("Loading locations");
-    sing->init_locations();
-    emit change("Loading TLE sources");
-    sing->init_tle_sources();
-    emit change("Loading satellites from TLE");
-    sing->init_tle();
-    emit change("Loading auto gains");
-    sing->init_autogains();
-    emit change("Loading UI config");
-    sing->init_ui_config();
-    emit change("Loading profile history");
-    sing->init_recent_list();
-    emit change("Init done, reloading devices");
+    sing->init(
+          [this] (std::string const &message) {
+            emit change(QString::fromStdString(message));
+          });
   } catch (Suscan::Exception const &e) {
     emit failure(QString(e.what()));
   }
 
+  emit change("Loading FFT wisdom");
+  wisdom.join();
+  emit change("Init done, reloading devices");
+
   verString =
       "SigDigger "
       + SigDiggerHelpers::version()
@@ -223,8 +209,16 @@ Loader::handleDone(void)
 // Public methods
 void
 Loader::saveConfig(void)
+{
+  this->beginSaveConfig();
+  this->endSaveConfig();
+}
+
+void
+Loader::beginSaveConfig(void)
 {
   Suscan::Singleton *sing = Suscan::Singleton::get_instance();
+  QString error;
 
   this->app->refreshConfig();
 
@@ -232,18 +226,63 @@ Loader::saveConfig(void)
     Suscan::Object obj = std::move(this->app->getConfig());
 
     sing->putUIConfig(this->confIndex, std::move(obj));
+  } catch (Suscan::Exception const &e) {
+    error = QString::fromStdString(e.what());
+  }
+
+  if (!error.isEmpty()) {
+    std::promise<QString> failed;
+    failed.set_value(error);
+    this->configSaved = failed.get_future().share();
+    return;
+  }
 
-    sing->sync();
+  // Nothing in here touches the UI
+  this->configSaved = std::async(
+        std::launch::async,
+        [sing] () {
+          try {
+            sing->sync();
 
-    Suscan::ConfigContext::saveAll();
-  } catch (Suscan::Exception const &e) {
+            FFTPlanCache::instance()->saveWisdom();
+
+            Suscan::ConfigContext::saveAll();
+          } catch (Suscan::Exception const &e) {
+            return QString::fromStdString(e.what());
+          }
+
+          return QString();
+        }).share();
+}
+
+std::shared_future<QString>
+Loader::getPendingConfig(void) const
+{
+  return this->configSaved;
+}
+
+bool
+Loader::endSaveConfig(void)
+{
+  QString error;
+
+  if (!this->configSaved.valid())
+    return true;
+
+  error = this->configSaved.get();
+  this->configSaved = std::shared_future<QString>();
+
+  if (!error.isEmpty()) {
     (void) QMessageBox::critical(
           this,
           "Save configuration",
           "Failed to save SigDigger's configuration: <pre>"
-          + QString::fromStdString(e.what()) + "</pre>",
+          + error + "</pre>",
           QMessageBox::Close);
+    return false;
   }
+
+  return true;
 }
 
 void
@@ -0,0 +1,128 @@
+//
+//    ThreadConfig.cpp: Thread placement settings
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <ThreadConfig.h>
+#include <QStringList>
+
+using namespace SigDigger;
+
+bool
+ThreadRolePolicy::isDefault(void) const
+{
+  return this->cpus.empty() && this->priority == 0;
+}
+
+ThreadConfig::ThreadConfig()
+{
+  this->loadDefaults();
+}
+
+ThreadConfig::ThreadConfig(Suscan::Object const &conf) : ThreadConfig()
+{
+  this->deserialize(conf);
+}
+
+const char *
+ThreadConfig::roleName(ThreadRole role)
+{
+  switch (role) {
+    case THREAD_ROLE_ANALYZER:
+      return "analyzer";
+
+    case THREAD_ROLE_AUDIO:
+      return "audio";
+
+    case THREAD_ROLE_IO:
+      return "io";
+
+    case THREAD_ROLE_DSP:
+      return "dsp";
+
+    case THREAD_ROLE_TASKS:
+      return "tasks";
+
+    default:
+      return "unknown";
+  }
+}
+
+bool
+ThreadConfig::parseCpus(std::string const &spec, std::vector<int> &cpus)
+{
+  QStringList ranges =
+      QString::fromStdString(spec).split(",", QString::SkipEmptyParts);
+
+  cpus.clear();
+
+  for (auto &p : ranges) {
+    QStringList ends = p.trimmed().split("-");
+    bool okFirst, okLast = true;
+    int first, last;
+
+    if (ends.size() > 2)
+      return false;
+
+    first = ends[0].trimmed().toInt(&okFirst);
+    last  = ends.size() == 2 ? ends[1].trimmed().toInt(&okLast) : first;
+
+    if (!okFirst || !okLast || first < 0 || last < first)
+      return false;
+
+    for (int i = first; i <= last; ++i)
+      cpus.push_back(i);
+  }
+
+  return true;
+}
+
+void
+ThreadConfig::loadDefaults(void)
+{
+  for (auto &p : this->roles)
+    p = ThreadRolePolicy();
+}
+
+Suscan::Object &&
+ThreadConfig::serialize(void)
+{
+  Suscan::Object obj(SUSCAN_OBJECT_TYPE_OBJECT);
+
+  obj.setClass("threadcfg");
+
+  for (int i = 0; i < THREAD_ROLE_COUNT; ++i) {
+    std::string name = roleName(static_cast<ThreadRole>(i));
+
+    obj.set(name + "Cpus", this->roles[i].cpus);
+    obj.set(name + "Priority", this->roles[i].priority);
+  }
+
+  return this->persist(obj);
+}
+
+void
+ThreadConfig::deserialize(Suscan::Object const &conf)
+{
+  for (int i = 0; i < THREAD_ROLE_COUNT; ++i) {
+    std::string name = roleName(static_cast<ThreadRole>(i));
+
+    this->roles[i].cpus =
+        conf.get(name + "Cpus", this->roles[i].cpus);
+    this->roles[i].priority =
+        conf.get(name + "Priority", this->roles[i].priority);
+  }
+}
@@ -18,6 +18,7 @@
 //
 
 #include <AlsaPlayer.h>
+#include <cstring>
 
 using namespace SigDigger;
 
@@ -29,8 +30,10 @@ using namespace SigDigger;
 AlsaPlayer::AlsaPlayer(
     std::string const &dev,
     unsigned int rate,
-    size_t bufSiz) :
-  GenericAudioPlayer(rate)
+    size_t bufSiz,
+    unsigned int channels,
+    AudioSource *source) :
+  GenericAudioPlayer(rate, channels, source)
 {
   int err;
   snd_pcm_hw_params_t *params = nullptr;
@@ -42,11 +45,14 @@ AlsaPlayer::AlsaPlayer(
   snd_pcm_hw_params_alloca(&params);
   snd_pcm_hw_params_any(pcm, params);
 
+  // In pull mode we write straight into the device buffer
   ATTEMPT(
         snd_pcm_hw_params_set_access(
           this->pcm,
           params,
-          SND_PCM_ACCESS_RW_INTERLEAVED),
+          source != nullptr
+          ? SND_PCM_ACCESS_MMAP_INTERLEAVED
+          : SND_PCM_ACCESS_RW_INTERLEAVED),
         "set interleaved access for audio device");
 
   ATTEMPT(
@@ -56,16 +62,36 @@ AlsaPlayer::AlsaPlayer(
           SND_PCM_FORMAT_FLOAT_LE),
         "set sample format");
 
-  ATTEMPT(
-        snd_pcm_hw_params_set_buffer_size(
-          this->pcm,
-          params,
-          bufSiz),
-        "set buffer size");
+  if (source != nullptr) {
+    snd_pcm_uframes_t period = bufSiz;
+    snd_pcm_uframes_t size   = bufSiz * ALSAPLAYER_PULL_PERIODS;
+
+    ATTEMPT(
+          snd_pcm_hw_params_set_period_size_near(
+            this->pcm,
+            params,
+            &period,
+            nullptr),
+          "set period size");
+
+    ATTEMPT(
+          snd_pcm_hw_params_set_buffer_size_near(
+            this->pcm,
+            params,
+            &size),
+          "set buffer size");
+  } else {
+    ATTEMPT(
+          snd_pcm_hw_params_set_buffer_size(
+            this->pcm,
+            params,
+            bufSiz),
+          "set buffer size");
+  }
 
   ATTEMPT(
-        snd_pcm_hw_params_set_channels(this->pcm, params, 1),
-        "set output to mono");
+        snd_pcm_hw_params_set_channels(this->pcm, params, channels),
+        "set output to " + std::to_string(channels) + " channel(s)");
 
   ATTEMPT(
         snd_pcm_hw_params_set_rate_near(this->pcm, params, &rate, nullptr),
@@ -90,6 +116,64 @@ AlsaPlayer::write(const float *buffer, size_t len)
   return err >= 0;
 }
 
+bool
+AlsaPlayer::pull(void)
+{
+  snd_pcm_sframes_t avail;
+  int err;
+
+  if (this->source == nullptr)
+    return false;
+
+  if ((err = snd_pcm_wait(this->pcm, ALSAPLAYER_PULL_WAIT_MS)) < 0)
+    return snd_pcm_recover(this->pcm, err, 1) >= 0;
+
+  if ((avail = snd_pcm_avail_update(this->pcm)) < 0)
+    return snd_pcm_recover(this->pcm, static_cast<int>(avail), 1) >= 0;
+
+  while (avail > 0) {
+    const snd_pcm_channel_area_t *areas;
+    snd_pcm_uframes_t offset;
+    snd_pcm_uframes_t frames = static_cast<snd_pcm_uframes_t>(avail);
+    snd_pcm_sframes_t committed;
+    float *dest;
+    size_t got;
+
+    if ((err = snd_pcm_mmap_begin(this->pcm, &areas, &offset, &frames)) < 0)
+      return snd_pcm_recover(this->pcm, err, 1) >= 0;
+
+    // Interleaved access: one area for all channels
+    dest = reinterpret_cast<float *>(
+          static_cast<char *>(areas[0].addr)
+          + areas[0].first / 8
+          + offset * areas[0].step / 8);
+
+    got = this->source->read(dest, frames);
+    if (got < frames)
+      memset(
+            dest + got * this->channels,
+            0,
+            (frames - got) * this->channels * sizeof(float));
+
+    committed = snd_pcm_mmap_commit(this->pcm, offset, frames);
+    if (committed < 0)
+      return snd_pcm_recover(this->pcm, static_cast<int>(committed), 1) >= 0;
+
+    // Short commit: the device will tell us when it wants more
+    if (static_cast<snd_pcm_uframes_t>(committed) != frames)
+      break;
+
+    avail -= committed;
+  }
+
+  // Prepared (first time, or after recovering from an xrun) and full
+  if (snd_pcm_state(this->pcm) == SND_PCM_STATE_PREPARED)
+    if (snd_pcm_start(this->pcm) < 0)
+      return false;
+
+  return true;
+}
+
 AlsaPlayer::~AlsaPlayer()
 {
   if (this->pcm != nullptr) {
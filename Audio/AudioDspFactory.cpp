@@ -0,0 +1,152 @@
+//
+//    AudioDspFactory.cpp: Pluggable audio processing stages
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <AudioDspFactory.h>
+#include <Suscan/Library.h>
+#include <QElapsedTimer>
+
+using namespace SigDigger;
+
+/////////////////////////////// AudioDspStage /////////////////////////////////
+AudioDspStage::AudioDspStage(AudioDspFactory *factory) :
+  Suscan::FeatureObject(factory)
+{
+
+}
+
+void
+AudioDspStage::setSampleRate(unsigned int)
+{
+  // NO-OP
+}
+
+AudioDspStage::~AudioDspStage()
+{
+
+}
+
+////////////////////////////// AudioDspFactory /////////////////////////////////
+bool
+AudioDspFactory::registerGlobally(void)
+{
+  Suscan::Singleton *s = Suscan::Singleton::get_instance();
+
+  return s->registerAudioDspFactory(this);
+}
+
+bool
+AudioDspFactory::unregisterGlobally(void)
+{
+  Suscan::Singleton *s = Suscan::Singleton::get_instance();
+
+  return s->unregisterAudioDspFactory(this);
+}
+
+AudioDspFactory::AudioDspFactory(Suscan::Plugin *plugin)
+  : Suscan::FeatureFactory(plugin)
+{
+
+}
+
+/////////////////////////////// AudioDspChain //////////////////////////////////
+AudioDspChain::AudioDspChain(unsigned int rate)
+{
+  Suscan::Singleton *s = Suscan::Singleton::get_instance();
+
+  this->sampRate = rate;
+
+  for (auto p = s->getFirstAudioDspFactory();
+       p != s->getLastAudioDspFactory();
+       ++p) {
+    AudioDspStage *stage = (*p)->make();
+
+    if (stage != nullptr) {
+      stage->setSampleRate(rate);
+      this->stages.push_back(stage);
+    }
+  }
+
+  this->elapsed.resize(this->stages.size());
+}
+
+AudioDspChain::~AudioDspChain()
+{
+  for (auto stage : this->stages)
+    delete stage;
+}
+
+void
+AudioDspChain::setSampleRate(unsigned int rate)
+{
+  if (this->sampRate != rate) {
+    this->sampRate = rate;
+    this->overruns = 0;
+
+    for (auto stage : this->stages)
+      stage->setSampleRate(rate);
+  }
+}
+
+void
+AudioDspChain::bypassSlowest(void)
+{
+  size_t slowest = 0;
+
+  for (size_t i = 1; i < this->stages.size(); ++i)
+    if (this->elapsed[i] > this->elapsed[slowest])
+      slowest = i;
+
+  SU_WARNING(
+        "Audio DSP stage `%s' keeps going over budget, bypassed\n",
+        this->stages[slowest]->factoryName());
+
+  delete this->stages[slowest];
+  this->stages.erase(this->stages.begin() + static_cast<long>(slowest));
+  this->elapsed.erase(this->elapsed.begin() + static_cast<long>(slowest));
+}
+
+void
+AudioDspChain::process(float *block, size_t size)
+{
+  QElapsedTimer timer;
+  qint64 budget, total = 0;
+
+  if (this->stages.empty() || size == 0)
+    return;
+
+  budget = static_cast<qint64>(
+        SIGDIGGER_AUDIO_DSP_BUDGET * 1e9 * static_cast<qreal>(size)
+        / static_cast<qreal>(this->sampRate));
+
+  timer.start();
+
+  for (size_t i = 0; i < this->stages.size(); ++i) {
+    this->stages[i]->process(block, size);
+    this->elapsed[i] = timer.nsecsElapsed() - total;
+    total += this->elapsed[i];
+  }
+
+  // A single slow block is fine (the jitter buffer absorbs it), a stage
+  // that is consistently too slow for this rate is not
+  if (total <= budget) {
+    this->overruns = 0;
+  } else if (++this->overruns >= SIGDIGGER_AUDIO_DSP_OVERRUNS) {
+    this->bypassSlowest();
+    this->overruns = 0;
+  }
+}
@@ -20,6 +20,8 @@
 #include <AudioFileSaver.h>
 #include <sndfile.h>
 #include <unistd.h>
+#include <ctime>
+#include <cmath>
 
 using namespace SigDigger;
 
@@ -28,7 +30,21 @@ namespace SigDigger {
     AudioFileSaver::AudioFileParams params;
     std::string fullPath;
     std::string lastError;
+    std::vector<SUFLOAT> realData;
     SNDFILE *sfp = nullptr;
+    bool prepared = false;
+
+    // Squelch tracking for gated and split recordings. The hang time is
+    // counted in samples, as that is what the worker thread sees.
+    size_t hangLen = 0;
+    size_t silentRun = 0;
+    bool active = false;
+
+    std::string getExtension(void) const;
+    int getFormat(void) const;
+    bool openFile(void);
+    void closeFile(void);
+    bool writeSpan(const SUFLOAT *data, size_t len);
 
   public:
     AudioFileWriter(AudioFileSaver::AudioFileParams const &params);
@@ -48,58 +64,164 @@ AudioFileWriter::getError(void) const
   return this->lastError;
 }
 
+std::string
+AudioFileWriter::getExtension(void) const
+{
+  switch (this->params.format) {
+    case AudioFileSaver::RECORD_FORMAT_FLAC:
+      return "flac";
+
+    case AudioFileSaver::RECORD_FORMAT_OPUS:
+      return "opus";
+
+    default:
+      return "wav";
+  }
+}
+
+int
+AudioFileWriter::getFormat(void) const
+{
+  switch (this->params.format) {
+    case AudioFileSaver::RECORD_FORMAT_FLAC:
+      return SF_FORMAT_FLAC | SF_FORMAT_PCM_16;
+
+    case AudioFileSaver::RECORD_FORMAT_OPUS:
+#ifdef SF_FORMAT_OPUS
+      return SF_FORMAT_OGG | SF_FORMAT_OPUS;
+#else
+      return 0;
+#endif // SF_FORMAT_OPUS
+
+    default:
+      return SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+  }
+}
+
+bool
+AudioFileWriter::openFile(void)
+{
+  char fileName[160];
+  char stamp[32] = "";
+  unsigned int index = 1;
+  SF_INFO sfinfo;
+  std::string modulation;
+  std::string ext = this->getExtension();
+
+  switch (this->params.modulation) {
+    case AM:
+      modulation = "AM";
+      break;
+
+    case FM:
+      modulation = "FM";
+      break;
+
+    case USB:
+      modulation = "USB";
+      break;
+
+    case LSB:
+      modulation = "LSB";
+      break;
+  }
+
+  // Split recordings are named after the (UTC) start of the transmission
+  if (this->params.mode == AudioFileSaver::RECORD_SPLIT) {
+    time_t now = time(nullptr);
+    struct tm tm;
+
+    gmtime_r(&now, &tm);
+    strftime(stamp, sizeof(stamp), "-%Y%m%d-%H%M%S", &tm);
+  }
+
+  do {
+    snprintf(
+          fileName,
+          sizeof(fileName),
+          "audio-%s-%.0lf-%d%s-%04d.%s",
+          modulation.c_str(),
+          this->params.frequency,
+          this->params.sampRate,
+          stamp,
+          index++,
+          ext.c_str());
+    this->fullPath = this->params.savePath + "/" + fileName;
+  } while (access(this->fullPath.c_str(), F_OK) != -1);
+
+  sfinfo.channels = 1;
+  sfinfo.samplerate = static_cast<int>(this->params.sampRate);
+  sfinfo.format = this->getFormat();
+
+  if (sfinfo.format == 0) {
+    this->lastError =
+        "This build of libsndfile cannot encode Opus. Choose another format.";
+    return false;
+  }
+
+  if ((this->sfp = sf_open(this->fullPath.c_str(), SFM_WRITE, &sfinfo))
+      == nullptr) {
+    this->lastError =
+        std::string("Save file ")
+        + this->fullPath
+        + std::string(" failed: ")
+        + sf_strerror(nullptr);
+    return false;
+  }
+
+  return true;
+}
+
+void
+AudioFileWriter::closeFile(void)
+{
+  if (this->sfp != nullptr) {
+    sf_close(this->sfp);
+    this->sfp = nullptr;
+  }
+}
+
+bool
+AudioFileWriter::writeSpan(const SUFLOAT *data, size_t len)
+{
+  sf_count_t count = static_cast<sf_count_t>(len);
+
+  if (len == 0)
+    return true;
+
+  if (this->sfp == nullptr && !this->openFile())
+    return false;
+
+  // Encoding (if any) happens here, in the saver's worker thread
+  if (sf_write_float(this->sfp, data, count) != count) {
+    this->lastError =
+        std::string("Write to ")
+        + this->fullPath
+        + std::string(" failed: ")
+        + sf_strerror(this->sfp);
+    return false;
+  }
+
+  return true;
+}
+
 bool
 AudioFileWriter::prepare(void)
 {
-  if (this->sfp == nullptr) {
-    char fileName[128];
-    unsigned int index = 1;
-    SF_INFO sfinfo;
-    std::string modulation;
-
-    switch (this->params.modulation) {
-      case AM:
-        modulation = "AM";
-        break;
-
-      case FM:
-        modulation = "FM";
-        break;
-
-      case USB:
-        modulation = "USB";
-        break;
-
-      case LSB:
-        modulation = "LSB";
-        break;
-    }
+  if (!this->prepared) {
+    this->hangLen = static_cast<size_t>(
+          this->params.sampRate * 1e-3 * SIGDIGGER_AUDIO_SAVER_HANG_MS);
+    this->silentRun = 0;
+    this->active = false;
 
-    do {
-      snprintf(
-            fileName,
-            sizeof(fileName),
-            "audio-%s-%.0lf-%d-%04d.wav",
-            modulation.c_str(),
-            this->params.frequency,
-            this->params.sampRate,
-            index++);
-      this->fullPath = this->params.savePath + "/" + fileName;
-    } while (access(this->fullPath.c_str(), F_OK) != -1);
-
-    sfinfo.channels = 1;
-    sfinfo.samplerate = static_cast<int>(this->params.sampRate);
-    sfinfo.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
-
-    if ((this->sfp = sf_open(this->fullPath.c_str(), SFM_WRITE, &sfinfo))
-        == nullptr) {
-      this->lastError =
-          std::string("Save file ")
-          + this->fullPath
-          + std::string(" failed: ")
-          + sf_strerror(nullptr);
-      return false;
-    }
+    // Continuous and gated recordings go to a single file, opened now
+    // so that a bad path or format is reported right away. Split
+    // recordings open files as transmissions come in.
+    if (this->params.mode != AudioFileSaver::RECORD_SPLIT)
+      if (!this->openFile())
+        return false;
+
+    this->prepared = true;
   }
 
   return true;
@@ -118,41 +240,77 @@ AudioFileWriter::~AudioFileWriter(void)
 bool
 AudioFileWriter::canWrite(void) const
 {
-  return this->sfp != nullptr;
+  return this->prepared;
 }
 
 ssize_t
 AudioFileWriter::write(const void *data, size_t len)
 {
-  ssize_t result;
-  std::vector<SUFLOAT> realData;
   const SUCOMPLEX *asComplex = reinterpret_cast<const SUCOMPLEX *>(data);
-  unsigned int i;
+  size_t samples = len / sizeof(SUCOMPLEX);
+  size_t spanStart = 0;
+  size_t i;
 
-  if (this->sfp == nullptr)
+  if (!this->prepared)
     return 0;
 
-  // Convert length to a length in samples
-  len /= sizeof(SUCOMPLEX);
+  this->realData.resize(samples);
 
-  realData.resize(len);
+  for (i = 0; i < samples; ++i)
+    this->realData[i] = SU_C_REAL(asComplex[i]);
 
-  for (i = 0; i < len; ++i)
-    realData[i] = SU_C_REAL(asComplex[i]);
+  if (this->params.mode == AudioFileSaver::RECORD_CONTINUOUS) {
+    if (!this->writeSpan(this->realData.data(), samples))
+      return -1;
 
-  result = sf_write_float(this->sfp, realData.data(), len);
+    return static_cast<ssize_t>(samples * sizeof(SUCOMPLEX));
+  }
 
-  // Return this in bytes
-  return result * static_cast<ssize_t>(sizeof(SUCOMPLEX));
+  // Gated / split: keep samples from the first non-silent one until the
+  // squelch has stayed closed for the hang time. The tail of the hang
+  // time is written too, so transmissions do not end abruptly.
+  for (i = 0; i < samples; ++i) {
+    bool silent =
+        std::fabs(this->realData[i]) < SIGDIGGER_AUDIO_SAVER_SILENCE_LEVEL;
+
+    if (!this->active) {
+      if (!silent) {
+        this->active = true;
+        this->silentRun = 0;
+        spanStart = i;
+      }
+    } else if (silent) {
+      if (++this->silentRun >= this->hangLen) {
+        if (!this->writeSpan(
+              this->realData.data() + spanStart,
+              i + 1 - spanStart))
+          return -1;
+
+        this->active = false;
+
+        if (this->params.mode == AudioFileSaver::RECORD_SPLIT)
+          this->closeFile();
+      }
+    } else {
+      this->silentRun = 0;
+    }
+  }
+
+  if (this->active
+      && !this->writeSpan(
+        this->realData.data() + spanStart,
+        samples - spanStart))
+    return -1;
+
+  // Silence is consumed too, even if nothing was written
+  return static_cast<ssize_t>(samples * sizeof(SUCOMPLEX));
 }
 
 bool
 AudioFileWriter::close(void)
 {
-  if (this->sfp != nullptr) {
-    sf_close(this->sfp);
-    this->sfp = nullptr;
-  }
+  this->closeFile();
+  this->prepared = false;
 
   return true;
 }
@@ -161,6 +319,8 @@ AudioFileWriter::close(void)
 
 AudioFileSaver::~AudioFileSaver()
 {
+  this->finish();
+
   if (this->writer != nullptr)
     delete this->writer;
 }
@@ -172,4 +332,5 @@ AudioFileSaver::AudioFileSaver(
 {
   this->params = params;
   this->setSampleRate(params.sampRate);
+  this->tracker.set("Audio recording", true);
 }
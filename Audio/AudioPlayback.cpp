@@ -20,9 +20,15 @@
 #include <iostream>
 #include "AudioPlayback.h"
 #include <stdexcept>
+#include <cmath>
+#include <cstring>
 #include <util/compat-mman.h>
 #include <QCoreApplication>
 #include <GenericAudioPlayer.h>
+#include <SampleKernels.h>
+#include <Tracer.h>
+#include <ThreadPolicy.h>
+#include <LoadGovernor.h>
 
 #ifdef SIGDIGGER_HAVE_ALSA
 #  include "AlsaPlayer.h"
@@ -39,6 +45,7 @@ using namespace SigDigger;
 
 
 ///////////////////////////// Playback worker /////////////////////////////////
+// In frames: each buffer holds bufferSize * SIGDIGGER_AUDIO_CHANNELS floats
 unsigned int
 PlaybackWorker::calcBufferSizeForRate(unsigned int rate)
 {
@@ -49,14 +56,15 @@ PlaybackWorker::calcBufferSizeForRate(unsigned int rate)
           SIGDIGGER_AUDIO_BUFFER_DELAY_MS
           * 1e-3f
           * static_cast<float>(rate)),
-        static_cast<unsigned int>(SIGDIGGER_AUDIO_BUFFER_SIZE));
+        static_cast<unsigned int>(
+          SIGDIGGER_AUDIO_BUFFER_SIZE / SIGDIGGER_AUDIO_CHANNELS));
 
 }
 
 PlaybackWorker::PlaybackWorker(
     AudioBufferList *instance,
     std::string const &dev,
-    unsigned int sampRate)
+    unsigned int sampRate) : reader(instance)
 {
   this->device     = dev;
   this->sampRate   = sampRate;
@@ -71,23 +79,54 @@ PlaybackWorker::getBufferSize(void) const
 }
 
 void
-PlaybackWorker::setGain(float vol)
+PlaybackWorker::play(void)
 {
-  this->gain = vol;
+  if (this->player != nullptr) {
+    if (this->player->isPull())
+      this->pullLoop();
+    else
+      this->pushLoop();
+  }
 }
 
 void
-PlaybackWorker::play(void)
+PlaybackWorker::pullLoop(void)
+{
+  // If we are already pulling, we are being called from processEvents()
+  // below: the feeder is done buffering, and we can go on playing.
+  this->reader.resume();
+
+  if (this->pulling)
+    return;
+
+  this->pulling = true;
+
+  while (this->player != nullptr) {
+    if (!this->player->pull()) {
+      this->stopPlayback();
+      emit error("Playback error");
+      break;
+    }
+
+    if (this->reader.takeStarved())
+      emit starving();
+
+    // Process pending events
+    QCoreApplication::processEvents();
+  }
+
+  this->pulling = false;
+}
+
+void
+PlaybackWorker::pushLoop(void)
 {
   float *buffer;
-  unsigned int i;
 
+  // Gain was already applied by the feeder
   while (this->player != nullptr && (buffer = this->instance->next()) != nullptr) {
     bool ok;
 
-    for (i = 0; i < this->bufferSize; ++i)
-      buffer[i] *= this->gain;
-
     ok = this->player->write(buffer, this->bufferSize);
 
     // Done with this buffer, mark as free.
@@ -110,21 +149,33 @@ void
 PlaybackWorker::startPlayback()
 {
   if (this->player == nullptr) {
+#if SIGDIGGER_AUDIO_PULL_MODE
+    AudioSource *source = &this->reader;
+#else
+    AudioSource *source = nullptr;
+#endif // SIGDIGGER_AUDIO_PULL_MODE
+
     // Reset buffer list
     this->instance->clear();
+    this->reader.reset(this->bufferSize);
 
     try {
   #ifdef SIGDIGGER_HAVE_ALSA
     this->player = new AlsaPlayer(
           this->device,
           this->sampRate,
-          this->bufferSize);
+          this->bufferSize,
+          SIGDIGGER_AUDIO_CHANNELS,
+          source);
   #elif defined(SIGDIGGER_HAVE_PORTAUDIO)
     this->player = new PortAudioPlayer(
           this->device,
           this->sampRate,
-          this->bufferSize);
+          this->bufferSize,
+          SIGDIGGER_AUDIO_CHANNELS,
+          source);
   #else
+    (void) source;
     throw std::runtime_error(
         "Cannot create audio playback object: audio support disabled at compile time");
   #endif // SIGDIGGER_HAVE_ALSA
@@ -166,6 +217,77 @@ PlaybackWorker::halt(void)
   emit finished();
 }
 
+//////////////////////////// AudioBufferReader ////////////////////////////////
+AudioBufferReader::AudioBufferReader(AudioBufferList *instance)
+{
+  this->instance = instance;
+}
+
+void
+AudioBufferReader::reset(size_t bufferSize)
+{
+  this->current    = nullptr;
+  this->offset     = 0;
+  this->bufferSize = bufferSize;
+
+  this->playing.storeRelease(0);
+  this->starved.storeRelease(0);
+}
+
+void
+AudioBufferReader::resume(void)
+{
+  this->playing.storeRelease(1);
+}
+
+bool
+AudioBufferReader::takeStarved(void)
+{
+  return this->starved.fetchAndStoreAcquire(0) != 0;
+}
+
+size_t
+AudioBufferReader::read(float *frames, size_t len)
+{
+  size_t done = 0;
+
+  if (this->playing.loadAcquire() == 0)
+    return 0;
+
+  while (done < len) {
+    size_t chunk;
+
+    if (this->current == nullptr) {
+      if ((this->current = this->instance->next()) == nullptr) {
+        // Underrun: silence until the feeder has buffered again
+        this->playing.storeRelease(0);
+        this->starved.storeRelease(1);
+        break;
+      }
+
+      this->offset = 0;
+    }
+
+    chunk = qMin(len - done, this->bufferSize - this->offset);
+
+    memcpy(
+          frames + done * SIGDIGGER_AUDIO_CHANNELS,
+          this->current + this->offset * SIGDIGGER_AUDIO_CHANNELS,
+          chunk * SIGDIGGER_AUDIO_CHANNELS * sizeof(float));
+
+    done         += chunk;
+    this->offset += chunk;
+
+    // Done with this buffer, mark as free.
+    if (this->offset == this->bufferSize) {
+      this->instance->release();
+      this->current = nullptr;
+    }
+  }
+
+  return done;
+}
+
 ////////////////////////////////// Audio buffer ///////////////////////////////
 AudioBuffer::AudioBuffer()
 {
@@ -195,167 +317,462 @@ AudioBuffer::~AudioBuffer()
 }
 
 ////////////////////////////// AudioBufferList /////////////////////////////////
-AudioBufferList::AudioBufferList(unsigned int num) : listMutex(QMutex::Recursive)
+AudioBufferList::AudioBufferList(unsigned int num)
 {
-  unsigned int i;
+  // One slot is always kept empty, so that head == tail unambiguously
+  // means that there is nothing to play.
+  this->allocation.resize(num + 1);
+  this->totalLen = num;
+}
 
-  this->allocation.resize(num);
+float *
+AudioBufferList::reserve(void)
+{
+  unsigned int head = this->head.loadAcquire();
 
-  for (i = 0; i < num; ++i) {
-    AudioBuffer *buffer = &this->allocation[i];
-    buffer->next = this->freeList;
-    this->freeList = buffer;
+  // You cannot reserve a buffer before committing it
+  if (this->reserved) {
+    std::cerr << "Invalid reserve(), please call commit() first!" << std::endl;
+    return nullptr;
+  } else if (this->advance(head) == this->tail.loadAcquire()) {
+    // Ring full: the playback thread is lagging behind
+    return nullptr;
   }
 
-  this->freeLen = this->totalLen = num;
+  this->reserved = true;
+
+  return this->allocation[head].data;
 }
 
 void
-AudioBufferList::reset(void)
+AudioBufferList::commit(void)
 {
-  QMutexLocker(&this->listMutex);
+  // You cannot commit if the current buffer is null
+  if (!this->reserved) {
+    std::cerr << "Calling commit() with no reserve() is forbidden." << std::endl;
+  } else {
+    this->reserved = false;
 
-  if (this->current != nullptr) {
-    AudioBuffer *buffer = this->current;
-    this->current = nullptr;
+    // Release: the samples written to the buffer must be visible to the
+    // consumer before the new head is.
+    this->head.storeRelease(this->advance(this->head.loadAcquire()));
+  }
+}
 
-    buffer->next = this->freeList;
-    this->freeList = buffer;
+void
+AudioBufferList::cancel(void)
+{
+  // Nothing was published, the slot is simply reused by the next reserve()
+  this->reserved = false;
+}
+
+float *
+AudioBufferList::next(void)
+{
+  unsigned int tail = this->tail.loadAcquire();
+
+  if (this->playing) {
+    std::cerr << "Invalid next(), please call release() first!" << std::endl;
+    return nullptr;
+  } else if (tail == this->head.loadAcquire()) {
+    // Starving
+    return nullptr;
   }
 
-  if (this->playBuffer != nullptr) {
-    AudioBuffer *buffer = this->playBuffer;
-    this->playBuffer = nullptr;
+  this->playing = true;
+
+  return this->allocation[tail].data;
+}
+
+void
+AudioBufferList::release(void)
+{
+  if (!this->playing) {
+    std::cerr << "Invalid release(), please call next() first!" << std::endl;
+  } else {
+    this->playing = false;
 
-    buffer->next = this->freeList;
-    this->freeList = buffer;
+    // Release: we are done reading the buffer before the producer gets
+    // to overwrite it.
+    this->tail.storeRelease(this->advance(this->tail.loadAcquire()));
   }
+}
 
-  // Moving the current playlist is actually pretty easy
+void
+AudioBufferList::clear(void)
+{
+  // A buffer being filled by the producer is left alone: it will be
+  // committed (and played) as soon as it is full.
+  this->playing = false;
+  this->tail.storeRelease(this->head.loadAcquire());
+}
 
-  if (this->playListHead != nullptr) {
-    this->playListTail->next = this->freeList;
-    this->freeList = this->playListHead;
+////////////////////////////// PlaybackFeeder /////////////////////////////////
+PlaybackFeeder::PlaybackFeeder(AudioBufferList *instance, unsigned int sampRate)
+{
+  this->instance   = instance;
+  this->sampRate   = sampRate;
+  this->inRate     = sampRate;
+  this->bufferSize = PlaybackWorker::calcBufferSizeForRate(sampRate);
+  this->quietTimer.start();
+}
 
-    this->playListHead = this->playListTail = nullptr;
+void
+PlaybackFeeder::measureArrival(SUSCOUNT size)
+{
+  // A batch should arrive one batch duration after the previous one. How
+  // far it is from that tells how much we have to buffer to ride it out.
+  if (this->arrivalTimer.isValid()) {
+    qreal dt = static_cast<qreal>(this->arrivalTimer.nsecsElapsed()) * 1e-9;
+
+    this->jitter +=
+        (std::fabs(dt - this->lastDuration) - this->jitter)
+        / SIGDIGGER_AUDIO_JITTER_AVERAGE;
   }
 
-  this->freeLen = this->totalLen;
-  this->playListLen = 0;
+  this->arrivalTimer.restart();
+  this->lastDuration =
+      static_cast<qreal>(size) / static_cast<qreal>(this->inRate);
 }
 
-float *
-AudioBufferList::reserve(void)
+void
+PlaybackFeeder::updateTarget(void)
 {
-  QMutexLocker(&this->listMutex);
+  qreal bufferTime =
+      static_cast<qreal>(this->bufferSize) / static_cast<qreal>(this->sampRate);
+  unsigned int jitterTarget = SIGDIGGER_AUDIO_BUFFER_TARGET_MIN
+      + static_cast<unsigned int>(std::ceil(2 * this->jitter / bufferTime));
+
+  if (this->quietTimer.elapsed() > SIGDIGGER_AUDIO_QUIET_SHRINK_MS) {
+    if (this->starveTarget > SIGDIGGER_AUDIO_BUFFER_TARGET_MIN)
+      --this->starveTarget;
+    this->quietTimer.restart();
+  }
 
-  // You cannot reserve a buffer before committing int
-  if (this->current != nullptr) {
-    std::cerr << "Invalid reserve(), please call commit() first!" << std::endl;
-    return nullptr;
-  } else if (this->freeList == nullptr) {
-    // std::cerr << "Free audio buffer list exhausted!" << std::endl;
-    return nullptr;
+  this->target = qBound(
+        static_cast<unsigned int>(SIGDIGGER_AUDIO_BUFFER_TARGET_MIN),
+        qMax(jitterTarget, this->starveTarget),
+        static_cast<unsigned int>(SIGDIGGER_AUDIO_BUFFER_TARGET_MAX));
+}
+
+void
+PlaybackFeeder::updateRatio(void)
+{
+  qreal error;
+
+  this->fill +=
+      (static_cast<qreal>(this->instance->getPlayListLen()) - this->fill)
+      / SIGDIGGER_AUDIO_FILL_AVERAGE;
+
+  // Too full: consume input slightly faster than we play it, and the
+  // other way around. At most SIGDIGGER_AUDIO_DRIFT_MAX_PPM off.
+  error = (this->fill - static_cast<qreal>(this->target))
+      * SIGDIGGER_AUDIO_DRIFT_GAIN_PPM * 1e-6;
+
+  this->ratio = this->step * (1 + qBound(
+        -SIGDIGGER_AUDIO_DRIFT_MAX_PPM * 1e-6,
+        error,
+        +SIGDIGGER_AUDIO_DRIFT_MAX_PPM * 1e-6));
+}
+
+void
+PlaybackFeeder::mix(SUSCOUNT size)
+{
+  const Channel &clock = this->channels[this->clock];
+  float *out;
+
+  this->mixed.resize(size * SIGDIGGER_AUDIO_CHANNELS);
+  out = this->mixed.data();
+
+  for (SUSCOUNT i = 0; i < size; ++i) {
+    out[2 * i]     = clock.left  * this->scratch[i];
+    out[2 * i + 1] = clock.right * this->scratch[i];
+  }
+
+  // Channels that have not caught up simply contribute less this time
+  for (auto it = this->channels.begin(); it != this->channels.end(); ++it) {
+    std::vector<float> &backlog = it->backlog;
+    SUSCOUNT count;
+
+    if (it.key() == this->clock || backlog.empty())
+      continue;
+
+    count = qMin(size, static_cast<SUSCOUNT>(backlog.size()));
+
+    for (SUSCOUNT i = 0; i < count; ++i) {
+      out[2 * i]     += it->left  * backlog[i];
+      out[2 * i + 1] += it->right * backlog[i];
+    }
+
+    backlog.erase(backlog.begin(), backlog.begin() + static_cast<long>(count));
+  }
+}
+
+SUSCOUNT
+PlaybackFeeder::resample(const float *frames, SUSCOUNT size)
+{
+  qreal end = static_cast<qreal>(size) - 1;
+  SUSCOUNT n = 0;
+  SUSCOUNT max;
+  unsigned int j;
+
+  if (size == 0)
+    return 0;
+
+  max = static_cast<SUSCOUNT>(std::ceil((end - this->pos) / this->ratio)) + 1;
+  this->resampled.resize(max * SIGDIGGER_AUDIO_CHANNELS);
+
+  // Linear interpolation is plenty for corrections of a few hundred ppm,
+  // and acceptable for rate changes: the inspector already low-passed
+  // the audio to the cutoff frequency.
+  while (this->pos < end && n < max) {
+    qreal fl = std::floor(this->pos);
+    long i = static_cast<long>(fl);
+    float frac = static_cast<float>(this->pos - fl);
+
+    for (j = 0; j < SIGDIGGER_AUDIO_CHANNELS; ++j) {
+      float a = i < 0 ? this->last[j] : frames[i * SIGDIGGER_AUDIO_CHANNELS + j];
+      float b = frames[(i + 1) * SIGDIGGER_AUDIO_CHANNELS + j];
+
+      this->resampled[n * SIGDIGGER_AUDIO_CHANNELS + j] = a + frac * (b - a);
+    }
+
+    ++n;
+    this->pos += this->ratio;
   }
 
-  this->current = this->freeList;
-  this->freeList = this->freeList->next;
-  --this->freeLen;
+  for (j = 0; j < SIGDIGGER_AUDIO_CHANNELS; ++j)
+    this->last[j] = frames[(size - 1) * SIGDIGGER_AUDIO_CHANNELS + j];
+  this->pos -= static_cast<qreal>(size);
 
-  return this->current->data;
+  return n;
 }
 
 void
-AudioBufferList::commit(void)
+PlaybackFeeder::push(const float *samples, SUSCOUNT frames)
 {
-  QMutexLocker(&this->listMutex);
+  unsigned int bufferSize = this->bufferSize * SIGDIGGER_AUDIO_CHANNELS;
+  SUSCOUNT size = frames * SIGDIGGER_AUDIO_CHANNELS;
 
-  // You cannot commit if the current buffer is null
-  if (this->current == nullptr) {
-    std::cerr << "Calling commit() with no reserve() is forbidden." << std::endl;
-  } else {
-    AudioBuffer *buffer = this->current;
-    this->current = nullptr;
+  while (size > 0) {
+    SUSCOUNT chunk = size;
 
-    buffer->prev = nullptr;
-    buffer->next = this->playListHead;
-    if (this->playListHead != nullptr)
-      this->playListHead->prev = buffer;
+    // No current buffer, try to allocate
+    if (this->current == nullptr) {
+      this->ptr = 0;
+      if ((this->current = this->instance->reserve()) == nullptr) {
+        // Somehow the playback thread is slow...
+        return;
+      }
+    }
+
+    if (chunk > bufferSize - this->ptr)
+      chunk = bufferSize - this->ptr;
 
-    this->playListHead = buffer;
+    memcpy(this->current + this->ptr, samples, chunk * sizeof(float));
 
-    if (this->playListTail == nullptr)
-      this->playListTail = buffer;
-    ++this->playListLen;
+    samples   += chunk;
+    this->ptr += chunk;
+    size      -= chunk;
+
+    // Buffer full, send to playback thread.
+    if (this->ptr == bufferSize) {
+      this->current = nullptr;
+      this->instance->commit();
+
+      // If buffering, we wait until the target fill level is reached.
+      // When that happens, we restart the thread.
+      if (this->buffering) {
+        if (++this->completed >= this->target) {
+          emit restart();
+          this->buffering = false;
+        }
+      } else {
+        this->updateRatio();
+      }
+    }
   }
 }
 
-float *
-AudioBufferList::next(void)
+void
+PlaybackFeeder::write(const SUCOMPLEX *samples, SUSCOUNT size)
 {
-  QMutexLocker(&this->listMutex);
+  SIGDIGGER_TRACE_SCOPE("PlaybackFeeder::write");
+  SUSCOUNT count;
 
-  if (this->playBuffer != nullptr) {
-    std::cerr << "Invalid next(), please call release() first!" << std::endl;
-    return nullptr;
-  } else if (this->playListTail == nullptr) {
-    // Starving
-    return nullptr;
-  } else {
-    AudioBuffer *buffer = this->playListTail;
-    this->playBuffer = buffer;
+  if (!this->ready || size == 0)
+    return;
 
-    this->playListTail = buffer->prev;
+  this->measureArrival(size);
+  this->updateTarget();
 
-    if (this->playListTail == nullptr)
-      this->playListHead = nullptr;
-    --this->playListLen;
+  this->scratch.resize(size);
+  SampleKernels::realPart(this->scratch.data(), samples, size, this->gain);
+  this->channels[this->clock].dsp->process(this->scratch.data(), size);
 
-    return buffer->data;
+  // Mix even if we drop it: the other channels must stay aligned
+  this->mix(size);
+
+  // Way above target (e.g. after a burst, or after the target shrank):
+  // the resampler would take too long to catch up. Drop the batch.
+  if (!this->buffering
+      && this->instance->getPlayListLen()
+         > this->target + SIGDIGGER_AUDIO_BUFFER_SLACK)
+    return;
+
+  count = this->resample(this->mixed.data(), size);
+  this->push(this->resampled.data(), count);
+}
+
+void
+PlaybackFeeder::feed(Suscan::SamplesMessage msg)
+{
+  auto it = this->channels.find(msg.getInspectorId());
+
+  if (it == this->channels.end())
+    return;
+
+  if (it.key() == this->clock) {
+    this->write(msg.getSamples(), msg.getCount());
+  } else if (this->ready) {
+    std::vector<float> &backlog = it->backlog;
+    size_t size = backlog.size();
+    size_t count = msg.getCount();
+
+    backlog.resize(size + count);
+    SampleKernels::realPart(
+          backlog.data() + size,
+          msg.getSamples(),
+          count,
+          this->gain);
+    it->dsp->process(backlog.data() + size, count);
+
+    // The clock channel stalled (or is gone for good): forget the oldest
+    if (backlog.size() > SIGDIGGER_AUDIO_MIXER_BACKLOG)
+      backlog.erase(
+            backlog.begin(),
+            backlog.end() - SIGDIGGER_AUDIO_MIXER_BACKLOG);
   }
 }
 
 void
-AudioBufferList::release(void)
+PlaybackFeeder::setChannel(unsigned int id, float pan)
 {
-  QMutexLocker(&this->listMutex);
+  Channel &channel = this->channels[id];
 
-  if (this->playBuffer == nullptr) {
-    std::cerr << "Invalid release(), please call next() first!" << std::endl;
-  } else {
-    AudioBuffer *buffer = this->playBuffer;
-    this->playBuffer = nullptr;
+  pan = qBound(-1.f, pan, 1.f);
+
+  if (!channel.dsp)
+    channel.dsp = std::make_shared<AudioDspChain>(this->inRate);
 
-    buffer->next = this->freeList;
-    this->freeList = buffer;
-    ++this->freeLen;
+  // Balance law: centered channels play at full level on both sides
+  channel.left  = qMin(1.f, 1 - pan);
+  channel.right = qMin(1.f, 1 + pan);
+
+  if (!this->haveClock) {
+    this->clock = id;
+    this->haveClock = true;
   }
 }
 
 void
-AudioBufferList::clear(void)
+PlaybackFeeder::removeChannel(unsigned int id)
 {
-  QMutexLocker(&this->listMutex);
+  this->channels.remove(id);
+
+  if (this->haveClock && this->clock == id) {
+    this->haveClock = !this->channels.isEmpty();
+    if (this->haveClock)
+      this->clock = this->channels.firstKey();
+  }
+}
+
+void
+PlaybackFeeder::cancel(void)
+{
+  this->ptr = 0;
+  this->ready = false;
+  this->buffering = true;
+  this->completed = 0;
+
+  // Keep what we learned about the host (target), forget the stream
+  this->arrivalTimer.invalidate();
+  this->fill  = this->target;
+  this->ratio = this->step;
+  this->pos   = 0;
+
+  for (auto &last : this->last)
+    last = 0;
+
+  for (auto &channel : this->channels)
+    channel.backlog.clear();
 
-  // You cannot commit if the current buffer is null
   if (this->current != nullptr) {
-    AudioBuffer *buffer = this->current;
+    this->instance->cancel();
     this->current = nullptr;
+  }
+}
 
-    buffer->prev = nullptr;
-    buffer->next = this->playListHead;
-    if (this->playListHead != nullptr)
-      this->playListHead->prev = buffer;
+void
+PlaybackFeeder::setSampleRate(unsigned int rate)
+{
+  this->cancel();
+  this->sampRate   = rate;
+  this->inRate     = rate;
+  this->step       = 1;
+  this->ratio      = 1;
+  this->bufferSize = PlaybackWorker::calcBufferSizeForRate(rate);
+  this->jitter     = 0;
 
-    this->playListHead = buffer;
+  for (auto &channel : this->channels)
+    channel.dsp->setSampleRate(rate);
+}
 
-    if (this->playListTail == nullptr)
-      this->playListTail = buffer;
-    ++this->playListLen;
-  }
+void
+PlaybackFeeder::setInputRate(unsigned int rate)
+{
+  qreal step =
+      static_cast<qreal>(rate) / static_cast<qreal>(this->sampRate);
+
+  // Keep the current drift correction, just rescaled
+  this->ratio *= step / this->step;
+  this->step   = step;
+  this->inRate = rate;
+
+  for (auto &channel : this->channels)
+    channel.dsp->setSampleRate(rate);
+}
+
+void
+PlaybackFeeder::setGain(float gain)
+{
+  this->gain = gain;
+}
+
+void
+PlaybackFeeder::onReady(void)
+{
+  this->ready = true;
+}
+
+void
+PlaybackFeeder::onStarving(void)
+{
+  if (this->instance->getPlayListLen() < SIGDIGGER_AUDIO_BUFFERING_WATERMARK) {
+    // Underrun: we were too optimistic about this host
+    this->starveTarget = qMin(
+          this->starveTarget + SIGDIGGER_AUDIO_UNDERRUN_GROWTH,
+          static_cast<unsigned int>(SIGDIGGER_AUDIO_BUFFER_TARGET_MAX));
+    this->quietTimer.restart();
+    this->updateTarget();
+    LoadGovernor::notifyUnderrun();
 
-  while (next())
-    release();
+    this->completed = 0;
+    this->buffering = true;
+    std::cout << "AudioPlayback: reached watermark, buffering again..." << std::endl;
+  } else {
+    emit restart();
+  }
 }
 
 //////////////////////////////// AudioBuffer ///////////////////////////////////
@@ -364,7 +781,7 @@ AudioPlayback::AudioPlayback(std::string const &dev, unsigned int rate)
 {
   this->device = dev;
   this->sampRate = rate;
-  this->bufferSize = PlaybackWorker::calcBufferSizeForRate(rate);
+  this->inRate = rate;
   this->startWorker();
 }
 
@@ -376,9 +793,16 @@ AudioPlayback::startWorker()
         this->device,
         this->sampRate);
 
+  this->feeder = new PlaybackFeeder(&this->bufferList, this->sampRate);
+
   this->workerThread = new QThread();
+  this->feederThread = new QThread();
+
+  ThreadPolicy::bind(this->workerThread, THREAD_ROLE_AUDIO);
+  ThreadPolicy::bind(this->feederThread, THREAD_ROLE_AUDIO);
 
   this->worker->moveToThread(this->workerThread);
+  this->feeder->moveToThread(this->feederThread);
 
   connect(
         this->worker,
@@ -386,25 +810,57 @@ AudioPlayback::startWorker()
         this,
         SLOT(onError(QString)));
 
+  // Buffering state belongs to the feeder. The worker talks to it directly,
+  // without going through the GUI thread.
   connect(
         this->worker,
         SIGNAL(starving()),
-        this,
+        this->feeder,
         SLOT(onStarving()));
 
   connect(
         this->worker,
         SIGNAL(ready()),
-        this,
+        this->feeder,
         SLOT(onReady()));
 
   // On restart, play
   connect(
-        this,
+        this->feeder,
         SIGNAL(restart()),
         this->worker,
         SLOT(play()));
 
+  connect(
+        this,
+        SIGNAL(samples(Suscan::SamplesMessage)),
+        this->feeder,
+        SLOT(feed(Suscan::SamplesMessage)));
+
+  connect(
+        this,
+        SIGNAL(channel(unsigned int, float)),
+        this->feeder,
+        SLOT(setChannel(unsigned int, float)));
+
+  connect(
+        this,
+        SIGNAL(channelRemoved(unsigned int)),
+        this->feeder,
+        SLOT(removeChannel(unsigned int)));
+
+  connect(
+        this,
+        SIGNAL(cancel()),
+        this->feeder,
+        SLOT(cancel()));
+
+  connect(
+        this,
+        SIGNAL(inputRate(unsigned int)),
+        this->feeder,
+        SLOT(setInputRate(unsigned int)));
+
   connect(
         this,
         SIGNAL(startPlayback()),
@@ -417,6 +873,14 @@ AudioPlayback::startWorker()
         this->worker,
         SLOT(stopPlayback()));
 
+  // The feeder must see the new rate before the worker restarts the
+  // player (and signals ready)
+  connect(
+        this,
+        SIGNAL(sampleRate(unsigned int)),
+        this->feeder,
+        SLOT(setSampleRate(unsigned int)));
+
   connect(
         this,
         SIGNAL(sampleRate(unsigned int)),
@@ -426,10 +890,11 @@ AudioPlayback::startWorker()
   connect(
         this,
         SIGNAL(gain(float)),
-        this->worker,
+        this->feeder,
         SLOT(setGain(float)));
 
   this->workerThread->start();
+  this->feederThread->start(QThread::HighPriority);
 }
 
 void
@@ -439,22 +904,19 @@ AudioPlayback::onError(QString desc)
   emit error(desc);
 }
 
-void
-AudioPlayback::onStarving(void)
-{
-  if (this->bufferList.getPlayListLen() < SIGDIGGER_AUDIO_BUFFERING_WATERMARK) {
-    this->completed = 0;
-    this->buffering = true;
-    std::cout << "AudioPlayback: reached watermark, buffering again..." << std::endl;
-  } else {
-    emit restart();
-  }
-}
-
 AudioPlayback::~AudioPlayback()
 {
   emit halt();
 
+  if (this->feederThread != nullptr) {
+    this->feederThread->quit();
+    this->feederThread->wait();
+    delete this->feederThread;
+
+    if (this->feeder != nullptr)
+      delete this->feeder;
+  }
+
   if (this->workerThread != nullptr) {
     this->workerThread->quit();
     this->workerThread->wait();
@@ -474,11 +936,7 @@ AudioPlayback::getSampleRate(void) const
 void
 AudioPlayback::cancelPlayBack(void)
 {
-  this->bufferSize = PlaybackWorker::calcBufferSizeForRate(this->sampRate);
-  this->ptr = 0;
-  this->ready = false;
-  this->current_buffer = nullptr;
-  this->completed = 0;
+  emit cancel();
 }
 
 void
@@ -486,11 +944,26 @@ AudioPlayback::setSampleRate(unsigned int rate)
 {
   if (this->sampRate != rate) {
     this->sampRate = rate;
-    this->cancelPlayBack();
+    this->inRate   = rate;
     emit sampleRate(rate);
   }
 }
 
+unsigned int
+AudioPlayback::getInputRate(void) const
+{
+  return this->inRate;
+}
+
+void
+AudioPlayback::setInputRate(unsigned int rate)
+{
+  if (this->inRate != rate) {
+    this->inRate = rate;
+    emit inputRate(rate);
+  }
+}
+
 float
 AudioPlayback::getVolume(void) const
 {
@@ -516,7 +989,6 @@ AudioPlayback::start(void)
 {
   if (!this->running) {
     emit startPlayback();
-    this->buffering = true;
     this->running = true;
   }
 }
@@ -532,55 +1004,21 @@ AudioPlayback::stop(void)
 }
 
 void
-AudioPlayback::write(const SUCOMPLEX *samples, SUSCOUNT size)
+AudioPlayback::write(Suscan::SamplesMessage const &msg)
 {
-  unsigned int bufferSize = this->bufferSize;
-
-  while (size > 0 && this->running && this->ready) {
-    SUSCOUNT chunk = size;
-    SUSCOUNT remaining;
-    float *start;
-
-    // No current buffer, try to allocate
-    if (this->current_buffer == nullptr) {
-      this->ptr = 0;
-      if ((this->current_buffer = this->bufferList.reserve()) == nullptr) {
-        // Somehow the playback thread is slow...
-        return;
-      }
-    }
-
-    start = this->current_buffer + this->ptr;
-
-    if (chunk > bufferSize - this->ptr)
-      chunk = bufferSize - this->ptr;
-    remaining = chunk;
-
-    while (remaining-- > 0)
-      *start++ = SU_C_REAL(*samples++);
-
-    this->ptr += chunk;
-    size -= chunk;
-
-    // Buffer full, send to playback thread.
-    if (this->ptr == bufferSize) {
-      this->current_buffer = nullptr;
-      this->bufferList.commit();
+  SIGDIGGER_TRACE_SCOPE("AudioPlayback::write");
+  if (this->running)
+    emit samples(msg);
+}
 
-      // If buffering, we wait until we have SIGDIGGER_AUDIO_BUFFER_MIN
-      // buffers full. When that happens, we restart the thread.
-      if (this->buffering) {
-        if (++this->completed == SIGDIGGER_AUDIO_BUFFER_MIN) {
-          emit restart();
-          this->buffering = false;
-        }
-      }
-    }
-  }
+void
+AudioPlayback::setChannel(Suscan::InspectorId id, SUFLOAT pan)
+{
+  emit channel(id, pan);
 }
 
 void
-AudioPlayback::onReady(void)
+AudioPlayback::removeChannel(Suscan::InspectorId id)
 {
-  this->ready = true;
+  emit channelRemoved(id);
 }
@@ -21,9 +21,19 @@
 
 using namespace SigDigger;
 
-GenericAudioPlayer::GenericAudioPlayer(unsigned int sampleRate)
+AudioSource::~AudioSource()
+{
+
+}
+
+GenericAudioPlayer::GenericAudioPlayer(
+    unsigned int sampleRate,
+    unsigned int channels,
+    AudioSource *source)
 {
   this->sampleRate = sampleRate;
+  this->channels   = channels;
+  this->source     = source;
 }
 
 GenericAudioPlayer::~GenericAudioPlayer()
@@ -18,6 +18,7 @@
 //
 
 #include <PortAudioPlayer.h>
+#include <cstring>
 
 #define ATTEMPT(expr, what) \
   if ((err = expr) < 0)  \
@@ -52,8 +53,10 @@ PortAudioPlayer::paFinalizer(void)
 PortAudioPlayer::PortAudioPlayer(
     std::string const &,
     unsigned int rate,
-    size_t bufSiz)
-  : GenericAudioPlayer(rate)
+    size_t bufSiz,
+    unsigned int channels,
+    AudioSource *source)
+  : GenericAudioPlayer(rate, channels, source)
 {
   PaStreamParameters outputParameters;
   PaError pErr;
@@ -62,12 +65,19 @@ PortAudioPlayer::PortAudioPlayer(
     throw std::runtime_error("Failed to initialize PortAudio library");
 
   outputParameters.device = Pa_GetDefaultOutputDevice(); /* default output device */
-  outputParameters.channelCount = 1;
+  outputParameters.channelCount = static_cast<int>(channels);
   outputParameters.sampleFormat = paFloat32;
   outputParameters.suggestedLatency =
-      Pa_GetDeviceInfo(outputParameters.device)->defaultHighOutputLatency;
+      source != nullptr
+      ? Pa_GetDeviceInfo(outputParameters.device)->defaultLowOutputLatency
+      : Pa_GetDeviceInfo(outputParameters.device)->defaultHighOutputLatency;
   outputParameters.hostApiSpecificStreamInfo = nullptr;
 
+  this->periodMs = static_cast<unsigned long>(1000 * bufSiz / rate);
+  if (this->periodMs < 1)
+    this->periodMs = 1;
+
+  // In pull mode, PortAudio calls us back from its own thread
   pErr = Pa_OpenStream(
      &this->stream,
      nullptr,
@@ -75,8 +85,8 @@ PortAudioPlayer::PortAudioPlayer(
      rate,
      bufSiz,
      paClipOff,
-     nullptr,
-     nullptr);
+     source != nullptr ? PortAudioPlayer::streamCallback : nullptr,
+     source != nullptr ? this : nullptr);
 
   if (pErr != paNoError)
       throw std::runtime_error(
@@ -105,6 +115,41 @@ PortAudioPlayer::write(const float *buffer, size_t len)
   return err == paNoError;
 }
 
+int
+PortAudioPlayer::streamCallback(
+    const void *,
+    void *output,
+    unsigned long frames,
+    const PaStreamCallbackTimeInfo *,
+    PaStreamCallbackFlags,
+    void *userData)
+{
+  PortAudioPlayer *self = static_cast<PortAudioPlayer *>(userData);
+  float *dest = static_cast<float *>(output);
+  size_t got = self->source->read(dest, frames);
+
+  if (got < frames)
+    memset(
+          dest + got * self->channels,
+          0,
+          (frames - got) * self->channels * sizeof(float));
+
+  return paContinue;
+}
+
+bool
+PortAudioPlayer::pull(void)
+{
+  if (this->source == nullptr)
+    return false;
+
+  // The callback does the actual work. All we do is stay out of the way
+  // for a period, and see whether the stream is still alive.
+  Pa_Sleep(static_cast<long>(this->periodMs));
+
+  return Pa_IsStreamActive(this->stream) == 1;
+}
+
 PortAudioPlayer::~PortAudioPlayer()
 {
   if (this->stream != nullptr) {
@@ -123,7 +123,7 @@ BackgroundTasksDialog::setController(Suscan::MultitaskController *controller)
 
   connect(
         this->model,
-        SIGNAL(layoutChanged(void)),
+        SIGNAL(modelReset(void)),
         this,
         SLOT(onLayoutChanged(void)));
 
@@ -135,7 +135,7 @@ BackgroundTasksDialog::setController(Suscan::MultitaskController *controller)
             const QModelIndex &,
             const QVector<int> &)),
         this,
-        SLOT(onLayoutChanged(void)));
+        SLOT(onDataChanged(void)));
 
   connect(
         delegate,
@@ -174,6 +174,14 @@ BackgroundTasksDialog::onLayoutChanged(void)
   this->ui->cancelAllButton->setEnabled(rows > 0);
 }
 
+void
+BackgroundTasksDialog::onDataChanged(void)
+{
+  // Fitting the status column measures every row: not while hidden
+  if (this->isVisible())
+    this->ui->tableView->resizeColumnToContents(2);
+}
+
 void
 BackgroundTasksDialog::onCancelClicked(QModelIndex index)
 {
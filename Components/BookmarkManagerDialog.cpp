@@ -23,6 +23,12 @@
 #include <Suscan/Library.h>
 #include <AddBookmarkDialog.h>
 #include <TableDelegates.h>
+#include <BookmarkImportTask.h>
+#include <Suscan/MultitaskController.h>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QPushButton>
 
 using namespace SigDigger;
 
@@ -38,11 +44,11 @@ BookmarkManagerDialog::BookmarkManagerDialog(QWidget *parent) :
   this->model = new BookmarkTableModel(
         this,
         &Suscan::Singleton::get_instance()->getBookmarkMap());
-  this->proxy = new QSortFilterProxyModel(this);
-  this->proxy->setSourceModel(this->model);
+  this->proxy = new BookmarkFilterProxyModel(this, this->model);
 
-  this->ui->bookmarkView->setModel(this->model);
-  this->ui->bookmarkView->setSortingEnabled(false);
+  this->ui->bookmarkView->setModel(this->proxy);
+  this->ui->bookmarkView->setSortingEnabled(true);
+  this->ui->bookmarkView->sortByColumn(0, Qt::AscendingOrder);
 
   this->editDialog = new AddBookmarkDialog(this);
   this->editDialog->setWindowTitle("Edit bookmark");
@@ -59,6 +65,10 @@ BookmarkManagerDialog::BookmarkManagerDialog(QWidget *parent) :
   headerView->setStretchLastSection(false);
   headerView->setSectionResizeMode(4, QHeaderView::Stretch);
 
+  this->importButton = this->ui->buttonBox->addButton(
+        "&Import...",
+        QDialogButtonBox::ActionRole);
+
   this->connectAll();
 }
 
@@ -88,6 +98,18 @@ BookmarkManagerDialog::connectAll(void)
         SIGNAL(activated(QModelIndex const &)),
         this,
         SLOT(onCellActivated(QModelIndex const &)));
+
+  connect(
+        this->ui->filterEdit,
+        SIGNAL(textChanged(QString)),
+        this,
+        SLOT(onFilterChanged(QString)));
+
+  connect(
+        this->importButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onImport(void)));
 }
 
 BookmarkManagerDialog::~BookmarkManagerDialog()
@@ -116,17 +138,14 @@ BookmarkManagerDialog::notifyChanged(void)
 void
 BookmarkManagerDialog::onRemoveBookmark(QModelIndex index)
 {
-  auto map = &Suscan::Singleton::get_instance()->getBookmarkMap();
+  int row = this->proxy->mapToSource(index).row();
+  const Suscan::Bookmark *bm = this->model->bookmarkAt(row);
 
-  if (this->ui->bookmarkView->model() == this->proxy)
-    index = this->proxy->mapToSource(index);
-
-  int row = index.row();
-
-  if (row >= 0 && row < map->count()) {
-    Suscan::Bookmark bm = (*map)[map->keys().at(row)];
+  if (bm != nullptr) {
+    // The pointer belongs to the map entry we are about to remove
+    qint64 frequency = bm->info.frequency;
     this->model->notifyRemovalStart(row);
-    Suscan::Singleton::get_instance()->removeBookmark(bm.info.frequency);
+    Suscan::Singleton::get_instance()->removeBookmark(frequency);
     this->model->notifyRemovalFinish();
   }
 }
@@ -156,23 +175,17 @@ BookmarkManagerDialog::onEditAccepted(void)
 void
 BookmarkManagerDialog::onEditBookmark(QModelIndex index)
 {
-  auto map = &Suscan::Singleton::get_instance()->getBookmarkMap();
-
-  if (this->ui->bookmarkView->model() == this->proxy)
-    index = this->proxy->mapToSource(index);
+  const Suscan::Bookmark *bm =
+      this->model->bookmarkAt(this->proxy->mapToSource(index).row());
 
-  int row = index.row();
+  if (bm != nullptr) {
+    this->editingFrequency = bm->info.frequency;
 
-  if (row >= 0 && row < map->count()) {
-    Suscan::Bookmark bm = (*map)[map->keys().at(row)];
-
-    this->editingFrequency = bm.info.frequency;
-
-    this->editDialog->setNameHint(bm.info.name);
+    this->editDialog->setNameHint(bm->info.name);
     this->editDialog->setFrequencyHint(this->editingFrequency);
-    this->editDialog->setColorHint(bm.info.color);
-    this->editDialog->setBandwidthHint(bm.info.bandwidth());
-    this->editDialog->setModulationHint(bm.info.modulation);
+    this->editDialog->setColorHint(bm->info.color);
+    this->editDialog->setBandwidthHint(bm->info.bandwidth());
+    this->editDialog->setModulationHint(bm->info.modulation);
 
     this->editDialog->show();
   }
@@ -181,17 +194,98 @@ BookmarkManagerDialog::onEditBookmark(QModelIndex index)
 void
 BookmarkManagerDialog::onCellActivated(QModelIndex const &index)
 {
-  QModelIndex copy = index;
+  const Suscan::Bookmark *bm =
+      this->model->bookmarkAt(this->proxy->mapToSource(index).row());
+
+  if (bm != nullptr)
+    emit bookmarkSelected(bm->info);
+}
+
+void
+BookmarkManagerDialog::onFilterChanged(QString text)
+{
+  this->proxy->setFilter(text);
+}
 
-  auto map = &Suscan::Singleton::get_instance()->getBookmarkMap();
+void
+BookmarkManagerDialog::onImport(void)
+{
+  QString path = QFileDialog::getOpenFileName(
+        this,
+        "Import bookmarks",
+        QString(),
+        "Bookmark lists (*.csv *.txt);;All files (*)");
 
-  if (this->ui->bookmarkView->model() == this->proxy)
-    copy = this->proxy->mapToSource(copy);
+  if (path.isEmpty())
+    return;
 
-  int row = copy.row();
+  BookmarkImportTask *task = new BookmarkImportTask(path);
 
-  if (row >= 0 && row < map->count()) {
-    Suscan::Bookmark bm = (*map)[map->keys().at(row)];
-    emit bookmarkSelected(bm.info);
-  }
+  connect(
+        task,
+        SIGNAL(parsed(QString, QList<BookmarkInfo>, int)),
+        this,
+        SLOT(onImportParsed(QString, QList<BookmarkInfo>, int)));
+
+  connect(
+        task,
+        SIGNAL(error(QString)),
+        this,
+        SLOT(onImportError(QString)));
+
+  connect(
+        task,
+        SIGNAL(cancelled(void)),
+        this,
+        SLOT(onImportCancelled(void)));
+
+  // One import at a time: the list is merged once parsing is done
+  this->importButton->setEnabled(false);
+
+  Suscan::Singleton::get_instance()->getBackgroundTaskController()->pushTask(
+        task,
+        "Import bookmarks from " + QFileInfo(path).fileName());
+}
+
+void
+BookmarkManagerDialog::onImportParsed(
+    QString path,
+    QList<BookmarkInfo> list,
+    int rejected)
+{
+  int added = Suscan::Singleton::get_instance()->registerBookmarks(list);
+  QString message = QString("%1 bookmarks imported from %2.")
+      .arg(added)
+      .arg(QFileInfo(path).fileName());
+
+  this->importButton->setEnabled(true);
+
+  // Model rows, waterfall overlay and bookmark file: all rebuilt once
+  if (added > 0)
+    this->notifyChanged();
+
+  if (added < list.size())
+    message += QString(" %1 were already bookmarked.").arg(list.size() - added);
+
+  if (rejected > 0)
+    message += QString(" %1 lines could not be parsed.").arg(rejected);
+
+  QMessageBox::information(this, "Import bookmarks", message);
+}
+
+void
+BookmarkManagerDialog::onImportError(QString message)
+{
+  this->importButton->setEnabled(true);
+
+  QMessageBox::critical(
+        this,
+        "Import bookmarks",
+        "Failed to import bookmarks: " + message);
+}
+
+void
+BookmarkManagerDialog::onImportCancelled(void)
+{
+  this->importButton->setEnabled(true);
 }
@@ -0,0 +1,214 @@
+//
+//    CyclicSpectrumDialog.cpp: Cyclic spectrum of a time window selection
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "CyclicSpectrumDialog.h"
+#include "ui_CyclicSpectrumDialog.h"
+#include "CyclicSpectrumTask.h"
+#include "Palette.h"
+#include <SuWidgetsHelpers.h>
+#include <QPixmap>
+
+using namespace SigDigger;
+
+CyclicSpectrumDialog::CyclicSpectrumDialog(QWidget *parent) :
+  QDialog(parent),
+  ui(new Ui::CyclicSpectrumDialog)
+{
+  ui->setupUi(this);
+  this->setWindowFlags(
+        this->windowFlags() | Qt::Window | Qt::WindowMaximizeButtonHint);
+
+  for (unsigned int size = 16; size <= 256; size <<= 1)
+    this->ui->channelsCombo->addItem(QString::number(size), QVariant(size));
+  this->ui->channelsCombo->setCurrentIndex(
+        this->ui->channelsCombo->findData(QVariant(64u)));
+
+  for (unsigned int size = 32; size <= 1024; size <<= 1)
+    this->ui->framesCombo->addItem(QString::number(size), QVariant(size));
+  this->ui->framesCombo->setCurrentIndex(
+        this->ui->framesCombo->findData(QVariant(256u)));
+
+  this->connectAll();
+}
+
+CyclicSpectrumDialog::~CyclicSpectrumDialog()
+{
+  delete ui;
+}
+
+void
+CyclicSpectrumDialog::connectAll(void)
+{
+  connect(
+        this->ui->computeButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SIGNAL(computeRequested(void)));
+
+  connect(
+        this->ui->rangeSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onRangeChanged(void)));
+}
+
+void
+CyclicSpectrumDialog::setSampleRate(qreal fs)
+{
+  this->fs = fs;
+}
+
+void
+CyclicSpectrumDialog::setPalette(const Palette *palette)
+{
+  this->palette = palette;
+
+  if (this->result && this->result->complete)
+    this->redraw();
+}
+
+unsigned int
+CyclicSpectrumDialog::getChannels(void) const
+{
+  return this->ui->channelsCombo->currentData().toUInt();
+}
+
+unsigned int
+CyclicSpectrumDialog::getFrames(void) const
+{
+  return this->ui->framesCombo->currentData().toUInt();
+}
+
+void
+CyclicSpectrumDialog::refreshInfo(void)
+{
+  const CyclicSpectrumResult *result = this->result.get();
+  QString features;
+
+  if (result == nullptr || result->blocks == 0) {
+    this->ui->infoLabel->setText("No cyclic spectrum");
+    this->ui->featuresLabel->setText("");
+    return;
+  }
+
+  this->ui->infoLabel->setText(
+        QString::number(result->blocks)
+        + " blocks of "
+        + QString::number(result->frames)
+        + " frames. Frequency resolution: "
+        + SuWidgetsHelpers::formatQuantity(this->fs / result->channels, "Hz")
+        + ", cyclic resolution: "
+        + SuWidgetsHelpers::formatQuantity(
+          this->fs / (result->frames * result->hop), "Hz")
+        + (result->complete ? "" : " (computing...)"));
+
+  if (!result->complete) {
+    this->ui->featuresLabel->setText("");
+    return;
+  }
+
+  for (auto const &f : result->features) {
+    if (!features.isEmpty())
+      features += ", ";
+    features +=
+        SuWidgetsHelpers::formatQuantity(f.alpha * this->fs, "Hz")
+        + " ("
+        + QString::number(
+          static_cast<qreal>(f.level - result->featurePeak), 'f', 1)
+        + " dB)";
+  }
+
+  this->ui->featuresLabel->setText(
+        features.isEmpty()
+        ? "No cyclic features found"
+        : "Cyclic features: " + features);
+}
+
+void
+CyclicSpectrumDialog::setResult(
+    std::shared_ptr<const CyclicSpectrumResult> const &result)
+{
+  this->result = result;
+
+  this->refreshInfo();
+
+  if (result->complete)
+    this->redraw();
+}
+
+void
+CyclicSpectrumDialog::notifyComplete(void)
+{
+  this->refreshInfo();
+  this->redraw();
+}
+
+void
+CyclicSpectrumDialog::redraw(void)
+{
+  const CyclicSpectrumResult *result = this->result.get();
+  unsigned int channels;
+  float range, floor, k;
+  const QRgb *table;
+
+  if (result == nullptr
+      || !result->complete
+      || this->palette == nullptr
+      || result->blocks == 0)
+    return;
+
+  channels = result->channels;
+  range = static_cast<float>(this->ui->rangeSpin->value());
+  k = (SIGDIGGER_PALETTE_MAX_STOPS - 1) / range;
+  table = this->palette->getRgbTable();
+
+  // Scaled to the strongest feature: the a = 0 row (the PSD) saturates
+  floor = result->featurePeak - range;
+
+  this->image = QImage(
+        static_cast<int>(channels),
+        static_cast<int>(result->alphaBins),
+        QImage::Format_RGB32);
+
+  // Frequency runs left to right, cyclic frequency bottom to top
+  for (unsigned int a = 0; a < result->alphaBins; ++a) {
+    QRgb *line = reinterpret_cast<QRgb *>(
+          this->image.scanLine(static_cast<int>(result->alphaBins - 1 - a)));
+    const float *row = result->surface.data()
+        + static_cast<size_t>(a) * channels;
+
+    for (unsigned int f = 0; f < channels; ++f) {
+      int index = static_cast<int>((row[f] - floor) * k);
+
+      if (index < 0)
+        index = 0;
+      else if (index >= SIGDIGGER_PALETTE_MAX_STOPS)
+        index = SIGDIGGER_PALETTE_MAX_STOPS - 1;
+
+      line[f] = table[index];
+    }
+  }
+
+  this->ui->imageLabel->setPixmap(QPixmap::fromImage(this->image));
+}
+
+void
+CyclicSpectrumDialog::onRangeChanged(void)
+{
+  this->redraw();
+}
@@ -33,6 +33,18 @@ void
 DataSaverConfig::deserialize(Suscan::Object const &conf)
 {
   LOAD(path);
+  LOAD(segmentMinutes);
+  LOAD(segmentRetention);
+  LOAD(captureFormat);
+  LOAD(triggerEnabled);
+  LOAD(sharedContainer);
+  LOAD(packSymbols);
+
+  this->trigger.level      = conf.get("triggerLevel", this->trigger.level);
+  this->trigger.offset     = conf.get("triggerOffset", this->trigger.offset);
+  this->trigger.width      = conf.get("triggerWidth", this->trigger.width);
+  this->trigger.preTrigger = conf.get("triggerPre", this->trigger.preTrigger);
+  this->trigger.hang       = conf.get("triggerHang", this->trigger.hang);
 }
 
 Suscan::Object &&
@@ -43,6 +55,18 @@ DataSaverConfig::serialize(void)
   obj.setClass("DataSaverConfig");
 
   STORE(path);
+  STORE(segmentMinutes);
+  STORE(segmentRetention);
+  STORE(captureFormat);
+  STORE(triggerEnabled);
+  STORE(sharedContainer);
+  STORE(packSymbols);
+
+  obj.set("triggerLevel", this->trigger.level);
+  obj.set("triggerOffset", this->trigger.offset);
+  obj.set("triggerWidth", this->trigger.width);
+  obj.set("triggerPre", this->trigger.preTrigger);
+  obj.set("triggerHang", this->trigger.hang);
 
   return this->persist(obj);
 }
@@ -62,6 +86,57 @@ DataSaverUI::connectAll(void)
         SIGNAL(clicked(bool)),
         this,
         SLOT(onRecordStartStop(void)));
+
+  connect(
+        this->ui->segmentDurationSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onCaptureSettingsChanged(void)));
+
+  connect(
+        this->ui->segmentRetentionSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onCaptureSettingsChanged(void)));
+
+  connect(
+        this->ui->captureFormatCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onCaptureSettingsChanged(void)));
+
+  connect(
+        this->ui->triggerCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onCaptureSettingsChanged(void)));
+
+  connect(
+        this->ui->containerCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onCaptureSettingsChanged(void)));
+
+  connect(
+        this->ui->packSymbolsCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onCaptureSettingsChanged(void)));
+
+  QDoubleSpinBox *triggerSpins[] = {
+    this->ui->triggerLevelSpin,
+    this->ui->triggerOffsetSpin,
+    this->ui->triggerWidthSpin,
+    this->ui->triggerPreSpin,
+    this->ui->triggerHangSpin
+  };
+
+  for (auto spin : triggerSpins)
+    connect(
+          spin,
+          SIGNAL(valueChanged(double)),
+          this,
+          SLOT(onCaptureSettingsChanged(void)));
 }
 
 // Setters
@@ -108,15 +183,28 @@ DataSaverUI::setIORate(qreal rate)
   this->refreshDiskUsage();
 }
 
+void
+DataSaverUI::setBufferUsage(qreal usage, qreal highWater)
+{
+  this->ui->bufferUsageProgress->setValue(static_cast<int>(usage * 100));
+  this->ui->bufferUsageProgress->setFormat(
+        QString("%p% (peak ")
+        + QString::number(static_cast<int>(highWater * 100))
+        + "%)");
+}
+
 void
 DataSaverUI::setRecordState(bool state)
 {
   this->ui->recordStartStopButton->setChecked(state);
 
   this->ui->recordStartStopButton->setText(state ? "Stop" : "Record");
+  this->refreshCaptureControls();
 
-  if (!state)
+  if (!state) {
     this->ui->ioBwProgress->setValue(0);
+    this->setBufferUsage(0, 0);
+  }
 }
 
 // Getters
@@ -132,6 +220,120 @@ DataSaverUI::getRecordSavePath(void) const
   return this->ui->savePath->text().toStdString();
 }
 
+void
+DataSaverUI::refreshCaptureControls(void)
+{
+  bool raw = this->getCaptureFormat() == "float32";
+  bool recording = this->getRecordState();
+  bool trigger = this->ui->triggerCheck->isChecked();
+
+  // Triggered events are written one file each, never split
+  this->ui->segmentDurationSpin->setEnabled(raw && !trigger);
+  this->ui->segmentRetentionSpin->setEnabled(raw && !trigger);
+
+  // The ring and the band are set up when recording starts
+  this->ui->triggerCheck->setEnabled(!recording);
+  this->ui->triggerLevelSpin->setEnabled(trigger);
+  this->ui->triggerOffsetSpin->setEnabled(trigger && !recording);
+  this->ui->triggerWidthSpin->setEnabled(trigger && !recording);
+  this->ui->triggerPreSpin->setEnabled(trigger && !recording);
+  this->ui->triggerHangSpin->setEnabled(trigger);
+
+  this->ui->containerCheck->setEnabled(!recording);
+  this->ui->packSymbolsCheck->setEnabled(!recording);
+}
+
+void
+DataSaverUI::setCaptureControlsVisible(bool visible)
+{
+  this->captureControls = visible;
+
+  this->ui->segmentLabel->setVisible(visible);
+  this->ui->segmentDurationSpin->setVisible(visible);
+  this->ui->segmentRetentionSpin->setVisible(visible);
+  this->ui->captureFormatLabel->setVisible(visible);
+  this->ui->captureFormatCombo->setVisible(visible);
+  this->ui->triggerLabel->setVisible(visible);
+  this->ui->triggerCheck->setVisible(visible);
+  this->ui->triggerLevelSpin->setVisible(visible);
+  this->ui->triggerBandLabel->setVisible(visible);
+  this->ui->triggerOffsetSpin->setVisible(visible);
+  this->ui->triggerWidthSpin->setVisible(visible);
+  this->ui->triggerTimesLabel->setVisible(visible);
+  this->ui->triggerPreSpin->setVisible(visible);
+  this->ui->triggerHangSpin->setVisible(visible);
+
+  // IQ captures have formats and segments of their own
+  this->ui->containerLabel->setVisible(!visible);
+  this->ui->containerCheck->setVisible(!visible);
+  this->ui->packSymbolsLabel->setVisible(!visible);
+  this->ui->packSymbolsCheck->setVisible(!visible);
+}
+
+unsigned int
+DataSaverUI::getSegmentDuration(void) const
+{
+  if (!this->captureControls
+      || this->getCaptureFormat() != "float32"
+      || this->getTriggerEnabled())
+    return 0;
+
+  return static_cast<unsigned>(this->ui->segmentDurationSpin->value()) * 60;
+}
+
+unsigned int
+DataSaverUI::getSegmentRetention(void) const
+{
+  return static_cast<unsigned>(this->ui->segmentRetentionSpin->value());
+}
+
+std::string
+DataSaverUI::getCaptureFormat(void) const
+{
+  if (!this->captureControls)
+    return "float32";
+
+  return this->ui->captureFormatCombo->currentData().toString().toStdString();
+}
+
+bool
+DataSaverUI::getTriggerEnabled(void) const
+{
+  return this->captureControls && this->ui->triggerCheck->isChecked();
+}
+
+RecordingTriggerParams
+DataSaverUI::getTriggerParams(void) const
+{
+  RecordingTriggerParams params;
+
+  params.level      = static_cast<SUFLOAT>(this->ui->triggerLevelSpin->value());
+  params.offset     = this->ui->triggerOffsetSpin->value();
+  params.width      = this->ui->triggerWidthSpin->value();
+  params.preTrigger = this->ui->triggerPreSpin->value();
+  params.hang       = this->ui->triggerHangSpin->value();
+
+  return params;
+}
+
+bool
+DataSaverUI::getSharedContainer(void) const
+{
+  return !this->captureControls && this->ui->containerCheck->isChecked();
+}
+
+bool
+DataSaverUI::getPackSymbols(void) const
+{
+  return !this->captureControls && this->ui->packSymbolsCheck->isChecked();
+}
+
+void
+DataSaverUI::setTriggerStatus(QString const &status)
+{
+  this->ui->captureSizeLabel->setText(status);
+}
+
 
 DataSaverUI::DataSaverUI(QWidget *parent) :
   GenericDataSaverUI(parent),
@@ -141,6 +343,19 @@ DataSaverUI::DataSaverUI(QWidget *parent) :
 
   this->setRecordSavePath(QDir::currentPath().toStdString());
 
+  this->ui->captureFormatCombo->addItem("Complex float32", "float32");
+  this->ui->captureFormatCombo->addItem("Complex int16", "int16");
+#ifdef HAVE_ZSTD
+  this->ui->captureFormatCombo->addItem("Complex int16 + zstd", "int16_zstd");
+#endif // HAVE_ZSTD
+  this->ui->captureFormatCombo->addItem("Complex int8", "int8");
+#ifdef HAVE_ZSTD
+  this->ui->captureFormatCombo->addItem("Complex int8 + zstd", "int8_zstd");
+#endif // HAVE_ZSTD
+
+  // Only meaningful for raw IQ captures
+  this->setCaptureControlsVisible(false);
+
   this->connectAll();
 }
 
@@ -160,8 +375,36 @@ DataSaverUI::allocConfig(void)
 void
 DataSaverUI::applyConfig(void)
 {
+  // Every setValue() below writes the whole UI state back to the config
+  unsigned int segmentMinutes = this->config->segmentMinutes;
+  unsigned int segmentRetention = this->config->segmentRetention;
+  std::string captureFormat = this->config->captureFormat;
+  RecordingTriggerParams trigger = this->config->trigger;
+  bool triggerEnabled = this->config->triggerEnabled;
+  bool sharedContainer = this->config->sharedContainer;
+  bool packSymbols = this->config->packSymbols;
+
   if (this->config->path.size() > 0)
     this->setRecordSavePath(this->config->path);
+
+  this->ui->segmentDurationSpin->setValue(static_cast<int>(segmentMinutes));
+  this->ui->segmentRetentionSpin->setValue(static_cast<int>(segmentRetention));
+
+  int index = this->ui->captureFormatCombo->findData(
+        QString::fromStdString(captureFormat));
+  if (index != -1)
+    this->ui->captureFormatCombo->setCurrentIndex(index);
+
+  this->ui->triggerLevelSpin->setValue(static_cast<double>(trigger.level));
+  this->ui->triggerOffsetSpin->setValue(trigger.offset);
+  this->ui->triggerWidthSpin->setValue(trigger.width);
+  this->ui->triggerPreSpin->setValue(trigger.preTrigger);
+  this->ui->triggerHangSpin->setValue(trigger.hang);
+  this->ui->triggerCheck->setChecked(triggerEnabled);
+  this->ui->containerCheck->setChecked(sharedContainer);
+  this->ui->packSymbolsCheck->setChecked(packSymbols);
+
+  this->refreshCaptureControls();
 }
 
 ///////////////////////////////// Slots ////////////////////////////////////////
@@ -193,6 +436,25 @@ DataSaverUI::onRecordStartStop(void)
         this->ui->recordStartStopButton->isChecked()
         ? "Stop"
         : "Record");
+  this->refreshCaptureControls();
 
   emit recordStateChanged(this->ui->recordStartStopButton->isChecked());
 }
+
+void
+DataSaverUI::onCaptureSettingsChanged(void)
+{
+  if (this->config != nullptr) {
+    this->config->segmentMinutes =
+        static_cast<unsigned>(this->ui->segmentDurationSpin->value());
+    this->config->segmentRetention =
+        static_cast<unsigned>(this->ui->segmentRetentionSpin->value());
+    this->config->captureFormat = this->getCaptureFormat();
+    this->config->triggerEnabled = this->ui->triggerCheck->isChecked();
+    this->config->sharedContainer = this->ui->containerCheck->isChecked();
+    this->config->packSymbols = this->ui->packSymbolsCheck->isChecked();
+    this->config->trigger = this->getTriggerParams();
+  }
+
+  this->refreshCaptureControls();
+}
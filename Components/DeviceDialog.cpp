@@ -90,6 +90,11 @@ DeviceDialog::refreshDevices(void)
   std::vector<Suscan::Source::Device>::const_iterator end
       = s->getLastDevice();
 
+  if (s->getDeviceRevision() == this->deviceRevision)
+    return;
+
+  this->deviceRevision = s->getDeviceRevision();
+  this->ui->deviceTable->setUpdatesEnabled(false);
   this->ui->deviceTable->clear();
 
   // Set headers
@@ -110,10 +115,14 @@ DeviceDialog::refreshDevices(void)
   this->ui->deviceTable->horizontalHeaderItem(2)->setTextAlignment(
         Qt::AlignLeft);
 
+  std::vector<Suscan::DeviceSummary> missing = s->getMissingDevices();
+
+  this->ui->deviceTable->setRowCount(
+        static_cast<int>((end - start) + missing.size()));
+
   for (auto p = start; p != end; ++p) {
     QTableWidgetItem *iconItem = new QTableWidgetItem();
     iconItem->setIcon(QIcon(getDeviceIcon(*p)));
-    this->ui->deviceTable->setRowCount(i + 1);
     this->ui->deviceTable->setItem(i, 0, iconItem);
     this->ui->deviceTable->setItem(
           i,
@@ -126,7 +135,25 @@ DeviceDialog::refreshDevices(void)
     ++i;
   }
 
+  // Seen in the previous session, and possibly still being detected
+  for (auto const &dev : missing) {
+    QTableWidgetItem *iconItem = new QTableWidgetItem();
+    iconItem->setIcon(QIcon(":/icons/devices-unavail.png"));
+    this->ui->deviceTable->setItem(i, 0, iconItem);
+    this->ui->deviceTable->setItem(
+          i,
+          1,
+          new QTableWidgetItem(QString::fromStdString(dev.desc)));
+    this->ui->deviceTable->setItem(
+          i,
+          2,
+          new QTableWidgetItem(
+            QString::fromStdString(dev.driver) + " (not detected yet)"));
+    ++i;
+  }
+
   this->ui->deviceTable->resizeColumnToContents(1);
+  this->ui->deviceTable->setUpdatesEnabled(true);
 }
 
 void
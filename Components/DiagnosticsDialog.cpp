@@ -0,0 +1,292 @@
+//
+//    DiagnosticsDialog.cpp: Analyzer message path diagnostics
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include <DiagnosticsDialog.h>
+#include <QMessageBox>
+#include <QFileDialog>
+#include <QFile>
+#include <QTimer>
+
+#include "ui_DiagnosticsDialog.h"
+
+#include <QTableWidgetItem>
+#include <MemoryAccountant.h>
+
+using namespace SigDigger;
+
+DiagnosticsDialog::DiagnosticsDialog(QWidget *parent) :
+  QDialog(parent),
+  ui(new Ui::DiagnosticsDialog)
+{
+  ui->setupUi(this);
+
+  this->setWindowTitle("Diagnostics");
+
+  this->timer = new QTimer(this);
+  this->timer->setInterval(SIGDIGGER_DIAGNOSTICS_REFRESH_INTERVAL_MS);
+
+  this->connectAll();
+  this->refreshUi();
+}
+
+DiagnosticsDialog::~DiagnosticsDialog()
+{
+  delete ui;
+}
+
+void
+DiagnosticsDialog::connectAll(void)
+{
+  connect(
+        this->timer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onRefresh(void)));
+
+  connect(
+        this->ui->saveButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onSave(void)));
+
+  connect(
+        this->ui->resetButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onReset(void)));
+}
+
+void
+DiagnosticsDialog::setCell(int row, int col, QString const &text)
+{
+  QTableWidgetItem *item = this->ui->statsTableWidget->item(row, col);
+
+  if (item == nullptr)
+    this->ui->statsTableWidget->setItem(row, col, new QTableWidgetItem(text));
+  else
+    item->setText(text);
+}
+
+void
+DiagnosticsDialog::setHistogramCells(
+    int row,
+    int col,
+    Suscan::StatsHistogram const &hist)
+{
+  if (hist.count == 0) {
+    this->setCell(row, col,     "-");
+    this->setCell(row, col + 1, "-");
+    this->setCell(row, col + 2, "-");
+  } else {
+    this->setCell(row, col,     QString::number(hist.mean(), 'f', 1));
+    this->setCell(row, col + 1, QString::number(hist.percentile(.99)));
+    this->setCell(row, col + 2, QString::number(hist.max));
+  }
+}
+
+void
+DiagnosticsDialog::refreshUi(void)
+{
+  Suscan::AnalyzerStats const &stats = this->lastStats;
+  int rows = Suscan::ANALYZER_STATS_CLASS_COUNT + stats.routes.size();
+  int row = 0;
+
+  this->ui->saveButton->setEnabled(!this->analyzer.isNull());
+  this->ui->resetButton->setEnabled(!this->analyzer.isNull());
+
+  this->ui->statsTableWidget->setRowCount(rows);
+
+  for (int i = 0; i < Suscan::ANALYZER_STATS_CLASS_COUNT; ++i, ++row) {
+    Suscan::MessageClassStats const &cls = stats.classes[i];
+
+    this->setCell(row, 0, Suscan::AnalyzerStats::className(i));
+    this->setCell(row, 1, QString::number(cls.read));
+    this->setCell(row, 2, QString::number(cls.delivered));
+    this->setCell(row, 3, QString::number(cls.coalesced));
+    this->setHistogramCells(row, 4, cls.queueLatency);
+    this->setHistogramCells(row, 7, cls.dispatchTime);
+  }
+
+  for (auto &p : stats.routes) {
+    this->setCell(
+          row,
+          0,
+          QString::asprintf("samples:0x%x (", p.inspectorId)
+          + p.receiver + ")");
+    this->setCell(row, 1, "-");
+    this->setCell(row, 2, QString::number(p.dispatchTime.count));
+    this->setCell(row, 3, "-");
+    this->setCell(row, 4, "-");
+    this->setCell(row, 5, "-");
+    this->setCell(row, 6, "-");
+    this->setHistogramCells(row, 7, p.dispatchTime);
+    ++row;
+  }
+
+  if (this->analyzer.isNull()) {
+    this->ui->summaryLabel->setText("No analyzer running");
+  } else {
+    this->ui->summaryLabel->setText(
+          QString::asprintf(
+            "Uptime: %lld ms, %llu batches, "
+            "backlog per batch: avg %.1f, p99 %llu, max %llu messages",
+            static_cast<long long>(stats.uptimeMs),
+            static_cast<unsigned long long>(stats.batches),
+            stats.backlog.mean(),
+            static_cast<unsigned long long>(stats.backlog.percentile(.99)),
+            static_cast<unsigned long long>(stats.backlog.max)));
+  }
+
+  this->ui->statsTableWidget->resizeColumnsToContents();
+
+  this->refreshMemory();
+}
+
+void
+DiagnosticsDialog::refreshMemory(void)
+{
+  MemoryAccountant *accountant = MemoryAccountant::instance();
+  QVector<MemoryUsage> usage = accountant->getUsage();
+  QTableWidget *table = this->ui->memoryTableWidget;
+  size_t budget = accountant->getBudget();
+  QString budgetText = budget == 0
+      ? "unlimited"
+      : QString::asprintf("%.1f MiB", budget / 1048576.);
+  int row = 0;
+
+  table->setRowCount(usage.size());
+
+  for (auto &p : usage) {
+    QString cells[] = {
+      p.subsystem,
+      QString::number(p.accounts),
+      QString::number(p.bytes / 1048576., 'f', 1),
+      p.reclaimable ? "Yes" : "No"
+    };
+
+    for (int col = 0; col < 4; ++col) {
+      QTableWidgetItem *item = table->item(row, col);
+
+      if (item == nullptr)
+        table->setItem(row, col, new QTableWidgetItem(cells[col]));
+      else
+        item->setText(cells[col]);
+    }
+
+    ++row;
+  }
+
+  this->ui->memoryLabel->setText(
+        QString::asprintf(
+          "Accounted memory: %.1f MiB of %s, %.1f MiB reclaimed, "
+          "%u captures refused",
+          accountant->getTotal() / 1048576.,
+          qPrintable(budgetText),
+          accountant->getReclaimed() / 1048576.,
+          accountant->getRefused()));
+
+  table->resizeColumnsToContents();
+}
+
+void
+DiagnosticsDialog::saveStats(QString path)
+{
+  QFile file(path);
+
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    QMessageBox::critical(
+          this,
+          "Save diagnostics",
+          "Failed to save diagnostics to file: " + file.errorString());
+    return;
+  }
+
+  file.write(this->lastStats.dump());
+  file.close();
+}
+
+void
+DiagnosticsDialog::setAnalyzer(Suscan::Analyzer *analyzer)
+{
+  this->analyzer = analyzer;
+
+  // Keep the last figures of a finished run visible until a new one starts
+  if (analyzer != nullptr)
+    this->lastStats = analyzer->getStats();
+
+  this->refreshUi();
+}
+
+void
+DiagnosticsDialog::showEvent(QShowEvent *event)
+{
+  this->onRefresh();
+  this->timer->start();
+
+  QDialog::showEvent(event);
+}
+
+void
+DiagnosticsDialog::hideEvent(QHideEvent *event)
+{
+  this->timer->stop();
+
+  QDialog::hideEvent(event);
+}
+
+/////////////////////////////////// Slots //////////////////////////////////////
+void
+DiagnosticsDialog::onRefresh(void)
+{
+  if (!this->analyzer.isNull())
+    this->lastStats = this->analyzer->getStats();
+
+  this->refreshUi();
+}
+
+void
+DiagnosticsDialog::onReset(void)
+{
+  if (!this->analyzer.isNull())
+    this->analyzer->resetStats();
+
+  this->onRefresh();
+}
+
+void
+DiagnosticsDialog::onSave(void)
+{
+  QFileDialog dialog(this);
+  QStringList filters;
+
+  dialog.setFileMode(QFileDialog::FileMode::AnyFile);
+  dialog.setAcceptMode(QFileDialog::AcceptSave);
+  dialog.setWindowTitle(QString("Save diagnostics"));
+  dialog.setDefaultSuffix("json");
+
+  filters << "JSON files (*.json)"
+          << "Any (*)";
+
+  dialog.setNameFilters(filters);
+
+  if (dialog.exec()) {
+    QString path = dialog.selectedFiles().first();
+    this->saveStats(path);
+  }
+}
@@ -19,14 +19,18 @@
 #include "FrequencyCorrectionDialog.h"
 #include "ui_FrequencyCorrectionDialog.h"
 #include <QPainter>
+#include <QDateTime>
 #include "SigDiggerHelpers.h"
 #include <SuWidgetsHelpers.h>
 #include <Suscan/Analyzer.h>
+#include <OrbitTracker.h>
 
 #define FREQUENCY_CORRECTION_DIALOG_OVERSAMPLING 2
 #define FREQUENCY_EV_TICKS 10
 #define FREQUENCY_AZ_TICKS 12
-#define SAT_PATH_POINTS    20
+
+// Passes ahead of the current one that we try to keep predicted
+#define FREQUENCY_CORRECTION_DIALOG_PASSES_AHEAD 2
 
 using namespace SigDigger;
 
@@ -164,6 +168,9 @@ FrequencyCorrectionDialog::findNewSatellites(void)
     for (auto p : sus->getSatelliteMap())
       this->ui->satCombo->addItem(p.nameToQString());
 
+    this->catalogStale = true;
+    this->requestCatalog();
+
     if (this->desiredSelected != "") {
       this->setCurrentSatellite(this->desiredSelected);
     } else {
@@ -178,13 +185,29 @@ FrequencyCorrectionDialog::findNewSatellites(void)
     this->ui->satRadio->setChecked(this->desiredFromSat);
 }
 
+// Only worth it while someone is looking at the list
+void
+FrequencyCorrectionDialog::requestCatalog(void)
+{
+  if (!this->catalogStale
+      || !this->haveQth
+      || !this->isVisible()
+      || this->ui->satCombo->count() == 0)
+    return;
+
+  this->catalogRequest = this->catalog->request(this->rxSite, this->timeStamp);
+  this->catalogStale = false;
+}
+
+static inline qreal
+timevalToSeconds(struct timeval const &tv)
+{
+  return static_cast<qreal>(tv.tv_sec) + 1e-6 * static_cast<qreal>(tv.tv_usec);
+}
+
 void
 FrequencyCorrectionDialog::paintAzimuthElevationPass(QPainter &p)
 {
-  qreal delta;
-  struct timeval diff;
-  struct timeval tdelta;
-  struct timeval t;
   struct tm losTm, aosTm;
   SigDiggerHelpers *hlp = SigDiggerHelpers::instance();
   bool visible;
@@ -192,19 +215,26 @@ FrequencyCorrectionDialog::paintAzimuthElevationPass(QPainter &p)
   bool haveSourceEnd = false;
   QVector<qreal> dashes;
   xyz_t pAzEl = {{0}, {0}, {0}};
-  xyz_t firstAzel = {{0}, {0}, {0}};
   xyz_t azel;
   QPen pen(
         this->colors.constellationForeground,
         FREQUENCY_CORRECTION_DIALOG_OVERSAMPLING);
 
   if (this->haveALOS) {
+    SatellitePass const &pass = this->passes.front();
     qreal mkwidth =
           (this->azElAxesRadius / 80) * FREQUENCY_CORRECTION_DIALOG_OVERSAMPLING;
     time_t lost = this->losTime.tv_sec;
     time_t aost = this->aosTime.tv_sec;
     time_t ssrc = this->startTime.tv_sec;
     time_t esrc = this->endTime.tv_sec;
+    qreal  aos  = timevalToSeconds(pass.aos);
+    qreal  now  = timevalToSeconds(this->timeStamp);
+    qreal  delta;
+    int    points = pass.track.size();
+
+    if (points < 2)
+      return;
 
     if (!this->realTime) {
       // Non-realtime signals have a defined start time and end time
@@ -220,20 +250,12 @@ FrequencyCorrectionDialog::paintAzimuthElevationPass(QPainter &p)
     localtime_r(&aost, &aosTm);
     hlp->popTZ();
 
-    timersub(&this->losTime, &this->aosTime, &diff);
-
-    delta = (static_cast<qreal>(diff.tv_sec)
-             + 1e-6 * static_cast<qreal>(diff.tv_usec)) / SAT_PATH_POINTS;
-
-    tdelta.tv_sec  = static_cast<time_t>(floor(delta));
-    tdelta.tv_usec = static_cast<unsigned>(1e6 * (delta - floor(delta)));
+    delta = (timevalToSeconds(pass.los) - aos) / (points - 1);
 
     // Yay C++
     dashes << 3 << 4;
 
-    t = this->aosTime;
-
-    visible = timercmp(&this->timeStamp, &this->aosTime, >);
+    visible = now > aos;
 
     if (visible) {
       pen.setStyle(Qt::SolidLine);
@@ -245,34 +267,33 @@ FrequencyCorrectionDialog::paintAzimuthElevationPass(QPainter &p)
 
     p.setPen(pen);
 
-    for (auto i = 0; i <= SAT_PATH_POINTS; ++i) {
+    // The track comes precomputed. Only where the satellite is now has
+    // to be propagated, and updatePrediction() already did that.
+    for (auto i = 0; i < points; ++i) {
+      azel = pass.track[i];
+
       // Have we just left the satellite behind?
-      if (visible && !timercmp(&this->timeStamp, &t, >)) {
+      if (visible && !(now > aos + i * delta)) {
         if (i > 0) {
-          sgdp4_prediction_update(&this->prediction, &this->timeStamp);
-          sgdp4_prediction_get_azel(&this->prediction, &azel);
-          p.drawLine(QLineF(this->azElToPoint(pAzEl), this->azElToPoint(azel)));
+          p.drawLine(
+                QLineF(
+                  this->azElToPoint(pAzEl),
+                  this->azElToPoint(this->currentAzEl)));
+          pAzEl = this->currentAzEl;
         }
 
-        // Back to the dashes. Also, this iteration does not count.
-        --i;
+        // Back to the dashes
         visible = false;
         pen.setColor(this->colors.constellationForeground);
         pen.setDashPattern(dashes);
         pen.setWidth(FREQUENCY_CORRECTION_DIALOG_OVERSAMPLING);
         p.setPen(pen);
-      } else { // No.
-        sgdp4_prediction_update(&this->prediction, &t);
-        sgdp4_prediction_get_azel(&this->prediction, &azel);
       }
 
       if (i > 0)
         p.drawLine(QLineF(this->azElToPoint(pAzEl), this->azElToPoint(azel)));
-      else
-        firstAzel = azel;
 
       pAzEl = azel;
-      timeradd(&t, &tdelta, &t);
     }
 
     pen.setStyle(Qt::SolidLine);
@@ -280,12 +301,12 @@ FrequencyCorrectionDialog::paintAzimuthElevationPass(QPainter &p)
 
     this->paintTextAt(
           p,
-          this->azElToPoint(firstAzel),
+          this->azElToPoint(pass.track.front()),
           QString::asprintf("%02u:%02u", aosTm.tm_hour, aosTm.tm_min));
 
     this->paintTextAt(
           p,
-          this->azElToPoint(azel),
+          this->azElToPoint(pass.track.back()),
           QString::asprintf("%02u:%02u", losTm.tm_hour, losTm.tm_min));
 
     if (haveSourceStart) {
@@ -316,7 +337,7 @@ void
 FrequencyCorrectionDialog::paintAzimuthElevationSatPath(QPixmap &pixmap)
 {
   QPainter p(&pixmap);
-  xyz_t azel;
+  xyz_t azel = this->currentAzEl;
 
   QPen pen(
         this->colors.constellationForeground,
@@ -328,9 +349,6 @@ FrequencyCorrectionDialog::paintAzimuthElevationSatPath(QPixmap &pixmap)
 
     this->paintAzimuthElevationPass(p);
 
-    sgdp4_prediction_update(&this->prediction, &this->timeStamp);
-    sgdp4_prediction_get_azel(&this->prediction, &azel);
-
     if (azel.elevation > 0) {
       p.setBrush(Qt::cyan);
       p.drawEllipse(
@@ -437,110 +455,51 @@ FrequencyCorrectionDialog::refreshOrbit(void)
 }
 
 void
-FrequencyCorrectionDialog::recalcALOS(void)
+FrequencyCorrectionDialog::invalidatePasses(void)
 {
-  if (!this->haveOrbit) {
-    this->haveALOS = false;
-  } else {
-    if (!this->haveALOS
-        || timercmp(&this->timeStamp, &this->losTime, >=)) {
-      xyz_t azel;
-      SUDOUBLE window;
-      SUDOUBLE searchWindow;
-      struct timeval delta, search;
-      this->haveALOS = false;
-
-      // Get current prediction
-      if (!sgdp4_prediction_update(&this->prediction, &this->timeStamp))
-        return;
+  this->passes.clear();
+  this->passRequest     = 0;
+  this->passPending     = false;
+  this->passesExhausted = false;
+  this->haveALOS        = false;
+}
 
-      sgdp4_prediction_get_azel(&this->prediction, &azel);
+void
+FrequencyCorrectionDialog::refreshPasses(void)
+{
+  if (!this->haveOrbit) {
+    this->invalidatePasses();
+    return;
+  }
 
-      searchWindow = qBound(
-            FREQUENCY_CORRECTION_DIALOG_TIME_WINDOW_MIN,  // 1 day
-            3 * 86400.0 / this->currentOrbit.rev,
-            FREQUENCY_CORRECTION_DIALOG_TIME_WINDOW_MAX); // 30 days
-
-      window = searchWindow;
-
-      if (azel.elevation > 0) {
-        // For visible satellites, the strategy is as follows:
-        //   1. In the current timeStamp, look for the next LOS event.
-        //   2. Compute the lapse between the current timeStamp and the LOS
-        //   3. Perform exponentially bigger backward time steps, of initial
-        //      length equal to that length
-        //   4. If the satellite is now invisible, assume that the next
-        //      AOS event is the corresponding to the current pass.
-
-        // Step 1
-        if (!sgdp4_prediction_find_los(
-              &this->prediction,
-              &this->timeStamp,
-              window,
-              &this->losTime))
-          return; // Something went wrong
-
-        // Step 2
-        timersub(&this->losTime, &this->timeStamp, &delta);
-        delta.tv_sec += 1;
-
-        // Step 3
-        do {
-          timersub(&this->losTime, &delta, &search);
-          SigDiggerHelpers::timerdup(&delta);
-
-          if (!sgdp4_prediction_update(&this->prediction, &search))
-            break;
-
-          sgdp4_prediction_get_azel(&this->prediction, &azel);
-        } while (azel.elevation > 0
-                 && static_cast<qreal>(delta.tv_sec) < searchWindow);
-
-        // Check if the satellite now is belon the horizon
-        if (azel.elevation > 0)
-          return; // Nope. Something went wrong.
-
-        // Okay, now if we find the next AOS, it should be our rise time
-        this->haveALOS =
-            sgdp4_prediction_find_aos(
-              &this->prediction,
-              &search,
-              searchWindow,
-              &this->aosTime);
-
-        if (!this->haveALOS)
-          return;
-
-        this->haveALOS =
-            sgdp4_prediction_find_los(
-              &this->prediction,
-              &search,
-              searchWindow,
-              &this->losTime);
-      } else {
-        // For non-visible satellites, the strategy is as follows:
-        //   1. In the current timeStamp, look for the next AOS event.
-        //   2. After that AOS, compute the next LOS event
-        //   3. If both events were found, assume it belongs to the next pass
-        this->haveALOS =
-            sgdp4_prediction_find_aos(
-              &this->prediction,
-              &this->timeStamp,
-              window,
-              &this->aosTime);
-
-        if (!this->haveALOS)
-          return;
-
-        this->haveALOS = sgdp4_prediction_find_los(
-              &this->prediction,
-              &this->timeStamp,
-              searchWindow,
-              &this->losTime);
-      }
+  // Forget the passes that are over
+  while (!this->passes.isEmpty()
+         && timercmp(&this->timeStamp, &this->passes.front().los, >=))
+    this->passes.pop_front();
+
+  // Keep a few passes ahead, asking for them in the background
+  if (!this->passPending
+      && !this->passesExhausted
+      && this->passes.size() <= FREQUENCY_CORRECTION_DIALOG_PASSES_AHEAD) {
+    struct timeval from = this->timeStamp;
+    if (!this->passes.isEmpty()) {
+      from = this->passes.back().los;
+      from.tv_sec += 1;
     }
 
-    sgdp4_prediction_update(&this->prediction, &this->timeStamp);
+    this->passRequest = this->predictor->request(
+          &this->currentOrbit,
+          this->rxSite,
+          from,
+          FREQUENCY_CORRECTION_DIALOG_PASSES_AHEAD + 1);
+    this->passPending = true;
+  }
+
+  this->haveALOS = !this->passes.isEmpty();
+
+  if (this->haveALOS) {
+    this->aosTime = this->passes.front().aos;
+    this->losTime = this->passes.front().los;
   }
 }
 
@@ -553,10 +512,13 @@ FrequencyCorrectionDialog::setCurrentOrbit(const orbit_t *orbit)
       this->currentOrbit.name = nullptr;
     }
     sgdp4_prediction_finalize(&this->prediction);
+    OrbitTracker::instance()->unsubscribe(this->trackerHandle);
+    this->trackerHandle = -1;
     this->haveOrbit = false;
-    this->haveALOS  = false;
   }
 
+  this->invalidatePasses();
+
   if (orbit != nullptr) {
     if (&this->currentOrbit != orbit) {
       this->currentOrbit = *orbit;
@@ -571,6 +533,9 @@ FrequencyCorrectionDialog::setCurrentOrbit(const orbit_t *orbit)
           &this->currentOrbit,
           &this->rxSite)) {
       this->haveOrbit = true;
+      this->trackerHandle = OrbitTracker::instance()->subscribe(
+            &this->currentOrbit,
+            this->rxSite);
     } else {
       orbit_finalize(&this->currentOrbit);
       this->currentOrbit.name = nullptr;
@@ -588,10 +553,10 @@ FrequencyCorrectionDialog::setTimestamp(struct timeval const &tv)
 
     timersub(&tv, &this->timeStamp, &delta);
 
-    // If the delta is suspiciously big, or backwards in time, recalculate
-    // ALOS
+    // If the delta is suspiciously big, or backwards in time, predict the
+    // passes again
     if (delta.tv_sec >= 1 || delta.tv_sec < 0 || delta.tv_usec < 0)
-      this->haveALOS = false;
+      this->invalidatePasses();
 
     this->timeStamp = tv;
     this->updatePrediction();
@@ -603,8 +568,9 @@ FrequencyCorrectionDialog::resetTimestamp(struct timeval const &tv)
 {
   if (!this->realTime) {
     this->timeStamp = tv;
-    this->haveALOS = false;
+    this->invalidatePasses();
     this->updatePrediction();
+    this->catalogStale = true;
   }
 }
 
@@ -616,7 +582,6 @@ FrequencyCorrectionDialog::setTimeLimits(
   this->startTime = start;
   this->endTime   = end;
 
-  this->haveALOS = false;
   this->updatePrediction();
 }
 
@@ -664,13 +629,26 @@ FrequencyCorrectionDialog::updatePrediction(void)
   qreal seconds;
   xyz_t azel, v_azel;
 
-  if (this->haveOrbit) {
-    this->recalcALOS();
+  this->refreshPasses();
 
-    sgdp4_prediction_update(&this->prediction, &this->timeStamp);
+  if (this->haveOrbit) {
+    OrbitTracker::State state;
+
+    // The only propagation per tick, shared with every other dialog
+    // following the same satellite
+    if (OrbitTracker::instance()->getState(
+          this->trackerHandle,
+          this->timeStamp,
+          state)) {
+      azel   = state.azel;
+      v_azel = state.vazel;
+    } else {
+      sgdp4_prediction_update(&this->prediction, &this->timeStamp);
+      sgdp4_prediction_get_azel(&this->prediction, &azel);
+      sgdp4_prediction_get_vel_azel(&this->prediction, &v_azel);
+    }
 
-    sgdp4_prediction_get_azel(&this->prediction, &azel);
-    sgdp4_prediction_get_vel_azel(&this->prediction, &v_azel);
+    this->currentAzEl = azel;
 
     this->ui->visibleLabel->setText(azel.elevation < 0 ? "No" : "Yes");
     this->ui->azimuthLabel->setText(
@@ -770,7 +748,7 @@ FrequencyCorrectionDialog::setRealTime(bool realTime)
     gettimeofday(&tv, nullptr);
     this->resetTimestamp(tv);
   } else {
-    this->haveALOS = false;
+    this->invalidatePasses();
   }
 }
 
@@ -858,6 +836,18 @@ FrequencyCorrectionDialog::connectAll(void)
         SIGNAL(timeout(void)),
         this,
         SLOT(onTick(void)));
+
+  connect(
+        this->predictor,
+        SIGNAL(ready(void)),
+        this,
+        SLOT(onPassesReady(void)));
+
+  connect(
+        this->catalog,
+        SIGNAL(ready(void)),
+        this,
+        SLOT(onCatalogReady(void)));
 }
 
 FrequencyCorrectionDialog::FrequencyCorrectionDialog(
@@ -870,6 +860,9 @@ FrequencyCorrectionDialog::FrequencyCorrectionDialog(
 {
 
   ui->setupUi(this);
+
+  this->predictor = new PassPredictor(this);
+  this->catalog = new CatalogPredictor(this);
   this->connectAll();
 
   gettimeofday(&this->timeStamp, nullptr);
@@ -887,6 +880,17 @@ FrequencyCorrectionDialog::setQth(xyz_t const &qth)
   this->rxSite = qth;
   this->haveQth = true;
   this->refreshOrbit();
+
+  this->catalogStale = true;
+  this->requestCatalog();
+}
+
+void
+FrequencyCorrectionDialog::showEvent(QShowEvent *event)
+{
+  this->requestCatalog();
+
+  QDialog::showEvent(event);
 }
 
 void
@@ -917,6 +921,7 @@ FrequencyCorrectionDialog::parseCurrentTLE(void)
 
 FrequencyCorrectionDialog::~FrequencyCorrectionDialog()
 {
+  OrbitTracker::instance()->unsubscribe(this->trackerHandle);
   orbit_finalize(&this->currentOrbit);
   delete ui;
 }
@@ -977,3 +982,78 @@ FrequencyCorrectionDialog::onTick(void)
     this->updatePrediction();
   }
 }
+
+void
+FrequencyCorrectionDialog::onPassesReady(void)
+{
+  QVector<SatellitePass> result;
+  quint64 id;
+
+  if (!this->predictor->take(id, result) || id != this->passRequest)
+    return;
+
+  this->passPending = false;
+
+  // Nothing ahead: do not keep asking on every tick
+  if (result.isEmpty())
+    this->passesExhausted = true;
+
+  // A pass starting before the last one we have ended would be a repeat
+  for (auto &pass : result)
+    if (this->passes.isEmpty()
+        || timercmp(&pass.aos, &this->passes.back().los, >))
+      this->passes.push_back(pass);
+
+  this->updatePrediction();
+}
+
+void
+FrequencyCorrectionDialog::onCatalogReady(void)
+{
+  QVector<CatalogPass> result;
+  QComboBox *combo = this->ui->satCombo;
+  QString current = this->getCurrentSatellite();
+  QFont bold = combo->font();
+  quint64 id;
+  int ndx;
+
+  if (!this->catalog->take(id, result) || id != this->catalogRequest)
+    return;
+
+  bold.setBold(true);
+
+  for (int i = 0; i < combo->count(); ++i) {
+    combo->setItemData(i, QVariant(), Qt::FontRole);
+    combo->setItemData(i, "No pass in the next day", Qt::ToolTipRole);
+  }
+
+  for (auto &p : result) {
+    QDateTime aos = QDateTime::fromSecsSinceEpoch(p.pass.aos.tv_sec, Qt::UTC);
+    QDateTime los = QDateTime::fromSecsSinceEpoch(p.pass.los.tv_sec, Qt::UTC);
+
+    if ((ndx = combo->findText(p.name)) >= 0) {
+      if (p.visible) {
+        combo->setItemData(ndx, bold, Qt::FontRole);
+        combo->setItemData(
+              ndx,
+              "Up now, sets at " + los.toString("HH:mm:ss") + " UTC",
+              Qt::ToolTipRole);
+      } else {
+        combo->setItemData(
+              ndx,
+              "Next pass: " + aos.toString("yyyy-MM-dd HH:mm:ss") + " UTC",
+              Qt::ToolTipRole);
+      }
+    }
+
+    // Saves the current satellite a round trip to its own predictor
+    if (p.name == current
+        && this->haveOrbit
+        && this->ui->satRadio->isChecked()
+        && this->passes.isEmpty()
+        && timercmp(&this->timeStamp, &p.pass.los, <)) {
+      this->passes.push_back(p.pass);
+      this->updatePrediction();
+    }
+  }
+}
@@ -21,6 +21,7 @@
 #include "ui_HistogramDialog.h"
 
 #include <SuWidgetsHelpers.h>
+#include <algorithm>
 
 using namespace SigDigger;
 
@@ -224,33 +225,57 @@ HistogramDialog::setColorConfig(ColorConfig const &colors)
 }
 
 void
-HistogramDialog::feed(const SUFLOAT *data, unsigned int len)
+HistogramDialog::setBins(HistogramBins const &bins)
 {
-  bool adjustDecider = false;
-
-  // FIXME: Decision adjustments should be better
-  if (this->properties.space == SamplingSpace::AMPLITUDE) {
-    for (unsigned int i = 0; i < len; ++i) {
-      if (data[i] < min) {
-        min = data[i];
-        adjustDecider = true;
-      }
-
-      if (data[i] > max) {
-        max = data[i];
-        adjustDecider = true;
-      }
-    }
-  }
-
-  if (adjustDecider) {
+  unsigned int maxCount = 0;
+  size_t nBins = bins.counts.size();
+  SUFLOAT binWidth;
+
+  if (nBins == 0)
+    return;
+
+  // The amplitude range is only known once the feeder has measured it
+  if (this->properties.space == SamplingSpace::AMPLITUDE
+      && (bins.min != this->min || bins.max != this->max)) {
+    this->min = bins.min;
+    this->max = bins.max;
     this->dummyDecider.setMinimum(this->min);
     this->dummyDecider.setMaximum(this->max);
-    this->ui->histogram->reset();
     this->refreshUi();
   }
 
-  this->ui->histogram->feed(data, len);
+  for (auto count : bins.counts)
+    maxCount = std::max(maxCount, count);
+
+  this->ui->histogram->reset();
+
+  if (maxCount == 0)
+    return;
+
+  // The widget only takes samples: hand it the center of every bin as
+  // many times as its height, relative to the tallest bin, requires.
+  binWidth = (bins.max - bins.min) / static_cast<SUFLOAT>(nBins);
+  this->levelBuffer.clear();
+
+  for (size_t i = 0; i < nBins; ++i) {
+    unsigned int n;
+
+    if (bins.counts[i] == 0)
+      continue;
+
+    n = static_cast<unsigned int>(
+          (static_cast<quint64>(bins.counts[i])
+           * SIGDIGGER_HISTOGRAM_DIALOG_LEVELS + maxCount - 1) / maxCount);
+
+    this->levelBuffer.insert(
+          this->levelBuffer.end(),
+          n,
+          bins.min + (static_cast<SUFLOAT>(i) + .5f) * binWidth);
+  }
+
+  this->ui->histogram->feed(
+        this->levelBuffer.data(),
+        static_cast<unsigned int>(this->levelBuffer.size()));
 }
 
 void
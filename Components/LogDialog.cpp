@@ -18,6 +18,7 @@
 //
 
 #include <LogDialog.h>
+#include <Tracer.h>
 #include <QMessageBox>
 #include <cerrno>
 #include <cstring>
@@ -40,6 +41,8 @@ LogDialog::LogDialog(QWidget *parent) :
 
   this->setWindowTitle("Message log");
 
+  this->ui->traceButton->setChecked(Tracer::isEnabled());
+
   this->connectAll();
 }
 
@@ -65,8 +68,8 @@ LogDialog::saveLog(QString path)
           this->msgVec[i].time.tv_sec,
           static_cast<int>(this->msgVec[i].time.tv_usec),
           su_log_severity_to_string(this->msgVec[i].severity),
-          this->msgVec[i].domain.c_str(),
-          this->msgVec[i].function.c_str(),
+          this->msgVec[i].domain,
+          this->msgVec[i].function,
           this->msgVec[i].line,
           this->msgVec[i].message.c_str());
   }
@@ -79,9 +82,9 @@ LogDialog::connectAll(void)
 {
   connect(
         this->logger,
-        SIGNAL(messageEmitted(Suscan::LoggerMessage)),
+        SIGNAL(messagesEmitted(QVector<Suscan::LoggerMessage>)),
         this,
-        SLOT(onMessage(Suscan::LoggerMessage)));
+        SLOT(onMessages(QVector<Suscan::LoggerMessage>)));
 
   connect(
         this->ui->saveButton,
@@ -94,6 +97,18 @@ LogDialog::connectAll(void)
         SIGNAL(clicked(bool)),
         this,
         SLOT(onClear(void)));
+
+  connect(
+        this->ui->traceButton,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onToggleTrace(void)));
+
+  connect(
+        this->ui->exportTraceButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onExportTrace(void)));
 }
 
 LogDialog::~LogDialog()
@@ -140,7 +155,7 @@ LogDialog::getErrorHtml(void) const
 }
 
 void
-LogDialog::onMessage(Suscan::LoggerMessage msg)
+LogDialog::appendMessage(Suscan::LoggerMessage const &msg)
 {
   int newRow = this->ui->logTableWidget->rowCount();
 
@@ -162,7 +177,7 @@ LogDialog::onMessage(Suscan::LoggerMessage msg)
   this->ui->logTableWidget->setItem(
         newRow,
         3,
-        new QTableWidgetItem(QString::fromStdString(msg.domain)));
+        new QTableWidgetItem(QString(msg.domain)));
 
   this->ui->logTableWidget->setItem(
         newRow,
@@ -172,21 +187,41 @@ LogDialog::onMessage(Suscan::LoggerMessage msg)
   this->ui->logTableWidget->setItem(
         newRow,
         4,
-        new QTableWidgetItem(QString::fromStdString(msg.function)));
+        new QTableWidgetItem(QString(msg.function)));
 
   this->ui->logTableWidget->setItem(
         newRow,
         5,
         new QTableWidgetItem(QString::number(msg.line)));
 
+  if (msg.severity == SU_LOG_SEVERITY_CRITICAL ||
+      msg.severity == SU_LOG_SEVERITY_ERROR)
+    this->errorFound = true;
+}
+
+void
+LogDialog::onMessages(QVector<Suscan::LoggerMessage> batch)
+{
+  int excess;
+
+  this->ui->logTableWidget->setUpdatesEnabled(false);
+
+  for (auto const &p : batch)
+    this->appendMessage(p);
+
+  // Keep as many messages as the logger itself does
+  excess = this->msgVec.size() - SIGDIGGER_LOGGER_HISTORY_SIZE;
+  if (excess > 0) {
+    this->msgVec.remove(0, excess);
+    for (int i = 0; i < excess; ++i)
+      this->ui->logTableWidget->removeRow(0);
+  }
+
   this->ui->logTableWidget->resizeColumnsToContents();
+  this->ui->logTableWidget->setUpdatesEnabled(true);
 
   if (this->ui->autoScrollButton->isChecked())
     this->ui->logTableWidget->scrollToBottom();
-
-  if (msg.severity == SU_LOG_SEVERITY_CRITICAL ||
-      msg.severity == SU_LOG_SEVERITY_ERROR)
-    this->errorFound = true;
 }
 
 void
@@ -217,3 +252,34 @@ LogDialog::onSave(void)
   }
 }
 
+void
+LogDialog::onToggleTrace(void)
+{
+  bool enabled = this->ui->traceButton->isChecked();
+
+  // Start every tracing session with an empty trace
+  if (enabled && !Tracer::isEnabled())
+    Tracer::instance()->clear();
+
+  Tracer::instance()->setEnabled(enabled);
+}
+
+void
+LogDialog::onExportTrace(void)
+{
+  QString path = QFileDialog::getSaveFileName(
+        this,
+        "Export trace",
+        "sigdigger-trace.json",
+        "Chrome trace files (*.json);;Any (*)");
+  QString error;
+
+  if (path.isEmpty())
+    return;
+
+  if (!Tracer::instance()->saveChromeTrace(path, error))
+    QMessageBox::critical(
+          this,
+          "Export trace",
+          "Failed to export trace: " + error);
+}
@@ -25,6 +25,11 @@
 #include "Waterfall.h"
 #include "GLWaterfall.h"
 #include <WFHelpers.h>
+#include <SigDiggerHelpers.h>
+#include <Tracer.h>
+#include <RenderScheduler.h>
+#include <algorithm>
+#include <cstdint>
 
 using namespace SigDigger;
 
@@ -36,30 +41,178 @@ using namespace SigDigger;
       this->glWf->call;             \
   } while (false);                  \
 
+// The bookmark window is three times the span it was made for. Zooming in
+// beyond half that span makes it twice as wide as needed.
+#define SIGDIGGER_BOOKMARK_CACHE_SHRINK 6
+
 namespace SigDigger {
+  // Bookmarks are fetched for a window wider than the visible span, so
+  // that panning and repaints are served from the cached list until the
+  // view leaves the window, the view is zoomed in past half the span the
+  // window was made for, or the bookmark database changes.
   class SuscanBookmarkSource : public BookmarkSource {
+      QVector<BookmarkInfo> cache;
+      qint64  cacheStart = 0;
+      qint64  cacheEnd   = -1;
+      quint64 cacheRevision = 0;
+
+      void refreshCache(qint64 start, qint64 end);
+
     public:
       virtual QList<BookmarkInfo> getBookmarksInRange(qint64, qint64) override;
   };
+
+  // Waterfalls go through every band of a FAT on each repaint. Bands are
+  // indexed once, at load, and the waterfall gets a view holding only
+  // the bands around the visible span.
+  class FATOverlay {
+      std::string name;
+      std::vector<FrequencyBand> bands; // Sorted by min, neighbours merged
+      std::vector<qint64> reach;        // Highest max of bands[0..i]
+      FrequencyAllocationTable *view = nullptr;
+
+      static bool sameAllocation(FrequencyBand const &, FrequencyBand const &);
+
+    public:
+      FATOverlay(std::string const &name, std::vector<FrequencyBand> &&);
+      ~FATOverlay();
+
+      std::string const &
+      getName(void) const
+      {
+        return this->name;
+      }
+
+      FrequencyAllocationTable *
+      getView(void) const
+      {
+        return this->view;
+      }
+
+      // Replaces the view by one with the bands intersecting [start, end]
+      FrequencyAllocationTable *makeView(qint64 start, qint64 end);
+  };
 }
 
-QList<BookmarkInfo>
-SuscanBookmarkSource::getBookmarksInRange(qint64 start, qint64 end)
+////////////////////////////////// FATOverlay /////////////////////////////////
+FATOverlay::FATOverlay(
+    std::string const &name,
+    std::vector<FrequencyBand> &&bands)
 {
-  QList<BookmarkInfo> list;
+  qint64 reach = INT64_MIN;
 
-  auto p = Suscan::Singleton::get_instance()->getBookmarkFrom(start);
+  this->name = name;
 
-  while (p != Suscan::Singleton::get_instance()->getLastBookmark()) {
-    try {
-      if (p->info.frequency <= end) {
-        list.push_back(p->info);
-      }
+  std::stable_sort(
+        bands.begin(),
+        bands.end(),
+        [] (FrequencyBand const &a, FrequencyBand const &b) {
+          return a.min < b.min;
+        });
 
-    } catch (Suscan::Exception const &) { }
-    ++p;
+  // Contiguous bands with the same allocation are drawn as one anyway
+  for (auto &band : bands) {
+    if (!this->bands.empty()
+        && sameAllocation(this->bands.back(), band)
+        && band.min <= this->bands.back().max + 1) {
+      if (band.max > this->bands.back().max)
+        this->bands.back().max = band.max;
+    } else {
+      this->bands.push_back(band);
+    }
   }
 
+  this->reach.reserve(this->bands.size());
+
+  for (auto &band : this->bands) {
+    if (band.max > reach)
+      reach = band.max;
+    this->reach.push_back(reach);
+  }
+}
+
+FATOverlay::~FATOverlay()
+{
+  if (this->view != nullptr)
+    delete this->view;
+}
+
+bool
+FATOverlay::sameAllocation(FrequencyBand const &a, FrequencyBand const &b)
+{
+  return a.primary == b.primary
+      && a.secondary == b.secondary
+      && a.footnotes == b.footnotes
+      && a.color == b.color;
+}
+
+FrequencyAllocationTable *
+FATOverlay::makeView(qint64 start, qint64 end)
+{
+  FrequencyAllocationTable *view = new FrequencyAllocationTable(this->name);
+
+  // Bands before the first one reaching start end before it too
+  auto first = std::lower_bound(this->reach.cbegin(), this->reach.cend(), start);
+  size_t i = static_cast<size_t>(first - this->reach.cbegin());
+
+  for (; i < this->bands.size() && this->bands[i].min <= end; ++i)
+    if (this->bands[i].max >= start)
+      view->pushBand(this->bands[i]);
+
+  if (this->view != nullptr)
+    delete this->view;
+
+  this->view = view;
+
+  return view;
+}
+
+void
+SuscanBookmarkSource::refreshCache(qint64 start, qint64 end)
+{
+  Suscan::Singleton *sing = Suscan::Singleton::get_instance();
+  qint64 margin = end - start;
+
+  this->cacheStart    = start > INT64_MIN + margin ? start - margin : INT64_MIN;
+  this->cacheEnd      = end < INT64_MAX - margin ? end + margin : INT64_MAX;
+  this->cacheRevision = sing->getBookmarkRevision();
+  this->cache         = sing->getBookmarksInRange(
+        this->cacheStart,
+        this->cacheEnd).toVector();
+}
+
+QList<BookmarkInfo>
+SuscanBookmarkSource::getBookmarksInRange(qint64 start, qint64 end)
+{
+  QList<BookmarkInfo> list;
+  quint64 span, window;
+
+  if (start > end)
+    return list;
+
+  // Both differences are non-negative, so they fit in 64 unsigned bits
+  span   = static_cast<quint64>(end) - static_cast<quint64>(start);
+  window = static_cast<quint64>(this->cacheEnd)
+      - static_cast<quint64>(this->cacheStart);
+
+  if (start < this->cacheStart
+      || end > this->cacheEnd
+      || window / SIGDIGGER_BOOKMARK_CACHE_SHRINK > span
+      || this->cacheRevision
+         != Suscan::Singleton::get_instance()->getBookmarkRevision())
+    this->refreshCache(start, end);
+
+  auto first = std::lower_bound(
+        this->cache.cbegin(),
+        this->cache.cend(),
+        start,
+        [] (BookmarkInfo const &info, qint64 freq) {
+          return info.frequency < freq;
+        });
+
+  for (auto p = first; p != this->cache.cend() && p->frequency <= end; ++p)
+    list.push_back(*p);
+
   return list;
 }
 
@@ -74,6 +227,28 @@ MainSpectrum::MainSpectrum(QWidget *parent) :
   this->setFreqs(0, 0);
   this->lastFreqUpdate.start();
   this->bookmarkSource = new SuscanBookmarkSource();
+
+  // Until a palette is set
+  for (unsigned int i = 0; i < SIGDIGGER_PALETTE_MAX_STOPS; ++i)
+    this->paletteTable[i] = qRgb(
+          static_cast<int>(i),
+          static_cast<int>(i),
+          static_cast<int>(i));
+
+  this->replayTimer = new QTimer(this);
+  this->replayTimer->setSingleShot(true);
+  this->replayTimer->setInterval(
+        SIGDIGGER_MAIN_SPECTRUM_REPLAY_DELAY_MS);
+
+  connect(
+        this->replayTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onReplayHistory(void)));
+
+  RenderScheduler::instance()->attach(
+        this,
+        [this] () { this->flushOverlay(); });
 }
 
 MainSpectrum::~MainSpectrum()
@@ -81,6 +256,9 @@ MainSpectrum::~MainSpectrum()
   for (auto p : this->FATs)
     delete p;
 
+  for (auto p : this->overlays)
+    delete p;
+
   delete this->bookmarkSource;
 
   delete ui;
@@ -210,17 +388,76 @@ MainSpectrum::addToolWidget(QWidget *widget, QString const &title)
     this->maxToolWidth = widthHint;
 }
 
+void
+MainSpectrum::addToolWidgets(QList<QPair<QWidget *, QString>> const &list)
+{
+  // Relayout once, not once per widget
+  this->ui->multiToolBox->setUpdatesEnabled(false);
+
+  for (auto const &p : list)
+    this->addToolWidget(p.first, p.second);
+
+  this->ui->multiToolBox->setUpdatesEnabled(true);
+}
+
 void
 MainSpectrum::feed(float *data, int size, struct timeval const &tv, bool looped)
 {
+  SIGDIGGER_TRACE_SCOPE("MainSpectrum::feed");
   QDateTime dateTime;
+  unsigned int level, displaySize;
+  float *display;
 
   dateTime.setMSecsSinceEpoch(tv.tv_sec * 1000 + tv.tv_usec / 1000);
 
-  WATERFALL_CALL(setNewFftData(data, size, dateTime, looped));
+  // There is no point in handing the waterfall more bins than it can
+  // draw. Decimate down to the coarsest level that still provides a
+  // couple of bins per pixel in the visible span.
+  level = PSDPyramid::levelFor(
+        static_cast<unsigned int>(size),
+        this->visibleZoom,
+        this->displayPixels());
+
+  display = this->pyramid.compute(
+        data,
+        static_cast<unsigned int>(size),
+        level,
+        displaySize);
+
+  // A different number of bins (new FFT size or level) would leave the
+  // waterfall half drawn at the old resolution. Redraw what is on screen
+  // at the new one, so the transition is seamless.
+  if (displaySize != this->displayedSize) {
+    bool rescale = this->displayedSize != 0 && this->history.count() > 0;
+
+    this->displayedSize = displaySize;
+
+    if (rescale)
+      this->viewStale = true;
+  }
+
+  // While hidden, frames are only kept in the history. It is replayed
+  // as soon as the waterfall can be seen again.
+  if (SigDiggerHelpers::isOnScreen(this)) {
+    if (this->viewStale) {
+      this->viewStale = false;
+      this->replayHistory(this->history.count());
+    }
+
+    WATERFALL_CALL(
+          setNewFftData(
+            display,
+            static_cast<int>(displaySize),
+            dateTime,
+            looped));
+  } else {
+    this->viewStale = true;
+  }
+
+  this->history.push(display, displaySize, tv);
 
-  if (!this->resAdjusted) {
-    this->resAdjusted = true;
+  if (this->resAdjustedSize != static_cast<unsigned int>(size)) {
+    this->resAdjustedSize = static_cast<unsigned int>(size);
     int res = static_cast<int>(
           round(static_cast<qreal>(this->cachedRate) / size));
     if (res < 1)
@@ -230,6 +467,137 @@ MainSpectrum::feed(float *data, int size, struct timeval const &tv, bool looped)
   }
 }
 
+int
+MainSpectrum::displayPixels(void) const
+{
+  const QWidget *widget = nullptr;
+
+  if (this->wf != nullptr)
+    widget = this->wf;
+  else if (this->glWf != nullptr)
+    widget = this->glWf;
+
+  if (widget == nullptr)
+    return 0;
+
+  return static_cast<int>(widget->width() * widget->devicePixelRatioF());
+}
+
+int
+MainSpectrum::displayLines(void) const
+{
+  const QWidget *widget = nullptr;
+
+  if (this->wf != nullptr)
+    widget = this->wf;
+  else if (this->glWf != nullptr)
+    widget = this->glWf;
+
+  if (widget == nullptr)
+    return 0;
+
+  return static_cast<int>(widget->height() * widget->devicePixelRatioF());
+}
+
+void
+MainSpectrum::showEvent(QShowEvent *event)
+{
+  PersistentWidget::showEvent(event);
+
+  if (this->viewStale) {
+    this->viewStale = false;
+    this->replayHistory(this->history.count());
+  }
+}
+
+void
+MainSpectrum::scheduleReplay(void)
+{
+  // Range sliders fire lots of updates. Replay once they settle down.
+  if (this->history.count() > 0)
+    this->replayTimer->start();
+}
+
+WaterfallHistory const &
+MainSpectrum::getHistory(void) const
+{
+  return this->history;
+}
+
+void
+MainSpectrum::setHistoryCapacity(quint64 ram, quint64 disk)
+{
+  this->history.setCapacity(ram, disk);
+}
+
+void
+MainSpectrum::clearHistory(void)
+{
+  this->history.clear();
+}
+
+void
+MainSpectrum::replayHistory(size_t end)
+{
+  size_t lines = static_cast<size_t>(this->displayLines());
+  size_t start;
+  unsigned int size;
+  struct timeval tv;
+  QDateTime dateTime;
+  const float *data;
+
+  if (end > this->history.count())
+    end = this->history.count();
+
+  start = end > lines ? end - lines : 0;
+
+  // Feeding a screenful of past frames redraws the whole waterfall
+  for (size_t i = start; i < end; ++i) {
+    data = this->history.frame(i, size, tv);
+    if (data == nullptr)
+      continue;
+
+    if (this->displayedSize != 0 && size != this->displayedSize) {
+      if (this->resampled.size() < this->displayedSize)
+        this->resampled.resize(this->displayedSize);
+
+      PSDPyramid::resample(
+            data,
+            size,
+            this->resampled.data(),
+            this->displayedSize,
+            this->pyramid.getMode());
+
+      data = this->resampled.data();
+      size = this->displayedSize;
+    }
+
+    dateTime.setMSecsSinceEpoch(tv.tv_sec * 1000 + tv.tv_usec / 1000);
+    WATERFALL_CALL(
+          setNewFftData(
+            const_cast<float *>(data),
+            static_cast<int>(size),
+            dateTime,
+            false));
+  }
+}
+
+//
+// Shows what the waterfall looked like around tv, if we still have it in
+// the history. Used as a preview while the time slider is dragged.
+//
+bool
+MainSpectrum::previewTimeStamp(struct timeval const &tv)
+{
+  size_t index;
+
+  if (!this->history.find(tv, index))
+    return false;
+
+  this->replayHistory(index + 1);
+  return true;
+}
+
 void
 MainSpectrum::updateLimits(void)
 {
@@ -335,7 +703,7 @@ MainSpectrum::notifyHalt(void)
   WATERFALL_CALL(setRunningState(false));
   WATERFALL_CALL(setClickResolution(1));
   WATERFALL_CALL(setFilterClickResolution(1));
-  this->resAdjusted = false;
+  this->resAdjustedSize = 0;
 }
 
 void
@@ -400,13 +768,18 @@ MainSpectrum::setFreqs(qint64 freq, qint64 lnbFreq, bool silent)
   WATERFALL_CALL(setFreqUnits(getFrequencyUnits(freq)));
 
   this->updateLimits();
+  this->refreshFATViews();
   this->setLoFreq(newLo);
 }
 
 void
 MainSpectrum::setPaletteGradient(const QColor *table)
 {
+  for (unsigned int i = 0; i < SIGDIGGER_PALETTE_MAX_STOPS; ++i)
+    this->paletteTable[i] = table[i].rgb();
+
   WATERFALL_CALL(setPalette(table));
+  this->scheduleReplay();
 }
 
 void
@@ -418,7 +791,11 @@ MainSpectrum::setPandapterRange(float min, float max)
 void
 MainSpectrum::setWfRange(float min, float max)
 {
+  this->wfMin = min;
+  this->wfMax = max;
+
   WATERFALL_CALL(setWaterfallRange(min, max));
+  this->scheduleReplay();
 }
 
 void
@@ -454,15 +831,17 @@ MainSpectrum::setExpectedRate(int rate)
 void
 MainSpectrum::setTimeStamps(bool enabled)
 {
+  this->timeStampsShown = enabled;
   WATERFALL_CALL(setTimeStampsEnabled(enabled));
-  WATERFALL_CALL(updateOverlay());
+  this->invalidateOverlay();
 }
 
 void
 MainSpectrum::setBookmarks(bool enabled)
 {
+  this->bookmarksShown = enabled;
   WATERFALL_CALL(setBookmarksEnabled(enabled));
-  WATERFALL_CALL(updateOverlay());
+  this->invalidateOverlay();
 }
 
 void
@@ -532,12 +911,53 @@ MainSpectrum::setGuiConfig(GuiConfig const &cfg)
     this->glWf->setMaxBlending(cfg.useMaxBlending);
 
   WATERFALL_CALL(setUseLBMdrag(cfg.useLMBdrag));
+
+  this->setHistoryCapacity(
+        SIGDIGGER_WATERFALL_HISTORY_DEFAULT_RAM,
+        static_cast<quint64>(cfg.waterfallSpill) << 20);
 }
 
 void
 MainSpectrum::updateOverlay(void)
 {
+  this->invalidateOverlay();
+}
+
+MainSpectrum::OverlayState
+MainSpectrum::currentOverlay(void) const
+{
+  OverlayState state;
+
+  state.centerFreq       = this->getCenterFreq();
+  state.span             = this->cachedRate / this->zoom;
+  state.bookmarkRevision =
+      Suscan::Singleton::get_instance()->getBookmarkRevision();
+  state.fatRevision      = this->fatRevision;
+  state.timeStamps       = this->timeStampsShown;
+  state.bookmarks        = this->bookmarksShown;
+  state.fats             = this->fatsShown;
+
+  return state;
+}
+
+void
+MainSpectrum::invalidateOverlay(void)
+{
+  RenderScheduler::instance()->markDirty(this);
+}
+
+void
+MainSpectrum::flushOverlay(void)
+{
+  OverlayState state = this->currentOverlay();
+
+  if (this->overlayDrawn && state == this->drawnOverlay)
+    return;
+
   WATERFALL_CALL(updateOverlay());
+
+  this->drawnOverlay = state;
+  this->overlayDrawn = true;
 }
 
 void
@@ -603,6 +1023,7 @@ MainSpectrum::setZoom(unsigned int zoom)
 {
   if (zoom > 0) {
     this->zoom = zoom;
+    this->visibleZoom = zoom;
     WATERFALL_CALL(setSpanFreq(this->cachedRate / zoom));
   }
 }
@@ -627,11 +1048,13 @@ MainSpectrum::setSampleRate(unsigned int rate)
     WATERFALL_CALL(setSampleRate(rate));
 
     WATERFALL_CALL(setSpanFreq(rate / this->zoom));
+    this->visibleZoom = this->zoom;
     this->ui->loLcd->setMin(-freq / 2 + this->getCenterFreq());
     this->ui->loLcd->setMax(freq / 2 + this->getCenterFreq());
 
     this->cachedRate = rate;
-    this->resAdjusted = false;
+    this->resAdjustedSize = 0;
+    this->refreshFATViews(true);
   }
 }
 
@@ -652,19 +1075,102 @@ qint32 MainSpectrum::computeHighCutFreq(int bw) const
 void
 MainSpectrum::setShowFATs(bool show)
 {
+  this->fatsShown = show;
   WATERFALL_CALL(setFATsVisible(show));
+  this->invalidateOverlay();
+}
+
+FATOverlay *
+MainSpectrum::findOverlay(std::string const &name) const
+{
+  for (auto p : this->overlays)
+    if (p->getName() == name)
+      return p;
+
+  return nullptr;
+}
+
+void
+MainSpectrum::refreshFATViews(bool force)
+{
+  qint64 center = this->getCenterFreq();
+  qint64 half = static_cast<qint64>(this->cachedRate / 2);
+  qint64 start, end;
+
+  if (this->shownOverlays.empty())
+    return;
+
+  // Without a rate, there is no telling what is visible
+  if (half == 0) {
+    start = INT64_MIN;
+    end   = INT64_MAX;
+  } else {
+    start = center - half;
+    end   = center + half;
+  }
+
+  if (!force && start >= this->fatViewStart && end <= this->fatViewEnd)
+    return;
+
+  // Leave a whole span of margin on each side, so that panning does not
+  // rebuild the views every time
+  if (half != 0) {
+    start -= 2 * half;
+    end   += 2 * half;
+  }
+
+  this->fatViewStart = start;
+  this->fatViewEnd   = end;
+
+  // Keep the drawing order
+  for (auto p : this->shownOverlays)
+    WATERFALL_CALL(removeFAT(p->getName()));
+
+  for (auto p : this->shownOverlays)
+    WATERFALL_CALL(pushFAT(p->makeView(start, end)));
+
+  ++this->fatRevision;
+  this->invalidateOverlay();
 }
 
 void
 MainSpectrum::pushFAT(FrequencyAllocationTable *fat)
 {
-  WATERFALL_CALL(pushFAT(fat));
+  FATOverlay *overlay = this->findOverlay(fat->getName());
+
+  if (overlay == nullptr) {
+    WATERFALL_CALL(pushFAT(fat));
+    ++this->fatRevision;
+    this->invalidateOverlay();
+    return;
+  }
+
+  if (std::find(
+        this->shownOverlays.begin(),
+        this->shownOverlays.end(),
+        overlay) == this->shownOverlays.end())
+    this->shownOverlays.push_back(overlay);
+
+  this->refreshFATViews(true);
 }
 
 void
 MainSpectrum::removeFAT(QString const &name)
 {
-  WATERFALL_CALL(removeFAT(name.toStdString()));
+  std::string asStdString = name.toStdString();
+  FATOverlay *overlay = this->findOverlay(asStdString);
+
+  WATERFALL_CALL(removeFAT(asStdString));
+  ++this->fatRevision;
+  this->invalidateOverlay();
+
+  if (overlay != nullptr)
+    this->shownOverlays.erase(
+          std::remove(
+            this->shownOverlays.begin(),
+            this->shownOverlays.end(),
+            overlay),
+          this->shownOverlays.end());
 }
 
 FrequencyBand
@@ -751,6 +1257,8 @@ MainSpectrum::deserializeFATs(void)
   for (auto p = sus->getFirstFAT();
        p != sus->getLastFAT();
        p++) {
+    std::vector<FrequencyBand> list;
+
     this->FATs.resize(ndx + 1);
     this->FATs[ndx] = new FrequencyAllocationTable(p->getField("name").value());
     bands = p->getField("bands");
@@ -758,14 +1266,20 @@ MainSpectrum::deserializeFATs(void)
     SU_ATTEMPT(bands.getType() == SUSCAN_OBJECT_TYPE_SET);
 
     count = bands.length();
+    list.reserve(count);
 
     for (i = 0; i < count; ++i) {
       try {
-        this->FATs[ndx]->pushBand(deserializeFrequencyBand(bands[i]));
+        FrequencyBand band = deserializeFrequencyBand(bands[i]);
+        this->FATs[ndx]->pushBand(band);
+        list.push_back(band);
       } catch (Suscan::Exception &) {
       }
     }
 
+    this->overlays.push_back(
+          new FATOverlay(this->FATs[ndx]->getName(), std::move(list)));
+
     emit newBandPlan(QString::fromStdString(this->FATs[ndx]->getName()));
     ++ndx;
   }
@@ -808,6 +1322,35 @@ MainSpectrum::getBandwidth(void) const
   return this->bandwidth;
 }
 
+// Out of an FFT of `size` bins, the size that feed() would decimate it
+// to. Anything above this never makes it to the screen.
+unsigned int
+MainSpectrum::getDisplayFftSize(unsigned int size) const
+{
+  return size >> PSDPyramid::levelFor(
+        size,
+        this->visibleZoom,
+        this->displayPixels());
+}
+
+const QRgb *
+MainSpectrum::getPaletteTable(void) const
+{
+  return this->paletteTable;
+}
+
+float
+MainSpectrum::getWfMin(void) const
+{
+  return this->wfMin;
+}
+
+float
+MainSpectrum::getWfMax(void) const
+{
+  return this->wfMax;
+}
+
 //////////////////////////////// Slots /////////////////////////////////////////
 void
 MainSpectrum::onWfBandwidthChanged(int min, int max)
@@ -832,6 +1375,7 @@ MainSpectrum::onNewCenterFreq(qint64 freq)
 {
   this->ui->fcLcd->setValue(freq);
   this->updateLimits();
+  this->refreshFATViews();
 }
 
 void
@@ -866,9 +1410,16 @@ MainSpectrum::onRangeChanged(float min, float max)
   emit rangeChanged(min, max);
 }
 
+void
+MainSpectrum::onReplayHistory(void)
+{
+  this->replayHistory(this->history.count());
+}
+
 void
 MainSpectrum::onNewZoomLevel(float level)
 {
+  this->visibleZoom = level;
   emit zoomChanged(level);
 }
 
@@ -30,6 +30,36 @@ NetForwarderUI::connectAll(void)
         SIGNAL(clicked(bool)),
         this,
         SLOT(onForwardStartStop(void)));
+
+  connect(
+        this->ui->formatCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onFormatChanged(void)));
+
+  connect(
+        this->ui->socketTypeCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onFormatChanged(void)));
+}
+
+void
+NetForwarderUI::refreshFormatControls(void)
+{
+  bool forwarding = this->getForwardState();
+  SocketForwarderFormat format = this->getFormat();
+
+  this->ui->formatCombo->setEnabled(!forwarding);
+  this->ui->decimationSpin->setEnabled(!forwarding);
+  this->ui->fullScaleSpin->setEnabled(
+        !forwarding
+        && (format == SOCKET_FORWARDER_INT16
+            || format == SOCKET_FORWARDER_INT8));
+
+  // A shared memory ring is named by host alone
+  this->ui->portSpin->setEnabled(
+        !forwarding && this->getMode() != SOCKET_FORWARDER_SHM);
 }
 
 NetForwarderUI::NetForwarderUI(QWidget *parent) :
@@ -38,12 +68,17 @@ NetForwarderUI::NetForwarderUI(QWidget *parent) :
 {
   ui->setupUi(this);
 
+#ifdef _WIN32
+  this->ui->socketTypeCombo->removeItem(SOCKET_FORWARDER_SHM);
+#endif // _WIN32
+
   this->spinner = new WaitingSpinnerWidget(parent);
   this->spinner->setLineLength(5);
   this->spinner->setInnerRadius(5);
   this->ui->spinGrid->addWidget(this->spinner);
 
   this->connectAll();
+  this->refreshFormatControls();
 }
 
 NetForwarderUI::~NetForwarderUI()
@@ -91,8 +126,11 @@ NetForwarderUI::setForwardState(bool state)
   this->ui->udpStartStopButton->setChecked(state);
 
   this->ui->hostEdit->setEnabled(!state);
-  this->ui->portSpin->setEnabled(!state);
   this->ui->frameLen->setEnabled(!state);
+  this->ui->socketTypeCombo->setEnabled(!state);
+  this->ui->overflowCombo->setEnabled(!state);
+  this->ui->headerCheck->setEnabled(!state);
+  this->refreshFormatControls();
 
   this->ui->udpStartStopButton->setText(state ? "Stop" : "Forward");
 
@@ -132,9 +170,51 @@ NetForwarderUI::setCaptureSize(quint64 size)
 }
 
 void
-NetForwarderUI::setTcp(bool tcp)
+NetForwarderUI::setQueueState(qreal usage, quint64 dropped)
+{
+  this->ui->queueProgress->setValue(static_cast<int>(usage * 100));
+  this->ui->queueProgress->setFormat(
+        dropped > 0
+        ? "%p% (" + formatCaptureSize(dropped) + " dropped)"
+        : QString("%p%"));
+}
+
+void
+NetForwarderUI::setOverflow(SocketForwarderOverflow overflow)
+{
+  this->ui->overflowCombo->setCurrentIndex(static_cast<int>(overflow));
+}
+
+void
+NetForwarderUI::setFormat(SocketForwarderFormat format)
+{
+  this->ui->formatCombo->setCurrentIndex(static_cast<int>(format));
+  this->refreshFormatControls();
+}
+
+void
+NetForwarderUI::setFullScale(SUFLOAT fullScale)
+{
+  this->ui->fullScaleSpin->setValue(static_cast<double>(fullScale));
+}
+
+void
+NetForwarderUI::setDecimation(unsigned int decimation)
 {
-  this->ui->socketTypeCombo->setCurrentIndex(tcp ? 1 : 0);
+  this->ui->decimationSpin->setValue(static_cast<int>(decimation));
+}
+
+void
+NetForwarderUI::setMode(SocketForwarderMode mode)
+{
+  this->ui->socketTypeCombo->setCurrentIndex(static_cast<int>(mode));
+  this->refreshFormatControls();
+}
+
+void
+NetForwarderUI::setHeader(bool header)
+{
+  this->ui->headerCheck->setChecked(header);
 }
 
 std::string
@@ -161,10 +241,47 @@ NetForwarderUI::getForwardState(void) const
   return this->ui->udpStartStopButton->isChecked();
 }
 
+// Combo entries follow the SocketForwarderMode order
+SocketForwarderMode
+NetForwarderUI::getMode(void) const
+{
+  return static_cast<SocketForwarderMode>(
+        this->ui->socketTypeCombo->currentIndex());
+}
+
+// Combo entries follow the SocketForwarderOverflow order
+SocketForwarderOverflow
+NetForwarderUI::getOverflow(void) const
+{
+  return static_cast<SocketForwarderOverflow>(
+        this->ui->overflowCombo->currentIndex());
+}
+
+// Combo entries follow the SocketForwarderFormat order
+SocketForwarderFormat
+NetForwarderUI::getFormat(void) const
+{
+  return static_cast<SocketForwarderFormat>(
+        this->ui->formatCombo->currentIndex());
+}
+
+SUFLOAT
+NetForwarderUI::getFullScale(void) const
+{
+  return static_cast<SUFLOAT>(this->ui->fullScaleSpin->value());
+}
+
+unsigned int
+NetForwarderUI::getDecimation(void) const
+{
+  return static_cast<unsigned int>(this->ui->decimationSpin->value());
+}
+
 bool
-NetForwarderUI::getTcp(void) const
+NetForwarderUI::getHeader(void) const
 {
-  return this->ui->socketTypeCombo->currentIndex() == 1;
+  return this->getMode() == SOCKET_FORWARDER_UDP
+      && this->ui->headerCheck->isChecked();
 }
 
 ///////////////////////////////// Slots ///////////////////////////////////////
@@ -178,3 +295,9 @@ NetForwarderUI::onForwardStartStop(void)
 
   emit forwardStateChanged(this->ui->udpStartStopButton->isChecked());
 }
+
+void
+NetForwarderUI::onFormatChanged(void)
+{
+  this->refreshFormatControls();
+}
@@ -23,14 +23,34 @@
 #include "MainSpectrum.h"
 #include <SuWidgetsHelpers.h>
 #include <SigDiggerHelpers.h>
+#include <GuiConfig.h>
+#include "Waterfall.h"
+#include "GLWaterfall.h"
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <limits>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <sys/time.h>
 
 using namespace SigDigger;
 
+#define WATERFALL_CALL(call)        \
+  do {                              \
+    if (this->wf != nullptr)        \
+      this->wf->call;               \
+    else if (this->glWf != nullptr) \
+      this->glWf->call;             \
+  } while (false)
+
+#define WATERFALL_FUNC(call, dfl)   \
+  (this->wf != nullptr              \
+    ? this->wf->call                \
+    : (this->glWf != nullptr        \
+        ? this->glWf->call          \
+        : (dfl)))
+
 void
 SavedSpectrum::set(qint64 start, qint64 end, const float *data, size_t size)
 {
@@ -80,10 +100,15 @@ PanoramicDialogConfig::deserialize(Suscan::Object const &conf)
   LOAD(panRangeMax);
   LOAD(lnbFreq);
   LOAD(device);
+  LOAD(extraDevices);
   LOAD(sampRate);
+  LOAD(resolution);
   LOAD(strategy);
   LOAD(partitioning);
   LOAD(palette);
+  LOAD(relayMode);
+  LOAD(relayHost);
+  LOAD(relayPort);
 
   for (unsigned int i = 0; i < conf.getFieldCount(); ++i)
     if (conf.getFieldByIndex(i).name().substr(0, 5) == "gain.") {
@@ -108,10 +133,15 @@ PanoramicDialogConfig::serialize(void)
   STORE(panRangeMax);
   STORE(lnbFreq);
   STORE(sampRate);
+  STORE(resolution);
   STORE(device);
+  STORE(extraDevices);
   STORE(strategy);
   STORE(partitioning);
   STORE(palette);
+  STORE(relayMode);
+  STORE(relayHost);
+  STORE(relayPort);
 
   for (auto p : this->gains)
     obj.set(p.first, p.second);
@@ -160,6 +190,9 @@ PanoramicDialog::PanoramicDialog(QWidget *parent) :
 {
   ui->setupUi(static_cast<QDialog *>(this));
 
+  this->extraDevicesMenu = new QMenu(this);
+  this->ui->extraDevicesButton->setMenu(this->extraDevicesMenu);
+
   this->assertConfig();
   this->setWindowFlags(Qt::Window);
   this->ui->sampleRateSpin->setUnits("sps");
@@ -177,6 +210,10 @@ PanoramicDialog::PanoramicDialog(QWidget *parent) :
   this->ui->lnbDoubleSpinBox->setMinimum(-300e9);
   this->ui->lnbDoubleSpinBox->setMaximum(300e9);
 
+  // Replaced by a GLWaterfall later on, if the GUI config asks for it
+  this->wf = this->ui->waterfall;
+  this->connectWaterfall(this->wf);
+
   this->connectAll();
 }
 
@@ -187,6 +224,44 @@ PanoramicDialog::~PanoramicDialog()
   delete ui;
 }
 
+//
+// Waterfall and GLWaterfall share their signals. Whichever is in use is
+// connected here.
+//
+void
+PanoramicDialog::connectWaterfall(QWidget *widget)
+{
+  connect(
+        widget,
+        SIGNAL(newFilterFreq(int, int)),
+        this,
+        SLOT(onNewBandwidth(int, int)));
+
+  connect(
+        widget,
+        SIGNAL(newDemodFreq(qint64, qint64)),
+        this,
+        SLOT(onNewOffset()));
+
+  connect(
+        widget,
+        SIGNAL(newZoomLevel(float)),
+        this,
+        SLOT(onNewZoomLevel(float)));
+
+  connect(
+        widget,
+        SIGNAL(newCenterFreq(qint64)),
+        this,
+        SLOT(onNewCenterFreq(qint64)));
+
+  connect(
+        widget,
+        SIGNAL(pandapterRangeChanged(float, float)),
+        this,
+        SLOT(onRangeChanged(float, float)));
+}
+
 void
 PanoramicDialog::connectAll(void)
 {
@@ -208,6 +283,12 @@ PanoramicDialog::connectAll(void)
         this,
         SLOT(onSampleRateSpinChanged(void)));
 
+  connect(
+        this->ui->resolutionCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onResolutionChanged(void)));
+
   connect(
         this->ui->fullRangeCheck,
         SIGNAL(stateChanged(int)),
@@ -238,30 +319,6 @@ PanoramicDialog::connectAll(void)
         this,
         SIGNAL(reset(void)));
 
-  connect(
-        this->ui->waterfall,
-        SIGNAL(newFilterFreq(int, int)),
-        this,
-        SLOT(onNewBandwidth(int, int)));
-
-  connect(
-        this->ui->waterfall,
-        SIGNAL(newDemodFreq(qint64, qint64)),
-        this,
-        SLOT(onNewOffset()));
-
-  connect(
-        this->ui->waterfall,
-        SIGNAL(newZoomLevel(float)),
-        this,
-        SLOT(onNewZoomLevel(float)));
-
-  connect(
-        this->ui->waterfall,
-        SIGNAL(newCenterFreq(qint64)),
-        this,
-        SLOT(onNewCenterFreq(qint64)));
-
   connect(
         this->ui->rttSpin,
         SIGNAL(valueChanged(int)),
@@ -274,12 +331,6 @@ PanoramicDialog::connectAll(void)
         this,
         SIGNAL(relBandwidthChanged(void)));
 
-  connect(
-        this->ui->waterfall,
-        SIGNAL(pandapterRangeChanged(float, float)),
-        this,
-        SLOT(onRangeChanged(float, float)));
-
   connect(
         this->ui->paletteCombo,
         SIGNAL(activated(int)),
@@ -304,11 +355,41 @@ PanoramicDialog::connectAll(void)
         this,
         SIGNAL(partitioningChanged(QString)));
 
+  connect(
+        this->ui->relayModeCombo,
+        SIGNAL(currentIndexChanged(int)),
+        this,
+        SLOT(onRelayModeChanged(void)));
+
   connect(
         this->ui->exportButton,
         SIGNAL(clicked(bool)),
         this,
         SLOT(onExport(void)));
+
+  connect(
+        this->ui->recordButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onToggleRecord(void)));
+
+  connect(
+        this->ui->replayButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onToggleReplay(void)));
+
+  connect(
+        &this->replayTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onReplayTimeout(void)));
+
+  connect(
+        &this->frameTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onFrameTimeout(void)));
 }
 
 
@@ -326,6 +407,20 @@ PanoramicDialog::preferredRttMs(Suscan::Source::Device const &dev)
   return 0;
 }
 
+// Same here. 0 means unknown: the scanner waits for the full RTT.
+unsigned int
+PanoramicDialog::preferredSettleMs(Suscan::Source::Device const &dev)
+{
+  if (dev.getDriver() == "rtlsdr")
+    return 25;
+  else if (dev.getDriver() == "airspy")
+    return 5;
+  else if (dev.getDriver() == "hackrf")
+    return 3;
+
+  return 0;
+}
+
 void
 PanoramicDialog::refreshUi(void)
 {
@@ -333,12 +428,25 @@ PanoramicDialog::refreshUi(void)
   bool fullRange = this->ui->fullRangeCheck->isChecked();
 
   this->ui->deviceCombo->setEnabled(!this->running && !empty);
+  this->ui->extraDevicesButton->setEnabled(
+        !this->running && this->deviceMap.size() > 1);
   this->ui->fullRangeCheck->setEnabled(!this->running && !empty);
   this->ui->rangeEndSpin->setEnabled(!this->running && !empty && !fullRange);
   this->ui->rangeStartSpin->setEnabled(!this->running && !empty && !fullRange);
   this->ui->lnbDoubleSpinBox->setEnabled(!this->running);
   this->ui->scanButton->setChecked(this->running);
   this->ui->sampleRateSpin->setEnabled(!this->running);
+  this->ui->resolutionCombo->setEnabled(!this->running);
+  this->ui->recordButton->setEnabled(!this->reader.isOpen());
+  this->ui->recordButton->setChecked(this->recorder.isOpen());
+  this->ui->replayButton->setEnabled(
+        !this->running && !this->recorder.isOpen());
+  this->ui->replayButton->setChecked(this->reader.isOpen());
+  this->ui->relayModeCombo->setEnabled(!this->running);
+  this->ui->relayHostEdit->setEnabled(
+        !this->running && this->getRelayMode() == "Send");
+  this->ui->relayPortSpin->setEnabled(
+        !this->running && this->getRelayMode() != "Off");
 }
 
 SUFREQ
@@ -363,6 +471,7 @@ void
 PanoramicDialog::setRunning(bool running)
 {
   if (running && !this->running) {
+    this->stopReplay();
     this->frames = 0;
     this->ui->framesLabel->setText("0");
   } else if (!running && this->running) {
@@ -387,6 +496,24 @@ PanoramicDialog::getPartitioning(void) const
   return this->ui->partitioningCombo->currentText();
 }
 
+QString
+PanoramicDialog::getRelayMode(void) const
+{
+  return this->ui->relayModeCombo->currentText();
+}
+
+QString
+PanoramicDialog::getRelayHost(void) const
+{
+  return this->ui->relayHostEdit->text().trimmed();
+}
+
+quint16
+PanoramicDialog::getRelayPort(void) const
+{
+  return static_cast<quint16>(this->ui->relayPortSpin->value());
+}
+
 float
 PanoramicDialog::getGain(QString const &gain) const
 {
@@ -413,7 +540,7 @@ PanoramicDialog::setWfRange(qint64 freqStart, qint64 freqEnd)
     // That remains fixed. Spectrum is received according to the
     // waterfall's span.
     if (bw != this->currBw) {
-      this->ui->waterfall->setSampleRate(bw);
+      WATERFALL_CALL(setSampleRate(bw));
       this->currBw = bw;
     }
   } else {
@@ -424,28 +551,28 @@ PanoramicDialog::setWfRange(qint64 freqStart, qint64 freqEnd)
     // When also have to adjust the bandwidth, we must reset the zoom
     // so the sure can keep zooming in the spectrum,
 
-    this->ui->waterfall->setCenterFreq(fc);
+    WATERFALL_CALL(setCenterFreq(fc));
 
     if (bw != this->currBw) {
       qint64 demodBw = bw / 10;
-      this->ui->waterfall->setLocked(false);
-      this->ui->waterfall->setSampleRate(bw);
-      this->ui->waterfall->setDemodRanges(
+      WATERFALL_CALL(setLocked(false));
+      WATERFALL_CALL(setSampleRate(bw));
+      WATERFALL_CALL(setDemodRanges(
             -bw / 2,
             0,
             0,
             bw / 2,
-            true);
+            true));
 
 
       if (demodBw > 4000000000)
         demodBw = 4000000000;
 
-      this->ui->waterfall->setHiLowCutFrequencies(
+      WATERFALL_CALL(setHiLowCutFrequencies(
             -demodBw / 2,
-            demodBw / 2);
+            demodBw / 2));
 
-      this->ui->waterfall->resetHorizontalZoom();
+      WATERFALL_CALL(resetHorizontalZoom());
       this->currBw = bw;
     }
   }
@@ -453,6 +580,41 @@ PanoramicDialog::setWfRange(qint64 freqStart, qint64 freqEnd)
 
 void
 PanoramicDialog::feed(
+    qint64 freqStart,
+    qint64 freqEnd,
+    const float *data,
+    size_t size,
+    size_t dirtyStart,
+    size_t dirtyEnd)
+{
+  // Live data is ignored while replaying
+  if (this->reader.isOpen())
+    return;
+
+  if (this->liveFrame.size() != size
+      || this->liveStart != freqStart
+      || this->liveEnd != freqEnd) {
+    this->liveFrame.assign(data, data + size);
+    this->liveStart = freqStart;
+    this->liveEnd   = freqEnd;
+  } else {
+    dirtyEnd = std::min(dirtyEnd, size);
+    if (dirtyStart < dirtyEnd)
+      std::copy(
+            data + dirtyStart,
+            data + dirtyEnd,
+            this->liveFrame.begin() + static_cast<long>(dirtyStart));
+  }
+
+  this->livePending = true;
+
+  // The timer stops by itself once hops stop arriving
+  if (!this->frameTimer.isActive())
+    this->frameTimer.start(SIGDIGGER_PANORAMIC_FRAME_INTERVAL_MS);
+}
+
+void
+PanoramicDialog::feedFrame(
     qint64 freqStart,
     qint64 freqEnd,
     float *data,
@@ -476,20 +638,70 @@ PanoramicDialog::feed(
         size);
 
   this->ui->exportButton->setEnabled(true);
-  this->ui->waterfall->setNewFftData(data, static_cast<int>(size));
+  WATERFALL_CALL(setNewFftData(data, static_cast<int>(size)));
 
   ++this->frames;
   this->redrawMeasures();
 }
 
+void
+PanoramicDialog::setGuiConfig(GuiConfig const &cfg)
+{
+  // Like the main spectrum, the waterfall is only swapped once. This is a
+  // separate window, so the GL waterfall must be allowed in windows too.
+  if (cfg.useGLWaterfall && cfg.useGlInWindows && this->glWf == nullptr) {
+    this->glWf = new GLWaterfall(this);
+    this->glWf->setObjectName(QStringLiteral("waterfall"));
+
+    delete this->ui->gridLayout->replaceWidget(this->wf, this->glWf);
+    this->wf->deleteLater();
+    this->wf = nullptr;
+    this->ui->waterfall = nullptr;
+
+    this->connectWaterfall(this->glWf);
+
+    // Bring the new waterfall to the state of the old one
+    this->setColors(this->lastColors);
+    this->setPaletteGradient(this->paletteGradient);
+    WATERFALL_CALL(setPandapterRange(
+          this->dialogConfig->panRangeMin,
+          this->dialogConfig->panRangeMax));
+    WATERFALL_CALL(setWaterfallRange(
+          this->dialogConfig->panRangeMin,
+          this->dialogConfig->panRangeMax));
+    this->adjustRanges();
+
+    if (this->freqEnd > this->freqStart) {
+      this->currBw = 0;
+      this->adjustingRange = true;
+      this->setWfRange(this->freqStart, this->freqEnd);
+      this->adjustingRange = false;
+    }
+
+    if (!this->currentFAT.empty()) {
+      this->currentFAT = "";
+      this->onBandPlanChanged(0);
+    }
+
+    WATERFALL_CALL(setRunningState(this->ui->scanButton->isChecked()));
+  }
+
+  if (this->glWf != nullptr)
+    this->glWf->setMaxBlending(cfg.useMaxBlending);
+
+  WATERFALL_CALL(setUseLBMdrag(cfg.useLMBdrag));
+}
+
 void
 PanoramicDialog::setColors(ColorConfig const &cfg)
 {
-  this->ui->waterfall->setFftPlotColor(cfg.spectrumForeground);
-  this->ui->waterfall->setFftAxesColor(cfg.spectrumAxes);
-  this->ui->waterfall->setFftBgColor(cfg.spectrumBackground);
-  this->ui->waterfall->setFftTextColor(cfg.spectrumText);
-  this->ui->waterfall->setFilterBoxColor(cfg.filterBox);
+  this->lastColors = cfg;
+
+  WATERFALL_CALL(setFftPlotColor(cfg.spectrumForeground));
+  WATERFALL_CALL(setFftAxesColor(cfg.spectrumAxes));
+  WATERFALL_CALL(setFftBgColor(cfg.spectrumBackground));
+  WATERFALL_CALL(setFftTextColor(cfg.spectrumText));
+  WATERFALL_CALL(setFilterBoxColor(cfg.filterBox));
 }
 
 void
@@ -500,8 +712,8 @@ PanoramicDialog::setPaletteGradient(QString const &name)
 
   if (index >= 0) {
     this->ui->paletteCombo->setCurrentIndex(index);
-    this->ui->waterfall->setPalette(
-          SigDiggerHelpers::instance()->getPalette(index)->getGradient());
+    WATERFALL_CALL(setPalette(
+          SigDiggerHelpers::instance()->getPalette(index)->getGradient()));
   }
 }
 
@@ -537,9 +749,54 @@ PanoramicDialog::populateDeviceCombo(void)
   if (this->deviceMap.size() > 0)
     this->onDeviceChanged();
 
+  this->populateExtraDevicesMenu();
   this->refreshUi();
 }
 
+void
+PanoramicDialog::populateExtraDevicesMenu(void)
+{
+  QStringList checked;
+  std::string primary = this->ui->deviceCombo->currentText().toStdString();
+
+  // Keep the current selection, or the saved one if the menu is empty
+  if (this->extraDevicesMenu->actions().isEmpty()) {
+    checked = QString::fromStdString(
+          this->dialogConfig->extraDevices).split("\n");
+  } else {
+    for (auto p : this->extraDevicesMenu->actions())
+      if (p->isChecked())
+        checked.push_back(p->text());
+  }
+
+  this->extraDevicesMenu->clear();
+
+  for (auto p : this->deviceMap) {
+    if (p.first != primary) {
+      QString name = QString::fromStdString(p.first);
+      QAction *action = this->extraDevicesMenu->addAction(name);
+      action->setCheckable(true);
+      action->setChecked(checked.contains(name));
+    }
+  }
+}
+
+std::vector<Suscan::Source::Device>
+PanoramicDialog::getExtraDevices(void) const
+{
+  std::vector<Suscan::Source::Device> devices;
+
+  for (auto p : this->extraDevicesMenu->actions()) {
+    if (p->isChecked()) {
+      auto it = this->deviceMap.find(p->text().toStdString());
+      if (it != this->deviceMap.cend())
+        devices.push_back(it->second);
+    }
+  }
+
+  return devices;
+}
+
 bool
 PanoramicDialog::getSelectedDevice(Suscan::Source::Device &dev) const
 {
@@ -570,12 +827,12 @@ PanoramicDialog::adjustRanges(void)
     this->ui->rangeEndSpin->setValue(val);
   }
 
-  this->ui->waterfall->setFreqUnits(
+  WATERFALL_CALL(setFreqUnits(
         getFrequencyUnits(
-          static_cast<qint64>(maxFreq)));
+          static_cast<qint64>(maxFreq))));
 
-  this->ui->waterfall->setSpanFreq(static_cast<qint64>(maxFreq - minFreq));
-  this->ui->waterfall->setCenterFreq(static_cast<qint64>(maxFreq + minFreq) / 2);
+  WATERFALL_CALL(setSpanFreq(static_cast<qint64>(maxFreq - minFreq)));
+  WATERFALL_CALL(setCenterFreq(static_cast<qint64>(maxFreq + minFreq) / 2));
 }
 
 bool
@@ -633,6 +890,13 @@ PanoramicDialog::saveConfig(void)
   this->getSelectedDevice(dev);
 
   this->dialogConfig->device = dev.getDesc();
+  this->dialogConfig->extraDevices.clear();
+
+  for (auto &p : this->getExtraDevices()) {
+    if (!this->dialogConfig->extraDevices.empty())
+      this->dialogConfig->extraDevices += "\n";
+    this->dialogConfig->extraDevices += p.getDesc();
+  }
   this->dialogConfig->lnbFreq = this->ui->lnbDoubleSpinBox->value();
   this->dialogConfig->palette = this->paletteGradient.toStdString();
   this->dialogConfig->rangeMin = this->ui->rangeStartSpin->value();
@@ -645,6 +909,10 @@ PanoramicDialog::saveConfig(void)
       this->ui->partitioningCombo->currentText().toStdString();
 
   this->dialogConfig->fullRange = this->ui->fullRangeCheck->isChecked();
+
+  this->dialogConfig->relayMode = this->getRelayMode().toStdString();
+  this->dialogConfig->relayHost = this->getRelayHost().toStdString();
+  this->dialogConfig->relayPort = this->getRelayPort();
 }
 
 FrequencyBand
@@ -724,20 +992,20 @@ void
 PanoramicDialog::redrawMeasures(void)
 {
   this->demodFreq = static_cast<qint64>(
-        this->ui->waterfall->getFilterOffset() +
+        WATERFALL_FUNC(getFilterOffset(), 0) +
         .5 * (this->freqStart + this->freqEnd));
 
   this->ui->centerLabel->setText(
         SuWidgetsHelpers::formatQuantity(
           static_cast<qreal>(
-            this->ui->waterfall->getFilterOffset() +
+            WATERFALL_FUNC(getFilterOffset(), 0) +
             .5 * (this->freqStart + this->freqEnd)),
           6,
           "Hz"));
 
   this->ui->bwLabel->setText(
         SuWidgetsHelpers::formatQuantity(
-          static_cast<qreal>(this->ui->waterfall->getFilterBw()),
+          static_cast<qreal>(WATERFALL_FUNC(getFilterBw(), 0)),
           6,
           "Hz"));
 
@@ -750,6 +1018,12 @@ PanoramicDialog::getRttMs(void) const
   return static_cast<unsigned int>(this->ui->rttSpin->value());
 }
 
+unsigned int
+PanoramicDialog::getResolution(void) const
+{
+  return this->dialogConfig->resolution;
+}
+
 float
 PanoramicDialog::getRelBw(void) const
 {
@@ -868,12 +1142,24 @@ PanoramicDialog::applyConfig(void)
   this->ui->rangeEndSpin->setValue(this->dialogConfig->rangeMax);
   this->ui->fullRangeCheck->setChecked(this->dialogConfig->fullRange);
   this->ui->sampleRateSpin->setValue(this->dialogConfig->sampRate);
-  this->ui->waterfall->setPandapterRange(
+  this->ui->relayModeCombo->setCurrentText(
+        QString::fromStdString(this->dialogConfig->relayMode));
+  this->ui->relayHostEdit->setText(
+        QString::fromStdString(this->dialogConfig->relayHost));
+  this->ui->relayPortSpin->setValue(
+        static_cast<int>(this->dialogConfig->relayPort));
+
+  for (int i = 0; i < this->ui->resolutionCombo->count(); ++i)
+    if (this->ui->resolutionCombo->itemText(i).toUInt()
+        == this->dialogConfig->resolution)
+      this->ui->resolutionCombo->setCurrentIndex(i);
+
+  WATERFALL_CALL(setPandapterRange(
         this->dialogConfig->panRangeMin,
-        this->dialogConfig->panRangeMax);
-  this->ui->waterfall->setWaterfallRange(
+        this->dialogConfig->panRangeMax));
+  WATERFALL_CALL(setWaterfallRange(
         this->dialogConfig->panRangeMin,
-        this->dialogConfig->panRangeMax);
+        this->dialogConfig->panRangeMax));
   this->onDeviceChanged();
 }
 
@@ -898,6 +1184,7 @@ PanoramicDialog::onDeviceChanged(void)
     this->clearGains();
   }
 
+  this->populateExtraDevicesMenu();
   this->adjustRanges();
 }
 
@@ -945,7 +1232,7 @@ PanoramicDialog::onToggleScan(void)
     emit stop();
   }
 
-  this->ui->waterfall->setRunningState(this->ui->scanButton->isChecked());
+  WATERFALL_CALL(setRunningState(this->ui->scanButton->isChecked()));
   this->ui->scanButton->setText(
         this->ui->scanButton->isChecked()
         ? "Stop"
@@ -958,9 +1245,9 @@ PanoramicDialog::onNewZoomLevel(float)
 {
   qint64 min, max;
   qint64 fc =
-        this->ui->waterfall->getCenterFreq()
-        + this->ui->waterfall->getFftCenterFreq();
-  qint64 span = static_cast<qint64>(this->ui->waterfall->getSpanFreq());
+        WATERFALL_FUNC(getCenterFreq(), 0)
+        + WATERFALL_FUNC(getFftCenterFreq(), 0);
+  qint64 span = static_cast<qint64>(WATERFALL_FUNC(getSpanFreq(), 0));
   bool adjLeft = false;
   bool adjRight = false;
 
@@ -995,12 +1282,12 @@ PanoramicDialog::onNewZoomLevel(float)
     }
 
     if (adjLeft && adjRight)
-      this->ui->waterfall->resetHorizontalZoom();
+      WATERFALL_CALL(resetHorizontalZoom());
 
     this->fixedFreqMode = max - min <= this->minBwForZoom * this->getRelBw();
 
     if (this->fixedFreqMode) {
-      fc = this->ui->waterfall->getCenterFreq();
+      fc = WATERFALL_FUNC(getCenterFreq(), 0);
       min = fc - span / 2;
       max = fc + span / 2;
     }
@@ -1017,7 +1304,7 @@ PanoramicDialog::onRangeChanged(float min, float max)
 {
   this->dialogConfig->panRangeMin = min;
   this->dialogConfig->panRangeMax = max;
-  this->ui->waterfall->setWaterfallRange(min, max);
+  WATERFALL_CALL(setWaterfallRange(min, max));
 }
 
 void
@@ -1062,8 +1349,8 @@ PanoramicDialog::onNewCenterFreq(qint64 freq)
   }
 
   if (rightBorder || leftBorder)
-    this->ui->waterfall->setCenterFreq(
-        static_cast<qint64>(.5 * (max + min)));
+    WATERFALL_CALL(setCenterFreq(
+        static_cast<qint64>(.5 * (max + min))));
 
   emit detailChanged(min, max, this->fixedFreqMode);
 }
@@ -1074,10 +1361,16 @@ PanoramicDialog::onPaletteChanged(int)
   this->setPaletteGradient(this->ui->paletteCombo->currentText());
 }
 
+void
+PanoramicDialog::onRelayModeChanged(void)
+{
+  this->refreshUi();
+}
+
 void
 PanoramicDialog::onStrategyChanged(QString strategy)
 {
-  this->ui->partitioningCombo->setEnabled(strategy != QString("Progressive"));
+  this->ui->partitioningCombo->setEnabled(strategy == QString("Stochastic"));
   emit strategyChanged(strategy);
 }
 
@@ -1122,20 +1415,142 @@ PanoramicDialog::onExport(void)
   } while (!done);
 }
 
+void
+PanoramicDialog::stopRecording(void)
+{
+  this->recorder.close();
+  this->refreshUi();
+}
+
+void
+PanoramicDialog::stopReplay(void)
+{
+  this->replayTimer.stop();
+  this->reader.close();
+  this->refreshUi();
+}
+
+void
+PanoramicDialog::onToggleRecord(void)
+{
+  if (this->recorder.isOpen()) {
+    this->stopRecording();
+  } else {
+    QString path = QFileDialog::getSaveFileName(
+          this,
+          "Record panoramic spectrum",
+          QString(),
+          "SigDigger panoramic recording (*.sdpan)");
+
+    if (!path.isEmpty() && !this->recorder.open(path))
+      QMessageBox::warning(
+            this,
+            "Cannot open file",
+            "Cannot create the recording in the specified location. Please "
+            "choose a different location and try again.",
+            QMessageBox::Ok);
+
+    this->refreshUi();
+  }
+}
+
+void
+PanoramicDialog::onToggleReplay(void)
+{
+  if (this->reader.isOpen()) {
+    this->stopReplay();
+  } else {
+    QString path = QFileDialog::getOpenFileName(
+          this,
+          "Replay panoramic spectrum",
+          QString(),
+          "SigDigger panoramic recording (*.sdpan)");
+
+    if (!path.isEmpty()) {
+      if (!this->reader.open(path)) {
+        QMessageBox::warning(
+              this,
+              "Cannot open file",
+              "The selected file is not a valid panoramic recording.",
+              QMessageBox::Ok);
+      } else {
+        this->frames = 0;
+        this->replayFrame = 0;
+        this->replayTimer.start(SIGDIGGER_PANORAMIC_REPLAY_INTERVAL_MS);
+      }
+    }
+
+    this->refreshUi();
+  }
+}
+
+void
+PanoramicDialog::onReplayTimeout(void)
+{
+  if (this->replayFrame >= this->reader.getFrameCount()
+      || !this->reader.read(this->replayFrame++, this->replayed)) {
+    this->stopReplay();
+    return;
+  }
+
+  this->feedFrame(
+        this->replayed.freqMin,
+        this->replayed.freqMax,
+        this->replayed.psd.data(),
+        this->replayed.psd.size());
+}
+
+void
+PanoramicDialog::onFrameTimeout(void)
+{
+  if (!this->livePending || this->reader.isOpen()) {
+    this->frameTimer.stop();
+    return;
+  }
+
+  this->livePending = false;
+
+  if (this->recorder.isOpen()) {
+    struct timeval tv;
+
+    gettimeofday(&tv, nullptr);
+
+    if (!this->recorder.write(
+          tv,
+          this->liveStart,
+          this->liveEnd,
+          this->liveFrame.data(),
+          this->liveFrame.size())) {
+      this->stopRecording();
+      QMessageBox::warning(
+            this,
+            "Recording stopped",
+            "Failed to write to the panoramic recording. Recording stopped.",
+            QMessageBox::Ok);
+    }
+  }
+
+  this->feedFrame(
+        this->liveStart,
+        this->liveEnd,
+        this->liveFrame.data(),
+        this->liveFrame.size());
+}
+
 void
 PanoramicDialog::onBandPlanChanged(int)
 {
   int val = this->ui->allocationCombo->currentData().value<int>();
 
   if (this->currentFAT.size() > 0)
-    this->ui->waterfall->removeFAT(this->currentFAT);
+    WATERFALL_CALL(removeFAT(this->currentFAT));
 
   if (val >= 0) {
-    this->ui->waterfall->setFATsVisible(true);
-    this->ui->waterfall->pushFAT(this->FATs[static_cast<unsigned>(val)]);
+    WATERFALL_CALL(setFATsVisible(true));
+    WATERFALL_CALL(pushFAT(this->FATs[static_cast<unsigned>(val)]));
     this->currentFAT = this->FATs[static_cast<unsigned>(val)]->getName();
   } else {
-    this->ui->waterfall->setFATsVisible(false);
+    WATERFALL_CALL(setFATsVisible(false));
     this->currentFAT = "";
   }
 }
@@ -1151,6 +1566,15 @@ PanoramicDialog::onGainChanged(QString name, float val)
   emit gainChanged(name, val);
 }
 
+void
+PanoramicDialog::onResolutionChanged(void)
+{
+  unsigned int resolution = this->ui->resolutionCombo->currentText().toUInt();
+
+  if (resolution > 0)
+    this->dialogConfig->resolution = resolution;
+}
+
 void
 PanoramicDialog::onSampleRateSpinChanged(void)
 {
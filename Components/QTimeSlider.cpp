@@ -26,6 +26,8 @@
 #include <QStyleOptionSlider>
 #include "SigDiggerHelpers.h"
 #include <QProxyStyle>
+#include <algorithm>
+#include <vector>
 
 using namespace SigDigger;
 
@@ -77,6 +79,20 @@ QTimeSlider::QTimeSlider(QWidget *parent) : QSlider(parent)
 void
 QTimeSlider::paintEvent(QPaintEvent *ev)
 {
+  if (!this->overview.isNull()) {
+    QPainter p(this);
+    QFontMetrics metrics(this->font());
+    qreal top = this->height() / 3;
+    qreal bottom = this->height() - metrics.height();
+
+    if (bottom > top) {
+      p.setRenderHint(QPainter::SmoothPixmapTransform);
+      p.drawImage(
+            QRectF(0, top, this->width(), bottom - top),
+            this->overview);
+    }
+  }
+
   if (timercmp(&this->startTime, &this->endTime, <=)) {
     QPainter p(this);
     QString tickFormat;
@@ -289,6 +305,52 @@ QTimeSlider::setTimeStamp(struct timeval const &tv)
   this->blockSignals(false);
 }
 
+void
+QTimeSlider::setOverview(QVector<float> const &data, int columns, int bins)
+{
+  const QRgb *table =
+      SigDiggerHelpers::instance()->getGqrxPalette()->getRgbTable();
+  std::vector<float> sorted;
+  float noise, peak, range;
+  int i, j;
+
+  if (columns <= 0 || bins <= 0 || data.size() != columns * bins) {
+    this->clearOverview();
+    return;
+  }
+
+  // Noise floor at the median, so that only activity stands out
+  sorted.assign(data.begin(), data.end());
+  std::nth_element(
+        sorted.begin(),
+        sorted.begin() + sorted.size() / 2,
+        sorted.end());
+  noise   = sorted[sorted.size() / 2];
+  peak    = *std::max_element(data.begin(), data.end());
+  range   = std::max(peak - noise, 1.f);
+
+  this->overview = QImage(columns, bins, QImage::Format_RGB32);
+
+  for (j = 0; j < bins; ++j) {
+    QRgb *line = reinterpret_cast<QRgb *>(
+          this->overview.scanLine(bins - j - 1));
+
+    for (i = 0; i < columns; ++i) {
+      float norm = (data[i * bins + j] - noise) / range;
+      line[i] = table[qBound(0, static_cast<int>(norm * 255), 255)];
+    }
+  }
+
+  this->update();
+}
+
+void
+QTimeSlider::clearOverview(void)
+{
+  this->overview = QImage();
+  this->update();
+}
+
 QDateTime
 QTimeSlider::getDateTime(void) const
 {
@@ -21,6 +21,16 @@
 
 using namespace SigDigger;
 
+// Remote analyzers are given IPv4 addresses only, names otherwise
+static QString
+ipv4String(QHostAddress const &address)
+{
+  bool ok = false;
+  quint32 ipv4 = address.toIPv4Address(&ok);
+
+  return ok ? QHostAddress(ipv4).toString() : QString();
+}
+
 QuickConnectDialog::QuickConnectDialog(QWidget *parent) :
   QDialog(parent),
   ui(new Ui::QuickConnectDialog)
@@ -29,6 +39,42 @@ QuickConnectDialog::QuickConnectDialog(QWidget *parent) :
 
   this->setWindowFlags(
     this->windowFlags() & ~Qt::WindowMaximizeButtonHint);
+
+  this->probeTimer.setSingleShot(true);
+  this->probeTimer.setInterval(SIGDIGGER_QUICK_CONNECT_PROBE_DELAY_MS);
+
+  connect(
+        this->ui->hostEdit,
+        SIGNAL(textChanged(QString)),
+        this,
+        SLOT(onHostChanged(void)));
+
+  connect(
+        this->ui->portSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onHostChanged(void)));
+
+  connect(
+        &this->probeTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onProbeTimeout(void)));
+}
+
+void
+QuickConnectDialog::cancelProbe(void)
+{
+  if (this->lookupId != -1) {
+    QHostInfo::abortHostLookup(this->lookupId);
+    this->lookupId = -1;
+  }
+
+  if (this->probe != nullptr) {
+    this->probe->abort();
+    this->probe->deleteLater();
+    this->probe = nullptr;
+  }
 }
 
 void
@@ -70,7 +116,133 @@ QuickConnectDialog::getPort(void) const
   return this->ui->portSpin->value();
 }
 
+QString
+QuickConnectDialog::getResolvedAddress(void) const
+{
+  if (this->resolvedHost != this->getHost().trimmed())
+    return QString();
+
+  return this->resolvedAddress;
+}
+
 QuickConnectDialog::~QuickConnectDialog()
 {
+  this->cancelProbe();
   delete ui;
 }
+
+////////////////////////////////// Slots /////////////////////////////////////
+void
+QuickConnectDialog::onHostChanged(void)
+{
+  this->cancelProbe();
+  this->resolvedHost.clear();
+  this->resolvedAddress.clear();
+  this->ui->statusLabel->clear();
+  this->probeTimer.start();
+}
+
+void
+QuickConnectDialog::onProbeTimeout(void)
+{
+  QString host = this->getHost().trimmed();
+
+  this->cancelProbe();
+
+  if (host.isEmpty())
+    return;
+
+  this->ui->statusLabel->setText("Resolving " + host + "...");
+
+  // Both at once: the socket does its own lookup, ours is just quicker
+  // to tell a typo apart from a server that is down
+  this->lookupId = QHostInfo::lookupHost(
+        host,
+        this,
+        SLOT(onHostResolved(QHostInfo)));
+
+  this->probe = new QTcpSocket(this);
+
+  connect(
+        this->probe,
+        SIGNAL(connected(void)),
+        this,
+        SLOT(onProbeConnected(void)));
+
+  connect(
+        this->probe,
+        SIGNAL(error(QAbstractSocket::SocketError)),
+        this,
+        SLOT(onProbeError(QAbstractSocket::SocketError)));
+
+  this->probeClock.start();
+  this->probe->connectToHost(host, static_cast<quint16>(this->getPort()));
+}
+
+void
+QuickConnectDialog::onHostResolved(QHostInfo info)
+{
+  if (info.lookupId() != this->lookupId)
+    return;
+
+  this->lookupId = -1;
+
+  if (info.error() != QHostInfo::NoError || info.addresses().isEmpty()) {
+    this->ui->statusLabel->setText(
+          "Cannot resolve host: " + info.errorString());
+    return;
+  }
+
+  // The probe may have made it first
+  if (!this->resolvedAddress.isEmpty())
+    return;
+
+  for (auto const &address : info.addresses()) {
+    this->resolvedAddress = ipv4String(address);
+    if (!this->resolvedAddress.isEmpty())
+      break;
+  }
+
+  this->resolvedHost = this->getHost().trimmed();
+
+  if (this->probe != nullptr)
+    this->ui->statusLabel->setText(
+          "Resolved to "
+          + info.addresses().first().toString()
+          + ", connecting...");
+}
+
+void
+QuickConnectDialog::onProbeConnected(void)
+{
+  // The analyzer opens a connection of its own. This one told us that
+  // the server is there, and which of its addresses answers.
+  QString peer = ipv4String(this->probe->peerAddress());
+
+  if (!peer.isEmpty()) {
+    this->resolvedHost = this->getHost().trimmed();
+    this->resolvedAddress = peer;
+  }
+
+  this->ui->statusLabel->setText(
+        QString::asprintf(
+          "Server reachable at %s (%lld ms)",
+          this->probe->peerAddress().toString().toStdString().c_str(),
+          static_cast<long long>(this->probeClock.elapsed())));
+
+  this->probe->disconnectFromHost();
+  this->probe->deleteLater();
+  this->probe = nullptr;
+}
+
+void
+QuickConnectDialog::onProbeError(QAbstractSocket::SocketError error)
+{
+  // Lookup failures are told by onHostResolved
+  if (error != QAbstractSocket::HostNotFoundError)
+    this->ui->statusLabel->setText(
+          "Cannot connect: " + this->probe->errorString());
+
+  this->probe->deleteLater();
+  this->probe = nullptr;
+}
@@ -21,19 +21,22 @@
 #include <QMessageBox>
 #include <cctype>
 #include "ui_RMSViewTab.h"
-#include <sstream>
 #include <utility>
 #include <string>
+#include <cstring>
+#include <algorithm>
 #include <QDateTime>
 #include <QFileDialog>
+#include <SigDiggerHelpers.h>
+#include <RenderScheduler.h>
 
-#define MAX_LINE_SIZE  4096
-#define TIMER_INTERVAL_MS 100
+#define TIMER_INTERVAL_MS (1000 / SIGDIGGER_RMS_VIEW_FPS)
 using namespace SigDigger;
 
-RMSViewTab::RMSViewTab(QWidget *parent, QTcpSocket *socket) :
+RMSViewTab::RMSViewTab(QWidget *parent, RMSStream *stream) :
   QWidget(parent),
-  socket(socket),
+  stream(stream),
+  history(1),
   ui(new Ui::RMSViewTab)
 {
   setlocale(LC_ALL, "C");
@@ -45,9 +48,12 @@ RMSViewTab::RMSViewTab(QWidget *parent, QTcpSocket *socket) :
   this->ui->waveform->setAutoFitToEnvelope(false);
 
   this->onToggleModes();
+  this->refreshCapacity();
+
+  RenderScheduler::instance()->attach(this, [this] () { this->refreshView(); });
 
   this->timer.start(TIMER_INTERVAL_MS);
-  this->processSocketData();
+  this->collect();
 
   this->connectAll();
 
@@ -69,7 +75,12 @@ RMSViewTab::saveToMatlab(QString const &path)
     return false;
   }
 
-  fprintf(fp, "RATE=%.9f;\n", this->rate / this->ui->intSpin->value());
+  fprintf(
+        fp,
+        "RATE=%.9f;\n",
+        this->rate
+        / this->ui->intSpin->value()
+        / static_cast<qreal>(RMSHistory::getDecimation(this->level)));
   fprintf(fp, "TIMESTAMP=%.6f;\n", this->first);
   fprintf(fp, "X=[\n");
   for (size_t i = 0; i < this->data.size(); ++i)
@@ -80,6 +91,25 @@ RMSViewTab::saveToMatlab(QString const &path)
           SU_C_IMAG(this->data[i]));
 
   fprintf(fp, "];\n");
+
+  // Averaged tiers also know the extremes of every point
+  if (this->level > 0) {
+    std::vector<SUCOMPLEX> mean;
+    std::vector<SUFLOAT> min, max;
+
+    this->history.view(this->level, mean, &min, &max);
+
+    fprintf(fp, "XMIN=[\n");
+    for (auto v : min)
+      fprintf(fp, "  %.9e\n", v);
+    fprintf(fp, "];\n");
+
+    fprintf(fp, "XMAX=[\n");
+    for (auto v : max)
+      fprintf(fp, "  %.9e\n", v);
+    fprintf(fp, "];\n");
+  }
+
   fclose(fp);
 
   return true;
@@ -89,114 +119,75 @@ void
 RMSViewTab::integrateMeasure(qreal timestamp, SUFLOAT mag)
 {
   int intLen = this->ui->intSpin->value();
-  QDateTime date;
 
   this->energy_accum += mag;
 
   if (++this->accum_ctr == intLen) {
     this->energy_accum /= intLen;
-    this->data.push_back(
-          this->energy_accum
-          + I * SU_ASFLOAT(SU_POWER_DB_RAW(this->energy_accum)));
+    this->history.push(this->energy_accum);
     this->last = timestamp;
     this->accum_ctr = 0;
     this->energy_accum = 0;
-    this->ui->waveform->refreshData();
-    if (this->ui->autoFitButton->isChecked())
-      this->fitVertical();
-    this->ui->waveform->invalidate();
+
+    // Widgets are refreshed once per batch, by refreshView()
+    this->dirty = true;
   }
 }
 
-bool
-RMSViewTab::parseLine(void)
+void
+RMSViewTab::refreshSampleRate(void)
 {
-  SUFLOAT mag, db;
-  QDateTime date;
-  long sec;
-  qreal usec;
-  qreal rate;
-  std::vector<std::string> fields;
-  std::istringstream iss(this->line);
-
-  // Description line allows commas and stuff
-  if (line.compare(0, 5, "DESC,") == 0) {
-    emit titleChanged(QString(line.c_str() + 5));
-    return true;
-  }
-
-  for (std::string token; std::getline(iss, token, ','); )
-    fields.push_back(std::move(token));
-
-  if (fields.size() == 2) {
-    if (fields[0] == "RATE") {
-      if (sscanf(fields[1].c_str(), "%lf", &rate) < 1)
-        return false;
-
-      this->rate = rate;
-      this->ui->waveform->setSampleRate(rate);
-    } else {
-      return false;
-    }
-  } else if (fields.size() == 4) {
-    if (sscanf(fields[0].c_str(), "%ld", &sec) < 1)
-      return false;
-    if (sscanf(fields[1].c_str(), "%lf", &usec) < 1)
-      return false;
-    if (sscanf(fields[2].c_str(), "%e", &mag) < 1)
-      return false;
-    if (sscanf(fields[3].c_str(), "%g", &db) < 1)
-      return false;
-
-    this->integrateMeasure(
-          static_cast<qreal>(sec) + usec,
-          mag);
-
-    if (this->data.size() > 0) {
-      date.setTime_t(static_cast<unsigned int>(this->last));
-      this->ui->lastLabel->setText("Last: " + date.toString());
-
-      if (this->data.size() == 1) {
-        this->first = this->last;
-        this->ui->sinceLabel->setText("Since: " + date.toString());
-      }
-    }
-    return true;
-  }
+  this->ui->waveform->setSampleRate(
+        this->rate
+        / this->ui->intSpin->value()
+        / static_cast<qreal>(RMSHistory::getDecimation(this->level)));
+}
 
-  return false;
+void
+RMSViewTab::refreshCapacity(void)
+{
+  this->history.setCapacity(
+        static_cast<size_t>(
+          SIGDIGGER_RMS_HISTORY_FULL_MINUTES * 60
+          * this->rate
+          / this->ui->intSpin->value()));
 }
 
 void
-RMSViewTab::processSocketData(void)
+RMSViewTab::refreshView(void)
 {
-  char c;
-  bool firstTime = this->data.size() == 0;
-
-  while (this->socket->bytesAvailable() > 0) {
-    if (this->socket->read(&c, 1) < 1) {
-      this->disconnectSocket();
-      return;
-    }
-
-    if (c == '\n') {
-      this->parseLine();
-      this->line.clear();
-    } else if (isprint(c)) {
-      this->line += c;
-      if (this->line.size() >= MAX_LINE_SIZE) {
-        this->line.clear();
-        this->disconnect();
-        QMessageBox::critical(
-              this,
-              "Max line size exceeded",
-              "Remote peer attempted to flood us. Preventively disconnected");
-      }
-    }
-  }
+  QDateTime date;
+
+  if (!this->dirty)
+    return;
+
+  this->dirty = false;
+
+  this->history.view(this->level, this->data);
 
-  if (firstTime && this->data.size() > 0) {
+  // The view ends at the last measurement
+  if (this->history.getSpan(this->level) > 0)
+    this->first = this->last
+        - static_cast<qreal>(this->history.getSpan(this->level) - 1)
+        * this->ui->intSpin->value() / this->rate;
+
+  this->ui->waveform->refreshData();
+  if (this->ui->autoFitButton->isChecked())
+    this->fitVertical();
+  this->ui->waveform->invalidate();
+
+  date.setTime_t(static_cast<unsigned int>(this->last));
+  this->ui->lastLabel->setText("Last: " + date.toString());
+
+  // Moves forward as the oldest history is forgotten
+  date.setTime_t(static_cast<unsigned int>(this->first));
+  this->ui->sinceLabel->setText("Since: " + date.toString());
+
+  if (this->fitPending) {
     qint64 width = this->ui->waveform->getVerticalAxisWidth();
+
+    this->fitPending = false;
+
     this->ui->waveform->zoomHorizontal(
           -width,
           static_cast<qint64>(this->ui->waveform->size().width()) - width);
@@ -204,14 +195,52 @@ RMSViewTab::processSocketData(void)
 }
 
 void
-RMSViewTab::disconnectSocket(void)
+RMSViewTab::collect(void)
 {
-  if (this->socket != nullptr) {
-    this->socket->close();
-    delete this->socket;
-    this->socket = nullptr;
+  bool firstTime = this->history.isEmpty();
+
+  this->stream->take(this->batch);
+
+  if (this->batch.rate > 0) {
+    this->rate = this->batch.rate;
+    this->refreshSampleRate();
+    this->refreshCapacity();
   }
 
+  if (!this->batch.title.isEmpty())
+    emit titleChanged(this->batch.title);
+
+  for (auto mag : this->batch.mags)
+    this->integrateMeasure(this->batch.last, mag);
+
+  if (firstTime && !this->history.isEmpty())
+    this->fitPending = true;
+
+  if (!this->batch.error.isEmpty())
+    QMessageBox::critical(this, "Connection closed", this->batch.error);
+
+  if (this->batch.closed && this->ui->stopButton->isEnabled())
+    this->disconnectSocket();
+
+  // Hidden tabs only accumulate. They catch up when shown.
+  if (this->dirty && SigDiggerHelpers::isOnScreen(this))
+    RenderScheduler::instance()->markDirty(this);
+}
+
+void
+RMSViewTab::showEvent(QShowEvent *event)
+{
+  QWidget::showEvent(event);
+  this->refreshView();
+}
+
+void
+RMSViewTab::disconnectSocket(void)
+{
+  // The stream itself lives until the tab is gone
+  if (this->stream != nullptr)
+    this->stream->close();
+
   this->ui->stopButton->setEnabled(false);
   this->ui->stopButton->setChecked(false);
   this->ui->stopButton->setIcon(QIcon(":/icons/offline.png"));
@@ -244,12 +273,6 @@ RMSViewTab::connectAll(void)
         this,
         SLOT(onTimeout()));
 
-  connect(
-        this->socket,
-        SIGNAL(disconnected()),
-        this,
-        SLOT(onSocketDisconnected()));
-
   connect(
         this->ui->stopButton,
         SIGNAL(clicked(bool)),
@@ -291,11 +314,19 @@ RMSViewTab::connectAll(void)
         SIGNAL(valueChanged(int)),
         this,
         SLOT(onValueChanged(int)));
+
+  connect(
+        this->ui->historyCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onHistoryChanged(int)));
 }
 
 RMSViewTab::~RMSViewTab()
 {
-  this->disconnectSocket();
+  if (this->stream != nullptr)
+    this->stream->release();
+
   delete ui;
 }
 
@@ -324,8 +355,8 @@ RMSViewTab::onStop(void)
 void
 RMSViewTab::onTimeout(void)
 {
-  if (this->socket != nullptr)
-    this->processSocketData();
+  if (this->stream != nullptr)
+    this->collect();
 }
 
 void
@@ -356,13 +387,6 @@ RMSViewTab::onResetZoom(void)
   this->ui->waveform->zoomHorizontalReset();
 }
 
-void
-RMSViewTab::onSocketDisconnected(void)
-{
-  this->socket = nullptr;
-  this->disconnectSocket();
-}
-
 void
 RMSViewTab::onValueChanged(int)
 {
@@ -370,9 +394,24 @@ RMSViewTab::onValueChanged(int)
   this->accum_ctr = 0;
   this->ui->sinceLabel->setText("Since: N/A");
   this->ui->lastLabel->setText("Last: N/A");
+  this->history.clear();
   this->data.clear();
-  this->ui->waveform->setSampleRate(rate / this->ui->intSpin->value());
+  this->refreshCapacity();
+  this->refreshSampleRate();
   this->ui->waveform->refreshData();
   if (this->ui->autoFitButton->isChecked())
     this->fitVertical();
 }
+
+void
+RMSViewTab::onHistoryChanged(int index)
+{
+  this->level = static_cast<unsigned int>(std::max(index, 0));
+  this->refreshSampleRate();
+
+  if (!this->history.isEmpty()) {
+    this->dirty = true;
+    this->fitPending = true;
+    this->refreshView();
+  }
+}
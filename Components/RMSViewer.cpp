@@ -21,7 +21,7 @@
 #include <RMSViewTab.h>
 #include <QMessageBox>
 #include <RMSViewerSettingsDialog.h>
-#include <QMessageBox>
+#include <RMSIngestor.h>
 
 #include "ui_RMSViewer.h"
 
@@ -35,17 +35,22 @@ RMSViewer::RMSViewer(QWidget *parent) :
 
   this->settingsDialog = new RMSViewerSettingsDialog(this);
   this->settingsDialog->setWindowTitle("TCP server settings");
+
+  this->ingestor = new RMSIngestor();
+  this->ingestor->moveToThread(&this->ioThread);
+  this->ioThread.start();
+
   this->connectAll();
 }
 
 void
-RMSViewer::openNewView(QTcpSocket *socket)
+RMSViewer::openNewView(RMSStream *stream)
 {
-  RMSViewTab *tab = new RMSViewTab(this, socket);
+  RMSViewTab *tab = new RMSViewTab(this, stream);
 
   int ndx = this->ui->serverTabWidget->addTab(
         tab,
-        "Power graph [" + socket->peerAddress().toString() + "]");
+        "Power graph [" + stream->getPeer() + "]");
 
   connect(
         tab,
@@ -97,19 +102,34 @@ RMSViewer::setListeningState(bool state)
               "settings dialog to define the listening address and port and "
               "try again.");
       } else {
-        this->listening = this->server.listen(
-              QHostAddress(this->listenAddr),
-              this->listenPort);
+        QString error;
+
+        QMetaObject::invokeMethod(
+              this->ingestor,
+              "listen",
+              Qt::BlockingQueuedConnection,
+              Q_RETURN_ARG(bool, this->listening),
+              Q_ARG(QString, this->listenAddr),
+              Q_ARG(quint16, this->listenPort));
 
         if (!this->listening) {
+          QMetaObject::invokeMethod(
+                this->ingestor,
+                "errorString",
+                Qt::BlockingQueuedConnection,
+                Q_RETURN_ARG(QString, error));
+
           QMessageBox::critical(
                 this,
                 "TCP server",
-                "Failed to start TCP server: " + this->server.errorString());
+                "Failed to start TCP server: " + error);
         }
       }
     } else {
-      this->server.close();
+      QMetaObject::invokeMethod(
+            this->ingestor,
+            "stop",
+            Qt::BlockingQueuedConnection);
       this->listening = false;
     }
 
@@ -139,16 +159,22 @@ void
 RMSViewer::connectAll(void)
 {
   connect(
-        &this->server,
-        SIGNAL(acceptError(QAbstractSocket::SocketError)),
+        &this->ioThread,
+        SIGNAL(finished()),
+        this->ingestor,
+        SLOT(deleteLater()));
+
+  connect(
+        this->ingestor,
+        SIGNAL(acceptError(QString)),
         this,
-        SLOT(onAcceptError(QAbstractSocket::SocketError)));
+        SLOT(onAcceptError(QString)));
 
   connect(
-        &this->server,
-        SIGNAL(newConnection()),
+        this->ingestor,
+        SIGNAL(newStream(SigDigger::RMSStream *)),
         this,
-        SLOT(onNewConnection()));
+        SLOT(onNewStream(SigDigger::RMSStream *)));
 
   connect(
         this->ui->actionStartStop,
@@ -171,29 +197,30 @@ RMSViewer::connectAll(void)
 
 RMSViewer::~RMSViewer()
 {
+  // Tabs release their streams before the I/O thread goes away
   delete ui;
+
+  this->ioThread.quit();
+  this->ioThread.wait();
 }
 
 /////////////////////////////////// Slots //////////////////////////////////////
 
 void
-RMSViewer::onAcceptError(QAbstractSocket::SocketError)
+RMSViewer::onAcceptError(QString error)
 {
   QMessageBox::critical(
         this,
         "Accept error",
-        "Failed to accept new connection: " + this->server.errorString());
+        "Failed to accept new connection: " + error);
 
   this->setListeningState(false);
 }
 
 void
-RMSViewer::onNewConnection(void)
+RMSViewer::onNewStream(SigDigger::RMSStream *stream)
 {
-  QTcpSocket *socket;
-
-  while ((socket = this->server.nextPendingConnection()) != nullptr)
-    this->openNewView(socket);
+  this->openNewView(stream);
 }
 
 void
@@ -21,6 +21,7 @@
 #include "ui_SamplerDialog.h"
 
 #include <SuWidgetsHelpers.h>
+#include <RenderScheduler.h>
 #include <QMessageBox>
 #include <QFileDialog>
 
@@ -36,7 +37,13 @@ SamplerDialog::SamplerDialog(QWidget *parent) :
         this->windowFlags() | Qt::Window | Qt::WindowMaximizeButtonHint);
   this->setModal(true);
 
+  this->store.setMemoryLimit(SIGDIGGER_SAMPLER_DIALOG_MEMORY_LIMIT);
+
   this->connectAll();
+
+  RenderScheduler::instance()->attach(
+        this,
+        [this] () { this->flushSymbols(); });
 }
 
 void
@@ -171,6 +178,8 @@ SamplerDialog::setProperties(SamplingProperties const &prop)
 void
 SamplerDialog::reset(void)
 {
+  this->store.clear();
+  this->pending.clear();
   this->ui->symView->clear();
   this->ui->histogram->reset();
 
@@ -223,12 +232,108 @@ SamplerDialog::feedSet(WaveSampleSet const &set)
   }
 
   this->ui->histogram->feed(set.block, set.len);
-  this->ui->symView->feed(set.symbols, set.len);
+
+  // Blocks arrive much faster than the view can be redrawn. The view
+  // gets whatever arrived since the last frame, in one go.
+  this->store.append(set.symbols, set.len);
+  this->pending.insert(
+        this->pending.end(),
+        set.symbols,
+        set.symbols + set.len);
+
+  RenderScheduler::instance()->markDirty(this);
+}
+
+void
+SamplerDialog::flushSymbols(void)
+{
+  if (this->pending.empty())
+    return;
+
+  this->ui->symView->feed(
+        this->pending.data(),
+        static_cast<unsigned int>(this->pending.size()));
+  this->pending.clear();
+
+  if (this->ui->symView->getLength() > SIGDIGGER_SAMPLER_DIALOG_MAX_VIEW_SYMBOLS)
+    this->trimView();
 
   this->refreshHScrollBar();
   this->refreshVScrollBar();
 }
 
+void
+SamplerDialog::trimView(void)
+{
+  // Keep half of the window, so trimming happens once every so often
+  size_t keep = SIGDIGGER_SAMPLER_DIALOG_MAX_VIEW_SYMBOLS / 2;
+  std::vector<Symbol> recent(keep);
+
+  keep = this->store.read(this->store.size() - keep, recent.data(), keep);
+
+  this->ui->symView->clear();
+  this->ui->symView->feed(recent.data(), static_cast<unsigned int>(keep));
+}
+
+//
+// Puts every sampled symbol back in the view, so that it can be saved.
+// Returns true if it did, and the view has to be trimmed afterwards.
+//
+bool
+SamplerDialog::refillView(void)
+{
+  size_t total;
+  std::vector<Symbol> block;
+  size_t got;
+
+  // Pending symbols are in the store already
+  this->flushSymbols();
+
+  total = this->store.size();
+  if (this->ui->symView->getLength() >= total)
+    return false;
+
+  if (total > SIGDIGGER_SAMPLER_DIALOG_MAX_SAVE_SYMBOLS) {
+    (void) QMessageBox::warning(
+          this->ui->symView,
+          "Save symbol file",
+          "Too many symbols for this format. Only the last "
+          + QString::number(this->ui->symView->getLength())
+          + " symbols will be saved. Save them as a packed bit stream "
+            "(*.bits) to keep all of them.",
+          QMessageBox::Ok);
+    return false;
+  }
+
+  block.resize(SIGDIGGER_SAMPLER_DIALOG_MAX_VIEW_SYMBOLS / 2);
+  this->ui->symView->clear();
+
+  for (size_t i = 0; i < total; i += got) {
+    if ((got = this->store.read(i, block.data(), block.size())) == 0)
+      break;
+    this->ui->symView->feed(block.data(), static_cast<unsigned int>(got));
+  }
+
+  return true;
+}
+
+bool
+SamplerDialog::savePacked(QString const &path)
+{
+  FILE *fp;
+  bool ok;
+
+  if ((fp = fopen(path.toStdString().c_str(), "wb")) == nullptr)
+    return false;
+
+  ok = this->store.writePacked(fp);
+
+  if (fclose(fp) != 0)
+    ok = false;
+
+  return ok;
+}
+
 WaveSampler *
 SamplerDialog::makeSampler(void)
 {
@@ -330,6 +435,7 @@ SamplerDialog::onBpsChanged(void)
   unsigned int bps = static_cast<unsigned>(this->ui->bpsSpin->value());
 
   this->decider.setBps(bps);
+  this->store.setBitsPerSymbol(bps);
   this->ui->histogram->setOrderHint(bps);
   this->ui->symView->setBitsPerSymbol(bps);
 
@@ -417,9 +523,11 @@ SamplerDialog::onSaveSymView(void)
   QFileDialog dialog(this->ui->symView);
   QStringList filters;
   enum SymView::FileFormat fmt = SymView::FILE_FORMAT_TEXT;
+  bool refilled;
 
   filters << "Text file (*.txt)"
           << "Binary file (*.bin)"
+          << "Packed bit stream (*.bits)"
           << "C source file (*.c)"
           << "Microsoft Windows Bitmap (*.bmp)"
           << "PNG Image (*.png)"
@@ -440,6 +548,19 @@ SamplerDialog::onSaveSymView(void)
         ? fi.suffix()
         : SuWidgetsHelpers::extractFilterExtension(filter);
 
+    // Everything sampled, straight from the store. The other formats
+    // are written by the view, refilled from the store if trimmed.
+    if (ext == "bits") {
+      if (!this->savePacked(SuWidgetsHelpers::ensureExtension(path, ext)))
+        (void) QMessageBox::critical(
+              this->ui->symView,
+              "Save symbol file",
+              "Failed to save file in the specified location. Please try "
+              "again.",
+              QMessageBox::Close);
+      return;
+    }
+
     if (ext == "txt")
       fmt = SymView::FILE_FORMAT_TEXT;
     else if (ext == "bin")
@@ -455,6 +576,8 @@ SamplerDialog::onSaveSymView(void)
     else if (ext == "ppm")
       fmt = SymView::FILE_FORMAT_PPM;
 
+    refilled = this->refillView();
+
     try {
       this->ui->symView->save(
             SuWidgetsHelpers::ensureExtension(path, ext),
@@ -466,5 +589,8 @@ SamplerDialog::onSaveSymView(void)
             "Failed to save file in the specified location. Please try again.",
             QMessageBox::Close);
     }
+
+    if (refilled)
+      this->trimView();
   }
 }
@@ -0,0 +1,238 @@
+//
+//    SpectrogramDialog.cpp: Spectrogram of a time window selection
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "SpectrogramDialog.h"
+#include "ui_SpectrogramDialog.h"
+#include "SpectrogramTask.h"
+#include "Palette.h"
+#include <SuWidgetsHelpers.h>
+#include <QPixmap>
+#include <algorithm>
+
+using namespace SigDigger;
+
+SpectrogramDialog::SpectrogramDialog(QWidget *parent) :
+  QDialog(parent),
+  ui(new Ui::SpectrogramDialog)
+{
+  ui->setupUi(this);
+  this->setWindowFlags(
+        this->windowFlags() | Qt::Window | Qt::WindowMaximizeButtonHint);
+
+  for (unsigned int size = 64; size <= 4096; size <<= 1)
+    this->ui->fftSizeCombo->addItem(QString::number(size), QVariant(size));
+  this->ui->fftSizeCombo->setCurrentIndex(
+        this->ui->fftSizeCombo->findData(QVariant(512u)));
+
+  // Item data is the hop, as a fraction of the FFT size
+  this->ui->overlapCombo->addItem("0%", QVariant(1.));
+  this->ui->overlapCombo->addItem("50%", QVariant(.5));
+  this->ui->overlapCombo->addItem("75%", QVariant(.25));
+  this->ui->overlapCombo->addItem("87.5%", QVariant(.125));
+  this->ui->overlapCombo->setCurrentIndex(2);
+
+  this->refreshTimer.setInterval(SIGDIGGER_SPECTROGRAM_DIALOG_REFRESH_MS);
+
+  this->connectAll();
+}
+
+SpectrogramDialog::~SpectrogramDialog()
+{
+  delete ui;
+}
+
+void
+SpectrogramDialog::connectAll(void)
+{
+  connect(
+        this->ui->computeButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SIGNAL(computeRequested(void)));
+
+  connect(
+        this->ui->rangeSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onRangeChanged(void)));
+
+  connect(
+        &this->refreshTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onRefresh(void)));
+}
+
+void
+SpectrogramDialog::setSampleRate(qreal fs)
+{
+  this->fs = fs;
+}
+
+void
+SpectrogramDialog::setPalette(const Palette *palette)
+{
+  this->palette = palette;
+
+  if (this->result)
+    this->redraw(true);
+}
+
+unsigned int
+SpectrogramDialog::getFftSize(void) const
+{
+  return this->ui->fftSizeCombo->currentData().toUInt();
+}
+
+size_t
+SpectrogramDialog::getHop(void) const
+{
+  qreal fraction = this->ui->overlapCombo->currentData().toReal();
+
+  return std::max<size_t>(
+        1,
+        static_cast<size_t>(this->getFftSize() * fraction));
+}
+
+void
+SpectrogramDialog::refreshInfo(void)
+{
+  if (!this->result || this->result->frames == 0) {
+    this->ui->infoLabel->setText("No spectrogram");
+    return;
+  }
+
+  this->ui->infoLabel->setText(
+        QString::number(this->result->frames)
+        + " frames of "
+        + QString::number(this->result->fftSize)
+        + " bins, every "
+        + SuWidgetsHelpers::formatQuantity(this->result->hop / this->fs, "s")
+        + ". RBW: "
+        + SuWidgetsHelpers::formatQuantity(
+          this->fs / this->result->fftSize, "Hz")
+        + (this->result->complete ? "" : " (computing...)"));
+}
+
+void
+SpectrogramDialog::setResult(
+    std::shared_ptr<const SpectrogramResult> const &result)
+{
+  this->result = result;
+  this->haveDrawnPeak = false;
+  this->drawn.assign(result->tiles, false);
+  this->image = QImage(
+        std::max<int>(1, static_cast<int>(result->frames)),
+        std::max<int>(1, static_cast<int>(result->fftSize)),
+        QImage::Format_RGB32);
+  this->image.fill(Qt::black);
+
+  this->refreshInfo();
+
+  if (result->complete)
+    this->redraw(true);
+  else
+    this->refreshTimer.start();
+}
+
+void
+SpectrogramDialog::notifyComplete(void)
+{
+  this->refreshTimer.stop();
+  this->onRefresh();
+  this->refreshInfo();
+}
+
+void
+SpectrogramDialog::drawTile(size_t tile)
+{
+  const SpectrogramResult *result = this->result.get();
+  unsigned int size = result->fftSize;
+  size_t first = tile * SIGDIGGER_SPECTROGRAM_TILE_FRAMES;
+  size_t last  = std::min(
+        first + SIGDIGGER_SPECTROGRAM_TILE_FRAMES,
+        result->frames);
+  float range = static_cast<float>(this->ui->rangeSpin->value());
+  float floor = this->drawnPeak - range;
+  float k = (SIGDIGGER_PALETTE_MAX_STOPS - 1) / range;
+  const QRgb *table = this->palette->getRgbTable();
+
+  // Time runs left to right, frequency bottom to top
+  for (unsigned int bin = 0; bin < size; ++bin) {
+    QRgb *line = reinterpret_cast<QRgb *>(
+          this->image.scanLine(static_cast<int>(size - 1 - bin)));
+
+    for (size_t f = first; f < last; ++f) {
+      float level = (result->power[f * size + bin] - floor) * k;
+      int index = static_cast<int>(level);
+
+      if (index < 0)
+        index = 0;
+      else if (index >= SIGDIGGER_PALETTE_MAX_STOPS)
+        index = SIGDIGGER_PALETTE_MAX_STOPS - 1;
+
+      line[f] = table[index];
+    }
+  }
+
+  this->drawn[tile] = true;
+}
+
+void
+SpectrogramDialog::redraw(bool all)
+{
+  bool changed = false;
+  float peak;
+
+  if (!this->result || this->palette == nullptr || this->result->frames == 0)
+    return;
+
+  peak = this->result->getPeak();
+
+  // Levels are relative to the strongest bin seen. If it grew too much,
+  // what was drawn is too bright: start over with the new scale.
+  if (!this->haveDrawnPeak
+      || peak > this->drawnPeak + SIGDIGGER_SPECTROGRAM_DIALOG_RESCALE_DB
+      || (this->result->complete && peak != this->drawnPeak)) {
+    all = true;
+    this->drawnPeak = peak;
+    this->haveDrawnPeak = true;
+  }
+
+  for (size_t i = 0; i < this->result->tiles; ++i) {
+    if ((all || !this->drawn[i]) && this->result->isTileDone(i)) {
+      this->drawTile(i);
+      changed = true;
+    }
+  }
+
+  if (changed)
+    this->ui->imageLabel->setPixmap(QPixmap::fromImage(this->image));
+}
+
+void
+SpectrogramDialog::onRefresh(void)
+{
+  this->redraw(false);
+}
+
+void
+SpectrogramDialog::onRangeChanged(void)
+{
+  this->redraw(true);
+}
@@ -34,10 +34,27 @@
 #include <CarrierXlator.h>
 #include <CostasRecoveryTask.h>
 #include <PLLSyncTask.h>
+#include <RecoverySweepTask.h>
 #include <QuadDemodTask.h>
 #include <AGCTask.h>
 #include <DelayedConjTask.h>
 #include <LPFTask.h>
+#include <TransformChainTask.h>
+#include <TransformReplayTask.h>
+#include <LoadCaptureTask.h>
+#include <ChannelExtractTask.h>
+#include <BatchTransformTask.h>
+#include <Suscan/MultitaskController.h>
+#include <CaptureFile.h>
+#include <SegmentedDataSaver.h>
+#include <QuantizedIQ.h>
+#include <QInputDialog>
+#include <SampleStatistics.h>
+#include <HugePages.h>
+#include <SpectrogramTask.h>
+#include <SpectrogramDialog.h>
+#include <CyclicSpectrumTask.h>
+#include <CyclicSpectrumDialog.h>
 
 #include "ui_TimeWindow.h"
 
@@ -104,6 +121,12 @@ TimeWindow::connectTransformWidgets(void)
         this,
         SLOT(onLPF()));
 
+  connect(
+        this->ui->extractButton,
+        SIGNAL(clicked(void)),
+        this,
+        SLOT(onExtractChannel()));
+
   connect(
         this->ui->costasSyncButton,
         SIGNAL(clicked(void)),
@@ -116,6 +139,18 @@ TimeWindow::connectTransformWidgets(void)
         this,
         SLOT(onPLLRecovery()));
 
+  connect(
+        this->ui->costasSweepButton,
+        SIGNAL(clicked(void)),
+        this,
+        SLOT(onCostasSweep()));
+
+  connect(
+        this->ui->pllSweepButton,
+        SIGNAL(clicked(void)),
+        this,
+        SLOT(onPLLSweep()));
+
   connect(
         this->ui->cycloButton,
         SIGNAL(clicked(void)),
@@ -157,6 +192,36 @@ TimeWindow::connectTransformWidgets(void)
         SIGNAL(clicked(void)),
         this,
         SLOT(onResetCarrier()));
+
+  connect(
+        this->ui->chainRunButton,
+        SIGNAL(clicked(void)),
+        this,
+        SLOT(onChainRun()));
+
+  connect(
+        this->ui->chainClearButton,
+        SIGNAL(clicked(void)),
+        this,
+        SLOT(onChainClear()));
+
+  connect(
+        this->ui->chainBatchButton,
+        SIGNAL(clicked(void)),
+        this,
+        SLOT(onChainBatch()));
+
+  connect(
+        this->ui->undoButton,
+        SIGNAL(clicked(void)),
+        this,
+        SLOT(onUndo()));
+
+  connect(
+        this->ui->redoButton,
+        SIGNAL(clicked(void)),
+        this,
+        SLOT(onRedo()));
 }
 
 void
@@ -200,12 +265,36 @@ TimeWindow::connectAll(void)
         this,
         SLOT(onHoverTime(qreal)));
 
+  connect(
+        this->ui->actionOpen,
+        SIGNAL(triggered(bool)),
+        this,
+        SLOT(onOpenCapture(void)));
+
   connect(
         this->ui->actionSave,
         SIGNAL(triggered(bool)),
         this,
         SLOT(onSaveAll(void)));
 
+  connect(
+        this->ui->actionSpectrogram,
+        SIGNAL(triggered(bool)),
+        this,
+        SLOT(onShowSpectrogram(void)));
+
+  connect(
+        this->spectrogramDialog,
+        SIGNAL(computeRequested(void)),
+        this,
+        SLOT(onComputeSpectrogram(void)));
+
+  connect(
+        this->cyclicDialog,
+        SIGNAL(computeRequested(void)),
+        this,
+        SLOT(onComputeCyclicSpectrum(void)));
+
   connect(
         this->ui->actionSave_selection,
         SIGNAL(triggered(bool)),
@@ -334,6 +423,30 @@ TimeWindow::connectAll(void)
         this,
         SLOT(onTaskError(QString)));
 
+  connect(
+        &this->baudController,
+        SIGNAL(done(void)),
+        this,
+        SLOT(onBaudEstimatorDone(void)));
+
+  connect(
+        &this->baudController,
+        SIGNAL(cancelled(void)),
+        this,
+        SLOT(onBaudEstimatorIdle(void)));
+
+  connect(
+        &this->baudController,
+        SIGNAL(error(QString)),
+        this,
+        SLOT(onBaudEstimatorIdle(void)));
+
+  connect(
+        this->ui->baudEstimateButton,
+        SIGNAL(clicked(void)),
+        this,
+        SLOT(onUseBaudEstimate(void)));
+
   connect(
         this->ui->guessCarrierButton,
         SIGNAL(clicked(void)),
@@ -371,12 +484,6 @@ TimeWindow::connectAll(void)
         this,
         SLOT(onTriggerHistogram(void)));
 
-  connect(
-        this->histogramDialog,
-        SIGNAL(blanked(void)),
-        this,
-        SLOT(onHistogramBlanked(void)));
-
   connect(
         this->ui->startSamplinButton,
         SIGNAL(clicked(void)),
@@ -395,12 +502,6 @@ TimeWindow::connectAll(void)
         this,
         SLOT(onAbort(void)));
 
-  connect(
-        this->histogramDialog,
-        SIGNAL(stopTask(void)),
-        this,
-        SLOT(onAbort(void)));
-
   connect(
         this->ui->clckSourceBtnGrp,
         SIGNAL(buttonClicked(int)),
@@ -440,6 +541,29 @@ TimeWindow::connectAll(void)
   connectFineTuneSelWidgets();
 }
 
+HistogramDialog *
+TimeWindow::getHistogramDialog(void)
+{
+  if (this->histogramDialog == nullptr) {
+    this->histogramDialog = new HistogramDialog(this);
+    this->histogramDialog->setColorConfig(this->colorConfig);
+
+    connect(
+          this->histogramDialog,
+          SIGNAL(blanked(void)),
+          this,
+          SLOT(onHistogramBlanked(void)));
+
+    connect(
+          this->histogramDialog,
+          SIGNAL(stopTask(void)),
+          this,
+          SLOT(onAbort(void)));
+  }
+
+  return this->histogramDialog;
+}
+
 int
 TimeWindow::getPeriodicDivision(void) const
 {
@@ -467,6 +591,13 @@ TimeWindow::showEvent(QShowEvent *)
             + TIME_WINDOW_EXTRA_WIDTH);
     this->firstShow = false;
   }
+
+  if (this->displayPending) {
+    // Same buffer as last time, but its contents may differ
+    this->ui->realWaveform->setData(nullptr, false);
+    this->ui->imagWaveform->setData(nullptr, false);
+    this->setDisplayData(this->displayData, this->displayKeepView);
+  }
 }
 
 
@@ -500,6 +631,8 @@ TimeWindow::setPaletteContrast(int contrast)
 void
 TimeWindow::setColorConfig(ColorConfig const &cfg)
 {
+  this->colorConfig = cfg;
+
   this->ui->constellation->setBackgroundColor(cfg.constellationBackground);
   this->ui->constellation->setForegroundColor(cfg.constellationForeground);
   this->ui->constellation->setAxesColor(cfg.constellationAxes);
@@ -516,7 +649,9 @@ TimeWindow::setColorConfig(ColorConfig const &cfg)
   this->ui->imagWaveform->setTextColor(cfg.spectrumText);
   this->ui->imagWaveform->setSelectionColor(cfg.selection);
 
-  this->histogramDialog->setColorConfig(cfg);
+  if (this->histogramDialog != nullptr)
+    this->histogramDialog->setColorConfig(cfg);
+
   this->samplerDialog->setColorConfig(cfg);
   this->dopplerDialog->setColorConfig(cfg);
 }
@@ -588,8 +723,15 @@ TimeWindow::getTransformRegion(
   SUCOMPLEX *dest;
   length = 0;
 
-  this->processedData.resize(this->getDisplayDataLength());
-  dest = this->processedData.data();
+  // The processed buffer is about to be resized or written
+  this->cancelStatistics();
+
+  // Contents are only worth preserving if the transform is applied to the
+  // processed buffer itself (and then, only outside the selection).
+  this->detachProcessedData(this->displayData == this->processedData);
+  HugePages::reserve(*this->processedData, this->getDisplayDataLength());
+  this->processedData->resize(this->getDisplayDataLength());
+  dest = this->processedData->data();
 
   if (data == this->data->data())
     memcpy(dest, data, this->getDisplayDataLength() * sizeof(SUCOMPLEX));
@@ -612,6 +754,154 @@ TimeWindow::getTransformRegion(
   }
 }
 
+bool
+TimeWindow::chainStep(TransformStep const &step)
+{
+  if (!this->ui->chainCheck->isChecked())
+    return false;
+
+  this->chain.push_back(step);
+  this->refreshChainLabel();
+
+  return true;
+}
+
+void
+TimeWindow::refreshChainLabel(void)
+{
+  QStringList steps;
+
+  for (auto &step : this->chain)
+    steps.append(step.describe());
+
+  this->ui->chainLabel->setText(
+        steps.isEmpty() ? "(empty)" : steps.join(" → "));
+  this->ui->chainRunButton->setEnabled(
+        !this->taskRunning && !this->chain.empty());
+  this->ui->chainBatchButton->setEnabled(!this->chain.empty());
+}
+
+void
+TimeWindow::recordTransform(
+    std::vector<TransformStep> const &steps,
+    const SUCOMPLEX *destination,
+    SUSCOUNT length)
+{
+  this->pendingRecord.steps  = steps;
+  this->pendingRecord.offset =
+      static_cast<SUSCOUNT>(destination - this->processedData->data());
+  this->pendingRecord.length = length;
+  this->recordPending = true;
+}
+
+void
+TimeWindow::commitTransform(void)
+{
+  if (this->recordPending) {
+    this->history.push(this->pendingRecord, *this->processedData);
+    this->recordPending = false;
+  }
+
+  this->refreshHistoryUi();
+}
+
+void
+TimeWindow::historySeek(size_t pos)
+{
+  const std::vector<SUCOMPLEX> *checkpoint;
+  size_t base;
+
+  if (this->taskRunning || pos > this->history.count())
+    return;
+
+  this->cancelStatistics();
+
+  if (pos == 0) {
+    this->history.seek(0);
+    this->setDisplayData(this->data, true);
+    this->onFit();
+    this->refreshHistoryUi();
+    return;
+  }
+
+  checkpoint = this->history.nearest(pos, base);
+
+  if (this->displayData == this->processedData
+      && this->history.position() <= pos
+      && this->history.position() > base) {
+    // Walking forward from the current state is cheaper
+    base = this->history.position();
+    this->detachProcessedData(true);
+  } else if (checkpoint != nullptr) {
+    this->detachProcessedData(false);
+    HugePages::reserve(*this->processedData, checkpoint->size());
+    *this->processedData = *checkpoint;
+  } else {
+    this->detachProcessedData(false);
+    HugePages::reserve(*this->processedData, this->data->size());
+    *this->processedData = *this->data;
+  }
+
+  if (base == pos) {
+    this->history.seek(pos);
+    this->refreshProcessedData();
+    this->refreshHistoryUi();
+    return;
+  }
+
+  try {
+    TransformReplayTask *task = new TransformReplayTask(
+          this->processedData->data(),
+          this->processedData->size(),
+          this->history.records(base, pos));
+
+    this->replayTarget = pos;
+    this->notifyTaskRunning(true);
+    this->taskController.process("replay", task);
+  } catch (Suscan::Exception &e) {
+    QMessageBox::warning(
+          this,
+          "Transform history",
+          "Cannot replay transforms: " + QString(e.what()));
+  }
+}
+
+void
+TimeWindow::historyAbort(void)
+{
+  bool wasReplay = this->taskController.getName() == "replay";
+
+  // The processed buffer was modified in place up to some point. Fall back
+  // to the original capture, keeping the history around for redo.
+  if ((this->recordPending || wasReplay)
+      && this->displayData == this->processedData) {
+    this->history.seek(0);
+    this->setDisplayData(this->data, true);
+  }
+
+  this->recordPending = false;
+  this->refreshHistoryUi();
+}
+
+void
+TimeWindow::refreshHistoryUi(void)
+{
+  size_t pos = this->history.position();
+
+  this->ui->historyLabel->setText(
+        pos == 0
+        ? this->history.describe(0)
+        : QString::number(pos)
+          + "/"
+          + QString::number(this->history.count())
+          + ": "
+          + this->history.describe(pos));
+  this->ui->undoButton->setEnabled(
+        !this->taskRunning && this->history.canUndo());
+  this->ui->redoButton->setEnabled(
+        !this->taskRunning && this->history.canRedo());
+}
+
 void
 TimeWindow::populateSamplingProperties(SamplingProperties &prop)
 {
@@ -719,6 +1009,7 @@ TimeWindow::notifyTaskRunning(bool running)
   this->samplingSetEnabled(!running);
 
   this->ui->lpfApplyButton->setEnabled(!running);
+  this->ui->extractButton->setEnabled(!running);
   this->ui->agcButton->setEnabled(!running);
   this->ui->dcmButton->setEnabled(!running);
   this->ui->cycloButton->setEnabled(!running);
@@ -727,6 +1018,13 @@ TimeWindow::notifyTaskRunning(bool running)
   this->ui->resetButton->setEnabled(!running);
   this->ui->costasSyncButton->setEnabled(!running);
   this->ui->pllSyncButton->setEnabled(!running);
+  this->ui->costasSweepButton->setEnabled(!running);
+  this->ui->pllSweepButton->setEnabled(!running);
+  this->ui->chainRunButton->setEnabled(!running && !this->chain.empty());
+  this->ui->chainClearButton->setEnabled(!running);
+  this->ui->undoButton->setEnabled(!running && this->history.canUndo());
+  this->ui->redoButton->setEnabled(!running && this->history.canRedo());
+  this->ui->actionSpectrogram->setEnabled(!running);
 }
 
 void
@@ -810,7 +1108,7 @@ TimeWindow::refreshMeasures(void)
   SUCOMPLEX min, max, mean;
   SUFLOAT rms;
   int length = static_cast<int>(this->getDisplayDataLength());
-  bool selection = false;
+  bool upperBound = false;
 
   if (this->ui->realWaveform->getHorizontalSelectionPresent()) {
     selStart = this->ui->realWaveform->getHorizontalSelectionStart();
@@ -854,7 +1152,17 @@ TimeWindow::refreshMeasures(void)
     max  = limits.max;
     rms  = limits.envelope;
 
-    selection = true;
+    // Exact mean and RMS, once the prefix sums are there. Until then, the
+    // envelope is only an upper bound of the RMS.
+    upperBound = !(this->stats
+        && this->stats->isFor(
+          this->getDisplayData(),
+          static_cast<size_t>(length))
+        && this->stats->compute(
+          static_cast<qint64>(selStart),
+          static_cast<qint64>(selEnd),
+          mean,
+          rms));
 
 #endif
     this->ui->periodLabel->setText(
@@ -927,7 +1235,7 @@ TimeWindow::refreshMeasures(void)
         SuWidgetsHelpers::formatScientific(SU_C_IMAG(mean)));
 
   this->ui->rmsLabel->setText(
-        (selection ? "< " : "") +
+        (upperBound ? "< " : "") +
         SuWidgetsHelpers::formatReal(rms));
 }
 
@@ -943,12 +1251,28 @@ TimeWindow::setCenterFreq(SUFREQ center)
 
 void
 TimeWindow::setDisplayData(
-    std::vector<SUCOMPLEX> const *displayData,
+    std::shared_ptr<const std::vector<SUCOMPLEX>> const &displayData,
     bool keepView)
 {
   QCursor cursor = this->cursor();
 
+  // The previous buffer may be released right below
+  this->cancelStatistics();
   this->displayData = displayData;
+  this->spectrograms.clear();
+  this->cyclicSpectrum.reset();
+
+  // Building the waveform envelopes is the expensive part. Nobody sees it
+  // while the window is hidden or minimized, so it waits for showEvent().
+  if (!SigDiggerHelpers::isOnScreen(this)) {
+    this->displayKeepView = this->displayPending
+        ? this->displayKeepView && keepView
+        : keepView;
+    this->displayPending = true;
+    return;
+  }
+
+  this->displayPending = false;
 
   // This is just a workaround. TODO: fix build method in Waveformview
   this->setCursor(Qt::WaitCursor);
@@ -960,8 +1284,10 @@ TimeWindow::setDisplayData(
     qint64 currStart = this->ui->realWaveform->getSampleStart();
     qint64 currEnd   = this->ui->realWaveform->getSampleEnd();
 
-    this->ui->realWaveform->setData(displayData, keepView, true);
-    this->ui->imagWaveform->setData(displayData, keepView, true);
+    this->ui->realWaveform->setData(displayData.get(), keepView, true);
+    this->ui->imagWaveform->setData(displayData.get(), keepView, true);
+
+    this->buildStatistics();
 
     if (currStart != currEnd) {
       this->ui->realWaveform->zoomHorizontal(currStart, currEnd);
@@ -976,13 +1302,71 @@ TimeWindow::setDisplayData(
   this->setCursor(cursor);
 }
 
+//
+// The processed buffer was rewritten in place. The waveform keeps its own
+// decimated envelope tree, which would not be rebuilt if we passed the same
+// buffer again. Detaching it first (which costs nothing) forces a single
+// rebuild over the new samples, instead of an extra pass over the original
+// capture just to make the buffer look different.
+//
+void
+TimeWindow::refreshProcessedData(void)
+{
+  qint64 currStart = this->ui->realWaveform->getSampleStart();
+  qint64 currEnd   = this->ui->realWaveform->getSampleEnd();
+
+  if (this->displayData == this->processedData) {
+    this->ui->realWaveform->setData(nullptr, false);
+    this->ui->imagWaveform->setData(nullptr, false);
+  }
+
+  this->setDisplayData(this->processedData, true);
+
+  if (currStart != currEnd) {
+    this->ui->realWaveform->zoomHorizontal(currStart, currEnd);
+    this->ui->imagWaveform->zoomHorizontal(currStart, currEnd);
+  }
+}
+
+//
+// Export tasks read the processed buffer without copying it. If one of
+// them is still running, the buffer is left to it and transforms are
+// written to a new one instead. The display keeps its own reference, so
+// it does not count as a reader here.
+//
+void
+TimeWindow::detachProcessedData(bool preserve)
+{
+  long owners = this->processedData.use_count();
+
+  if (this->displayData == this->processedData)
+    --owners;
+
+  if (owners > 1) {
+    if (preserve)
+      this->processedData =
+          std::make_shared<std::vector<SUCOMPLEX>>(*this->processedData);
+    else
+      this->processedData = std::make_shared<std::vector<SUCOMPLEX>>();
+  }
+}
+
 void
-TimeWindow::setData(std::vector<SUCOMPLEX> const &data, qreal fs, qreal bw)
+TimeWindow::setData(
+    std::shared_ptr<const std::vector<SUCOMPLEX>> const &data,
+    qreal fs,
+    qreal bw)
 {
+  this->cancelStatistics();
+
   if (this->fs != fs) {
     this->fs = fs;
     this->ui->costasBwSpin->setValue(this->fs / 200);
     this->ui->pllCutOffSpin->setValue(this->fs / 200);
+    this->ui->extractBwSpin->setMaximum(this->fs);
+    this->ui->extractBwSpin->setValue(this->fs / 10);
+    this->ui->extractRateSpin->setMaximum(this->fs);
+    this->ui->extractRateSpin->setValue(this->fs / 8);
   }
 
   if (!sufeq(this->bw, bw, 1e-6)) {
@@ -992,13 +1376,23 @@ TimeWindow::setData(std::vector<SUCOMPLEX> const &data, qreal fs, qreal bw)
 
   this->ui->syncFreqSpin->setMinimum(-this->fs / 2);
   this->ui->syncFreqSpin->setMaximum(this->fs / 2);
+  this->ui->extractFreqSpin->setMinimum(-this->fs / 2);
+  this->ui->extractFreqSpin->setMaximum(this->fs / 2);
   this->ui->realWaveform->setSampleRate(fs);
   this->ui->imagWaveform->setSampleRate(fs);
 
-  this->data = &data;
+  this->data = data;
+
+  // Transforms of the previous capture are of no use now. Let go of them
+  // before anything else, so memory use does not peak at two captures. The
+  // new processed buffer is only allocated by the first transform.
+  this->processedData = std::make_shared<std::vector<SUCOMPLEX>>();
 
-  this->setDisplayData(&data);
+  this->history.clear();
+  this->recordPending = false;
+  this->setDisplayData(data);
   this->onCarrierSlidersChanged();
+  this->refreshHistoryUi();
 }
 
 void
@@ -1018,9 +1412,14 @@ TimeWindow::TimeWindow(QWidget *parent) :
 {
   ui->setupUi(this);
 
-  this->histogramDialog = new HistogramDialog(this);
+  this->processedData = std::make_shared<std::vector<SUCOMPLEX>>();
+  this->displayData   = this->processedData;
+  this->data          = this->processedData;
+
   this->samplerDialog   = new SamplerDialog(this);
   this->dopplerDialog   = new DopplerDialog(this);
+  this->spectrogramDialog = new SpectrogramDialog(this);
+  this->cyclicDialog    = new CyclicSpectrumDialog(this);
 
   // We can do this because both labels have the same font
   this->ui->notchWidthLabel->setFixedWidth(
@@ -1066,6 +1465,8 @@ TimeWindow::TimeWindow(QWidget *parent) :
   SigDiggerHelpers::instance()->populatePaletteCombo(this->ui->paletteCombo);
 
   this->ui->toolBox->setCurrentIndex(0);
+  this->refreshChainLabel();
+  this->refreshHistoryUi();
 
   this->connectAll();
 }
@@ -1078,9 +1479,134 @@ TimeWindow::postLoadInit()
 
 TimeWindow::~TimeWindow()
 {
+  this->cancelStatistics();
+
   delete ui;
 }
 
+void
+TimeWindow::buildStatistics(void)
+{
+  Suscan::TaskPool *pool = Suscan::TaskPool::shared();
+  std::shared_ptr<SampleStatistics> stats;
+  TimeWindow *window = this;
+
+  this->cancelStatistics();
+
+  if (this->getDisplayDataLength() == 0)
+    return;
+
+  this->stats = stats = std::make_shared<SampleStatistics>(
+        this->getDisplayData(),
+        this->getDisplayDataLength());
+
+  // The window stops the statistics before going away: a build in
+  // progress is waited for, one that did not start does nothing.
+  auto job = [stats, window] () {
+    stats->build([window] () {
+      QMetaObject::invokeMethod(
+            window,
+            "onStatisticsReady",
+            Qt::QueuedConnection);
+    });
+
+    return false;
+  };
+
+  if (pool != nullptr)
+    pool->submit(job, Suscan::TASK_PRIORITY_INTERACTIVE);
+  else
+    job();
+}
+
+void
+TimeWindow::cancelStatistics(void)
+{
+  if (this->stats) {
+    this->stats->stop();
+    this->stats.reset();
+  }
+}
+
+void
+TimeWindow::estimateBaud(void)
+{
+  BaudEstimatorTask *task;
+  qint64 start, end;
+
+  this->baudCandidates.clear();
+  this->refreshBaudEstimate();
+
+  if (!this->ui->realWaveform->isComplete()
+      || !this->ui->realWaveform->getHorizontalSelectionPresent()) {
+    this->baudPending = false;
+    this->baudController.cancel();
+    return;
+  }
+
+  start = std::max<qint64>(
+        0,
+        static_cast<qint64>(
+          this->ui->realWaveform->getHorizontalSelectionStart()));
+  end   = std::min<qint64>(
+        static_cast<qint64>(this->getDisplayDataLength()),
+        static_cast<qint64>(
+          this->ui->realWaveform->getHorizontalSelectionEnd()));
+
+  if (end - start < SIGDIGGER_BAUD_ESTIMATOR_SEGMENT_MIN)
+    return;
+
+  task = new BaudEstimatorTask(
+        this->displayData,
+        static_cast<size_t>(start),
+        static_cast<size_t>(end - start),
+        this->fs);
+
+  // Still busy with an older selection: this one goes next
+  if (!this->baudController.process("baudEstimator", task)) {
+    delete task;
+    this->baudPending = true;
+    this->baudController.cancel();
+  }
+}
+
+void
+TimeWindow::refreshBaudEstimate(void)
+{
+  QString tooltip;
+
+  if (this->baudCandidates.empty()) {
+    this->ui->baudEstimateButton->setText("N/A");
+    this->ui->baudEstimateButton->setToolTip(QString());
+    this->ui->baudEstimateButton->setEnabled(false);
+    return;
+  }
+
+  for (auto const &candidate : this->baudCandidates) {
+    if (!tooltip.isEmpty())
+      tooltip += "\n";
+
+    tooltip += SuWidgetsHelpers::formatQuantity(candidate.rate, 4, "Hz")
+        + QString::asprintf(
+          " (%.0f%%, %.1f dB)",
+          candidate.confidence * 100,
+          static_cast<double>(candidate.snr));
+  }
+
+  this->ui->baudEstimateButton->setText(
+        SuWidgetsHelpers::formatQuantity(
+          this->baudCandidates.front().rate,
+          4,
+          "Hz")
+        + QString::asprintf(
+          " (%.0f%%)",
+          this->baudCandidates.front().confidence * 100));
+  this->ui->baudEstimateButton->setToolTip(
+        "Symbol rate candidates, from the squared envelope of the "
+        "selection (click to use the first one):\n" + tooltip);
+  this->ui->baudEstimateButton->setEnabled(true);
+}
+
 //////////////////////////////////// Slots /////////////////////////////////////
 void
 TimeWindow::onHZoom(qint64 min, qint64 max)
@@ -1130,6 +1656,7 @@ TimeWindow::onHSelection(qreal min, qreal max)
 
     this->refreshUi();
     this->refreshMeasures();
+    this->estimateBaud();
     wf->invalidate();
 
     this->adjusting = false;
@@ -1299,13 +1826,182 @@ TimeWindow::onPeriodicDivisionsChanged(void)
 }
 
 
+void
+TimeWindow::onOpenCapture(void)
+{
+  std::shared_ptr<CaptureFile> file;
+  QString path;
+  qreal rate;
+  quint64 from = 0;
+  quint64 count;
+  bool ok = true;
+
+  if (this->taskRunning)
+    return;
+
+  path = QFileDialog::getOpenFileName(
+        this,
+        "Open capture",
+        QString(),
+        "Capture files (*.raw *.cf32 *"
+        SIGDIGGER_SEGMENTED_INDEX_EXTENSION
+        " *" SIGDIGGER_QUANTIZED_IQ_EXTENSION ");;Any (*)");
+
+  if (path.isEmpty())
+    return;
+
+  file = std::make_shared<CaptureFile>();
+  if (!file->open(path.toStdString())) {
+    QMessageBox::warning(
+          this,
+          "Open capture",
+          "Cannot open capture: " + QString::fromStdString(file->getError()));
+    return;
+  }
+
+  // Raw files carry no metadata
+  rate = file->getSampleRate();
+  if (rate <= 0) {
+    rate = QInputDialog::getDouble(
+          this,
+          "Open capture",
+          "Sample rate (sp/s)",
+          this->fs > 0 ? this->fs : 250000,
+          1,
+          1e9,
+          0,
+          &ok);
+    if (!ok)
+      return;
+  }
+
+  // Whatever does not fit stays in the file. Only the chosen range is
+  // read (and, for raw files, paged in).
+  count = file->getLength();
+  if (count > TIME_WINDOW_MAX_LOAD_SAMPLES) {
+    qreal duration = count / rate;
+    qreal start = QInputDialog::getDouble(
+          this,
+          "Open capture",
+          "This capture is " + SuWidgetsHelpers::formatQuantity(duration, "s")
+          + " long, only "
+          + SuWidgetsHelpers::formatQuantity(
+            TIME_WINDOW_MAX_LOAD_SAMPLES / rate, "s")
+          + " can be loaded at once. Start at (s):",
+          0,
+          0,
+          duration,
+          3,
+          &ok);
+    if (!ok)
+      return;
+
+    from  = std::min(static_cast<quint64>(start * rate), count - 1);
+    count = std::min(
+          count - from,
+          static_cast<quint64>(TIME_WINDOW_MAX_LOAD_SAMPLES));
+  }
+
+  this->captureFile = file;
+  this->captureRate = rate;
+
+  this->notifyTaskRunning(true);
+  this->taskController.process(
+        "loadCapture",
+        new LoadCaptureTask(file, from, static_cast<size_t>(count)));
+}
+
+void
+TimeWindow::onStatisticsReady(void)
+{
+  if (this->stats && this->stats->isReady())
+    this->refreshMeasures();
+}
+
+void
+TimeWindow::onShowSpectrogram(void)
+{
+  qint64 start = 0;
+  qint64 end = static_cast<qint64>(this->getDisplayDataLength());
+
+  if (this->ui->realWaveform->getHorizontalSelectionPresent()) {
+    start = std::max<qint64>(
+          0,
+          static_cast<qint64>(
+            this->ui->realWaveform->getHorizontalSelectionStart()));
+    end   = std::min<qint64>(
+          end,
+          static_cast<qint64>(
+            this->ui->realWaveform->getHorizontalSelectionEnd()));
+  }
+
+  if (end <= start)
+    return;
+
+  this->spectrogramStart  = start;
+  this->spectrogramLength = static_cast<size_t>(end - start);
+
+  this->spectrogramDialog->setSampleRate(this->fs);
+  this->spectrogramDialog->setPalette(
+        SigDiggerHelpers::instance()->getPalette(this->getPalette()));
+  this->spectrogramDialog->show();
+  this->spectrogramDialog->raise();
+
+  this->onComputeSpectrogram();
+}
+
+void
+TimeWindow::onComputeSpectrogram(void)
+{
+  unsigned int fftSize = this->spectrogramDialog->getFftSize();
+  size_t hop = this->spectrogramDialog->getHop();
+  std::shared_ptr<SpectrogramResult> result;
+  SpectrogramTask *task;
+
+  if (this->taskRunning || this->spectrogramLength == 0)
+    return;
+
+  for (auto &p : this->spectrograms) {
+    if (p->matches(
+          fftSize,
+          hop,
+          this->spectrogramStart,
+          this->spectrogramLength)) {
+      this->spectrogramDialog->setResult(p);
+      this->spectrogramDialog->notifyComplete();
+      return;
+    }
+  }
+
+  result = std::make_shared<SpectrogramResult>(
+        fftSize,
+        hop,
+        this->spectrogramStart,
+        this->spectrogramLength);
+
+  if (result->frames == 0) {
+    QMessageBox::warning(
+          this,
+          "Spectrogram",
+          "The selection is shorter than the FFT size.");
+    return;
+  }
+
+  task = new SpectrogramTask(this->displayData, result);
+
+  this->pendingSpectrogram = result;
+  this->spectrogramDialog->setResult(result);
+
+  this->notifyTaskRunning(true);
+  this->taskController.process("spectrogram", task);
+}
+
 void
 TimeWindow::onSaveAll(void)
 {
   SigDiggerHelpers::openSaveSamplesDialog(
         this,
-        this->getDisplayData(),
-        this->getDisplayDataLength(),
+        this->displayData,
         this->fs,
         0,
         static_cast<int>(this->getDisplayDataLength()),
@@ -1317,8 +2013,7 @@ TimeWindow::onSaveSelection(void)
 {
   SigDiggerHelpers::openSaveSamplesDialog(
         this,
-        this->getDisplayData(),
-        this->getDisplayDataLength(),
+        this->displayData,
         this->fs,
         static_cast<int>(this->ui->realWaveform->getHorizontalSelectionStart()),
         static_cast<int>(this->ui->realWaveform->getHorizontalSelectionEnd()),
@@ -1461,6 +2156,8 @@ TimeWindow::onPaletteChanged(int index)
   if (palette != nullptr) {
     this->ui->realWaveform->setPalette(palette->getGradient());
     this->ui->imagWaveform->setPalette(palette->getGradient());
+    this->spectrogramDialog->setPalette(palette);
+    this->cyclicDialog->setPalette(palette);
   }
 
   emit configChanged();
@@ -1528,17 +2225,104 @@ TimeWindow::onTaskDone(void)
     // Translate
     CarrierXlator *cx = new CarrierXlator(orig, dest, len, relFreq, 0);
 
+    TransformStep step;
+    step.kind = TransformStep::XLATE;
+    step.freq = relFreq;
+    this->recordTransform(std::vector<TransformStep>(1, step), dest, len);
+
     // Launch carrier translator
     this->taskController.process("xlateCarrier", cx);
   } else if (this->taskController.getName() == "xlateCarrier") {
-    this->setDisplayData(&this->processedData, true);
+    this->commitTransform();
+    this->refreshProcessedData();
+    this->notifyTaskRunning(false);
+  } else if (this->taskController.getName() == "replay") {
+    this->history.seek(this->replayTarget);
+    this->history.checkpoint(this->replayTarget, *this->processedData);
+    this->refreshProcessedData();
+    this->notifyTaskRunning(false);
+    this->refreshHistoryUi();
+  } else if (this->taskController.getName() == "loadCapture") {
+    LoadCaptureTask *task = const_cast<LoadCaptureTask *>(
+          static_cast<const LoadCaptureTask *>(this->taskController.getTask()));
+    SUFREQ freq = this->captureFile->getFrequency();
+
+    this->notifyTaskRunning(false);
+    this->setData(task->takeBuffer(), this->captureRate, this->captureRate);
+    if (freq != 0)
+      this->setCenterFreq(freq);
+    this->captureFile.reset();
+    this->onFit();
+  } else if (this->taskController.getName() == "extractChannel") {
+    ChannelExtractTask *task = const_cast<ChannelExtractTask *>(
+          static_cast<const ChannelExtractTask *>(
+            this->taskController.getTask()));
+
+    this->notifyTaskRunning(false);
+    this->setData(task->takeBuffer(), task->getRate(), task->getBandwidth());
+    this->setCenterFreq(this->centerFreq + this->extractFreq);
+    this->onFit();
+  } else if (this->taskController.getName() == "spectrogram") {
+    this->pendingSpectrogram->complete = true;
+
+    this->spectrograms.push_back(this->pendingSpectrogram);
+    if (this->spectrograms.size() > TIME_WINDOW_SPECTROGRAM_CACHE)
+      this->spectrograms.erase(this->spectrograms.begin());
+    this->pendingSpectrogram.reset();
+
+    this->spectrogramDialog->notifyComplete();
+    this->notifyTaskRunning(false);
+  } else if (this->taskController.getName() == "cyclicSpectrum") {
+    this->pendingCyclicSpectrum->complete = true;
+    this->cyclicSpectrum = this->pendingCyclicSpectrum;
+    this->pendingCyclicSpectrum.reset();
+
+    this->cyclicDialog->notifyComplete();
     this->notifyTaskRunning(false);
   } else if (this->taskController.getName() == "triggerHistogram") {
-    this->histogramDialog->show();
+    this->getHistogramDialog()->show();
     this->notifyTaskRunning(false);
   } else if (this->taskController.getName() == "triggerSampler") {
     this->samplerDialog->show();
     this->notifyTaskRunning(false);
+  } else if (this->taskController.getName() == "costasSweep"
+             || this->taskController.getName() == "pllSweep") {
+    bool costas = this->taskController.getName() == "costasSweep";
+    RecoveryCandidate best =
+        static_cast<const RecoverySweepTask *>(
+          this->taskController.getTask())->getBest();
+
+    this->notifyTaskRunning(false);
+
+    if (best.score <= 0) {
+      QMessageBox::warning(
+            this,
+            "Recovery parameter sweep",
+            "None of the swept configurations locked to the signal.");
+      return;
+    }
+
+    // Leave the winner in the UI, and run it on the whole selection
+    if (costas) {
+      switch (best.kind) {
+        case SU_COSTAS_KIND_QPSK:
+          this->ui->costasOrderCombo->setCurrentIndex(1);
+          break;
+
+        case SU_COSTAS_KIND_8PSK:
+          this->ui->costasOrderCombo->setCurrentIndex(2);
+          break;
+
+        default:
+          this->ui->costasOrderCombo->setCurrentIndex(0);
+      }
+
+      this->ui->costasBwSpin->setValue(SU_NORM2ABS_FREQ(this->fs, best.bw));
+      this->onCostasRecovery();
+    } else {
+      this->ui->pllCutOffSpin->setValue(SU_NORM2ABS_FREQ(this->fs, best.bw));
+      this->onPLLRecovery();
+    }
   } else if (this->taskController.getName() == "computeDoppler") {
     SUFLOAT lambda = static_cast<SUFLOAT>(299792458. / this->ui->refFreqSpin->value());
     // Oh my god. Please provide something better than this
@@ -1560,10 +2344,8 @@ TimeWindow::onTaskDone(void)
     this->dopplerDialog->setMax(dc->getMax());
     this->dopplerDialog->show();
   } else {
-    this->setDisplayData(this->data, true);
-    this->setDisplayData(&this->processedData, true);
-    this->ui->realWaveform->invalidate();
-    this->ui->imagWaveform->invalidate();
+    this->commitTransform();
+    this->refreshProcessedData();
     this->onFit();
     this->notifyTaskRunning(false);
   }
@@ -1576,6 +2358,10 @@ TimeWindow::onTaskCancelled(void)
   this->ui->taskStateLabel->setText("Idle");
   this->ui->taskProgressBar->setValue(0);
 
+  this->historyAbort();
+  this->captureFile.reset();
+  this->pendingSpectrogram.reset();
+  this->pendingCyclicSpectrum.reset();
   this->notifyTaskRunning(false);
 }
 
@@ -1585,11 +2371,37 @@ TimeWindow::onTaskError(QString error)
   this->ui->taskStateLabel->setText("Idle");
   this->ui->taskProgressBar->setValue(0);
 
+  this->historyAbort();
+  this->captureFile.reset();
+  this->pendingSpectrogram.reset();
+  this->pendingCyclicSpectrum.reset();
   this->notifyTaskRunning(false);
 
   QMessageBox::warning(this, "Background task failed", "Task failed: " + error);
 }
 
+//
+// Segment size for the carrier detector. 0 means a single FFT over the
+// whole selection, which is what the automatic setting picks unless the
+// selection is too long for a single transform.
+//
+size_t
+TimeWindow::getCarrierSegmentSize(size_t length) const
+{
+  switch (this->ui->segmentSizeCombo->currentIndex()) {
+    case 0:
+      return length > SIGDIGGER_CARRIER_DETECTOR_MAX_SINGLE_FFT
+          ? SIGDIGGER_CARRIER_DETECTOR_MAX_SINGLE_FFT
+          : 0;
+
+    case 1:
+      return 0;
+
+    default:
+      return this->ui->segmentSizeCombo->currentText().toULongLong();
+  }
+}
+
 void
 TimeWindow::onGuessCarrier(void)
 {
@@ -1606,7 +2418,8 @@ TimeWindow::onGuessCarrier(void)
           static_cast<qreal>(this->ui->averagerSlider->value())
           / static_cast<qreal>(this->ui->averagerSlider->maximum()),
           static_cast<qreal>(this->ui->dcNotchSlider->value())
-          / static_cast<qreal>(this->ui->dcNotchSlider->maximum()));
+          / static_cast<qreal>(this->ui->dcNotchSlider->maximum()),
+          this->getCarrierSegmentSize(static_cast<size_t>(selEnd - selStart)));
 
     this->notifyTaskRunning(true);
     this->taskController.process("guessCarrier", cd);
@@ -1632,6 +2445,12 @@ TimeWindow::onSyncCarrier(void)
 
   CarrierXlator *cx = new CarrierXlator(orig, dest, len, relFreq, phase);
 
+  TransformStep step;
+  step.kind = TransformStep::XLATE;
+  step.freq = relFreq;
+  step.phase = phase;
+  this->recordTransform(std::vector<TransformStep>(1, step), dest, len);
+
   this->notifyTaskRunning(true);
   this->taskController.process("xlateCarrier", cx);
 }
@@ -1639,8 +2458,7 @@ TimeWindow::onSyncCarrier(void)
 void
 TimeWindow::onResetCarrier(void)
 {
-  this->setDisplayData(this->data, true);
-  this->onFit();
+  this->historySeek(0);
   this->ui->syncFreqSpin->setValue(0);
 }
 
@@ -1668,9 +2486,9 @@ TimeWindow::onCarrierSlidersChanged(void)
 }
 
 void
-TimeWindow::onHistogramSamples(const float *samples, unsigned int size)
+TimeWindow::onHistogramBins(SigDigger::HistogramBins const &bins)
 {
-  this->histogramDialog->feed(samples, size);
+  this->getHistogramDialog()->setBins(bins);
 }
 
 void
@@ -1687,13 +2505,13 @@ TimeWindow::onTriggerHistogram(void)
 
   connect(
         hf,
-        SIGNAL(data(const float *, unsigned int)),
+        SIGNAL(data(SigDigger::HistogramBins)),
         this,
-        SLOT(onHistogramSamples(const float *, unsigned int)));
+        SLOT(onHistogramBins(SigDigger::HistogramBins)));
 
-  this->histogramDialog->reset();
-  this->histogramDialog->setProperties(props);
-  this->histogramDialog->show();
+  this->getHistogramDialog()->reset();
+  this->getHistogramDialog()->setProperties(props);
+  this->getHistogramDialog()->show();
   this->notifyTaskRunning(true);
   this->taskController.process("triggerHistogram", hf);
 }
@@ -1701,12 +2519,12 @@ TimeWindow::onTriggerHistogram(void)
 void
 TimeWindow::onHistogramBlanked(void)
 {
-  if (this->histogramDialog->isVisible())
+  if (this->histogramDialog != nullptr && this->histogramDialog->isVisible())
     this->onTriggerHistogram();
 }
 
 void
-TimeWindow::onSampleSet(SigDigger::WaveSampleSet set)
+TimeWindow::onSampleSet(SigDigger::WaveSampleSet const &set)
 {
   this->samplerDialog->feedSet(set);
 }
@@ -1870,6 +2688,42 @@ TimeWindow::onCalculateDoppler(void)
   }
 }
 
+void
+TimeWindow::onBaudEstimatorDone(void)
+{
+  const BaudEstimatorTask *task = static_cast<const BaudEstimatorTask *>(
+        this->baudController.getTask());
+
+  if (this->baudPending) {
+    this->baudPending = false;
+    this->estimateBaud();
+    return;
+  }
+
+  // The selection went away before the estimate got cancelled
+  if (!this->ui->realWaveform->getHorizontalSelectionPresent())
+    return;
+
+  this->baudCandidates = task->getCandidates();
+  this->refreshBaudEstimate();
+}
+
+void
+TimeWindow::onBaudEstimatorIdle(void)
+{
+  if (this->baudPending) {
+    this->baudPending = false;
+    this->estimateBaud();
+  }
+}
+
+void
+TimeWindow::onUseBaudEstimate(void)
+{
+  if (!this->baudCandidates.empty())
+    this->ui->baudSpin->setValue(this->baudCandidates.front().rate);
+}
+
 void
 TimeWindow::onCostasRecovery(void)
 {
@@ -1910,6 +2764,15 @@ TimeWindow::onCostasRecovery(void)
         break;
     }
 
+    TransformStep step;
+    step.kind = TransformStep::COSTAS;
+    step.tau = tau;
+    step.bw = relBw;
+    step.costasKind = kind;
+
+    if (this->chainStep(step))
+      return;
+
     CostasRecoveryTask *task = new CostasRecoveryTask(
           orig,
           dest,
@@ -1918,6 +2781,7 @@ TimeWindow::onCostasRecovery(void)
           relBw,
           kind);
 
+    this->recordTransform(std::vector<TransformStep>(1, step), dest, len);
     this->notifyTaskRunning(true);
     this->taskController.process("costas", task);
   } catch (Suscan::Exception &e) {
@@ -1948,8 +2812,16 @@ TimeWindow::onPLLRecovery(void)
           len,
           this->ui->afcSelCheck->isChecked());
 
+    TransformStep step;
+    step.kind = TransformStep::PLL;
+    step.bw = relBw;
+
+    if (this->chainStep(step))
+      return;
+
     PLLSyncTask *task = new PLLSyncTask(orig, dest, len, relBw);
 
+    this->recordTransform(std::vector<TransformStep>(1, step), dest, len);
     this->notifyTaskRunning(true);
     this->taskController.process("pll", task);
   } catch (Suscan::Exception &e) {
@@ -1961,32 +2833,140 @@ TimeWindow::onPLLRecovery(void)
 }
 
 void
-TimeWindow::onCycloAnalysis(void)
+TimeWindow::onCostasSweep(void)
 {
   if (!this->ui->realWaveform->isComplete())
     return;
 
-  try {
-    const SUCOMPLEX *orig;
-    SUCOMPLEX *dest;
-    SUSCOUNT len;
+  SUFLOAT relBw = SU_ABS2NORM_FREQ(
+        this->fs,
+        this->ui->costasBwSpin->value());
+  SUFLOAT tau = 1. / SU_ABS2NORM_BAUD(
+        this->fs,
+        this->ui->costasArmBwSpin->value());
+  const SUCOMPLEX *orig;
+  SUCOMPLEX *dest;
+  SUSCOUNT len;
 
-    this->getTransformRegion(
+  this->getTransformRegion(
+        orig,
+        dest,
+        len,
+        this->ui->afcSelCheck->isChecked());
+
+  this->notifyTaskRunning(true);
+  this->taskController.process(
+        "costasSweep",
+        new RecoverySweepTask(
           orig,
-          dest,
           len,
-          this->ui->transSelCheck->isChecked());
+          RecoverySweepTask::costasGrid(tau, relBw)));
+}
 
-    DelayedConjTask *task = new DelayedConjTask(orig, dest, len, 1);
+void
+TimeWindow::onPLLSweep(void)
+{
+  if (!this->ui->realWaveform->isComplete())
+    return;
 
-    this->notifyTaskRunning(true);
-    this->taskController.process("cyclo", task);
-  } catch (Suscan::Exception &e) {
+  SUFLOAT relBw = SU_ABS2NORM_FREQ(
+        this->fs,
+        this->ui->pllCutOffSpin->value());
+  const SUCOMPLEX *orig;
+  SUCOMPLEX *dest;
+  SUSCOUNT len;
+
+  this->getTransformRegion(
+        orig,
+        dest,
+        len,
+        this->ui->afcSelCheck->isChecked());
+
+  this->notifyTaskRunning(true);
+  this->taskController.process(
+        "pllSweep",
+        new RecoverySweepTask(orig, len, RecoverySweepTask::pllGrid(relBw)));
+}
+
+void
+TimeWindow::onCycloAnalysis(void)
+{
+  qint64 start = 0;
+  qint64 end = static_cast<qint64>(this->getDisplayDataLength());
+
+  if (!this->ui->realWaveform->isComplete())
+    return;
+
+  if (this->ui->transSelCheck->isChecked()
+      && this->ui->realWaveform->getHorizontalSelectionPresent()) {
+    start = std::max<qint64>(
+          0,
+          static_cast<qint64>(
+            this->ui->realWaveform->getHorizontalSelectionStart()));
+    end   = std::min<qint64>(
+          end,
+          static_cast<qint64>(
+            this->ui->realWaveform->getHorizontalSelectionEnd()));
+  }
+
+  if (end <= start)
+    return;
+
+  this->cyclicStart  = start;
+  this->cyclicLength = static_cast<size_t>(end - start);
+
+  this->cyclicDialog->setSampleRate(this->fs);
+  this->cyclicDialog->setPalette(
+        SigDiggerHelpers::instance()->getPalette(this->getPalette()));
+  this->cyclicDialog->show();
+  this->cyclicDialog->raise();
+
+  this->onComputeCyclicSpectrum();
+}
+
+void
+TimeWindow::onComputeCyclicSpectrum(void)
+{
+  unsigned int channels = this->cyclicDialog->getChannels();
+  unsigned int frames = this->cyclicDialog->getFrames();
+  std::shared_ptr<CyclicSpectrumResult> result;
+  CyclicSpectrumTask *task;
+
+  if (this->taskRunning || this->cyclicLength == 0)
+    return;
+
+  if (this->cyclicSpectrum
+      && this->cyclicSpectrum->matches(
+        channels,
+        frames,
+        this->cyclicStart,
+        this->cyclicLength)) {
+    this->cyclicDialog->setResult(this->cyclicSpectrum);
+    return;
+  }
+
+  result = std::make_shared<CyclicSpectrumResult>(
+        channels,
+        frames,
+        this->cyclicStart,
+        this->cyclicLength);
+
+  if (result->blocks == 0) {
     QMessageBox::warning(
           this,
           "Cyclostationary analysis",
-          "Cannot perform operation: " + QString(e.what()));
+          "The selection is too short for this resolution. Try with fewer "
+          "channels or frames.");
+    return;
   }
+
+  task = new CyclicSpectrumTask(this->displayData, result);
+
+  this->pendingCyclicSpectrum = result;
+  this->cyclicDialog->setResult(result);
+
+  this->notifyTaskRunning(true);
+  this->taskController.process("cyclicSpectrum", task);
 }
 
 void
@@ -2006,8 +2986,15 @@ TimeWindow::onQuadDemod(void)
           len,
           this->ui->transSelCheck->isChecked());
 
-    QuadDemodTask *task = new QuadDemodTask(orig, dest, len);
+    TransformStep step;
+    step.kind = TransformStep::QUAD_DEMOD;
 
+    if (this->chainStep(step))
+      return;
+
+    QuadDemodTask *task = new QuadDemodTask(orig, dest, len, true);
+
+    this->recordTransform(std::vector<TransformStep>(1, step), dest, len);
     this->notifyTaskRunning(true);
     this->taskController.process("quadDemod", task);
   } catch (Suscan::Exception &e) {
@@ -2050,8 +3037,16 @@ TimeWindow::onAGC(void)
             "Automatic Gain Control",
             "Cannot perform automatic gain control: rate is faster than sample rate");
     } else {
+      TransformStep step;
+      step.kind = TransformStep::AGC;
+      step.tau = tau;
+
+      if (this->chainStep(step))
+        return;
+
       AGCTask *task = new AGCTask(orig, dest, len, tau);
 
+      this->recordTransform(std::vector<TransformStep>(1, step), dest, len);
       this->notifyTaskRunning(true);
       this->taskController.process("agc", task);
     }
@@ -2086,8 +3081,16 @@ TimeWindow::onLPF(void)
     if (bw >= 1.f)
       bw = 1;
 
+    TransformStep step;
+    step.kind = TransformStep::LPF;
+    step.bw = bw;
+
+    if (this->chainStep(step))
+      return;
+
     LPFTask *task = new LPFTask(orig, dest, len, bw);
 
+    this->recordTransform(std::vector<TransformStep>(1, step), dest, len);
     this->notifyTaskRunning(true);
     this->taskController.process("lpf", task);
   } catch (Suscan::Exception &e) {
@@ -2098,6 +3101,67 @@ TimeWindow::onLPF(void)
   }
 }
 
+void
+TimeWindow::onExtractChannel(void)
+{
+  qreal freq = this->ui->extractFreqSpin->value();
+  qreal bw = this->ui->extractBwSpin->value();
+  qreal rate = this->ui->extractRateSpin->value();
+  qint64 start = 0;
+  qint64 end = static_cast<qint64>(this->getDisplayDataLength());
+  ChannelExtractTask *task;
+
+  if (this->taskRunning || !this->ui->realWaveform->isComplete())
+    return;
+
+  if (rate <= 0 || rate >= this->fs || bw <= 0) {
+    QMessageBox::warning(
+          this,
+          "Extract channel",
+          "The output rate must be below the current sample rate, and the "
+          "bandwidth must be positive.");
+    return;
+  }
+
+  if (this->ui->transSelCheck->isChecked()
+      && this->ui->realWaveform->getHorizontalSelectionPresent()) {
+    start = std::max<qint64>(
+          0,
+          static_cast<qint64>(
+            this->ui->realWaveform->getHorizontalSelectionStart()));
+    end   = std::min<qint64>(
+          end,
+          static_cast<qint64>(
+            this->ui->realWaveform->getHorizontalSelectionEnd()));
+  }
+
+  if (end <= start)
+    return;
+
+  // The result replaces the capture: the history can't go across a change
+  // of sample rate
+  if (this->history.count() > 0
+      && QMessageBox::question(
+        this,
+        "Extract channel",
+        "The extracted channel will replace the current capture, and the "
+        "transform history will be lost. Continue?",
+        QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes)
+    return;
+
+  task = new ChannelExtractTask(
+        this->getDisplayData() + start,
+        static_cast<size_t>(end - start),
+        this->fs,
+        freq,
+        bw,
+        rate);
+
+  this->extractFreq = freq;
+  this->notifyTaskRunning(true);
+  this->taskController.process("extractChannel", task);
+}
+
 void
 TimeWindow::onDelayedConjugate(void)
 {
@@ -2131,8 +3195,16 @@ TimeWindow::onDelayedConjugate(void)
             "Product by the delayed conjugate",
             "Product by the delayed conjugate: rate is faster than sample rate");
     } else {
+      TransformStep step;
+      step.kind = TransformStep::DELAYED_CONJ;
+      step.delay = samples;
+
+      if (this->chainStep(step))
+        return;
+
       DelayedConjTask *task = new DelayedConjTask(orig, dest, len, samples);
 
+      this->recordTransform(std::vector<TransformStep>(1, step), dest, len);
       this->notifyTaskRunning(true);
       this->taskController.process("delayedConj", task);
     }
@@ -2144,6 +3216,120 @@ TimeWindow::onDelayedConjugate(void)
   }
 }
 
+void
+TimeWindow::onChainRun(void)
+{
+  if (!this->ui->realWaveform->isComplete() || this->chain.empty())
+    return;
+
+  try {
+    const SUCOMPLEX *orig = nullptr;
+    SUCOMPLEX *dest = nullptr;
+    SUSCOUNT len = 0;
+
+    this->getTransformRegion(
+          orig,
+          dest,
+          len,
+          this->ui->transSelCheck->isChecked());
+
+    TransformChainTask *task =
+        new TransformChainTask(orig, dest, len, this->chain);
+
+    this->recordTransform(this->chain, dest, len);
+    this->notifyTaskRunning(true);
+    this->taskController.process("transformChain", task);
+  } catch (Suscan::Exception &e) {
+    QMessageBox::warning(
+          this,
+          "Transform chain",
+          "Cannot perform operation: " + QString(e.what()));
+  }
+}
+
+void
+TimeWindow::onChainClear(void)
+{
+  this->chain.clear();
+  this->refreshChainLabel();
+}
+
+void
+TimeWindow::onChainBatch(void)
+{
+  QStringList inputs;
+  QStringList formats;
+  QString outputDir;
+  QString format;
+  BatchTransformTask *task;
+  bool ok = false;
+
+  if (this->chain.empty())
+    return;
+
+  inputs = QFileDialog::getOpenFileNames(
+        this,
+        "Run chain on captures",
+        QString(),
+        "Capture files (*.raw *.cf32 *"
+        SIGDIGGER_SEGMENTED_INDEX_EXTENSION
+        " *" SIGDIGGER_QUANTIZED_IQ_EXTENSION ");;Any (*)");
+
+  if (inputs.isEmpty())
+    return;
+
+  outputDir = QFileDialog::getExistingDirectory(
+        this,
+        "Save processed captures to");
+
+  if (outputDir.isEmpty())
+    return;
+
+  formats << "raw" << "wav" << "mat" << "m";
+#ifdef HAVE_ZSTD
+  formats << "zst";
+#endif // HAVE_ZSTD
+
+  format = QInputDialog::getItem(
+        this,
+        "Run chain on captures",
+        "Output format",
+        formats,
+        0,
+        false,
+        &ok);
+
+  if (!ok)
+    return;
+
+  // Steps are normalized to the sample rate: they mean the same thing for
+  // every capture. Raw files, which do not say, are assumed to be at ours.
+  task = new BatchTransformTask(
+        inputs,
+        outputDir,
+        format,
+        this->chain,
+        this->fs);
+
+  Suscan::Singleton::get_instance()->getBackgroundTaskController()->pushTask(
+        task,
+        "Run chain on " + QString::number(inputs.size()) + " captures");
+}
+
+void
+TimeWindow::onUndo(void)
+{
+  if (this->history.canUndo())
+    this->historySeek(this->history.position() - 1);
+}
+
+void
+TimeWindow::onRedo(void)
+{
+  if (this->history.canRedo())
+    this->historySeek(this->history.position() + 1);
+}
+
 void
 TimeWindow::onAGCRateChanged(void)
 {
@@ -22,6 +22,7 @@
 #include <AppConfig.h>
 #include <SuWidgetsHelpers.h>
 #include <Suscan/AnalyzerRequestTracker.h>
+#include <cmath>
 
 using namespace SigDigger;
 
@@ -142,9 +143,16 @@ AudioProcessor::closeAudio()
   assert(m_analyzer != nullptr);
 
   if (m_opening || m_opened) {
+    // Extra channels go first. They are reopened along with the main one.
+    for (auto &channel : m_channels)
+      this->closeChannel(channel);
+
     // Inspector opened: close it
-    if (m_audioInspectorOpened)
+    if (m_audioInspectorOpened) {
+      m_analyzer->unregisterSamplesRoute(m_audioInspId);
       m_analyzer->closeInspector(m_audioInspHandle);
+      m_playBack->removeChannel(m_audioInspId);
+    }
 
     if (!m_opened)
       m_tracker->cancelAll();
@@ -159,6 +167,12 @@ AudioProcessor::closeAudio()
   m_opened  = false;
   m_settingRate = false;
   m_audioInspectorOpened = false;
+  m_sent = InspectorState();
+
+  if (m_squelchOpen) {
+    m_squelchOpen = false;
+    emit squelchChanged(false);
+  }
 
   return true;
 }
@@ -166,9 +180,13 @@ AudioProcessor::closeAudio()
 SUFREQ
 AudioProcessor::calcTrueBandwidth()
 {
-  SUFREQ bw = m_bw;
+  return this->calcTrueBandwidth(m_bw, m_demod);
+}
 
-  if (m_demod == AudioDemod::USB || m_demod == AudioDemod::LSB)
+SUFREQ
+AudioProcessor::calcTrueBandwidth(SUFREQ bw, AudioDemod demod)
+{
+  if (demod == AudioDemod::USB || demod == AudioDemod::LSB)
     bw *= .5;
 
   if (bw > m_maxAudioBw)
@@ -181,16 +199,23 @@ AudioProcessor::calcTrueBandwidth()
 
 SUFREQ
 AudioProcessor::calcTrueLoFreq()
+{
+  return this->calcTrueLoFreq(m_lo, m_bw, m_demod);
+}
+
+SUFREQ
+AudioProcessor::calcTrueLoFreq(SUFREQ lo, SUFREQ bw, AudioDemod demod)
 {
   SUFREQ delta = 0;
-  SUFREQ bw = this->calcTrueBandwidth();
 
-  if (m_demod == AudioDemod::USB)
+  bw = this->calcTrueBandwidth(bw, demod);
+
+  if (demod == AudioDemod::USB)
     delta += .5 * bw;
-  else if (m_demod == AudioDemod::LSB)
+  else if (demod == AudioDemod::LSB)
     delta -= .5 * bw;
 
-  return m_lo + delta;
+  return lo + delta;
 }
 
 void
@@ -199,7 +224,14 @@ AudioProcessor::setTrueLoFreq()
   assert(m_analyzer != nullptr);
   assert(m_audioInspectorOpened);
 
-  m_analyzer->setInspectorFreq(m_audioInspHandle, this->calcTrueLoFreq());
+  SUFREQ lo = this->calcTrueLoFreq();
+
+  if (m_sent.haveLo && sufeq(m_sent.lo, lo, 1e-8f))
+    return;
+
+  m_analyzer->setInspectorFreq(m_audioInspHandle, lo);
+  m_sent.lo     = lo;
+  m_sent.haveLo = true;
 }
 
 void
@@ -208,18 +240,31 @@ AudioProcessor::setTrueBandwidth()
   assert(m_analyzer != nullptr);
   assert(m_audioInspectorOpened);
 
-  m_analyzer->setInspectorBandwidth(
-        m_audioInspHandle,
-        this->calcTrueBandwidth());
+  SUFREQ bw = this->calcTrueBandwidth();
+
+  if (m_sent.haveBw && sufeq(m_sent.bw, bw, 1e-8f))
+    return;
+
+  m_analyzer->setInspectorBandwidth(m_audioInspHandle, bw);
+  m_sent.bw     = bw;
+  m_sent.haveBw = true;
 }
 
-void
+bool
 AudioProcessor::setParams()
 {
   assert(m_audioCfgTemplate != nullptr);
   assert(m_analyzer != nullptr);
   assert(m_audioInspectorOpened);
 
+  if (m_sent.haveParams
+      && sufeq(m_sent.cutOff, m_cutOff, 1e-8f)
+      && m_sent.sampleRate == m_sampleRate
+      && m_sent.demod == m_demod
+      && m_sent.squelch == m_squelch
+      && sufeq(m_sent.squelchLevel, m_squelchLevel, 1e-8f))
+    return false;
+
   Suscan::Config cfg(m_audioCfgTemplate);
   cfg.set("audio.cutoff", m_cutOff);
   cfg.set("audio.volume", 1.f); // We handle this at UI level
@@ -230,6 +275,176 @@ AudioProcessor::setParams()
 
   // Set audio inspector parameters
   m_analyzer->setInspectorConfig(m_audioInspHandle, cfg);
+
+  m_sent.cutOff       = m_cutOff;
+  m_sent.sampleRate   = m_sampleRate;
+  m_sent.demod        = m_demod;
+  m_sent.squelch      = m_squelch;
+  m_sent.squelchLevel = m_squelchLevel;
+  m_sent.haveParams   = true;
+
+  return true;
+}
+
+///////////////////////////// Additional channels //////////////////////////////
+void
+AudioProcessor::setChannelParams(AudioChannel const &channel)
+{
+  assert(m_audioCfgTemplate != nullptr);
+  assert(m_analyzer != nullptr);
+  assert(channel.opened);
+
+  Suscan::Config cfg(m_audioCfgTemplate);
+  cfg.set("audio.cutoff", m_cutOff);
+  cfg.set("audio.volume", 1.f);
+  cfg.set("audio.sample-rate", SCAST(uint64_t, m_sampleRate));
+  cfg.set("audio.demodulator", SCAST(uint64_t, channel.demod + 1));
+  cfg.set("audio.squelch", channel.squelch);
+  cfg.set("audio.squelch-level", channel.squelchLevel);
+
+  m_analyzer->setInspectorConfig(channel.handle, cfg);
+}
+
+void
+AudioProcessor::setChannelFreq(AudioChannel const &channel)
+{
+  assert(m_analyzer != nullptr);
+  assert(channel.opened);
+
+  m_analyzer->setInspectorFreq(
+        channel.handle,
+        this->calcTrueLoFreq(channel.freq - m_tuner, channel.bw, channel.demod));
+}
+
+void
+AudioProcessor::openChannel(int id)
+{
+  auto it = m_channels.find(id);
+  Suscan::Channel ch;
+
+  if (it == m_channels.end() || it->opening || it->opened)
+    return;
+
+  ch.bw    = m_maxAudioBw;
+  ch.ft    = 0;
+  ch.fc    = this->calcTrueLoFreq(it->freq - m_tuner, it->bw, it->demod);
+  ch.fLow  = -.5 * m_maxAudioBw;
+  ch.fHigh = +.5 * m_maxAudioBw;
+
+  // The channel id travels with the request, so onOpened() can tell
+  // these apart from the main channel's
+  it->opening = m_tracker->requestOpen("audio", ch, QVariant(id));
+
+  if (!it->opening)
+    emit audioError("Internal Suscan error while opening audio channel");
+}
+
+void
+AudioProcessor::closeChannel(AudioChannel &channel)
+{
+  if (channel.opened) {
+    m_analyzer->unregisterSamplesRoute(channel.inspId);
+    m_analyzer->closeInspector(channel.handle);
+    m_playBack->removeChannel(channel.inspId);
+  }
+
+  channel.opening = false;
+  channel.opened  = false;
+  channel.handle  = -1;
+  channel.inspId  = 0xffffffff;
+}
+
+void
+AudioProcessor::onChannelOpened(Suscan::AnalyzerRequest const &req)
+{
+  auto it = m_channels.find(req.data.toInt());
+
+  if (m_analyzer == nullptr)
+    return;
+
+  // Removed (or audio closed) while the request was in flight
+  if (it == m_channels.end() || !it->opening || !m_opened) {
+    m_analyzer->closeInspector(req.handle);
+    return;
+  }
+
+  it->opening = false;
+  it->opened  = true;
+  it->handle  = req.handle;
+  it->inspId  = req.inspectorId;
+
+  m_playBack->setChannel(it->inspId, it->pan);
+  m_analyzer->registerSamplesRoute(
+        it->inspId,
+        this,
+        [this] (Suscan::SamplesMessage const &msg) {
+          m_playBack->write(msg);
+        });
+
+  m_analyzer->setInspectorBandwidth(
+        it->handle,
+        this->calcTrueBandwidth(it->bw, it->demod));
+  this->setChannelFreq(*it);
+  this->setChannelParams(*it);
+
+  m_analyzer->setInspectorWatermark(
+        it->handle,
+        PlaybackWorker::calcBufferSizeForRate(m_sampleRate) / 2);
+}
+
+int
+AudioProcessor::addChannel()
+{
+  AudioChannel channel;
+  int id;
+
+  if (m_playBack == nullptr)
+    return -1;
+
+  channel.freq         = m_tuner + m_lo;
+  channel.bw           = m_bw;
+  channel.demod        = m_demod;
+  channel.squelch      = m_squelch;
+  channel.squelchLevel = m_squelchLevel;
+
+  id = ++m_lastChannel;
+  m_channels[id] = channel;
+
+  if (m_opened)
+    this->openChannel(id);
+
+  return id;
+}
+
+void
+AudioProcessor::removeChannel(int id)
+{
+  auto it = m_channels.find(id);
+
+  if (it != m_channels.end()) {
+    this->closeChannel(*it);
+    m_channels.erase(it);
+  }
+}
+
+void
+AudioProcessor::setChannelPan(int id, SUFLOAT pan)
+{
+  if (id == 0) {
+    m_pan = pan;
+
+    if (m_audioInspectorOpened)
+      m_playBack->setChannel(m_audioInspId, pan);
+  } else {
+    auto it = m_channels.find(id);
+
+    if (it != m_channels.end()) {
+      it->pan = pan;
+
+      if (it->opened)
+        m_playBack->setChannel(it->inspId, pan);
+    }
+  }
 }
 
 void
@@ -246,12 +461,6 @@ AudioProcessor::connectAnalyzer()
         SIGNAL(inspector_message(const Suscan::InspectorMessage &)),
         this,
         SLOT(onInspectorMessage(const Suscan::InspectorMessage &)));
-
-  connect(
-        m_analyzer,
-        SIGNAL(samples_message(const Suscan::SamplesMessage &)),
-        this,
-        SLOT(onInspectorSamples(const Suscan::SamplesMessage &)));
 }
 
 void
@@ -380,8 +589,12 @@ AudioProcessor::setCorrectionEnabled(bool enabled)
   if (m_correctionEnabled != enabled) {
     m_correctionEnabled = enabled;
 
-    if (m_correctionEnabled && m_audioInspectorOpened)
-      m_analyzer->setInspectorDopplerCorrection(m_audioInspHandle, m_orbit);
+    if (m_audioInspectorOpened) {
+      if (m_correctionEnabled)
+        m_analyzer->setInspectorDopplerCorrection(m_audioInspHandle, m_orbit);
+      else
+        m_analyzer->disableDopplerCorrection(m_audioInspHandle);
+    }
   }
 }
 
@@ -412,13 +625,24 @@ AudioProcessor::setSampleRate(unsigned rate)
     m_sampleRate = rate;
 
     // We temptatively set the corresponding parameter and wait for its
-    // acknowledgment to call setSampleRate
+    // acknowledgment to change the rate the playback resamples from. The
+    // device itself keeps running at the rate it was opened with.
     if (m_audioInspectorOpened) {
-      m_settingRate = true;
-      this->setParams();
+      m_settingRate = this->setParams();
+      if (!m_settingRate)
+        m_playBack->setInputRate(rate);
       m_analyzer->setInspectorWatermark(
             m_audioInspHandle,
             PlaybackWorker::calcBufferSizeForRate(m_sampleRate) / 2);
+
+      for (auto &channel : m_channels) {
+        if (channel.opened) {
+          this->setChannelParams(channel);
+          m_analyzer->setInspectorWatermark(
+                channel.handle,
+                PlaybackWorker::calcBufferSizeForRate(m_sampleRate) / 2);
+        }
+      }
     } else {
       m_playBack->setSampleRate(rate);
     }
@@ -438,14 +662,23 @@ AudioProcessor::setCutOff(float cutOff)
 
     if (m_audioInspectorOpened)
       this->setParams();
+
+    for (auto &channel : m_channels)
+      if (channel.opened)
+        this->setChannelParams(channel);
   }
 }
 
 void
 AudioProcessor::setTunerFreq(SUFREQ tuner)
 {
-  // No need to signal anything
+  // No need to signal anything for the main channel. Extra channels are
+  // pinned to an absolute frequency and have to be moved.
   m_tuner = tuner;
+
+  for (auto &channel : m_channels)
+    if (channel.opened)
+      this->setChannelFreq(channel);
 }
 
 void
@@ -508,12 +741,30 @@ AudioProcessor::isOpened() const
   return m_opened;
 }
 
+bool
+AudioProcessor::isSquelchOpen() const
+{
+  return m_squelchOpen;
+}
+
 size_t
 AudioProcessor::getSaveSize() const
 {
   return m_audioFileSaver == nullptr ? 0 : m_audioFileSaver->getSize();
 }
 
+void
+AudioProcessor::setRecordMode(AudioFileSaver::RecordMode mode)
+{
+  m_recordMode = mode;
+}
+
+void
+AudioProcessor::setRecordFormat(AudioFileSaver::RecordFormat format)
+{
+  m_recordFormat = format;
+}
+
 bool
 AudioProcessor::startRecording(QString path)
 {
@@ -527,6 +778,8 @@ AudioProcessor::startRecording(QString path)
     params.savePath   = path.toStdString();
     params.frequency  = m_tuner + m_lo;
     params.modulation = m_demod;
+    params.mode       = m_recordMode;
+    params.format     = m_recordFormat;
 
     m_audioFileSaver = new AudioFileSaver(params, nullptr);
     this->connectAudioFileSaver();
@@ -558,6 +811,10 @@ AudioProcessor::onInspectorMessage(Suscan::InspectorMessage const &msg)
         // Async step 4: analyzer acknowledged config, emit audio open
         if (!m_opened) {
           m_opened = true;
+
+          for (auto it = m_channels.begin(); it != m_channels.end(); ++it)
+            this->openChannel(it.key());
+
           emit audioOpened();
         }
 
@@ -572,7 +829,7 @@ AudioProcessor::onInspectorMessage(Suscan::InspectorMessage const &msg)
           if (value != nullptr) {
             if (m_sampleRate == value->as_int) {
               m_settingRate = false;
-              m_playBack->setSampleRate(m_sampleRate);
+              m_playBack->setInputRate(m_sampleRate);
             }
           } else {
             // This should never happen, but just in case the server is not
@@ -614,11 +871,23 @@ AudioProcessor::onInspectorSamples(Suscan::SamplesMessage const &msg)
   if (m_opened && msg.getInspectorId() == m_audioInspId) {
     const SUCOMPLEX *samples = msg.getSamples();
     unsigned int count = msg.getCount();
+    bool open = !m_squelch;
+
+    // The audio inspector zeroes its output while the squelch is closed
+    for (unsigned int i = 0; !open && i < count; ++i)
+      open = std::fabs(SU_C_REAL(samples[i]))
+          >= SIGDIGGER_AUDIO_SAVER_SILENCE_LEVEL;
+
+    if (open != m_squelchOpen) {
+      m_squelchOpen = open;
+      emit squelchChanged(open);
+    }
 
-    m_playBack->write(samples, count);
+    // Conversion to audio happens in the playback feeder thread
+    m_playBack->write(msg);
 
     if (m_audioFileSaver != nullptr)
-      m_audioFileSaver->write(samples, count);
+      m_audioFileSaver->write(msg.getSamples(), msg.getCount());
   }
 }
 
@@ -626,6 +895,11 @@ AudioProcessor::onInspectorSamples(Suscan::SamplesMessage const &msg)
 void
 AudioProcessor::onOpened(Suscan::AnalyzerRequest const &req)
 {
+  if (req.data.isValid()) {
+    this->onChannelOpened(req);
+    return;
+  }
+
   // Async step 2: update state
   m_opening = false;
 
@@ -652,6 +926,16 @@ AudioProcessor::onOpened(Suscan::AnalyzerRequest const &req)
     m_audioInspHandle      = req.handle;
     m_audioInspId          = req.inspectorId;
     m_audioInspectorOpened = true;
+    m_sent = InspectorState();
+
+    // Registered first: the main channel clocks the mixer
+    m_playBack->setChannel(m_audioInspId, m_pan);
+    m_analyzer->registerSamplesRoute(
+          m_audioInspId,
+          this,
+          [this] (Suscan::SamplesMessage const &msg) {
+            this->onInspectorSamples(msg);
+          });
 
     this->setTrueBandwidth();
     this->setTrueLoFreq();
@@ -667,16 +951,34 @@ AudioProcessor::onOpened(Suscan::AnalyzerRequest const &req)
 }
 
 void
-AudioProcessor::onCancelled(Suscan::AnalyzerRequest const &)
+AudioProcessor::onCancelled(Suscan::AnalyzerRequest const &req)
 {
+  if (req.data.isValid()) {
+    auto it = m_channels.find(req.data.toInt());
+    if (it != m_channels.end())
+      it->opening = false;
+    return;
+  }
+
   m_opening = false;
   m_settingRate = false;
   m_playBack->stop();
 }
 
 void
-AudioProcessor::onError(Suscan::AnalyzerRequest const &, std::string const &err)
+AudioProcessor::onError(Suscan::AnalyzerRequest const &req, std::string const &err)
 {
+  if (req.data.isValid()) {
+    auto it = m_channels.find(req.data.toInt());
+    if (it != m_channels.end())
+      it->opening = false;
+
+    emit audioError(
+          "Failed to open additional audio channel: "
+          + QString::fromStdString(err));
+    return;
+  }
+
   m_opening = false;
   m_settingRate = false;
   m_playBack->stop();
@@ -20,6 +20,7 @@
 #define AUDIOPROCESSOR_H
 
 #include <QObject>
+#include <QMap>
 #include <Suscan/Library.h>
 #include <Suscan/Analyzer.h>
 #include <AudioFileSaver.h>
@@ -52,11 +53,34 @@ namespace SigDigger {
     bool            m_correctionEnabled = false;
     bool            m_squelch = false;
     SUFLOAT         m_squelchLevel;
+    bool            m_squelchOpen = false; // Main channel output not silent
     SUFREQ          m_bw = 2e5; // Hz
+    SUFLOAT         m_pan = 0;
+
+    // Additional channels, demodulated by inspectors of their own and mixed
+    // with the main one. Sample rate, cutoff and volume are shared.
+    struct AudioChannel {
+      SUFREQ          freq = 0; // Absolute, so they stay put on retune
+      SUFREQ          bw = 2e5;
+      AudioDemod      demod = AudioDemod::FM;
+      bool            squelch = false;
+      SUFLOAT         squelchLevel = 0;
+      SUFLOAT         pan = 0;
+
+      bool            opening = false;
+      bool            opened = false;
+      Suscan::Handle  handle = -1;
+      uint32_t        inspId = 0xffffffff;
+    };
+
+    QMap<int, AudioChannel> m_channels;
+    int             m_lastChannel = 0;
 
     // Composed objects
     AudioFileSaver *m_audioFileSaver = nullptr;
     QString         m_savedPath;
+    AudioFileSaver::RecordMode   m_recordMode = AudioFileSaver::RECORD_CONTINUOUS;
+    AudioFileSaver::RecordFormat m_recordFormat = AudioFileSaver::RECORD_FORMAT_WAV;
     AudioPlayback  *m_playBack = nullptr;
     Suscan::AnalyzerRequestTracker *m_tracker = nullptr;
     QString         m_audioError;
@@ -72,6 +96,23 @@ namespace SigDigger {
     bool              m_audioInspectorOpened = false;
     SUFREQ            m_maxAudioBw = 2e5; // Hz
 
+    // What the audio inspector was last told, so that settings that did
+    // not really change are not sent again
+    struct InspectorState {
+      bool          haveParams = false;
+      bool          haveLo = false;
+      bool          haveBw = false;
+      float         cutOff = 0;
+      unsigned int  sampleRate = 0;
+      AudioDemod    demod = AudioDemod::FM;
+      bool          squelch = false;
+      SUFLOAT       squelchLevel = 0;
+      SUFREQ        lo = 0;
+      SUFREQ        bw = 0;
+    };
+
+    InspectorState    m_sent;
+
     // Other references
     MainSpectrum     *m_spectrum = nullptr;
 
@@ -82,11 +123,19 @@ namespace SigDigger {
     void disconnectAnalyzer();
     bool openAudio();
     bool closeAudio();
-    void setParams();
+    bool setParams();
     void setTrueLoFreq();
     void setTrueBandwidth();
     SUFREQ calcTrueLoFreq();
     SUFREQ calcTrueBandwidth();
+    SUFREQ calcTrueLoFreq(SUFREQ lo, SUFREQ bw, AudioDemod demod);
+    SUFREQ calcTrueBandwidth(SUFREQ bw, AudioDemod demod);
+
+    void openChannel(int id);
+    void closeChannel(AudioChannel &);
+    void setChannelParams(AudioChannel const &);
+    void setChannelFreq(AudioChannel const &);
+    void onChannelOpened(Suscan::AnalyzerRequest const &);
 
   public:
     explicit AudioProcessor(UIMediator *, QObject *parent = nullptr);
@@ -107,16 +156,28 @@ namespace SigDigger {
 
     void setBandwidth(SUFREQ);
 
+    // Take effect on the next recording
+    void setRecordMode(AudioFileSaver::RecordMode);
+    void setRecordFormat(AudioFileSaver::RecordFormat);
+
+    // Pins the current demodulator settings as an additional channel.
+    // Returns its id (the main channel is 0), or -1 if audio is unavailable.
+    int  addChannel();
+    void removeChannel(int);
+    void setChannelPan(int, SUFLOAT);
+
     bool isAudioAvailable() const;
     QString getAudioError() const;
     bool isRecording() const;
     bool isOpened() const;
+    bool isSquelchOpen() const;
     size_t getSaveSize() const;
 
   signals:
     void audioClosed();
     void audioOpened();
     void audioError(QString);
+    void squelchChanged(bool);
 
     void recStopped();
     void recSwamped();
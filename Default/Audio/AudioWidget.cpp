@@ -31,6 +31,7 @@
 #include "AudioProcessor.h"
 #include <SuWidgetsHelpers.h>
 #include <MainSpectrum.h>
+#include <LoadGovernor.h>
 
 using namespace SigDigger;
 
@@ -42,6 +43,26 @@ static const unsigned int supportedRates[] = {
   48000,
   192000};
 
+// Item data of the channel combo: channel id and pan
+#define CHANNEL_ID_ROLE  Qt::UserRole
+#define CHANNEL_PAN_ROLE (Qt::UserRole + 1)
+
+// Config names of the recording modes and formats, in enum order
+static const char *recordModeNames[] = {"continuous", "gated", "split"};
+static const char *recordFormatNames[] = {"wav", "flac", "opus"};
+static const char *scanSourceNames[] = {"bookmarks", "passband"};
+
+template <size_t N>
+static int
+nameToIndex(const char *(&names)[N], std::string const &name)
+{
+  for (size_t i = 0; i < N; ++i)
+    if (name == names[i])
+      return static_cast<int>(i);
+
+  return 0;
+}
+
 #define STRINGFY(x) #x
 #define STORE(field) obj.set(STRINGFY(field), this->field)
 #define LOAD(field) this->field = conf.get(STRINGFY(field), this->field)
@@ -69,6 +90,8 @@ AudioWidgetConfig::deserialize(Suscan::Object const &conf)
   LOAD(cutOff);
   LOAD(volume);
   LOAD(savePath);
+  LOAD(recordMode);
+  LOAD(recordFormat);
   LOAD(squelch);
   LOAD(amSquelch);
   LOAD(ssbSquelch);
@@ -76,6 +99,10 @@ AudioWidgetConfig::deserialize(Suscan::Object const &conf)
   LOAD(isSatellite);
   LOAD(satName);
   LOAD(tleData);
+  LOAD(scanSource);
+  LOAD(scanRate);
+  LOAD(scanHang);
+  LOAD(scanThreshold);
 }
 
 Suscan::Object &&
@@ -92,6 +119,8 @@ AudioWidgetConfig::serialize(void)
   STORE(cutOff);
   STORE(volume);
   STORE(savePath);
+  STORE(recordMode);
+  STORE(recordFormat);
   STORE(squelch);
   STORE(amSquelch);
   STORE(ssbSquelch);
@@ -99,6 +128,10 @@ AudioWidgetConfig::serialize(void)
   STORE(isSatellite);
   STORE(satName);
   STORE(tleData);
+  STORE(scanSource);
+  STORE(scanRate);
+  STORE(scanHang);
+  STORE(scanThreshold);
 
   return this->persist(obj);
 }
@@ -115,6 +148,7 @@ AudioWidget::AudioWidget(
   ui->setupUi(this);
 
   m_processor = new AudioProcessor(mediator, this);
+  m_scanner   = new ChannelScanner(mediator, this);
   m_spectrum  = mediator->getMainSpectrum();
 
   this->setRecordSavePath(QDir::currentPath().toStdString());
@@ -124,6 +158,10 @@ AudioWidget::AudioWidget(
       this->demodFreq,
       this->colorConfig);
 
+  this->ui->channelCombo->addItem("Tuned channel");
+  this->ui->channelCombo->setItemData(0, 0, CHANNEL_ID_ROLE);
+  this->ui->channelCombo->setItemData(0, 0, CHANNEL_PAN_ROLE);
+
   this->assertConfig();
   this->populateRates();
   this->connectAll();
@@ -222,6 +260,42 @@ AudioWidget::connectAll(void)
         this,
         SLOT(onOpenDopplerSettings(void)));
 
+  connect(
+        this->ui->recordModeCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onRecordModeChanged(void)));
+
+  connect(
+        this->ui->recordFormatCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onRecordFormatChanged(void)));
+
+  connect(
+        this->ui->pinChannelButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onPinChannel(void)));
+
+  connect(
+        this->ui->unpinChannelButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onUnpinChannel(void)));
+
+  connect(
+        this->ui->channelCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onChannelSelected(void)));
+
+  connect(
+        this->ui->panSlider,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onPanChanged(void)));
+
   connect(
         this->fcDialog,
         SIGNAL(accepted()),
@@ -275,6 +349,54 @@ AudioWidget::connectAll(void)
         SIGNAL(audioError(QString)),
         this,
         SLOT(onAudioError(QString)));
+
+  this->connect(
+        m_processor,
+        SIGNAL(squelchChanged(bool)),
+        m_scanner,
+        SLOT(onSquelchChanged(bool)));
+
+  connect(
+        this->ui->scanButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onScanToggled(void)));
+
+  connect(
+        this->ui->scanSourceCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onScanParamsChanged(void)));
+
+  connect(
+        this->ui->scanRateSpin,
+        SIGNAL(valueChanged(double)),
+        this,
+        SLOT(onScanParamsChanged(void)));
+
+  connect(
+        this->ui->scanHangSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onScanParamsChanged(void)));
+
+  connect(
+        this->ui->scanThresholdSpin,
+        SIGNAL(valueChanged(double)),
+        this,
+        SLOT(onScanParamsChanged(void)));
+
+  connect(
+        m_scanner,
+        SIGNAL(stateChanged(void)),
+        this,
+        SLOT(onScannerStateChanged(void)));
+
+  connect(
+        m_scanner,
+        SIGNAL(channelChanged(void)),
+        this,
+        SLOT(onScannerChannelChanged(void)));
 }
 
 bool
@@ -301,7 +423,18 @@ AudioWidget::refreshUi(void)
   this->ui->cutoffSlider->setEnabled(shouldOpenAudio);
   this->ui->recordStartStopButton->setEnabled(shouldOpenAudio);
 
+  // Mode and format are fixed for the duration of a recording
+  this->ui->recordModeCombo->setEnabled(!recording);
+  this->ui->recordFormatCombo->setEnabled(!recording);
+
+  this->ui->pinChannelButton->setEnabled(shouldOpenAudio);
+  this->ui->unpinChannelButton->setEnabled(this->getSelectedChannel() != 0);
+  this->ui->panSlider->setEnabled(shouldOpenAudio);
+
   this->ui->sqlButton->setEnabled(shouldOpenAudio);
+
+  // Without audio, the scanner dwells on PSD activity alone
+  m_scanner->setSquelchEnabled(shouldOpenAudio && this->panelConfig->squelch);
   this->ui->sqlLevelSpin->setEnabled(
         shouldOpenAudio && this->getDemod() != AudioDemod::FM);
 
@@ -369,6 +502,12 @@ AudioWidget::setDiskUsage(qreal usage)
 
 
 // Getters
+int
+AudioWidget::getSelectedChannel(void) const
+{
+  return this->ui->channelCombo->currentData(CHANNEL_ID_ROLE).toInt();
+}
+
 SUFLOAT
 AudioWidget::getBandwidth(void) const
 {
@@ -468,6 +607,20 @@ AudioWidget::getRecordSavePath(void) const
   return this->ui->savePath->text().toStdString();
 }
 
+AudioFileSaver::RecordMode
+AudioWidget::getRecordMode(void) const
+{
+  return static_cast<AudioFileSaver::RecordMode>(
+        this->ui->recordModeCombo->currentIndex());
+}
+
+AudioFileSaver::RecordFormat
+AudioWidget::getRecordFormat(void) const
+{
+  return static_cast<AudioFileSaver::RecordFormat>(
+        this->ui->recordFormatCombo->currentIndex());
+}
+
 // Setters
 void
 AudioWidget::setSampleRate(unsigned int rate)
@@ -592,6 +745,73 @@ AudioWidget::refreshDiskUsage(void)
 }
 
 
+void
+AudioWidget::setRecordMode(AudioFileSaver::RecordMode mode)
+{
+  this->panelConfig->recordMode = recordModeNames[mode];
+  this->ui->recordModeCombo->setCurrentIndex(static_cast<int>(mode));
+
+  m_processor->setRecordMode(mode);
+}
+
+void
+AudioWidget::setRecordFormat(AudioFileSaver::RecordFormat format)
+{
+  this->panelConfig->recordFormat = recordFormatNames[format];
+  this->ui->recordFormatCombo->setCurrentIndex(static_cast<int>(format));
+
+  m_processor->setRecordFormat(format);
+}
+
+void
+AudioWidget::setScannerParams(void)
+{
+  m_scanner->setSource(
+        static_cast<ChannelScanner::Source>(
+          this->ui->scanSourceCombo->currentIndex()));
+  m_scanner->setRate(this->ui->scanRateSpin->value());
+  m_scanner->setHangTime(
+        static_cast<unsigned int>(this->ui->scanHangSpin->value()));
+  m_scanner->setThreshold(
+        static_cast<SUFLOAT>(this->ui->scanThresholdSpin->value()));
+}
+
+void
+AudioWidget::refreshScannerState(void)
+{
+  BookmarkInfo const *current = m_scanner->getCurrentChannel();
+  QString channel;
+
+  this->ui->scanButton->setChecked(m_scanner->isRunning());
+  this->ui->scanSourceCombo->setEnabled(!m_scanner->isRunning());
+
+  if (current != nullptr)
+    channel = current->name.isEmpty()
+        ? SuWidgetsHelpers::formatQuantity(current->frequency, "Hz")
+        : current->name;
+
+  switch (m_scanner->getState()) {
+    case ChannelScanner::IDLE:
+      this->ui->scanStatusLabel->setText("Idle");
+      break;
+
+    case ChannelScanner::SCANNING:
+      this->ui->scanStatusLabel->setText(
+            QString("%1 channels, %2 ch/s")
+            .arg(m_scanner->getChannelCount())
+            .arg(m_scanner->getChannelsPerSecond(), 0, 'f', 1));
+      break;
+
+    case ChannelScanner::SETTLING:
+      this->ui->scanStatusLabel->setText("Checking " + channel);
+      break;
+
+    case ChannelScanner::DWELLING:
+      this->ui->scanStatusLabel->setText("Listening to " + channel);
+      break;
+  }
+}
+
 void
 AudioWidget::setRecordSavePath(std::string const &path)
 {
@@ -629,6 +849,25 @@ AudioWidget::applyConfig(void)
   if (this->panelConfig->savePath.size() > 0)
     this->setRecordSavePath(this->panelConfig->savePath);
 
+  this->setRecordMode(
+        static_cast<AudioFileSaver::RecordMode>(
+          nameToIndex(recordModeNames, this->panelConfig->recordMode)));
+  this->setRecordFormat(
+        static_cast<AudioFileSaver::RecordFormat>(
+          nameToIndex(recordFormatNames, this->panelConfig->recordFormat)));
+
+  // Scanner. Every spin box updates the config, read it first.
+  int scanSource = nameToIndex(scanSourceNames, this->panelConfig->scanSource);
+  qreal scanRate = static_cast<qreal>(this->panelConfig->scanRate);
+  int scanHang = static_cast<int>(this->panelConfig->scanHang);
+  qreal scanThreshold = static_cast<qreal>(this->panelConfig->scanThreshold);
+
+  this->ui->scanSourceCombo->setCurrentIndex(scanSource);
+  this->ui->scanRateSpin->setValue(scanRate);
+  this->ui->scanHangSpin->setValue(scanHang);
+  this->ui->scanThresholdSpin->setValue(scanThreshold);
+  this->setScannerParams();
+
   // Update processor parameters
   m_processor->setBandwidth(SCAST(SUFREQ, m_spectrum->getBandwidth()));
   m_processor->setLoFreq(SCAST(SUFREQ, m_spectrum->getLoFreq()));
@@ -658,14 +897,18 @@ AudioWidget::setState(int state, Suscan::Analyzer *analyzer)
 
     connect(
           analyzer,
-          SIGNAL(source_info_message(const Suscan::SourceInfoMessage &)),
+          SIGNAL(psd_message(const Suscan::PSDMessage &)),
           this,
-          SLOT(onSourceInfoMessage(const Suscan::SourceInfoMessage &)));
+          SLOT(onPSDMessage(const Suscan::PSDMessage &)));
 
     this->refreshUi();
   }
 
+  if (analyzer == nullptr)
+    m_scanner->stop();
+
   m_analyzer = analyzer;
+  this->ui->scanButton->setEnabled(analyzer != nullptr);
 
   if (state != m_state)
     m_state = state;
@@ -674,6 +917,26 @@ AudioWidget::setState(int state, Suscan::Analyzer *analyzer)
     m_processor->setAnalyzer(analyzer);
 }
 
+void
+AudioWidget::setSourceInfo(Suscan::AnalyzerSourceInfo const &info, unsigned int)
+{
+  if (m_analyzer != nullptr && !m_haveSourceInfo) {
+    m_audioAllowed =
+        info.testPermission(SUSCAN_ANALYZER_PERM_OPEN_AUDIO);
+
+    if (m_audioAllowed) {
+      // We do not update processor parameters until source info is available
+      m_processor->setBandwidth(SCAST(SUFREQ, m_spectrum->getBandwidth()));
+      m_processor->setLoFreq(SCAST(SUFREQ, m_spectrum->getLoFreq()));
+      m_processor->setTunerFreq(SCAST(SUFREQ, m_spectrum->getCenterFreq()));
+      m_processor->setAnalyzer(m_analyzer);
+    }
+
+    m_haveSourceInfo = true;
+    this->refreshUi();
+  }
+}
+
 void
 AudioWidget::setQth(Suscan::Location const &qth)
 {
@@ -857,6 +1120,18 @@ AudioWidget::onRecordStartStop(void)
   this->refreshUi();
 }
 
+void
+AudioWidget::onRecordModeChanged(void)
+{
+  this->setRecordMode(this->getRecordMode());
+}
+
+void
+AudioWidget::onRecordFormatChanged(void)
+{
+  this->setRecordFormat(this->getRecordFormat());
+}
+
 void
 AudioWidget::onToggleSquelch(void)
 {
@@ -886,6 +1161,121 @@ AudioWidget::onOpenDopplerSettings(void)
   }
 }
 
+void
+AudioWidget::onPinChannel(void)
+{
+  qint64 freq = m_spectrum->getCenterFreq() + m_spectrum->getLoFreq();
+  int id = m_processor->addChannel();
+  int index;
+
+  if (id < 0)
+    return;
+
+  index = this->ui->channelCombo->count();
+  this->ui->channelCombo->addItem(
+        SuWidgetsHelpers::formatQuantity(freq, "Hz")
+        + " ("
+        + this->ui->demodCombo->currentText()
+        + ")");
+  this->ui->channelCombo->setItemData(index, id, CHANNEL_ID_ROLE);
+  this->ui->channelCombo->setItemData(index, 0, CHANNEL_PAN_ROLE);
+  this->ui->channelCombo->setCurrentIndex(index);
+
+  this->onChannelSelected();
+}
+
+void
+AudioWidget::onUnpinChannel(void)
+{
+  int id = this->getSelectedChannel();
+
+  // The tuned channel cannot be unpinned
+  if (id == 0)
+    return;
+
+  m_processor->removeChannel(id);
+  this->ui->channelCombo->removeItem(this->ui->channelCombo->currentIndex());
+
+  this->onChannelSelected();
+}
+
+void
+AudioWidget::onChannelSelected(void)
+{
+  int pan = this->ui->channelCombo->currentData(CHANNEL_PAN_ROLE).toInt();
+  bool blocking = this->ui->panSlider->blockSignals(true);
+
+  this->ui->panSlider->setValue(pan);
+  this->ui->panSlider->blockSignals(blocking);
+
+  this->onPanChanged();
+  this->refreshUi();
+}
+
+void
+AudioWidget::onPanChanged(void)
+{
+  int pan = this->ui->panSlider->value();
+
+  this->ui->channelCombo->setItemData(
+        this->ui->channelCombo->currentIndex(),
+        pan,
+        CHANNEL_PAN_ROLE);
+
+  if (pan == 0)
+    this->ui->panLabel->setText("Center");
+  else
+    this->ui->panLabel->setText(
+          QString::number(qAbs(pan)) + (pan < 0 ? "% L" : "% R"));
+
+  m_processor->setChannelPan(
+        this->getSelectedChannel(),
+        SCAST(SUFLOAT, pan) / 100);
+}
+
+void
+AudioWidget::onScanToggled(void)
+{
+  if (this->ui->scanButton->isChecked()) {
+    this->setScannerParams();
+    m_scanner->start();
+  } else {
+    m_scanner->stop();
+  }
+
+  this->refreshScannerState();
+}
+
+void
+AudioWidget::onScanParamsChanged(void)
+{
+  this->panelConfig->scanSource =
+      scanSourceNames[this->ui->scanSourceCombo->currentIndex()];
+  this->panelConfig->scanRate =
+      static_cast<SUFLOAT>(this->ui->scanRateSpin->value());
+  this->panelConfig->scanHang =
+      static_cast<unsigned int>(this->ui->scanHangSpin->value());
+  this->panelConfig->scanThreshold =
+      static_cast<SUFLOAT>(this->ui->scanThresholdSpin->value());
+
+  this->setScannerParams();
+}
+
+void
+AudioWidget::onScannerStateChanged(void)
+{
+  this->refreshScannerState();
+}
+
+void
+AudioWidget::onScannerChannelChanged(void)
+{
+  // Filter bandwidth changes made by the scanner are not signalled by
+  // the spectrum. The LO is.
+  this->onSpectrumBandwidthChanged();
+  this->refreshScannerState();
+}
+
 void
 AudioWidget::onAcceptCorrectionSetting(void)
 {
@@ -952,6 +1342,8 @@ AudioWidget::onAudioSaveError(void)
 void
 AudioWidget::onAudioSaveSwamped(void)
 {
+  LoadGovernor::notifySwamp();
+
   this->refreshUi();
 
   QMessageBox::warning(
@@ -975,23 +1367,9 @@ AudioWidget::onAudioCommit(void)
 }
 
 void
-AudioWidget::onSourceInfoMessage(Suscan::SourceInfoMessage const &msg)
+AudioWidget::onPSDMessage(Suscan::PSDMessage const &msg)
 {
-  if (!m_haveSourceInfo) {
-    m_audioAllowed =
-        msg.info()->testPermission(SUSCAN_ANALYZER_PERM_OPEN_AUDIO);
-
-    if (m_audioAllowed) {
-      // We do not update processor parameters until source info is available
-      m_processor->setBandwidth(SCAST(SUFREQ, m_spectrum->getBandwidth()));
-      m_processor->setLoFreq(SCAST(SUFREQ, m_spectrum->getLoFreq()));
-      m_processor->setTunerFreq(SCAST(SUFREQ, m_spectrum->getCenterFreq()));
-      m_processor->setAnalyzer(m_analyzer);
-    }
-
-    m_haveSourceInfo = true;
-    this->refreshUi();
-  }
+  m_scanner->feedPSD(msg);
 }
 
 ////////////////// TODO: implement onJumpToBookmark ////////////////////////////
@@ -22,6 +22,7 @@
 #include <ToolWidgetFactory.h>
 #include <ColorConfig.h>
 #include <AudioFileSaver.h>
+#include "ChannelScanner.h"
 
 namespace Ui {
   class AudioPanel;
@@ -39,6 +40,8 @@ namespace SigDigger {
     bool collapsed = false;
     std::string demod;
     std::string savePath;
+    std::string recordMode = "continuous";
+    std::string recordFormat = "wav";
     unsigned int rate   = 44100;
     SUFLOAT cutOff      = 15000;
     SUFLOAT volume      = -6;
@@ -52,6 +55,11 @@ namespace SigDigger {
     std::string satName = "ISS (ZARYA)";
     std::string tleData = "";
 
+    std::string scanSource = "bookmarks";
+    SUFLOAT scanRate    = SIGDIGGER_SCANNER_DEFAULT_RATE;
+    unsigned int scanHang = SIGDIGGER_SCANNER_DEFAULT_HANG_MS;
+    SUFLOAT scanThreshold = SIGDIGGER_SCANNER_DEFAULT_THRESHOLD;
+
     // Overriden methods
     void deserialize(Suscan::Object const &conf) override;
     Suscan::Object &&serialize() override;
@@ -71,6 +79,7 @@ namespace SigDigger {
 
     // Processing members
     AudioProcessor *m_processor  = nullptr;
+    ChannelScanner *m_scanner    = nullptr;
     Suscan::Analyzer *m_analyzer = nullptr; // Borrowed
     bool m_haveSourceInfo = false;
     bool m_audioAllowed = true;
@@ -86,6 +95,7 @@ namespace SigDigger {
     void connectAll();
     void populateRates();
     void refreshUi();
+    int  getSelectedChannel() const;
 
     // Private setters
     void setBandwidth(SUFLOAT);
@@ -107,6 +117,12 @@ namespace SigDigger {
     void setCaptureSize(quint64);
     void setIORate(qreal);
     void setRecordState(bool state);
+    void setRecordMode(AudioFileSaver::RecordMode);
+    void setRecordFormat(AudioFileSaver::RecordFormat);
+
+    // Scanner
+    void setScannerParams();
+    void refreshScannerState();
 
     // Private getters
     SUFLOAT getBandwidth() const;
@@ -124,6 +140,8 @@ namespace SigDigger {
     Suscan::Orbit getOrbit() const;
     bool getRecordState(void) const;
     std::string getRecordSavePath(void) const;
+    AudioFileSaver::RecordMode getRecordMode(void) const;
+    AudioFileSaver::RecordFormat getRecordFormat(void) const;
 
   public:
     AudioWidget(AudioWidgetFactory *, UIMediator *, QWidget *parent = nullptr);
@@ -140,6 +158,9 @@ namespace SigDigger {
     void setColorConfig(ColorConfig const &) override;
     void setTimeStamp(struct timeval const &) override;
     void setProfile(Suscan::Source::Config &) override;
+    void setSourceInfo(
+        Suscan::AnalyzerSourceInfo const &,
+        unsigned int changes) override;
 
   public slots:
     void onSpectrumBandwidthChanged(void);
@@ -156,9 +177,21 @@ namespace SigDigger {
     void onAcceptCorrectionSetting();
     void onChangeSavePath();
     void onRecordStartStop();
+    void onRecordModeChanged();
+    void onRecordFormatChanged();
     void onToggleSquelch();
     void onSquelchLevelChanged();
     void onOpenDopplerSettings();
+    void onPinChannel();
+    void onUnpinChannel();
+    void onChannelSelected();
+    void onPanChanged();
+
+    // Scanner
+    void onScanToggled();
+    void onScanParamsChanged();
+    void onScannerStateChanged();
+    void onScannerChannelChanged();
 
     // Notifications
     void onSetTLE(Suscan::InspectorMessage const &);
@@ -174,7 +207,7 @@ namespace SigDigger {
     void onAudioCommit(void);
 
     // Analyzer slots
-    void onSourceInfoMessage(Suscan::SourceInfoMessage const &);
+    void onPSDMessage(Suscan::PSDMessage const &);
   };
 }
 
@@ -0,0 +1,410 @@
+//
+//    ChannelScanner.cpp: Bookmark and passband channel scanner
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "ChannelScanner.h"
+#include <UIMediator.h>
+#include <MainSpectrum.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace SigDigger;
+
+ChannelScanner::ChannelScanner(UIMediator *mediator, QObject *parent) :
+  QObject(parent),
+  m_mediator(mediator),
+  m_spectrum(mediator->getMainSpectrum())
+{
+  this->setRate(m_rate);
+
+  connect(
+        &m_timer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onTimeout(void)));
+}
+
+void
+ChannelScanner::setSource(Source source)
+{
+  if (m_source != source) {
+    m_source = source;
+    m_channels.clear();
+    m_current = -1;
+  }
+}
+
+void
+ChannelScanner::setRate(qreal rate)
+{
+  if (rate <= 0)
+    rate = SIGDIGGER_SCANNER_DEFAULT_RATE;
+
+  m_rate = rate;
+  m_timer.setInterval(std::max(1, qRound(1e3 / rate)));
+}
+
+void
+ChannelScanner::setHangTime(unsigned int ms)
+{
+  m_hangMs = ms;
+}
+
+void
+ChannelScanner::setThreshold(SUFLOAT threshold)
+{
+  m_threshold = threshold;
+}
+
+void
+ChannelScanner::setSquelchEnabled(bool enabled)
+{
+  m_squelchEnabled = enabled;
+}
+
+void
+ChannelScanner::start()
+{
+  if (this->isRunning())
+    return;
+
+  // Picks up bookmark and passband changes made while stopped
+  m_channels.clear();
+  m_checked = 0;
+  m_channelsPerSecond = 0;
+  m_statsTimer.start();
+  m_timer.start();
+
+  this->setState(SCANNING);
+}
+
+void
+ChannelScanner::stop()
+{
+  m_timer.stop();
+  m_awaitingPsd = false;
+  m_psdValid = false;
+
+  this->setState(IDLE);
+}
+
+void
+ChannelScanner::feedPSD(Suscan::PSDMessage const &msg)
+{
+  const SUFLOAT *data = msg.get();
+  SUSCOUNT size = msg.size();
+
+  if (m_state == IDLE || size == 0)
+    return;
+
+  // Still the spectrum of the frequency we left
+  if (m_awaitingPsd) {
+    if (sufeq(msg.getFrequency(), m_stalePsdFreq, 1))
+      return;
+    m_awaitingPsd = false;
+  }
+
+  m_psd.resize(size);
+  for (SUSCOUNT i = 0; i < size; ++i)
+    m_psd[i] = SU_POWER_DB(data[i]);
+
+  // The median bin is a good enough noise floor for sparse bands
+  m_sorted = m_psd;
+  std::nth_element(
+        m_sorted.begin(),
+        m_sorted.begin() + size / 2,
+        m_sorted.end());
+
+  m_psdFloor = m_sorted[size / 2];
+  m_psdRate  = msg.getSampleRate();
+  m_psdFreq  = msg.getFrequency();
+  m_psdValid = m_psdRate > 0;
+}
+
+bool
+ChannelScanner::isRunning() const
+{
+  return m_state != IDLE;
+}
+
+ChannelScanner::State
+ChannelScanner::getState() const
+{
+  return m_state;
+}
+
+qreal
+ChannelScanner::getChannelsPerSecond() const
+{
+  return m_channelsPerSecond;
+}
+
+int
+ChannelScanner::getChannelCount() const
+{
+  return m_channels.size();
+}
+
+BookmarkInfo const *
+ChannelScanner::getCurrentChannel() const
+{
+  if (m_current < 0 || m_current >= m_channels.size())
+    return nullptr;
+
+  return &m_channels[m_current];
+}
+
+///////////////////////////// Private methods /////////////////////////////////
+void
+ChannelScanner::refreshChannels()
+{
+  if (m_source == BOOKMARKS) {
+    Suscan::Singleton *sus = Suscan::Singleton::get_instance();
+    quint64 revision = sus->getBookmarkRevision();
+
+    if (revision == m_bookmarkRevision && !m_channels.isEmpty())
+      return;
+
+    m_bookmarkRevision = revision;
+    m_channels.clear();
+
+    for (auto const &bm : sus->getBookmarkMap())
+      m_channels.push_back(bm.info);
+  } else {
+    qint64 center = m_spectrum->getCenterFreq();
+    unsigned int bw = m_spectrum->getBandwidth();
+    qreal half = .5 * m_psdRate * SIGDIGGER_SCANNER_PASSBAND_MARGIN;
+
+    if (center == m_passbandCenter
+        && bw == m_passbandBw
+        && !m_channels.isEmpty())
+      return;
+
+    m_channels.clear();
+
+    if (bw == 0 || m_psdRate == 0)
+      return;
+
+    m_passbandCenter = center;
+    m_passbandBw = bw;
+
+    for (qreal f = -half + .5 * bw; f + .5 * bw <= half; f += bw) {
+      BookmarkInfo info;
+
+      info.frequency   = center + static_cast<qint64>(f);
+      info.lowFreqCut  = -static_cast<qint32>(bw / 2);
+      info.highFreqCut = +static_cast<qint32>(bw - bw / 2);
+      m_channels.push_back(info);
+    }
+  }
+
+  if (m_current >= m_channels.size())
+    m_current = -1;
+}
+
+bool
+ChannelScanner::inPassband(BookmarkInfo const &info) const
+{
+  qint64 offset;
+  qreal half;
+
+  if (!m_psdValid)
+    return false;
+
+  offset = info.frequency - m_spectrum->getCenterFreq();
+  half = .5 * m_psdRate * SIGDIGGER_SCANNER_PASSBAND_MARGIN;
+
+  return offset + info.lowFreqCut >= -half
+      && offset + info.highFreqCut <= +half;
+}
+
+// Peak of the channel bins, above the noise floor
+SUFLOAT
+ChannelScanner::channelLevel(BookmarkInfo const &info) const
+{
+  qreal offset = info.frequency - m_spectrum->getCenterFreq();
+  qreal binWidth = static_cast<qreal>(m_psdRate) / m_psd.size();
+  qreal low  = info.lowFreqCut;
+  qreal high = info.highFreqCut;
+  qint64 first, last;
+  SUFLOAT peak = -INFINITY;
+
+  if (high <= low) {
+    high = .5 * m_spectrum->getBandwidth();
+    low  = -high;
+  }
+
+  first = static_cast<qint64>(
+        std::floor((offset + low + .5 * m_psdRate) / binWidth));
+  last  = static_cast<qint64>(
+        std::ceil((offset + high + .5 * m_psdRate) / binWidth));
+
+  first = std::max<qint64>(first, 0);
+  last  = std::min<qint64>(last, static_cast<qint64>(m_psd.size()) - 1);
+
+  for (qint64 i = first; i <= last; ++i)
+    peak = std::max(peak, m_psd[static_cast<size_t>(i)]);
+
+  return peak - m_psdFloor;
+}
+
+bool
+ChannelScanner::isActive() const
+{
+  BookmarkInfo const *current = this->getCurrentChannel();
+
+  if (m_squelchEnabled)
+    return m_squelchOpen;
+
+  if (current == nullptr || !this->inPassband(*current))
+    return false;
+
+  return this->channelLevel(*current) >= m_threshold;
+}
+
+void
+ChannelScanner::tune(int index, bool retune)
+{
+  BookmarkInfo const &info = m_channels[index];
+  qint64 bw = info.highFreqCut - info.lowFreqCut;
+
+  m_current = index;
+
+  if (retune) {
+    // Same as jumping to the bookmark. The PSD is stale until the
+    // analyzer reports the new frequency.
+    m_stalePsdFreq = m_psdFreq;
+    m_psdValid = false;
+    m_awaitingPsd = true;
+    m_retuneTimer.start();
+    m_mediator->onJumpToBookmark(info);
+  } else {
+    m_spectrum->setLoFreq(info.frequency - m_spectrum->getCenterFreq());
+    if (bw > 0)
+      m_spectrum->setFilterBandwidth(static_cast<unsigned int>(bw));
+  }
+
+  emit channelChanged();
+
+  this->setState(SETTLING);
+}
+
+void
+ChannelScanner::countChecked(unsigned int count)
+{
+  qint64 elapsed = m_statsTimer.elapsed();
+
+  m_checked += count;
+
+  if (elapsed >= SIGDIGGER_SCANNER_STATS_MS) {
+    m_channelsPerSecond = 1e3 * m_checked / elapsed;
+    m_checked = 0;
+    m_statsTimer.restart();
+    emit stateChanged();
+  }
+}
+
+void
+ChannelScanner::setState(State state)
+{
+  if (m_state != state) {
+    m_state = state;
+    emit stateChanged();
+  }
+}
+
+//
+// Quiet channels in the passband are skipped right away. The hop ends on
+// the first channel that needs listening to, or retuning to.
+//
+void
+ChannelScanner::hop()
+{
+  int count;
+  unsigned int checked = 0;
+
+  this->refreshChannels();
+  count = m_channels.size();
+
+  for (int k = 1; k <= count; ++k) {
+    int index = (m_current + k) % count;
+    BookmarkInfo const &info = m_channels[index];
+
+    ++checked;
+
+    if (this->inPassband(info)) {
+      if (this->channelLevel(info) < m_threshold)
+        continue;
+
+      this->countChecked(checked);
+      this->tune(index, false);
+      return;
+    }
+
+    this->countChecked(checked);
+    this->tune(index, true);
+    return;
+  }
+
+  this->countChecked(checked);
+  this->setState(SCANNING);
+}
+
+/////////////////////////////////// Slots /////////////////////////////////////
+void
+ChannelScanner::onSquelchChanged(bool open)
+{
+  m_squelchOpen = open;
+
+  if (open && m_state == DWELLING)
+    m_lastActive.restart();
+}
+
+void
+ChannelScanner::onTimeout()
+{
+  if (m_awaitingPsd) {
+    if (m_retuneTimer.elapsed() < SIGDIGGER_SCANNER_RETUNE_TIMEOUT_MS)
+      return;
+    m_awaitingPsd = false;
+  }
+
+  switch (m_state) {
+    case IDLE:
+      break;
+
+    case SCANNING:
+      this->hop();
+      break;
+
+    case SETTLING:
+      if (this->isActive()) {
+        m_lastActive.start();
+        this->setState(DWELLING);
+      } else {
+        this->hop();
+      }
+      break;
+
+    case DWELLING:
+      if (this->isActive())
+        m_lastActive.restart();
+      else if (m_lastActive.elapsed() >= m_hangMs)
+        this->hop();
+      break;
+  }
+}
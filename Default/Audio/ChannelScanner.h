@@ -0,0 +1,151 @@
+//
+//    ChannelScanner.h: Bookmark and passband channel scanner
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef CHANNELSCANNER_H
+#define CHANNELSCANNER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
+#include <Suscan/Library.h>
+#include <Suscan/Messages/PSDMessage.h>
+#include <vector>
+
+#define SIGDIGGER_SCANNER_DEFAULT_RATE      10    // Hops per second
+#define SIGDIGGER_SCANNER_DEFAULT_HANG_MS   2000
+#define SIGDIGGER_SCANNER_DEFAULT_THRESHOLD 10    // dB above the noise floor
+
+// Channels closer to the edges of the passband than this (as a fraction of
+// half the sample rate) are retuned to, instead of checked in the PSD
+#define SIGDIGGER_SCANNER_PASSBAND_MARGIN   .9
+
+// Longest wait for the first PSD after a retune
+#define SIGDIGGER_SCANNER_RETUNE_TIMEOUT_MS 1000
+
+// Period over which the scanned channels per second are measured
+#define SIGDIGGER_SCANNER_STATS_MS          1000
+
+namespace SigDigger {
+  class UIMediator;
+  class MainSpectrum;
+
+  //
+  // Hops through a list of channels the way a hardware scanner does, and
+  // dwells on the first one showing activity until it has been quiet for
+  // the hang time. Channels within the current passband are checked in
+  // the last PSD without tuning to them: all the quiet ones are skipped
+  // in the same hop. Only the channels outside the passband (and those
+  // with energy, to listen to them) take a hop of their own.
+  //
+  // A channel is active while the audio squelch is open or, if the
+  // squelch is disabled, while its PSD is above the threshold.
+  //
+  class ChannelScanner : public QObject
+  {
+    Q_OBJECT
+
+  public:
+    enum Source {
+      BOOKMARKS, // Singleton bookmarks, retuning if necessary
+      PASSBAND   // Consecutive channels of the filter bandwidth
+    };
+
+    enum State {
+      IDLE,
+      SCANNING,
+      SETTLING,
+      DWELLING
+    };
+
+  private:
+    UIMediator   *m_mediator = nullptr;
+    MainSpectrum *m_spectrum = nullptr;
+    QTimer        m_timer;
+
+    Source        m_source = BOOKMARKS;
+    State         m_state = IDLE;
+    qreal         m_rate = SIGDIGGER_SCANNER_DEFAULT_RATE;
+    unsigned int  m_hangMs = SIGDIGGER_SCANNER_DEFAULT_HANG_MS;
+    SUFLOAT       m_threshold = SIGDIGGER_SCANNER_DEFAULT_THRESHOLD;
+    bool          m_squelchEnabled = false;
+    bool          m_squelchOpen = false;
+
+    // Channel list
+    QVector<BookmarkInfo> m_channels;
+    quint64       m_bookmarkRevision = 0;
+    qint64        m_passbandCenter = 0;
+    unsigned int  m_passbandBw = 0;
+    int           m_current = -1;
+    QElapsedTimer m_lastActive;
+
+    // Last PSD, in dB. Discarded on retune, until a new one arrives.
+    std::vector<SUFLOAT> m_psd;
+    std::vector<SUFLOAT> m_sorted;
+    SUFLOAT       m_psdFloor = 0;
+    unsigned int  m_psdRate = 0;
+    SUFREQ        m_psdFreq = 0;
+    SUFREQ        m_stalePsdFreq = 0;
+    bool          m_psdValid = false;
+    bool          m_awaitingPsd = false;
+    QElapsedTimer m_retuneTimer;
+
+    // Stats
+    QElapsedTimer m_statsTimer;
+    unsigned int  m_checked = 0;
+    qreal         m_channelsPerSecond = 0;
+
+    void refreshChannels();
+    bool inPassband(BookmarkInfo const &) const;
+    SUFLOAT channelLevel(BookmarkInfo const &) const;
+    bool isActive() const;
+    void tune(int index, bool retune);
+    void countChecked(unsigned int);
+    void setState(State);
+    void hop();
+
+  public:
+    ChannelScanner(UIMediator *, QObject *parent = nullptr);
+
+    void setSource(Source);
+    void setRate(qreal);
+    void setHangTime(unsigned int);
+    void setThreshold(SUFLOAT);
+    void setSquelchEnabled(bool);
+
+    void start();
+    void stop();
+    void feedPSD(Suscan::PSDMessage const &);
+
+    bool isRunning() const;
+    State getState() const;
+    qreal getChannelsPerSecond() const;
+    int getChannelCount() const;
+    BookmarkInfo const *getCurrentChannel() const;
+
+  signals:
+    void stateChanged();
+    void channelChanged(); // After the LO and bandwidth have been set
+
+  public slots:
+    void onSquelchChanged(bool open);
+    void onTimeout();
+  };
+}
+
+#endif // CHANNELSCANNER_H
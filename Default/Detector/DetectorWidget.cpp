@@ -0,0 +1,520 @@
+//
+//    Default/Detector/DetectorWidget.cpp: Emission detector tool
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "DetectorWidgetFactory.h"
+#include "DetectorWidget.h"
+#include <QApplication>
+#include <QDateTime>
+#include <QEvent>
+#include <SuWidgetsHelpers.h>
+#include <UIMediator.h>
+#include <MainSpectrum.h>
+#include <ThreadPolicy.h>
+#include "ui_DetectorWidget.h"
+
+using namespace SigDigger;
+
+enum DetectorColumn {
+  DETECTOR_COLUMN_TIME,
+  DETECTOR_COLUMN_CENTER,
+  DETECTOR_COLUMN_BANDWIDTH,
+  DETECTOR_COLUMN_PEAK,
+  DETECTOR_COLUMN_SNR,
+  DETECTOR_COLUMN_DURATION
+};
+
+/////////////////////////// Detector widget config /////////////////////////////
+#define STRINGFY(x) #x
+#define STORE(field) obj.set(STRINGFY(field), this->field)
+#define LOAD(field) this->field = conf.get(STRINGFY(field), this->field)
+
+void
+DetectorWidgetConfig::deserialize(Suscan::Object const &conf)
+{
+  LOAD(collapsed);
+  LOAD(enabled);
+  LOAD(threshold);
+  LOAD(guardBins);
+  LOAD(trainingBins);
+  LOAD(minDuration);
+  LOAD(hold);
+  LOAD(alert);
+  LOAD(autoBookmark);
+}
+
+Suscan::Object &&
+DetectorWidgetConfig::serialize(void)
+{
+  Suscan::Object obj(SUSCAN_OBJECT_TYPE_OBJECT);
+
+  obj.setClass("DetectorWidgetConfig");
+
+  STORE(collapsed);
+  STORE(enabled);
+  STORE(threshold);
+  STORE(guardBins);
+  STORE(trainingBins);
+  STORE(minDuration);
+  STORE(hold);
+  STORE(alert);
+  STORE(autoBookmark);
+
+  return this->persist(obj);
+}
+
+////////////////////////// Detector widget config //////////////////////////////
+Suscan::Serializable *
+DetectorWidget::allocConfig(void)
+{
+  return this->panelConfig = new DetectorWidgetConfig();
+}
+
+void
+DetectorWidget::applyConfig(void)
+{
+  DetectorWidgetConfig savedConfig = *this->panelConfig;
+
+  // Setting the first widget would overwrite the rest of the config
+  this->ui->enableCheck->setChecked(savedConfig.enabled);
+  this->ui->thresholdSpin->setValue(static_cast<qreal>(savedConfig.threshold));
+  this->ui->guardSpin->setValue(static_cast<int>(savedConfig.guardBins));
+  this->ui->trainingSpin->setValue(static_cast<int>(savedConfig.trainingBins));
+  this->ui->minDurationSpin->setValue(
+        static_cast<qreal>(savedConfig.minDuration));
+  this->ui->holdSpin->setValue(static_cast<qreal>(savedConfig.hold));
+  this->ui->alertCheck->setChecked(savedConfig.alert);
+  this->ui->autoBookmarkCheck->setChecked(savedConfig.autoBookmark);
+
+  *this->panelConfig = savedConfig;
+
+  this->setProperty("collapsed", savedConfig.collapsed);
+
+  this->pushParams();
+  this->refreshUi();
+}
+
+bool
+DetectorWidget::event(QEvent *event)
+{
+  if (event->type() == QEvent::DynamicPropertyChange) {
+    QDynamicPropertyChangeEvent *const propEvent =
+        static_cast<QDynamicPropertyChangeEvent*>(event);
+    QString propName = propEvent->propertyName();
+    if (propName == "collapsed")
+      this->panelConfig->collapsed = this->property("collapsed").value<bool>();
+  }
+
+  return ToolWidget::event(event);
+}
+
+void
+DetectorWidget::setState(int, Suscan::Analyzer *analyzer)
+{
+  if (analyzer != m_analyzer) {
+    m_analyzer = analyzer;
+
+    // Emissions of the previous analyzer are over
+    emit detectorReset();
+
+    if (m_analyzer != nullptr)
+      connect(
+            m_analyzer,
+            SIGNAL(psd_message(const Suscan::PSDMessage &)),
+            this,
+            SLOT(onPSDMessage(const Suscan::PSDMessage &)));
+
+    this->refreshUi();
+  }
+}
+
+void
+DetectorWidget::setProfile(Suscan::Source::Config &)
+{
+  // NO-OP
+}
+
+void
+DetectorWidget::connectAll(void)
+{
+  connect(
+        m_worker,
+        SIGNAL(processed(QVector<SigDigger::SignalDetectorEvent>, qreal)),
+        this,
+        SLOT(onDetectorEvents(QVector<SigDigger::SignalDetectorEvent>, qreal)));
+
+  connect(
+        this,
+        SIGNAL(detectorParams(SigDigger::SignalDetectorParams)),
+        m_worker,
+        SLOT(onParams(SigDigger::SignalDetectorParams)));
+
+  connect(
+        this,
+        SIGNAL(detectorReset(void)),
+        m_worker,
+        SLOT(onReset(void)));
+
+  connect(
+        this->ui->enableCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onEnabledChanged(void)));
+
+  connect(
+        this->ui->thresholdSpin,
+        SIGNAL(valueChanged(double)),
+        this,
+        SLOT(onParamsChanged(void)));
+
+  connect(
+        this->ui->guardSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onParamsChanged(void)));
+
+  connect(
+        this->ui->trainingSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onParamsChanged(void)));
+
+  connect(
+        this->ui->minDurationSpin,
+        SIGNAL(valueChanged(double)),
+        this,
+        SLOT(onParamsChanged(void)));
+
+  connect(
+        this->ui->holdSpin,
+        SIGNAL(valueChanged(double)),
+        this,
+        SLOT(onParamsChanged(void)));
+
+  connect(
+        this->ui->alertCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onAlertChanged(void)));
+
+  connect(
+        this->ui->autoBookmarkCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onAlertChanged(void)));
+
+  connect(
+        this->ui->clearButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onClear(void)));
+
+  connect(
+        this->ui->bookmarkButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onBookmark(void)));
+
+  connect(
+        this->ui->eventTable,
+        SIGNAL(itemSelectionChanged(void)),
+        this,
+        SLOT(onSelectionChanged(void)));
+}
+
+DetectorWidget::DetectorWidget(
+    DetectorWidgetFactory *factory,
+    UIMediator *mediator,
+    QWidget *parent) :
+  ToolWidget(factory, mediator, parent),
+  ui(new Ui::DetectorWidget)
+{
+  ui->setupUi(this);
+
+  m_mediator = mediator;
+  m_spectrum = mediator->getMainSpectrum();
+
+  this->assertConfig();
+
+  m_thread = new QThread();
+  ThreadPolicy::bind(m_thread, THREAD_ROLE_DSP);
+  m_worker = new SignalDetectorWorker();
+  m_worker->moveToThread(m_thread);
+
+  connect(
+        m_thread,
+        &QThread::finished,
+        m_worker,
+        &QObject::deleteLater);
+
+  connect(
+        m_thread,
+        &QThread::finished,
+        m_thread,
+        &QObject::deleteLater);
+
+  m_thread->start();
+
+  this->connectAll();
+
+  this->setProperty("collapsed", this->panelConfig->collapsed);
+}
+
+DetectorWidget::~DetectorWidget()
+{
+  if (m_thread != nullptr)
+    m_thread->quit();
+
+  delete ui;
+}
+
+//////////////////////////////// Private methods ///////////////////////////////
+void
+DetectorWidget::refreshUi(void)
+{
+  bool enabled = this->panelConfig->enabled;
+
+  this->ui->bookmarkButton->setEnabled(
+        !this->ui->eventTable->selectedItems().isEmpty());
+
+  if (!enabled)
+    this->ui->statusLabel->setText("Idle");
+  else if (m_analyzer == nullptr)
+    this->ui->statusLabel->setText("Waiting for the analyzer");
+}
+
+void
+DetectorWidget::pushParams(void)
+{
+  SignalDetectorParams params;
+
+  params.threshold    = this->panelConfig->threshold;
+  params.guardBins    = this->panelConfig->guardBins;
+  params.trainingBins = this->panelConfig->trainingBins;
+  params.minDuration  = static_cast<qreal>(this->panelConfig->minDuration);
+  params.hold         = static_cast<qreal>(this->panelConfig->hold);
+
+  emit detectorParams(params);
+}
+
+int
+DetectorWidget::findRow(quint64 id) const
+{
+  int rows = this->ui->eventTable->rowCount();
+
+  // Emissions that are still on are usually the most recent ones
+  for (int i = 0; i < rows; ++i) {
+    QTableWidgetItem *item =
+        this->ui->eventTable->item(i, DETECTOR_COLUMN_TIME);
+
+    if (item != nullptr
+        && item->data(Qt::UserRole).value<SignalEmission>().id == id)
+      return i;
+  }
+
+  return -1;
+}
+
+void
+DetectorWidget::setRow(int row, SignalEmission const &em, bool active)
+{
+  QString values[] = {
+    QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(em.start * 1e3))
+        .toUTC()
+        .toString("hh:mm:ss.zzz"),
+    SuWidgetsHelpers::formatQuantity(em.center(), 6, "Hz"),
+    SuWidgetsHelpers::formatQuantity(em.bandwidth(), 4, "Hz"),
+    QString::number(static_cast<qreal>(em.peak), 'f', 1) + " dB",
+    QString::number(static_cast<qreal>(em.snr), 'f', 1) + " dB",
+    active
+        ? QString("Active")
+        : SuWidgetsHelpers::formatQuantity(em.duration(), 3, "s")
+  };
+
+  for (int i = 0; i < 6; ++i) {
+    QTableWidgetItem *item = this->ui->eventTable->item(row, i);
+
+    if (item == nullptr) {
+      item = new QTableWidgetItem();
+      this->ui->eventTable->setItem(row, i, item);
+    }
+
+    item->setText(values[i]);
+  }
+
+  // Bookmarks are made from this
+  this->ui->eventTable->item(row, DETECTOR_COLUMN_TIME)->setData(
+        Qt::UserRole,
+        QVariant::fromValue(em));
+}
+
+void
+DetectorWidget::addEmission(SignalEmission const &em)
+{
+  int rows;
+
+  this->ui->eventTable->insertRow(0);
+  this->setRow(0, em, true);
+
+  rows = this->ui->eventTable->rowCount();
+  if (rows > SIGDIGGER_DETECTOR_MAX_EVENTS)
+    this->ui->eventTable->removeRow(rows - 1);
+
+  ++m_active;
+
+  if (this->panelConfig->alert) {
+    QApplication::beep();
+    QApplication::alert(this->window());
+  }
+}
+
+void
+DetectorWidget::endEmission(SignalEmission const &em)
+{
+  int row = this->findRow(em.id);
+
+  if (m_active > 0)
+    --m_active;
+
+  if (row != -1)
+    this->setRow(row, em, false);
+
+  if (this->panelConfig->autoBookmark)
+    this->bookmark(em);
+}
+
+bool
+DetectorWidget::bookmark(SignalEmission const &em)
+{
+  Suscan::Singleton *sus = Suscan::Singleton::get_instance();
+  BookmarkInfo info;
+  qint32 halfBw = static_cast<qint32>(.5 * em.bandwidth());
+
+  info.name = QString("Emission %1 (%2)")
+      .arg(em.id)
+      .arg(QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(em.start * 1e3))
+           .toUTC()
+           .toString("yyyy-MM-dd hh:mm:ss"));
+  info.frequency = static_cast<qint64>(em.center());
+  info.color = QColor(SIGDIGGER_DETECTOR_BOOKMARK_COLOR);
+  info.lowFreqCut = -halfBw;
+  info.highFreqCut = +halfBw;
+
+  if (!sus->registerBookmark(info))
+    return false;
+
+  m_spectrum->updateOverlay();
+
+  return true;
+}
+
+//////////////////////////////////// Slots /////////////////////////////////////
+void
+DetectorWidget::onPSDMessage(const Suscan::PSDMessage &msg)
+{
+  if (this->panelConfig->enabled)
+    m_worker->offer(msg);
+}
+
+void
+DetectorWidget::onDetectorEvents(
+    QVector<SigDigger::SignalDetectorEvent> events,
+    qreal floor)
+{
+  for (auto &ev : events) {
+    if (ev.kind == SignalDetectorEvent::STARTED)
+      this->addEmission(ev.emission);
+    else
+      this->endEmission(ev.emission);
+
+    if (m_analyzer != nullptr)
+      m_analyzer->dispatchEmission(ev);
+  }
+
+  if (this->panelConfig->enabled && m_analyzer != nullptr)
+    this->ui->statusLabel->setText(
+          QString("Floor: %1 dB, %2 active")
+          .arg(floor, 0, 'f', 1)
+          .arg(m_active));
+}
+
+void
+DetectorWidget::onEnabledChanged(void)
+{
+  this->panelConfig->enabled = this->ui->enableCheck->isChecked();
+
+  if (!this->panelConfig->enabled)
+    emit detectorReset();
+
+  this->refreshUi();
+}
+
+void
+DetectorWidget::onParamsChanged(void)
+{
+  this->panelConfig->threshold =
+      static_cast<float>(this->ui->thresholdSpin->value());
+  this->panelConfig->guardBins =
+      static_cast<unsigned int>(this->ui->guardSpin->value());
+  this->panelConfig->trainingBins =
+      static_cast<unsigned int>(this->ui->trainingSpin->value());
+  this->panelConfig->minDuration =
+      static_cast<float>(this->ui->minDurationSpin->value());
+  this->panelConfig->hold =
+      static_cast<float>(this->ui->holdSpin->value());
+
+  this->pushParams();
+}
+
+void
+DetectorWidget::onAlertChanged(void)
+{
+  this->panelConfig->alert = this->ui->alertCheck->isChecked();
+  this->panelConfig->autoBookmark = this->ui->autoBookmarkCheck->isChecked();
+}
+
+void
+DetectorWidget::onClear(void)
+{
+  this->ui->eventTable->setRowCount(0);
+  this->refreshUi();
+}
+
+void
+DetectorWidget::onBookmark(void)
+{
+  QList<QTableWidgetItem *> items = this->ui->eventTable->selectedItems();
+  SignalEmission em;
+
+  if (items.isEmpty())
+    return;
+
+  em = this->ui->eventTable->item(
+        items.first()->row(),
+        DETECTOR_COLUMN_TIME)->data(Qt::UserRole).value<SignalEmission>();
+
+  if (!this->bookmark(em))
+    this->ui->statusLabel->setText(
+          "A bookmark already exists for "
+          + SuWidgetsHelpers::formatQuantity(em.center(), 6, "Hz"));
+}
+
+void
+DetectorWidget::onSelectionChanged(void)
+{
+  this->refreshUi();
+}
@@ -0,0 +1,116 @@
+//
+//    Default/Detector/DetectorWidget.h: Emission detector tool
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef DETECTORWIDGET_H
+#define DETECTORWIDGET_H
+
+#include "ToolWidgetFactory.h"
+#include <Suscan/Library.h>
+#include <Suscan/Analyzer.h>
+#include <SignalDetector.h>
+#include <QThread>
+
+// Oldest events are forgotten past this
+#define SIGDIGGER_DETECTOR_MAX_EVENTS    1000
+#define SIGDIGGER_DETECTOR_BOOKMARK_COLOR "#ffaa00"
+
+namespace Ui {
+  class DetectorWidget;
+}
+
+namespace SigDigger {
+  class DetectorWidgetFactory;
+  class UIMediator;
+  class MainSpectrum;
+
+  struct DetectorWidgetConfig : public Suscan::Serializable {
+    bool collapsed = false;
+    bool enabled = false;
+    float threshold = 10;
+    unsigned int guardBins = 2;
+    unsigned int trainingBins = 16;
+    float minDuration = .2f;
+    float hold = .5f;
+    bool alert = false;
+    bool autoBookmark = false;
+
+    // Overriden methods
+    void deserialize(Suscan::Object const &conf) override;
+    Suscan::Object &&serialize() override;
+  };
+
+  class DetectorWidget : public ToolWidget
+  {
+    Q_OBJECT
+
+    // Convenience pointer
+    DetectorWidgetConfig *panelConfig = nullptr;
+
+    // UI Objects
+    Ui::DetectorWidget *ui = nullptr;
+    MainSpectrum *m_spectrum = nullptr;
+    UIMediator   *m_mediator = nullptr;
+    Suscan::Analyzer *m_analyzer = nullptr;
+
+    // Detector
+    QThread *m_thread = nullptr;
+    SignalDetectorWorker *m_worker = nullptr;
+    unsigned int m_active = 0;
+
+    void connectAll(void);
+    void refreshUi(void);
+    void pushParams(void);
+    int findRow(quint64 id) const;
+    void addEmission(SignalEmission const &);
+    void endEmission(SignalEmission const &);
+    void setRow(int row, SignalEmission const &, bool active);
+    bool bookmark(SignalEmission const &);
+
+  public:
+    DetectorWidget(
+        DetectorWidgetFactory *,
+        UIMediator *,
+        QWidget *parent = nullptr);
+    ~DetectorWidget() override;
+
+    // Configuration methods
+    Suscan::Serializable *allocConfig(void) override;
+    void applyConfig(void) override;
+    bool event(QEvent *) override;
+
+    // Overriden methods
+    void setState(int, Suscan::Analyzer *) override;
+    void setProfile(Suscan::Source::Config &) override;
+
+  signals:
+    void detectorParams(SigDigger::SignalDetectorParams);
+    void detectorReset(void);
+
+  public slots:
+    void onPSDMessage(const Suscan::PSDMessage &);
+    void onDetectorEvents(QVector<SigDigger::SignalDetectorEvent>, qreal);
+    void onEnabledChanged(void);
+    void onParamsChanged(void);
+    void onAlertChanged(void);
+    void onClear(void);
+    void onBookmark(void);
+    void onSelectionChanged(void);
+  };
+}
+
+#endif // DETECTORWIDGET_H
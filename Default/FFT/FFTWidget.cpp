@@ -21,6 +21,7 @@
 #include "FFTWidget.h"
 #include <QVariant>
 #include <QEvent>
+#include <cmath>
 #include <SigDiggerHelpers.h>
 #include <SuWidgetsHelpers.h>
 #include <UIMediator.h>
@@ -39,6 +40,8 @@ FFTWidgetConfig::deserialize(Suscan::Object const &conf)
 {
   LOAD(collapsed);
   LOAD(averaging);
+  LOAD(averagingPercentile);
+  LOAD(trace);
   LOAD(panWfRatio);
   LOAD(peakDetect);
   LOAD(peakHold);
@@ -67,6 +70,8 @@ FFTWidgetConfig::serialize(void)
 
   STORE(collapsed);
   STORE(averaging);
+  STORE(averagingPercentile);
+  STORE(trace);
   STORE(panWfRatio);
   STORE(peakDetect);
   STORE(peakHold);
@@ -110,6 +115,8 @@ FFTWidget::applyConfig(void)
   this->refreshPalettes();
 
   this->setAveraging(savedConfig.averaging);
+  this->setAveragingPercentile(savedConfig.averagingPercentile);
+  this->setTrace(savedConfig.trace);
   this->setPanWfRatio(savedConfig.panWfRatio);
   this->setPandRangeMax(savedConfig.panRangeMax);
   this->setPandRangeMin(savedConfig.panRangeMin);
@@ -160,11 +167,6 @@ FFTWidget::setState(int, Suscan::Analyzer *analyzer)
             SIGNAL(analyzer_params(const Suscan::AnalyzerParams &)),
             this,
             SLOT(onAnalyzerParams(const Suscan::AnalyzerParams &)));
-      connect(
-            m_analyzer,
-            SIGNAL(source_info_message(const Suscan::SourceInfoMessage &)),
-            this,
-            SLOT(onSourceInfoMessage(const Suscan::SourceInfoMessage &)));
     }
   }
 }
@@ -176,6 +178,20 @@ FFTWidget::setProfile(Suscan::Source::Config &config)
   this->updateRbw();
 }
 
+void
+FFTWidget::setSourceInfo(
+    Suscan::AnalyzerSourceInfo const &info,
+    unsigned int changes)
+{
+  if (changes & Suscan::SOURCE_INFO_SAMPLE_RATE) {
+    this->rate = SCAST(unsigned, info.getSampleRate());
+    this->updateRbw();
+  }
+
+  if (changes & Suscan::SOURCE_INFO_PERMISSIONS)
+    this->applySourceInfo(info);
+}
+
 void
 FFTWidget::connectAll(void)
 {
@@ -203,6 +219,18 @@ FFTWidget::connectAll(void)
         this,
         SLOT(onAveragingChanged(int)));
 
+  connect(
+        this->ui->averagingModeCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onAveragingModeChanged(int)));
+
+  connect(
+        this->ui->traceCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onTraceChanged(int)));
+
   connect(
         this->ui->fftAspectSlider,
         SIGNAL(valueChanged(int)),
@@ -349,6 +377,8 @@ FFTWidget::FFTWidget(FFTWidgetFactory *factory, UIMediator *mediator, QWidget *p
   this->addTimeSpan(48 * 3600);
 
   this->populateUnits();
+  this->populateAveragingModes();
+  this->populateTraces();
 
   this->connectAll();
 
@@ -369,6 +399,49 @@ FFTWidget::populateUnits(void)
   this->ui->zeroPointSpin->setValue(0.0);
 }
 
+void
+FFTWidget::populateAveragingModes(void)
+{
+  this->ui->averagingModeCombo->clear();
+
+  // Item data is the percentile
+  this->ui->averagingModeCombo->addItem("Mean", QVariant::fromValue(0.f));
+  this->ui->averagingModeCombo->addItem("Median", QVariant::fromValue(.5f));
+  this->ui->averagingModeCombo->addItem(
+        "10th percentile",
+        QVariant::fromValue(.1f));
+  this->ui->averagingModeCombo->addItem(
+        "25th percentile",
+        QVariant::fromValue(.25f));
+  this->ui->averagingModeCombo->addItem(
+        "75th percentile",
+        QVariant::fromValue(.75f));
+  this->ui->averagingModeCombo->addItem(
+        "90th percentile",
+        QVariant::fromValue(.9f));
+
+  this->ui->averagingModeCombo->setCurrentIndex(0);
+}
+
+void
+FFTWidget::populateTraces(void)
+{
+  this->ui->traceCombo->clear();
+
+  // Item data is the Averager::Trace
+  this->ui->traceCombo->addItem(
+        "Average",
+        QVariant::fromValue<unsigned int>(Averager::AVERAGE));
+  this->ui->traceCombo->addItem(
+        "Max hold",
+        QVariant::fromValue<unsigned int>(Averager::MAX_HOLD));
+  this->ui->traceCombo->addItem(
+        "Min hold",
+        QVariant::fromValue<unsigned int>(Averager::MIN_HOLD));
+
+  this->ui->traceCombo->setCurrentIndex(0);
+}
+
 void
 FFTWidget::refreshPalettes(void)
 {
@@ -541,6 +614,18 @@ FFTWidget::getAveraging(void) const
   return avg;
 }
 
+float
+FFTWidget::getAveragingPercentile(void) const
+{
+  return this->ui->averagingModeCombo->currentData().value<float>();
+}
+
+unsigned int
+FFTWidget::getTrace(void) const
+{
+  return this->ui->traceCombo->currentData().value<unsigned int>();
+}
+
 float
 FFTWidget::getPanWfRatio(void) const
 {
@@ -743,6 +828,41 @@ FFTWidget::setAveraging(float avg)
   this->panelConfig->averaging = avg;
 }
 
+void
+FFTWidget::setAveragingPercentile(float percentile)
+{
+  int index = 0;
+
+  // Closest of the modes offered
+  for (int i = 1; i < this->ui->averagingModeCombo->count(); ++i) {
+    float value = this->ui->averagingModeCombo->itemData(i).value<float>();
+    float best =
+        this->ui->averagingModeCombo->itemData(index).value<float>();
+
+    if (std::fabs(value - percentile) < std::fabs(best - percentile))
+      index = i;
+  }
+
+  this->ui->averagingModeCombo->setCurrentIndex(index);
+  this->panelConfig->averagingPercentile = this->getAveragingPercentile();
+
+  m_mediator->getSpectrumAverager()->setPercentile(
+        this->panelConfig->averagingPercentile);
+}
+
+void
+FFTWidget::setTrace(unsigned int trace)
+{
+  int index = this->ui->traceCombo->findData(
+        QVariant::fromValue<unsigned int>(trace));
+
+  this->ui->traceCombo->setCurrentIndex(index < 0 ? 0 : index);
+  this->panelConfig->trace = this->getTrace();
+
+  m_mediator->getSpectrumAverager()->setTrace(
+        static_cast<Averager::Trace>(this->panelConfig->trace));
+}
+
 void
 FFTWidget::setPanWfRatio(float ratio)
 {
@@ -953,10 +1073,8 @@ FFTWidget::refreshSpectrumSettings(void)
 void
 FFTWidget::updateAnalyzerParams(void)
 {
-  if (m_analyzer != nullptr) {
-    auto params = m_mediator->getAnalyzerParams();
-    m_analyzer->setParams(*params);
-  }
+  if (m_analyzer != nullptr)
+    m_analyzer->setParams(m_mediator->requestAnalyzerParams());
 }
 
 void
@@ -1011,6 +1129,20 @@ FFTWidget::onAveragingChanged(int)
   averager->setAlpha(avg);
 }
 
+void
+FFTWidget::onAveragingModeChanged(int)
+{
+  this->setAveragingPercentile(this->getAveragingPercentile());
+}
+
+void
+FFTWidget::onTraceChanged(int)
+{
+  // Choosing the same hold again starts it over
+  this->setTrace(this->getTrace());
+  m_mediator->getSpectrumAverager()->resetHold();
+}
+
 void
 FFTWidget::onAspectRatioChanged(int)
 {
@@ -1182,16 +1314,11 @@ FFTWidget::onGainChanged(void)
 }
 
 void
-FFTWidget::onAnalyzerParams(const Suscan::AnalyzerParams &params)
-{
-  this->refreshParamControls(params);
-}
-
-void
-FFTWidget::onSourceInfoMessage(Suscan::SourceInfoMessage const &msg)
+FFTWidget::onAnalyzerParams(const Suscan::AnalyzerParams &)
 {
-  this->rate = SCAST(unsigned, msg.info()->getSampleRate());
-  this->updateRbw();
+  // Show the user's settings, not the reduced ones the mediator may
+  // have requested on top of them
+  this->refreshParamControls(*m_mediator->getAnalyzerParams());
 }
 
 void
@@ -40,6 +40,8 @@ namespace SigDigger {
   struct FFTWidgetConfig : public Suscan::Serializable {
     bool collapsed = false;
     float averaging = 1;
+    float averagingPercentile = 0; // 0: exponential mean
+    unsigned int trace = 0;        // Averager::Trace
     float panWfRatio = 0.3f;
     bool peakDetect = false;
     bool peakHold = false;
@@ -108,6 +110,8 @@ namespace SigDigger {
     void updateTimeSpans();
     void connectAll();
     void populateUnits();
+    void populateAveragingModes();
+    void populateTraces();
     void updateRbw();
 
     void refreshPalettes();
@@ -120,6 +124,8 @@ namespace SigDigger {
     float getWfRangeMin() const;
     float getWfRangeMax() const;
     float getAveraging() const;
+    float getAveragingPercentile() const;
+    unsigned int getTrace() const;
     float getPanWfRatio() const;
     unsigned int getFreqZoom() const;
     unsigned int getFftSize() const;
@@ -152,6 +158,8 @@ namespace SigDigger {
     void setWfRangeMin(float);
     void setWfRangeMax(float);
     void setAveraging(float);
+    void setAveragingPercentile(float);
+    void setTrace(unsigned int);
     void setPanWfRatio(float);
     void setFreqZoom(int);
     void setDefaultFftSize(unsigned int);
@@ -204,11 +212,16 @@ namespace SigDigger {
     // Overriden methods
     void setState(int, Suscan::Analyzer *) override;
     void setProfile(Suscan::Source::Config &) override;
+    void setSourceInfo(
+        Suscan::AnalyzerSourceInfo const &,
+        unsigned int changes) override;
 
   public slots:
     void onPandRangeChanged(int min, int max);
     void onWfRangeChanged(int min, int max);
     void onAveragingChanged(int val);
+    void onAveragingModeChanged(int);
+    void onTraceChanged(int);
     void onAspectRatioChanged(int val);
     void onPaletteChanged(int);
     void onFreqZoomChanged(int);
@@ -229,7 +242,6 @@ namespace SigDigger {
 
     // Analyzer slots
     void onAnalyzerParams(const Suscan::AnalyzerParams &params);
-    void onSourceInfoMessage(Suscan::SourceInfoMessage const &msg);
 
     // Spectrum slots
     void onRangeChanged(float min, float max);
@@ -18,16 +18,19 @@
 //
 
 #include "FACTab.h"
+#include "FACWorker.h"
 #include "ui_FACTab.h"
 #include <SuWidgetsHelpers.h>
+#include <RenderScheduler.h>
+#include <ThreadPolicy.h>
+#include <QThread>
 
 using namespace SigDigger;
 
 void
 FACTab::resizeFAC(int size)
 {
-  this->buffer.resize(static_cast<size_t>(size));
-  this->buffer.assign(this->buffer.size(), 0);
+  this->size = static_cast<unsigned int>(size);
 
   this->fac.resize(static_cast<size_t>(size / 2));
   this->fac.assign(this->fac.size(), 0);
@@ -36,36 +39,27 @@ FACTab::resizeFAC(int size)
   this->ui->facWaveform->invalidate();
   this->adjustZoom = true;
 
-  this->min = INFINITY;
-  this->max = -INFINITY;
-
   this->p = 0;
 
-  if (this->direct != nullptr)
-    SU_FFTW(_destroy_plan)(this->direct);
-
-  if (this->reverse != nullptr)
-    SU_FFTW(_destroy_plan)(this->reverse);
-
-  SU_ATTEMPT(this->direct = SU_FFTW(_plan_dft_1d)(
-        static_cast<int>(this->buffer.size()),
-        reinterpret_cast<SU_FFTW(_complex) *>(this->buffer.data()),
-        reinterpret_cast<SU_FFTW(_complex) *>(this->buffer.data()),
-        FFTW_FORWARD,
-        FFTW_ESTIMATE));
-
-  SU_ATTEMPT(this->reverse = SU_FFTW(_plan_dft_1d)(
-        static_cast<int>(this->buffer.size()),
-        reinterpret_cast<SU_FFTW(_complex) *>(this->buffer.data()),
-        reinterpret_cast<SU_FFTW(_complex) *>(this->buffer.data()),
-        FFTW_BACKWARD,
-        FFTW_ESTIMATE));
+  this->updateWorkerParams();
 
   this->ui->facWaveform->zoomHorizontal(
         static_cast<qint64>(0),
         static_cast<qint64>(size / 2));
 }
 
+void
+FACTab::updateWorkerParams(void)
+{
+  unsigned int divisor =
+      static_cast<unsigned int>(
+        qMax(1, this->ui->overlapCombo->currentData().value<int>()));
+
+  this->hop = qMax(1u, this->size / divisor);
+
+  this->facWorker->setParams(this->size, this->hop, this->alpha);
+}
+
 FACTab::FACTab(QWidget *parent) :
   QWidget(parent),
   ui(new Ui::FACTab)
@@ -74,8 +68,29 @@ FACTab::FACTab(QWidget *parent) :
 
   ui->setupUi(this);
 
+  this->facThread = new QThread();
+  ThreadPolicy::bind(this->facThread, THREAD_ROLE_DSP);
+  this->facWorker = new FACWorker();
+  this->facWorker->moveToThread(this->facThread);
+
+  connect(
+        this->facThread,
+        &QThread::finished,
+        this->facWorker,
+        &QObject::deleteLater);
+
+  connect(
+        this->facThread,
+        &QThread::finished,
+        this->facThread,
+        &QObject::deleteLater);
+
+  this->facThread->start();
+
   this->connectAll();
 
+  RenderScheduler::instance()->attach(this, [this] () { this->refreshView(); });
+
   for (i = 9; i < 20; ++i)
     this->ui->facSizeCombo->addItem(
           QString::number(1 << i),
@@ -83,12 +98,21 @@ FACTab::FACTab(QWidget *parent) :
 
   this->ui->facSizeCombo->setCurrentIndex(16 - 9);
 
+  this->ui->overlapCombo->addItem("No overlap", QVariant::fromValue<int>(1));
+  this->ui->overlapCombo->addItem("50% overlap", QVariant::fromValue<int>(2));
+  this->ui->overlapCombo->addItem("75% overlap", QVariant::fromValue<int>(4));
+  this->ui->overlapCombo->addItem(
+        "87.5% overlap",
+        QVariant::fromValue<int>(8));
+
+  this->ui->overlapCombo->setCurrentIndex(1);
+
   this->ui->facWaveform->setRealComponent(true);
   this->ui->facWaveform->setEnableFeedback(false);
   this->onUnitsChanged();
 
-  this->onChangeFACSize();
   this->onAdjustAveraging();
+  this->onChangeFACSize();
   this->onChangePeakDetect();
 
   this->ui->facWaveform->zoomVertical(
@@ -100,13 +124,9 @@ FACTab::FACTab(QWidget *parent) :
 
 FACTab::~FACTab()
 {
-  delete ui;
-
-  if (this->direct != nullptr)
-    SU_FFTW(_destroy_plan)(this->direct);
+  this->facThread->quit();
 
-  if (this->reverse != nullptr)
-    SU_FFTW(_destroy_plan)(this->reverse);
+  delete ui;
 }
 
 void
@@ -147,6 +167,18 @@ FACTab::connectAll(void)
         SIGNAL(valueChanged(int)),
         this,
         SLOT(onAdjustAveraging(void)));
+
+  connect(
+        this->ui->overlapCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onChangeOverlap(void)));
+
+  connect(
+        this->facWorker,
+        SIGNAL(resultReady(void)),
+        this,
+        SLOT(onFACResult(void)));
 }
 
 void
@@ -162,8 +194,9 @@ FACTab::setSampleRate(qreal fs)
 
   this->onUnitsChanged();
 
-  this->buffer.assign(this->buffer.size(), 0);
+  this->facWorker->reset();
   this->fac.assign(this->fac.size(), 0);
+  this->p = 0;
 }
 
 void
@@ -179,128 +212,127 @@ FACTab::setColorConfig(ColorConfig const &cfg)
 void
 FACTab::feed(const SUCOMPLEX *data, unsigned int size)
 {
-  size_t got, i;
-  SUCOMPLEX *bufData = this->buffer.data();
-  SUCOMPLEX *facData = this->fac.data();
-  QList<WaveMarker> markers;
-  WaveMarker marker;
-  size_t bufLen = this->buffer.size();
-  bool redraw = false;
-  SUFLOAT localMax = -INFINITY;
-  SUFLOAT power = 0;
-  unsigned int powerCount = 0;
-  size_t localMaxPos = 0;
   struct timeval tv, diff;
-  qint64 currStart = this->ui->facWaveform->getSampleStart();
-  qint64 currEnd   = this->ui->facWaveform->getSampleEnd();
-
-  while (size > 0) {
-    got = size;
-    if (got > (bufLen - this->p))
-      got = bufLen - this->p;
-
-    memcpy(bufData + this->p, data, got * sizeof(SUCOMPLEX));
-    p    += got;
-
-    if (p == bufLen) {
-      p = 0;
 
-      gettimeofday(&this->lastRefresh, nullptr);
+  this->facWorker->push(data, size);
+  this->p = qMin(this->p + size, this->hop);
 
-      SU_FFTW(_execute(this->direct));
+  gettimeofday(&tv, nullptr);
+  timersub(&tv, &this->lastRefresh, &diff);
 
-      for (i = 0; i < bufLen; ++i)
-        bufData[i] *= SU_C_CONJ(bufData[i]);
+  if (diff.tv_sec > 0 || diff.tv_usec > 100000) {
+    this->ui->progressBar->setValue(
+          static_cast<int>(100. * this->p / this->hop));
+    this->lastRefresh = tv;
+  }
+}
 
-      SU_FFTW(_execute(this->reverse));
+/////////////////////////////////////// Slots //////////////////////////////////
+void
+FACTab::onRecord(void)
+{
+  this->recording = this->ui->recordButton->isChecked();
+}
 
-      for (i = 0; i < bufLen / 2; ++i) {
-        bufData[i] = SU_C_ABS(bufData[i]);
+void
+FACTab::onAdjustAveraging(void)
+{
+  this->alpha =
+      1 - static_cast<SUFLOAT>(this->ui->averagingSlider->value() / 100.);
 
-        if (currStart <= SCAST(qint64, i) && SCAST(qint64, i) < currEnd) {
-          if (SU_C_REAL(bufData[i]) > localMax) {
-            localMax = SU_C_REAL(bufData[i]);
-            localMaxPos = i;
-          } else {
-            power += SU_C_REAL(bufData[i]) * SU_C_REAL(bufData[i]);
-            ++powerCount;
-          }
+  if (this->size > 0)
+    this->updateWorkerParams();
+}
 
-          if (SU_C_REAL(bufData[i]) > this->max)
-            this->max = SU_C_REAL(bufData[i]);
+void
+FACTab::onChangeFACSize(void)
+{
+  this->resizeFAC(this->ui->facSizeCombo->currentData().value<int>());
+}
 
-          if (SU_C_REAL(bufData[i]) < this->min)
-            this->min = SU_C_REAL(bufData[i]);
-        }
-      }
+void
+FACTab::onChangeOverlap(void)
+{
+  this->updateWorkerParams();
+}
 
-      for (i = 0; i < bufLen / 2; ++i)
-        SU_SPLPF_FEED(facData[i], SU_C_REAL(bufData[i]) / this->max, this->alpha);
+//
+// Results are coalesced by the worker until taken, so they are only taken
+// when the scheduler has a frame for us.
+//
+void
+FACTab::refreshView(void)
+{
+  QList<WaveMarker> markers;
+  WaveMarker marker;
+  SUFLOAT localMax = -INFINITY;
+  SUFLOAT power = 0;
+  unsigned int powerCount = 0;
+  size_t localMaxPos = 0;
+  size_t i;
+  qint64 currStart = this->ui->facWaveform->getSampleStart();
+  qint64 currEnd   = this->ui->facWaveform->getSampleEnd();
 
-      redraw = true;
-    }
+  this->facWorker->takeResult(this->fac);
 
-    size -= got;
-    data += got;
+  // Stale result from a previous FAC size
+  if (this->fac.size() != this->size / 2) {
+    this->fac.resize(this->size / 2);
+    this->fac.assign(this->fac.size(), 0);
+    return;
   }
 
-  if (redraw) {
-    this->ui->progressBar->setValue(100);
-    this->ui->facWaveform->setData(&this->fac, true, true);
+  this->p = 0;
+  gettimeofday(&this->lastRefresh, nullptr);
 
-    if (this->adjustZoom) {
-      this->ui->facWaveform->zoomVertical(
-            static_cast<qreal>(0),
-            static_cast<qreal>(1));
+  this->ui->progressBar->setValue(100);
+  this->ui->facWaveform->setData(&this->fac, true, true);
 
-      this->adjustZoom = false;
-    }
+  if (this->adjustZoom) {
+    this->ui->facWaveform->zoomVertical(
+          static_cast<qreal>(0),
+          static_cast<qreal>(1));
 
-    if (this->ui->detectPeaksCheck->isChecked()) {
-      if (!isinf(localMax) && powerCount > 0) {
-        SUFLOAT meanPower = SU_SQRT(power / powerCount);
-        SUFLOAT sigmas = localMax / meanPower;
-
-        if (sigmas > this->ui->sigmaSpin->value()) {
-          marker.below = false;
-          marker.x = localMaxPos;
-          marker.string =
-              "Max: " + QString::number(localMaxPos) +
-              " (" + QString::number(sigmas, 'g', 2) + "σ)";
-          markers.append(marker);
+    this->adjustZoom = false;
+  }
+
+  if (this->ui->detectPeaksCheck->isChecked()) {
+    for (i = 0; i < this->fac.size(); ++i) {
+      if (currStart <= SCAST(qint64, i) && SCAST(qint64, i) < currEnd) {
+        SUFLOAT val = SU_C_REAL(this->fac[i]);
+
+        if (val > localMax) {
+          localMax = val;
+          localMaxPos = i;
+        } else {
+          power += val * val;
+          ++powerCount;
         }
       }
     }
-    this->ui->facWaveform->setMarkerList(markers);
-  } else {
-    gettimeofday(&tv, nullptr);
-    timersub(&tv, &this->lastRefresh, &diff);
 
-    if (diff.tv_usec > 100000) {
-      this->ui->progressBar->setValue(100. * this->p / bufLen);
-      this->lastRefresh = tv;
+    if (!isinf(localMax) && powerCount > 0) {
+      SUFLOAT meanPower = SU_SQRT(power / powerCount);
+      SUFLOAT sigmas = localMax / meanPower;
+
+      if (sigmas > this->ui->sigmaSpin->value()) {
+        marker.below = false;
+        marker.x = localMaxPos;
+        marker.string =
+            "Max: " + QString::number(localMaxPos) +
+            " (" + QString::number(sigmas, 'g', 2) + "σ)";
+        markers.append(marker);
+      }
     }
   }
-}
 
-/////////////////////////////////////// Slots //////////////////////////////////
-void
-FACTab::onRecord(void)
-{
-  this->recording = this->ui->recordButton->isChecked();
-}
-
-void
-FACTab::onAdjustAveraging(void)
-{
-  this->alpha =
-      1 - static_cast<SUFLOAT>(this->ui->averagingSlider->value() / 100.);
+  this->ui->facWaveform->setMarkerList(markers);
 }
 
 void
-FACTab::onChangeFACSize(void)
+FACTab::onFACResult(void)
 {
-  this->resizeFAC(this->ui->facSizeCombo->currentData().value<int>());
+  RenderScheduler::instance()->markDirty(this);
 }
 
 void
@@ -23,6 +23,7 @@
 #include <util/compat-time.h>
 
 class ThrottleControl;
+class QThread;
 #include <sigutils/types.h>
 #include "ColorConfig.h"
 
@@ -31,6 +32,8 @@ namespace Ui {
 }
 
 namespace SigDigger {
+  class FACWorker;
+
   class FACTab : public QWidget
   {
     Q_OBJECT
@@ -38,23 +41,26 @@ namespace SigDigger {
     qreal fs = 1;
 
     struct timeval lastRefresh = {0, 0};
-    SU_FFTW(_plan) direct = nullptr;
-    SU_FFTW(_plan) reverse = nullptr;
 
-    std::vector<SUCOMPLEX> buffer;
+    QThread *facThread = nullptr;
+    FACWorker *facWorker = nullptr;
+
     std::vector<SUCOMPLEX> fac;
     SUFLOAT alpha;
-    SUFLOAT min = INFINITY;
-    SUFLOAT max = -INFINITY;
+    unsigned int size = 0;
+    unsigned int hop = 0;
 
     bool recording = false;
     bool adjustZoom = false;
 
+    // Samples fed since the last update
     unsigned int p = 0;
 
     void refreshUi(void);
     void connectAll(void);
     void resizeFAC(int);
+    void updateWorkerParams(void);
+    void refreshView(void);
 
   public:
     explicit FACTab(QWidget *parent = nullptr);
@@ -78,6 +84,8 @@ namespace SigDigger {
     void onChangeFACSize(void);
     void onUnitsChanged(void);
     void onChangePeakDetect(void);
+    void onChangeOverlap(void);
+    void onFACResult(void);
 
   private:
     Ui::FACTab *ui;
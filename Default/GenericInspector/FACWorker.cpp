@@ -0,0 +1,226 @@
+//
+//    FACWorker.cpp: Streaming fast autocorrelation worker
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "FACWorker.h"
+#include "FFTPlanCache.h"
+#include <QMutexLocker>
+#include <cstring>
+#include <algorithm>
+
+using namespace SigDigger;
+
+FACWorker::FACWorker(QObject *parent) : QObject(parent)
+{
+  // Requests may come from any thread, but are always served here
+  connect(
+        this,
+        SIGNAL(processRequested(void)),
+        this,
+        SLOT(process(void)),
+        Qt::QueuedConnection);
+}
+
+void
+FACWorker::setParams(unsigned int size, unsigned int hop, SUFLOAT alpha)
+{
+  QMutexLocker locker(&this->mutex);
+
+  if (hop < 1)
+    hop = 1;
+
+  if (hop > size)
+    hop = size;
+
+  if (size != this->size)
+    this->resetRequested = true;
+
+  this->size  = size;
+  this->hop   = hop;
+  this->alpha = alpha;
+}
+
+void
+FACWorker::reset(void)
+{
+  QMutexLocker locker(&this->mutex);
+
+  this->resetRequested = true;
+}
+
+void
+FACWorker::push(const SUCOMPLEX *data, size_t len)
+{
+  QMutexLocker locker(&this->mutex);
+  size_t maxPending =
+      static_cast<size_t>(this->size) * SIGDIGGER_FAC_WORKER_MAX_PENDING_BLOCKS;
+
+  this->pending.insert(this->pending.end(), data, data + len);
+
+  if (this->pending.size() > maxPending)
+    this->pending.erase(
+          this->pending.begin(),
+          this->pending.begin()
+          + static_cast<long>(this->pending.size() - maxPending));
+
+  if (!this->processQueued) {
+    this->processQueued = true;
+    emit processRequested();
+  }
+}
+
+void
+FACWorker::takeResult(std::vector<SUCOMPLEX> &dest)
+{
+  QMutexLocker locker(&this->mutex);
+
+  dest = this->result;
+  this->resultQueued = false;
+}
+
+void
+FACWorker::configure(unsigned int size, unsigned int hop)
+{
+  if (size != this->currSize) {
+    this->window.resize(size);
+    this->scratch.resize(size);
+    this->average.resize(size / 2);
+
+    this->direct = FFTPlanCache::instance()->get(
+          static_cast<int>(size),
+          FFTW_FORWARD,
+          reinterpret_cast<SU_FFTW(_complex) *>(this->scratch.data()),
+          reinterpret_cast<SU_FFTW(_complex) *>(this->scratch.data()));
+
+    this->reverse = FFTPlanCache::instance()->get(
+          static_cast<int>(size),
+          FFTW_BACKWARD,
+          reinterpret_cast<SU_FFTW(_complex) *>(this->scratch.data()),
+          reinterpret_cast<SU_FFTW(_complex) *>(this->scratch.data()));
+
+    this->currSize = size;
+  }
+
+  this->currHop = hop;
+}
+
+void
+FACWorker::compute(SUFLOAT alpha)
+{
+  SUCOMPLEX *buf = this->scratch.data();
+  SU_FFTW(_complex) *fftBuf = reinterpret_cast<SU_FFTW(_complex) *>(buf);
+  size_t half = this->currSize / 2;
+  size_t i;
+
+  memcpy(buf, this->window.data(), this->currSize * sizeof(SUCOMPLEX));
+
+  FFTPlanCache::execute(this->direct, fftBuf, fftBuf);
+
+  for (i = 0; i < this->currSize; ++i)
+    buf[i] *= SU_C_CONJ(buf[i]);
+
+  FFTPlanCache::execute(this->reverse, fftBuf, fftBuf);
+
+  for (i = 0; i < half; ++i) {
+    SUFLOAT mag = SU_C_ABS(buf[i]);
+    buf[i] = mag;
+
+    if (mag > this->max)
+      this->max = mag;
+  }
+
+  if (this->max > 0)
+    for (i = 0; i < half; ++i)
+      SU_SPLPF_FEED(
+            this->average[i],
+            SU_C_REAL(buf[i]) / this->max,
+            alpha);
+}
+
+void
+FACWorker::process(void)
+{
+  unsigned int size, hop;
+  SUFLOAT alpha;
+  bool reset;
+  bool computed = false;
+  size_t p = 0, got;
+
+  this->mutex.lock();
+  this->input.swap(this->pending);
+  this->pending.clear();
+  this->processQueued = false;
+  size  = this->size;
+  hop   = this->hop;
+  alpha = this->alpha;
+  reset = this->resetRequested;
+  this->resetRequested = false;
+  this->mutex.unlock();
+
+  if (size == 0)
+    return;
+
+  this->configure(size, hop);
+
+  if (reset) {
+    std::fill(this->average.begin(), this->average.end(), 0);
+    this->fill = 0;
+    this->max  = 0;
+  }
+
+  if (this->direct == nullptr || this->reverse == nullptr)
+    return;
+
+  // Overlap-save: slide the window by `hop` samples after every block
+  while (p < this->input.size()) {
+    got = std::min(this->currSize - this->fill, this->input.size() - p);
+    memcpy(
+          this->window.data() + this->fill,
+          this->input.data() + p,
+          got * sizeof(SUCOMPLEX));
+    this->fill += got;
+    p += got;
+
+    if (this->fill == this->currSize) {
+      this->compute(alpha);
+      computed = true;
+
+      memmove(
+            this->window.data(),
+            this->window.data() + this->currHop,
+            (this->currSize - this->currHop) * sizeof(SUCOMPLEX));
+      this->fill = this->currSize - this->currHop;
+    }
+  }
+
+  if (computed) {
+    QMutexLocker locker(&this->mutex);
+
+    // A resize may have been requested meanwhile. Do not publish a block
+    // of the old size in that case.
+    if (this->resetRequested)
+      return;
+
+    this->result = this->average;
+
+    if (!this->resultQueued) {
+      this->resultQueued = true;
+      emit resultReady();
+    }
+  }
+}
@@ -0,0 +1,86 @@
+//
+//    FACWorker.h: Streaming fast autocorrelation worker
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef FACWORKER_H
+#define FACWORKER_H
+
+#include <QObject>
+#include <QMutex>
+#include <vector>
+#include <sigutils/types.h>
+
+// Samples waiting for the worker are bounded to this many FFT lengths.
+// Older samples are dropped if the worker cannot keep up.
+#define SIGDIGGER_FAC_WORKER_MAX_PENDING_BLOCKS 4
+
+namespace SigDigger {
+  //
+  // Computes the fast autocorrelation of a sample stream in its own
+  // thread. Every `hop` new samples, the last `size` samples are
+  // transformed (overlap-save), and the normalized |r[k]| is folded into
+  // an exponentially averaged estimate with factor `alpha`.
+  //
+  class FACWorker : public QObject
+  {
+    Q_OBJECT
+
+    // Shared with the GUI thread
+    QMutex mutex;
+    std::vector<SUCOMPLEX> pending;
+    std::vector<SUCOMPLEX> result;
+    unsigned int size = 0;
+    unsigned int hop = 0;
+    SUFLOAT alpha = 1;
+    bool resetRequested = false;
+    bool processQueued = false;
+    bool resultQueued = false;
+
+    // Owned by the worker thread
+    unsigned int currSize = 0;
+    unsigned int currHop = 0;
+    std::vector<SUCOMPLEX> window;
+    std::vector<SUCOMPLEX> scratch;
+    std::vector<SUCOMPLEX> average;
+    std::vector<SUCOMPLEX> input;
+    SU_FFTW(_plan) direct = nullptr;
+    SU_FFTW(_plan) reverse = nullptr;
+    size_t fill = 0;
+    SUFLOAT max = 0;
+
+    void configure(unsigned int size, unsigned int hop);
+    void compute(SUFLOAT alpha);
+
+  public:
+    explicit FACWorker(QObject *parent = nullptr);
+
+    // Called from the GUI thread
+    void setParams(unsigned int size, unsigned int hop, SUFLOAT alpha);
+    void reset(void);
+    void push(const SUCOMPLEX *data, size_t len);
+    void takeResult(std::vector<SUCOMPLEX> &dest);
+
+  signals:
+    void processRequested(void);
+    void resultReady(void);
+
+  public slots:
+    void process(void);
+  };
+}
+
+#endif // FACWORKER_H
@@ -0,0 +1,392 @@
+//
+//    GLConstellation.cpp: OpenGL density constellation
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "GLConstellation.h"
+#include <sigutils/log.h>
+#include <QOpenGLContext>
+#include <cmath>
+
+#ifndef GL_RGBA16F
+#  define GL_RGBA16F 0x881A
+#endif // GL_RGBA16F
+
+using namespace SigDigger;
+
+static const char *pointVertexShader =
+    "attribute vec2 position;\n"
+    "uniform float scale;\n"
+    "void main() {\n"
+    "  gl_Position = vec4(position * scale, 0., 1.);\n"
+    "}\n";
+
+static const char *quadVertexShader =
+    "attribute vec2 position;\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "  uv = .5 * position + .5;\n"
+    "  gl_Position = vec4(position, 0., 1.);\n"
+    "}\n";
+
+// Also used to draw the axes
+static const char *colorFragmentShader =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform vec4 color;\n"
+    "void main() {\n"
+    "  gl_FragColor = color;\n"
+    "}\n";
+
+static const char *displayFragmentShader =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D density;\n"
+    "uniform vec4 foreground;\n"
+    "uniform vec4 background;\n"
+    "uniform float gain;\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "  float d = texture2D(density, uv).r;\n"
+    "  gl_FragColor = mix(background, foreground, 1. - exp(-gain * d));\n"
+    "}\n";
+
+// Full-screen quad (triangle strip) followed by the axes (lines)
+static const GLfloat quadVertices[] = {
+  -1, -1,   1, -1,  -1,  1,   1,  1,
+  -1,  0,   1,  0,   0, -1,   0,  1
+};
+
+GLConstellation::GLConstellation(QWidget *parent) :
+  QOpenGLWidget(parent),
+  pointBuffer(QOpenGLBuffer::VertexBuffer),
+  quadBuffer(QOpenGLBuffer::VertexBuffer)
+{
+  this->pointBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+  this->quadBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+}
+
+GLConstellation::~GLConstellation()
+{
+  this->onContextDestroyed();
+}
+
+std::unique_ptr<QOpenGLShaderProgram>
+GLConstellation::makeProgram(const char *vertex, const char *fragment)
+{
+  std::unique_ptr<QOpenGLShaderProgram> program(new QOpenGLShaderProgram());
+
+  if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertex)
+      || !program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragment)) {
+    SU_ERROR(
+          "GLConstellation: cannot compile shaders: %s\n",
+          program->log().toStdString().c_str());
+    return nullptr;
+  }
+
+  program->bindAttributeLocation("position", 0);
+
+  if (!program->link()) {
+    SU_ERROR(
+          "GLConstellation: cannot link program: %s\n",
+          program->log().toStdString().c_str());
+    return nullptr;
+  }
+
+  return program;
+}
+
+bool
+GLConstellation::makePrograms(void)
+{
+  this->pointProgram   = this->makeProgram(
+        pointVertexShader,
+        colorFragmentShader);
+  this->decayProgram   = this->makeProgram(
+        quadVertexShader,
+        colorFragmentShader);
+  this->displayProgram = this->makeProgram(
+        quadVertexShader,
+        displayFragmentShader);
+
+  return this->pointProgram
+      && this->decayProgram
+      && this->displayProgram;
+}
+
+//
+// Densities are accumulated in a half float texture where available, so
+// that dense clusters do not saturate. 8 bit textures still work, with
+// less dynamic range.
+//
+void
+GLConstellation::makeAccumulator(void)
+{
+  QOpenGLFramebufferObjectFormat format;
+  qreal ratio = this->devicePixelRatioF();
+  QSize size(
+        qMax(1, static_cast<int>(this->width() * ratio)),
+        qMax(1, static_cast<int>(this->height() * ratio)));
+
+  format.setInternalTextureFormat(GL_RGBA16F);
+  this->accum.reset(new QOpenGLFramebufferObject(size, format));
+
+  if (!this->accum->isValid())
+    this->accum.reset(new QOpenGLFramebufferObject(size));
+
+  this->accum->bind();
+  glClearColor(0, 0, 0, 0);
+  glClear(GL_COLOR_BUFFER_BIT);
+  this->accum->release();
+}
+
+void
+GLConstellation::initializeGL(void)
+{
+  this->initializeOpenGLFunctions();
+
+  // Reparenting into a different window brings a new context
+  connect(
+        this->context(),
+        SIGNAL(aboutToBeDestroyed(void)),
+        this,
+        SLOT(onContextDestroyed(void)));
+
+  if (!this->makePrograms())
+    return;
+
+  this->quadBuffer.create();
+  this->quadBuffer.bind();
+  this->quadBuffer.allocate(quadVertices, sizeof(quadVertices));
+  this->quadBuffer.release();
+
+  this->pointBuffer.create();
+
+  this->makeAccumulator();
+  this->frameTimer.start();
+
+  this->initialized = true;
+}
+
+void
+GLConstellation::resizeGL(int, int)
+{
+  if (this->initialized)
+    this->makeAccumulator();
+}
+
+//
+// Scales the accumulated density by factor. The constant subtracted
+// on top of that makes sure 8 bit textures do not get stuck at a few
+// levels above zero because of rounding.
+//
+void
+GLConstellation::decay(qreal factor)
+{
+  GLfloat f = static_cast<GLfloat>(factor);
+
+  this->decayProgram->bind();
+  this->decayProgram->setUniformValue("color", 1.f / 255, 0.f, 0.f, 0.f);
+
+  glEnable(GL_BLEND);
+  glBlendEquation(GL_FUNC_REVERSE_SUBTRACT);
+  glBlendFunc(GL_ONE, GL_CONSTANT_COLOR);
+  glBlendColor(f, f, f, f);
+
+  this->quadBuffer.bind();
+  this->decayProgram->enableAttributeArray(0);
+  this->decayProgram->setAttributeBuffer(0, GL_FLOAT, 0, 2);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  this->decayProgram->disableAttributeArray(0);
+  this->quadBuffer.release();
+
+  glBlendEquation(GL_FUNC_ADD);
+  glDisable(GL_BLEND);
+}
+
+void
+GLConstellation::accumulate(void)
+{
+  GLfloat level = SIGDIGGER_GL_CONSTELLATION_HIT_LEVEL;
+
+  if (this->pending.empty())
+    return;
+
+  // SUCOMPLEX is laid out as (I, Q): samples are vertices already
+  this->pointBuffer.bind();
+  this->pointBuffer.allocate(
+        this->pending.data(),
+        static_cast<int>(this->pending.size() * sizeof(SUCOMPLEX)));
+
+  this->pointProgram->bind();
+  this->pointProgram->setUniformValue(
+        "scale",
+        1.f / SIGDIGGER_GL_CONSTELLATION_RANGE);
+  this->pointProgram->setUniformValue("color", level, level, level, level);
+  this->pointProgram->enableAttributeArray(0);
+  this->pointProgram->setAttributeBuffer(
+        0,
+        GL_FLOAT,
+        0,
+        2,
+        sizeof(SUCOMPLEX));
+
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+  glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(this->pending.size()));
+  glDisable(GL_BLEND);
+
+  this->pointProgram->disableAttributeArray(0);
+  this->pointBuffer.release();
+
+  this->pending.clear();
+}
+
+void
+GLConstellation::display(void)
+{
+  this->displayProgram->bind();
+  this->displayProgram->setUniformValue("density", 0);
+  this->displayProgram->setUniformValue("foreground", this->foreground);
+  this->displayProgram->setUniformValue("background", this->background);
+  this->displayProgram->setUniformValue(
+        "gain",
+        SIGDIGGER_GL_CONSTELLATION_GAIN);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, this->accum->texture());
+
+  this->quadBuffer.bind();
+  this->displayProgram->enableAttributeArray(0);
+  this->displayProgram->setAttributeBuffer(0, GL_FLOAT, 0, 2);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  this->displayProgram->disableAttributeArray(0);
+
+  // Axes, through the center
+  this->pointProgram->bind();
+  this->pointProgram->setUniformValue("scale", 1.f);
+  this->pointProgram->setUniformValue("color", this->axes);
+  this->pointProgram->enableAttributeArray(0);
+  this->pointProgram->setAttributeBuffer(0, GL_FLOAT, 0, 2);
+  glDrawArrays(GL_LINES, 4, 4);
+  this->pointProgram->disableAttributeArray(0);
+  this->quadBuffer.release();
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void
+GLConstellation::paintGL(void)
+{
+  qreal elapsed;
+
+  if (!this->initialized) {
+    glClearColor(
+          static_cast<GLfloat>(this->background.redF()),
+          static_cast<GLfloat>(this->background.greenF()),
+          static_cast<GLfloat>(this->background.blueF()),
+          1);
+    glClear(GL_COLOR_BUFFER_BIT);
+    return;
+  }
+
+  elapsed = static_cast<qreal>(this->frameTimer.restart());
+
+  this->accum->bind();
+  glViewport(0, 0, this->accum->width(), this->accum->height());
+  this->decay(std::exp(-elapsed / this->persistence));
+  this->accumulate();
+  // Releasing binds the widget's own framebuffer back
+  this->accum->release();
+
+  glViewport(
+        0,
+        0,
+        static_cast<GLsizei>(this->width() * this->devicePixelRatioF()),
+        static_cast<GLsizei>(this->height() * this->devicePixelRatioF()));
+  this->display();
+
+  // Keep fading out for a while after the last block
+  if (this->feedTimer.isValid()
+      && this->feedTimer.elapsed() < 5 * this->persistence)
+    this->update();
+}
+
+void
+GLConstellation::feed(const SUCOMPLEX *data, unsigned int size)
+{
+  size_t room = SIGDIGGER_GL_CONSTELLATION_MAX_PENDING - this->pending.size();
+
+  // More than a frame can take: keep the first points
+  if (size > room)
+    size = static_cast<unsigned int>(room);
+
+  this->pending.insert(this->pending.end(), data, data + size);
+  this->feedTimer.start();
+
+  this->update();
+}
+
+void
+GLConstellation::setForegroundColor(QColor const &color)
+{
+  this->foreground = color;
+  this->update();
+}
+
+void
+GLConstellation::setBackgroundColor(QColor const &color)
+{
+  this->background = color;
+  this->update();
+}
+
+void
+GLConstellation::setAxesColor(QColor const &color)
+{
+  this->axes = color;
+  this->update();
+}
+
+void
+GLConstellation::setPersistence(qreal ms)
+{
+  if (ms > 0)
+    this->persistence = ms;
+}
+
+////////////////////////////////// Slots ///////////////////////////////////////
+void
+GLConstellation::onContextDestroyed(void)
+{
+  if (!this->initialized)
+    return;
+
+  this->makeCurrent();
+
+  this->accum.reset();
+  this->pointBuffer.destroy();
+  this->quadBuffer.destroy();
+  this->pointProgram.reset();
+  this->decayProgram.reset();
+  this->displayProgram.reset();
+
+  this->doneCurrent();
+
+  this->initialized = false;
+}
@@ -0,0 +1,106 @@
+//
+//    GLConstellation.h: OpenGL density constellation
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef GLCONSTELLATION_H
+#define GLCONSTELLATION_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFramebufferObject>
+#include <QElapsedTimer>
+#include <QColor>
+#include <sigutils/types.h>
+#include <memory>
+#include <vector>
+
+// Amplitude shown at the edges of the plot
+#define SIGDIGGER_GL_CONSTELLATION_RANGE          1.25f
+
+// Time (ms) it takes the density to fall to 1/e once points stop hitting
+#define SIGDIGGER_GL_CONSTELLATION_PERSISTENCE_MS 250.
+
+// Density added by a single point, and points kept between two frames
+#define SIGDIGGER_GL_CONSTELLATION_HIT_LEVEL      (1.f / 64.f)
+#define SIGDIGGER_GL_CONSTELLATION_MAX_PENDING    (1 << 18)
+
+// Density at which the plot gets 1 - 1/e of the way to the foreground
+#define SIGDIGGER_GL_CONSTELLATION_GAIN           3.f
+
+namespace SigDigger {
+  //
+  // Constellation drawn as a density plot. Sample blocks are uploaded
+  // as they are (I/Q pairs are already 2D vertices) and every point adds
+  // up into an accumulation texture that decays over time. Feeding it
+  // costs a copy of the block: there is no per-point work in the CPU,
+  // so it needs no decimation.
+  //
+  class GLConstellation : public QOpenGLWidget, protected QOpenGLFunctions
+  {
+    Q_OBJECT
+
+    std::vector<SUCOMPLEX> pending;
+    QColor foreground = QColor(0xff, 0xff, 0);
+    QColor background = Qt::black;
+    QColor axes       = QColor(0x80, 0x80, 0x80);
+    qreal persistence = SIGDIGGER_GL_CONSTELLATION_PERSISTENCE_MS;
+
+    // GL resources, bound to the current context
+    bool initialized = false;
+    QOpenGLBuffer pointBuffer;
+    QOpenGLBuffer quadBuffer;
+    std::unique_ptr<QOpenGLShaderProgram> pointProgram;
+    std::unique_ptr<QOpenGLShaderProgram> decayProgram;
+    std::unique_ptr<QOpenGLShaderProgram> displayProgram;
+    std::unique_ptr<QOpenGLFramebufferObject> accum;
+
+    QElapsedTimer frameTimer; // Since last frame
+    QElapsedTimer feedTimer;  // Since last block
+
+    std::unique_ptr<QOpenGLShaderProgram> makeProgram(
+        const char *vertex,
+        const char *fragment);
+    bool makePrograms(void);
+    void makeAccumulator(void);
+    void decay(qreal factor);
+    void accumulate(void);
+    void display(void);
+
+  protected:
+    void initializeGL(void) override;
+    void resizeGL(int w, int h) override;
+    void paintGL(void) override;
+
+  public:
+    explicit GLConstellation(QWidget *parent = nullptr);
+    ~GLConstellation() override;
+
+    void feed(const SUCOMPLEX *data, unsigned int size);
+
+    void setForegroundColor(QColor const &);
+    void setBackgroundColor(QColor const &);
+    void setAxesColor(QColor const &);
+    void setPersistence(qreal ms);
+
+  public slots:
+    void onContextDestroyed(void);
+  };
+}
+
+#endif // GLCONSTELLATION_H
@@ -0,0 +1,461 @@
+//
+//    GLTVDisplay.cpp: OpenGL analog TV picture display
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "GLTVDisplay.h"
+#include <sigutils/log.h>
+#include <QOpenGLContext>
+#include <QMatrix4x4>
+#include <QImage>
+#include <cmath>
+
+#ifndef GL_RGBA16F
+#  define GL_RGBA16F 0x881A
+#endif // GL_RGBA16F
+
+// Frames are uploaded straight from the frame buffer
+static_assert(
+    sizeof(SUFLOAT) == sizeof(GLfloat),
+    "GLTVDisplay needs single precision frames");
+
+using namespace SigDigger;
+
+static const char *vertexShader =
+    "attribute vec2 position;\n"
+    "uniform mat4 transform;\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "  uv = .5 * position + .5;\n"
+    "  gl_Position = transform * vec4(position, 0., 1.);\n"
+    "}\n";
+
+static const char *blendFragmentShader =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D frame;\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "  gl_FragColor = vec4(texture2D(frame, uv).r, 0., 0., 1.);\n"
+    "}\n";
+
+static const char *displayFragmentShader =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D picture;\n"
+    "uniform float gain;\n"
+    "uniform float brightness;\n"
+    "uniform float gamma;\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "  float y = clamp(brightness + gain * texture2D(picture, uv).r, 0., 1.);\n"
+    "  gl_FragColor = vec4(vec3(pow(y, gamma)), 1.);\n"
+    "}\n";
+
+static const GLfloat quadVertices[] = {
+  -1, -1,   1, -1,  -1,  1,   1,  1
+};
+
+GLTVDisplay::GLTVDisplay(QWidget *parent) :
+  QOpenGLWidget(parent),
+  quadBuffer(QOpenGLBuffer::VertexBuffer)
+{
+  this->quadBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+}
+
+GLTVDisplay::~GLTVDisplay()
+{
+  this->onContextDestroyed();
+}
+
+QSize
+GLTVDisplay::sizeHint(void) const
+{
+  return QSize(this->picWidth * this->zoom, this->picHeight * this->zoom);
+}
+
+std::unique_ptr<QOpenGLShaderProgram>
+GLTVDisplay::makeProgram(const char *fragment)
+{
+  std::unique_ptr<QOpenGLShaderProgram> program(new QOpenGLShaderProgram());
+
+  if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShader)
+      || !program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragment)) {
+    SU_ERROR(
+          "GLTVDisplay: cannot compile shaders: %s\n",
+          program->log().toStdString().c_str());
+    return nullptr;
+  }
+
+  program->bindAttributeLocation("position", 0);
+
+  if (!program->link()) {
+    SU_ERROR(
+          "GLTVDisplay: cannot link program: %s\n",
+          program->log().toStdString().c_str());
+    return nullptr;
+  }
+
+  return program;
+}
+
+//
+// The accumulated picture has the size of the frames, so that averaging
+// does not depend on the size of the widget.
+//
+void
+GLTVDisplay::makeAccumulator(void)
+{
+  QOpenGLFramebufferObjectFormat format;
+  QSize size(this->textureWidth, this->textureHeight);
+
+  format.setInternalTextureFormat(GL_RGBA16F);
+  this->accum.reset(new QOpenGLFramebufferObject(size, format));
+
+  if (!this->accum->isValid())
+    this->accum.reset(new QOpenGLFramebufferObject(size));
+
+  this->accum->bind();
+  glClearColor(0, 0, 0, 0);
+  glClear(GL_COLOR_BUFFER_BIT);
+  this->accum->release();
+
+  glBindTexture(GL_TEXTURE_2D, this->accum->texture());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  this->accumCount = 0;
+}
+
+void
+GLTVDisplay::refreshGeometry(void)
+{
+  this->setMinimumSize(this->sizeHint());
+  this->updateGeometry();
+  this->update();
+}
+
+void
+GLTVDisplay::initializeGL(void)
+{
+  this->initializeOpenGLFunctions();
+
+  // Reparenting into a different window brings a new context
+  connect(
+        this->context(),
+        SIGNAL(aboutToBeDestroyed(void)),
+        this,
+        SLOT(onContextDestroyed(void)));
+
+  this->blendProgram   = this->makeProgram(blendFragmentShader);
+  this->displayProgram = this->makeProgram(displayFragmentShader);
+
+  if (!this->blendProgram || !this->displayProgram)
+    return;
+
+  this->quadBuffer.create();
+  this->quadBuffer.bind();
+  this->quadBuffer.allocate(quadVertices, sizeof(quadVertices));
+  this->quadBuffer.release();
+
+  glGenTextures(1, &this->frameTexture);
+  glBindTexture(GL_TEXTURE_2D, this->frameTexture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  this->textureWidth = this->textureHeight = 0;
+  this->haveFrame = false;
+  this->initialized = true;
+}
+
+//
+// Uploads the frame and blends it into the accumulated picture. Called
+// with the context current.
+//
+void
+GLTVDisplay::upload(const struct sigutils_tv_frame_buffer *frame)
+{
+  GLfloat alpha = 1;
+  bool resized =
+      frame->width != this->textureWidth
+      || frame->height != this->textureHeight;
+
+  glBindTexture(GL_TEXTURE_2D, this->frameTexture);
+
+  if (resized) {
+    this->textureWidth  = frame->width;
+    this->textureHeight = frame->height;
+    glTexImage2D(
+          GL_TEXTURE_2D,
+          0,
+          GL_LUMINANCE,
+          frame->width,
+          frame->height,
+          0,
+          GL_LUMINANCE,
+          GL_FLOAT,
+          frame->buffer);
+    this->makeAccumulator();
+    glBindTexture(GL_TEXTURE_2D, this->frameTexture);
+  } else {
+    glTexSubImage2D(
+          GL_TEXTURE_2D,
+          0,
+          0,
+          0,
+          frame->width,
+          frame->height,
+          GL_LUMINANCE,
+          GL_FLOAT,
+          frame->buffer);
+  }
+
+  if (this->accumulate) {
+    if (this->enableSPLPF)
+      alpha = static_cast<GLfloat>(this->accumAlpha);
+    else
+      alpha = 1.f / static_cast<GLfloat>(this->accumCount + 1);
+
+    ++this->accumCount;
+  }
+
+  this->accum->bind();
+  glViewport(0, 0, this->textureWidth, this->textureHeight);
+
+  this->blendProgram->bind();
+  this->blendProgram->setUniformValue("transform", QMatrix4x4());
+  this->blendProgram->setUniformValue("frame", 0);
+
+  glActiveTexture(GL_TEXTURE0);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+  glBlendColor(0, 0, 0, alpha);
+
+  this->quadBuffer.bind();
+  this->blendProgram->enableAttributeArray(0);
+  this->blendProgram->setAttributeBuffer(0, GL_FLOAT, 0, 2);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  this->blendProgram->disableAttributeArray(0);
+  this->quadBuffer.release();
+
+  glDisable(GL_BLEND);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  // Releasing binds the widget's own framebuffer back
+  this->accum->release();
+
+  this->haveFrame = true;
+}
+
+void
+GLTVDisplay::paintGL(void)
+{
+  QMatrix4x4 transform;
+  qreal ratio = this->devicePixelRatioF();
+  float width  = static_cast<float>(this->width());
+  float height = static_cast<float>(this->height());
+  float fit;
+
+  glClearColor(0, 0, 0, 1);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  if (!this->initialized || !this->haveFrame || width < 1 || height < 1)
+    return;
+
+  // Fit the picture in the widget, then rotate it around the center.
+  // The first line of the frame is the bottom row of the texture.
+  fit = qMin(
+        width / static_cast<float>(this->textureWidth),
+        height / static_cast<float>(this->textureHeight));
+
+  transform.scale(2.f / width, 2.f / height);
+  transform.rotate(static_cast<float>(this->rotation), 0, 0, 1);
+  transform.scale(
+        .5f * fit * this->textureWidth * (this->hFlip ? -1 : 1),
+        .5f * fit * this->textureHeight * (this->vFlip ? 1 : -1));
+
+  glViewport(
+        0,
+        0,
+        static_cast<GLsizei>(width * ratio),
+        static_cast<GLsizei>(height * ratio));
+
+  this->displayProgram->bind();
+  this->displayProgram->setUniformValue("transform", transform);
+  this->displayProgram->setUniformValue("picture", 0);
+  this->displayProgram->setUniformValue(
+        "gain",
+        static_cast<GLfloat>(std::exp(2 * this->contrast)));
+  this->displayProgram->setUniformValue(
+        "brightness",
+        static_cast<GLfloat>(this->brightness));
+  this->displayProgram->setUniformValue(
+        "gamma",
+        static_cast<GLfloat>(this->gamma));
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, this->accum->texture());
+
+  this->quadBuffer.bind();
+  this->displayProgram->enableAttributeArray(0);
+  this->displayProgram->setAttributeBuffer(0, GL_FLOAT, 0, 2);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  this->displayProgram->disableAttributeArray(0);
+  this->quadBuffer.release();
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void
+GLTVDisplay::putFrame(const struct sigutils_tv_frame_buffer *frame)
+{
+  // Nothing to draw on yet: the widget was never shown
+  if (!this->initialized)
+    return;
+
+  this->makeCurrent();
+  this->upload(frame);
+  this->doneCurrent();
+}
+
+void
+GLTVDisplay::setPicGeometry(int width, int height)
+{
+  if (this->picWidth != width || this->picHeight != height) {
+    this->picWidth  = width;
+    this->picHeight = height;
+    this->refreshGeometry();
+  }
+}
+
+bool
+GLTVDisplay::saveToFile(QString const &path)
+{
+  return this->grabFramebuffer().save(path);
+}
+
+void
+GLTVDisplay::invalidate(void)
+{
+  this->update();
+}
+
+void
+GLTVDisplay::setContrast(qreal contrast)
+{
+  this->contrast = contrast;
+  this->update();
+}
+
+void
+GLTVDisplay::setBrightness(qreal brightness)
+{
+  this->brightness = brightness;
+  this->update();
+}
+
+void
+GLTVDisplay::setGamma(qreal gamma)
+{
+  this->gamma = gamma;
+  this->update();
+}
+
+void
+GLTVDisplay::setRotation(qreal degrees)
+{
+  this->rotation = degrees;
+  this->update();
+}
+
+void
+GLTVDisplay::setHorizontalFlip(bool flip)
+{
+  this->hFlip = flip;
+  this->update();
+}
+
+void
+GLTVDisplay::setVerticalFlip(bool flip)
+{
+  this->vFlip = flip;
+  this->update();
+}
+
+void
+GLTVDisplay::setZoom(int zoom)
+{
+  if (zoom < 1)
+    zoom = 1;
+
+  if (this->zoom != zoom) {
+    this->zoom = zoom;
+    this->refreshGeometry();
+  }
+}
+
+void
+GLTVDisplay::setAccumulate(bool accumulate)
+{
+  if (this->accumulate != accumulate) {
+    this->accumulate = accumulate;
+    this->accumCount = 0;
+  }
+}
+
+void
+GLTVDisplay::setEnableSPLPF(bool enable)
+{
+  this->enableSPLPF = enable;
+  this->accumCount = 0;
+}
+
+void
+GLTVDisplay::setAccumAlpha(SUFLOAT alpha)
+{
+  this->accumAlpha = alpha;
+}
+
+////////////////////////////////// Slots ///////////////////////////////////////
+void
+GLTVDisplay::onContextDestroyed(void)
+{
+  if (!this->initialized)
+    return;
+
+  this->makeCurrent();
+
+  this->accum.reset();
+  this->quadBuffer.destroy();
+  this->blendProgram.reset();
+  this->displayProgram.reset();
+
+  if (this->frameTexture != 0) {
+    glDeleteTextures(1, &this->frameTexture);
+    this->frameTexture = 0;
+  }
+
+  this->doneCurrent();
+
+  this->initialized = false;
+  this->haveFrame = false;
+}
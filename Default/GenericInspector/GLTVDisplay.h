@@ -0,0 +1,107 @@
+//
+//    GLTVDisplay.h: OpenGL analog TV picture display
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef GLTVDISPLAY_H
+#define GLTVDISPLAY_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFramebufferObject>
+#include <sigutils/types.h>
+#include <sigutils/tvproc.h>
+#include <memory>
+
+namespace SigDigger {
+  //
+  // Drop-in replacement of TVDisplay that does all the picture work in
+  // the GPU. Frames are uploaded as they are (one float luminance value
+  // per pixel), averaged into the accumulation framebuffer by blending,
+  // and contrast, brightness, gamma and the picture geometry are applied
+  // while drawing.
+  //
+  class GLTVDisplay : public QOpenGLWidget, protected QOpenGLFunctions
+  {
+    Q_OBJECT
+
+    int picWidth = 0;
+    int picHeight = 0;
+    qreal contrast = 0;
+    qreal brightness = 0;
+    qreal gamma = 1;
+    qreal rotation = 0;
+    bool hFlip = false;
+    bool vFlip = false;
+    int zoom = 1;
+
+    // Accumulation: exponential average when the single pole LPF is on,
+    // plain average of every frame since enabled otherwise.
+    bool accumulate = false;
+    bool enableSPLPF = false;
+    SUFLOAT accumAlpha = 1;
+    unsigned int accumCount = 0;
+
+    // GL resources, bound to the current context
+    bool initialized = false;
+    bool haveFrame = false;
+    GLuint frameTexture = 0;
+    int textureWidth = 0;
+    int textureHeight = 0;
+    QOpenGLBuffer quadBuffer;
+    std::unique_ptr<QOpenGLShaderProgram> blendProgram;
+    std::unique_ptr<QOpenGLShaderProgram> displayProgram;
+    std::unique_ptr<QOpenGLFramebufferObject> accum;
+
+    std::unique_ptr<QOpenGLShaderProgram> makeProgram(const char *fragment);
+    void makeAccumulator(void);
+    void refreshGeometry(void);
+    void upload(const struct sigutils_tv_frame_buffer *frame);
+
+  protected:
+    void initializeGL(void) override;
+    void paintGL(void) override;
+
+  public:
+    explicit GLTVDisplay(QWidget *parent = nullptr);
+    ~GLTVDisplay() override;
+
+    QSize sizeHint(void) const override;
+
+    void putFrame(const struct sigutils_tv_frame_buffer *frame);
+    void setPicGeometry(int width, int height);
+    bool saveToFile(QString const &path);
+    void invalidate(void);
+
+    void setContrast(qreal);
+    void setBrightness(qreal);
+    void setGamma(qreal);
+    void setRotation(qreal degrees);
+    void setHorizontalFlip(bool);
+    void setVerticalFlip(bool);
+    void setZoom(int);
+    void setAccumulate(bool);
+    void setEnableSPLPF(bool);
+    void setAccumAlpha(SUFLOAT);
+
+  public slots:
+    void onContextDestroyed(void);
+  };
+}
+
+#endif // GLTVDISPLAY_H
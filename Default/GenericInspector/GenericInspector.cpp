@@ -21,6 +21,8 @@
 #include "GenericInspector.h"
 #include <SuWidgetsHelpers.h>
 #include <UIMediator.h>
+#include <LoadGovernor.h>
+#include <QApplication>
 
 using namespace SigDigger;
 
@@ -41,6 +43,7 @@ GenericInspectorConfig::deserialize(Suscan::Object const &conf)
   LOAD(units);
   LOAD(gain);
   LOAD(zeroPoint);
+  LOAD(plotPoints);
 }
 
 Suscan::Object &&
@@ -60,6 +63,7 @@ GenericInspectorConfig::serialize(void)
   STORE(units);
   STORE(gain);
   STORE(zeroPoint);
+  STORE(plotPoints);
 
   return this->persist(obj);
 }
@@ -100,6 +104,18 @@ GenericInspector::GenericInspector(
         this,
         SLOT(onSetSpectrumSource(unsigned int)));
 
+  this->connect(
+        this->ui,
+        SIGNAL(spectrumVisibilityChanged(void)),
+        this,
+        SLOT(onSpectrumVisibilityChanged(void)));
+
+  this->connect(
+        this->ui,
+        SIGNAL(estimatorVisibilityChanged(void)),
+        this,
+        SLOT(onEstimatorVisibilityChanged(void)));
+
   this->connect(
         this->ui,
         SIGNAL(loChanged(void)),
@@ -142,6 +158,18 @@ GenericInspector::GenericInspector(
         this,
         SLOT(onOpenInspector(QString, qint64, qreal, bool)));
 
+  connect(
+        LoadGovernor::instance(),
+        SIGNAL(levelChanged(int)),
+        this,
+        SLOT(onShedStateChanged(void)));
+
+  connect(
+        qApp,
+        SIGNAL(focusChanged(QWidget *, QWidget *)),
+        this,
+        SLOT(onShedStateChanged(void)));
+
   for (auto p = request.spectSources.begin();
        p != request.spectSources.end();
        ++p)
@@ -157,12 +185,6 @@ void
 GenericInspector::attachAnalyzer(Suscan::Analyzer *analyzer)
 {
   this->ui->setState(InspectorUI::ATTACHED);
-
-  connect(
-        analyzer,
-        SIGNAL(source_info_message(Suscan::SourceInfoMessage const &)),
-        this,
-        SLOT(onSourceInfoMessage(Suscan::SourceInfoMessage const &)));
 }
 
 void
@@ -217,6 +239,16 @@ GenericInspector::setTimeStamp(struct timeval const &tv)
   this->ui->setTimeStamp(tv);
 }
 
+void
+GenericInspector::setSourceInfo(
+    Suscan::AnalyzerSourceInfo const &info,
+    unsigned int changes)
+{
+  // Detached inspectors belong to an analyzer that is gone
+  if (m_analyzer != nullptr && (changes & Suscan::SOURCE_INFO_FREQUENCY))
+    this->ui->setTunerFrequency(info.getFrequency());
+}
+
 void
 GenericInspector::setQth(Suscan::Location const &location)
 {
@@ -255,6 +287,10 @@ GenericInspector::inspectorMessage(Suscan::InspectorMessage const &msg)
             msg.getSpectrumSourceId());
       break;
 
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_ESTIMATOR:
+      this->updateEstimator(msg.getEstimatorId(), msg.getEstimation());
+      break;
+
     case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_ORBIT_REPORT:
       this->notifyOrbitReport(msg.getOrbitReport());
       break;
@@ -272,7 +308,7 @@ GenericInspector::inspectorMessage(Suscan::InspectorMessage const &msg)
 void
 GenericInspector::samplesMessage(Suscan::SamplesMessage const &msg)
 {
-  this->feed(msg.getSamples(), msg.getCount());
+  this->ui->feed(msg);
 }
 
 std::string
@@ -346,6 +382,93 @@ GenericInspector::showEvent(QShowEvent *)
     this->ui->adjustSizes();
     this->adjusted = true;
   }
+
+  this->ui->catchUpViews();
+  this->refreshSpectrumDemand();
+}
+
+void
+GenericInspector::hideEvent(QHideEvent *)
+{
+  this->refreshSpectrumDemand();
+}
+
+//
+// At the last load shedding level, only the inspector the user is
+// working with (the one with the focus) keeps its spectrum and estimators
+//
+bool
+GenericInspector::isShed(void) const
+{
+  QWidget *focus;
+
+  if (LoadGovernor::instance()->getLevel() < LOAD_LEVEL_SUSPENDED)
+    return false;
+
+  focus = QApplication::focusWidget();
+
+  return focus == nullptr || (focus != this && !this->isAncestorOf(focus));
+}
+
+//
+// Inspector spectra are only requested while somebody can see them. When
+// the waterfall goes out of sight the spectrum source is set to none,
+// and the source selected in the UI is requested again once it is back.
+//
+void
+GenericInspector::refreshSpectrumDemand(void)
+{
+  bool wanted;
+
+  if (this->analyzer() == nullptr)
+    return;
+
+  wanted = !this->suspended
+      && !this->isShed()
+      && this->ui->isSpectrumVisible();
+
+  if (wanted != this->spectrumPaused)
+    return;
+
+  try {
+    this->analyzer()->setSpectrumSource(
+          this->request().handle,
+          wanted ? this->ui->getSpectrumSource() : 0,
+          0);
+    this->spectrumPaused = !wanted;
+  } catch (Suscan::Exception const &) {
+  }
+}
+
+//
+// Likewise, enabled estimators only run while their controls can be
+// seen. Which ones are enabled is kept by the controls themselves.
+//
+void
+GenericInspector::refreshEstimatorDemand(void)
+{
+  bool wanted;
+
+  if (this->analyzer() == nullptr)
+    return;
+
+  wanted = !this->suspended
+      && !this->isShed()
+      && this->ui->areEstimatorsVisible();
+
+  if (wanted != this->estimatorsPaused)
+    return;
+
+  try {
+    for (auto id : this->ui->getActiveEstimators())
+      this->analyzer()->setInspectorEnabled(
+            this->request().handle,
+            id,
+            wanted,
+            0);
+    this->estimatorsPaused = !wanted;
+  } catch (Suscan::Exception const &) {
+  }
 }
 
 void
@@ -408,18 +531,85 @@ GenericInspector::~GenericInspector()
 void
 GenericInspector::onConfigChanged(void)
 {
-  // TODO: Send config
-  if (this->analyzer() != nullptr) {
+  // No request id: identical configs are skipped and bursts of changes
+  // are coalesced by the analyzer
+  if (this->analyzer() != nullptr)
     this->analyzer()->setInspectorConfig(
           this->request().handle,
-          this->config(),
-          static_cast<Suscan::RequestId>(rand()));
+          this->config());
+}
+
+//
+// While suspended, the analyzer stops computing spectra and estimates for
+// this inspector. Filters, demodulator state and the whole UI are kept.
+//
+bool
+GenericInspector::suspend()
+{
+  // A retuned inspector would not be found by the channel it was opened on
+  if (this->analyzer() == nullptr || this->retuned)
+    return false;
+
+  try {
+    this->analyzer()->setSpectrumSource(this->request().handle, 0, 0);
+
+    if (!this->estimatorsPaused)
+      for (auto id : this->ui->getActiveEstimators())
+        this->analyzer()->setInspectorEnabled(
+              this->request().handle,
+              id,
+              false,
+              0);
+  } catch (Suscan::Exception const &) {
+    return false;
   }
+
+  this->suspended = true;
+  this->spectrumPaused = true;
+  this->estimatorsPaused = true;
+
+  return true;
+}
+
+void
+GenericInspector::resume()
+{
+  if (this->analyzer() == nullptr)
+    return;
+
+  this->suspended = false;
+
+  // Spectrum and estimators come back once they are shown
+  this->refreshSpectrumDemand();
+  this->refreshEstimatorDemand();
+}
+
+QJsonObject
+GenericInspector::saveSession() const
+{
+  QJsonObject obj = InspectionWidget::saveSession();
+
+  this->ui->saveSession(obj);
+
+  return obj;
+}
+
+void
+GenericInspector::restoreSession(QJsonObject const &obj)
+{
+  InspectionWidget::restoreSession(obj);
+
+  this->ui->refreshInspectorCtls();
+  this->ui->restoreSession(obj);
 }
 
 void
 GenericInspector::onSetSpectrumSource(unsigned int index)
 {
+  // Remembered by the UI, requested once the spectrum is visible
+  if (this->spectrumPaused)
+    return;
+
   if (this->analyzer() != nullptr)
     this->analyzer()->setSpectrumSource(
         this->request().handle,
@@ -427,9 +617,30 @@ GenericInspector::onSetSpectrumSource(unsigned int index)
         static_cast<Suscan::RequestId>(rand()));
 }
 
+void
+GenericInspector::onSpectrumVisibilityChanged(void)
+{
+  this->refreshSpectrumDemand();
+}
+
+void
+GenericInspector::onEstimatorVisibilityChanged(void)
+{
+  this->refreshEstimatorDemand();
+}
+
+void
+GenericInspector::onShedStateChanged(void)
+{
+  this->refreshSpectrumDemand();
+  this->refreshEstimatorDemand();
+}
+
 void
 GenericInspector::onLoChanged(void)
 {
+  this->retuned = true;
+
   if (this->analyzer() != nullptr)
     this->analyzer()->setInspectorFreq(
         this->request().handle,
@@ -440,6 +651,8 @@ GenericInspector::onLoChanged(void)
 void
 GenericInspector::onBandwidthChanged(void)
 {
+  this->retuned = true;
+
   if (this->analyzer() != nullptr)
     this->analyzer()->setInspectorBandwidth(
         this->request().handle,
@@ -450,6 +663,10 @@ GenericInspector::onBandwidthChanged(void)
 void
 GenericInspector::onToggleEstimator(Suscan::EstimatorId id, bool enabled)
 {
+  // Remembered by the control, enabled once it is visible
+  if (this->estimatorsPaused)
+    return;
+
   if (this->analyzer() != nullptr)
     this->analyzer()->setInspectorEnabled(this->request().handle, id, enabled, 0);
 }
@@ -503,12 +720,8 @@ GenericInspector::onOpenInspector(
         "GenericInspectorFactory",
         inspClass.toStdString().c_str(),
         ch,
-        precise,
+        precise
+        ? Suscan::CHANNEL_PRECISION_PRECISE
+        : Suscan::CHANNEL_PRECISION_FAST,
         this->request().handle);
 }
-
-void
-GenericInspector::onSourceInfoMessage(Suscan::SourceInfoMessage const &msg)
-{
-  this->ui->setTunerFrequency(msg.info()->getFrequency());
-}
@@ -22,6 +22,7 @@ namespace SigDigger {
     std::string  units             = "dBFS";
     float        gain              = 0;
     float        zeroPoint         = 0;
+    unsigned int plotPoints        = SIGDIGGER_INSPECTOR_UI_DEFAULT_PLOT_POINTS;
 
     void deserialize(Suscan::Object const &conf) override;
     Suscan::Object &&serialize() override;
@@ -38,6 +39,10 @@ namespace SigDigger {
       InspectorUI *ui = nullptr;
       uint32_t lastSpectrumId = 0;
       bool adjusted = false;
+      bool retuned = false;
+      bool suspended = false;
+      bool spectrumPaused = false; // Spectrum source disabled while unseen
+      bool estimatorsPaused = false; // Same, for the enabled estimators
 
       QString getInspectorTabTitle() const;
 
@@ -50,6 +55,9 @@ namespace SigDigger {
       void updateEstimator(Suscan::EstimatorId id, float val);
       void notifyOrbitReport(Suscan::OrbitReport const &);
       void disableCorrection(void);
+      bool isShed(void) const;
+      void refreshSpectrumDemand(void);
+      void refreshEstimatorDemand(void);
       void setTunerFrequency(SUFREQ freq);
       void setRealTime(bool);
       void setTimeLimits(
@@ -62,15 +70,23 @@ namespace SigDigger {
 
       void setProfile(Suscan::Source::Config &) override;
       void setTimeStamp(struct timeval const &) override;
+      void setSourceInfo(
+          Suscan::AnalyzerSourceInfo const &,
+          unsigned int changes) override;
       void setQth(Suscan::Location const &) override;
 
       void inspectorMessage(Suscan::InspectorMessage const &) override;
       void samplesMessage(Suscan::SamplesMessage const &) override;
+      bool suspend() override;
+      void resume() override;
+      QJsonObject saveSession() const override;
+      void restoreSession(QJsonObject const &) override;
 
       Suscan::Serializable *allocConfig(void) override;
       void applyConfig(void) override;
 
       void showEvent(QShowEvent *event) override;
+      void hideEvent(QHideEvent *event) override;
       void floatStart() override;
       void floatEnd() override;
 
@@ -88,6 +104,9 @@ namespace SigDigger {
       // UI slots
       void onConfigChanged(void);
       void onSetSpectrumSource(unsigned int index);
+      void onSpectrumVisibilityChanged(void);
+      void onEstimatorVisibilityChanged(void);
+      void onShedStateChanged(void);
       void onLoChanged(void);
       void onBandwidthChanged(void);
       void onToggleEstimator(Suscan::EstimatorId, bool);
@@ -99,9 +118,6 @@ namespace SigDigger {
           qint64 freq,
           qreal bw,
           bool precise);
-
-      // Analyzer slots
-      void onSourceInfoMessage(Suscan::SourceInfoMessage const &);
   };
 }
 
@@ -61,6 +61,18 @@ EstimatorControl::updateUI(void)
   this->ui->applyButton->setEnabled(this->available);
 }
 
+void
+EstimatorControl::showEvent(QShowEvent *)
+{
+  emit visibilityChanged();
+}
+
+void
+EstimatorControl::hideEvent(QHideEvent *)
+{
+  emit visibilityChanged();
+}
+
 void
 EstimatorControl::setParameterValue(float param)
 {
@@ -93,6 +105,12 @@ EstimatorControl::isParamAvailable(void) const
 }
 
 
+bool
+EstimatorControl::isEstimating(void) const
+{
+  return this->ui->estimateButton->isChecked();
+}
+
 EstimatorControl::~EstimatorControl()
 {
   delete ui;
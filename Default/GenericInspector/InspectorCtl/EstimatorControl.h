@@ -39,6 +39,10 @@ namespace SigDigger {
 
       void updateUI(void);
 
+    protected:
+      void showEvent(QShowEvent *) override;
+      void hideEvent(QHideEvent *) override;
+
     public:
       explicit EstimatorControl(QWidget *parent, Suscan::Estimator const &);
       ~EstimatorControl();
@@ -49,6 +53,7 @@ namespace SigDigger {
 
       float getParameterValue(void) const;
       bool isParamAvailable(void) const;
+      bool isEstimating(void) const;
 
     public slots:
       void onEstimate(void);
@@ -57,6 +62,7 @@ namespace SigDigger {
     signals:
       void estimatorChanged(Suscan::EstimatorId, bool);
       void apply(QString, float);
+      void visibilityChanged(void);
 
     private:
       Ui::EstimatorControl *ui;
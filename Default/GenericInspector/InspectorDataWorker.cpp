@@ -0,0 +1,333 @@
+//
+//    InspectorDataWorker.cpp: Off-GUI thread processing of inspector samples
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "InspectorDataWorker.h"
+#include "InspectorUI.h"
+#include <SampleKernels.h>
+
+using namespace SigDigger;
+
+InspectorDataWorker::InspectorDataWorker(QObject *parent) : QObject(parent)
+{
+  this->decisionBlock.setArena(&this->scratch);
+}
+
+void
+InspectorDataWorker::setDecider(Decider const &decider)
+{
+  QMutexLocker locker(&this->mutex);
+
+  this->decider = decider;
+}
+
+void
+InspectorDataWorker::setSinks(FileDataSaver *saver, SocketForwarder *fwd)
+{
+  QMutexLocker locker(&this->mutex);
+
+  if (this->dataSaver != saver)
+    this->savePacker.reset();
+
+  if (this->socketForwarder != fwd)
+    this->forwardPacker.reset();
+
+  this->dataSaver = saver;
+  this->socketForwarder = fwd;
+  this->decimCount = 0;
+}
+
+void
+InspectorDataWorker::setChannel(MultiStreamChannel *channel)
+{
+  QMutexLocker locker(&this->mutex);
+
+  if (this->channel != channel)
+    this->savePacker.reset();
+
+  this->channel = channel;
+}
+
+void
+InspectorDataWorker::setSavePacking(bool packed)
+{
+  QMutexLocker locker(&this->mutex);
+
+  this->packSaved = packed;
+}
+
+void
+InspectorDataWorker::setForwardFormat(
+    SocketForwarderFormat format,
+    SUFLOAT fullScale,
+    unsigned int decimation)
+{
+  QMutexLocker locker(&this->mutex);
+
+  if (fullScale <= 0)
+    fullScale = 1;
+
+  this->forwardFormat = format;
+  this->decimation = decimation < 1 ? 1 : decimation;
+  this->decimCount = 0;
+
+  switch (format) {
+    case SOCKET_FORWARDER_INT16:
+      this->forwardScale = INT16_MAX / fullScale;
+      break;
+
+    case SOCKET_FORWARDER_INT8:
+      this->forwardScale = INT8_MAX / fullScale;
+      break;
+
+    default:
+      this->forwardScale = 1;
+  }
+}
+
+template<typename T> static size_t
+boxcar(
+    T *dest,
+    const T *x,
+    size_t size,
+    unsigned int factor,
+    T &acc,
+    unsigned int &count)
+{
+  size_t n = 0;
+  SUFLOAT k = static_cast<SUFLOAT>(1) / static_cast<SUFLOAT>(factor);
+
+  for (size_t i = 0; i < size; ++i) {
+    acc += x[i];
+
+    if (++count == factor) {
+      dest[n++] = acc * k;
+      acc = 0;
+      count = 0;
+    }
+  }
+
+  return n;
+}
+
+void
+InspectorDataWorker::convert(const SUFLOAT *data, size_t size)
+{
+  if (this->forwardFormat == SOCKET_FORWARDER_INT16) {
+    auto converted = this->scratch.take<int16_t>(size);
+
+    SampleKernels::toInt16(
+          converted.data(),
+          data,
+          size,
+          this->forwardScale);
+
+    this->socketForwarder->write(
+          reinterpret_cast<const uint8_t *>(converted.data()),
+          size * sizeof(int16_t));
+  } else {
+    auto converted = this->scratch.take<int8_t>(size);
+
+    SampleKernels::toInt8(
+          converted.data(),
+          data,
+          size,
+          this->forwardScale);
+
+    this->socketForwarder->write(
+          reinterpret_cast<const uint8_t *>(converted.data()),
+          size * sizeof(int8_t));
+  }
+}
+
+// Symbols are forwarded as they are, unless packed
+void
+InspectorDataWorker::forward(const uint8_t *data, size_t size)
+{
+  if (this->forwardFormat == SOCKET_FORWARDER_PACKED) {
+    auto const &frames = this->forwardPacker.pack(
+          data,
+          size,
+          this->decider.getBps());
+
+    this->socketForwarder->write(frames.data(), frames.size());
+  } else {
+    this->socketForwarder->write(data, size);
+  }
+}
+
+void
+InspectorDataWorker::forward(const SUFLOAT *data, size_t size)
+{
+  if (this->decimation > 1) {
+    SUFLOAT *decim =
+        this->scratch.take<SUFLOAT>(size / this->decimation + 1).data();
+
+    size = boxcar(
+          decim,
+          data,
+          size,
+          this->decimation,
+          this->floatAcc,
+          this->decimCount);
+    data = decim;
+  }
+
+  if (size == 0)
+    return;
+
+  if (this->forwardFormat == SOCKET_FORWARDER_INT16
+      || this->forwardFormat == SOCKET_FORWARDER_INT8)
+    this->convert(data, size);
+  else
+    this->socketForwarder->write(data, size);
+}
+
+void
+InspectorDataWorker::forward(const SUCOMPLEX *data, size_t size)
+{
+  if (this->decimation > 1) {
+    SUCOMPLEX *decim =
+        this->scratch.take<SUCOMPLEX>(size / this->decimation + 1).data();
+
+    size = boxcar(
+          decim,
+          data,
+          size,
+          this->decimation,
+          this->complexAcc,
+          this->decimCount);
+    data = decim;
+  }
+
+  if (size == 0)
+    return;
+
+  if (this->forwardFormat == SOCKET_FORWARDER_INT16
+      || this->forwardFormat == SOCKET_FORWARDER_INT8)
+    this->convert(reinterpret_cast<const SUFLOAT *>(data), 2 * size);
+  else
+    this->socketForwarder->write(data, size);
+}
+
+template<typename T> void
+InspectorDataWorker::deliver(const T *data, size_t size)
+{
+  if (this->dataSaver != nullptr)
+    this->dataSaver->write(data, size);
+
+  if (this->channel != nullptr)
+    this->channel->write(data, size);
+
+  if (this->socketForwarder != nullptr)
+    this->forward(data, size);
+}
+
+void
+InspectorDataWorker::deliverSymbols(const uint8_t *symbols, size_t size)
+{
+  if (!this->packSaved) {
+    this->deliver(symbols, size);
+    return;
+  }
+
+  if (this->dataSaver != nullptr || this->channel != nullptr) {
+    auto const &frames = this->savePacker.pack(
+          symbols,
+          size,
+          this->decider.getBps());
+
+    if (this->dataSaver != nullptr)
+      this->dataSaver->write(frames.data(), frames.size());
+
+    if (this->channel != nullptr)
+      this->channel->write(frames.data(), frames.size());
+  }
+
+  if (this->socketForwarder != nullptr)
+    this->forward(symbols, size);
+}
+
+void
+InspectorDataWorker::process(Suscan::SamplesMessage msg, int dataVar)
+{
+  QMutexLocker locker(&this->mutex);
+  ScratchArena::Frame frame(this->scratch);
+  const SUCOMPLEX *data = msg.getSamples();
+  unsigned int size = msg.getCount();
+  ScratchSpan<SUFLOAT> floats;
+
+  if (this->dataSaver == nullptr
+      && this->channel == nullptr
+      && this->socketForwarder == nullptr)
+    return;
+
+  switch (dataVar) {
+    case SIGDIGGER_INSPECTOR_UI_DECISION_SPACE:
+      switch (this->decider.getDecisionMode()) {
+        case Decider::MODULUS:
+          this->decisionBlock.modulus(data, size);
+          break;
+
+        case Decider::ARGUMENT: {
+          SUFLOAT *arg;
+
+          this->decisionBlock.argument(data, size, true);
+          arg = this->decisionBlock.data();
+
+          for (unsigned i = 0; i < size; ++i)
+            arg[i] /= PI;
+          break;
+        }
+      }
+
+      // Decision space: deliver floats
+      this->deliver(this->decisionBlock.data(), size);
+      break;
+
+    case SIGDIGGER_INSPECTOR_UI_SOFT_BITS:
+      // Pure softbits: deliver complex I/Q samples
+      this->deliver(data, size);
+      break;
+
+    case SIGDIGGER_INSPECTOR_UI_SOFT_BITS_I:
+      floats = this->scratch.take<SUFLOAT>(size);
+      for (unsigned i = 0; i < size; ++i)
+        floats[i] = SU_C_REAL(data[i]);
+
+      this->deliver(floats.data(), size);
+      break;
+
+    case SIGDIGGER_INSPECTOR_UI_SOFT_BITS_Q:
+      floats = this->scratch.take<SUFLOAT>(size);
+      for (unsigned i = 0; i < size; ++i)
+        floats[i] = SU_C_IMAG(data[i]);
+
+      this->deliver(floats.data(), size);
+      break;
+
+    case SIGDIGGER_INSPECTOR_UI_SYMBOLS:
+      if (this->decider.getBps() > 0) {
+        this->decider.feed(data, size);
+        this->deliverSymbols(
+              this->decider.get().data(),
+              this->decider.get().size());
+      }
+      break;
+  }
+}
@@ -0,0 +1,105 @@
+//
+//    InspectorDataWorker.h: Off-GUI thread processing of inspector samples
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef INSPECTORDATAWORKER_H
+#define INSPECTORDATAWORKER_H
+
+#include <QObject>
+#include <QMutex>
+#include <vector>
+#include <Suscan/Messages/SamplesMessage.h>
+#include <SocketForwarder.h>
+
+#include "Decider.h"
+#include "DecisionBlock.h"
+#include "FileDataSaver.h"
+#include "MultiStreamSaver.h"
+#include "ScratchArena.h"
+#include "SymbolPacker.h"
+
+namespace SigDigger {
+  //
+  // Performs the non-visual part of InspectorUI::feed (decision and data
+  // forwarding) in its own thread. Samples are received as the original
+  // SamplesMessage, so they are shared with the GUI thread rather than
+  // copied.
+  //
+  // Sinks are owned by InspectorUI. They must be detached through
+  // setSinks before they are destroyed.
+  //
+  class InspectorDataWorker : public QObject
+  {
+    Q_OBJECT
+
+    QMutex mutex;
+    Decider decider;
+    DecisionBlock decisionBlock;
+    FileDataSaver *dataSaver = nullptr;
+    MultiStreamChannel *channel = nullptr;
+    SocketForwarder *socketForwarder = nullptr;
+
+    // Conversion buffers of process(), given back when it returns
+    ScratchArena scratch;
+
+    // Bit-packed symbols, for the forwarder (packed format) and for the
+    // saver or channel (if packSaved). Numbered per sink.
+    SymbolPacker forwardPacker;
+    SymbolPacker savePacker;
+    bool packSaved = false;
+
+    // Forwarding format. Decimation averages every `decimation` samples
+    // (carried over between messages) before conversion.
+    SocketForwarderFormat forwardFormat = SOCKET_FORWARDER_FLOAT32;
+    SUFLOAT forwardScale = 1;
+    unsigned int decimation = 1;
+    unsigned int decimCount = 0;
+    SUCOMPLEX complexAcc = 0;
+    SUFLOAT floatAcc = 0;
+
+    template<typename T> void deliver(const T *, size_t);
+    void deliverSymbols(const uint8_t *, size_t);
+    void forward(const uint8_t *, size_t);
+    void forward(const SUFLOAT *, size_t);
+    void forward(const SUCOMPLEX *, size_t);
+    void convert(const SUFLOAT *, size_t);
+
+  public:
+    explicit InspectorDataWorker(QObject *parent = nullptr);
+
+    void setDecider(Decider const &);
+    void setSinks(FileDataSaver *, SocketForwarder *);
+
+    // Recording into a shared container, instead of (or along with) the
+    // data saver. Same ownership rules as the other sinks.
+    void setChannel(MultiStreamChannel *);
+
+    // Saves symbols bit-packed, in SymbolPacker frames
+    void setSavePacking(bool);
+
+    // fullScale is the amplitude mapped to the largest integer
+    void setForwardFormat(
+        SocketForwarderFormat format,
+        SUFLOAT fullScale,
+        unsigned int decimation);
+
+  public slots:
+    void process(Suscan::SamplesMessage, int dataVar);
+  };
+}
+
+#endif // INSPECTORDATAWORKER_H
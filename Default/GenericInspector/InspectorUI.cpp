@@ -37,16 +37,24 @@
 #include <QMessageBox>
 #include <SuWidgetsHelpers.h>
 #include <SigDiggerHelpers.h>
+#include <SessionSnapshot.h>
+#include <RenderScheduler.h>
+#include <LoadGovernor.h>
+#include <MemoryAccountant.h>
+#include <ThreadPolicy.h>
+#include <Tracer.h>
 #include <FrequencyCorrectionDialog.h>
 #include <QInputDialog>
 #include <QMessageBox>
 #include <suscan.h>
 #include <iomanip>
+#include <algorithm>
 #include <fcntl.h>
 #include "GenericInspector.h"
 
 #include "Waterfall.h"
 #include "GLWaterfall.h"
+#include "GLConstellation.h"
 
 using namespace SigDigger;
 
@@ -97,6 +105,26 @@ InspectorUI::makeWf(QWidget *owner)
     this->glWf->setMaxBlending(this->usingMaxBlending);
 }
 
+//
+// The density constellation takes the place of the classic one, which
+// stays around (hidden) so that everything configuring it keeps working.
+//
+void
+InspectorUI::makeGLConstellation(QWidget *owner)
+{
+  QLayout *layout = this->ui->constellation->parentWidget()->layout();
+
+  this->glConstellation = new GLConstellation(owner);
+  this->glConstellation->setObjectName(QStringLiteral("glConstellation"));
+  this->glConstellation->setSizePolicy(this->ui->constellation->sizePolicy());
+  this->glConstellation->setFixedSize(
+        this->ui->constellation->sizeHint().expandedTo(
+          this->ui->constellation->minimumSize()));
+
+  delete layout->replaceWidget(this->ui->constellation, this->glConstellation);
+  this->ui->constellation->hide();
+}
+
 void
 InspectorUI::beginReparenting(void)
 {
@@ -221,6 +249,8 @@ InspectorUI::InspectorUI(
   this->config = config;
   this->owner  = owner;
 
+  this->decisionBlock.setArena(&this->scratch);
+
   this->ui->setupUi(owner);
 
   this->usingGlWf = appConfig.guiConfig.useGLWaterfall;
@@ -229,6 +259,9 @@ InspectorUI::InspectorUI(
 
   this->makeWf(owner);
 
+  if (appConfig.guiConfig.useGLConstellation)
+    this->makeGLConstellation(owner);
+
   this->haveQth = suscan_get_qth(&this->qth);
 
   this->facTab = new FACTab(this->ui->toolTab);
@@ -243,6 +276,9 @@ InspectorUI::InspectorUI(
   this->tvTab = new TVProcessorTab(this->ui->toolTab, 0);
   this->ui->toolTab->addTab(this->tvTab, "Analog TV");
 
+  if (appConfig.guiConfig.useGLTVDisplay)
+    this->tvTab->makeGLDisplay();
+
   this->fcDialog = new FrequencyCorrectionDialog(
         owner,
         0,
@@ -282,6 +318,48 @@ InspectorUI::InspectorUI(
     this->ui->histogram->overrideUnits("Hz");
   }
 
+  this->dataThread = new QThread();
+  ThreadPolicy::bind(this->dataThread, THREAD_ROLE_DSP);
+  this->dataWorker = new InspectorDataWorker();
+  this->dataWorker->moveToThread(this->dataThread);
+  this->dataWorker->setDecider(this->decider);
+
+  // SNR fits share the thread with data forwarding
+  this->snrWorker = new SNREstimatorWorker();
+  this->snrWorker->moveToThread(this->dataThread);
+
+  connect(
+        this->dataThread,
+        &QThread::finished,
+        this->dataWorker,
+        &QObject::deleteLater);
+
+  connect(
+        this->dataThread,
+        &QThread::finished,
+        this->snrWorker,
+        &QObject::deleteLater);
+
+  connect(
+        this->snrWorker,
+        SIGNAL(modelReady(void)),
+        this,
+        SLOT(onSNRModelReady(void)));
+
+  connect(
+        this->dataThread,
+        &QThread::finished,
+        this->dataThread,
+        &QObject::deleteLater);
+
+  connect(
+        this,
+        SIGNAL(samplesForwarded(Suscan::SamplesMessage, int)),
+        this->dataWorker,
+        SLOT(process(Suscan::SamplesMessage, int)));
+
+  this->dataThread->start();
+
   this->initUi();
   this->connectAll();
 
@@ -294,11 +372,19 @@ InspectorUI::InspectorUI(
 
 InspectorUI::~InspectorUI()
 {
+  // After this, the worker no longer touches the sinks
+  this->dataWorker->setSinks(nullptr, nullptr);
+  this->dataWorker->setChannel(nullptr);
+  this->dataThread->quit();
+
   delete this->ui;
 
   if (this->dataSaver != nullptr)
     delete this->dataSaver;
 
+  if (this->channel != nullptr)
+    delete this->channel;
+
   if (this->socketForwarder != nullptr)
     delete this->socketForwarder;
 }
@@ -321,6 +407,7 @@ InspectorUI::initUi(void)
   this->ui->histogram->setThrottleControl(&this->throttle);
   this->ui->histogram->setDecider(&this->decider);
   this->ui->histogram->reset();
+  this->snrHistogram.reset();
 
   this->ui->centerLabel->setFixedWidth(
         SuWidgetsHelpers::getWidgetTextWidth(
@@ -397,6 +484,8 @@ InspectorUI::setSampleRate(float rate)
   if (this->config->hasPrefix("fsk"))
     this->ui->histogram->overrideDisplayRange(SCAST(qreal, rate));
 
+  this->refreshPlotStride();
+
   for (auto p : this->controls)
     p->setSampleRate(rate);
 }
@@ -429,6 +518,69 @@ InspectorUI::refreshInspectorCtls(void)
     p->refreshUi();
 }
 
+void
+InspectorUI::saveSession(QJsonObject &obj) const
+{
+  obj["tab"] = this->ui->toolTab->currentIndex();
+
+  if (this->recording)
+    obj["record"] =
+        QString::fromStdString(this->saverUI->getRecordSavePath());
+
+  if (this->forwarding) {
+    QJsonObject forward;
+
+    forward["host"]     =
+        QString::fromStdString(this->netForwarderUI->getHost());
+    forward["port"]     = this->netForwarderUI->getPort();
+    forward["mtu"]      = SCAST(int, this->netForwarderUI->getFrameLen());
+    forward["header"]   = this->netForwarderUI->getHeader();
+    forward["mode"]     =
+        SessionSnapshot::modeName(this->netForwarderUI->getMode());
+    forward["overflow"] =
+        SessionSnapshot::overflowName(this->netForwarderUI->getOverflow());
+
+    obj["forward"] = forward;
+  }
+}
+
+void
+InspectorUI::restoreSession(QJsonObject const &obj)
+{
+  int tab = obj.value("tab").toInt(-1);
+
+  if (tab >= 0 && tab < this->ui->toolTab->count())
+    this->ui->toolTab->setCurrentIndex(tab);
+
+  if (obj.contains("record"))
+    this->saverUI->setRecordSavePath(
+          obj.value("record").toString().toStdString());
+
+  if (obj.contains("forward")) {
+    QJsonObject forward = obj.value("forward").toObject();
+    SocketForwarderMode mode;
+    SocketForwarderOverflow overflow;
+
+    this->netForwarderUI->setHost(
+          forward.value("host").toString("127.0.0.1").toStdString());
+    this->netForwarderUI->setPort(
+          SCAST(uint16_t, forward.value("port").toInt()));
+    this->netForwarderUI->setHeader(forward.value("header").toBool(false));
+
+    if (forward.contains("mtu"))
+      this->netForwarderUI->setFrameLen(
+            SCAST(unsigned, forward.value("mtu").toInt()));
+
+    if (SessionSnapshot::parseMode(forward.value("mode").toString(), mode))
+      this->netForwarderUI->setMode(mode);
+
+    if (SessionSnapshot::parseOverflow(
+          forward.value("overflow").toString(),
+          overflow))
+      this->netForwarderUI->setOverflow(overflow);
+  }
+}
+
 unsigned int
 InspectorUI::getBandwidth(void) const
 {
@@ -485,6 +637,12 @@ InspectorUI::addEstimator(Suscan::Estimator const &estimator)
         this,
         SLOT(onToggleEstimator(Suscan::EstimatorId, bool)));
 
+  connect(
+        ctl,
+        SIGNAL(visibilityChanged(void)),
+        this,
+        SLOT(onEstimatorVisibilityChanged(void)));
+
   connect(
         ctl,
         SIGNAL(apply(QString, float)),
@@ -502,6 +660,12 @@ InspectorUI::connectAll()
         this,
         SLOT(onFPSChanged(void)));
 
+  connect(
+        this->ui->plotPointsSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onPlotPointsChanged(void)));
+
   connect(
         this->ui->burnCPUButton,
         SIGNAL(clicked(bool)),
@@ -569,6 +733,18 @@ InspectorUI::connectAll()
         this,
         SLOT(onAspectSliderChanged(int)));
 
+  connect(
+        this->ui->toolTab,
+        SIGNAL(currentChanged(int)),
+        this,
+        SLOT(onSpectrumVisibilityChanged(void)));
+
+  connect(
+        this->ui->splitter,
+        SIGNAL(splitterMoved(int, int)),
+        this,
+        SLOT(onSpectrumVisibilityChanged(void)));
+
   connect(
         this->ui->unitsCombo,
         SIGNAL(activated(int)),
@@ -616,31 +792,44 @@ InspectorUI::connectAll()
         SIGNAL(clicked(bool)),
         this,
         SLOT(onScOpenInspector(void)));
+
+  // The histogram edits the limits of our decider
+  connect(
+        this->ui->histogram,
+        SIGNAL(newLimits(float, float)),
+        this,
+        SLOT(onDeciderLimitsChanged(void)));
+
+  connect(
+        this->ui->histogram,
+        SIGNAL(resetLimits(void)),
+        this,
+        SLOT(onDeciderLimitsChanged(void)));
 }
 
 void
-InspectorUI::connectDataSaver()
+InspectorUI::connectDataSaver(QObject *saver)
 {
   connect(
-        this->dataSaver,
+        saver,
         SIGNAL(stopped(void)),
         this,
         SLOT(onSaveError(void)));
 
   connect(
-        this->dataSaver,
+        saver,
         SIGNAL(swamped(void)),
         this,
         SLOT(onSaveSwamped(void)));
 
   connect(
-        this->dataSaver,
+        saver,
         SIGNAL(dataRate(qreal)),
         this,
         SLOT(onSaveRate(qreal)));
 
   connect(
-        this->dataSaver,
+        saver,
         SIGNAL(commit(void)),
         this,
         SLOT(onCommit(void)));
@@ -704,19 +893,59 @@ InspectorUI::captureFileName(void) const
   return path;
 }
 
+// Size of a forwarded sample, as the sequence header counts them
+unsigned int
+InspectorUI::forwardedSampleSize(SocketForwarderFormat format) const
+{
+  unsigned int components = 1;
+
+  switch (this->ui->dataVarCombo->currentIndex()) {
+    case SIGDIGGER_INSPECTOR_UI_SYMBOLS:
+      return sizeof(uint8_t);
+
+    case SIGDIGGER_INSPECTOR_UI_SOFT_BITS:
+      components = 2;
+      break;
+  }
+
+  switch (format) {
+    case SOCKET_FORWARDER_INT16:
+      return components * sizeof(int16_t);
+
+    case SOCKET_FORWARDER_INT8:
+      return components * sizeof(int8_t);
+
+    default:
+      return components * sizeof(SUFLOAT);
+  }
+}
+
 bool
 InspectorUI::installNetForwarder(void)
 {
   if (this->socketForwarder == nullptr) {
+    SocketForwarderFormat format = this->netForwarderUI->getFormat();
+    unsigned int decimation = this->netForwarderUI->getDecimation();
+
     this->socketForwarder = new SocketForwarder(
           this->netForwarderUI->getHost(),
           this->netForwarderUI->getPort(),
           this->netForwarderUI->getFrameLen(),
-          this->netForwarderUI->getTcp(),
+          this->netForwarderUI->getMode(),
+          this->netForwarderUI->getHeader(),
+          this->forwardedSampleSize(format),
+          this->netForwarderUI->getOverflow(),
           this);
     this->recordingRate = this->getBaudRate();
-    this->socketForwarder->setSampleRate(recordingRate);
+    this->socketForwarder->setSampleRate(
+          std::max(this->recordingRate / decimation, 1u));
+    this->dataWorker->setForwardFormat(
+          format,
+          this->netForwarderUI->getFullScale(),
+          decimation);
+    this->netForwarderUI->setQueueState(0, 0);
     connectNetForwarder();
+    this->dataWorker->setSinks(this->dataSaver, this->socketForwarder);
 
     return true;
   }
@@ -727,6 +956,8 @@ InspectorUI::installNetForwarder(void)
 void
 InspectorUI::uninstallNetForwarder(void)
 {
+  this->dataWorker->setSinks(this->dataSaver, nullptr);
+
   if (this->socketForwarder)
     this->socketForwarder->deleteLater();
   this->socketForwarder = nullptr;
@@ -758,11 +989,68 @@ InspectorUI::setTimeLimits(
   this->fcDialog->setTimeLimits(start, end);
 }
 
+bool
+InspectorUI::installSharedChannel(void)
+{
+  QString error;
+  std::ostringstream os;
+
+  os << this->getClassName()
+     << "-"
+     << std::to_string(this->getBaudRate())
+     << "-baud-"
+     << this->name.toStdString();
+
+  // Symbols, decisions and soft bits are saved as floats are forwarded
+  this->channel = MultiStreamContainer::open(
+        this->saverUI->getRecordSavePath(),
+        os.str(),
+        this->forwardedSampleSize(SOCKET_FORWARDER_FLOAT32),
+        this->getBaudRate(),
+        error);
+
+  if (this->channel == nullptr) {
+    (void) QMessageBox::critical(
+          this->owner,
+          "Save demodulator output",
+          error,
+          QMessageBox::Close);
+
+    return false;
+  }
+
+  this->recordingRate = this->getBaudRate();
+  connectDataSaver(this->channel);
+  this->dataWorker->setChannel(this->channel);
+
+  return true;
+}
+
 bool
 InspectorUI::installDataSaver(void)
 {
-  if (this->dataSaver == nullptr) {
-    std::string path = this->captureFileName();
+  if (this->dataSaver == nullptr && this->channel == nullptr) {
+    std::string path;
+
+    this->dataWorker->setSavePacking(this->saverUI->getPackSymbols());
+
+    // One shared file and writer thread for every inspector recording
+    if (this->saverUI->getSharedContainer())
+      return this->installSharedChannel();
+
+    if (!MemoryAccountant::instance()->admit(
+          GenericDataSaver::ringBytes(this->getBaudRate()))) {
+      (void) QMessageBox::warning(
+            this->owner,
+            "Save demodulator output",
+            "Not enough memory left in the memory budget for the capture "
+            "buffers. Free some memory or raise the budget in the settings.",
+            QMessageBox::Close);
+
+      return false;
+    }
+
+    path = this->captureFileName();
     this->fd = open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0600);
     if (this->fd == -1) {
       std::string path;
@@ -784,7 +1072,8 @@ InspectorUI::installDataSaver(void)
     this->dataSaver = new FileDataSaver(this->fd, this);
     this->recordingRate = this->getBaudRate();
     this->dataSaver->setSampleRate(recordingRate);
-    connectDataSaver();
+    connectDataSaver(this->dataSaver);
+    this->dataWorker->setSinks(this->dataSaver, this->socketForwarder);
 
     return true;
   }
@@ -795,10 +1084,17 @@ InspectorUI::installDataSaver(void)
 void
 InspectorUI::uninstallDataSaver(void)
 {
+  this->dataWorker->setSinks(nullptr, this->socketForwarder);
+  this->dataWorker->setChannel(nullptr);
+
   if (this->dataSaver != nullptr)
     this->dataSaver->deleteLater();
   this->dataSaver = nullptr;
 
+  if (this->channel != nullptr)
+    this->channel->deleteLater();
+  this->channel = nullptr;
+
   if (this->fd != -1) {
     close(this->fd);
     this->fd = -1;
@@ -811,9 +1107,9 @@ InspectorUI::onToggleSNR(void)
   this->estimating = this->ui->snrButton->isChecked();
 
   if (this->estimating) {
-    this->estimator.setSigma(1.f);
-    this->estimator.setAlpha(1.f / (this->decider.getIntervals()));
-    gettimeofday(&this->last_estimator_update, nullptr);
+    this->snrWorker->restart(1.f, 1.f / (this->decider.getIntervals()));
+    this->snrHistogram.reset();
+    this->estimatorTimer.invalidate();
   } else {
     std::vector<float> empty;
     this->ui->histogram->setSNRModel(empty);
@@ -825,155 +1121,157 @@ InspectorUI::onToggleSNR(void)
 void
 InspectorUI::onResetSNR(void)
 {
-  this->estimator.setSigma(1.f);
+  this->snrWorker->restart(1.f, 1.f / (this->decider.getIntervals()));
 
 }
 
 
 void
-InspectorUI::feed(const SUCOMPLEX *data, unsigned int size)
+InspectorUI::feed(Suscan::SamplesMessage const &msg)
 {
   bool dataForwarding = this->recording || this->forwarding;
-  bool symbolForwarding =
-      this->ui->dataVarCombo->currentIndex() == SIGDIGGER_INSPECTOR_UI_SYMBOLS;
-  bool decisionNeeded =
-      (dataForwarding && symbolForwarding) || this->symViewTab->isRecording();
-  bool haveDecision = false;
-  this->ui->constellation->feed(data, size);
-  this->ui->histogram->feed(data, size);
 
-  if (this->estimating) {
-    struct timeval tv, res;
-    this->estimator.feed(this->ui->histogram->getHistory());
-    gettimeofday(&tv, nullptr);
-
-    timersub(&this->last_estimator_update, &tv, &res);
-
-    if (res.tv_sec > 0 || res.tv_usec > 100000) {
-      this->ui->histogram->setSNRModel(this->estimator.getModel());
-      this->ui->snrLabel->setText(
-            QString::number(
-              floor(20. * log10(SCAST(qreal, this->estimator.getSNR()))))
-            + " dB");
-      this->last_estimator_update = tv;
+  this->feed(msg.getSamples(), msg.getCount());
+
+  // The worker gets a reference to the same samples, not a copy
+  if (dataForwarding)
+    emit samplesForwarded(msg, this->ui->dataVarCombo->currentIndex());
+}
+
+//
+// Visual consumers only. Decision for data forwarding and the forwarding
+// itself happen in the data worker.
+//
+void
+InspectorUI::feed(const SUCOMPLEX *data, unsigned int size)
+{
+  SIGDIGGER_TRACE_SCOPE("InspectorUI::feed");
+  ScratchArena::Frame frame(this->scratch);
+
+  // In batch replay, samples arrive faster than real time and live plots
+  // only get a block now and then. Everything else gets every sample.
+  if (RenderScheduler::instance()->acceptData(this)) {
+    // The histogram feeds the SNR estimator
+    this->ui->histogram->feed(data, size);
+
+    // Hidden constellations keep their last points until they are shown.
+    // The density constellation costs the same for any number of points.
+    if (this->glConstellation != nullptr) {
+      if (SigDiggerHelpers::isOnScreen(this->glConstellation))
+        this->glConstellation->feed(data, size);
+    } else if (!SigDiggerHelpers::isOnScreen(this->ui->constellation)) {
+      this->plotPhase = 0;
+    } else if (this->plotStride <= 1) {
+      this->ui->constellation->feed(data, size);
+    } else {
+      unsigned int i = this->plotPhase;
+      unsigned int n = 0;
+      auto points = this->scratch.take<SUCOMPLEX>(size / this->plotStride + 1);
+
+      for (; i < size; i += this->plotStride)
+        points[n++] = data[i];
+
+      this->plotPhase = i - size;
+      this->ui->constellation->feed(points.data(), n);
     }
   }
 
-  // Decision happens here.
-  if (decisionNeeded) {
-    if (this->decider.getBps() > 0) {
-      this->decider.feed(data, size);
-      haveDecision = true;
+  // Fitting happens in the worker, which tells us when the model is ready
+  if (this->estimating
+      && (!this->estimatorTimer.isValid()
+          || this->estimatorTimer.elapsed()
+             >= SIGDIGGER_INSPECTOR_UI_SNR_UPDATE_MS)) {
+    // Only what arrived since the last update is added to the window
+    this->snrHistogram.update(this->ui->histogram->getHistory());
+    this->snrWorker->feed(this->snrHistogram.get());
+    this->estimatorTimer.start();
+  }
 
-      if (this->symViewTab->isRecording()) {
-        this->symViewTab->feed(this->decider.get());
-        this->ui->transition->feed(this->decider.get());
-      }
-    }
+  if (this->symViewTab->isRecording() && this->decider.getBps() > 0) {
+    this->decider.feed(data, size);
+    this->symViewTab->feed(this->decider.get());
+    this->ui->transition->feed(this->decider.get());
   }
 
   if (this->facTab->isRecording())
     this->facTab->feed(data, size);
 
-  if (this->tvTab->isEnabled())
-    this->tvTab->feed(data, size);
+  if (this->tvTab->isEnabled()) {
+    this->decisionBlock.compute(
+          data,
+          size,
+          this->decider.getDecisionMode(),
+          true);
+    this->tvTab->feed(this->decisionBlock.data(), this->decisionBlock.size());
+  }
 
   if (this->wfTab->isRecording())
     this->wfTab->feed(data, size);
+}
 
-  if (dataForwarding) {
-    switch (this->ui->dataVarCombo->currentIndex()) {
-      case SIGDIGGER_INSPECTOR_UI_DECISION_SPACE:
-        if (this->floatBuffer.size() < size)
-          this->floatBuffer.resize(size);
-
-        switch (this->decider.getDecisionMode()) {
-          case Decider::MODULUS:
-            for (unsigned i = 0; i < size; ++i)
-              this->floatBuffer[i] = SU_C_ABS(data[i]);
-            break;
-
-          case Decider::ARGUMENT:
-            for (unsigned i = 0; i < size; ++i)
-              this->floatBuffer[i] = SU_C_ARG(I * data[i]) / PI;
-            break;
-        }
-
-        // Decision space: deliver floats
-        if (this->recording)
-          this->dataSaver->write(this->floatBuffer.data(), size);
-
-        if (this->forwarding)
-          this->socketForwarder->write(this->floatBuffer.data(), size);
-
-        break;
-
-      case SIGDIGGER_INSPECTOR_UI_SOFT_BITS:
-        // Pure softbits: deliver complex I/Q samples
-        if (this->recording)
-          this->dataSaver->write(data, size);
-
-        if (this->forwarding)
-          this->socketForwarder->write(data, size);
-        break;
-
-      case SIGDIGGER_INSPECTOR_UI_SOFT_BITS_I:
-        if (this->floatBuffer.size() < size)
-          this->floatBuffer.resize(size);
-        for (unsigned i = 0; i < size; ++i)
-          this->floatBuffer[i] = SU_C_REAL(data[i]);
-
-        if (this->recording)
-          this->dataSaver->write(this->floatBuffer.data(), size);
-
-        if (this->forwarding)
-          this->socketForwarder->write(this->floatBuffer.data(), size);
-        break;
-
-      case SIGDIGGER_INSPECTOR_UI_SOFT_BITS_Q:
-        if (this->floatBuffer.size() < size)
-          this->floatBuffer.resize(size);
-        for (unsigned i = 0; i < size; ++i)
-          this->floatBuffer[i] = SU_C_IMAG(data[i]);
-
-        if (this->recording)
-          this->dataSaver->write(this->floatBuffer.data(), size);
-
-        if (this->forwarding)
-          this->socketForwarder->write(this->floatBuffer.data(), size);
-        break;
-
-      case SIGDIGGER_INSPECTOR_UI_SYMBOLS:
-        if (haveDecision) {
-          if (this->recording)
-            this->dataSaver->write(
-                this->decider.get().data(),
-                this->decider.get().size());
-
-          if (this->forwarding)
-            this->socketForwarder->write(
-                this->decider.get().data(),
-                this->decider.get().size());
-        }
-        break;
-    }
+QWidget *
+InspectorUI::waterfallWidget(void) const
+{
+  if (this->wf != nullptr)
+    return this->wf;
+
+  return this->glWf;
+}
+
+//
+// Spectra wider than the waterfall are folded down (keeping the peak of
+// each group of bins) to the smallest power-of-two fraction of their size
+// that still covers one bin per pixel.
+//
+void
+InspectorUI::foldSpectrum(const SUFLOAT *data, SUSCOUNT len)
+{
+  QWidget *widget = this->waterfallWidget();
+  SUSCOUNT width = widget != nullptr ? SCAST(SUSCOUNT, widget->width()) : 0;
+  unsigned int fold = 1;
+
+  if (width > 0)
+    while (len % (2 * fold) == 0 && len / (2 * fold) >= width)
+      fold <<= 1;
+
+  this->spectrumFold = fold;
+  this->fftData.resize(len / fold);
+
+  if (fold == 1) {
+    this->fftData.assign(data, data + len);
+    return;
+  }
+
+  for (SUSCOUNT i = 0; i < len / fold; ++i) {
+    const SUFLOAT *group = data + i * fold;
+    this->fftData[i] = *std::max_element(group, group + fold);
   }
 }
 
 void
 InspectorUI::feedSpectrum(const SUFLOAT *data, SUSCOUNT len, SUSCOUNT rate)
 {
+  SUSCOUNT folded;
+
   if (this->lastRate != rate) {
     WATERFALL_CALL(setSampleRate(SCAST(float, rate)));
     this->lastRate = rate;
   }
 
-  this->fftData.resize(len);
-  this->fftData.assign(data, data + len);
+  if (!RenderScheduler::instance()->acceptData(this->owner))
+    return;
 
-  WATERFALL_CALL(setNewFftData(
-        static_cast<float *>(this->fftData.data()),
-        SCAST(int, len)));
+  this->foldSpectrum(data, len);
+  folded = this->fftData.size();
+
+  // In a background tab, only the last spectrum is kept. It is drawn
+  // by catchUpViews() once the inspector is shown again.
+  this->spectrumStale = !SigDiggerHelpers::isOnScreen(this->owner);
+
+  if (!this->spectrumStale)
+    WATERFALL_CALL(setNewFftData(
+          static_cast<float *>(this->fftData.data()),
+          SCAST(int, folded)));
 
   if (!this->haveSpectrumLimits) {
     SUFLOAT min = +INFINITY;
@@ -1006,19 +1304,30 @@ InspectorUI::feedSpectrum(const SUFLOAT *data, SUSCOUNT len, SUSCOUNT rate)
     }
   }
 
-  if (this->lastLen != len) {
+  if (this->lastLen != folded) {
     int res = SCAST(int,
-          round(SCAST(qreal, rate) / SCAST(qreal, len)));
+          round(SCAST(qreal, rate) / SCAST(qreal, folded)));
     if (res < 1)
       res = 1;
 
-    this->lastLen = len;
+    this->lastLen = folded;
     WATERFALL_CALL(resetHorizontalZoom());
     WATERFALL_CALL(setClickResolution(res));
     WATERFALL_CALL(setFilterClickResolution(res));
   }
 }
 
+void
+InspectorUI::catchUpViews(void)
+{
+  if (this->spectrumStale && !this->fftData.empty()) {
+    this->spectrumStale = false;
+    WATERFALL_CALL(setNewFftData(
+          static_cast<float *>(this->fftData.data()),
+          SCAST(int, this->fftData.size())));
+  }
+}
+
 void
 InspectorUI::resetSpectrumLimits(void)
 {
@@ -1193,7 +1502,8 @@ InspectorUI::setBps(unsigned int bps)
 {
   if (this->bps != bps) {
     this->decider.setBps(bps);
-    this->estimator.setBps(bps);
+    this->dataWorker->setDecider(this->decider);
+    this->snrWorker->setBps(bps);
     this->symViewTab->setBitsPerSymbol(bps);
     this->ui->constellation->setOrderHint(bps);
     this->ui->transition->setOrderHint(bps);
@@ -1298,6 +1608,7 @@ InspectorUI::onInspectorControlChanged(void)
   this->setBps(this->getBps());
 
   this->ui->histogram->reset();
+  this->snrHistogram.reset();
 
   emit configChanged();
 }
@@ -1310,6 +1621,31 @@ InspectorUI::onCPUBurnClicked(void)
 
   this->throttle.setCpuBurn(burn);
   this->ui->fpsSpin->setEnabled(!burn);
+  this->refreshPlotStride();
+}
+
+//
+// The constellation cannot show more than a few thousand points per
+// frame. Feeding it every sample of a fast inspector only burns GUI time,
+// so it gets one in plotStride. Burning CPU means drawing everything.
+//
+void
+InspectorUI::refreshPlotStride(void)
+{
+  unsigned int points = SCAST(unsigned int, this->ui->plotPointsSpin->value());
+  qreal fps = this->ui->fpsSpin->value();
+  qreal perFrame;
+
+  if (points == 0 || this->ui->burnCPUButton->isChecked() || fps <= 0) {
+    this->plotStride = 1;
+  } else {
+    perFrame = SCAST(qreal, this->sampleRate) / fps;
+    this->plotStride = perFrame > points
+        ? SCAST(unsigned int, std::ceil(perFrame / points))
+        : 1;
+  }
+
+  this->plotPhase = 0;
 }
 
 void
@@ -1329,6 +1665,12 @@ InspectorUI::setAppConfig(AppConfig const &cfg)
   this->ui->constellation->setBackgroundColor(colors.constellationBackground);
   this->ui->constellation->setAxesColor(colors.constellationAxes);
 
+  if (this->glConstellation != nullptr) {
+    this->glConstellation->setForegroundColor(colors.constellationForeground);
+    this->glConstellation->setBackgroundColor(colors.constellationBackground);
+    this->glConstellation->setAxesColor(colors.constellationAxes);
+  }
+
   this->ui->transition->setForegroundColor(colors.transitionForeground);
   this->ui->transition->setBackgroundColor(colors.transitionBackground);
   this->ui->transition->setAxesColor(colors.transitionAxes);
@@ -1375,6 +1717,7 @@ InspectorUI::setAppConfig(AppConfig const &cfg)
   this->ui->unitsCombo->setCurrentText(QString::fromStdString(m_tabConfig->units));
   this->ui->gainSpinBox->setValue(SCAST(qreal, m_tabConfig->gain));
   this->ui->zeroPointSpin->setValue(SCAST(qreal, m_tabConfig->zeroPoint));
+  this->ui->plotPointsSpin->setValue(SCAST(int, m_tabConfig->plotPoints));
 }
 
 void
@@ -1462,6 +1805,15 @@ InspectorUI::onFPSChanged(void)
 {
   this->throttle.setRate(
         SCAST(unsigned int, this->ui->fpsSpin->value()));
+  this->refreshPlotStride();
+}
+
+void
+InspectorUI::onPlotPointsChanged(void)
+{
+  m_tabConfig->plotPoints =
+      SCAST(unsigned int, this->ui->plotPointsSpin->value());
+  this->refreshPlotStride();
 }
 
 void
@@ -1480,6 +1832,47 @@ InspectorUI::onSpectrumConfigChanged(void)
   WATERFALL_CALL(setPeakHold(m_tabConfig->peakDetect));
 }
 
+unsigned int
+InspectorUI::getSpectrumSource(void) const
+{
+  return static_cast<unsigned>(this->ui->spectrumSourceCombo->currentIndex());
+}
+
+//
+// The spectrum is only worth computing if its waterfall can be seen: the
+// inspector is on screen, the Spectrum tab is selected and the splitter
+// has not collapsed the panel.
+//
+bool
+InspectorUI::isSpectrumVisible(void) const
+{
+  QWidget *widget = this->waterfallWidget();
+
+  return SigDiggerHelpers::isOnScreen(widget) && widget->width() > 0;
+}
+
+bool
+InspectorUI::areEstimatorsVisible(void) const
+{
+  for (auto &p : this->estimatorCtls)
+    if (SigDiggerHelpers::isOnScreen(p.second))
+      return true;
+
+  return false;
+}
+
+std::vector<Suscan::EstimatorId>
+InspectorUI::getActiveEstimators(void) const
+{
+  std::vector<Suscan::EstimatorId> active;
+
+  for (auto &p : this->estimatorCtls)
+    if (p.second->isEstimating())
+      active.push_back(p.first);
+
+  return active;
+}
+
 void
 InspectorUI::onSpectrumSourceChanged(void)
 {
@@ -1487,6 +1880,18 @@ InspectorUI::onSpectrumSourceChanged(void)
         static_cast<unsigned>(this->ui->spectrumSourceCombo->currentIndex()));
 }
 
+void
+InspectorUI::onSpectrumVisibilityChanged(void)
+{
+  emit spectrumVisibilityChanged();
+}
+
+void
+InspectorUI::onEstimatorVisibilityChanged(void)
+{
+  emit estimatorVisibilityChanged();
+}
+
 void
 InspectorUI::onChangeLo(void)
 {
@@ -1551,8 +1956,10 @@ InspectorUI::onToggleRecord(void)
 void
 InspectorUI::onSaveError(void)
 {
-  if (this->dataSaver != nullptr) {
-    QString error = this->dataSaver->getLastError();
+  if (this->dataSaver != nullptr || this->channel != nullptr) {
+    QString error = this->dataSaver != nullptr
+        ? this->dataSaver->getLastError()
+        : this->channel->getLastError();
     this->recording = false;
     this->uninstallDataSaver();
 
@@ -1569,7 +1976,9 @@ InspectorUI::onSaveError(void)
 void
 InspectorUI::onSaveSwamped(void)
 {
-  if (this->dataSaver != nullptr) {
+  LoadGovernor::notifySwamp();
+
+  if (this->dataSaver != nullptr || this->channel != nullptr) {
     this->recording = false;
     this->uninstallDataSaver();
     QMessageBox::warning(
@@ -1591,7 +2000,17 @@ InspectorUI::onSaveRate(qreal rate)
 void
 InspectorUI::onCommit(void)
 {
-  this->saverUI->setCaptureSize(this->dataSaver->getSize());
+  if (this->channel != nullptr) {
+    this->saverUI->setCaptureSize(this->channel->getSize());
+    this->saverUI->setBufferUsage(
+          this->channel->getBufferUsage(),
+          this->channel->getBufferHighWater());
+  } else if (this->dataSaver != nullptr) {
+    this->saverUI->setCaptureSize(this->dataSaver->getSize());
+    this->saverUI->setBufferUsage(
+          this->dataSaver->getBufferUsage(),
+          this->dataSaver->getBufferHighWater());
+  }
 }
 
 
@@ -1664,6 +2083,36 @@ void
 InspectorUI::onNetCommit(void)
 {
   this->netForwarderUI->setCaptureSize(this->socketForwarder->getSize());
+  this->netForwarderUI->setQueueState(
+        static_cast<qreal>(this->socketForwarder->getQueuedBytes())
+        / SIGDIGGER_UDPFORWARDER_MAX_SEND_QUEUE,
+        this->socketForwarder->getDroppedBytes());
+}
+
+void
+InspectorUI::onSNRModelReady(void)
+{
+  std::vector<float> model;
+  float snr;
+
+  if (!this->snrWorker->takeModel(model, snr))
+    return;
+
+  // Late result of a fit started before estimation was disabled
+  if (!this->estimating)
+    return;
+
+  this->ui->histogram->setSNRModel(model);
+  this->ui->snrLabel->setText(
+        QString::number(floor(20. * log10(SCAST(qreal, snr))))
+        + " dB");
+}
+
+void
+InspectorUI::onDeciderLimitsChanged(void)
+{
+  // Forwarded and saved symbols must use the same thresholds as the view
+  this->dataWorker->setDecider(this->decider);
 }
 
 void
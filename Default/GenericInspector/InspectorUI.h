@@ -24,6 +24,8 @@
 #include <QVector>
 #include <QThread>
 #include <QMenu>
+#include <QElapsedTimer>
+#include <QJsonObject>
 #include <memory>
 #include <map>
 #include "InspectorCtl/InspectorCtl.h"
@@ -32,21 +34,27 @@
 #include <Suscan/Library.h>
 #include <Suscan/Estimator.h>
 #include <SNREstimator.h>
+#include <HistogramAccumulator.h>
 #include <sys/time.h>
 #include <SocketForwarder.h>
 
 #include "ThrottleableWidget.h"
 #include "Decider.h"
+#include "DecisionBlock.h"
+#include "ScratchArena.h"
 #include "Palette.h"
 #include "ColorConfig.h"
 #include "DataSaverUI.h"
 #include "FileDataSaver.h"
+#include "MultiStreamSaver.h"
 #include "NetForwarderUI.h"
 
 #include "SymViewTab.h"
 #include "TVProcessorTab.h"
 #include "WaveformTab.h"
 #include "FACTab.h"
+#include "InspectorDataWorker.h"
+#include "SNREstimatorWorker.h"
 
 namespace Ui {
   class Inspector;
@@ -58,6 +66,15 @@ namespace Ui {
 #define SIGDIGGER_INSPECTOR_UI_SOFT_BITS_Q    3
 #define SIGDIGGER_INSPECTOR_UI_SYMBOLS        4
 
+// Points per frame the constellation is fed with by default (0: all)
+#define SIGDIGGER_INSPECTOR_UI_DEFAULT_PLOT_POINTS 4096
+
+// Histograms are handed to the SNR estimator at most this often
+#define SIGDIGGER_INSPECTOR_UI_SNR_UPDATE_MS  100
+
+// The SNR is fitted to the last few updates only (about 3 s of samples)
+#define SIGDIGGER_INSPECTOR_UI_SNR_WINDOW_BLOCKS 32
+
 class Waterfall;
 class GLWaterfall;
 
@@ -66,6 +83,7 @@ namespace SigDigger {
   class AppConfig;
   class EstimatorControl;
   class GenericInspectorConfig;
+  class GLConstellation;
 
   class InspectorUI : public QObject {
     Q_OBJECT
@@ -85,7 +103,7 @@ namespace SigDigger {
   private:
 
     unsigned int basebandSampleRate;
-    float sampleRate;
+    float sampleRate = 0;
 
     bool recording = false;
     bool forwarding = false;
@@ -106,16 +124,25 @@ namespace SigDigger {
     // Decider goes here
     unsigned int bps = 0;
     Decider decider;
-    SNREstimator estimator;
+    DecisionBlock decisionBlock;
+
+    // Constellation decimation
+    unsigned int plotStride = 1;
+    unsigned int plotPhase = 0;
+
+    // Per-feed buffers (decimated constellation, decisions)
+    ScratchArena scratch;
 
     bool estimating = false;
-    struct timeval last_estimator_update;
-    std::vector<SUFLOAT>  floatBuffer;
+    QElapsedTimer estimatorTimer;
     std::vector<SUFLOAT>  fftData;
+    unsigned int spectrumFold = 1; // Bins per displayed bin
+    bool spectrumStale = false; // Last fftData never reached the waterfall
 
     // UI objects
     Waterfall   *wf   = nullptr;
     GLWaterfall *glWf = nullptr;
+    GLConstellation *glConstellation = nullptr; // Replaces ui->constellation
     ColorConfig colors;
     bool usingGlWf = false;
     bool usingMaxBlending = false;
@@ -134,7 +161,13 @@ namespace SigDigger {
     DataSaverUI *saverUI = nullptr;
     NetForwarderUI *netForwarderUI = nullptr;
     FileDataSaver *dataSaver = nullptr;
+    MultiStreamChannel *channel = nullptr;
     SocketForwarder *socketForwarder = nullptr;
+    QThread *dataThread = nullptr;
+    InspectorDataWorker *dataWorker = nullptr;
+    SNREstimatorWorker *snrWorker = nullptr;
+    HistogramAccumulator snrHistogram =
+        HistogramAccumulator(SIGDIGGER_INSPECTOR_UI_SNR_WINDOW_BLOCKS);
     TVProcessorTab *tvTab = nullptr;
     FACTab *facTab = nullptr;
     WaveformTab *wfTab = nullptr;
@@ -152,6 +185,7 @@ namespace SigDigger {
     void connectAll(void);
 
     void initUi(void);
+    void refreshPlotStride(void);
     unsigned int getBps(void) const;
     unsigned int getBaudRate(void) const;
     SUFLOAT getBaudRateFloat(void) const;
@@ -159,12 +193,17 @@ namespace SigDigger {
     void populateUnits(void);
     void populate(void);
     void connectWf(void);
+    QWidget *waterfallWidget(void) const;
+    void foldSpectrum(const SUFLOAT *data, SUSCOUNT len);
     void connectGLWf(void);
     void makeWf(QWidget *owner);
-    void connectDataSaver(void);
+    void makeGLConstellation(QWidget *owner);
+    void connectDataSaver(QObject *saver);
     void connectNetForwarder(void);
     void refreshSizes(void);
     std::string captureFileName(void) const;
+    bool installSharedChannel(void);
+    unsigned int forwardedSampleSize(SocketForwarderFormat) const;
     unsigned int getVScrollPageSize(void) const;
     unsigned int getHScrollOffset(void) const;
     void refreshVScrollBar(void) const;
@@ -202,7 +241,9 @@ namespace SigDigger {
       }
 
       void feed(const SUCOMPLEX *data, unsigned int size);
+      void feed(Suscan::SamplesMessage const &msg);
       void feedSpectrum(const SUFLOAT *data, SUSCOUNT len, SUSCOUNT rate);
+      void catchUpViews(void);
       void updateEstimator(Suscan::EstimatorId id, float val);
       void setQth(xyz_t const &);
       void setState(enum State state);
@@ -232,8 +273,19 @@ namespace SigDigger {
       void setLo(int lo);
       void resetSpectrumLimits(void);
       void refreshInspectorCtls(void);
+
+      // Session snapshots: the selected tool tab, and where recordings
+      // and forwarded samples go (only while they are active). Restoring
+      // sets the targets, it does not start them.
+      void saveSession(QJsonObject &) const;
+      void restoreSession(QJsonObject const &);
+
       unsigned int getBandwidth(void) const;
       int getLo(void) const;
+      unsigned int getSpectrumSource(void) const;
+      bool isSpectrumVisible(void) const;
+      bool areEstimatorsVisible(void) const;
+      std::vector<Suscan::EstimatorId> getActiveEstimators(void) const;
       void adjustSizes(void);
       float getZeroPoint(void) const;
       enum State getState(void) const;
@@ -241,10 +293,13 @@ namespace SigDigger {
     public slots:
       void onInspectorControlChanged();
       void onAspectSliderChanged(int);
+      void onSpectrumVisibilityChanged(void);
+      void onEstimatorVisibilityChanged(void);
       void onPandapterRangeChanged(float, float);
       void onCPUBurnClicked(void);
       void onFPSReset(void);
       void onFPSChanged(void);
+      void onPlotPointsChanged(void);
       void onSpectrumConfigChanged(void);
       void onSpectrumSourceChanged(void);
       void onToggleSNR(void);
@@ -283,9 +338,18 @@ namespace SigDigger {
       void onNetRate(qreal rate);
       void onNetCommit(void);
 
+      // SNR estimator slots
+      void onSNRModelReady(void);
+
+      // Histogram slots
+      void onDeciderLimitsChanged(void);
+
     signals:
+      void samplesForwarded(Suscan::SamplesMessage, int);
       void configChanged(void);
       void setSpectrumSource(unsigned int index);
+      void spectrumVisibilityChanged(void);
+      void estimatorVisibilityChanged(void);
       void loChanged(void);
       void bandwidthChanged(void);
       void toggleEstimator(Suscan::EstimatorId, bool);
@@ -0,0 +1,126 @@
+//
+//    SNREstimatorWorker.cpp: Off-GUI thread SNR model fitting
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "SNREstimatorWorker.h"
+
+using namespace SigDigger;
+
+SNREstimatorWorker::SNREstimatorWorker(QObject *parent) : QObject(parent)
+{
+  connect(
+        this,
+        SIGNAL(histogramAvailable(void)),
+        this,
+        SLOT(onHistogramAvailable(void)),
+        Qt::QueuedConnection);
+}
+
+void
+SNREstimatorWorker::feed(std::vector<unsigned int> const &history)
+{
+  bool notify;
+
+  {
+    QMutexLocker locker(&this->mutex);
+
+    this->pendingHistory.assign(history.begin(), history.end());
+    notify = !this->histogramPending;
+    this->histogramPending = true;
+  }
+
+  // One notification per fit, no matter how many histograms came in
+  if (notify)
+    emit histogramAvailable();
+}
+
+void
+SNREstimatorWorker::restart(float sigma, float alpha)
+{
+  QMutexLocker locker(&this->mutex);
+
+  this->pendingSigma   = sigma;
+  this->pendingAlpha   = alpha;
+  this->restartPending = true;
+  this->modelAvailable = false;
+}
+
+void
+SNREstimatorWorker::setBps(unsigned int bps)
+{
+  QMutexLocker locker(&this->mutex);
+
+  this->pendingBps = bps;
+  this->bpsPending = true;
+}
+
+bool
+SNREstimatorWorker::takeModel(std::vector<float> &model, float &snr)
+{
+  QMutexLocker locker(&this->mutex);
+
+  if (!this->modelAvailable)
+    return false;
+
+  model.swap(this->model);
+  snr = this->snr;
+  this->modelAvailable = false;
+
+  return true;
+}
+
+void
+SNREstimatorWorker::onHistogramAvailable(void)
+{
+  {
+    QMutexLocker locker(&this->mutex);
+
+    if (!this->histogramPending)
+      return;
+
+    if (this->bpsPending) {
+      this->estimator.setBps(this->pendingBps);
+      this->bpsPending = false;
+    }
+
+    if (this->restartPending) {
+      this->estimator.setSigma(this->pendingSigma);
+      this->estimator.setAlpha(this->pendingAlpha);
+      this->restartPending = false;
+    }
+
+    this->history.swap(this->pendingHistory);
+    this->histogramPending = false;
+  }
+
+  this->estimator.feed(this->history);
+
+  {
+    QMutexLocker locker(&this->mutex);
+
+    // A restart requested during the fit invalidates it
+    if (this->restartPending)
+      return;
+
+    this->model = this->estimator.getModel();
+    this->snr   = this->estimator.getSNR();
+    this->modelAvailable = true;
+  }
+
+  emit modelReady();
+}
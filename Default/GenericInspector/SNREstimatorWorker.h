@@ -0,0 +1,77 @@
+//
+//    SNREstimatorWorker.h: Off-GUI thread SNR model fitting
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SNRESTIMATORWORKER_H
+#define SNRESTIMATORWORKER_H
+
+#include <QObject>
+#include <QMutex>
+#include <vector>
+#include <SNREstimator.h>
+
+namespace SigDigger {
+  //
+  // Fits the SNR model of InspectorUI's histogram in the thread it lives
+  // in. Histograms and settings are handed over through feed(), restart()
+  // and setBps(), which may be called from any thread and never wait for
+  // a fit. Only the most recent histogram is fitted: the ones arriving
+  // while a fit is in progress replace each other.
+  //
+  class SNREstimatorWorker : public QObject
+  {
+    Q_OBJECT
+
+    QMutex mutex;
+
+    // Owned by the worker thread
+    SNREstimator estimator;
+    std::vector<unsigned int> history;
+
+    // Protected by mutex
+    std::vector<unsigned int> pendingHistory;
+    bool histogramPending = false;
+    bool restartPending = false;
+    bool bpsPending = false;
+    float pendingSigma = SNR_ESTIMATOR_DEFAULT_SIGMA;
+    float pendingAlpha = SNR_ESTIMATOR_DEFAULT_ALPHA;
+    unsigned int pendingBps = 0;
+
+    std::vector<float> model;
+    float snr = 0;
+    bool modelAvailable = false;
+
+  public:
+    explicit SNREstimatorWorker(QObject *parent = nullptr);
+
+    void feed(std::vector<unsigned int> const &history);
+    void restart(float sigma, float alpha);
+    void setBps(unsigned int bps);
+
+    // Returns false if there is no new model since the last call
+    bool takeModel(std::vector<float> &model, float &snr);
+
+  signals:
+    void histogramAvailable(void);
+    void modelReady(void);
+
+  public slots:
+    void onHistogramAvailable(void);
+  };
+}
+
+#endif // SNRESTIMATORWORKER_H
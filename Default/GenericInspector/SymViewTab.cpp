@@ -21,6 +21,7 @@
 #include <SuWidgetsHelpers.h>
 #include <QMessageBox>
 #include <QFileDialog>
+#include <cstdio>
 
 #include "SymViewTab.h"
 #include "ui_SymViewTab.h"
@@ -150,6 +151,30 @@ SymViewTab::connectAll(void)
         SIGNAL(clicked(bool)),
         this,
         SLOT(onClearSymView()));
+
+  connect(
+        this->ui->searchButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onSearch()));
+
+  connect(
+        this->ui->searchEdit,
+        SIGNAL(returnPressed()),
+        this,
+        SLOT(onSearch()));
+
+  connect(
+        this->ui->prevHitButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onPrevHit()));
+
+  connect(
+        this->ui->nextHitButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onNextHit()));
 }
 
 void
@@ -169,10 +194,133 @@ SymViewTab::setColorConfig(const ColorConfig &colors)
 void
 SymViewTab::feed(const Symbol *data, unsigned int size)
 {
+  this->store.append(data, size);
   this->ui->symView->feed(data, size);
+
+  if (this->ui->symView->getLength() > SIGDIGGER_SYMVIEW_TAB_MAX_VIEW_SYMBOLS)
+    this->trimView();
+
   this->refreshSizes();
 }
 
+void
+SymViewTab::trimView(void)
+{
+  // Keep half of the window, so trimming happens once every so often
+  size_t keep = SIGDIGGER_SYMVIEW_TAB_MAX_VIEW_SYMBOLS / 2;
+  std::vector<Symbol> recent(keep);
+
+  keep = this->store.read(this->store.size() - keep, recent.data(), keep);
+
+  this->ui->symView->clear();
+  this->ui->symView->feed(recent.data(), static_cast<unsigned int>(keep));
+}
+
+//
+// Puts the whole recording back in the view, so that it can be saved.
+// Returns true if it did, and the view has to be trimmed afterwards.
+//
+bool
+SymViewTab::refillView(void)
+{
+  size_t total = this->store.size();
+  std::vector<Symbol> block;
+  size_t got;
+
+  if (this->ui->symView->getLength() >= total)
+    return false;
+
+  if (total > SIGDIGGER_SYMVIEW_TAB_MAX_SAVE_SYMBOLS) {
+    (void) QMessageBox::warning(
+          this->ui->symView,
+          "Save symbol file",
+          "The symbol recording is too big for this format. Only the last "
+          + QString::number(this->ui->symView->getLength())
+          + " symbols will be saved. Save it as a packed bit stream "
+            "(*.bits) to keep all of them.",
+          QMessageBox::Ok);
+    return false;
+  }
+
+  block.resize(SIGDIGGER_SYMVIEW_TAB_MAX_VIEW_SYMBOLS / 2);
+  this->ui->symView->clear();
+
+  for (size_t i = 0; i < total; i += got) {
+    if ((got = this->store.read(i, block.data(), block.size())) == 0)
+      break;
+    this->ui->symView->feed(block.data(), static_cast<unsigned int>(got));
+  }
+
+  return true;
+}
+
+void
+SymViewTab::clearHits(void)
+{
+  this->hits.clear();
+  this->currentHit = 0;
+  this->hitsCapped = false;
+  this->ui->prevHitButton->setEnabled(false);
+  this->ui->nextHitButton->setEnabled(false);
+  this->ui->searchResultLabel->setText("");
+}
+
+void
+SymViewTab::goToHit(size_t index)
+{
+  size_t viewStart = this->store.size() - this->ui->symView->getLength();
+  size_t hit;
+  QString text;
+
+  if (index >= this->hits.size())
+    return;
+
+  this->currentHit = index;
+  hit = this->hits[index];
+
+  text = QString::number(index + 1)
+      + " of "
+      + QString::number(this->hits.size())
+      + (this->hitsCapped ? "+" : "")
+      + " at symbol "
+      + QString::number(hit);
+
+  // The view only has the most recent symbols
+  if (hit < viewStart) {
+    text += " (not in view)";
+  } else {
+    unsigned int offset = static_cast<unsigned int>(hit - viewStart);
+
+    if (this->ui->autoScrollButton->isChecked()) {
+      this->ui->autoScrollButton->setChecked(false);
+      this->onSymViewControlsChanged();
+    }
+
+    this->ui->offsetSpin->setValue(static_cast<int>(offset));
+  }
+
+  this->ui->searchResultLabel->setText(text);
+  this->ui->prevHitButton->setEnabled(index > 0);
+  this->ui->nextHitButton->setEnabled(index + 1 < this->hits.size());
+}
+
+bool
+SymViewTab::savePacked(QString const &path)
+{
+  FILE *fp;
+  bool ok;
+
+  if ((fp = fopen(path.toStdString().c_str(), "wb")) == nullptr)
+    return false;
+
+  ok = this->store.writePacked(fp);
+
+  if (fclose(fp) != 0)
+    ok = false;
+
+  return ok;
+}
+
 unsigned int
 SymViewTab::getVScrollPageSize(void) const
 {
@@ -245,7 +393,12 @@ SymViewTab::refreshVScrollBar(void) const
 void
 SymViewTab::setBitsPerSymbol(unsigned int bps)
 {
+  // Symbols of a different size cannot share the recording
+  if (this->bps != bps && this->store.size() > 0)
+    this->onClearSymView();
+
   this->bps = bps;
+  this->store.setBitsPerSymbol(bps);
   this->ui->symView->setBitsPerSymbol(bps);
 }
 
@@ -255,20 +408,20 @@ SymViewTab::refreshSizes(void)
   this->ui->sizeLabel->setText(
         "Capture size: " +
         SuWidgetsHelpers::formatQuantity(
-          this->ui->symView->getLength(),
+          this->store.size(),
           "sym"));
 
   this->ui->dataSizeLabel->setText(
         "Data size: " +
         SuWidgetsHelpers::formatQuantity(
-          this->ui->symView->getLength() * this->bps,
+          this->store.getBitCount(),
           "bits")
         + " (" +
         SuWidgetsHelpers::formatBinaryQuantity(
-          this->ui->symView->getLength() * this->bps >> 3,
+          this->store.getBitCount() >> 3,
           "B") + ")");
 
-  this->ui->saveButton->setEnabled(this->ui->symView->getLength() > 0);
+  this->ui->saveButton->setEnabled(this->store.size() > 0);
 
   this->refreshVScrollBar();
 }
@@ -360,9 +513,11 @@ SymViewTab::onSaveSymView(void)
   QFileDialog dialog(this->ui->symView);
   QStringList filters;
   enum SymView::FileFormat fmt = SymView::FILE_FORMAT_TEXT;
+  bool refilled;
 
   filters << "Text file (*.txt)"
           << "Binary file (*.bin)"
+          << "Packed bit stream (*.bits)"
           << "C source file (*.c)"
           << "Microsoft Windows Bitmap (*.bmp)"
           << "PNG Image (*.png)"
@@ -383,6 +538,19 @@ SymViewTab::onSaveSymView(void)
         ? fi.suffix()
         : SuWidgetsHelpers::extractFilterExtension(filter);
 
+    // The whole recording, straight from the store. The other formats
+    // are written by the view, refilled from the store if trimmed.
+    if (ext == "bits") {
+      if (!this->savePacked(SuWidgetsHelpers::ensureExtension(path, ext)))
+        (void) QMessageBox::critical(
+              this->ui->symView,
+              "Save symbol file",
+              "Failed to save file in the specified location. Please verify "
+              "if permission and disk space allow this operation.",
+              QMessageBox::Close);
+      return;
+    }
+
     if (ext == "txt")
       fmt = SymView::FILE_FORMAT_TEXT;
     else if (ext == "bin")
@@ -398,6 +566,8 @@ SymViewTab::onSaveSymView(void)
     else if (ext == "ppm")
       fmt = SymView::FILE_FORMAT_PPM;
 
+    refilled = this->refillView();
+
     try {
       this->ui->symView->save(
             SuWidgetsHelpers::ensureExtension(path, ext),
@@ -410,12 +580,17 @@ SymViewTab::onSaveSymView(void)
             "permission and disk space allow this operation.",
             QMessageBox::Close);
     }
+
+    if (refilled)
+      this->trimView();
   }
 }
 
 void
 SymViewTab::onClearSymView(void)
 {
+  this->store.clear();
+  this->clearHits();
   this->ui->symView->clear();
   this->onOffsetChanged(0);
   this->refreshVScrollBar();
@@ -447,3 +622,65 @@ SymViewTab::onSymViewZoomChanged(unsigned int zoom)
   this->refreshVScrollBar();
   this->refreshHScrollBar();
 }
+
+void
+SymViewTab::onSearch(void)
+{
+  QString text = this->ui->searchEdit->text().remove(' ');
+  quint64 pattern = 0;
+  quint64 care = 0;
+  unsigned int length = static_cast<unsigned int>(text.size());
+
+  this->clearHits();
+
+  if (length == 0)
+    return;
+
+  if (length > SIGDIGGER_SYMBOL_STORE_MAX_PATTERN) {
+    this->ui->searchResultLabel->setText("Pattern too long");
+    return;
+  }
+
+  for (auto c : text) {
+    pattern <<= 1;
+    care    <<= 1;
+
+    if (c == '0') {
+      care |= 1;
+    } else if (c == '1') {
+      pattern |= 1;
+      care    |= 1;
+    } else if (c != 'x' && c != 'X' && c != '?') {
+      this->ui->searchResultLabel->setText("Invalid pattern");
+      return;
+    }
+  }
+
+  this->store.find(
+        pattern,
+        care,
+        length,
+        static_cast<unsigned int>(this->ui->searchErrorsSpin->value()),
+        this->hits,
+        SIGDIGGER_SYMVIEW_TAB_MAX_HITS);
+
+  this->hitsCapped = this->hits.size() >= SIGDIGGER_SYMVIEW_TAB_MAX_HITS;
+
+  if (this->hits.empty())
+    this->ui->searchResultLabel->setText("No matches");
+  else
+    this->goToHit(0);
+}
+
+void
+SymViewTab::onPrevHit(void)
+{
+  if (this->currentHit > 0)
+    this->goToHit(this->currentHit - 1);
+}
+
+void
+SymViewTab::onNextHit(void)
+{
+  this->goToHit(this->currentHit + 1);
+}
@@ -23,6 +23,19 @@
 #include <QWidget>
 #include <Decider.h>
 #include <ColorConfig.h>
+#include <SymbolStore.h>
+
+// The whole recording is kept packed. The symbol view only holds (up to)
+// this many of the most recent symbols.
+#define SIGDIGGER_SYMVIEW_TAB_MAX_VIEW_SYMBOLS (1 << 24)
+
+// Formats written by the view get the whole recording by refilling the
+// view for a moment, as long as it has no more than this many symbols
+#define SIGDIGGER_SYMVIEW_TAB_MAX_SAVE_SYMBOLS (1 << 28)
+
+// Searches stop after this many hits. Mostly wildcard patterns would
+// otherwise match every symbol.
+#define SIGDIGGER_SYMVIEW_TAB_MAX_HITS 10000
 
 namespace Ui {
   class SymViewTab;
@@ -39,7 +52,18 @@ namespace SigDigger {
     bool scrolling = false;
 
     unsigned int bps = 1;
-
+    SymbolStore store;
+
+    // Pattern search
+    std::vector<size_t> hits;
+    size_t currentHit = 0;
+    bool hitsCapped = false; // There may be more than these
+
+    void trimView(void);
+    bool refillView(void);
+    void clearHits(void);
+    void goToHit(size_t index);
+    bool savePacked(QString const &path);
     void refreshSizes(void);
     void refreshVScrollBar(void) const;
     void refreshHScrollBar(void) const;
@@ -83,6 +107,9 @@ namespace SigDigger {
     void onOffsetChanged(unsigned int offset);
     void onHScrollBarChanged(int offset);
     void onScrollBarChanged(int offset);
+    void onSearch(void);
+    void onPrevHit(void);
+    void onNextHit(void);
 
   private:
     Ui::SymViewTab *ui;
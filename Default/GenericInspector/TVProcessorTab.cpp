@@ -19,8 +19,12 @@
 
 #include "TVProcessorTab.h"
 #include "ui_TVProcessorTab.h"
+#include "GLTVDisplay.h"
 #include <QMessageBox>
 #include <SuWidgetsHelpers.h>
+#include <SigDiggerHelpers.h>
+#include <RenderScheduler.h>
+#include <ThreadPolicy.h>
 #include <QThread>
 #include <QFileDialog>
 
@@ -29,6 +33,19 @@ using namespace SigDigger;
 #define EP 1e2
 #define EP_INV (1. / (EP))
 
+#define TV_DISPLAY_CALL(call)            \
+  do {                                   \
+    if (this->glDisplay != nullptr)      \
+      this->glDisplay->call;             \
+    else                                 \
+      this->ui->tvDisplay->call;         \
+  } while (false)
+
+#define TV_DISPLAY_FUNC(call)            \
+  (this->glDisplay != nullptr            \
+    ? this->glDisplay->call              \
+    : this->ui->tvDisplay->call)
+
 TVProcessorTab::TVProcessorTab(QWidget *parent, qreal rate) :
   QWidget(parent),
   ui(new Ui::TVProcessorTab)
@@ -38,6 +55,7 @@ TVProcessorTab::TVProcessorTab(QWidget *parent, qreal rate) :
   ui->setupUi(this);
 
   this->tvThread = new QThread();
+  ThreadPolicy::bind(this->tvThread, THREAD_ROLE_DSP);
   this->tvWorker = new TVProcessorWorker();
   this->tvWorker->moveToThread(this->tvThread);
 
@@ -57,16 +75,77 @@ TVProcessorTab::TVProcessorTab(QWidget *parent, qreal rate) :
 
   this->connectAll();
   this->onTVProcessorUiChanged();
+
+  RenderScheduler::instance()->attach(
+        this,
+        [this] () { this->presentFrame(); });
 }
 
 TVProcessorTab::~TVProcessorTab()
 {
+  // The worker is gone by the time the frame would get there
+  if (this->pendingFrame != nullptr)
+    su_tv_frame_buffer_destroy(this->pendingFrame);
+
   if (this->tvThread != nullptr)
     this->tvThread->quit();
 
   delete ui;
 }
 
+//
+// The GL display keeps the whole picture in the GPU: frames are uploaded
+// once and never converted to an image. It takes the place of the
+// classic one, which stays around (hidden).
+//
+void
+TVProcessorTab::makeGLDisplay(void)
+{
+  struct sigutils_tv_processor_params params;
+  QLayout *layout = this->ui->tvDisplay->parentWidget()->layout();
+
+  if (this->glDisplay != nullptr)
+    return;
+
+  this->glDisplay = new GLTVDisplay(this->ui->tvDisplay->parentWidget());
+  this->glDisplay->setObjectName(QStringLiteral("glTvDisplay"));
+  this->glDisplay->setSizePolicy(this->ui->tvDisplay->sizePolicy());
+
+  delete layout->replaceWidget(this->ui->tvDisplay, this->glDisplay);
+  this->ui->tvDisplay->hide();
+
+  this->onTVContrastChanged();
+  this->onTVBrightnessChanged();
+  this->onTVGammaChanged();
+  this->onTVAspectChanged();
+  this->onAccumChanged();
+
+  this->parseUi(params);
+  this->glDisplay->setPicGeometry(
+        static_cast<int>(params.line_len),
+        static_cast<int>(params.frame_lines));
+}
+
+void
+TVProcessorTab::presentFrame(void)
+{
+  if (this->pendingFrame != nullptr) {
+    TV_DISPLAY_CALL(putFrame(this->pendingFrame));
+    this->disposePendingFrame();
+  }
+
+  TV_DISPLAY_CALL(invalidate());
+}
+
+void
+TVProcessorTab::disposePendingFrame(void)
+{
+  if (this->pendingFrame != nullptr) {
+    emit tvProcessorDisposeFrame(this->pendingFrame);
+    this->pendingFrame = nullptr;
+  }
+}
+
 void
 TVProcessorTab::connectAll(void)
 {
@@ -390,9 +469,9 @@ TVProcessorTab::emitParameters(void)
       emit startTVProcessor();
     this->ui->enableTvButton->setEnabled(true);
 
-    this->ui->tvDisplay->setPicGeometry(
+    TV_DISPLAY_CALL(setPicGeometry(
           static_cast<int>(params.line_len),
-          static_cast<int>(params.frame_lines));
+          static_cast<int>(params.frame_lines)));
   } else {
     this->ui->enableTvButton->setEnabled(false);
     if (this->tvProcessing) {
@@ -590,22 +669,23 @@ TVProcessorTab::parseUi(
 }
 
 void
-TVProcessorTab::feed(const SUCOMPLEX *data, unsigned int size)
+TVProcessorTab::feed(const SUFLOAT *decision, unsigned int size)
 {
   SUFLOAT k = this->ui->invertSyncCheck->isChecked() ? -1 : 1;
   SUFLOAT dc = static_cast<SUFLOAT>(this->ui->dcSpin->value()) / 100;
+  SUFLOAT *buffer = this->tvWorker->beginPush(size);
 
-  this->floatBuffer.resize(size);
+  // Worker is lagging behind. Drop this batch.
+  if (buffer == nullptr)
+    return;
 
-  if (this->decisionMode == Decider::MODULUS) {
-    for (unsigned i = 0; i < size; ++i)
-      this->floatBuffer[i] = k * SU_C_ABS(data[i]) + dc;
-  } else {
-    for (unsigned i = 0; i < size; ++i)
-      this->floatBuffer[i] = k * SU_C_ARG(data[i]) / PI + dc;
-  }
+  if (this->decisionMode == Decider::ARGUMENT)
+    k /= PI;
+
+  for (unsigned i = 0; i < size; ++i)
+    buffer[i] = k * decision[i] + dc;
 
-  this->tvWorker->pushData(this->floatBuffer);
+  this->tvWorker->commitPush();
 
   emit tvProcessorData();
 }
@@ -637,19 +717,32 @@ TVProcessorTab::onToggleTVProcessor(void)
 {
   this->tvProcessing = this->ui->enableTvButton->isChecked();
 
-  if (this->tvProcessing)
+  if (this->tvProcessing) {
     emit startTVProcessor();
-  else
+  } else {
+    this->disposePendingFrame();
     emit stopTVProcessor();
+  }
 }
 
 void
 TVProcessorTab::onTVProcessorFrame(struct sigutils_tv_frame_buffer *frame)
 {
+  // Frames are acknowledged as they arrive, whether they are shown or
+  // skipped: the worker only holds back while they pile up in the event
+  // queue, i.e. when the GUI thread is really lagging behind.
   this->tvWorker->acknowledgeFrame();
-  this->ui->tvDisplay->putFrame(frame);
-  this->ui->tvDisplay->invalidate();
-  emit tvProcessorDisposeFrame(frame);
+
+  if (!SigDiggerHelpers::isOnScreen(this)) {
+    emit tvProcessorDisposeFrame(frame);
+    return;
+  }
+
+  // Only the last frame before a redraw gets to the display
+  this->disposePendingFrame();
+  this->pendingFrame = frame;
+
+  RenderScheduler::instance()->markDirty(this);
 }
 
 void
@@ -670,13 +763,13 @@ TVProcessorTab::onTVProcessorError(QString error)
 void
 TVProcessorTab::onTVContrastChanged(void)
 {
-  this->ui->tvDisplay->setContrast(this->ui->contrastDial->value() / 100.);
+  TV_DISPLAY_CALL(setContrast(this->ui->contrastDial->value() / 100.));
 }
 
 void
 TVProcessorTab::onTVBrightnessChanged(void)
 {
-  this->ui->tvDisplay->setBrightness(this->ui->brightnessDial->value() / 100.);
+  TV_DISPLAY_CALL(setBrightness(this->ui->brightnessDial->value() / 100.));
 }
 
 void
@@ -687,18 +780,18 @@ TVProcessorTab::onTVGammaChanged(void)
   if (gamma < 1)
     gamma = -1. / (gamma - 2);
 
-  this->ui->tvDisplay->setGamma(gamma);
+  TV_DISPLAY_CALL(setGamma(gamma));
 }
 
 void
 TVProcessorTab::onTVAspectChanged(void)
 {
-  this->ui->tvDisplay->setRotation(this->ui->rotationDial->value());
-  this->ui->tvDisplay->setHorizontalFlip(
-        this->ui->flipHorizontalCheck->isChecked());
-  this->ui->tvDisplay->setVerticalFlip(
-        this->ui->flipVerticalCheck->isChecked());
-  this->ui->tvDisplay->setZoom(this->ui->tvZoomSpin->value());
+  TV_DISPLAY_CALL(setRotation(this->ui->rotationDial->value()));
+  TV_DISPLAY_CALL(setHorizontalFlip(
+        this->ui->flipHorizontalCheck->isChecked()));
+  TV_DISPLAY_CALL(setVerticalFlip(
+        this->ui->flipVerticalCheck->isChecked()));
+  TV_DISPLAY_CALL(setZoom(this->ui->tvZoomSpin->value()));
 }
 
 void
@@ -725,8 +818,8 @@ TVProcessorTab::onSaveSnapshot(void)
         ? fi.suffix()
         : SuWidgetsHelpers::extractFilterExtension(filter);
 
-    if (!this->ui->tvDisplay->saveToFile(
-          SuWidgetsHelpers::ensureExtension(path, ext)))
+    if (!TV_DISPLAY_FUNC(saveToFile(
+          SuWidgetsHelpers::ensureExtension(path, ext))))
       QMessageBox::critical(
             this,
             "Failed to take snapshot",
@@ -739,7 +832,7 @@ TVProcessorTab::onSaveSnapshot(void)
 void
 TVProcessorTab::onAccumChanged(void)
 {
-  this->ui->tvDisplay->setAccumulate(this->ui->accumButton->isChecked());
+  TV_DISPLAY_CALL(setAccumulate(this->ui->accumButton->isChecked()));
   this->ui->lpfButton->setEnabled(this->ui->accumButton->isChecked());
   this->onEnableLPFChanged();
 }
@@ -747,7 +840,7 @@ TVProcessorTab::onAccumChanged(void)
 void
 TVProcessorTab::onEnableLPFChanged(void)
 {
-  this->ui->tvDisplay->setEnableSPLPF(this->ui->lpfButton->isChecked());
+  TV_DISPLAY_CALL(setEnableSPLPF(this->ui->lpfButton->isChecked()));
   this->ui->accumSpinBox->setEnabled(
         this->ui->lpfButton->isChecked() && this->ui->accumButton->isChecked());
   this->onAccumSpinChanged();
@@ -756,7 +849,7 @@ TVProcessorTab::onEnableLPFChanged(void)
 void
 TVProcessorTab::onAccumSpinChanged(void)
 {
-  this->ui->tvDisplay->setAccumAlpha(
-          SU_SPLPF_ALPHA(this->ui->accumSpinBox->value() / 5.f));
+  TV_DISPLAY_CALL(setAccumAlpha(
+          SU_SPLPF_ALPHA(this->ui->accumSpinBox->value() / 5.f)));
 }
 
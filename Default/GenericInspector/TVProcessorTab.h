@@ -29,6 +29,8 @@ namespace Ui {
 }
 
 namespace SigDigger {
+  class GLTVDisplay;
+
   class TVProcessorTab : public QWidget
   {
     Q_OBJECT
@@ -41,9 +43,16 @@ namespace SigDigger {
 
     TVProcessorWorker *tvWorker = nullptr;
     QThread *tvThread = nullptr;
-    std::vector<SUFLOAT> floatBuffer;
+
+    // Replaces ui->tvDisplay
+    GLTVDisplay *glDisplay = nullptr;
+
+    // Most recent frame, until the next redraw. Older ones are skipped.
+    struct sigutils_tv_frame_buffer *pendingFrame = nullptr;
 
     void connectAll(void);
+    void presentFrame(void);
+    void disposePendingFrame(void);
     void emitParameters(void);
     void refreshUiState(void);
     void refreshUi(
@@ -64,8 +73,9 @@ namespace SigDigger {
     ~TVProcessorTab();
 
     void setDecisionMode(Decider::DecisionMode);
-    void feed(const SUCOMPLEX *, unsigned int size);
+    void feed(const SUFLOAT *decision, unsigned int size);
     void setSampleRate(qreal);
+    void makeGLDisplay(void);
 
   signals:
     void startTVProcessor(void);
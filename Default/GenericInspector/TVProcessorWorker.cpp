@@ -36,84 +36,35 @@ TVProcessorWorker::TVProcessorWorker(QObject *parent) : QObject(parent)
 
 TVProcessorWorker::~TVProcessorWorker()
 {
-  std::vector<SUFLOAT> *entry = nullptr;
-
   this->stop();
-
-  while ((entry = popFromList(this->pendingList)) != nullptr)
-    delete entry;
-
-  while ((entry = popFromList(this->freeList)) != nullptr)
-    delete entry;
 }
 
-
-std::vector<SUFLOAT> *
-TVProcessorWorker::popFromList(std::list<std::vector<SUFLOAT> *> &list)
+SUFLOAT *
+TVProcessorWorker::beginPush(SUSCOUNT size)
 {
-  std::vector<SUFLOAT> *entry;
+  quint32 head = this->ringHead.loadAcquire();
+  quint32 tail = this->ringTail.loadAcquire();
+  std::vector<SUFLOAT> *slot;
 
-  if (list.empty())
+  if (head - tail >= TV_PROCESSOR_WORKER_RING_SIZE)
     return nullptr;
 
-  entry = list.front();
-
-  list.pop_front();
-
-  return entry;
-}
-
-std::vector<SUFLOAT> *
-TVProcessorWorker::allocBuffer(std::vector<SUFLOAT> &buffer)
-{
-  std::vector<SUFLOAT> *entry;
-
-  this->pendingDataMutex.lock();
-  entry = popFromList(this->freeList);
-  this->pendingDataMutex.unlock();
-
-  if (entry == nullptr)
-    entry = new std::vector<SUFLOAT>;
-
-  *entry = std::move(buffer);
-
-  return entry;
-}
-
-void
-TVProcessorWorker::putPendingBuffer(std::vector<SUFLOAT> *buffer)
-{
-  this->pendingDataMutex.lock();
-  this->pendingList.push_back(buffer);
-  this->pendingDataMutex.unlock();
-}
-
-std::vector<SUFLOAT> *
-TVProcessorWorker::takePendingBuffer(void)
-{
-  std::vector<SUFLOAT> *entry;
-
-  this->pendingDataMutex.lock();
-  entry = popFromList(this->pendingList);
-  this->pendingDataMutex.unlock();
+  slot = &this->ring[head % TV_PROCESSOR_WORKER_RING_SIZE];
+  slot->resize(size);
 
-  return entry;
+  return slot->data();
 }
 
 void
-TVProcessorWorker::disposeBuffer(std::vector<SUFLOAT> *buffer)
+TVProcessorWorker::commitPush(void)
 {
-  this->pendingDataMutex.lock();
-  this->freeList.push_back(buffer);
-  this->pendingDataMutex.unlock();
+  this->ringHead.fetchAndAddRelease(1);
 }
 
 void
-TVProcessorWorker::pushData(std::vector<SUFLOAT> &data)
+TVProcessorWorker::drain(void)
 {
-  std::vector<SUFLOAT> *entry = this->allocBuffer(data);
-
-  this->putPendingBuffer(entry);
+  this->ringTail.storeRelease(this->ringHead.loadAcquire());
 }
 
 void
@@ -168,8 +119,6 @@ TVProcessorWorker::acknowledgeFrame(void)
 void
 TVProcessorWorker::stop(void)
 {
-  std::vector<SUFLOAT> *entry;
-
   if (this->processor != nullptr) {
     su_tv_processor_destroy(this->processor);
     this->processor = nullptr;
@@ -178,8 +127,7 @@ TVProcessorWorker::stop(void)
     this->blocked = false;
   }
 
-  while ((entry = this->takePendingBuffer()))
-    this->disposeBuffer(entry);
+  this->drain();
 }
 
 void
@@ -195,13 +143,23 @@ TVProcessorWorker::start(void)
 void
 TVProcessorWorker::process()
 {
-  if (this->processor != nullptr) {
-    std::vector<SUFLOAT> *entry;
+  quint32 tail = this->ringTail.loadAcquire();
+  quint32 head = this->ringHead.loadAcquire();
 
-    while ((entry = this->takePendingBuffer()) != nullptr) {
-      this->work(entry->data(), entry->size());
-      this->disposeBuffer(entry);
-    }
+  if (this->processor == nullptr) {
+    this->drain();
+    return;
+  }
+
+  while (tail != head) {
+    std::vector<SUFLOAT> &slot =
+        this->ring[tail % TV_PROCESSOR_WORKER_RING_SIZE];
+
+    this->work(slot.data(), slot.size());
+    this->ringTail.storeRelease(++tail);
+
+    if (tail == head)
+      head = this->ringHead.loadAcquire();
   }
 }
 
@@ -25,12 +25,11 @@
 #include <sigutils/types.h>
 #include <sigutils/tvproc.h>
 #include <QAtomicInteger>
-#include <QMutex>
-#include <list>
 
 #define TV_PROCESSOR_WORKER_MAX_NACK_FRAMES   100
 #define TV_PROCESSOR_WORKER_MIN_NACK_RESTART   50
 #define TV_PROCESSOR_MAX_PENDING_FRAMES       120
+#define TV_PROCESSOR_WORKER_RING_SIZE         256
 
 namespace SigDigger {
   class TVProcessorWorker : public QObject
@@ -40,9 +39,14 @@ namespace SigDigger {
     struct sigutils_tv_processor_params defaultParams;
     su_tv_processor_t *processor = nullptr;
 
-    QMutex pendingDataMutex;
-    std::list<std::vector<SUFLOAT> *> freeList;
-    std::list<std::vector<SUFLOAT> *> pendingList;
+    //
+    // Single-producer (GUI thread), single-consumer (worker thread) ring
+    // of sample buffers. Slots are reused, so once every buffer has grown
+    // to the usual batch size no further allocations take place.
+    //
+    std::vector<SUFLOAT> ring[TV_PROCESSOR_WORKER_RING_SIZE];
+    QAtomicInteger<quint32> ringHead = 0;
+    QAtomicInteger<quint32> ringTail = 0;
 
     bool blocked = false;
     SUSCOUNT frameCount = 0;
@@ -50,22 +54,18 @@ namespace SigDigger {
 
     QAtomicInteger<SUSCOUNT> frameAck = 0;
 
-    std::vector<SUFLOAT> *allocBuffer(std::vector<SUFLOAT> &);
-    void putPendingBuffer(std::vector<SUFLOAT> *);
-    std::vector<SUFLOAT> *takePendingBuffer(void);
-    void disposeBuffer(std::vector<SUFLOAT> *);
-
     void work(const SUFLOAT *samples, SUSCOUNT size);
-
-    static std::vector<SUFLOAT> *popFromList(
-        std::list<std::vector<SUFLOAT> *> &list);
+    void drain(void);
 
   public:
     explicit TVProcessorWorker(QObject *parent = nullptr);
     ~TVProcessorWorker();
 
     void acknowledgeFrame(void);
-    void pushData(std::vector<SUFLOAT> &data);
+
+    // Producer side. beginPush returns nullptr if the ring is full.
+    SUFLOAT *beginPush(SUSCOUNT size);
+    void commitPush(void);
 
     //
     // FIXME: assume that signals may be lost.
@@ -2,8 +2,11 @@
 #include "ui_WaveformTab.h"
 #include "SigDiggerHelpers.h"
 #include "SuWidgetsHelpers.h"
+#include "RenderScheduler.h"
+#include "HugePages.h"
 #include <sigutils/types.h>
 #include <string>
+#include <algorithm>
 
 using namespace SigDigger;
 
@@ -57,6 +60,8 @@ WaveformTab::WaveformTab(QWidget *parent) :
   this->refreshMeasures();
   SigDiggerHelpers::instance()->populatePaletteCombo(this->ui->paletteCombo);
   this->connectAll();
+
+  RenderScheduler::instance()->attach(this, [this] () { this->refreshView(); });
 }
 
 const SUCOMPLEX *
@@ -91,19 +96,87 @@ WaveformTab::setSampleRate(qreal rate)
 void
 WaveformTab::feed(const SUCOMPLEX *data, unsigned int size)
 {
-  size_t prevSize = this->buffer.size();
-  qreal prevDuration = prevSize / this->fs;
+  this->store->append(data, size);
+
+  // The display window only changes right before the waveforms are told
+  // about it, in refreshView(). They keep a pointer to it.
+  this->pending.insert(this->pending.end(), data, data + size);
+
+  RenderScheduler::instance()->markDirty(this);
+}
+
+void
+WaveformTab::commitPending(void)
+{
+  size_t size = this->pending.size();
+  size_t skip = 0;
+
+  if (size > SIGDIGGER_WAVEFORM_TAB_MAX_DISPLAY_SAMPLES) {
+    skip = size - SIGDIGGER_WAVEFORM_TAB_MAX_DISPLAY_SAMPLES;
+    size = SIGDIGGER_WAVEFORM_TAB_MAX_DISPLAY_SAMPLES;
+  }
+
+  // Drop the oldest half of the display window once it is full. The
+  // capacity is kept, so this does not reallocate.
+  if (this->buffer.size() + size > SIGDIGGER_WAVEFORM_TAB_MAX_DISPLAY_SAMPLES
+      && !this->buffer.empty()) {
+    size_t drop = this->buffer.size() / 2;
+
+    if (this->buffer.size() - drop + size
+        > SIGDIGGER_WAVEFORM_TAB_MAX_DISPLAY_SAMPLES)
+      drop = this->buffer.size();
+
+    this->buffer.erase(
+          this->buffer.begin(),
+          this->buffer.begin() + static_cast<long>(drop));
+    this->displayOffset += drop;
+  }
+
+  // Grow as insert() would, but onto huge pages
+  if (this->buffer.size() + size > this->buffer.capacity())
+    HugePages::reserve(
+          this->buffer,
+          std::min<size_t>(
+            std::max(2 * this->buffer.capacity(), this->buffer.size() + size),
+            SIGDIGGER_WAVEFORM_TAB_MAX_DISPLAY_SAMPLES));
+
+  this->displayOffset += skip;
+  this->buffer.insert(
+        this->buffer.end(),
+        this->pending.begin() + static_cast<long>(skip),
+        this->pending.end());
+  this->pending.clear();
+}
+
+void
+WaveformTab::refreshView(void)
+{
+  qreal prevDuration = this->shownSize / this->fs;
   qreal currDuration;
+  qint64 offset;
 
-  this->buffer.resize(prevSize + size);
-  memcpy(this->buffer.data() + prevSize, data, size * sizeof (SUCOMPLEX));
+  if (!this->pending.empty())
+    this->commitPending();
 
-  currDuration = this->buffer.size() / this->fs;
+  // Keep recording, but leave the waveforms alone while they are hidden.
+  // showEvent() catches up.
+  if (!SigDiggerHelpers::isOnScreen(this)) {
+    this->viewStale = true;
+    return;
+  }
+
+  this->viewStale = false;
+
+  if (this->shownSize == this->store->size())
+    return;
+
+  currDuration = this->store->size() / this->fs;
+  offset = static_cast<qint64>(this->displayOffset);
 
   this->ui->realWaveform->setData(&this->buffer, true);
   this->ui->imagWaveform->setData(&this->buffer, true);
 
-  if (prevSize == 0) {
+  if (this->shownSize == 0) {
     this->onFit();
     this->ui->realWaveform->zoomHorizontal(
           static_cast<qint64>(0),
@@ -121,12 +194,42 @@ WaveformTab::feed(const SUCOMPLEX *data, unsigned int size)
       this->onFit();
 
     this->ui->realWaveform->zoomHorizontal(
-          static_cast<qint64>(this->fs * std::floor(currDuration)),
-          static_cast<qint64>(this->fs * (std::floor(currDuration) + 1.)));
+          static_cast<qint64>(this->fs * std::floor(currDuration)) - offset,
+          static_cast<qint64>(this->fs * (std::floor(currDuration) + 1.))
+          - offset);
     this->ui->imagWaveform->zoomHorizontal(
-          static_cast<qint64>(this->fs * std::floor(currDuration)),
-          static_cast<qint64>(this->fs * (std::floor(currDuration) + 1.)));
+          static_cast<qint64>(this->fs * std::floor(currDuration)) - offset,
+          static_cast<qint64>(this->fs * (std::floor(currDuration) + 1.))
+          - offset);
   }
+
+  this->shownSize = this->store->size();
+}
+
+void
+WaveformTab::showEvent(QShowEvent *event)
+{
+  QWidget::showEvent(event);
+
+  if (this->viewStale)
+    this->refreshView();
+}
+
+//
+// Start and end are given in samples since the beginning of the recording.
+// The export reads them back from the store, block by block, so spilled
+// samples never have to fit in RAM at once.
+//
+void
+WaveformTab::saveRange(size_t start, size_t end)
+{
+  SigDiggerHelpers::openSaveSamplesDialog(
+        this,
+        this->store,
+        this->fs,
+        start,
+        end,
+        Suscan::Singleton::get_instance()->getBackgroundTaskController());
 }
 
 void
@@ -510,6 +613,14 @@ WaveformTab::clear(void)
   this->ui->imagWaveform->setSampleRate(this->fs);
 
   this->buffer.clear();
+  this->pending.clear();
+  // Exports may still be reading the previous recording
+  if (this->store.use_count() > 1)
+    this->store = std::make_shared<SampleStore>();
+  else
+    this->store->clear();
+  this->displayOffset = 0;
+  this->shownSize = 0;
 
   this->ui->realWaveform->setData(nullptr);
   this->ui->imagWaveform->setData(nullptr);
@@ -708,6 +819,7 @@ WaveformTab::onRecord(void)
   this->recording = this->ui->recordButton->isChecked();
 
   if (!this->recording) {
+    this->refreshView();
     this->onFit();
     this->refreshMeasures();
     this->refreshUi();
@@ -720,27 +832,24 @@ WaveformTab::onRecord(void)
 void
 WaveformTab::onSaveAll(void)
 {
-  SigDiggerHelpers::openSaveSamplesDialog(
-        this,
-        this->getDisplayData(),
-        this->getDisplayDataLength(),
-        this->fs,
-        0,
-        static_cast<int>(this->getDisplayDataLength()),
-        Suscan::Singleton::get_instance()->getBackgroundTaskController());
+  this->saveRange(0, this->store->size());
 }
 
 void
 WaveformTab::onSaveSelection(void)
 {
-  SigDiggerHelpers::openSaveSamplesDialog(
-        this,
-        this->getDisplayData(),
-        this->getDisplayDataLength(),
-        this->fs,
-        static_cast<int>(this->ui->realWaveform->getHorizontalSelectionStart()),
-        static_cast<int>(this->ui->realWaveform->getHorizontalSelectionEnd()),
-        Suscan::Singleton::get_instance()->getBackgroundTaskController());
+  qreal start = this->ui->realWaveform->getHorizontalSelectionStart();
+  qreal end   = this->ui->realWaveform->getHorizontalSelectionEnd();
+
+  if (start < 0)
+    start = 0;
+
+  if (end < start)
+    end = start;
+
+  this->saveRange(
+        this->displayOffset + static_cast<size_t>(start),
+        this->displayOffset + static_cast<size_t>(end));
 }
 
 void
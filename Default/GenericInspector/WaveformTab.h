@@ -4,6 +4,14 @@
 #include <QWidget>
 #include <sigutils/types.h>
 #include "ColorConfig.h"
+#include "SampleStore.h"
+
+//
+// The waveform widgets need contiguous data, so they only get to see the
+// latest samples of the recording. The whole recording is kept in a
+// SampleStore, which spills to disk.
+//
+#define SIGDIGGER_WAVEFORM_TAB_MAX_DISPLAY_SAMPLES (1 << 25)
 
 class ThrottleControl;
 class QPushButton;
@@ -19,20 +27,28 @@ namespace SigDigger {
 
     qreal fs = 1;
     std::vector<SUCOMPLEX> buffer;
+    std::vector<SUCOMPLEX> pending; // Fed since the last frame
+    std::shared_ptr<SampleStore> store = std::make_shared<SampleStore>();
+    size_t displayOffset = 0;
+    size_t shownSize = 0;           // Store size at the last frame
     bool recording = false;
 
     bool hadSelectionBefore = true; // Yep. This must be true.
     bool adjusting = false;
     bool firstShow = true;
+    bool viewStale = false; // Recorded while not on screen
 
     const SUCOMPLEX *getDisplayData(void) const;
     size_t getDisplayDataLength(void) const;
+    void saveRange(size_t start, size_t end);
 
     int getPeriodicDivision(void) const;
 
     void recalcLimits(void);
     void refreshMeasures(void);
     void refreshUi(void);
+    void commitPending(void);
+    void refreshView(void);
 
     void samplingNotifySelection(bool, bool);
     void samplingSetEnabled(bool);
@@ -68,6 +84,9 @@ namespace SigDigger {
 
     void feed(const SUCOMPLEX *, unsigned int);
 
+  protected:
+    void showEvent(QShowEvent *) override;
+
   public slots:
     void onHZoom(qint64 min, qint64 max);
     void onVZoom(qreal min, qreal max);
@@ -39,11 +39,12 @@ InspToolWidgetConfig::deserialize(Suscan::Object const &conf)
   LOAD(collapsed);
   LOAD(inspectorClass);
   LOAD(inspFactory);
-  LOAD(precise);
+  LOAD(centering);
   LOAD(palette);
   LOAD(paletteOffset);
   LOAD(paletteContrast);
   LOAD(autoSquelchTriggerSNR);
+  LOAD(preTriggerMs);
 }
 
 Suscan::Object &&
@@ -56,11 +57,12 @@ InspToolWidgetConfig::serialize(void)
   STORE(collapsed);
   STORE(inspectorClass);
   STORE(inspFactory);
-  STORE(precise);
+  STORE(centering);
   STORE(palette);
   STORE(paletteOffset);
   STORE(paletteContrast);
   STORE(autoSquelchTriggerSNR);
+  STORE(preTriggerMs);
 
   return this->persist(obj);
 }
@@ -86,15 +88,16 @@ InspToolWidget::refreshInspectorCombo()
 
   this->ui->inspectorCombo->clear();
 
-  for (auto p = sus->getFirstInspectionWidgetFactory();
-       p != sus->getLastInspectionWidgetFactory();
-       ++p, ++i) {
+  // Listed from the manifests too: plugins are loaded on first use
+  for (auto const &p : sus->getInspectionWidgetFactoryList()) {
     this->ui->inspectorCombo->addItem(
-          QString((*p)->description()),
-          QVariant::fromValue<QString>((*p)->name()));
+          p.second,
+          QVariant::fromValue<QString>(p.first));
 
-    if ((*p)->name() == factory)
+    if (p.first.toStdString() == factory)
       index = i;
+
+    ++i;
   }
 
   this->ui->inspectorCombo->setEnabled(index != -1);
@@ -110,7 +113,12 @@ InspToolWidget::applyConfig(void)
 {
   this->refreshInspectorCombo();
   this->setInspectorClass(this->panelConfig->inspectorClass);
-  this->setPrecise(this->panelConfig->precise);
+  this->setPrecision(
+        this->panelConfig->centering == "precise"
+        ? Suscan::CHANNEL_PRECISION_PRECISE
+        : this->panelConfig->centering == "fast"
+          ? Suscan::CHANNEL_PRECISION_FAST
+          : Suscan::CHANNEL_PRECISION_AUTO);
   this->timeWindow->postLoadInit();
   this->timeWindow->setPalette(this->panelConfig->palette);
   this->timeWindow->setPaletteOffset(this->panelConfig->paletteOffset);
@@ -119,6 +127,8 @@ InspToolWidget::applyConfig(void)
   this->ui->frequencySpinBox->setMinimum(-18e9);
   this->ui->triggerSpin->setValue(
         static_cast<qreal>(this->panelConfig->autoSquelchTriggerSNR));
+  this->ui->preTriggerSpin->setValue(
+        static_cast<int>(this->panelConfig->preTriggerMs));
 
   this->setProperty("collapsed", this->panelConfig->collapsed);
 
@@ -160,10 +170,10 @@ InspToolWidget::connectAll(void)
         SLOT(onOpenInspector(void)));
 
   connect(
-        this->ui->preciseCheck,
-        SIGNAL(stateChanged(int)),
+        this->ui->centeringCombo,
+        SIGNAL(activated(int)),
         this,
-        SLOT(onPreciseChanged(void)));
+        SLOT(onCenteringChanged(void)));
 
   connect(
         this->ui->captureButton,
@@ -201,6 +211,12 @@ InspToolWidget::connectAll(void)
         this,
         SLOT(onTriggerSNRChanged(double)));
 
+  connect(
+        this->ui->preTriggerSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onPreTriggerChanged(int)));
+
   connect(
         this->mediator()->getMainSpectrum(),
         SIGNAL(bandwidthChanged()),
@@ -301,9 +317,10 @@ InspToolWidget::setBandwidth(unsigned int freq)
 }
 
 void
-InspToolWidget::setPrecise(bool precise)
+InspToolWidget::setPrecision(Suscan::ChannelPrecision precision)
 {
-  this->ui->preciseCheck->setChecked(precise);
+  // Items are in the same order as the enum
+  this->ui->centeringCombo->setCurrentIndex(static_cast<int>(precision));
 }
 
 void
@@ -322,10 +339,11 @@ InspToolWidget::getState(void) const
   return this->state;
 }
 
-bool
-InspToolWidget::getPrecise(void) const
+Suscan::ChannelPrecision
+InspToolWidget::getPrecision(void) const
 {
-  return this->ui->preciseCheck->isChecked();
+  return static_cast<Suscan::ChannelPrecision>(
+        this->ui->centeringCombo->currentIndex());
 }
 
 void
@@ -370,11 +388,10 @@ InspToolWidget::resetRawInspector(qreal fs)
         SIGDIGGER_DEFAULT_UPDATEUI_PERIOD_MS * 1e-3 * this->timeWindowFs);
   this->maxSamples = this->ui->maxMemSpin->value() * (1 << 20) / sizeof(SUCOMPLEX);
   this->ui->hangTimeSpin->setMinimum(std::ceil(1e3 / fs));
-  this->data.resize(0);
-  this->timeWindow->setData(
-        this->data,
-        this->timeWindowFs,
-        this->ui->bandwidthSpin->value());
+  // Start over with a fresh buffer. Whatever the time window (or an
+  // export task) holds is left alone.
+  if (!this->data->empty())
+    this->data = std::make_shared<std::vector<SUCOMPLEX>>();
   this->ui->sampleRateLabel->setText(
         SuWidgetsHelpers::formatQuantity(fs, "sp/s"));
   this->ui->durationLabel->setText(
@@ -388,28 +405,92 @@ InspToolWidget::refreshCaptureInfo(void)
 {
   this->ui->durationLabel->setText(
         SuWidgetsHelpers::formatQuantityFromDelta(
-          this->data.size() / this->timeWindowFs,
+          this->data->size() / this->timeWindowFs,
           1 / this->timeWindowFs,
           "s"));
   this->ui->memoryLabel->setText(
         SuWidgetsHelpers::formatBinaryQuantity(
-          static_cast<qint64>(this->data.size() * sizeof(SUCOMPLEX))));
+          static_cast<qint64>(this->data->size() * sizeof(SUCOMPLEX))));
+}
+
+//
+// Growing the capture by doubling would both copy it repeatedly and leave
+// up to twice its size allocated right at the memory limit. The whole limit
+// is reserved instead: pages are only backed as samples are written, and
+// on huge pages where possible.
+//
+void
+InspToolWidget::reserveCapture(void)
+{
+  HugePages::reserve(*this->data, this->maxSamples);
+}
+
+void
+InspToolWidget::resetHistory(SUSCOUNT length)
+{
+  // No need to clear it: only the first historyFill samples are valid.
+  // It is written all over soon, so get the pages ready first.
+  this->history.resize(length);
+  HugePages::prefault(this->history.data(), length * sizeof(SUCOMPLEX));
+  this->historyPtr  = 0;
+  this->historyFill = 0;
+}
+
+void
+InspToolWidget::pushHistory(const SUCOMPLEX *data, size_t size)
+{
+  size_t len = this->history.size();
+  size_t chunk;
+
+  if (len == 0)
+    return;
+
+  // Only the newest samples would survive anyway
+  if (size > len) {
+    data += size - len;
+    size  = len;
+  }
+
+  chunk = std::min(size, len - this->historyPtr);
+
+  std::copy(data, data + chunk, this->history.begin() + this->historyPtr);
+  std::copy(data + chunk, data + size, this->history.begin());
+
+  this->historyPtr   = (this->historyPtr + size) % len;
+  this->historyFill  = std::min(this->historyFill + size, len);
 }
 
 void
 InspToolWidget::transferHistory(void)
 {
-  // Insert older samples
-  this->data.insert(
-        this->data.end(),
-        this->history.begin() + this->historyPtr,
-        this->history.end());
+  size_t len = this->history.size();
+  size_t start;
+
+  if (this->historyFill == 0)
+    return;
+
+  start = (this->historyPtr + len - this->historyFill) % len;
+
+  this->reserveCapture();
 
-  // Insert newer samples
-  this->data.insert(
-        this->data.end(),
-        this->history.begin(),
-        this->history.begin() + this->historyPtr);
+  if (start + this->historyFill <= len) {
+    this->data->insert(
+          this->data->end(),
+          this->history.begin() + start,
+          this->history.begin() + start + this->historyFill);
+  } else {
+    // Older samples, then newer samples
+    this->data->insert(
+          this->data->end(),
+          this->history.begin() + start,
+          this->history.end());
+    this->data->insert(
+          this->data->end(),
+          this->history.begin(),
+          this->history.begin() + this->historyPtr);
+  }
+
+  this->historyFill = 0;
 }
 
 void
@@ -424,7 +505,9 @@ InspToolWidget::feedRawInspector(const SUCOMPLEX *data, size_t size)
 
   if (this->ui->captureButton->isDown()) {
     // Manual capture
-    this->data.insert(this->data.end(), data, data + size);
+    if (this->data->empty())
+      this->reserveCapture();
+    this->data->insert(this->data->end(), data, data + size);
     if (refreshUi)
       this->refreshCaptureInfo();
   } else if (this->autoSquelch) {
@@ -455,11 +538,7 @@ InspToolWidget::feedRawInspector(const SUCOMPLEX *data, size_t size)
     } else { // CASE 2: Measure a small fraction
       SUFLOAT immEnergy = this->timeWindowFs * sum;
 
-      for (size_t i = 0; i < size; ++i) {
-        this->history[this->historyPtr++] = data[i];
-        if (this->historyPtr == this->history.size())
-          this->historyPtr = 0;
-      }
+      this->pushHistory(data, size);
 
       // Limited energy accumulation
       if (size > this->hangLength) {
@@ -509,17 +588,18 @@ InspToolWidget::feedRawInspector(const SUCOMPLEX *data, size_t size)
 
     // TRIGGERED: Recording the channel
     if (this->autoSquelchTriggered) {
-      this->data.insert(this->data.end(), data, data + size);
+      this->data->insert(this->data->end(), data, data + size);
       this->refreshCaptureInfo();
-      if (this->data.size() > this->hangLength) {
+      if (this->data->size() > this->hangLength) {
         if (immLevel >= this->hangLevel)
           this->hangCounter = 0;
         else
           this->hangCounter += size;
 
-        if (this->hangCounter >= this->hangLength || this->data.size() > this->maxSamples) { // Hang!
-          this->cancelAutoSquelch();
+        if (this->hangCounter >= this->hangLength || this->data->size() > this->maxSamples) { // Hang!
+          // Hand the capture over before the sample rate is reset
           this->openTimeWindow();
+          this->cancelAutoSquelch();
         }
       }
     }
@@ -529,8 +609,14 @@ InspToolWidget::feedRawInspector(const SUCOMPLEX *data, size_t size)
 void
 InspToolWidget::openTimeWindow(void)
 {
+  std::shared_ptr<std::vector<SUCOMPLEX>> capture;
+
+  // The time window takes the buffer itself. New samples go to a new one.
+  capture.swap(this->data);
+  this->data = std::make_shared<std::vector<SUCOMPLEX>>();
+
   this->timeWindow->setData(
-        this->data,
+        capture,
         this->timeWindowFs,
         this->ui->bandwidthSpin->value());
   this->timeWindow->setCenterFreq(this->demodFreq);
@@ -554,7 +640,7 @@ InspToolWidget::enableAutoSquelch(void)
   // Enable autoSquelch
   this->autoSquelch = true;
   this->powerAccum = this->powerError = this->powerSamples = 0;
-  this->historyPtr = 0;
+  this->resetHistory(0);
   this->ui->squelchLevelLabel->setEnabled(true);
   this->ui->powerLabel->setEnabled(true);
   this->ui->captureButton->setEnabled(false);
@@ -562,6 +648,7 @@ InspToolWidget::enableAutoSquelch(void)
   this->ui->hangTimeSpin->setEnabled(false);
   this->ui->maxMemSpin->setEnabled(false);
   this->ui->triggerSpin->setEnabled(false);
+  this->ui->preTriggerSpin->setEnabled(false);
 
   this->startRawCapture();
 }
@@ -581,6 +668,7 @@ InspToolWidget::cancelAutoSquelch(void)
   this->ui->hangTimeSpin->setEnabled(true);
   this->ui->maxMemSpin->setEnabled(true);
   this->ui->triggerSpin->setEnabled(true);
+  this->ui->preTriggerSpin->setEnabled(true);
   this->ui->autoSquelchButton->setText("Autosquelch");
 
   this->stopRawCapture();
@@ -623,29 +711,30 @@ InspToolWidget::setState(int, Suscan::Analyzer *analyzer)
     m_opened = false;
 
     if (m_analyzer != nullptr) {
-      connect(
-            m_analyzer,
-            SIGNAL(source_info_message(Suscan::SourceInfoMessage const &)),
-            this,
-            SLOT(onSourceInfoMessage(Suscan::SourceInfoMessage const &)));
-
       connect(
             m_analyzer,
             SIGNAL(inspector_message(Suscan::InspectorMessage const &)),
             this,
             SLOT(onInspectorMessage(Suscan::InspectorMessage const &)));
-
-      connect(
-            m_analyzer,
-            SIGNAL(samples_message(Suscan::SamplesMessage const &)),
-            this,
-            SLOT(onInspectorSamples(Suscan::SamplesMessage const &)));
     }
 
     this->setState(m_analyzer == nullptr ? DETACHED : ATTACHED);
   }
 }
 
+void
+InspToolWidget::setSourceInfo(
+    Suscan::AnalyzerSourceInfo const &info,
+    unsigned int changes)
+{
+  if (changes & Suscan::SOURCE_INFO_SAMPLE_RATE)
+    this->setBandwidthLimits(1, SCAST(unsigned, info.getSampleRate()));
+
+  // Only the permissions are kept
+  if (changes & Suscan::SOURCE_INFO_PERMISSIONS)
+    this->applySourceInfo(info);
+}
+
 void
 InspToolWidget::setProfile(Suscan::Source::Config &config)
 {
@@ -701,7 +790,7 @@ InspToolWidget::onOpenInspector(void)
         this->panelConfig->inspFactory.c_str(),
         this->panelConfig->inspectorClass.c_str(),
         ch,
-        this->ui->preciseCheck->isChecked());
+        this->getPrecision());
 }
 
 void
@@ -712,9 +801,20 @@ InspToolWidget::onBandwidthChanged(double bw)
 }
 
 void
-InspToolWidget::onPreciseChanged(void)
+InspToolWidget::onCenteringChanged(void)
 {
-  this->panelConfig->precise = this->ui->preciseCheck->isChecked();
+  switch (this->getPrecision()) {
+    case Suscan::CHANNEL_PRECISION_PRECISE:
+      this->panelConfig->centering = "precise";
+      break;
+
+    case Suscan::CHANNEL_PRECISION_FAST:
+      this->panelConfig->centering = "fast";
+      break;
+
+    default:
+      this->panelConfig->centering = "auto";
+  }
 }
 
 void
@@ -724,9 +824,9 @@ InspToolWidget::onPressAutoSquelch(void)
     this->enableAutoSquelch();
     this->ui->autoSquelchButton->setText("Measuring...");
   } else {
-    this->cancelAutoSquelch();
-    if (this->data.size() > 0)
+    if (this->data->size() > 0)
       this->openTimeWindow();
+    this->cancelAutoSquelch();
   }
 }
 
@@ -739,8 +839,13 @@ InspToolWidget::onReleaseAutoSquelch(void)
     } else {
       this->hangLength =
           1e-3 * this->ui->hangTimeSpin->value() * this->timeWindowFs;
-      this->history.resize(2 * this->hangLength);
-      std::fill(this->history.begin(), this->history.end(), 0);
+      // The squelch level is averaged over the hang time, so it crosses
+      // the threshold up to one hang length after the onset. Keep that
+      // much, plus the requested pre-trigger time.
+      this->resetHistory(
+            this->hangLength
+            + SCAST(SUSCOUNT,
+                1e-3 * this->ui->preTriggerSpin->value() * this->timeWindowFs));
       this->powerAccum /= this->powerSamples;
       this->powerSamples = 1;
       this->ui->autoSquelchButton->setText("Waiting...");
@@ -765,7 +870,7 @@ InspToolWidget::onReleaseHold(void)
 {
   stopRawCapture();
 
-  if (this->data.size() > 0)
+  if (this->data->size() > 0)
     this->openTimeWindow();
 }
 
@@ -783,6 +888,12 @@ InspToolWidget::onTriggerSNRChanged(double val)
   this->panelConfig->autoSquelchTriggerSNR = static_cast<SUFLOAT>(val);
 }
 
+void
+InspToolWidget::onPreTriggerChanged(int val)
+{
+  this->panelConfig->preTriggerMs = static_cast<unsigned int>(val);
+}
+
 
 // Main UI slots
 void
@@ -806,6 +917,14 @@ InspToolWidget::onOpened(Suscan::AnalyzerRequest const &request)
   m_opened = true;
   m_request = request;
 
+  if (m_analyzer != nullptr)
+    m_analyzer->registerSamplesRoute(
+          request.inspectorId,
+          this,
+          [this] (Suscan::SamplesMessage const &msg) {
+            this->onInspectorSamples(msg);
+          });
+
   this->resetRawInspector(SCAST(qreal, request.equivRate));
 }
 
@@ -826,24 +945,16 @@ InspToolWidget::onError(Suscan::AnalyzerRequest const &, std::string const &erro
 }
 
 // Analyzer slots
-void
-InspToolWidget::onSourceInfoMessage(Suscan::SourceInfoMessage const &msg)
-{
-  this->setBandwidthLimits(
-        1,
-        SCAST(unsigned, msg.info()->getSampleRate()));
-
-  this->applySourceInfo(*msg.info());
-}
-
 void
 InspToolWidget::onInspectorMessage(Suscan::InspectorMessage const &msg)
 {
   if (
       m_opened
       && msg.getKind() == SUSCAN_ANALYZER_INSPECTOR_MSGKIND_CLOSE
-      && msg.getInspectorId() == m_request.inspectorId)
+      && msg.getInspectorId() == m_request.inspectorId) {
     m_opened = false;
+    m_analyzer->unregisterSamplesRoute(m_request.inspectorId);
+  }
 }
 
 void
@@ -22,11 +22,13 @@
 #include <ToolWidgetFactory.h>
 #include <TimeWindow.h>
 #include <ColorConfig.h>
+#include <HugePages.h>
 #include <Suscan/Analyzer.h>
 #include <Suscan/AnalyzerRequestTracker.h>
 
 #define SIGDIGGER_DEFAULT_SQUELCH_TRIGGER  10
 #define SIGDIGGER_DEFAULT_UPDATEUI_PERIOD_MS 250.
+#define SIGDIGGER_DEFAULT_PRETRIGGER_MS    100
 
 namespace Ui {
   class InspectorPanel;
@@ -48,9 +50,10 @@ namespace SigDigger {
     std::string palette = "Suscan";
     std::string inspFactory = "GenericInspector";
     SUFLOAT autoSquelchTriggerSNR = SIGDIGGER_DEFAULT_SQUELCH_TRIGGER;
+    unsigned int preTriggerMs = SIGDIGGER_DEFAULT_PRETRIGGER_MS;
     unsigned int paletteOffset;
     int paletteContrast;
-    bool precise = false;
+    std::string centering = "auto"; // auto, precise or fast
 
     // Overriden methods
     void deserialize(Suscan::Object const &conf) override;
@@ -92,9 +95,14 @@ namespace SigDigger {
     Suscan::AnalyzerSourceInfo sourceInfo =
         Suscan::AnalyzerSourceInfo();
 
-    std::vector<SUCOMPLEX> data;
-    std::vector<SUCOMPLEX> history;
-    unsigned int historyPtr = 0;
+    std::shared_ptr<std::vector<SUCOMPLEX>> data =
+        std::make_shared<std::vector<SUCOMPLEX>>();
+
+    // Pre-trigger ring: the newest historyFill samples, ending right
+    // before historyPtr. Allocated once per squelch session.
+    std::vector<SUCOMPLEX, HugePageAllocator<SUCOMPLEX>> history;
+    size_t historyPtr = 0;
+    size_t historyFill = 0;
     SUFLOAT  currEnergy = 0;
     SUFLOAT  powerAccum = 0;
     SUFLOAT  powerError = 0;
@@ -113,13 +121,16 @@ namespace SigDigger {
     void setInspectorClass(std::string const &cls);
     void refreshCaptureInfo(void);
     void openTimeWindow(void);
+    void reserveCapture(void);
+    void resetHistory(SUSCOUNT length);
+    void pushHistory(const SUCOMPLEX *data, size_t size);
     void transferHistory(void);
 
     void applySourceInfo(Suscan::AnalyzerSourceInfo const &info);
     void setDemodFrequency(qint64);
     void setBandwidthLimits(unsigned int min, unsigned int max);
     void setBandwidth(unsigned int freq);
-    void setPrecise(bool precise);
+    void setPrecision(Suscan::ChannelPrecision);
     void setState(enum State state);
 
     void startRawCapture();
@@ -130,7 +141,7 @@ namespace SigDigger {
 
     unsigned int getBandwidth(void) const;
     std::string getInspectorClass(void) const;
-    bool getPrecise(void) const;
+    Suscan::ChannelPrecision getPrecision(void) const;
     enum State getState(void) const;
     void refreshInspectorCombo();
 
@@ -145,6 +156,9 @@ namespace SigDigger {
     // Overriden methods
     void setState(int, Suscan::Analyzer *) override;
     void setProfile(Suscan::Source::Config &) override;
+    void setSourceInfo(
+        Suscan::AnalyzerSourceInfo const &,
+        unsigned int changes) override;
     void setColorConfig(ColorConfig const &) override;
     Suscan::Serializable *allocConfig(void) override;
     void applyConfig(void) override;
@@ -154,7 +168,7 @@ namespace SigDigger {
     // UI slots
     void onOpenInspector(void);
     void onBandwidthChanged(double);
-    void onPreciseChanged(void);
+    void onCenteringChanged(void);
     void onPressHold(void);
     void onReleaseHold(void);
 
@@ -164,6 +178,7 @@ namespace SigDigger {
 
     void onTimeWindowConfigChanged(void);
     void onTriggerSNRChanged(double val);
+    void onPreTriggerChanged(int val);
 
     // Main UI slots
     void onSpectrumBandwidthChanged(void);
@@ -175,7 +190,6 @@ namespace SigDigger {
     void onError(Suscan::AnalyzerRequest const &, std::string const &);
 
     // Analyzer slots
-    void onSourceInfoMessage(Suscan::SourceInfoMessage const &);
     void onInspectorMessage(Suscan::InspectorMessage const &);
     void onInspectorSamples(Suscan::SamplesMessage const &);
   };
@@ -42,3 +42,10 @@ InspToolWidgetFactory::getTitle() const
 {
   return "Channel inspection";
 }
+
+bool
+InspToolWidgetFactory::deferrable(void) const
+{
+  // Nothing happens here until the user asks for it from the panel
+  return true;
+}
@@ -31,6 +31,7 @@ namespace SigDigger {
     // ToolWidgetFactory overrides
     ToolWidget *make(UIMediator *) override;
     std::string getTitle() const override;
+    bool deferrable(void) const override;
 
     InspToolWidgetFactory(Suscan::Plugin *);
   };
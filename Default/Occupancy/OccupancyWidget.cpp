@@ -0,0 +1,481 @@
+//
+//    Default/Occupancy/OccupancyWidget.cpp: Occupancy statistics tool
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "OccupancyWidgetFactory.h"
+#include "OccupancyWidget.h"
+#include <QDateTime>
+#include <QEvent>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QImage>
+#include <SigDiggerHelpers.h>
+#include <SuWidgetsHelpers.h>
+#include <UIMediator.h>
+#include "ui_OccupancyWidget.h"
+#include <algorithm>
+
+using namespace SigDigger;
+
+//////////////////////////// Occupancy widget config ///////////////////////////
+#define STRINGFY(x) #x
+#define STORE(field) obj.set(STRINGFY(field), this->field)
+#define LOAD(field) this->field = conf.get(STRINGFY(field), this->field)
+
+void
+OccupancyWidgetConfig::deserialize(Suscan::Object const &conf)
+{
+  LOAD(collapsed);
+  LOAD(enabled);
+  LOAD(path);
+  LOAD(bucket);
+  LOAD(threshold);
+  LOAD(channels);
+  LOAD(column);
+  LOAD(hours);
+}
+
+Suscan::Object &&
+OccupancyWidgetConfig::serialize(void)
+{
+  Suscan::Object obj(SUSCAN_OBJECT_TYPE_OBJECT);
+
+  obj.setClass("OccupancyWidgetConfig");
+
+  STORE(collapsed);
+  STORE(enabled);
+  STORE(path);
+  STORE(bucket);
+  STORE(threshold);
+  STORE(channels);
+  STORE(column);
+  STORE(hours);
+
+  return this->persist(obj);
+}
+
+///////////////////////// Occupancy widget config //////////////////////////////
+Suscan::Serializable *
+OccupancyWidget::allocConfig(void)
+{
+  return this->panelConfig = new OccupancyWidgetConfig();
+}
+
+void
+OccupancyWidget::applyConfig(void)
+{
+  OccupancyWidgetConfig savedConfig = *this->panelConfig;
+
+  // Setting the first widget would overwrite the rest of the config
+  this->ui->pathEdit->setText(QString::fromStdString(savedConfig.path));
+  this->ui->bucketSpin->setValue(static_cast<qreal>(savedConfig.bucket));
+  this->ui->thresholdSpin->setValue(static_cast<qreal>(savedConfig.threshold));
+  this->ui->channelsSpin->setValue(static_cast<int>(savedConfig.channels));
+  this->ui->columnCombo->setCurrentIndex(savedConfig.column);
+  this->ui->hoursSpin->setValue(static_cast<int>(savedConfig.hours));
+
+  *this->panelConfig = savedConfig;
+
+  this->setProperty("collapsed", savedConfig.collapsed);
+
+  this->pushParams();
+
+  // Resume accumulating where the previous session left it
+  this->ui->enableCheck->setChecked(savedConfig.enabled);
+
+  this->refreshUi();
+  this->refreshStatus();
+  this->refreshHeatMap();
+}
+
+bool
+OccupancyWidget::event(QEvent *event)
+{
+  if (event->type() == QEvent::DynamicPropertyChange) {
+    QDynamicPropertyChangeEvent *const propEvent =
+        static_cast<QDynamicPropertyChangeEvent*>(event);
+    QString propName = propEvent->propertyName();
+    if (propName == "collapsed")
+      this->panelConfig->collapsed = this->property("collapsed").value<bool>();
+  }
+
+  return ToolWidget::event(event);
+}
+
+void
+OccupancyWidget::setState(int, Suscan::Analyzer *)
+{
+  // NO-OP: the mediator feeds the accumulator
+}
+
+void
+OccupancyWidget::setProfile(Suscan::Source::Config &)
+{
+  // NO-OP
+}
+
+void
+OccupancyWidget::connectAll(void)
+{
+  connect(
+        this->ui->enableCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onEnabledChanged(void)));
+
+  connect(
+        this->ui->bucketSpin,
+        SIGNAL(valueChanged(double)),
+        this,
+        SLOT(onParamsChanged(void)));
+
+  connect(
+        this->ui->thresholdSpin,
+        SIGNAL(valueChanged(double)),
+        this,
+        SLOT(onParamsChanged(void)));
+
+  connect(
+        this->ui->channelsSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onParamsChanged(void)));
+
+  connect(
+        this->ui->pathEdit,
+        SIGNAL(editingFinished(void)),
+        this,
+        SLOT(onPathChanged(void)));
+
+  connect(
+        this->ui->browseButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onBrowse(void)));
+
+  connect(
+        this->ui->columnCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onViewChanged(void)));
+
+  connect(
+        this->ui->hoursSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onViewChanged(void)));
+
+  connect(
+        this->ui->refreshButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onViewChanged(void)));
+
+  connect(
+        &m_timer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onTimeout(void)));
+}
+
+OccupancyWidget::OccupancyWidget(
+    OccupancyWidgetFactory *factory,
+    UIMediator *mediator,
+    QWidget *parent) :
+  ToolWidget(factory, mediator, parent),
+  ui(new Ui::OccupancyWidget)
+{
+  ui->setupUi(this);
+
+  m_mediator = mediator;
+  m_accumulator = mediator->getOccupancyAccumulator();
+
+  this->assertConfig();
+
+  m_timer.setInterval(SIGDIGGER_OCCUPANCY_VIEW_UPDATE_MS);
+  m_timer.start();
+
+  this->connectAll();
+
+  this->setProperty("collapsed", this->panelConfig->collapsed);
+}
+
+OccupancyWidget::~OccupancyWidget()
+{
+  delete ui;
+}
+
+//////////////////////////////// Private methods ///////////////////////////////
+void
+OccupancyWidget::pushParams(void)
+{
+  OccupancyParams params;
+
+  params.bucket = static_cast<qreal>(this->panelConfig->bucket);
+  params.threshold = this->panelConfig->threshold;
+
+  m_accumulator->setParams(params);
+}
+
+void
+OccupancyWidget::refreshUi(void)
+{
+  bool open = m_accumulator->isOpen();
+
+  // The store is chosen before accumulating
+  this->ui->pathEdit->setEnabled(!open);
+  this->ui->browseButton->setEnabled(!open);
+  this->ui->channelsSpin->setEnabled(!open);
+}
+
+OccupancyStore *
+OccupancyWidget::viewStore(void)
+{
+  std::string path = this->panelConfig->path;
+
+  if (m_accumulator->isOpen())
+    return &m_accumulator->getStore();
+
+  if (m_viewStore.isOpen())
+    return &m_viewStore;
+
+  // Just looking must not create a store
+  if (path.empty()
+      || !QFileInfo(
+        QString::fromStdString(path + "/" SIGDIGGER_OCCUPANCY_INDEX_FILE))
+      .exists())
+    return nullptr;
+
+  if (!m_viewStore.open(path, this->panelConfig->channels))
+    return nullptr;
+
+  return &m_viewStore;
+}
+
+void
+OccupancyWidget::refreshStatus(void)
+{
+  OccupancyStore *store;
+
+  if (!m_accumulator->isOpen()) {
+    this->ui->statusLabel->setText("Idle");
+    return;
+  }
+
+  store = &m_accumulator->getStore();
+
+  this->ui->statusLabel->setText(
+        QString("%1 buckets of %2 channels, %3")
+        .arg(store->count())
+        .arg(store->getChannels())
+        .arg(SuWidgetsHelpers::formatBinaryQuantity(
+               static_cast<qint64>(store->size()))));
+}
+
+void
+OccupancyWidget::refreshHeatMap(void)
+{
+  OccupancyStore *store = this->viewStore();
+  OccupancyColumn column =
+      static_cast<OccupancyColumn>(this->ui->columnCombo->currentIndex());
+  const QRgb *table =
+      SigDiggerHelpers::instance()->getGqrxPalette()->getRgbTable();
+  std::vector<uint8_t> data;
+  size_t first, count, rows, channels;
+  uint8_t lo = 0, hi = 255;
+
+  if (store == nullptr || store->count() == 0) {
+    this->ui->heatMapLabel->clear();
+    this->ui->rangeLabel->clear();
+    m_shownCount = 0;
+    return;
+  }
+
+  OccupancyBucket const &last = store->bucket(store->count() - 1);
+
+  // The span ends at the last bucket, so past stores can be browsed too
+  first = store->find(last.end - 3600. * this->panelConfig->hours);
+  count = store->count() - first;
+  channels = store->getChannels();
+
+  if (!store->read(column, first, count, data)) {
+    this->ui->statusLabel->setText(QString::fromStdString(store->getError()));
+    return;
+  }
+
+  // Levels are stretched over the range found in the view
+  if (column != OCCUPANCY_DUTY && !data.empty()) {
+    auto range = std::minmax_element(data.begin(), data.end());
+    lo = *range.first;
+    hi = *range.second;
+  }
+
+  rows = std::min<size_t>(count, SIGDIGGER_OCCUPANCY_VIEW_MAX_ROWS);
+
+  QImage image(
+        static_cast<int>(channels),
+        static_cast<int>(rows),
+        QImage::Format_RGB32);
+
+  for (size_t r = 0; r < rows; ++r) {
+    // Newest on top
+    size_t group = rows - 1 - r;
+    size_t from = group * count / rows;
+    size_t to = std::max(from + 1, (group + 1) * count / rows);
+    QRgb *line = reinterpret_cast<QRgb *>(
+          image.scanLine(static_cast<int>(r)));
+
+    for (size_t c = 0; c < channels; ++c) {
+      unsigned int value = 0;
+
+      for (size_t b = from; b < to; ++b)
+        value = std::max<unsigned int>(value, data[b * channels + c]);
+
+      line[c] = table[hi > lo ? (value - lo) * 255 / (hi - lo) : 0];
+    }
+  }
+
+  this->ui->heatMapLabel->setPixmap(QPixmap::fromImage(image));
+
+  if (column == OCCUPANCY_DUTY)
+    this->ui->heatMapLabel->setToolTip("Duty cycle, 0 to 100 %");
+  else
+    this->ui->heatMapLabel->setToolTip(
+          QString("Level, %1 to %2 dB")
+          .arg(static_cast<qreal>(occupancyLevel(lo)))
+          .arg(static_cast<qreal>(occupancyLevel(hi))));
+
+  this->ui->rangeLabel->setText(
+        QString("%1 - %2, %3 - %4 UTC")
+        .arg(SuWidgetsHelpers::formatQuantity(last.fc - .5 * last.fs, 6, "Hz"))
+        .arg(SuWidgetsHelpers::formatQuantity(last.fc + .5 * last.fs, 6, "Hz"))
+        .arg(QDateTime::fromMSecsSinceEpoch(
+               static_cast<qint64>(store->bucket(first).start * 1e3))
+             .toUTC()
+             .toString("yyyy-MM-dd hh:mm"))
+        .arg(QDateTime::fromMSecsSinceEpoch(
+               static_cast<qint64>(last.end * 1e3))
+             .toUTC()
+             .toString("yyyy-MM-dd hh:mm")));
+
+  m_shownCount = store->count();
+}
+
+//////////////////////////////////// Slots /////////////////////////////////////
+void
+OccupancyWidget::onEnabledChanged(void)
+{
+  bool enabled = this->ui->enableCheck->isChecked();
+
+  if (enabled && !m_accumulator->isOpen()) {
+    m_viewStore.close();
+
+    if (this->panelConfig->path.empty()) {
+      this->ui->statusLabel->setText("Select a directory first");
+      enabled = false;
+    } else if (!m_accumulator->open(
+                 this->panelConfig->path,
+                 this->panelConfig->channels)) {
+      this->ui->statusLabel->setText(
+            QString::fromStdString(m_accumulator->getStore().getError()));
+      enabled = false;
+    }
+
+    if (!enabled) {
+      bool blocking = this->ui->enableCheck->blockSignals(true);
+      this->ui->enableCheck->setChecked(false);
+      this->ui->enableCheck->blockSignals(blocking);
+    }
+  } else if (!enabled) {
+    m_accumulator->close();
+  }
+
+  this->panelConfig->enabled = enabled;
+
+  this->refreshUi();
+
+  if (enabled)
+    this->refreshStatus();
+
+  this->refreshHeatMap();
+}
+
+void
+OccupancyWidget::onParamsChanged(void)
+{
+  this->panelConfig->bucket =
+      static_cast<float>(this->ui->bucketSpin->value());
+  this->panelConfig->threshold =
+      static_cast<float>(this->ui->thresholdSpin->value());
+  this->panelConfig->channels =
+      static_cast<unsigned int>(this->ui->channelsSpin->value());
+
+  this->pushParams();
+}
+
+void
+OccupancyWidget::onPathChanged(void)
+{
+  std::string path = this->ui->pathEdit->text().toStdString();
+
+  if (path != this->panelConfig->path) {
+    this->panelConfig->path = path;
+    m_viewStore.close();
+    this->refreshHeatMap();
+  }
+}
+
+void
+OccupancyWidget::onBrowse(void)
+{
+  QFileDialog dialog(this->ui->browseButton);
+
+  dialog.setFileMode(QFileDialog::DirectoryOnly);
+  dialog.setAcceptMode(QFileDialog::AcceptOpen);
+  dialog.setWindowTitle(QString("Select occupancy store directory"));
+
+  if (dialog.exec()) {
+    this->ui->pathEdit->setText(dialog.selectedFiles().first());
+    this->onPathChanged();
+  }
+}
+
+void
+OccupancyWidget::onViewChanged(void)
+{
+  this->panelConfig->column = this->ui->columnCombo->currentIndex();
+  this->panelConfig->hours =
+      static_cast<unsigned int>(this->ui->hoursSpin->value());
+
+  this->refreshHeatMap();
+}
+
+void
+OccupancyWidget::onTimeout(void)
+{
+  OccupancyStore *store;
+
+  if (!m_accumulator->isOpen())
+    return;
+
+  this->refreshStatus();
+
+  // A new bucket is worth a new map
+  store = &m_accumulator->getStore();
+  if (store->count() != m_shownCount)
+    this->refreshHeatMap();
+}
@@ -0,0 +1,104 @@
+//
+//    Default/Occupancy/OccupancyWidget.h: Occupancy statistics tool
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef OCCUPANCYWIDGET_H
+#define OCCUPANCYWIDGET_H
+
+#include "ToolWidgetFactory.h"
+#include <Suscan/Library.h>
+#include <OccupancyAccumulator.h>
+#include <QTimer>
+
+// Rows of the heat map. Longer spans keep the max of consecutive buckets.
+#define SIGDIGGER_OCCUPANCY_VIEW_MAX_ROWS  1024
+#define SIGDIGGER_OCCUPANCY_VIEW_UPDATE_MS 5000
+
+namespace Ui {
+  class OccupancyWidget;
+}
+
+namespace SigDigger {
+  class OccupancyWidgetFactory;
+  class UIMediator;
+
+  struct OccupancyWidgetConfig : public Suscan::Serializable {
+    bool collapsed = false;
+    bool enabled = false;
+    std::string path;
+    float bucket = SIGDIGGER_OCCUPANCY_DEFAULT_BUCKET;
+    float threshold = -80;
+    unsigned int channels = SIGDIGGER_OCCUPANCY_DEFAULT_CHANNELS;
+    int column = OCCUPANCY_DUTY;
+    unsigned int hours = 24;
+
+    // Overriden methods
+    void deserialize(Suscan::Object const &conf) override;
+    Suscan::Object &&serialize() override;
+  };
+
+  class OccupancyWidget : public ToolWidget
+  {
+    Q_OBJECT
+
+    // Convenience pointer
+    OccupancyWidgetConfig *panelConfig = nullptr;
+
+    // UI Objects
+    Ui::OccupancyWidget *ui = nullptr;
+    UIMediator *m_mediator = nullptr;
+    OccupancyAccumulator *m_accumulator = nullptr;
+
+    // Browsing a store without accumulating
+    OccupancyStore m_viewStore;
+    QTimer m_timer;
+    size_t m_shownCount = 0;
+
+    void connectAll(void);
+    void refreshUi(void);
+    void refreshStatus(void);
+    void refreshHeatMap(void);
+    void pushParams(void);
+    OccupancyStore *viewStore(void);
+
+  public:
+    OccupancyWidget(
+        OccupancyWidgetFactory *,
+        UIMediator *,
+        QWidget *parent = nullptr);
+    ~OccupancyWidget() override;
+
+    // Configuration methods
+    Suscan::Serializable *allocConfig(void) override;
+    void applyConfig(void) override;
+    bool event(QEvent *) override;
+
+    // Overriden methods
+    void setState(int, Suscan::Analyzer *) override;
+    void setProfile(Suscan::Source::Config &) override;
+
+  public slots:
+    void onEnabledChanged(void);
+    void onParamsChanged(void);
+    void onPathChanged(void);
+    void onBrowse(void);
+    void onViewChanged(void);
+    void onTimeout(void);
+  };
+}
+
+#endif // OCCUPANCYWIDGET_H
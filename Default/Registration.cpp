@@ -22,8 +22,12 @@
 #include "Source/SourceWidgetFactory.h"
 #include "Inspection/InspToolWidgetFactory.h"
 #include "FFT/FFTWidgetFactory.h"
+#include "Detector/DetectorWidgetFactory.h"
+#include "Occupancy/OccupancyWidgetFactory.h"
 #include "DefaultTab/DefaultTabWidgetFactory.h"
 #include "GenericInspector/GenericInspectorFactory.h"
+#include "ZoomSpectrum/ZoomSpectrumFactory.h"
+#include "RemoteControl/RemoteControlFactory.h"
 
 #include <Suscan/Library.h>
 
@@ -45,10 +49,15 @@ SigDigger::DefaultPluginEntry(Suscan::Plugin *plugin)
   sus->registerToolWidgetFactory(new SourceWidgetFactory(plugin));
   sus->registerToolWidgetFactory(new InspToolWidgetFactory(plugin));
   sus->registerToolWidgetFactory(new FFTWidgetFactory(plugin));
+  sus->registerToolWidgetFactory(new DetectorWidgetFactory(plugin));
+  sus->registerToolWidgetFactory(new OccupancyWidgetFactory(plugin));
 
   sus->registerTabWidgetFactory(new DefaultTabWidgetFactory(plugin));
 
   sus->registerInspectionWidgetFactory(new GenericInspectorFactory(plugin));
+  sus->registerInspectionWidgetFactory(new ZoomSpectrumFactory(plugin));
+
+  sus->registerUIListenerFactory(new RemoteControlFactory(plugin));
 
   return true;
 }
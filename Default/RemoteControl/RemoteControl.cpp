@@ -0,0 +1,752 @@
+//
+//    RemoteControl.cpp: Remote control and telemetry endpoint
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "RemoteControl.h"
+#include "RemoteControlFactory.h"
+#include <UIMediator.h>
+#include <InspectionWidgetFactory.h>
+#include <SuWidgetsHelpers.h>
+#include <QTcpSocket>
+#include <QLocalSocket>
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QJsonArray>
+
+using namespace SigDigger;
+
+Q_DECLARE_METATYPE(SigDigger::RemoteControlClient *);
+
+#define STRINGFY(x) #x
+#define STORE(field) obj.set(STRINGFY(field), this->field)
+#define LOAD(field) this->field = conf.get(STRINGFY(field), this->field)
+
+////////////////////////////// RemoteControlConfig /////////////////////////////
+void
+RemoteControlConfig::deserialize(Suscan::Object const &conf)
+{
+  LOAD(enabled);
+  LOAD(endpoint);
+}
+
+Suscan::Object &&
+RemoteControlConfig::serialize(void)
+{
+  Suscan::Object obj(SUSCAN_OBJECT_TYPE_OBJECT);
+
+  obj.setClass("RemoteControlConfig");
+
+  STORE(enabled);
+  STORE(endpoint);
+
+  return this->persist(obj);
+}
+
+////////////////////////////// RemoteControlClient /////////////////////////////
+RemoteControlClient::RemoteControlClient(QIODevice *socket, QObject *parent) :
+  QObject(parent),
+  m_socket(socket)
+{
+  m_socket->setParent(this);
+
+  connect(
+        m_socket,
+        SIGNAL(readyRead()),
+        this,
+        SLOT(onReadyRead()));
+
+  connect(
+        m_socket,
+        SIGNAL(disconnected()),
+        this,
+        SLOT(onDisconnected()));
+}
+
+RemoteControlClient::~RemoteControlClient()
+{
+  if (m_socket != nullptr) {
+    m_socket->disconnect(this);
+    m_socket->close();
+  }
+}
+
+void
+RemoteControlClient::send(QJsonObject const &obj)
+{
+  if (m_socket == nullptr)
+    return;
+
+  m_socket->write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+  m_socket->write("\n", 1);
+}
+
+bool
+RemoteControlClient::wantsTelemetry(qint64 now) const
+{
+  return m_telemetryMs > 0 && now - m_lastTelemetry >= m_telemetryMs;
+}
+
+void
+RemoteControlClient::noteTelemetry(qint64 now)
+{
+  m_lastTelemetry = now;
+}
+
+void
+RemoteControlClient::setTelemetryInterval(int ms)
+{
+  m_telemetryMs = ms;
+  m_lastTelemetry = 0;
+}
+
+void
+RemoteControlClient::onReadyRead(void)
+{
+  QJsonParseError error;
+  QJsonDocument doc;
+  int nl;
+
+  if (m_socket == nullptr)
+    return;
+
+  m_pending.append(m_socket->readAll());
+
+  while ((nl = m_pending.indexOf('\n')) != -1) {
+    QByteArray line = m_pending.left(nl).trimmed();
+
+    m_pending.remove(0, nl + 1);
+
+    if (line.isEmpty())
+      continue;
+
+    doc = QJsonDocument::fromJson(line, &error);
+
+    if (!doc.isObject()) {
+      QJsonObject reply;
+
+      reply["ok"]    = false;
+      reply["error"] = "Malformed command: " + error.errorString();
+      this->send(reply);
+      continue;
+    }
+
+    emit command(this, doc.object());
+
+    // The command may have closed us
+    if (m_socket == nullptr)
+      return;
+  }
+
+  if (m_pending.size() >= SIGDIGGER_REMOTE_CONTROL_MAX_LINE_SIZE) {
+    m_pending.clear();
+    this->onDisconnected();
+  }
+}
+
+void
+RemoteControlClient::onDisconnected(void)
+{
+  if (m_socket != nullptr) {
+    m_socket->disconnect(this);
+    m_socket->close();
+    m_socket->deleteLater();
+    m_socket = nullptr;
+  }
+
+  emit closed(this);
+}
+
+///////////////////////////////// RemoteControl ////////////////////////////////
+RemoteControl::RemoteControl(
+    RemoteControlFactory *factory,
+    UIMediator *mediator,
+    QObject *parent) : UIListener(factory, mediator, parent)
+{
+  qRegisterMetaType<SigDigger::RemoteControlClient *>();
+
+  this->assertConfig();
+
+  m_clock.start();
+
+  connect(
+        &m_telemetryTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onTelemetryTimeout(void)));
+}
+
+RemoteControl::~RemoteControl()
+{
+  this->stopListening();
+}
+
+bool
+RemoteControl::listen(QString const &endpoint)
+{
+  if (endpoint.startsWith("unix:")) {
+    QString path = endpoint.mid(5);
+
+    // A previous instance may have left the socket behind
+    QLocalServer::removeServer(path);
+
+    m_localServer = new QLocalServer(this);
+    m_localServer->setSocketOptions(QLocalServer::UserAccessOption);
+
+    connect(
+          m_localServer,
+          SIGNAL(newConnection()),
+          this,
+          SLOT(onNewLocalConnection()));
+
+    if (!m_localServer->listen(path)) {
+      SU_ERROR(
+            "Remote control: cannot listen on %s: %s\n",
+            path.toStdString().c_str(),
+            m_localServer->errorString().toStdString().c_str());
+      return false;
+    }
+  } else if (endpoint.startsWith("tcp:")) {
+    QString address = endpoint.mid(4);
+    int colon = address.lastIndexOf(':');
+    bool ok = false;
+    quint16 port = 0;
+
+    if (colon != -1)
+      port = SCAST(quint16, address.mid(colon + 1).toUInt(&ok));
+
+    if (!ok) {
+      SU_ERROR(
+            "Remote control: invalid endpoint `%s'\n",
+            endpoint.toStdString().c_str());
+      return false;
+    }
+
+    m_tcpServer = new QTcpServer(this);
+
+    connect(
+          m_tcpServer,
+          SIGNAL(newConnection()),
+          this,
+          SLOT(onNewTcpConnection()));
+
+    if (!m_tcpServer->listen(QHostAddress(address.left(colon)), port)) {
+      SU_ERROR(
+            "Remote control: cannot listen on %s: %s\n",
+            endpoint.toStdString().c_str(),
+            m_tcpServer->errorString().toStdString().c_str());
+      return false;
+    }
+  } else {
+    SU_ERROR(
+          "Remote control: unsupported endpoint `%s' (use tcp:ADDR:PORT "
+          "or unix:PATH)\n",
+          endpoint.toStdString().c_str());
+    return false;
+  }
+
+  m_endpoint = endpoint;
+  SU_INFO("Remote control: listening on %s\n", endpoint.toStdString().c_str());
+
+  return true;
+}
+
+void
+RemoteControl::stopListening(void)
+{
+  for (auto p : m_clients) {
+    p->disconnect(this);
+    p->deleteLater();
+  }
+
+  m_clients.clear();
+  m_telemetryTimer.stop();
+
+  if (m_tcpServer != nullptr) {
+    m_tcpServer->close();
+    m_tcpServer->deleteLater();
+    m_tcpServer = nullptr;
+  }
+
+  if (m_localServer != nullptr) {
+    m_localServer->close();
+    m_localServer->deleteLater();
+    m_localServer = nullptr;
+  }
+
+  m_endpoint.clear();
+}
+
+void
+RemoteControl::addClient(QIODevice *socket)
+{
+  RemoteControlClient *client = new RemoteControlClient(socket, this);
+
+  connect(
+        client,
+        SIGNAL(command(SigDigger::RemoteControlClient *, QJsonObject)),
+        this,
+        SLOT(onCommand(SigDigger::RemoteControlClient *, QJsonObject)));
+
+  connect(
+        client,
+        SIGNAL(closed(SigDigger::RemoteControlClient *)),
+        this,
+        SLOT(onClientClosed(SigDigger::RemoteControlClient *)));
+
+  m_clients.push_back(client);
+}
+
+void
+RemoteControl::refreshTelemetryTimer(void)
+{
+  // Ticks at the pace of the most demanding subscriber
+  int interval = 0;
+
+  for (auto p : m_clients) {
+    int ms = p->telemetryInterval();
+    if (ms > 0 && (interval == 0 || ms < interval))
+      interval = ms;
+  }
+
+  if (interval == 0) {
+    m_telemetryTimer.stop();
+  } else if (!m_telemetryTimer.isActive()
+             || m_telemetryTimer.interval() != interval) {
+    m_telemetryTimer.start(interval);
+  }
+}
+
+QJsonObject
+RemoteControl::inspectorToJson(InspectionWidget *widget) const
+{
+  Suscan::AnalyzerRequest const &request = widget->request();
+  QJsonObject obj;
+
+  obj["id"]        = SCAST(qint64, request.inspectorId);
+  obj["class"]     = QString::fromStdString(request.inspClass);
+  obj["factory"]   = widget->factoryName();
+  obj["frequency"] =
+      request.channel.fc + this->mediator()->getCurrentCenterFreq();
+  obj["bandwidth"] = request.channel.bw;
+  obj["rate"]      = request.equivRate;
+
+  return obj;
+}
+
+QJsonObject
+RemoteControl::makeStatus(void) const
+{
+  static const char *states[] = {"halted", "halting", "running", "restarting"};
+  QJsonObject status;
+
+  status["state"] =
+      m_state >= 0 && m_state < 4 ? states[m_state] : "unknown";
+  status["frequency"] = this->mediator()->getCurrentCenterFreq();
+  status["inspectors"] = this->mediator()->inspectionWidgets().size();
+
+  if (m_profile != nullptr) {
+    status["profile"] = QString::fromStdString(m_profile->label());
+    status["rate"]    = SCAST(qint64, m_profile->getDecimatedSampleRate());
+    status["lnb"]     = m_profile->getLnbFreq();
+  }
+
+  return status;
+}
+
+QJsonObject
+RemoteControl::makeTelemetry(void)
+{
+  Suscan::AnalyzerStats stats;
+  QJsonObject telemetry = this->makeStatus();
+  QJsonObject stages;
+  QJsonArray routes;
+  qint64 now = m_clock.elapsed();
+  qreal dt;
+
+  telemetry["event"]  = "telemetry";
+  telemetry["time_s"] = now * 1e-3;
+
+  if (m_analyzer == nullptr)
+    return telemetry;
+
+  stats = m_analyzer->getStats();
+  dt = (now - m_lastStatsTime) * 1e-3;
+
+  // A stats reset (or a new analyzer) restarts the counters
+  if (stats.uptimeMs < m_lastStats.uptimeMs)
+    m_lastStats.reset();
+
+  for (int i = 0; i < Suscan::ANALYZER_STATS_CLASS_COUNT; ++i) {
+    Suscan::MessageClassStats const &curr = stats.classes[i];
+    Suscan::MessageClassStats const &prev = m_lastStats.classes[i];
+    QJsonObject stage;
+
+    stage["read"]      = SCAST(qint64, curr.read);
+    stage["delivered"] = SCAST(qint64, curr.delivered);
+    stage["dropped"]   = SCAST(qint64, curr.coalesced);
+
+    if (dt > 0 && m_lastStatsTime > 0) {
+      stage["read_rate"] = (curr.read - prev.read) / dt;
+      stage["drop_rate"] = (curr.coalesced - prev.coalesced) / dt;
+    }
+
+    stage["latency_us_p99"] =
+        SCAST(qint64, curr.queueLatency.percentile(.99));
+
+    stages[Suscan::AnalyzerStats::className(i)] = stage;
+  }
+
+  for (auto const &route : stats.routes) {
+    QJsonObject obj;
+
+    obj["inspector"] = SCAST(qint64, route.inspectorId);
+    obj["receiver"]  = route.receiver;
+    obj["count"]     = SCAST(qint64, route.dispatchTime.count);
+    obj["dispatch_us_mean"] = route.dispatchTime.mean();
+    routes.append(obj);
+  }
+
+  telemetry["uptime_ms"] = stats.uptimeMs;
+  telemetry["stages"]    = stages;
+  telemetry["routes"]    = routes;
+
+  m_lastStats     = stats;
+  m_lastStatsTime = now;
+
+  return telemetry;
+}
+
+////////////////////////////////// Commands ////////////////////////////////////
+bool
+RemoteControl::cmdTune(QJsonObject const &cmd, QJsonObject &, QString &error)
+{
+  BookmarkInfo info;
+  qint64 bw = SCAST(qint64, cmd.value("bw").toDouble());
+
+  if (!cmd.contains("freq")) {
+    error = "Missing frequency";
+    return false;
+  }
+
+  info.frequency   = SCAST(qint64, cmd.value("freq").toDouble());
+  info.lowFreqCut  = -SCAST(qint32, bw / 2);
+  info.highFreqCut = +SCAST(qint32, bw - bw / 2);
+
+  this->mediator()->onJumpToBookmark(info);
+
+  return true;
+}
+
+bool
+RemoteControl::cmdCapture(QJsonObject const &cmd, QJsonObject &, QString &)
+{
+  this->mediator()->onToggleCapture(cmd.value("state").toBool(true));
+
+  return true;
+}
+
+bool
+RemoteControl::cmdRecord(QJsonObject const &cmd, QJsonObject &, QString &error)
+{
+  if (m_analyzer == nullptr) {
+    error = "Not capturing";
+    return false;
+  }
+
+  this->mediator()->requestRecord(cmd.value("state").toBool(true));
+
+  return true;
+}
+
+bool
+RemoteControl::cmdGain(QJsonObject const &cmd, QJsonObject &, QString &error)
+{
+  std::string name = cmd.value("name").toString().toStdString();
+  SUFLOAT value = SCAST(SUFLOAT, cmd.value("value").toDouble());
+
+  if (name.empty()) {
+    error = "Missing gain name";
+    return false;
+  }
+
+  if (m_analyzer != nullptr) {
+    try {
+      m_analyzer->setGain(name, value);
+    } catch (Suscan::Exception &) {
+      error = "Source does not allow adjusting gain settings";
+      return false;
+    }
+  }
+
+  // Hot or not, it is remembered for the next capture
+  if (m_profile != nullptr)
+    m_profile->setGain(name, value);
+
+  return true;
+}
+
+bool
+RemoteControl::cmdOpen(QJsonObject const &cmd, QJsonObject &, QString &error)
+{
+  std::string factory =
+      cmd.value("factory").toString("GenericInspectorFactory").toStdString();
+  std::string inspClass = cmd.value("class").toString("psk").toStdString();
+  Suscan::ChannelPrecision precision = Suscan::CHANNEL_PRECISION_AUTO;
+  Suscan::Channel ch;
+
+  if (m_analyzer == nullptr) {
+    error = "Not capturing";
+    return false;
+  }
+
+  if (!cmd.contains("freq") || cmd.value("bw").toDouble() <= 0) {
+    error = "Missing frequency or bandwidth";
+    return false;
+  }
+
+  ch.bw    = cmd.value("bw").toDouble();
+  ch.ft    = 0;
+  ch.fc    = cmd.value("freq").toDouble()
+      - this->mediator()->getCurrentCenterFreq();
+  ch.fLow  = - .5 * ch.bw;
+  ch.fHigh = + .5 * ch.bw;
+
+  // Without an explicit choice, the tracker decides
+  if (cmd.contains("precise"))
+    precision = cmd.value("precise").toBool()
+        ? Suscan::CHANNEL_PRECISION_PRECISE
+        : Suscan::CHANNEL_PRECISION_FAST;
+
+  // The inspector shows up in the inspectors list once opened
+  if (!this->mediator()->openInspectorTab(
+        factory.c_str(),
+        inspClass.c_str(),
+        ch,
+        precision)) {
+    error = "Cannot open inspector";
+    return false;
+  }
+
+  return true;
+}
+
+bool
+RemoteControl::cmdClose(QJsonObject const &cmd, QJsonObject &reply, QString &error)
+{
+  QList<InspectionWidget *> widgets = this->mediator()->inspectionWidgets();
+  bool all = cmd.value("all").toBool();
+  uint32_t id = SCAST(uint32_t, cmd.value("id").toDouble(-1));
+  int closed = 0;
+
+  if (!all && !cmd.contains("id")) {
+    error = "Missing inspector id";
+    return false;
+  }
+
+  for (auto p : widgets) {
+    if (all || p->request().inspectorId == id) {
+      p->closeRequested();
+      ++closed;
+    }
+  }
+
+  if (closed == 0 && !all) {
+    error = "No such inspector";
+    return false;
+  }
+
+  reply["closed"] = closed;
+
+  return true;
+}
+
+bool
+RemoteControl::cmdInspectors(QJsonObject const &, QJsonObject &reply, QString &)
+{
+  QJsonArray list;
+
+  for (auto p : this->mediator()->inspectionWidgets())
+    list.append(this->inspectorToJson(p));
+
+  reply["inspectors"] = list;
+
+  return true;
+}
+
+bool
+RemoteControl::cmdSubscribe(
+    RemoteControlClient *client,
+    QJsonObject const &cmd,
+    QJsonObject &,
+    QString &)
+{
+  int ms = SCAST(
+        int,
+        1e3 * cmd.value("interval").toDouble(
+          1e-3 * SIGDIGGER_REMOTE_CONTROL_TELEMETRY_MS));
+
+  if (ms > 0 && ms < SIGDIGGER_REMOTE_CONTROL_MIN_TELEMETRY_MS)
+    ms = SIGDIGGER_REMOTE_CONTROL_MIN_TELEMETRY_MS;
+
+  client->setTelemetryInterval(ms);
+
+  this->refreshTelemetryTimer();
+
+  return true;
+}
+
+///////////////////////////// Overriden methods ////////////////////////////////
+Suscan::Serializable *
+RemoteControl::allocConfig(void)
+{
+  return m_config = new RemoteControlConfig();
+}
+
+void
+RemoteControl::applyConfig(void)
+{
+  QString endpoint = QString::fromStdString(m_config->endpoint);
+  QByteArray env = qgetenv(SIGDIGGER_REMOTE_CONTROL_ENV);
+  bool enabled = m_config->enabled;
+
+  if (!env.isEmpty()) {
+    endpoint = QString::fromUtf8(env);
+    enabled = true;
+  }
+
+  if (enabled && endpoint == m_endpoint)
+    return;
+
+  this->stopListening();
+
+  if (enabled)
+    this->listen(endpoint);
+}
+
+void
+RemoteControl::setState(int state, Suscan::Analyzer *analyzer)
+{
+  m_state = state;
+
+  if (m_analyzer != analyzer) {
+    m_analyzer = analyzer;
+    m_lastStats.reset();
+    m_lastStatsTime = 0;
+  }
+}
+
+void
+RemoteControl::setProfile(Suscan::Source::Config &profile)
+{
+  m_profile = &profile;
+}
+
+/////////////////////////////////// Slots //////////////////////////////////////
+void
+RemoteControl::onNewTcpConnection(void)
+{
+  QTcpSocket *socket;
+
+  while ((socket = m_tcpServer->nextPendingConnection()) != nullptr)
+    this->addClient(socket);
+}
+
+void
+RemoteControl::onNewLocalConnection(void)
+{
+  QLocalSocket *socket;
+
+  while ((socket = m_localServer->nextPendingConnection()) != nullptr)
+    this->addClient(socket);
+}
+
+void
+RemoteControl::onCommand(RemoteControlClient *client, QJsonObject cmd)
+{
+  QString name = cmd.value("cmd").toString();
+  QJsonObject reply;
+  QString error;
+  bool ok;
+
+  if (cmd.contains("id"))
+    reply["id"] = cmd.value("id");
+
+  if (name == "ping") {
+    ok = true;
+  } else if (name == "status") {
+    reply["status"] = this->makeStatus();
+    ok = true;
+  } else if (name == "tune") {
+    ok = this->cmdTune(cmd, reply, error);
+  } else if (name == "capture") {
+    ok = this->cmdCapture(cmd, reply, error);
+  } else if (name == "record") {
+    ok = this->cmdRecord(cmd, reply, error);
+  } else if (name == "gain") {
+    ok = this->cmdGain(cmd, reply, error);
+  } else if (name == "open") {
+    ok = this->cmdOpen(cmd, reply, error);
+  } else if (name == "close") {
+    ok = this->cmdClose(cmd, reply, error);
+  } else if (name == "inspectors") {
+    ok = this->cmdInspectors(cmd, reply, error);
+  } else if (name == "subscribe") {
+    ok = this->cmdSubscribe(client, cmd, reply, error);
+  } else if (name == "telemetry") {
+    reply["telemetry"] = this->makeTelemetry();
+    ok = true;
+  } else {
+    error = "Unknown command `" + name + "'";
+    ok = false;
+  }
+
+  reply["ok"] = ok;
+  if (!ok)
+    reply["error"] = error;
+
+  client->send(reply);
+}
+
+void
+RemoteControl::onClientClosed(RemoteControlClient *client)
+{
+  m_clients.removeAll(client);
+  client->deleteLater();
+
+  this->refreshTelemetryTimer();
+}
+
+void
+RemoteControl::onTelemetryTimeout(void)
+{
+  qint64 now = m_clock.elapsed();
+  QJsonObject telemetry;
+  bool built = false;
+
+  for (auto p : m_clients) {
+    // Some slack, so that subscribers at the timer rate are not skipped
+    if (p->wantsTelemetry(now + m_telemetryTimer.interval() / 2)) {
+      if (!built) {
+        telemetry = this->makeTelemetry();
+        built = true;
+      }
+
+      p->send(telemetry);
+      p->noteTelemetry(now);
+    }
+  }
+}
@@ -0,0 +1,168 @@
+//
+//    RemoteControl.h: Remote control and telemetry endpoint
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef REMOTECONTROL_H
+#define REMOTECONTROL_H
+
+#include <UIListenerFactory.h>
+#include <Suscan/Library.h>
+#include <QTcpServer>
+#include <QLocalServer>
+#include <QIODevice>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QTimer>
+
+//
+// Clients send one JSON object per line and get one JSON object per line
+// back, in the same order:
+//
+//   -> {"id": 1, "cmd": "tune", "freq": 145800000}
+//   <- {"id": 1, "ok": true}
+//
+// Failed commands answer {"id": ..., "ok": false, "error": "..."}. Once
+// subscribed, telemetry objects ({"event": "telemetry", ...}) are pushed
+// in between replies.
+//
+#define SIGDIGGER_REMOTE_CONTROL_DEFAULT_ENDPOINT "tcp:127.0.0.1:2727"
+#define SIGDIGGER_REMOTE_CONTROL_MAX_LINE_SIZE    4096
+#define SIGDIGGER_REMOTE_CONTROL_TELEMETRY_MS     1000
+#define SIGDIGGER_REMOTE_CONTROL_MIN_TELEMETRY_MS 100
+
+// Overrides the configured endpoint (and enables the server),
+// e.g. SIGDIGGER_REMOTE_CONTROL=unix:/run/sigdigger/ctl
+#define SIGDIGGER_REMOTE_CONTROL_ENV              "SIGDIGGER_REMOTE_CONTROL"
+
+namespace SigDigger {
+  class RemoteControlFactory;
+  class InspectionWidget;
+
+  struct RemoteControlConfig : public Suscan::Serializable {
+    bool enabled = false;
+    std::string endpoint = SIGDIGGER_REMOTE_CONTROL_DEFAULT_ENDPOINT;
+
+    // Overriden methods
+    void deserialize(Suscan::Object const &conf) override;
+    Suscan::Object &&serialize() override;
+  };
+
+  //
+  // One connected peer, either a TCP or a local socket
+  //
+  class RemoteControlClient : public QObject
+  {
+    Q_OBJECT
+
+    QIODevice *m_socket;
+    QByteArray m_pending;
+    int m_telemetryMs = 0; // 0: not subscribed
+    qint64 m_lastTelemetry = 0;
+
+  public:
+    RemoteControlClient(QIODevice *socket, QObject *parent = nullptr);
+    ~RemoteControlClient() override;
+
+    void send(QJsonObject const &);
+    bool wantsTelemetry(qint64 now) const;
+    void noteTelemetry(qint64 now);
+    void setTelemetryInterval(int ms);
+
+    int
+    telemetryInterval(void) const
+    {
+      return m_telemetryMs;
+    }
+
+  signals:
+    void command(SigDigger::RemoteControlClient *, QJsonObject);
+    void closed(SigDigger::RemoteControlClient *);
+
+  public slots:
+    void onReadyRead(void);
+    void onDisconnected(void);
+  };
+
+  //
+  // Headless UI listener exposing the mediator's actions (tuning,
+  // capture, recording, gains and inspectors) to remote orchestrators,
+  // along with the throughput and drop counters of the analyzer.
+  //
+  class RemoteControl : public UIListener
+  {
+    Q_OBJECT
+
+    RemoteControlConfig *m_config = nullptr;
+    Suscan::Analyzer *m_analyzer = nullptr;
+    Suscan::Source::Config *m_profile = nullptr;
+    int m_state = 0;
+
+    QTcpServer *m_tcpServer = nullptr;
+    QLocalServer *m_localServer = nullptr;
+    QString m_endpoint;
+    QList<RemoteControlClient *> m_clients;
+
+    // Telemetry rates are computed against the previous snapshot
+    QTimer m_telemetryTimer;
+    QElapsedTimer m_clock;
+    Suscan::AnalyzerStats m_lastStats;
+    qint64 m_lastStatsTime = 0;
+
+    bool listen(QString const &endpoint);
+    void stopListening(void);
+    void addClient(QIODevice *);
+    void refreshTelemetryTimer(void);
+    QJsonObject makeTelemetry(void);
+    QJsonObject makeStatus(void) const;
+    QJsonObject inspectorToJson(InspectionWidget *) const;
+
+    // Command handlers. On failure, they fill the error string.
+    bool cmdTune(QJsonObject const &, QJsonObject &, QString &);
+    bool cmdCapture(QJsonObject const &, QJsonObject &, QString &);
+    bool cmdRecord(QJsonObject const &, QJsonObject &, QString &);
+    bool cmdGain(QJsonObject const &, QJsonObject &, QString &);
+    bool cmdOpen(QJsonObject const &, QJsonObject &, QString &);
+    bool cmdClose(QJsonObject const &, QJsonObject &, QString &);
+    bool cmdInspectors(QJsonObject const &, QJsonObject &, QString &);
+    bool cmdSubscribe(
+        RemoteControlClient *,
+        QJsonObject const &,
+        QJsonObject &,
+        QString &);
+
+  public:
+    RemoteControl(RemoteControlFactory *, UIMediator *, QObject *parent = nullptr);
+    ~RemoteControl() override;
+
+    // Configuration methods
+    Suscan::Serializable *allocConfig(void) override;
+    void applyConfig(void) override;
+
+    // Overriden methods
+    void setState(int, Suscan::Analyzer *) override;
+    void setProfile(Suscan::Source::Config &) override;
+
+  public slots:
+    void onNewTcpConnection(void);
+    void onNewLocalConnection(void);
+    void onCommand(SigDigger::RemoteControlClient *, QJsonObject);
+    void onClientClosed(SigDigger::RemoteControlClient *);
+    void onTelemetryTimeout(void);
+  };
+}
+
+#endif // REMOTECONTROL_H
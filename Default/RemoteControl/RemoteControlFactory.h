@@ -0,0 +1,39 @@
+//
+//    RemoteControlFactory.h: Factory for the remote control endpoint
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef REMOTECONTROLFACTORY_H
+#define REMOTECONTROLFACTORY_H
+
+#include <UIListenerFactory.h>
+
+namespace SigDigger {
+  class RemoteControlFactory : public UIListenerFactory
+  {
+  public:
+    // FeatureFactory overrides
+    const char *name(void) const override;
+
+    // UIListenerFactory overrides
+    UIListener *make(UIMediator *) override;
+    std::string getTitle() const override;
+
+    RemoteControlFactory(Suscan::Plugin *);
+  };
+}
+
+#endif // REMOTECONTROLFACTORY_H
@@ -22,8 +22,13 @@
 #include "SuWidgetsHelpers.h"
 #include "SigDiggerHelpers.h"
 #include "ui_SourceWidget.h"
+#include "RenderScheduler.h"
+#include "LoadGovernor.h"
+#include "MemoryAccountant.h"
 #include <QMessageBox>
 #include <FileDataSaver.h>
+#include <SegmentedDataSaver.h>
+#include <QuantizedDataSaver.h>
 #include <fcntl.h>
 
 using namespace SigDigger;
@@ -64,6 +69,7 @@ SourceWidgetConfig::deserialize(Suscan::Object const &conf)
 
   LOAD(collapsed);
   LOAD(throttle);
+  LOAD(batchReplay);
   LOAD(throttleRate);
   LOAD(dcRemove);
   LOAD(iqRev);
@@ -108,6 +114,7 @@ SourceWidgetConfig::serialize(void)
 
   STORE(collapsed);
   STORE(throttle);
+  STORE(batchReplay);
   STORE(throttleRate);
   STORE(dcRemove);
   STORE(iqRev);
@@ -145,6 +152,7 @@ SourceWidget::SourceWidget(
   ui->setupUi(this);
 
   this->saverUI = new DataSaverUI(this);
+  this->saverUI->setCaptureControlsVisible(true);
   this->ui->dataSaverGrid->addWidget(this->saverUI);
   this->ui->throttleSpin->setUnits("sps");
   this->ui->throttleSpin->setMinimum(0);
@@ -176,12 +184,24 @@ SourceWidget::connectAll(void)
         this,
         SLOT(onThrottleChanged(void)));
 
+  connect(
+        this->ui->batchReplayCheck,
+        SIGNAL(stateChanged(int)),
+        this,
+        SLOT(onThrottleChanged(void)));
+
   connect(
         this->saverUI,
         SIGNAL(recordStateChanged(bool)),
         this,
         SLOT(onRecordStartStop()));
 
+  connect(
+        this->mediator(),
+        SIGNAL(recordRequested(bool)),
+        this,
+        SLOT(onRecordRequested(bool)));
+
   connect(
         this->ui->autoGainCombo,
         SIGNAL(activated(int)),
@@ -335,7 +355,9 @@ SourceWidget::tryApplyGains(
 }
 
 void
-SourceWidget::applySourceInfo(Suscan::AnalyzerSourceInfo const &info)
+SourceWidget::applySourceInfo(
+    Suscan::AnalyzerSourceInfo const &info,
+    unsigned int changes)
 {
   std::vector<Suscan::Source::GainDescription> gains;
   DeviceGain *gain = nullptr;
@@ -352,11 +374,17 @@ SourceWidget::applySourceInfo(Suscan::AnalyzerSourceInfo const &info)
   // 5. AGC
   //
   // These settings are set once the first source info is received, and
-  // refresh the UI in subsequent receptions.
+  // refresh the UI in subsequent receptions. Only what changed since the
+  // previous one is touched.
 
-  this->setSampleRate(SCAST(unsigned, info.getSampleRate()));
+  if (!this->haveSourceInfo)
+    changes = Suscan::SOURCE_INFO_ALL;
 
-  if (info.getMeasuredSampleRate() > 0)
+  if (changes & Suscan::SOURCE_INFO_SAMPLE_RATE)
+    this->setSampleRate(SCAST(unsigned, info.getSampleRate()));
+
+  if ((changes & Suscan::SOURCE_INFO_MEASURED_RATE)
+      && info.getMeasuredSampleRate() > 0)
     this->setProcessRate(SCAST(unsigned, info.getMeasuredSampleRate()));
 
   if (!this->haveSourceInfo) {
@@ -368,30 +396,42 @@ SourceWidget::applySourceInfo(Suscan::AnalyzerSourceInfo const &info)
 
     this->setDelayedAnalyzerOptions();
   } else {
-    bool throttleEnabled = !sufeq(
-          info.getEffectiveSampleRate(),
-          info.getSampleRate(),
-          0); // Integer quantities
+    if (changes & Suscan::SOURCE_INFO_PERMISSIONS)
+      m_sourceInfo = info;
+
+    if (changes & Suscan::SOURCE_INFO_SAMPLE_RATE) {
+      bool throttleEnabled = !sufeq(
+            info.getEffectiveSampleRate(),
+            info.getSampleRate(),
+            0); // Integer quantities
 
-    this->ui->throttleCheck->setChecked(throttleEnabled);
+      this->ui->throttleCheck->setChecked(throttleEnabled);
+    }
 
-    this->setDCRemove(info.getDCRemove());
-    this->setIQReverse(info.getIQReverse());
-    this->setAGCEnabled(info.getAGC());
+    if (changes & Suscan::SOURCE_INFO_DC_REMOVE)
+      this->setDCRemove(info.getDCRemove());
+    if (changes & Suscan::SOURCE_INFO_IQ_REVERSE)
+      this->setIQReverse(info.getIQReverse());
+    if (changes & Suscan::SOURCE_INFO_AGC)
+      this->setAGCEnabled(info.getAGC());
   }
 
+  if (changes & Suscan::SOURCE_INFO_BANDWIDTH)
+    this->setBandwidth(info.getBandwidth());
 
-  this->setBandwidth(info.getBandwidth());
-  this->setPPM(info.getPPM());
+  if (changes & Suscan::SOURCE_INFO_PPM)
+    this->setPPM(info.getPPM());
 
-  // Populate antennas
-  this->populateAntennaCombo(info);
+  if (changes & Suscan::SOURCE_INFO_ANTENNA) {
+    // Populate antennas
+    this->populateAntennaCombo(info);
 
-  // What if SoapySDR lies? We consider the case in which the antenna is
-  // not reported in the antenna list
-  this->selectAntenna(info.getAntenna());
+    // What if SoapySDR lies? We consider the case in which the antenna is
+    // not reported in the antenna list
+    this->selectAntenna(info.getAntenna());
+  }
 
-  if (!this->tryApplyGains(info)) {
+  if ((changes & Suscan::SOURCE_INFO_GAINS) && !this->tryApplyGains(info)) {
     // Recreate gains
     this->clearGains();
 
@@ -503,6 +543,10 @@ SourceWidget::refreshUi()
           this->profile->getType() != SUSCAN_SOURCE_TYPE_SDR
           || isRemote);
 
+    // Replaying faster than real time only makes sense for local files
+    this->batchReplayable =
+        this->profile->getType() == SUSCAN_SOURCE_TYPE_FILE && !isRemote;
+
     this->ui->antennaCombo->setEnabled(
           this->profile->getType() == SUSCAN_SOURCE_TYPE_SDR);
 
@@ -536,7 +580,10 @@ SourceWidget::refreshUi()
         && m_sourceInfo.testPermission(SUSCAN_ANALYZER_PERM_THROTTLE));
   this->ui->throttleSpin->setEnabled(
         this->ui->throttleCheck->isChecked()
-        && this->ui->throttleCheck->isEnabled());
+        && this->ui->throttleCheck->isEnabled()
+        && !this->isBatchReplay());
+  this->ui->batchReplayCheck->setEnabled(
+        this->batchReplayable && this->throttleable);
   this->ui->antennaCombo->setEnabled(
         this->ui->antennaCombo->isEnabled()
         && m_sourceInfo.testPermission(SUSCAN_ANALYZER_PERM_SET_ANTENNA));
@@ -635,6 +682,14 @@ SourceWidget::setThrottleable(bool val)
   this->ui->bwSpin->setEnabled(!val);
 }
 
+bool
+SourceWidget::isBatchReplay(void) const
+{
+  return this->batchReplayable
+      && this->throttleable
+      && this->panelConfig->batchReplay;
+}
+
 unsigned int
 SourceWidget::getEffectiveRate(void) const
 {
@@ -818,6 +873,10 @@ SourceWidget::applyConfig()
   this->ui->throttleCheck->setChecked(this->panelConfig->throttle);
   this->ui->throttleCheck->blockSignals(blocked);
 
+  blocked = this->ui->batchReplayCheck->blockSignals(true);
+  this->ui->batchReplayCheck->setChecked(this->panelConfig->batchReplay);
+  this->ui->batchReplayCheck->blockSignals(blocked);
+
   this->onThrottleChanged();
 
   this->ui->dcRemoveCheck->setChecked(this->panelConfig->dcRemove);
@@ -855,6 +914,7 @@ SourceWidget::setBlockingSignals(bool blocking)
 
   oldState = SETBLOCKING(agcEnabledCheck);
   SETBLOCKING(throttleCheck);
+  SETBLOCKING(batchReplayCheck);
   SETBLOCKING(bwSpin);
   SETBLOCKING(ppmSpinBox);
   SETBLOCKING(gainPresetCheck);
@@ -899,8 +959,7 @@ SourceWidget::setState(int state, Suscan::Analyzer *analyzer)
 {
   if (m_analyzer != analyzer) {
     // Uninstall any datasaver
-    this->uninstallDataSaver();
-    m_filterInstalled = false; // The filter is not installed anymore.
+    this->uninstallTrigger();
 
     m_analyzer = analyzer;
 
@@ -910,17 +969,13 @@ SourceWidget::setState(int state, Suscan::Analyzer *analyzer)
       m_sourceInfo = Suscan::AnalyzerSourceInfo();
       this->setProcessRate(0);
       this->refreshUi();
+      RenderScheduler::instance()->setBatchMode(false);
     } else {
       // Switched to running! Then, do the following:
-      // 1. Connect source_info_message
-      // 2. If recording is enabled, go ahead.
-      // 3. Upon the reception of the first source info message: apply delayed
+      // 1. If recording is enabled, go ahead.
+      // 2. Upon the reception of the first source info (setSourceInfo),
+      //    apply delayed
 
-      connect(
-            analyzer,
-            SIGNAL(source_info_message(const Suscan::SourceInfoMessage &)),
-            this,
-            SLOT(onSourceInfoMessage(const Suscan::SourceInfoMessage &)));
       connect(
             analyzer,
             SIGNAL(psd_message(const Suscan::PSDMessage &)),
@@ -988,18 +1043,14 @@ SourceWidget::setProfile(Suscan::Source::Config &profile)
 }
 
 //////////////////////////////// Data saving ///////////////////////////////////
-int
-SourceWidget::openCaptureFile(void)
+std::string
+SourceWidget::makeCaptureBaseName(std::string const &format) const
 {
-  int fd = -1;
   char baseName[80];
   char datetime[17];
   time_t unixtime;
   struct tm tm;
 
-  if (this->profile == nullptr)
-    return -1;
-
   unixtime = time(nullptr);
   gmtime_r(&unixtime, &tm);
   strftime(datetime, sizeof(datetime), "%Y%m%d_%H%M%SZ", &tm);
@@ -1007,13 +1058,24 @@ SourceWidget::openCaptureFile(void)
   snprintf(
         baseName,
         sizeof(baseName),
-        "sigdigger_%s_%d_%.0lf_float32_iq.raw",
+        "sigdigger_%s_%d_%.0lf_%s_iq",
         datetime,
         this->profile->getDecimatedSampleRate(),
-        this->profile->getFreq());
+        this->profile->getFreq(),
+        format.c_str());
 
-  std::string fullPath =
-      this->saverUI->getRecordSavePath() + "/" + baseName;
+  return this->saverUI->getRecordSavePath() + "/" + baseName;
+}
+
+int
+SourceWidget::openCaptureFile(void)
+{
+  int fd = -1;
+
+  if (this->profile == nullptr)
+    return -1;
+
+  std::string fullPath = this->makeCaptureBaseName("float32") + ".raw";
 
   if ((fd = creat(fullPath.c_str(), 0600)) == -1) {
     QMessageBox::warning(
@@ -1027,13 +1089,64 @@ SourceWidget::openCaptureFile(void)
   return fd;
 }
 
+bool
+SourceWidget::openSegmentedCapture(void)
+{
+  SegmentedDataSaver *saver;
+  unsigned int rate;
+
+  if (this->profile == nullptr || m_analyzer == nullptr || m_dataSaver != nullptr)
+    return false;
+
+  rate = static_cast<unsigned>(this->profile->getDecimatedSampleRate());
+
+  saver = new SegmentedDataSaver(
+        this->makeCaptureBaseName("float32"),
+        rate,
+        this->profile->getFreq(),
+        static_cast<quint64>(this->saverUI->getSegmentDuration())
+        * rate * sizeof(SUCOMPLEX),
+        this->saverUI->getSegmentRetention(),
+        this);
+
+  if (!saver->isOpen()) {
+    QMessageBox::warning(
+              this,
+              "SigDigger error",
+              "Failed to open capture file for writing: " +
+              QString::fromStdString(saver->getError()),
+              QMessageBox::Ok);
+    delete saver;
+    return false;
+  }
+
+  m_segmentedSaver = saver;
+  m_captureFreq = this->profile->getFreq();
+  this->installDataSaver(saver);
+
+  return true;
+}
+
 void
 SourceWidget::uninstallDataSaver()
 {
+  // Whatever the tap still holds reaches the saver before it is gone
+  if (m_saverTap != nullptr) {
+    if (m_analyzer != nullptr)
+      m_analyzer->getBaseBandTap()->detach(m_saverTap);
+    delete m_saverTap;
+    m_saverTap = nullptr;
+  }
+
+  // Armed trigger: back to filling the pre-trigger ring
+  if (m_preTrigger != nullptr)
+    m_preTrigger->setSaver(nullptr);
+
   if (m_dataSaver != nullptr)
     delete m_dataSaver;
 
   m_dataSaver = nullptr;
+  m_segmentedSaver = nullptr;
 }
 
 void
@@ -1064,21 +1177,80 @@ SourceWidget::connectDataSaver()
         SLOT(onCommit()));
 }
 
-// I wish this could be static
-SUBOOL
-SigDigger::onBaseBandData(
-    void *privdata,
-    suscan_analyzer_t *,
-    const SUCOMPLEX *samples,
-    SUSCOUNT length)
+DataSaverTap::DataSaverTap(GenericDataSaver *saver) : m_saver(saver)
+{
+}
+
+void
+DataSaverTap::baseband(const SUCOMPLEX *samples, SUSCOUNT length)
+{
+  m_saver->write(samples, length);
+}
+
+bool
+SourceWidget::openQuantizedCapture(std::string const &format)
+{
+  QuantizedIQFormat sampleFormat = QUANTIZED_IQ_INT16;
+  QuantizedIQCompression compression = QUANTIZED_IQ_UNCOMPRESSED;
+  std::string typeName = format;
+  size_t p = format.find('_');
+  unsigned int rate;
+  int fd;
+
+  if (this->profile == nullptr || m_analyzer == nullptr || m_dataSaver != nullptr)
+    return false;
+
+  if (p != std::string::npos) {
+    typeName = format.substr(0, p);
+    if (format.substr(p + 1) == "zstd")
+      compression = QUANTIZED_IQ_ZSTD;
+  }
+
+  if (typeName == "int8")
+    sampleFormat = QUANTIZED_IQ_INT8;
+
+  std::string fullPath =
+      this->makeCaptureBaseName(typeName) + SIGDIGGER_QUANTIZED_IQ_EXTENSION;
+
+  if ((fd = creat(fullPath.c_str(), 0600)) == -1) {
+    QMessageBox::warning(
+              this,
+              "SigDigger error",
+              "Failed to open capture file for writing: " +
+              QString(strerror(errno)),
+              QMessageBox::Ok);
+    return false;
+  }
+
+  rate = static_cast<unsigned>(this->profile->getDecimatedSampleRate());
+
+  this->installDataSaver(
+        new QuantizedDataSaver(
+          fd,
+          rate,
+          this->profile->getFreq(),
+          sampleFormat,
+          compression,
+          this));
+
+  return true;
+}
+
+void
+SourceWidget::installDataSaver(GenericDataSaver *saver)
 {
-  SourceWidget *widget = static_cast<SourceWidget *>(privdata);
-  FileDataSaver *saver;
+  m_dataSaver = saver;
 
-  if ((saver = widget->m_dataSaver) != nullptr)
-    saver->write(samples, length);
+  this->connectDataSaver();
 
-  return SU_TRUE;
+  // Triggered capture: the pre-trigger ring goes first
+  if (m_preTrigger != nullptr) {
+    m_preTrigger->setSaver(saver);
+    return;
+  }
+
+  m_saverTap = new DataSaverTap(saver);
+  m_analyzer->getBaseBandTap()->attach(m_saverTap);
 }
 
 void
@@ -1086,32 +1258,124 @@ SourceWidget::installDataSaver(int fd)
 {
   if (m_dataSaver == nullptr) {
     if (this->profile != nullptr && m_analyzer != nullptr) {
-      m_dataSaver = new FileDataSaver(fd, this);
-      m_dataSaver->setSampleRate(this->profile->getDecimatedSampleRate());
+      FileDataSaver *saver = new FileDataSaver(fd, this);
+      saver->setSampleRate(this->profile->getDecimatedSampleRate());
+      this->installDataSaver(saver);
+    }
+  }
+}
 
-      if (!m_filterInstalled) {
-        m_analyzer->registerBaseBandFilter(onBaseBandData, this);
-        m_filterInstalled = true;
-      }
+bool
+SourceWidget::installTrigger()
+{
+  RecordingTriggerParams params;
+  qreal rate;
 
-      this->connectDataSaver();
-    }
+  if (this->profile == nullptr || m_analyzer == nullptr || m_preTrigger != nullptr)
+    return false;
+
+  params = this->saverUI->getTriggerParams();
+  rate   = this->profile->getDecimatedSampleRate();
+
+  m_trigger.setParams(params);
+  m_trigger.reset();
+  m_triggerEvents = 0;
+
+  m_preTrigger = new PreTriggerBuffer(
+        static_cast<size_t>(
+          (params.preTrigger + SIGDIGGER_RECORDING_TRIGGER_LATENCY_S) * rate));
+  m_analyzer->getBaseBandTap()->attach(m_preTrigger);
+
+  this->saverUI->setTriggerStatus("Armed");
+
+  return true;
+}
+
+void
+SourceWidget::uninstallTrigger()
+{
+  this->uninstallDataSaver();
+
+  if (m_preTrigger != nullptr) {
+    if (m_analyzer != nullptr)
+      m_analyzer->getBaseBandTap()->detach(m_preTrigger);
+    delete m_preTrigger;
+    m_preTrigger = nullptr;
   }
+
+  m_trigger.reset();
 }
 
+bool
+SourceWidget::openTriggeredCapture()
+{
+  std::string format = this->saverUI->getCaptureFormat();
+
+  if (format != "float32")
+    return this->openQuantizedCapture(format);
+
+  int fd = this->openCaptureFile();
+  if (fd != -1)
+    this->installDataSaver(fd);
+
+  return m_dataSaver != nullptr;
+}
 
-////////////////////////////////////// Slots ///////////////////////////////////
 void
-SourceWidget::onSourceInfoMessage(Suscan::SourceInfoMessage const &msg)
+SourceWidget::processTrigger(Suscan::PSDMessage const &msg)
+{
+  // Level and hang time may be adjusted while armed
+  m_trigger.setParams(this->saverUI->getTriggerParams());
+
+  switch (m_trigger.process(msg)) {
+    case RecordingTrigger::START:
+      if (!this->openTriggeredCapture()) {
+        // Already warned. Better stop than fail once per event.
+        this->uninstallTrigger();
+        this->setRecordState(false);
+        return;
+      }
+      ++m_triggerEvents;
+      break;
+
+    case RecordingTrigger::STOP:
+      this->uninstallDataSaver();
+      this->setIORate(0);
+      break;
+
+    case RecordingTrigger::NONE:
+      break;
+  }
+
+  if (m_dataSaver == nullptr)
+    this->saverUI->setTriggerStatus(
+          QString("Armed (%1 dB), %2 captures")
+          .arg(static_cast<double>(m_trigger.getLastLevel()), 0, 'f', 1)
+          .arg(m_triggerEvents));
+}
+
+void
+SourceWidget::setSourceInfo(
+    Suscan::AnalyzerSourceInfo const &info,
+    unsigned int changes)
 {
-  this->applySourceInfo(*msg.info());
+  this->applySourceInfo(info, changes);
 }
 
+////////////////////////////////////// Slots ///////////////////////////////////
 void
 SourceWidget::onPSDMessage(Suscan::PSDMessage const &msg)
 {
   this->setSampleRate(msg.getSampleRate());
   this->setProcessRate(msg.getMeasuredSampleRate());
+
+  if (m_segmentedSaver != nullptr && msg.getFrequency() != m_captureFreq) {
+    m_captureFreq = msg.getFrequency();
+    m_segmentedSaver->noteFrequency(m_captureFreq);
+  }
+
+  if (m_preTrigger != nullptr)
+    this->processTrigger(msg);
 }
 
 void
@@ -1119,6 +1383,9 @@ SourceWidget::onGainChanged(QString name, float val)
 {
   this->setAGCEnabled(false);
 
+  if (m_segmentedSaver != nullptr)
+    m_segmentedSaver->noteGain(name.toStdString(), val);
+
   if (this->profile != nullptr)
     this->profile->setGain(name.toStdString(), val);
 
@@ -1143,33 +1410,80 @@ SourceWidget::onRecordStartStop(void)
         && this->saverUI->getRecordState();
 
     if (recordState) {
-      int fd = this->openCaptureFile();
-      if (fd != -1)
-        this->installDataSaver(fd);
-      this->setRecordState(fd != -1);
+      std::string format = this->saverUI->getCaptureFormat();
+      size_t ring = GenericDataSaver::ringBytes(
+            this->profile != nullptr
+            ? this->profile->getDecimatedSampleRate()
+            : 0);
+
+      if (!MemoryAccountant::instance()->admit(ring)) {
+        QMessageBox::warning(
+              this,
+              "SigDigger error",
+              "Not enough memory left in the memory budget for the capture "
+              "buffers. Free some memory or raise the budget in the "
+              "settings.",
+              QMessageBox::Ok);
+        this->setRecordState(false);
+      } else if (this->saverUI->getTriggerEnabled()) {
+        this->setRecordState(this->installTrigger());
+      } else if (format != "float32") {
+        this->setRecordState(this->openQuantizedCapture(format));
+      } else if (this->saverUI->getSegmentDuration() > 0) {
+        this->setRecordState(this->openSegmentedCapture());
+      } else {
+        int fd = this->openCaptureFile();
+        if (fd != -1)
+          this->installDataSaver(fd);
+        this->setRecordState(fd != -1);
+      }
     } else {
-      this->uninstallDataSaver();
+      this->uninstallTrigger();
       this->setCaptureSize(0);
       this->setRecordState(false);
     }
   }
 }
 
+void
+SourceWidget::onRecordRequested(bool state)
+{
+  // As if the record button had been toggled
+  if (this->saverUI->getRecordState() != state) {
+    this->saverUI->setRecordState(state);
+    this->onRecordStartStop();
+  }
+}
+
 void
 SourceWidget::onThrottleChanged(void)
 {
   bool throttling = this->ui->throttleCheck->isChecked();
+  bool batch;
+  unsigned int throttle = 0;
 
   this->panelConfig->throttle = throttling;
   this->panelConfig->throttleRate = static_cast<unsigned>(
         this->ui->throttleSpin->value());
+  this->panelConfig->batchReplay = this->ui->batchReplayCheck->isChecked();
+
+  batch = this->isBatchReplay();
 
   this->ui->throttleSpin->setEnabled(
-        throttling && this->ui->throttleCheck->isChecked());
+        throttling && this->ui->throttleCheck->isEnabled() && !batch);
+
+  // In batch replay, the analyzer goes as fast as it can and the visual
+  // consumers are decimated. Recorders and forwarders get every sample.
+  if (batch)
+    throttle = SIGDIGGER_SOURCE_WIDGET_BATCH_THROTTLE;
+  else if (throttling)
+    throttle = this->panelConfig->throttleRate;
+
+  RenderScheduler::instance()->setBatchMode(batch && m_analyzer != nullptr);
 
   if (m_analyzer != nullptr) {
     try {
-      m_analyzer->setThrottle(throttling ? this->panelConfig->throttleRate : 0);
+      m_analyzer->setThrottle(throttle);
     } catch (Suscan::Exception &) {
       (void)  QMessageBox::critical(
             this,
@@ -1332,7 +1646,7 @@ void
 SourceWidget::onSaveError(void)
 {
   if (m_dataSaver != nullptr) {
-    this->uninstallDataSaver();
+    this->uninstallTrigger();
 
     QMessageBox::warning(
               this,
@@ -1347,8 +1661,10 @@ SourceWidget::onSaveError(void)
 void
 SourceWidget::onSaveSwamped(void)
 {
+  LoadGovernor::notifySwamp();
+
   if (m_dataSaver != nullptr) {
-    this->uninstallDataSaver();
+    this->uninstallTrigger();
 
     QMessageBox::warning(
           this,
@@ -1370,6 +1686,10 @@ SourceWidget::onSaveRate(qreal rate)
 void
 SourceWidget::onCommit(void)
 {
-  if (m_dataSaver != nullptr)
+  if (m_dataSaver != nullptr) {
     this->setCaptureSize(m_dataSaver->getSize());
+    this->saverUI->setBufferUsage(
+          m_dataSaver->getBufferUsage(),
+          m_dataSaver->getBufferHighWater());
+  }
 }
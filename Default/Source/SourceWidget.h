@@ -23,6 +23,11 @@
 #include "DataSaverUI.h"
 #include "DeviceGain.h"
 #include "AutoGain.h"
+#include <BaseBandTap.h>
+#include <RecordingTrigger.h>
+
+// Throttle requested in batch replay: way above any disk or CPU speed
+#define SIGDIGGER_SOURCE_WIDGET_BATCH_THROTTLE 1000000000
 
 namespace Ui {
   class SourcePanel;
@@ -30,13 +35,17 @@ namespace Ui {
 
 namespace SigDigger {
   class SourceWidgetFactory;
-  class FileDataSaver;
+  class GenericDataSaver;
+  class SegmentedDataSaver;
+
+  // Feeds the baseband to the active data saver, from the tap's thread
+  class DataSaverTap : public BaseBandConsumer {
+    GenericDataSaver *m_saver;
 
-  SUBOOL onBaseBandData(
-      void *privdata,
-      suscan_analyzer_t *,
-      const SUCOMPLEX *samples,
-      SUSCOUNT length);
+  public:
+    DataSaverTap(GenericDataSaver *saver);
+    void baseband(const SUCOMPLEX *samples, SUSCOUNT length) override;
+  };
 
   struct GainPresetSetting : public Suscan::Serializable {
     std::string driver;
@@ -53,6 +62,7 @@ namespace SigDigger {
       Suscan::Serializable *dataSaverConfig = nullptr;
       bool collapsed = false;
       bool throttle = false;
+      bool batchReplay = false;
       bool dcRemove = false;
       bool iqRev = false;
       bool agcEnabled = false;
@@ -93,12 +103,20 @@ namespace SigDigger {
     bool haveSourceInfo = false;
     std::map<std::string, std::vector<AutoGain>> autoGains;
     bool throttleable = false;
+    bool batchReplayable = false;
     std::vector<AutoGain> *currAutoGainSet = nullptr;
     AutoGain *currentAutoGain = nullptr;
 
     // Data saving state
-    bool m_filterInstalled = false;
-    FileDataSaver *m_dataSaver = nullptr;
+    GenericDataSaver *m_dataSaver = nullptr;
+    DataSaverTap *m_saverTap = nullptr;
+    SegmentedDataSaver *m_segmentedSaver = nullptr;
+    SUFREQ m_captureFreq = 0;
+
+    // Triggered recording: armed while m_preTrigger exists
+    RecordingTrigger m_trigger;
+    PreTriggerBuffer *m_preTrigger = nullptr;
+    unsigned int m_triggerEvents = 0;
 
     // Private methods
     DeviceGain *lookupGain(std::string const &name);
@@ -119,10 +137,13 @@ namespace SigDigger {
     void refreshUi();
 
     void setThrottleable(bool val);
+    bool isBatchReplay(void) const;
     void setSampleRate(unsigned int rate);
     unsigned int getEffectiveRate() const;
     void setProcessRate(unsigned int rate);
-    void applySourceInfo(Suscan::AnalyzerSourceInfo const &info);
+    void applySourceInfo(
+        Suscan::AnalyzerSourceInfo const &info,
+        unsigned int changes);
     void setGain(std::string const &name, SUFLOAT val);
 
     void setCaptureSize(quint64);
@@ -138,8 +159,16 @@ namespace SigDigger {
     void setDelayedAnalyzerOptions();
 
     // Data saver
+    std::string makeCaptureBaseName(std::string const &format) const;
     int openCaptureFile();
+    bool openSegmentedCapture();
+    bool openQuantizedCapture(std::string const &format);
+    void installDataSaver(GenericDataSaver *saver);
     void installDataSaver(int fd);
+    bool installTrigger();
+    void uninstallTrigger();
+    bool openTriggeredCapture();
+    void processTrigger(Suscan::PSDMessage const &msg);
     void connectDataSaver();
     void uninstallDataSaver();
 
@@ -155,20 +184,16 @@ namespace SigDigger {
     // Overriden methods
     void setState(int, Suscan::Analyzer *) override;
     void setProfile(Suscan::Source::Config &) override;
-
-    friend SUBOOL
-    onBaseBandData(
-        void *privdata,
-        suscan_analyzer_t *,
-        const SUCOMPLEX *samples,
-        SUSCOUNT length);
+    void setSourceInfo(
+        Suscan::AnalyzerSourceInfo const &,
+        unsigned int changes) override;
 
   public slots:
-    void onSourceInfoMessage(Suscan::SourceInfoMessage const &msg);
     void onPSDMessage(Suscan::PSDMessage const &msg);
     void onGainChanged(QString name, float val);
     void onAntennaChanged(int);
     void onRecordStartStop();
+    void onRecordRequested(bool);
     void onSelectAutoGain();
     void onToggleAutoGain();
     void onChangeAutoGain();
@@ -0,0 +1,398 @@
+//
+//    ZoomSpectrum.cpp: Zoom-FFT view of a narrow channel
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "ZoomSpectrum.h"
+#include "ui_ZoomSpectrum.h"
+#include <SuWidgetsHelpers.h>
+#include <SigDiggerHelpers.h>
+#include <RenderScheduler.h>
+#include <UIMediator.h>
+#include "AppConfig.h"
+#include "Waterfall.h"
+#include <cmath>
+
+using namespace SigDigger;
+
+#define STRINGFY(x) #x
+#define STORE(field) obj.set(STRINGFY(field), this->field)
+#define LOAD(field) this->field = conf.get(STRINGFY(field), this->field)
+
+void
+ZoomSpectrumConfig::deserialize(Suscan::Object const &conf)
+{
+  LOAD(palette);
+}
+
+Suscan::Object &&
+ZoomSpectrumConfig::serialize(void)
+{
+  Suscan::Object obj(SUSCAN_OBJECT_TYPE_OBJECT);
+
+  obj.setClass("ZoomSpectrumConfig");
+
+  STORE(palette);
+
+  return this->persist(obj);
+}
+
+ZoomSpectrum::ZoomSpectrum(
+    InspectionWidgetFactory *factory,
+    Suscan::AnalyzerRequest const &request,
+    UIMediator *mediator,
+    QWidget *parent) :
+  InspectionWidget(factory, request, mediator, parent),
+  m_ui(new Ui::ZoomSpectrum)
+{
+  ColorConfig const &colors = mediator->getAppConfig()->colors;
+  SUFREQ center = request.channel.fc + mediator->getCurrentCenterFreq();
+
+  this->assertConfig();
+
+  m_ui->setupUi(this);
+
+  m_wf = new Waterfall(this);
+  m_wf->setObjectName(QStringLiteral("wfSpectrum"));
+  m_ui->gridLayout->addWidget(m_wf, 1, 0, 1, 4);
+
+  m_wf->setFreqUnits(1);
+  m_wf->setCenterFreq(static_cast<qint64>(center));
+  m_wf->setClickResolution(1);
+  m_wf->setFilterClickResolution(1);
+  m_wf->setSampleRate(static_cast<float>(request.equivRate));
+  m_wf->setDemodRanges(
+        static_cast<int>(-request.equivRate / 2),
+        1,
+        1,
+        static_cast<int>(+request.equivRate / 2),
+        true);
+  m_wf->setHiLowCutFrequencies(
+        -static_cast<qint64>(request.bandwidth / 2),
+        +static_cast<qint64>(request.bandwidth / 2));
+  m_wf->resetHorizontalZoom();
+
+  m_wf->setFftPlotColor(colors.spectrumForeground);
+  m_wf->setFftBgColor(colors.spectrumBackground);
+  m_wf->setFftAxesColor(colors.spectrumAxes);
+  m_wf->setFftTextColor(colors.spectrumText);
+  m_wf->setFilterBoxColor(colors.filterBox);
+
+  SigDiggerHelpers::instance()->populatePaletteCombo(m_ui->paletteCombo);
+  this->applyConfig();
+
+  m_spectrumSource = this->findSpectrumSource();
+
+  connect(
+        m_ui->paletteCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onPaletteChanged(int)));
+
+  connect(
+        m_ui->autoRangeButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onAutoRange(void)));
+
+  this->refreshResolution();
+}
+
+ZoomSpectrum::~ZoomSpectrum()
+{
+  delete m_ui;
+}
+
+void
+ZoomSpectrum::attachAnalyzer(Suscan::Analyzer *)
+{
+  this->refreshSpectrumDemand();
+}
+
+void
+ZoomSpectrum::detachAnalyzer()
+{
+  m_spectrumPaused = true;
+}
+
+void
+ZoomSpectrum::inspectorMessage(Suscan::InspectorMessage const &msg)
+{
+  SUFLOAT *data;
+  SUSCOUNT len, p;
+  float x;
+
+  if (msg.getKind() != SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SPECTRUM)
+    return;
+
+  data = msg.getSpectrumData();
+  len = msg.getSpectrumLength();
+  p = len / 2;
+
+  for (auto i = 0u; i < len; ++i)
+    data[i] = SU_POWER_DB(data[i]);
+
+  for (auto i = 0u; i < len / 2; ++i) {
+    x = data[i];
+    data[i] = data[p];
+    data[p] = x;
+
+    if (++p == len)
+      p = 0;
+  }
+
+  this->feedSpectrum(
+        data,
+        len,
+        msg.getSpectrumRate(),
+        msg.getSpectrumSourceId());
+}
+
+//
+// Samples are still delivered to this widget but ignored: only the
+// spectrum of the channel is shown, and only while it can be seen.
+//
+bool
+ZoomSpectrum::suspend()
+{
+  if (this->analyzer() == nullptr)
+    return false;
+
+  try {
+    this->analyzer()->setSpectrumSource(this->request().handle, 0, 0);
+  } catch (Suscan::Exception const &) {
+    return false;
+  }
+
+  m_suspended = true;
+  m_spectrumPaused = true;
+
+  return true;
+}
+
+void
+ZoomSpectrum::resume()
+{
+  m_suspended = false;
+
+  this->refreshSpectrumDemand();
+}
+
+Suscan::Serializable *
+ZoomSpectrum::allocConfig(void)
+{
+  m_zoomConfig = new ZoomSpectrumConfig();
+
+  return m_zoomConfig;
+}
+
+void
+ZoomSpectrum::applyConfig(void)
+{
+  if (!this->setPalette(m_zoomConfig->palette))
+    (void) this->setPalette("Inferno (Feely)");
+}
+
+void
+ZoomSpectrum::showEvent(QShowEvent *)
+{
+  this->refreshSpectrumDemand();
+}
+
+void
+ZoomSpectrum::hideEvent(QHideEvent *)
+{
+  this->refreshSpectrumDemand();
+}
+
+std::string
+ZoomSpectrum::getLabel() const
+{
+  return this->getTabTitle().toStdString();
+}
+
+///////////////////////////// Private methods /////////////////////////////////
+QString
+ZoomSpectrum::getTabTitle() const
+{
+  return "Zoom FFT in "
+      + SuWidgetsHelpers::formatQuantity(
+        this->request().channel.fc + this->mediator()->getCurrentCenterFreq(),
+        "Hz");
+}
+
+unsigned int
+ZoomSpectrum::findSpectrumSource() const
+{
+  auto const &sources = this->request().spectSources;
+
+  for (unsigned i = 0; i < sources.size(); ++i)
+    if (sources[i].name == SIGDIGGER_ZOOM_SPECTRUM_SOURCE)
+      return i;
+
+  // Index 0 is no spectrum at all
+  return sources.size() > 1 ? 1 : 0;
+}
+
+void
+ZoomSpectrum::feedSpectrum(
+    SUFLOAT *data,
+    SUSCOUNT len,
+    SUSCOUNT rate,
+    uint32_t id)
+{
+  if (len == 0)
+    return;
+
+  if (id != m_lastSpectrumId) {
+    m_lastSpectrumId = id;
+    m_haveLimits = false;
+  }
+
+  if (rate != m_lastRate || len != m_lastLength) {
+    int res = static_cast<int>(
+          round(static_cast<qreal>(rate) / static_cast<qreal>(len)));
+
+    if (res < 1)
+      res = 1;
+
+    m_lastRate = rate;
+    m_lastLength = len;
+
+    m_wf->setSampleRate(static_cast<float>(rate));
+    m_wf->resetHorizontalZoom();
+    m_wf->setClickResolution(res);
+    m_wf->setFilterClickResolution(res);
+    this->refreshResolution();
+  }
+
+  if (!RenderScheduler::instance()->acceptData(this))
+    return;
+
+  if (!SigDiggerHelpers::isOnScreen(this))
+    return;
+
+  m_wf->setNewFftData(data, static_cast<int>(len));
+
+  if (!m_haveLimits)
+    this->adjustLimits(data, len);
+}
+
+void
+ZoomSpectrum::adjustLimits(const SUFLOAT *data, SUSCOUNT len)
+{
+  SUFLOAT min = +INFINITY;
+  SUFLOAT max = -INFINITY;
+  SUFLOAT spacing;
+
+  for (SUSCOUNT i = 0; i < len; ++i) {
+    if (min > data[i])
+      min = data[i];
+    if (max < data[i])
+      max = data[i];
+  }
+
+  if (std::isinf(min) || std::isinf(max))
+    return;
+
+  spacing = .1f * (max - min);
+
+  m_wf->setPandapterRange(min - spacing, max + spacing);
+  m_wf->setWaterfallRange(min - spacing, max + spacing);
+
+  m_haveLimits = true;
+}
+
+void
+ZoomSpectrum::refreshResolution()
+{
+  if (m_lastLength == 0) {
+    m_ui->resolutionLabel->setText(
+          QString("Span: %1, RBW: N/A")
+          .arg(SuWidgetsHelpers::formatQuantity(
+                 this->request().equivRate,
+                 "Hz")));
+  } else {
+    m_ui->resolutionLabel->setText(
+          QString("Span: %1, RBW: %2")
+          .arg(SuWidgetsHelpers::formatQuantity(
+                 static_cast<qreal>(m_lastRate),
+                 "Hz"))
+          .arg(SuWidgetsHelpers::formatQuantity(
+                 static_cast<qreal>(m_lastRate) / m_lastLength,
+                 "Hz")));
+  }
+}
+
+//
+// As in the generic inspector, the spectrum is only computed while the
+// waterfall can be seen.
+//
+void
+ZoomSpectrum::refreshSpectrumDemand()
+{
+  bool wanted;
+
+  if (this->analyzer() == nullptr || m_spectrumSource == 0)
+    return;
+
+  wanted = !m_suspended && this->isVisible();
+
+  if (wanted != m_spectrumPaused)
+    return;
+
+  try {
+    this->analyzer()->setSpectrumSource(
+          this->request().handle,
+          wanted ? m_spectrumSource : 0,
+          0);
+    m_spectrumPaused = !wanted;
+  } catch (Suscan::Exception const &) {
+  }
+}
+
+bool
+ZoomSpectrum::setPalette(std::string const &name)
+{
+  int index = SigDiggerHelpers::instance()->getPaletteIndex(name);
+
+  if (index < 0)
+    return false;
+
+  m_wf->setPalette(
+        SigDiggerHelpers::instance()->getPalette(index)->getGradient());
+  m_ui->paletteCombo->setCurrentIndex(index);
+
+  m_zoomConfig->palette = name;
+
+  return true;
+}
+
+/////////////////////////////////// Slots /////////////////////////////////////
+void
+ZoomSpectrum::onPaletteChanged(int index)
+{
+  const Palette *palette = SigDiggerHelpers::instance()->getPalette(index);
+
+  if (palette != nullptr)
+    (void) this->setPalette(palette->getName());
+}
+
+void
+ZoomSpectrum::onAutoRange(void)
+{
+  m_haveLimits = false;
+}
@@ -0,0 +1,107 @@
+//
+//    ZoomSpectrum.h: Zoom-FFT view of a narrow channel
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef ZOOMSPECTRUM_H
+#define ZOOMSPECTRUM_H
+
+#include <InspectionWidgetFactory.h>
+#include <Suscan/Library.h>
+
+// Spectrum source preferred by the zoom view, if the inspector offers it
+#define SIGDIGGER_ZOOM_SPECTRUM_SOURCE "psd"
+
+namespace Ui {
+  class ZoomSpectrum;
+}
+
+class Waterfall;
+
+namespace SigDigger {
+  class ZoomSpectrumConfig : public Suscan::Serializable {
+  public:
+    std::string palette = "Inferno (Feely)";
+
+    void deserialize(Suscan::Object const &conf) override;
+    Suscan::Object &&serialize() override;
+  };
+
+  //
+  // High-resolution spectrum of a sub-band. The inspector translates and
+  // decimates the channel, and its spectrum source computes the FFT at
+  // the channel rate: the resolution is the channel bandwidth over the
+  // spectrum size, and the cost does not depend on the source rate.
+  //
+  class ZoomSpectrum : public InspectionWidget
+  {
+      Q_OBJECT
+
+      ZoomSpectrumConfig *m_zoomConfig = nullptr;
+      Ui::ZoomSpectrum   *m_ui = nullptr;
+      Waterfall          *m_wf = nullptr;
+
+      unsigned int m_spectrumSource = 0;
+      uint32_t     m_lastSpectrumId = 0;
+      SUSCOUNT     m_lastRate = 0;
+      SUSCOUNT     m_lastLength = 0;
+      bool         m_haveLimits = false;
+      bool         m_suspended = false;
+      bool         m_spectrumPaused = true;
+
+      QString getTabTitle() const;
+      unsigned int findSpectrumSource() const;
+      void feedSpectrum(
+          SUFLOAT *data,
+          SUSCOUNT len,
+          SUSCOUNT rate,
+          uint32_t id);
+      void adjustLimits(const SUFLOAT *data, SUSCOUNT len);
+      void refreshResolution();
+      void refreshSpectrumDemand();
+      bool setPalette(std::string const &);
+
+  public:
+      void attachAnalyzer(Suscan::Analyzer *) override;
+      void detachAnalyzer() override;
+
+      void inspectorMessage(Suscan::InspectorMessage const &) override;
+      bool suspend() override;
+      void resume() override;
+
+      Suscan::Serializable *allocConfig(void) override;
+      void applyConfig(void) override;
+
+      void showEvent(QShowEvent *event) override;
+      void hideEvent(QHideEvent *event) override;
+
+      std::string getLabel() const override;
+
+      explicit ZoomSpectrum(
+          InspectionWidgetFactory *factory,
+          Suscan::AnalyzerRequest const &request,
+          UIMediator *mediator,
+          QWidget *parent);
+
+      ~ZoomSpectrum() override;
+
+    public slots:
+      void onPaletteChanged(int);
+      void onAutoRange(void);
+  };
+}
+
+#endif // ZOOMSPECTRUM_H
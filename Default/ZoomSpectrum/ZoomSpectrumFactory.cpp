@@ -0,0 +1,48 @@
+//
+//    ZoomSpectrumFactory.cpp: Zoom-FFT inspection widget factory
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "ZoomSpectrumFactory.h"
+#include "ZoomSpectrum.h"
+
+using namespace SigDigger;
+
+ZoomSpectrumFactory::ZoomSpectrumFactory(Suscan::Plugin *plugin) :
+  InspectionWidgetFactory(plugin)
+{
+
+}
+
+const char *
+ZoomSpectrumFactory::name() const
+{
+  return "ZoomSpectrumFactory";
+}
+
+const char *
+ZoomSpectrumFactory::description() const
+{
+  return "Zoom FFT (high-resolution sub-band spectrum)";
+}
+
+InspectionWidget *
+ZoomSpectrumFactory::make(
+    Suscan::AnalyzerRequest const &request,
+    UIMediator *mediator)
+{
+  return new ZoomSpectrum(this, request, mediator, nullptr);
+}
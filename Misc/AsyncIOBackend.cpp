@@ -0,0 +1,305 @@
+//
+//    AsyncIOBackend.cpp: Asynchronous file write backends
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "AsyncIOBackend.h"
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <vector>
+
+#ifdef HAVE_LIBURING
+#  include <liburing.h>
+#endif // HAVE_LIBURING
+
+#if defined(_POSIX_ASYNCHRONOUS_IO) && _POSIX_ASYNCHRONOUS_IO > 0
+#  include <aio.h>
+#  define SIGDIGGER_HAVE_POSIX_AIO
+#endif
+
+using namespace SigDigger;
+
+AsyncIOBackend::~AsyncIOBackend()
+{
+}
+
+#ifdef HAVE_LIBURING
+////////////////////////////////// io_uring ////////////////////////////////////
+namespace SigDigger {
+  class UringIOBackend : public AsyncIOBackend {
+    struct io_uring ring;
+    unsigned int depth;
+    bool initialized = false;
+    std::string lastError;
+
+  public:
+    UringIOBackend(unsigned int depth);
+    ~UringIOBackend() override;
+
+    bool
+    isInitialized(void) const
+    {
+      return this->initialized;
+    }
+
+    unsigned int getDepth(void) const override;
+    const char *getName(void) const override;
+    std::string getError(void) const override;
+    bool submit(int, const void *, size_t, off_t, uintptr_t) override;
+    bool reap(uintptr_t &tag, ssize_t &result) override;
+  };
+}
+
+UringIOBackend::UringIOBackend(unsigned int depth)
+{
+  int ret;
+
+  this->depth = depth;
+
+  if ((ret = io_uring_queue_init(depth, &this->ring, 0)) < 0)
+    this->lastError = "io_uring_queue_init() failed: "
+        + std::string(strerror(-ret));
+  else
+    this->initialized = true;
+}
+
+UringIOBackend::~UringIOBackend()
+{
+  if (this->initialized)
+    io_uring_queue_exit(&this->ring);
+}
+
+unsigned int
+UringIOBackend::getDepth(void) const
+{
+  return this->depth;
+}
+
+const char *
+UringIOBackend::getName(void) const
+{
+  return "io_uring";
+}
+
+std::string
+UringIOBackend::getError(void) const
+{
+  return this->lastError;
+}
+
+bool
+UringIOBackend::submit(
+    int fd,
+    const void *data,
+    size_t len,
+    off_t offset,
+    uintptr_t tag)
+{
+  struct io_uring_sqe *sqe = io_uring_get_sqe(&this->ring);
+  int ret;
+
+  if (sqe == nullptr) {
+    this->lastError = "io_uring submission queue is full";
+    return false;
+  }
+
+  io_uring_prep_write(
+        sqe,
+        fd,
+        data,
+        static_cast<unsigned>(len),
+        static_cast<__u64>(offset));
+  io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(tag));
+
+  if ((ret = io_uring_submit(&this->ring)) < 0) {
+    this->lastError = "io_uring_submit() failed: "
+        + std::string(strerror(-ret));
+    return false;
+  }
+
+  return true;
+}
+
+bool
+UringIOBackend::reap(uintptr_t &tag, ssize_t &result)
+{
+  struct io_uring_cqe *cqe = nullptr;
+  int ret;
+
+  do
+    ret = io_uring_wait_cqe(&this->ring, &cqe);
+  while (ret == -EINTR);
+
+  if (ret < 0) {
+    this->lastError = "io_uring_wait_cqe() failed: "
+        + std::string(strerror(-ret));
+    return false;
+  }
+
+  tag    = reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe));
+  result = cqe->res;
+
+  io_uring_cqe_seen(&this->ring, cqe);
+
+  return true;
+}
+#endif // HAVE_LIBURING
+
+#ifdef SIGDIGGER_HAVE_POSIX_AIO
+////////////////////////////////// POSIX AIO ///////////////////////////////////
+namespace SigDigger {
+  class PosixAIOBackend : public AsyncIOBackend {
+    struct Request {
+      struct aiocb cb;
+      uintptr_t tag = 0;
+      bool busy = false;
+    };
+
+    std::vector<Request> requests;
+    std::vector<const struct aiocb *> waitList;
+    std::string lastError;
+
+  public:
+    PosixAIOBackend(unsigned int depth);
+
+    unsigned int getDepth(void) const override;
+    const char *getName(void) const override;
+    std::string getError(void) const override;
+    bool submit(int, const void *, size_t, off_t, uintptr_t) override;
+    bool reap(uintptr_t &tag, ssize_t &result) override;
+  };
+}
+
+PosixAIOBackend::PosixAIOBackend(unsigned int depth)
+{
+  this->requests.resize(depth);
+  this->waitList.resize(depth);
+}
+
+unsigned int
+PosixAIOBackend::getDepth(void) const
+{
+  return static_cast<unsigned int>(this->requests.size());
+}
+
+const char *
+PosixAIOBackend::getName(void) const
+{
+  return "POSIX AIO";
+}
+
+std::string
+PosixAIOBackend::getError(void) const
+{
+  return this->lastError;
+}
+
+bool
+PosixAIOBackend::submit(
+    int fd,
+    const void *data,
+    size_t len,
+    off_t offset,
+    uintptr_t tag)
+{
+  for (auto &req : this->requests) {
+    if (!req.busy) {
+      memset(&req.cb, 0, sizeof(struct aiocb));
+      req.cb.aio_fildes = fd;
+      req.cb.aio_buf    = const_cast<void *>(data);
+      req.cb.aio_nbytes = len;
+      req.cb.aio_offset = offset;
+      req.cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+
+      if (aio_write(&req.cb) == -1) {
+        this->lastError = "aio_write() failed: "
+            + std::string(strerror(errno));
+        return false;
+      }
+
+      req.tag  = tag;
+      req.busy = true;
+      return true;
+    }
+  }
+
+  this->lastError = "Too many asynchronous writes in flight";
+  return false;
+}
+
+bool
+PosixAIOBackend::reap(uintptr_t &tag, ssize_t &result)
+{
+  for (;;) {
+    int count = 0;
+
+    for (auto &req : this->requests) {
+      if (!req.busy)
+        continue;
+
+      int err = aio_error(&req.cb);
+
+      if (err != EINPROGRESS) {
+        ssize_t ret = aio_return(&req.cb);
+
+        tag      = req.tag;
+        result   = err == 0 ? ret : -err;
+        req.busy = false;
+        return true;
+      }
+
+      this->waitList[count++] = &req.cb;
+    }
+
+    if (count == 0) {
+      this->lastError = "No asynchronous writes in flight";
+      return false;
+    }
+
+    if (aio_suspend(this->waitList.data(), count, nullptr) == -1
+        && errno != EINTR && errno != EAGAIN) {
+      this->lastError = "aio_suspend() failed: "
+          + std::string(strerror(errno));
+      return false;
+    }
+  }
+}
+#endif // SIGDIGGER_HAVE_POSIX_AIO
+
+AsyncIOBackend *
+AsyncIOBackend::make(unsigned int depth)
+{
+  AsyncIOBackend *backend = nullptr;
+
+#ifdef HAVE_LIBURING
+  UringIOBackend *uring = new UringIOBackend(depth);
+
+  // Kernels without io_uring (or with it disabled) fail here
+  if (uring->isInitialized())
+    return uring;
+
+  delete uring;
+#endif // HAVE_LIBURING
+
+#ifdef SIGDIGGER_HAVE_POSIX_AIO
+  backend = new PosixAIOBackend(depth);
+#else
+  (void) depth;
+#endif // SIGDIGGER_HAVE_POSIX_AIO
+
+  return backend;
+}
@@ -18,44 +18,412 @@
 //
 
 #include "Averager.h"
+#include "PSDPyramid.h"
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+#if defined(__AVX__) || defined(__SSE__) || defined(__x86_64__)
+#  include <immintrin.h>
+#elif defined(__ARM_NEON)
+#  include <arm_neon.h>
+#endif
 
 using namespace SigDigger;
 
+//
+// Exponential blending kernel. Updates the average and, optionally, the
+// peak and min hold buffers in a single pass over the incoming PSD.
+//
+// last, peak and min are aligned to SIGDIGGER_AVERAGER_ALIGNMENT, the
+// incoming PSD is not (it belongs to the message).
+//
+static void
+averagerBlend(
+    float *last,
+    float *peak,
+    float *min,
+    const float *in,
+    float alpha,
+    unsigned long size)
+{
+  unsigned long i = 0;
+
+#if defined(__AVX__)
+  __m256 a = _mm256_set1_ps(alpha);
+
+  if (peak != nullptr) {
+    for (; i + 8 <= size; i += 8) {
+      __m256 x = _mm256_loadu_ps(in + i);
+      __m256 l = _mm256_load_ps(last + i);
+      l = _mm256_add_ps(l, _mm256_mul_ps(a, _mm256_sub_ps(x, l)));
+      _mm256_store_ps(last + i, l);
+      _mm256_store_ps(peak + i, _mm256_max_ps(_mm256_load_ps(peak + i), x));
+      _mm256_store_ps(min  + i, _mm256_min_ps(_mm256_load_ps(min  + i), x));
+    }
+  } else {
+    for (; i + 8 <= size; i += 8) {
+      __m256 x = _mm256_loadu_ps(in + i);
+      __m256 l = _mm256_load_ps(last + i);
+      l = _mm256_add_ps(l, _mm256_mul_ps(a, _mm256_sub_ps(x, l)));
+      _mm256_store_ps(last + i, l);
+    }
+  }
+#elif defined(__SSE__) || defined(__x86_64__)
+  __m128 a = _mm_set1_ps(alpha);
+
+  if (peak != nullptr) {
+    for (; i + 4 <= size; i += 4) {
+      __m128 x = _mm_loadu_ps(in + i);
+      __m128 l = _mm_load_ps(last + i);
+      l = _mm_add_ps(l, _mm_mul_ps(a, _mm_sub_ps(x, l)));
+      _mm_store_ps(last + i, l);
+      _mm_store_ps(peak + i, _mm_max_ps(_mm_load_ps(peak + i), x));
+      _mm_store_ps(min  + i, _mm_min_ps(_mm_load_ps(min  + i), x));
+    }
+  } else {
+    for (; i + 4 <= size; i += 4) {
+      __m128 x = _mm_loadu_ps(in + i);
+      __m128 l = _mm_load_ps(last + i);
+      l = _mm_add_ps(l, _mm_mul_ps(a, _mm_sub_ps(x, l)));
+      _mm_store_ps(last + i, l);
+    }
+  }
+#elif defined(__ARM_NEON)
+  float32x4_t a = vdupq_n_f32(alpha);
+
+  if (peak != nullptr) {
+    for (; i + 4 <= size; i += 4) {
+      float32x4_t x = vld1q_f32(in + i);
+      float32x4_t l = vld1q_f32(last + i);
+      l = vmlaq_f32(l, a, vsubq_f32(x, l));
+      vst1q_f32(last + i, l);
+      vst1q_f32(peak + i, vmaxq_f32(vld1q_f32(peak + i), x));
+      vst1q_f32(min  + i, vminq_f32(vld1q_f32(min  + i), x));
+    }
+  } else {
+    for (; i + 4 <= size; i += 4) {
+      float32x4_t x = vld1q_f32(in + i);
+      float32x4_t l = vld1q_f32(last + i);
+      vst1q_f32(last + i, vmlaq_f32(l, a, vsubq_f32(x, l)));
+    }
+  }
+#endif
+
+  // Scalar tail (or the whole thing, if no SIMD is available)
+  if (peak != nullptr) {
+    for (; i < size; ++i) {
+      last[i] += alpha * (in[i] - last[i]);
+      if (in[i] > peak[i])
+        peak[i] = in[i];
+      if (in[i] < min[i])
+        min[i] = in[i];
+    }
+  } else {
+    for (; i < size; ++i)
+      last[i] += alpha * (in[i] - last[i]);
+  }
+}
+
+//
+// Percentile tracking kernel. Every estimate is multiplied by up if the
+// incoming value is above it, or by down otherwise. Same buffers and
+// alignment as averagerBlend.
+//
+static void
+averagerTrack(
+    float *last,
+    float *peak,
+    float *min,
+    const float *in,
+    float up,
+    float down,
+    unsigned long size)
+{
+  unsigned long i = 0;
+
+#if defined(__AVX__)
+  __m256 u  = _mm256_set1_ps(up);
+  __m256 d  = _mm256_set1_ps(down);
+  __m256 fl = _mm256_set1_ps(SIGDIGGER_AVERAGER_QUANTILE_FLOOR);
+
+  for (; i + 8 <= size; i += 8) {
+    __m256 x = _mm256_loadu_ps(in + i);
+    __m256 q = _mm256_load_ps(last + i);
+    __m256 f = _mm256_blendv_ps(u, d, _mm256_cmp_ps(x, q, _CMP_LT_OQ));
+    _mm256_store_ps(last + i, _mm256_max_ps(_mm256_mul_ps(q, f), fl));
+
+    if (peak != nullptr) {
+      _mm256_store_ps(peak + i, _mm256_max_ps(_mm256_load_ps(peak + i), x));
+      _mm256_store_ps(min  + i, _mm256_min_ps(_mm256_load_ps(min  + i), x));
+    }
+  }
+#elif defined(__SSE__) || defined(__x86_64__)
+  __m128 u  = _mm_set1_ps(up);
+  __m128 d  = _mm_set1_ps(down);
+  __m128 fl = _mm_set1_ps(SIGDIGGER_AVERAGER_QUANTILE_FLOOR);
+
+  for (; i + 4 <= size; i += 4) {
+    __m128 x = _mm_loadu_ps(in + i);
+    __m128 q = _mm_load_ps(last + i);
+    __m128 below = _mm_cmplt_ps(x, q);
+    __m128 f = _mm_or_ps(_mm_and_ps(below, d), _mm_andnot_ps(below, u));
+    _mm_store_ps(last + i, _mm_max_ps(_mm_mul_ps(q, f), fl));
+
+    if (peak != nullptr) {
+      _mm_store_ps(peak + i, _mm_max_ps(_mm_load_ps(peak + i), x));
+      _mm_store_ps(min  + i, _mm_min_ps(_mm_load_ps(min  + i), x));
+    }
+  }
+#elif defined(__ARM_NEON)
+  float32x4_t u  = vdupq_n_f32(up);
+  float32x4_t d  = vdupq_n_f32(down);
+  float32x4_t fl = vdupq_n_f32(SIGDIGGER_AVERAGER_QUANTILE_FLOOR);
+
+  for (; i + 4 <= size; i += 4) {
+    float32x4_t x = vld1q_f32(in + i);
+    float32x4_t q = vld1q_f32(last + i);
+    float32x4_t f = vbslq_f32(vcltq_f32(x, q), d, u);
+    vst1q_f32(last + i, vmaxq_f32(vmulq_f32(q, f), fl));
+
+    if (peak != nullptr) {
+      vst1q_f32(peak + i, vmaxq_f32(vld1q_f32(peak + i), x));
+      vst1q_f32(min  + i, vminq_f32(vld1q_f32(min  + i), x));
+    }
+  }
+#endif
+
+  // Scalar tail (or the whole thing, if no SIMD is available)
+  for (; i < size; ++i) {
+    float q = last[i] * (in[i] < last[i] ? down : up);
+    last[i] = q > SIGDIGGER_AVERAGER_QUANTILE_FLOOR
+        ? q
+        : SIGDIGGER_AVERAGER_QUANTILE_FLOOR;
+
+    if (peak != nullptr) {
+      if (in[i] > peak[i])
+        peak[i] = in[i];
+      if (in[i] < min[i])
+        min[i] = in[i];
+    }
+  }
+}
+
+void
+Averager::assertCapacity(unsigned long size)
+{
+  // Round each buffer up so that the next one stays aligned too
+  const unsigned long step = SIGDIGGER_AVERAGER_ALIGNMENT / sizeof(float);
+  unsigned long stride = (size + step - 1) / step * step;
+  void *raw;
+  uintptr_t base;
+
+  if (size <= this->capacity)
+    return;
+
+  raw = malloc(3 * stride * sizeof(float) + SIGDIGGER_AVERAGER_ALIGNMENT);
+  if (raw == nullptr)
+    throw Suscan::Exception("Failed to allocate PSD buffer");
+
+  if (this->storage != nullptr)
+    free(this->storage);
+
+  base = reinterpret_cast<uintptr_t>(raw);
+  base = (base + SIGDIGGER_AVERAGER_ALIGNMENT - 1)
+      & ~static_cast<uintptr_t>(SIGDIGGER_AVERAGER_ALIGNMENT - 1);
+
+  this->storage  = raw;
+  this->capacity = stride;
+  this->last     = reinterpret_cast<float *>(base);
+  this->peakHold = this->last + stride;
+  this->minHold  = this->peakHold + stride;
+}
+
+//
+// The FFT size changed under us. The average (and holds) are carried over
+// to the new number of bins, so that switching FFT sizes does not restart
+// the averaging from scratch. Holds keep their peaks (and minima).
+//
+void
+Averager::rescale(unsigned long size)
+{
+  unsigned int prevSize = static_cast<unsigned int>(this->bufsiz);
+  unsigned int newSize = static_cast<unsigned int>(size);
+  std::vector<float> prev(3 * prevSize);
+
+  memcpy(prev.data(), this->last, prevSize * sizeof(float));
+  if (this->holdValid) {
+    memcpy(prev.data() + prevSize, this->peakHold, prevSize * sizeof(float));
+    memcpy(prev.data() + 2 * prevSize, this->minHold, prevSize * sizeof(float));
+  }
+
+  this->assertCapacity(size);
+
+  PSDPyramid::resample(
+        prev.data(),
+        prevSize,
+        this->last,
+        newSize,
+        PSDPyramid::MEAN);
+
+  if (this->holdValid) {
+    PSDPyramid::resample(
+          prev.data() + prevSize,
+          prevSize,
+          this->peakHold,
+          newSize,
+          PSDPyramid::MAXIMUM);
+
+    PSDPyramid::resample(
+          prev.data() + 2 * prevSize,
+          prevSize,
+          this->minHold,
+          newSize,
+          PSDPyramid::MINIMUM);
+  }
+
+  this->bufsiz = size;
+}
+
 void
 Averager::feed(Suscan::PSDMessage const &m)
 {
+  const SUFLOAT *original = m.get();
+  unsigned long size = m.size();
   bool blend = this->alpha != 1.f;
+  bool track = blend && this->percentile > 0;
+
+  static_assert(
+        sizeof(SUFLOAT) == sizeof(float),
+        "Averager assumes single-precision PSDs");
 
-  if (this->last == nullptr || m.size() != this->bufsiz) {
-    try {
-      float *buf = new float[m.size()];
-      if (this->last != nullptr)
-        delete [] this->last;
-      this->last = buf;
-      this->bufsiz = m.size();
-      blend = false;
-    } catch (std::bad_alloc &) {
-      throw Suscan::Exception("Failed to allocate PSD buffer");
+  if (this->last == nullptr || this->bufsiz == 0) {
+    this->assertCapacity(size);
+    this->bufsiz    = size;
+    this->holdValid = false;
+    blend = track = false;
+  } else if (size != this->bufsiz) {
+    this->rescale(size);
+  }
+
+  // First PSD after a hold reset: start hold buffers from it
+  if (this->hold && !this->holdValid) {
+    memcpy(this->peakHold, original, size * sizeof(float));
+    memcpy(this->minHold,  original, size * sizeof(float));
+    this->holdValid = true;
+    if (!blend) {
+      memcpy(this->last, original, size * sizeof(float));
+      return;
     }
   }
 
-  if (blend) {
-    const SUFLOAT *original = m.get();
-    for (unsigned long i = 0; i < this->bufsiz; ++i)
-      this->last[i] += this->alpha * (original[i] - this->last[i]);
+  if (track) {
+    averagerTrack(
+          this->last,
+          this->hold ? this->peakHold : nullptr,
+          this->hold ? this->minHold  : nullptr,
+          original,
+          this->quantileUp,
+          this->quantileDown,
+          size);
+  } else if (blend || this->hold) {
+    averagerBlend(
+          this->last,
+          this->hold ? this->peakHold : nullptr,
+          this->hold ? this->minHold  : nullptr,
+          original,
+          blend ? this->alpha : 1.f,
+          size);
   } else {
-    memcpy(this->last, m.get(), m.size() * sizeof(float));
+    memcpy(this->last, original, size * sizeof(float));
   }
 }
 
+void
+Averager::updateQuantileSteps(void)
+{
+  // The averaging speed is the step, in nepers. Steps up and down are
+  // weighted so that they cancel out exactly at the percentile.
+  this->quantileUp   = std::exp(this->alpha * this->percentile);
+  this->quantileDown = std::exp(-this->alpha * (1 - this->percentile));
+}
+
 void
 Averager::setAlpha(float alpha)
 {
   this->alpha = alpha;
+  this->updateQuantileSteps();
+}
+
+void
+Averager::setPercentile(float percentile)
+{
+  if (percentile < 0)
+    percentile = 0;
+  else if (percentile >= 1)
+    percentile = .99f;
+
+  this->percentile = percentile;
+  this->updateQuantileSteps();
+}
+
+void
+Averager::setHold(bool enabled)
+{
+  if (this->hold != enabled) {
+    this->hold = enabled;
+    this->holdValid = false;
+  }
+}
+
+void
+Averager::resetHold(void)
+{
+  this->holdValid = false;
+}
+
+void
+Averager::setTrace(Trace trace)
+{
+  if (this->trace != trace) {
+    this->trace = trace;
+    this->setHold(trace != AVERAGE);
+    this->resetHold();
+  }
+}
+
+float *
+Averager::getTraceData(void) const
+{
+  float *data = nullptr;
+
+  if (this->trace == MAX_HOLD)
+    data = this->getPeak();
+  else if (this->trace == MIN_HOLD)
+    data = this->getMin();
+
+  return data != nullptr ? data : this->last;
+}
+
+void
+Averager::reset(void)
+{
+  if (this->storage != nullptr) {
+    free(this->storage);
+    this->storage  = nullptr;
+    this->capacity = 0;
+    this->last     = nullptr;
+    this->peakHold = nullptr;
+    this->minHold  = nullptr;
+  }
+
+  this->bufsiz    = 0;
+  this->holdValid = false;
 }
 
 Averager::~Averager(void)
 {
   this->reset();
 }
-
@@ -0,0 +1,275 @@
+//
+//    BenchmarkHistory.cpp: Stored benchmark results and regression checks
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <BenchmarkHistory.h>
+#include <SampleKernels.h>
+#include <SigDiggerHelpers.h>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QSysInfo>
+#include <QFile>
+#include <QDir>
+#include <algorithm>
+#include <cstdio>
+
+using namespace SigDigger;
+
+BenchmarkHistory::BenchmarkHistory(QString const &suite)
+{
+  this->suite = suite;
+  this->setConfig(QJsonObject());
+}
+
+void
+BenchmarkHistory::help(void)
+{
+  fprintf(stderr, "     -H, --history=DIR       Compare with and record to the\n");
+  fprintf(stderr, "                             results in DIR (empty: none)\n");
+  if (*SIGDIGGER_BENCHMARK_HISTORY_DIR != '\0')
+    fprintf(stderr, "                             (default: %s)\n",
+            SIGDIGGER_BENCHMARK_HISTORY_DIR);
+  fprintf(stderr, "     -E, --tolerance=LIST    Allowed change for the worse, as\n");
+  fprintf(stderr, "                             comma-separated [PREFIX=]FRACTION\n");
+  fprintf(stderr, "                             (default: %g)\n",
+          SIGDIGGER_BENCHMARK_HISTORY_DEFAULT_TOLERANCE);
+  fprintf(stderr, "     -N, --no-record         Compare, but do not record this run\n");
+}
+
+void
+BenchmarkHistory::setDirectory(QString const &dir)
+{
+  this->directory = dir;
+}
+
+void
+BenchmarkHistory::setRecording(bool recording)
+{
+  this->recording = recording;
+}
+
+void
+BenchmarkHistory::setConfig(QJsonObject const &params)
+{
+  QJsonObject config = params;
+
+  config["host"]    = QSysInfo::machineHostName();
+  config["kernels"] = SampleKernels::isaName();
+
+  this->config = QString::fromUtf8(
+        QJsonDocument(config).toJson(QJsonDocument::Compact));
+}
+
+bool
+BenchmarkHistory::setTolerances(QString const &spec)
+{
+  QList<QPair<QString, qreal>> tolerances;
+  qreal defaultTolerance = this->defaultTolerance;
+
+  for (auto &p : spec.split(",", QString::SkipEmptyParts)) {
+    int eq = p.lastIndexOf('=');
+    QString prefix = eq < 0 ? QString() : p.left(eq).trimmed();
+    bool ok;
+    qreal tolerance = p.mid(eq + 1).trimmed().toDouble(&ok);
+
+    if (!ok || tolerance < 0)
+      return false;
+
+    if (prefix.isEmpty())
+      defaultTolerance = tolerance;
+    else
+      tolerances.append(qMakePair(prefix, tolerance));
+  }
+
+  std::stable_sort(
+        tolerances.begin(),
+        tolerances.end(),
+        [] (QPair<QString, qreal> const &a, QPair<QString, qreal> const &b) {
+          return a.first.size() > b.first.size();
+        });
+
+  this->tolerances = tolerances;
+  this->defaultTolerance = defaultTolerance;
+
+  return true;
+}
+
+void
+BenchmarkHistory::addMetric(
+    QString const &name,
+    qreal value,
+    Direction direction)
+{
+  this->metrics[name] = Metric{value, direction};
+}
+
+qreal
+BenchmarkHistory::toleranceOf(QString const &name) const
+{
+  for (auto &p : this->tolerances)
+    if (name.startsWith(p.first))
+      return p.second;
+
+  return this->defaultTolerance;
+}
+
+QString
+BenchmarkHistory::historyPath(void) const
+{
+  return this->directory + "/" + this->suite + ".jsonl";
+}
+
+void
+BenchmarkHistory::loadBaselines(QMap<QString, QList<qreal>> &values) const
+{
+  QFile file(this->historyPath());
+
+  // No history yet: every metric is new
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    return;
+
+  while (!file.atEnd()) {
+    QJsonObject run = QJsonDocument::fromJson(file.readLine()).object();
+    QJsonObject metrics = run["metrics"].toObject();
+
+    if (run["config"].toString() != this->config
+        || run["regressed"].toBool())
+      continue;
+
+    for (auto it = metrics.constBegin(); it != metrics.constEnd(); ++it) {
+      QList<qreal> &list = values[it.key()];
+
+      list.append(it.value().toDouble());
+      if (list.size() > SIGDIGGER_BENCHMARK_HISTORY_BASELINE_RUNS)
+        list.removeFirst();
+    }
+  }
+}
+
+bool
+BenchmarkHistory::record(void) const
+{
+  QJsonObject run, build, metrics;
+  QFile file(this->historyPath());
+  QByteArray line;
+
+  for (auto it = this->metrics.cbegin(); it != this->metrics.cend(); ++it)
+    metrics[it.key()] = it.value().value;
+
+  build["version"] = SigDiggerHelpers::version();
+  build["package"] = SigDiggerHelpers::pkgversion();
+
+  run["time"]      = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+  run["build"]     = build;
+  run["config"]    = this->config;
+  run["regressed"] = this->regressed;
+  run["metrics"]   = metrics;
+
+  line = QJsonDocument(run).toJson(QJsonDocument::Compact) + "\n";
+
+  if (!QDir().mkpath(this->directory)
+      || !file.open(QIODevice::WriteOnly | QIODevice::Append)
+      || file.write(line) != line.size()) {
+    fprintf(
+          stderr,
+          "Cannot record results to %s: %s\n",
+          this->historyPath().toStdString().c_str(),
+          file.errorString().toStdString().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool
+BenchmarkHistory::process(void)
+{
+  QMap<QString, QList<qreal>> baselines;
+
+  this->comparison = QJsonObject();
+  this->regressed  = false;
+
+  if (this->directory.isEmpty())
+    return true;
+
+  this->loadBaselines(baselines);
+
+  for (auto it = this->metrics.cbegin(); it != this->metrics.cend(); ++it) {
+    QList<qreal> values = baselines.value(it.key());
+    QJsonObject result;
+    qreal tolerance = this->toleranceOf(it.key());
+    qreal value = it.value().value;
+    qreal baseline, change, worse;
+
+    result["value"] = value;
+
+    if (values.isEmpty()) {
+      result["status"] = "new";
+      this->comparison[it.key()] = result;
+      continue;
+    }
+
+    std::sort(values.begin(), values.end());
+    baseline = values.size() % 2
+        ? values[values.size() / 2]
+        : .5 * (values[values.size() / 2 - 1] + values[values.size() / 2]);
+
+    // A zero baseline allows no relative comparison
+    change = baseline != 0 ? (value - baseline) / baseline : 0;
+    worse  = it.value().direction == LOWER_IS_BETTER ? change : -change;
+
+    result["baseline"]  = baseline;
+    result["change"]    = change;
+    result["tolerance"] = tolerance;
+    result["status"]    = worse > tolerance ? "regression" : "ok";
+
+    if (worse > tolerance) {
+      this->regressed = true;
+      fprintf(
+            stderr,
+            "REGRESSION: %s: %g (baseline %g, %+.1f%%, tolerance %.1f%%)\n",
+            it.key().toStdString().c_str(),
+            value,
+            baseline,
+            change * 1e2,
+            tolerance * 1e2);
+    }
+
+    this->comparison[it.key()] = result;
+  }
+
+  if (this->recording)
+    return this->record();
+
+  return true;
+}
+
+QJsonObject
+BenchmarkHistory::toJson(void) const
+{
+  QJsonObject obj;
+
+  if (this->directory.isEmpty())
+    return obj;
+
+  obj["history"]   = this->historyPath();
+  obj["regressed"] = this->regressed;
+  obj["metrics"]   = this->comparison;
+
+  return obj;
+}
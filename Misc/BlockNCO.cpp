@@ -0,0 +1,82 @@
+//
+//    BlockNCO.cpp: Oscillator and mixer working on blocks
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "BlockNCO.h"
+#include "SampleKernels.h"
+#include <sigutils/sampling.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace SigDigger;
+
+BlockNCO::BlockNCO(SUFLOAT fnor, SUFLOAT phase)
+{
+  this->table.resize(SIGDIGGER_BLOCK_NCO_TABLE_LENGTH);
+
+  this->setFrequency(fnor);
+  this->setPhase(phase);
+}
+
+void
+BlockNCO::setFrequency(SUFLOAT fnor)
+{
+  size_t i;
+
+  this->omega = SU_NORM2ANG_FREQ(static_cast<double>(fnor));
+
+  for (i = 0; i < this->table.size(); ++i) {
+    double arg = std::remainder(i * this->omega, 2 * M_PI);
+
+    this->table[i] = SUCOMPLEX(
+          static_cast<SUFLOAT>(std::cos(arg)),
+          static_cast<SUFLOAT>(std::sin(arg)));
+  }
+}
+
+void
+BlockNCO::setPhase(SUFLOAT phase)
+{
+  this->phase = std::remainder(static_cast<double>(phase), 2 * M_PI);
+}
+
+void
+BlockNCO::mix(SUCOMPLEX *dest, const SUCOMPLEX *x, size_t size)
+{
+  size_t chunk;
+
+  while (size > 0) {
+    chunk = std::min(size, this->table.size());
+
+    SampleKernels::mix(
+          dest,
+          x,
+          this->table.data(),
+          chunk,
+          SUCOMPLEX(
+            static_cast<SUFLOAT>(std::cos(this->phase)),
+            static_cast<SUFLOAT>(std::sin(this->phase))));
+
+    this->phase = std::remainder(
+          this->phase + chunk * this->omega,
+          2 * M_PI);
+
+    dest += chunk;
+    x    += chunk;
+    size -= chunk;
+  }
+}
@@ -21,6 +21,7 @@
 #include <cmath>
 #include <QColor>
 #include <QDebug>
+#include <algorithm>
 
 using namespace SigDigger;
 
@@ -29,13 +30,77 @@ BookmarkTableModel::BookmarkTableModel(
     const QMap<qint64,Suscan::Bookmark> *map) : QAbstractTableModel(parent)
 {
   this->bookmarkPtr = map;
+
+  this->rebuildRows();
+}
+
+void
+BookmarkTableModel::rebuildRows(void)
+{
+  QVector<int> order;
+  int count = this->bookmarkPtr->count();
+  int i = 0;
+
+  this->rows.resize(count);
+  this->searchKeys.resize(count);
+
+  for (auto p = this->bookmarkPtr->cbegin(); p != this->bookmarkPtr->cend(); ++p) {
+    this->rows[i] = &p.value();
+    this->searchKeys[i] =
+        (p->info.name + "\n" + p->info.modulation).toLower();
+    ++i;
+  }
+
+  order.resize(count);
+
+  // Name index
+  for (i = 0; i < count; ++i)
+    order[i] = i;
+
+  std::stable_sort(
+        order.begin(),
+        order.end(),
+        [this] (int a, int b) {
+          return QString::localeAwareCompare(
+                this->rows[a]->info.name,
+                this->rows[b]->info.name) < 0;
+        });
+
+  this->nameRank.resize(count);
+  for (i = 0; i < count; ++i)
+    this->nameRank[order[i]] = i;
+
+  // Modulation index
+  for (i = 0; i < count; ++i)
+    order[i] = i;
+
+  std::stable_sort(
+        order.begin(),
+        order.end(),
+        [this] (int a, int b) {
+          return this->rows[a]->info.modulation
+              < this->rows[b]->info.modulation;
+        });
+
+  this->modulationRank.resize(count);
+  for (i = 0; i < count; ++i)
+    this->modulationRank[order[i]] = i;
+}
+
+const Suscan::Bookmark *
+BookmarkTableModel::bookmarkAt(int row) const
+{
+  if (row < 0 || row >= this->rows.size())
+    return nullptr;
+
+  return this->rows[row];
 }
 
 
 int
 BookmarkTableModel::rowCount(const QModelIndex &) const
 {
-  return this->bookmarkPtr->count();
+  return this->rows.size();
 }
 
 int
@@ -48,28 +113,27 @@ BookmarkTableModel::columnCount(const QModelIndex &) const
 QVariant
 BookmarkTableModel::data(const QModelIndex &index, int role) const
 {
-  if (index.row() < 0 || index.row() >= this->bookmarkPtr->count())
-    return QVariant();
+  const Suscan::Bookmark *bookmark = this->bookmarkAt(index.row());
 
-  Suscan::Bookmark bookmark =
-      (*this->bookmarkPtr)[this->bookmarkPtr->keys().at(index.row())];
+  if (bookmark == nullptr)
+    return QVariant();
 
   if (role == Qt::DisplayRole) {
     switch (index.column()) {
       case 0:
-        return SuWidgetsHelpers::formatQuantity(bookmark.info.frequency, "Hz");
+        return SuWidgetsHelpers::formatQuantity(bookmark->info.frequency, "Hz");
 
       case 1:
-        return SuWidgetsHelpers::formatQuantity(bookmark.info.bandwidth(), "Hz");
+        return SuWidgetsHelpers::formatQuantity(bookmark->info.bandwidth(), "Hz");
 
       case 2:
-        return bookmark.info.modulation;
+        return bookmark->info.modulation;
 
       case 3:
         return "";
 
       case 4:
-        return bookmark.info.name;
+        return bookmark->info.name;
 
       case 5:
       case 6:
@@ -77,7 +141,7 @@ BookmarkTableModel::data(const QModelIndex &index, int role) const
     }
   } else if (role == Qt::BackgroundColorRole) {
     if (index.column() == 3)
-      return bookmark.info.color;
+      return bookmark->info.color;
   }
 
   return QVariant();
@@ -106,6 +170,8 @@ BookmarkTableModel::headerData(int s, Qt::Orientation hor, int role) const
 void
 BookmarkTableModel::notifyChanged(void)
 {
+  emit layoutAboutToBeChanged();
+  this->rebuildRows();
   emit layoutChanged();
 }
 
@@ -119,5 +185,58 @@ BookmarkTableModel::notifyRemovalStart(int row)
 void
 BookmarkTableModel::notifyRemovalFinish(void)
 {
+  this->rebuildRows();
   endRemoveRows();
 }
+
+/////////////////////////// BookmarkFilterProxyModel ///////////////////////////
+BookmarkFilterProxyModel::BookmarkFilterProxyModel(
+    QObject *parent,
+    BookmarkTableModel *model) : QSortFilterProxyModel(parent)
+{
+  this->bookmarks = model;
+  this->setSourceModel(model);
+}
+
+void
+BookmarkFilterProxyModel::setFilter(QString const &filter)
+{
+  this->filter = filter.trimmed().toLower();
+  this->invalidateFilter();
+}
+
+bool
+BookmarkFilterProxyModel::lessThan(
+    QModelIndex const &left,
+    QModelIndex const &right) const
+{
+  int a = left.row();
+  int b = right.row();
+
+  switch (left.column()) {
+    case 1:
+      return this->bookmarks->bookmarkAt(a)->info.bandwidth()
+          < this->bookmarks->bookmarkAt(b)->info.bandwidth();
+
+    case 2:
+      return this->bookmarks->getModulationRank(a)
+          < this->bookmarks->getModulationRank(b);
+
+    case 4:
+      return this->bookmarks->getNameRank(a)
+          < this->bookmarks->getNameRank(b);
+
+    default:
+      // Rows are already in frequency order
+      return a < b;
+  }
+}
+
+bool
+BookmarkFilterProxyModel::filterAcceptsRow(int row, QModelIndex const &) const
+{
+  if (this->filter.isEmpty())
+    return true;
+
+  return this->bookmarks->getSearchKey(row).contains(this->filter);
+}
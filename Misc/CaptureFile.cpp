@@ -0,0 +1,227 @@
+//
+//    CaptureFile.cpp: Random access to capture files
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "CaptureFile.h"
+#include "SegmentedCaptureReader.h"
+#include "SegmentedDataSaver.h"
+#include "QuantizedIQ.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+using namespace SigDigger;
+
+CaptureFile::CaptureFile()
+{
+}
+
+CaptureFile::~CaptureFile()
+{
+  this->close();
+}
+
+static bool
+endsWith(std::string const &str, const char *suffix)
+{
+  size_t len = strlen(suffix);
+
+  return str.size() >= len
+      && str.compare(str.size() - len, len, suffix) == 0;
+}
+
+static void
+adviseSequential(const void *addr, size_t size)
+{
+  uintptr_t page  = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  uintptr_t start = reinterpret_cast<uintptr_t>(addr) & ~(page - 1);
+  uintptr_t end   = reinterpret_cast<uintptr_t>(addr) + size;
+
+  madvise(reinterpret_cast<void *>(start), end - start, MADV_SEQUENTIAL);
+}
+
+CaptureFileFormat
+CaptureFile::guessFormat(std::string const &path)
+{
+  if (endsWith(path, SIGDIGGER_SEGMENTED_INDEX_EXTENSION))
+    return CAPTURE_FILE_SEGMENTED;
+
+  if (endsWith(path, SIGDIGGER_QUANTIZED_IQ_EXTENSION))
+    return CAPTURE_FILE_QUANTIZED;
+
+  return CAPTURE_FILE_RAW;
+}
+
+void
+CaptureFile::close(void)
+{
+  if (this->map != nullptr) {
+    munmap(const_cast<SUCOMPLEX *>(this->map), this->mapSize);
+    this->map = nullptr;
+    this->mapSize = 0;
+  }
+
+  if (this->fd != -1) {
+    ::close(this->fd);
+    this->fd = -1;
+  }
+
+  this->segmented.reset();
+  this->quantized.reset();
+
+  this->length = 0;
+  this->rate = 0;
+  this->freq = 0;
+}
+
+bool
+CaptureFile::openRaw(std::string const &path)
+{
+  struct stat sbuf;
+  void *addr;
+
+  if ((this->fd = ::open(path.c_str(), O_RDONLY)) == -1) {
+    this->lastError = "Cannot open " + path + ": " + strerror(errno);
+    return false;
+  }
+
+  if (fstat(this->fd, &sbuf) == -1) {
+    this->lastError = "Cannot stat " + path + ": " + strerror(errno);
+    return false;
+  }
+
+  this->length = static_cast<quint64>(sbuf.st_size) / sizeof(SUCOMPLEX);
+
+  if (this->length == 0) {
+    this->lastError = "Capture file is empty";
+    return false;
+  }
+
+  this->mapSize = this->length * sizeof(SUCOMPLEX);
+
+  addr = mmap(nullptr, this->mapSize, PROT_READ, MAP_SHARED, this->fd, 0);
+  if (addr == MAP_FAILED) {
+    this->mapSize = 0;
+    this->lastError = "Cannot map " + path + ": " + strerror(errno);
+    return false;
+  }
+
+  this->map = static_cast<const SUCOMPLEX *>(addr);
+
+  // The mapping keeps the file alive
+  ::close(this->fd);
+  this->fd = -1;
+
+  return true;
+}
+
+bool
+CaptureFile::open(std::string const &path)
+{
+  bool ok = false;
+
+  this->close();
+
+  this->format = guessFormat(path);
+
+  switch (this->format) {
+    case CAPTURE_FILE_RAW:
+      ok = this->openRaw(path);
+      break;
+
+    case CAPTURE_FILE_SEGMENTED:
+      this->segmented.reset(new SegmentedCaptureReader());
+      if (!(ok = this->segmented->open(path))) {
+        this->lastError = this->segmented->getError();
+      } else {
+        this->length = this->segmented->getEndSample()
+            - this->segmented->getFirstSample();
+        this->rate   = this->segmented->getSampleRate();
+        this->freq   = this->segmented->getFrequencyAt(
+              this->segmented->getFirstSample());
+      }
+      break;
+
+    case CAPTURE_FILE_QUANTIZED:
+      this->quantized.reset(new QuantizedCaptureReader());
+      if (!(ok = this->quantized->open(path))) {
+        this->lastError = this->quantized->getError();
+      } else {
+        this->length = this->quantized->getLength();
+        this->rate   = this->quantized->getSampleRate();
+        this->freq   = this->quantized->getFrequency();
+      }
+      break;
+  }
+
+  if (!ok)
+    this->close();
+
+  return ok;
+}
+
+ssize_t
+CaptureFile::read(quint64 from, SUCOMPLEX *data, size_t len)
+{
+  ssize_t got;
+
+  if (from >= this->length)
+    return 0;
+
+  if (len > this->length - from)
+    len = static_cast<size_t>(this->length - from);
+
+  switch (this->format) {
+    case CAPTURE_FILE_RAW:
+      if (this->map == nullptr)
+        return -1;
+
+      // Ranges are read once, front to back
+      adviseSequential(this->map + from, len * sizeof(SUCOMPLEX));
+      memcpy(data, this->map + from, len * sizeof(SUCOMPLEX));
+      got = static_cast<ssize_t>(len);
+      break;
+
+    case CAPTURE_FILE_SEGMENTED:
+      if (!this->segmented->seek(this->segmented->getFirstSample() + from)) {
+        this->lastError = this->segmented->getError();
+        return -1;
+      }
+
+      if ((got = this->segmented->read(data, len)) < 0)
+        this->lastError = this->segmented->getError();
+      break;
+
+    case CAPTURE_FILE_QUANTIZED:
+      if (!this->quantized->seek(from)) {
+        this->lastError = this->quantized->getError();
+        return -1;
+      }
+
+      if ((got = this->quantized->read(data, len)) < 0)
+        this->lastError = this->quantized->getError();
+      break;
+
+    default:
+      got = -1;
+  }
+
+  return got;
+}
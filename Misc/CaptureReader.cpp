@@ -0,0 +1,193 @@
+//
+//    CaptureReader.cpp: Random access to the samples of a capture file
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "CaptureReader.h"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace SigDigger;
+
+CaptureReader::~CaptureReader()
+{
+  if (this->sf != nullptr)
+    sf_close(this->sf);
+
+  if (this->fd != -1)
+    ::close(this->fd);
+}
+
+bool
+CaptureReader::openSndFile(QString const &path)
+{
+  SF_INFO sfinfo;
+
+  memset(&sfinfo, 0, sizeof(SF_INFO));
+
+  if ((this->sf = sf_open(path.toStdString().c_str(), SFM_READ, &sfinfo))
+      == nullptr)
+    return false;
+
+  this->channels = sfinfo.channels;
+  this->length   = static_cast<quint64>(sfinfo.frames);
+
+  return this->channels == 1 || this->channels == 2;
+}
+
+bool
+CaptureReader::openRaw(QString const &path)
+{
+  off_t size;
+
+  switch (this->format) {
+    case SUSCAN_SOURCE_FORMAT_RAW_UNSIGNED8:
+    case SUSCAN_SOURCE_FORMAT_RAW_SIGNED8:
+      this->sampleSize = 2 * sizeof(uint8_t);
+      break;
+
+    case SUSCAN_SOURCE_FORMAT_RAW_SIGNED16:
+      this->sampleSize = 2 * sizeof(int16_t);
+      break;
+
+    default:
+      this->format     = SUSCAN_SOURCE_FORMAT_RAW_FLOAT32;
+      this->sampleSize = 2 * sizeof(float);
+  }
+
+  if ((this->fd = ::open(path.toStdString().c_str(), O_RDONLY)) == -1)
+    return false;
+
+  if ((size = lseek(this->fd, 0, SEEK_END)) == -1)
+    return false;
+
+  this->length = static_cast<quint64>(size) / this->sampleSize;
+
+  return true;
+}
+
+bool
+CaptureReader::open(QString const &path, enum suscan_source_format format)
+{
+  this->format = format;
+
+  switch (format) {
+    case SUSCAN_SOURCE_FORMAT_WAV:
+      return this->openSndFile(path);
+
+    case SUSCAN_SOURCE_FORMAT_AUTO:
+      // Same guess the source does: whatever libsndfile cannot open is
+      // taken as raw float32
+      if (this->openSndFile(path))
+        return true;
+
+      if (this->sf != nullptr) {
+        sf_close(this->sf);
+        this->sf = nullptr;
+      }
+
+      return this->openRaw(path);
+
+    default:
+      return this->openRaw(path);
+  }
+}
+
+size_t
+CaptureReader::read(quint64 pos, SUCOMPLEX *out, size_t len)
+{
+  size_t got = 0;
+  size_t i;
+
+  if (this->sf != nullptr) {
+    sf_count_t frames;
+
+    this->sfBuffer.resize(len * static_cast<size_t>(this->channels));
+
+    if (sf_seek(this->sf, static_cast<sf_count_t>(pos), SEEK_SET) == -1)
+      return 0;
+
+    frames = sf_readf_float(
+          this->sf,
+          this->sfBuffer.data(),
+          static_cast<sf_count_t>(len));
+
+    if (frames <= 0)
+      return 0;
+
+    got = static_cast<size_t>(frames);
+
+    if (this->channels == 2)
+      for (i = 0; i < got; ++i)
+        out[i] = this->sfBuffer[2 * i] + I * this->sfBuffer[2 * i + 1];
+    else
+      for (i = 0; i < got; ++i)
+        out[i] = this->sfBuffer[i];
+  } else {
+    ssize_t bytes;
+
+    this->rawBuffer.resize(len * this->sampleSize);
+
+    bytes = pread(
+          this->fd,
+          this->rawBuffer.data(),
+          len * this->sampleSize,
+          static_cast<off_t>(pos * this->sampleSize));
+
+    if (bytes <= 0)
+      return 0;
+
+    got = static_cast<size_t>(bytes) / this->sampleSize;
+
+    switch (this->format) {
+      case SUSCAN_SOURCE_FORMAT_RAW_UNSIGNED8: {
+        const uint8_t *asU8 = this->rawBuffer.data();
+        for (i = 0; i < got; ++i)
+          out[i] =
+              (asU8[2 * i] - 127.5f) / 127.5f
+              + I * ((asU8[2 * i + 1] - 127.5f) / 127.5f);
+        break;
+      }
+
+      case SUSCAN_SOURCE_FORMAT_RAW_SIGNED8: {
+        const int8_t *asS8 =
+            reinterpret_cast<const int8_t *>(this->rawBuffer.data());
+        for (i = 0; i < got; ++i)
+          out[i] = asS8[2 * i] / 128.f + I * (asS8[2 * i + 1] / 128.f);
+        break;
+      }
+
+      case SUSCAN_SOURCE_FORMAT_RAW_SIGNED16: {
+        const int16_t *asS16 =
+            reinterpret_cast<const int16_t *>(this->rawBuffer.data());
+        for (i = 0; i < got; ++i)
+          out[i] =
+              asS16[2 * i] / 32768.f + I * (asS16[2 * i + 1] / 32768.f);
+        break;
+      }
+
+      default: {
+        const float *asFloat =
+            reinterpret_cast<const float *>(this->rawBuffer.data());
+        for (i = 0; i < got; ++i)
+          out[i] = asFloat[2 * i] + I * asFloat[2 * i + 1];
+      }
+    }
+  }
+
+  return got;
+}
@@ -0,0 +1,210 @@
+//
+//    CatalogPredictor.cpp: Visibility of a whole TLE catalog
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <CatalogPredictor.h>
+#include <Suscan/Library.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace SigDigger;
+
+CatalogPredictor::CatalogPredictor(QObject *parent) : QObject(parent)
+{
+}
+
+CatalogPredictor::~CatalogPredictor()
+{
+  this->stop();
+}
+
+// Called from the owner thread only. Waits for the batches in progress.
+void
+CatalogPredictor::stop(void)
+{
+  this->slices.stop();
+
+  this->entries.clear();
+  this->found.clear();
+}
+
+quint64
+CatalogPredictor::request(
+    xyz_t const &site,
+    struct timeval const &from,
+    qreal horizon)
+{
+  auto sus = Suscan::Singleton::get_instance();
+  auto &map = sus->getSatelliteMap();
+  quint64 id;
+
+  this->stop();
+
+  // The catalog may change while we work: take our own copy of it
+  this->entries.reserve(static_cast<size_t>(map.size()));
+
+  for (auto p = map.begin(); p != map.end(); ++p) {
+    Entry entry;
+
+    entry.name  = p.key();
+    entry.orbit = p.value().getCOrbit();
+    entry.orbit.name = nullptr; // Not ours
+    this->entries.push_back(entry);
+  }
+
+  this->site  = site;
+  this->from  = from;
+  this->steps = static_cast<int>(
+        std::ceil(horizon / SIGDIGGER_CATALOG_PREDICTOR_STEP));
+
+  {
+    QMutexLocker locker(&this->mutex);
+    id = ++this->lastId;
+  }
+
+  if (this->entries.empty()) {
+    this->finish();
+    return id;
+  }
+
+  this->batches = static_cast<int>(
+        (this->entries.size() + SIGDIGGER_CATALOG_PREDICTOR_BATCH - 1)
+        / SIGDIGGER_CATALOG_PREDICTOR_BATCH);
+  this->scanned.storeRelease(0);
+
+  this->slices.submit(
+        this->batches,
+        [this] (int batch) { this->runBatch(batch); });
+
+  return id;
+}
+
+bool
+CatalogPredictor::take(quint64 &id, QVector<CatalogPass> &passes)
+{
+  QMutexLocker locker(&this->mutex);
+
+  if (!this->haveResult)
+    return false;
+
+  id     = this->resultId;
+  passes = std::move(this->result);
+
+  this->result.clear();
+  this->haveResult = false;
+
+  return true;
+}
+
+// Worker side
+bool
+CatalogPredictor::scan(Entry const &entry, CatalogPass &result) const
+{
+  sgdp4_prediction_t pred;
+  orbit_t orbit = entry.orbit;
+  xyz_t site = this->site;
+  struct timeval t, prev = this->from;
+  xyz_t azel;
+  bool found = false;
+  int i;
+
+  if (!sgdp4_prediction_init(&pred, &orbit, &site))
+    return false;
+
+  for (i = 0; i <= this->steps && !found; ++i) {
+    t = this->from;
+    t.tv_sec += static_cast<time_t>(i * SIGDIGGER_CATALOG_PREDICTOR_STEP);
+
+    if (!sgdp4_prediction_update(&pred, &t))
+      break;
+
+    sgdp4_prediction_get_azel(&pred, &azel);
+
+    if (azel.elevation > 0) {
+      // Up now: the current pass. Otherwise, it rose in the last step.
+      result.visible = i == 0;
+      found = PassPredictor::findPass(
+            &pred,
+            orbit,
+            i == 0 ? t : prev,
+            i == 0,
+            result.pass);
+    }
+
+    prev = t;
+  }
+
+  if (found) {
+    result.name = entry.name;
+    PassPredictor::computeTrack(&pred, result.pass);
+  }
+
+  sgdp4_prediction_finalize(&pred);
+
+  return found;
+}
+
+void
+CatalogPredictor::runBatch(int batch)
+{
+  QVector<CatalogPass> local;
+  int count = static_cast<int>(this->entries.size());
+  int first = batch * SIGDIGGER_CATALOG_PREDICTOR_BATCH;
+  int last = std::min(count, first + SIGDIGGER_CATALOG_PREDICTOR_BATCH);
+
+  for (int i = first; i < last && !this->slices.isCancelled(); ++i) {
+    CatalogPass pass;
+
+    if (this->scan(this->entries[static_cast<size_t>(i)], pass))
+      local.push_back(std::move(pass));
+  }
+
+  {
+    QMutexLocker locker(&this->mutex);
+    this->found += local;
+  }
+
+  // The last batch out publishes the result
+  if (this->scanned.fetchAndAddOrdered(1) == this->batches - 1
+      && !this->slices.isCancelled())
+    this->finish();
+}
+
+void
+CatalogPredictor::finish(void)
+{
+  {
+    QMutexLocker locker(&this->mutex);
+
+    std::sort(
+          this->found.begin(),
+          this->found.end(),
+          [] (CatalogPass const &a, CatalogPass const &b) {
+            if (a.visible != b.visible)
+              return a.visible;
+            return timercmp(&a.pass.aos, &b.pass.aos, <);
+          });
+
+    this->resultId   = this->lastId;
+    this->result     = std::move(this->found);
+    this->haveResult = true;
+    this->found.clear();
+  }
+
+  emit ready();
+}
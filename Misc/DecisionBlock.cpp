@@ -0,0 +1,77 @@
+//
+//    DecisionBlock.cpp: Decision variable of a block of samples
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "DecisionBlock.h"
+#include "SampleKernels.h"
+
+using namespace SigDigger;
+
+void
+DecisionBlock::setArena(ScratchArena *arena)
+{
+  this->arena = arena;
+  this->values.clear();
+  this->values.shrink_to_fit();
+  this->ptr   = nullptr;
+  this->count = 0;
+}
+
+SUFLOAT *
+DecisionBlock::prepare(unsigned int size)
+{
+  if (this->arena != nullptr) {
+    this->ptr = this->arena->take<SUFLOAT>(size).data();
+  } else {
+    this->values.resize(size);
+    this->ptr = this->values.data();
+  }
+
+  this->count = size;
+
+  return this->ptr;
+}
+
+void
+DecisionBlock::modulus(const SUCOMPLEX *data, unsigned int size)
+{
+  SampleKernels::modulus(this->prepare(size), data, size);
+}
+
+void
+DecisionBlock::argument(
+    const SUCOMPLEX *data,
+    unsigned int size,
+    bool quadrature,
+    bool fastArg)
+{
+  SampleKernels::argument(this->prepare(size), data, size, quadrature, fastArg);
+}
+
+void
+DecisionBlock::compute(
+    const SUCOMPLEX *data,
+    unsigned int size,
+    Decider::DecisionMode mode,
+    bool fastArg)
+{
+  if (mode == Decider::MODULUS)
+    this->modulus(data, size);
+  else
+    this->argument(data, size, false, fastArg);
+}
@@ -0,0 +1,180 @@
+//
+//    Misc/FFTPlanCache.cpp: Process-wide FFTW plan cache
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "FFTPlanCache.h"
+#include <QMutexLocker>
+#include <QFile>
+#include <QThread>
+#include <algorithm>
+#include <Suscan/Library.h>
+#include <suscan.h>
+
+using namespace SigDigger;
+
+FFTPlanCache *
+FFTPlanCache::instance(void)
+{
+  // Reached from the GUI, the workers and the loader thread. Plans may
+  // still run during exit, so the cache is never destroyed.
+  static FFTPlanCache *cache = new FFTPlanCache();
+
+  return cache;
+}
+
+FFTPlanCache::FFTPlanCache()
+{
+#ifdef HAVE_FFTW3_THREADS
+  if (SU_FFTW(_init_threads)())
+    this->threads = std::max(1, QThread::idealThreadCount());
+#endif // HAVE_FFTW3_THREADS
+}
+
+FFTPlanCache::~FFTPlanCache()
+{
+  for (auto p : this->plans)
+    SU_FFTW(_destroy_plan)(p.second);
+}
+
+SU_FFTW(_plan)
+FFTPlanCache::makePlan(int size, int sign, bool inPlace, bool aligned)
+{
+  SU_FFTW(_complex) *in = nullptr;
+  SU_FFTW(_complex) *out = nullptr;
+  SU_FFTW(_plan) plan = nullptr;
+  unsigned int flags = aligned ? 0 : FFTW_UNALIGNED;
+  size_t bytes = static_cast<size_t>(size) * sizeof(SU_FFTW(_complex));
+
+  // Measuring overwrites the arrays, so plan on scratch buffers
+  if ((in = static_cast<SU_FFTW(_complex) *>(SU_FFTW(_malloc)(bytes)))
+      == nullptr)
+    goto done;
+
+  if (inPlace)
+    out = in;
+  else if ((out = static_cast<SU_FFTW(_complex) *>(SU_FFTW(_malloc)(bytes)))
+      == nullptr)
+    goto done;
+
+#ifdef HAVE_FFTW3_THREADS
+  // Applies to the plans created from now on
+  SU_FFTW(_plan_with_nthreads)(
+        size >= SIGDIGGER_FFT_PLAN_CACHE_THREADS_MIN ? this->threads : 1);
+#endif // HAVE_FFTW3_THREADS
+
+  if (size <= SIGDIGGER_FFT_PLAN_CACHE_MEASURE_MAX) {
+    plan = SU_FFTW(_plan_dft_1d)(size, in, out, sign, flags | FFTW_MEASURE);
+    if (plan != nullptr)
+      this->wisdomChanged = true;
+  } else {
+    plan = SU_FFTW(_plan_dft_1d)(
+          size,
+          in,
+          out,
+          sign,
+          flags | FFTW_MEASURE | FFTW_WISDOM_ONLY);
+  }
+
+  if (plan == nullptr)
+    plan = SU_FFTW(_plan_dft_1d)(size, in, out, sign, flags | FFTW_ESTIMATE);
+
+done:
+  if (out != nullptr && out != in)
+    SU_FFTW(_free)(out);
+
+  if (in != nullptr)
+    SU_FFTW(_free)(in);
+
+  return plan;
+}
+
+SU_FFTW(_plan)
+FFTPlanCache::get(
+    int size,
+    int sign,
+    const SU_FFTW(_complex) *in,
+    const SU_FFTW(_complex) *out)
+{
+  QMutexLocker locker(&this->mutex);
+  bool aligned =
+      SU_FFTW(_alignment_of)(
+        reinterpret_cast<SUFLOAT *>(const_cast<SU_FFTW(_complex) *>(in))) == 0
+      && SU_FFTW(_alignment_of)(
+        reinterpret_cast<SUFLOAT *>(const_cast<SU_FFTW(_complex) *>(out))) == 0;
+  Key key = std::make_tuple(size, sign, in == out, aligned);
+  SU_FFTW(_plan) plan;
+
+  auto it = this->plans.find(key);
+  if (it != this->plans.end())
+    return it->second;
+
+  plan = this->makePlan(size, sign, in == out, aligned);
+  if (plan != nullptr)
+    this->plans[key] = plan;
+
+  return plan;
+}
+
+QString
+FFTPlanCache::wisdomPath(void) const
+{
+  return
+      QString(suscan_confdb_get_local_path())
+      + "/"
+      + SIGDIGGER_FFT_PLAN_CACHE_WISDOM_FILE;
+}
+
+bool
+FFTPlanCache::loadWisdom(void)
+{
+  QMutexLocker locker(&this->mutex);
+  QString path = this->wisdomPath();
+
+  if (!QFile::exists(path))
+    return false;
+
+  if (!SU_FFTW(_import_wisdom_from_filename)(path.toStdString().c_str())) {
+    SU_WARNING(
+          "Cannot import FFTW wisdom from %s\n",
+          path.toStdString().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool
+FFTPlanCache::saveWisdom(void)
+{
+  QMutexLocker locker(&this->mutex);
+  QString path = this->wisdomPath();
+
+  if (!this->wisdomChanged)
+    return true;
+
+  if (!SU_FFTW(_export_wisdom_to_filename)(path.toStdString().c_str())) {
+    SU_WARNING(
+          "Cannot export FFTW wisdom to %s\n",
+          path.toStdString().c_str());
+    return false;
+  }
+
+  this->wisdomChanged = false;
+
+  return true;
+}
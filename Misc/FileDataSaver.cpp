@@ -18,15 +18,35 @@
 //
 
 #include "FileDataSaver.h"
+#include "AsyncIOBackend.h"
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <vector>
 
 using namespace SigDigger;
 
 namespace SigDigger {
   class FileDataWriter : public GenericDataWriter {
+    // Asynchronous writes in flight, needed to complete short writes
+    struct Request {
+      const uint8_t *data;
+      size_t len;
+      off_t offset;
+    };
+
     int fd = -1;
     std::string lastError;
 
+    AsyncIOBackend *backend = nullptr;
+    std::vector<Request> requests;
+    off_t offset = 0;
+    bool direct = false;
+
+    void setDirect(bool direct);
+    bool writeAt(const uint8_t *data, size_t len, off_t offset);
+
   public:
     FileDataWriter(int fd);
 
@@ -34,6 +54,11 @@ namespace SigDigger {
     bool canWrite(void) const;
     std::string getError(void) const;
     ssize_t write(const void *data, size_t len);
+
+    unsigned int getQueueDepth(void) const override;
+    bool submit(const void *data, size_t len, uintptr_t tag) override;
+    bool reap(uintptr_t &tag, ssize_t &result) override;
+
     bool close(void);
     ~FileDataWriter();
   };
@@ -45,9 +70,132 @@ FileDataWriter::getError(void) const
   return this->lastError;
 }
 
+// O_DIRECT bypasses the page cache, but needs the buffer address, the
+// length and the file offset to be multiples of the block size. The ring
+// slots are, except for the last (partial) one of the recording.
+void
+FileDataWriter::setDirect(bool direct)
+{
+#ifdef O_DIRECT
+  int flags = fcntl(this->fd, F_GETFL);
+
+  if (flags == -1)
+    return;
+
+  flags = direct ? flags | O_DIRECT : flags & ~O_DIRECT;
+
+  // Some filesystems (e.g. tmpfs) refuse it. The writes are still async.
+  if (fcntl(this->fd, F_SETFL, flags) == 0)
+    this->direct = direct;
+#else
+  (void) direct;
+#endif // O_DIRECT
+}
+
 bool
 FileDataWriter::prepare(void)
 {
+  off_t offset;
+
+  // Pipes and other non-seekable files are written the old way
+  if (this->fd == -1 || (offset = lseek(this->fd, 0, SEEK_CUR)) == -1)
+    return true;
+
+  this->backend = AsyncIOBackend::make(
+        SIGDIGGER_FILE_DATA_SAVER_QUEUE_DEPTH);
+
+  if (this->backend != nullptr) {
+    this->offset = offset;
+
+    if (offset % SIGDIGGER_GENERIC_DATA_SAVER_SLOT_ALIGN == 0)
+      this->setDirect(true);
+  }
+
+  return true;
+}
+
+bool
+FileDataWriter::writeAt(const uint8_t *data, size_t len, off_t offset)
+{
+  ssize_t result;
+
+  while (len > 0) {
+    result = pwrite(this->fd, data, len, offset);
+
+    if (result < 1) {
+      lastError = "pwrite() failed: " + std::string(strerror(errno));
+      return false;
+    }
+
+    data   += result;
+    len    -= static_cast<size_t>(result);
+    offset += result;
+  }
+
+  return true;
+}
+
+unsigned int
+FileDataWriter::getQueueDepth(void) const
+{
+  return this->backend != nullptr ? this->backend->getDepth() : 0;
+}
+
+bool
+FileDataWriter::submit(const void *data, size_t len, uintptr_t tag)
+{
+  uintptr_t align = SIGDIGGER_GENERIC_DATA_SAVER_SLOT_ALIGN;
+
+  if (this->fd == -1 || this->backend == nullptr) {
+    this->lastError = "File is closed";
+    return false;
+  }
+
+  if (this->direct
+      && (reinterpret_cast<uintptr_t>(data) % align != 0 || len % align != 0))
+    this->setDirect(false);
+
+  if (tag >= this->requests.size())
+    this->requests.resize(tag + 1);
+
+  this->requests[tag].data   = static_cast<const uint8_t *>(data);
+  this->requests[tag].len    = len;
+  this->requests[tag].offset = this->offset;
+
+  if (!this->backend->submit(this->fd, data, len, this->offset, tag)) {
+    this->lastError = this->backend->getError();
+    return false;
+  }
+
+  this->offset += static_cast<off_t>(len);
+
+  return true;
+}
+
+bool
+FileDataWriter::reap(uintptr_t &tag, ssize_t &result)
+{
+  Request *req;
+
+  if (this->backend == nullptr || !this->backend->reap(tag, result)) {
+    if (this->backend != nullptr)
+      this->lastError = this->backend->getError();
+    return false;
+  }
+
+  req = &this->requests[tag];
+
+  // Short write (e.g. interrupted). The rest is unaligned, finish it here.
+  if (result > 0 && static_cast<size_t>(result) < req->len) {
+    size_t done = static_cast<size_t>(result);
+
+    if (this->direct)
+      this->setDirect(false);
+
+    if (this->writeAt(req->data + done, req->len - done, req->offset + result))
+      result = static_cast<ssize_t>(req->len);
+  }
+
   return true;
 }
 
@@ -70,6 +218,25 @@ FileDataWriter::write(const void *data, size_t len)
   if (this->fd == -1)
     return 0;
 
+  // Asynchronous writes are positioned, this one must be too
+  if (this->backend != nullptr) {
+    uintptr_t align = SIGDIGGER_GENERIC_DATA_SAVER_SLOT_ALIGN;
+
+    if (this->direct
+        && (reinterpret_cast<uintptr_t>(data) % align != 0
+            || len % align != 0))
+      this->setDirect(false);
+
+    result = pwrite(this->fd, data, len, this->offset);
+
+    if (result < 1)
+      lastError = "pwrite() failed: " + std::string(strerror(errno));
+    else
+      this->offset += result;
+
+    return result;
+  }
+
   result = ::write(this->fd, data, len);
 
   if (result < 1)
@@ -94,6 +261,9 @@ FileDataWriter::close(void)
 FileDataWriter::~FileDataWriter(void)
 {
   this->close();
+
+  if (this->backend != nullptr)
+    delete this->backend;
 }
 
 //////////////////////////// FileDataSaver /////////////////////////////////////
@@ -104,6 +274,8 @@ FileDataSaver::FileDataSaver(int fd, QObject *parent) :
 
 FileDataSaver::~FileDataSaver(void)
 {
+  this->finish();
+
   if (this->writer != nullptr)
     delete this->writer;
 }
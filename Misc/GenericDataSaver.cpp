@@ -19,6 +19,12 @@
 
 #include "GenericDataSaver.h"
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <Tracer.h>
+#include <ThreadPolicy.h>
+#include <HugePages.h>
 
 using namespace SigDigger;
 
@@ -39,6 +45,24 @@ TEMPLATE_INSTANCE_FOR_WRITE_NO_MATTER_WHAT(uint8_t);
 TEMPLATE_INSTANCE_FOR_WRITE_NO_MATTER_WHAT(SUFLOAT);
 TEMPLATE_INSTANCE_FOR_WRITE_NO_MATTER_WHAT(SUCOMPLEX);
 
+unsigned int
+GenericDataWriter::getQueueDepth(void) const
+{
+  return 0;
+}
+
+bool
+GenericDataWriter::submit(const void *, size_t, uintptr_t)
+{
+  return false;
+}
+
+bool
+GenericDataWriter::reap(uintptr_t &, ssize_t &)
+{
+  return false;
+}
+
 GenericDataWriter::~GenericDataWriter()
 {
   // ?
@@ -63,54 +87,149 @@ GenericDataWorker::onPrepare(void)
 }
 
 void
-GenericDataWorker::onCommit(void)
+GenericDataWorker::fail(std::string const &error)
 {
-  if (!this->writerPrepared) {
-    // Silently ignore this buffer
-    this->instance->bufferReady = true;
-  } else if (!this->failed) {
-    QMutexLocker locker(&this->instance->dataMutex);
-    struct timeval tv, otv, sub;
-    ssize_t dumped;
-    size_t allocation = this->instance->allocation;
-    std::vector<uint8_t> *thisBuf =
-        &this->instance->buffers[1 - this->instance->buffer];
-    uint8_t *buffer = thisBuf->data();
-    int remaining = static_cast<int>(this->instance->commitedSize);
+  if (!this->failed) {
+    this->failed = true;
+    emit this->error(QString::fromStdString(error));
+  }
+}
 
-    locker.unlock();
+bool
+GenericDataWorker::writeSlot(const uint8_t *data, size_t size)
+{
+  ssize_t dumped;
 
-    gettimeofday(&otv, nullptr);
+  while (size > 0) {
+    dumped = this->instance->writer->write(data, size);
 
-    while (remaining > 0) {
-      dumped = this->instance->writer->write(
-            buffer,
-            static_cast<unsigned>(remaining));
+    if (dumped < 1) {
+      this->fail(this->instance->writer->getError());
+      return false;
+    }
+
+    size -= static_cast<size_t>(dumped);
+    data += dumped;
+  }
+
+  return true;
+}
 
-      if (dumped < 1) {
-        this->failed = true;
-        emit error(QString::fromStdString(this->instance->writer->getError()));
-        return;
+void
+GenericDataWorker::drainAsync(void)
+{
+  GenericDataSaver *saver = this->instance;
+  GenericDataWriter *writer = saver->writer;
+  unsigned int depth = writer->getQueueDepth();
+  struct timeval tv, sub;
+  uintptr_t tag;
+  ssize_t result;
+
+  if (this->done.size() != saver->slotCount)
+    this->done.assign(saver->slotCount, false);
+
+  if (this->submitted == 0)
+    this->next = saver->tail;
+
+  for (;;) {
+    unsigned int pending = saver->pending.loadAcquire();
+
+    // Keep the queue full
+    while (!this->failed
+           && this->inFlight < depth
+           && this->submitted < pending) {
+      GenericDataSaver::Slot *slot = &saver->slots[this->next];
+
+      if (this->inFlight == 0)
+        gettimeofday(&this->lastRelease, nullptr);
+
+      if (!writer->submit(slot->data, slot->used, this->next)) {
+        this->fail(writer->getError());
+        break;
       }
 
-      remaining -= dumped;
-      buffer += dumped;
+      this->next = (this->next + 1) % saver->slotCount;
+      ++this->inFlight;
+      ++this->submitted;
     }
 
-    gettimeofday(&tv, nullptr);
+    if (this->inFlight == 0)
+      break;
+
+    if (writer->reap(tag, result)) {
+      if (result < static_cast<ssize_t>(saver->slots[tag].used))
+        this->fail(
+              result < 0
+              ? "Asynchronous write failed: " + std::string(strerror(
+                  static_cast<int>(-result)))
+              : "Asynchronous write was truncated");
+      this->done[tag] = true;
+      --this->inFlight;
+    } else {
+      // Nothing can be known about the rest. Give up on them.
+      this->fail(writer->getError());
+      for (unsigned int i = 0; i < this->submitted; ++i)
+        this->done[(saver->tail + i) % saver->slotCount] = true;
+      this->inFlight = 0;
+    }
+
+    // Hand completed slots back to the producer, oldest first
+    while (this->submitted > 0 && this->done[saver->tail]) {
+      GenericDataSaver::Slot *slot = &saver->slots[saver->tail];
+
+      this->done[saver->tail] = false;
+      slot->used = 0;
+      saver->tail = (saver->tail + 1) % saver->slotCount;
+      --this->submitted;
+      saver->pending.fetchAndSubRelease(1);
+
+      if (!this->failed) {
+        gettimeofday(&tv, nullptr);
+        timersub(&tv, &this->lastRelease, &sub);
+        this->lastRelease = tv;
 
-    // Requested allocation does not match buffer size.
-    if (thisBuf->size() != allocation) {
-      try {
-        thisBuf->resize(allocation);
-      } catch (std::exception &) {
-        this->failed = true;
-        emit error("Memory allocation error");
-        return;
+        emit writeFinished(static_cast<quint64>(
+              sub.tv_usec + sub.tv_sec * 1000000l));
       }
     }
+  }
+}
+
+void
+GenericDataWorker::drain(void)
+{
+  GenericDataSaver *saver = this->instance;
+
+  // Cleared before looking at pending: a commit made after this point is
+  // either seen below or posts a new commit().
+  saver->commitRequests.fetchAndStoreOrdered(0);
+
+  if (this->writerPrepared
+      && !this->failed
+      && saver->writer->getQueueDepth() > 0)
+    this->drainAsync();
+
+  // Blocking writes. With an asynchronous writer, only the slots committed
+  // while the last asynchronous write was being reaped (or the ones to be
+  // dropped after a failure) get here.
+  while (saver->pending.loadAcquire() > 0) {
+    GenericDataSaver::Slot *slot = &saver->slots[saver->tail];
+    struct timeval tv, otv, sub;
+    bool ok = true;
+
+    gettimeofday(&otv, nullptr);
+    if (this->writerPrepared && !this->failed)
+      ok = this->writeSlot(slot->data, slot->used);
+    gettimeofday(&tv, nullptr);
+
+    // Hand the slot back to the producer
+    slot->used = 0;
+    saver->tail = (saver->tail + 1) % saver->slotCount;
+    saver->pending.fetchAndSubRelease(1);
+
+    if (!ok || !this->writerPrepared || this->failed)
+      continue;
 
-    this->instance->bufferReady = true;
     timersub(&tv, &otv, &sub);
 
     emit writeFinished(static_cast<quint64>(
@@ -118,9 +237,19 @@ GenericDataWorker::onCommit(void)
   }
 }
 
+void
+GenericDataWorker::onCommit(void)
+{
+  this->drain();
+}
+
 GenericDataSaver::GenericDataSaver(
     GenericDataWriter *writer,
-    QObject *parent) : QObject(parent), workerObject(this)
+    QObject *parent) :
+  QObject(parent),
+  workerObject(this),
+  account("Recording buffers"),
+  tracker("Data recording", true)
 {
   this->writer = writer;
   this->setSampleRate(1000000);
@@ -157,6 +286,7 @@ GenericDataSaver::GenericDataSaver(
 
   // Worker object will run somewhere else
   this->workerObject.moveToThread(&this->workerThread);
+  ThreadPolicy::bind(&this->workerThread, THREAD_ROLE_IO);
   this->workerThread.start();
 
   emit prepare();
@@ -164,39 +294,150 @@ GenericDataSaver::GenericDataSaver(
 
 GenericDataSaver::~GenericDataSaver()
 {
+  this->finish();
+  this->freeRing();
+}
+
+void
+GenericDataSaver::finish(void)
+{
+  if (this->finished)
+    return;
+
+  this->finished = true;
+
   this->workerThread.quit();
   this->workerThread.wait();
 
+  // Whatever is still in the ring (including the partially filled slot)
+  // is written here. Nobody is left to receive the worker's signals.
+  this->workerObject.blockSignals(true);
+
   if (this->writer->canWrite()) {
+    if (!this->slots.empty() && this->slots[this->head].used > 0)
+      this->commitHead();
+
+    this->workerObject.drain();
+
     QMutexLocker locker(&this->dataMutex);
     this->writer->close();
   }
 }
 
+uint8_t *
+GenericDataSaver::allocSlot(size_t size)
+{
+  // Page-aligned, as direct I/O requires
+  return static_cast<uint8_t *>(HugePages::allocate(size));
+}
+
+void
+GenericDataSaver::freeSlot(uint8_t *data, size_t size)
+{
+  HugePages::release(data, size);
+}
+
 // Protected by mutex
 void
-GenericDataSaver::doCommit(void)
+GenericDataSaver::freeRing(void)
 {
-  // It is okay if the worker thread is still dumping data. This is
-  // just a way to signal this situation. If it was not ready, we
-  // do not flip buffers and keep filling the current one.
-  if (this->bufferReady) {
-    struct timeval otv = this->lastCommit;
-    struct timeval sub;
+  for (auto &slot : this->slots)
+    if (slot.data != nullptr)
+      freeSlot(slot.data, this->slotSize);
+
+  this->slots.clear();
+  this->slotSize = 0;
+  this->head = this->tail = 0;
+  this->pending.storeRelease(0);
+  this->highWater.storeRelease(0);
+  this->account.set(0);
+}
 
-    gettimeofday(&this->lastCommit, nullptr);
-    timersub(&this->lastCommit, &otv, &sub);
-    this->writeTime = static_cast<quint64>(
-              sub.tv_usec + sub.tv_sec * 1000000l);
+// Protected by mutex. Only called while no data has been written.
+void
+GenericDataSaver::allocRing(void)
+{
+  size_t align = SIGDIGGER_GENERIC_DATA_SAVER_SLOT_ALIGN;
+  size_t size = this->allocation / this->slotCount;
 
-    this->buffer = 1 - this->buffer;
-    this->commitedSize = this->ptr;
-    this->size += this->commitedSize;
-    this->ptr = 0;
-    this->bufferReady = false;
+  this->freeRing();
 
-    emit commit();
+  // Round up to whole pages
+  size = (size + align - 1) / align * align;
+  if (size == 0)
+    size = align;
+
+  this->slots.resize(this->slotCount);
+  this->slotSize = size;
+
+  for (auto &slot : this->slots) {
+    slot.data = allocSlot(size);
+    if (slot.data == nullptr) {
+      this->freeRing();
+      this->lastError = "Memory allocation error";
+      return;
+    }
   }
+
+  // Have the whole ring backed before the first samples arrive
+  for (auto &slot : this->slots)
+    HugePages::prefault(slot.data, size);
+
+  this->account.set(this->slotCount * size);
+}
+
+// Producer side. Hands head over to the worker, unless the worker still
+// owns the slot that would become the new head.
+bool
+GenericDataSaver::commitHead(void)
+{
+  struct timeval otv = this->lastCommit;
+  struct timeval sub;
+  unsigned int pending;
+
+  if (this->pending.loadAcquire() + 1 >= this->slotCount)
+    return false;
+
+  gettimeofday(&this->lastCommit, nullptr);
+  timersub(&this->lastCommit, &otv, &sub);
+  this->writeTime.storeRelease(static_cast<quint64>(
+            sub.tv_usec + sub.tv_sec * 1000000l));
+
+  this->size.fetchAndAddRelaxed(this->slots[this->head].used);
+  this->head = (this->head + 1) % this->slotCount;
+
+  // Publishes the slot contents to the worker
+  pending = this->pending.fetchAndAddRelease(1) + 1;
+
+  if (pending > this->highWater.loadAcquire())
+    this->highWater.storeRelease(pending);
+
+  return true;
+}
+
+// Producer side
+bool
+GenericDataSaver::doCommit(void)
+{
+  if (!this->commitHead())
+    return false;
+
+  // The worker is already on its way, no need to post another event
+  if (this->commitRequests.fetchAndAddOrdered(1) == 0)
+    emit commit();
+
+  return true;
+}
+
+// The rate hint is given in samples. Size the ring for the widest
+// sample type, within the ring limit.
+size_t
+GenericDataSaver::ringBytes(unsigned int rate)
+{
+  return std::min<size_t>(
+        SIGDIGGER_GENERIC_DATA_SAVER_RING_SECONDS
+        * static_cast<size_t>(rate) * sizeof(SUCOMPLEX),
+        SIGDIGGER_GENERIC_DATA_SAVER_MAX_RING_BYTES);
 }
 
 void
@@ -206,49 +447,84 @@ GenericDataSaver::setSampleRate(unsigned int rate)
     QMutexLocker locker(&this->dataMutex);
 
     this->rateHint = rate;
-    this->allocation = 3 * rate; // Up to 3 sec of data
+    this->allocation = ringBytes(rate);
 
     // No data is being written, we can reallocate here
-    if (!this->dataWritten) {
-      this->buffers[0].resize(this->allocation);
-      this->buffers[1].resize(this->allocation);
-    }
+    if (!this->dataWritten.loadAcquire())
+      this->allocRing();
+  }
+}
+
+void
+GenericDataSaver::setRingSlots(unsigned int slots)
+{
+  QMutexLocker locker(&this->dataMutex);
+
+  // One slot is always being filled, at least another one is needed
+  // to write data in the meantime.
+  if (slots < 2)
+    slots = 2;
+
+  if (this->slotCount != slots && !this->dataWritten.loadAcquire()) {
+    this->slotCount = slots;
+    this->allocRing();
   }
 }
 
 void
 GenericDataSaver::setBufferSize(unsigned int size)
 {
-  this->buffers[0].resize(size);
-  this->buffers[1].resize(size);
+  QMutexLocker locker(&this->dataMutex);
+
+  this->allocation = size;
+
+  if (!this->dataWritten.loadAcquire())
+    this->allocRing();
 }
 
 template<typename T> void
 GenericDataSaver::write(const T *data, size_t size)
 {
+  SIGDIGGER_TRACE_SCOPE("GenericDataSaver::write");
   if (this->writer->canWrite()) {
-    QMutexLocker locker(&this->dataMutex);
-    size_t totalBytes = this->buffers[this->buffer].size();
-    size_t avail = (totalBytes - this->ptr) / sizeof(T);
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    size_t left = size * sizeof(T);
+    size_t avail, chunk;
+    Slot *slot;
+
+    if (this->slots.empty())
+      return;
 
-    this->dataWritten = true;
+    this->dataWritten.storeRelease(1);
 
-    if (size > avail) {
+    // A slot left full for lack of room goes first
+    if (this->slots[this->head].used == this->slotSize)
+      this->doCommit();
+
+    // Whole writes are dropped, never parts of them. The worker can only
+    // make room in the meantime, never take it.
+    avail = this->slotSize - this->slots[this->head].used
+        + (this->slotCount - this->pending.loadAcquire() - 1) * this->slotSize;
+
+    if (left > avail) {
       emit swamped();
       return;
     }
 
-    // Copy data
-    memcpy(
-      this->buffers[this->buffer].data() + this->ptr,
-      data,
-      size * sizeof(T));
+    this->accepted.fetchAndAddRelaxed(left);
 
-    this->ptr += size * sizeof(T);
+    while (left > 0) {
+      slot  = &this->slots[this->head];
+      chunk = std::min(left, this->slotSize - slot->used);
 
-    if (this->ptr > totalBytes / 2) {
-      // Buffer starts to get filled up, issue commit request
-      this->doCommit();
+      memcpy(slot->data + slot->used, bytes, chunk);
+
+      slot->used += chunk;
+      bytes      += chunk;
+      left       -= chunk;
+
+      if (slot->used == this->slotSize && !this->doCommit())
+        break;
     }
   }
 }
@@ -261,7 +537,33 @@ template void GenericDataSaver::write<uint8_t>(const uint8_t *, size_t);
 quint64
 GenericDataSaver::getSize(void) const
 {
-  return this->size;
+  return this->size.loadAcquire();
+}
+
+quint64
+GenericDataSaver::getAcceptedSize(void) const
+{
+  return this->accepted.loadAcquire();
+}
+
+qreal
+GenericDataSaver::getBufferUsage(void)
+{
+  if (this->slotCount == 0)
+    return 0;
+
+  return static_cast<qreal>(this->pending.loadAcquire())
+      / static_cast<qreal>(this->slotCount);
+}
+
+qreal
+GenericDataSaver::getBufferHighWater(void)
+{
+  if (this->slotCount == 0)
+    return 0;
+
+  return static_cast<qreal>(this->highWater.loadAcquire())
+      / static_cast<qreal>(this->slotCount);
 }
 
 QString
@@ -286,12 +588,14 @@ GenericDataSaver::onError(QString error)
 void
 GenericDataSaver::onWriteFinished(quint64 usec)
 {
+  quint64 writeTime = this->writeTime.loadAcquire();
+
   this->commitTime = usec;
 
-  if (this->writeTime > 0) {
+  if (writeTime > 0) {
     emit dataRate(
           static_cast<qreal>(this->commitTime)
-          / static_cast<qreal>(this->writeTime));
+          / static_cast<qreal>(writeTime));
   }
 }
 
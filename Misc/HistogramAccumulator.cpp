@@ -0,0 +1,82 @@
+//
+//    HistogramAccumulator.cpp: Sliding window over a growing histogram
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "HistogramAccumulator.h"
+#include <algorithm>
+
+using namespace SigDigger;
+
+HistogramAccumulator::HistogramAccumulator(unsigned int blocks)
+{
+  this->blocks = std::max(blocks, 1u);
+}
+
+void
+HistogramAccumulator::setBlocks(unsigned int blocks)
+{
+  blocks = std::max(blocks, 1u);
+
+  if (this->blocks != blocks) {
+    this->blocks = blocks;
+    this->reset();
+  }
+}
+
+void
+HistogramAccumulator::reset(void)
+{
+  this->last.assign(this->bins, 0);
+  this->ring.assign(this->blocks * this->bins, 0);
+  this->sum.assign(this->bins, 0);
+  this->next = 0;
+}
+
+void
+HistogramAccumulator::update(std::vector<unsigned int> const &counts)
+{
+  unsigned int *block;
+  unsigned int delta;
+  unsigned int i;
+
+  if (counts.size() != this->bins) {
+    this->bins = static_cast<unsigned int>(counts.size());
+    this->reset();
+  }
+
+  // Counts going backwards: the histogram was cleared in between
+  for (i = 0; i < this->bins; ++i) {
+    delta = counts[i] - this->last[i];
+
+    if (delta >= SIGDIGGER_HISTOGRAM_ACCUMULATOR_MAX_DELTA) {
+      this->reset();
+      break;
+    }
+  }
+
+  // The block we overwrite leaves the window
+  block = this->ring.data() + this->next * this->bins;
+
+  for (i = 0; i < this->bins; ++i) {
+    delta = counts[i] - this->last[i];
+    this->sum[i] += delta - block[i];
+    block[i] = delta;
+  }
+
+  std::copy(counts.begin(), counts.end(), this->last.begin());
+  this->next = (this->next + 1) % this->blocks;
+}
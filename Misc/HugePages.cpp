@@ -0,0 +1,199 @@
+//
+//    HugePages.cpp: Huge page backing for large sample buffers
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "HugePages.h"
+#include <QRunnable>
+#include <QThreadPool>
+#include <cstdint>
+#include <cstdlib>
+
+#ifdef _WIN32
+#  include <malloc.h>
+#else
+#  include <sys/mman.h>
+#endif // _WIN32
+
+#define SIGDIGGER_HUGE_PAGES_ALIGN 4096
+
+using namespace SigDigger;
+
+namespace SigDigger {
+  class PrefaultRunner : public QRunnable
+  {
+    void *ptr;
+    size_t size;
+
+  public:
+    PrefaultRunner(void *ptr, size_t size)
+    {
+      this->ptr  = ptr;
+      this->size = size;
+    }
+
+    void
+    run(void) override
+    {
+#ifdef MADV_POPULATE_WRITE
+      // Unlike writing to the pages, this does not change their contents.
+      // If the buffer is gone by now, whatever took its place is only
+      // populated too.
+      (void) madvise(this->ptr, this->size, MADV_POPULATE_WRITE);
+#endif // MADV_POPULATE_WRITE
+    }
+  };
+}
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+static bool
+explicitHugePages(void)
+{
+  static int enabled = -1;
+
+  if (enabled == -1)
+    enabled = getenv(SIGDIGGER_HUGE_PAGES_EXPLICIT_ENV) != nullptr ? 1 : 0;
+
+  return enabled == 1;
+}
+#endif // defined(__linux__) && defined(MAP_HUGETLB)
+
+// Large mappings are rounded up to whole huge pages, whatever they end up
+// backed with: release() must be able to tell the length of a mapping
+// from its size alone.
+static size_t
+mappingSize(size_t size)
+{
+  if (size >= SIGDIGGER_HUGE_PAGES_MIN_SIZE)
+    return (size + SIGDIGGER_HUGE_PAGES_SIZE - 1)
+        / SIGDIGGER_HUGE_PAGES_SIZE * SIGDIGGER_HUGE_PAGES_SIZE;
+
+  return (size + SIGDIGGER_HUGE_PAGES_ALIGN - 1)
+      / SIGDIGGER_HUGE_PAGES_ALIGN * SIGDIGGER_HUGE_PAGES_ALIGN;
+}
+
+void *
+HugePages::allocate(size_t size)
+{
+#if defined(_WIN32)
+  return _aligned_malloc(mappingSize(size), SIGDIGGER_HUGE_PAGES_ALIGN);
+#elif defined(__linux__)
+  size_t length = mappingSize(size);
+  void *ptr = MAP_FAILED;
+
+#  ifdef MAP_HUGETLB
+  if (length >= SIGDIGGER_HUGE_PAGES_MIN_SIZE && explicitHugePages())
+    ptr = mmap(
+          nullptr,
+          length,
+          PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+          -1,
+          0);
+#  endif // MAP_HUGETLB
+
+  if (ptr == MAP_FAILED) {
+    ptr = mmap(
+          nullptr,
+          length,
+          PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS,
+          -1,
+          0);
+
+    if (ptr == MAP_FAILED)
+      return nullptr;
+
+    advise(ptr, length);
+  }
+
+  return ptr;
+#else
+  void *ptr = nullptr;
+
+  if (posix_memalign(&ptr, SIGDIGGER_HUGE_PAGES_ALIGN, mappingSize(size)) != 0)
+    return nullptr;
+
+  return ptr;
+#endif // _WIN32
+}
+
+void
+HugePages::release(void *ptr, size_t size)
+{
+  if (ptr == nullptr)
+    return;
+
+#if defined(_WIN32)
+  (void) size;
+  _aligned_free(ptr);
+#elif defined(__linux__)
+  munmap(ptr, mappingSize(size));
+#else
+  (void) size;
+  free(ptr);
+#endif // _WIN32
+}
+
+void
+HugePages::advise(void *ptr, size_t size)
+{
+#ifdef MADV_HUGEPAGE
+  uintptr_t start = reinterpret_cast<uintptr_t>(ptr);
+  uintptr_t end   = start + size;
+
+  if (size < SIGDIGGER_HUGE_PAGES_MIN_SIZE)
+    return;
+
+  // Only whole huge pages can be backed by one
+  start = (start + SIGDIGGER_HUGE_PAGES_SIZE - 1)
+      / SIGDIGGER_HUGE_PAGES_SIZE * SIGDIGGER_HUGE_PAGES_SIZE;
+  end   = end / SIGDIGGER_HUGE_PAGES_SIZE * SIGDIGGER_HUGE_PAGES_SIZE;
+
+  if (end > start)
+    (void) madvise(
+          reinterpret_cast<void *>(start),
+          end - start,
+          MADV_HUGEPAGE);
+#else
+  (void) ptr;
+  (void) size;
+#endif // MADV_HUGEPAGE
+}
+
+void
+HugePages::prefault(void *ptr, size_t size)
+{
+#ifdef MADV_POPULATE_WRITE
+  uintptr_t start = reinterpret_cast<uintptr_t>(ptr);
+  uintptr_t end   = start + size;
+
+  if (size < SIGDIGGER_HUGE_PAGES_MIN_SIZE)
+    return;
+
+  // Pages that are shared with something else are left alone
+  start = (start + SIGDIGGER_HUGE_PAGES_ALIGN - 1)
+      / SIGDIGGER_HUGE_PAGES_ALIGN * SIGDIGGER_HUGE_PAGES_ALIGN;
+  end   = end / SIGDIGGER_HUGE_PAGES_ALIGN * SIGDIGGER_HUGE_PAGES_ALIGN;
+
+  if (end > start)
+    QThreadPool::globalInstance()->start(
+          new PrefaultRunner(reinterpret_cast<void *>(start), end - start));
+#else
+  (void) ptr;
+  (void) size;
+#endif // MADV_POPULATE_WRITE
+}
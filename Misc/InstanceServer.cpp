@@ -0,0 +1,232 @@
+//
+//    InstanceServer.cpp: Single-instance handoff server
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <InstanceServer.h>
+#include <Suscan/Library.h>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QFileInfo>
+
+using namespace SigDigger;
+
+///////////////////////////////// LaunchRequest ////////////////////////////////
+QJsonObject
+LaunchRequest::toJson(void) const
+{
+  QJsonObject obj;
+
+  if (!this->file.isEmpty())
+    obj["file"] = QFileInfo(this->file).absoluteFilePath();
+
+  if (!this->profile.isEmpty())
+    obj["profile"] = this->profile;
+
+  if (this->haveFreq)
+    obj["freq"] = this->freq;
+
+  return obj;
+}
+
+LaunchRequest
+LaunchRequest::fromJson(QJsonObject const &obj)
+{
+  LaunchRequest req;
+
+  req.file     = obj.value("file").toString();
+  req.profile  = obj.value("profile").toString();
+  req.haveFreq = obj.contains("freq");
+  req.freq     = obj.value("freq").toDouble();
+
+  return req;
+}
+
+//////////////////////////////// InstanceServer ////////////////////////////////
+InstanceServer::InstanceServer(QObject *parent) : QObject(parent)
+{
+}
+
+InstanceServer::~InstanceServer()
+{
+  if (m_server != nullptr)
+    m_server->close();
+}
+
+QString
+InstanceServer::serverName(void)
+{
+  QString user = QString::fromLocal8Bit(qgetenv("USER"));
+
+  if (user.isEmpty())
+    user = QString::fromLocal8Bit(qgetenv("USERNAME"));
+
+  return QString(SIGDIGGER_INSTANCE_SERVER_NAME) + "-" + user;
+}
+
+bool
+InstanceServer::handOff(LaunchRequest const &req, QString &error)
+{
+  QLocalSocket socket;
+  QByteArray line;
+  QJsonDocument doc;
+
+  socket.connectToServer(serverName());
+
+  // Nobody listening: this launch becomes the instance
+  if (!socket.waitForConnected(SIGDIGGER_INSTANCE_HANDOFF_TIMEOUT_MS))
+    return false;
+
+  socket.write(QJsonDocument(req.toJson()).toJson(QJsonDocument::Compact));
+  socket.write("\n");
+
+  if (!socket.waitForBytesWritten(SIGDIGGER_INSTANCE_HANDOFF_TIMEOUT_MS)) {
+    error = "cannot send request: " + socket.errorString();
+    return false;
+  }
+
+  while (!socket.canReadLine())
+    if (!socket.waitForReadyRead(SIGDIGGER_INSTANCE_HANDOFF_TIMEOUT_MS)) {
+      error = "no reply from the running instance";
+      return false;
+    }
+
+  doc = QJsonDocument::fromJson(socket.readLine());
+
+  if (!doc.object().value("ok").toBool()) {
+    error = doc.object().value("error").toString("malformed reply");
+    return false;
+  }
+
+  return true;
+}
+
+bool
+InstanceServer::listen(void)
+{
+  QLocalSocket probe;
+  QString name = serverName();
+
+  // A live instance (launched with --new-instance on our side) keeps the
+  // name. Otherwise, the socket was left behind by one that crashed.
+  probe.connectToServer(name);
+  if (probe.waitForConnected(SIGDIGGER_INSTANCE_HANDOFF_TIMEOUT_MS)) {
+    probe.disconnectFromServer();
+    return false;
+  }
+
+  QLocalServer::removeServer(name);
+
+  m_server = new QLocalServer(this);
+  m_server->setSocketOptions(QLocalServer::UserAccessOption);
+
+  connect(
+        m_server,
+        SIGNAL(newConnection()),
+        this,
+        SLOT(onNewConnection()));
+
+  if (!m_server->listen(name)) {
+    SU_WARNING(
+          "Cannot listen for new launches on %s: %s\n",
+          name.toStdString().c_str(),
+          m_server->errorString().toStdString().c_str());
+    delete m_server;
+    m_server = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+void
+InstanceServer::reply(QLocalSocket *socket, bool ok, QString const &error)
+{
+  QJsonObject obj;
+
+  obj["ok"] = ok;
+  if (!ok)
+    obj["error"] = error;
+
+  socket->write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+  socket->write("\n");
+  socket->disconnectFromServer();
+}
+
+////////////////////////////////// Slots ///////////////////////////////////////
+void
+InstanceServer::onNewConnection(void)
+{
+  QLocalSocket *socket;
+
+  while ((socket = m_server->nextPendingConnection()) != nullptr) {
+    m_pending[socket] = QByteArray();
+
+    connect(
+          socket,
+          SIGNAL(readyRead()),
+          this,
+          SLOT(onReadyRead()));
+
+    connect(
+          socket,
+          SIGNAL(disconnected()),
+          this,
+          SLOT(onDisconnected()));
+  }
+}
+
+void
+InstanceServer::onReadyRead(void)
+{
+  QLocalSocket *socket = qobject_cast<QLocalSocket *>(QObject::sender());
+  QJsonParseError error;
+  QJsonDocument doc;
+  QByteArray &pending = m_pending[socket];
+  int nl;
+
+  pending.append(socket->readAll());
+
+  // One request per connection
+  if ((nl = pending.indexOf('\n')) == -1) {
+    if (pending.size() >= SIGDIGGER_INSTANCE_MAX_LINE_SIZE)
+      this->reply(socket, false, "Request too long");
+    return;
+  }
+
+  doc = QJsonDocument::fromJson(pending.left(nl), &error);
+  pending.clear();
+
+  if (!doc.isObject()) {
+    this->reply(socket, false, "Malformed request: " + error.errorString());
+    return;
+  }
+
+  // Accepted as soon as it parses: the rest happens in our own UI
+  this->reply(socket, true);
+
+  emit launchRequested(LaunchRequest::fromJson(doc.object()));
+}
+
+void
+InstanceServer::onDisconnected(void)
+{
+  QLocalSocket *socket = qobject_cast<QLocalSocket *>(QObject::sender());
+
+  m_pending.remove(socket);
+  socket->deleteLater();
+}
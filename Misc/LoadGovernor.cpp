@@ -0,0 +1,195 @@
+//
+//    LoadGovernor.cpp: Global load shedding
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "LoadGovernor.h"
+#include "RenderScheduler.h"
+#include <Suscan/Analyzer.h>
+
+using namespace SigDigger;
+
+QAtomicInteger<quint32> LoadGovernor::underruns = 0;
+QAtomicInteger<quint32> LoadGovernor::swamps = 0;
+LoadGovernor *LoadGovernor::currInstance = nullptr;
+
+LoadGovernor *
+LoadGovernor::instance(void)
+{
+  if (currInstance == nullptr)
+    currInstance = new LoadGovernor();
+
+  return currInstance;
+}
+
+LoadGovernor::LoadGovernor()
+{
+  this->pollTimer.setInterval(SIGDIGGER_LOAD_GOVERNOR_POLL_MS);
+
+  connect(
+        &this->pollTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onPoll(void)));
+
+  this->pollTimer.start();
+}
+
+void
+LoadGovernor::notifyUnderrun(void)
+{
+  underruns.fetchAndAddRelaxed(1);
+}
+
+void
+LoadGovernor::notifySwamp(void)
+{
+  swamps.fetchAndAddRelaxed(1);
+}
+
+void
+LoadGovernor::setAnalyzer(Suscan::Analyzer *analyzer)
+{
+  this->analyzer   = analyzer;
+  this->queueCount = 0;
+  this->queueTotal = 0;
+}
+
+void
+LoadGovernor::setEnabled(bool enabled)
+{
+  this->enabled = enabled;
+
+  if (!enabled)
+    this->setLevel(LOAD_LEVEL_NORMAL);
+}
+
+LoadLevel
+LoadGovernor::getLevel(void) const
+{
+  return this->level;
+}
+
+const char *
+LoadGovernor::levelDescription(LoadLevel level)
+{
+  switch (level) {
+    case LOAD_LEVEL_NORMAL:
+      return "full display rates";
+
+    case LOAD_LEVEL_REDUCED_RATE:
+      return "reduced display rate";
+
+    case LOAD_LEVEL_DECIMATED:
+      return "reduced display rate and decimated views";
+
+    case LOAD_LEVEL_SUSPENDED:
+      return "background inspectors paused";
+
+    default:
+      return "unknown";
+  }
+}
+
+//
+// Mean latency of the messages delivered since the last poll, over all
+// message classes
+//
+bool
+LoadGovernor::queueLagging(void)
+{
+  Suscan::AnalyzerStats stats;
+  quint64 count = 0, total = 0;
+  bool lagging;
+
+  if (this->analyzer.isNull())
+    return false;
+
+  stats = this->analyzer->getStats();
+
+  for (int i = 0; i < Suscan::ANALYZER_STATS_CLASS_COUNT; ++i) {
+    count += stats.classes[i].queueLatency.count;
+    total += stats.classes[i].queueLatency.total;
+  }
+
+  // Stats may have been reset in between
+  lagging = count > this->queueCount
+      && total >= this->queueTotal
+      && (total - this->queueTotal) / (count - this->queueCount)
+      > SIGDIGGER_LOAD_GOVERNOR_QUEUE_US;
+
+  this->queueCount = count;
+  this->queueTotal = total;
+
+  return lagging;
+}
+
+void
+LoadGovernor::setLevel(LoadLevel level)
+{
+  RenderScheduler *scheduler = RenderScheduler::instance();
+
+  if (level == this->level)
+    return;
+
+  this->level      = level;
+  this->overloaded = 0;
+  this->healthy    = 0;
+
+  scheduler->setFpsDivisor(level >= LOAD_LEVEL_REDUCED_RATE ? 2 : 1);
+  scheduler->setDecimated(level >= LOAD_LEVEL_DECIMATED);
+
+  emit levelChanged(level);
+}
+
+///////////////////////////////// Slots ////////////////////////////////////////
+void
+LoadGovernor::onPoll(void)
+{
+  qint64 lag = 0;
+  qint64 frame = RenderScheduler::instance()->takeWorstFrameTime();
+  bool urgent, lagging;
+
+  // The poll timer itself tells how late the event loop is
+  if (this->lastPoll.isValid())
+    lag = this->lastPoll.elapsed() - SIGDIGGER_LOAD_GOVERNOR_POLL_MS;
+  this->lastPoll.start();
+
+  urgent = underruns.fetchAndStoreRelaxed(0) > 0
+      || swamps.fetchAndStoreRelaxed(0) > 0;
+
+  lagging = this->queueLagging()
+      || urgent
+      || lag > SIGDIGGER_LOAD_GOVERNOR_LAG_MS
+      || frame > SIGDIGGER_LOAD_GOVERNOR_FRAME_US;
+
+  if (!this->enabled)
+    return;
+
+  if (lagging) {
+    this->healthy = 0;
+
+    if ((urgent || ++this->overloaded >= SIGDIGGER_LOAD_GOVERNOR_ESCALATE_POLLS)
+        && this->level < LOAD_LEVEL_COUNT - 1)
+      this->setLevel(static_cast<LoadLevel>(this->level + 1));
+  } else {
+    this->overloaded = 0;
+
+    if (this->level > LOAD_LEVEL_NORMAL
+        && ++this->healthy >= SIGDIGGER_LOAD_GOVERNOR_RELAX_POLLS)
+      this->setLevel(static_cast<LoadLevel>(this->level - 1));
+  }
+}
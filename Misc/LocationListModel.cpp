@@ -0,0 +1,169 @@
+//
+//    LocationListModel.cpp: Indexed list of known locations
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <LocationListModel.h>
+#include <Suscan/Library.h>
+
+using namespace SigDigger;
+
+LocationListModel::LocationListModel(QObject *parent)
+  : QAbstractListModel(parent)
+{
+  this->rebuild();
+}
+
+void
+LocationListModel::indexName(int id)
+{
+  QString const &key = this->keys[id];
+  int last = key.size() - SIGDIGGER_LOCATION_INDEX_GRAM;
+
+  for (int i = 0; i <= last; ++i) {
+    QVector<int> &list = this->grams[key.mid(i, SIGDIGGER_LOCATION_INDEX_GRAM)];
+
+    // Names repeating a trigram are listed once
+    if (list.isEmpty() || list.last() != id)
+      list.append(id);
+  }
+}
+
+bool
+LocationListModel::accepts(int id) const
+{
+  return this->filter.isEmpty() || this->keys[id].contains(this->filter);
+}
+
+void
+LocationListModel::rebuild(void)
+{
+  Suscan::Singleton *sus = Suscan::Singleton::get_instance();
+  int id = 0;
+
+  this->beginResetModel();
+
+  this->names.clear();
+  this->keys.clear();
+  this->grams.clear();
+  this->matches.clear();
+
+  for (auto i = sus->getFirstLocation(); i != sus->getLastLocation(); ++i) {
+    this->names.append(i.key());
+    this->keys.append(i.key().toLower());
+    this->indexName(id);
+
+    if (this->accepts(id))
+      this->matches.append(id);
+
+    ++id;
+  }
+
+  this->endResetModel();
+}
+
+void
+LocationListModel::append(QString const &name)
+{
+  int id = this->names.size();
+
+  this->names.append(name);
+  this->keys.append(name.toLower());
+  this->indexName(id);
+
+  if (this->accepts(id)) {
+    int row = this->matches.size();
+    this->beginInsertRows(QModelIndex(), row, row);
+    this->matches.append(id);
+    this->endInsertRows();
+  }
+}
+
+void
+LocationListModel::setFilter(QString const &text)
+{
+  QString filter = text.toLower();
+  QVector<int> candidates;
+  const QVector<int> *from = nullptr;
+  QVector<int> result;
+
+  if (filter == this->filter)
+    return;
+
+  // Narrowing down: whatever matches now, matched before too
+  if (!this->filter.isEmpty() && filter.contains(this->filter))
+    from = &this->matches;
+
+  if (filter.size() >= SIGDIGGER_LOCATION_INDEX_GRAM) {
+    int last = filter.size() - SIGDIGGER_LOCATION_INDEX_GRAM;
+
+    for (int i = 0; i <= last; ++i) {
+      auto it = this->grams.constFind(
+            filter.mid(i, SIGDIGGER_LOCATION_INDEX_GRAM));
+
+      if (it == this->grams.cend()) {
+        from = &candidates; // Empty: nothing can match
+        break;
+      }
+
+      if (from == nullptr || it->size() < from->size())
+        from = &*it;
+    }
+  }
+
+  this->filter = filter;
+
+  if (from != nullptr) {
+    for (auto id : *from)
+      if (this->accepts(id))
+        result.append(id);
+  } else {
+    for (int id = 0; id < this->names.size(); ++id)
+      if (this->accepts(id))
+        result.append(id);
+  }
+
+  this->beginResetModel();
+  this->matches = std::move(result);
+  this->endResetModel();
+}
+
+QString
+LocationListModel::nameAt(int row) const
+{
+  if (row < 0 || row >= this->matches.size())
+    return QString();
+
+  return this->names[this->matches[row]];
+}
+
+int
+LocationListModel::rowCount(const QModelIndex &parent) const
+{
+  if (parent.isValid())
+    return 0;
+
+  return this->matches.size();
+}
+
+QVariant
+LocationListModel::data(const QModelIndex &index, int role) const
+{
+  if (role == Qt::DisplayRole && index.isValid())
+    return this->nameAt(index.row());
+
+  return QVariant();
+}
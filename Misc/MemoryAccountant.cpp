@@ -0,0 +1,246 @@
+//
+//    MemoryAccountant.cpp: Process-wide accounting of large buffers
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "MemoryAccountant.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QMutexLocker>
+#include <QHash>
+#include <algorithm>
+
+using namespace SigDigger;
+
+/////////////////////////////// MemoryAccount /////////////////////////////////
+MemoryAccount::MemoryAccount(const char *subsystem) : bytes(0)
+{
+  this->subsystem = subsystem;
+
+  MemoryAccountant::instance()->add(this);
+}
+
+MemoryAccount::~MemoryAccount()
+{
+  MemoryAccountant::instance()->remove(this);
+}
+
+void
+MemoryAccount::setReclaimer(std::function<size_t (size_t)> const &reclaimer)
+{
+  QMutexLocker locker(&MemoryAccountant::instance()->mutex);
+
+  this->reclaimer = reclaimer;
+}
+
+////////////////////////////// MemoryAccountant ////////////////////////////////
+MemoryAccountant *MemoryAccountant::currInstance = nullptr;
+
+MemoryAccountant *
+MemoryAccountant::instance(void)
+{
+  if (currInstance == nullptr)
+    currInstance = new MemoryAccountant();
+
+  return currInstance;
+}
+
+MemoryAccountant::MemoryAccountant()
+{
+  this->pollTimer.setInterval(SIGDIGGER_MEMORY_ACCOUNTANT_POLL_MS);
+
+  connect(
+        &this->pollTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onPoll(void)));
+}
+
+void
+MemoryAccountant::add(MemoryAccount *account)
+{
+  QMutexLocker locker(&this->mutex);
+
+  this->accounts.push_back(account);
+}
+
+void
+MemoryAccountant::remove(MemoryAccount *account)
+{
+  QMutexLocker locker(&this->mutex);
+
+  this->accounts.removeOne(account);
+}
+
+void
+MemoryAccountant::setBudget(size_t bytes)
+{
+  this->budget = bytes;
+
+  if (bytes > 0) {
+    this->pollTimer.start();
+    this->enforce();
+  } else {
+    this->pollTimer.stop();
+  }
+}
+
+size_t
+MemoryAccountant::getBudget(void) const
+{
+  return this->budget;
+}
+
+size_t
+MemoryAccountant::getTotal(void)
+{
+  QMutexLocker locker(&this->mutex);
+  size_t total = 0;
+
+  for (auto p : this->accounts)
+    total += p->get();
+
+  return total;
+}
+
+quint64
+MemoryAccountant::getReclaimed(void) const
+{
+  return this->reclaimed;
+}
+
+unsigned int
+MemoryAccountant::getRefused(void) const
+{
+  return this->refused;
+}
+
+QVector<MemoryUsage>
+MemoryAccountant::getUsage(void)
+{
+  QMutexLocker locker(&this->mutex);
+  QHash<QString, int> index;
+  QVector<MemoryUsage> usage;
+
+  for (auto p : this->accounts) {
+    QString name = QString::fromUtf8(p->subsystem);
+    auto it = index.find(name);
+
+    if (it == index.end()) {
+      it = index.insert(name, usage.size());
+      usage.push_back(MemoryUsage());
+      usage.back().subsystem = name;
+    }
+
+    MemoryUsage &entry = usage[*it];
+    entry.bytes += p->get();
+    entry.accounts++;
+    entry.reclaimable = entry.reclaimable || p->reclaimer;
+  }
+
+  std::sort(
+        usage.begin(),
+        usage.end(),
+        [] (MemoryUsage const &a, MemoryUsage const &b) {
+          return a.bytes > b.bytes;
+        });
+
+  return usage;
+}
+
+//
+// Reclaimers are called without the lock held: they usually update their
+// own accounts, and may even destroy other ones. The candidates cannot go
+// away in the meantime, as they live in this very thread.
+//
+size_t
+MemoryAccountant::reclaim(size_t wanted)
+{
+  QVector<MemoryAccount *> candidates;
+  size_t freed = 0;
+
+  {
+    QMutexLocker locker(&this->mutex);
+
+    for (auto p : this->accounts)
+      if (p->reclaimer && p->get() > 0)
+        candidates.push_back(p);
+  }
+
+  std::sort(
+        candidates.begin(),
+        candidates.end(),
+        [] (MemoryAccount *a, MemoryAccount *b) {
+          return a->get() > b->get();
+        });
+
+  for (auto p : candidates) {
+    if (freed >= wanted)
+      break;
+
+    freed += p->reclaimer(wanted - freed);
+  }
+
+  this->reclaimed += freed;
+
+  return freed;
+}
+
+size_t
+MemoryAccountant::enforce(void)
+{
+  size_t total = this->getTotal();
+  size_t target;
+
+  if (this->budget == 0 || total <= this->budget)
+    return 0;
+
+  target = static_cast<size_t>(
+        this->budget * SIGDIGGER_MEMORY_ACCOUNTANT_HEADROOM);
+
+  return this->reclaim(total - target);
+}
+
+bool
+MemoryAccountant::admit(size_t bytes)
+{
+  size_t total;
+  bool guiThread;
+
+  if (this->budget == 0)
+    return true;
+
+  total = this->getTotal();
+  guiThread = QCoreApplication::instance() != nullptr
+      && QThread::currentThread() == QCoreApplication::instance()->thread();
+
+  if (total + bytes > this->budget && guiThread)
+    total -= std::min(total, this->reclaim(total + bytes - this->budget));
+
+  if (total + bytes > this->budget) {
+    ++this->refused;
+    return false;
+  }
+
+  return true;
+}
+
+/////////////////////////////////// Slots //////////////////////////////////////
+void
+MemoryAccountant::onPoll(void)
+{
+  this->enforce();
+}
@@ -0,0 +1,607 @@
+//
+//    MultiStreamSaver.cpp: Many recordings interleaved in one file
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "MultiStreamSaver.h"
+#include <MemoryAccountant.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+
+using namespace SigDigger;
+
+// Containers in use, by record directory. GUI thread only.
+static std::map<std::string, MultiStreamContainer *> containers;
+
+//////////////////////////// MultiStreamContainer //////////////////////////////
+MultiStreamContainer::MultiStreamContainer(std::string const &dir) :
+  QObject(nullptr),
+  dir(dir)
+{
+}
+
+MultiStreamContainer::~MultiStreamContainer()
+{
+  // Closes the file as well
+  if (this->saver != nullptr)
+    delete this->saver;
+}
+
+bool
+MultiStreamContainer::create(QString &error)
+{
+  MultiStreamFileHeader header;
+  uint64_t offset;
+  char stamp[32];
+  int fd;
+  time_t now = time(nullptr);
+  struct tm tm;
+
+  if (!MemoryAccountant::instance()->admit(
+        SIGDIGGER_MULTI_STREAM_RING_BYTES)) {
+    error = "Not enough memory left in the memory budget for the "
+            "container buffers";
+    return false;
+  }
+
+  localtime_r(&now, &tm);
+  strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+
+  this->path = this->dir
+      + "/multistream-"
+      + stamp
+      + SIGDIGGER_MULTI_STREAM_EXTENSION;
+
+  fd = ::open(this->path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0600);
+  if (fd == -1) {
+    error = "Failed to open container file <pre>"
+        + QString::fromStdString(this->path)
+        + "</pre>: "
+        + QString(strerror(errno));
+    return false;
+  }
+
+  this->saver = new FileDataSaver(fd, this);
+  this->saver->setBufferSize(SIGDIGGER_MULTI_STREAM_RING_BYTES);
+
+  // Swamps are told apart per channel: see MultiStreamChannel::flush()
+  connect(
+        this->saver,
+        SIGNAL(stopped(void)),
+        this,
+        SIGNAL(stopped(void)));
+
+  connect(
+        this->saver,
+        SIGNAL(dataRate(qreal)),
+        this,
+        SIGNAL(dataRate(qreal)));
+
+  connect(
+        this->saver,
+        SIGNAL(commit(void)),
+        this,
+        SIGNAL(commit(void)));
+
+  memset(&header, 0, sizeof(header));
+  memcpy(
+        header.magic,
+        SIGDIGGER_MULTI_STREAM_FILE_MAGIC,
+        sizeof(header.magic));
+  header.version = 1;
+  header.size    = sizeof(header);
+
+  if (!this->push(
+        reinterpret_cast<uint8_t *>(&header),
+        sizeof(header),
+        offset)) {
+    error = "Cannot write container header: " + this->getLastError();
+    return false;
+  }
+
+  return true;
+}
+
+// Called with the mutex held
+bool
+MultiStreamContainer::push(const uint8_t *data, size_t size, uint64_t &offset)
+{
+  quint64 before = this->saver->getAcceptedSize();
+
+  this->saver->write(data, size);
+
+  // Dropped whole. Nothing else is written meanwhile, so the file
+  // offset is the number of bytes accepted so far.
+  if (this->saver->getAcceptedSize() - before != size)
+    return false;
+
+  offset = this->offset;
+  this->offset += size;
+
+  return true;
+}
+
+bool
+MultiStreamContainer::writeBlock(
+    uint32_t stream,
+    uint8_t *block,
+    size_t length,
+    uint64_t seq)
+{
+  MultiStreamBlockHeader header;
+  QMutexLocker locker(&this->mutex);
+  uint64_t offset;
+
+  header.magic    = SIGDIGGER_MULTI_STREAM_BLOCK_MAGIC;
+  header.stream   = stream;
+  header.seq      = seq;
+  header.length   = static_cast<uint32_t>(length);
+  header.reserved = 0;
+
+  memcpy(block, &header, sizeof(header));
+
+  if (!this->push(block, sizeof(header) + length, offset))
+    return false;
+
+  this->streams[stream].blocks.push_back(offset);
+  this->streams[stream].bytes += length;
+
+  return true;
+}
+
+//
+// Stream index: uint32 stream count, then for every stream
+//
+//   uint32 id, sample size, sample rate, name length
+//   name (not terminated)
+//   uint64 bytes, block count
+//   uint64 block offsets
+//
+void
+MultiStreamContainer::writeIndex(void)
+{
+  QMutexLocker locker(&this->mutex);
+  std::vector<uint8_t> index;
+  MultiStreamFileFooter footer;
+  uint64_t offset;
+  auto put = [&index] (const void *data, size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    index.insert(index.end(), bytes, bytes + size);
+  };
+
+  uint32_t count = static_cast<uint32_t>(this->streams.size());
+  put(&count, sizeof(count));
+
+  for (auto &p : this->streams) {
+    uint32_t nameLen = static_cast<uint32_t>(p.name.size());
+    uint64_t blockCount = p.blocks.size();
+
+    put(&p.id, sizeof(p.id));
+    put(&p.sampleSize, sizeof(p.sampleSize));
+    put(&p.sampleRate, sizeof(p.sampleRate));
+    put(&nameLen, sizeof(nameLen));
+    put(p.name.data(), nameLen);
+    put(&p.bytes, sizeof(p.bytes));
+    put(&blockCount, sizeof(blockCount));
+    put(p.blocks.data(), blockCount * sizeof(uint64_t));
+  }
+
+  footer.index = this->offset;
+  memcpy(
+        footer.magic,
+        SIGDIGGER_MULTI_STREAM_INDEX_MAGIC,
+        sizeof(footer.magic));
+  put(&footer, sizeof(footer));
+
+  // Without it, readers fall back to scanning the blocks
+  if (!this->push(index.data(), index.size(), offset))
+    fprintf(
+          stderr,
+          "MultiStreamContainer: cannot write the stream index of %s\n",
+          this->path.c_str());
+}
+
+void
+MultiStreamContainer::closeStream(uint32_t)
+{
+  if (--this->openStreams > 0)
+    return;
+
+  this->writeIndex();
+
+  // Writes whatever is left in the ring and closes the file
+  delete this->saver;
+  this->saver = nullptr;
+
+  containers.erase(this->dir);
+  this->deleteLater();
+}
+
+MultiStreamChannel *
+MultiStreamContainer::open(
+    std::string const &dir,
+    std::string const &name,
+    unsigned int sampleSize,
+    unsigned int sampleRate,
+    QString &error)
+{
+  MultiStreamContainer *container;
+  MultiStreamInfo info;
+  auto it = containers.find(dir);
+
+  if (it == containers.end()) {
+    container = new MultiStreamContainer(dir);
+    if (!container->create(error)) {
+      delete container;
+      return nullptr;
+    }
+
+    containers[dir] = container;
+  } else {
+    container = it->second;
+  }
+
+  QMutexLocker locker(&container->mutex);
+
+  info.id         = static_cast<uint32_t>(container->streams.size());
+  info.name       = name;
+  info.sampleSize = sampleSize;
+  info.sampleRate = sampleRate;
+
+  container->streams.push_back(info);
+  ++container->openStreams;
+
+  return new MultiStreamChannel(container, info.id);
+}
+
+std::string
+MultiStreamContainer::getPath(void) const
+{
+  return this->path;
+}
+
+qreal
+MultiStreamContainer::getBufferUsage(void)
+{
+  return this->saver->getBufferUsage();
+}
+
+qreal
+MultiStreamContainer::getBufferHighWater(void)
+{
+  return this->saver->getBufferHighWater();
+}
+
+QString
+MultiStreamContainer::getLastError(void) const
+{
+  return this->saver->getLastError();
+}
+
+///////////////////////////// MultiStreamChannel ///////////////////////////////
+MultiStreamChannel::MultiStreamChannel(
+    MultiStreamContainer *container,
+    uint32_t id) :
+  QObject(nullptr),
+  container(container),
+  id(id)
+{
+  this->block.resize(
+        sizeof(MultiStreamBlockHeader) + SIGDIGGER_MULTI_STREAM_BLOCK_BYTES);
+
+  connect(
+        container,
+        SIGNAL(stopped(void)),
+        this,
+        SIGNAL(stopped(void)));
+
+  connect(
+        container,
+        SIGNAL(dataRate(qreal)),
+        this,
+        SIGNAL(dataRate(qreal)));
+
+  connect(
+        container,
+        SIGNAL(commit(void)),
+        this,
+        SIGNAL(commit(void)));
+}
+
+MultiStreamChannel::~MultiStreamChannel()
+{
+  // The producer is detached by now, so is the last partial block
+  if (this->used > 0)
+    (void) this->flush();
+
+  this->container->closeStream(this->id);
+}
+
+bool
+MultiStreamChannel::flush(void)
+{
+  bool ok = this->container->writeBlock(
+        this->id,
+        this->block.data(),
+        this->used,
+        this->seq);
+
+  // Like the other savers, a dropped block is a swamp of this stream
+  // only: the others may still fit in the ring.
+  if (ok) {
+    this->size.fetchAndAddRelaxed(this->used);
+    ++this->seq;
+  } else {
+    emit swamped();
+  }
+
+  this->used = 0;
+
+  return ok;
+}
+
+template<typename T> void
+MultiStreamChannel::write(const T *data, size_t size)
+{
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+  uint8_t *payload = this->block.data() + sizeof(MultiStreamBlockHeader);
+  size_t left = size * sizeof(T);
+  size_t chunk;
+
+  while (left > 0) {
+    chunk = std::min<size_t>(
+          left,
+          SIGDIGGER_MULTI_STREAM_BLOCK_BYTES - this->used);
+
+    memcpy(payload + this->used, bytes, chunk);
+
+    this->used += chunk;
+    bytes      += chunk;
+    left       -= chunk;
+
+    if (this->used == SIGDIGGER_MULTI_STREAM_BLOCK_BYTES && !this->flush())
+      break;
+  }
+}
+
+// Explicit instantiation of these ones
+template void MultiStreamChannel::write<SUCOMPLEX>(const SUCOMPLEX *, size_t);
+template void MultiStreamChannel::write<SUFLOAT>(const SUFLOAT *, size_t);
+template void MultiStreamChannel::write<uint8_t>(const uint8_t *, size_t);
+
+quint64
+MultiStreamChannel::getSize(void) const
+{
+  return this->size.loadAcquire();
+}
+
+qreal
+MultiStreamChannel::getBufferUsage(void)
+{
+  return this->container->getBufferUsage();
+}
+
+qreal
+MultiStreamChannel::getBufferHighWater(void)
+{
+  return this->container->getBufferHighWater();
+}
+
+QString
+MultiStreamChannel::getLastError(void) const
+{
+  return this->container->getLastError();
+}
+
+std::string
+MultiStreamChannel::getPath(void) const
+{
+  return this->container->getPath();
+}
+
+///////////////////////////// MultiStreamReader ////////////////////////////////
+MultiStreamReader::~MultiStreamReader()
+{
+  if (this->fp != nullptr)
+    fclose(this->fp);
+}
+
+bool
+MultiStreamReader::open(std::string const &path)
+{
+  MultiStreamFileHeader header;
+
+  this->fp = fopen(path.c_str(), "rb");
+  if (this->fp == nullptr) {
+    this->lastError = "cannot open " + path + ": " + strerror(errno);
+    return false;
+  }
+
+  fseeko(this->fp, 0, SEEK_END);
+  this->fileSize = static_cast<uint64_t>(ftello(this->fp));
+  fseeko(this->fp, 0, SEEK_SET);
+
+  if (fread(&header, sizeof(header), 1, this->fp) != 1
+      || memcmp(
+        header.magic,
+        SIGDIGGER_MULTI_STREAM_FILE_MAGIC,
+        sizeof(header.magic)) != 0) {
+    this->lastError = path + " is not a multi-stream container";
+    return false;
+  }
+
+  if (this->readIndex())
+    return true;
+
+  return this->scan();
+}
+
+bool
+MultiStreamReader::readIndex(void)
+{
+  MultiStreamFileFooter footer;
+  uint32_t count;
+  auto get = [this] (void *data, size_t size) {
+    return size == 0 || fread(data, size, 1, this->fp) == 1;
+  };
+
+  if (this->fileSize < sizeof(MultiStreamFileHeader) + sizeof(footer))
+    return false;
+
+  fseeko(
+        this->fp,
+        static_cast<off_t>(this->fileSize - sizeof(footer)),
+        SEEK_SET);
+  if (!get(&footer, sizeof(footer))
+      || memcmp(
+        footer.magic,
+        SIGDIGGER_MULTI_STREAM_INDEX_MAGIC,
+        sizeof(footer.magic)) != 0
+      || footer.index >= this->fileSize)
+    return false;
+
+  fseeko(this->fp, static_cast<off_t>(footer.index), SEEK_SET);
+  if (!get(&count, sizeof(count)))
+    return false;
+
+  this->streams.clear();
+
+  for (uint32_t i = 0; i < count; ++i) {
+    MultiStreamInfo info;
+    uint32_t nameLen;
+    uint64_t blockCount;
+
+    if (!get(&info.id, sizeof(info.id))
+        || !get(&info.sampleSize, sizeof(info.sampleSize))
+        || !get(&info.sampleRate, sizeof(info.sampleRate))
+        || !get(&nameLen, sizeof(nameLen))
+        || nameLen > footer.index)
+      return false;
+
+    info.name.resize(nameLen);
+    if (!get(&info.name[0], nameLen)
+        || !get(&info.bytes, sizeof(info.bytes))
+        || !get(&blockCount, sizeof(blockCount))
+        || blockCount > footer.index / sizeof(MultiStreamBlockHeader))
+      return false;
+
+    info.blocks.resize(blockCount);
+    if (!get(info.blocks.data(), blockCount * sizeof(uint64_t)))
+      return false;
+
+    this->streams.push_back(std::move(info));
+  }
+
+  return true;
+}
+
+// No index: walk the blocks up to the first broken one
+bool
+MultiStreamReader::scan(void)
+{
+  MultiStreamBlockHeader header;
+  uint64_t pos = sizeof(MultiStreamFileHeader);
+  std::map<uint32_t, size_t> byId;
+
+  this->streams.clear();
+
+  while (pos + sizeof(header) <= this->fileSize) {
+    fseeko(this->fp, static_cast<off_t>(pos), SEEK_SET);
+    if (fread(&header, sizeof(header), 1, this->fp) != 1
+        || header.magic != SIGDIGGER_MULTI_STREAM_BLOCK_MAGIC
+        || pos + sizeof(header) + header.length > this->fileSize)
+      break;
+
+    auto it = byId.find(header.stream);
+    if (it == byId.end()) {
+      MultiStreamInfo info;
+
+      // Only the index knows these
+      info.id   = header.stream;
+      info.name = "stream";
+
+      it = byId.emplace(header.stream, this->streams.size()).first;
+      this->streams.push_back(info);
+    }
+
+    this->streams[it->second].blocks.push_back(pos);
+    this->streams[it->second].bytes += header.length;
+
+    pos += sizeof(header) + header.length;
+  }
+
+  return true;
+}
+
+std::vector<MultiStreamInfo> const &
+MultiStreamReader::getStreams(void) const
+{
+  return this->streams;
+}
+
+bool
+MultiStreamReader::extract(size_t index, std::string const &path)
+{
+  MultiStreamInfo const &info = this->streams.at(index);
+  MultiStreamBlockHeader header;
+  std::vector<uint8_t> payload;
+  FILE *out;
+  bool ok = true;
+
+  out = fopen(path.c_str(), "wb");
+  if (out == nullptr) {
+    this->lastError = "cannot open " + path + ": " + strerror(errno);
+    return false;
+  }
+
+  for (auto offset : info.blocks) {
+    fseeko(this->fp, static_cast<off_t>(offset), SEEK_SET);
+
+    if (fread(&header, sizeof(header), 1, this->fp) != 1
+        || header.magic != SIGDIGGER_MULTI_STREAM_BLOCK_MAGIC
+        || header.stream != info.id) {
+      this->lastError = "broken block at offset " + std::to_string(offset);
+      ok = false;
+      break;
+    }
+
+    payload.resize(header.length);
+    if ((header.length > 0
+         && fread(payload.data(), header.length, 1, this->fp) != 1)
+        || fwrite(payload.data(), 1, header.length, out) != header.length) {
+      this->lastError = "I/O error while extracting to " + path;
+      ok = false;
+      break;
+    }
+  }
+
+  if (fclose(out) != 0 && ok) {
+    this->lastError = "cannot close " + path + ": " + strerror(errno);
+    ok = false;
+  }
+
+  return ok;
+}
+
+std::string
+MultiStreamReader::getLastError(void) const
+{
+  return this->lastError;
+}
@@ -137,26 +137,35 @@ MultitaskControllerModel::headerData(int s, Qt::Orientation hor, int role) const
 }
 
 ///////////////////////////////// Slots ///////////////////////////////////////
+//
+// Tasks being added or removed is the only structural change, and the only
+// one resetting the model. Progress (already coalesced by the controller)
+// only touches the status, rate and progress cells of its row.
+//
 void
 MultitaskControllerModel::onListChanged(void)
 {
+  this->beginResetModel();
   this->controller->getTaskVector(this->taskVec);
   this->controller->cleanup();
-  emit layoutChanged();
+  this->endResetModel();
 }
 
 void
 MultitaskControllerModel::onError(int index, QString message)
 {
   emit taskError(taskVec[index]->title(), message);
-  this->controller->getTaskVector(this->taskVec);
-  emit layoutChanged();
+  this->onListChanged();
 }
 
 void
 MultitaskControllerModel::onProgress(int index, qreal, QString)
 {
+  if (index < 0 || index >= this->taskVec.size())
+    return;
+
   emit dataChanged(
-        createIndex(index, 0, nullptr),
-        createIndex(index, 3, nullptr));
+        createIndex(index, 2, nullptr),
+        createIndex(index, 4, nullptr),
+        {Qt::DisplayRole});
 }
@@ -0,0 +1,476 @@
+//
+//    OccupancyAccumulator.cpp: Long-term spectrum occupancy statistics
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <OccupancyAccumulator.h>
+#include <QDir>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace SigDigger;
+
+#define OCCUPANCY_VERSION     1
+#define OCCUPANCY_CELL_WIDTH  (256 / SIGDIGGER_OCCUPANCY_SKETCH_CELLS)
+
+struct OccupancyHeader {
+  char magic[8];
+  quint32 version;
+  quint32 channels;
+};
+
+static const char *occupancyColumnNames[OCCUPANCY_COLUMN_COUNT] = {
+  "duty.col",
+  "max.col",
+  "p10.col",
+  "p50.col",
+  "p90.col"
+};
+
+static quint64
+fileSize(std::string const &path)
+{
+  struct stat sbuf;
+
+  if (stat(path.c_str(), &sbuf) == -1)
+    return 0;
+
+  return static_cast<quint64>(sbuf.st_size);
+}
+
+/////////////////////////////// OccupancyStore /////////////////////////////////
+OccupancyStore::OccupancyStore()
+{
+}
+
+OccupancyStore::~OccupancyStore()
+{
+  this->close();
+}
+
+std::string
+OccupancyStore::columnPath(int column) const
+{
+  return this->path + "/" + occupancyColumnNames[column];
+}
+
+void
+OccupancyStore::close(void)
+{
+  if (this->index != nullptr) {
+    fclose(this->index);
+    this->index = nullptr;
+  }
+
+  for (int i = 0; i < OCCUPANCY_COLUMN_COUNT; ++i) {
+    if (this->columns[i] != nullptr) {
+      fclose(this->columns[i]);
+      this->columns[i] = nullptr;
+    }
+  }
+
+  this->buckets.clear();
+}
+
+bool
+OccupancyStore::open(std::string const &dir, unsigned int channels)
+{
+  std::string indexPath = dir + "/" SIGDIGGER_OCCUPANCY_INDEX_FILE;
+  OccupancyHeader header;
+  FILE *fp;
+  size_t count;
+
+  this->close();
+  this->path = dir;
+
+  if (!QDir().mkpath(QString::fromStdString(dir))) {
+    this->lastError = "Cannot create directory " + dir;
+    return false;
+  }
+
+  if ((fp = fopen(indexPath.c_str(), "rb")) != nullptr) {
+    if (fread(&header, sizeof(OccupancyHeader), 1, fp) < 1
+        || memcmp(header.magic, SIGDIGGER_OCCUPANCY_MAGIC, 8) != 0
+        || header.version != OCCUPANCY_VERSION
+        || header.channels == 0) {
+      fclose(fp);
+      this->lastError = indexPath + " is not an occupancy index";
+      return false;
+    }
+
+    this->channels = header.channels;
+    count = (fileSize(indexPath) - sizeof(OccupancyHeader))
+        / sizeof(OccupancyBucket);
+
+    // A crash may have left columns ahead of the index, or the other
+    // way around. Only complete buckets are kept.
+    for (int i = 0; i < OCCUPANCY_COLUMN_COUNT; ++i)
+      count = std::min<size_t>(
+            count,
+            fileSize(this->columnPath(i)) / this->channels);
+
+    this->buckets.resize(count);
+    if (count > 0
+        && fread(
+          this->buckets.data(),
+          sizeof(OccupancyBucket),
+          count,
+          fp) < count) {
+      fclose(fp);
+      this->buckets.clear();
+      this->lastError = "Cannot read " + indexPath + ": " + strerror(errno);
+      return false;
+    }
+
+    fclose(fp);
+
+    if (truncate(
+          indexPath.c_str(),
+          static_cast<off_t>(
+            sizeof(OccupancyHeader) + count * sizeof(OccupancyBucket))) == -1) {
+      this->buckets.clear();
+      this->lastError = "Cannot truncate " + indexPath + ": " + strerror(errno);
+      return false;
+    }
+
+    for (int i = 0; i < OCCUPANCY_COLUMN_COUNT; ++i) {
+      std::string colPath = this->columnPath(i);
+
+      // Missing columns (an older, emptier store) are created below
+      if (fileSize(colPath) > 0
+          && truncate(
+            colPath.c_str(),
+            static_cast<off_t>(count * this->channels)) == -1) {
+        this->buckets.clear();
+        this->lastError = "Cannot truncate " + colPath + ": " + strerror(errno);
+        return false;
+      }
+    }
+  } else {
+    if ((fp = fopen(indexPath.c_str(), "wb")) == nullptr) {
+      this->lastError = "Cannot create " + indexPath + ": " + strerror(errno);
+      return false;
+    }
+
+    memcpy(header.magic, SIGDIGGER_OCCUPANCY_MAGIC, 8);
+    header.version  = OCCUPANCY_VERSION;
+    header.channels = channels;
+
+    if (fwrite(&header, sizeof(OccupancyHeader), 1, fp) < 1) {
+      fclose(fp);
+      this->lastError = "Cannot write " + indexPath + ": " + strerror(errno);
+      return false;
+    }
+
+    fclose(fp);
+    this->channels = channels;
+  }
+
+  if ((this->index = fopen(indexPath.c_str(), "ab")) == nullptr) {
+    this->lastError = "Cannot open " + indexPath + ": " + strerror(errno);
+    this->close();
+    return false;
+  }
+
+  for (int i = 0; i < OCCUPANCY_COLUMN_COUNT; ++i) {
+    std::string colPath = this->columnPath(i);
+
+    if ((this->columns[i] = fopen(colPath.c_str(), "ab")) == nullptr) {
+      this->lastError = "Cannot open " + colPath + ": " + strerror(errno);
+      this->close();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+quint64
+OccupancyStore::size(void) const
+{
+  return sizeof(OccupancyHeader)
+      + this->buckets.size()
+      * (sizeof(OccupancyBucket) + OCCUPANCY_COLUMN_COUNT * this->channels);
+}
+
+bool
+OccupancyStore::append(OccupancyBucket const &bucket, const uint8_t *data)
+{
+  if (!this->isOpen()) {
+    this->lastError = "Store is not open";
+    return false;
+  }
+
+  for (int i = 0; i < OCCUPANCY_COLUMN_COUNT; ++i) {
+    if (fwrite(data + i * this->channels, this->channels, 1, this->columns[i])
+        < 1
+        || fflush(this->columns[i]) != 0) {
+      this->lastError = "Cannot write " + this->columnPath(i) + ": "
+          + strerror(errno);
+      return false;
+    }
+  }
+
+  // The bucket exists once its index record does
+  if (fwrite(&bucket, sizeof(OccupancyBucket), 1, this->index) < 1
+      || fflush(this->index) != 0) {
+    this->lastError = std::string("Cannot write index: ") + strerror(errno);
+    return false;
+  }
+
+  this->buckets.push_back(bucket);
+
+  return true;
+}
+
+size_t
+OccupancyStore::find(qreal t) const
+{
+  return static_cast<size_t>(
+        std::partition_point(
+          this->buckets.begin(),
+          this->buckets.end(),
+          [t] (OccupancyBucket const &b) { return b.end <= t; })
+        - this->buckets.begin());
+}
+
+bool
+OccupancyStore::read(
+    OccupancyColumn column,
+    size_t first,
+    size_t count,
+    std::vector<uint8_t> &out)
+{
+  std::string colPath = this->columnPath(column);
+  FILE *fp;
+  bool ok;
+
+  if (first > this->buckets.size())
+    first = this->buckets.size();
+
+  count = std::min(count, this->buckets.size() - first);
+  out.resize(count * this->channels);
+
+  if (count == 0)
+    return true;
+
+  if ((fp = fopen(colPath.c_str(), "rb")) == nullptr) {
+    this->lastError = "Cannot open " + colPath + ": " + strerror(errno);
+    return false;
+  }
+
+  ok = fseeko(fp, static_cast<off_t>(first * this->channels), SEEK_SET) == 0
+      && fread(out.data(), this->channels, count, fp) == count;
+
+  if (!ok)
+    this->lastError = "Cannot read " + colPath + ": " + strerror(errno);
+
+  fclose(fp);
+
+  return ok;
+}
+
+//////////////////////////// OccupancyAccumulator //////////////////////////////
+OccupancyAccumulator::~OccupancyAccumulator()
+{
+  // The open bucket goes to disk too
+  this->close();
+}
+
+void
+OccupancyAccumulator::setParams(OccupancyParams const &params)
+{
+  this->params = params;
+
+  if (this->params.bucket <= 0)
+    this->params.bucket = SIGDIGGER_OCCUPANCY_DEFAULT_BUCKET;
+}
+
+OccupancyParams const &
+OccupancyAccumulator::getParams(void) const
+{
+  return this->params;
+}
+
+bool
+OccupancyAccumulator::open(std::string const &dir, unsigned int channels)
+{
+  unsigned int actual;
+
+  this->close();
+
+  channels = std::max(
+        1u,
+        std::min<unsigned int>(channels, SIGDIGGER_OCCUPANCY_MAX_CHANNELS));
+
+  if (!this->store.open(dir, channels))
+    return false;
+
+  actual = this->store.getChannels();
+
+  this->exceed.resize(actual);
+  this->maxHold.resize(actual);
+  this->sketch.resize(actual * SIGDIGGER_OCCUPANCY_SKETCH_CELLS);
+  this->record.resize(actual * OCCUPANCY_COLUMN_COUNT);
+  this->reduced.resize(actual);
+  this->reset();
+
+  return true;
+}
+
+void
+OccupancyAccumulator::close(void)
+{
+  if (this->store.isOpen()) {
+    this->flush();
+    this->store.close();
+  }
+}
+
+void
+OccupancyAccumulator::reset(void)
+{
+  this->frames = 0;
+  std::fill(this->exceed.begin(), this->exceed.end(), 0);
+  std::fill(this->maxHold.begin(), this->maxHold.end(), 0);
+  std::fill(this->sketch.begin(), this->sketch.end(), 0);
+}
+
+void
+OccupancyAccumulator::reduce(const SUFLOAT *psd, size_t size)
+{
+  size_t channels = this->reduced.size();
+
+  for (size_t c = 0; c < channels; ++c) {
+    size_t first = c * size / channels;
+    size_t last = std::max(first + 1, (c + 1) * size / channels);
+
+    this->reduced[c] = *std::max_element(psd + first, psd + last);
+  }
+}
+
+bool
+OccupancyAccumulator::flush(void)
+{
+  size_t channels = this->reduced.size();
+  OccupancyBucket bucket;
+  const qreal pcts[] = {.1, .5, .9};
+  bool ok;
+
+  if (this->frames == 0)
+    return true;
+
+  memset(&bucket, 0, sizeof(OccupancyBucket));
+  bucket.start     = this->bucketStart;
+  bucket.end       = this->lastTime;
+  bucket.fc        = this->fc;
+  bucket.fs        = this->fs;
+  bucket.frames    = this->frames;
+  bucket.threshold = this->params.threshold;
+
+  for (size_t c = 0; c < channels; ++c) {
+    const quint32 *hist = this->sketch.data()
+        + c * SIGDIGGER_OCCUPANCY_SKETCH_CELLS;
+    quint32 acc = 0;
+    int cell = 0;
+
+    this->record[OCCUPANCY_DUTY * channels + c] = static_cast<uint8_t>(
+          (255ull * this->exceed[c] + this->frames / 2) / this->frames);
+    this->record[OCCUPANCY_MAX * channels + c] = this->maxHold[c];
+
+    for (int p = 0; p < 3; ++p) {
+      quint32 target = std::max<quint32>(
+            1,
+            static_cast<quint32>(std::ceil(pcts[p] * this->frames)));
+
+      while (cell < SIGDIGGER_OCCUPANCY_SKETCH_CELLS - 1
+             && acc + hist[cell] < target)
+        acc += hist[cell++];
+
+      // Cell centers
+      this->record[(OCCUPANCY_P10 + p) * channels + c] =
+          static_cast<uint8_t>(
+            cell * OCCUPANCY_CELL_WIDTH + OCCUPANCY_CELL_WIDTH / 2);
+    }
+  }
+
+  ok = this->store.append(bucket, this->record.data());
+
+  this->reset();
+
+  return ok;
+}
+
+bool
+OccupancyAccumulator::feed(Suscan::PSDMessage const &msg)
+{
+  struct timeval tv = msg.getTimeStamp();
+  double t = static_cast<double>(tv.tv_sec) + 1e-6 * tv.tv_usec;
+  double bucketEnd;
+  size_t channels = this->reduced.size();
+  bool ok = true;
+
+  if (!this->store.isOpen() || msg.size() == 0)
+    return true;
+
+  // Buckets are aligned to multiples of their length, so stores of
+  // different days line up
+  bucketEnd = (std::floor(this->bucketStart / this->params.bucket) + 1)
+      * this->params.bucket;
+
+  if (this->frames > 0
+      && (t >= bucketEnd
+          || t < this->lastTime
+          || msg.getFrequency() != this->fc
+          || msg.getSampleRate() != this->fs))
+    ok = this->flush();
+
+  if (this->frames == 0) {
+    this->bucketStart = t;
+    this->fc = msg.getFrequency();
+    this->fs = msg.getSampleRate();
+  }
+
+  this->reduce(msg.get(), msg.size());
+
+  for (size_t c = 0; c < channels; ++c) {
+    SUFLOAT level = this->reduced[c] > 0
+        ? SU_POWER_DB(this->reduced[c])
+        : SIGDIGGER_OCCUPANCY_LEVEL_MIN;
+    int q = static_cast<int>(std::lround(
+          (level - SIGDIGGER_OCCUPANCY_LEVEL_MIN)
+          / SIGDIGGER_OCCUPANCY_LEVEL_STEP));
+    uint8_t level8 = static_cast<uint8_t>(std::max(0, std::min(q, 255)));
+
+    if (level > this->params.threshold)
+      ++this->exceed[c];
+
+    if (level8 > this->maxHold[c])
+      this->maxHold[c] = level8;
+
+    ++this->sketch[
+        c * SIGDIGGER_OCCUPANCY_SKETCH_CELLS + level8 / OCCUPANCY_CELL_WIDTH];
+  }
+
+  ++this->frames;
+  this->lastTime = t;
+
+  return ok;
+}
@@ -0,0 +1,162 @@
+//
+//    OrbitTracker.cpp: Shared orbit propagation
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <OrbitTracker.h>
+#include <sigutils/types.h>
+
+#ifndef SPEED_OF_LIGHT_KM_S
+#  define SPEED_OF_LIGHT_KM_S 299792.458
+#endif // SPEED_OF_LIGHT_KM_S
+
+using namespace SigDigger;
+
+OrbitTracker *OrbitTracker::currInstance = nullptr;
+
+OrbitTracker *
+OrbitTracker::instance(void)
+{
+  if (currInstance == nullptr)
+    currInstance = new OrbitTracker();
+
+  return currInstance;
+}
+
+OrbitTracker::OrbitTracker()
+{
+}
+
+QString
+OrbitTracker::makeKey(orbit_t const &orbit, xyz_t const &site)
+{
+  // Same satellite, same element set, same place
+  return QString::asprintf(
+        "%d/%d/%.8f/%.10g/%.10g/%.10g/%.10g/%.10g/%.10g/%.10g@%.8g,%.8g,%.8g",
+        orbit.satno,
+        orbit.ep_year,
+        orbit.ep_day,
+        orbit.rev,
+        orbit.ecc,
+        orbit.eqinc,
+        orbit.mnan,
+        orbit.argp,
+        orbit.ascn,
+        orbit.bstar,
+        site.lat,
+        site.lon,
+        site.height);
+}
+
+OrbitTracker::Handle
+OrbitTracker::subscribe(orbit_t const *orbit, xyz_t const &site)
+{
+  QString key = makeKey(*orbit, site);
+  Entry *entry;
+  auto it = this->entries.find(key);
+
+  if (it == this->entries.end()) {
+    entry = new Entry;
+    entry->key   = key;
+    entry->orbit = *orbit;
+    entry->orbit.name = nullptr; // Not needed, and not ours
+    entry->site  = site;
+
+    if (!sgdp4_prediction_init(
+          &entry->prediction,
+          &entry->orbit,
+          &entry->site)) {
+      delete entry;
+      return -1;
+    }
+
+    this->entries.insert(key, entry);
+  } else {
+    entry = it.value();
+  }
+
+  ++entry->refs;
+  this->handles.insert(++this->lastHandle, entry);
+
+  return this->lastHandle;
+}
+
+void
+OrbitTracker::unsubscribe(Handle handle)
+{
+  auto it = this->handles.find(handle);
+
+  if (it == this->handles.end())
+    return;
+
+  Entry *entry = it.value();
+  this->handles.erase(it);
+
+  if (--entry->refs == 0) {
+    this->entries.remove(entry->key);
+    sgdp4_prediction_finalize(&entry->prediction);
+    delete entry;
+  }
+}
+
+bool
+OrbitTracker::getState(Handle handle, struct timeval const &when, State &state)
+{
+  auto it = this->handles.find(handle);
+  struct timeval diff;
+
+  if (it == this->handles.end())
+    return false;
+
+  Entry *entry = it.value();
+
+  if (entry->haveState) {
+    timersub(&when, &entry->stamp, &diff);
+
+    if (diff.tv_sec == 0
+        && diff.tv_usec >= 0
+        && diff.tv_usec < SIGDIGGER_ORBIT_TRACKER_RESOLUTION_US) {
+      state = entry->state;
+      return true;
+    }
+  }
+
+  struct timeval t = when;
+
+  if (!sgdp4_prediction_update(&entry->prediction, &t))
+    return false;
+
+  sgdp4_prediction_get_azel(&entry->prediction, &entry->state.azel);
+  sgdp4_prediction_get_vel_azel(&entry->prediction, &entry->state.vazel);
+  entry->stamp     = when;
+  entry->haveState = true;
+
+  state = entry->state;
+
+  return true;
+}
+
+SUFLOAT
+OrbitTracker::getDoppler(Handle handle, struct timeval const &when, SUFREQ freq)
+{
+  State state;
+
+  if (!this->getState(handle, when, state))
+    return 0;
+
+  return static_cast<SUFLOAT>(
+        -state.vazel.distance * freq / SPEED_OF_LIGHT_KM_S);
+}
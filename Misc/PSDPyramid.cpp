@@ -0,0 +1,170 @@
+//
+//    PSDPyramid.cpp: Multi-resolution PSD decimation
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "PSDPyramid.h"
+
+using namespace SigDigger;
+
+void
+PSDPyramid::setMode(Mode mode)
+{
+  this->mode = mode;
+}
+
+PSDPyramid::Mode
+PSDPyramid::getMode(void) const
+{
+  return this->mode;
+}
+
+float *
+PSDPyramid::compute(
+    float *data,
+    unsigned int size,
+    unsigned int level,
+    unsigned int &outSize)
+{
+  float *prev = data;
+  unsigned int prevSize = size;
+
+  if (level >= SIGDIGGER_PSD_PYRAMID_MAX_LEVELS)
+    level = SIGDIGGER_PSD_PYRAMID_MAX_LEVELS - 1;
+
+  for (unsigned int l = 1; l <= level && prevSize > 1; ++l) {
+    std::vector<float> &curr = this->levels[l];
+    unsigned int half = prevSize / 2;
+    unsigned int currSize = (prevSize + 1) / 2;
+    unsigned int i;
+
+    // Only grows, PSD sizes rarely change
+    if (curr.size() < currSize)
+      curr.resize(currSize);
+
+    if (this->mode == MAXIMUM) {
+      for (i = 0; i < half; ++i)
+        curr[i] = prev[2 * i] > prev[2 * i + 1] ? prev[2 * i] : prev[2 * i + 1];
+    } else if (this->mode == MINIMUM) {
+      for (i = 0; i < half; ++i)
+        curr[i] = prev[2 * i] < prev[2 * i + 1] ? prev[2 * i] : prev[2 * i + 1];
+    } else {
+      for (i = 0; i < half; ++i)
+        curr[i] = .5f * (prev[2 * i] + prev[2 * i + 1]);
+    }
+
+    // Odd sizes: the last bin is carried as is
+    if (currSize > half)
+      curr[half] = prev[prevSize - 1];
+
+    prev = curr.data();
+    prevSize = currSize;
+  }
+
+  outSize = prevSize;
+
+  return prev;
+}
+
+unsigned int
+PSDPyramid::levelFor(unsigned int size, qreal zoom, int pixels)
+{
+  unsigned int level = 0;
+  qreal minBins = SIGDIGGER_PSD_PYRAMID_BINS_PER_PIXEL * pixels;
+  qreal visible;
+
+  if (zoom < 1)
+    zoom = 1;
+
+  if (pixels <= 0)
+    return 0;
+
+  visible = size / zoom;
+
+  while (level + 1 < SIGDIGGER_PSD_PYRAMID_MAX_LEVELS
+         && visible / 2 >= minBins) {
+    visible /= 2;
+    ++level;
+  }
+
+  return level;
+}
+
+void
+PSDPyramid::resample(
+    const float *data,
+    unsigned int size,
+    float *out,
+    unsigned int outSize,
+    Mode mode)
+{
+  qreal ratio;
+
+  if (size == 0 || outSize == 0)
+    return;
+
+  ratio = static_cast<qreal>(size) / outSize;
+
+  if (outSize < size) {
+    // Every output bin takes the input bins whose centers fall in it
+    for (unsigned int i = 0; i < outSize; ++i) {
+      unsigned int first = static_cast<unsigned int>(i * ratio);
+      unsigned int last  = static_cast<unsigned int>((i + 1) * ratio);
+      float acc = data[first];
+
+      if (last > size)
+        last = size;
+      if (last <= first)
+        last = first + 1;
+
+      for (unsigned int j = first + 1; j < last; ++j) {
+        if (mode == MAXIMUM) {
+          if (data[j] > acc)
+            acc = data[j];
+        } else if (mode == MINIMUM) {
+          if (data[j] < acc)
+            acc = data[j];
+        } else {
+          acc += data[j];
+        }
+      }
+
+      out[i] = mode == MEAN ? acc / (last - first) : acc;
+    }
+  } else {
+    // Linear interpolation between the centers of the input bins
+    for (unsigned int i = 0; i < outSize; ++i) {
+      qreal pos = (i + .5) * ratio - .5;
+      unsigned int j;
+      float frac;
+
+      if (pos <= 0) {
+        out[i] = data[0];
+        continue;
+      }
+
+      j = static_cast<unsigned int>(pos);
+      if (j + 1 >= size) {
+        out[i] = data[size - 1];
+        continue;
+      }
+
+      frac = static_cast<float>(pos - j);
+      out[i] = data[j] + frac * (data[j + 1] - data[j]);
+    }
+  }
+}
@@ -53,10 +53,20 @@ Palette::Palette(std::string const &name, qreal gradient[][3]) : Palette()
 
   this->name = name;
 
+  this->updateRgbTable();
   this->updateThumbnail();
 }
 
 
+void
+Palette::updateRgbTable(void)
+{
+  unsigned int i;
+
+  for (i = 0; i < SIGDIGGER_PALETTE_MAX_STOPS; ++i)
+    this->rgbTable[i] = this->gradient[i].rgba();
+}
+
 void
 Palette::updateThumbnail(void)
 {
@@ -68,7 +78,7 @@ Palette::updateThumbnail(void)
     index = ((SIGDIGGER_PALETTE_MAX_STOPS - 1) * i)
         / (SIGDIGGER_PALETTE_THUMB_WIDTH - 1);
 
-    rgb = this->gradient[static_cast<unsigned>(index)].rgb();
+    rgb = this->rgbTable[static_cast<unsigned>(index)];
 
     for (j = 0; j < SIGDIGGER_PALETTE_THUMB_HEIGHT; ++j)
       this->thumbnail.setPixel(i, j, rgb);
@@ -123,6 +133,7 @@ Palette::compose(void)
     for (j = prev + 1; j < SIGDIGGER_PALETTE_MAX_STOPS; ++j)
       this->gradient[j] = this->gradient[prev];
 
+  this->updateRgbTable();
   this->updateThumbnail();
 }
 
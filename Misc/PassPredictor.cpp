@@ -0,0 +1,237 @@
+//
+//    PassPredictor.cpp: Background satellite pass prediction
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <PassPredictor.h>
+#include <SigDiggerHelpers.h>
+#include <QtGlobal>
+#include <cmath>
+
+using namespace SigDigger;
+
+PassPredictor::PassPredictor(QObject *parent) : QObject(parent)
+{
+  this->thread = std::thread(&PassPredictor::run, this);
+}
+
+PassPredictor::~PassPredictor()
+{
+  {
+    std::lock_guard<std::mutex> guard(this->mutex);
+    this->exiting = true;
+  }
+
+  this->cond.notify_one();
+  this->thread.join();
+}
+
+quint64
+PassPredictor::request(
+    orbit_t const *orbit,
+    xyz_t const &site,
+    struct timeval const &from,
+    int count)
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+
+  this->pending.id    = ++this->lastId;
+  this->pending.orbit = *orbit;
+  this->pending.orbit.name = nullptr; // Not needed, and not ours
+  this->pending.site  = site;
+  this->pending.from  = from;
+  this->pending.count = count;
+  this->havePending   = true;
+
+  this->cond.notify_one();
+
+  return this->pending.id;
+}
+
+bool
+PassPredictor::take(quint64 &id, QVector<SatellitePass> &passes)
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+
+  if (!this->haveResult)
+    return false;
+
+  id     = this->resultId;
+  passes = std::move(this->result);
+
+  this->result.clear();
+  this->haveResult = false;
+
+  return true;
+}
+
+void
+PassPredictor::run(void)
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+
+  for (;;) {
+    this->cond.wait(
+          lock,
+          [this] () { return this->exiting || this->havePending; });
+
+    if (this->exiting)
+      break;
+
+    Request req = this->pending;
+    this->havePending = false;
+
+    lock.unlock();
+    QVector<SatellitePass> passes = predict(req);
+    lock.lock();
+
+    // Superseded while we were at it
+    if (this->havePending)
+      continue;
+
+    this->resultId   = req.id;
+    this->result     = std::move(passes);
+    this->haveResult = true;
+
+    lock.unlock();
+    emit ready();
+    lock.lock();
+  }
+}
+
+bool
+PassPredictor::findPass(
+    sgdp4_prediction_t *pred,
+    orbit_t const &orbit,
+    struct timeval const &origin,
+    bool first,
+    SatellitePass &pass)
+{
+  struct timeval from = origin; // sgdp4 wants non-const pointers
+  xyz_t azel;
+  SUDOUBLE searchWindow;
+  struct timeval delta, search;
+
+  if (!sgdp4_prediction_update(pred, &from))
+    return false;
+
+  sgdp4_prediction_get_azel(pred, &azel);
+
+  searchWindow = qBound(
+        SIGDIGGER_PASS_PREDICTOR_WINDOW_MIN,
+        3 * 86400.0 / orbit.rev,
+        SIGDIGGER_PASS_PREDICTOR_WINDOW_MAX);
+
+  if (first && azel.elevation > 0) {
+    // For visible satellites, the strategy is as follows:
+    //   1. From the current time, look for the next LOS event.
+    //   2. Compute the lapse between the current time and the LOS
+    //   3. Perform exponentially bigger backward time steps, of initial
+    //      length equal to that length
+    //   4. If the satellite is now invisible, assume that the next
+    //      AOS event is the corresponding to the current pass.
+    if (!sgdp4_prediction_find_los(pred, &from, searchWindow, &pass.los))
+      return false;
+
+    timersub(&pass.los, &from, &delta);
+    delta.tv_sec += 1;
+
+    do {
+      timersub(&pass.los, &delta, &search);
+      SigDiggerHelpers::timerdup(&delta);
+
+      if (!sgdp4_prediction_update(pred, &search))
+        break;
+
+      sgdp4_prediction_get_azel(pred, &azel);
+    } while (azel.elevation > 0
+             && static_cast<qreal>(delta.tv_sec) < searchWindow);
+
+    if (azel.elevation > 0)
+      return false;
+  } else {
+    // Otherwise, the next AOS and the LOS that follows it
+    search = from;
+  }
+
+  if (!sgdp4_prediction_find_aos(pred, &search, searchWindow, &pass.aos))
+    return false;
+
+  return sgdp4_prediction_find_los(pred, &search, searchWindow, &pass.los);
+}
+
+void
+PassPredictor::computeTrack(sgdp4_prediction_t *pred, SatellitePass &pass)
+{
+  struct timeval diff, t;
+  qreal delta;
+  int j;
+
+  timersub(&pass.los, &pass.aos, &diff);
+  delta = (static_cast<qreal>(diff.tv_sec)
+           + 1e-6 * static_cast<qreal>(diff.tv_usec))
+      / (SIGDIGGER_PASS_PREDICTOR_TRACK_POINTS - 1);
+
+  pass.track.resize(SIGDIGGER_PASS_PREDICTOR_TRACK_POINTS);
+
+  for (j = 0; j < SIGDIGGER_PASS_PREDICTOR_TRACK_POINTS; ++j) {
+    qreal offset = j * delta;
+
+    t.tv_sec  = pass.aos.tv_sec + static_cast<time_t>(std::floor(offset));
+    t.tv_usec = pass.aos.tv_usec
+        + static_cast<suseconds_t>(1e6 * (offset - std::floor(offset)));
+
+    if (t.tv_usec >= 1000000) {
+      t.tv_usec -= 1000000;
+      ++t.tv_sec;
+    }
+
+    sgdp4_prediction_update(pred, &t);
+    sgdp4_prediction_get_azel(pred, &pass.track[j]);
+  }
+}
+
+QVector<SatellitePass>
+PassPredictor::predict(Request const &req)
+{
+  QVector<SatellitePass> passes;
+  sgdp4_prediction_t pred;
+  orbit_t orbit = req.orbit;
+  xyz_t site = req.site;
+  struct timeval from = req.from;
+  int i;
+
+  if (!sgdp4_prediction_init(&pred, &orbit, &site))
+    return passes;
+
+  for (i = 0; i < req.count; ++i) {
+    SatellitePass pass;
+
+    if (!findPass(&pred, orbit, from, i == 0, pass))
+      break;
+
+    computeTrack(&pred, pass);
+    passes.push_back(pass);
+
+    // Look for the next one right after this one is gone
+    from = pass.los;
+    from.tv_sec += 1;
+  }
+
+  sgdp4_prediction_finalize(&pred);
+
+  return passes;
+}
@@ -0,0 +1,757 @@
+//
+//    PipelineBenchmark.cpp: Headless benchmark of the analyzer pipeline
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <PipelineBenchmark.h>
+#include <FileDataSaver.h>
+#include <SocketForwarder.h>
+#include <SuWidgetsHelpers.h>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QFile>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace SigDigger;
+
+/////////////////////////////// BenchmarkParams ///////////////////////////////
+void
+BenchmarkParams::help(const char *argv0)
+{
+  fprintf(stderr, "%s: SigDigger pipeline benchmark\n", argv0);
+  fprintf(stderr, "Usage:\n");
+  fprintf(stderr, "  %s -t Benchmark -- [options]\n\n", argv0);
+
+  fprintf(stderr, "Options:\n\n");
+  fprintf(stderr, "     -f, --file=PATH         Capture file (default: synthetic)\n");
+  fprintf(stderr, "     -F, --format=FORMAT     auto, cf32, cs16, cs8, cu8 or wav\n");
+  fprintf(stderr, "     -r, --rate=RATE         Sample rate (default: %d)\n",
+          SIGDIGGER_BENCHMARK_DEFAULT_SAMPLE_RATE);
+  fprintf(stderr, "     -T, --throttle=RATE     Throttle rate (default: none)\n");
+  fprintf(stderr, "     -d, --duration=SECONDS  Measurement time (default: %d)\n",
+          SIGDIGGER_BENCHMARK_DEFAULT_DURATION_S);
+  fprintf(stderr, "     -n, --inspectors=N      Inspectors to open (default: %d)\n",
+          SIGDIGGER_BENCHMARK_DEFAULT_INSPECTORS);
+  fprintf(stderr, "     -c, --class=CLASS       Inspector class (default: %s)\n",
+          SIGDIGGER_BENCHMARK_DEFAULT_CLASS);
+  fprintf(stderr, "     -b, --bandwidth=BW      Inspector bandwidth (default: %d)\n",
+          SIGDIGGER_BENCHMARK_DEFAULT_BANDWIDTH);
+  fprintf(stderr, "     -m, --consumers=LIST    Comma-separated list of averager,\n");
+  fprintf(stderr, "                             decision, saver and forwarder\n");
+  fprintf(stderr, "                             (default: all of them)\n");
+  fprintf(stderr, "     -p, --port=PORT         UDP port of the forwarder (default: %d)\n",
+          SIGDIGGER_BENCHMARK_DEFAULT_FORWARD_PORT);
+  fprintf(stderr, "     -o, --output=PATH       JSON report (default: stdout)\n");
+  BenchmarkHistory::help();
+  fprintf(stderr, "     -h, --help              This help\n\n");
+}
+
+bool
+BenchmarkParams::parse(int argc, char **argv)
+{
+  static struct option options[] = {
+    {"file",       required_argument, nullptr, 'f' },
+    {"format",     required_argument, nullptr, 'F' },
+    {"rate",       required_argument, nullptr, 'r' },
+    {"throttle",   required_argument, nullptr, 'T' },
+    {"duration",   required_argument, nullptr, 'd' },
+    {"inspectors", required_argument, nullptr, 'n' },
+    {"class",      required_argument, nullptr, 'c' },
+    {"bandwidth",  required_argument, nullptr, 'b' },
+    {"consumers",  required_argument, nullptr, 'm' },
+    {"port",       required_argument, nullptr, 'p' },
+    {"output",     required_argument, nullptr, 'o' },
+    {"history",    required_argument, nullptr, 'H' },
+    {"tolerance",  required_argument, nullptr, 'E' },
+    {"no-record",  no_argument,       nullptr, 'N' },
+    {"help",       no_argument,       nullptr, 'h' },
+    {nullptr,      0,                 nullptr, 0 }
+  };
+  QString format;
+  int c;
+
+  this->consumers = QStringList({"averager", "decision", "saver", "forwarder"});
+
+  optind = 0;
+
+  while ((c = getopt_long(
+              argc,
+              argv,
+              "f:F:r:T:d:n:c:b:m:p:o:H:E:Nh",
+              options,
+              nullptr)) != -1) {
+    switch (c) {
+      case 'f':
+        this->path = optarg;
+        break;
+
+      case 'F':
+        format = optarg;
+        if (format == "auto")
+          this->format = SUSCAN_SOURCE_FORMAT_AUTO;
+        else if (format == "cf32")
+          this->format = SUSCAN_SOURCE_FORMAT_RAW_FLOAT32;
+        else if (format == "cs16")
+          this->format = SUSCAN_SOURCE_FORMAT_RAW_SIGNED16;
+        else if (format == "cs8")
+          this->format = SUSCAN_SOURCE_FORMAT_RAW_SIGNED8;
+        else if (format == "cu8")
+          this->format = SUSCAN_SOURCE_FORMAT_RAW_UNSIGNED8;
+        else if (format == "wav")
+          this->format = SUSCAN_SOURCE_FORMAT_WAV;
+        else {
+          fprintf(stderr, "%s: unknown format `%s'\n", argv[0], optarg);
+          return false;
+        }
+        break;
+
+      case 'r':
+        this->sampleRate = SCAST(unsigned, strtoul(optarg, nullptr, 0));
+        break;
+
+      case 'T':
+        this->throttle = SCAST(unsigned, strtoul(optarg, nullptr, 0));
+        break;
+
+      case 'd':
+        this->duration = strtod(optarg, nullptr);
+        break;
+
+      case 'n':
+        this->inspectors = atoi(optarg);
+        break;
+
+      case 'c':
+        this->inspClass = optarg;
+        break;
+
+      case 'b':
+        this->bandwidth = strtod(optarg, nullptr);
+        break;
+
+      case 'm':
+        this->consumers = QString(optarg).split(",", QString::SkipEmptyParts);
+        break;
+
+      case 'p':
+        this->forwardPort = SCAST(uint16_t, atoi(optarg));
+        break;
+
+      case 'o':
+        this->output = optarg;
+        break;
+
+      case 'H':
+        this->history = optarg;
+        break;
+
+      case 'E':
+        if (!BenchmarkHistory("").setTolerances(optarg)) {
+          fprintf(stderr, "%s: invalid tolerance `%s'\n", argv[0], optarg);
+          return false;
+        }
+        this->tolerances = optarg;
+        break;
+
+      case 'N':
+        this->record = false;
+        break;
+
+      case 'h':
+        help(argv[0]);
+        return false;
+
+      default:
+        help(argv[0]);
+        return false;
+    }
+  }
+
+  for (auto &p : this->consumers) {
+    if (p != "averager" && p != "decision" && p != "saver" && p != "forwarder") {
+      fprintf(
+            stderr,
+            "%s: unknown consumer `%s'\n",
+            argv[0],
+            p.toStdString().c_str());
+      return false;
+    }
+  }
+
+  if (this->sampleRate == 0 || this->duration <= 0 || this->inspectors < 0) {
+    fprintf(stderr, "%s: invalid rate, duration or inspector count\n", argv[0]);
+    return false;
+  }
+
+  return true;
+}
+
+///////////////////////////// PipelineBenchmark ///////////////////////////////
+QJsonObject
+PipelineBenchmark::Stage::toJson(void) const
+{
+  QJsonObject obj;
+
+  obj["calls"]   = SCAST(qint64, this->calls);
+  obj["items"]   = SCAST(qint64, this->items);
+  obj["cpu_ms"]  = SCAST(qreal, this->cpuNs) * 1e-6;
+  obj["time_us"] = this->timeUs.toJson();
+
+  return obj;
+}
+
+PipelineBenchmark::PipelineBenchmark(
+    BenchmarkParams const &params,
+    QObject *parent) : QObject(parent)
+{
+  this->params = params;
+
+  this->history.setDirectory(params.history);
+  this->history.setTolerances(params.tolerances);
+  this->history.setRecording(params.record);
+
+  this->durationTimer.setSingleShot(true);
+
+  connect(
+        &this->durationTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onDurationExpired(void)));
+}
+
+PipelineBenchmark::~PipelineBenchmark()
+{
+  for (auto p : this->sinks) {
+    if (this->analyzer != nullptr)
+      this->analyzer->unregisterSamplesRoute(p->request.inspectorId);
+    delete p->saver;
+    delete p->forwarder;
+    delete p;
+  }
+
+  if (this->analyzer != nullptr)
+    delete this->analyzer;
+}
+
+qint64
+PipelineBenchmark::processCpuNs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+  return SCAST(qint64, ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+qint64
+PipelineBenchmark::threadCpuNs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+  return SCAST(qint64, ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+bool
+PipelineBenchmark::haveConsumer(QString const &name) const
+{
+  return this->params.consumers.contains(name);
+}
+
+//
+// One tone per inspector channel over white noise, looped by the source.
+//
+std::string
+PipelineBenchmark::makeSyntheticSource(void)
+{
+  std::vector<SUCOMPLEX> buffer(SIGDIGGER_BENCHMARK_SYNTHETIC_SAMPLES);
+  QString path;
+  QFile file;
+  int tones = std::max(this->params.inspectors, 1);
+  SUFLOAT fs = SCAST(SUFLOAT, this->params.sampleRate);
+
+  if (!this->tempDir.isValid()) {
+    this->lastError = "Cannot create temporary directory";
+    return "";
+  }
+
+  path = this->tempDir.filePath("synthetic.cf32");
+
+  for (size_t i = 0; i < buffer.size(); ++i) {
+    SUCOMPLEX x = .1f * SUCOMPLEX(
+          SCAST(SUFLOAT, rand()) / RAND_MAX - .5f,
+          SCAST(SUFLOAT, rand()) / RAND_MAX - .5f);
+
+    for (int j = 0; j < tones; ++j) {
+      SUFLOAT f = -.4f * fs + (SCAST(SUFLOAT, j) + .5f) * .8f * fs / tones;
+      x += SU_C_EXP(SUCOMPLEX(0, SCAST(SUFLOAT, 2 * M_PI) * f / fs * i))
+          / SCAST(SUFLOAT, tones);
+    }
+
+    buffer[i] = x;
+  }
+
+  file.setFileName(path);
+  if (!file.open(QIODevice::WriteOnly)
+      || file.write(
+        reinterpret_cast<const char *>(buffer.data()),
+        SCAST(qint64, buffer.size() * sizeof(SUCOMPLEX)))
+      != SCAST(qint64, buffer.size() * sizeof(SUCOMPLEX))) {
+    this->lastError = "Cannot write synthetic source: " + file.errorString();
+    return "";
+  }
+
+  this->params.format = SUSCAN_SOURCE_FORMAT_RAW_FLOAT32;
+
+  return path.toStdString();
+}
+
+bool
+PipelineBenchmark::start(void)
+{
+  Suscan::Source::Config config;
+  Suscan::AnalyzerParams analyzerParams;
+  std::string path = this->params.path.toStdString();
+
+  if (path.empty() && (path = this->makeSyntheticSource()).empty())
+    return false;
+
+  try {
+    config.setType(SUSCAN_SOURCE_TYPE_FILE);
+    config.setFormat(this->params.format);
+    config.setPath(path);
+    config.setSampleRate(this->params.sampleRate);
+    config.setFreq(0);
+    config.setLoop(true);
+
+    this->analyzer = new Suscan::Analyzer(analyzerParams, config);
+    this->analyzer->setThrottle(this->params.throttle);
+  } catch (Suscan::Exception const &e) {
+    this->lastError = "Cannot start analyzer: " + QString(e.what());
+    return false;
+  }
+
+  this->tracker = new Suscan::AnalyzerRequestTracker(this);
+  this->tracker->setAnalyzer(this->analyzer);
+
+  connect(
+        this->analyzer,
+        SIGNAL(psd_message(const Suscan::PSDMessage &)),
+        this,
+        SLOT(onPSDMessage(const Suscan::PSDMessage &)));
+
+  connect(
+        this->analyzer,
+        SIGNAL(inspector_message(const Suscan::InspectorMessage &)),
+        this->tracker,
+        SLOT(onInspectorMessage(const Suscan::InspectorMessage &)));
+
+  connect(
+        this->analyzer,
+        SIGNAL(eos(void)),
+        this,
+        SLOT(onEndOfStream(void)));
+
+  connect(
+        this->analyzer,
+        SIGNAL(read_error(void)),
+        this,
+        SLOT(onEndOfStream(void)));
+
+  connect(
+        this->analyzer,
+        SIGNAL(halted(void)),
+        this,
+        SLOT(onHalted(void)));
+
+  connect(
+        this->tracker,
+        SIGNAL(opened(Suscan::AnalyzerRequest const &)),
+        this,
+        SLOT(onOpened(Suscan::AnalyzerRequest const &)));
+
+  connect(
+        this->tracker,
+        SIGNAL(error(Suscan::AnalyzerRequest const &, const std::string &)),
+        this,
+        SLOT(onOpenError(Suscan::AnalyzerRequest const &, const std::string &)));
+
+  this->openInspectors();
+
+  return true;
+}
+
+void
+PipelineBenchmark::openInspectors(void)
+{
+  SUFREQ fs = this->params.sampleRate;
+  int n = this->params.inspectors;
+
+  if (n == 0) {
+    this->startMeasuring();
+    return;
+  }
+
+  this->tracker->beginBatch();
+
+  for (int i = 0; i < n; ++i) {
+    Suscan::Channel ch;
+
+    ch.bw    = this->params.bandwidth;
+    ch.ft    = 0;
+    ch.fc    = -.4 * fs + (i + .5) * .8 * fs / n;
+    ch.fLow  = -.5 * ch.bw;
+    ch.fHigh = +.5 * ch.bw;
+
+    this->tracker->requestOpen(this->params.inspClass, ch, QVariant(), true);
+  }
+
+  this->tracker->endBatch();
+}
+
+void
+PipelineBenchmark::makeSinks(InspectorSinks *sinks)
+{
+  unsigned int rate = SCAST(unsigned, sinks->request.equivRate);
+  int fd;
+
+  if (this->haveConsumer("saver")) {
+    if ((fd = open("/dev/null", O_WRONLY)) != -1) {
+      sinks->saver = new FileDataSaver(fd, this);
+      sinks->saver->setSampleRate(std::max(rate, 1u));
+    }
+  }
+
+  if (this->haveConsumer("forwarder")) {
+    sinks->forwarder = new SocketForwarder(
+          this->params.forwardHost.toStdString(),
+          this->params.forwardPort,
+          1400,
+          SOCKET_FORWARDER_UDP,
+          false,
+          sizeof(SUCOMPLEX),
+          SOCKET_FORWARDER_DROP_OLDEST,
+          this);
+    sinks->forwarder->setSampleRate(std::max(rate, 1u));
+  }
+}
+
+void
+PipelineBenchmark::feedSinks(
+    InspectorSinks *sinks,
+    Suscan::SamplesMessage const &msg)
+{
+  const SUCOMPLEX *data = msg.getSamples();
+  unsigned int size = SCAST(unsigned, msg.getCount());
+  qint64 t0, t1;
+
+  if (!this->measuring)
+    return;
+
+  sinks->samples += size;
+  this->samples  += size;
+
+  // Stage time is CPU time of this (the GUI) thread
+#define BENCHMARK_STAGE(name, call)                                 \
+  do {                                                              \
+    Stage &stage = this->stages[name];                              \
+    t0 = threadCpuNs();                                             \
+    call;                                                           \
+    t1 = threadCpuNs();                                             \
+    ++stage.calls;                                                  \
+    stage.items += size;                                            \
+    stage.cpuNs += SCAST(uint64_t, t1 - t0);                        \
+    stage.timeUs.feed(SCAST(uint64_t, t1 - t0) / 1000);             \
+  } while (false)
+
+  if (this->haveConsumer("decision"))
+    BENCHMARK_STAGE(
+          "decision",
+          sinks->decision.compute(data, size, Decider::MODULUS, true));
+
+  if (sinks->saver != nullptr)
+    BENCHMARK_STAGE("saver", sinks->saver->write(data, size));
+
+  if (sinks->forwarder != nullptr)
+    BENCHMARK_STAGE("forwarder", sinks->forwarder->write(data, size));
+
+#undef BENCHMARK_STAGE
+}
+
+void
+PipelineBenchmark::startMeasuring(void)
+{
+  if (this->measuring)
+    return;
+
+  this->analyzer->resetStats();
+  this->stages.clear();
+  this->psds       = 0;
+  this->samples    = 0;
+  this->sourceRate = 0;
+
+  for (auto p : this->sinks)
+    p->samples = 0;
+
+  this->cpuStartNs       = processCpuNs();
+  this->threadCpuStartNs = threadCpuNs();
+  this->clock.start();
+  this->measuring = true;
+
+  this->durationTimer.start(SCAST(int, this->params.duration * 1000));
+}
+
+void
+PipelineBenchmark::makeReport(void)
+{
+  QJsonObject throughput, cpu, stageObj, params;
+  QJsonArray consumers, inspectors;
+  qreal elapsed = this->clock.nsecsElapsed() * 1e-9;
+  qreal processCpu = (processCpuNs() - this->cpuStartNs) * 1e-9;
+  qreal threadCpu  = (threadCpuNs() - this->threadCpuStartNs) * 1e-9;
+  Suscan::AnalyzerStats stats = this->analyzer->getStats();
+
+  for (auto &p : this->params.consumers)
+    consumers.append(p);
+
+  params["source"]      = this->params.path.isEmpty()
+      ? QString("synthetic")
+      : this->params.path;
+  params["sample_rate"] = SCAST(qint64, this->params.sampleRate);
+  params["throttle"]    = SCAST(qint64, this->params.throttle);
+  params["duration_s"]  = this->params.duration;
+  params["inspectors"]  = this->params.inspectors;
+  params["class"]       = QString::fromStdString(this->params.inspClass);
+  params["bandwidth"]   = this->params.bandwidth;
+  params["consumers"]   = consumers;
+
+  for (auto p : this->sinks) {
+    QJsonObject insp;
+    insp["inspector_id"]   = SCAST(qint64, p->request.inspectorId);
+    insp["equiv_rate"]     = SCAST(qreal, p->request.equivRate);
+    insp["samples"]        = SCAST(qint64, p->samples);
+    insp["samples_per_s"]  = elapsed > 0 ? p->samples / elapsed : 0.;
+    inspectors.append(insp);
+  }
+
+  throughput["elapsed_s"]              = elapsed;
+  throughput["psds"]                   = SCAST(qint64, this->psds);
+  throughput["psds_per_s"]             = elapsed > 0 ? this->psds / elapsed : 0.;
+  throughput["inspector_samples"]      = SCAST(qint64, this->samples);
+  throughput["inspector_samples_per_s"] =
+      elapsed > 0 ? this->samples / elapsed : 0.;
+  throughput["source_samples_per_s"]   = this->sourceRate;
+
+  cpu["process_s"]      = processCpu;
+  cpu["process_load"]   = elapsed > 0 ? processCpu / elapsed : 0.;
+  cpu["gui_thread_s"]   = threadCpu;
+  cpu["other_threads_s"] = processCpu - threadCpu;
+
+  for (auto it = this->stages.cbegin(); it != this->stages.cend(); ++it)
+    stageObj[it.key()] = it.value().toJson();
+
+  this->report = QJsonObject();
+  this->report["params"]     = params;
+  this->report["throughput"] = throughput;
+  this->report["cpu"]        = cpu;
+  this->report["stages"]     = stageObj;
+  this->report["inspectors"] = inspectors;
+  this->report["failed_inspectors"] = this->failed;
+  this->report["analyzer"]   = stats.toJson();
+
+  this->compareReport();
+}
+
+void
+PipelineBenchmark::compareReport(void)
+{
+  QJsonObject throughput = this->report["throughput"].toObject();
+  QJsonObject stages = this->report["stages"].toObject();
+  QJsonObject messages =
+      this->report["analyzer"].toObject()["messages"].toObject();
+
+  this->history.setConfig(this->report["params"].toObject());
+
+  for (auto name : {
+       "psds_per_s",
+       "inspector_samples_per_s",
+       "source_samples_per_s"})
+    this->history.addMetric(
+          QString("throughput/") + name,
+          throughput[name].toDouble(),
+          BenchmarkHistory::HIGHER_IS_BETTER);
+
+  // Saver and forwarder stages are the cost of GenericDataSaver and
+  // SocketForwarder, per sample
+  for (auto it = stages.constBegin(); it != stages.constEnd(); ++it) {
+    QJsonObject stage = it.value().toObject();
+    qreal items = stage["items"].toDouble();
+
+    if (items > 0)
+      this->history.addMetric(
+            "stages/" + it.key() + "/ns_per_item",
+            stage["cpu_ms"].toDouble() * 1e6 / items,
+            BenchmarkHistory::LOWER_IS_BETTER);
+  }
+
+  // The analyzer message path, from the analyzer thread to its consumers
+  for (auto name : {"psd", "samples"}) {
+    QJsonObject latency = messages[name].toObject()["queue_latency_us"]
+        .toObject();
+
+    if (latency["count"].toDouble() > 0)
+      this->history.addMetric(
+            QString("analyzer/") + name + "/queue_latency_us_mean",
+            latency["mean"].toDouble(),
+            BenchmarkHistory::LOWER_IS_BETTER);
+  }
+
+  // Failing to record is reported, but the results are still valid
+  this->history.process();
+
+  this->report["baseline"] = this->history.toJson();
+}
+
+bool
+PipelineBenchmark::writeReport(void) const
+{
+  QByteArray json = QJsonDocument(this->report).toJson();
+
+  if (this->params.output.isEmpty()) {
+    fwrite(json.constData(), 1, SCAST(size_t, json.size()), stdout);
+    fflush(stdout);
+    return true;
+  }
+
+  QFile file(this->params.output);
+
+  if (!file.open(QIODevice::WriteOnly)
+      || file.write(json) != json.size()) {
+    fprintf(
+          stderr,
+          "Cannot write report to %s: %s\n",
+          this->params.output.toStdString().c_str(),
+          file.errorString().toStdString().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+void
+PipelineBenchmark::finish(void)
+{
+  if (!this->measuring)
+    return;
+
+  this->measuring = false;
+  this->durationTimer.stop();
+  this->makeReport();
+
+  if (this->analyzer != nullptr)
+    this->analyzer->halt();
+}
+
+/////////////////////////////////// Slots /////////////////////////////////////
+void
+PipelineBenchmark::onPSDMessage(Suscan::PSDMessage const &msg)
+{
+  qint64 t0, t1;
+
+  if (!this->measuring)
+    return;
+
+  ++this->psds;
+
+  // Running mean of the source rate measured by the analyzer
+  this->sourceRate +=
+      (msg.getMeasuredSampleRate() - this->sourceRate) / SCAST(qreal, this->psds);
+
+  if (this->haveConsumer("averager")) {
+    Stage &stage = this->stages["averager"];
+
+    t0 = threadCpuNs();
+    this->averager.feed(msg);
+    t1 = threadCpuNs();
+
+    ++stage.calls;
+    stage.items += msg.size();
+    stage.cpuNs += SCAST(uint64_t, t1 - t0);
+    stage.timeUs.feed(SCAST(uint64_t, t1 - t0) / 1000);
+  }
+}
+
+void
+PipelineBenchmark::onOpened(Suscan::AnalyzerRequest const &request)
+{
+  InspectorSinks *sinks = new InspectorSinks();
+
+  sinks->request = request;
+  this->makeSinks(sinks);
+  this->sinks.append(sinks);
+
+  this->analyzer->registerSamplesRoute(
+        request.inspectorId,
+        this,
+        [this, sinks] (Suscan::SamplesMessage const &msg) {
+          this->feedSinks(sinks, msg);
+        });
+
+  if (this->sinks.size() + this->failed >= this->params.inspectors)
+    this->startMeasuring();
+}
+
+void
+PipelineBenchmark::onOpenError(
+    Suscan::AnalyzerRequest const &,
+    std::string const &error)
+{
+  fprintf(stderr, "Benchmark: cannot open inspector: %s\n", error.c_str());
+
+  ++this->failed;
+
+  if (this->sinks.size() + this->failed >= this->params.inspectors)
+    this->startMeasuring();
+}
+
+void
+PipelineBenchmark::onDurationExpired(void)
+{
+  this->finish();
+}
+
+void
+PipelineBenchmark::onEndOfStream(void)
+{
+  if (!this->measuring)
+    this->lastError = "Source stopped before the measurement could start";
+
+  this->finish();
+
+  emit finished();
+}
+
+void
+PipelineBenchmark::onHalted(void)
+{
+  emit finished();
+}
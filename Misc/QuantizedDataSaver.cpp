@@ -0,0 +1,235 @@
+//
+//    QuantizedDataSaver.cpp: Saver of quantized IQ recordings
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "QuantizedDataSaver.h"
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/time.h>
+
+using namespace SigDigger;
+
+namespace SigDigger {
+  class QuantizedDataWriter : public GenericDataWriter {
+    int fd = -1;
+    std::string lastError;
+    QuantizedIQEncoder encoder;
+    QuantizedIQFileHeader header;
+    bool headerWritten = false;
+
+    // Samples of the block being built (as bytes: writes need not end
+    // at sample boundaries) and the encoded output
+    std::vector<uint8_t> stage;
+    std::vector<uint8_t> encoded;
+
+    bool writeAll(const uint8_t *data, size_t len);
+    bool flushBlock(void);
+
+  public:
+    QuantizedDataWriter(
+        int fd,
+        unsigned int rate,
+        SUFREQ freq,
+        QuantizedIQFormat format,
+        QuantizedIQCompression compression);
+
+    bool prepare(void) override;
+    bool canWrite(void) const override;
+    std::string getError(void) const override;
+    ssize_t write(const void *data, size_t len) override;
+    bool close(void) override;
+    ~QuantizedDataWriter() override;
+  };
+}
+
+QuantizedDataWriter::QuantizedDataWriter(
+    int fd,
+    unsigned int rate,
+    SUFREQ freq,
+    QuantizedIQFormat format,
+    QuantizedIQCompression compression) :
+  encoder(format, compression)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, nullptr);
+
+  this->fd = fd;
+
+  memset(&this->header, 0, sizeof(QuantizedIQFileHeader));
+  memcpy(this->header.magic, SIGDIGGER_QUANTIZED_IQ_MAGIC, 4);
+  this->header.version      = SIGDIGGER_QUANTIZED_IQ_VERSION;
+  this->header.format       = static_cast<uint8_t>(format);
+  this->header.compression  = static_cast<uint8_t>(
+        QuantizedIQEncoder::isCompressionSupported(compression)
+        ? compression
+        : QUANTIZED_IQ_UNCOMPRESSED);
+  this->header.rate         = rate;
+  this->header.blockSamples = SIGDIGGER_QUANTIZED_IQ_BLOCK_SAMPLES;
+  this->header.freq         = freq;
+  this->header.startTime    = tv.tv_sec + 1e-6 * tv.tv_usec;
+
+  this->stage.reserve(SIGDIGGER_QUANTIZED_IQ_BLOCK_SAMPLES * sizeof(SUCOMPLEX));
+}
+
+bool
+QuantizedDataWriter::writeAll(const uint8_t *data, size_t len)
+{
+  ssize_t result;
+
+  while (len > 0) {
+    if ((result = ::write(this->fd, data, len)) < 1) {
+      this->lastError = "write() failed: " + std::string(strerror(errno));
+      return false;
+    }
+
+    data += result;
+    len  -= static_cast<size_t>(result);
+  }
+
+  return true;
+}
+
+bool
+QuantizedDataWriter::flushBlock(void)
+{
+  size_t samples = this->stage.size() / sizeof(SUCOMPLEX);
+  size_t bytes = samples * sizeof(SUCOMPLEX);
+
+  if (samples == 0)
+    return true;
+
+  this->encoded.clear();
+
+  if (!this->encoder.encode(
+        reinterpret_cast<const SUCOMPLEX *>(this->stage.data()),
+        samples,
+        this->encoded)) {
+    this->lastError = this->encoder.getError();
+    return false;
+  }
+
+  // Keep the trailing partial sample, if any
+  this->stage.erase(this->stage.begin(), this->stage.begin() + bytes);
+
+  return this->writeAll(this->encoded.data(), this->encoded.size());
+}
+
+bool
+QuantizedDataWriter::prepare(void)
+{
+  if (this->fd == -1)
+    return false;
+
+  if (!this->headerWritten) {
+    this->headerWritten = true;
+    return this->writeAll(
+          reinterpret_cast<const uint8_t *>(&this->header),
+          sizeof(QuantizedIQFileHeader));
+  }
+
+  return true;
+}
+
+bool
+QuantizedDataWriter::canWrite(void) const
+{
+  return this->fd != -1;
+}
+
+std::string
+QuantizedDataWriter::getError(void) const
+{
+  return this->lastError;
+}
+
+ssize_t
+QuantizedDataWriter::write(const void *data, size_t len)
+{
+  size_t blockBytes = SIGDIGGER_QUANTIZED_IQ_BLOCK_SAMPLES * sizeof(SUCOMPLEX);
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  size_t left = len;
+  size_t chunk;
+
+  if (this->fd == -1)
+    return 0;
+
+  while (left > 0) {
+    chunk = std::min(left, blockBytes - this->stage.size());
+    this->stage.insert(this->stage.end(), bytes, bytes + chunk);
+
+    bytes += chunk;
+    left  -= chunk;
+
+    if (this->stage.size() == blockBytes && !this->flushBlock())
+      return -1;
+  }
+
+  return static_cast<ssize_t>(len);
+}
+
+bool
+QuantizedDataWriter::close(void)
+{
+  bool ok = true;
+
+  if (this->fd != -1) {
+    // Last (short) block
+    if (this->headerWritten)
+      ok = this->flushBlock();
+
+    ok = ::close(this->fd) == 0 && ok;
+    this->fd = -1;
+  }
+
+  return ok;
+}
+
+QuantizedDataWriter::~QuantizedDataWriter()
+{
+  this->close();
+}
+
+//////////////////////////// QuantizedDataSaver ////////////////////////////////
+QuantizedDataSaver::QuantizedDataSaver(
+    int fd,
+    unsigned int rate,
+    SUFREQ freq,
+    QuantizedIQFormat format,
+    QuantizedIQCompression compression,
+    QObject *parent) :
+  GenericDataSaver(
+    this->writer = new QuantizedDataWriter(
+      fd,
+      rate,
+      freq,
+      format,
+      compression),
+    parent)
+{
+  this->setSampleRate(rate);
+  this->tracker.set("Quantized IQ recording", true);
+}
+
+QuantizedDataSaver::~QuantizedDataSaver()
+{
+  this->finish();
+
+  if (this->writer != nullptr)
+    delete this->writer;
+}
@@ -0,0 +1,372 @@
+//
+//    QuantizedIQ.cpp: Quantized, optionally compressed IQ recordings
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "QuantizedIQ.h"
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+using namespace SigDigger;
+
+/////////////////////////////// QuantizedIQEncoder //////////////////////////////
+QuantizedIQEncoder::QuantizedIQEncoder(
+    QuantizedIQFormat format,
+    QuantizedIQCompression compression)
+{
+  this->format = format;
+  this->compression = compression;
+
+#ifdef HAVE_ZSTD
+  if (compression == QUANTIZED_IQ_ZSTD) {
+    if ((this->zstd = ZSTD_createCCtx()) == nullptr)
+      this->compression = QUANTIZED_IQ_UNCOMPRESSED;
+  }
+#else
+  this->compression = QUANTIZED_IQ_UNCOMPRESSED;
+#endif // HAVE_ZSTD
+}
+
+QuantizedIQEncoder::~QuantizedIQEncoder()
+{
+#ifdef HAVE_ZSTD
+  if (this->zstd != nullptr)
+    ZSTD_freeCCtx(this->zstd);
+#endif // HAVE_ZSTD
+}
+
+bool
+QuantizedIQEncoder::isCompressionSupported(QuantizedIQCompression compression)
+{
+#ifdef HAVE_ZSTD
+  (void) compression;
+  return true;
+#else
+  return compression == QUANTIZED_IQ_UNCOMPRESSED;
+#endif // HAVE_ZSTD
+}
+
+size_t
+QuantizedIQEncoder::sampleSize(QuantizedIQFormat format)
+{
+  return format == QUANTIZED_IQ_INT8 ? 2 * sizeof(int8_t) : 2 * sizeof(int16_t);
+}
+
+template<typename T> static void
+quantize(T *dest, const SUFLOAT *src, size_t len, SUFLOAT scale)
+{
+  for (size_t i = 0; i < len; ++i)
+    dest[i] = static_cast<T>(lrintf(src[i] * scale));
+}
+
+bool
+QuantizedIQEncoder::encode(
+    const SUCOMPLEX *data,
+    size_t len,
+    std::vector<uint8_t> &out)
+{
+  const SUFLOAT *values = reinterpret_cast<const SUFLOAT *>(data);
+  size_t count = 2 * len;
+  size_t rawSize = len * sampleSize(this->format);
+  size_t start = out.size();
+  SUFLOAT full = this->format == QUANTIZED_IQ_INT8 ? 127 : 32767;
+  SUFLOAT peak = 0;
+  QuantizedIQBlockHeader header;
+
+  // NaNs never win this comparison
+  for (size_t i = 0; i < count; ++i)
+    if (fabsf(values[i]) > peak)
+      peak = fabsf(values[i]);
+
+  header.samples    = static_cast<uint32_t>(len);
+  header.scale      = peak > 0 ? full / peak : 1;
+  header.compressed = 0;
+
+  this->quantized.resize(rawSize);
+
+  if (this->format == QUANTIZED_IQ_INT8)
+    quantize(
+          reinterpret_cast<int8_t *>(this->quantized.data()),
+          values,
+          count,
+          header.scale);
+  else
+    quantize(
+          reinterpret_cast<int16_t *>(this->quantized.data()),
+          values,
+          count,
+          header.scale);
+
+#ifdef HAVE_ZSTD
+  if (this->compression == QUANTIZED_IQ_ZSTD) {
+    size_t bound = ZSTD_compressBound(rawSize);
+    size_t result;
+
+    out.resize(start + sizeof(QuantizedIQBlockHeader) + bound);
+
+    result = ZSTD_compressCCtx(
+          this->zstd,
+          out.data() + start + sizeof(QuantizedIQBlockHeader),
+          bound,
+          this->quantized.data(),
+          rawSize,
+          SIGDIGGER_QUANTIZED_IQ_ZSTD_LEVEL);
+
+    // Noise does not compress. Those blocks are stored as they are.
+    if (!ZSTD_isError(result) && result < rawSize) {
+      header.payload    = static_cast<uint32_t>(result);
+      header.compressed = 1;
+      out.resize(start + sizeof(QuantizedIQBlockHeader) + result);
+      memcpy(out.data() + start, &header, sizeof(QuantizedIQBlockHeader));
+      return true;
+    }
+  }
+#endif // HAVE_ZSTD
+
+  header.payload = static_cast<uint32_t>(rawSize);
+  out.resize(start + sizeof(QuantizedIQBlockHeader) + rawSize);
+  memcpy(out.data() + start, &header, sizeof(QuantizedIQBlockHeader));
+  memcpy(
+        out.data() + start + sizeof(QuantizedIQBlockHeader),
+        this->quantized.data(),
+        rawSize);
+
+  return true;
+}
+
+///////////////////////////// QuantizedCaptureReader ////////////////////////////
+QuantizedCaptureReader::QuantizedCaptureReader()
+{
+  memset(&this->header, 0, sizeof(QuantizedIQFileHeader));
+}
+
+QuantizedCaptureReader::~QuantizedCaptureReader()
+{
+  this->close();
+
+#ifdef HAVE_ZSTD
+  if (this->zstd != nullptr)
+    ZSTD_freeDCtx(this->zstd);
+#endif // HAVE_ZSTD
+}
+
+void
+QuantizedCaptureReader::close(void)
+{
+  if (this->fp != nullptr) {
+    fclose(this->fp);
+    this->fp = nullptr;
+  }
+
+  this->blocks.clear();
+  this->loaded = false;
+  this->pos = 0;
+}
+
+bool
+QuantizedCaptureReader::open(std::string const &path)
+{
+  QuantizedIQBlockHeader blockHeader;
+  uint64_t first = 0;
+  off_t size;
+
+  this->close();
+
+  if ((this->fp = fopen(path.c_str(), "rb")) == nullptr) {
+    this->lastError = "Cannot open " + path + ": " + strerror(errno);
+    return false;
+  }
+
+  if (fread(&this->header, sizeof(QuantizedIQFileHeader), 1, this->fp) < 1
+      || memcmp(this->header.magic, SIGDIGGER_QUANTIZED_IQ_MAGIC, 4) != 0) {
+    this->lastError = "Not a quantized IQ recording";
+    this->close();
+    return false;
+  }
+
+  if (this->header.version > SIGDIGGER_QUANTIZED_IQ_VERSION
+      || (this->header.format != QUANTIZED_IQ_INT8
+          && this->header.format != QUANTIZED_IQ_INT16)) {
+    this->lastError = "Unsupported quantized IQ recording";
+    this->close();
+    return false;
+  }
+
+  fseeko(this->fp, 0, SEEK_END);
+  size = ftello(this->fp);
+  fseeko(this->fp, sizeof(QuantizedIQFileHeader), SEEK_SET);
+
+  // Build the block index. A recording that was interrupted may end
+  // in a partial block, which is left out.
+  while (fread(&blockHeader, sizeof(QuantizedIQBlockHeader), 1, this->fp) == 1) {
+    Block block;
+
+    block.offset = static_cast<uint64_t>(ftello(this->fp));
+    block.first  = first;
+    block.header = blockHeader;
+
+    if (block.offset + blockHeader.payload > static_cast<uint64_t>(size))
+      break;
+
+    this->blocks.push_back(block);
+    first += blockHeader.samples;
+
+    if (fseeko(this->fp, blockHeader.payload, SEEK_CUR) == -1)
+      break;
+  }
+
+  return true;
+}
+
+quint64
+QuantizedCaptureReader::getLength(void) const
+{
+  if (this->blocks.empty())
+    return 0;
+
+  return this->blocks.back().first + this->blocks.back().header.samples;
+}
+
+quint64
+QuantizedCaptureReader::tell(void) const
+{
+  return this->pos;
+}
+
+bool
+QuantizedCaptureReader::seek(quint64 sample)
+{
+  if (sample > this->getLength()) {
+    this->lastError = "Sample out of recording bounds";
+    return false;
+  }
+
+  this->pos = sample;
+
+  return true;
+}
+
+bool
+QuantizedCaptureReader::loadBlock(size_t index)
+{
+  Block const &block = this->blocks[index];
+  QuantizedIQFormat format = this->getFormat();
+  size_t rawSize = block.header.samples * QuantizedIQEncoder::sampleSize(format);
+  size_t count = 2 * block.header.samples;
+  SUFLOAT *dest;
+  SUFLOAT k = 1 / block.header.scale;
+
+  if (this->loaded && this->current == index)
+    return true;
+
+  this->loaded = false;
+  this->payload.resize(block.header.payload);
+
+  if (fseeko(this->fp, static_cast<off_t>(block.offset), SEEK_SET) == -1
+      || fread(this->payload.data(), 1, this->payload.size(), this->fp)
+      != this->payload.size()) {
+    this->lastError = "Cannot read recording: " + std::string(strerror(errno));
+    return false;
+  }
+
+  if (block.header.compressed) {
+#ifdef HAVE_ZSTD
+    size_t result;
+
+    if (this->zstd == nullptr && (this->zstd = ZSTD_createDCtx()) == nullptr) {
+      this->lastError = "Cannot create zstd decompression context";
+      return false;
+    }
+
+    this->quantized.resize(rawSize);
+    result = ZSTD_decompressDCtx(
+          this->zstd,
+          this->quantized.data(),
+          rawSize,
+          this->payload.data(),
+          this->payload.size());
+
+    if (ZSTD_isError(result) || result != rawSize) {
+      this->lastError = "Corrupted block in recording";
+      return false;
+    }
+#else
+    this->lastError = "Recording is zstd-compressed, and zstd is not available";
+    return false;
+#endif // HAVE_ZSTD
+  } else {
+    if (this->payload.size() != rawSize) {
+      this->lastError = "Corrupted block in recording";
+      return false;
+    }
+    this->quantized.swap(this->payload);
+  }
+
+  this->decoded.resize(block.header.samples);
+  dest = reinterpret_cast<SUFLOAT *>(this->decoded.data());
+
+  if (format == QUANTIZED_IQ_INT8) {
+    const int8_t *src = reinterpret_cast<const int8_t *>(this->quantized.data());
+    for (size_t i = 0; i < count; ++i)
+      dest[i] = k * src[i];
+  } else {
+    const int16_t *src = reinterpret_cast<const int16_t *>(this->quantized.data());
+    for (size_t i = 0; i < count; ++i)
+      dest[i] = k * src[i];
+  }
+
+  this->current = index;
+  this->loaded = true;
+
+  return true;
+}
+
+ssize_t
+QuantizedCaptureReader::read(SUCOMPLEX *data, size_t len)
+{
+  size_t got = 0;
+
+  while (got < len && this->pos < this->getLength()) {
+    auto it = std::upper_bound(
+          this->blocks.begin(),
+          this->blocks.end(),
+          this->pos,
+          [] (uint64_t s, Block const &b) { return s < b.first; });
+    size_t index = static_cast<size_t>(it - this->blocks.begin()) - 1;
+    uint64_t offset = this->pos - this->blocks[index].first;
+    size_t chunk;
+
+    if (!this->loadBlock(index))
+      return -1;
+
+    chunk = std::min<size_t>(
+          len - got,
+          static_cast<size_t>(this->blocks[index].header.samples - offset));
+
+    std::copy(
+          this->decoded.begin() + static_cast<ssize_t>(offset),
+          this->decoded.begin() + static_cast<ssize_t>(offset + chunk),
+          data + got);
+
+    got       += chunk;
+    this->pos += chunk;
+  }
+
+  return static_cast<ssize_t>(got);
+}
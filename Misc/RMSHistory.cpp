@@ -0,0 +1,168 @@
+//
+//    RMSHistory.cpp: Tiered, bounded history of RMS measurements
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "RMSHistory.h"
+#include <algorithm>
+
+using namespace SigDigger;
+
+RMSHistory::RMSHistory(size_t capacity) :
+  tiers(SIGDIGGER_RMS_HISTORY_TIERS)
+{
+  this->setCapacity(capacity);
+}
+
+void
+RMSHistory::setCapacity(size_t capacity)
+{
+  // Folding needs at least FACTOR entries to work with
+  this->capacity = std::max<size_t>(capacity, SIGDIGGER_RMS_HISTORY_FACTOR);
+}
+
+void
+RMSHistory::clear(void)
+{
+  for (auto &tier : this->tiers)
+    tier.clear();
+
+  this->count = 0;
+}
+
+quint64
+RMSHistory::getDecimation(unsigned int level)
+{
+  quint64 decimation = 1;
+
+  while (level-- > 0)
+    decimation *= SIGDIGGER_RMS_HISTORY_FACTOR;
+
+  return decimation;
+}
+
+void
+RMSHistory::fold(unsigned int tier)
+{
+  std::deque<Bucket> &src = this->tiers[tier];
+
+  while (src.size() > this->capacity) {
+    if (tier + 1 == this->tiers.size()) {
+      src.pop_front();
+      continue;
+    }
+
+    Bucket bucket = src.front();
+    SUFLOAT sum = 0;
+
+    for (unsigned int i = 0; i < SIGDIGGER_RMS_HISTORY_FACTOR; ++i) {
+      sum += src.front().mean;
+      bucket.min = std::min(bucket.min, src.front().min);
+      bucket.max = std::max(bucket.max, src.front().max);
+      src.pop_front();
+    }
+
+    bucket.mean = sum / SIGDIGGER_RMS_HISTORY_FACTOR;
+    this->tiers[tier + 1].push_back(bucket);
+  }
+}
+
+void
+RMSHistory::push(SUFLOAT value)
+{
+  this->tiers[0].push_back(Bucket {value, value, value});
+  ++this->count;
+
+  for (unsigned int i = 0; i < this->tiers.size(); ++i) {
+    if (this->tiers[i].size() <= this->capacity)
+      break;
+
+    this->fold(i);
+  }
+}
+
+quint64
+RMSHistory::getSpan(unsigned int level) const
+{
+  quint64 span = 0;
+
+  for (unsigned int i = 0; i <= level && i < this->tiers.size(); ++i)
+    span += this->tiers[i].size() * getDecimation(i);
+
+  return span;
+}
+
+void
+RMSHistory::view(
+    unsigned int level,
+    std::vector<SUCOMPLEX> &mean,
+    std::vector<SUFLOAT> *min,
+    std::vector<SUFLOAT> *max) const
+{
+  quint64 target, weight = 0;
+  SUFLOAT sum = 0, lo = 0, hi = 0;
+
+  if (level >= this->tiers.size())
+    level = static_cast<unsigned int>(this->tiers.size()) - 1;
+
+  target = getDecimation(level);
+
+  mean.clear();
+  if (min != nullptr)
+    min->clear();
+  if (max != nullptr)
+    max->clear();
+
+  mean.reserve(this->getSpan(level) / target + 1);
+
+  auto emitBucket = [&] () {
+    SUFLOAT value = sum / static_cast<SUFLOAT>(weight);
+
+    mean.push_back(value + I * SU_ASFLOAT(SU_POWER_DB_RAW(value)));
+    if (min != nullptr)
+      min->push_back(lo);
+    if (max != nullptr)
+      max->push_back(hi);
+
+    sum = 0;
+    weight = 0;
+  };
+
+  // Oldest first. Folding always takes the oldest entries of a tier, so
+  // groups of finer entries align with the coarser ones.
+  for (unsigned int i = level + 1; i-- > 0; ) {
+    quint64 w = getDecimation(i);
+
+    for (auto const &bucket : this->tiers[i]) {
+      if (weight == 0) {
+        lo = bucket.min;
+        hi = bucket.max;
+      } else {
+        lo = std::min(lo, bucket.min);
+        hi = std::max(hi, bucket.max);
+      }
+
+      sum    += bucket.mean * static_cast<SUFLOAT>(w);
+      weight += w;
+
+      if (weight >= target)
+        emitBucket();
+    }
+  }
+
+  if (weight > 0)
+    emitBucket();
+}
@@ -0,0 +1,342 @@
+//
+//    RMSIngestor.cpp: Reception and parsing of RMS reports, off the GUI thread
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "RMSIngestor.h"
+#include <QMutexLocker>
+#include <QHostAddress>
+#include <QtEndian>
+#include <cstring>
+#include <cstdlib>
+#include <clocale>
+
+using namespace SigDigger;
+
+Q_DECLARE_METATYPE(SigDigger::RMSStream *);
+
+/////////////////////////////////// RMSStream //////////////////////////////////
+RMSStream::RMSStream(QTcpSocket *socket, QObject *parent) :
+  QObject(parent),
+  socket(socket)
+{
+  this->peer = socket->peerAddress().toString();
+  this->socket->setParent(this);
+
+  connect(
+        this->socket,
+        SIGNAL(readyRead()),
+        this,
+        SLOT(onReadyRead()));
+
+  connect(
+        this->socket,
+        SIGNAL(disconnected()),
+        this,
+        SLOT(onDisconnected()));
+}
+
+RMSStream::~RMSStream()
+{
+  if (this->socket != nullptr)
+    this->socket->abort();
+}
+
+// Parses a number and the separator after it. Lines always end in '\n'
+// (and the buffer in '\0'), so strtod never runs past the line.
+static bool
+parseField(const char *&p, const char *end, double &value)
+{
+  char *tail;
+
+  value = strtod(p, &tail);
+
+  if (tail == p || tail > end)
+    return false;
+
+  p = tail;
+
+  if (p < end && *p++ != ',')
+    return false;
+
+  return true;
+}
+
+bool
+RMSStream::parseLine(const char *line, const char *end)
+{
+  double fields[4];
+  const char *p = line;
+  int count = 0;
+
+  while (end > line && (end[-1] == '\r' || end[-1] == ' '))
+    --end;
+
+  // Description line allows commas and stuff
+  if (end - line >= 5 && strncmp(line, "DESC,", 5) == 0) {
+    this->parsed.title =
+        QString::fromUtf8(line + 5, static_cast<int>(end - line - 5));
+    return true;
+  }
+
+  // Everything after this line comes in binary records
+  if (end - line == 6 && strncmp(line, "BINARY", 6) == 0) {
+    this->binary = true;
+    return true;
+  }
+
+  if (end - line >= 5 && strncmp(line, "RATE,", 5) == 0) {
+    p += 5;
+    if (!parseField(p, end, fields[0]) || p != end || fields[0] <= 0)
+      return false;
+
+    this->parsed.rate = fields[0];
+    return true;
+  }
+
+  // sec,usec,mag,db
+  while (p < end && count < 4)
+    if (!parseField(p, end, fields[count++]))
+      return false;
+
+  if (count != 4 || p != end)
+    return false;
+
+  this->parsed.mags.push_back(static_cast<SUFLOAT>(fields[2]));
+  this->parsed.last =
+      static_cast<qreal>(static_cast<long>(fields[0])) + fields[1];
+
+  return true;
+}
+
+void
+RMSStream::parseRecord(const char *data)
+{
+  quint64 bits = qFromLittleEndian<quint64>(data);
+  quint32 magBits = qFromLittleEndian<quint32>(data + 8);
+  double timestamp;
+  float mag;
+
+  memcpy(&timestamp, &bits, sizeof(double));
+  memcpy(&mag, &magBits, sizeof(float));
+
+  this->parsed.mags.push_back(mag);
+  this->parsed.last = timestamp;
+}
+
+void
+RMSStream::publish(void)
+{
+  QMutexLocker locker(&this->mutex);
+  RMSBatch &batch = this->batch;
+  size_t excess;
+
+  if (!this->parsed.mags.empty()) {
+    batch.mags.insert(
+          batch.mags.end(),
+          this->parsed.mags.begin(),
+          this->parsed.mags.end());
+    batch.last = this->parsed.last;
+
+    // Nobody is taking them. Forget the oldest.
+    if (batch.mags.size() > SIGDIGGER_RMS_MAX_PENDING) {
+      excess = batch.mags.size() - SIGDIGGER_RMS_MAX_PENDING;
+      batch.mags.erase(
+            batch.mags.begin(),
+            batch.mags.begin() + static_cast<long>(excess));
+      batch.dropped += excess;
+    }
+  }
+
+  if (this->parsed.rate > 0)
+    batch.rate = this->parsed.rate;
+
+  if (!this->parsed.title.isEmpty())
+    batch.title = this->parsed.title;
+
+  if (!this->parsed.error.isEmpty())
+    batch.error = this->parsed.error;
+
+  batch.closed = batch.closed || this->parsed.closed;
+
+  this->parsed.mags.clear();
+  this->parsed.rate = 0;
+  this->parsed.title.clear();
+  this->parsed.error.clear();
+  this->parsed.closed = false;
+}
+
+void
+RMSStream::take(RMSBatch &batch)
+{
+  QMutexLocker locker(&this->mutex);
+
+  // Keeps the capacity of both vectors around
+  batch.mags.clear();
+  std::swap(batch.mags, this->batch.mags);
+
+  batch.last    = this->batch.last;
+  batch.rate    = this->batch.rate;
+  batch.title   = this->batch.title;
+  batch.error   = this->batch.error;
+  batch.dropped = this->batch.dropped;
+  batch.closed  = this->batch.closed;
+
+  this->batch.rate = 0;
+  this->batch.title.clear();
+  this->batch.error.clear();
+  this->batch.dropped = 0;
+}
+
+void
+RMSStream::close(void)
+{
+  QMetaObject::invokeMethod(this, "onClose", Qt::QueuedConnection);
+}
+
+void
+RMSStream::release(void)
+{
+  this->close();
+  this->deleteLater();
+}
+
+///////////////////////////////// Slots ////////////////////////////////////////
+void
+RMSStream::onReadyRead(void)
+{
+  const char *p, *end, *nl;
+
+  if (this->socket == nullptr)
+    return;
+
+  this->pending.append(this->socket->readAll());
+
+  p   = this->pending.constData();
+  end = p + this->pending.size();
+
+  while (p < end) {
+    if (this->binary) {
+      if (end - p < SIGDIGGER_RMS_BINARY_RECORD_SIZE)
+        break;
+
+      this->parseRecord(p);
+      p += SIGDIGGER_RMS_BINARY_RECORD_SIZE;
+    } else {
+      nl = static_cast<const char *>(
+            memchr(p, '\n', static_cast<size_t>(end - p)));
+
+      if (nl == nullptr) {
+        if (end - p >= SIGDIGGER_RMS_MAX_LINE_SIZE) {
+          this->pending.clear();
+          this->parsed.error =
+              "Remote peer attempted to flood us. Preventively disconnected";
+          this->publish();
+          this->onClose();
+          return;
+        }
+        break;
+      }
+
+      this->parseLine(p, nl);
+      p = nl + 1;
+    }
+  }
+
+  this->pending.remove(0, static_cast<int>(p - this->pending.constData()));
+
+  this->publish();
+}
+
+void
+RMSStream::onDisconnected(void)
+{
+  this->onClose();
+}
+
+void
+RMSStream::onClose(void)
+{
+  if (this->socket != nullptr) {
+    this->socket->disconnect(this);
+    this->socket->abort();
+    this->socket->deleteLater();
+    this->socket = nullptr;
+  }
+
+  this->parsed.closed = true;
+  this->publish();
+}
+
+////////////////////////////////// RMSIngestor /////////////////////////////////
+RMSIngestor::RMSIngestor(QObject *parent) : QObject(parent)
+{
+  // Reports use dots as decimal separators
+  setlocale(LC_NUMERIC, "C");
+
+  qRegisterMetaType<SigDigger::RMSStream *>();
+}
+
+bool
+RMSIngestor::listen(QString address, quint16 port)
+{
+  if (this->server == nullptr) {
+    this->server = new QTcpServer(this);
+
+    connect(
+          this->server,
+          SIGNAL(acceptError(QAbstractSocket::SocketError)),
+          this,
+          SLOT(onAcceptError(QAbstractSocket::SocketError)));
+
+    connect(
+          this->server,
+          SIGNAL(newConnection()),
+          this,
+          SLOT(onNewConnection()));
+  }
+
+  return this->server->listen(QHostAddress(address), port);
+}
+
+void
+RMSIngestor::stop(void)
+{
+  if (this->server != nullptr)
+    this->server->close();
+}
+
+QString
+RMSIngestor::errorString(void) const
+{
+  return this->server != nullptr ? this->server->errorString() : QString();
+}
+
+///////////////////////////////// Slots ////////////////////////////////////////
+void
+RMSIngestor::onNewConnection(void)
+{
+  QTcpSocket *socket;
+
+  while ((socket = this->server->nextPendingConnection()) != nullptr)
+    emit newStream(new RMSStream(socket, this));
+}
+
+void
+RMSIngestor::onAcceptError(QAbstractSocket::SocketError)
+{
+  emit acceptError(this->server->errorString());
+}
@@ -0,0 +1,161 @@
+//
+//    RecordingTrigger.cpp: Power-triggered baseband recording
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <RecordingTrigger.h>
+#include <GenericDataSaver.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace SigDigger;
+
+////////////////////////////// RecordingTrigger ////////////////////////////////
+void
+RecordingTrigger::setParams(RecordingTriggerParams const &params)
+{
+  this->params = params;
+}
+
+RecordingTriggerParams const &
+RecordingTrigger::getParams(void) const
+{
+  return this->params;
+}
+
+void
+RecordingTrigger::reset(void)
+{
+  this->active = false;
+  this->lastAbove = 0;
+}
+
+RecordingTrigger::Event
+RecordingTrigger::process(Suscan::PSDMessage const &msg)
+{
+  const SUFLOAT *psd = msg.get();
+  SUSCOUNT size = msg.size();
+  SUFLOAT fs = static_cast<SUFLOAT>(msg.getSampleRate());
+  struct timeval tv = msg.getTimeStamp();
+  qreal now = static_cast<qreal>(tv.tv_sec) + 1e-6 * tv.tv_usec;
+  SUSCOUNT first = 0, last = size;
+  SUFLOAT power = 0;
+
+  if (size == 0 || fs <= 0)
+    return NONE;
+
+  // Bins are centered: bin size / 2 is the tuner frequency
+  if (this->params.width > 0) {
+    qreal binWidth = static_cast<qreal>(fs) / static_cast<qreal>(size);
+    qreal lo = (this->params.offset - .5 * this->params.width) / binWidth;
+    qreal hi = (this->params.offset + .5 * this->params.width) / binWidth;
+    qreal center = .5 * static_cast<qreal>(size);
+
+    first = static_cast<SUSCOUNT>(
+          std::max<qreal>(0, std::floor(center + lo)));
+    last = static_cast<SUSCOUNT>(
+          std::min<qreal>(static_cast<qreal>(size), std::ceil(center + hi)));
+
+    // Narrower than a bin (or out of the spectrum): nearest bin
+    if (first >= last) {
+      first = std::min<SUSCOUNT>(first, size - 1);
+      last = first + 1;
+    }
+  }
+
+  for (SUSCOUNT i = first; i < last; ++i)
+    power += psd[i];
+
+  power /= static_cast<SUFLOAT>(last - first);
+  this->lastLevel = SU_POWER_DB(power);
+
+  if (this->lastLevel >= this->params.level) {
+    this->lastAbove = now;
+
+    if (!this->active) {
+      this->active = true;
+      return START;
+    }
+  } else if (this->active
+             && (now - this->lastAbove >= this->params.hang
+                 || now < this->lastAbove)) {
+    // Time going backwards: seek in a replay
+    this->active = false;
+    return STOP;
+  }
+
+  return NONE;
+}
+
+////////////////////////////// PreTriggerBuffer ////////////////////////////////
+PreTriggerBuffer::PreTriggerBuffer(size_t length)
+{
+  this->ring.resize(std::max<size_t>(length, 1));
+}
+
+void
+PreTriggerBuffer::flushRing(void)
+{
+  size_t start = (this->pos + this->ring.size() - this->fill)
+      % this->ring.size();
+  size_t first = std::min(this->fill, this->ring.size() - start);
+
+  this->saver->write(this->ring.data() + start, first);
+  if (first < this->fill)
+    this->saver->write(this->ring.data(), this->fill - first);
+
+  this->pos = this->fill = 0;
+}
+
+void
+PreTriggerBuffer::setSaver(GenericDataSaver *saver)
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+
+  this->saver = saver;
+
+  if (this->saver != nullptr)
+    this->flushRing();
+}
+
+void
+PreTriggerBuffer::baseband(const SUCOMPLEX *samples, SUSCOUNT length)
+{
+  std::lock_guard<std::mutex> guard(this->mutex);
+  size_t size = this->ring.size();
+
+  // The saver never blocks, holding the lock here is cheap
+  if (this->saver != nullptr) {
+    this->saver->write(samples, length);
+    return;
+  }
+
+  if (length > size) {
+    samples += length - size;
+    length = size;
+  }
+
+  while (length > 0) {
+    size_t chunk = std::min<size_t>(length, size - this->pos);
+
+    std::copy(samples, samples + chunk, this->ring.begin() + this->pos);
+
+    this->pos   = (this->pos + chunk) % size;
+    this->fill  = std::min(this->fill + chunk, size);
+    samples    += chunk;
+    length     -= chunk;
+  }
+}
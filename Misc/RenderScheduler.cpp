@@ -0,0 +1,226 @@
+//
+//    RenderScheduler.cpp: Frame-paced redraw of live views
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "RenderScheduler.h"
+#include <QGuiApplication>
+#include <QScreen>
+#include <algorithm>
+#include <cmath>
+
+using namespace SigDigger;
+
+RenderScheduler *RenderScheduler::currInstance = nullptr;
+
+RenderScheduler *
+RenderScheduler::instance(void)
+{
+  if (currInstance == nullptr)
+    currInstance = new RenderScheduler();
+
+  return currInstance;
+}
+
+RenderScheduler::RenderScheduler()
+{
+  this->frameTimer.setSingleShot(true);
+  this->frameTimer.setTimerType(Qt::PreciseTimer);
+
+  this->refreshFrameInterval();
+
+  connect(
+        &this->frameTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onFrame(void)));
+}
+
+void
+RenderScheduler::refreshFrameInterval(void)
+{
+  qreal fps = this->maxFps;
+  QScreen *screen = QGuiApplication::primaryScreen();
+
+  if (screen != nullptr
+      && screen->refreshRate() > 1
+      && screen->refreshRate() < fps)
+    fps = screen->refreshRate();
+
+  fps /= this->fpsDivisor;
+
+  this->frameInterval = static_cast<int>(std::ceil(1000. / fps));
+}
+
+void
+RenderScheduler::attach(QObject *view, std::function<void (void)> const &redraw)
+{
+  bool known = this->views.contains(view);
+
+  this->views[view].redraw = redraw;
+
+  if (!known)
+    connect(
+          view,
+          SIGNAL(destroyed(QObject *)),
+          this,
+          SLOT(onViewDestroyed(QObject *)));
+}
+
+void
+RenderScheduler::detach(QObject *view)
+{
+  if (this->views.remove(view) > 0) {
+    this->dirtyViews.removeAll(view);
+    this->frameViews.removeAll(view);
+    disconnect(view, nullptr, this, nullptr);
+  }
+}
+
+void
+RenderScheduler::markDirty(QObject *view)
+{
+  auto it = this->views.find(view);
+  qint64 elapsed;
+
+  if (it == this->views.end() || it->dirty)
+    return;
+
+  it->dirty = true;
+  this->dirtyViews.append(view);
+
+  if (this->frameTimer.isActive())
+    return;
+
+  // Redraw right away if the last frame is old enough, so isolated
+  // updates do not wait for a full frame.
+  elapsed = this->lastFrame.isValid()
+      ? this->lastFrame.elapsed()
+      : this->frameInterval;
+
+  this->frameTimer.start(
+        static_cast<int>(
+          std::max<qint64>(0, this->frameInterval - elapsed)));
+}
+
+void
+RenderScheduler::setMaxFps(unsigned int fps)
+{
+  if (fps < 1)
+    fps = 1;
+  else if (fps > SIGDIGGER_RENDER_SCHEDULER_MAX_FPS)
+    fps = SIGDIGGER_RENDER_SCHEDULER_MAX_FPS;
+
+  this->maxFps = fps;
+  this->refreshFrameInterval();
+}
+
+unsigned int
+RenderScheduler::getMaxFps(void) const
+{
+  return this->maxFps;
+}
+
+bool
+RenderScheduler::acceptData(const QObject *consumer)
+{
+  if (!this->batchMode && !this->decimated)
+    return true;
+
+  QElapsedTimer &timer = this->lastAccepted[consumer];
+
+  if (timer.isValid()
+      && timer.elapsed() < 1000 / SIGDIGGER_RENDER_SCHEDULER_BATCH_FPS)
+    return false;
+
+  timer.start();
+  return true;
+}
+
+void
+RenderScheduler::setBatchMode(bool batch)
+{
+  this->batchMode = batch;
+
+  // Consumers may be gone by the next batch
+  if (!this->batchMode && !this->decimated)
+    this->lastAccepted.clear();
+}
+
+bool
+RenderScheduler::isBatchMode(void) const
+{
+  return this->batchMode;
+}
+
+void
+RenderScheduler::setFpsDivisor(unsigned int divisor)
+{
+  this->fpsDivisor = std::max(1u, divisor);
+  this->refreshFrameInterval();
+}
+
+void
+RenderScheduler::setDecimated(bool decimated)
+{
+  this->decimated = decimated;
+
+  if (!this->batchMode && !this->decimated)
+    this->lastAccepted.clear();
+}
+
+qint64
+RenderScheduler::takeWorstFrameTime(void)
+{
+  qint64 worst = this->worstFrameUs;
+
+  this->worstFrameUs = 0;
+
+  return worst;
+}
+
+//////////////////////////////////// Slots /////////////////////////////////////
+void
+RenderScheduler::onFrame(void)
+{
+  this->lastFrame.start();
+
+  // Views dirtied by a redraw callback are left for the next frame
+  this->frameViews.swap(this->dirtyViews);
+
+  while (!this->frameViews.isEmpty()) {
+    QObject *view = this->frameViews.takeFirst();
+    auto it = this->views.find(view);
+
+    if (it != this->views.end() && it->dirty) {
+      it->dirty = false;
+      it->redraw();
+    }
+  }
+
+  this->worstFrameUs = std::max(
+        this->worstFrameUs,
+        this->lastFrame.nsecsElapsed() / 1000);
+
+  if (!this->dirtyViews.isEmpty())
+    this->frameTimer.start(this->frameInterval);
+}
+
+void
+RenderScheduler::onViewDestroyed(QObject *view)
+{
+  this->detach(view);
+}
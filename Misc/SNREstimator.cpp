@@ -18,6 +18,7 @@
 //
 
 #include "SNREstimator.h"
+#include <algorithm>
 #include <cstdio>
 
 using namespace SigDigger;
@@ -27,6 +28,32 @@ SNREstimator::SNREstimator()
 
 }
 
+void
+SNREstimator::recalculateMoments(void)
+{
+  unsigned int i, j;
+  float x, skip;
+  float intlen = 1.f  / this->intervals;
+  float start = .5f * intlen;
+
+  // Only depends on the histogram length and the number of intervals
+  this->moment.resize(this->length);
+
+  for (i = 0; i < this->length; ++i) {
+    x = i * this->hx;
+    if (x >= .5f)
+      x -= 1.f;
+
+    this->moment[i] = 0;
+    for (j = 0; j < this->intervals; ++j) {
+      skip = start + j * intlen;
+      this->moment[i] += (x - skip) * (x - skip);
+    }
+  }
+
+  this->momentDirty = false;
+}
+
 void
 SNREstimator::recalculateModel(void)
 {
@@ -81,34 +108,18 @@ void
 SNREstimator::iterate()
 {
   if (this->length > 0 && this->intervals > 0) {
-    float delta = 0, x;
-    float term;
-    unsigned int i, j;
-    float intlen, start;
-    float skip;
+    float delta = 0;
+    unsigned int i;
     float sigmainv = 1.f / this->sigma;
     float sigma3inv = sigmainv * sigmainv * sigmainv;
 
-    this->recalculateModel();
+    if (this->momentDirty)
+      this->recalculateMoments();
 
-    intlen = 1.f  / this->intervals;
-    start = .5f * intlen;
-
-    for (i = 0; i < this->length; ++i) {
-      x = i * this->hx;
-      if (x >= .5f)
-        x -= 1.f;
-
-      term = 0;
-      for (j = 0; j < this->intervals; ++j) {
-        skip = start + j * intlen;
-        term += (x - skip) * (x - skip);
-      }
-
-      term *= (this->Hi[i] - this->Htilde[i]) / sigma3inv;
+    this->recalculateModel();
 
-      delta += term;
-    }
+    for (i = 0; i < this->length; ++i)
+      delta += this->moment[i] * (this->Hi[i] - this->Htilde[i]) / sigma3inv;
 
     this->delta = delta / this->length;
     this->sigma += -this->alpha * this->delta;
@@ -139,6 +150,8 @@ SNREstimator::setBps(unsigned int bps)
     this->sigma = SNR_ESTIMATOR_DEFAULT_SIGMA;
     this->intervals = 1 << bps;
     this->hx = 1.f / this->length;
+    this->momentDirty = true;
+    this->converged = false;
   }
 }
 
@@ -146,6 +159,8 @@ void
 SNREstimator::feed(std::vector<unsigned int> const &history)
 {
   unsigned int max = 0;
+  bool changed = false;
+  float Ht;
 
   if (this->length != history.size()) {
     this->length = static_cast<unsigned int>(history.size());
@@ -153,6 +168,8 @@ SNREstimator::feed(std::vector<unsigned int> const &history)
     this->Hi.resize(this->length);
     this->Htilde.resize(this->length);
     this->hx = 1.f / this->length;
+    this->momentDirty = true;
+    changed = true;
   }
 
   for (unsigned int i = 0; i < history.size(); ++i)
@@ -162,21 +179,41 @@ SNREstimator::feed(std::vector<unsigned int> const &history)
   if (max == 0)
     max = 1;
 
-  for (unsigned int i = 0; i < history.size(); ++i)
-    this->Htilde[i] = static_cast<float>(history[i]) / max;
+  for (unsigned int i = 0; i < history.size(); ++i) {
+    Ht = static_cast<float>(history[i]) / max;
+    if (Ht != this->Htilde[i]) {
+      this->Htilde[i] = Ht;
+      changed = true;
+    }
+  }
+
+  // Same histogram as last time and already fitted: nothing to do
+  if (changed)
+    this->converged = false;
+  else if (this->converged)
+    return;
 
-  this->iterate();
+  for (unsigned int n = 0; n < SNR_ESTIMATOR_MAX_ITERATIONS; ++n) {
+    this->iterate();
+
+    if (std::fabs(this->alpha * this->delta)
+        < SNR_ESTIMATOR_TOLERANCE * std::fabs(this->sigma)) {
+      this->converged = true;
+      break;
+    }
+  }
 }
 
 void
 SNREstimator::setAlpha(float alpha)
 {
   this->alpha = alpha;
+  this->converged = false;
 }
 
 void
 SNREstimator::setSigma(float sigma)
 {
   this->sigma = sigma;
+  this->converged = false;
 }
-
@@ -0,0 +1,975 @@
+//
+//    Misc/SampleKernels.cpp: Vectorized element-wise sample kernels
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "SampleKernels.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#  include <immintrin.h>
+#elif defined(__ARM_NEON)
+#  include <arm_neon.h>
+#endif
+
+// Distro builds target baseline x86-64. AVX2 versions of the kernels are
+// built for that ISA alone and chosen at run time, if the CPU has it.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  define SIGDIGGER_SAMPLE_KERNELS_AVX2
+#  define AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+
+using namespace SigDigger;
+
+// Minimax coefficients of atan(z), |z| <= 1
+#define ATAN_C1  0.99997726f
+#define ATAN_C3 -0.33262347f
+#define ATAN_C5  0.19354346f
+#define ATAN_C7 -0.11643287f
+#define ATAN_C9  0.05265332f
+#define ATAN_C11 -0.01172120f
+
+static const bool singlePrecision = sizeof(SUFLOAT) == sizeof(float);
+
+// Chosen once. SIGDIGGER_KERNELS=baseline turns the run-time dispatch off.
+static bool
+detectAVX2(void)
+{
+#ifdef SIGDIGGER_SAMPLE_KERNELS_AVX2
+  const char *forced = getenv("SIGDIGGER_KERNELS");
+
+  if (forced != nullptr && strcmp(forced, "baseline") == 0)
+    return false;
+
+  __builtin_cpu_init();
+
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+  return false;
+#endif // SIGDIGGER_SAMPLE_KERNELS_AVX2
+}
+
+static inline bool
+useAVX2(void)
+{
+  static const bool avx2 = detectAVX2();
+
+  return avx2;
+}
+
+const char *
+SampleKernels::isaName(void)
+{
+#if defined(__ARM_NEON)
+  return "neon";
+#else
+  if (useAVX2())
+    return "avx2";
+
+#  if defined(__SSE__) || defined(__x86_64__)
+  return "sse";
+#  else
+  return "generic";
+#  endif
+#endif
+}
+
+SUFLOAT
+SampleKernels::fastAtan2(SUFLOAT y, SUFLOAT x)
+{
+  float ax = std::fabs(static_cast<float>(x));
+  float ay = std::fabs(static_cast<float>(y));
+  float mx = ax > ay ? ax : ay;
+  float mn = ax > ay ? ay : ax;
+  float z, z2, r;
+
+  if (mx <= 0)
+    return 0;
+
+  z  = mn / mx;
+  z2 = z * z;
+  r  = z * (ATAN_C1 + z2 * (ATAN_C3 + z2 * (ATAN_C5 + z2 * (ATAN_C7
+         + z2 * (ATAN_C9 + z2 * ATAN_C11)))));
+
+  if (ay > ax)
+    r = static_cast<float>(M_PI / 2) - r;
+
+  if (x < 0)
+    r = static_cast<float>(M_PI) - r;
+
+  return y < 0 ? -r : r;
+}
+
+#if defined(__SSE__) || defined(__x86_64__)
+static inline __m128
+select4(__m128 mask, __m128 a, __m128 b)
+{
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128
+fastAtan2x4(__m128 y, __m128 x)
+{
+  const __m128 sign = _mm_set1_ps(-0.f);
+  __m128 ax = _mm_andnot_ps(sign, x);
+  __m128 ay = _mm_andnot_ps(sign, y);
+  __m128 mx = _mm_max_ps(_mm_max_ps(ax, ay), _mm_set1_ps(1e-30f));
+  __m128 z  = _mm_div_ps(_mm_min_ps(ax, ay), mx);
+  __m128 z2 = _mm_mul_ps(z, z);
+  __m128 r;
+
+  r = _mm_add_ps(_mm_set1_ps(ATAN_C9), _mm_mul_ps(z2, _mm_set1_ps(ATAN_C11)));
+  r = _mm_add_ps(_mm_set1_ps(ATAN_C7), _mm_mul_ps(z2, r));
+  r = _mm_add_ps(_mm_set1_ps(ATAN_C5), _mm_mul_ps(z2, r));
+  r = _mm_add_ps(_mm_set1_ps(ATAN_C3), _mm_mul_ps(z2, r));
+  r = _mm_add_ps(_mm_set1_ps(ATAN_C1), _mm_mul_ps(z2, r));
+  r = _mm_mul_ps(z, r);
+
+  r = select4(
+        _mm_cmpgt_ps(ay, ax),
+        _mm_sub_ps(_mm_set1_ps(static_cast<float>(M_PI / 2)), r),
+        r);
+  r = select4(
+        _mm_cmplt_ps(x, _mm_setzero_ps()),
+        _mm_sub_ps(_mm_set1_ps(static_cast<float>(M_PI)), r),
+        r);
+
+  return _mm_or_ps(r, _mm_and_ps(y, sign));
+}
+
+// 8 scaled samples, rounded to nearest and saturated to [lo, hi]
+static inline __m128i
+scaleToInt32x8(const float *x, __m128 k, __m128 lo, __m128 hi, __m128i &b)
+{
+  __m128 x0 = _mm_mul_ps(_mm_loadu_ps(x), k);
+  __m128 x1 = _mm_mul_ps(_mm_loadu_ps(x + 4), k);
+
+  b = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(x1, lo), hi));
+
+  return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(x0, lo), hi));
+}
+
+// Products of 4 complex samples, deinterleaved to real and imaginary parts
+static inline void
+conjProductx4(const float *x, const float *y, __m128 &re, __m128 &im)
+{
+  __m128 x0 = _mm_loadu_ps(x);
+  __m128 x1 = _mm_loadu_ps(x + 4);
+  __m128 y0 = _mm_loadu_ps(y);
+  __m128 y1 = _mm_loadu_ps(y + 4);
+  __m128 xr = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0));
+  __m128 xi = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1));
+  __m128 yr = _mm_shuffle_ps(y0, y1, _MM_SHUFFLE(2, 0, 2, 0));
+  __m128 yi = _mm_shuffle_ps(y0, y1, _MM_SHUFFLE(3, 1, 3, 1));
+
+  re = _mm_add_ps(_mm_mul_ps(xr, yr), _mm_mul_ps(xi, yi));
+  im = _mm_sub_ps(_mm_mul_ps(xi, yr), _mm_mul_ps(xr, yi));
+}
+#elif defined(__ARM_NEON)
+static inline float32x4_t
+fastAtan2x4(float32x4_t y, float32x4_t x)
+{
+  float32x4_t ax = vabsq_f32(x);
+  float32x4_t ay = vabsq_f32(y);
+  float32x4_t mx = vmaxq_f32(vmaxq_f32(ax, ay), vdupq_n_f32(1e-30f));
+  float32x4_t mn = vminq_f32(ax, ay);
+  float32x4_t inv = vrecpeq_f32(mx);
+  float32x4_t z, z2, r;
+
+  // Two Newton-Raphson steps bring the reciprocal to full precision
+  inv = vmulq_f32(vrecpsq_f32(mx, inv), inv);
+  inv = vmulq_f32(vrecpsq_f32(mx, inv), inv);
+  z   = vmulq_f32(mn, inv);
+  z2  = vmulq_f32(z, z);
+
+  r = vmlaq_f32(vdupq_n_f32(ATAN_C9), z2, vdupq_n_f32(ATAN_C11));
+  r = vmlaq_f32(vdupq_n_f32(ATAN_C7), z2, r);
+  r = vmlaq_f32(vdupq_n_f32(ATAN_C5), z2, r);
+  r = vmlaq_f32(vdupq_n_f32(ATAN_C3), z2, r);
+  r = vmlaq_f32(vdupq_n_f32(ATAN_C1), z2, r);
+  r = vmulq_f32(z, r);
+
+  r = vbslq_f32(
+        vcgtq_f32(ay, ax),
+        vsubq_f32(vdupq_n_f32(static_cast<float>(M_PI / 2)), r),
+        r);
+  r = vbslq_f32(
+        vcltq_f32(x, vdupq_n_f32(0)),
+        vsubq_f32(vdupq_n_f32(static_cast<float>(M_PI)), r),
+        r);
+
+  return vbslq_f32(vcltq_f32(y, vdupq_n_f32(0)), vnegq_f32(r), r);
+}
+
+// 8 scaled samples, rounded half away from zero and saturated to [lo, hi]
+static inline int16x8_t
+scaleToInt16x8(const float *x, float32x4_t k, float32x4_t lo, float32x4_t hi)
+{
+  const uint32x4_t sign = vdupq_n_u32(0x80000000);
+  const uint32x4_t half = vreinterpretq_u32_f32(vdupq_n_f32(.5f));
+  float32x4_t x0 = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(x), k), lo), hi);
+  float32x4_t x1 = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(x + 4), k), lo), hi);
+
+  x0 = vaddq_f32(
+        x0,
+        vreinterpretq_f32_u32(
+          vorrq_u32(vandq_u32(vreinterpretq_u32_f32(x0), sign), half)));
+  x1 = vaddq_f32(
+        x1,
+        vreinterpretq_f32_u32(
+          vorrq_u32(vandq_u32(vreinterpretq_u32_f32(x1), sign), half)));
+
+  return vcombine_s16(
+        vqmovn_s32(vcvtq_s32_f32(x0)),
+        vqmovn_s32(vcvtq_s32_f32(x1)));
+}
+#endif
+
+#ifdef SIGDIGGER_SAMPLE_KERNELS_AVX2
+//
+// 8 complex samples, deinterleaved. Real and imaginary parts come out in
+// the lane order of _mm256_shuffle_ps (0 1 4 5 2 3 6 7): interleave8()
+// restores it for complex outputs, and linear8() for real ones.
+//
+AVX2_TARGET static inline void
+deinterleave8(const float *x, __m256 &re, __m256 &im)
+{
+  __m256 x0 = _mm256_loadu_ps(x);
+  __m256 x1 = _mm256_loadu_ps(x + 8);
+
+  re = _mm256_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0));
+  im = _mm256_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+AVX2_TARGET static inline void
+interleave8(float *d, __m256 re, __m256 im)
+{
+  _mm256_storeu_ps(d,     _mm256_unpacklo_ps(re, im));
+  _mm256_storeu_ps(d + 8, _mm256_unpackhi_ps(re, im));
+}
+
+AVX2_TARGET static inline __m256
+linear8(__m256 v)
+{
+  return _mm256_castpd_ps(
+        _mm256_permute4x64_pd(
+          _mm256_castps_pd(v),
+          _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+AVX2_TARGET static inline __m256
+fastAtan2x8(__m256 y, __m256 x)
+{
+  const __m256 sign = _mm256_set1_ps(-0.f);
+  __m256 ax = _mm256_andnot_ps(sign, x);
+  __m256 ay = _mm256_andnot_ps(sign, y);
+  __m256 mx = _mm256_max_ps(_mm256_max_ps(ax, ay), _mm256_set1_ps(1e-30f));
+  __m256 z  = _mm256_div_ps(_mm256_min_ps(ax, ay), mx);
+  __m256 z2 = _mm256_mul_ps(z, z);
+  __m256 r;
+
+  r = _mm256_fmadd_ps(z2, _mm256_set1_ps(ATAN_C11), _mm256_set1_ps(ATAN_C9));
+  r = _mm256_fmadd_ps(z2, r, _mm256_set1_ps(ATAN_C7));
+  r = _mm256_fmadd_ps(z2, r, _mm256_set1_ps(ATAN_C5));
+  r = _mm256_fmadd_ps(z2, r, _mm256_set1_ps(ATAN_C3));
+  r = _mm256_fmadd_ps(z2, r, _mm256_set1_ps(ATAN_C1));
+  r = _mm256_mul_ps(z, r);
+
+  r = _mm256_blendv_ps(
+        r,
+        _mm256_sub_ps(_mm256_set1_ps(static_cast<float>(M_PI / 2)), r),
+        _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+  r = _mm256_blendv_ps(
+        r,
+        _mm256_sub_ps(_mm256_set1_ps(static_cast<float>(M_PI)), r),
+        _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+
+  return _mm256_or_ps(r, _mm256_and_ps(y, sign));
+}
+
+//
+// Each of these walks down from i in blocks of 8 and leaves i at the
+// first sample not done, for the SSE and scalar loops to finish.
+//
+AVX2_TARGET static void
+delayedConjAVX2(float *d, const float *x, const float *y, size_t &i, float eps)
+{
+  const __m256 e = _mm256_set1_ps(eps);
+  const __m256 one = _mm256_set1_ps(1.f);
+
+  for (; i >= 8; i -= 8) {
+    __m256 xr, xi, yr, yi, kinv, re, im;
+
+    deinterleave8(x + 2 * (i - 8), xr, xi);
+    deinterleave8(y + 2 * (i - 8), yr, yi);
+
+    kinv = _mm256_div_ps(
+          one,
+          _mm256_add_ps(
+            _mm256_sqrt_ps(_mm256_fmadd_ps(yr, yr, _mm256_mul_ps(yi, yi))),
+            e));
+    re = _mm256_fmadd_ps(xr, yr, _mm256_mul_ps(xi, yi));
+    im = _mm256_fmsub_ps(xi, yr, _mm256_mul_ps(xr, yi));
+
+    interleave8(
+          d + 2 * (i - 8),
+          _mm256_mul_ps(re, kinv),
+          _mm256_mul_ps(im, kinv));
+  }
+}
+
+AVX2_TARGET static void
+quadDemodAVX2(float *d, const float *x, const float *y, size_t &i, float k)
+{
+  const __m256 vk = _mm256_set1_ps(k);
+
+  for (; i >= 8; i -= 8) {
+    __m256 xr, xi, yr, yi, re, im;
+
+    deinterleave8(x + 2 * (i - 8), xr, xi);
+    deinterleave8(y + 2 * (i - 8), yr, yi);
+
+    re = _mm256_fmadd_ps(xr, yr, _mm256_mul_ps(xi, yi));
+    im = _mm256_fmsub_ps(xi, yr, _mm256_mul_ps(xr, yi));
+
+    interleave8(
+          d + 2 * (i - 8),
+          _mm256_setzero_ps(),
+          _mm256_mul_ps(vk, fastAtan2x8(im, re)));
+  }
+}
+
+AVX2_TARGET static void
+modulusAVX2(float *d, const float *x, size_t &i)
+{
+  for (; i >= 8; i -= 8) {
+    __m256 xr, xi;
+
+    deinterleave8(x + 2 * (i - 8), xr, xi);
+
+    _mm256_storeu_ps(
+          d + i - 8,
+          linear8(
+            _mm256_sqrt_ps(_mm256_fmadd_ps(xr, xr, _mm256_mul_ps(xi, xi)))));
+  }
+}
+
+AVX2_TARGET static void
+realPartAVX2(float *d, const float *x, size_t &i, float gain)
+{
+  const __m256 k = _mm256_set1_ps(gain);
+
+  for (; i >= 8; i -= 8) {
+    __m256 xr, xi;
+
+    deinterleave8(x + 2 * (i - 8), xr, xi);
+
+    _mm256_storeu_ps(d + i - 8, linear8(_mm256_mul_ps(k, xr)));
+  }
+}
+
+AVX2_TARGET static void
+argumentAVX2(float *d, const float *x, size_t &i, bool quadrature)
+{
+  const __m256 sign = _mm256_set1_ps(-0.f);
+
+  for (; i >= 8; i -= 8) {
+    __m256 xr, xi;
+
+    deinterleave8(x + 2 * (i - 8), xr, xi);
+
+    _mm256_storeu_ps(
+          d + i - 8,
+          linear8(
+            quadrature
+            ? fastAtan2x8(xr, _mm256_xor_ps(xi, sign))
+            : fastAtan2x8(xi, xr)));
+  }
+}
+
+AVX2_TARGET static void
+mixAVX2(
+    float *d,
+    const float *x,
+    const float *y,
+    size_t &i,
+    float kr,
+    float ki)
+{
+  const __m256 vkr = _mm256_set1_ps(kr);
+  const __m256 vki = _mm256_set1_ps(ki);
+
+  for (; i >= 8; i -= 8) {
+    __m256 xr, xi, yr, yi, tr, ti;
+
+    deinterleave8(x + 2 * (i - 8), xr, xi);
+    deinterleave8(y + 2 * (i - 8), yr, yi);
+
+    tr = _mm256_fmsub_ps(yr, vkr, _mm256_mul_ps(yi, vki));
+    ti = _mm256_fmadd_ps(yr, vki, _mm256_mul_ps(yi, vkr));
+
+    interleave8(
+          d + 2 * (i - 8),
+          _mm256_fmsub_ps(xr, tr, _mm256_mul_ps(xi, ti)),
+          _mm256_fmadd_ps(xr, ti, _mm256_mul_ps(xi, tr)));
+  }
+}
+#endif // SIGDIGGER_SAMPLE_KERNELS_AVX2
+
+void
+SampleKernels::delayedConj(
+    SUCOMPLEX *dest,
+    const SUCOMPLEX *x,
+    const SUCOMPLEX *y,
+    size_t size,
+    SUFLOAT eps)
+{
+  size_t i = size;
+
+  if (singlePrecision) {
+    float *d = reinterpret_cast<float *>(dest);
+    const float *fx = reinterpret_cast<const float *>(x);
+    const float *fy = reinterpret_cast<const float *>(y);
+
+#ifdef SIGDIGGER_SAMPLE_KERNELS_AVX2
+    if (useAVX2())
+      delayedConjAVX2(d, fx, fy, i, static_cast<float>(eps));
+#endif // SIGDIGGER_SAMPLE_KERNELS_AVX2
+
+#if defined(__SSE__) || defined(__x86_64__)
+    __m128 e = _mm_set1_ps(static_cast<float>(eps));
+    __m128 one = _mm_set1_ps(1.f);
+
+    for (; i >= 4; i -= 4) {
+      const float *yp = fy + 2 * (i - 4);
+      __m128 y0 = _mm_loadu_ps(yp);
+      __m128 y1 = _mm_loadu_ps(yp + 4);
+      __m128 yr = _mm_shuffle_ps(y0, y1, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 yi = _mm_shuffle_ps(y0, y1, _MM_SHUFFLE(3, 1, 3, 1));
+      __m128 mag = _mm_sqrt_ps(
+            _mm_add_ps(_mm_mul_ps(yr, yr), _mm_mul_ps(yi, yi)));
+      __m128 kinv = _mm_div_ps(one, _mm_add_ps(mag, e));
+      __m128 re, im;
+
+      conjProductx4(fx + 2 * (i - 4), yp, re, im);
+
+      re = _mm_mul_ps(re, kinv);
+      im = _mm_mul_ps(im, kinv);
+
+      _mm_storeu_ps(d + 2 * (i - 4),     _mm_unpacklo_ps(re, im));
+      _mm_storeu_ps(d + 2 * (i - 4) + 4, _mm_unpackhi_ps(re, im));
+    }
+#elif defined(__ARM_NEON)
+    float32x4_t e = vdupq_n_f32(static_cast<float>(eps));
+
+    for (; i >= 4; i -= 4) {
+      float32x4x2_t vx = vld2q_f32(fx + 2 * (i - 4));
+      float32x4x2_t vy = vld2q_f32(fy + 2 * (i - 4));
+      float32x4x2_t out;
+      float32x4_t mag = vsqrtq_f32(
+            vmlaq_f32(vmulq_f32(vy.val[0], vy.val[0]), vy.val[1], vy.val[1]));
+      float32x4_t den = vaddq_f32(mag, e);
+      float32x4_t kinv = vrecpeq_f32(den);
+
+      kinv = vmulq_f32(vrecpsq_f32(den, kinv), kinv);
+      kinv = vmulq_f32(vrecpsq_f32(den, kinv), kinv);
+
+      out.val[0] = vmlaq_f32(
+            vmulq_f32(vx.val[0], vy.val[0]), vx.val[1], vy.val[1]);
+      out.val[1] = vmlsq_f32(
+            vmulq_f32(vx.val[1], vy.val[0]), vx.val[0], vy.val[1]);
+      out.val[0] = vmulq_f32(out.val[0], kinv);
+      out.val[1] = vmulq_f32(out.val[1], kinv);
+
+      vst2q_f32(d + 2 * (i - 4), out);
+    }
+#endif
+  }
+
+  while (i-- > 0) {
+    SUFLOAT kinv = 1. / (SU_C_ABS(y[i]) + eps);
+    dest[i] = kinv * x[i] * SU_C_CONJ(y[i]);
+  }
+}
+
+void
+SampleKernels::quadDemod(
+    SUCOMPLEX *dest,
+    const SUCOMPLEX *x,
+    const SUCOMPLEX *y,
+    size_t size,
+    SUFLOAT k,
+    bool fastArg)
+{
+  size_t i = size;
+
+  if (singlePrecision && fastArg) {
+    float *d = reinterpret_cast<float *>(dest);
+    const float *fx = reinterpret_cast<const float *>(x);
+    const float *fy = reinterpret_cast<const float *>(y);
+
+#ifdef SIGDIGGER_SAMPLE_KERNELS_AVX2
+    if (useAVX2())
+      quadDemodAVX2(d, fx, fy, i, static_cast<float>(k));
+#endif // SIGDIGGER_SAMPLE_KERNELS_AVX2
+
+#if defined(__SSE__) || defined(__x86_64__)
+    __m128 vk = _mm_set1_ps(static_cast<float>(k));
+    __m128 zero = _mm_setzero_ps();
+
+    for (; i >= 4; i -= 4) {
+      __m128 re, im, arg;
+
+      conjProductx4(fx + 2 * (i - 4), fy + 2 * (i - 4), re, im);
+      arg = _mm_mul_ps(vk, fastAtan2x4(im, re));
+
+      _mm_storeu_ps(d + 2 * (i - 4),     _mm_unpacklo_ps(zero, arg));
+      _mm_storeu_ps(d + 2 * (i - 4) + 4, _mm_unpackhi_ps(zero, arg));
+    }
+#elif defined(__ARM_NEON)
+    float32x4_t vk = vdupq_n_f32(static_cast<float>(k));
+
+    for (; i >= 4; i -= 4) {
+      float32x4x2_t vx = vld2q_f32(fx + 2 * (i - 4));
+      float32x4x2_t vy = vld2q_f32(fy + 2 * (i - 4));
+      float32x4x2_t out;
+      float32x4_t re = vmlaq_f32(
+            vmulq_f32(vx.val[0], vy.val[0]), vx.val[1], vy.val[1]);
+      float32x4_t im = vmlsq_f32(
+            vmulq_f32(vx.val[1], vy.val[0]), vx.val[0], vy.val[1]);
+
+      out.val[0] = vdupq_n_f32(0);
+      out.val[1] = vmulq_f32(vk, fastAtan2x4(im, re));
+
+      vst2q_f32(d + 2 * (i - 4), out);
+    }
+#endif
+  }
+
+  while (i-- > 0) {
+    SUCOMPLEX p = x[i] * SU_C_CONJ(y[i]);
+
+    if (fastArg)
+      dest[i] = I * k * fastAtan2(SU_C_IMAG(p), SU_C_REAL(p));
+    else
+      dest[i] = I * k * SU_C_ARG(p);
+  }
+}
+
+void
+SampleKernels::modulus(SUFLOAT *dest, const SUCOMPLEX *x, size_t size)
+{
+  size_t i = size;
+
+  if (singlePrecision) {
+    float *d = reinterpret_cast<float *>(dest);
+    const float *fx = reinterpret_cast<const float *>(x);
+
+#ifdef SIGDIGGER_SAMPLE_KERNELS_AVX2
+    if (useAVX2())
+      modulusAVX2(d, fx, i);
+#endif // SIGDIGGER_SAMPLE_KERNELS_AVX2
+
+#if defined(__SSE__) || defined(__x86_64__)
+    for (; i >= 4; i -= 4) {
+      __m128 x0 = _mm_loadu_ps(fx + 2 * (i - 4));
+      __m128 x1 = _mm_loadu_ps(fx + 2 * (i - 4) + 4);
+      __m128 xr = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 xi = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1));
+
+      _mm_storeu_ps(
+            d + i - 4,
+            _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(xr, xr), _mm_mul_ps(xi, xi))));
+    }
+#elif defined(__ARM_NEON)
+    for (; i >= 4; i -= 4) {
+      float32x4x2_t vx = vld2q_f32(fx + 2 * (i - 4));
+
+      vst1q_f32(
+            d + i - 4,
+            vsqrtq_f32(
+              vmlaq_f32(
+                vmulq_f32(vx.val[0], vx.val[0]),
+                vx.val[1],
+                vx.val[1])));
+    }
+#endif
+  }
+
+  while (i-- > 0)
+    dest[i] = SU_C_ABS(x[i]);
+}
+
+void
+SampleKernels::realPart(
+    float *dest,
+    const SUCOMPLEX *x,
+    size_t size,
+    SUFLOAT gain)
+{
+  size_t i = size;
+
+  if (singlePrecision) {
+    const float *fx = reinterpret_cast<const float *>(x);
+
+#ifdef SIGDIGGER_SAMPLE_KERNELS_AVX2
+    if (useAVX2())
+      realPartAVX2(dest, fx, i, static_cast<float>(gain));
+#endif // SIGDIGGER_SAMPLE_KERNELS_AVX2
+
+#if defined(__SSE__) || defined(__x86_64__)
+    __m128 k = _mm_set1_ps(static_cast<float>(gain));
+
+    for (; i >= 4; i -= 4) {
+      __m128 x0 = _mm_loadu_ps(fx + 2 * (i - 4));
+      __m128 x1 = _mm_loadu_ps(fx + 2 * (i - 4) + 4);
+
+      _mm_storeu_ps(
+            dest + i - 4,
+            _mm_mul_ps(k, _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0))));
+    }
+#elif defined(__ARM_NEON)
+    float32x4_t k = vdupq_n_f32(static_cast<float>(gain));
+
+    for (; i >= 4; i -= 4) {
+      float32x4x2_t vx = vld2q_f32(fx + 2 * (i - 4));
+
+      vst1q_f32(dest + i - 4, vmulq_f32(k, vx.val[0]));
+    }
+#endif
+  }
+
+  while (i-- > 0)
+    dest[i] = static_cast<float>(gain * SU_C_REAL(x[i]));
+}
+
+void
+SampleKernels::argument(
+    SUFLOAT *dest,
+    const SUCOMPLEX *x,
+    size_t size,
+    bool quadrature,
+    bool fastArg)
+{
+  size_t i = size;
+
+  // arg(I * x) = atan2(re, -im)
+  if (singlePrecision && fastArg) {
+    float *d = reinterpret_cast<float *>(dest);
+    const float *fx = reinterpret_cast<const float *>(x);
+
+#ifdef SIGDIGGER_SAMPLE_KERNELS_AVX2
+    if (useAVX2())
+      argumentAVX2(d, fx, i, quadrature);
+#endif // SIGDIGGER_SAMPLE_KERNELS_AVX2
+
+#if defined(__SSE__) || defined(__x86_64__)
+    const __m128 sign = _mm_set1_ps(-0.f);
+
+    for (; i >= 4; i -= 4) {
+      __m128 x0 = _mm_loadu_ps(fx + 2 * (i - 4));
+      __m128 x1 = _mm_loadu_ps(fx + 2 * (i - 4) + 4);
+      __m128 xr = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 xi = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1));
+
+      _mm_storeu_ps(
+            d + i - 4,
+            quadrature
+            ? fastAtan2x4(xr, _mm_xor_ps(xi, sign))
+            : fastAtan2x4(xi, xr));
+    }
+#elif defined(__ARM_NEON)
+    for (; i >= 4; i -= 4) {
+      float32x4x2_t vx = vld2q_f32(fx + 2 * (i - 4));
+
+      vst1q_f32(
+            d + i - 4,
+            quadrature
+            ? fastAtan2x4(vx.val[0], vnegq_f32(vx.val[1]))
+            : fastAtan2x4(vx.val[1], vx.val[0]));
+    }
+#endif
+  }
+
+  while (i-- > 0) {
+    SUFLOAT re = SU_C_REAL(x[i]);
+    SUFLOAT im = SU_C_IMAG(x[i]);
+
+    if (quadrature) {
+      SUFLOAT t = re;
+      re = -im;
+      im = t;
+    }
+
+    if (fastArg)
+      dest[i] = fastAtan2(im, re);
+    else
+      dest[i] = std::atan2(im, re);
+  }
+}
+
+void
+SampleKernels::mix(
+    SUCOMPLEX *dest,
+    const SUCOMPLEX *x,
+    const SUCOMPLEX *y,
+    size_t size,
+    SUCOMPLEX k)
+{
+  size_t i = size;
+
+  if (singlePrecision) {
+    float *d = reinterpret_cast<float *>(dest);
+    const float *fx = reinterpret_cast<const float *>(x);
+    const float *fy = reinterpret_cast<const float *>(y);
+    float kr = static_cast<float>(SU_C_REAL(k));
+    float ki = static_cast<float>(SU_C_IMAG(k));
+
+#ifdef SIGDIGGER_SAMPLE_KERNELS_AVX2
+    if (useAVX2())
+      mixAVX2(d, fx, fy, i, kr, ki);
+#endif // SIGDIGGER_SAMPLE_KERNELS_AVX2
+
+#if defined(__SSE__) || defined(__x86_64__)
+    __m128 vkr = _mm_set1_ps(kr);
+    __m128 vki = _mm_set1_ps(ki);
+
+    for (; i >= 4; i -= 4) {
+      __m128 x0 = _mm_loadu_ps(fx + 2 * (i - 4));
+      __m128 x1 = _mm_loadu_ps(fx + 2 * (i - 4) + 4);
+      __m128 y0 = _mm_loadu_ps(fy + 2 * (i - 4));
+      __m128 y1 = _mm_loadu_ps(fy + 2 * (i - 4) + 4);
+      __m128 xr = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 xi = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1));
+      __m128 yr = _mm_shuffle_ps(y0, y1, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 yi = _mm_shuffle_ps(y0, y1, _MM_SHUFFLE(3, 1, 3, 1));
+      __m128 tr = _mm_sub_ps(_mm_mul_ps(yr, vkr), _mm_mul_ps(yi, vki));
+      __m128 ti = _mm_add_ps(_mm_mul_ps(yr, vki), _mm_mul_ps(yi, vkr));
+      __m128 re = _mm_sub_ps(_mm_mul_ps(xr, tr), _mm_mul_ps(xi, ti));
+      __m128 im = _mm_add_ps(_mm_mul_ps(xr, ti), _mm_mul_ps(xi, tr));
+
+      _mm_storeu_ps(d + 2 * (i - 4),     _mm_unpacklo_ps(re, im));
+      _mm_storeu_ps(d + 2 * (i - 4) + 4, _mm_unpackhi_ps(re, im));
+    }
+#elif defined(__ARM_NEON)
+    float32x4_t vkr = vdupq_n_f32(kr);
+    float32x4_t vki = vdupq_n_f32(ki);
+
+    for (; i >= 4; i -= 4) {
+      float32x4x2_t vx = vld2q_f32(fx + 2 * (i - 4));
+      float32x4x2_t vy = vld2q_f32(fy + 2 * (i - 4));
+      float32x4x2_t out;
+      float32x4_t tr = vmlsq_f32(vmulq_f32(vy.val[0], vkr), vy.val[1], vki);
+      float32x4_t ti = vmlaq_f32(vmulq_f32(vy.val[0], vki), vy.val[1], vkr);
+
+      out.val[0] = vmlsq_f32(vmulq_f32(vx.val[0], tr), vx.val[1], ti);
+      out.val[1] = vmlaq_f32(vmulq_f32(vx.val[0], ti), vx.val[1], tr);
+
+      vst2q_f32(d + 2 * (i - 4), out);
+    }
+#endif
+  }
+
+  while (i-- > 0)
+    dest[i] = k * x[i] * y[i];
+}
+
+template<typename T> static inline T
+saturate(SUFLOAT x, SUFLOAT lo, SUFLOAT hi)
+{
+  if (x < lo)
+    x = lo;
+  else if (x > hi)
+    x = hi;
+
+  return static_cast<T>(std::lrint(x));
+}
+
+void
+SampleKernels::toInt16(
+    int16_t *dest,
+    const SUFLOAT *x,
+    size_t size,
+    SUFLOAT scale)
+{
+  size_t i = 0;
+
+  if (singlePrecision) {
+    const float *fx = reinterpret_cast<const float *>(x);
+
+#if defined(__SSE__) || defined(__x86_64__)
+    const __m128 k  = _mm_set1_ps(static_cast<float>(scale));
+    const __m128 lo = _mm_set1_ps(INT16_MIN);
+    const __m128 hi = _mm_set1_ps(INT16_MAX);
+    __m128i b;
+
+    for (; i + 8 <= size; i += 8) {
+      __m128i a = scaleToInt32x8(fx + i, k, lo, hi, b);
+      _mm_storeu_si128(
+            reinterpret_cast<__m128i *>(dest + i),
+            _mm_packs_epi32(a, b));
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t k  = vdupq_n_f32(static_cast<float>(scale));
+    const float32x4_t lo = vdupq_n_f32(INT16_MIN);
+    const float32x4_t hi = vdupq_n_f32(INT16_MAX);
+
+    for (; i + 8 <= size; i += 8)
+      vst1q_s16(dest + i, scaleToInt16x8(fx + i, k, lo, hi));
+#endif
+  }
+
+  for (; i < size; ++i)
+    dest[i] = saturate<int16_t>(x[i] * scale, INT16_MIN, INT16_MAX);
+}
+
+void
+SampleKernels::toInt8(
+    int8_t *dest,
+    const SUFLOAT *x,
+    size_t size,
+    SUFLOAT scale)
+{
+  size_t i = 0;
+
+  if (singlePrecision) {
+    const float *fx = reinterpret_cast<const float *>(x);
+
+#if defined(__SSE__) || defined(__x86_64__)
+    const __m128 k  = _mm_set1_ps(static_cast<float>(scale));
+    const __m128 lo = _mm_set1_ps(INT8_MIN);
+    const __m128 hi = _mm_set1_ps(INT8_MAX);
+    __m128i b, d;
+
+    for (; i + 16 <= size; i += 16) {
+      __m128i a = scaleToInt32x8(fx + i, k, lo, hi, b);
+      __m128i c = scaleToInt32x8(fx + i + 8, k, lo, hi, d);
+      _mm_storeu_si128(
+            reinterpret_cast<__m128i *>(dest + i),
+            _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t k  = vdupq_n_f32(static_cast<float>(scale));
+    const float32x4_t lo = vdupq_n_f32(INT8_MIN);
+    const float32x4_t hi = vdupq_n_f32(INT8_MAX);
+
+    for (; i + 16 <= size; i += 16)
+      vst1q_s8(
+            dest + i,
+            vcombine_s8(
+              vqmovn_s16(scaleToInt16x8(fx + i, k, lo, hi)),
+              vqmovn_s16(scaleToInt16x8(fx + i + 8, k, lo, hi))));
+#endif
+  }
+
+  for (; i < size; ++i)
+    dest[i] = saturate<int8_t>(x[i] * scale, INT8_MIN, INT8_MAX);
+}
+
+#if defined(__SSE__) || defined(__x86_64__)
+// Bit i of x to bit 2i
+static inline uint32_t
+spreadBits16(uint32_t x)
+{
+  x = (x | (x << 8)) & 0x00ff00ff;
+  x = (x | (x << 4)) & 0x0f0f0f0f;
+  x = (x | (x << 2)) & 0x33333333;
+  x = (x | (x << 1)) & 0x55555555;
+
+  return x;
+}
+#endif
+
+size_t
+SampleKernels::packSymbols(
+    uint8_t *dest,
+    const uint8_t *symbols,
+    size_t size,
+    unsigned int bps)
+{
+  unsigned int mask = (1u << bps) - 1;
+  unsigned int acc = 0, bits = 0;
+  size_t i = 0, n = 0;
+
+#if defined(__SSE__) || defined(__x86_64__)
+  // Every 16 symbols make whole bytes: the scalar loop below starts
+  // byte-aligned. movemask takes the top bit of each byte, which the
+  // shifts fill with the bit of interest of that same byte.
+  if (bps == 1) {
+    for (; i + 16 <= size; i += 16) {
+      __m128i v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(symbols + i));
+      int m = _mm_movemask_epi8(_mm_slli_epi16(v, 7));
+
+      dest[n++] = static_cast<uint8_t>(m);
+      dest[n++] = static_cast<uint8_t>(m >> 8);
+    }
+  } else if (bps == 2) {
+    for (; i + 16 <= size; i += 16) {
+      __m128i v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(symbols + i));
+      uint32_t b0 = static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_slli_epi16(v, 7)));
+      uint32_t b1 = static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_slli_epi16(v, 6)));
+      uint32_t w = spreadBits16(b0) | (spreadBits16(b1) << 1);
+
+      dest[n++] = static_cast<uint8_t>(w);
+      dest[n++] = static_cast<uint8_t>(w >> 8);
+      dest[n++] = static_cast<uint8_t>(w >> 16);
+      dest[n++] = static_cast<uint8_t>(w >> 24);
+    }
+  } else if (bps == 4) {
+    // Pairs as 16-bit lanes: even | odd << 8 becomes even | odd << 4
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i low    = _mm_set1_epi16(0x00ff);
+    const __m128i high   = _mm_set1_epi16(0x00f0);
+
+    for (; i + 16 <= size; i += 16) {
+      __m128i v = _mm_and_si128(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(symbols + i)),
+            nibble);
+      __m128i p = _mm_or_si128(
+            _mm_and_si128(v, low),
+            _mm_and_si128(_mm_srli_epi16(v, 4), high));
+
+      _mm_storel_epi64(
+            reinterpret_cast<__m128i *>(dest + n),
+            _mm_packus_epi16(p, _mm_setzero_si128()));
+      n += 8;
+    }
+  }
+#endif
+
+  for (; i < size; ++i) {
+    acc  |= (symbols[i] & mask) << bits;
+    bits += bps;
+
+    while (bits >= 8) {
+      dest[n++] = static_cast<uint8_t>(acc);
+      acc  >>= 8;
+      bits -= 8;
+    }
+  }
+
+  if (bits > 0)
+    dest[n++] = static_cast<uint8_t>(acc);
+
+  return n;
+}
@@ -0,0 +1,165 @@
+//
+//    SampleStatistics.cpp: Constant-time statistics over sample ranges
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "SampleStatistics.h"
+#include <cmath>
+
+// Blocks summed between two looks at the cancel flag
+#define SIGDIGGER_SAMPLE_STATISTICS_CANCEL_BLOCKS 1024
+
+using namespace SigDigger;
+
+SampleStatistics::SampleStatistics(const SUCOMPLEX *data, size_t length)
+{
+  this->data   = data;
+  this->length = length;
+
+  this->cancelFlag.store(false);
+  this->readyFlag.store(false);
+}
+
+void
+SampleStatistics::scan(Sums &sums, size_t start, size_t end) const
+{
+  for (size_t i = start; i < end; ++i) {
+    SUDOUBLE re = static_cast<SUDOUBLE>(SU_C_REAL(this->data[i]));
+    SUDOUBLE im = static_cast<SUDOUBLE>(SU_C_IMAG(this->data[i]));
+
+    sums.i      += re;
+    sums.q      += im;
+    sums.energy += re * re + im * im;
+  }
+}
+
+void
+SampleStatistics::build(std::function<void (void)> const &onReady)
+{
+  size_t blocks = this->length / SIGDIGGER_SAMPLE_STATISTICS_BLOCK;
+  Sums acc;
+
+  {
+    std::lock_guard<std::mutex> guard(this->stateMutex);
+
+    if (this->cancelFlag.load())
+      return;
+
+    this->running = true;
+  }
+
+  this->prefix.resize(blocks + 1);
+  this->prefix[0] = acc;
+
+  for (size_t k = 0; k < blocks; ++k) {
+    if (k % SIGDIGGER_SAMPLE_STATISTICS_CANCEL_BLOCKS == 0
+        && this->cancelFlag.load(std::memory_order_relaxed))
+      break;
+
+    // Each block is summed on its own and then added. This keeps rounding
+    // errors from growing with the position in the capture.
+    Sums block;
+    this->scan(
+          block,
+          k * SIGDIGGER_SAMPLE_STATISTICS_BLOCK,
+          (k + 1) * SIGDIGGER_SAMPLE_STATISTICS_BLOCK);
+
+    acc.i      += block.i;
+    acc.q      += block.q;
+    acc.energy += block.energy;
+
+    this->prefix[k + 1] = acc;
+  }
+
+  if (!this->cancelFlag.load(std::memory_order_relaxed)) {
+    this->readyFlag.store(true, std::memory_order_release);
+
+    if (onReady)
+      onReady();
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(this->stateMutex);
+    this->running = false;
+  }
+
+  this->stateCond.notify_all();
+}
+
+void
+SampleStatistics::cancel(void)
+{
+  this->cancelFlag.store(true, std::memory_order_relaxed);
+}
+
+void
+SampleStatistics::stop(void)
+{
+  std::unique_lock<std::mutex> lock(this->stateMutex);
+
+  this->cancelFlag.store(true);
+  this->stateCond.wait(lock, [this] () { return !this->running; });
+}
+
+bool
+SampleStatistics::compute(
+    qint64 start,
+    qint64 end,
+    SUCOMPLEX &mean,
+    SUFLOAT &rms) const
+{
+  size_t first, last, kFirst, kLast;
+  Sums sums;
+  SUDOUBLE count;
+
+  if (!this->isReady())
+    return false;
+
+  if (start < 0)
+    start = 0;
+  if (end > static_cast<qint64>(this->length))
+    end = static_cast<qint64>(this->length);
+
+  if (end <= start)
+    return false;
+
+  first  = static_cast<size_t>(start);
+  last   = static_cast<size_t>(end);
+  kFirst = (first + SIGDIGGER_SAMPLE_STATISTICS_BLOCK - 1)
+      / SIGDIGGER_SAMPLE_STATISTICS_BLOCK;
+  kLast  = last / SIGDIGGER_SAMPLE_STATISTICS_BLOCK;
+
+  if (kFirst >= kLast) {
+    // Within (at most) two neighbouring blocks
+    this->scan(sums, first, last);
+  } else {
+    sums.i      = this->prefix[kLast].i      - this->prefix[kFirst].i;
+    sums.q      = this->prefix[kLast].q      - this->prefix[kFirst].q;
+    sums.energy = this->prefix[kLast].energy - this->prefix[kFirst].energy;
+
+    this->scan(sums, first, kFirst * SIGDIGGER_SAMPLE_STATISTICS_BLOCK);
+    this->scan(sums, kLast * SIGDIGGER_SAMPLE_STATISTICS_BLOCK, last);
+  }
+
+  count = static_cast<SUDOUBLE>(last - first);
+
+  mean = SUCOMPLEX(
+        static_cast<SUFLOAT>(sums.i / count),
+        static_cast<SUFLOAT>(sums.q / count));
+  rms  = static_cast<SUFLOAT>(std::sqrt(std::fmax(sums.energy / count, 0.)));
+
+  return true;
+}
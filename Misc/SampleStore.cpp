@@ -0,0 +1,225 @@
+//
+//    Misc/SampleStore.cpp: Paged sample storage with disk spill
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "SampleStore.h"
+#include <QTemporaryFile>
+#include <QDir>
+#include <QMutexLocker>
+#include <cstring>
+#include <Suscan/Library.h>
+
+#define PAGE_BYTES \
+  (static_cast<qint64>(SIGDIGGER_SAMPLE_STORE_PAGE_SAMPLES) \
+   * static_cast<qint64>(sizeof(SUCOMPLEX)))
+
+using namespace SigDigger;
+
+SampleStore::SampleStore()
+{
+}
+
+SampleStore::~SampleStore()
+{
+  delete this->spillFile;
+}
+
+bool
+SampleStore::ensureSpillFile(void)
+{
+  if (this->spillFile != nullptr)
+    return true;
+
+  if (this->spillFailed)
+    return false;
+
+  this->spillFile = new QTemporaryFile(
+        QDir::tempPath() + "/sigdigger-samples-XXXXXX.raw");
+
+  if (!this->spillFile->open()) {
+    SU_WARNING(
+          "Cannot create sample spill file: %s\n",
+          this->spillFile->errorString().toStdString().c_str());
+    delete this->spillFile;
+    this->spillFile = nullptr;
+    this->spillFailed = true;
+    return false;
+  }
+
+  return true;
+}
+
+//
+// Pages are spilled in order, so page i always lives at i * PAGE_BYTES in
+// the spill file. If the file cannot be written, pages just stay in RAM.
+// Called with the mutex held.
+//
+void
+SampleStore::spill(void)
+{
+  while (this->ramLimit > 0
+         && static_cast<quint64>(this->ramPages) * PAGE_BYTES > this->ramLimit
+         && this->firstInRam + 1 < this->pages.size()) {
+    Page &page = this->pages[this->firstInRam];
+
+    if (!this->ensureSpillFile())
+      return;
+
+    if (!this->spillFile->seek(
+          static_cast<qint64>(this->firstInRam) * PAGE_BYTES)
+        || this->spillFile->write(
+          reinterpret_cast<const char *>(page.data.get()),
+          PAGE_BYTES) != PAGE_BYTES) {
+      SU_WARNING(
+            "Cannot spill samples to disk: %s\n",
+            this->spillFile->errorString().toStdString().c_str());
+      this->spillFailed = true;
+      return;
+    }
+
+    page.data.reset();
+    page.spilled = true;
+    --this->ramPages;
+    ++this->firstInRam;
+  }
+}
+
+void
+SampleStore::setRamLimit(quint64 bytes)
+{
+  QMutexLocker locker(&this->mutex);
+
+  this->ramLimit = bytes;
+  this->spill();
+}
+
+void
+SampleStore::append(const SUCOMPLEX *data, size_t size)
+{
+  QMutexLocker locker(&this->mutex);
+
+  while (size > 0) {
+    size_t inPage = this->count % SIGDIGGER_SAMPLE_STORE_PAGE_SAMPLES;
+    size_t chunk = SIGDIGGER_SAMPLE_STORE_PAGE_SAMPLES - inPage;
+
+    if (inPage == 0) {
+      Page page;
+      page.data.reset(new SUCOMPLEX[SIGDIGGER_SAMPLE_STORE_PAGE_SAMPLES]);
+      this->pages.push_back(std::move(page));
+      ++this->ramPages;
+    }
+
+    if (chunk > size)
+      chunk = size;
+
+    std::memcpy(
+          this->pages.back().data.get() + inPage,
+          data,
+          chunk * sizeof(SUCOMPLEX));
+
+    this->count += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+
+  this->spill();
+}
+
+void
+SampleStore::clear(void)
+{
+  QMutexLocker locker(&this->mutex);
+
+  this->pages.clear();
+  this->count = 0;
+  this->ramPages = 0;
+  this->firstInRam = 0;
+
+  if (this->spillFile != nullptr) {
+    delete this->spillFile;
+    this->spillFile = nullptr;
+  }
+
+  this->spillFailed = false;
+}
+
+size_t
+SampleStore::size(void) const
+{
+  QMutexLocker locker(&this->mutex);
+
+  return this->count;
+}
+
+quint64
+SampleStore::getRamUsage(void) const
+{
+  QMutexLocker locker(&this->mutex);
+
+  return static_cast<quint64>(this->ramPages) * PAGE_BYTES;
+}
+
+quint64
+SampleStore::getSpilledBytes(void) const
+{
+  QMutexLocker locker(&this->mutex);
+
+  return static_cast<quint64>(this->firstInRam) * PAGE_BYTES;
+}
+
+size_t
+SampleStore::read(size_t offset, SUCOMPLEX *dest, size_t size)
+{
+  QMutexLocker locker(&this->mutex);
+  size_t copied = 0;
+
+  if (offset >= this->count)
+    return 0;
+
+  if (size > this->count - offset)
+    size = this->count - offset;
+
+  while (copied < size) {
+    size_t index  = offset / SIGDIGGER_SAMPLE_STORE_PAGE_SAMPLES;
+    size_t inPage = offset % SIGDIGGER_SAMPLE_STORE_PAGE_SAMPLES;
+    size_t chunk  = SIGDIGGER_SAMPLE_STORE_PAGE_SAMPLES - inPage;
+    Page &page = this->pages[index];
+
+    if (chunk > size - copied)
+      chunk = size - copied;
+
+    if (page.spilled) {
+      qint64 bytes = static_cast<qint64>(chunk * sizeof(SUCOMPLEX));
+
+      if (!this->spillFile->seek(
+            static_cast<qint64>(index) * PAGE_BYTES
+            + static_cast<qint64>(inPage * sizeof(SUCOMPLEX)))
+          || this->spillFile->read(reinterpret_cast<char *>(dest), bytes)
+             != bytes)
+        break;
+    } else {
+      std::memcpy(dest, page.data.get() + inPage, chunk * sizeof(SUCOMPLEX));
+    }
+
+    copied += chunk;
+    offset += chunk;
+    dest   += chunk;
+  }
+
+  return copied;
+}
@@ -0,0 +1,85 @@
+//
+//    ScratchArena.cpp: Per-frame scratch memory for sample paths
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "ScratchArena.h"
+
+using namespace SigDigger;
+
+// Worst case room for aligning the start of a request
+#define ALIGN_SLACK (SIGDIGGER_SCRATCH_ARENA_ALIGN - 1)
+
+static inline uint8_t *
+alignUp(uint8_t *ptr)
+{
+  uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+
+  addr = (addr + ALIGN_SLACK) & ~static_cast<uintptr_t>(ALIGN_SLACK);
+
+  return reinterpret_cast<uint8_t *>(addr);
+}
+
+ScratchArena::ScratchArena(size_t size)
+{
+  this->blockSize = size + ALIGN_SLACK;
+  this->block     = std::unique_ptr<uint8_t[]>(new uint8_t[this->blockSize]);
+}
+
+void *
+ScratchArena::take(size_t bytes)
+{
+  uint8_t *base = this->block.get();
+  uint8_t *ptr  = alignUp(base + this->used);
+
+  if (bytes == 0)
+    bytes = 1;
+
+  if (ptr + bytes <= base + this->blockSize) {
+    this->used = static_cast<size_t>(ptr - base) + bytes;
+    return ptr;
+  }
+
+  // Does not fit. Earlier requests must stay where they are, so this one
+  // gets a block of its own until the next reset().
+  this->overflow.emplace_back(new uint8_t[bytes + ALIGN_SLACK]);
+  this->overflowSize += bytes + ALIGN_SLACK;
+
+  return alignUp(this->overflow.back().get());
+}
+
+void
+ScratchArena::reset(void)
+{
+  if (!this->overflow.empty()) {
+    size_t needed = this->used + this->overflowSize;
+
+    this->overflow.clear();
+    this->overflowSize = 0;
+
+    // With some headroom, so frames slightly larger than this one fit too
+    this->blockSize = needed + needed / 2 + ALIGN_SLACK;
+    this->block     = std::unique_ptr<uint8_t[]>(new uint8_t[this->blockSize]);
+  }
+
+  this->used = 0;
+}
+
+size_t
+ScratchArena::capacity(void) const
+{
+  return this->blockSize - ALIGN_SLACK;
+}
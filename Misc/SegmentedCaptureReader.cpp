@@ -0,0 +1,358 @@
+//
+//    SegmentedCaptureReader.cpp: Seekable reader of segmented captures
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "SegmentedCaptureReader.h"
+#include "SegmentedDataSaver.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+
+#define SIGDIGGER_SEGMENTED_READER_EXTRACT_SAMPLES 65536
+
+using namespace SigDigger;
+
+SegmentedCaptureReader::SegmentedCaptureReader()
+{
+}
+
+SegmentedCaptureReader::~SegmentedCaptureReader()
+{
+  this->close();
+}
+
+void
+SegmentedCaptureReader::close(void)
+{
+  if (this->fd != -1) {
+    ::close(this->fd);
+    this->fd = -1;
+  }
+
+  this->segments.clear();
+  this->events.clear();
+  this->pos = 0;
+  this->current = 0;
+}
+
+bool
+SegmentedCaptureReader::open(std::string const &indexPath)
+{
+  std::ifstream index(indexPath);
+  std::string dir, line, keyword, name;
+  size_t p = indexPath.rfind('/');
+
+  this->close();
+
+  if (!index.is_open()) {
+    this->lastError = "Cannot open capture index: "
+        + std::string(strerror(errno));
+    return false;
+  }
+
+  if (p != std::string::npos)
+    dir = indexPath.substr(0, p + 1);
+
+  while (std::getline(index, line)) {
+    std::istringstream fields(line);
+
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    fields >> keyword;
+
+    if (keyword == "version") {
+      int version = 0;
+      fields >> version;
+      if (version > SIGDIGGER_SEGMENTED_INDEX_VERSION) {
+        this->lastError = "Unsupported capture index version";
+        return false;
+      }
+    } else if (keyword == "format") {
+      fields >> name;
+      if (name != "float32_iq") {
+        this->lastError = "Unsupported capture format " + name;
+        return false;
+      }
+    } else if (keyword == "rate") {
+      fields >> this->rate;
+    } else if (keyword == "start") {
+      fields >> this->startTime;
+    } else if (keyword == "segment") {
+      Segment segment;
+      fields >> segment.first >> segment.time >> name;
+      segment.path = dir + name;
+      segment.length = 0;
+      this->segments.push_back(segment);
+    } else if (keyword == "drop") {
+      fields >> name;
+      this->segments.erase(
+            std::remove_if(
+              this->segments.begin(),
+              this->segments.end(),
+              [&] (Segment const &s) { return s.path == dir + name; }),
+            this->segments.end());
+    } else if (keyword == "freq") {
+      Event event;
+      fields >> event.sample >> event.value;
+      this->events.push_back(event);
+    } else if (keyword == "gain") {
+      Event event;
+      fields >> event.sample >> event.gain >> event.value;
+      this->events.push_back(event);
+    }
+  }
+
+  if (this->rate == 0) {
+    this->lastError = "Capture index has no sample rate";
+    return false;
+  }
+
+  // Lengths come from the files themselves: the last segment of a capture
+  // still being recorded (or interrupted) is shorter than the index says
+  for (auto &segment : this->segments) {
+    struct stat sbuf;
+
+    if (stat(segment.path.c_str(), &sbuf) == 0)
+      segment.length = static_cast<quint64>(sbuf.st_size) / sizeof(SUCOMPLEX);
+  }
+
+  if (this->segments.empty()) {
+    this->lastError = "Capture has no segments left";
+    return false;
+  }
+
+  return this->seek(this->getFirstSample());
+}
+
+quint64
+SegmentedCaptureReader::getFirstSample(void) const
+{
+  return this->segments.empty() ? 0 : this->segments.front().first;
+}
+
+quint64
+SegmentedCaptureReader::getEndSample(void) const
+{
+  if (this->segments.empty())
+    return 0;
+
+  return this->segments.back().first + this->segments.back().length;
+}
+
+quint64
+SegmentedCaptureReader::tell(void) const
+{
+  return this->pos;
+}
+
+SUFREQ
+SegmentedCaptureReader::getFrequencyAt(quint64 sample) const
+{
+  SUFREQ freq = 0;
+
+  for (auto const &event : this->events) {
+    if (event.sample > sample)
+      break;
+    if (event.gain.empty())
+      freq = event.value;
+  }
+
+  return freq;
+}
+
+bool
+SegmentedCaptureReader::getGainAt(
+    quint64 sample,
+    std::string const &name,
+    SUFLOAT &value) const
+{
+  bool found = false;
+
+  for (auto const &event : this->events) {
+    if (event.sample > sample)
+      break;
+    if (event.gain == name) {
+      value = static_cast<SUFLOAT>(event.value);
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+// Last segment starting at or before sample
+size_t
+SegmentedCaptureReader::findSegment(quint64 sample) const
+{
+  auto it = std::upper_bound(
+        this->segments.begin(),
+        this->segments.end(),
+        sample,
+        [] (quint64 s, Segment const &seg) { return s < seg.first; });
+
+  return it == this->segments.begin()
+      ? 0
+      : static_cast<size_t>(it - this->segments.begin()) - 1;
+}
+
+bool
+SegmentedCaptureReader::openSegment(size_t index)
+{
+  if (this->fd != -1 && this->current == index)
+    return true;
+
+  if (this->fd != -1)
+    ::close(this->fd);
+
+  this->current = index;
+
+  if ((this->fd = ::open(this->segments[index].path.c_str(), O_RDONLY)) == -1) {
+    this->lastError = "Cannot open capture segment: "
+        + std::string(strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+bool
+SegmentedCaptureReader::seek(quint64 sample)
+{
+  if (sample < this->getFirstSample() || sample > this->getEndSample()) {
+    this->lastError = "Sample out of capture bounds";
+    return false;
+  }
+
+  if (!this->openSegment(this->findSegment(sample)))
+    return false;
+
+  this->pos = sample;
+
+  return true;
+}
+
+bool
+SegmentedCaptureReader::seekTime(SUDOUBLE unixTime)
+{
+  SUDOUBLE offset = (unixTime - this->startTime) * this->rate;
+
+  if (offset < 0)
+    offset = 0;
+
+  return this->seek(
+        std::max(
+          static_cast<quint64>(offset),
+          this->getFirstSample()));
+}
+
+ssize_t
+SegmentedCaptureReader::read(SUCOMPLEX *data, size_t len)
+{
+  size_t got = 0;
+
+  while (got < len && this->pos < this->getEndSample()) {
+    Segment const *seg;
+    quint64 offset, avail;
+    ssize_t result;
+
+    if (!this->openSegment(this->findSegment(this->pos)))
+      return -1;
+
+    seg    = &this->segments[this->current];
+    offset = this->pos - seg->first;
+
+    // Past this segment (gap left by an interrupted one), go to the next
+    if (offset >= seg->length) {
+      if (this->current + 1 >= this->segments.size())
+        break;
+      this->pos = this->segments[this->current + 1].first;
+      continue;
+    }
+
+    avail = std::min<quint64>(seg->length - offset, len - got);
+
+    result = pread(
+          this->fd,
+          data + got,
+          static_cast<size_t>(avail) * sizeof(SUCOMPLEX),
+          static_cast<off_t>(offset * sizeof(SUCOMPLEX)));
+
+    if (result < 0) {
+      this->lastError = "pread() failed: " + std::string(strerror(errno));
+      return -1;
+    }
+
+    if (result < static_cast<ssize_t>(sizeof(SUCOMPLEX)))
+      break;
+
+    got       += static_cast<size_t>(result) / sizeof(SUCOMPLEX);
+    this->pos += static_cast<quint64>(result) / sizeof(SUCOMPLEX);
+  }
+
+  return static_cast<ssize_t>(got);
+}
+
+bool
+SegmentedCaptureReader::extract(
+    quint64 from,
+    quint64 count,
+    std::string const &path)
+{
+  std::vector<SUCOMPLEX> buffer(SIGDIGGER_SEGMENTED_READER_EXTRACT_SAMPLES);
+  FILE *fp;
+  ssize_t got;
+  bool ok = true;
+
+  if (!this->seek(from))
+    return false;
+
+  if ((fp = fopen(path.c_str(), "wb")) == nullptr) {
+    this->lastError = "Cannot create " + path + ": " + strerror(errno);
+    return false;
+  }
+
+  while (count > 0) {
+    got = this->read(
+          buffer.data(),
+          static_cast<size_t>(std::min<quint64>(count, buffer.size())));
+
+    if (got <= 0) {
+      ok = got == 0;
+      break;
+    }
+
+    if (fwrite(buffer.data(), sizeof(SUCOMPLEX), static_cast<size_t>(got), fp)
+        != static_cast<size_t>(got)) {
+      this->lastError = "fwrite() failed: " + std::string(strerror(errno));
+      ok = false;
+      break;
+    }
+
+    count -= static_cast<quint64>(got);
+  }
+
+  ok = fclose(fp) == 0 && ok;
+
+  return ok;
+}
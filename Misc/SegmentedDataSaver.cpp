@@ -0,0 +1,336 @@
+//
+//    SegmentedDataSaver.cpp: Capture saver writing rotating segments and an index
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "SegmentedDataSaver.h"
+#include <QMutexLocker>
+#include <deque>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/time.h>
+
+using namespace SigDigger;
+
+namespace SigDigger {
+  class SegmentedDataWriter : public GenericDataWriter {
+    std::string base;
+    unsigned int rate;
+    quint64 segmentBytes;
+    unsigned int retention;
+    double startTime;
+
+    int fd = -1;
+    FILE *index = nullptr;
+    unsigned int segment = 0;
+    quint64 segmentUsed = 0;
+    quint64 written = 0;
+    std::deque<std::string> alive;
+    std::string lastError;
+
+    // Tuning events come from the GUI thread, segments from the worker
+    QMutex indexMutex;
+
+    bool openSegment(void);
+    void closeSegment(void);
+
+  public:
+    SegmentedDataWriter(
+        std::string const &base,
+        unsigned int rate,
+        SUFREQ freq,
+        quint64 segmentBytes,
+        unsigned int retention);
+
+    void noteFrequency(quint64 sample, SUFREQ freq);
+    void noteGain(quint64 sample, std::string const &name, SUFLOAT value);
+
+    bool prepare(void) override;
+    bool canWrite(void) const override;
+    std::string getError(void) const override;
+    ssize_t write(const void *data, size_t len) override;
+    bool close(void) override;
+    ~SegmentedDataWriter() override;
+  };
+}
+
+// Only the base name goes to the index, so the capture can be moved
+static std::string
+baseName(std::string const &path)
+{
+  size_t p = path.rfind('/');
+
+  return p == std::string::npos ? path : path.substr(p + 1);
+}
+
+SegmentedDataWriter::SegmentedDataWriter(
+    std::string const &base,
+    unsigned int rate,
+    SUFREQ freq,
+    quint64 segmentBytes,
+    unsigned int retention)
+{
+  std::string indexPath = base + SIGDIGGER_SEGMENTED_INDEX_EXTENSION;
+  struct timeval tv;
+
+  gettimeofday(&tv, nullptr);
+
+  this->base         = base;
+  this->rate         = rate;
+  this->retention    = retention;
+  this->startTime    = tv.tv_sec + 1e-6 * tv.tv_usec;
+
+  // Segments end at sample boundaries
+  this->segmentBytes = segmentBytes - segmentBytes % sizeof(SUCOMPLEX);
+  if (this->segmentBytes == 0)
+    this->segmentBytes = sizeof(SUCOMPLEX);
+
+  if ((this->index = fopen(indexPath.c_str(), "w")) == nullptr) {
+    this->lastError = "Cannot create capture index: "
+        + std::string(strerror(errno));
+    return;
+  }
+
+  fprintf(this->index, "# SigDigger segmented capture index\n");
+  fprintf(this->index, "version %d\n", SIGDIGGER_SEGMENTED_INDEX_VERSION);
+  fprintf(this->index, "format float32_iq\n");
+  fprintf(this->index, "rate %u\n", rate);
+  fprintf(this->index, "start %.6lf\n", this->startTime);
+  fprintf(this->index, "freq 0 %.0lf\n", freq);
+
+  this->openSegment();
+}
+
+bool
+SegmentedDataWriter::openSegment(void)
+{
+  char suffix[32];
+  std::string path;
+  quint64 first = this->written / sizeof(SUCOMPLEX);
+
+  snprintf(suffix, sizeof(suffix), "_%05u", this->segment++);
+  path = this->base + suffix + SIGDIGGER_SEGMENTED_SEGMENT_EXTENSION;
+
+  if ((this->fd = creat(path.c_str(), 0600)) == -1) {
+    this->lastError = "Cannot create capture segment: "
+        + std::string(strerror(errno));
+    return false;
+  }
+
+  this->segmentUsed = 0;
+  this->alive.push_back(path);
+
+  QMutexLocker locker(&this->indexMutex);
+
+  fprintf(
+        this->index,
+        "segment %llu %.6lf %s\n",
+        static_cast<unsigned long long>(first),
+        this->startTime + static_cast<double>(first) / this->rate,
+        baseName(path).c_str());
+
+  // Retention policy: forget the oldest segments
+  while (this->retention > 0 && this->alive.size() > this->retention) {
+    unlink(this->alive.front().c_str());
+    fprintf(this->index, "drop %s\n", baseName(this->alive.front()).c_str());
+    this->alive.pop_front();
+  }
+
+  fflush(this->index);
+
+  return true;
+}
+
+void
+SegmentedDataWriter::closeSegment(void)
+{
+  if (this->fd != -1) {
+    ::close(this->fd);
+    this->fd = -1;
+  }
+}
+
+void
+SegmentedDataWriter::noteFrequency(quint64 sample, SUFREQ freq)
+{
+  QMutexLocker locker(&this->indexMutex);
+
+  if (this->index != nullptr) {
+    fprintf(
+          this->index,
+          "freq %llu %.0lf\n",
+          static_cast<unsigned long long>(sample),
+          freq);
+    fflush(this->index);
+  }
+}
+
+void
+SegmentedDataWriter::noteGain(
+    quint64 sample,
+    std::string const &name,
+    SUFLOAT value)
+{
+  QMutexLocker locker(&this->indexMutex);
+
+  if (this->index != nullptr) {
+    fprintf(
+          this->index,
+          "gain %llu %s %g\n",
+          static_cast<unsigned long long>(sample),
+          name.c_str(),
+          static_cast<double>(value));
+    fflush(this->index);
+  }
+}
+
+bool
+SegmentedDataWriter::prepare(void)
+{
+  return this->fd != -1;
+}
+
+bool
+SegmentedDataWriter::canWrite(void) const
+{
+  return this->fd != -1;
+}
+
+std::string
+SegmentedDataWriter::getError(void) const
+{
+  return this->lastError;
+}
+
+ssize_t
+SegmentedDataWriter::write(const void *data, size_t len)
+{
+  ssize_t result;
+
+  if (this->fd == -1)
+    return 0;
+
+  if (this->segmentUsed == this->segmentBytes) {
+    this->closeSegment();
+    if (!this->openSegment())
+      return -1;
+  }
+
+  // Never across a segment boundary. The caller writes the rest.
+  if (len > this->segmentBytes - this->segmentUsed)
+    len = static_cast<size_t>(this->segmentBytes - this->segmentUsed);
+
+  result = ::write(this->fd, data, len);
+
+  if (result < 1) {
+    this->lastError = "write() failed: " + std::string(strerror(errno));
+  } else {
+    this->segmentUsed += static_cast<quint64>(result);
+    this->written     += static_cast<quint64>(result);
+  }
+
+  return result;
+}
+
+bool
+SegmentedDataWriter::close(void)
+{
+  QMutexLocker locker(&this->indexMutex);
+  bool ok = true;
+
+  if (this->fd != -1)
+    ok = ::close(this->fd) == 0;
+
+  this->fd = -1;
+
+  if (this->index != nullptr) {
+    fprintf(
+          this->index,
+          "end %llu\n",
+          static_cast<unsigned long long>(this->written / sizeof(SUCOMPLEX)));
+    ok = fclose(this->index) == 0 && ok;
+    this->index = nullptr;
+  }
+
+  return ok;
+}
+
+SegmentedDataWriter::~SegmentedDataWriter()
+{
+  this->close();
+}
+
+//////////////////////////// SegmentedDataSaver ////////////////////////////////
+SegmentedDataSaver::SegmentedDataSaver(
+    std::string const &base,
+    unsigned int rate,
+    SUFREQ freq,
+    quint64 segmentBytes,
+    unsigned int retention,
+    QObject *parent) :
+  GenericDataSaver(
+    this->writer = new SegmentedDataWriter(
+      base,
+      rate,
+      freq,
+      segmentBytes,
+      retention),
+    parent)
+{
+  this->setSampleRate(rate);
+  this->tracker.set("Segmented IQ recording", true);
+}
+
+SegmentedDataSaver::~SegmentedDataSaver()
+{
+  this->finish();
+
+  if (this->writer != nullptr)
+    delete this->writer;
+}
+
+quint64
+SegmentedDataSaver::currentSample(void) const
+{
+  return this->getAcceptedSize() / sizeof(SUCOMPLEX);
+}
+
+bool
+SegmentedDataSaver::isOpen(void) const
+{
+  return this->writer->canWrite();
+}
+
+std::string
+SegmentedDataSaver::getError(void) const
+{
+  return this->writer->getError();
+}
+
+void
+SegmentedDataSaver::noteFrequency(SUFREQ freq)
+{
+  this->writer->noteFrequency(this->currentSample(), freq);
+}
+
+void
+SegmentedDataSaver::noteGain(std::string const &name, SUFLOAT value)
+{
+  this->writer->noteGain(this->currentSample(), name, value);
+}
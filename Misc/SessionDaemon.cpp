@@ -0,0 +1,848 @@
+//
+//    SessionDaemon.cpp: Headless recording and forwarding daemon
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <SessionDaemon.h>
+#include <SessionSnapshot.h>
+#include <FileDataSaver.h>
+#include <ThreadPolicy.h>
+#include <SuWidgetsHelpers.h>
+#include <Suscan/Library.h>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QFile>
+#include <QDir>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+using namespace SigDigger;
+
+static volatile sig_atomic_t g_stopRequested = 0;
+
+static void
+onTerminationSignal(int)
+{
+  g_stopRequested = 1;
+}
+
+///////////////////////////////// DaemonParams ////////////////////////////////
+void
+DaemonParams::help(const char *argv0)
+{
+  fprintf(stderr, "%s: SigDigger headless recording and forwarding daemon\n", argv0);
+  fprintf(stderr, "Usage:\n");
+  fprintf(stderr, "  %s -t Daemon -- [options] SESSION\n\n", argv0);
+
+  fprintf(stderr, "Options:\n\n");
+  fprintf(stderr, "     -p, --profile=NAME      Source profile (default: the session's)\n");
+  fprintf(stderr, "     -d, --duration=SECONDS  Stop after this long (default: never)\n");
+  fprintf(stderr, "     -s, --status=SECONDS    Status report period, 0 to disable\n");
+  fprintf(stderr, "                             (default: %d)\n",
+          SIGDIGGER_DAEMON_DEFAULT_STATUS_S);
+  fprintf(stderr, "     -h, --help              This help\n\n");
+
+  fprintf(stderr, "SESSION is a JSON file like the following:\n\n");
+  fprintf(stderr, "  {\n");
+  fprintf(stderr, "    \"profile\": \"My SDR\",\n");
+  fprintf(stderr, "    \"frequency\": 145800000,\n");
+  fprintf(stderr, "    \"threads\": {\n");
+  fprintf(stderr, "      \"analyzer\": { \"cpus\": \"2\" },\n");
+  fprintf(stderr, "      \"io\": { \"cpus\": \"3\", \"priority\": 10 }\n");
+  fprintf(stderr, "    },\n");
+  fprintf(stderr, "    \"channels\": [\n");
+  fprintf(stderr, "      {\n");
+  fprintf(stderr, "        \"class\": \"raw\",\n");
+  fprintf(stderr, "        \"frequency\": 145825000,\n");
+  fprintf(stderr, "        \"bandwidth\": 25000,\n");
+  fprintf(stderr, "        \"params\": { },\n");
+  fprintf(stderr, "        \"record\": \"/var/lib/sigdigger\",\n");
+  fprintf(stderr, "        \"forward\": {\n");
+  fprintf(stderr, "          \"host\": \"127.0.0.1\", \"port\": 9999,\n");
+  fprintf(stderr, "          \"mode\": \"udp\", \"mtu\": 1400, \"header\": false,\n");
+  fprintf(stderr, "          \"overflow\": \"drop-oldest\"\n");
+  fprintf(stderr, "        }\n");
+  fprintf(stderr, "      }\n");
+  fprintf(stderr, "    ]\n");
+  fprintf(stderr, "  }\n\n");
+  fprintf(stderr, "Frequencies are absolute. The tuner frequency defaults to the\n");
+  fprintf(stderr, "profile's, and params are inspector settings (e.g. those shown by\n");
+  fprintf(stderr, "the inspector tab). Threads are placed by role (analyzer, audio,\n");
+  fprintf(stderr, "io, dsp, tasks): cpus is a list like 0-3,6 and priority a SCHED_FIFO\n");
+  fprintf(stderr, "priority, 0 meaning default scheduling.\n\n");
+  fprintf(stderr, "Several sources can run in the same process: instead of profile,\n");
+  fprintf(stderr, "frequency and channels, the session has a list of them:\n\n");
+  fprintf(stderr, "  {\n");
+  fprintf(stderr, "    \"threads\": { },\n");
+  fprintf(stderr, "    \"sources\": [\n");
+  fprintf(stderr, "      { \"profile\": \"My SDR\", \"channels\": [ ] },\n");
+  fprintf(stderr, "      { \"profile\": \"My other SDR\", \"channels\": [ ] }\n");
+  fprintf(stderr, "    ]\n");
+  fprintf(stderr, "  }\n\n");
+  fprintf(stderr, "The profile given with -p only applies to single-source sessions.\n\n");
+}
+
+bool
+DaemonParams::parse(int argc, char **argv)
+{
+  static struct option options[] = {
+    {"profile",  required_argument, nullptr, 'p' },
+    {"duration", required_argument, nullptr, 'd' },
+    {"status",   required_argument, nullptr, 's' },
+    {"help",     no_argument,       nullptr, 'h' },
+    {nullptr,    0,                 nullptr, 0 }
+  };
+  int c;
+
+  optind = 0;
+
+  while ((c = getopt_long(argc, argv, "p:d:s:h", options, nullptr)) != -1) {
+    switch (c) {
+      case 'p':
+        this->profile = optarg;
+        break;
+
+      case 'd':
+        this->duration = strtod(optarg, nullptr);
+        break;
+
+      case 's':
+        this->statusInterval = strtod(optarg, nullptr);
+        break;
+
+      case 'h':
+        help(argv[0]);
+        return false;
+
+      default:
+        help(argv[0]);
+        return false;
+    }
+  }
+
+  if (optind != argc - 1) {
+    fprintf(stderr, "%s: expected exactly one session file\n", argv[0]);
+    help(argv[0]);
+    return false;
+  }
+
+  this->session = argv[optind];
+
+  if (this->duration < 0 || this->statusInterval < 0) {
+    fprintf(stderr, "%s: invalid duration or status period\n", argv[0]);
+    return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////// SessionDaemon ////////////////////////////////
+SessionDaemon::SessionDaemon(
+    DaemonParams const &params,
+    QObject *parent) : QObject(parent)
+{
+  this->params = params;
+
+  this->durationTimer.setSingleShot(true);
+  this->signalTimer.setInterval(SIGDIGGER_DAEMON_SIGNAL_POLL_MS);
+
+  connect(
+        &this->durationTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onDurationExpired(void)));
+
+  connect(
+        &this->statusTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onStatusTimeout(void)));
+
+  connect(
+        &this->signalTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onSignalPoll(void)));
+}
+
+SessionDaemon::~SessionDaemon()
+{
+  for (auto p : this->channels) {
+    if (p->source->analyzer != nullptr && p->opened)
+      p->source->analyzer->unregisterSamplesRoute(p->request.inspectorId);
+    delete p->saver;
+    delete p->forwarder;
+    if (p->fd != -1)
+      close(p->fd);
+    delete p;
+  }
+
+  for (auto p : this->sources) {
+    if (p->analyzer != nullptr)
+      delete p->analyzer;
+    delete p;
+  }
+}
+
+bool
+SessionDaemon::parseThreads(QJsonObject const &obj)
+{
+  ThreadConfig config;
+  std::vector<int> cpus;
+
+  for (int i = 0; i < THREAD_ROLE_COUNT; ++i) {
+    const char *name = ThreadConfig::roleName(static_cast<ThreadRole>(i));
+    QJsonObject role = obj.value(name).toObject();
+
+    config.roles[i].cpus     = role.value("cpus").toString().toStdString();
+    config.roles[i].priority = role.value("priority").toInt(0);
+
+    if (!ThreadConfig::parseCpus(config.roles[i].cpus, cpus)) {
+      this->lastError = QString("Invalid CPU list for %1 threads").arg(name);
+      return false;
+    }
+  }
+
+  // Must happen before the analyzer thread is started
+  ThreadPolicy::instance()->setConfig(config);
+
+  return true;
+}
+
+bool
+SessionDaemon::parseChannel(QJsonObject const &obj, DaemonChannel *channel)
+{
+  QJsonObject forward;
+  QString mode, overflow;
+
+  channel->inspClass = obj.value("class")
+      .toString(SIGDIGGER_DAEMON_DEFAULT_CLASS).toStdString();
+  channel->frequency = obj.value("frequency").toDouble();
+  channel->bandwidth = obj.value("bandwidth").toDouble();
+  channel->precise   = obj.value("precise").toBool(true);
+  channel->params    = obj.value("params").toObject();
+  channel->recordDir = obj.value("record").toString();
+
+  if (channel->bandwidth <= 0) {
+    this->lastError = "Channel without a valid bandwidth";
+    return false;
+  }
+
+  if (obj.contains("forward")) {
+    forward = obj.value("forward").toObject();
+    mode = forward.value("mode").toString("udp");
+    overflow = forward.value("overflow").toString("drop-oldest");
+
+    channel->forward       = true;
+    channel->forwardHost   = forward.value("host").toString("127.0.0.1").toStdString();
+    channel->forwardPort   = SCAST(uint16_t, forward.value("port").toInt());
+    channel->forwardMtu    = SCAST(
+          unsigned,
+          forward.value("mtu").toInt(SIGDIGGER_DAEMON_DEFAULT_MTU));
+    channel->forwardHeader = forward.value("header").toBool(false);
+
+    if (!SessionSnapshot::parseMode(mode, channel->forwardMode)) {
+      this->lastError = "Unknown forwarding mode `" + mode + "'";
+      return false;
+    }
+
+    if (!SessionSnapshot::parseOverflow(overflow, channel->forwardOverflow)) {
+      this->lastError = "Unknown overflow policy `" + overflow + "'";
+      return false;
+    }
+  }
+
+  if (channel->recordDir.isEmpty() && !channel->forward) {
+    this->lastError = "Channel with neither recording nor forwarding";
+    return false;
+  }
+
+  return true;
+}
+
+bool
+SessionDaemon::loadSession(void)
+{
+  QFile file(this->params.session);
+  QJsonParseError error;
+  QJsonDocument doc;
+  QJsonObject root;
+
+  if (!file.open(QIODevice::ReadOnly)) {
+    this->lastError =
+        "Cannot open session " + this->params.session + ": " + file.errorString();
+    return false;
+  }
+
+  doc = QJsonDocument::fromJson(file.readAll(), &error);
+  if (!doc.isObject()) {
+    this->lastError =
+        "Invalid session " + this->params.session + ": " + error.errorString();
+    return false;
+  }
+
+  root = doc.object();
+
+  if (!this->parseThreads(root.value("threads").toObject()))
+    return false;
+
+  // Single-source sessions have the source fields at the root
+  if (root.contains("sources")) {
+    for (auto p : root.value("sources").toArray()) {
+      DaemonSource *source = new DaemonSource();
+
+      this->sources.append(source);
+
+      if (!this->parseSource(p.toObject(), source)) {
+        this->lastError = QString("Source %1: %2")
+            .arg(this->sources.size())
+            .arg(this->lastError);
+        return false;
+      }
+    }
+  } else {
+    DaemonSource *source = new DaemonSource();
+
+    this->sources.append(source);
+
+    if (!this->parseSource(root, source))
+      return false;
+  }
+
+  if (this->sources.isEmpty()) {
+    this->lastError = "Session has no sources";
+    return false;
+  }
+
+  if (this->sources.size() == 1 && !this->params.profile.isEmpty())
+    this->sources[0]->profileName = this->params.profile.toStdString();
+
+  return true;
+}
+
+bool
+SessionDaemon::parseSource(QJsonObject const &obj, DaemonSource *source)
+{
+  int count = 0;
+
+  source->profileName = obj.value("profile").toString().toStdString();
+
+  if (obj.contains("frequency")) {
+    source->frequency = obj.value("frequency").toDouble();
+    source->haveFrequency = true;
+  }
+
+  for (auto p : obj.value("channels").toArray()) {
+    DaemonChannel *channel = new DaemonChannel();
+
+    channel->source = source;
+    this->channels.append(channel);
+    ++count;
+
+    if (!this->parseChannel(p.toObject(), channel)) {
+      this->lastError = QString("Channel %1: %2")
+          .arg(count)
+          .arg(this->lastError);
+      return false;
+    }
+  }
+
+  if (count == 0) {
+    this->lastError = "Session has no channels";
+    return false;
+  }
+
+  return true;
+}
+
+bool
+SessionDaemon::startSource(DaemonSource *source)
+{
+  Suscan::Singleton *sus = Suscan::Singleton::get_instance();
+  Suscan::AnalyzerParams analyzerParams;
+  Suscan::Source::Config *profile;
+  Suscan::Source::Config config;
+
+  if ((profile = sus->getProfile(source->profileName)) == nullptr) {
+    this->lastError =
+        "No such source profile `"
+        + QString::fromStdString(source->profileName)
+        + "'";
+    return false;
+  }
+
+  config = *profile;
+
+  if (source->haveFrequency)
+    config.setFreq(source->frequency);
+  else
+    source->frequency = config.getFreq();
+
+  try {
+    source->analyzer = new Suscan::Analyzer(analyzerParams, config);
+  } catch (Suscan::Exception const &e) {
+    this->lastError = "Cannot start analyzer: " + QString(e.what());
+    return false;
+  }
+
+  source->tracker = new Suscan::AnalyzerRequestTracker(this);
+  source->tracker->setAnalyzer(source->analyzer);
+
+  connect(
+        source->analyzer,
+        SIGNAL(inspector_message(const Suscan::InspectorMessage &)),
+        source->tracker,
+        SLOT(onInspectorMessage(const Suscan::InspectorMessage &)));
+
+  connect(
+        source->analyzer,
+        SIGNAL(eos(void)),
+        this,
+        SLOT(onEndOfStream(void)));
+
+  connect(
+        source->analyzer,
+        SIGNAL(read_error(void)),
+        this,
+        SLOT(onEndOfStream(void)));
+
+  connect(
+        source->analyzer,
+        SIGNAL(halted(void)),
+        this,
+        SLOT(onHalted(void)));
+
+  connect(
+        source->tracker,
+        SIGNAL(opened(Suscan::AnalyzerRequest const &)),
+        this,
+        SLOT(onOpened(Suscan::AnalyzerRequest const &)));
+
+  connect(
+        source->tracker,
+        SIGNAL(error(Suscan::AnalyzerRequest const &, const std::string &)),
+        this,
+        SLOT(onOpenError(Suscan::AnalyzerRequest const &, const std::string &)));
+
+  return true;
+}
+
+DaemonSource *
+SessionDaemon::findSource(QObject *analyzer) const
+{
+  for (auto p : this->sources)
+    if (p->analyzer == analyzer)
+      return p;
+
+  return nullptr;
+}
+
+bool
+SessionDaemon::start(void)
+{
+  if (!this->loadSession())
+    return false;
+
+  for (int i = 0; i < this->sources.size(); ++i)
+    if (!this->startSource(this->sources[i])) {
+      if (this->sources.size() > 1)
+        this->lastError = QString("Source %1: %2")
+            .arg(i + 1)
+            .arg(this->lastError);
+      return false;
+    }
+
+  signal(SIGINT, onTerminationSignal);
+  signal(SIGTERM, onTerminationSignal);
+
+  this->clock.start();
+  this->signalTimer.start();
+
+  if (this->params.duration > 0)
+    this->durationTimer.start(SCAST(int, this->params.duration * 1000));
+
+  if (this->params.statusInterval > 0)
+    this->statusTimer.start(SCAST(int, this->params.statusInterval * 1000));
+
+  for (auto p : this->sources)
+    this->openChannels(p);
+
+  return true;
+}
+
+void
+SessionDaemon::openChannels(DaemonSource *source)
+{
+  source->tracker->beginBatch();
+
+  // Channel indices are global to the session
+  for (int i = 0; i < this->channels.size(); ++i) {
+    DaemonChannel *channel = this->channels[i];
+    Suscan::Channel ch;
+
+    if (channel->source != source)
+      continue;
+
+    ch.bw    = channel->bandwidth;
+    ch.ft    = 0;
+    ch.fc    = channel->frequency - source->frequency;
+    ch.fLow  = -.5 * ch.bw;
+    ch.fHigh = +.5 * ch.bw;
+
+    source->tracker->requestOpen(
+          channel->inspClass,
+          ch,
+          QVariant::fromValue(i),
+          channel->precise);
+  }
+
+  source->tracker->endBatch();
+}
+
+std::string
+SessionDaemon::recordFileName(DaemonChannel const *channel) const
+{
+  unsigned int i = 0;
+  std::string path;
+
+  // Same naming as the captures of the inspector tab
+  do {
+    std::ostringstream os;
+
+    os << "channel-capture-"
+       << channel->inspClass
+       << "-"
+       << SCAST(qint64, channel->frequency)
+       << "-Hz-"
+       << SCAST(unsigned, channel->request.equivRate)
+       << "-sps-"
+       << std::setw(4)
+       << std::setfill('0')
+       << ++i
+       << ".raw";
+    path = channel->recordDir.toStdString() + "/" + os.str();
+  } while (access(path.c_str(), F_OK) != -1);
+
+  return path;
+}
+
+bool
+SessionDaemon::makeSinks(DaemonChannel *channel)
+{
+  unsigned int rate = std::max(SCAST(unsigned, channel->request.equivRate), 1u);
+
+  if (!channel->recordDir.isEmpty()) {
+    std::string path;
+
+    if (!QDir().mkpath(channel->recordDir)) {
+      this->lastError = "Cannot create " + channel->recordDir;
+      return false;
+    }
+
+    path = this->recordFileName(channel);
+    channel->fd = open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0600);
+
+    if (channel->fd == -1) {
+      this->lastError =
+          "Cannot open " + QString::fromStdString(path) + ": " + strerror(errno);
+      return false;
+    }
+
+    channel->saver = new FileDataSaver(channel->fd, this);
+    channel->saver->setSampleRate(rate);
+
+    connect(
+          channel->saver,
+          SIGNAL(stopped(void)),
+          this,
+          SLOT(onSaverStopped(void)));
+
+    fprintf(stderr, "Daemon: recording to %s\n", path.c_str());
+  }
+
+  if (channel->forward) {
+    channel->forwarder = new SocketForwarder(
+          channel->forwardHost,
+          channel->forwardPort,
+          channel->forwardMtu,
+          channel->forwardMode,
+          channel->forwardHeader,
+          sizeof(SUCOMPLEX),
+          channel->forwardOverflow,
+          this);
+    channel->forwarder->setSampleRate(rate);
+
+    connect(
+          channel->forwarder,
+          SIGNAL(stopped(void)),
+          this,
+          SLOT(onSaverStopped(void)));
+  }
+
+  return true;
+}
+
+void
+SessionDaemon::applyParams(DaemonChannel *channel)
+{
+  if (channel->params.isEmpty() || channel->request.config == nullptr)
+    return;
+
+  Suscan::Config config(channel->request.config);
+
+  for (auto it = channel->params.begin(); it != channel->params.end(); ++it) {
+    std::string name = it.key().toStdString();
+    Suscan::FieldValue const *field = config.get(name);
+
+    if (field == nullptr) {
+      fprintf(
+            stderr,
+            "Daemon: ignoring unknown inspector parameter `%s'\n",
+            name.c_str());
+      continue;
+    }
+
+    switch (field->getType()) {
+      case SUSCAN_FIELD_TYPE_STRING:
+      case SUSCAN_FIELD_TYPE_FILE:
+        config.set(name, it.value().toString().toStdString());
+        break;
+
+      case SUSCAN_FIELD_TYPE_INTEGER:
+        config.set(name, SCAST(uint64_t, it.value().toDouble()));
+        break;
+
+      case SUSCAN_FIELD_TYPE_FLOAT:
+        config.set(name, SCAST(SUFLOAT, it.value().toDouble()));
+        break;
+
+      case SUSCAN_FIELD_TYPE_BOOLEAN:
+        config.set(name, it.value().toBool());
+        break;
+    }
+  }
+
+  channel->source->analyzer->setInspectorConfig(
+        channel->request.handle,
+        config);
+}
+
+void
+SessionDaemon::printStatus(void) const
+{
+  QJsonObject status;
+  QJsonArray channels;
+
+  for (auto p : this->channels) {
+    QJsonObject ch;
+
+    ch["source"]     = this->sources.indexOf(p->source) + 1;
+    ch["frequency"]  = p->frequency;
+    ch["opened"]     = p->opened;
+    ch["samples"]    = SCAST(qint64, p->samples);
+
+    if (p->saver != nullptr)
+      ch["saved_bytes"] = SCAST(qint64, p->saver->getSize());
+
+    if (p->forwarder != nullptr) {
+      ch["queued_bytes"]  = SCAST(qint64, p->forwarder->getQueuedBytes());
+      ch["dropped_bytes"] = SCAST(qint64, p->forwarder->getDroppedBytes());
+    }
+
+    channels.append(ch);
+  }
+
+  status["uptime_s"] = this->clock.elapsed() * 1e-3;
+  status["failed"]   = this->failed;
+  status["channels"] = channels;
+
+  fprintf(
+        stderr,
+        "%s\n",
+        QJsonDocument(status).toJson(QJsonDocument::Compact).constData());
+}
+
+void
+SessionDaemon::stop(void)
+{
+  if (this->stopping)
+    return;
+
+  this->stopping = true;
+  this->durationTimer.stop();
+  this->statusTimer.stop();
+  this->signalTimer.stop();
+
+  if (this->params.statusInterval > 0)
+    this->printStatus();
+
+  this->checkFinished();
+
+  // Finished once the last of them halts
+  for (auto p : this->sources)
+    if (p->analyzer != nullptr && !p->halted)
+      p->analyzer->halt();
+}
+
+void
+SessionDaemon::checkFinished(void)
+{
+  for (auto p : this->sources)
+    if (p->analyzer != nullptr && !p->halted)
+      return;
+
+  if (this->stopping)
+    emit finished();
+  else
+    this->stop();
+}
+
+/////////////////////////////////// Slots /////////////////////////////////////
+void
+SessionDaemon::onOpened(Suscan::AnalyzerRequest const &request)
+{
+  int index = request.data.value<int>();
+  DaemonChannel *channel;
+
+  if (index < 0 || index >= this->channels.size() || this->stopping)
+    return;
+
+  channel = this->channels[index];
+  channel->request = request;
+
+  if (!this->makeSinks(channel)) {
+    fprintf(
+          stderr,
+          "Daemon: channel %d: %s\n",
+          index + 1,
+          this->lastError.toStdString().c_str());
+    ++this->failed;
+    channel->source->analyzer->closeInspector(request.handle);
+    return;
+  }
+
+  this->applyParams(channel);
+
+  channel->opened = true;
+
+  channel->source->analyzer->registerSamplesRoute(
+        request.inspectorId,
+        this,
+        [channel] (Suscan::SamplesMessage const &msg) {
+          const SUCOMPLEX *data = msg.getSamples();
+          size_t size = msg.getCount();
+
+          channel->samples += size;
+
+          if (channel->saver != nullptr)
+            channel->saver->write(data, size);
+
+          if (channel->forwarder != nullptr)
+            channel->forwarder->write(data, size);
+        });
+}
+
+void
+SessionDaemon::onOpenError(
+    Suscan::AnalyzerRequest const &request,
+    std::string const &error)
+{
+  fprintf(
+        stderr,
+        "Daemon: cannot open channel %d: %s\n",
+        request.data.value<int>() + 1,
+        error.c_str());
+
+  ++this->failed;
+}
+
+void
+SessionDaemon::onSaverStopped(void)
+{
+  fprintf(stderr, "Daemon: a recording or forwarder stopped on error\n");
+}
+
+void
+SessionDaemon::onDurationExpired(void)
+{
+  this->stop();
+}
+
+void
+SessionDaemon::onStatusTimeout(void)
+{
+  this->printStatus();
+}
+
+void
+SessionDaemon::onSignalPoll(void)
+{
+  if (g_stopRequested)
+    this->stop();
+}
+
+//
+// A source that stops does not take the others with it. The daemon goes
+// on until all of them are gone, and then fails.
+//
+void
+SessionDaemon::onEndOfStream(void)
+{
+  DaemonSource *source = this->findSource(this->sender());
+  bool running = false;
+
+  if (source == nullptr || source->halted)
+    return;
+
+  fprintf(
+        stderr,
+        "Daemon: source %d stopped\n",
+        this->sources.indexOf(source) + 1);
+
+  this->lastError = "Source stopped";
+
+  for (auto p : this->sources)
+    if (p != source && !p->halted)
+      running = true;
+
+  if (running)
+    source->analyzer->halt();
+  else
+    this->stop();
+}
+
+void
+SessionDaemon::onHalted(void)
+{
+  DaemonSource *source = this->findSource(this->sender());
+
+  if (source != nullptr) {
+    source->halted = true;
+
+    // Not asked for
+    if (!this->stopping)
+      this->lastError = "Source stopped";
+  }
+
+  this->checkFinished();
+}
@@ -0,0 +1,228 @@
+//
+//    SessionSnapshot.cpp: Whole-workspace session snapshot
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <SessionSnapshot.h>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QFile>
+
+using namespace SigDigger;
+
+/////////////////////////////// SessionInspector ///////////////////////////////
+QJsonObject
+SessionInspector::toJson(void) const
+{
+  QJsonObject obj = this->state;
+
+  obj["factory"]   = QString::fromStdString(this->factory);
+  obj["class"]     = QString::fromStdString(this->inspClass);
+  obj["frequency"] = this->frequency;
+  obj["bandwidth"] = this->bandwidth;
+  obj["precise"]   = this->precise;
+
+  return obj;
+}
+
+bool
+SessionInspector::fromJson(QJsonObject const &obj)
+{
+  this->factory   = obj.value("factory").toString().toStdString();
+  this->inspClass = obj.value("class").toString().toStdString();
+  this->frequency = obj.value("frequency").toDouble();
+  this->bandwidth = obj.value("bandwidth").toDouble();
+  this->precise   = obj.value("precise").toBool(true);
+  this->state     = obj;
+
+  // Channels written for the daemon have no widget to open
+  return !this->factory.empty()
+      && !this->inspClass.empty()
+      && this->bandwidth > 0;
+}
+
+/////////////////////////////// SessionSnapshot ////////////////////////////////
+QJsonObject
+SessionSnapshot::toJson(void) const
+{
+  QJsonObject root;
+  QJsonObject window;
+  QJsonArray channels;
+
+  for (auto const &p : this->inspectors)
+    channels.append(p.toJson());
+
+  window["geometry"] = QString::fromLatin1(this->geometry.toBase64());
+  window["state"]    = QString::fromLatin1(this->windowState.toBase64());
+
+  root["profile"]  = QString::fromStdString(this->profileName);
+  root["source"]   = this->source;
+  root["window"]   = window;
+  root["channels"] = channels;
+
+  if (this->haveFrequency)
+    root["frequency"] = this->frequency;
+
+  return root;
+}
+
+bool
+SessionSnapshot::fromJson(QJsonObject const &root, QString &error)
+{
+  QJsonObject window = root.value("window").toObject();
+
+  this->profileName   = root.value("profile").toString().toStdString();
+  this->source        = root.value("source").toString();
+  this->haveFrequency = root.contains("frequency");
+  this->frequency     = root.value("frequency").toDouble();
+  this->geometry      = QByteArray::fromBase64(
+        window.value("geometry").toString().toLatin1());
+  this->windowState   = QByteArray::fromBase64(
+        window.value("state").toString().toLatin1());
+
+  this->inspectors.clear();
+
+  for (auto p : root.value("channels").toArray()) {
+    SessionInspector insp;
+
+    if (insp.fromJson(p.toObject()))
+      this->inspectors.push_back(insp);
+  }
+
+  if (this->profileName.empty() && this->source.isEmpty()) {
+    error = "Session has no source profile";
+    return false;
+  }
+
+  return true;
+}
+
+bool
+SessionSnapshot::save(QString const &path, QString &error) const
+{
+  QFile file(path);
+  QByteArray data = QJsonDocument(this->toJson()).toJson();
+
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    error = file.errorString();
+    return false;
+  }
+
+  if (file.write(data) != data.size()) {
+    error = file.errorString();
+    return false;
+  }
+
+  return true;
+}
+
+bool
+SessionSnapshot::load(QString const &path, QString &error)
+{
+  QFile file(path);
+  QJsonParseError parseError;
+  QJsonDocument doc;
+
+  if (!file.open(QIODevice::ReadOnly)) {
+    error = file.errorString();
+    return false;
+  }
+
+  if (file.size() > SIGDIGGER_SESSION_SNAPSHOT_MAX_SIZE) {
+    error = "File is too big to be a session";
+    return false;
+  }
+
+  doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+
+  if (!doc.isObject()) {
+    error = parseError.errorString();
+    return false;
+  }
+
+  return this->fromJson(doc.object(), error);
+}
+
+QString
+SessionSnapshot::modeName(SocketForwarderMode mode)
+{
+  switch (mode) {
+    case SOCKET_FORWARDER_UDP:
+      return "udp";
+
+    case SOCKET_FORWARDER_TCP:
+      return "tcp";
+
+    case SOCKET_FORWARDER_TCP_SERVER:
+      return "tcp-server";
+
+    case SOCKET_FORWARDER_SHM:
+      return "shm";
+  }
+
+  return "udp";
+}
+
+bool
+SessionSnapshot::parseMode(QString const &name, SocketForwarderMode &mode)
+{
+  if (name == "udp")
+    mode = SOCKET_FORWARDER_UDP;
+  else if (name == "tcp")
+    mode = SOCKET_FORWARDER_TCP;
+  else if (name == "tcp-server")
+    mode = SOCKET_FORWARDER_TCP_SERVER;
+  else if (name == "shm")
+    mode = SOCKET_FORWARDER_SHM;
+  else
+    return false;
+
+  return true;
+}
+
+QString
+SessionSnapshot::overflowName(SocketForwarderOverflow overflow)
+{
+  switch (overflow) {
+    case SOCKET_FORWARDER_DROP_OLDEST:
+      return "drop-oldest";
+
+    case SOCKET_FORWARDER_DROP_NEWEST:
+      return "drop-newest";
+
+    case SOCKET_FORWARDER_DECIMATE:
+      return "decimate";
+  }
+
+  return "drop-oldest";
+}
+
+bool
+SessionSnapshot::parseOverflow(
+    QString const &name,
+    SocketForwarderOverflow &overflow)
+{
+  if (name == "drop-oldest")
+    overflow = SOCKET_FORWARDER_DROP_OLDEST;
+  else if (name == "drop-newest")
+    overflow = SOCKET_FORWARDER_DROP_NEWEST;
+  else if (name == "decimate")
+    overflow = SOCKET_FORWARDER_DECIMATE;
+  else
+    return false;
+
+  return true;
+}
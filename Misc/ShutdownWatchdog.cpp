@@ -0,0 +1,204 @@
+//
+//    ShutdownWatchdog.cpp: Bounded application shutdown
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "ShutdownWatchdog.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+using namespace SigDigger;
+
+namespace {
+  struct Tracked {
+    std::string name;
+    bool holdsData;
+  };
+
+  // Shared by the trackers and the watchdog. Never destroyed, as trackers
+  // may outlive any static destruction order.
+  struct TrackerRegistry {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::map<unsigned int, Tracked> tracked;
+    unsigned int last = 0;
+
+    static TrackerRegistry *
+    instance(void)
+    {
+      static TrackerRegistry *registry = new TrackerRegistry();
+
+      return registry;
+    }
+  };
+}
+
+/////////////////////////////// ShutdownTracker ////////////////////////////////
+ShutdownTracker::ShutdownTracker(std::string const &name, bool holdsData)
+{
+  TrackerRegistry *registry = TrackerRegistry::instance();
+  std::lock_guard<std::mutex> guard(registry->mutex);
+
+  this->id = ++registry->last;
+  registry->tracked[this->id] = Tracked {name, holdsData};
+}
+
+ShutdownTracker::~ShutdownTracker()
+{
+  TrackerRegistry *registry = TrackerRegistry::instance();
+
+  {
+    std::lock_guard<std::mutex> guard(registry->mutex);
+    registry->tracked.erase(this->id);
+  }
+
+  registry->cond.notify_all();
+}
+
+void
+ShutdownTracker::set(std::string const &name, bool holdsData)
+{
+  TrackerRegistry *registry = TrackerRegistry::instance();
+
+  {
+    std::lock_guard<std::mutex> guard(registry->mutex);
+    registry->tracked[this->id] = Tracked {name, holdsData};
+  }
+
+  registry->cond.notify_all();
+}
+
+/////////////////////////////// ShutdownWatchdog ///////////////////////////////
+
+ShutdownWatchdog::ShutdownWatchdog(
+    unsigned int timeoutMs,
+    int exitCode,
+    std::function<void (void)> const &beforeExit)
+{
+  this->thread = std::thread(
+        &ShutdownWatchdog::run,
+        this,
+        timeoutMs,
+        exitCode,
+        beforeExit);
+}
+
+ShutdownWatchdog::~ShutdownWatchdog()
+{
+  TrackerRegistry *registry = TrackerRegistry::instance();
+
+  {
+    std::lock_guard<std::mutex> guard(this->mutex);
+    this->disarmed = true;
+  }
+
+  this->cond.notify_all();
+
+  // It may be waiting for the recorders
+  {
+    std::lock_guard<std::mutex> guard(registry->mutex);
+  }
+  registry->cond.notify_all();
+
+  this->thread.join();
+}
+
+// Returns false if the shutdown completed in the meantime
+bool
+ShutdownWatchdog::waitForData(void)
+{
+  TrackerRegistry *registry = TrackerRegistry::instance();
+  std::unique_lock<std::mutex> lock(registry->mutex);
+  auto done = [this, registry] () {
+    bool disarmed;
+
+    {
+      std::lock_guard<std::mutex> guard(this->mutex);
+      disarmed = this->disarmed;
+    }
+
+    if (disarmed)
+      return true;
+
+    for (auto &p : registry->tracked)
+      if (p.second.holdsData)
+        return false;
+
+    return true;
+  };
+
+  for (auto &p : registry->tracked)
+    if (p.second.holdsData)
+      fprintf(stderr, "  Waiting for %s\n", p.second.name.c_str());
+
+  registry->cond.wait_for(
+        lock,
+        std::chrono::milliseconds(SIGDIGGER_SHUTDOWN_DATA_TIMEOUT_MS),
+        done);
+
+  {
+    std::lock_guard<std::mutex> guard(this->mutex);
+    if (this->disarmed)
+      return false;
+  }
+
+  for (auto &p : registry->tracked)
+    fprintf(
+          stderr,
+          "  Left behind: %s%s\n",
+          p.second.name.c_str(),
+          p.second.holdsData ? " (unsaved data may be lost)" : "");
+
+  return true;
+}
+
+void
+ShutdownWatchdog::run(
+    unsigned int timeoutMs,
+    int exitCode,
+    std::function<void (void)> beforeExit)
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+
+  if (this->cond.wait_for(
+        lock,
+        std::chrono::milliseconds(timeoutMs),
+        [this] () { return this->disarmed; }))
+    return;
+
+  lock.unlock();
+
+  fprintf(
+        stderr,
+        "Shutdown did not complete in %u ms, leaving the remaining "
+        "threads behind\n",
+        timeoutMs);
+
+  if (beforeExit)
+    beforeExit();
+
+  if (!this->waitForData())
+    return;
+
+  fflush(stdout);
+  fflush(stderr);
+
+  // No destructors, no atexit handlers: they would wait for the very
+  // threads that are stuck
+  std::_Exit(exitCode);
+}
@@ -21,9 +21,11 @@
 #include "DefaultGradient.h"
 #include "Version.h"
 #include <QComboBox>
+#include <QWidget>
 #include <fstream>
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <SuWidgetsHelpers.h>
 #include <Suscan/MultitaskController.h>
 #include <ExportSamplesTask.h>
@@ -34,6 +36,9 @@
   "custom build on " __DATE__ " at " __TIME__ " (" __VERSION__ ")"
 #endif /* SUSCAN_BUILD_STRING */
 
+#define SIGDIGGER_HELPERS_MULTI_EXPORT_FILTER \
+  "Raw I/Q, WAV and MAT-file at once (*.raw *.wav *.mat)"
+
 using namespace SigDigger;
 
 SigDiggerHelpers *SigDiggerHelpers::currInstance = nullptr;
@@ -70,6 +75,15 @@ SigDiggerHelpers::timerdup(struct timeval *tv)
   }
 }
 
+bool
+SigDiggerHelpers::isOnScreen(const QWidget *widget)
+{
+  if (widget == nullptr || !widget->isVisible())
+    return false;
+
+  return !widget->window()->isMinimized();
+}
+
 AudioDemod
 SigDiggerHelpers::strToDemod(std::string const &str)
 {
@@ -108,18 +122,45 @@ SigDiggerHelpers::demodToStr(AudioDemod demod)
 void
 SigDiggerHelpers::openSaveSamplesDialog(
     QWidget *root,
-    const SUCOMPLEX *data,
-    size_t length,
+    std::shared_ptr<const std::vector<SUCOMPLEX>> const &buffer,
     qreal fs,
     int start,
     int end,
     Suscan::MultitaskController *mt)
+{
+  runSaveSamplesDialog(
+        root,
+        [&] () { return new ExportSamplesTask(buffer, fs, start, end); },
+        mt);
+}
+
+void
+SigDiggerHelpers::openSaveSamplesDialog(
+    QWidget *root,
+    std::shared_ptr<SampleStore> const &store,
+    qreal fs,
+    size_t start,
+    size_t end,
+    Suscan::MultitaskController *mt)
+{
+  runSaveSamplesDialog(
+        root,
+        [&] () { return new ExportSamplesTask(store, fs, start, end); },
+        mt);
+}
+
+void
+SigDiggerHelpers::runSaveSamplesDialog(
+    QWidget *root,
+    std::function<ExportSamplesTask *(void)> const &makeTask,
+    Suscan::MultitaskController *mt)
 {
   bool done = false;
 
   do {
     QFileDialog dialog(root);
     QStringList filters;
+    QStringList formats;
     QString format;
 
     dialog.setFileMode(QFileDialog::FileMode::AnyFile);
@@ -129,7 +170,11 @@ SigDiggerHelpers::openSaveSamplesDialog(
     filters << "Audio file (*.wav)"
             << "Raw I/Q data (*.raw)"
             << "MATLAB/Octave script (*.m)"
-            << "MATLAB 5.0 MAT-file (*.mat)";
+            << "MATLAB 5.0 MAT-file (*.mat)"
+            << SIGDIGGER_HELPERS_MULTI_EXPORT_FILTER;
+#ifdef HAVE_ZSTD
+    filters << "Zstandard-compressed raw I/Q data (*.zst)";
+#endif // HAVE_ZSTD
 
     dialog.setNameFilters(filters);
 
@@ -138,7 +183,11 @@ SigDiggerHelpers::openSaveSamplesDialog(
       QString filter = dialog.selectedNameFilter();
       ExportSamplesTask *task;
 
-      if (strstr(filter.toStdString().c_str(), ".mat") != nullptr)
+      if (filter == SIGDIGGER_HELPERS_MULTI_EXPORT_FILTER)
+        format = "multi";
+      else if (strstr(filter.toStdString().c_str(), ".zst") != nullptr)
+        format = "zst";
+      else if (strstr(filter.toStdString().c_str(), ".mat") != nullptr)
         format = "mat";
       else if (strstr(filter.toStdString().c_str(), ".m") != nullptr)
         format = "m";
@@ -147,9 +196,22 @@ SigDiggerHelpers::openSaveSamplesDialog(
       else
         format = "wav";
 
-      path = SuWidgetsHelpers::ensureExtension(path, format);
+      task = makeTask();
+
+      if (format == "multi") {
+        // Same selection, several files: written in a single pass
+        QFileInfo info(path);
 
-      task = new ExportSamplesTask(path, format, data, length, fs, start, end);
+        formats << "raw" << "wav" << "mat";
+        if (formats.contains(info.suffix()))
+          path = info.path() + "/" + info.completeBaseName();
+
+        for (auto &ext : formats)
+          task->addSink(SuWidgetsHelpers::ensureExtension(path, ext), ext);
+      } else {
+        path = SuWidgetsHelpers::ensureExtension(path, format);
+        task->addSink(path, format);
+      }
 
       if (!task->attemptOpen()) {
         QMessageBox::critical(
@@ -372,3 +434,131 @@ SigDiggerHelpers::pushUTCTZ(void)
 {
   this->pushTZ("");
 }
+
+bool
+SigDiggerHelpers::guessCaptureParams(Suscan::Source::Config &profile)
+{
+  QFileInfo fi(QString::fromStdString(profile.getPath()));
+  std::string baseName = fi.baseName().toStdString();
+
+  SUFREQ fc;
+  unsigned int fs;
+  unsigned int date, time;
+  bool haveFc   = false;
+  bool haveFs   = false;
+  bool haveDate = false;
+  bool haveTime = false;
+  bool isUTC    = false;
+  bool haveTm   = false;
+  struct tm tm;
+  struct timeval tv = {0, 0};
+
+  memset(&tm, 0, sizeof(struct tm));
+
+  if (sscanf(
+        baseName.c_str(),
+        "sigdigger_%08d_%06dZ_%d_%lg_float32_iq",
+        &date,
+        &time,
+        &fs,
+        &fc) == 4) {
+    haveFc   = true;
+    haveFs   = true;
+    haveDate = true;
+    haveTime = true;
+    isUTC    = true;
+  } else if (sscanf(
+        baseName.c_str(),
+        "sigdigger_%d_%lg_float32_iq",
+        &fs,
+        &fc) == 2) {
+    haveFc = true;
+    haveFs = true;
+  } else if (sscanf(
+        baseName.c_str(),
+        "gqrx_%08d_%06d_%lg_%d_fc",
+        &date,
+        &time,
+        &fc,
+        &fs) == 4) {
+    haveFc   = true;
+    haveFs   = true;
+    haveDate = true;
+    haveTime = true;
+  } else if (sscanf(
+        baseName.c_str(),
+        "SDRSharp_%08d_%06dZ_%lg_IQ",
+        &date,
+        &time,
+        &fc) == 3) {
+    haveFc   = true;
+    haveDate = true;
+    haveTime = true;
+  } else if (sscanf(
+        baseName.c_str(),
+        "HDSDR_%08d_%06dZ_%lgkHz",
+        &date,
+        &time,
+        &fc) == 3) {
+    fc      *= 1e3;
+    haveFc   = true;
+    haveDate = true;
+    haveTime = true;
+    isUTC    = true;
+  } else if (sscanf(
+        baseName.c_str(),
+        "baseband_%lgHz_%02d-%02d-%02d_%02d-%02d-%04d",
+        &fc,
+        &tm.tm_hour,
+        &tm.tm_min,
+        &tm.tm_sec,
+        &tm.tm_mday,
+        &tm.tm_mon,
+        &tm.tm_year) == 7) {
+    tm.tm_year -= 1900;
+    tm.tm_mon  -= 1;
+
+    haveFc   = true;
+    haveTm   = true;
+    isUTC    = true;
+  }
+
+  if (haveDate || haveTime) {
+    haveTm = true;
+    if (haveDate) {
+      tm.tm_year = date / 10000 - 1900;
+      tm.tm_mon  = ((date / 100) % 100) - 1;
+      tm.tm_mday = date % 100;
+    }
+
+    if (haveTime) {
+      tm.tm_hour = time / 10000;
+      tm.tm_min  = (time / 100) % 100;
+      tm.tm_sec  = time % 100;
+    }
+  }
+
+  if (haveTm) {
+    if (isUTC) {
+      this->pushUTCTZ();
+      tm.tm_isdst = 0;
+      tv.tv_sec = mktime(&tm);
+    } else {
+      this->pushLocalTZ();
+      tm.tm_isdst = -1;
+      tv.tv_sec = mktime(&tm);
+    }
+
+    this->popTZ();
+
+    profile.setStartTime(tv);
+  }
+
+  if (haveFs)
+    profile.setSampleRate(fs);
+
+  if (haveFc)
+    profile.setFreq(fc);
+
+  return haveFs || haveFc || haveTm;
+}
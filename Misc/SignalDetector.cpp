@@ -0,0 +1,382 @@
+//
+//    SignalDetector.cpp: Emission detection on the PSD stream
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <SignalDetector.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace SigDigger;
+
+static bool typesRegistered = false;
+
+/////////////////////////////// SignalDetector /////////////////////////////////
+void
+SignalDetector::setParams(SignalDetectorParams const &params)
+{
+  this->params = params;
+
+  if (this->params.trainingBins < 1)
+    this->params.trainingBins = 1;
+
+  if (this->params.minBins < 1)
+    this->params.minBins = 1;
+}
+
+SignalDetectorParams const &
+SignalDetector::getParams(void) const
+{
+  return this->params;
+}
+
+void
+SignalDetector::endAll(std::vector<SignalDetectorEvent> &events)
+{
+  for (auto &t : this->tracks) {
+    if (t.reported) {
+      SignalDetectorEvent ev;
+
+      ev.kind = SignalDetectorEvent::ENDED;
+      ev.emission = t.emission;
+      ev.emission.end = t.lastSeen;
+      events.push_back(ev);
+    }
+  }
+
+  this->tracks.clear();
+}
+
+void
+SignalDetector::reset(std::vector<SignalDetectorEvent> &events)
+{
+  this->endAll(events);
+  this->floor.clear();
+}
+
+// Smallest-of cell averaging: the mean floor of the training bins at
+// each side of the bin under test, whichever is lower. The lower side is
+// the one not sitting on a neighbouring emission.
+void
+SignalDetector::updateThresholds(const SUFLOAT *psd, size_t size)
+{
+  SUFLOAT k = std::pow(10.f, this->params.threshold / 10.f);
+  size_t g = this->params.guardBins;
+  size_t n = this->params.trainingBins;
+
+  this->sums.resize(size + 1);
+  this->noise.resize(size);
+  this->detected.resize(size);
+
+  this->sums[0] = 0;
+  for (size_t i = 0; i < size; ++i)
+    this->sums[i + 1] = this->sums[i] + this->floor[i];
+
+  for (size_t i = 0; i < size; ++i) {
+    double lead = -1, lag = -1, est;
+
+    if (i > g) {
+      size_t hi = i - g;
+      size_t lo = hi > n ? hi - n : 0;
+      lead = (this->sums[hi] - this->sums[lo]) / static_cast<double>(hi - lo);
+    }
+
+    if (i + g + 1 < size) {
+      size_t lo = i + g + 1;
+      size_t hi = std::min(lo + n, size);
+      lag = (this->sums[hi] - this->sums[lo]) / static_cast<double>(hi - lo);
+    }
+
+    if (lead < 0)
+      est = lag;
+    else if (lag < 0)
+      est = lead;
+    else
+      est = std::min(lead, lag);
+
+    // Window wider than the spectrum: only the bin itself is left
+    if (est < 0)
+      est = this->floor[i];
+
+    this->noise[i] = static_cast<SUFLOAT>(est);
+    this->detected[i] = psd[i] > k * this->noise[i];
+  }
+}
+
+void
+SignalDetector::updateFloor(const SUFLOAT *psd, size_t size)
+{
+  SUFLOAT alpha = this->params.floorAlpha;
+  SUFLOAT leak;
+
+  // Plain average until there are enough PSDs for the EWMA to settle
+  ++this->frames;
+  if (alpha * static_cast<SUFLOAT>(this->frames) < 1)
+    alpha = 1.f / static_cast<SUFLOAT>(this->frames);
+
+  leak = static_cast<SUFLOAT>(
+        alpha * SIGDIGGER_SIGNAL_DETECTOR_FLOOR_LEAK);
+
+  for (size_t i = 0; i < size; ++i)
+    this->floor[i] += (this->detected[i] ? leak : alpha)
+        * (psd[i] - this->floor[i]);
+}
+
+void
+SignalDetector::track(SignalEmission const &em)
+{
+  for (auto &t : this->tracks) {
+    if (em.fHigh >= t.emission.fLow && em.fLow <= t.emission.fHigh) {
+      t.emission.fLow  = std::min(t.emission.fLow, em.fLow);
+      t.emission.fHigh = std::max(t.emission.fHigh, em.fHigh);
+      t.emission.peak  = std::max(t.emission.peak, em.peak);
+      t.emission.snr   = std::max(t.emission.snr, em.snr);
+      t.emission.end   = em.end;
+      t.lastSeen       = em.end;
+      t.matched        = true;
+      return;
+    }
+  }
+
+  Track t;
+
+  t.emission          = em;
+  t.emission.id       = ++this->lastId;
+  t.emission.start    = em.end;
+  t.lastSeen          = em.end;
+  t.matched           = true;
+  t.reported          = false;
+
+  this->tracks.push_back(t);
+}
+
+void
+SignalDetector::process(
+    const SUFLOAT *psd,
+    size_t size,
+    SUFREQ fc,
+    unsigned int fs,
+    qreal timeStamp,
+    std::vector<SignalDetectorEvent> &events)
+{
+  SUFREQ binWidth, fStart;
+  size_t gap = this->params.mergeGap;
+  size_t i = 0;
+
+  if (size == 0 || fs == 0)
+    return;
+
+  // Another spectrum: nothing learned so far applies
+  if (size != this->floor.size() || fc != this->lastFc || fs != this->lastFs) {
+    this->endAll(events);
+    this->floor.assign(psd, psd + size);
+    this->frames = 1;
+    this->lastFc = fc;
+    this->lastFs = fs;
+  } else if (timeStamp < this->lastTime) {
+    // Replay rewound
+    this->endAll(events);
+  }
+
+  this->lastTime = timeStamp;
+
+  binWidth = static_cast<SUFREQ>(fs) / static_cast<SUFREQ>(size);
+  fStart = fc - .5 * static_cast<SUFREQ>(fs);
+
+  this->updateThresholds(psd, size);
+
+  while (i < size) {
+    size_t first, last, peakBin, misses = 0;
+
+    if (!this->detected[i]) {
+      ++i;
+      continue;
+    }
+
+    first = last = peakBin = i;
+
+    for (++i; i < size && misses <= gap; ++i) {
+      if (this->detected[i]) {
+        last = i;
+        misses = 0;
+        if (psd[i] > psd[peakBin])
+          peakBin = i;
+      } else {
+        ++misses;
+      }
+    }
+
+    i = last + 1;
+
+    if (last - first + 1 >= this->params.minBins) {
+      SignalEmission em;
+
+      em.fLow  = fStart + binWidth * static_cast<SUFREQ>(first);
+      em.fHigh = fStart + binWidth * static_cast<SUFREQ>(last + 1);
+      em.peak  = SU_POWER_DB(psd[peakBin]);
+      em.snr   = this->noise[peakBin] > 0
+          ? SU_POWER_DB(psd[peakBin] / this->noise[peakBin])
+          : 0;
+      em.end   = timeStamp;
+
+      this->track(em);
+    }
+  }
+
+  for (auto t = this->tracks.begin(); t != this->tracks.end(); ) {
+    if (!t->matched) {
+      if (timeStamp - t->lastSeen > this->params.hold) {
+        if (t->reported) {
+          SignalDetectorEvent ev;
+          ev.kind = SignalDetectorEvent::ENDED;
+          ev.emission = t->emission;
+          ev.emission.end = t->lastSeen;
+          events.push_back(ev);
+        }
+
+        t = this->tracks.erase(t);
+        continue;
+      }
+    } else if (!t->reported
+               && t->emission.duration() >= this->params.minDuration) {
+      SignalDetectorEvent ev;
+      ev.kind = SignalDetectorEvent::STARTED;
+      ev.emission = t->emission;
+      events.push_back(ev);
+      t->reported = true;
+    }
+
+    t->matched = false;
+    ++t;
+  }
+
+  this->updateFloor(psd, size);
+}
+
+void
+SignalDetector::process(
+    Suscan::PSDMessage const &msg,
+    std::vector<SignalDetectorEvent> &events)
+{
+  struct timeval tv = msg.getTimeStamp();
+
+  this->process(
+        msg.get(),
+        msg.size(),
+        msg.getFrequency(),
+        msg.getSampleRate(),
+        static_cast<qreal>(tv.tv_sec) + 1e-6 * tv.tv_usec,
+        events);
+}
+
+std::vector<SignalEmission>
+SignalDetector::getActive(void) const
+{
+  std::vector<SignalEmission> active;
+
+  for (auto &t : this->tracks)
+    if (t.reported)
+      active.push_back(t.emission);
+
+  return active;
+}
+
+SUFLOAT
+SignalDetector::getNoiseFloor(void) const
+{
+  std::vector<SUFLOAT> copy = this->floor;
+
+  if (copy.empty())
+    return 0;
+
+  std::nth_element(copy.begin(), copy.begin() + copy.size() / 2, copy.end());
+
+  return SU_POWER_DB(copy[copy.size() / 2]);
+}
+
+//////////////////////////// SignalDetectorWorker //////////////////////////////
+static QVector<SignalDetectorEvent>
+toQVector(std::vector<SignalDetectorEvent> const &events)
+{
+  QVector<SignalDetectorEvent> vec;
+
+  vec.reserve(static_cast<int>(events.size()));
+
+  for (auto &ev : events)
+    vec.append(ev);
+
+  return vec;
+}
+
+SignalDetectorWorker::SignalDetectorWorker(QObject *parent) : QObject(parent)
+{
+  if (!typesRegistered) {
+    qRegisterMetaType<SigDigger::SignalDetectorEvent>();
+    qRegisterMetaType<QVector<SigDigger::SignalDetectorEvent>>();
+    qRegisterMetaType<SigDigger::SignalDetectorParams>();
+    typesRegistered = true;
+  }
+
+  connect(
+        this,
+        SIGNAL(queuedPSD(Suscan::PSDMessage)),
+        this,
+        SLOT(onPSD(Suscan::PSDMessage)));
+}
+
+bool
+SignalDetectorWorker::offer(Suscan::PSDMessage const &msg)
+{
+  if (!this->busy.testAndSetAcquire(0, 1)) {
+    this->dropped.fetchAndAddRelaxed(1);
+    return false;
+  }
+
+  emit queuedPSD(msg);
+
+  return true;
+}
+
+void
+SignalDetectorWorker::onPSD(Suscan::PSDMessage msg)
+{
+  std::vector<SignalDetectorEvent> events;
+
+  this->detector.process(msg, events);
+  this->busy.storeRelease(0);
+
+  emit processed(
+        toQVector(events),
+        static_cast<qreal>(this->detector.getNoiseFloor()));
+}
+
+void
+SignalDetectorWorker::onParams(SigDigger::SignalDetectorParams params)
+{
+  this->detector.setParams(params);
+}
+
+void
+SignalDetectorWorker::onReset(void)
+{
+  std::vector<SignalDetectorEvent> events;
+
+  this->detector.reset(events);
+
+  emit processed(
+        toQVector(events),
+        0);
+}
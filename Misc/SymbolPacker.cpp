@@ -0,0 +1,86 @@
+//
+//    SymbolPacker.cpp: Bit-packed, framed symbol streams
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "SymbolPacker.h"
+#include "SampleKernels.h"
+#include <util/compat-in.h>
+#include <cstring>
+
+using namespace SigDigger;
+
+void
+SymbolPacker::reset(void)
+{
+  this->sequence = 0;
+}
+
+void
+SymbolPacker::appendFrame(
+    const uint8_t *symbols,
+    size_t size,
+    unsigned int bps)
+{
+  PackedSymbolHeader header;
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&header);
+  size_t start = this->frames.size();
+  uint8_t check = 0;
+
+  header.sync     = htonl(SIGDIGGER_SYMBOL_PACKER_SYNC);
+  header.sequence = htonl(this->sequence++);
+  header.symbols  = htons(static_cast<uint16_t>(size));
+  header.bps      = static_cast<uint8_t>(bps);
+
+  for (size_t i = 0; i < offsetof(PackedSymbolHeader, check); ++i)
+    check ^= bytes[i];
+  header.check = check;
+
+  this->frames.resize(start + sizeof(header) + (size * bps + 7) / 8);
+  memcpy(this->frames.data() + start, &header, sizeof(header));
+
+  SampleKernels::packSymbols(
+        this->frames.data() + start + sizeof(header),
+        symbols,
+        size,
+        bps);
+}
+
+std::vector<uint8_t> const &
+SymbolPacker::pack(const uint8_t *symbols, size_t size, unsigned int bps)
+{
+  size_t chunk;
+
+  if (bps < 1)
+    bps = 1;
+  else if (bps > 8)
+    bps = 8;
+
+  this->frames.clear();
+
+  while (size > 0) {
+    chunk = size < SIGDIGGER_SYMBOL_PACKER_MAX_SYMBOLS
+        ? size
+        : SIGDIGGER_SYMBOL_PACKER_MAX_SYMBOLS;
+
+    this->appendFrame(symbols, chunk, bps);
+
+    symbols += chunk;
+    size    -= chunk;
+  }
+
+  return this->frames;
+}
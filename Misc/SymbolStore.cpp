@@ -0,0 +1,390 @@
+//
+//    SymbolStore.cpp: Bit-packed symbol storage
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "SymbolStore.h"
+#include <sigutils/log.h>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstring>
+
+using namespace SigDigger;
+
+SymbolStore::SymbolStore() : account("Sampled symbols")
+{
+  this->account.setReclaimer(
+        [this] (size_t wanted) {
+          return this->reclaim(wanted);
+        });
+}
+
+SymbolStore::~SymbolStore()
+{
+  if (this->spill != nullptr)
+    fclose(this->spill);
+}
+
+void
+SymbolStore::setMemoryLimit(quint64 bytes)
+{
+  this->maxResidentPages = static_cast<size_t>(
+        (bytes + SIGDIGGER_SYMBOL_STORE_PAGE_BYTES - 1)
+        / SIGDIGGER_SYMBOL_STORE_PAGE_BYTES);
+}
+
+void
+SymbolStore::setBitsPerSymbol(unsigned int bps)
+{
+  if (bps < 1)
+    bps = 1;
+  else if (bps > 8)
+    bps = 8;
+
+  if (this->bps != bps) {
+    this->clear();
+    this->bps = bps;
+  }
+}
+
+void
+SymbolStore::pushByte(quint8 byte)
+{
+  size_t page = static_cast<size_t>(
+        this->bytes / SIGDIGGER_SYMBOL_STORE_PAGE_BYTES);
+
+  if (page == this->pages.size()) {
+    this->pages.push_back(
+          std::unique_ptr<quint8[]>(
+            new quint8[SIGDIGGER_SYMBOL_STORE_PAGE_BYTES]));
+
+    // Only complete pages leave memory
+    if (this->maxResidentPages > 0
+        && this->pages.size() - this->spilledPages > this->maxResidentPages)
+      this->spillPage();
+
+    this->account.set(static_cast<size_t>(this->getMemoryUsage()));
+  }
+
+  this->pages[page][this->bytes % SIGDIGGER_SYMBOL_STORE_PAGE_BYTES] = byte;
+  ++this->bytes;
+}
+
+// The last page may be incomplete, and it stays in memory
+size_t
+SymbolStore::reclaim(size_t wanted)
+{
+  size_t freed = 0;
+
+  this->readPage.reset();
+  this->readPageIndex = SIZE_MAX;
+
+  while (freed < wanted
+         && !this->spillFailed
+         && this->pages.size() - this->spilledPages > 1) {
+    this->spillPage();
+    if (!this->spillFailed)
+      freed += SIGDIGGER_SYMBOL_STORE_PAGE_BYTES;
+  }
+
+  this->account.set(static_cast<size_t>(this->getMemoryUsage()));
+
+  return freed;
+}
+
+void
+SymbolStore::spillPage(void)
+{
+  size_t page = this->spilledPages;
+  long offset = static_cast<long>(page) * SIGDIGGER_SYMBOL_STORE_PAGE_BYTES;
+
+  if (this->spillFailed)
+    return;
+
+  if (this->spill == nullptr && (this->spill = tmpfile()) == nullptr) {
+    SU_WARNING("Cannot create symbol spill file, keeping symbols in memory\n");
+    this->spillFailed = true;
+    return;
+  }
+
+  if (fseek(this->spill, offset, SEEK_SET) != 0
+      || fwrite(
+        this->pages[page].get(),
+        SIGDIGGER_SYMBOL_STORE_PAGE_BYTES,
+        1,
+        this->spill) != 1
+      || fflush(this->spill) != 0) {
+    SU_WARNING("Cannot write symbol spill file, keeping symbols in memory\n");
+    this->spillFailed = true;
+    return;
+  }
+
+  this->pages[page].reset();
+  ++this->spilledPages;
+}
+
+const quint8 *
+SymbolStore::pageData(size_t page) const
+{
+  long offset;
+
+  if (this->pages[page])
+    return this->pages[page].get();
+
+  if (this->readPageIndex == page)
+    return this->readPage.get();
+
+  if (!this->readPage)
+    this->readPage.reset(new quint8[SIGDIGGER_SYMBOL_STORE_PAGE_BYTES]);
+
+  offset = static_cast<long>(page) * SIGDIGGER_SYMBOL_STORE_PAGE_BYTES;
+
+  if (fseek(this->spill, offset, SEEK_SET) != 0
+      || fread(
+        this->readPage.get(),
+        SIGDIGGER_SYMBOL_STORE_PAGE_BYTES,
+        1,
+        this->spill) != 1) {
+    SU_WARNING("Cannot read back symbol page %zu\n", page);
+    memset(this->readPage.get(), 0, SIGDIGGER_SYMBOL_STORE_PAGE_BYTES);
+  }
+
+  this->readPageIndex = page;
+
+  return this->readPage.get();
+}
+
+quint8
+SymbolStore::byteAt(quint64 index) const
+{
+  if (index < this->bytes)
+    return this->pageData(
+          static_cast<size_t>(index / SIGDIGGER_SYMBOL_STORE_PAGE_BYTES))
+        [index % SIGDIGGER_SYMBOL_STORE_PAGE_BYTES];
+
+  // Incomplete byte, left-aligned like the complete ones
+  return static_cast<quint8>(this->acc << (8 - this->accBits));
+}
+
+void
+SymbolStore::append(const Symbol *data, size_t size)
+{
+  quint32 mask = (1u << this->bps) - 1;
+  size_t i = 0;
+
+  // Fast path: whole bytes of 1-bit symbols
+  if (this->bps == 1) {
+    while (i < size && this->accBits != 0) {
+      this->acc = (this->acc << 1) | (data[i++] & 1u);
+      if (++this->accBits == 8) {
+        this->pushByte(static_cast<quint8>(this->acc));
+        this->acc = this->accBits = 0;
+      }
+    }
+
+    for (; i + 8 <= size; i += 8) {
+      quint8 byte = 0;
+
+      for (unsigned int b = 0; b < 8; ++b)
+        byte = static_cast<quint8>((byte << 1) | (data[i + b] & 1u));
+
+      this->pushByte(byte);
+    }
+  }
+
+  for (; i < size; ++i) {
+    this->acc = (this->acc << this->bps) | (data[i] & mask);
+    this->accBits += this->bps;
+
+    if (this->accBits >= 8) {
+      this->accBits -= 8;
+      this->pushByte(static_cast<quint8>(this->acc >> this->accBits));
+      this->acc &= (1u << this->accBits) - 1;
+    }
+  }
+
+  this->count += size;
+}
+
+void
+SymbolStore::clear(void)
+{
+  this->pages.clear();
+
+  if (this->spill != nullptr) {
+    fclose(this->spill);
+    this->spill = nullptr;
+  }
+
+  this->spilledPages  = 0;
+  this->spillFailed   = false;
+  this->readPageIndex = SIZE_MAX;
+
+  this->count   = 0;
+  this->bytes   = 0;
+  this->acc     = 0;
+  this->accBits = 0;
+
+  this->account.set(0);
+}
+
+size_t
+SymbolStore::size(void) const
+{
+  return this->count;
+}
+
+quint64
+SymbolStore::getBitCount(void) const
+{
+  return static_cast<quint64>(this->count) * this->bps;
+}
+
+quint64
+SymbolStore::getMemoryUsage(void) const
+{
+  return static_cast<quint64>(this->pages.size() - this->spilledPages)
+      * SIGDIGGER_SYMBOL_STORE_PAGE_BYTES;
+}
+
+quint64
+SymbolStore::getSpilledBytes(void) const
+{
+  return static_cast<quint64>(this->spilledPages)
+      * SIGDIGGER_SYMBOL_STORE_PAGE_BYTES;
+}
+
+size_t
+SymbolStore::read(size_t offset, Symbol *dest, size_t size) const
+{
+  quint32 mask = (1u << this->bps) - 1;
+  quint64 bit;
+
+  if (offset >= this->count)
+    return 0;
+
+  size = std::min(size, this->count - offset);
+  bit  = static_cast<quint64>(offset) * this->bps;
+
+  for (size_t i = 0; i < size; ++i, bit += this->bps) {
+    // A symbol spans two bytes at most
+    quint32 word = static_cast<quint32>(this->byteAt(bit >> 3)) << 8;
+    unsigned int shift = static_cast<unsigned int>(bit & 7);
+
+    if (shift + this->bps > 8)
+      word |= this->byteAt((bit >> 3) + 1);
+
+    dest[i] = static_cast<Symbol>(
+          (word >> (16 - shift - this->bps)) & mask);
+  }
+
+  return size;
+}
+
+bool
+SymbolStore::writePacked(FILE *fp) const
+{
+  quint64 left = this->bytes;
+
+  for (size_t i = 0; i < this->pages.size(); ++i) {
+    size_t chunk = static_cast<size_t>(
+          std::min<quint64>(left, SIGDIGGER_SYMBOL_STORE_PAGE_BYTES));
+
+    if (fwrite(this->pageData(i), 1, chunk, fp) != chunk)
+      return false;
+
+    left -= chunk;
+  }
+
+  if (this->accBits > 0) {
+    quint8 last = this->byteAt(this->bytes);
+    if (fwrite(&last, 1, 1, fp) != 1)
+      return false;
+  }
+
+  return true;
+}
+
+bool
+SymbolStore::find(
+    quint64 pattern,
+    quint64 care,
+    unsigned int length,
+    unsigned int maxErrors,
+    std::vector<size_t> &hits,
+    size_t maxHits) const
+{
+  quint64 totalBits = this->getBitCount();
+  quint64 totalBytes = (totalBits + 7) >> 3;
+  quint64 window = 0;
+  quint64 next = 0;
+  quint64 current = 0;   // Byte the window starts at
+  quint64 fetched = 0;   // Bytes read into window and next
+
+  hits.clear();
+
+  if (length == 0 || length > SIGDIGGER_SYMBOL_STORE_MAX_PATTERN)
+    return false;
+
+  // Left-align the pattern, so that it lines up with the window
+  if (length < 64) {
+    pattern <<= 64 - length;
+    care    <<= 64 - length;
+  }
+
+  pattern &= care;
+
+  // Bytes past the end of the stream read as zero
+  auto fetch = [&] () -> quint64 {
+    quint64 index = fetched++;
+
+    if (index >= totalBytes)
+      return 0;
+
+    return this->byteAt(index);
+  };
+
+  // The window holds the 64 bits starting at byte `current`. Together
+  // with the byte after it, it covers every match starting in it.
+  for (unsigned int i = 0; i < 8; ++i)
+    window = (window << 8) | fetch();
+  next = fetch();
+
+  for (quint64 bit = 0; bit + length <= totalBits; bit += this->bps) {
+    unsigned int s = static_cast<unsigned int>(bit & 7);
+    quint64 w;
+
+    while (current < (bit >> 3)) {
+      window = (window << 8) | next;
+      next   = fetch();
+      ++current;
+    }
+
+    w = s == 0 ? window : (window << s) | (next >> (8 - s));
+    w = (w ^ pattern) & care;
+
+    if (w == 0
+        || (maxErrors > 0
+            && static_cast<unsigned int>(qPopulationCount(w)) <= maxErrors)) {
+      hits.push_back(static_cast<size_t>(bit / this->bps));
+      if (maxHits != 0 && hits.size() >= maxHits)
+        break;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,496 @@
+//
+//    TaskBenchmark.cpp: Microbenchmarks of the Tasks kernels
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <TaskBenchmark.h>
+#include <CarrierDetector.h>
+#include <DopplerCalculator.h>
+#include <CostasRecoveryTask.h>
+#include <PLLSyncTask.h>
+#include <AGCTask.h>
+#include <LPFTask.h>
+#include <QuadDemodTask.h>
+#include <DelayedConjTask.h>
+#include <WaveSampler.h>
+#include <HistogramFeeder.h>
+#include <CarrierXlator.h>
+#include <Scanner.h>
+#include <SampleKernels.h>
+#include <Suscan/Library.h>
+#include <SuWidgetsHelpers.h>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QFile>
+#include <getopt.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef __GLIBC__
+#  include <malloc.h>
+#endif // __GLIBC__
+
+using namespace SigDigger;
+
+namespace SigDigger {
+  //
+  // Sweep processing of the panoramic spectrum, as a task: every step
+  // feeds one hop into a SpectrumView, half a hop bandwidth after the
+  // previous one. There are as many hops as PSDs fit in the input, whose
+  // powers (in dB) are the bins of the PSD.
+  //
+  class SweepTask : public Suscan::CancellableTask {
+    SpectrumView view;
+    std::vector<SUFLOAT> psd;
+    SUFREQ fs;
+    size_t hops;
+    size_t hop = 0;
+
+  public:
+    SweepTask(const SUCOMPLEX *x, size_t size, SUFREQ fs) : fs(fs)
+    {
+      size_t i;
+
+      this->psd.resize(SIGDIGGER_TASK_BENCHMARK_SWEEP_PSD_SIZE);
+      for (i = 0; i < this->psd.size(); ++i) {
+        SUCOMPLEX v = x[i % size];
+        this->psd[i] = SU_POWER_DB(SU_C_REAL(v * SU_C_CONJ(v)) + 1e-20f);
+      }
+
+      this->hops = std::max<size_t>(1, size / this->psd.size());
+
+      this->view.fftBandwidth = fs;
+      this->view.setRange(0, (this->hops + 1) * fs / 2);
+    }
+
+    bool
+    work(void) override
+    {
+      this->view.feed(this->psd.data(), (this->hop + 1) * this->fs / 2);
+
+      if (++this->hop < this->hops)
+        return true;
+
+      emit done();
+      return false;
+    }
+
+    void
+    cancel(void) override
+    {
+      emit cancelled();
+    }
+  };
+}
+
+void
+TaskBenchmark::help(const char *argv0)
+{
+  fprintf(stderr, "%s: SigDigger task microbenchmarks\n", argv0);
+  fprintf(stderr, "Usage:\n");
+  fprintf(stderr, "  %s -t TaskBenchmark -- [options]\n\n", argv0);
+
+  fprintf(stderr, "Options:\n\n");
+  fprintf(stderr, "     -k, --tasks=LIST        Comma-separated tasks to run\n");
+  fprintf(stderr, "                             (default: all of them)\n");
+  fprintf(stderr, "     -s, --sizes=LIST        Comma-separated sizes, in samples\n");
+  fprintf(stderr, "                             (default: 4096,65536,1048576)\n");
+  fprintf(stderr, "     -r, --repeat=N          Runs per task and size (default: %d)\n",
+          SIGDIGGER_TASK_BENCHMARK_DEFAULT_REPEAT);
+  fprintf(stderr, "     -S, --seed=SEED         Seed of the input signal (default: %d)\n",
+          SIGDIGGER_TASK_BENCHMARK_DEFAULT_SEED);
+  fprintf(stderr, "     -l, --list              List tasks and exit\n");
+  fprintf(stderr, "     -o, --output=PATH       JSON report (default: stdout)\n");
+  BenchmarkHistory::help();
+  fprintf(stderr, "     -h, --help              This help\n\n");
+}
+
+bool
+TaskBenchmark::parse(int argc, char **argv)
+{
+  static struct option options[] = {
+    {"tasks",     required_argument, nullptr, 'k' },
+    {"sizes",     required_argument, nullptr, 's' },
+    {"repeat",    required_argument, nullptr, 'r' },
+    {"seed",      required_argument, nullptr, 'S' },
+    {"list",      no_argument,       nullptr, 'l' },
+    {"output",    required_argument, nullptr, 'o' },
+    {"history",   required_argument, nullptr, 'H' },
+    {"tolerance", required_argument, nullptr, 'E' },
+    {"no-record", no_argument,       nullptr, 'N' },
+    {"help",      no_argument,       nullptr, 'h' },
+    {nullptr,     0,                 nullptr, 0 }
+  };
+  int c;
+
+  this->makeKernels();
+
+  optind = 0;
+
+  while ((c = getopt_long(argc, argv, "k:s:r:S:lo:H:E:Nh", options, nullptr))
+         != -1) {
+    switch (c) {
+      case 'k':
+        this->tasks = QString(optarg).split(",", QString::SkipEmptyParts);
+        break;
+
+      case 's':
+        this->sizes.clear();
+        for (auto &p : QString(optarg).split(",", QString::SkipEmptyParts))
+          this->sizes.push_back(SCAST(size_t, p.toULongLong()));
+        break;
+
+      case 'r':
+        this->repeat = SCAST(unsigned, atoi(optarg));
+        break;
+
+      case 'S':
+        this->seed = SCAST(unsigned, strtoul(optarg, nullptr, 0));
+        break;
+
+      case 'l':
+        for (auto &p : this->kernels)
+          printf("%s\n", p.name.toStdString().c_str());
+        return false;
+
+      case 'o':
+        this->output = optarg;
+        break;
+
+      case 'H':
+        this->history.setDirectory(optarg);
+        break;
+
+      case 'E':
+        if (!this->history.setTolerances(optarg)) {
+          fprintf(stderr, "%s: invalid tolerance `%s'\n", argv[0], optarg);
+          return false;
+        }
+        break;
+
+      case 'N':
+        this->history.setRecording(false);
+        break;
+
+      default:
+        help(argv[0]);
+        return false;
+    }
+  }
+
+  for (auto &p : this->tasks) {
+    bool found = false;
+
+    for (auto &k : this->kernels)
+      if (k.name == p)
+        found = true;
+
+    if (!found) {
+      fprintf(
+            stderr,
+            "%s: unknown task `%s' (see --list)\n",
+            argv[0],
+            p.toStdString().c_str());
+      return false;
+    }
+  }
+
+  if (this->repeat < 1)
+    this->repeat = 1;
+
+  for (auto p : this->sizes) {
+    if (p == 0) {
+      fprintf(stderr, "%s: invalid size\n", argv[0]);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//
+// Unit-amplitude BPSK at 8 samples per symbol, with a small carrier
+// offset and white noise. Same seed, same signal.
+//
+void
+TaskBenchmark::makeInput(size_t size)
+{
+  std::mt19937 rng(this->seed);
+  std::normal_distribution<SUFLOAT> noise(0, .05f);
+  std::bernoulli_distribution bit(.5);
+  SUFLOAT symbol = 1;
+  SUFLOAT omega = SCAST(SUFLOAT, 2 * M_PI * 1e-3);
+
+  this->input.resize(size);
+  this->destination.resize(size);
+
+  for (size_t i = 0; i < size; ++i) {
+    if (i % 8 == 0)
+      symbol = bit(rng) ? 1 : -1;
+
+    this->input[i] =
+        symbol * SU_C_EXP(SUCOMPLEX(0, omega * SCAST(SUFLOAT, i)))
+        + SUCOMPLEX(noise(rng), noise(rng));
+  }
+}
+
+void
+TaskBenchmark::makeKernels(void)
+{
+  SUFLOAT fs = this->fs;
+  Decider *decider = &this->decider;
+
+  this->decider.setDecisionMode(Decider::MODULUS);
+  this->decider.setMinimum(0);
+  this->decider.setMaximum(1.5);
+  this->decider.setBps(1);
+
+  // Sampling properties shared by WaveSampler and HistogramFeeder
+  auto sampling = [fs] (const SUCOMPLEX *data, size_t len) {
+    SamplingProperties props;
+
+    props.sync              = SamplingClockSync::GARDNER;
+    props.space             = SamplingSpace::AMPLITUDE;
+    props.fs                = fs;
+    props.loopGain          = 0;
+    props.threshold         = 0;
+    props.zeroCrossingAngle = 1;
+    props.data              = data;
+    props.length            = len;
+    props.symbolSync        = 0;
+    props.symbolCount       = SCAST(qreal, len) / 8;
+    props.rate              = SCAST(qreal, fs) / 8;
+
+    return props;
+  };
+
+  this->kernels = {
+    {"CarrierDetector", [] (const SUCOMPLEX *x, SUCOMPLEX *, size_t n) {
+      return new CarrierDetector(x, n, 1e-2, 1e-3);
+    }},
+    {"DopplerCalculator", [fs] (const SUCOMPLEX *x, SUCOMPLEX *, size_t n) {
+      return new DopplerCalculator(1e9, x, n, fs);
+    }},
+    {"CostasRecoveryTask", [] (const SUCOMPLEX *x, SUCOMPLEX *y, size_t n) {
+      return new CostasRecoveryTask(x, y, n, 100, 1e-2, SU_COSTAS_KIND_BPSK);
+    }},
+    {"PLLSyncTask", [] (const SUCOMPLEX *x, SUCOMPLEX *y, size_t n) {
+      return new PLLSyncTask(x, y, n, 1e-2);
+    }},
+    {"AGCTask", [] (const SUCOMPLEX *x, SUCOMPLEX *y, size_t n) {
+      return new AGCTask(x, y, n, 100);
+    }},
+    {"LPFTask", [] (const SUCOMPLEX *x, SUCOMPLEX *y, size_t n) {
+      return new LPFTask(x, y, n, .2f);
+    }},
+    {"QuadDemodTask", [] (const SUCOMPLEX *x, SUCOMPLEX *y, size_t n) {
+      return new QuadDemodTask(x, y, n, true);
+    }},
+    {"DelayedConjTask", [] (const SUCOMPLEX *x, SUCOMPLEX *y, size_t n) {
+      return new DelayedConjTask(x, y, n, 8);
+    }},
+    {"WaveSampler", [sampling, decider] (const SUCOMPLEX *x, SUCOMPLEX *, size_t n) {
+      return new WaveSampler(sampling(x, n), decider);
+    }},
+    {"HistogramFeeder", [sampling] (const SUCOMPLEX *x, SUCOMPLEX *, size_t n) {
+      return new HistogramFeeder(sampling(x, n));
+    }},
+    {"CarrierXlator", [] (const SUCOMPLEX *x, SUCOMPLEX *y, size_t n) {
+      return new CarrierXlator(x, y, n, .1f, 0);
+    }},
+    {"SpectrumView", [fs] (const SUCOMPLEX *x, SUCOMPLEX *, size_t n) {
+      return new SweepTask(x, n, fs);
+    }},
+  };
+}
+
+size_t
+TaskBenchmark::heapInUse(void)
+{
+#ifdef __GLIBC__
+  // Still there in newer glibcs, only deprecated in favour of mallinfo2
+  struct mallinfo info = mallinfo();
+
+  return SCAST(size_t, SCAST(unsigned, info.uordblks))
+      + SCAST(size_t, SCAST(unsigned, info.hblkhd));
+#else
+  return 0;
+#endif // __GLIBC__
+}
+
+static qint64
+threadCpuNs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+  return SCAST(qint64, ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+QJsonObject
+TaskBenchmark::run(Kernel const &kernel, size_t size)
+{
+  QJsonObject result;
+  QElapsedTimer timer;
+  qint64 bestWall = -1, bestCpu = -1;
+  size_t heapPeak = 0;
+  uint64_t steps = 0;
+  struct rusage usage;
+  bool failed = false;
+
+  for (unsigned int i = 0; i < this->repeat && !failed; ++i) {
+    size_t heapBase = heapInUse();
+    size_t runPeak  = 0;
+    qint64 wall, cpu;
+    Suscan::CancellableTask *task;
+
+    steps = 0;
+
+    // Construction is part of what a caller pays for, so it is timed too.
+    // CPU time is that of this thread only: work handed to thread pools
+    // shows up in the wall time.
+    timer.start();
+    cpu = threadCpuNs();
+
+    try {
+      task = kernel.make(this->input.data(), this->destination.data(), size);
+    } catch (Suscan::Exception const &e) {
+      result["error"] = QString(e.what());
+      failed = true;
+      break;
+    }
+
+    do {
+      size_t heap = heapInUse();
+      if (heap > heapBase && heap - heapBase > runPeak)
+        runPeak = heap - heapBase;
+      ++steps;
+    } while (task->step());
+
+    delete task;
+
+    wall = timer.nsecsElapsed();
+    cpu  = threadCpuNs() - cpu;
+
+    if (bestWall < 0 || wall < bestWall)
+      bestWall = wall;
+    if (bestCpu < 0 || cpu < bestCpu)
+      bestCpu = cpu;
+    if (runPeak > heapPeak)
+      heapPeak = runPeak;
+  }
+
+  getrusage(RUSAGE_SELF, &usage);
+
+  result["task"]  = kernel.name;
+  result["size"]  = SCAST(qint64, size);
+  result["steps"] = SCAST(qint64, steps);
+
+  if (!failed) {
+    result["ns_per_sample"]     = SCAST(qreal, bestWall) / SCAST(qreal, size);
+    result["cpu_ns_per_sample"] = SCAST(qreal, bestCpu) / SCAST(qreal, size);
+    result["samples_per_s"]     = bestWall > 0 ? size * 1e9 / bestWall : 0.;
+  }
+
+  result["heap_peak_bytes"] = SCAST(qint64, heapPeak);
+  result["max_rss_kb"]      = SCAST(qint64, usage.ru_maxrss);
+
+  return result;
+}
+
+bool
+TaskBenchmark::run(void)
+{
+  QJsonObject config;
+
+  for (auto size : this->sizes) {
+    this->makeInput(size);
+
+    for (auto &p : this->kernels) {
+      if (!this->tasks.isEmpty() && !this->tasks.contains(p.name))
+        continue;
+
+      fprintf(
+            stderr,
+            "Running %s on %zu samples...\n",
+            p.name.toStdString().c_str(),
+            size);
+
+      this->results.append(this->run(p, size));
+    }
+  }
+
+  // Sizes and task subsets do not matter: each one is a metric of its own
+  config["seed"]   = SCAST(qint64, this->seed);
+  config["repeat"] = SCAST(qint64, this->repeat);
+  this->history.setConfig(config);
+
+  for (auto p : this->results) {
+    QJsonObject result = p.toObject();
+
+    if (result.contains("ns_per_sample"))
+      this->history.addMetric(
+            result["task"].toString()
+            + "/" + QString::number(SCAST(qint64, result["size"].toDouble()))
+            + "/ns_per_sample",
+            result["ns_per_sample"].toDouble(),
+            BenchmarkHistory::LOWER_IS_BETTER);
+  }
+
+  // Failing to record is reported, but the results are still valid
+  this->history.process();
+
+  return true;
+}
+
+bool
+TaskBenchmark::writeReport(void) const
+{
+  QJsonObject report;
+  QByteArray json;
+
+  report["seed"]    = SCAST(qint64, this->seed);
+  report["repeat"]  = SCAST(qint64, this->repeat);
+  report["kernels"] = SampleKernels::isaName();
+  report["results"] = this->results;
+  report["baseline"] = this->history.toJson();
+
+  json = QJsonDocument(report).toJson();
+
+  if (this->output.isEmpty()) {
+    fwrite(json.constData(), 1, SCAST(size_t, json.size()), stdout);
+    fflush(stdout);
+    return true;
+  }
+
+  QFile file(this->output);
+
+  if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+    fprintf(
+          stderr,
+          "Cannot write report to %s: %s\n",
+          this->output.toStdString().c_str(),
+          file.errorString().toStdString().c_str());
+    return false;
+  }
+
+  return true;
+}
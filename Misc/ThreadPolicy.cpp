@@ -0,0 +1,177 @@
+//
+//    ThreadPolicy.cpp: Per-role thread placement
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "ThreadPolicy.h"
+#include <QMutexLocker>
+#include <QThread>
+#include <Suscan/Library.h>
+#include <cstring>
+
+#ifdef __linux__
+#  include <pthread.h>
+#endif // __linux__
+
+using namespace SigDigger;
+
+ThreadPolicy *ThreadPolicy::currInstance = nullptr;
+
+ThreadPolicy *
+ThreadPolicy::instance(void)
+{
+  if (currInstance == nullptr)
+    currInstance = new ThreadPolicy();
+
+  return currInstance;
+}
+
+ThreadPolicy::ThreadPolicy()
+{
+#ifdef __linux__
+  // Threads without CPUs of their own go back to these
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &this->processMask) != 0) {
+    CPU_ZERO(&this->processMask);
+    for (int i = 0; i < CPU_SETSIZE; ++i)
+      CPU_SET(i, &this->processMask);
+  }
+#endif // __linux__
+}
+
+void
+ThreadPolicy::warn(const char *what, int error)
+{
+  // Once per configuration change, not once per thread
+  if (this->warned)
+    return;
+
+  this->warned = true;
+
+  SU_WARNING(
+        "Cannot set thread %s: %s\n",
+        what,
+        strerror(error));
+}
+
+#ifdef __linux__
+void
+ThreadPolicy::applyTo(Qt::HANDLE handle, ThreadRolePolicy const &policy)
+{
+  pthread_t thread = reinterpret_cast<pthread_t>(handle);
+  std::vector<int> cpus;
+  struct sched_param param;
+  cpu_set_t mask;
+  int sched;
+  int error;
+
+  if (ThreadConfig::parseCpus(policy.cpus, cpus) && !cpus.empty()) {
+    CPU_ZERO(&mask);
+    for (auto cpu : cpus)
+      if (cpu < CPU_SETSIZE)
+        CPU_SET(cpu, &mask);
+  } else {
+    mask = this->processMask;
+  }
+
+  if ((error = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &mask)) != 0)
+    this->warn("CPU affinity", error);
+
+  if (policy.priority > 0) {
+    param.sched_priority = qBound(
+          sched_get_priority_min(SCHED_FIFO),
+          policy.priority,
+          sched_get_priority_max(SCHED_FIFO));
+
+    // EPERM here usually means RLIMIT_RTPRIO is 0 for this user
+    if ((error = pthread_setschedparam(thread, SCHED_FIFO, &param)) != 0)
+      this->warn("real-time priority", error);
+  } else if (pthread_getschedparam(thread, &sched, &param) == 0
+             && sched == SCHED_FIFO) {
+    param.sched_priority = 0;
+    if ((error = pthread_setschedparam(thread, SCHED_OTHER, &param)) != 0)
+      this->warn("default scheduling", error);
+  }
+}
+#else
+void
+ThreadPolicy::applyTo(Qt::HANDLE handle, ThreadRolePolicy const &policy)
+{
+  // No affinity API here. Priorities can only be raised from the thread
+  // itself, through Qt.
+  if (handle == QThread::currentThreadId() && policy.priority > 0)
+    QThread::currentThread()->setPriority(QThread::TimeCriticalPriority);
+}
+#endif // __linux__
+
+void
+ThreadPolicy::setConfig(ThreadConfig const &config)
+{
+  QMutexLocker locker(&this->mutex);
+
+  this->config = config;
+  this->warned = false;
+
+  for (auto it = this->threads.begin(); it != this->threads.end(); ++it)
+    this->applyTo(it.key(), this->config.roles[it.value()]);
+}
+
+ThreadConfig
+ThreadPolicy::getConfig(void)
+{
+  QMutexLocker locker(&this->mutex);
+
+  return this->config;
+}
+
+void
+ThreadPolicy::enter(ThreadRole role)
+{
+  QMutexLocker locker(&this->mutex);
+  Qt::HANDLE self = QThread::currentThreadId();
+
+  this->threads[self] = role;
+
+  // Nothing to undo yet
+  if (!this->config.roles[role].isDefault())
+    this->applyTo(self, this->config.roles[role]);
+}
+
+void
+ThreadPolicy::leave(void)
+{
+  QMutexLocker locker(&this->mutex);
+
+  this->threads.remove(QThread::currentThreadId());
+}
+
+void
+ThreadPolicy::bind(QThread *thread, ThreadRole role)
+{
+  // Both are emitted from the thread itself
+  QObject::connect(
+        thread,
+        &QThread::started,
+        thread,
+        [role] () { ThreadPolicy::instance()->enter(role); },
+        Qt::DirectConnection);
+
+  QObject::connect(
+        thread,
+        &QThread::finished,
+        thread,
+        [] () { ThreadPolicy::instance()->leave(); },
+        Qt::DirectConnection);
+}
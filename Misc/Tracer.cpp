@@ -0,0 +1,180 @@
+//
+//    Tracer.cpp: Low overhead scoped tracing of hot paths
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <Tracer.h>
+#include <QCoreApplication>
+#include <QThread>
+#include <QFile>
+#include <chrono>
+
+using namespace SigDigger;
+
+std::atomic<bool> Tracer::enabled(false);
+
+static thread_local TraceRing *currentRing = nullptr;
+static std::atomic<int64_t> clearedAt(0);
+
+TraceRing::TraceRing(uint32_t tid) :
+  events(SIGDIGGER_TRACER_RING_SIZE),
+  head(0),
+  tid(tid)
+{
+}
+
+Tracer::Tracer()
+{
+  if (!qgetenv(SIGDIGGER_TRACER_ENV).isEmpty())
+    this->setEnabled(true);
+}
+
+Tracer *
+Tracer::instance(void)
+{
+  static Tracer tracer;
+
+  return &tracer;
+}
+
+int64_t
+Tracer::now(void)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void
+Tracer::setEnabled(bool enabled)
+{
+  Tracer::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+TraceRing *
+Tracer::makeRing(void)
+{
+  std::lock_guard<std::mutex> guard(this->ringMutex);
+  QThread *thread = QThread::currentThread();
+  TraceRing *ring = new TraceRing(++this->lastTid);
+
+  if (QCoreApplication::instance() != nullptr
+      && thread == QCoreApplication::instance()->thread())
+    ring->threadName = "GUI";
+  else if (thread != nullptr && !thread->objectName().isEmpty())
+    ring->threadName = thread->objectName();
+  else
+    ring->threadName = "Thread " + QString::number(ring->tid);
+
+  this->rings.push_back(ring);
+
+  return ring;
+}
+
+void
+Tracer::record(const char *name, int64_t startNs, int64_t durationNs)
+{
+  TraceRing *ring = currentRing;
+  uint64_t head;
+
+  if (ring == nullptr)
+    ring = currentRing = this->makeRing();
+
+  head = ring->head.load(std::memory_order_relaxed);
+  ring->events[head % SIGDIGGER_TRACER_RING_SIZE] =
+      {name, startNs, durationNs};
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+void
+Tracer::clear(void)
+{
+  clearedAt = Tracer::now();
+}
+
+//
+// Rings are read while their threads keep writing. An event is trusted if
+// it was still inside the ring after the copy was made.
+//
+QByteArray
+Tracer::exportChromeTrace(void)
+{
+  QByteArray json;
+  int64_t epoch = clearedAt;
+  std::vector<TraceEvent> copy(SIGDIGGER_TRACER_RING_SIZE);
+  std::lock_guard<std::mutex> guard(this->ringMutex);
+  bool first = true;
+
+  json += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+  for (auto ring : this->rings) {
+    uint64_t before = ring->head.load(std::memory_order_acquire);
+    uint64_t after;
+    uint64_t oldest;
+
+    copy = ring->events;
+    after = ring->head.load(std::memory_order_acquire);
+
+    // Everything older than this may have been overwritten while copying
+    oldest = after > SIGDIGGER_TRACER_RING_SIZE
+        ? after - SIGDIGGER_TRACER_RING_SIZE + 1
+        : 0;
+
+    if (!first)
+      json += ",";
+    first = false;
+
+    json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+        + QByteArray::number(ring->tid)
+        + ",\"args\":{\"name\":\""
+        + ring->threadName.toUtf8()
+        + "\"}}";
+
+    for (uint64_t i = oldest; i < before; ++i) {
+      TraceEvent const &ev = copy[i % SIGDIGGER_TRACER_RING_SIZE];
+
+      if (ev.startNs < epoch)
+        continue;
+
+      json += ",{\"name\":\"";
+      json += ev.name;
+      json += "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+          + QByteArray::number(ring->tid)
+          + ",\"ts\":"
+          + QByteArray::number(ev.startNs * 1e-3, 'f', 3)
+          + ",\"dur\":"
+          + QByteArray::number(ev.durationNs * 1e-3, 'f', 3)
+          + "}";
+    }
+  }
+
+  json += "]}\n";
+
+  return json;
+}
+
+bool
+Tracer::saveChromeTrace(QString const &path, QString &error)
+{
+  QFile file(path);
+  QByteArray json = this->exportChromeTrace();
+
+  if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+    error = file.errorString();
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,240 @@
+//
+//    Misc/TransformHistory.cpp: Recipe-based undo history of TimeWindow transforms
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include <TransformHistory.h>
+#include <new>
+
+using namespace SigDigger;
+
+TransformHistory::TransformHistory() : account("Transform checkpoints")
+{
+  this->account.setReclaimer(
+        [this] (size_t wanted) {
+          return this->reclaim(wanted);
+        });
+}
+
+quint64
+TransformHistory::bytes(std::vector<SUCOMPLEX> const &state)
+{
+  return static_cast<quint64>(state.size()) * sizeof(SUCOMPLEX);
+}
+
+void
+TransformHistory::dropCheckpoint(size_t index)
+{
+  Entry &entry = this->entries[index];
+
+  this->ramBytes -= bytes(entry.checkpoint);
+  std::vector<SUCOMPLEX>().swap(entry.checkpoint);
+  this->account.set(this->ramBytes);
+}
+
+// Returns entries.size() if there is none (other than keep)
+size_t
+TransformHistory::farthestCheckpoint(size_t keep) const
+{
+  size_t victim = this->entries.size();
+  size_t farthest = 0;
+
+  for (size_t i = 0; i < this->entries.size(); ++i) {
+    size_t pos = i + 1;
+    size_t distance = pos > this->cursor
+        ? pos - this->cursor
+        : this->cursor - pos;
+
+    if (i == keep || this->entries[i].checkpoint.empty())
+      continue;
+
+    if (victim == this->entries.size() || distance >= farthest) {
+      victim = i;
+      farthest = distance;
+    }
+  }
+
+  return victim;
+}
+
+bool
+TransformHistory::makeRoom(quint64 size, size_t keep)
+{
+  if (size > this->ramCapacity)
+    return false;
+
+  while (this->ramBytes + size > this->ramCapacity) {
+    size_t victim = this->farthestCheckpoint(keep);
+
+    if (victim == this->entries.size())
+      return false;
+
+    this->dropCheckpoint(victim);
+  }
+
+  return true;
+}
+
+// The checkpoint of the current position goes last
+size_t
+TransformHistory::reclaim(size_t wanted)
+{
+  quint64 before = this->ramBytes;
+  size_t keep = this->cursor > 0 ? this->cursor - 1 : this->entries.size();
+  size_t victim;
+
+  while (before - this->ramBytes < wanted) {
+    if ((victim = this->farthestCheckpoint(keep)) == this->entries.size()) {
+      if (keep == this->entries.size())
+        break;
+      victim = keep;
+      keep = this->entries.size();
+      if (this->entries[victim].checkpoint.empty())
+        continue;
+    }
+
+    this->dropCheckpoint(victim);
+  }
+
+  return static_cast<size_t>(before - this->ramBytes);
+}
+
+void
+TransformHistory::setCapacity(quint64 ram)
+{
+  this->ramCapacity = ram;
+  this->makeRoom(0, this->entries.size());
+}
+
+void
+TransformHistory::clear(void)
+{
+  this->entries.clear();
+  this->cursor = 0;
+  this->ramBytes = 0;
+  this->account.set(0);
+}
+
+void
+TransformHistory::push(
+    TransformRecord const &record,
+    std::vector<SUCOMPLEX> const &result)
+{
+  while (this->entries.size() > this->cursor) {
+    this->dropCheckpoint(this->entries.size() - 1);
+    this->entries.pop_back();
+  }
+
+  this->entries.push_back(Entry());
+  this->entries.back().record = record;
+  this->cursor = this->entries.size();
+
+  this->checkpoint(this->cursor, result);
+}
+
+void
+TransformHistory::checkpoint(size_t pos, std::vector<SUCOMPLEX> const &state)
+{
+  if (pos == 0 || pos > this->entries.size())
+    return;
+
+  Entry &entry = this->entries[pos - 1];
+
+  if (!entry.checkpoint.empty())
+    return;
+
+  if (!this->makeRoom(bytes(state), pos - 1))
+    return;
+
+  try {
+    entry.checkpoint = state;
+    this->ramBytes += bytes(state);
+    this->account.set(this->ramBytes);
+  } catch (std::bad_alloc &) {
+    // Checkpoints are an optimization. Replaying still works.
+    std::vector<SUCOMPLEX>().swap(entry.checkpoint);
+  }
+}
+
+const std::vector<SUCOMPLEX> *
+TransformHistory::nearest(size_t pos, size_t &base) const
+{
+  if (pos > this->entries.size())
+    pos = this->entries.size();
+
+  for (base = pos; base > 0; --base)
+    if (!this->entries[base - 1].checkpoint.empty())
+      return &this->entries[base - 1].checkpoint;
+
+  return nullptr;
+}
+
+std::vector<TransformRecord>
+TransformHistory::records(size_t from, size_t to) const
+{
+  std::vector<TransformRecord> result;
+
+  if (to > this->entries.size())
+    to = this->entries.size();
+
+  for (size_t i = from; i < to; ++i)
+    result.push_back(this->entries[i].record);
+
+  return result;
+}
+
+void
+TransformHistory::seek(size_t pos)
+{
+  if (pos > this->entries.size())
+    pos = this->entries.size();
+
+  this->cursor = pos;
+}
+
+size_t
+TransformHistory::position(void) const
+{
+  return this->cursor;
+}
+
+size_t
+TransformHistory::count(void) const
+{
+  return this->entries.size();
+}
+
+bool
+TransformHistory::canUndo(void) const
+{
+  return this->cursor > 0;
+}
+
+bool
+TransformHistory::canRedo(void) const
+{
+  return this->cursor < this->entries.size();
+}
+
+QString
+TransformHistory::describe(size_t pos) const
+{
+  if (pos == 0 || pos > this->entries.size())
+    return "Original capture";
+
+  return this->entries[pos - 1].record.describe();
+}
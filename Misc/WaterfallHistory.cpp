@@ -0,0 +1,331 @@
+//
+//    WaterfallHistory.cpp: PSD history with disk spill
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "WaterfallHistory.h"
+#include "PSDPyramid.h"
+#include <QTemporaryFile>
+#include <QDir>
+#include <QStorageInfo>
+#include <QMutexLocker>
+#include <cstring>
+#include <Suscan/Library.h>
+
+using namespace SigDigger;
+
+WaterfallHistory::WaterfallHistory() : account("Waterfall history")
+{
+  this->account.setReclaimer(
+        [this] (size_t wanted) {
+          return this->reclaim(wanted);
+        });
+}
+
+WaterfallHistory::~WaterfallHistory()
+{
+  this->closeSpillFile();
+}
+
+bool
+WaterfallHistory::ensureSpillFile(void)
+{
+  qint64 free;
+
+  if (this->spillMap != nullptr)
+    return true;
+
+  if (this->spillFailed || this->spillLimit == 0)
+    return false;
+
+  free = QStorageInfo(QDir::tempPath()).bytesAvailable();
+  this->spillCapacity = this->spillLimit;
+  if (free >= 0 && this->spillCapacity > static_cast<quint64>(free) / 2)
+    this->spillCapacity = static_cast<quint64>(free) / 2;
+
+  if (this->spillCapacity < SIGDIGGER_WATERFALL_HISTORY_MIN_DISK) {
+    SU_WARNING(
+          "Not enough space in %s for the waterfall history\n",
+          QDir::tempPath().toStdString().c_str());
+    this->spillFailed = true;
+    return false;
+  }
+
+  this->spillFile = new QTemporaryFile(
+        QDir::tempPath() + "/sigdigger-waterfall-XXXXXX.bin");
+
+  // The file is sparse: disk space is only used as frames get spilled
+  if (this->spillFile->open()
+      && this->spillFile->resize(static_cast<qint64>(this->spillCapacity)))
+    this->spillMap = this->spillFile->map(
+          0,
+          static_cast<qint64>(this->spillCapacity));
+
+  if (this->spillMap == nullptr) {
+    SU_WARNING(
+          "Cannot map waterfall history file: %s\n",
+          this->spillFile->errorString().toStdString().c_str());
+    this->closeSpillFile();
+    this->spillFailed = true;
+    return false;
+  }
+
+  return true;
+}
+
+void
+WaterfallHistory::closeSpillFile(void)
+{
+  if (this->spillFile != nullptr) {
+    if (this->spillMap != nullptr)
+      this->spillFile->unmap(this->spillMap);
+    delete this->spillFile;
+  }
+
+  this->spillFile   = nullptr;
+  this->spillMap    = nullptr;
+  this->spillOffset = 0;
+  this->firstSerial += this->spilled.size();
+  this->spilled.clear();
+}
+
+void
+WaterfallHistory::spill(Frame const &frame)
+{
+  SpilledFrame entry;
+  quint64 bytes = frame.data.size() * sizeof(float);
+
+  // Frames that cannot be spilled are lost
+  if (!this->ensureSpillFile() || bytes > this->spillCapacity) {
+    ++this->firstSerial;
+    return;
+  }
+
+  // Wrap around. Everything past the current offset belongs to the
+  // previous lap and is the oldest data we have.
+  if (this->spillOffset + bytes > this->spillCapacity) {
+    while (!this->spilled.empty()
+           && this->spilled.front().offset >= this->spillOffset) {
+      this->spilled.pop_front();
+      ++this->firstSerial;
+    }
+    this->spillOffset = 0;
+  }
+
+  while (!this->spilled.empty()
+         && this->spilled.front().offset < this->spillOffset + bytes
+         && this->spilled.front().offset
+            + this->spilled.front().size * sizeof(float) > this->spillOffset) {
+    this->spilled.pop_front();
+    ++this->firstSerial;
+  }
+
+  memcpy(this->spillMap + this->spillOffset, frame.data.data(), bytes);
+
+  entry.tv     = frame.tv;
+  entry.offset = this->spillOffset;
+  entry.size   = static_cast<unsigned int>(frame.data.size());
+
+  this->spilled.push_back(entry);
+  this->spillOffset += bytes;
+}
+
+void
+WaterfallHistory::setCapacity(quint64 ram, quint64 disk)
+{
+  QMutexLocker locker(&this->mutex);
+
+  if (disk != this->spillLimit) {
+    this->closeSpillFile();
+    this->spillLimit  = disk;
+    this->spillFailed = false;
+  }
+
+  this->ramCapacity = ram;
+}
+
+void
+WaterfallHistory::push(
+    const float *data,
+    unsigned int size,
+    struct timeval const &tv)
+{
+  QMutexLocker locker(&this->mutex);
+  Frame frame;
+
+  // Reuse the storage of the last evicted frame
+  frame.data.swap(this->spare);
+  frame.data.assign(data, data + size);
+  frame.tv = tv;
+
+  this->ramBytes += size * sizeof(float);
+  this->frames.push_back(std::move(frame));
+
+  while (this->ramBytes > this->ramCapacity && this->frames.size() > 1)
+    this->evictOldest();
+
+  this->account.set(this->ramBytes);
+}
+
+quint64
+WaterfallHistory::evictOldest(void)
+{
+  Frame &oldest = this->frames.front();
+  quint64 bytes = oldest.data.size() * sizeof(float);
+
+  this->spill(oldest);
+  this->ramBytes -= bytes;
+  this->spare.swap(oldest.data);
+  this->frames.pop_front();
+
+  return bytes;
+}
+
+size_t
+WaterfallHistory::reclaim(size_t wanted)
+{
+  QMutexLocker locker(&this->mutex);
+  quint64 freed = 0;
+
+  // The newest frame always stays in RAM
+  while (freed < wanted && this->frames.size() > 1)
+    freed += this->evictOldest();
+
+  std::vector<float>().swap(this->spare);
+
+  this->account.set(this->ramBytes);
+
+  return static_cast<size_t>(freed);
+}
+
+void
+WaterfallHistory::clear(void)
+{
+  QMutexLocker locker(&this->mutex);
+
+  this->firstSerial += this->count();
+  this->frames.clear();
+  this->spilled.clear();
+  this->ramBytes    = 0;
+  this->spillOffset = 0;
+
+  this->account.set(0);
+}
+
+size_t
+WaterfallHistory::count(void) const
+{
+  return this->spilled.size() + this->frames.size();
+}
+
+const float *
+WaterfallHistory::frame(
+    size_t index,
+    unsigned int &size,
+    struct timeval &tv) const
+{
+  if (index < this->spilled.size()) {
+    SpilledFrame const &entry = this->spilled[index];
+    size = entry.size;
+    tv   = entry.tv;
+    return reinterpret_cast<const float *>(this->spillMap + entry.offset);
+  }
+
+  index -= this->spilled.size();
+
+  if (index < this->frames.size()) {
+    Frame const &entry = this->frames[index];
+    size = static_cast<unsigned int>(entry.data.size());
+    tv   = entry.tv;
+    return entry.data.data();
+  }
+
+  size = 0;
+  return nullptr;
+}
+
+bool
+WaterfallHistory::find(struct timeval const &tv, size_t &index) const
+{
+  qint64 target = static_cast<qint64>(tv.tv_sec) * 1000000 + tv.tv_usec;
+  qint64 first = 0, last = 0;
+  qint64 best = -1;
+  size_t total = this->count();
+  size_t i;
+
+  // Frames are not necessarily in time order (the user may have seeked
+  // back and forth), so all of them are checked.
+  for (i = 0; i < total; ++i) {
+    struct timeval const &frameTv = i < this->spilled.size()
+        ? this->spilled[i].tv
+        : this->frames[i - this->spilled.size()].tv;
+    qint64 t = static_cast<qint64>(frameTv.tv_sec) * 1000000
+        + frameTv.tv_usec;
+    qint64 delta = t > target ? t - target : target - t;
+
+    if (i == 0 || t < first)
+      first = t;
+    if (i == 0 || t > last)
+      last = t;
+
+    if (best < 0 || delta < best) {
+      best  = delta;
+      index = i;
+    }
+  }
+
+  return total > 0 && first <= target && target <= last;
+}
+
+void
+WaterfallHistory::serials(quint64 &first, quint64 &end) const
+{
+  QMutexLocker locker(&this->mutex);
+
+  first = this->firstSerial;
+  end   = this->firstSerial + this->count();
+}
+
+bool
+WaterfallHistory::copyFrame(
+    quint64 serial,
+    float *out,
+    unsigned int size,
+    struct timeval &tv) const
+{
+  QMutexLocker locker(&this->mutex);
+  unsigned int frameSize;
+  const float *data;
+
+  if (serial < this->firstSerial)
+    return false;
+
+  data = this->frame(
+        static_cast<size_t>(serial - this->firstSerial),
+        frameSize,
+        tv);
+
+  if (data == nullptr)
+    return false;
+
+  if (frameSize == size)
+    memcpy(out, data, size * sizeof(float));
+  else
+    PSDPyramid::resample(data, frameSize, out, size);
+
+  return true;
+}
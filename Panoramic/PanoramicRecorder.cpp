@@ -0,0 +1,457 @@
+//
+//    Panoramic/PanoramicRecorder.cpp: Compact recording of panoramic spectrum frames
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "PanoramicRecorder.h"
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace SigDigger;
+
+#define SIGDIGGER_PANORAMIC_RECORDER_HEADER_SIZE 12
+#define SIGDIGGER_PANORAMIC_RECORDER_FRAME_HEADER_SIZE 37
+#define SIGDIGGER_PANORAMIC_RECORDER_INDEX_ENTRY_SIZE 20
+
+////////////////////////////// Encoding helpers ////////////////////////////
+static inline void
+putU32(std::vector<quint8> &buf, quint32 val)
+{
+  quint8 bytes[4];
+  qToLittleEndian(val, bytes);
+  buf.insert(buf.end(), bytes, bytes + 4);
+}
+
+static inline void
+putI64(std::vector<quint8> &buf, qint64 val)
+{
+  quint8 bytes[8];
+  qToLittleEndian(val, bytes);
+  buf.insert(buf.end(), bytes, bytes + 8);
+}
+
+static inline void
+putVarint(std::vector<quint8> &buf, qint32 val)
+{
+  quint32 z = (static_cast<quint32>(val) << 1) ^ static_cast<quint32>(val >> 31);
+
+  while (z >= 0x80) {
+    buf.push_back(static_cast<quint8>(z | 0x80));
+    z >>= 7;
+  }
+
+  buf.push_back(static_cast<quint8>(z));
+}
+
+static inline bool
+getVarint(const quint8 *&p, const quint8 *end, qint32 &val)
+{
+  quint32 z = 0;
+  unsigned int shift = 0;
+
+  while (p < end && shift < 35) {
+    quint8 byte = *p++;
+    z |= static_cast<quint32>(byte & 0x7f) << shift;
+
+    if (!(byte & 0x80)) {
+      val = static_cast<qint32>(z >> 1) ^ -static_cast<qint32>(z & 1);
+      return true;
+    }
+
+    shift += 7;
+  }
+
+  return false;
+}
+
+static inline qint32
+quantize(float dB)
+{
+  float q;
+
+  if (std::isnan(dB))
+    return std::numeric_limits<qint16>::min();
+
+  q = std::round(dB * SIGDIGGER_PANORAMIC_RECORDER_DB_SCALE);
+
+  if (q < std::numeric_limits<qint16>::min())
+    return std::numeric_limits<qint16>::min();
+
+  if (q > std::numeric_limits<qint16>::max())
+    return std::numeric_limits<qint16>::max();
+
+  return static_cast<qint32>(q);
+}
+
+/////////////////////////////// PanoramicRecorder //////////////////////////
+PanoramicRecorder::~PanoramicRecorder()
+{
+  this->close();
+}
+
+bool
+PanoramicRecorder::open(QString const &path)
+{
+  std::vector<quint8> header(
+        SIGDIGGER_PANORAMIC_RECORDER_MAGIC,
+        SIGDIGGER_PANORAMIC_RECORDER_MAGIC + 8);
+
+  this->close();
+
+  this->data.setFileName(path);
+  this->index.setFileName(path + SIGDIGGER_PANORAMIC_RECORDER_INDEX_EXT);
+
+  if (!this->data.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return false;
+
+  if (!this->index.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    this->data.close();
+    return false;
+  }
+
+  putU32(header, SIGDIGGER_PANORAMIC_RECORDER_VERSION);
+
+  if (this->data.write(
+        reinterpret_cast<const char *>(header.data()),
+        static_cast<qint64>(header.size()))
+      != static_cast<qint64>(header.size())) {
+    this->close();
+    return false;
+  }
+
+  this->frames   = 0;
+  this->sinceKey = 0;
+  this->prev.clear();
+
+  return true;
+}
+
+void
+PanoramicRecorder::close(void)
+{
+  if (this->data.isOpen())
+    this->data.close();
+
+  if (this->index.isOpen())
+    this->index.close();
+}
+
+bool
+PanoramicRecorder::isOpen(void) const
+{
+  return this->data.isOpen();
+}
+
+quint64
+PanoramicRecorder::getFrameCount(void) const
+{
+  return this->frames;
+}
+
+qint64
+PanoramicRecorder::getBytesWritten(void) const
+{
+  return this->data.isOpen() ? this->data.pos() + this->index.pos() : 0;
+}
+
+bool
+PanoramicRecorder::write(
+    struct timeval const &tv,
+    qint64 freqMin,
+    qint64 freqMax,
+    const float *psd,
+    size_t size)
+{
+  std::vector<quint8> entry;
+  quint64 offset;
+  qint64 usec;
+  qint32 last = 0, q;
+  bool key;
+
+  if (!this->isOpen())
+    return false;
+
+  key = this->frames == 0
+      || size != this->prev.size()
+      || freqMin != this->prevMin
+      || freqMax != this->prevMax
+      || this->sinceKey >= SIGDIGGER_PANORAMIC_RECORDER_KEY_INTERVAL;
+
+  usec = static_cast<qint64>(tv.tv_sec) * 1000000 + tv.tv_usec;
+
+  this->buffer.clear();
+  putU32(this->buffer, SIGDIGGER_PANORAMIC_RECORDER_FRAME_MAGIC);
+  putU32(this->buffer, 0); // Payload length, filled below
+  putU32(this->buffer, static_cast<quint32>(size));
+  this->buffer.push_back(key ? 1 : 0);
+  putI64(this->buffer, usec);
+  putI64(this->buffer, freqMin);
+  putI64(this->buffer, freqMax);
+
+  this->prev.resize(size);
+
+  for (size_t i = 0; i < size; ++i) {
+    q = quantize(psd[i]);
+    putVarint(this->buffer, q - (key ? last : this->prev[i]));
+    this->prev[i] = last = q;
+  }
+
+  qToLittleEndian(
+        static_cast<quint32>(
+          this->buffer.size() - SIGDIGGER_PANORAMIC_RECORDER_FRAME_HEADER_SIZE),
+        this->buffer.data() + 4);
+
+  offset = static_cast<quint64>(this->data.pos());
+
+  if (this->data.write(
+        reinterpret_cast<const char *>(this->buffer.data()),
+        static_cast<qint64>(this->buffer.size()))
+      != static_cast<qint64>(this->buffer.size()))
+    return false;
+
+  putI64(entry, static_cast<qint64>(offset));
+  putI64(entry, usec);
+  putU32(entry, key ? 1 : 0);
+
+  this->index.write(
+        reinterpret_cast<const char *>(entry.data()),
+        static_cast<qint64>(entry.size()));
+
+  // Keep the file usable if the application dies mid-survey
+  this->data.flush();
+  this->index.flush();
+
+  this->prevMin  = freqMin;
+  this->prevMax  = freqMax;
+  this->sinceKey = key ? 1 : this->sinceKey + 1;
+  ++this->frames;
+
+  return true;
+}
+
+/////////////////////////////// PanoramicReader ////////////////////////////
+PanoramicReader::~PanoramicReader()
+{
+  this->close();
+}
+
+bool
+PanoramicReader::open(QString const &path)
+{
+  char header[SIGDIGGER_PANORAMIC_RECORDER_HEADER_SIZE];
+
+  this->close();
+
+  this->data.setFileName(path);
+
+  if (!this->data.open(QIODevice::ReadOnly))
+    return false;
+
+  if (this->data.read(header, sizeof(header)) != sizeof(header)
+      || std::memcmp(header, SIGDIGGER_PANORAMIC_RECORDER_MAGIC, 8) != 0
+      || qFromLittleEndian<quint32>(header + 8)
+         != SIGDIGGER_PANORAMIC_RECORDER_VERSION) {
+    this->close();
+    return false;
+  }
+
+  this->loadIndex(path + SIGDIGGER_PANORAMIC_RECORDER_INDEX_EXT);
+
+  if (!this->rebuildIndex()) {
+    this->close();
+    return false;
+  }
+
+  return true;
+}
+
+void
+PanoramicReader::close(void)
+{
+  if (this->data.isOpen())
+    this->data.close();
+
+  this->entries.clear();
+  this->curr.clear();
+  this->decoded = -1;
+}
+
+bool
+PanoramicReader::isOpen(void) const
+{
+  return this->data.isOpen();
+}
+
+size_t
+PanoramicReader::getFrameCount(void) const
+{
+  return this->entries.size();
+}
+
+bool
+PanoramicReader::loadIndex(QString const &path)
+{
+  QFile index(path);
+  quint8 entry[SIGDIGGER_PANORAMIC_RECORDER_INDEX_ENTRY_SIZE];
+  qint64 size = this->data.size();
+
+  if (!index.open(QIODevice::ReadOnly))
+    return false;
+
+  while (index.read(reinterpret_cast<char *>(entry), sizeof(entry))
+         == sizeof(entry)) {
+    PanoramicIndexEntry e;
+
+    e.offset    = qFromLittleEndian<quint64>(entry);
+    e.timeStamp = qFromLittleEndian<qint64>(entry + 8);
+    e.flags     = qFromLittleEndian<quint32>(entry + 16);
+
+    if (static_cast<qint64>(e.offset) >= size)
+      break;
+
+    this->entries.push_back(e);
+  }
+
+  return true;
+}
+
+//
+// Completes the index with the frames found after the last indexed one.
+// The last indexed frame is checked again, as the index may have been
+// written before the data of its frame.
+//
+bool
+PanoramicReader::rebuildIndex(void)
+{
+  quint8 hdr[SIGDIGGER_PANORAMIC_RECORDER_FRAME_HEADER_SIZE];
+  qint64 size = this->data.size();
+  qint64 offset = SIGDIGGER_PANORAMIC_RECORDER_HEADER_SIZE;
+
+  if (!this->entries.empty()) {
+    offset = static_cast<qint64>(this->entries.back().offset);
+    this->entries.pop_back();
+  }
+
+  while (offset + SIGDIGGER_PANORAMIC_RECORDER_FRAME_HEADER_SIZE <= size) {
+    PanoramicIndexEntry e;
+    quint32 length;
+
+    if (!this->data.seek(offset)
+        || this->data.read(reinterpret_cast<char *>(hdr), sizeof(hdr))
+           != sizeof(hdr))
+      return false;
+
+    if (qFromLittleEndian<quint32>(hdr)
+        != SIGDIGGER_PANORAMIC_RECORDER_FRAME_MAGIC)
+      break;
+
+    length = qFromLittleEndian<quint32>(hdr + 4);
+
+    // Truncated frame, most likely the last one of an interrupted survey
+    if (offset + SIGDIGGER_PANORAMIC_RECORDER_FRAME_HEADER_SIZE + length > size)
+      break;
+
+    e.offset    = static_cast<quint64>(offset);
+    e.flags     = hdr[12];
+    e.timeStamp = qFromLittleEndian<qint64>(hdr + 13);
+    this->entries.push_back(e);
+
+    offset += SIGDIGGER_PANORAMIC_RECORDER_FRAME_HEADER_SIZE + length;
+  }
+
+  return true;
+}
+
+bool
+PanoramicReader::decodeNext(size_t frame, PanoramicFrame &out)
+{
+  quint8 hdr[SIGDIGGER_PANORAMIC_RECORDER_FRAME_HEADER_SIZE];
+  const quint8 *p, *end;
+  quint32 length, bins;
+  qint64 usec;
+  qint32 delta, last = 0;
+  bool key;
+
+  this->decoded = -1;
+
+  if (!this->data.seek(static_cast<qint64>(this->entries[frame].offset))
+      || this->data.read(reinterpret_cast<char *>(hdr), sizeof(hdr))
+         != sizeof(hdr))
+    return false;
+
+  length = qFromLittleEndian<quint32>(hdr + 4);
+  bins   = qFromLittleEndian<quint32>(hdr + 8);
+  key    = hdr[12] & 1;
+  usec   = qFromLittleEndian<qint64>(hdr + 13);
+
+  if (!key && this->curr.size() != bins)
+    return false;
+
+  this->buffer.resize(length);
+  if (this->data.read(reinterpret_cast<char *>(this->buffer.data()), length)
+      != static_cast<qint64>(length))
+    return false;
+
+  this->curr.resize(bins);
+  p   = this->buffer.data();
+  end = p + length;
+
+  for (quint32 i = 0; i < bins; ++i) {
+    if (!getVarint(p, end, delta))
+      return false;
+
+    this->curr[i] = last = (key ? last : this->curr[i]) + delta;
+  }
+
+  out.timeStamp.tv_sec  = static_cast<time_t>(usec / 1000000);
+  out.timeStamp.tv_usec = static_cast<suseconds_t>(usec % 1000000);
+  out.freqMin = qFromLittleEndian<qint64>(hdr + 21);
+  out.freqMax = qFromLittleEndian<qint64>(hdr + 29);
+
+  this->decoded = static_cast<qint64>(frame);
+
+  return true;
+}
+
+bool
+PanoramicReader::read(size_t frame, PanoramicFrame &out)
+{
+  size_t start = frame;
+
+  if (frame >= this->entries.size())
+    return false;
+
+  // Find the closest key frame, unless we are already past it
+  while (start > 0 && !(this->entries[start].flags & 1))
+    --start;
+
+  if (this->decoded >= static_cast<qint64>(start)
+      && this->decoded < static_cast<qint64>(frame))
+    start = static_cast<size_t>(this->decoded + 1);
+
+  for (size_t i = start; i <= frame; ++i)
+    if (!this->decodeNext(i, out))
+      return false;
+
+  out.psd.resize(this->curr.size());
+  for (size_t i = 0; i < this->curr.size(); ++i)
+    out.psd[i] = this->curr[i] / SIGDIGGER_PANORAMIC_RECORDER_DB_SCALE;
+
+  return true;
+}
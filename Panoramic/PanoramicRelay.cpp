@@ -0,0 +1,336 @@
+//
+//    PanoramicRelay.cpp: Exchange of panoramic sweep fragments between nodes
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "PanoramicRelay.h"
+#include <QHostAddress>
+#include <QtEndian>
+#include <cstring>
+
+using namespace SigDigger;
+
+static inline void
+putFloat(char *dest, float value)
+{
+  quint32 bits;
+
+  memcpy(&bits, &value, sizeof(float));
+  qToLittleEndian<quint32>(bits, dest);
+}
+
+static inline float
+getFloat(const char *src)
+{
+  quint32 bits = qFromLittleEndian<quint32>(src);
+  float value;
+
+  memcpy(&value, &bits, sizeof(float));
+
+  return value;
+}
+
+static inline void
+putDouble(char *dest, double value)
+{
+  quint64 bits;
+
+  memcpy(&bits, &value, sizeof(double));
+  qToLittleEndian<quint64>(bits, dest);
+}
+
+static inline double
+getDouble(const char *src)
+{
+  quint64 bits = qFromLittleEndian<quint64>(src);
+  double value;
+
+  memcpy(&value, &bits, sizeof(double));
+
+  return value;
+}
+
+///////////////////////////// PanoramicRelaySender ////////////////////////////
+PanoramicRelaySender::PanoramicRelaySender(
+    QString const &host,
+    quint16 port,
+    QObject *parent) : QObject(parent), host(host), port(port)
+{
+  this->reconnectTimer.setSingleShot(true);
+  this->reconnectTimer.setInterval(SIGDIGGER_PANORAMIC_RELAY_RECONNECT_MS);
+
+  connect(
+        &this->socket,
+        SIGNAL(disconnected()),
+        this,
+        SLOT(onDisconnected()));
+
+  connect(
+        &this->socket,
+        SIGNAL(error(QAbstractSocket::SocketError)),
+        this,
+        SLOT(onError(QAbstractSocket::SocketError)));
+
+  connect(
+        &this->reconnectTimer,
+        SIGNAL(timeout()),
+        this,
+        SLOT(onReconnect()));
+
+  this->onReconnect();
+}
+
+void
+PanoramicRelaySender::send(SpectrumView const &fragment)
+{
+  unsigned int first = 0, last = fragment.size;
+  unsigned int count;
+  char *p;
+
+  if (this->socket.state() != QAbstractSocket::ConnectedState
+      || this->socket.bytesToWrite() > SIGDIGGER_PANORAMIC_RELAY_MAX_BACKLOG) {
+    ++this->dropped;
+    return;
+  }
+
+  // Bins outside the useful part of the hop carry nothing
+  while (first < last && fragment.bins[first].count <= 0)
+    ++first;
+
+  while (last > first && fragment.bins[last - 1].count <= 0)
+    --last;
+
+  if (first == last)
+    return;
+
+  count = last - first;
+  this->packet.resize(
+        SIGDIGGER_PANORAMIC_RELAY_HEADER_SIZE
+        + static_cast<int>(count * 2 * sizeof(float)));
+  p = this->packet.data();
+
+  qToLittleEndian<quint32>(SIGDIGGER_PANORAMIC_RELAY_MAGIC, p);
+  qToLittleEndian<quint32>(fragment.size, p + 4);
+  qToLittleEndian<quint32>(first, p + 8);
+  qToLittleEndian<quint32>(count, p + 12);
+  putDouble(p + 16, fragment.freqMin);
+  putDouble(p + 24, fragment.freqMax);
+  p += SIGDIGGER_PANORAMIC_RELAY_HEADER_SIZE;
+
+  for (unsigned int i = first; i < last; ++i, p += 2 * sizeof(float)) {
+    putFloat(p, fragment.bins[i].accum);
+    putFloat(p + sizeof(float), fragment.bins[i].count);
+  }
+
+  this->socket.write(this->packet);
+  ++this->sent;
+}
+
+quint64
+PanoramicRelaySender::getSentCount(void) const
+{
+  return this->sent;
+}
+
+quint64
+PanoramicRelaySender::getDroppedCount(void) const
+{
+  return this->dropped;
+}
+
+void
+PanoramicRelaySender::onDisconnected(void)
+{
+  if (!this->reconnectTimer.isActive())
+    this->reconnectTimer.start();
+}
+
+void
+PanoramicRelaySender::onError(QAbstractSocket::SocketError)
+{
+  this->socket.abort();
+
+  if (!this->reconnectTimer.isActive())
+    this->reconnectTimer.start();
+}
+
+void
+PanoramicRelaySender::onReconnect(void)
+{
+  if (this->socket.state() == QAbstractSocket::UnconnectedState)
+    this->socket.connectToHost(this->host, this->port);
+}
+
+//////////////////////////// PanoramicRelayReceiver ////////////////////////////
+PanoramicRelayReceiver::PanoramicRelayReceiver(
+    unsigned int size,
+    QObject *parent) : QObject(parent), fragment(size)
+{
+  connect(
+        &this->server,
+        SIGNAL(newConnection()),
+        this,
+        SLOT(onNewConnection()));
+}
+
+PanoramicRelayReceiver::~PanoramicRelayReceiver()
+{
+  for (auto p = this->peers.begin(); p != this->peers.end(); ++p) {
+    p.key()->disconnect(this);
+    p.key()->abort();
+  }
+}
+
+bool
+PanoramicRelayReceiver::listen(quint16 port)
+{
+  return this->server.listen(QHostAddress::Any, port);
+}
+
+QString
+PanoramicRelayReceiver::errorString(void) const
+{
+  return this->server.errorString();
+}
+
+unsigned int
+PanoramicRelayReceiver::getPeerCount(void) const
+{
+  return static_cast<unsigned int>(this->peers.size());
+}
+
+quint64
+PanoramicRelayReceiver::getReceivedCount(void) const
+{
+  return this->received;
+}
+
+quint64
+PanoramicRelayReceiver::getRejectedCount(void) const
+{
+  return this->rejected;
+}
+
+// Returns false if the peer is not speaking our protocol
+bool
+PanoramicRelayReceiver::parse(QByteArray &pending)
+{
+  const char *p = pending.constData();
+  const char *end = p + pending.size();
+  quint32 size, first, count;
+  size_t length;
+
+  while (end - p >= SIGDIGGER_PANORAMIC_RELAY_HEADER_SIZE) {
+    if (qFromLittleEndian<quint32>(p) != SIGDIGGER_PANORAMIC_RELAY_MAGIC)
+      return false;
+
+    size  = qFromLittleEndian<quint32>(p + 4);
+    first = qFromLittleEndian<quint32>(p + 8);
+    count = qFromLittleEndian<quint32>(p + 12);
+
+    if (size > SIGDIGGER_SCANNER_MAX_SPECTRUM_SIZE
+        || first > size
+        || count > size - first)
+      return false;
+
+    length = SIGDIGGER_PANORAMIC_RELAY_HEADER_SIZE + count * 2 * sizeof(float);
+    if (static_cast<size_t>(end - p) < length)
+      break;
+
+    // Fragments of a different resolution cannot be merged
+    if (size == this->fragment.size) {
+      const char *bins = p + SIGDIGGER_PANORAMIC_RELAY_HEADER_SIZE;
+      SpectrumBin zero = {0, 0};
+
+      this->fragment.freqMin   = getDouble(p + 16);
+      this->fragment.freqMax   = getDouble(p + 24);
+      this->fragment.freqRange =
+          this->fragment.freqMax - this->fragment.freqMin;
+
+      std::fill(this->fragment.bins.begin(), this->fragment.bins.end(), zero);
+
+      for (quint32 i = 0; i < count; ++i, bins += 2 * sizeof(float)) {
+        this->fragment.bins[first + i].accum = getFloat(bins);
+        this->fragment.bins[first + i].count = getFloat(bins + sizeof(float));
+      }
+
+      ++this->received;
+
+      if (this->fragment.freqRange > 0)
+        emit fragmentReceived(this->fragment);
+    } else {
+      ++this->rejected;
+    }
+
+    p += length;
+  }
+
+  pending.remove(0, static_cast<int>(p - pending.constData()));
+
+  return true;
+}
+
+void
+PanoramicRelayReceiver::onNewConnection(void)
+{
+  QTcpSocket *socket;
+
+  while ((socket = this->server.nextPendingConnection()) != nullptr) {
+    this->peers.insert(socket, QByteArray());
+
+    connect(
+          socket,
+          SIGNAL(readyRead()),
+          this,
+          SLOT(onReadyRead()));
+
+    connect(
+          socket,
+          SIGNAL(disconnected()),
+          this,
+          SLOT(onDisconnected()));
+  }
+}
+
+void
+PanoramicRelayReceiver::onReadyRead(void)
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket *>(this->sender());
+  auto it = this->peers.find(socket);
+
+  if (it == this->peers.end())
+    return;
+
+  it.value().append(socket->readAll());
+
+  if (!this->parse(it.value())) {
+    this->peers.erase(it);
+    socket->disconnect(this);
+    socket->abort();
+    socket->deleteLater();
+  }
+}
+
+void
+PanoramicRelayReceiver::onDisconnected(void)
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket *>(this->sender());
+
+  if (this->peers.remove(socket) > 0) {
+    socket->disconnect(this);
+    socket->deleteLater();
+  }
+}
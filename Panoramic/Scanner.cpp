@@ -18,13 +18,85 @@
 //
 
 #include "Scanner.h"
+#include "PanoramicRelay.h"
 #include <cmath>
 #include <cassert>
+#include <algorithm>
+#include <sys/time.h>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#  include <immintrin.h>
+#elif defined(__ARM_NEON)
+#  include <arm_neon.h>
+#endif
+
+static_assert(
+      sizeof(SigDigger::SpectrumBin) == 2 * sizeof(SUFLOAT),
+      "SpectrumBin must be tightly packed");
 
 using namespace SigDigger;
 
-SpectrumView::SpectrumView()
+SpectrumView::SpectrumView(unsigned int size)
+{
+  this->setSize(size);
+}
+
+// Sum of n samples, taken every stride floats
+static inline SUFLOAT
+scannerSum(const SUFLOAT *x, int n, unsigned int stride)
+{
+  SUFLOAT sum = 0;
+  int i = 0;
+
+#if defined(__SSE__) || defined(__x86_64__)
+  if (stride == 1 && n >= 8) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    float tmp[4];
+
+    for (; i + 8 <= n; i += 8) {
+      acc0 = _mm_add_ps(acc0, _mm_loadu_ps(x + i));
+      acc1 = _mm_add_ps(acc1, _mm_loadu_ps(x + i + 4));
+    }
+
+    _mm_storeu_ps(tmp, _mm_add_ps(acc0, acc1));
+    sum = tmp[0] + tmp[1] + tmp[2] + tmp[3];
+  }
+#elif defined(__ARM_NEON)
+  if (stride == 1 && n >= 8) {
+    float32x4_t acc0 = vdupq_n_f32(0);
+    float32x4_t acc1 = vdupq_n_f32(0);
+
+    for (; i + 8 <= n; i += 8) {
+      acc0 = vaddq_f32(acc0, vld1q_f32(x + i));
+      acc1 = vaddq_f32(acc1, vld1q_f32(x + i + 4));
+    }
+
+    acc0 = vaddq_f32(acc0, acc1);
+    sum = vgetq_lane_f32(acc0, 0) + vgetq_lane_f32(acc0, 1)
+        + vgetq_lane_f32(acc0, 2) + vgetq_lane_f32(acc0, 3);
+  }
+#endif
+
+  for (; i < n; ++i)
+    sum += x[i * stride];
+
+  return sum;
+}
+
+void
+SpectrumView::setSize(unsigned int size)
 {
+  if (size < SIGDIGGER_SCANNER_MIN_SPECTRUM_SIZE)
+    size = SIGDIGGER_SCANNER_MIN_SPECTRUM_SIZE;
+  else if (size > SIGDIGGER_SCANNER_MAX_SPECTRUM_SIZE)
+    size = SIGDIGGER_SCANNER_MAX_SPECTRUM_SIZE;
+
+  this->size = size;
+  this->psd.resize(size);
+  this->bins.resize(size);
+  this->scaled.resize(size);
+
   this->reset();
 }
 
@@ -38,10 +110,45 @@ SpectrumView::setRange(SUFREQ freqMin, SUFREQ freqMax)
   this->reset();
 }
 
+void
+SpectrumView::markDirty(unsigned int start, unsigned int end)
+{
+  if (end > this->size)
+    end = this->size;
+
+  if (start >= end)
+    return;
+
+  if (this->dirtyStart >= this->dirtyEnd) {
+    this->dirtyStart = start;
+    this->dirtyEnd   = end;
+  } else {
+    this->dirtyStart = std::min(this->dirtyStart, start);
+    this->dirtyEnd   = std::max(this->dirtyEnd, end);
+  }
+}
+
+bool
+SpectrumView::takeDirty(unsigned int &start, unsigned int &end)
+{
+  if (this->dirtyStart >= this->dirtyEnd)
+    return false;
+
+  start = this->dirtyStart;
+  end   = this->dirtyEnd;
+
+  this->dirtyStart = this->dirtyEnd = 0;
+
+  return true;
+}
+
+// Only the bins fed since the last call change in the first pass. Gaps
+// are filled from their neighbours, so they are compared as they are
+// written and marked dirty if they change.
 void
 SpectrumView::interpolate(void)
 {
-  unsigned int i, j;
+  unsigned int i = 0, j;
   unsigned int count = 1;
   unsigned int zero_pos = 0;
   SUFLOAT t = 0;
@@ -49,15 +156,56 @@ SpectrumView::interpolate(void)
   SUFLOAT left = SIGDIGGER_SCANNER_DEFAULT_BIN_VALUE;
   SUFLOAT right = SIGDIGGER_SCANNER_DEFAULT_BIN_VALUE;
   bool inGap = false;
+  SpectrumBin *bins = this->bins.data();
+  SUFLOAT *psd = this->psd.data();
+  SUFLOAT value;
+
+  // First pass: average every bin that has been updated, and keep the
+  // accumulators from growing indefinitely.
+#if defined(__SSE__) || defined(__x86_64__)
+  const __m128 half  = _mm_set1_ps(.5f);
+  const __m128 max   = _mm_set1_ps(SIGDIGGER_SCANNER_COUNT_MAX);
+  const __m128 reset = _mm_set1_ps(SIGDIGGER_SCANNER_COUNT_RESET);
+
+  for (; i + 4 <= this->size; i += 4) {
+    SUFLOAT *p = &bins[i].accum;
+    __m128 lo    = _mm_loadu_ps(p);
+    __m128 hi    = _mm_loadu_ps(p + 4);
+    __m128 acc   = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 cnt   = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+    __m128 valid = _mm_cmpgt_ps(cnt, half);
+    __m128 over  = _mm_cmpgt_ps(cnt, max);
+    __m128 avg   = _mm_or_ps(
+          _mm_and_ps(valid, _mm_div_ps(acc, cnt)),
+          _mm_andnot_ps(valid, _mm_loadu_ps(psd + i)));
+
+    _mm_storeu_ps(psd + i, avg);
+
+    acc = _mm_or_ps(
+          _mm_and_ps(over, _mm_mul_ps(avg, reset)),
+          _mm_andnot_ps(over, acc));
+    cnt = _mm_or_ps(_mm_and_ps(over, reset), _mm_andnot_ps(over, cnt));
+
+    _mm_storeu_ps(p,     _mm_unpacklo_ps(acc, cnt));
+    _mm_storeu_ps(p + 4, _mm_unpackhi_ps(acc, cnt));
+  }
+#endif
+
+  for (; i < this->size; ++i) {
+    if (bins[i].count > .5f) {
+      psd[i] = bins[i].accum / bins[i].count;
+      if (bins[i].count > SIGDIGGER_SCANNER_COUNT_MAX) {
+        bins[i].count = SIGDIGGER_SCANNER_COUNT_RESET;
+        bins[i].accum = psd[i] * SIGDIGGER_SCANNER_COUNT_RESET;
+      }
+    }
+  }
 
-  // Find a bin with zero entries, measure its width,
-  // compute values in both ends and interpolate
-
-  i = 0;
-
-  for (i = 0; i < SIGDIGGER_SCANNER_SPECTRUM_SIZE; ++i) {
+  // Second pass: find bins with zero entries, measure the width of the
+  // gap, and interpolate between both ends.
+  for (i = 0; i < this->size; ++i) {
     if (!inGap) {
-      if (this->psdCount[i] <= .5f) {
+      if (bins[i].count <= .5f) {
         // Found zero!
         inGap = true;
         zero_pos = i;
@@ -65,29 +213,26 @@ SpectrumView::interpolate(void)
 
         first = i == 0;
         if (!first)
-          left = this->psd[i - 1];
-
-      } else {
-        this->psd[i] = this->psdAccum[i] / this->psdCount[i];
-        if (this->psdCount[i] > SIGDIGGER_SCANNER_COUNT_MAX) {
-          this->psdCount[i]    = SIGDIGGER_SCANNER_COUNT_RESET;
-          this->psdAccum[i] = this->psd[i] * SIGDIGGER_SCANNER_COUNT_RESET;
-        }
+          left = psd[i - 1];
       }
     } else {
-      if (this->psdCount[i] <= .5f) {
+      if (bins[i].count <= .5f) {
         ++count;
       } else {
-        // End of gap of zeroes. Compute right and interpolate
+        // End of gap of zeroes. Interpolate up to the right end.
         inGap = false;
-        right = this->psd[i] = this->psdAccum[i] / this->psdCount[i];
-        if (first) {
-          for (j = 0; j < count; ++j)
-            this->psd[j + zero_pos] = right;
-        } else {
-          for (j = 0; j < count; ++j) {
+        right = psd[i];
+        for (j = 0; j < count; ++j) {
+          if (first) {
+            value = right;
+          } else {
             t = static_cast<SUFLOAT>(j + .5f) / count;
-            this->psd[j + zero_pos] = (1 - t) * left + t * right;
+            value = (1 - t) * left + t * right;
+          }
+
+          if (psd[j + zero_pos] != value) {
+            psd[j + zero_pos] = value;
+            this->markDirty(j + zero_pos, j + zero_pos + 1);
           }
         }
       }
@@ -95,15 +240,21 @@ SpectrumView::interpolate(void)
   }
 
   // Deal with trailing zeroes, if any
-  if (inGap)
-    for (j = 0; j < count; ++j)
-      this->psd[j + zero_pos] = right;
+  if (inGap) {
+    for (j = 0; j < count; ++j) {
+      if (psd[j + zero_pos] != right) {
+        psd[j + zero_pos] = right;
+        this->markDirty(j + zero_pos, j + zero_pos + 1);
+      }
+    }
+  }
 }
 
 void
 SpectrumView::feedLinearMode(
     const SUFLOAT *psdData,
     const SUFLOAT *countData,
+    unsigned int stride,
     SUFREQ freqMin,
     SUFREQ freqMax,
     bool adjustSides)
@@ -115,8 +266,9 @@ SpectrumView::feedLinearMode(
   int skip;
   int i, j = 0, p = 0;
   int pieceWidth;
-  int startBin, endBin;
+  int startBin, endBin, inner;
   int scaledLen;
+  int size = static_cast<int>(this->size);
   SUFLOAT psdAccum = 0, psdCount = 0;
   SUFREQ pos = 0;
   SUFLOAT accPrev, accCurr;
@@ -126,62 +278,68 @@ SpectrumView::feedLinearMode(
   SUFLOAT delta;
   SUFREQ freqSkip;
   SUFLOAT tStart, tEnd;
+  const SUFLOAT *psdPiece;
+  const SUFLOAT *countPiece;
 
   // Compute subrange inside PSD message
   inpBw = freqMax - freqMin;
   if (adjustSides) {
-    skip = static_cast<int>(
-          .5f * (1 - this->fftRelBw) * SIGDIGGER_SCANNER_SPECTRUM_SIZE);
+    skip = static_cast<int>(.5f * (1 - this->fftRelBw) * size);
   } else {
     skip = 0;
   }
 
-  freqSkip = static_cast<SUFREQ>(skip) / SIGDIGGER_SCANNER_SPECTRUM_SIZE
-      * inpBw;
-  pieceWidth = SIGDIGGER_SCANNER_SPECTRUM_SIZE - 2 * skip;
+  freqSkip = static_cast<SUFREQ>(skip) / size * inpBw;
+  pieceWidth = size - 2 * skip;
   bw = inpBw - 2 * freqSkip;
   assert(skip >= 0);
 
+  psdPiece   = psdData + skip * stride;
+  countPiece = countData != nullptr ? countData + skip * stride : nullptr;
+
   // Delicate step 1: Average in blocks of fftCount.
   // In this range, we can fit fftCount = range / bw pieces
-  // Each piece is w = SIGDIGGER_SCANNER_SPECTRUM_SIZE / fftCount bins wide
-  // We must average SIGDIGGER_SCANNER_SPECTRUM_SIZE / w = fftCount bins
+  // Each piece is w = size / fftCount bins wide
+  // We must average size / w = fftCount bins
 
   // Compute dimension variables.
   fftCount  = static_cast<SUFLOAT>(this->freqRange / bw); // How many FFTs fit in here.
-  bins      = SIGDIGGER_SCANNER_SPECTRUM_SIZE / fftCount; // Target bin count
+  bins      = size / fftCount; // Target bin count
   delta     = static_cast<SUFLOAT>(pieceWidth - 1) / bins;
   scaledLen = static_cast<int>(SU_FLOOR(bins));
 
-  if (scaledLen > SIGDIGGER_SCANNER_SPECTRUM_SIZE)
-    scaledLen = SIGDIGGER_SCANNER_SPECTRUM_SIZE;
+  if (scaledLen > size)
+    scaledLen = size;
 
-  // This is basically a linear scale
+  // This is basically a linear scale. Both ends of each block are
+  // weighted, everything in between is added as is.
   for (i = 0; i < scaledLen; ++i) {
     startBin  = static_cast<int>(SU_FLOOR(i * delta));
     endBin    = static_cast<int>(SU_FLOOR((i + 1) * delta));
     tStart    =  1 - (i * delta - startBin);
     tEnd      =  (i + 1) * delta - endBin;
-    psdAccum  = 0;
-    psdCount  = 0;
-
-    for (j = startBin; j <= endBin; ++j) {
-      x = psdData[j + skip];
-      c = countData != nullptr ? countData[j + skip] : 1;
-      if (j == startBin) {
-        psdAccum += tStart * x;
-        psdCount += tStart * c;
-      } else if (j == endBin) {
-        psdAccum += tEnd * x;
-        psdCount += tEnd * c;
-      } else {
-        psdAccum += x;
-        psdCount += c;
-      }
+
+    if (startBin == endBin) {
+      psdAccum = tStart * psdPiece[startBin * stride];
+      psdCount = countPiece != nullptr
+          ? tStart * countPiece[startBin * stride]
+          : tStart;
+    } else {
+      inner    = endBin - startBin - 1;
+      psdAccum = tStart * psdPiece[startBin * stride]
+          + tEnd * psdPiece[endBin * stride]
+          + scannerSum(psdPiece + (startBin + 1) * stride, inner, stride);
+
+      if (countPiece != nullptr)
+        psdCount = tStart * countPiece[startBin * stride]
+            + tEnd * countPiece[endBin * stride]
+            + scannerSum(countPiece + (startBin + 1) * stride, inner, stride);
+      else
+        psdCount = tStart + tEnd + inner;
     }
 
-    this->scaledPsdAccum[i] = psdAccum / delta;
-    this->scaledPsdCount[i] = psdCount / delta;
+    this->scaled[i].accum = psdAccum / delta;
+    this->scaled[i].count = psdCount / delta;
   }
 
   p = i;
@@ -193,7 +351,7 @@ SpectrumView::feedLinearMode(
   //
 
   pos = (freqSkip + freqMin - this->freqMin) / (this->freqRange);
-  pos *= SIGDIGGER_SCANNER_SPECTRUM_SIZE;
+  pos *= size;
   j = static_cast<int>(floor(pos));
   t = static_cast<SUFLOAT>(pos - j);
 
@@ -201,19 +359,20 @@ SpectrumView::feedLinearMode(
 
   accPrev = cntPrev = 0;
   for (i = 1; i <= p; ++i, ++j) {
-    accCurr = i < p ? this->scaledPsdAccum[i] : 0;
-    cntCurr = i < p ? this->scaledPsdCount[i] : 0;
+    accCurr = i < p ? this->scaled[i].accum : 0;
+    cntCurr = i < p ? this->scaled[i].count : 0;
 
     assert(!std::isnan(accCurr));
     x = (1 - t) * accPrev + t * accCurr;
     c = (1 - t) * cntPrev + t * cntCurr;
     assert(!std::isnan(x));
 
-    if (j >= 0 && j < SIGDIGGER_SCANNER_SPECTRUM_SIZE) {
+    if (j >= 0 && j < size) {
       // Add, taking into account the interpolation parameter
       // and the weight of the last coefficient.
-      this->psdAccum[j] += x;
-      this->psdCount[j] += c;
+      this->bins[j].accum += x;
+      this->bins[j].count += c;
+      this->markDirty(static_cast<unsigned>(j), static_cast<unsigned>(j) + 1);
     }
 
     accPrev = accCurr;
@@ -224,6 +383,7 @@ SpectrumView::feedLinearMode(
 void
 SpectrumView::feedHistogramMode(
     const SUFLOAT *psdData,
+    unsigned int stride,
     SUFREQ freqMin,
     SUFREQ freqMax)
 {
@@ -231,23 +391,23 @@ SpectrumView::feedHistogramMode(
   SUFREQ fStart = (freqMin - this->freqMin) / this->freqRange;
   SUFREQ fEnd   = (freqMax - this->freqMin) / this->freqRange;
   SUFLOAT t;
-  SUFLOAT inv = 1. / SIGDIGGER_SCANNER_SPECTRUM_SIZE;
-  unsigned int i;
+  SUFLOAT inv = 1.f / this->size;
   SUFLOAT accum = 0;
 
-  fStart *= SIGDIGGER_SCANNER_SPECTRUM_SIZE;
-  fEnd   *= SIGDIGGER_SCANNER_SPECTRUM_SIZE;
-  relBw  *= SIGDIGGER_SCANNER_SPECTRUM_SIZE;
+  fStart *= this->size;
+  fEnd   *= this->size;
+  relBw  *= this->size;
+
+  // PSDs starting outside the view do not fit in any bin
+  if (fStart < 0 || fStart >= this->size)
+    return;
 
   unsigned int j = static_cast<unsigned int>(fStart);
 
   // Now, relBw represents the relative size of the range
   // with respecto to the spectrum bin.
 
-  for (i = 0; i < SIGDIGGER_SCANNER_SPECTRUM_SIZE; ++i)
-    accum += psdData[i];
-
-  accum *= inv;
+  accum = scannerSum(psdData, static_cast<int>(this->size), stride) * inv;
 
   assert(!std::isnan(inv));
   assert(!std::isnan(accum));
@@ -256,16 +416,20 @@ SpectrumView::feedHistogramMode(
     // Between two bins.
     t = static_cast<SUFLOAT>((fStart - floor(fStart)) / relBw);
 
-    this->psdCount[j] += 1 - t;
-    this->psdAccum[j] += (1 - t) * accum;
+    this->bins[j].count += 1 - t;
+    this->bins[j].accum += (1 - t) * accum;
 
-    if (j + 1 < SIGDIGGER_SCANNER_SPECTRUM_SIZE) {
-      this->psdCount[j + 1] += t;
-      this->psdAccum[j + 1] += t * accum;
+    if (j + 1 < this->size) {
+      this->bins[j + 1].count += t;
+      this->bins[j + 1].accum += t * accum;
     }
+
+    this->markDirty(j, j + 2);
   } else {
-    this->psdCount[j] += 1;
-    this->psdAccum[j] += accum;
+    this->bins[j].count += 1;
+    this->bins[j].accum += accum;
+
+    this->markDirty(j, j + 1);
   }
 }
 
@@ -273,16 +437,17 @@ void
 SpectrumView::feed(
     const SUFLOAT *psd,
     const SUFLOAT *count,
+    unsigned int stride,
     SUFREQ freqMin,
     SUFREQ freqMax,
     bool adjustSides)
 {
   SUFREQ fftCount = (freqMax - freqMin) / this->freqRange;
 
-  if (fftCount * SIGDIGGER_SCANNER_SPECTRUM_SIZE >= 2)
-    this->feedLinearMode(psd, count, freqMin, freqMax, adjustSides);
+  if (fftCount * this->size >= 2)
+    this->feedLinearMode(psd, count, stride, freqMin, freqMax, adjustSides);
   else
-    this->feedHistogramMode(psd, freqMin, freqMax);
+    this->feedHistogramMode(psd, stride, freqMin, freqMax);
 
   this->interpolate();
 }
@@ -290,13 +455,21 @@ SpectrumView::feed(
 void
 SpectrumView::feed(
     const SUFLOAT *psd,
-    const SUFLOAT *count,
+    SUFREQ freqMin,
+    SUFREQ freqMax,
+    bool adjustSides)
+{
+  this->feed(psd, nullptr, 1, freqMin, freqMax, adjustSides);
+}
+
+void
+SpectrumView::feed(
+    const SUFLOAT *psd,
     SUFREQ center,
     bool adjustSides)
 {
   this->feed(
         psd,
-        count,
         center - this->fftBandwidth / 2,
         center + this->fftBandwidth / 2,
         adjustSides);
@@ -305,9 +478,14 @@ SpectrumView::feed(
 void
 SpectrumView::feed(SpectrumView const &detail)
 {
+  // Both views must have the same resolution
+  if (detail.size != this->size)
+    return;
+
   this->feed(
-        detail.psdAccum,
-        detail.psdCount,
+        &detail.bins[0].accum,
+        &detail.bins[0].count,
+        2,
         detail.freqMin,
         detail.freqMax,
         false);
@@ -316,20 +494,46 @@ SpectrumView::feed(SpectrumView const &detail)
 void
 SpectrumView::reset(void)
 {
-  memset(this->psd, 0, SIGDIGGER_SCANNER_SPECTRUM_SIZE * sizeof(SUFLOAT));
-  memset(this->psdAccum, 0, SIGDIGGER_SCANNER_SPECTRUM_SIZE * sizeof(SUFLOAT));
-  memset(this->psdCount, 0, SIGDIGGER_SCANNER_SPECTRUM_SIZE * sizeof(SUFLOAT));
-  memset(this->scaledPsdAccum, 0, SIGDIGGER_SCANNER_SPECTRUM_SIZE * sizeof(SUFLOAT));
-  memset(this->scaledPsdCount, 0, SIGDIGGER_SCANNER_SPECTRUM_SIZE * sizeof(SUFLOAT));
+  SpectrumBin zero = {0, 0};
+
+  std::fill(this->psd.begin(), this->psd.end(), 0);
+  std::fill(this->bins.begin(), this->bins.end(), zero);
+  std::fill(this->scaled.begin(), this->scaled.end(), zero);
+
+  this->dirtyStart = 0;
+  this->dirtyEnd   = this->size;
+}
+
+Scanner::Scanner(
+    QObject *parent,
+    SUFREQ freqMin,
+    SUFREQ freqMax,
+    Suscan::Source::Config const &cfg,
+    unsigned int size) :
+  Scanner(
+    parent,
+    freqMin,
+    freqMax,
+    std::vector<Suscan::Source::Config>{cfg},
+    size)
+{
 }
 
 Scanner::Scanner(
     QObject *parent,
     SUFREQ freqMin,
     SUFREQ freqMax,
-    Suscan::Source::Config const &cfg) : QObject(parent)
+    std::vector<Suscan::Source::Config> const &configs,
+    unsigned int size) : QObject(parent)
 {
   Suscan::AnalyzerParams params;
+  SUFREQ step;
+  unsigned int i;
+
+  this->views[0].setSize(size);
+  this->views[1].setSize(size);
+  this->size = this->views[0].size;
+  this->fragment.setSize(this->size);
 
   if (freqMin > freqMax) {
     SUFREQ tmp = freqMin;
@@ -337,52 +541,124 @@ Scanner::Scanner(
     freqMax = tmp;
   }
 
+  if (configs.empty())
+    throw Suscan::Exception("No devices given to the panoramic scanner");
+
   this->freqMin = freqMin;
   this->freqMax = freqMax;
+  this->store.setRange(freqMin, freqMax);
 
   params.channelUpdateInterval = 0;
   params.spectrumAvgAlpha = .001f;
   params.sAvgAlpha = 0.001f;
   params.nAvgAlpha = 0.5;
   params.snr = 2;
-  params.windowSize = SIGDIGGER_SCANNER_SPECTRUM_SIZE;
+  params.windowSize = this->size;
 
   params.mode = Suscan::AnalyzerParams::Mode::WIDE_SPECTRUM;
-  params.minFreq = freqMin;
-  params.maxFreq = freqMax;
 
+  // Every device sweeps its own slice of the range, of equal width
+  step = (freqMax - freqMin) / configs.size();
+
+  try {
+    for (i = 0; i < configs.size(); ++i) {
+      Suscan::Source::Config cfg = configs[i];
+      ScannerDevice dev;
+
+      dev.freqMin = freqMin + i * step;
+      dev.freqMax = i + 1 == configs.size() ? freqMax : dev.freqMin + step;
+      dev.hopMin  = dev.freqMin;
+      dev.hopMax  = dev.freqMax;
 
-  this->analyzer = new Suscan::Analyzer(params, cfg);
+      params.minFreq = dev.freqMin;
+      params.maxFreq = dev.freqMax;
+      cfg.setFreq(.5 * (dev.freqMin + dev.freqMax));
 
+      // Every PSD message belongs to a different hop. None of them can be
+      // discarded, not even the first ones.
+      dev.analyzer = new Suscan::Analyzer(params, cfg, false);
+      this->devices.push_back(dev);
+
+      this->connectAnalyzer(dev.analyzer);
+    }
+  } catch (Suscan::Exception &) {
+    for (auto &p : this->devices)
+      delete p.analyzer;
+    throw;
+  }
+}
+
+void
+Scanner::connectAnalyzer(Suscan::Analyzer *analyzer)
+{
   connect(
-        this->analyzer,
+        analyzer,
         SIGNAL(halted(void)),
         this,
         SLOT(onAnalyzerHalted(void)));
 
   connect(
-        this->analyzer,
+        analyzer,
         SIGNAL(eos(void)),
         this,
         SLOT(onAnalyzerHalted(void)));
 
   connect(
-        this->analyzer,
+        analyzer,
         SIGNAL(read_error(void)),
         this,
         SLOT(onAnalyzerHalted(void)));
 
   connect(
-        this->analyzer,
+        analyzer,
         SIGNAL(psd_message(const Suscan::PSDMessage &)),
         this,
         SLOT(onPSDMessage(const Suscan::PSDMessage &)));
 }
 
+Scanner::ScannerDevice *
+Scanner::lookupDevice(QObject *analyzer)
+{
+  for (auto &p : this->devices)
+    if (p.analyzer == analyzer)
+      return &p;
+
+  return nullptr;
+}
+
 Scanner::~Scanner()
 {
-  if (this->analyzer != nullptr)
-    delete this->analyzer;
+  delete this->relaySender;
+  delete this->relayReceiver;
+
+  for (auto &p : this->devices)
+    delete p.analyzer;
+}
+
+void
+Scanner::relayTo(QString const &host, quint16 port)
+{
+  delete this->relaySender;
+  this->relaySender = nullptr;
+
+  if (!host.isEmpty())
+    this->relaySender = new PanoramicRelaySender(host, port, this);
+}
+
+bool
+Scanner::aggregate(quint16 port)
+{
+  delete this->relayReceiver;
+  this->relayReceiver = new PanoramicRelayReceiver(this->size, this);
+
+  connect(
+        this->relayReceiver,
+        SIGNAL(fragmentReceived(SigDigger::SpectrumView const &)),
+        this,
+        SLOT(onFragment(SigDigger::SpectrumView const &)),
+        Qt::DirectConnection);
+
+  return this->relayReceiver->listen(port);
 }
 
 void
@@ -390,8 +666,8 @@ Scanner::setRelativeBw(float ratio)
 {
   if (ratio > 1)
     ratio = 1;
-  else if (ratio < 2.f / SIGDIGGER_SCANNER_SPECTRUM_SIZE)
-    ratio = 2.f / SIGDIGGER_SCANNER_SPECTRUM_SIZE;
+  else if (ratio < 2.f / this->size)
+    ratio = 2.f / this->size;
 
   this->views[0].fftRelBw = this->views[1].fftRelBw = ratio;
   this->relBw = ratio;
@@ -412,7 +688,8 @@ Scanner::getSpectrumView(void) const
 void
 Scanner::stop(void)
 {
-  this->analyzer->halt();
+  for (auto &p : this->devices)
+    p.analyzer->halt();
 }
 
 void
@@ -425,19 +702,202 @@ Scanner::flip(void)
 void
 Scanner::setStrategy(Suscan::Analyzer::SweepStrategy strategy)
 {
-  this->analyzer->setSweepStrategy(strategy);
+  for (auto &p : this->devices)
+    p.analyzer->setSweepStrategy(strategy);
+}
+
+void
+Scanner::setAdaptive(bool adaptive)
+{
+  if (this->adaptive != adaptive) {
+    this->adaptive = adaptive;
+
+    try {
+      for (auto &p : this->devices) {
+        p.current = -1;
+        p.dwell = 0;
+
+        if (adaptive)
+          this->buildSegments(p);
+
+        this->applyHopRange(p);
+      }
+    } catch (Suscan::Exception const &) {
+    }
+  }
+}
+
+bool
+Scanner::isAdaptive(void) const
+{
+  return this->adaptive;
+}
+
+void
+Scanner::applyHopRange(ScannerDevice &dev)
+{
+  if (this->adaptive && !dev.idle && !dev.segments.empty())
+    this->schedule(dev);
+  else
+    dev.analyzer->setHopRange(dev.hopMin, dev.hopMax);
+}
+
+//
+// Splits the hop range of a device in segments as wide as the useful
+// part of a single PSD. Statistics of segments that keep their center
+// are preserved.
+//
+void
+Scanner::buildSegments(ScannerDevice &dev)
+{
+  std::vector<ScannerSegment> old;
+  SUFREQ width = dev.fs * static_cast<SUFREQ>(this->relBw);
+  SUFREQ range = dev.hopMax - dev.hopMin;
+  unsigned int n, i;
+  size_t j = 0;
+
+  if (dev.fs == 0 || width <= 0) {
+    dev.segments.clear();
+    return;
+  }
+
+  n = static_cast<unsigned int>(std::ceil(range / width));
+  if (n == 0)
+    n = 1;
+
+  old.swap(dev.segments);
+  dev.segments.resize(n);
+  dev.segmentWidth = range > 0 ? range / n : width;
+
+  for (i = 0; i < n; ++i) {
+    ScannerSegment &seg = dev.segments[i];
+    seg.center = n == 1 && range <= 0
+        ? dev.hopMin
+        : dev.hopMin + (i + .5) * dev.segmentWidth;
+
+    while (j < old.size() && old[j].center < seg.center - 1)
+      ++j;
+
+    if (j < old.size() && std::fabs(old[j].center - seg.center) <= 1) {
+      seg = old[j];
+      seg.center = dev.segments[i].center;
+    }
+  }
+
+  dev.current = -1;
+  dev.dwell = 0;
+}
+
+void
+Scanner::updateSegment(ScannerDevice &dev, const SUFLOAT *psd, SUFREQ center)
+{
+  unsigned int skip =
+      static_cast<unsigned int>(.5f * (1 - this->relBw) * this->size);
+  unsigned int n = this->size - 2 * skip;
+  unsigned int busy = 0, i;
+  SUFLOAT mean = 0, delta, threshold;
+  qint64 index;
+
+  if (dev.segments.empty() || n == 0)
+    return;
+
+  index = dev.segmentWidth > 0
+      ? static_cast<qint64>(
+          std::floor((center - dev.hopMin) / dev.segmentWidth))
+      : 0;
+
+  if (index < 0 || index >= static_cast<qint64>(dev.segments.size()))
+    return;
+
+  ScannerSegment &seg = dev.segments[static_cast<size_t>(index)];
+
+  psd += skip;
+
+  for (i = 0; i < n; ++i)
+    mean += psd[i];
+  mean /= n;
+
+  threshold = (seg.visited ? seg.mean : mean)
+      + SIGDIGGER_SCANNER_ADAPTIVE_OCCUPANCY_DB;
+
+  for (i = 0; i < n; ++i)
+    if (psd[i] > threshold)
+      ++busy;
+
+  if (!seg.visited) {
+    seg.mean = mean;
+    seg.var = 0;
+    seg.occupancy = static_cast<SUFLOAT>(busy) / n;
+    seg.visited = true;
+  } else {
+    // Exponentially weighted mean and variance
+    delta = mean - seg.mean;
+    seg.mean += SIGDIGGER_SCANNER_ADAPTIVE_ALPHA * delta;
+    seg.var = (1 - SIGDIGGER_SCANNER_ADAPTIVE_ALPHA)
+        * (seg.var + SIGDIGGER_SCANNER_ADAPTIVE_ALPHA * delta * delta);
+    seg.occupancy += SIGDIGGER_SCANNER_ADAPTIVE_ALPHA
+        * (static_cast<SUFLOAT>(busy) / n - seg.occupancy);
+  }
+
+  seg.lastRound = this->round;
+}
+
+void
+Scanner::schedule(ScannerDevice &dev)
+{
+  SUFLOAT best = -1, priority;
+  int next = -1;
+  int i = 0;
+
+  if (dev.current >= 0 && ++dev.dwell < SIGDIGGER_SCANNER_ADAPTIVE_DWELL)
+    return;
+
+  ++this->round;
+
+  for (auto &seg : dev.segments) {
+    if (!seg.visited) {
+      // Complete a first pass before anything else
+      next = i;
+      break;
+    }
+
+    priority = static_cast<SUFLOAT>(this->round - seg.lastRound)
+        * (1
+           + SIGDIGGER_SCANNER_ADAPTIVE_VAR_WEIGHT * std::sqrt(seg.var)
+           + SIGDIGGER_SCANNER_ADAPTIVE_OCC_WEIGHT * seg.occupancy);
+
+    if (priority > best) {
+      best = priority;
+      next = i;
+    }
+
+    ++i;
+  }
+
+  if (next >= 0) {
+    SUFREQ center = dev.segments[static_cast<size_t>(next)].center;
+    dev.current = next;
+    dev.dwell = 0;
+    dev.analyzer->setHopRange(center, center);
+  }
 }
 
 void
 Scanner::setPartitioning(Suscan::Analyzer::SpectrumPartitioning partitioning)
 {
-  this->analyzer->setSpectrumPartitioning(partitioning);
+  for (auto &p : this->devices)
+    p.analyzer->setSpectrumPartitioning(partitioning);
 }
 
 void
 Scanner::setGain(QString const &name, float value)
 {
-  this->analyzer->setGain(name.toStdString(), value);
+  // Devices need not share the same gain elements
+  for (auto &p : this->devices) {
+    try {
+      p.analyzer->setGain(name.toStdString(), value);
+    } catch (Suscan::Exception const &) { }
+  }
 }
 
 unsigned int
@@ -446,10 +906,35 @@ Scanner::getFs(void) const
   return this->fs;
 }
 
+unsigned int
+Scanner::getSpectrumSize(void) const
+{
+  return this->size;
+}
+
+unsigned int
+Scanner::getDeviceCount(void) const
+{
+  return static_cast<unsigned int>(this->devices.size());
+}
+
+quint64
+Scanner::getDroppedHops(void) const
+{
+  return this->droppedHops;
+}
+
+SpectrumTileStore const &
+Scanner::getTileStore(void) const
+{
+  return this->store;
+}
+
 void
 Scanner::setViewRange(SUFREQ freqMin, SUFREQ freqMax, bool noHop)
 {
   SUFREQ searchMin, searchMax;
+  SUFREQ devMin, devMax;
 
   if (fs == 0)
       return;
@@ -482,43 +967,174 @@ Scanner::setViewRange(SUFREQ freqMin, SUFREQ freqMax, bool noHop)
         std::fabs(this->getSpectrumView().freqMax - freqMax) > 1) {
       SpectrumView &previous = this->getSpectrumView();
       this->flip();
-      this->getSpectrumView().setRange(freqMin, freqMax);
-      this->getSpectrumView().feed(previous);
+
+      SpectrumView &current = this->getSpectrumView();
+      current.setRange(freqMin, freqMax);
+
+      // Reuse whatever was already swept at this resolution. The previous
+      // view is only needed if the store has nothing for this range.
+      if (this->store.render(
+            freqMin,
+            freqMax,
+            &current.bins[0].accum,
+            &current.bins[0].count,
+            current.size,
+            2) > 0)
+        current.interpolate();
+      else
+        current.feed(previous);
     }
 
-    this->analyzer->setHopRange(searchMin, searchMax);
+    // Each device only sweeps the part of its slice that is visible.
+    // Devices with nothing to show park at the edge closest to the view.
+    for (auto &p : this->devices) {
+      devMin = searchMin < p.freqMin ? p.freqMin : searchMin;
+      devMax = searchMax > p.freqMax ? p.freqMax : searchMax;
+
+      if (devMin > devMax) {
+        devMin = devMax = searchMax < p.freqMin ? p.freqMin : p.freqMax;
+        p.idle = true;
+      } else {
+        p.idle = false;
+      }
+
+      p.hopMin = devMin;
+      p.hopMax = devMax;
+
+      if (this->adaptive)
+        this->buildSegments(p);
+
+      this->applyHopRange(p);
+    }
   } catch (Suscan::Exception const &) {
     // Invalid limits, warn?
   }
 }
 
+void
+Scanner::applyBuffering(ScannerDevice &dev)
+{
+  unsigned int wait = dev.settleMs > 0 ? dev.settleMs : this->rtt;
+
+  if (dev.fs > 0)
+    dev.analyzer->setBufferingSize(
+          static_cast<SUSCOUNT>(wait) * dev.fs / 1000);
+}
+
+// Whether this hop was taken after the device settled. The previous hop
+// of the device marks the retune.
+bool
+Scanner::settled(ScannerDevice &dev, struct timeval const &tv)
+{
+  struct timeval diff;
+  qreal elapsed, needed;
+  bool ok = true;
+
+  if (dev.settleMs > 0 && dev.haveLastHop) {
+    timersub(&tv, &dev.lastHop, &diff);
+    elapsed = diff.tv_sec + diff.tv_usec * 1e-6;
+    needed  = dev.settleMs * 1e-3
+        + static_cast<qreal>(this->size) / dev.fs;
+
+    // Non-monotonic timestamps (replays, clock jumps) are let through
+    ok = elapsed < 0 || elapsed >= needed;
+  }
+
+  dev.lastHop = tv;
+  dev.haveLastHop = true;
+
+  return ok;
+}
+
 void
 Scanner::setRttMs(unsigned int rtt)
 {
   this->rtt = rtt;
 
-  if (this->fs > 0)
-    this->analyzer->setBufferingSize(rtt * this->fs / 1000);
+  for (auto &p : this->devices)
+    this->applyBuffering(p);
+}
+
+void
+Scanner::setSettleMs(unsigned int device, unsigned int ms)
+{
+  if (device < this->devices.size()) {
+    this->devices[device].settleMs = ms;
+    this->applyBuffering(this->devices[device]);
+  }
 }
 
 ////////////////////////////// Slots /////////////////////////////////////
 void
 Scanner::onPSDMessage(const Suscan::PSDMessage &msg)
 {
-  if (!this->fsGuessed) {
-    this->fs = msg.getSampleRate();
-    this->analyzer->setBufferingSize(this->rtt * this->fs / 1000);
-    this->analyzer->setBandwidth(this->fs);
-    this->fsGuessed = true;
-    this->views[0].fftBandwidth = this->views[1].fftBandwidth = this->fs;
-    this->getSpectrumView().setRange(this->freqMin, this->freqMax);
+  ScannerDevice *dev = this->lookupDevice(this->sender());
+  SpectrumView &view = this->getSpectrumView();
+  SUFREQ center = msg.getFrequency();
+
+  if (dev == nullptr)
+    return;
+
+  if (dev->fs == 0) {
+    dev->fs = msg.getSampleRate();
+    this->applyBuffering(*dev);
+    dev->analyzer->setBandwidth(dev->fs);
+
+    if (this->adaptive) {
+      this->buildSegments(*dev);
+      this->applyHopRange(*dev);
+    }
+
+    // The first device to report its rate initializes the views
+    if (!this->fsGuessed) {
+      this->fs = dev->fs;
+      this->fsGuessed = true;
+      this->views[0].fftBandwidth = this->views[1].fftBandwidth = this->fs;
+      view.setRange(this->freqMin, this->freqMax);
+    }
   }
 
-  if (msg.size() == SIGDIGGER_SCANNER_SPECTRUM_SIZE) {
-    this->getSpectrumView().feed(
-          msg.get(),
-          nullptr,
-          msg.getFrequency());
+  if (!this->settled(*dev, msg.getTimeStamp())) {
+    ++this->droppedHops;
+    return;
+  }
+
+  // Hops of parked devices may not even overlap the view
+  if (dev->idle
+      || center + dev->fs / 2 < view.freqMin
+      || center - dev->fs / 2 > view.freqMax)
+    return;
+
+  if (msg.size() == this->size) {
+    unsigned int skip =
+        static_cast<unsigned int>(.5f * (1 - this->relBw) * this->size);
+    SUFREQ freqSkip = static_cast<SUFREQ>(skip) / this->size * dev->fs;
+
+    view.feed(msg.get(), center - dev->fs / 2, center + dev->fs / 2);
+
+    // The aggregator merges it as if it were a view of this hop only
+    if (this->relaySender != nullptr) {
+      this->fragment.fftBandwidth = dev->fs;
+      this->fragment.fftRelBw = this->relBw;
+      this->fragment.setRange(center - dev->fs / 2, center + dev->fs / 2);
+      this->fragment.feed(msg.get(), center - dev->fs / 2, center + dev->fs / 2);
+      this->relaySender->send(this->fragment);
+    }
+
+    if (this->adaptive) {
+      try {
+        this->updateSegment(*dev, msg.get(), center);
+        this->schedule(*dev);
+      } catch (Suscan::Exception const &) {
+      }
+    }
+
+    // The store keeps the useful part of the PSD only
+    this->store.feed(
+          msg.get() + skip,
+          this->size - 2 * skip,
+          center - dev->fs / 2 + freqSkip,
+          center + dev->fs / 2 - freqSkip);
   }
 
   emit spectrumUpdated();
@@ -529,3 +1145,42 @@ Scanner::onAnalyzerHalted(void)
 {
   emit stopped();
 }
+
+void
+Scanner::onFragment(SpectrumView const &fragment)
+{
+  SpectrumView &view = this->getSpectrumView();
+  unsigned int first = 0, last = fragment.size;
+  SUFREQ binWidth = fragment.freqRange / fragment.size;
+
+  // Nothing to merge into until our own devices set up the view
+  if (!this->fsGuessed
+      || fragment.freqMax < view.freqMin
+      || fragment.freqMin > view.freqMax)
+    return;
+
+  view.feed(fragment);
+
+  // The store takes plain PSDs: only the part of the hop with data
+  while (first < last && fragment.bins[first].count <= 0)
+    ++first;
+
+  while (last > first && fragment.bins[last - 1].count <= 0)
+    --last;
+
+  if (first < last) {
+    this->fragmentPsd.resize(last - first);
+
+    for (unsigned int i = first; i < last; ++i)
+      this->fragmentPsd[i - first] =
+          fragment.bins[i].accum / fragment.bins[i].count;
+
+    this->store.feed(
+          this->fragmentPsd.data(),
+          last - first,
+          fragment.freqMin + first * binWidth,
+          fragment.freqMin + last * binWidth);
+  }
+
+  emit spectrumUpdated();
+}
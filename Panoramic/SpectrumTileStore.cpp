@@ -0,0 +1,383 @@
+//
+//    Panoramic/SpectrumTileStore.cpp: Multi-resolution store of panoramic spectrum data
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "SpectrumTileStore.h"
+#include <cmath>
+#include <cstring>
+
+using namespace SigDigger;
+
+SpectrumTileStore::SpectrumTileStore(size_t memory)
+{
+  this->setMemoryLimit(memory);
+}
+
+SUFREQ
+SpectrumTileStore::binWidth(unsigned int level) const
+{
+  return this->freqRange
+      / (static_cast<SUFREQ>(SIGDIGGER_TILE_STORE_TILE_BINS)
+         * static_cast<SUFREQ>(1ull << level));
+}
+
+//
+// Level whose bins are closest to binWidth. If coarser is set, bins of
+// the returned level are never narrower than binWidth (so that every one
+// of them receives at least one sample). Otherwise, they are never wider.
+//
+unsigned int
+SpectrumTileStore::levelFor(SUFREQ binWidth, bool coarser) const
+{
+  SUFREQ level;
+
+  if (binWidth <= 0)
+    return this->maxLevel;
+
+  level = std::log2(
+        this->freqRange / (SIGDIGGER_TILE_STORE_TILE_BINS * binWidth));
+  level = coarser ? std::floor(level) : std::ceil(level);
+
+  if (level < 0)
+    return 0;
+
+  if (level > this->maxLevel)
+    return this->maxLevel;
+
+  return static_cast<unsigned int>(level);
+}
+
+SpectrumTileStore::Tile *
+SpectrumTileStore::findTile(unsigned int level, quint64 index)
+{
+  auto it = this->tiles.find(key(level, index));
+
+  if (it == this->tiles.end())
+    return nullptr;
+
+  this->lru.splice(this->lru.begin(), this->lru, it->second.lru);
+
+  return &it->second;
+}
+
+SpectrumTileStore::Tile *
+SpectrumTileStore::assertTile(unsigned int level, quint64 index)
+{
+  Tile *tile = this->findTile(level, index);
+
+  if (tile == nullptr) {
+    quint64 k = key(level, index);
+
+    while (this->tiles.size() >= this->maxTiles && !this->lru.empty()) {
+      this->tiles.erase(this->lru.back());
+      this->lru.pop_back();
+    }
+
+    tile = &this->tiles[k];
+    std::memset(tile->accum, 0, sizeof(tile->accum));
+    std::memset(tile->count, 0, sizeof(tile->count));
+
+    this->lru.push_front(k);
+    tile->lru = this->lru.begin();
+  }
+
+  return tile;
+}
+
+void
+SpectrumTileStore::setRange(SUFREQ freqMin, SUFREQ freqMax)
+{
+  SUFREQ level;
+
+  if (freqMin > freqMax) {
+    SUFREQ tmp = freqMin;
+    freqMin = freqMax;
+    freqMax = tmp;
+  }
+
+  this->freqMin   = freqMin;
+  this->freqMax   = freqMax;
+  this->freqRange = freqMax - freqMin;
+
+  // Finer levels than 1 Hz per bin are of no use
+  level = this->freqRange > SIGDIGGER_TILE_STORE_TILE_BINS
+      ? std::floor(std::log2(this->freqRange / SIGDIGGER_TILE_STORE_TILE_BINS))
+      : 0;
+
+  if (level > SIGDIGGER_TILE_STORE_MAX_LEVELS - 1)
+    level = SIGDIGGER_TILE_STORE_MAX_LEVELS - 1;
+
+  this->maxLevel = static_cast<unsigned int>(level);
+
+  this->clear();
+}
+
+void
+SpectrumTileStore::setMemoryLimit(size_t bytes)
+{
+  this->maxTiles = bytes / sizeof(Tile);
+
+  if (this->maxTiles < 16)
+    this->maxTiles = 16;
+
+  while (this->tiles.size() > this->maxTiles) {
+    this->tiles.erase(this->lru.back());
+    this->lru.pop_back();
+  }
+}
+
+void
+SpectrumTileStore::clear(void)
+{
+  this->tiles.clear();
+  this->lru.clear();
+}
+
+size_t
+SpectrumTileStore::getTileCount(void) const
+{
+  return this->tiles.size();
+}
+
+size_t
+SpectrumTileStore::getMemoryUsage(void) const
+{
+  return this->tiles.size() * sizeof(Tile);
+}
+
+void
+SpectrumTileStore::commitLevel(
+    unsigned int level,
+    qint64 first,
+    const SUFLOAT *accum,
+    const SUFLOAT *count,
+    size_t len)
+{
+  Tile *tile = nullptr;
+  qint64 tileIndex = -1;
+
+  for (size_t j = 0; j < len; ++j) {
+    if (count[j] > 0) {
+      qint64 g = first + static_cast<qint64>(j);
+      qint64 t = g / SIGDIGGER_TILE_STORE_TILE_BINS;
+      unsigned int b = static_cast<unsigned int>(
+            g % SIGDIGGER_TILE_STORE_TILE_BINS);
+
+      if (t != tileIndex) {
+        tile = this->assertTile(level, static_cast<quint64>(t));
+        tileIndex = t;
+      }
+
+      // Every PSD contributes with its own average to each bin
+      tile->accum[b] += accum[j] / count[j];
+      tile->count[b] += 1;
+
+      if (tile->count[b] > SIGDIGGER_TILE_STORE_COUNT_MAX) {
+        tile->accum[b] *= SIGDIGGER_TILE_STORE_COUNT_RESET / tile->count[b];
+        tile->count[b]  = SIGDIGGER_TILE_STORE_COUNT_RESET;
+      }
+    }
+  }
+}
+
+void
+SpectrumTileStore::feed(
+    const SUFLOAT *psd,
+    unsigned int size,
+    SUFREQ freqMin,
+    SUFREQ freqMax)
+{
+  SUFREQ w, bw;
+  unsigned int level;
+  qint64 first, last, nBins;
+  size_t len;
+
+  if (size == 0 || this->freqRange <= 0 || freqMax <= freqMin)
+    return;
+
+  w     = (freqMax - freqMin) / size;
+  level = this->levelFor(w, true);
+  bw    = this->binWidth(level);
+  nBins = static_cast<qint64>(SIGDIGGER_TILE_STORE_TILE_BINS) << level;
+
+  first = static_cast<qint64>(std::floor((freqMin - this->freqMin) / bw));
+  last  = static_cast<qint64>(std::floor((freqMax - this->freqMin) / bw));
+
+  if (first < 0)
+    first = 0;
+
+  if (last >= nBins)
+    last = nBins - 1;
+
+  if (first > last)
+    return;
+
+  len = static_cast<size_t>(last - first + 1);
+  this->levelAccum.assign(len, 0);
+  this->levelCount.assign(len, 0);
+
+  // Bin the PSD at its native level
+  for (unsigned int k = 0; k < size; ++k) {
+    SUFREQ c = freqMin + (k + .5) * w;
+    qint64 g = static_cast<qint64>(std::floor((c - this->freqMin) / bw));
+
+    if (g >= first && g <= last) {
+      this->levelAccum[static_cast<size_t>(g - first)] += psd[k];
+      this->levelCount[static_cast<size_t>(g - first)] += 1;
+    }
+  }
+
+  // And merge bins pairwise for every coarser level
+  for (;;) {
+    qint64 nFirst, nLast;
+    size_t nLen;
+
+    this->commitLevel(
+          level,
+          first,
+          this->levelAccum.data(),
+          this->levelCount.data(),
+          len);
+
+    if (level == 0)
+      break;
+
+    nFirst = first >> 1;
+    nLast  = last >> 1;
+    nLen   = static_cast<size_t>(nLast - nFirst + 1);
+
+    this->mergeAccum.assign(nLen, 0);
+    this->mergeCount.assign(nLen, 0);
+
+    for (size_t j = 0; j < len; ++j) {
+      size_t t = static_cast<size_t>(
+            ((first + static_cast<qint64>(j)) >> 1) - nFirst);
+      this->mergeAccum[t] += this->levelAccum[j];
+      this->mergeCount[t] += this->levelCount[j];
+    }
+
+    this->levelAccum.swap(this->mergeAccum);
+    this->levelCount.swap(this->mergeCount);
+
+    first = nFirst;
+    last  = nLast;
+    len   = nLen;
+    --level;
+  }
+}
+
+unsigned int
+SpectrumTileStore::renderLevel(
+    unsigned int level,
+    SUFREQ freqMin,
+    SUFREQ freqMax,
+    SUFLOAT *accum,
+    SUFLOAT *count,
+    unsigned int size,
+    unsigned int stride)
+{
+  SUFREQ vb = (freqMax - freqMin) / size;
+  SUFREQ bw = this->binWidth(level);
+  qint64 nBins = static_cast<qint64>(SIGDIGGER_TILE_STORE_TILE_BINS) << level;
+  qint64 tileIndex = -1;
+  Tile *tile = nullptr;
+  unsigned int filled = 0;
+
+  for (unsigned int i = 0; i < size; ++i) {
+    SUFREQ a = freqMin + i * vb - this->freqMin;
+    qint64 ga, gb;
+    SUFLOAT sum = 0;
+    unsigned int n = 0;
+
+    if (count[i * stride] > .5f)
+      continue;
+
+    ga = static_cast<qint64>(std::floor(a / bw));
+    gb = static_cast<qint64>(std::ceil((a + vb) / bw)) - 1;
+
+    if (gb < ga)
+      gb = ga;
+
+    if (ga < 0)
+      ga = 0;
+
+    if (gb >= nBins)
+      gb = nBins - 1;
+
+    for (qint64 g = ga; g <= gb; ++g) {
+      qint64 t = g / SIGDIGGER_TILE_STORE_TILE_BINS;
+      unsigned int b = static_cast<unsigned int>(
+            g % SIGDIGGER_TILE_STORE_TILE_BINS);
+
+      if (t != tileIndex) {
+        tile = this->findTile(level, static_cast<quint64>(t));
+        tileIndex = t;
+      }
+
+      if (tile != nullptr && tile->count[b] > 0) {
+        sum += tile->accum[b] / tile->count[b];
+        ++n;
+      }
+    }
+
+    if (n > 0) {
+      accum[i * stride] = sum / n;
+      count[i * stride] = 1;
+      ++filled;
+    }
+  }
+
+  return filled;
+}
+
+unsigned int
+SpectrumTileStore::render(
+    SUFREQ freqMin,
+    SUFREQ freqMax,
+    SUFLOAT *accum,
+    SUFLOAT *count,
+    unsigned int size,
+    unsigned int stride)
+{
+  unsigned int filled = 0;
+  unsigned int level;
+
+  if (size == 0 || this->tiles.empty() || freqMax <= freqMin)
+    return 0;
+
+  level = this->levelFor((freqMax - freqMin) / size, false);
+
+  // Coarser levels only fill what finer levels could not
+  for (;;) {
+    filled += this->renderLevel(
+          level,
+          freqMin,
+          freqMax,
+          accum,
+          count,
+          size,
+          stride);
+
+    if (filled == size || level == 0)
+      break;
+
+    --level;
+  }
+
+  return filled;
+}
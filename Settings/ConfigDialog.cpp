@@ -26,6 +26,7 @@
 #include <GuiConfigTab.h>
 #include <TLESourceTab.h>
 #include <LocationConfigTab.h>
+#include <ThreadConfigTab.h>
 #include <time.h>
 #include "ConfigDialog.h"
 
@@ -129,6 +130,18 @@ ConfigDialog::getGuiConfig() const
   return this->guiTab->getGuiConfig();
 }
 
+void
+ConfigDialog::setThreadConfig(ThreadConfig const &config)
+{
+  this->threadTab->setThreadConfig(config);
+}
+
+ThreadConfig
+ConfigDialog::getThreadConfig() const
+{
+  return this->threadTab->getThreadConfig();
+}
+
 TLESourceConfig
 ConfigDialog::getTleSourceConfig(void) const
 {
@@ -153,6 +166,12 @@ ConfigDialog::guiChanged(void) const
   return this->guiTab->hasChanged();
 }
 
+bool
+ConfigDialog::threadConfigChanged(void) const
+{
+  return this->threadTab->hasChanged();
+}
+
 bool
 ConfigDialog::tleSourceConfigChanged(void) const
 {
@@ -177,12 +196,6 @@ ConfigDialog::setLocation(Suscan::Location const &loc)
   this->locationTab->setLocation(loc);
 }
 
-bool
-ConfigDialog::sourceNeedsRestart(void) const
-{
-  return this->profileTab->shouldRestart();
-}
-
 bool
 ConfigDialog::run(void)
 {
@@ -220,12 +233,14 @@ ConfigDialog::ConfigDialog(QWidget *parent) :
   this->guiTab       = new GuiConfigTab(this);
   this->locationTab  = new LocationConfigTab(this);
   this->tleSourceTab = new TLESourceTab(this);
+  this->threadTab    = new ThreadConfigTab(this);
 
   this->appendConfigTab(this->profileTab);
   this->appendConfigTab(this->colorTab);
   this->appendConfigTab(this->guiTab);
   this->appendConfigTab(this->tleSourceTab);
   this->appendConfigTab(this->locationTab);
+  this->appendConfigTab(this->threadTab);
 
   this->connectAll();
 }
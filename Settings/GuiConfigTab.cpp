@@ -29,9 +29,27 @@ GuiConfigTab::save()
   this->guiConfig.useGLWaterfall = this->ui->useGLWaterfallCheck->isChecked();
   this->guiConfig.useMaxBlending = this->ui->useMaxBlendingCheck->isChecked();
   this->guiConfig.useGlInWindows = this->ui->useGlWfInWindowsCheck->isChecked();
+  this->guiConfig.useGLConstellation =
+        this->ui->useGLConstellationCheck->isChecked();
+  this->guiConfig.useGLTVDisplay =
+        this->ui->useGLTVDisplayCheck->isChecked();
   this->guiConfig.enableMsgTTL   = this->ui->ttlCheck->isChecked();
   this->guiConfig.msgTTL         = static_cast<unsigned>(
         this->ui->ttlSpin->value());
+  this->guiConfig.enablePsdGovernor = this->ui->governorCheck->isChecked();
+  this->guiConfig.enableLoadGovernor =
+        this->ui->loadGovernorCheck->isChecked();
+  this->guiConfig.matchRemotePsdSize = this->ui->remotePsdCheck->isChecked();
+  this->guiConfig.maxFps         = static_cast<unsigned>(
+        this->ui->fpsSpin->value());
+  this->guiConfig.memoryBudget   = static_cast<unsigned>(
+        this->ui->memoryBudgetSpin->value());
+  this->guiConfig.waterfallSpill = static_cast<unsigned>(
+        this->ui->waterfallSpillSpin->value());
+  this->guiConfig.msgBatchSize   = static_cast<unsigned>(
+        this->ui->batchSizeSpin->value());
+  this->guiConfig.msgBatchDeadline = static_cast<unsigned>(
+        this->ui->batchDeadlineSpin->value());
 }
 
 void
@@ -45,11 +63,27 @@ GuiConfigTab::refreshUi()
   this->ui->useGlWfInWindowsCheck->setEnabled(
         this->ui->useGLWaterfallCheck->isChecked());
   this->ui->useMaxBlendingCheck->setChecked(this->guiConfig.useMaxBlending);
+  this->ui->useGLConstellationCheck->setChecked(
+        this->guiConfig.useGLConstellation);
+  this->ui->useGLTVDisplayCheck->setChecked(
+        this->guiConfig.useGLTVDisplay);
   this->ui->ttlCheck->setChecked(this->guiConfig.enableMsgTTL);
   this->ui->ttlLabel->setEnabled(this->ui->ttlCheck->isChecked());
   this->ui->ttlSpin->setEnabled(this->ui->ttlCheck->isChecked());
   this->ui->ttlSpin->setValue(static_cast<int>(this->guiConfig.msgTTL));
-
+  this->ui->governorCheck->setEnabled(this->ui->ttlCheck->isChecked());
+  this->ui->governorCheck->setChecked(this->guiConfig.enablePsdGovernor);
+  this->ui->loadGovernorCheck->setChecked(this->guiConfig.enableLoadGovernor);
+  this->ui->remotePsdCheck->setChecked(this->guiConfig.matchRemotePsdSize);
+  this->ui->fpsSpin->setValue(static_cast<int>(this->guiConfig.maxFps));
+  this->ui->memoryBudgetSpin->setValue(
+        static_cast<int>(this->guiConfig.memoryBudget));
+  this->ui->waterfallSpillSpin->setValue(
+        static_cast<int>(this->guiConfig.waterfallSpill));
+  this->ui->batchSizeSpin->setValue(
+        static_cast<int>(this->guiConfig.msgBatchSize));
+  this->ui->batchDeadlineSpin->setValue(
+        static_cast<int>(this->guiConfig.msgBatchDeadline));
 }
 
 void
@@ -105,6 +139,18 @@ GuiConfigTab::connectAll(void)
         this,
         SLOT(onConfigChanged(void)));
 
+  connect(
+        this->ui->useGLConstellationCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged(void)));
+
+  connect(
+        this->ui->useGLTVDisplayCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged(void)));
+
   connect(
         this->ui->ttlCheck,
         SIGNAL(toggled(bool)),
@@ -116,6 +162,54 @@ GuiConfigTab::connectAll(void)
         SIGNAL(valueChanged(int)),
         this,
         SLOT(onConfigChanged(void)));
+
+  connect(
+        this->ui->governorCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged(void)));
+
+  connect(
+        this->ui->loadGovernorCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged(void)));
+
+  connect(
+        this->ui->remotePsdCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged(void)));
+
+  connect(
+        this->ui->fpsSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onConfigChanged(void)));
+
+  connect(
+        this->ui->memoryBudgetSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onConfigChanged(void)));
+
+  connect(
+        this->ui->waterfallSpillSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onConfigChanged(void)));
+
+  connect(
+        this->ui->batchSizeSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onConfigChanged(void)));
+
+  connect(
+        this->ui->batchDeadlineSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onConfigChanged(void)));
 }
 
 GuiConfigTab::GuiConfigTab(QWidget *parent) :
@@ -143,6 +237,7 @@ GuiConfigTab::onConfigChanged(void)
 
   this->ui->ttlLabel->setEnabled(this->ui->ttlCheck->isChecked());
   this->ui->ttlSpin->setEnabled(this->ui->ttlCheck->isChecked());
+  this->ui->governorCheck->setEnabled(this->ui->ttlCheck->isChecked());
 
   this->modified = true;
   emit changed();
@@ -17,6 +17,7 @@
 //    <http://www.gnu.org/licenses/>
 //
 #include "LocationConfigTab.h"
+#include "LocationListModel.h"
 #include "ui_LocationConfigTab.h"
 #include <Suscan/Library.h>
 #include <QPainter>
@@ -28,10 +29,10 @@ void
 LocationConfigTab::connectAll(void)
 {
   connect(
-        this->ui->cityListWidget,
-        SIGNAL(itemDoubleClicked(QListWidgetItem *)),
+        this->ui->cityListView,
+        SIGNAL(doubleClicked(QModelIndex const &)),
         this,
-        SLOT(onLocationSelected(QListWidgetItem *)));
+        SLOT(onLocationSelected(QModelIndex const &)));
 
   connect(
         this->ui->cityNameEdit,
@@ -79,17 +80,7 @@ LocationConfigTab::connectAll(void)
 void
 LocationConfigTab::repaintCountryList(QString searchText)
 {
-  Suscan::Singleton *sus = Suscan::Singleton::get_instance();
-
-  this->ui->cityListWidget->clear();
-
-  for (auto i = sus->getFirstLocation(); i != sus->getLastLocation(); ++i) {
-    QString locName = i->getLocationName();
-    if (locName.contains(searchText, Qt::CaseInsensitive)) {
-      QListWidgetItem *item = new QListWidgetItem(locName);
-      this->ui->cityListWidget->addItem(item);
-    }
-  }
+  this->locationModel->setFilter(searchText);
 }
 
 void
@@ -98,10 +89,11 @@ LocationConfigTab::populateLocations(void)
   Suscan::Singleton *sus = Suscan::Singleton::get_instance();
   int index = 0;
 
+  this->locationModel = new LocationListModel(this);
+  this->ui->cityListView->setModel(this->locationModel);
+
   for (auto i = sus->getFirstLocation(); i != sus->getLastLocation(); ++i) {
     QString country;
-    QListWidgetItem *item = new QListWidgetItem(i->getLocationName());
-    this->ui->cityListWidget->addItem(item);
 
     country = QString::fromStdString(i->country);
 
@@ -218,13 +210,14 @@ LocationConfigTab::~LocationConfigTab()
 
 //////////////////////////////// Slots /////////////////////////////////////////
 void
-LocationConfigTab::onLocationSelected(QListWidgetItem *item)
+LocationConfigTab::onLocationSelected(QModelIndex const &index)
 {
-  QString fullName = item->text();
-  auto locMap = Suscan::Singleton::get_instance()->getLocationMap();
+  QString fullName = this->locationModel->nameAt(index.row());
+  auto const &locMap = Suscan::Singleton::get_instance()->getLocationMap();
+  auto it = locMap.find(fullName);
 
-  if (locMap.find(fullName) != locMap.end()) {
-    auto loc = locMap[fullName];
+  if (it != locMap.end()) {
+    auto const &loc = *it;
     QString country = QString::fromStdString(loc.country);
     int index = -1;
 
@@ -260,7 +253,7 @@ LocationConfigTab::onRegisterLocation(void)
 {
   Suscan::Location loc;
   auto sus = Suscan::Singleton::get_instance();
-  auto locMap = Suscan::Singleton::get_instance()->getLocationMap();
+  auto const &locMap = Suscan::Singleton::get_instance()->getLocationMap();
 
 
   loc.name        = this->ui->cityNameEdit->text().toStdString();
@@ -279,8 +272,7 @@ LocationConfigTab::onRegisterLocation(void)
           + " already exists. Please choose a different name.");
   } else {
     sus->registerLocation(loc);
-    QListWidgetItem *item = new QListWidgetItem(loc.getLocationName());
-    this->ui->cityListWidget->addItem(item);
-    this->ui->cityListWidget->scrollToBottom();
+    this->locationModel->append(locName);
+    this->ui->cityListView->scrollToBottom();
   }
 }
@@ -19,6 +19,7 @@
 
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QSignalBlocker>
 
 #include <Suscan/Library.h>
 #include <SuWidgetsHelpers.h>
@@ -36,19 +37,12 @@ using namespace SigDigger;
 Q_DECLARE_METATYPE(Suscan::Source::Config); // Unicorns
 Q_DECLARE_METATYPE(Suscan::Source::Device); // More unicorns
 
-
-// TODO:
-// hasChanged and shouldRestart is based on the idea that the modification
-// of certain fields can be used as a hint to whether we should restart
-// the source or not. This can be done better: just add a Source::Config
-// method that compares two source configs, and determines whether it
-// makes sense to restart certain things or not.
-
+// Whether the changes need a restart is decided by the mediator, which
+// compares the new profile against the current one
 void
-ProfileConfigTab::configChanged(bool restart)
+ProfileConfigTab::configChanged(void)
 {
-  this->modified     = true;
-  this->needsRestart = this->needsRestart || restart;
+  this->modified = true;
   emit changed();
 }
 
@@ -85,54 +79,84 @@ ProfileConfigTab::populateProfileCombo(void)
         QVariant::fromValue(i->second));
 }
 
+// Brings the combo to the sorted item list with the fewest insertions
+// and removals. Surviving items (hence the selection) are left alone.
+static void
+syncComboItems(
+    QComboBox *combo,
+    QList<QPair<QString, QVariant>> const &items)
+{
+  QSignalBlocker blocker(combo);
+  int i = 0;
+
+  for (auto const &item : items) {
+    int found = -1;
+
+    for (int j = i; j < combo->count(); ++j) {
+      if (combo->itemText(j) == item.first) {
+        found = j;
+        break;
+      }
+    }
+
+    if (found == -1) {
+      combo->insertItem(i, item.first, item.second);
+    } else {
+      while (found-- > i)
+        combo->removeItem(i);
+      if (combo->itemData(i) != item.second)
+        combo->setItemData(i, item.second);
+    }
+
+    ++i;
+  }
+
+  while (combo->count() > i)
+    combo->removeItem(i);
+}
+
 void
 ProfileConfigTab::populateDeviceCombo(void)
 {
   Suscan::Singleton *sus = Suscan::Singleton::get_instance();
-  int currentIndex = this->ui->deviceCombo->currentIndex();
-  int newIndex = -1;
-  int p = 0;
-  QString prevName, name;
-
-  if (currentIndex != -1)
-    prevName = this->ui->deviceCombo->currentText();
-
-  this->ui->deviceCombo->clear();
-
-  for (auto i = sus->getFirstDevice(); i != sus->getLastDevice(); ++i) {
-    if (i->isAvailable() && !i->isRemote()) {
-      name = QString::fromStdString(i->getDesc());
-      if (currentIndex != -1 && newIndex == -1 && name == prevName)
-        newIndex = p;
-
-      this->ui->deviceCombo->addItem(
-          name,
-          QVariant::fromValue<long>(i - sus->getFirstDevice()));
-      ++p;
-    }
-  }
+  QList<QPair<QString, QVariant>> items;
+
+  if (sus->getDeviceRevision() == this->deviceRevision)
+    return;
+
+  for (auto i = sus->getFirstDevice(); i != sus->getLastDevice(); ++i)
+    if (i->isAvailable() && !i->isRemote())
+      items.append(
+            qMakePair(
+              QString::fromStdString(i->getDesc()),
+              QVariant::fromValue<long>(i - sus->getFirstDevice())));
+
+  syncComboItems(this->ui->deviceCombo, items);
 
-  if (newIndex == -1)
-    newIndex = 0;
+  if (this->ui->deviceCombo->currentIndex() == -1)
+    this->ui->deviceCombo->setCurrentIndex(0);
 
-  this->ui->deviceCombo->setCurrentIndex(newIndex);
+  this->deviceRevision = sus->getDeviceRevision();
 }
 
 void
 ProfileConfigTab::populateRemoteDeviceCombo(void)
 {
   Suscan::Singleton *sus = Suscan::Singleton::get_instance();
+  QList<QPair<QString, QVariant>> items;
 
-  this->ui->remoteDeviceCombo->clear();
+  if (sus->getNetworkProfileRevision() == this->networkProfileRevision)
+    return;
 
   for (
        auto i = sus->getFirstNetworkProfile();
        i != sus->getLastNetworkProfile();
        ++i)
-    this->ui->remoteDeviceCombo->addItem(i->label().c_str());
+    items.append(qMakePair(i.key(), QVariant()));
 
-  if (this->ui->remoteDeviceCombo->currentIndex() != -1)
-    this->ui->remoteDeviceCombo->setCurrentIndex(0);
+  syncComboItems(this->ui->remoteDeviceCombo, items);
+
+  this->networkProfileRevision = sus->getNetworkProfileRevision();
 }
 
 
@@ -474,7 +498,6 @@ void
 ProfileConfigTab::save()
 {
   bool modified = this->modified;
-  bool needsRestart = this->needsRestart;
 
   this->profile.setType(
         this->ui->sdrRadio->isChecked()
@@ -492,15 +515,13 @@ ProfileConfigTab::save()
   if (!this->hasTweaks)
     this->onAnalyzerTypeChanged(this->ui->analyzerTypeCombo->currentIndex());
 
-  this->modified     = modified;
-  this->needsRestart = needsRestart;
+  this->modified = modified;
 }
 
 void
 ProfileConfigTab::setUnchanged(void)
 {
-  this->modified     = false;
-  this->needsRestart = false;
+  this->modified = false;
 }
 
 bool
@@ -509,12 +530,6 @@ ProfileConfigTab::hasChanged(void) const
   return this->modified;
 }
 
-bool
-ProfileConfigTab::shouldRestart(void) const
-{
-  return this->needsRestart;
-}
-
 void
 ProfileConfigTab::connectAll(void)
 {
@@ -850,7 +865,7 @@ ProfileConfigTab::onLoadProfileClicked(void)
   QVariant data = this->ui->profileCombo->itemData(this->ui->profileCombo->currentIndex());
 
   if (this->shouldDisregardTweaks()) {
-    this->configChanged(true);
+    this->configChanged();
     this->profile = data.value<Suscan::Source::Config>();
   }
 
@@ -861,7 +876,7 @@ void
 ProfileConfigTab::onToggleSourceType(bool)
 {
   if (!this->refreshing) {
-    this->configChanged(true);
+    this->configChanged();
     if (this->ui->sdrRadio->isChecked()) {
       this->profile.setType(SUSCAN_SOURCE_TYPE_SDR);
     } else {
@@ -894,7 +909,7 @@ ProfileConfigTab::onDeviceChanged(int index)
             static_cast<unsigned int>(
             this->ui->deviceCombo->itemData(index).value<long>())));
 
-    this->configChanged(true);
+    this->configChanged();
     this->profile.setDevice(*device);
     this->hasTweaks = false;
 
@@ -923,7 +938,7 @@ void
 ProfileConfigTab::onFormatChanged(int index)
 {
   if (!this->refreshing) {
-    this->configChanged(true);
+    this->configChanged();
     switch (index) {
       case 0:
         this->profile.setFormat(SUSCAN_SOURCE_FORMAT_AUTO);
@@ -994,7 +1009,7 @@ ProfileConfigTab::onRemoteParamsChanged(void)
 {
   if (this->remoteSelected()) {
     this->ui->mcInterfaceEdit->setEnabled(this->ui->mcCheck->isChecked());
-    this->configChanged(true);
+    this->configChanged();
     this->profile.setDevice(this->remoteDevice);
     this->updateRemoteParams();
   }
@@ -1016,7 +1031,7 @@ ProfileConfigTab::onCheckButtonsToggled(bool)
 
     if (this->profile.getLoop() != this->ui->loopCheck->isChecked()) {
       this->profile.setLoop(this->ui->loopCheck->isChecked());
-      this->configChanged(true);
+      this->configChanged();
     }
   }
 }
@@ -1101,13 +1116,13 @@ ProfileConfigTab::onSpinsChanged(void)
 
     if (this->profile.getSampleRate() != sampRate) {
       this->profile.setSampleRate(sampRate);
-      this->configChanged(true);
+      this->configChanged();
       adjustBandwidth = true;
     }
 
     if (this->profile.getDecimation() != decimation) {
       this->profile.setDecimation(decimation);
-      this->configChanged(true);
+      this->configChanged();
       adjustBandwidth = true;
     }
 
@@ -1122,7 +1137,7 @@ ProfileConfigTab::onSpinsChanged(void)
       tv.tv_sec  = timeStamp;
       tv.tv_usec = timeStampUsec;
       this->profile.setStartTime(tv);
-      this->configChanged(true);
+      this->configChanged();
     }
 
     if (adjustBandwidth && this->profile.getBandwidth() > maxBandwidth)
@@ -1146,130 +1161,7 @@ ProfileConfigTab::onBandwidthChanged(double)
 void
 ProfileConfigTab::guessParamsFromFileName(void)
 {
-  QFileInfo fi(QString::fromStdString(this->profile.getPath()));
-  std::string baseName = fi.baseName().toStdString();
-  SigDiggerHelpers *hlp = SigDiggerHelpers::instance();
-
-  SUFREQ fc;
-  unsigned int fs;
-  unsigned int date, time;
-  bool haveFc   = false;
-  bool haveFs   = false;
-  bool haveDate = false;
-  bool haveTime = false;
-  bool isUTC    = false;
-  bool haveTm   = false;
-  struct tm tm;
-  struct timeval tv = {0, 0};
-
-  memset(&tm, 0, sizeof(struct tm));
-
-  if (sscanf(
-        baseName.c_str(),
-        "sigdigger_%08d_%06dZ_%d_%lg_float32_iq",
-        &date,
-        &time,
-        &fs,
-        &fc) == 4) {
-    haveFc   = true;
-    haveFs   = true;
-    haveDate = true;
-    haveTime = true;
-    isUTC    = true;
-  } else if (sscanf(
-        baseName.c_str(),
-        "sigdigger_%d_%lg_float32_iq",
-        &fs,
-        &fc) == 2) {
-    haveFc = true;
-    haveFs = true;
-  } else if (sscanf(
-        baseName.c_str(),
-        "gqrx_%08d_%06d_%lg_%d_fc",
-        &date,
-        &time,
-        &fc,
-        &fs) == 4) {
-    haveFc   = true;
-    haveFs   = true;
-    haveDate = true;
-    haveTime = true;
-  } else if (sscanf(
-        baseName.c_str(),
-        "SDRSharp_%08d_%06dZ_%lg_IQ",
-        &date,
-        &time,
-        &fc) == 3) {
-    haveFc   = true;
-    haveDate = true;
-    haveTime = true;
-  } else if (sscanf(
-        baseName.c_str(),
-        "HDSDR_%08d_%06dZ_%lgkHz",
-        &date,
-        &time,
-        &fc) == 3) {
-    fc      *= 1e3;
-    haveFc   = true;
-    haveDate = true;
-    haveTime = true;
-    isUTC    = true;
-  } else if (sscanf(
-        baseName.c_str(),
-        "baseband_%lgHz_%02d-%02d-%02d_%02d-%02d-%04d",
-        &fc,
-        &tm.tm_hour,
-        &tm.tm_min,
-        &tm.tm_sec,
-        &tm.tm_mday,
-        &tm.tm_mon,
-        &tm.tm_year) == 7) {
-    tm.tm_year -= 1900;
-    tm.tm_mon  -= 1;
-
-    haveFc   = true;
-    haveTm   = true;
-    isUTC    = true;
-  }
-
-  if (haveDate || haveTime) {
-    haveTm = true;
-    if (haveDate) {
-      tm.tm_year = date / 10000 - 1900;
-      tm.tm_mon  = ((date / 100) % 100) - 1;
-      tm.tm_mday = date % 100;
-    }
-
-    if (haveTime) {
-      tm.tm_hour = time / 10000;
-      tm.tm_min  = (time / 100) % 100;
-      tm.tm_sec  = time % 100;
-    }
-  }
-
-  if (haveTm) {
-    if (isUTC) {
-      hlp->pushUTCTZ();
-      tm.tm_isdst = 0;
-      tv.tv_sec = mktime(&tm);
-    } else {
-      hlp->pushLocalTZ();
-      tm.tm_isdst = -1;
-      tv.tv_sec = mktime(&tm);
-    }
-
-    hlp->popTZ();
-
-    this->profile.setStartTime(tv);
-  }
-
-  if (haveFs)
-    this->profile.setSampleRate(fs);
-
-  if (haveFc)
-    this->profile.setFreq(fc);
-
-  if (haveFs || haveFc || haveTm)
+  if (SigDiggerHelpers::instance()->guessCaptureParams(this->profile))
     this->refreshUi();
 }
 
@@ -1342,7 +1234,7 @@ ProfileConfigTab::onBrowseCaptureFile(void)
 
   if (!path.isEmpty()) {
     this->ui->pathEdit->setText(path);
-    this->configChanged(true);
+    this->configChanged();
     this->profile.setPath(path.toStdString());
     this->guessParamsFromFileName();
   }
@@ -1394,7 +1286,7 @@ ProfileConfigTab::onChangeConnectionType(void)
     this->ui->useNetworkProfileRadio->setChecked(false);
   }
 
-  this->configChanged(true);
+  this->configChanged();
   this->refreshUiState();
 }
 
@@ -1448,7 +1340,7 @@ ProfileConfigTab::onRemoteProfileSelected(void)
       if (pass.length() == 0)
         pass = this->ui->passEdit->text().toStdString();
 
-      this->configChanged(true);
+      this->configChanged();
       this->setProfile(*it);
 
       // Provide a better hint for username if the server announced none
@@ -1494,7 +1386,7 @@ ProfileConfigTab::onDeviceTweaksAccepted(void)
 {
   if (this->tweaks->hasChanged()) {
     this->tweaks->commitConfig();
-    this->configChanged(true);
+    this->configChanged();
     this->hasTweaks = true;
   }
 }
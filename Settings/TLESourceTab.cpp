@@ -166,14 +166,12 @@ TLESourceTab::triggerDownloadTLEs(void)
 {
   auto sus = Suscan::Singleton::get_instance();
 
-  this->currSrc = sus->getFirstTLESource();
-  this->endSrc  = sus->getLastTLESource();
-
-  if (this->currSrc != this->endSrc) {
-    this->srcNum    = 1;
-    this->srcFailed = 0;
-    this->srcCount  = static_cast<unsigned>(sus->getTLESourceMap().count());
-    this->pushDownloadTask();
+  this->srcCount     = static_cast<unsigned>(sus->getTLESourceMap().count());
+  this->srcUpdated   = 0;
+  this->srcUnchanged = 0;
+  this->srcFailed    = 0;
+
+  if (this->srcCount > 0 && this->pushDownloadTask()) {
     this->refreshDownloadStatus();
     this->ui->downloadProgress->setFormat("Starting update...");
     this->ui->downloadProgress->setValue(0);
@@ -191,39 +189,30 @@ TLESourceTab::triggerDownloadTLEs(void)
 }
 
 void
-TLESourceTab::downloadNext(void)
+TLESourceTab::finishDownload(void)
 {
-  if (this->currSrc != this->endSrc)
-    ++this->currSrc;
-
-  if (this->currSrc != this->endSrc) {
-    ++this->srcNum;
-    this->pushDownloadTask();
-    this->refreshDownloadStatus();
-    this->ui->downloadProgress->setFormat("Connecting to next server");
-    this->ui->downloadProgress->setValue(0);
-    this->downloading = true;
+  if (this->srcFailed == this->srcCount) {
+    this->ui->downloadStatusLabel->setText("All TLE sources failed to download");
   } else {
-    if (this->srcFailed == this->srcCount) {
-      this->ui->downloadStatusLabel->setText("All TLE sources failed to download");
-    } else if (this->srcFailed > 0) {
-      this->ui->downloadStatusLabel->setText(
-            QString::number(this->srcNum - this->srcFailed) +
-            " of " + QString::number(this->srcCount) +
-            " sources updated, " + QString::number(this->srcFailed) + " failed");
-    } else {
-      this->ui->downloadStatusLabel->setText(
-            QString::number(this->srcNum) +
-            " of " + QString::number(this->srcCount) +
-            " sources updated");
-    }
+    QString status =
+        QString::number(this->srcUpdated) +
+        " of " + QString::number(this->srcCount) +
+        " sources updated";
 
-    this->ui->downloadProgress->setFormat("%p%");
-    this->ui->downloadProgress->setValue(0);
-    this->ui->downloadProgress->setEnabled(false);
-    this->downloading = false;
+    if (this->srcUnchanged > 0)
+      status += ", " + QString::number(this->srcUnchanged) + " unchanged";
+
+    if (this->srcFailed > 0)
+      status += ", " + QString::number(this->srcFailed) + " failed";
+
+    this->ui->downloadStatusLabel->setText(status);
   }
 
+  this->ui->downloadProgress->setFormat("%p%");
+  this->ui->downloadProgress->setValue(0);
+  this->ui->downloadProgress->setEnabled(false);
+  this->downloading = false;
+
   this->refreshUi();
 }
 
@@ -231,11 +220,10 @@ bool
 TLESourceTab::pushDownloadTask(void)
 {
 #ifdef HAVE_CURL
+  auto sus = Suscan::Singleton::get_instance();
   TLEDownloaderTask *task = new TLEDownloaderTask(
-        QString::fromStdString(this->currSrc->url));
-  this->taskController->process(
-        "Download TLEs (" + QString::fromStdString(this->currSrc->name) + ")",
-        task);
+        sus->getTLESourceMap().values());
+  this->taskController->process("Download TLEs", task);
   return true;
 #else  // HAVE_CURL
   QMessageBox::critical(
@@ -249,19 +237,10 @@ TLESourceTab::pushDownloadTask(void)
 void
 TLESourceTab::refreshDownloadStatus(void)
 {
-  if (this->srcFailed > 0) {
-    this->ui->downloadStatusLabel->setText(
-          "Downloading " + QString::number(this->srcNum) +
-          " of " + QString::number(this->srcCount) +
-          " (" + QString::fromStdString(this->currSrc->name) + "), " +
-          QString::number(this->srcFailed) + " failed");
-  } else {
-    this->ui->downloadStatusLabel->setText(
-          "Downloading " + QString::number(this->srcNum) +
-          " of " + QString::number(this->srcCount) +
-          " (" + QString::fromStdString(this->currSrc->name) + ")");
-  }
+  this->ui->downloadStatusLabel->setText(
+        "Downloading " + QString::number(this->srcCount) + " sources");
 }
+
 TLESourceTab::TLESourceTab(QWidget *parent) :
   ConfigTab(parent, "TLE Sources"),
   ui(new Ui::TLESourceTab)
@@ -381,7 +360,19 @@ TLESourceTab::onTaskProgress(qreal progress, QString string)
 void
 TLESourceTab::onTaskDone(void)
 {
-  this->downloadNext();
+#ifdef HAVE_CURL
+  // Still alive while done() is being delivered
+  auto task = static_cast<const TLEDownloaderTask *>(
+        this->taskController->getTask());
+
+  if (task != nullptr) {
+    this->srcUpdated   = task->getUpdated();
+    this->srcUnchanged = task->getUnchanged();
+    this->srcFailed    = task->getFailed();
+  }
+#endif // HAVE_CURL
+
+  this->finishDownload();
 }
 
 void
@@ -399,6 +390,8 @@ TLESourceTab::onTaskCancelled(void)
 void
 TLESourceTab::onTaskError(QString)
 {
-  ++this->srcFailed;
-  this->downloadNext();
+  this->srcUpdated   = 0;
+  this->srcUnchanged = 0;
+  this->srcFailed    = this->srcCount;
+  this->finishDownload();
 }
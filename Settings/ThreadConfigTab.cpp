@@ -0,0 +1,123 @@
+//
+//    ThreadConfigTab.cpp: Thread placement settings tab
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "ThreadConfigTab.h"
+#include "ui_ThreadConfigTab.h"
+#include <QRegularExpressionValidator>
+#include <QLineEdit>
+#include <QSpinBox>
+
+using namespace SigDigger;
+
+void
+ThreadConfigTab::save()
+{
+  for (int i = 0; i < THREAD_ROLE_COUNT; ++i) {
+    this->threadConfig.roles[i].cpus =
+        this->cpusEdits[i]->text().trimmed().toStdString();
+    this->threadConfig.roles[i].priority = this->prioritySpins[i]->value();
+  }
+}
+
+void
+ThreadConfigTab::refreshUi()
+{
+  for (int i = 0; i < THREAD_ROLE_COUNT; ++i) {
+    this->cpusEdits[i]->setText(
+          QString::fromStdString(this->threadConfig.roles[i].cpus));
+    this->prioritySpins[i]->setValue(this->threadConfig.roles[i].priority);
+  }
+}
+
+void
+ThreadConfigTab::setThreadConfig(ThreadConfig const &config)
+{
+  this->threadConfig = config;
+  this->refreshUi();
+  this->modified = false;
+}
+
+ThreadConfig
+ThreadConfigTab::getThreadConfig(void) const
+{
+  return this->threadConfig;
+}
+
+bool
+ThreadConfigTab::hasChanged(void) const
+{
+  return this->modified;
+}
+
+void
+ThreadConfigTab::connectAll(void)
+{
+  for (int i = 0; i < THREAD_ROLE_COUNT; ++i) {
+    connect(
+          this->cpusEdits[i],
+          SIGNAL(textEdited(QString)),
+          this,
+          SLOT(onConfigChanged(void)));
+
+    connect(
+          this->prioritySpins[i],
+          SIGNAL(valueChanged(int)),
+          this,
+          SLOT(onConfigChanged(void)));
+  }
+}
+
+ThreadConfigTab::ThreadConfigTab(QWidget *parent) :
+  ConfigTab(parent, "Threads"),
+  ui(new Ui::ThreadConfigTab)
+{
+  ui->setupUi(this);
+
+  this->cpusEdits[THREAD_ROLE_ANALYZER]     = this->ui->analyzerCpusEdit;
+  this->cpusEdits[THREAD_ROLE_AUDIO]        = this->ui->audioCpusEdit;
+  this->cpusEdits[THREAD_ROLE_IO]           = this->ui->ioCpusEdit;
+  this->cpusEdits[THREAD_ROLE_DSP]          = this->ui->dspCpusEdit;
+  this->cpusEdits[THREAD_ROLE_TASKS]        = this->ui->tasksCpusEdit;
+
+  this->prioritySpins[THREAD_ROLE_ANALYZER] = this->ui->analyzerPrioritySpin;
+  this->prioritySpins[THREAD_ROLE_AUDIO]    = this->ui->audioPrioritySpin;
+  this->prioritySpins[THREAD_ROLE_IO]       = this->ui->ioPrioritySpin;
+  this->prioritySpins[THREAD_ROLE_DSP]      = this->ui->dspPrioritySpin;
+  this->prioritySpins[THREAD_ROLE_TASKS]    = this->ui->tasksPrioritySpin;
+
+  for (auto p : this->cpusEdits)
+    p->setValidator(
+          new QRegularExpressionValidator(
+            QRegularExpression("^(\\d+(-\\d+)?)(,\\d+(-\\d+)?)*$|^$"),
+            p));
+
+  this->connectAll();
+}
+
+ThreadConfigTab::~ThreadConfigTab()
+{
+  delete ui;
+}
+
+////////////////////////////////// Slots ///////////////////////////////////////
+void
+ThreadConfigTab::onConfigChanged(void)
+{
+  this->modified = true;
+  emit changed();
+}
@@ -50,6 +50,10 @@ target.path=$$PREFIX/bin
   QMAKE_CXXFLAGS += "-DSIGDIGGER_PKGVERSION='\""$$PKGVERSION"\"'"
 }
 
+# Where the benchmark modes keep their results between runs
+isEmpty(BENCHMARK_HISTORY): BENCHMARK_HISTORY = $$PWD/benchmarks
+QMAKE_CXXFLAGS += "-DSIGDIGGER_BENCHMARK_HISTORY_DIR='\""$$BENCHMARK_HISTORY"\"'"
+
 darwin: ICON = icons/SigDigger.icns
 darwin: QMAKE_RPATHDIR += $$SUWIDGETS_INSTALL_LIBS
 datwin: QMAKE_RPATHDIR += /usr/local/lib
@@ -72,6 +76,8 @@ SOURCES += \
     App/GuiConfig.cpp \
     App/Loader.cpp \
     App/TLESourceConfig.cpp \
+    App/ThreadConfig.cpp \
+    Audio/AudioDspFactory.cpp \
     Audio/AudioFileSaver.cpp \
     Audio/AudioPlayback.cpp \
     Audio/GenericAudioPlayer.cpp \
@@ -81,6 +87,8 @@ SOURCES += \
     Components/DeviceGain.cpp \
     Components/DeviceTweaks.cpp \
     Components/DopplerDialog.cpp \
+    Components/SpectrogramDialog.cpp \
+    Components/CyclicSpectrumDialog.cpp \
     Components/FrequencyCorrectionDialog.cpp \
     Components/GainSlider.cpp \
     Components/GenericDataSaverUI.cpp \
@@ -96,13 +104,23 @@ SOURCES += \
     Default/Audio/AudioProcessor.cpp \
     Default/Audio/AudioWidget.cpp \
     Default/Audio/AudioWidgetFactory.cpp \
+    Default/Audio/ChannelScanner.cpp \
     Default/DefaultTab/DefaultTabWidget.cpp \
     Default/DefaultTab/DefaultTabWidgetFactory.cpp \
+    Default/Detector/DetectorWidget.cpp \
+    Default/Detector/DetectorWidgetFactory.cpp \
     Default/FFT/FFTWidget.cpp \
     Default/FFT/FFTWidgetFactory.cpp \
+    Default/Occupancy/OccupancyWidget.cpp \
+    Default/Occupancy/OccupancyWidgetFactory.cpp \
     Default/GenericInspector/FACTab.cpp \
+    Default/GenericInspector/FACWorker.cpp \
     Default/GenericInspector/GenericInspector.cpp \
     Default/GenericInspector/GenericInspectorFactory.cpp \
+    Default/GenericInspector/GLConstellation.cpp \
+    Default/GenericInspector/GLTVDisplay.cpp \
+    Default/GenericInspector/InspectorDataWorker.cpp \
+    Default/GenericInspector/SNREstimatorWorker.cpp \
     Default/GenericInspector/InspectorCtl/AfcControl.cpp \
     Default/GenericInspector/InspectorCtl/AskControl.cpp \
     Default/GenericInspector/InspectorCtl/ClockRecovery.cpp \
@@ -122,11 +140,47 @@ SOURCES += \
     Default/Registration.cpp \
     Default/Source/SourceWidget.cpp \
     Default/Source/SourceWidgetFactory.cpp \
+    Default/ZoomSpectrum/ZoomSpectrum.cpp \
+    Default/ZoomSpectrum/ZoomSpectrumFactory.cpp \
+    Default/RemoteControl/RemoteControl.cpp \
+    Default/RemoteControl/RemoteControlFactory.cpp \
     Misc/AutoGain.cpp \
     Misc/Averager.cpp \
+    Misc/CaptureReader.cpp \
+    Misc/FFTPlanCache.cpp \
+    Misc/OccupancyAccumulator.cpp \
+    Misc/OrbitTracker.cpp \
     Misc/Palette.cpp \
+    Misc/CatalogPredictor.cpp \
+    Misc/PassPredictor.cpp \
+    Misc/BenchmarkHistory.cpp \
+    Misc/PipelineBenchmark.cpp \
+    Misc/SessionDaemon.cpp \
+    Misc/SessionSnapshot.cpp \
+    Misc/ShutdownWatchdog.cpp \
+    Misc/PSDPyramid.cpp \
+    Misc/RenderScheduler.cpp \
+    Misc/MemoryAccountant.cpp \
+    Misc/MultiStreamSaver.cpp \
+    Misc/HugePages.cpp \
+    Misc/InstanceServer.cpp \
+    Misc/LoadGovernor.cpp \
+    Misc/ThreadPolicy.cpp \
+    Misc/WaterfallHistory.cpp \
+    Misc/SampleStore.cpp \
+    Misc/SampleStatistics.cpp \
+    Misc/SymbolStore.cpp \
+    Misc/TaskBenchmark.cpp \
+    Misc/Tracer.cpp \
+    Misc/TransformHistory.cpp \
+    Misc/SampleKernels.cpp \
+    Misc/DecisionBlock.cpp \
+    Misc/SymbolPacker.cpp \
+    Misc/ScratchArena.cpp \
+    Misc/HistogramAccumulator.cpp \
     Misc/SNREstimator.cpp \
     Misc/SigDiggerHelpers.cpp \
+    Misc/SignalDetector.cpp \
     Settings/ColorConfigTab.cpp \
     Settings/ConfigDialog.cpp \
     Settings/ConfigTab.cpp \
@@ -134,8 +188,10 @@ SOURCES += \
     Settings/LocationConfigTab.cpp \
     Settings/ProfileConfigTab.cpp \
     Settings/TLESourceTab.cpp \
+    Settings/ThreadConfigTab.cpp \
     Suscan/AnalyzerRequestTracker.cpp \
     Suscan/CancellableTask.cpp \
+    Suscan/ChunkedTask.cpp \
     Suscan/FeatureFactory.cpp \
     Suscan/Messages/ChannelMessage.cpp \
     Suscan/Messages/GenericMessage.cpp \
@@ -143,8 +199,10 @@ SOURCES += \
     Suscan/Messages/PSDMessage.cpp \
     Suscan/Messages/SamplesMessage.cpp \
     Suscan/Analyzer.cpp \
+    Suscan/AnalyzerStats.cpp \
     Suscan/AnalyzerParams.cpp \
     Suscan/Config.cpp \
+    Suscan/ConfigCache.cpp \
     Suscan/Exception.cpp \
     Suscan/Library.cpp \
     Suscan/Logger.cpp \
@@ -153,20 +211,35 @@ SOURCES += \
     Suscan/Messages/SourceInfoMessage.cpp \
     Suscan/Messages/StatusMessage.cpp \
     Suscan/MultitaskController.cpp \
+    Suscan/TaskPool.cpp \
     Suscan/Object.cpp \
     Suscan/Plugin.cpp \
+    Suscan/BaseBandTap.cpp \
+    Suscan/SampleConsumerFactory.cpp \
     Suscan/Serializable.cpp \
     Suscan/Source.cpp \
     Tasks/AGCTask.cpp \
+    Tasks/BatchTransformTask.cpp \
+    Tasks/BookmarkImportTask.cpp \
+    Tasks/BaudEstimatorTask.cpp \
     Tasks/CarrierDetector.cpp \
+    Tasks/RecordingOverviewTask.cpp \
     Tasks/CarrierXlator.cpp \
+    Tasks/ChannelExtractTask.cpp \
+    Tasks/LoadCaptureTask.cpp \
+    Tasks/SpectrogramTask.cpp \
     Tasks/CostasRecoveryTask.cpp \
+    Tasks/CyclicSpectrumTask.cpp \
     Tasks/DelayedConjTask.cpp \
     Tasks/DopplerCalculator.cpp \
     Tasks/HistogramFeeder.cpp \
     Tasks/LPFTask.cpp \
     Tasks/PLLSyncTask.cpp \
     Tasks/QuadDemodTask.cpp \
+    Tasks/RecoverySweepTask.cpp \
+    Tasks/TransformChainTask.cpp \
+    Tasks/TransformReplayTask.cpp \
+    Tasks/WaterfallExportTask.cpp \
     Tasks/WaveSampler.cpp \
     UIComponent/InspectionWidgetFactory.cpp \
     UIComponent/TabWidgetFactory.cpp \
@@ -174,29 +247,46 @@ SOURCES += \
     UIComponent/UIComponentFactory.cpp \
     UIComponent/UIListenerFactory.cpp \
     UIMediator/InspectorMediator.cpp \
+    UIMediator/SessionMediator.cpp \
     UIMediator/PanoramicDialogMediator.cpp \
     UIMediator/SpectrumMediator.cpp \
     UIMediator/TimeSliderMediator.cpp \
     UIMediator/UIMediator.cpp \
     main.cpp \
     Misc/GenericDataSaver.cpp \
+    Misc/RecordingTrigger.cpp \
+    Misc/RMSHistory.cpp \
+    Misc/RMSIngestor.cpp \
+    Misc/QuantizedDataSaver.cpp \
+    Misc/QuantizedIQ.cpp \
+    Misc/SegmentedCaptureReader.cpp \
+    Misc/SegmentedDataSaver.cpp \
+    Misc/AsyncIOBackend.cpp \
     Misc/FileDataSaver.cpp \
     UDP/SocketForwarder.cpp \
     Components/NetForwarderUI.cpp \
     Components/WaitingSpinnerWidget.cpp \
     Components/DeviceDialog.cpp \
     UIMediator/DeviceDialogMediator.cpp \
+    UIMediator/DialogMediator.cpp \
     Components/PanoramicDialog.cpp \
     Panoramic/Scanner.cpp \
+    Panoramic/PanoramicRecorder.cpp \
+    Panoramic/PanoramicRelay.cpp \
+    Panoramic/SpectrumTileStore.cpp \
     Components/RMSViewer.cpp \
     Components/RMSViewTab.cpp \
     Components/RMSViewerSettingsDialog.cpp \
     Components/LogDialog.cpp \
+    Components/DiagnosticsDialog.cpp \
     Misc/MultitaskControllerModel.cpp \
     Components/BackgroundTasksDialog.cpp \
     Tasks/ExportSamplesTask.cpp \
     Components/AddBookmarkDialog.cpp \
+    Misc/BlockNCO.cpp \
     Misc/BookmarkTableModel.cpp \
+    Misc/LocationListModel.cpp \
+    Misc/CaptureFile.cpp \
     Components/BookmarkManagerDialog.cpp \
     Misc/TableDelegates.cpp
 
@@ -204,26 +294,65 @@ INSTALL_HEADERS += \
     include/AppConfig.h \
     include/Application.h \
     include/AppUI.h \
+    include/AudioDspFactory.h \
     include/AudioFileSaver.h \
     include/AudioPlayback.h \
     include/Averager.h \
+    include/CaptureReader.h \
     include/ColorConfig.h \
     include/ConfigTab.h \
     include/FeatureFactory.h \
+    include/FFTPlanCache.h \
     include/GuiConfig.h \
     include/InspectionWidgetFactory.h \
     include/SigDiggerHelpers.h \
+    include/SignalDetector.h \
     include/MainSpectrum.h \
     include/MainWindow.h \
+    include/OccupancyAccumulator.h \
+    include/OrbitTracker.h \
     include/Palette.h \
+    include/CatalogPredictor.h \
+    include/PassPredictor.h \
     include/PersistentWidget.h \
+    include/BenchmarkHistory.h \
+    include/PipelineBenchmark.h \
+    include/SessionDaemon.h \
+    include/SessionSnapshot.h \
+    include/ShutdownWatchdog.h \
+    include/PSDPyramid.h \
+    include/RenderScheduler.h \
+    include/MemoryAccountant.h \
+    include/MultiStreamSaver.h \
+    include/HugePages.h \
+    include/InstanceServer.h \
+    include/LoadGovernor.h \
+    include/ThreadPolicy.h \
+    include/WaterfallHistory.h \
+    include/WaterfallExportTask.h \
+    include/BaseBandTap.h \
+    include/SampleConsumerFactory.h \
+    include/SampleStore.h \
+    include/SampleStatistics.h \
+    include/SymbolStore.h \
+    include/TaskBenchmark.h \
+    include/Tracer.h \
+    include/SampleKernels.h \
     include/TabWidgetFactory.h \
     include/TLESourceConfig.h \
+    include/ThreadConfig.h \
     include/ToolWidgetFactory.h \
     include/UIComponentFactory.h \
     include/UIListenerFactory.h \
     include/UIMediator.h \
     include/GenericDataSaver.h \
+    include/RMSHistory.h \
+    include/RMSIngestor.h \
+    include/QuantizedDataSaver.h \
+    include/QuantizedIQ.h \
+    include/SegmentedCaptureReader.h \
+    include/SegmentedDataSaver.h \
+    include/AsyncIOBackend.h \
     include/Version.h
 
 install_headers.path   = $$SIGDIGGER_INSTALL_HEADERS
@@ -233,17 +362,21 @@ INSTALLS              += install_headers
 SUSCAN_HEADERS += \
     include/Suscan/AnalyzerRequestTracker.h \
     include/Suscan/CancellableTask.h \
+    include/Suscan/ChunkedTask.h \
     include/Suscan/Analyzer.h \
+    include/Suscan/AnalyzerStats.h \
     include/Suscan/AnalyzerParams.h \
     include/Suscan/Channel.h \
     include/Suscan/Compat.h \
     include/Suscan/Config.h \
+    include/Suscan/ConfigCache.h \
     include/Suscan/Estimator.h \
     include/Suscan/Library.h \
     include/Suscan/Logger.h \
     include/Suscan/Message.h \
     include/Suscan/MQ.h \
     include/Suscan/MultitaskController.h \
+    include/Suscan/TaskPool.h \
     include/Suscan/Object.h \
     include/Suscan/Plugin.h \
     include/Suscan/Serializable.h \
@@ -274,13 +407,23 @@ HEADERS += \
     Default/Audio/AudioProcessor.h \
     Default/Audio/AudioWidget.h \
     Default/Audio/AudioWidgetFactory.h \
+    Default/Audio/ChannelScanner.h \
     Default/DefaultTab/DefaultTabWidget.h \
     Default/DefaultTab/DefaultTabWidgetFactory.h \
+    Default/Detector/DetectorWidget.h \
+    Default/Detector/DetectorWidgetFactory.h \
     Default/FFT/FFTWidget.h \
     Default/FFT/FFTWidgetFactory.h \
+    Default/Occupancy/OccupancyWidget.h \
+    Default/Occupancy/OccupancyWidgetFactory.h \
     Default/GenericInspector/FACTab.h \
+    Default/GenericInspector/FACWorker.h \
     Default/GenericInspector/GenericInspector.h \
     Default/GenericInspector/GenericInspectorFactory.h \
+    Default/GenericInspector/GLConstellation.h \
+    Default/GenericInspector/GLTVDisplay.h \
+    Default/GenericInspector/InspectorDataWorker.h \
+    Default/GenericInspector/SNREstimatorWorker.h \
     Default/GenericInspector/InspectorCtl/AfcControl.h \
     Default/GenericInspector/InspectorCtl/AskControl.h \
     Default/GenericInspector/InspectorCtl/ClockRecovery.h \
@@ -300,17 +443,31 @@ HEADERS += \
     Default/Registration.h \
     Default/Source/SourceWidget.h \
     Default/Source/SourceWidgetFactory.h \
+    Default/ZoomSpectrum/ZoomSpectrum.h \
+    Default/ZoomSpectrum/ZoomSpectrumFactory.h \
+    Default/RemoteControl/RemoteControl.h \
+    Default/RemoteControl/RemoteControlFactory.h \
     include/AGCTask.h \
+    include/BatchTransformTask.h \
     include/AddTLESourceDialog.h \
     include/AlsaPlayer.h \
+    include/BaudEstimatorTask.h \
     include/CarrierDetector.h \
+    include/RecordingOverviewTask.h \
+    include/RecordingTrigger.h \
     include/CarrierXlator.h \
+    include/ChannelExtractTask.h \
+    include/LoadCaptureTask.h \
+    include/SpectrogramTask.h \
     include/ColorConfigTab.h \
     include/CostasRecoveryTask.h \
+    include/CyclicSpectrumTask.h \
     include/DelayedConjTask.h \
     include/DeviceTweaks.h \
     include/DopplerCalculator.h \
     include/DopplerDialog.h \
+    include/SpectrogramDialog.h \
+    include/CyclicSpectrumDialog.h \
     include/FrequencyCorrectionDialog.h \
     include/GenericAudioPlayer.h \
     include/GenericDataSaverUI.h \
@@ -324,6 +481,10 @@ HEADERS += \
     include/ProfileConfigTab.h \
     include/QTimeSlider.h \
     include/QuadDemodTask.h \
+    include/RecoverySweepTask.h \
+    include/TransformChainTask.h \
+    include/TransformHistory.h \
+    include/TransformReplayTask.h \
     include/QuickConnectDialog.h \
     include/SamplerDialog.h \
     include/SamplingProperties.h \
@@ -336,8 +497,13 @@ HEADERS += \
     include/GainSlider.h \
     include/Loader.h \
     include/SaveProfileDialog.h \
+    include/DecisionBlock.h \
+    include/SymbolPacker.h \
+    include/ScratchArena.h \
+    include/HistogramAccumulator.h \
     include/SNREstimator.h \
     include/TLESourceTab.h \
+    include/ThreadConfigTab.h \
     include/TimeWindow.h \
     include/FileDataSaver.h \
     include/SocketForwarder.h \
@@ -346,16 +512,24 @@ HEADERS += \
     include/DeviceDialog.h \
     include/PanoramicDialog.h \
     include/Scanner.h \
+    include/PanoramicRecorder.h \
+    include/PanoramicRelay.h \
+    include/SpectrumTileStore.h \
     include/WaveSampler.h \
     include/RMSViewer.h \
     include/RMSViewTab.h \
     include/RMSViewerSettingsDialog.h \
     include/LogDialog.h \
+    include/DiagnosticsDialog.h \
     include/MultitaskControllerModel.h \
     include/BackgroundTasksDialog.h \
     include/ExportSamplesTask.h \
     include/AddBookmarkDialog.h \
+    include/BlockNCO.h \
+    include/BookmarkImportTask.h \
     include/BookmarkTableModel.h \
+    include/LocationListModel.h \
+    include/CaptureFile.h \
     include/BookmarkManagerDialog.h \
     include/TableDelegates.h
 
@@ -363,7 +537,9 @@ HEADERS += \
 FORMS += \
     Default/Audio/AudioWidget.ui \
     Default/DefaultTab/DefaultTabWidget.ui \
+    Default/Detector/DetectorWidget.ui \
     Default/FFT/FFTWidget.ui \
+    Default/Occupancy/OccupancyWidget.ui \
     Default/GenericInspector/FACTab.ui \
     Default/GenericInspector/GenericInspector.ui \
     Default/GenericInspector/SymViewTab.ui \
@@ -371,6 +547,7 @@ FORMS += \
     Default/GenericInspector/WaveformTab.ui \
     Default/Inspection/InspToolWidget.ui \
     Default/Source/SourceWidget.ui \
+    Default/ZoomSpectrum/ZoomSpectrum.ui \
     ui/AboutDialog.ui \
     ui/AddTLESourceDialog.ui \
     ui/AfcControl.ui \
@@ -382,6 +559,8 @@ FORMS += \
     ui/DeviceGain.ui \
     ui/DeviceTweaks.ui \
     ui/DopplerDialog.ui \
+    ui/SpectrogramDialog.ui \
+    ui/CyclicSpectrumDialog.ui \
     ui/EqualizerControl.ui \
     ui/FrequencyCorrectionDialog.ui \
     ui/GainControl.ui \
@@ -396,6 +575,7 @@ FORMS += \
     ui/QuickConnectDialog.ui \
     ui/SamplerDialog.ui \
     ui/TLESourceTab.ui \
+    ui/ThreadConfigTab.ui \
     ui/TimeWindow.ui \
     ui/ToneControl.ui \
     ui/SaveProfileDialog.ui \
@@ -407,6 +587,7 @@ FORMS += \
     ui/RMSViewTab.ui \
     ui/RMSViewerSettingsDialog.ui \
     ui/LogDialog.ui \
+    ui/DiagnosticsDialog.ui \
     ui/BackgroundTasksDialog.ui \
     ui/AddBookmarkDialog.ui \
     ui/BookmarkManagerDialog.ui
@@ -429,6 +610,25 @@ packagesExist(libcurl) {
 packagesExist(volk) {
   PKGCONFIG += volk
 }
+
+isEmpty(DISABLE_LIBURING): packagesExist(liburing) {
+  PKGCONFIG += liburing
+  QMAKE_CXXFLAGS += -DHAVE_LIBURING
+}
+
+# POSIX AIO lives in librt on glibc < 2.34
+linux: LIBS += -lrt
+
+packagesExist(libzstd) {
+  PKGCONFIG += libzstd
+  QMAKE_CXXFLAGS += -DHAVE_ZSTD
+}
+
+# fftw3f_threads ships with fftw3f but has no pkg-config file of its own
+isEmpty(DISABLE_FFTW_THREADS) {
+  LIBS += -lfftw3f_threads
+  QMAKE_CXXFLAGS += -DHAVE_FFTW3_THREADS
+}
   
 # Sound API detection. We first check for system-specific audio libraries,
 # which tend to be the faster ones. If they are not available, fallback
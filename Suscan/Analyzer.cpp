@@ -18,11 +18,19 @@
 //
 
 #include <iostream>
+#include <memory>
+#include <cstring>
+#include <algorithm>
 
 #include <QMetaType>
+#include <QElapsedTimer>
 #include <Suscan/Library.h>
 #include <Suscan/Analyzer.h>
+#include <SampleConsumerFactory.h>
+#include <BaseBandTap.h>
 #include <SuWidgetsHelpers.h>
+#include <Tracer.h>
+#include <ThreadPolicy.h>
 
 Q_DECLARE_METATYPE(Suscan::Message);
 Q_DECLARE_METATYPE(Suscan::ChannelMessage);
@@ -39,6 +47,126 @@ Q_DECLARE_METATYPE(Suscan::Orbit);
 
 using namespace Suscan;
 
+// AnalyzerSourceInfo
+static bool
+sameString(const char *a, const char *b)
+{
+  if (a == nullptr || b == nullptr)
+    return a == b;
+
+  return strcmp(a, b) == 0;
+}
+
+static bool
+sameTime(struct timeval const &a, struct timeval const &b)
+{
+  return a.tv_sec == b.tv_sec && a.tv_usec == b.tv_usec;
+}
+
+unsigned int
+AnalyzerSourceInfo::diff(AnalyzerSourceInfo const &prev) const
+{
+  const struct suscan_analyzer_source_info *a = this->c_info;
+  const struct suscan_analyzer_source_info *b = prev.c_info;
+  unsigned int changes = 0;
+  unsigned int i;
+
+  if (a->permissions != b->permissions)
+    changes |= SOURCE_INFO_PERMISSIONS;
+
+  if (a->source_samp_rate != b->source_samp_rate
+      || a->effective_samp_rate != b->effective_samp_rate)
+    changes |= SOURCE_INFO_SAMPLE_RATE;
+
+  if (!sufeq(a->measured_samp_rate, b->measured_samp_rate, 0))
+    changes |= SOURCE_INFO_MEASURED_RATE;
+
+  if (!sufeq(a->frequency, b->frequency, 0) || !sufeq(a->lnb, b->lnb, 0))
+    changes |= SOURCE_INFO_FREQUENCY;
+
+  if (!sufeq(a->freq_min, b->freq_min, 0)
+      || !sufeq(a->freq_max, b->freq_max, 0))
+    changes |= SOURCE_INFO_FREQ_LIMITS;
+
+  if (!sufeq(a->bandwidth, b->bandwidth, 0))
+    changes |= SOURCE_INFO_BANDWIDTH;
+
+  if (a->dc_remove != b->dc_remove)
+    changes |= SOURCE_INFO_DC_REMOVE;
+
+  if (a->iq_reverse != b->iq_reverse)
+    changes |= SOURCE_INFO_IQ_REVERSE;
+
+  if (a->agc != b->agc)
+    changes |= SOURCE_INFO_AGC;
+
+  if (!sufeq(a->ppm, b->ppm, 0))
+    changes |= SOURCE_INFO_PPM;
+
+  if (a->seekable != b->seekable
+      || !sameTime(a->source_start, b->source_start)
+      || !sameTime(a->source_end, b->source_end))
+    changes |= SOURCE_INFO_TIME_RANGE;
+
+  if (!sameString(a->antenna, b->antenna)
+      || a->antenna_count != b->antenna_count)
+    changes |= SOURCE_INFO_ANTENNA;
+  else
+    for (i = 0; i < a->antenna_count; ++i)
+      if (!sameString(a->antenna_list[i], b->antenna_list[i])) {
+        changes |= SOURCE_INFO_ANTENNA;
+        break;
+      }
+
+  if (a->gain_count != b->gain_count)
+    changes |= SOURCE_INFO_GAINS;
+  else
+    for (i = 0; i < a->gain_count; ++i) {
+      const struct suscan_analyzer_gain_info *ga = a->gain_list[i];
+      const struct suscan_analyzer_gain_info *gb = b->gain_list[i];
+
+      if (!sameString(ga->name, gb->name)
+          || !sufeq(ga->value, gb->value, 0)
+          || !sufeq(ga->min, gb->min, 0)
+          || !sufeq(ga->max, gb->max, 0)
+          || !sufeq(ga->step, gb->step, 0)) {
+        changes |= SOURCE_INFO_GAINS;
+        break;
+      }
+    }
+
+  return changes;
+}
+
+void
+AnalyzerSourceInfo::update(AnalyzerSourceInfo const &info, unsigned int changes)
+{
+  struct suscan_analyzer_source_info *dest = this->c_info;
+  const struct suscan_analyzer_source_info *src = info.c_info;
+
+  if (this->loan || (changes & (SOURCE_INFO_GAINS | SOURCE_INFO_ANTENNA))) {
+    *this = info;
+    return;
+  }
+
+  dest->permissions         = src->permissions;
+  dest->source_samp_rate    = src->source_samp_rate;
+  dest->effective_samp_rate = src->effective_samp_rate;
+  dest->measured_samp_rate  = src->measured_samp_rate;
+  dest->frequency           = src->frequency;
+  dest->lnb                 = src->lnb;
+  dest->freq_min            = src->freq_min;
+  dest->freq_max            = src->freq_max;
+  dest->bandwidth           = src->bandwidth;
+  dest->dc_remove           = src->dc_remove;
+  dest->iq_reverse          = src->iq_reverse;
+  dest->agc                 = src->agc;
+  dest->ppm                 = src->ppm;
+  dest->seekable            = src->seekable;
+  dest->source_start        = src->source_start;
+  dest->source_end          = src->source_end;
+}
+
 // Orbit
 void
 Orbit::debug(void) const
@@ -60,46 +188,128 @@ Orbit::debug(void) const
 }
 
 // Async thread
+bool
+Analyzer::AsyncThread::collect(MessageBatch *batch, uint32_t type, void *data)
+{
+  qint64 now = this->owner->statsClock.nsecsElapsed();
+
+  ++this->owner->statsRead[AnalyzerStats::classOf(type)];
+
+  switch (type) {
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PSD: {
+      PSDMessage psd(static_cast<struct suscan_analyzer_psd_msg *>(data));
+
+      this->owner->consumers->dispatch(psd);
+
+      // When coalescing, the batch just carries a placeholder that tells
+      // the GUI thread to pick the newest pending PSD.
+      if (this->owner->psdCoalescing) {
+        if (this->owner->stashPSD(psd))
+          batch->push_back(
+                {type, nullptr, now, PSDMessage(), SamplesMessage()});
+        break;
+      }
+
+      batch->push_back({type, nullptr, now, psd, SamplesMessage()});
+      break;
+    }
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
+      if (this->owner->consumers->wants(SigDigger::SampleConsumer::SAMPLES)) {
+        SamplesMessage samples(
+              static_cast<struct suscan_analyzer_sample_batch_msg *>(data));
+
+        this->owner->consumers->dispatch(samples);
+        batch->push_back({type, nullptr, now, PSDMessage(), samples});
+        break;
+      }
+
+      batch->push_back({type, data, now, PSDMessage(), SamplesMessage()});
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR: {
+      bool firstHeld = false;
+
+      // Held updates are announced with a placeholder, so the GUI thread
+      // knows it has to deliver them later.
+      if (this->owner->throttleEstimator(
+            static_cast<struct suscan_analyzer_inspector_msg *>(data),
+            now,
+            firstHeld)) {
+        if (firstHeld)
+          batch->push_back(
+                {type, nullptr, now, PSDMessage(), SamplesMessage()});
+        break;
+      }
+
+      batch->push_back({type, data, now, PSDMessage(), SamplesMessage()});
+      break;
+    }
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INFO:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS:
+      batch->push_back({type, data, now, PSDMessage(), SamplesMessage()});
+      break;
+
+    // Exit conditions
+    case SUSCAN_WORKER_MSG_TYPE_HALT:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_READ_ERROR:
+      suscan_analyzer_dispose_message(type, data);
+      batch->push_back({type, nullptr, now, PSDMessage(), SamplesMessage()});
+      return false;
+
+    default:
+      // Everything else is disposed
+      suscan_analyzer_dispose_message(type, data);
+  }
+
+  return true;
+}
+
 void
 Analyzer::AsyncThread::run()
 {
   void *data = nullptr;
   uint32_t type = 0;
   bool running = true;
+  MessageBatch *batch = nullptr;
+  QElapsedTimer timer;
+  unsigned int maxSize;
+  qint64 deadline;
+
+  SigDigger::ThreadPolicy::instance()->enter(SigDigger::THREAD_ROLE_ANALYZER);
 
   // FIXME: Capture allocation exceptions!
   do {
     type = -1;
     data = this->owner->read(type);
 
-    switch (type) {
-      case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INFO:
-      case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR:
-      case SUSCAN_ANALYZER_MESSAGE_TYPE_PSD:
-      case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
-      case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT:
-      case SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL:
-      case SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS:
-        emit message(type, data);
-        break;
+    maxSize  = this->owner->batchSize;
+    deadline = this->owner->batchDeadlineMs;
 
-      // Exit conditions
-      case SUSCAN_WORKER_MSG_TYPE_HALT:
-      case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
-      case SUSCAN_ANALYZER_MESSAGE_TYPE_READ_ERROR:
-        running = false;
-        suscan_analyzer_dispose_message(type, data);
-        break;
+    batch = new MessageBatch();
+    batch->reserve(maxSize);
 
-      default:
-        // Everything else is disposed
-        suscan_analyzer_dispose_message(type, data);
-        data = nullptr;
-    }
+    timer.start();
+    running = this->collect(batch, type, data);
+
+    // Drain whatever is already in the queue, without blocking
+    while (running
+           && batch->size() < maxSize
+           && !timer.hasExpired(deadline)
+           && this->owner->mq.poll(type, data))
+      running = this->collect(batch, type, data);
+
+    if (batch->empty())
+      delete batch;
+    else
+      emit messageBatch(batch);
   } while (running);
 
-  // Emit exit reason
-  emit message(type, data);
+  SigDigger::ThreadPolicy::instance()->leave();
 }
 
 Analyzer::AsyncThread::AsyncThread(Analyzer *owner)
@@ -129,21 +339,64 @@ Analyzer::registerBaseBandFilter(suscan_analyzer_baseband_filter_func_t func, vo
   SU_ATTEMPT(suscan_analyzer_register_baseband_filter(this->instance, func, privdata));
 }
 
+SUBOOL
+Analyzer::onBaseBand(
+    void *privdata,
+    suscan_analyzer_t *,
+    const SUCOMPLEX *samples,
+    SUSCOUNT length)
+{
+  SigDigger::BaseBandTap *tap = static_cast<SigDigger::BaseBandTap *>(privdata);
+
+  if (!tap->idle())
+    tap->feed(samples, length);
+
+  return SU_TRUE;
+}
+
+// Baseband consumers should attach here rather than register filters of
+// their own, which would run inline in the DSP thread
+SigDigger::BaseBandTap *
+Analyzer::getBaseBandTap(void)
+{
+  if (!this->baseBandTapInstalled) {
+    this->registerBaseBandFilter(onBaseBand, this->baseBandTap);
+    this->baseBandTapInstalled = true;
+  }
+
+  return this->baseBandTap;
+}
+
+// Emissions are found in the GUI (by the detector tool) but belong to
+// this analyzer's spectrum, so they reach its consumers from here
+void
+Analyzer::dispatchEmission(SigDigger::SignalDetectorEvent const &event)
+{
+  this->consumers->dispatch(event);
+}
+
 void
 Analyzer::setGain(std::string const &name, SUFLOAT value)
 {
-  SU_ATTEMPT(suscan_analyzer_set_gain(this->instance, name.c_str(), value));
+  this->queueControl(
+        "gain:" + name,
+        [this, name, value] () {
+          SU_ATTEMPT(
+                suscan_analyzer_set_gain(this->instance, name.c_str(), value));
+        });
 }
 
 void
 Analyzer::seek(struct timeval const &tv)
 {
+  this->flushControls();
   SU_ATTEMPT(suscan_analyzer_seek(this->instance, &tv));
 }
 
 void
 Analyzer::setAntenna(std::string const &name)
 {
+  this->flushControls();
   SU_ATTEMPT(suscan_analyzer_set_antenna(this->instance, name.c_str()));
 }
 
@@ -166,24 +419,38 @@ Analyzer::setSpectrumPartitioning(SpectrumPartitioning partitioning)
 void
 Analyzer::setBandwidth(SUFLOAT value)
 {
-  SU_ATTEMPT(suscan_analyzer_set_bw(this->instance, value));
+  this->queueControl(
+        "bw",
+        [this, value] () {
+          SU_ATTEMPT(suscan_analyzer_set_bw(this->instance, value));
+        });
 }
 
 void
 Analyzer::setPPM(SUFLOAT value)
 {
-  SU_ATTEMPT(suscan_analyzer_set_ppm(this->instance, value));
+  this->queueControl(
+        "ppm",
+        [this, value] () {
+          SU_ATTEMPT(suscan_analyzer_set_ppm(this->instance, value));
+        });
 }
 
 void
 Analyzer::setFrequency(SUFREQ freq, SUFREQ lnb)
 {
-  SU_ATTEMPT(suscan_analyzer_set_freq(this->instance, freq, lnb));
+  this->queueControl(
+        "freq",
+        [this, freq, lnb] () {
+          SU_ATTEMPT(suscan_analyzer_set_freq(this->instance, freq, lnb));
+        });
 }
 
 void
 Analyzer::setParams(AnalyzerParams &params)
 {
+  this->flushControls();
+
   SU_ATTEMPT(
         suscan_analyzer_set_params_async(
           this->instance,
@@ -230,6 +497,282 @@ Analyzer::setBufferingSize(SUSCOUNT len)
   SU_ATTEMPT(suscan_analyzer_set_buffering_size(this->instance, len));
 }
 
+void
+Analyzer::setMessageBatching(unsigned int maxSize, unsigned int deadlineMs)
+{
+  // A batch size of 1 is equivalent to per-message delivery
+  this->batchSize       = maxSize < 1 ? 1 : maxSize;
+  this->batchDeadlineMs = deadlineMs;
+}
+
+void
+Analyzer::setPSDCoalescing(bool enabled)
+{
+  this->psdCoalescing = enabled;
+}
+
+void
+Analyzer::setEstimatorUpdateInterval(unsigned int ms)
+{
+  this->estimatorIntervalMs = ms;
+}
+
+void
+Analyzer::setControlCoalescing(unsigned int ms)
+{
+  // Zero means every control command is sent as soon as it is requested
+  this->controlIntervalMs = ms;
+
+  if (ms == 0)
+    this->flushControls();
+  else
+    this->controlTimer.setInterval(static_cast<int>(ms));
+}
+
+//
+// Sends the command right away if nothing was sent during the current
+// interval. Otherwise, it replaces the command pending for the same key
+// (or is queued after the others) until the interval is over. Errors of
+// immediate commands reach the caller, as before.
+//
+void
+Analyzer::queueControl(
+    std::string const &key,
+    std::function<void (void)> const &send)
+{
+  if (this->controlIntervalMs == 0) {
+    send();
+    return;
+  }
+
+  if (!this->controlTimer.isActive()) {
+    this->controlTimer.start();
+    send();
+    return;
+  }
+
+  for (auto &p : this->pendingControls)
+    if (p.key == key) {
+      p.send = send;
+      return;
+    }
+
+  this->pendingControls.push_back(PendingControl {key, send});
+}
+
+// Sends the pending commands now, in the order they were first queued.
+// Requests that must see the effect of previous controls call this first.
+void
+Analyzer::flushControls(void)
+{
+  std::vector<PendingControl> pending;
+
+  pending.swap(this->pendingControls);
+
+  for (auto &p : pending) {
+    try {
+      p.send();
+    } catch (Suscan::Exception const &e) {
+      SU_WARNING("Deferred %s command failed: %s\n", p.key.c_str(), e.what());
+    }
+  }
+}
+
+void
+Analyzer::dropControls(void)
+{
+  this->controlTimer.stop();
+  this->pendingControls.clear();
+  this->inspectorConfigs.clear();
+}
+
+// Returns true if this estimator update comes too soon after the last
+// one that was delivered, and must be dropped.
+// Returns true if the message was held (and is now owned by the analyzer).
+// firstHeld is set if no other update was held before this one.
+bool
+Analyzer::throttleEstimator(
+    struct suscan_analyzer_inspector_msg *msg,
+    qint64 now,
+    bool &firstHeld)
+{
+  qint64 interval = SCAST(qint64, this->estimatorIntervalMs) * 1000000;
+  quint64 key;
+  std::lock_guard<std::mutex> guard(this->estimatorMutex);
+
+  // Closed inspectors will not report again
+  if (msg->kind == SUSCAN_ANALYZER_INSPECTOR_MSGKIND_CLOSE) {
+    for (auto it = this->estimatorLastNs.begin();
+         it != this->estimatorLastNs.end();)
+      if ((it.key() >> 32) == msg->inspector_id)
+        it = this->estimatorLastNs.erase(it);
+      else
+        ++it;
+
+    for (auto it = this->heldEstimators.begin();
+         it != this->heldEstimators.end();)
+      if ((it.key() >> 32) == msg->inspector_id)
+        it = this->heldEstimators.erase(it);
+      else
+        ++it;
+
+    return false;
+  }
+
+  if (msg->kind != SUSCAN_ANALYZER_INSPECTOR_MSGKIND_ESTIMATOR
+      || interval == 0)
+    return false;
+
+  key = (SCAST(quint64, msg->inspector_id) << 32) | msg->estimator_id;
+
+  auto it = this->estimatorLastNs.find(key);
+
+  if (it != this->estimatorLastNs.end() && now - it.value() < interval) {
+    // Only the latest update of the interval is kept
+    if (this->heldEstimators.contains(key))
+      ++this->statsEstimatorsDropped;
+
+    firstHeld = this->heldEstimators.isEmpty();
+    this->heldEstimators[key] = InspectorMessage(msg);
+    return true;
+  }
+
+  this->estimatorLastNs[key] = now;
+
+  // This one is newer than whatever was still held
+  if (this->heldEstimators.remove(key) > 0)
+    ++this->statsEstimatorsDropped;
+
+  return false;
+}
+
+// Returns true if there was no pending PSD, i.e. the GUI thread must be
+// notified about this one.
+bool
+Analyzer::stashPSD(PSDMessage const &psd)
+{
+  std::lock_guard<std::mutex> guard(this->psdMutex);
+  bool wasEmpty = !this->havePendingPSD;
+
+  // Nobody is going to look at the previous PSD. Drop it right away
+  // (unless a sample consumer still holds it).
+  if (!wasEmpty)
+    ++this->statsCoalesced;
+
+  this->pendingPSD = psd;
+  this->havePendingPSD = true;
+
+  return wasEmpty;
+}
+
+bool
+Analyzer::takePendingPSD(PSDMessage &psd)
+{
+  std::lock_guard<std::mutex> guard(this->psdMutex);
+
+  if (!this->havePendingPSD)
+    return false;
+
+  psd = std::move(this->pendingPSD);
+  this->pendingPSD = PSDMessage();
+  this->havePendingPSD = false;
+
+  return true;
+}
+
+//
+// Samples belonging to an inspector with a registered route are delivered
+// only to its receiver. Samples without a route are broadcast through the
+// samples_message signal, as before.
+//
+void
+Analyzer::registerSamplesRoute(
+    InspectorId id,
+    QObject *receiver,
+    SamplesHandler handler)
+{
+  this->samplesRoutes[id] = SamplesRoute {receiver, handler};
+}
+
+void
+Analyzer::unregisterSamplesRoute(InspectorId id)
+{
+  this->samplesRoutes.remove(id);
+}
+
+void
+Analyzer::routeSamples(SamplesMessage const &msg)
+{
+  auto it = this->samplesRoutes.find(msg.getInspectorId());
+
+  if (it == this->samplesRoutes.end()) {
+    emit samples_message(msg);
+  } else if (it->receiver.isNull()) {
+    // Receiver is gone, and so are its samples
+    this->samplesRoutes.erase(it);
+  } else {
+    InspectorId id = msg.getInspectorId();
+    qint64 start = this->statsClock.nsecsElapsed();
+
+    it->handler(msg);
+
+    // The handler may have modified the routing table. Look it up again.
+    it = this->samplesRoutes.find(id);
+    if (it != this->samplesRoutes.end())
+      it->dispatchTime.feed(
+            SCAST(uint64_t, this->statsClock.nsecsElapsed() - start) / 1000);
+  }
+}
+
+AnalyzerStats
+Analyzer::getStats(void) const
+{
+  AnalyzerStats stats = this->stats;
+
+  stats.uptimeMs =
+      (this->statsClock.nsecsElapsed() - this->statsEpochNs) / 1000000;
+
+  for (int i = 0; i < ANALYZER_STATS_CLASS_COUNT; ++i)
+    stats.classes[i].read = this->statsRead[i];
+
+  stats.classes[ANALYZER_STATS_PSD].coalesced = this->statsCoalesced;
+  stats.classes[ANALYZER_STATS_INSPECTOR].coalesced =
+      this->statsEstimatorsDropped;
+
+  for (auto it = this->samplesRoutes.cbegin();
+       it != this->samplesRoutes.cend();
+       ++it) {
+    SamplesRouteStats route;
+
+    route.receiver     = it->receiver.isNull()
+        ? QString("(deleted)")
+        : QString(it->receiver->metaObject()->className());
+    route.inspectorId  = it.key();
+    route.dispatchTime = it->dispatchTime;
+
+    stats.routes.push_back(route);
+  }
+
+  return stats;
+}
+
+void
+Analyzer::resetStats(void)
+{
+  this->stats.reset();
+
+  for (int i = 0; i < ANALYZER_STATS_CLASS_COUNT; ++i)
+    this->statsRead[i] = 0;
+
+  this->statsCoalesced = 0;
+  this->statsEstimatorsDropped = 0;
+
+  for (auto &p : this->samplesRoutes)
+    p.dispatchTime.reset();
+
+  this->statsEpochNs = this->statsClock.nsecsElapsed();
+}
+
 SUSCOUNT
 Analyzer::getSampleRate(void) const
 {
@@ -256,13 +799,59 @@ Analyzer::getSourceTimeStamp(void) const
 void
 Analyzer::halt(void)
 {
+  // Nothing sent after a halt request would be processed
+  this->dropControls();
   suscan_analyzer_req_halt(this->instance);
 }
 
 // Signal slots
+void
+Analyzer::onControlTimeout(void)
+{
+  // Nothing changed during the last interval: the next command goes
+  // through immediately.
+  if (this->pendingControls.empty())
+    this->controlTimer.stop();
+  else
+    this->flushControls();
+}
+
+void
+Analyzer::onEstimatorTimeout(void)
+{
+  qint64 now = this->statsClock.nsecsElapsed();
+  qint64 interval = SCAST(qint64, this->estimatorIntervalMs) * 1000000;
+  std::vector<InspectorMessage> due;
+
+  {
+    std::lock_guard<std::mutex> guard(this->estimatorMutex);
+
+    for (auto it = this->heldEstimators.begin();
+         it != this->heldEstimators.end();) {
+      auto last = this->estimatorLastNs.find(it.key());
+
+      if (last == this->estimatorLastNs.end()
+          || now - last.value() >= interval) {
+        this->estimatorLastNs[it.key()] = now;
+        due.push_back(it.value());
+        it = this->heldEstimators.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    if (this->heldEstimators.isEmpty())
+      this->estimatorTimer.stop();
+  }
+
+  for (auto &msg : due)
+    emit inspector_message(msg);
+}
+
 void
 Analyzer::captureMessage(quint32 type, void *data)
 {
+  SIGDIGGER_TRACE_SCOPE("Analyzer::captureMessage");
   switch (type) {
     // Data messages
     case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INFO:
@@ -278,7 +867,7 @@ Analyzer::captureMessage(quint32 type, void *data)
       break;
 
     case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
-      emit samples_message(SamplesMessage(static_cast<struct suscan_analyzer_sample_batch_msg *>(data)));
+      this->routeSamples(SamplesMessage(static_cast<struct suscan_analyzer_sample_batch_msg *>(data)));
       break;
 
     case SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL:
@@ -309,6 +898,56 @@ Analyzer::captureMessage(quint32 type, void *data)
   }
 }
 
+void
+Analyzer::captureMessageBatch(void *ptr)
+{
+  SIGDIGGER_TRACE_SCOPE("Analyzer::captureMessageBatch");
+  MessageBatch *batch = static_cast<MessageBatch *>(ptr);
+  void *data;
+  qint64 start, end;
+
+  ++this->stats.batches;
+  this->stats.backlog.feed(batch->size());
+
+  for (auto &p : *batch) {
+    data = p.data;
+
+    if (p.type == SUSCAN_ANALYZER_MESSAGE_TYPE_PSD) {
+      PSDMessage psd = std::move(p.psd);
+
+      // Placeholder of a coalesced PSD
+      if (psd.isNull() && !this->takePendingPSD(psd))
+        continue;
+
+      start = this->statsClock.nsecsElapsed();
+      emit psd_message(psd);
+    } else if (p.type == SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR
+               && data == nullptr) {
+      // Placeholder of a held estimator update
+      if (!this->estimatorTimer.isActive())
+        this->estimatorTimer.start(
+              std::max(1, SCAST(int, this->estimatorIntervalMs.load())));
+      continue;
+    } else if (p.type == SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES
+               && data == nullptr) {
+      start = this->statsClock.nsecsElapsed();
+      this->routeSamples(p.samples);
+    } else {
+      start = this->statsClock.nsecsElapsed();
+      this->captureMessage(p.type, data);
+    }
+
+    end   = this->statsClock.nsecsElapsed();
+
+    MessageClassStats &cls = this->stats.classes[AnalyzerStats::classOf(p.type)];
+    ++cls.delivered;
+    cls.queueLatency.feed(SCAST(uint64_t, start - p.readNs) / 1000);
+    cls.dispatchTime.feed(SCAST(uint64_t, end - start) / 1000);
+  }
+
+  delete batch;
+}
+
 bool Analyzer::registered = false; // Yes, C++!
 
 void
@@ -420,17 +1059,53 @@ Analyzer::openEx(
 void
 Analyzer::setInspectorConfig(Handle handle, Config const &cfg, RequestId id)
 {
-  SU_ATTEMPT(
-        suscan_analyzer_set_inspector_config_async(
-          this->instance,
-          handle,
-          cfg.getInstance(),
-          id));
+  // The caller's config may change before the command is sent
+  std::shared_ptr<Config> copy = std::make_shared<Config>(cfg.getInstance());
+  auto last = this->inspectorConfigs.find(handle);
+  bool unchanged =
+      last != this->inspectorConfigs.end()
+      && copy->changedFields(**last).empty();
+
+  this->inspectorConfigs[handle] = copy;
+
+  // Someone is waiting for the response to this request: do not replace it
+  if (id != 0) {
+    this->flushControls();
+    SU_ATTEMPT(
+          suscan_analyzer_set_inspector_config_async(
+            this->instance,
+            handle,
+            copy->getInstance(),
+            id));
+    return;
+  }
+
+  // Same values as the last config requested for this inspector (e.g. a
+  // control re-emitting its state): nothing to apply
+  if (unchanged)
+    return;
+
+  this->queueControl(
+        "inspcfg:" + std::to_string(handle),
+        [this, handle, copy] () {
+          SU_ATTEMPT(
+                suscan_analyzer_set_inspector_config_async(
+                  this->instance,
+                  handle,
+                  copy->getInstance(),
+                  0));
+        });
 }
 
 void
 Analyzer::setInspectorId(Handle handle, InspectorId id, RequestId req_id)
 {
+  this->flushControls();
+
+  // Sent once per opened inspector: handles of closed inspectors may be
+  // reused, and nothing was configured on this one yet
+  this->inspectorConfigs.remove(handle);
+
   SU_ATTEMPT(
         suscan_analyzer_set_inspector_id_async(
           this->instance,
@@ -442,26 +1117,35 @@ Analyzer::setInspectorId(Handle handle, InspectorId id, RequestId req_id)
 void
 Analyzer::setInspectorFreq(Handle handle, SUFREQ freq, RequestId)
 {
-  SU_ATTEMPT(
-        suscan_analyzer_set_inspector_freq_overridable(
-          this->instance,
-          handle,
-          freq));
+  this->queueControl(
+        "inspfreq:" + std::to_string(handle),
+        [this, handle, freq] () {
+          SU_ATTEMPT(
+                suscan_analyzer_set_inspector_freq_overridable(
+                  this->instance,
+                  handle,
+                  freq));
+        });
 }
 
 void
 Analyzer::setInspectorBandwidth(Handle handle, SUFREQ bw, RequestId)
 {
-  SU_ATTEMPT(
-        suscan_analyzer_set_inspector_bandwidth_overridable(
-          this->instance,
-          handle,
-          bw));
+  this->queueControl(
+        "inspbw:" + std::to_string(handle),
+        [this, handle, bw] () {
+          SU_ATTEMPT(
+                suscan_analyzer_set_inspector_bandwidth_overridable(
+                  this->instance,
+                  handle,
+                  bw));
+        });
 }
 
 void
 Analyzer::setInspectorWatermark(Handle handle, SUSCOUNT wm, RequestId req_id)
 {
+  this->flushControls();
   SU_ATTEMPT(
         suscan_analyzer_set_inspector_watermark_async(
           this->instance,
@@ -473,6 +1157,7 @@ Analyzer::setInspectorWatermark(Handle handle, SUSCOUNT wm, RequestId req_id)
 void
 Analyzer::setSpectrumSource(Handle handle, unsigned int src, RequestId id)
 {
+  this->flushControls();
   SU_ATTEMPT(
         suscan_analyzer_inspector_set_spectrum_async(
           this->instance,
@@ -489,6 +1174,7 @@ Analyzer::setInspectorEnabled(
     bool enabled,
     RequestId id)
 {
+  this->flushControls();
   SU_ATTEMPT(
         suscan_analyzer_inspector_estimator_cmd_async(
           this->instance,
@@ -504,6 +1190,7 @@ Analyzer::setInspectorDopplerCorrection(
     Orbit const &orbit,
     RequestId id)
 {
+  this->flushControls();
   SU_ATTEMPT(
         suscan_analyzer_inspector_set_tle_async(
           this->instance,
@@ -517,6 +1204,7 @@ Analyzer::disableDopplerCorrection(
     Handle handle,
     RequestId id)
 {
+  this->flushControls();
   SU_ATTEMPT(
         suscan_analyzer_inspector_set_tle_async(
           this->instance,
@@ -528,12 +1216,29 @@ Analyzer::disableDopplerCorrection(
 void
 Analyzer::closeInspector(Handle handle, RequestId id)
 {
+  this->flushControls();
+  this->inspectorConfigs.remove(handle);
   SU_ATTEMPT(suscan_analyzer_close_async(this->instance, handle, id));
 }
 
 // Object construction and destruction
-Analyzer::Analyzer(AnalyzerParams &params, Source::Config const &config)
+Analyzer::Analyzer(
+    AnalyzerParams &params,
+    Source::Config const &config,
+    bool psdCoalescing) :
+  batchSize(SIGDIGGER_ANALYZER_DEFAULT_BATCH_SIZE),
+  batchDeadlineMs(SIGDIGGER_ANALYZER_DEFAULT_BATCH_DEADLINE_MS),
+  psdCoalescing(psdCoalescing),
+  estimatorIntervalMs(SIGDIGGER_ANALYZER_DEFAULT_ESTIMATOR_INTERVAL_MS),
+  controlIntervalMs(SIGDIGGER_ANALYZER_DEFAULT_CONTROL_INTERVAL_MS),
+  statsCoalesced(0),
+  statsEstimatorsDropped(0)
 {
+  for (int i = 0; i < ANALYZER_STATS_CLASS_COUNT; ++i)
+    this->statsRead[i] = 0;
+
+  this->statsClock.start();
+
   this->requestId   = SCAST(uint32_t, rand() ^ (rand() << 16));
   this->inspectorId = SCAST(uint32_t, rand() ^ (rand() << 16));
 
@@ -544,15 +1249,31 @@ Analyzer::Analyzer(AnalyzerParams &params, Source::Config const &config)
         config.instance,
         &mq.mq));
 
+  this->consumers   = new SigDigger::SampleConsumerDispatcher();
+  this->baseBandTap = new SigDigger::BaseBandTap();
   this->asyncThread = new AsyncThread(this);
 
   connect(
         this->asyncThread,
-        SIGNAL(message(quint32, void *)),
+        SIGNAL(messageBatch(void *)),
         this,
-        SLOT(captureMessage(quint32, void *)),
+        SLOT(captureMessageBatch(void *)),
         Qt::QueuedConnection);
 
+  this->controlTimer.setInterval(SIGDIGGER_ANALYZER_DEFAULT_CONTROL_INTERVAL_MS);
+
+  connect(
+        &this->controlTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onControlTimeout(void)));
+
+  connect(
+        &this->estimatorTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onEstimatorTimeout(void)));
+
   this->asyncThread->start();
 }
 
@@ -567,8 +1288,20 @@ Analyzer::~Analyzer()
       this->asyncThread = nullptr;
     }
     // Async thread is safely destroyed, proceed to destroy instance
+    this->pendingPSD = PSDMessage();
+    this->havePendingPSD = false;
+    this->heldEstimators.clear();
+
+    // Consumers may still hold messages of this analyzer
+    delete this->consumers;
+    this->consumers = nullptr;
+
     suscan_analyzer_destroy(this->instance);
     this->instance = nullptr;
+
+    // No more baseband after this. Remaining consumers get what is left.
+    delete this->baseBandTap;
+    this->baseBandTap = nullptr;
   }
 }
 
@@ -89,6 +89,7 @@ AnalyzerParams::deserialize(Object const &conf)
   LOAD(windowSize);
   LOAD(minFreq);
   LOAD(maxFreq);
+  LOAD(channelGrid);
 
   wFunc = conf.get("windowFunction", std::string("none"));
 
@@ -126,6 +127,7 @@ AnalyzerParams::serialize(void)
   STORE(windowSize);
   STORE(minFreq);
   STORE(maxFreq);
+  STORE(channelGrid);
 
   switch (this->windowFunction) {
     case NONE:
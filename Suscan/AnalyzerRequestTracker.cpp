@@ -18,6 +18,7 @@
 //
 #include <Suscan/AnalyzerRequestTracker.h>
 #include <Suscan/Analyzer.h>
+#include <cmath>
 
 using namespace Suscan;
 
@@ -28,14 +29,27 @@ static bool g_registered = false;
 AnalyzerRequestTracker::AnalyzerRequestTracker(QObject *parent) :
   QObject(parent)
 {
+  m_timeoutTimer.setInterval(SIGDIGGER_ANALYZER_REQUEST_POLL_MS);
 
+  connect(
+        &m_timeoutTimer,
+        SIGNAL(timeout()),
+        this,
+        SLOT(onTimeout()));
 }
 
 bool
-AnalyzerRequestTracker::executeOpenRequest(AnalyzerRequest const &req)
+AnalyzerRequestTracker::executeOpenRequest(AnalyzerRequest &req)
 {
   assert(m_analyzer != nullptr);
 
+  // Too many requests on the wire; the next reply will make room
+  if (m_pendingRequests.size() >= SIGDIGGER_ANALYZER_REQUEST_MAX_IN_FLIGHT) {
+    m_queuedRequests.push_back(req);
+    return true;
+  }
+
+  req.sent.start();
   m_pendingRequests[req.requestId] = req;
 
   try {
@@ -46,9 +60,13 @@ AnalyzerRequestTracker::executeOpenRequest(AnalyzerRequest const &req)
           req.parent,
           req.requestId);
   } catch (Suscan::Exception &) {
+    m_pendingRequests.remove(req.requestId);
     return false;
   }
 
+  if (!m_timeoutTimer.isActive())
+    m_timeoutTimer.start();
+
   return true;
 }
 
@@ -66,6 +84,111 @@ AnalyzerRequestTracker::executeSetInspectorId(AnalyzerRequest const &req)
   return true;
 }
 
+void
+AnalyzerRequestTracker::dispatchQueued()
+{
+  while (m_analyzer != nullptr
+         && !m_queuedRequests.empty()
+         && m_pendingRequests.size()
+         < SIGDIGGER_ANALYZER_REQUEST_MAX_IN_FLIGHT) {
+    AnalyzerRequest req = m_queuedRequests.front();
+    m_queuedRequests.pop_front();
+
+    if (!this->executeOpenRequest(req)) {
+      emit error(req, "Cannot send open request to the analyzer");
+      this->finishRequest(req, false);
+    }
+  }
+
+  if (m_pendingRequests.isEmpty())
+    m_timeoutTimer.stop();
+}
+
+void
+AnalyzerRequestTracker::finishRequest(AnalyzerRequest const &req, bool success)
+{
+  auto it = m_batches.find(req.batchId);
+
+  if (it == m_batches.end())
+    return;
+
+  --it->remaining;
+
+  if (success)
+    ++it->opened;
+  else
+    ++it->failed;
+
+  this->checkBatch(req.batchId);
+}
+
+void
+AnalyzerRequestTracker::checkBatch(uint32_t batchId)
+{
+  auto it = m_batches.find(batchId);
+
+  if (it != m_batches.end() && it->closed && it->remaining == 0) {
+    Batch batch = *it;
+
+    m_batches.erase(it);
+    emit batchFinished(batchId, batch.opened, batch.failed);
+  }
+}
+
+void
+AnalyzerRequestTracker::snapToGrid(AnalyzerRequest &req) const
+{
+  if (m_channelGrid <= 0 || req.parent != -1)
+    return;
+
+  if (req.channel.fHigh - req.channel.fLow > m_channelGrid)
+    return;
+
+  // Cutoffs are relative to fc, they move along with it
+  req.channel.fc = m_channelGrid * std::round(req.channel.fc / m_channelGrid);
+  req.precise    = false;
+}
+
+void
+AnalyzerRequestTracker::setChannelGrid(SUFREQ spacing)
+{
+  m_channelGrid = spacing > 0 ? spacing : 0;
+}
+
+SUFREQ
+AnalyzerRequestTracker::getChannelGrid() const
+{
+  return m_channelGrid;
+}
+
+bool
+AnalyzerRequestTracker::choosePrecise(AnalyzerRequest const &req) const
+{
+  SUFLOAT rate, measured;
+  qreal ratio;
+
+  // Subchannels are relative to their parent's rate: leave them alone
+  if (req.parent != -1)
+    return true;
+
+  if ((rate = static_cast<SUFLOAT>(m_analyzer->getSampleRate())) <= 0)
+    return true;
+
+  ratio = (req.channel.fHigh - req.channel.fLow) / rate;
+
+  if (ratio <= SIGDIGGER_ANALYZER_PRECISE_NARROW_RATIO)
+    return true;
+
+  if (ratio >= SIGDIGGER_ANALYZER_PRECISE_WIDE_RATIO)
+    return false;
+
+  // Not measured yet means we do not know: assume it keeps up
+  measured = static_cast<SUFLOAT>(m_analyzer->getMeasuredSampleRate());
+
+  return measured <= 0
+      || measured >= SIGDIGGER_ANALYZER_PRECISE_LAG_RATIO * rate;
+}
+
 bool
 AnalyzerRequestTracker::requestOpen(
     std::string const &inspClass,
@@ -73,6 +196,22 @@ AnalyzerRequestTracker::requestOpen(
     QVariant data,
     bool precise,
     Handle parent)
+{
+  return this->requestOpen(
+        inspClass,
+        channel,
+        data,
+        precise ? CHANNEL_PRECISION_PRECISE : CHANNEL_PRECISION_FAST,
+        parent);
+}
+
+bool
+AnalyzerRequestTracker::requestOpen(
+    std::string const &inspClass,
+    Channel const &channel,
+    QVariant data,
+    ChannelPrecision precision,
+    Handle parent)
 {
   AnalyzerRequest request;
 
@@ -88,24 +227,77 @@ AnalyzerRequestTracker::requestOpen(
   request.inspectorId = m_analyzer->allocateInspectorId();
   request.inspClass   = inspClass;
   request.channel     = channel;
-  request.precise     = precise;
   request.parent      = parent;
   request.data        = data;
+  request.batchId     = m_currentBatch;
+
+  if (precision == CHANNEL_PRECISION_AUTO)
+    request.precise = this->choosePrecise(request);
+  else
+    request.precise = precision == CHANNEL_PRECISION_PRECISE;
+
+  this->snapToGrid(request);
+
+  if (!this->executeOpenRequest(request))
+    return false;
+
+  if (request.batchId != 0)
+    ++m_batches[request.batchId].remaining;
 
-  return this->executeOpenRequest(request);
+  return true;
+}
+
+uint32_t
+AnalyzerRequestTracker::beginBatch()
+{
+  if (m_currentBatch == 0) {
+    m_currentBatch = ++m_lastBatch;
+    m_batches[m_currentBatch] = Batch();
+  }
+
+  return m_currentBatch;
+}
+
+void
+AnalyzerRequestTracker::endBatch()
+{
+  uint32_t batchId = m_currentBatch;
+
+  if (batchId == 0)
+    return;
+
+  m_currentBatch = 0;
+  m_batches[batchId].closed = true;
+
+  // Everything may have been answered already (or nothing requested)
+  this->checkBatch(batchId);
 }
 
 void
 AnalyzerRequestTracker::cancelAll()
 {
-  for (auto &r : m_pendingRequests) {
+  QMap<uint32_t, AnalyzerRequest> pending;
+  std::deque<AnalyzerRequest> queued;
+
+  // Slots may place new requests: work on copies
+  pending.swap(m_pendingRequests);
+  queued.swap(m_queuedRequests);
+
+  m_timeoutTimer.stop();
+  m_expiredRequests.clear();
+
+  for (auto &r : pending) {
     if (m_analyzer != nullptr && r.opened)
       m_analyzer->closeInspector(r.handle, r.requestId);
 
     emit cancelled(r);
+    this->finishRequest(r, false);
   }
 
-  m_pendingRequests.clear();
+  for (auto &r : queued) {
+    emit cancelled(r);
+    this->finishRequest(r, false);
+  }
 }
 
 void
@@ -115,6 +307,7 @@ AnalyzerRequestTracker::setAnalyzer(Analyzer *analyzer)
   this->cancelAll();
 
   m_pendingRequests.clear();
+  m_queuedRequests.clear();
 
   m_analyzer = analyzer;
 
@@ -131,54 +324,105 @@ AnalyzerRequestTracker::onInspectorMessage(
     const Suscan::InspectorMessage &message)
 {
   auto it = m_pendingRequests.find(message.getRequestId());
+  const char *failure = nullptr;
+
+  if (it == m_pendingRequests.end()) {
+    // Late reply to a request we gave up on. Do not leak the inspector.
+    if (m_expiredRequests.contains(message.getRequestId())) {
+      if (message.getKind() == SUSCAN_ANALYZER_INSPECTOR_MSGKIND_OPEN
+          && m_analyzer != nullptr)
+        m_analyzer->closeInspector(message.getHandle());
 
-  if (it != m_pendingRequests.end()) {
-    switch (message.getKind()) {
-      case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_OPEN:
-        if (it->config == nullptr) {
-          it->config = suscan_config_dup(message.getCConfig());
-        }
-        it->basebandRate = message.getBasebandRate();
-        it->equivRate    = message.getEquivSampleRate();
-        it->bandwidth    = message.getBandwidth();
-        it->lo           = message.getLo();
-        it->handle       = message.getHandle();
-        it->spectSources = message.getSpectrumSources();
-        it->estimators   = message.getEstimators();
-        it->opened       = true;
-        this->executeSetInspectorId(*it);
-        break;
-
-      case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_ID:
-        it->idSet = true;
-        emit opened(*it);
-        m_pendingRequests.remove(it->requestId);
-        break;
-
-      case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INVALID_CHANNEL:
-        emit error(*it, "Invalid channel specification (invalid bandwidth / frequency)");
-        m_pendingRequests.remove(it->requestId);
-        break;
-
-      case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE:
-        emit error(*it, "Wrong handle (server desync?)");
-        m_pendingRequests.remove(it->requestId);
-        break;
-
-      case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_OBJECT:
-        emit error(*it, "Wrong object");
-        m_pendingRequests.remove(it->requestId);
-        break;
-
-      case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_KIND:
-        emit error(*it, "Invalid message kind");
-        m_pendingRequests.remove(it->requestId);
-        break;
-
-      default:
-        break;
+      m_expiredRequests.remove(message.getRequestId());
     }
+
+    return;
+  }
+
+  switch (message.getKind()) {
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_OPEN:
+      if (it->config == nullptr) {
+        it->config = suscan_config_dup(message.getCConfig());
+      }
+      it->basebandRate = message.getBasebandRate();
+      it->equivRate    = message.getEquivSampleRate();
+      it->bandwidth    = message.getBandwidth();
+      it->lo           = message.getLo();
+      it->handle       = message.getHandle();
+      it->spectSources = message.getSpectrumSources();
+      it->estimators   = message.getEstimators();
+      it->opened       = true;
+      if (!this->executeSetInspectorId(*it))
+        failure = "Cannot set inspector ID";
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_ID: {
+      AnalyzerRequest req = *it;
+
+      m_pendingRequests.erase(it);
+      req.idSet = true;
+      emit opened(req);
+      this->finishRequest(req, true);
+      break;
+    }
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INVALID_CHANNEL:
+      failure = "Invalid channel specification (invalid bandwidth / frequency)";
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE:
+      failure = "Wrong handle (server desync?)";
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_OBJECT:
+      failure = "Wrong object";
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_KIND:
+      failure = "Invalid message kind";
+      break;
+
+    default:
+      break;
   }
+
+  if (failure != nullptr) {
+    AnalyzerRequest req = m_pendingRequests.take(message.getRequestId());
+
+    if (req.opened && m_analyzer != nullptr)
+      m_analyzer->closeInspector(req.handle, req.requestId);
+
+    emit error(req, failure);
+    this->finishRequest(req, false);
+  }
+
+  this->dispatchQueued();
+}
+
+void
+AnalyzerRequestTracker::onTimeout()
+{
+  QList<uint32_t> expired;
+
+  for (auto &r : m_pendingRequests)
+    if (r.sent.hasExpired(SIGDIGGER_ANALYZER_REQUEST_TIMEOUT_MS))
+      expired.append(r.requestId);
+
+  for (auto id : expired) {
+    AnalyzerRequest req = m_pendingRequests.take(id);
+
+    if (req.opened) {
+      if (m_analyzer != nullptr)
+        m_analyzer->closeInspector(req.handle, req.requestId);
+    } else {
+      m_expiredRequests.insert(id);
+    }
+
+    emit error(req, "The analyzer did not reply in time");
+    this->finishRequest(req, false);
+  }
+
+  this->dispatchQueued();
 }
 
 AnalyzerRequestTracker::~AnalyzerRequestTracker()
@@ -212,6 +456,8 @@ AnalyzerRequest::operator=(AnalyzerRequest const &prev)
   this->data         = prev.data;
   this->opened       = prev.opened;
   this->idSet        = prev.idSet;
+  this->batchId      = prev.batchId;
+  this->sent         = prev.sent;
   this->basebandRate = prev.basebandRate;
   this->equivRate    = prev.equivRate;
   this->bandwidth    = prev.bandwidth;
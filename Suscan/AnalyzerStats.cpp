@@ -0,0 +1,225 @@
+//
+//    AnalyzerStats.cpp: Analyzer message path statistics
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include <Suscan/AnalyzerStats.h>
+#include <analyzer/analyzer.h>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <algorithm>
+#include <cmath>
+
+using namespace Suscan;
+
+///////////////////////////////// StatsHistogram ///////////////////////////////
+void
+StatsHistogram::feed(uint64_t value)
+{
+  unsigned int bucket = 0;
+  uint64_t v = value;
+
+  while (v > 0 && bucket < SIGDIGGER_STATS_HISTOGRAM_BUCKETS - 1) {
+    v >>= 1;
+    ++bucket;
+  }
+
+  ++this->buckets[bucket];
+  ++this->count;
+  this->total += value;
+
+  if (value > this->max)
+    this->max = value;
+}
+
+void
+StatsHistogram::reset(void)
+{
+  *this = StatsHistogram();
+}
+
+qreal
+StatsHistogram::mean(void) const
+{
+  if (this->count == 0)
+    return 0;
+
+  return static_cast<qreal>(this->total) / static_cast<qreal>(this->count);
+}
+
+// Returns the upper bound of the bucket containing the given percentile
+uint64_t
+StatsHistogram::percentile(qreal p) const
+{
+  uint64_t target, accum = 0;
+  unsigned int i;
+
+  if (this->count == 0)
+    return 0;
+
+  target = static_cast<uint64_t>(std::ceil(p * this->count));
+
+  for (i = 0; i < SIGDIGGER_STATS_HISTOGRAM_BUCKETS; ++i) {
+    accum += this->buckets[i];
+    if (accum >= target)
+      break;
+  }
+
+  if (i == 0)
+    return 0;
+
+  return std::min(static_cast<uint64_t>(1) << i, this->max);
+}
+
+QJsonObject
+StatsHistogram::toJson(void) const
+{
+  QJsonObject obj;
+  QJsonArray buckets;
+  unsigned int last = 0;
+
+  for (unsigned int i = 0; i < SIGDIGGER_STATS_HISTOGRAM_BUCKETS; ++i)
+    if (this->buckets[i] > 0)
+      last = i + 1;
+
+  for (unsigned int i = 0; i < last; ++i)
+    buckets.append(static_cast<qint64>(this->buckets[i]));
+
+  obj["count"]   = static_cast<qint64>(this->count);
+  obj["mean"]    = this->mean();
+  obj["p50"]     = static_cast<qint64>(this->percentile(.5));
+  obj["p99"]     = static_cast<qint64>(this->percentile(.99));
+  obj["max"]     = static_cast<qint64>(this->max);
+  obj["buckets"] = buckets;
+
+  return obj;
+}
+
+/////////////////////////////// MessageClassStats //////////////////////////////
+QJsonObject
+MessageClassStats::toJson(void) const
+{
+  QJsonObject obj;
+
+  obj["read"]             = static_cast<qint64>(this->read);
+  obj["delivered"]        = static_cast<qint64>(this->delivered);
+  obj["coalesced"]        = static_cast<qint64>(this->coalesced);
+  obj["queue_latency_us"] = this->queueLatency.toJson();
+  obj["dispatch_time_us"] = this->dispatchTime.toJson();
+
+  return obj;
+}
+
+/////////////////////////////// SamplesRouteStats //////////////////////////////
+QJsonObject
+SamplesRouteStats::toJson(void) const
+{
+  QJsonObject obj;
+
+  obj["receiver"]         = this->receiver;
+  obj["inspector_id"]     = static_cast<qint64>(this->inspectorId);
+  obj["dispatch_time_us"] = this->dispatchTime.toJson();
+
+  return obj;
+}
+
+///////////////////////////////// AnalyzerStats ////////////////////////////////
+AnalyzerStatsClass
+AnalyzerStats::classOf(uint32_t type)
+{
+  switch (type) {
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PSD:
+      return ANALYZER_STATS_PSD;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR:
+      return ANALYZER_STATS_INSPECTOR;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES:
+      return ANALYZER_STATS_SAMPLES;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INFO:
+      return ANALYZER_STATS_SOURCE_INFO;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT:
+      return ANALYZER_STATS_STATUS;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS:
+      return ANALYZER_STATS_PARAMS;
+  }
+
+  return ANALYZER_STATS_OTHER;
+}
+
+const char *
+AnalyzerStats::className(int cls)
+{
+  switch (cls) {
+    case ANALYZER_STATS_PSD:
+      return "psd";
+
+    case ANALYZER_STATS_INSPECTOR:
+      return "inspector";
+
+    case ANALYZER_STATS_SAMPLES:
+      return "samples";
+
+    case ANALYZER_STATS_SOURCE_INFO:
+      return "source_info";
+
+    case ANALYZER_STATS_STATUS:
+      return "status";
+
+    case ANALYZER_STATS_PARAMS:
+      return "params";
+  }
+
+  return "other";
+}
+
+void
+AnalyzerStats::reset(void)
+{
+  *this = AnalyzerStats();
+}
+
+QJsonObject
+AnalyzerStats::toJson(void) const
+{
+  QJsonObject obj, classes;
+  QJsonArray routes;
+
+  for (int i = 0; i < ANALYZER_STATS_CLASS_COUNT; ++i)
+    classes[className(i)] = this->classes[i].toJson();
+
+  for (auto &p : this->routes)
+    routes.append(p.toJson());
+
+  obj["uptime_ms"]  = this->uptimeMs;
+  obj["batches"]    = static_cast<qint64>(this->batches);
+  obj["mq_backlog"] = this->backlog.toJson();
+  obj["messages"]   = classes;
+  obj["routes"]     = routes;
+
+  return obj;
+}
+
+QByteArray
+AnalyzerStats::dump(void) const
+{
+  return QJsonDocument(this->toJson()).toJson(QJsonDocument::Indented);
+}
@@ -0,0 +1,192 @@
+//
+//    BaseBandTap.cpp: Baseband sample distribution to consumer threads
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <BaseBandTap.h>
+#include <Tracer.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace SigDigger;
+
+BaseBandConsumer::~BaseBandConsumer()
+{
+}
+
+BaseBandTap::BaseBandTap(void) : readerCount(0)
+{
+}
+
+BaseBandTap::~BaseBandTap()
+{
+  for (auto reader : this->readers) {
+    stop(reader);
+    delete reader;
+  }
+}
+
+void
+BaseBandTap::run(Reader *reader)
+{
+  size_t size = reader->ring.size();
+
+  for (;;) {
+    size_t tail = reader->tail.load(std::memory_order_relaxed);
+    size_t head = reader->head.load(std::memory_order_acquire);
+
+    if (head == tail) {
+      // Only leave once the ring is empty
+      if (reader->exit)
+        break;
+
+      std::unique_lock<std::mutex> lock(reader->mutex);
+      reader->waiting = true;
+
+      if (reader->head.load(std::memory_order_acquire) == tail
+          && !reader->exit)
+        reader->ready.wait_for(
+              lock,
+              std::chrono::milliseconds(SIGDIGGER_BASEBAND_TAP_IDLE_MS));
+
+      reader->waiting = false;
+      continue;
+    }
+
+    // Contiguous part up to the end of the ring. The rest goes next.
+    size_t offset = tail & reader->mask;
+    size_t chunk  = std::min(head - tail, size - offset);
+
+    reader->consumer->baseband(reader->ring.data() + offset, chunk);
+    reader->tail.store(tail + chunk, std::memory_order_release);
+  }
+}
+
+void
+BaseBandTap::stop(Reader *reader)
+{
+  {
+    std::lock_guard<std::mutex> guard(reader->mutex);
+    reader->exit = true;
+  }
+
+  reader->ready.notify_one();
+  reader->thread.join();
+}
+
+void
+BaseBandTap::feed(const SUCOMPLEX *samples, SUSCOUNT length)
+{
+  SIGDIGGER_TRACE_SCOPE("BaseBandTap::feed");
+  std::lock_guard<std::mutex> guard(this->readersMutex);
+
+  for (auto reader : this->readers) {
+    size_t size = reader->ring.size();
+    size_t head = reader->head.load(std::memory_order_relaxed);
+    size_t tail = reader->tail.load(std::memory_order_acquire);
+
+    if (length > size - (head - tail)) {
+      reader->dropped += length;
+      continue;
+    }
+
+    size_t offset = head & reader->mask;
+    size_t first  = std::min<size_t>(length, size - offset);
+
+    memcpy(
+          reader->ring.data() + offset,
+          samples,
+          first * sizeof(SUCOMPLEX));
+
+    if (first < length)
+      memcpy(
+            reader->ring.data(),
+            samples + first,
+            (length - first) * sizeof(SUCOMPLEX));
+
+    reader->head.store(head + length, std::memory_order_release);
+
+    // Only bother the consumer if it went to sleep
+    if (reader->waiting.exchange(false)) {
+      std::lock_guard<std::mutex> wakeGuard(reader->mutex);
+      reader->ready.notify_one();
+    }
+  }
+}
+
+void
+BaseBandTap::attach(BaseBandConsumer *consumer, size_t ringLength)
+{
+  Reader *reader = new Reader;
+  size_t size = 1;
+
+  while (size < ringLength)
+    size <<= 1;
+
+  reader->consumer = consumer;
+  reader->ring.resize(size);
+  reader->mask     = size - 1;
+  reader->head     = 0;
+  reader->tail     = 0;
+  reader->dropped  = 0;
+  reader->waiting  = false;
+  reader->exit     = false;
+  reader->thread   = std::thread(run, reader);
+
+  std::lock_guard<std::mutex> guard(this->readersMutex);
+  this->readers.push_back(reader);
+  ++this->readerCount;
+}
+
+bool
+BaseBandTap::detach(BaseBandConsumer *consumer)
+{
+  Reader *reader = nullptr;
+
+  {
+    // Once out of the list, feed() will not touch it again
+    std::lock_guard<std::mutex> guard(this->readersMutex);
+    auto it = std::find_if(
+          this->readers.begin(),
+          this->readers.end(),
+          [consumer] (Reader *r) { return r->consumer == consumer; });
+
+    if (it == this->readers.end())
+      return false;
+
+    reader = *it;
+    this->readers.erase(it);
+    --this->readerCount;
+  }
+
+  stop(reader);
+  delete reader;
+
+  return true;
+}
+
+quint64
+BaseBandTap::dropped(BaseBandConsumer *consumer)
+{
+  std::lock_guard<std::mutex> guard(this->readersMutex);
+
+  for (auto reader : this->readers)
+    if (reader->consumer == consumer)
+      return reader->dropped;
+
+  return 0;
+}
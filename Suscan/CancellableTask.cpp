@@ -18,6 +18,10 @@
 //
 #include <Suscan/CancellableTask.h>
 #include <Suscan/Library.h>
+#include <Tracer.h>
+#include <ThreadPolicy.h>
+#include <QElapsedTimer>
+#include <QMutexLocker>
 
 using namespace Suscan;
 
@@ -46,7 +50,45 @@ CancellableTask::assertTypeRegistration(void)
 void
 CancellableTask::setProgress(qreal progress)
 {
-  this->prog = progress;
+  if (progress < 0)
+    progress = 0;
+  else if (progress > 1)
+    progress = 1;
+
+  this->progTotal.storeRelease(0);
+  this->progPpm.storeRelease(static_cast<quint32>(progress * 1e6));
+}
+
+void
+CancellableTask::setProgressCount(quint64 done, quint64 total)
+{
+  this->progDone.storeRelease(done);
+  this->progTotal.storeRelease(total);
+}
+
+qreal
+CancellableTask::getProgress(void) const
+{
+  quint64 total = this->progTotal.loadAcquire();
+
+  if (total > 0)
+    return static_cast<qreal>(this->progDone.loadAcquire())
+        / static_cast<qreal>(total);
+
+  return this->progPpm.loadAcquire() * 1e-6;
+}
+
+QString
+CancellableTask::getStatus(void) const
+{
+  QMutexLocker locker(&this->statusMutex);
+
+  if (!this->statusFormat.isEmpty())
+    return this->statusFormat
+        .arg(this->progDone.loadAcquire())
+        .arg(this->progTotal.loadAcquire());
+
+  return this->status;
 }
 
 void
@@ -58,18 +100,71 @@ CancellableTask::setDataSize(quint64 size)
 void
 CancellableTask::setStatus(QString status)
 {
+  QMutexLocker locker(&this->statusMutex);
+
   this->status = status;
+  this->statusFormat.clear();
 }
 
 void
-CancellableTask::onWorkRequested(void)
+CancellableTask::setStatusFormat(QString const &format)
+{
+  QMutexLocker locker(&this->statusMutex);
+
+  this->statusFormat = format;
+}
+
+void
+CancellableTask::requestCancel(void)
 {
+  this->cancelRequest.storeRelease(1);
+}
+
+bool
+CancellableTask::isCancelRequested(void) const
+{
+  return this->cancelRequest.loadAcquire() != 0;
+}
+
+bool
+CancellableTask::step(void)
+{
+  // Class names are static strings: one trace entry per task kind
+  SIGDIGGER_TRACE_SCOPE(this->metaObject()->className());
+
   try {
-    if (this->work())
-      emit progress(prog, status);
+    return this->work();
   } catch (Suscan::Exception &e) {
     emit error(QString::fromStdString(e.what()));
   }
+
+  return false;
+}
+
+void
+CancellableTask::notifyProgress(void)
+{
+  emit progress(this->getProgress(), this->getStatus());
+}
+
+void
+CancellableTask::onWorkRequested(void)
+{
+  QElapsedTimer timer;
+  bool more;
+
+  // Go back to the event loop every few milliseconds (so cancellation
+  // requests get through), not after every block.
+  timer.start();
+
+  do
+    more = this->step();
+  while (more
+         && !this->isCancelRequested()
+         && timer.elapsed() < SIGDIGGER_CANCELLABLE_TASK_SLICE_MS);
+
+  if (more)
+    this->notifyProgress();
 }
 
 void
@@ -81,6 +176,15 @@ CancellableTask::onCancelRequested(void)
 /////////////////////////// CancellableController //////////////////////////////
 CancellableController::CancellableController(QObject *parent) : QObject(parent)
 {
+  this->pollTimer.setInterval(SIGDIGGER_CANCELLABLE_CONTROLLER_POLL_MS);
+
+  connect(
+        &this->pollTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onPollTimeout(void)));
+
+  SigDigger::ThreadPolicy::bind(&this->worker, SigDigger::THREAD_ROLE_TASKS);
   this->worker.start();
 }
 
@@ -139,6 +243,8 @@ CancellableController::connectTask(void)
 void
 CancellableController::deleteTask(void)
 {
+  this->pollTimer.stop();
+
   if (this->task != nullptr) {
     delete this->task;
     this->task = nullptr;
@@ -166,6 +272,7 @@ CancellableController::process(QString const &name, CancellableTask *task)
 
   this->connectTask();
 
+  this->pollTimer.start();
   emit queuedWork();
 
   return true;
@@ -179,6 +286,9 @@ CancellableController::cancel(void)
 
   this->cancelledState = true;
   emit cancelling();
+
+  // The slice in progress ends early, and the queued slot does the rest
+  this->task->requestCancel();
   emit queuedCancel();
 
   return true;
@@ -214,10 +324,17 @@ CancellableController::onError(QString errmsg)
 }
 
 void
-CancellableController::onProgress(qreal prog, QString status)
+CancellableController::onProgress(qreal, QString)
 {
-  emit progress(prog, status);
-
+  // Progress itself is published by onPollTimeout(), at a fixed rate.
+  // This is only the request for the next slice of work.
   if (!this->cancelledState)
     emit queuedWork();
 }
+
+void
+CancellableController::onPollTimeout(void)
+{
+  if (this->task != nullptr && !this->doneReceived)
+    emit progress(this->task->getProgress(), this->task->getStatus());
+}
@@ -0,0 +1,128 @@
+//
+//    ChunkedTask.cpp: Cancellable task processed in parallel chunks
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include <Suscan/ChunkedTask.h>
+#include <algorithm>
+
+using namespace Suscan;
+
+ChunkedTask::ChunkedTask(
+    const SUCOMPLEX *origin,
+    size_t length,
+    size_t overlap,
+    QObject *parent) : CancellableTask(parent), slices(this)
+{
+  this->chunkOrigin = origin;
+  this->chunkLength = length;
+  this->overlap     = overlap;
+
+  this->setProgressCount(0, length);
+  this->setStatusFormat("Processing (%1/%2)...");
+}
+
+ChunkedTask::~ChunkedTask()
+{
+  // Too late for processChunk(), but nothing may touch the chunks either
+  this->stop();
+}
+
+void
+ChunkedTask::stop(void)
+{
+  this->slices.stop();
+}
+
+void
+ChunkedTask::prepare(void)
+{
+  TaskPool *pool = TaskPool::shared();
+  int threads = pool != nullptr ? pool->threadCount() : 1;
+  size_t count = static_cast<size_t>(threads)
+      * SIGDIGGER_CHUNKED_TASK_CHUNKS_PER_CPU;
+  size_t minChunk = std::max<size_t>(
+        SIGDIGGER_CHUNKED_TASK_MIN_CHUNK,
+        4 * this->overlap);
+  size_t chunkLen;
+  size_t i, start;
+
+  if (this->chunkLength / count < minChunk)
+    count = std::max<size_t>(1, this->chunkLength / minChunk);
+
+  chunkLen = (this->chunkLength + count - 1) / count;
+
+  // Take all histories before anything gets written
+  for (start = 0; start < this->chunkLength; start += chunkLen) {
+    Chunk chunk;
+
+    chunk.start = start;
+    chunk.end   = std::min(start + chunkLen, this->chunkLength);
+    chunk.history.resize(this->overlap, 0);
+
+    for (i = 0; i < this->overlap; ++i)
+      if (start + i >= this->overlap)
+        chunk.history[i] = this->chunkOrigin[start + i - this->overlap];
+
+    this->chunks.push_back(std::move(chunk));
+  }
+
+  this->slices.start(
+        static_cast<int>(this->chunks.size()),
+        [this] (int index) { this->runChunk(index); });
+}
+
+void
+ChunkedTask::runChunk(int index)
+{
+  Chunk const &chunk = this->chunks[static_cast<size_t>(index)];
+
+  this->processChunk(chunk.start, chunk.end, chunk.history.data());
+  this->processed.fetchAndAddRelaxed(chunk.end - chunk.start);
+}
+
+void
+ChunkedTask::updateStatus(void)
+{
+  this->setProgressCount(this->processed.loadAcquire(), this->chunkLength);
+}
+
+bool
+ChunkedTask::work(void)
+{
+  if (!this->started) {
+    this->prepare();
+    this->started = true;
+    return true;
+  }
+
+  if (!this->slices.step(SIGDIGGER_CHUNKED_TASK_POLL_INTERVAL_MS)) {
+    this->updateStatus();
+    return true;
+  }
+
+  this->updateStatus();
+
+  emit done();
+  return false;
+}
+
+void
+ChunkedTask::cancel(void)
+{
+  this->slices.cancelOwner();
+}
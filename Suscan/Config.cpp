@@ -26,6 +26,30 @@ FieldValue::FieldValue(struct suscan_field_value *inst)
   this->instance = inst;
 }
 
+bool
+FieldValue::sameValue(FieldValue const &other) const
+{
+  if (this->getType() != other.getType())
+    return false;
+
+  switch (this->getType()) {
+    case SUSCAN_FIELD_TYPE_STRING:
+    case SUSCAN_FIELD_TYPE_FILE:
+      return this->getString() == other.getString();
+
+    case SUSCAN_FIELD_TYPE_INTEGER:
+      return this->getUint64() == other.getUint64();
+
+    case SUSCAN_FIELD_TYPE_FLOAT:
+      return this->getFloat() == other.getFloat();
+
+    case SUSCAN_FIELD_TYPE_BOOLEAN:
+      return this->getBoolean() == other.getBoolean();
+  }
+
+  return false;
+}
+
 Config::Config()
 {
   this->instance = nullptr;
@@ -72,6 +96,24 @@ Config::get(std::string const &name) const
   return nullptr;
 }
 
+std::vector<std::string>
+Config::changedFields(Config const &other) const
+{
+  std::vector<std::string> changed;
+  bool sameDesc =
+      this->instance != nullptr
+      && other.instance != nullptr
+      && this->instance->desc == other.instance->desc
+      && this->fields.size() == other.fields.size();
+
+  // Same descriptor: fields are in the same order
+  for (size_t i = 0; i < this->fields.size(); ++i)
+    if (!sameDesc || !this->fields[i].sameValue(other.fields[i]))
+      changed.push_back(this->fields[i].getName());
+
+  return changed;
+}
+
 ConfigContext::ConfigContext(suscan_config_context_t *ctx)
 {
   this->ctx = ctx;
@@ -0,0 +1,293 @@
+//
+//    ConfigCache.cpp: Binary cache of parsed configuration files
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <Suscan/ConfigCache.h>
+#include <Suscan/Config.h>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QDir>
+#include <cstring>
+
+using namespace Suscan;
+
+///////////////////////////// ConfigCacheWriter ///////////////////////////////
+void
+ConfigCacheWriter::putU32(quint32 val)
+{
+  uchar bytes[4];
+
+  for (unsigned int i = 0; i < 4; ++i)
+    bytes[i] = static_cast<uchar>(val >> (8 * i));
+
+  this->data.append(reinterpret_cast<const char *>(bytes), 4);
+}
+
+void
+ConfigCacheWriter::putU64(quint64 val)
+{
+  this->putU32(static_cast<quint32>(val));
+  this->putU32(static_cast<quint32>(val >> 32));
+}
+
+void
+ConfigCacheWriter::putString(std::string const &str)
+{
+  this->putU32(static_cast<quint32>(str.size()));
+  this->data.append(str.data(), static_cast<int>(str.size()));
+}
+
+void
+ConfigCacheWriter::putString(QString const &str)
+{
+  this->putString(str.toStdString());
+}
+
+///////////////////////////// ConfigCacheReader ///////////////////////////////
+ConfigCacheReader::ConfigCacheReader(const uchar *data, size_t size)
+{
+  this->ptr = data;
+  this->end = data + size;
+}
+
+bool
+ConfigCacheReader::take(size_t size)
+{
+  if (!this->ok || static_cast<size_t>(this->end - this->ptr) < size) {
+    this->ok = false;
+    return false;
+  }
+
+  return true;
+}
+
+quint32
+ConfigCacheReader::getU32(void)
+{
+  quint32 val = 0;
+
+  if (!this->take(4))
+    return 0;
+
+  for (unsigned int i = 0; i < 4; ++i)
+    val |= static_cast<quint32>(this->ptr[i]) << (8 * i);
+
+  this->ptr += 4;
+
+  return val;
+}
+
+quint64
+ConfigCacheReader::getU64(void)
+{
+  quint64 lo = this->getU32();
+  quint64 hi = this->getU32();
+
+  return lo | (hi << 32);
+}
+
+std::string
+ConfigCacheReader::getString(void)
+{
+  size_t size = this->getU32();
+  std::string str;
+
+  if (!this->take(size))
+    return str;
+
+  str.assign(reinterpret_cast<const char *>(this->ptr), size);
+  this->ptr += size;
+
+  return str;
+}
+
+QString
+ConfigCacheReader::getQString(void)
+{
+  return QString::fromStdString(this->getString());
+}
+
+//////////////////////////////// ConfigCache ///////////////////////////////////
+ConfigCache::ConfigCache(std::string const &name, QStringList const &sources)
+{
+  const char *local = suscan_confdb_get_local_path();
+
+  if (local != nullptr)
+    this->path =
+        QString(local) + "/cache/" + QString::fromStdString(name) + ".bin";
+
+  for (auto &source : sources) {
+    QFileInfo info(source);
+
+    if (info.exists())
+      this->stamps.push_back(
+            Stamp {
+              info.absoluteFilePath(),
+              static_cast<quint64>(info.lastModified().toMSecsSinceEpoch()),
+              static_cast<quint64>(info.size())});
+  }
+}
+
+ConfigCache::~ConfigCache()
+{
+  if (this->map != nullptr)
+    this->file.unmap(this->map);
+}
+
+QByteArray
+ConfigCache::hashSources(void) const
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+
+  for (auto &stamp : this->stamps) {
+    QFile source(stamp.path);
+
+    if (!source.open(QIODevice::ReadOnly) || !hash.addData(&source))
+      return QByteArray();
+  }
+
+  return hash.result();
+}
+
+bool
+ConfigCache::open(ConfigCacheReader &reader)
+{
+  ConfigCacheReader header;
+  bool sameStamps = true;
+  quint64 size;
+  qint64 fileSize;
+
+  this->touched = false;
+
+  if (this->path.isEmpty())
+    return false;
+
+  this->file.setFileName(this->path);
+
+  if (!this->file.open(QIODevice::ReadOnly))
+    return false;
+
+  fileSize = this->file.size();
+  if (fileSize <= 0
+      || (this->map = this->file.map(0, fileSize)) == nullptr)
+    return false;
+
+  header = ConfigCacheReader(this->map, static_cast<size_t>(fileSize));
+
+  if (header.getU32() != SUSCAN_CONFIG_CACHE_MAGIC
+      || header.getU32() != SUSCAN_CONFIG_CACHE_VERSION
+      || header.getU32() != this->stamps.size())
+    return false;
+
+  for (auto &stamp : this->stamps) {
+    QString path = header.getQString();
+    quint64 mtime = header.getU64();
+
+    // A file was added, removed or resized: no point in hashing
+    if (path != stamp.path || header.getU64() != stamp.size)
+      return false;
+
+    if (mtime != stamp.mtime)
+      sameStamps = false;
+  }
+
+  std::string hash = header.getString();
+
+  if (!header.good())
+    return false;
+
+  if (!sameStamps) {
+    QByteArray current = this->hashSources();
+
+    if (current.isEmpty()
+        || current != QByteArray::fromStdString(hash))
+      return false;
+
+    this->touched = true;
+  }
+
+  size = header.getU64();
+
+  // The payload is what is left. Anything else is a truncated file.
+  if (!header.good() || header.remaining() != size)
+    return false;
+
+  reader = header;
+
+  return true;
+}
+
+bool
+ConfigCache::save(QByteArray const &payload)
+{
+  ConfigCacheWriter header;
+  QByteArray hash = this->hashSources();
+
+  if (this->path.isEmpty() || hash.isEmpty())
+    return false;
+
+  if (!QDir().mkpath(QFileInfo(this->path).absolutePath()))
+    return false;
+
+  header.putU32(SUSCAN_CONFIG_CACHE_MAGIC);
+  header.putU32(SUSCAN_CONFIG_CACHE_VERSION);
+  header.putU32(static_cast<quint32>(this->stamps.size()));
+
+  for (auto &stamp : this->stamps) {
+    header.putString(stamp.path);
+    header.putU64(stamp.mtime);
+    header.putU64(stamp.size);
+  }
+
+  header.putString(hash.toStdString());
+  header.putU64(static_cast<quint64>(payload.size()));
+
+  // Whoever maps the old one keeps seeing it: the new one is a new inode
+  QSaveFile out(this->path);
+
+  if (!out.open(QIODevice::WriteOnly))
+    return false;
+
+  out.write(header.bytes());
+  out.write(payload);
+
+  return out.commit();
+}
+
+QStringList
+ConfigCache::confDbSources(std::string const &context)
+{
+  QStringList sources;
+  QString pattern = QString::fromStdString(context) + ".*";
+  const char *paths[] = {
+    suscan_confdb_get_system_path(),
+    suscan_confdb_get_local_path()};
+
+  for (auto path : paths) {
+    if (path == nullptr)
+      continue;
+
+    QDir dir(path);
+
+    for (auto &file : dir.entryList(QStringList() << pattern, QDir::Files))
+      sources << dir.absoluteFilePath(file);
+  }
+
+  return sources;
+}
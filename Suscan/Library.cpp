@@ -21,14 +21,19 @@
 
 #include <Suscan/Library.h>
 #include <Suscan/MultitaskController.h>
+#include <Suscan/ConfigCache.h>
 #include <suscan.h>
 #include <analyzer/version.h>
 #include <QtGui>
+#include <QSaveFile>
+#include <algorithm>
 #include <Suscan/Plugin.h>
 #include <FeatureFactory.h>
 #include <ToolWidgetFactory.h>
 #include <TabWidgetFactory.h>
 #include <UIListenerFactory.h>
+#include <AudioDspFactory.h>
+#include <SampleConsumerFactory.h>
 #include <InspectionWidgetFactory.h>
 
 using namespace Suscan;
@@ -37,6 +42,26 @@ using namespace Suscan;
 Singleton *Singleton::instance = nullptr;
 Logger    *Singleton::logger   = nullptr;
 
+#define STEP(x) (1u << Singleton::x)
+
+// Only data that is not needed to bring up the main window is deferred
+const Singleton::InitStepInfo Singleton::initSteps[INIT_STEP_COUNT] = {
+  {"Loading signal sources",      &Singleton::init_sources,          0, true,  false},
+  {"Loading spectrum sources",    &Singleton::init_spectrum_sources, 0, false, false},
+  {"Loading estimators",          &Singleton::init_estimators,       0, false, false},
+  {"Loading inspectors",          &Singleton::init_inspectors,
+    STEP(INIT_SPECTRUM_SOURCES) | STEP(INIT_ESTIMATORS),               false, false},
+  {"Loading palettes",            &Singleton::init_palettes,         0, true,  false},
+  {"Loading frequency tables",    &Singleton::init_fats,             0, true,  true},
+  {"Loading bookmarks",           &Singleton::init_bookmarks,        0, true,  true},
+  {"Loading locations",           &Singleton::init_locations,        0, true,  false},
+  {"Loading TLE sources",         &Singleton::init_tle_sources,      0, true,  true},
+  {"Loading satellites from TLE", &Singleton::init_tle,              0, false, true},
+  {"Loading auto gains",          &Singleton::init_autogains,        0, true,  false},
+  {"Loading UI config",           &Singleton::init_ui_config,        0, true,  false},
+  {"Loading profile history",     &Singleton::init_recent_list,      0, true,  false}
+};
+
 #define STRINGFY(x) #x
 #define STORE(field) obj.set(STRINGFY(field), this->field)
 #define STORE_NAME(name, field) obj.set(name, this->field)
@@ -107,8 +132,14 @@ Singleton::Singleton()
   this->spectrum_sources_initd = false;
   this->inspectors_initd = false;
 
+  for (auto &state : this->initState)
+    state = INIT_PENDING;
+
   this->backgroundTaskController = new MultitaskController;
 
+  // Tasks running elsewhere share their parallel work with this pool
+  TaskPool::setShared(this->backgroundTaskController->getPool());
+
   // Define some read-only units. We may let the user add customized
   // units too.
 
@@ -130,6 +161,19 @@ Singleton::Singleton()
 
 Singleton::~Singleton()
 {
+  if (this->deferredThread.joinable())
+    this->deferredThread.join();
+
+  if (this->syncThread.joinable()) {
+    {
+      std::lock_guard<std::mutex> guard(this->syncMutex);
+      this->syncExit = true;
+    }
+
+    this->syncCond.notify_one();
+    this->syncThread.join();
+  }
+
   this->killBackgroundTaskController();
 }
 
@@ -161,6 +205,146 @@ Singleton::suscanVersion(void)
       + " (" + std::string(suscan_pkgversion()) + ")";
 }
 
+////////////////////////////////// Init graph ///////////////////////////////////
+bool
+Singleton::isInitDone(InitStep step) const
+{
+  std::lock_guard<std::mutex> lock(this->initMutex);
+
+  return this->initState[step] == INIT_DONE;
+}
+
+void
+Singleton::require(InitStep step) const
+{
+  std::unique_lock<std::mutex> lock(this->initMutex);
+
+  if (this->initState[step] == INIT_DONE)
+    return;
+
+  // Nobody took it yet: run it here. Accessors are const, steps are not.
+  if (this->initState[step] == INIT_PENDING) {
+    lock.unlock();
+    const_cast<Singleton *>(this)->runStep(step);
+    return;
+  }
+
+  this->initCond.wait(
+        lock,
+        [this, step] () { return this->initState[step] == INIT_DONE; });
+}
+
+void
+Singleton::runStep(InitStep step)
+{
+  InitStepInfo const &info = initSteps[step];
+  std::function<void (std::string const &)> progress;
+  std::exception_ptr error;
+  unsigned int i;
+
+  {
+    std::unique_lock<std::mutex> lock(this->initMutex);
+
+    // Somebody else got here first
+    if (this->initState[step] != INIT_PENDING) {
+      this->initCond.wait(
+            lock,
+            [this, step] () { return this->initState[step] == INIT_DONE; });
+      return;
+    }
+
+    this->initState[step] = INIT_RUNNING;
+    progress = this->initProgress;
+  }
+
+  for (i = 0; i < INIT_STEP_COUNT; ++i)
+    if (info.deps & (1u << i))
+      this->require(static_cast<InitStep>(i));
+
+  if (progress)
+    progress(info.message);
+
+  try {
+    if (info.confDb) {
+      std::lock_guard<std::mutex> guard(this->confDbMutex);
+      (this->*info.run)();
+    } else {
+      (this->*info.run)();
+    }
+  } catch (std::exception const &e) {
+    SU_ERROR("%s: %s\n", info.message, e.what());
+    error = std::current_exception();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->initMutex);
+
+    this->initState[step] = INIT_DONE;
+    if (error && !this->initError)
+      this->initError = error;
+  }
+
+  this->initCond.notify_all();
+}
+
+void
+Singleton::init(std::function<void (std::string const &)> const &progress)
+{
+  std::vector<std::thread> workers;
+  std::exception_ptr error;
+  unsigned int i;
+
+  {
+    std::lock_guard<std::mutex> lock(this->initMutex);
+    this->initProgress = progress;
+  }
+
+  // One thread per eager step. Each one waits for its dependencies and
+  // queues on the configuration database if needed.
+  for (i = 0; i < INIT_STEP_COUNT; ++i)
+    if (!initSteps[i].deferred)
+      workers.push_back(
+            std::thread(
+              [this, i] () {
+                this->runStep(static_cast<InitStep>(i));
+              }));
+
+  for (auto &worker : workers)
+    worker.join();
+
+  {
+    std::lock_guard<std::mutex> lock(this->initMutex);
+    this->initProgress = nullptr;
+    error = this->initError;
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+
+  if (!this->deferredThread.joinable())
+    this->deferredThread = std::thread(
+          [this] () {
+            for (unsigned int i = 0; i < INIT_STEP_COUNT; ++i)
+              if (initSteps[i].deferred)
+                this->runStep(static_cast<InitStep>(i));
+          });
+
+  if (!this->syncThread.joinable())
+    this->syncThread = std::thread(&Singleton::writeBehind, this);
+}
+
+void
+Singleton::waitForInit(void)
+{
+  unsigned int i;
+
+  for (i = 0; i < INIT_STEP_COUNT; ++i)
+    this->require(static_cast<InitStep>(i));
+
+  if (this->deferredThread.joinable())
+    this->deferredThread.join();
+}
+
 // Initialization methods
 static SUBOOL
 walk_all_sources(suscan_source_config_t *config, void *privdata)
@@ -201,7 +385,8 @@ Singleton::init_sources(void)
   if (!this->sources_initd) {
     SU_ATTEMPT(suscan_init_sources());
     suscan_source_config_walk(walk_all_sources, static_cast<void *>(this));
-    suscan_source_device_walk(walk_all_devices, static_cast<void *>(this));
+    this->refreshDevices();
+    this->loadKnownDevices();
     this->sources_initd = true;
   }
 }
@@ -322,10 +507,181 @@ Singleton::init_autogains(void)
   }
 }
 
+// Object trees, as they come from the configuration database
+static void
+putObjectTree(ConfigCacheWriter &w, suscan_object_t *obj)
+{
+  enum suscan_object_type type;
+  const char *str;
+  unsigned int i, count;
+
+  // Never expected, but keep the stream well-formed
+  if (obj == nullptr) {
+    w.putU32(static_cast<quint32>(SUSCAN_OBJECT_TYPE_FIELD));
+    w.putString(std::string());
+    return;
+  }
+
+  type = suscan_object_get_type(obj);
+  w.putU32(static_cast<quint32>(type));
+
+  switch (type) {
+    case SUSCAN_OBJECT_TYPE_FIELD:
+      str = suscan_object_get_value(obj);
+      w.putString(std::string(str == nullptr ? "" : str));
+      break;
+
+    case SUSCAN_OBJECT_TYPE_OBJECT:
+      str = suscan_object_get_class(obj);
+      w.putString(std::string(str == nullptr ? "" : str));
+
+      count = suscan_object_field_count(obj);
+      w.putU32(count);
+
+      for (i = 0; i < count; ++i) {
+        suscan_object_t *field = suscan_object_get_field_by_index(obj, i);
+        str = field == nullptr ? nullptr : suscan_object_get_name(field);
+
+        w.putString(std::string(str == nullptr ? "" : str));
+        putObjectTree(w, field);
+      }
+      break;
+
+    case SUSCAN_OBJECT_TYPE_SET:
+      count = suscan_object_set_get_count(obj);
+      w.putU32(count);
+
+      for (i = 0; i < count; ++i)
+        putObjectTree(w, suscan_object_set_get(obj, i));
+      break;
+  }
+}
+
+static suscan_object_t *
+getObjectTree(ConfigCacheReader &r)
+{
+  enum suscan_object_type type =
+      static_cast<enum suscan_object_type>(r.getU32());
+  suscan_object_t *obj = nullptr;
+  suscan_object_t *child = nullptr;
+  std::string str;
+  unsigned int i, count;
+
+  if (!r.good()
+      || (type != SUSCAN_OBJECT_TYPE_FIELD
+          && type != SUSCAN_OBJECT_TYPE_OBJECT
+          && type != SUSCAN_OBJECT_TYPE_SET))
+    return nullptr;
+
+  if ((obj = suscan_object_new(type)) == nullptr)
+    return nullptr;
+
+  switch (type) {
+    case SUSCAN_OBJECT_TYPE_FIELD:
+      str = r.getString();
+      if (!suscan_object_set_value(obj, str.c_str()))
+        goto fail;
+      break;
+
+    case SUSCAN_OBJECT_TYPE_OBJECT:
+      str = r.getString();
+      if (!str.empty() && !suscan_object_set_class(obj, str.c_str()))
+        goto fail;
+
+      count = r.getU32();
+      for (i = 0; i < count && r.good(); ++i) {
+        str = r.getString();
+
+        if ((child = getObjectTree(r)) == nullptr
+            || !suscan_object_set_field(obj, str.c_str(), child))
+          goto fail;
+
+        child = nullptr;
+      }
+      break;
+
+    case SUSCAN_OBJECT_TYPE_SET:
+      count = r.getU32();
+      for (i = 0; i < count && r.good(); ++i) {
+        if ((child = getObjectTree(r)) == nullptr
+            || !suscan_object_set_append(obj, child))
+          goto fail;
+
+        child = nullptr;
+      }
+      break;
+  }
+
+  if (r.good())
+    return obj;
+
+fail:
+  if (child != nullptr)
+    suscan_object_destroy(child);
+  suscan_object_destroy(obj);
+
+  return nullptr;
+}
+
+void
+Singleton::saveFATCache(ConfigCache &cache)
+{
+  ConfigCacheWriter w;
+
+  w.putU32(static_cast<quint32>(this->FATs.size()));
+
+  for (auto &fat : this->FATs)
+    putObjectTree(w, fat.getInstance());
+
+  (void) cache.save(w.bytes());
+}
+
+bool
+Singleton::loadFATCache(ConfigCache &cache)
+{
+  ConfigCacheReader r;
+  unsigned int i, count;
+
+  if (!cache.open(r))
+    return false;
+
+  // The cached set owns the trees, FATs borrows them (as it does from
+  // the configuration database)
+  this->cachedFATs = Object(SUSCAN_OBJECT_TYPE_SET);
+  count = r.getU32();
+
+  for (i = 0; i < count; ++i) {
+    suscan_object_t *fat = getObjectTree(r);
+
+    if (fat == nullptr
+        || !suscan_object_set_append(this->cachedFATs.getInstance(), fat)) {
+      if (fat != nullptr)
+        suscan_object_destroy(fat);
+      this->cachedFATs.clear();
+      return false;
+    }
+  }
+
+  for (i = 0; i < count; ++i)
+    this->FATs.push_back(this->cachedFATs[i]);
+
+  if (cache.needsRefresh())
+    this->saveFATCache(cache);
+
+  return true;
+}
+
 void
 Singleton::init_fats(void)
 {
   unsigned int i, count;
+  ConfigCache cache(
+        "frequency_allocations",
+        ConfigCache::confDbSources("frequency_allocations"));
+
+  if (this->loadFATCache(cache))
+    return;
+
   ConfigContext ctx("frequency_allocations");
   Object list = ctx.listObject();
 
@@ -339,10 +695,83 @@ Singleton::init_fats(void)
         this->FATs.push_back(list[i]);
     } catch (Suscan::Exception const &) { }
   }
+
+  this->saveFATCache(cache);
+}
+
+void
+Singleton::saveBookmarkCache(ConfigCache &cache)
+{
+  ConfigCacheWriter w;
+
+  w.putU32(static_cast<quint32>(this->bookmarks.size()));
+
+  for (auto &bm : this->bookmarks) {
+    w.putString(bm.info.name);
+    w.putU64(static_cast<quint64>(bm.info.frequency));
+    w.putString(bm.info.color.name());
+    w.putU32(static_cast<quint32>(bm.info.lowFreqCut));
+    w.putU32(static_cast<quint32>(bm.info.highFreqCut));
+    w.putString(bm.info.modulation);
+    w.putU32(static_cast<quint32>(bm.entry));
+  }
+
+  (void) cache.save(w.bytes());
+}
+
+bool
+Singleton::loadBookmarkCache(ConfigCache &cache)
+{
+  ConfigCacheReader r;
+  unsigned int i, count;
+
+  if (!cache.open(r))
+    return false;
+
+  count = r.getU32();
+
+  for (i = 0; i < count && r.good(); ++i) {
+    Bookmark bm;
+
+    bm.info.name        = r.getQString();
+    bm.info.frequency   = static_cast<qint64>(r.getU64());
+    bm.info.color       = QColor(r.getQString());
+    bm.info.lowFreqCut  = static_cast<int>(r.getU32());
+    bm.info.highFreqCut = static_cast<int>(r.getU32());
+    bm.info.modulation  = r.getQString();
+    bm.entry            = static_cast<int>(r.getU32());
+
+    this->bookmarks[bm.info.frequency] = bm;
+  }
+
+  if (!r.good()) {
+    this->bookmarks.clear();
+    return false;
+  }
+
+  if (cache.needsRefresh())
+    this->saveBookmarkCache(cache);
+
+  return true;
 }
 
 void
 Singleton::init_bookmarks(void)
+{
+  ConfigCache cache("bookmarks", ConfigCache::confDbSources("bookmarks"));
+
+  // Entries keep pointing to the right list items: the cache is only
+  // valid while the file is what was parsed into it.
+  if (!this->loadBookmarkCache(cache)) {
+    this->parseBookmarks();
+    this->saveBookmarkCache(cache);
+  }
+
+  ++this->bookmarkRevision;
+}
+
+void
+Singleton::parseBookmarks(void)
 {
   unsigned int i, count;
   ConfigContext ctx("bookmarks");
@@ -459,21 +888,63 @@ void
 Singleton::init_tle(void)
 {
   const char *userTLEDir;
+  QStringList files;
 
-  if ((userTLEDir = suscan_confdb_get_local_tle_path()) != nullptr) {
-    QDirIterator it(userTLEDir, QDirIterator::NoIteratorFlags);
+  if ((userTLEDir = suscan_confdb_get_local_tle_path()) == nullptr)
+    return;
 
-    while (it.hasNext()) {
-      QFile f(it.next());
-      QFileInfo fi(f);
+  QDirIterator it(userTLEDir, QDirIterator::NoIteratorFlags);
 
-      if (fi.completeSuffix().toLower() == "tle") {
-        Orbit orbit;
-        if (orbit.loadFromFile(f.fileName().toStdString().c_str()))
-          this->satellites[orbit.nameToQString()] = orbit;
-      }
+  while (it.hasNext()) {
+    QFileInfo fi(it.next());
+
+    if (fi.isFile() && fi.completeSuffix().toLower() == "tle")
+      files << fi.absoluteFilePath();
+  }
+
+  // Catalogs may be thousands of files. Checking their stamps is much
+  // cheaper than opening every one of them.
+  files.sort();
+
+  ConfigCache cache("tle", files);
+  ConfigCacheReader r;
+  std::vector<std::string> tles;
+  bool cached = false;
+
+  if (cache.open(r)) {
+    unsigned int i, count = r.getU32();
+
+    for (i = 0; i < count && r.good(); ++i)
+      tles.push_back(r.getString());
+
+    if (!(cached = r.good()))
+      tles.clear();
+  }
+
+  if (!cached) {
+    for (auto &path : files) {
+      QFile f(path);
+
+      if (f.open(QIODevice::ReadOnly))
+        tles.push_back(f.readAll().toStdString());
     }
   }
+
+  for (auto &tle : tles) {
+    Orbit orbit;
+    if (orbit.loadFromTLE(tle))
+      this->satellites[orbit.nameToQString()] = orbit;
+  }
+
+  if (!cached || cache.needsRefresh()) {
+    ConfigCacheWriter w;
+
+    w.putU32(static_cast<quint32>(tles.size()));
+    for (auto &tle : tles)
+      w.putString(tle);
+
+    (void) cache.save(w.bytes());
+  }
 }
 
 void
@@ -499,37 +970,143 @@ Singleton::init_plugins(void)
     auto asStd = path.toStdString();
 
     for (auto file : files) {
-      auto fullPath = (path + "/" + file).toStdString();
-      auto plugin = Suscan::Plugin::make(fullPath.c_str());
-
-      if (plugin != nullptr) {
-        if (!plugin->load()) {
-          SU_WARNING("Plugin %s failed to load\n", fullPath.c_str());
-          delete plugin;
-        }
-
-        // TODO: register plugin here!!
-      } else {
-        printf("Failed to make plugin.\n");
-      }
+      if (file.endsWith(SUSCAN_PLUGIN_MANIFEST_SUFFIX))
+        continue;
+
+      this->registerPlugin((path + "/" + file).toStdString());
     }
   }
 }
 
+bool
+Singleton::registerPlugin(std::string const &fullPath)
+{
+  PluginManifest manifest;
+  Plugin *plugin;
+
+  // With a manifest, plugins that only provide factories looked up by
+  // name are not opened until one of them is needed.
+  if (PluginManifest::read(
+        manifest,
+        fullPath + SUSCAN_PLUGIN_MANIFEST_SUFFIX)
+      && !manifest.eager
+      && !(manifest.tabFactories.isEmpty()
+           && manifest.inspectionFactories.isEmpty())) {
+    plugin = Plugin::makeDeferred(fullPath.c_str(), manifest);
+
+    for (auto const &p : manifest.tabFactories)
+      this->deferredTabFactories[p.first] =
+          DeferredFactory {plugin, p.second};
+
+    for (auto const &p : manifest.inspectionFactories)
+      this->deferredInspectionFactories[p.first] =
+          DeferredFactory {plugin, p.second};
+
+    return true;
+  }
+
+  plugin = Plugin::make(fullPath.c_str());
+
+  if (plugin == nullptr) {
+    printf("Failed to make plugin.\n");
+    return false;
+  }
+
+  if (!plugin->load()) {
+    SU_WARNING("Plugin %s failed to load\n", fullPath.c_str());
+    delete plugin;
+    return false;
+  }
+
+  // TODO: register plugin here!!
+  return true;
+}
+
+bool
+Singleton::loadDeferredPlugin(Plugin *plugin) const
+{
+  bool ok = plugin->load();
+
+  // Whatever happens, the manifest has been superseded by the plugin
+  QMap<QString, DeferredFactory> *tables[] = {
+    &this->deferredTabFactories,
+    &this->deferredInspectionFactories};
+
+  for (auto table : tables) {
+    for (auto p = table->begin(); p != table->end();) {
+      if (p->plugin == plugin)
+        p = table->erase(p);
+      else
+        ++p;
+    }
+  }
+
+  if (!ok) {
+    SU_WARNING("Plugin %s failed to load\n", plugin->path().c_str());
+    delete plugin;
+  }
+
+  return ok;
+}
+
+static bool
+sameDeviceListing(
+    std::vector<Source::Device> const &a,
+    std::vector<Source::Device> const &b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  for (size_t i = 0; i < a.size(); ++i)
+    if (!a[i].equals(b[i]) || a[i].isAvailable() != b[i].isAvailable())
+      return false;
+
+  return true;
+}
+
 void
 Singleton::refreshDevices(void)
 {
+  // The previous listing is kept aside (capacity included) to compare
+  // against, and becomes the buffer of the next refresh.
+  this->devicesScratch.swap(this->devices);
   this->devices.clear();
   suscan_source_device_walk(walk_all_devices, static_cast<void *>(this));
+
+  // Listed by name, not in detection order
+  std::stable_sort(
+        this->devices.begin(),
+        this->devices.end(),
+        [] (Source::Device const &a, Source::Device const &b) {
+          int cmp = a.getDesc().compare(b.getDesc());
+          return cmp == 0 ? a.getDriver() < b.getDriver() : cmp < 0;
+        });
+
+  if (!sameDeviceListing(this->devicesScratch, this->devices))
+    ++this->deviceRevision;
+
+  this->devicesScratch.clear();
 }
 
 void
 Singleton::refreshNetworkProfiles(void)
 {
-  this->networkProfiles.clear();
+  // Entries are updated in place. Only names appearing or vanishing
+  // count as a change of the listing.
+  this->networkProfilesSeen.clear();
   suscan_discovered_remote_device_walk(
         walk_all_remote_devices,
         static_cast<void *>(this));
+
+  for (auto it = this->networkProfiles.begin();
+       it != this->networkProfiles.end();) {
+    if (!this->networkProfilesSeen.contains(it.key())) {
+      it = this->networkProfiles.erase(it);
+      ++this->networkProfileRevision;
+    } else {
+      ++it;
+    }
+  }
 }
 
 bool
@@ -547,16 +1124,94 @@ Singleton::getQth(void) const
 void
 Singleton::setQth(Location const &loc)
 {
+  std::lock_guard<std::mutex> guard(this->syncMutex);
+
   this->qth = loc;
   this->have_qth = true;
   suscan_set_qth(&loc.site);
+  this->markDirty(SYNC_LOCATIONS);
 }
 
 void
 Singleton::detect_devices(void)
 {
   suscan_source_detect_devices();
+}
+
+void
+Singleton::commitDetectedDevices(void)
+{
+  bool hadMissing = !this->getMissingDevices().empty();
+
   this->refreshDevices();
+
+  this->knownDevices.clear();
+  for (auto const &dev : this->devices)
+    if (dev.isAvailable() && !dev.isRemote())
+      this->knownDevices.push_back(
+            DeviceSummary {dev.getDesc(), dev.getDriver()});
+
+  this->devicesDetected = true;
+  this->saveKnownDevices();
+
+  // The entries listed from the previous session are gone now
+  if (hadMissing)
+    ++this->deviceRevision;
+}
+
+QString
+Singleton::knownDevicesPath(void)
+{
+  const char *local = suscan_confdb_get_local_path();
+
+  if (local == nullptr)
+    return QString();
+
+  return QString(local) + "/cache/" + SIGDIGGER_KNOWN_DEVICES_FILE;
+}
+
+void
+Singleton::loadKnownDevices(void)
+{
+  QFile file(knownDevicesPath());
+
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    return;
+
+  // One device per line: driver and description, tab-separated
+  while (!file.atEnd()) {
+    QStringList fields =
+        QString::fromUtf8(file.readLine()).trimmed().split('\t');
+
+    if (fields.size() == 2)
+      this->knownDevices.push_back(
+            DeviceSummary {
+              fields[1].toStdString(),
+              fields[0].toStdString()});
+  }
+}
+
+void
+Singleton::saveKnownDevices(void)
+{
+  QString path = knownDevicesPath();
+
+  if (path.isEmpty() || !QDir().mkpath(QFileInfo(path).absolutePath()))
+    return;
+
+  QSaveFile file(path);
+
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    return;
+
+  QTextStream out(&file);
+
+  for (auto const &dev : this->knownDevices)
+    out << QString::fromStdString(dev.driver) << "\t"
+        << QString::fromStdString(dev.desc) << "\n";
+
+  out.flush();
+  file.commit();
 }
 
 void
@@ -596,14 +1251,14 @@ Singleton::init_recent_list(void)
 }
 
 void
-Singleton::syncRecent(void)
+Singleton::syncRecent(std::list<std::string> const &recent)
 {
   ConfigContext ctx("recent");
   Object list = ctx.listObject();
 
   list.clear();
 
-  for (auto p : this->recentProfiles) {
+  for (auto p : recent) {
     try {
       list.append(Object::makeField(p));
     } catch (Suscan::Exception const &) {
@@ -613,7 +1268,9 @@ Singleton::syncRecent(void)
 }
 
 void
-Singleton::syncLocations(void)
+Singleton::syncLocations(
+    QMap<QString, Location> const &locations,
+    Location const *qth)
 {
   ConfigContext ctx("user_locations");
   Object list = ctx.listObject();
@@ -621,7 +1278,7 @@ Singleton::syncLocations(void)
   // Save all user locations
   list.clear();
 
-  for (auto p : this->locations) {
+  for (auto p : locations) {
     try {
       if (p.userLocation)
         list.append(p.serialize());
@@ -631,77 +1288,246 @@ Singleton::syncLocations(void)
   }
 
   // Save QTH, if defined
-  if (this->have_qth) {
+  if (qth != nullptr) {
+    Location copy = *qth;
     ConfigContext ctx("qth");
     Object list = ctx.listObject();
     list.clear();
-    list.append(this->qth.serialize());
+    list.append(copy.serialize());
+  }
+}
+
+void
+Singleton::syncTLESources(QMap<std::string, TLESource> const &tleSources)
+{
+  ConfigContext ctx("user_tle");
+  Object list = ctx.listObject();
+
+  // Save all user TLE sources
+  list.clear();
+
+  for (auto p : tleSources) {
+    try {
+      if (p.user)
+        list.append(p.serialize());
+    } catch (Suscan::Exception const &) {
+      // Don't even bother to warn
+    }
+  }
+}
+
+void
+Singleton::syncUI(void)
+{
+  unsigned int i, count;
+  ConfigContext ctx("uiconfig");
+  Object list = ctx.listObject();
+
+  count = static_cast<unsigned int>(this->uiConfig.size());
+
+  // Sync all modified configurations
+  for (i = 0; i < count; ++i) {
+    if (!this->uiConfig[i].isBorrowed()) {
+      try {
+        list.put(this->uiConfig[i], i);
+      } catch (Suscan::Exception const &) {
+        list.append(this->uiConfig[i]);
+      }
+    }
   }
 }
 
 void
-Singleton::syncTLESources(void)
+Singleton::syncBookmarks(QMap<qint64, Bookmark> const &bookmarks)
+{
+  ConfigContext ctx("bookmarks");
+  Object list = ctx.listObject();
+
+  // The file is rewritten as a whole anyway. Rebuilding the list keeps it
+  // in the order of the map and spares us from tracking list positions.
+  list.clear();
+
+  for (auto &bm : bookmarks) {
+    try {
+      Object obj(SUSCAN_OBJECT_TYPE_OBJECT);
+
+      obj.set("name", bm.info.name.toStdString());
+      obj.set("frequency", static_cast<double>(bm.info.frequency));
+      obj.set("color", bm.info.color.name().toStdString());
+      obj.set("low_freq_cut", bm.info.lowFreqCut);
+      obj.set("high_freq_cut", bm.info.highFreqCut);
+      obj.set("modulation", bm.info.modulation.toStdString());
+
+      list.append(std::move(obj));
+    } catch (Suscan::Exception const &) {
+    }
+  }
+}
+
+bool
+Singleton::writeContext(std::string const &name)
+{
+  const char *local = suscan_confdb_get_local_path();
+  std::vector<char> data;
+
+  if (local == nullptr)
+    return false;
+
+  {
+    std::lock_guard<std::mutex> guard(this->confDbMutex);
+    ConfigContext ctx(name);
+
+    data = ctx.listObject().serialize();
+  }
+
+  // Temporary file + rename: a crash halfway leaves the old file intact
+  QSaveFile file(QString(local) + "/" + QString::fromStdString(name) + ".xml");
+
+  if (!file.open(QIODevice::WriteOnly)
+      || file.write(data.data(), static_cast<qint64>(data.size()))
+         != static_cast<qint64>(data.size())
+      || !file.commit()) {
+    SU_WARNING("Failed to write config context %s\n", name.c_str());
+    return false;
+  }
+
+  // Written: do not let saveAll() write it again
+  {
+    std::lock_guard<std::mutex> guard(this->confDbMutex);
+    ConfigContext(name).setSave(false);
+  }
+
+  return true;
+}
+
+void
+Singleton::markDirty(SyncItem item)
+{
+  // Called with syncMutex held
+  this->dirty |= 1u << item;
+  this->syncCond.notify_one();
+}
+
+unsigned int
+Singleton::takeDirty(void)
+{
+  std::lock_guard<std::mutex> guard(this->syncMutex);
+  unsigned int mask = this->dirty;
+
+  this->dirty = 0;
+
+  return mask;
+}
+
+void
+Singleton::flush(unsigned int mask)
 {
-  ConfigContext ctx("user_tle");
-  Object list = ctx.listObject();
+  std::list<std::string> recent;
+  QMap<qint64, Bookmark> bookmarks;
+  QMap<QString, Location> locations;
+  QMap<std::string, TLESource> tleSources;
+  Location qth;
+  bool haveQth = false;
 
-  // Save all user TLE sources
-  list.clear();
+  std::lock_guard<std::mutex> flushGuard(this->flushMutex);
 
-  for (auto p : this->tleSources) {
-    try {
-      if (p.user)
-        list.append(p.serialize());
-    } catch (Suscan::Exception const &) {
-      // Don't even bother to warn
+  // Snapshots are cheap: Qt containers are implicitly shared
+  {
+    std::lock_guard<std::mutex> guard(this->syncMutex);
+
+    if (mask & (1u << SYNC_RECENT))
+      recent = this->recentProfiles;
+
+    if (mask & (1u << SYNC_BOOKMARKS))
+      bookmarks = this->bookmarks;
+
+    if (mask & (1u << SYNC_LOCATIONS)) {
+      locations = this->locations;
+      qth = this->qth;
+      haveQth = this->have_qth;
     }
+
+    if (mask & (1u << SYNC_TLE_SOURCES))
+      tleSources = this->tleSources;
   }
-}
 
-void
-Singleton::syncUI(void)
-{
-  unsigned int i, count;
-  ConfigContext ctx("uiconfig");
-  Object list = ctx.listObject();
+  try {
+    if (mask & (1u << SYNC_RECENT)) {
+      {
+        std::lock_guard<std::mutex> guard(this->confDbMutex);
+        this->syncRecent(recent);
+      }
+      this->writeContext("recent");
+    }
 
-  count = static_cast<unsigned int>(this->uiConfig.size());
+    // UI objects are not copied: only sync() writes them, from the thread
+    // that owns them.
+    if (mask & (1u << SYNC_UI)) {
+      {
+        std::lock_guard<std::mutex> guard(this->confDbMutex);
+        this->syncUI();
+      }
+      this->writeContext("uiconfig");
+    }
 
-  // Sync all modified configurations
-  for (i = 0; i < count; ++i) {
-    if (!this->uiConfig[i].isBorrowed()) {
-      try {
-        list.put(this->uiConfig[i], i);
-      } catch (Suscan::Exception const &) {
-        list.append(this->uiConfig[i]);
+    if (mask & (1u << SYNC_BOOKMARKS)) {
+      {
+        std::lock_guard<std::mutex> guard(this->confDbMutex);
+        this->syncBookmarks(bookmarks);
+      }
+      this->writeContext("bookmarks");
+    }
+
+    if (mask & (1u << SYNC_LOCATIONS)) {
+      {
+        std::lock_guard<std::mutex> guard(this->confDbMutex);
+        this->syncLocations(locations, haveQth ? &qth : nullptr);
       }
+      this->writeContext("user_locations");
+      if (haveQth)
+        this->writeContext("qth");
     }
+
+    if (mask & (1u << SYNC_TLE_SOURCES)) {
+      {
+        std::lock_guard<std::mutex> guard(this->confDbMutex);
+        this->syncTLESources(tleSources);
+      }
+      this->writeContext("user_tle");
+    }
+  } catch (Suscan::Exception const &e) {
+    SU_WARNING("Failed to sync configuration: %s\n", e.what());
   }
 }
 
 void
-Singleton::syncBookmarks(void)
+Singleton::writeBehind(void)
 {
-  ConfigContext ctx("bookmarks");
-  Object list = ctx.listObject();
+  std::unique_lock<std::mutex> lock(this->syncMutex);
+  const unsigned int background = ~(1u << SYNC_UI);
 
-  // Sync all modified configurations
-  for (auto p : this->bookmarks.keys()) {
-    if (this->bookmarks[p].entry == -1) {
-      try {
-        Object obj(SUSCAN_OBJECT_TYPE_OBJECT);
+  for (;;) {
+    this->syncCond.wait(
+          lock,
+          [this, background] () {
+            return this->syncExit || (this->dirty & background);
+          });
 
-        obj.set("name", this->bookmarks[p].info.name.toStdString());
-        obj.set("frequency", static_cast<double>(this->bookmarks[p].info.frequency));
-        obj.set("color", this->bookmarks[p].info.color.name().toStdString());
-        obj.set("low_freq_cut", this->bookmarks[p].info.lowFreqCut);
-        obj.set("high_freq_cut", this->bookmarks[p].info.highFreqCut);
-        obj.set("modulation", this->bookmarks[p].info.modulation.toStdString());
+    if (this->syncExit)
+      break;
 
-        list.append(std::move(obj));
-      } catch (Suscan::Exception const &) {
-      }
-    }
+    // Let a burst of changes settle before writing them
+    this->syncCond.wait_for(
+          lock,
+          std::chrono::milliseconds(SIGDIGGER_SYNC_COALESCE_MS),
+          [this] () { return this->syncExit; });
+
+    unsigned int mask = this->dirty & background;
+    this->dirty &= ~background;
+
+    lock.unlock();
+    this->flush(mask);
+    lock.lock();
   }
 }
 
@@ -709,6 +1535,7 @@ void
 Singleton::killBackgroundTaskController(void)
 {
   if (this->backgroundTaskController != nullptr) {
+    TaskPool::setShared(nullptr);
     delete this->backgroundTaskController;
     this->backgroundTaskController = nullptr;
   }
@@ -717,11 +1544,24 @@ Singleton::killBackgroundTaskController(void)
 void
 Singleton::sync(void)
 {
-  this->syncRecent();
-  this->syncUI();
-  this->syncBookmarks();
-  this->syncLocations();
-  this->syncTLESources();
+  this->waitForInit();
+
+  // The UI configuration is only handed over right before this call
+  this->flush(this->takeDirty() | (1u << SYNC_UI));
+
+  // Whatever is still marked for saving was not changed. Keep saveAll()
+  // from rewriting it.
+  {
+    const char *contexts[] = {
+      "recent", "bookmarks", "user_locations", "qth", "user_tle"};
+    suscan_config_context_t *ctx;
+
+    std::lock_guard<std::mutex> guard(this->confDbMutex);
+
+    for (auto name : contexts)
+      if ((ctx = suscan_config_context_lookup(name)) != nullptr)
+        ConfigContext(ctx).setSave(false);
+  }
 }
 
 // Singleton methods
@@ -741,6 +1581,10 @@ Singleton::registerNetworkProfile(const suscan_source_config_t *config)
 {
   QString name = QString(suscan_source_config_get_label(config));
 
+  if (!this->networkProfiles.contains(name))
+    ++this->networkProfileRevision;
+
+  this->networkProfilesSeen.insert(name);
   this->networkProfiles[name] = Suscan::Source::Config::wrap(
         suscan_source_config_clone(config));
 }
@@ -785,43 +1629,80 @@ Singleton::saveProfile(Suscan::Source::Config const &profile)
 void
 Singleton::removeBookmark(qint64 freq)
 {
-  if (this->bookmarks.find(freq) != this->bookmarks.end()) {
-    Bookmark bm = this->bookmarks[freq];
-    this->bookmarks.remove(freq);
+  this->require(INIT_BOOKMARKS);
 
-    if (bm.entry != -1) {
-      ConfigContext ctx("bookmarks");
-      Object list = ctx.listObject();
-      list.remove(static_cast<unsigned>(bm.entry));
-    }
+  std::lock_guard<std::mutex> guard(this->syncMutex);
+
+  if (this->bookmarks.remove(freq) > 0) {
+    ++this->bookmarkRevision;
+    this->markDirty(SYNC_BOOKMARKS);
   }
 }
 
 void
 Singleton::replaceBookmark(BookmarkInfo const& info)
 {
+  this->require(INIT_BOOKMARKS);
+
   Bookmark bm;
 
   bm.info = info;
 
-  this->removeBookmark(info.frequency);
+  std::lock_guard<std::mutex> guard(this->syncMutex);
+
   this->bookmarks[info.frequency] = bm;
+  ++this->bookmarkRevision;
+  this->markDirty(SYNC_BOOKMARKS);
 }
 
 bool
 Singleton::registerBookmark(BookmarkInfo const& info)
 {
+  this->require(INIT_BOOKMARKS);
+
   if (this->bookmarks.find(info.frequency) != this->bookmarks.end())
     return false;
 
   Bookmark bm;
 
   bm.info = info;
+
+  std::lock_guard<std::mutex> guard(this->syncMutex);
+
   this->bookmarks[info.frequency] = bm;
+  ++this->bookmarkRevision;
+  this->markDirty(SYNC_BOOKMARKS);
 
   return true;
 }
 
+int
+Singleton::registerBookmarks(QList<BookmarkInfo> const &list)
+{
+  this->require(INIT_BOOKMARKS);
+
+  int count = 0;
+
+  std::lock_guard<std::mutex> guard(this->syncMutex);
+
+  for (auto const &info : list) {
+    if (!this->bookmarks.contains(info.frequency)) {
+      Bookmark bm;
+
+      bm.info = info;
+      this->bookmarks.insert(info.frequency, bm);
+      ++count;
+    }
+  }
+
+  if (count > 0) {
+    ++this->bookmarkRevision;
+    this->markDirty(SYNC_BOOKMARKS);
+  }
+
+  return count;
+}
+
 bool
 Singleton::registerLocation(Location const& loc)
 {
@@ -833,7 +1714,10 @@ Singleton::registerLocation(Location const& loc)
   newLoc = loc;
   newLoc.userLocation = true;
 
+  std::lock_guard<std::mutex> guard(this->syncMutex);
+
   this->locations[newLoc.getLocationName()] = newLoc;
+  this->markDirty(SYNC_LOCATIONS);
 
   return true;
 }
@@ -846,38 +1730,266 @@ Singleton::normalizeTLEName(QString const &name)
   return name.trimmed().replace(QRegExp("[^-a-zA-Z0-9()]"), "_");
 }
 
+///////////////////////////// Bulk TLE ingestion ///////////////////////////////
+struct TLERecord {
+  Orbit orbit;
+  std::string text;
+};
+
+static bool
+tle_line_is(const char *line, const char *end, char number)
+{
+  return end - line >= 2 && line[0] == number && line[1] == ' ';
+}
+
+static const char *
+tle_next_line(const char *line, const char *end)
+{
+  while (line < end && *line != '\n')
+    ++line;
+
+  return line < end ? line + 1 : end;
+}
+
+// First record starting at or after p, but not before floor. Records are
+// an optional title line followed by lines 1 and 2.
+static const char *
+tle_record_start(const char *p, const char *floor, const char *end)
+{
+  const char *prev = nullptr;
+  const char *line;
+
+  // Go to the beginning of the line p is in
+  while (p > floor && p[-1] != '\n')
+    --p;
+
+  for (line = p; line < end; line = tle_next_line(line, end)) {
+    const char *next = tle_next_line(line, end);
+
+    if (tle_line_is(line, end, '1') && tle_line_is(next, end, '2')) {
+      if (prev != nullptr && !tle_line_is(prev, end, '2'))
+        return prev;
+      return line;
+    }
+
+    prev = line;
+  }
+
+  return end;
+}
+
+static void
+tle_parse_range(const char *data, size_t size, std::vector<TLERecord> &out)
+{
+  orbit_t orbit = orbit_INITIALIZER;
+  SUSDIFF got;
+
+  while ((got = orbit_init_from_data(&orbit, data, size)) > 0) {
+    TLERecord record;
+
+    record.orbit = Orbit(&orbit);
+    record.text.assign(data, static_cast<size_t>(got));
+    out.push_back(record);
+    orbit_finalize(&orbit);
+
+    data += got;
+    size -= static_cast<size_t>(got);
+  }
+}
+
+static bool
+tle_newer(orbit_t const &a, orbit_t const &b)
+{
+  return a.ep_year > b.ep_year
+      || (a.ep_year == b.ep_year && a.ep_day >= b.ep_day);
+}
+
+template<class T, class F> static void
+run_parallel(std::vector<T> &items, F func)
+{
+  std::vector<std::thread> workers;
+
+  for (size_t i = 1; i < items.size(); ++i)
+    workers.push_back(std::thread(func, std::ref(items[i])));
+
+  if (!items.empty())
+    func(items[0]);
+
+  for (auto &worker : workers)
+    worker.join();
+}
+
+bool
+Singleton::saveTLE(QString const &dir, Orbit const &orbit, std::string const &text)
+{
+  QFile qFile(dir + "/" + normalizeTLEName(orbit.nameToQString()) + ".tle");
+
+  if (!qFile.open(QIODevice::WriteOnly))
+    return false;
+
+  qFile.write(text.data(), static_cast<qint64>(text.size()));
+  qFile.close();
+
+  return qFile.error() == QFileDevice::NoError;
+}
+
+unsigned int
+Singleton::registerTLEs(std::string const &catalog)
+{
+  struct Slice {
+    const char *start;
+    const char *end;
+    std::vector<TLERecord> records;
+  };
+
+  this->require(INIT_TLE);
+
+  const char *userTLEDir = suscan_confdb_get_local_tle_path();
+  const char *data = catalog.data();
+  const char *end  = data + catalog.size();
+  const char *p = data;
+  unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<Slice> slices;
+  std::vector<TLERecord *> unique;
+  QHash<int, size_t> bySatno; // Index in unique
+  QHash<int, QString> satnoNames;
+  QString dir;
+  unsigned int i, count = 0;
+
+  if (userTLEDir == nullptr)
+    return 0;
+
+  dir = userTLEDir;
+
+  // Small catalogs are not worth the threads
+  threads = std::min(
+        threads,
+        static_cast<unsigned>(
+          catalog.size() / SIGDIGGER_TLE_PARSE_MIN_SLICE + 1));
+
+  // Cut the catalog at record boundaries, one slice per thread
+  for (i = 0; i < threads && p < end; ++i) {
+    const char *cut = i + 1 == threads
+        ? end
+        : tle_record_start(
+            data + catalog.size() * (i + 1) / threads,
+            p,
+            end);
+
+    if (cut > p) {
+      Slice slice;
+      slice.start = p;
+      slice.end   = cut;
+      slices.push_back(std::move(slice));
+    }
+
+    p = cut;
+  }
+
+  run_parallel(
+        slices,
+        [] (Slice &slice) {
+          tle_parse_range(
+                slice.start,
+                static_cast<size_t>(slice.end - slice.start),
+                slice.records);
+        });
+
+  // Deduplicate by catalog number, keeping the newest epoch. Later
+  // records win ties, as they did when they were registered one by one.
+  for (auto &slice : slices) {
+    for (auto &record : slice.records) {
+      int satno = record.orbit.getCOrbit().satno;
+      auto it = bySatno.find(satno);
+
+      if (it == bySatno.end()) {
+        bySatno.insert(satno, unique.size());
+        unique.push_back(&record);
+      } else if (tle_newer(
+                   record.orbit.getCOrbit(),
+                   unique[*it]->orbit.getCOrbit())) {
+        unique[*it] = &record;
+      }
+    }
+  }
+
+  // Drop the records that already have something newer
+  for (auto q = this->satellites.cbegin(); q != this->satellites.cend(); ++q)
+    satnoNames.insert(q.value().getCOrbit().satno, q.key());
+
+  unique.erase(
+        std::remove_if(
+          unique.begin(),
+          unique.end(),
+          [this, &satnoNames] (TLERecord *record) {
+            auto it = satnoNames.find(record->orbit.getCOrbit().satno);
+
+            return it != satnoNames.end()
+                && !tle_newer(
+                  record->orbit.getCOrbit(),
+                  this->satellites.constFind(*it)->getCOrbit());
+          }),
+        unique.end());
+
+  // Writing thousands of files dominates: spread it over the same threads
+  std::vector<std::vector<TLERecord *>> batches(slices.size());
+  std::vector<std::vector<TLERecord *>> written(slices.size());
+
+  for (size_t j = 0; j < unique.size(); ++j)
+    batches[j % batches.size()].push_back(unique[j]);
+
+  {
+    std::vector<std::thread> workers;
+
+    for (size_t j = 0; j < batches.size(); ++j)
+      workers.push_back(
+            std::thread(
+              [&batches, &written, &dir, j] () {
+                for (auto record : batches[j])
+                  if (saveTLE(dir, record->orbit, record->text))
+                    written[j].push_back(record);
+              }));
+
+    for (auto &worker : workers)
+      worker.join();
+  }
+
+  for (auto &batch : written) {
+    for (auto record : batch) {
+      QString name = record->orbit.nameToQString();
+      auto it = satnoNames.find(record->orbit.getCOrbit().satno);
+
+      // Renamed satellite: forget the old entry and its file
+      if (it != satnoNames.end() && *it != name) {
+        QFile::remove(dir + "/" + normalizeTLEName(*it) + ".tle");
+        this->satellites.remove(*it);
+      }
+
+      this->satellites[name] = record->orbit;
+      ++count;
+    }
+  }
+
+  return count;
+}
+
 bool
 Singleton::registerTLE(std::string const &tleData)
 {
+  this->require(INIT_TLE);
+
   Orbit newOrbit;
   const char *userTLEDir;
-  QString fullTLEPath;
 
   if (newOrbit.loadFromTLE(tleData)) {
     // Valid TLE file, overwrite current TLE
     if ((userTLEDir = suscan_confdb_get_local_tle_path()) == nullptr)
       return false;
 
-    fullTLEPath =
-        userTLEDir + QString("/")
-        + normalizeTLEName(newOrbit.nameToQString()) + ".tle";
-
     // Attempt to save it. If we could
-    QFile qFile(fullTLEPath);
-    if (qFile.open(QIODevice::WriteOnly)) {
-      bool ok;
-      QTextStream out(&qFile);
-      out << QString::fromStdString(tleData);
-      out.flush();
-
-      ok = !qFile.error();
-
-      qFile.close();
-
-      if (ok) {
-        this->satellites[newOrbit.nameToQString()] = newOrbit;
-        return true;
-      }
+    if (saveTLE(userTLEDir, newOrbit, tleData)) {
+      this->satellites[newOrbit.nameToQString()] = newOrbit;
+      return true;
     }
   }
 
@@ -887,6 +1999,8 @@ Singleton::registerTLE(std::string const &tleData)
 bool
 Singleton::registerTLESource(TLESource const& tleSrc)
 {
+  this->require(INIT_TLE_SOURCES);
+
   if (this->tleSources.find(tleSrc.name) != this->tleSources.end())
     return false;
 
@@ -895,7 +2009,10 @@ Singleton::registerTLESource(TLESource const& tleSrc)
   newSrc = tleSrc;
   newSrc.user = true;
 
+  std::lock_guard<std::mutex> guard(this->syncMutex);
+
   this->tleSources[newSrc.name] = newSrc;
+  this->markDirty(SYNC_TLE_SOURCES);
 
   return true;
 }
@@ -903,6 +2020,8 @@ Singleton::registerTLESource(TLESource const& tleSrc)
 bool
 Singleton::removeTLESource(std::string const &name)
 {
+  this->require(INIT_TLE_SOURCES);
+
   if (this->tleSources.find(name) == this->tleSources.end())
     return false;
 
@@ -910,7 +2029,10 @@ Singleton::removeTLESource(std::string const &name)
   if (!this->tleSources[name].user)
     return false;
 
+  std::lock_guard<std::mutex> guard(this->syncMutex);
+
   this->tleSources.remove(name);
+  this->markDirty(SYNC_TLE_SOURCES);
 
   return true;
 }
@@ -1017,12 +2139,16 @@ Singleton::getLastUIConfig(void)
 std::vector<Object>::const_iterator
 Singleton::getFirstFAT(void) const
 {
+  this->require(INIT_FATS);
+
   return this->FATs.begin();
 }
 
 std::vector<Object>::const_iterator
 Singleton::getLastFAT(void) const
 {
+  this->require(INIT_FATS);
+
   return this->FATs.end();
 }
 
@@ -1033,6 +2159,9 @@ Singleton::putUIConfig(unsigned int pos, Object &&rv)
     this->uiConfig.resize(pos + 1);
 
   this->uiConfig[pos] = std::move(rv);
+
+  std::lock_guard<std::mutex> guard(this->syncMutex);
+  this->markDirty(SYNC_UI);
 }
 
 const Source::Device *
@@ -1059,27 +2188,101 @@ Singleton::getLastRecent(void) const
 QMap<qint64,Bookmark> const &
 Singleton::getBookmarkMap(void) const
 {
+  this->require(INIT_BOOKMARKS);
+
   return this->bookmarks;
 }
 
 QMap<qint64,Bookmark>::const_iterator
 Singleton::getFirstBookmark(void) const
 {
+  this->require(INIT_BOOKMARKS);
+
   return this->bookmarks.cbegin();
 }
 
 QMap<qint64,Bookmark>::const_iterator
 Singleton::getLastBookmark(void) const
 {
+  this->require(INIT_BOOKMARKS);
+
   return this->bookmarks.cend();
 }
 
 QMap<qint64,Bookmark>::const_iterator
 Singleton::getBookmarkFrom(qint64 freq) const
 {
+  this->require(INIT_BOOKMARKS);
+
   return this->bookmarks.lowerBound(freq);
 }
 
+QList<BookmarkInfo>
+Singleton::getBookmarksInRange(qint64 start, qint64 end) const
+{
+  QList<BookmarkInfo> list;
+
+  // Called while painting: do not wait for the bookmarks. Once they are
+  // loaded the revision changes, and callers come back for them.
+  if (start > end || !this->isInitDone(INIT_BOOKMARKS))
+    return list;
+
+  auto last = this->bookmarks.upperBound(end);
+
+  for (auto p = this->bookmarks.lowerBound(start); p != last; ++p)
+    list.push_back(p->info);
+
+  return list;
+}
+
+quint64
+Singleton::getBookmarkRevision(void) const
+{
+  if (!this->isInitDone(INIT_BOOKMARKS))
+    return 0;
+
+  return this->bookmarkRevision;
+}
+
+quint64
+Singleton::getDeviceRevision(void) const
+{
+  return this->deviceRevision;
+}
+
+std::vector<DeviceSummary>
+Singleton::getMissingDevices(void) const
+{
+  std::vector<DeviceSummary> missing;
+
+  if (this->devicesDetected)
+    return missing;
+
+  for (auto const &known : this->knownDevices) {
+    bool found = false;
+
+    for (auto const &dev : this->devices) {
+      if (dev.isAvailable()
+          && dev.getDesc() == known.desc
+          && dev.getDriver() == known.driver) {
+        found = true;
+        break;
+      }
+    }
+
+    if (!found)
+      missing.push_back(known);
+  }
+
+  return missing;
+}
+
+quint64
+Singleton::getNetworkProfileRevision(void) const
+{
+  return this->networkProfileRevision;
+}
+
 QMap<QString, Location> const &
 Singleton::getLocationMap(void) const
 {
@@ -1101,6 +2304,8 @@ Singleton::getLastLocation(void) const
 QMap<QString, Orbit> const &
 Singleton::getSatelliteMap(void) const
 {
+  this->require(INIT_TLE);
+
   return this->satellites;
 }
 
@@ -1108,30 +2313,40 @@ Singleton::getSatelliteMap(void) const
 QMap<QString, Orbit>::const_iterator
 Singleton::getFirstSatellite(void) const
 {
+  this->require(INIT_TLE);
+
   return this->satellites.cbegin();
 }
 
 QMap<QString, Orbit>::const_iterator
 Singleton::getLastSatellite(void) const
 {
-return this->satellites.cend();
+  this->require(INIT_TLE);
+
+  return this->satellites.cend();
 }
 
 QMap<std::string, TLESource> const &
 Singleton::getTLESourceMap(void) const
 {
+  this->require(INIT_TLE_SOURCES);
+
   return this->tleSources;
 }
 
 QMap<std::string, TLESource>::const_iterator
 Singleton::getFirstTLESource(void) const
 {
+  this->require(INIT_TLE_SOURCES);
+
   return this->tleSources.cbegin();
 }
 
 QMap<std::string, TLESource>::const_iterator
 Singleton::getLastTLESource(void) const
 {
+  this->require(INIT_TLE_SOURCES);
+
   return this->tleSources.cend();
 }
 
@@ -1160,25 +2375,25 @@ Singleton::getSpectrumUnitFrom(std::string const &name) const
 }
 
 
-QHash<QString, Source::Config> const &
+QMap<QString, Source::Config> const &
 Singleton::getNetworkProfileMap(void) const
 {
   return this->networkProfiles;
 }
 
-QHash<QString, Source::Config>::const_iterator
+QMap<QString, Source::Config>::const_iterator
 Singleton::getFirstNetworkProfile(void) const
 {
   return this->networkProfiles.cbegin();
 }
 
-QHash<QString, Source::Config>::const_iterator
+QMap<QString, Source::Config>::const_iterator
 Singleton::getLastNetworkProfile(void) const
 {
   return this->networkProfiles.cend();
 }
 
-QHash<QString, Source::Config>::const_iterator
+QMap<QString, Source::Config>::const_iterator
 Singleton::getNetworkProfileFrom(QString const &name) const
 {
   return this->networkProfiles.constFind(name);
@@ -1188,10 +2403,11 @@ bool
 Singleton::registerToolWidgetFactory(SigDigger::ToolWidgetFactory *factory)
 {
   // Not a bug. The plugin went ahead of ourselves.
-  if (this->toolWidgetFactories.contains(factory))
+  if (this->toolWidgetFactoryTable.value(factory->name()) == factory)
     return true;
 
   this->toolWidgetFactories.push_back(factory);
+  this->toolWidgetFactoryTable[factory->name()] = factory;
 
   return true;
 }
@@ -1205,10 +2421,18 @@ Singleton::unregisterToolWidgetFactory(SigDigger::ToolWidgetFactory *factory)
     return false;
 
   this->toolWidgetFactories.removeAt(index);
+  if (this->toolWidgetFactoryTable.value(factory->name()) == factory)
+    this->toolWidgetFactoryTable.remove(factory->name());
 
   return true;
 }
 
+SigDigger::ToolWidgetFactory *
+Singleton::findToolWidgetFactory(QString const &name) const
+{
+  return this->toolWidgetFactoryTable.value(name);
+}
+
 QList<SigDigger::ToolWidgetFactory *>::const_iterator
 Singleton::getFirstToolWidgetFactory() const
 {
@@ -1225,7 +2449,7 @@ bool
 Singleton::registerTabWidgetFactory(SigDigger::TabWidgetFactory *factory)
 {
   // Not a bug. The plugin went ahead of ourselves.
-  if (this->tabWidgetFactories.contains(factory))
+  if (this->tabWidgetFactoryTable.value(factory->name()) == factory)
     return true;
 
   this->tabWidgetFactories.push_back(factory);
@@ -1243,7 +2467,8 @@ Singleton::unregisterTabWidgetFactory(SigDigger::TabWidgetFactory *factory)
     return false;
 
   this->tabWidgetFactories.removeAt(index);
-  this->tabWidgetFactoryTable.remove(factory->name());
+  if (this->tabWidgetFactoryTable.value(factory->name()) == factory)
+    this->tabWidgetFactoryTable.remove(factory->name());
 
   return true;
 }
@@ -1251,8 +2476,14 @@ Singleton::unregisterTabWidgetFactory(SigDigger::TabWidgetFactory *factory)
 SigDigger::TabWidgetFactory *
 Singleton::findTabWidgetFactory(QString const &name) const
 {
-  if (!this->tabWidgetFactoryTable.contains(name))
-    return nullptr;
+  if (!this->tabWidgetFactoryTable.contains(name)) {
+    auto deferred = this->deferredTabFactories.constFind(name);
+
+    if (deferred == this->deferredTabFactories.cend()
+        || !this->loadDeferredPlugin(deferred->plugin)
+        || !this->tabWidgetFactoryTable.contains(name))
+      return nullptr;
+  }
 
   return this->tabWidgetFactoryTable[name];
 }
@@ -1273,7 +2504,7 @@ bool
 Singleton::registerInspectionWidgetFactory(SigDigger::InspectionWidgetFactory *factory)
 {
   // Not a bug. The plugin went ahead of ourselves.
-  if (this->inspectionWidgetFactories.contains(factory))
+  if (this->inspectionWidgetFactoryTable.value(factory->name()) == factory)
     return true;
 
   this->inspectionWidgetFactories.push_back(factory);
@@ -1291,7 +2522,8 @@ Singleton::unregisterInspectionWidgetFactory(SigDigger::InspectionWidgetFactory
     return false;
 
   this->inspectionWidgetFactories.removeAt(index);
-  this->inspectionWidgetFactoryTable.remove(factory->name());
+  if (this->inspectionWidgetFactoryTable.value(factory->name()) == factory)
+    this->inspectionWidgetFactoryTable.remove(factory->name());
 
   return true;
 }
@@ -1299,12 +2531,35 @@ Singleton::unregisterInspectionWidgetFactory(SigDigger::InspectionWidgetFactory
 SigDigger::InspectionWidgetFactory *
 Singleton::findInspectionWidgetFactory(QString const &name) const
 {
-  if (!this->inspectionWidgetFactoryTable.contains(name))
-    return nullptr;
+  if (!this->inspectionWidgetFactoryTable.contains(name)) {
+    auto deferred = this->deferredInspectionFactories.constFind(name);
+
+    if (deferred == this->deferredInspectionFactories.cend()
+        || !this->loadDeferredPlugin(deferred->plugin)
+        || !this->inspectionWidgetFactoryTable.contains(name))
+      return nullptr;
+  }
 
   return this->inspectionWidgetFactoryTable[name];
 }
 
+QList<QPair<QString, QString>>
+Singleton::getInspectionWidgetFactoryList(void) const
+{
+  QList<QPair<QString, QString>> list;
+
+  for (auto p : this->inspectionWidgetFactories)
+    list.append(qMakePair(QString(p->name()), QString(p->description())));
+
+  for (auto p = this->deferredInspectionFactories.cbegin();
+       p != this->deferredInspectionFactories.cend();
+       ++p)
+    if (!this->inspectionWidgetFactoryTable.contains(p.key()))
+      list.append(qMakePair(p.key(), p->description));
+
+  return list;
+}
+
 QList<SigDigger::InspectionWidgetFactory *>::const_iterator
 Singleton::getFirstInspectionWidgetFactory() const
 {
@@ -1321,10 +2576,11 @@ bool
 Singleton::registerUIListenerFactory(SigDigger::UIListenerFactory *factory)
 {
   // Not a bug. The plugin got ahead of ourselves.
-  if (this->uiListenerFactories.contains(factory))
+  if (this->uiListenerFactoryTable.value(factory->name()) == factory)
     return true;
 
   this->uiListenerFactories.push_back(factory);
+  this->uiListenerFactoryTable[factory->name()] = factory;
 
   return true;
 }
@@ -1338,10 +2594,18 @@ Singleton::unregisterUIListenerFactory(SigDigger::UIListenerFactory *factory)
     return false;
 
   this->uiListenerFactories.removeAt(index);
+  if (this->uiListenerFactoryTable.value(factory->name()) == factory)
+    this->uiListenerFactoryTable.remove(factory->name());
 
   return true;
 }
 
+SigDigger::UIListenerFactory *
+Singleton::findUIListenerFactory(QString const &name) const
+{
+  return this->uiListenerFactoryTable.value(name);
+}
+
 QList<SigDigger::UIListenerFactory *>::const_iterator
 Singleton::getFirstUIListenerFactory() const
 {
@@ -1354,6 +2618,80 @@ Singleton::getLastUIListenerFactory() const
   return this->uiListenerFactories.end();
 }
 
+bool
+Singleton::registerAudioDspFactory(SigDigger::AudioDspFactory *factory)
+{
+  // Not a bug. The plugin got ahead of ourselves.
+  if (this->audioDspFactories.contains(factory))
+    return true;
+
+  this->audioDspFactories.push_back(factory);
+
+  return true;
+}
+
+bool
+Singleton::unregisterAudioDspFactory(SigDigger::AudioDspFactory *factory)
+{
+  int index = this->audioDspFactories.indexOf(factory);
+
+  if (index == -1)
+    return false;
+
+  this->audioDspFactories.removeAt(index);
+
+  return true;
+}
+
+QList<SigDigger::AudioDspFactory *>::const_iterator
+Singleton::getFirstAudioDspFactory() const
+{
+  return this->audioDspFactories.begin();
+}
+
+QList<SigDigger::AudioDspFactory *>::const_iterator
+Singleton::getLastAudioDspFactory() const
+{
+  return this->audioDspFactories.end();
+}
+
+bool
+Singleton::registerSampleConsumerFactory(SigDigger::SampleConsumerFactory *factory)
+{
+  // Not a bug. The plugin got ahead of ourselves.
+  if (this->sampleConsumerFactories.contains(factory))
+    return true;
+
+  this->sampleConsumerFactories.push_back(factory);
+
+  return true;
+}
+
+bool
+Singleton::unregisterSampleConsumerFactory(SigDigger::SampleConsumerFactory *factory)
+{
+  int index = this->sampleConsumerFactories.indexOf(factory);
+
+  if (index == -1)
+    return false;
+
+  this->sampleConsumerFactories.removeAt(index);
+
+  return true;
+}
+
+QList<SigDigger::SampleConsumerFactory *>::const_iterator
+Singleton::getFirstSampleConsumerFactory() const
+{
+  return this->sampleConsumerFactories.begin();
+}
+
+QList<SigDigger::SampleConsumerFactory *>::const_iterator
+Singleton::getLastSampleConsumerFactory() const
+{
+  return this->sampleConsumerFactories.end();
+}
+
 bool
 Singleton::notifyRecent(std::string const &name)
 {
@@ -1361,7 +2699,10 @@ Singleton::notifyRecent(std::string const &name)
 
   found = this->removeRecent(name);
 
+  std::lock_guard<std::mutex> guard(this->syncMutex);
+
   this->recentProfiles.push_front(name);
+  this->markDirty(SYNC_RECENT);
 
   return found;
 }
@@ -1371,6 +2712,8 @@ Singleton::removeRecent(std::string const &name)
 {
   bool found = false;
 
+  std::lock_guard<std::mutex> guard(this->syncMutex);
+
   for (auto p = this->getFirstRecent(); p != this->getLastRecent(); ++p) {
     if (*p == name) {
       auto current = p;
@@ -1384,11 +2727,17 @@ Singleton::removeRecent(std::string const &name)
     }
   }
 
+  if (found)
+    this->markDirty(SYNC_RECENT);
+
   return found;
 }
 
 void
 Singleton::clearRecent(void)
 {
+  std::lock_guard<std::mutex> guard(this->syncMutex);
+
   this->recentProfiles.clear();
+  this->markDirty(SYNC_RECENT);
 }
@@ -18,11 +18,26 @@
 //
 
 #include <Suscan/Logger.h>
+#include <sys/time.h>
+#include <cstring>
 
 Q_DECLARE_METATYPE(Suscan::LoggerMessage);
+Q_DECLARE_METATYPE(QVector<Suscan::LoggerMessage>);
 
 using namespace Suscan;
 
+static_assert(
+    (SIGDIGGER_LOGGER_RING_SIZE & (SIGDIGGER_LOGGER_RING_SIZE - 1)) == 0,
+    "Logger ring size must be a power of two");
+
+static const unsigned int g_rateLimits[] = {
+  SIGDIGGER_LOGGER_RATE_DEBUG,
+  SIGDIGGER_LOGGER_RATE_INFO,
+  SIGDIGGER_LOGGER_RATE_WARNING,
+  SIGDIGGER_LOGGER_RATE_ERROR,
+  SIGDIGGER_LOGGER_RATE_CRITICAL
+};
+
 Logger *Logger::instance = nullptr;
 
 void
@@ -37,38 +52,210 @@ Logger::Logger(void) : QObject()
 {
   struct sigutils_log_config config;
 
+  this->ring = new RingSlot[SIGDIGGER_LOGGER_RING_SIZE];
+  for (size_t i = 0; i < SIGDIGGER_LOGGER_RING_SIZE; ++i)
+    this->ring[i].sequence.store(i, std::memory_order_relaxed);
+
+  this->head.store(0);
+  this->dropped.store(0);
+  this->suppressed.store(0);
+
+  for (auto &p : this->rates) {
+    p.second.store(0);
+    p.count.store(0);
+  }
+
   config.priv = this;
   config.exclusive = SU_FALSE;
   config.log_func = log_func;
 
   qRegisterMetaType<Suscan::LoggerMessage>();
+  qRegisterMetaType<QVector<Suscan::LoggerMessage>>();
+
+  connect(
+        &this->deliveryTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onDeliveryTimeout(void)));
+
+  this->deliveryTimer.start(SIGDIGGER_LOGGER_DELIVERY_INTERVAL_MS);
 
   su_log_init(&config);
 }
 
+const char *
+Logger::intern(const char *string)
+{
+  // Domains and functions are almost always string literals. Remember the
+  // last one seen by this thread, and compare before taking the lock.
+  thread_local const char *lastSource = nullptr;
+  thread_local const char *lastInterned = nullptr;
+
+  if (string == nullptr)
+    string = "";
+
+  if (string == lastSource && strcmp(string, lastInterned) == 0)
+    return lastInterned;
+
+  std::lock_guard<std::mutex> lock(this->internMutex);
+  auto it = this->interned.emplace(string).first;
+
+  lastSource   = string;
+  lastInterned = it->c_str();
+
+  return lastInterned;
+}
+
+bool
+Logger::admit(enum sigutils_log_severity severity, time_t now)
+{
+  unsigned int index = static_cast<unsigned int>(severity);
+  unsigned int limit;
+
+  if (index >= sizeof(g_rateLimits) / sizeof(g_rateLimits[0]))
+    return true;
+
+  limit = g_rateLimits[index];
+  if (limit == 0)
+    return true;
+
+  // One-second windows. Racing threads may let a few extra messages
+  // through when the window turns over, which is fine.
+  RateWindow &window = this->rates[index];
+  time_t second = window.second.load(std::memory_order_relaxed);
+
+  if (second != now
+      && window.second.compare_exchange_strong(second, now))
+    window.count.store(0, std::memory_order_relaxed);
+
+  return window.count.fetch_add(1, std::memory_order_relaxed) < limit;
+}
+
 void
 Logger::push(const struct sigutils_log_message *message)
 {
-  struct LoggerMessage msg;
+  size_t pos = this->head.load(std::memory_order_relaxed);
+  RingSlot *slot;
 
-  msg.severity = message->severity;
-  msg.time     = message->time;
-  msg.line     = message->line;
+  if (!this->admit(message->severity, message->time.tv_sec)) {
+    this->suppressed.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
 
-  msg.domain   = std::string(message->domain);
-  msg.function = std::string(message->function);
-  msg.message  = std::string(message->message);
+  for (;;) {
+    slot = &this->ring[pos & (SIGDIGGER_LOGGER_RING_SIZE - 1)];
+    size_t seq = slot->sequence.load(std::memory_order_acquire);
+    intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
 
-  emit messageEmitted(msg);
+    if (diff == 0) {
+      if (this->head.compare_exchange_weak(
+            pos,
+            pos + 1,
+            std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      // Full. The consumer is not keeping up: never wait for it.
+      this->dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      pos = this->head.load(std::memory_order_relaxed);
+    }
+  }
 
-  std::lock_guard<std::mutex> lock(this->mutex);
-  this->messages.push_back(std::move(msg));
+  slot->msg.severity = message->severity;
+  slot->msg.time     = message->time;
+  slot->msg.line     = message->line;
+  slot->msg.domain   = this->intern(message->domain);
+  slot->msg.function = this->intern(message->function);
+
+  // Reuses the capacity left by the previous message in this slot
+  slot->msg.message.assign(message->message);
+
+  slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+void
+Logger::store(LoggerMessage const &msg)
+{
+  this->messages.push_back(msg);
+  if (this->messages.size() > SIGDIGGER_LOGGER_HISTORY_SIZE)
+    this->messages.pop_front();
+
+  this->pending.push_back(msg);
+  if (this->pending.size() > 2 * SIGDIGGER_LOGGER_HISTORY_SIZE)
+    this->pending.remove(0, SIGDIGGER_LOGGER_HISTORY_SIZE);
+}
+
+void
+Logger::storeNote(
+    enum sigutils_log_severity severity,
+    std::string const &text)
+{
+  LoggerMessage msg;
+
+  msg.severity = severity;
+  msg.domain   = this->intern("logger");
+  msg.function = this->intern(__FUNCTION__);
+  msg.line     = __LINE__;
+  msg.message  = text;
+
+  gettimeofday(&msg.time, nullptr);
+
+  this->store(msg);
+}
+
+void
+Logger::drain(void)
+{
+  unsigned int count;
+
+  for (;;) {
+    RingSlot *slot = &this->ring[this->tail & (SIGDIGGER_LOGGER_RING_SIZE - 1)];
+
+    if (slot->sequence.load(std::memory_order_acquire) != this->tail + 1)
+      break;
+
+    this->store(slot->msg);
+
+    slot->sequence.store(
+          this->tail + SIGDIGGER_LOGGER_RING_SIZE,
+          std::memory_order_release);
+    ++this->tail;
+  }
+
+  if ((count = this->suppressed.exchange(0)) > 0)
+    this->storeNote(
+          SU_LOG_SEVERITY_WARNING,
+          std::to_string(count) + " log messages suppressed (rate limit)\n");
+
+  if ((count = this->dropped.exchange(0)) > 0)
+    this->storeNote(
+          SU_LOG_SEVERITY_WARNING,
+          std::to_string(count) + " log messages dropped (ring full)\n");
+}
+
+void
+Logger::onDeliveryTimeout(void)
+{
+  QVector<LoggerMessage> batch;
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->drain();
+    batch.swap(this->pending);
+  }
+
+  if (!batch.isEmpty())
+    emit messagesEmitted(batch);
 }
 
 void
 Logger::flush(void)
 {
   std::lock_guard<std::mutex> lock(this->mutex);
+
+  // Pending messages still reach the UI. Only the history is forgotten.
+  this->drain();
   this->messages.clear();
 }
 
@@ -76,6 +263,7 @@ void
 Logger::lock(void)
 {
   this->mutex.lock();
+  this->drain();
 }
 
 void
@@ -93,19 +281,19 @@ Logger::getInstance(void)
   return instance;
 }
 
-std::vector<LoggerMessage>::const_iterator
+std::deque<LoggerMessage>::const_iterator
 Logger::begin(void)
 {
-  return this->messages.begin();
+  return this->messages.cbegin();
 }
 
-std::vector<LoggerMessage>::const_iterator
+std::deque<LoggerMessage>::const_iterator
 Logger::end(void)
 {
-  return this->messages.end();
+  return this->messages.cend();
 }
 
 Logger::~Logger(void)
 {
-
+  delete[] this->ring;
 }
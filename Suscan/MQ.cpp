@@ -28,6 +28,12 @@ MQ::read(uint32_t &type)
   return suscan_mq_read(&this->mq, &type);
 }
 
+bool
+MQ::poll(uint32_t &type, void *&data)
+{
+  return suscan_mq_poll(&this->mq, &type, &data) != SU_FALSE;
+}
+
 MQ::MQ()
 {
   this->mq_initialized = false;
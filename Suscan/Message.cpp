@@ -18,71 +18,172 @@
 //
 
 #include <Suscan/Message.h>
+#include <atomic>
+#include <mutex>
+
+#define SIGDIGGER_MESSAGE_REF_POOL_CHUNK 256
+
+namespace Suscan {
+  struct MessageRef {
+    std::atomic<unsigned int> count;
+    uint32_t    type;
+    void       *data;
+    MessageRef *next;
+  };
+};
 
 using namespace Suscan;
 
+namespace {
+  //
+  // MessageRefs are allocated in chunks and never given back to the
+  // system: the pool is as big as the peak number of live messages.
+  //
+  class MessageRefPool {
+    std::mutex  mutex;
+    MessageRef *freeList = nullptr;
+
+    void
+    grow(void)
+    {
+      MessageRef *chunk = new MessageRef[SIGDIGGER_MESSAGE_REF_POOL_CHUNK];
+
+      for (unsigned i = 0; i < SIGDIGGER_MESSAGE_REF_POOL_CHUNK; ++i) {
+        chunk[i].next = this->freeList;
+        this->freeList = chunk + i;
+      }
+    }
+
+  public:
+    MessageRef *
+    alloc(uint32_t type, void *data)
+    {
+      MessageRef *ref;
+
+      {
+        std::lock_guard<std::mutex> guard(this->mutex);
+
+        if (this->freeList == nullptr)
+          this->grow();
+
+        ref = this->freeList;
+        this->freeList = ref->next;
+      }
+
+      ref->count = 1;
+      ref->type  = type;
+      ref->data  = data;
+      ref->next  = nullptr;
+
+      return ref;
+    }
+
+    void
+    recycle(MessageRef *ref)
+    {
+      std::lock_guard<std::mutex> guard(this->mutex);
+
+      ref->data = nullptr;
+      ref->next = this->freeList;
+      this->freeList = ref;
+    }
+
+    static MessageRefPool *
+    instance(void)
+    {
+      // Intentionally leaked: messages may outlive static destructors
+      static MessageRefPool *pool = new MessageRefPool();
+      return pool;
+    }
+  };
+}
+
 uint32_t
 Message::getType(void) const
 {
   return this->type;
 }
 
+bool
+Message::isNull(void) const
+{
+  return this->ref == nullptr;
+}
+
+void *
+Message::getCMessage(void) const
+{
+  return this->ref == nullptr ? nullptr : this->ref->data;
+}
+
+void
+Message::release(void)
+{
+  if (this->ref != nullptr) {
+    if (--this->ref->count == 0) {
+      suscan_analyzer_dispose_message(this->ref->type, this->ref->data);
+      MessageRefPool::instance()->recycle(this->ref);
+    }
+
+    this->ref = nullptr;
+  }
+}
+
 Message::Message()
 {
   this->type = 0;
-  this->c_message = nullptr;
+  this->ref  = nullptr;
 }
 
-// The madness below fixes the problem of the lifecycle of objects passed
-// to QT signal slots. Again, Message is just a proxy object.
-//
-// TODO: Would it make sense to have a generic Proxy object to keep track
-// of Suscan objects?
-
-// C-Level constructor
 Message::Message(uint32_t type, void *c_message)
 {
   this->type = type;
-  auto deleter = [=](void *ptr) { suscan_analyzer_dispose_message(type, ptr); };
-  this->c_message = std::shared_ptr<void>(c_message, deleter);
+
+  if (c_message != nullptr)
+    this->ref = MessageRefPool::instance()->alloc(type, c_message);
 }
 
-// Move constructor
 Message::Message(Message &&rv)
 {
-  std::swap(this->type, rv.type);
-  this->c_message.swap(rv.c_message);
+  this->type = rv.type;
+  std::swap(this->ref, rv.ref);
 }
 
-// Move assignation
 Message &
 Message::operator=(Message &&rv)
 {
   std::swap(this->type, rv.type);
-  this->c_message.swap(rv.c_message);
+  std::swap(this->ref, rv.ref);
 
   return *this;
 }
 
-// Copy constructor
 Message::Message(const Message &rv)
 {
   this->type = rv.type;
-  this->c_message = rv.c_message;
+  this->ref  = rv.ref;
+
+  if (this->ref != nullptr)
+    ++this->ref->count;
 }
 
-// Copy assignation
 Message &
 Message::operator=(const Message &rv)
 {
+  if (this->ref != rv.ref) {
+    if (rv.ref != nullptr)
+      ++rv.ref->count;
+
+    this->release();
+    this->ref = rv.ref;
+  }
+
   this->type = rv.type;
-  this->c_message = rv.c_message;
 
   return *this;
 }
 
-// Default destructor
 Message::~Message()
 {
-  // Lalalala
+  this->release();
 }
@@ -42,7 +42,7 @@ SUSCOUNT
 PSDMessage::size(void) const
 {
   const struct suscan_analyzer_psd_msg *msg
-      = static_cast<struct suscan_analyzer_psd_msg *>(this->c_message.get());
+      = static_cast<struct suscan_analyzer_psd_msg *>(this->getCMessage());
   return msg->psd_size;
 }
 
@@ -50,7 +50,7 @@ unsigned int
 PSDMessage::getSampleRate(void) const
 {
   const struct suscan_analyzer_psd_msg *msg
-      = static_cast<struct suscan_analyzer_psd_msg *>(this->c_message.get());
+      = static_cast<struct suscan_analyzer_psd_msg *>(this->getCMessage());
   return static_cast<unsigned int>(msg->samp_rate);
 }
 
@@ -58,7 +58,7 @@ unsigned int
 PSDMessage::getMeasuredSampleRate(void) const
 {
   const struct suscan_analyzer_psd_msg *msg
-      = static_cast<struct suscan_analyzer_psd_msg *>(this->c_message.get());
+      = static_cast<struct suscan_analyzer_psd_msg *>(this->getCMessage());
   return static_cast<unsigned int>(msg->measured_samp_rate);
 }
 
@@ -66,7 +66,7 @@ struct timeval
 PSDMessage::getTimeStamp(void) const
 {
   const struct suscan_analyzer_psd_msg *msg
-      = static_cast<struct suscan_analyzer_psd_msg *>(this->c_message.get());
+      = static_cast<struct suscan_analyzer_psd_msg *>(this->getCMessage());
   return msg->timestamp;
 }
 
@@ -74,7 +74,7 @@ struct timeval
 PSDMessage::getRealTimeStamp(void) const
 {
   const struct suscan_analyzer_psd_msg *msg
-      = static_cast<struct suscan_analyzer_psd_msg *>(this->c_message.get());
+      = static_cast<struct suscan_analyzer_psd_msg *>(this->getCMessage());
   return msg->rt_time;
 }
 
@@ -82,7 +82,7 @@ bool
 PSDMessage::hasLooped(void) const
 {
   const struct suscan_analyzer_psd_msg *msg
-      = static_cast<struct suscan_analyzer_psd_msg *>(this->c_message.get());
+      = static_cast<struct suscan_analyzer_psd_msg *>(this->getCMessage());
 
   return msg->looped;
 }
@@ -91,7 +91,7 @@ SUFREQ
 PSDMessage::getFrequency(void) const
 {
   const struct suscan_analyzer_psd_msg *msg
-      = static_cast<struct suscan_analyzer_psd_msg *>(this->c_message.get());
+      = static_cast<struct suscan_analyzer_psd_msg *>(this->getCMessage());
 
   return msg->fc;
 }
@@ -100,6 +100,6 @@ const SUFLOAT *
 PSDMessage::get(void) const
 {
   const struct suscan_analyzer_psd_msg *msg
-      = static_cast<struct suscan_analyzer_psd_msg *>(this->c_message.get());
+      = static_cast<struct suscan_analyzer_psd_msg *>(this->getCMessage());
   return msg->psd_data;
 }
@@ -24,50 +24,10 @@ CancellableTaskContext::CancellableTaskContext(
     CancellableTask *task,
     QString const &title)
 {
-  this->mThread = new QThread;
   this->mTask  = task;
   this->mTitle = title;
   this->mCreationTime = QDateTime::currentDateTime();
   this->mLastUpdate = this->mCreationTime;
-  this->connectAll();
-
-  task->moveToThread(this->mThread);
-}
-
-void
-CancellableTaskContext::connectAll(void)
-{
-  // Thread start triggers processing
-  QObject::connect(
-        this->mThread,
-        SIGNAL(started()),
-        this->mTask,
-        SLOT(onWorkRequested()));
-
-  // And thread quit trigger deleteLater()
-  QObject::connect(
-        this->mThread,
-        SIGNAL(finished()),
-        this->mThread,
-        SLOT(deleteLater()));
-
-  // Task is deleted after finalization
-  QObject::connect(
-        this->mThread,
-        SIGNAL(finished()),
-        this->mTask,
-        SLOT(deleteLater()));
-}
-
-CancellableTaskContext::~CancellableTaskContext()
-{
-  this->mThread->quit();
-}
-
-void
-CancellableTaskContext::start(void)
-{
-  this->mThread->start();
 }
 
 void
@@ -105,12 +65,17 @@ CancellableTaskContext::setProgress(qreal value, QString message)
 {
   QDateTime now = QDateTime::currentDateTime();
   qint64 elapsed = this->mLastUpdate.msecsTo(now);
-  qreal delta = value - this->mLastProgressValue;
+  qreal delta = value - this->mRateProgressValue;
 
-  this->mLastUpdate          = now;
   this->mLastProgressValue   = value;
   this->mLastProgressMessage = message;
-  this->mRate = 1e3 * this->mTask->getDataSize() * (delta / elapsed);
+
+  // Updates within the same millisecond count towards the next rate
+  if (elapsed > 0) {
+    this->mLastUpdate        = now;
+    this->mRateProgressValue = value;
+    this->mRate = 1e3 * this->mTask->getDataSize() * (delta / elapsed);
+  }
 }
 
 QString
@@ -135,10 +100,22 @@ CancellableTaskContext::title(void) const
 MultitaskController::MultitaskController(QObject *parent) : QObject(parent)
 {
   CancellableTask::assertTypeRegistration();
+
+  this->progressTimer.setSingleShot(true);
+  this->progressTimer.setInterval(SIGDIGGER_MULTITASK_PROGRESS_INTERVAL_MS);
+
+  connect(
+        &this->progressTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onProgressTimeout(void)));
 }
 
 MultitaskController::~MultitaskController()
 {
+  // Running tasks would otherwise keep the pool from shutting down
+  this->cancelAll();
+
   for (auto p : this->deadList)
     delete p;
 
@@ -172,12 +149,6 @@ MultitaskController::connectNewTask(CancellableTask *task)
         SIGNAL(error(QString)),
         this,
         SLOT(onError(QString)));
-
-  connect(
-        this,
-        SIGNAL(cancel(void)),
-        task,
-        SLOT(onCancelRequested(void)));
 }
 
 CancellableTaskContext *
@@ -211,7 +182,11 @@ MultitaskController::repopulateTaskVector(void)
 }
 
 void
-MultitaskController::pushTask(CancellableTask *task, QString const &title)
+MultitaskController::pushTask(
+    CancellableTask *task,
+    QString const &title,
+    TaskPriority priority,
+    qint64 sliceMs)
 {
   CancellableTaskContext *ctx = new CancellableTaskContext(task, title);
 
@@ -226,7 +201,7 @@ MultitaskController::pushTask(CancellableTask *task, QString const &title)
 
   // Start after GUI has been notified
   this->connectNewTask(task);
-  ctx->start();
+  this->pool.push(task, priority, sliceMs);
 }
 
 void
@@ -238,20 +213,23 @@ MultitaskController::getTaskVector(QVector<CancellableTaskContext *> &vec) const
 void
 MultitaskController::cancelAll(void)
 {
-  emit cancel();
+  // Served by the pool workers, between two steps of each task
+  for (auto p : this->taskList)
+    p->task()->requestCancel();
 }
 
 void
 MultitaskController::cancelByIndex(int index)
 {
   if (index >= 0 && index < this->taskVec.size())
-    this->taskVec[index]->task()->cancel();
+    this->taskVec[index]->task()->requestCancel();
 }
 
 void
 MultitaskController::removeTaskContext(CancellableTaskContext *ctx)
 {
   this->taskList.remove(ctx);
+  this->progressed.remove(ctx);
   this->deadList.push_back(ctx);
   this->repopulateTaskVector();
 }
@@ -278,10 +256,28 @@ MultitaskController::onProgress(qreal progress, QString state)
 
   if (ctx != nullptr) {
     ctx->setProgress(progress, state);
-    emit(taskProgress(ctx->index(), progress, state));
+    this->progressed.insert(ctx);
+
+    if (!this->progressTimer.isActive())
+      this->progressTimer.start();
   }
 }
 
+void
+MultitaskController::onProgressTimeout(void)
+{
+  QSet<CancellableTaskContext *> progressed;
+
+  // Slots may cancel tasks: work on a copy
+  progressed.swap(this->progressed);
+
+  for (auto ctx : progressed)
+    emit taskProgress(
+        ctx->index(),
+        ctx->progressValue(),
+        ctx->progressMessage());
+}
+
 void
 MultitaskController::onDone(void)
 {
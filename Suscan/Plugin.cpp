@@ -27,6 +27,8 @@
 #include <FeatureFactory.h>
 #include <Default/Registration.h>
 #include <QCoreApplication>
+#include <QSettings>
+#include <QFileInfo>
 
 #define SIGDIGGER_PLUGIN_MANGLED_ENTRY "_Z11plugin_loadPN6Suscan6PluginE"
 
@@ -156,6 +158,66 @@ done:
   return plugin;
 }
 
+Plugin *
+Plugin::makeDeferred(const char *path, PluginManifest const &manifest)
+{
+  Plugin *plugin = new Plugin(
+        manifest.name,
+        path,
+        manifest.description,
+        nullptr);
+
+  plugin->m_deferred = true;
+  plugin->m_version  = manifest.version;
+
+  return plugin;
+}
+
+bool
+PluginManifest::read(PluginManifest &manifest, std::string const &path)
+{
+  QString qPath = QString::fromStdString(path);
+
+  if (!QFileInfo(qPath).isFile())
+    return false;
+
+  QSettings ini(qPath, QSettings::IniFormat);
+
+  if (ini.status() != QSettings::NoError) {
+    SU_WARNING("%s: cannot parse plugin manifest\n", path.c_str());
+    return false;
+  }
+
+  manifest.name        = ini.value("plugin/name").toString().toStdString();
+  manifest.version     = ini.value("plugin/version").toString().toStdString();
+  manifest.description =
+      ini.value("plugin/description").toString().toStdString();
+
+  if (manifest.name.empty()) {
+    SU_WARNING("%s: plugin manifest has no name\n", path.c_str());
+    return false;
+  }
+
+  ini.beginGroup("tab");
+  for (auto const &key : ini.childKeys())
+    manifest.tabFactories.append(qMakePair(key, ini.value(key).toString()));
+  ini.endGroup();
+
+  ini.beginGroup("inspection");
+  for (auto const &key : ini.childKeys())
+    manifest.inspectionFactories.append(
+          qMakePair(key, ini.value(key).toString()));
+  ini.endGroup();
+
+  for (auto group : {"tool", "listener", "audiodsp", "consumer"}) {
+    ini.beginGroup(group);
+    manifest.eager = manifest.eager || !ini.childKeys().isEmpty();
+    ini.endGroup();
+  }
+
+  return true;
+}
+
 Plugin *
 Plugin::getDefaultPlugin()
 {
@@ -234,6 +296,14 @@ Plugin::load(void)
   if (this->m_loaded)
     return true;
 
+  if (this->m_deferred && this->m_handle == nullptr) {
+    this->m_handle = dlopen(this->m_path.c_str(), RTLD_LAZY);
+    if (this->m_handle == nullptr) {
+      SU_ERROR("Cannot open %s: %s\n", this->m_path.c_str(), dlerror());
+      return false;
+    }
+  }
+
   // Default plugin
   if (this->m_handle == nullptr) {
     pluginEntry = SigDigger::DefaultPluginEntry;
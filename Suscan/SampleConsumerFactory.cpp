@@ -0,0 +1,247 @@
+//
+//    SampleConsumerFactory.cpp: headless consumers of analyzer data
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <SampleConsumerFactory.h>
+#include <Suscan/Library.h>
+
+using namespace SigDigger;
+
+////////////////////////////// SampleConsumer //////////////////////////////////
+SampleConsumer::SampleConsumer(SampleConsumerFactory *factory) :
+  Suscan::FeatureObject(factory)
+{
+  this->m_dropped = 0;
+}
+
+void
+SampleConsumer::samples(Suscan::SamplesMessage const &)
+{
+  // NO-OP
+}
+
+void
+SampleConsumer::psd(Suscan::PSDMessage const &)
+{
+  // NO-OP
+}
+
+void
+SampleConsumer::emission(SignalDetectorEvent const &)
+{
+  // NO-OP
+}
+
+quint64
+SampleConsumer::dropped(void) const
+{
+  return this->m_dropped;
+}
+
+void
+SampleConsumer::notifyDropped(void)
+{
+  ++this->m_dropped;
+}
+
+SampleConsumer::~SampleConsumer()
+{
+
+}
+
+/////////////////////////// SampleConsumerFactory //////////////////////////////
+bool
+SampleConsumerFactory::registerGlobally(void)
+{
+  Suscan::Singleton *s = Suscan::Singleton::get_instance();
+
+  return s->registerSampleConsumerFactory(this);
+}
+
+bool
+SampleConsumerFactory::unregisterGlobally(void)
+{
+  Suscan::Singleton *s = Suscan::Singleton::get_instance();
+
+  return s->unregisterSampleConsumerFactory(this);
+}
+
+SampleConsumerFactory::SampleConsumerFactory(Suscan::Plugin *plugin)
+  : Suscan::FeatureFactory(plugin)
+{
+
+}
+
+////////////////////////// SampleConsumerDispatcher ////////////////////////////
+SampleConsumerDispatcher::SampleConsumerDispatcher(void)
+{
+  Suscan::Singleton *s = Suscan::Singleton::get_instance();
+
+  for (auto p = s->getFirstSampleConsumerFactory();
+       p != s->getLastSampleConsumerFactory();
+       ++p) {
+    SampleConsumer *consumer = (*p)->make();
+
+    if (consumer == nullptr)
+      continue;
+
+    Worker *worker = new Worker;
+
+    worker->consumer = consumer;
+    worker->wants    = consumer->wants();
+    worker->thread   = std::thread(run, worker);
+
+    this->wanted |= worker->wants;
+    this->workers.push_back(worker);
+  }
+}
+
+SampleConsumerDispatcher::~SampleConsumerDispatcher()
+{
+  for (auto worker : this->workers) {
+    {
+      std::lock_guard<std::mutex> guard(worker->mutex);
+      worker->exit = true;
+    }
+
+    worker->ready.notify_one();
+    worker->thread.join();
+
+    delete worker->consumer;
+    delete worker;
+  }
+}
+
+void
+SampleConsumerDispatcher::run(Worker *worker)
+{
+  std::unique_lock<std::mutex> lock(worker->mutex);
+
+  for (;;) {
+    worker->ready.wait(
+          lock,
+          [worker] () { return worker->exit || !worker->queue.empty(); });
+
+    if (worker->exit)
+      break;
+
+    Item item = std::move(worker->queue.front());
+    worker->queue.pop_front();
+
+    lock.unlock();
+    worker->space.notify_one();
+
+    switch (item.kind) {
+      case SampleConsumer::SAMPLES:
+        worker->consumer->samples(item.samples);
+        break;
+
+      case SampleConsumer::PSD:
+        worker->consumer->psd(item.psd);
+        break;
+
+      case SampleConsumer::EMISSIONS:
+        worker->consumer->emission(item.event);
+        break;
+    }
+
+    // The message goes back to the analyzer (or to whoever else shares
+    // it) before waiting for the next one
+    item = Item();
+
+    lock.lock();
+  }
+}
+
+void
+SampleConsumerDispatcher::push(Item const &item, unsigned int kind, bool wait)
+{
+  for (auto worker : this->workers) {
+    if (!(worker->wants & kind))
+      continue;
+
+    {
+      std::unique_lock<std::mutex> lock(worker->mutex);
+
+      if (worker->queue.size() >= SIGDIGGER_SAMPLE_CONSUMER_QUEUE_LEN) {
+        if (wait)
+          worker->space.wait_for(
+                lock,
+                std::chrono::milliseconds(SIGDIGGER_SAMPLE_CONSUMER_WAIT_MS),
+                [worker] () {
+                  return worker->queue.size()
+                      < SIGDIGGER_SAMPLE_CONSUMER_QUEUE_LEN;
+                });
+
+        if (worker->queue.size() >= SIGDIGGER_SAMPLE_CONSUMER_QUEUE_LEN) {
+          worker->consumer->notifyDropped();
+          continue;
+        }
+      }
+
+      worker->queue.push_back(item);
+    }
+
+    worker->ready.notify_one();
+  }
+}
+
+void
+SampleConsumerDispatcher::dispatch(Suscan::SamplesMessage const &msg)
+{
+  if (this->wants(SampleConsumer::SAMPLES)) {
+    // Samples lost are a gap in the decoded stream: worth a short wait
+    this->push(
+          Item {
+            msg,
+            Suscan::PSDMessage(),
+            SignalDetectorEvent(),
+            SampleConsumer::SAMPLES},
+          SampleConsumer::SAMPLES,
+          true);
+  }
+}
+
+void
+SampleConsumerDispatcher::dispatch(Suscan::PSDMessage const &msg)
+{
+  // The next PSD supersedes this one anyway, no waiting
+  if (this->wants(SampleConsumer::PSD))
+    this->push(
+          Item {
+            Suscan::SamplesMessage(),
+            msg,
+            SignalDetectorEvent(),
+            SampleConsumer::PSD},
+          SampleConsumer::PSD,
+          false);
+}
+
+void
+SampleConsumerDispatcher::dispatch(SignalDetectorEvent const &event)
+{
+  // Few and far between: worth a short wait, as samples
+  if (this->wants(SampleConsumer::EMISSIONS))
+    this->push(
+          Item {
+            Suscan::SamplesMessage(),
+            Suscan::PSDMessage(),
+            event,
+            SampleConsumer::EMISSIONS},
+          SampleConsumer::EMISSIONS,
+          true);
+}
@@ -507,6 +507,44 @@ Source::Config::getPPM(void) const
   return suscan_source_config_get_ppm(this->instance);
 }
 
+//
+// A running analyzer can retune, change the bandwidth, PPM, DC removal,
+// antenna and gains of its source. Anything else (source type, device,
+// file, rate, decimation, device arguments...) means opening the source
+// again. Labels are irrelevant.
+//
+bool
+Source::Config::needsRestart(Config const &other) const
+{
+  struct timeval thisStart, otherStart;
+
+  if (this->instance == nullptr || other.instance == nullptr)
+    return this->instance != other.instance;
+
+  if (this->getType() != other.getType()
+      || this->getFormat() != other.getFormat()
+      || this->getInterface() != other.getInterface()
+      || this->getPath() != other.getPath()
+      || this->getSampleRate() != other.getSampleRate()
+      || this->getDecimation() != other.getDecimation()
+      || this->getLoop() != other.getLoop()
+      || this->getIQBalance() != other.getIQBalance())
+    return true;
+
+  if (suscan_source_config_get_device(this->instance)
+      != suscan_source_config_get_device(other.instance))
+    return true;
+
+  thisStart  = this->getStartTime();
+  otherStart = other.getStartTime();
+
+  if (thisStart.tv_sec != otherStart.tv_sec
+      || thisStart.tv_usec != otherStart.tv_usec)
+    return true;
+
+  return this->getParamList() != other.getParamList();
+}
+
 void
 Source::Config::setSampleRate(unsigned int rate)
 {
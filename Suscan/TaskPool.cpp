@@ -0,0 +1,511 @@
+//
+//    TaskPool.cpp: Bounded work-stealing pool for cancellable tasks
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include <Suscan/TaskPool.h>
+#include <ThreadPolicy.h>
+#include <QElapsedTimer>
+#include <algorithm>
+
+using namespace Suscan;
+
+TaskPool *TaskPool::sharedPool = nullptr;
+
+////////////////////////////// TaskPoolWorker //////////////////////////////////
+TaskPoolWorker::TaskPoolWorker(TaskPool *pool, int id)
+{
+  this->pool = pool;
+  this->id   = id;
+}
+
+void
+TaskPoolWorker::run(void)
+{
+  TaskPoolEntry *entry;
+  quint64 generation;
+
+  while (!this->pool->stopFlag) {
+    this->pool->sleepMutex.lock();
+    generation = this->pool->generation;
+    this->pool->sleepMutex.unlock();
+
+    entry = this->pool->next(this->id);
+
+    if (entry != nullptr) {
+      this->pool->runEntry(this->id, entry);
+    } else {
+      // Nothing we are allowed to run. Sleep until the queues change. The
+      // timeout only matters if a wake up is missed.
+      this->pool->sleepMutex.lock();
+      if (generation == this->pool->generation && !this->pool->stopFlag)
+        this->pool->wakeUp.wait(
+              &this->pool->sleepMutex,
+              SIGDIGGER_TASK_POOL_IDLE_WAIT_MS);
+      this->pool->sleepMutex.unlock();
+    }
+  }
+}
+
+///////////////////////////////// TaskPool /////////////////////////////////////
+TaskPool::TaskPool(int threads)
+{
+  int i;
+
+  if (threads <= 0)
+    threads = QThread::idealThreadCount();
+
+  if (threads <= 0)
+    threads = 1;
+
+  for (i = 0; i < threads; ++i)
+    this->queues.push_back(new Queue);
+
+  for (i = 0; i < threads; ++i) {
+    this->workers.push_back(new TaskPoolWorker(this, i));
+    SigDigger::ThreadPolicy::bind(
+          this->workers.back(),
+          SigDigger::THREAD_ROLE_TASKS);
+    this->workers.back()->start();
+  }
+}
+
+TaskPool::~TaskPool()
+{
+  this->stopFlag = 1;
+
+  this->sleepMutex.lock();
+  this->wakeUp.wakeAll();
+  this->sleepMutex.unlock();
+
+  for (auto worker : this->workers) {
+    worker->wait();
+    delete worker;
+  }
+
+  // Workers are gone: whatever is left in the queues can be freed here
+  for (auto queue : this->queues) {
+    for (auto &entries : queue->entries)
+      for (auto entry : entries) {
+        if (entry->task != nullptr)
+          delete entry->task;
+        delete entry;
+      }
+
+    delete queue;
+  }
+}
+
+int
+TaskPool::threadCount(void) const
+{
+  return static_cast<int>(this->workers.size());
+}
+
+void
+TaskPool::notify(void)
+{
+  this->sleepMutex.lock();
+  ++this->generation;
+  this->wakeUp.wakeAll();
+  this->sleepMutex.unlock();
+}
+
+void
+TaskPool::enqueue(int id, TaskPoolEntry *entry)
+{
+  Queue *queue = this->queues[static_cast<size_t>(id)];
+
+  queue->mutex.lock();
+  queue->entries[entry->priority].push_back(entry);
+  queue->mutex.unlock();
+
+  ++this->queued;
+  this->notify();
+}
+
+TaskPoolEntry *
+TaskPool::take(int id, int priority)
+{
+  TaskPoolEntry *entry = nullptr;
+  int count = static_cast<int>(this->queues.size());
+
+  // Own queue first, oldest task first
+  for (int i = 0; i < count && entry == nullptr; ++i) {
+    Queue *queue = this->queues[static_cast<size_t>((id + i) % count)];
+    std::deque<TaskPoolEntry *> &entries = queue->entries[priority];
+
+    queue->mutex.lock();
+    if (!entries.empty()) {
+      if (i == 0) {
+        entry = entries.front();
+        entries.pop_front();
+      } else {
+        // Steal from the back, away from where the owner works
+        entry = entries.back();
+        entries.pop_back();
+      }
+    }
+    queue->mutex.unlock();
+  }
+
+  if (entry != nullptr)
+    --this->queued;
+
+  return entry;
+}
+
+TaskPoolEntry *
+TaskPool::next(int id)
+{
+  TaskPoolEntry *entry;
+  int maxBackground = static_cast<int>(this->workers.size()) - 1;
+
+  if (this->queued == 0)
+    return nullptr;
+
+  if ((entry = this->take(id, TASK_PRIORITY_INTERACTIVE)) != nullptr)
+    return entry;
+
+  // Keep a worker free for interactive tasks, unless we only have one
+  if (maxBackground < 1)
+    maxBackground = 1;
+
+  if (this->runningBackground.fetchAndAddOrdered(1) >= maxBackground) {
+    --this->runningBackground;
+    return nullptr;
+  }
+
+  if ((entry = this->take(id, TASK_PRIORITY_BACKGROUND)) == nullptr)
+    --this->runningBackground;
+
+  return entry;
+}
+
+void
+TaskPool::runEntry(int id, TaskPoolEntry *entry)
+{
+  QElapsedTimer timer;
+  bool more = true;
+
+  timer.start();
+
+  do {
+    if (*entry->finished) {
+      more = false;
+    } else if (entry->task == nullptr) {
+      more = entry->job();
+    } else if (entry->task->isCancelRequested() && !entry->cancelled) {
+      // Some tasks report cancelled() right away, others in their next
+      // step (once they are done with partial results)
+      entry->task->cancel();
+      entry->cancelled = true;
+    } else {
+      more = entry->task->step();
+    }
+  } while (more && !this->stopFlag && timer.elapsed() < entry->sliceMs);
+
+  // Report once per slice, not once per step
+  if (more && !*entry->finished && entry->task != nullptr)
+    entry->task->notifyProgress();
+
+  if (entry->priority == TASK_PRIORITY_BACKGROUND)
+    --this->runningBackground;
+
+  if (more && !*entry->finished)
+    this->enqueue(id, entry);
+  else
+    this->retire(entry);
+}
+
+void
+TaskPool::retire(TaskPoolEntry *entry)
+{
+  if (entry->task == nullptr) {
+    delete entry;
+    this->notify();
+    return;
+  }
+
+  // A task that stops without saying why still has to leave the
+  // controller's list before the object goes away.
+  if (!*entry->finished) {
+    if (entry->cancelled)
+      emit entry->task->cancelled();
+    else
+      emit entry->task->done();
+  }
+
+  // Posted to the thread the task lives in, after any queued signal
+  // this worker emitted for it.
+  entry->task->deleteLater();
+  delete entry;
+
+  this->notify();
+}
+
+void
+TaskPool::push(CancellableTask *task, TaskPriority priority, qint64 sliceMs)
+{
+  TaskPoolEntry *entry = new TaskPoolEntry;
+  std::shared_ptr<QAtomicInteger<int>> finished =
+      std::make_shared<QAtomicInteger<int>>(0);
+
+  if (sliceMs <= 0)
+    sliceMs = priority == TASK_PRIORITY_INTERACTIVE
+        ? SIGDIGGER_TASK_POOL_INTERACTIVE_SLICE_MS
+        : SIGDIGGER_TASK_POOL_BACKGROUND_SLICE_MS;
+
+  entry->task     = task;
+  entry->priority = priority;
+  entry->sliceMs  = sliceMs;
+  entry->finished = finished;
+
+  // Functor connections are direct: the flag is set by whichever thread
+  // emits, before work() gets called again.
+  QObject::connect(
+        task,
+        &CancellableTask::done,
+        [finished] () { *finished = 1; });
+
+  QObject::connect(
+        task,
+        &CancellableTask::cancelled,
+        [finished] () { *finished = 1; });
+
+  QObject::connect(
+        task,
+        &CancellableTask::error,
+        [finished] (QString) { *finished = 1; });
+
+  this->enqueue(
+        static_cast<int>(
+          this->nextQueue.fetchAndAddOrdered(1) % this->queues.size()),
+        entry);
+}
+
+void
+TaskPool::submit(
+    std::function<bool (void)> job,
+    TaskPriority priority,
+    qint64 sliceMs)
+{
+  TaskPoolEntry *entry = new TaskPoolEntry;
+
+  if (sliceMs <= 0)
+    sliceMs = priority == TASK_PRIORITY_INTERACTIVE
+        ? SIGDIGGER_TASK_POOL_INTERACTIVE_SLICE_MS
+        : SIGDIGGER_TASK_POOL_BACKGROUND_SLICE_MS;
+
+  entry->job      = std::move(job);
+  entry->priority = priority;
+  entry->sliceMs  = sliceMs;
+  entry->finished = std::make_shared<QAtomicInteger<int>>(0);
+
+  this->enqueue(
+        static_cast<int>(
+          this->nextQueue.fetchAndAddOrdered(1) % this->queues.size()),
+        entry);
+}
+
+TaskPool *
+TaskPool::shared(void)
+{
+  return TaskPool::sharedPool;
+}
+
+void
+TaskPool::setShared(TaskPool *pool)
+{
+  TaskPool::sharedPool = pool;
+}
+
+///////////////////////////////// TaskSlices ///////////////////////////////////
+bool
+TaskSlices::State::isCancelled(void) const
+{
+  // The owner is alive as long as stop() was not called
+  return this->stopFlag.loadAcquire() != 0
+      || (this->owner != nullptr && this->owner->isCancelRequested());
+}
+
+bool
+TaskSlices::State::runOne(void)
+{
+  bool ran = false;
+  int unit;
+
+  // Ordered on both sides: stop() either sees us active, or we see it
+  this->active.fetchAndAddOrdered(1);
+
+  if (!this->stopFlag.fetchAndAddOrdered(0)
+      && !this->isCancelled()
+      && (unit = this->next.fetchAndAddOrdered(1)) < this->count) {
+    this->body(unit);
+    this->completed.fetchAndAddOrdered(1);
+    ran = true;
+  }
+
+  if (this->active.fetchAndAddOrdered(-1) == 1) {
+    this->mutex.lock();
+    this->idle.wakeAll();
+    this->mutex.unlock();
+  }
+
+  return ran;
+}
+
+TaskSlices::TaskSlices(CancellableTask *owner)
+{
+  this->owner = owner;
+}
+
+TaskSlices::~TaskSlices()
+{
+  this->stop();
+}
+
+void
+TaskSlices::launch(
+    int count,
+    std::function<void (int)> body,
+    TaskPriority priority,
+    int threads,
+    bool takesUnits)
+{
+  TaskPool *pool = TaskPool::shared();
+  std::shared_ptr<State> state = std::make_shared<State>();
+  int helpers = 0;
+
+  this->stop();
+
+  state->owner = this->owner;
+  state->body  = std::move(body);
+  state->count = count;
+  this->state  = state;
+
+  if (pool != nullptr) {
+    if (threads <= 0 || threads > pool->threadCount())
+      threads = pool->threadCount();
+
+    if (takesUnits)
+      helpers = std::min(threads - 1, count - 1);
+    else
+      helpers = std::min(threads, count);
+  } else if (!takesUnits) {
+    while (state->runOne())
+      continue;
+  }
+
+  for (int i = 0; i < helpers; ++i)
+    pool->submit([state] () { return state->runOne(); }, priority);
+}
+
+void
+TaskSlices::start(
+    int count,
+    std::function<void (int)> body,
+    TaskPriority priority,
+    int threads)
+{
+  this->launch(count, std::move(body), priority, threads, true);
+}
+
+void
+TaskSlices::submit(
+    int count,
+    std::function<void (int)> body,
+    TaskPriority priority,
+    int threads)
+{
+  this->launch(count, std::move(body), priority, threads, false);
+}
+
+bool
+TaskSlices::runOne(void)
+{
+  return this->state != nullptr && this->state->runOne();
+}
+
+bool
+TaskSlices::wait(unsigned long ms)
+{
+  if (this->state == nullptr)
+    return false;
+
+  this->state->mutex.lock();
+  if (this->state->active.loadAcquire() > 0)
+    this->state->idle.wait(&this->state->mutex, ms);
+  this->state->mutex.unlock();
+
+  return this->isFinished();
+}
+
+bool
+TaskSlices::step(unsigned long pollMs)
+{
+  return !this->runOne() && this->wait(pollMs);
+}
+
+bool
+TaskSlices::isFinished(void) const
+{
+  return this->state != nullptr
+      && this->state->completed.loadAcquire() >= this->state->count;
+}
+
+int
+TaskSlices::completed(void) const
+{
+  return this->state != nullptr ? this->state->completed.loadAcquire() : 0;
+}
+
+bool
+TaskSlices::isCancelled(void) const
+{
+  return this->state != nullptr && this->state->isCancelled();
+}
+
+void
+TaskSlices::cancel(void)
+{
+  if (this->state != nullptr)
+    this->state->stopFlag.fetchAndStoreOrdered(1);
+}
+
+void
+TaskSlices::stop(void)
+{
+  if (this->state == nullptr)
+    return;
+
+  this->cancel();
+
+  this->state->mutex.lock();
+  while (this->state->active.loadAcquire() > 0)
+    this->state->idle.wait(&this->state->mutex);
+  this->state->mutex.unlock();
+}
+
+void
+TaskSlices::cancelOwner(void)
+{
+  this->cancel();
+
+  if (this->owner != nullptr)
+    emit this->owner->cancelled();
+}
@@ -19,14 +19,6 @@
 #include <AGCTask.h>
 #include <Suscan/Library.h>
 
-#define SIGDIGGER_AGC_FAST_RISE_FRAC   (2 * 3.9062e-1)
-#define SIGDIGGER_AGC_FAST_FALL_FRAC   (2 * SIGDIGGER_AGC_FAST_RISE_FRAC)
-#define SIGDIGGER_AGC_SLOW_RISE_FRAC   (10 * SIGDIGGER_AGC_FAST_RISE_FRAC)
-#define SIGDIGGER_AGC_SLOW_FALL_FRAC   (10 * SIGDIGGER_AGC_FAST_FALL_FRAC)
-#define SIGDIGGER_AGC_HANG_MAX_FRAC    (SIGDIGGER_AGC_FAST_RISE_FRAC * 5)
-#define SIGDIGGER_AGC_DELAY_LINE_FRAC  (SIGDIGGER_AGC_FAST_RISE_FRAC * 10)
-#define SIGDIGGER_AGC_MAG_HISTORY_FRAC (SIGDIGGER_AGC_FAST_RISE_FRAC * 10)
-
 #define SIGDIGGER_AGC_BLOCK_LENGTH 4096
 
 
@@ -54,8 +46,8 @@ AGCTask::AGCTask(
 
   this->agcInitialized = true;
 
-  this->setProgress(0);
-  this->setStatus("Processing...");
+  this->setProgressCount(0, this->length);
+  this->setStatusFormat("Processing (%1/%2)...");
 }
 
 bool
@@ -74,13 +66,7 @@ AGCTask::work(void)
 
   this->p = p;
 
-  this->setStatus("Processing ("
-                  + QString::number(p)
-                  + "/"
-                  + QString::number(this->length)
-                  + ")...");
-
-  this->setProgress(static_cast<qreal>(p) / static_cast<qreal>(this->length));
+  this->setProgressCount(p, this->length);
 
   if (this->p < this->length)
     return true;
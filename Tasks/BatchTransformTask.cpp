@@ -0,0 +1,260 @@
+//
+//    BatchTransformTask.cpp: Run a transform chain over a list of captures
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <BatchTransformTask.h>
+#include <ExportSamplesTask.h>
+#include <CaptureFile.h>
+#include <Suscan/Library.h>
+#include <QMutexLocker>
+#include <QFileInfo>
+#include <QDir>
+#include <algorithm>
+#include <memory>
+#include <new>
+
+using namespace SigDigger;
+
+BatchTransformTask::BatchTransformTask(
+    QStringList const &inputs,
+    QString const &outputDir,
+    QString const &format,
+    std::vector<TransformStep> const &steps,
+    qreal defaultRate,
+    QObject *parent) : CancellableTask(parent), slices(this)
+{
+  this->inputs      = inputs;
+  this->outputDir   = outputDir;
+  this->format      = format;
+  this->steps       = steps;
+  this->defaultRate = defaultRate;
+
+  this->setProgressCount(0, static_cast<quint64>(inputs.size()));
+  this->setStatusFormat("Processing captures (%1/%2)...");
+}
+
+BatchTransformTask::~BatchTransformTask()
+{
+  // Captures waiting for memory must notice too
+  this->slices.cancel();
+  this->memoryMutex.lock();
+  this->memoryCond.wakeAll();
+  this->memoryMutex.unlock();
+
+  this->slices.stop();
+}
+
+bool
+BatchTransformTask::acquireMemory(quint64 bytes)
+{
+  QMutexLocker locker(&this->memoryMutex);
+
+  // A capture that does not fit the budget is still let through when
+  // nothing else is in memory
+  while (this->memoryInUse > 0
+         && this->memoryInUse + bytes > SIGDIGGER_BATCH_MEMORY_MAX) {
+    if (this->slices.isCancelled())
+      return false;
+    this->memoryCond.wait(
+          &this->memoryMutex,
+          SIGDIGGER_BATCH_POLL_INTERVAL_MS);
+  }
+
+  this->memoryInUse += bytes;
+  return true;
+}
+
+void
+BatchTransformTask::releaseMemory(quint64 bytes)
+{
+  QMutexLocker locker(&this->memoryMutex);
+
+  this->memoryInUse -= bytes;
+  this->memoryCond.wakeAll();
+}
+
+void
+BatchTransformTask::fail(QString const &path, QString const &reason)
+{
+  QMutexLocker locker(&this->failureMutex);
+
+  this->failures.append(QFileInfo(path).fileName() + ": " + reason);
+}
+
+QString
+BatchTransformTask::outputPath(QString const &input) const
+{
+  return QDir(this->outputDir).filePath(
+        QFileInfo(input).completeBaseName()
+        + "-processed."
+        + this->format);
+}
+
+void
+BatchTransformTask::processInput(QString const &path)
+{
+  CaptureFile file;
+  std::shared_ptr<std::vector<SUCOMPLEX>> buffer;
+  quint64 length;
+  quint64 bytes;
+  qreal rate;
+  size_t p = 0;
+
+  if (!file.open(path.toStdString())) {
+    this->fail(path, QString::fromStdString(file.getError()));
+    return;
+  }
+
+  length = file.getLength();
+  rate   = file.getSampleRate() > 0 ? file.getSampleRate() : this->defaultRate;
+
+  if (length == 0) {
+    this->fail(path, "capture is empty");
+    return;
+  }
+
+  if (length > SIGDIGGER_BATCH_MAX_SAMPLES) {
+    this->fail(
+          path,
+          "capture is longer than "
+          + QString::number(SIGDIGGER_BATCH_MAX_SAMPLES)
+          + " samples");
+    return;
+  }
+
+  bytes = length * sizeof(SUCOMPLEX);
+  if (!this->acquireMemory(bytes))
+    return;
+
+  try {
+    buffer = std::make_shared<std::vector<SUCOMPLEX>>(length);
+  } catch (std::bad_alloc &) {
+    this->releaseMemory(bytes);
+    this->fail(path, "out of memory");
+    return;
+  }
+
+  while (p < length && !this->slices.isCancelled()) {
+    size_t amount = std::min<size_t>(length - p, SIGDIGGER_BATCH_READ_BLOCK);
+    ssize_t got = file.read(p, buffer->data() + p, amount);
+
+    if (got <= 0) {
+      buffer->resize(p);
+      break;
+    }
+
+    p += static_cast<size_t>(got);
+  }
+
+  file.close();
+
+  try {
+    TransformChainTask chain(
+          buffer->data(),
+          buffer->data(),
+          buffer->size(),
+          this->steps);
+
+    while (!this->slices.isCancelled() && chain.work());
+  } catch (Suscan::Exception &e) {
+    this->releaseMemory(bytes);
+    this->fail(path, QString::fromStdString(e.what()));
+    return;
+  }
+
+  if (!this->slices.isCancelled()) {
+    ExportSamplesTask exporter(
+          this->outputPath(path),
+          this->format,
+          buffer,
+          rate,
+          0,
+          static_cast<int>(buffer->size()));
+
+    // Writes the whole capture in a single call
+    if (exporter.attemptOpen())
+      exporter.work();
+
+    if (!exporter.getLastError().isEmpty())
+      this->fail(path, exporter.getLastError());
+  }
+
+  buffer.reset();
+  this->releaseMemory(bytes);
+}
+
+void
+BatchTransformTask::runInput(int index)
+{
+  this->processInput(this->inputs[index]);
+  this->processed.fetchAndAddRelaxed(1);
+}
+
+bool
+BatchTransformTask::work(void)
+{
+  bool finished;
+
+  if (!this->started) {
+    if (this->inputs.isEmpty()) {
+      emit error("No captures were given.");
+      return false;
+    }
+
+    this->slices.start(
+          this->inputs.size(),
+          [this] (int index) { this->runInput(index); },
+          Suscan::TASK_PRIORITY_BACKGROUND,
+          SIGDIGGER_BATCH_MAX_CAPTURES);
+
+    this->started = true;
+    return true;
+  }
+
+  finished = this->slices.step(SIGDIGGER_BATCH_POLL_INTERVAL_MS);
+
+  this->setProgressCount(
+        static_cast<quint64>(this->processed.loadAcquire()),
+        static_cast<quint64>(this->inputs.size()));
+
+  if (!finished)
+    return true;
+
+  if (!this->failures.isEmpty()) {
+    emit error(
+          QString::number(this->failures.size())
+          + " of "
+          + QString::number(this->inputs.size())
+          + " captures failed. "
+          + this->failures.join("; "));
+    return false;
+  }
+
+  emit done();
+  return false;
+}
+
+void
+BatchTransformTask::cancel(void)
+{
+  this->slices.cancelOwner();
+
+  // Captures waiting for memory must notice too
+  this->memoryMutex.lock();
+  this->memoryCond.wakeAll();
+  this->memoryMutex.unlock();
+}
@@ -0,0 +1,272 @@
+//
+//    BaudEstimatorTask.cpp: Symbol rate estimation from the squared envelope
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "BaudEstimatorTask.h"
+#include "FFTPlanCache.h"
+#include <sigutils/taps.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace SigDigger;
+
+BaudEstimatorTask::BaudEstimatorTask(
+    std::shared_ptr<const std::vector<SUCOMPLEX>> const &buffer,
+    size_t start,
+    size_t length,
+    qreal fs,
+    QObject *parent) :
+  Suscan::CancellableTask(parent),
+  buffer(buffer),
+  slices(this)
+{
+  this->start  = std::min(start, buffer->size());
+  this->length = std::min(length, buffer->size() - this->start);
+  this->fs     = fs;
+
+  this->setStatus("Estimating symbol rate");
+}
+
+BaudEstimatorTask::~BaudEstimatorTask()
+{
+  this->slices.stop();
+}
+
+bool
+BaudEstimatorTask::prepare(void)
+{
+  SU_FFTW(_complex) *scratch;
+  size_t possible;
+
+  this->segmentSize = SIGDIGGER_BAUD_ESTIMATOR_SEGMENT_MAX;
+  while (this->segmentSize > this->length)
+    this->segmentSize >>= 1;
+
+  // Half overlapping segments, or evenly spread ones if there are too many
+  possible = 1 + (this->length - this->segmentSize) / (this->segmentSize / 2);
+
+  if (possible > SIGDIGGER_BAUD_ESTIMATOR_MAX_SEGMENTS) {
+    this->segments = SIGDIGGER_BAUD_ESTIMATOR_MAX_SEGMENTS;
+    this->stride   =
+        (this->length - this->segmentSize) / (this->segments - 1);
+  } else {
+    this->segments = possible;
+    this->stride   = this->segmentSize / 2;
+  }
+
+  // Only needed to get an aligned, in-place plan
+  if ((scratch = static_cast<SU_FFTW(_complex) *>(
+         SU_FFTW(_malloc)(this->segmentSize * sizeof(SUCOMPLEX)))) == nullptr)
+    return false;
+
+  this->plan = FFTPlanCache::instance()->get(
+        static_cast<int>(this->segmentSize),
+        FFTW_FORWARD,
+        scratch,
+        scratch);
+
+  SU_FFTW(_free)(scratch);
+
+  this->psd.assign(this->segmentSize / 2 + 1, 0);
+
+  return this->plan != nullptr;
+}
+
+void
+BaudEstimatorTask::runSegment(int index)
+{
+  SU_FFTW(_complex) *segment;
+  SUCOMPLEX *asSuComplex;
+  const SUCOMPLEX *data;
+  SUFLOAT mean;
+  size_t i;
+
+  if ((segment = static_cast<SU_FFTW(_complex) *>(
+         SU_FFTW(_malloc)(this->segmentSize * sizeof(SUCOMPLEX)))) == nullptr) {
+    this->failed.storeRelease(1);
+    return;
+  }
+
+  asSuComplex = reinterpret_cast<SUCOMPLEX *>(segment);
+
+  data = this->buffer->data()
+      + this->start
+      + static_cast<size_t>(index) * this->stride;
+
+  // Squared envelope, without its mean (it would only leak from DC)
+  mean = 0;
+  for (i = 0; i < this->segmentSize; ++i) {
+    asSuComplex[i] = SU_C_REAL(data[i] * SU_C_CONJ(data[i]));
+    mean += SU_C_REAL(asSuComplex[i]);
+  }
+
+  mean /= static_cast<SUFLOAT>(this->segmentSize);
+  for (i = 0; i < this->segmentSize; ++i)
+    asSuComplex[i] -= mean;
+
+  su_taps_apply_blackmann_harris_complex(
+        asSuComplex,
+        static_cast<SUSCOUNT>(this->segmentSize));
+
+  FFTPlanCache::execute(this->plan, segment, segment);
+
+  // The envelope is real: the upper half is the mirror of the lower one
+  this->psdMutex.lock();
+  for (i = 0; i < this->psd.size(); ++i)
+    this->psd[i] += SU_C_REAL(asSuComplex[i] * SU_C_CONJ(asSuComplex[i]));
+  this->psdMutex.unlock();
+
+  this->processed.fetchAndAddRelaxed(1);
+
+  SU_FFTW(_free)(segment);
+}
+
+void
+BaudEstimatorTask::findCandidates(void)
+{
+  struct Line {
+    qreal bin;
+    SUFLOAT power;
+  };
+
+  std::vector<SUFLOAT> sorted(
+        this->psd.begin() + SIGDIGGER_BAUD_ESTIMATOR_DC_BINS,
+        this->psd.end() - 1);
+  std::vector<Line> lines, accepted;
+  qreal binWidth = this->fs / static_cast<qreal>(this->segmentSize);
+  SUFLOAT median, excess = 0;
+  size_t k;
+
+  this->candidates.clear();
+
+  if (sorted.empty())
+    return;
+
+  std::nth_element(
+        sorted.begin(),
+        sorted.begin() + sorted.size() / 2,
+        sorted.end());
+  median = sorted[sorted.size() / 2];
+
+  if (median <= 0)
+    return;
+
+  // Local maxima standing out of the median, refined by fitting a
+  // parabola to the log power of the bins around them
+  for (k = SIGDIGGER_BAUD_ESTIMATOR_DC_BINS; k + 1 < this->psd.size(); ++k) {
+    SUFLOAT p = this->psd[k];
+
+    if (p > this->psd[k - 1]
+        && p >= this->psd[k + 1]
+        && p >= SIGDIGGER_BAUD_ESTIMATOR_MIN_PEAK_RATIO * median) {
+      qreal a = std::log(static_cast<qreal>(this->psd[k - 1]) + 1e-30);
+      qreal b = std::log(static_cast<qreal>(p));
+      qreal c = std::log(static_cast<qreal>(this->psd[k + 1]) + 1e-30);
+      qreal den = a - 2 * b + c;
+      qreal delta = den < 0 ? .5 * (a - c) / den : 0;
+
+      lines.push_back({static_cast<qreal>(k) + delta, p});
+    }
+  }
+
+  std::sort(
+        lines.begin(),
+        lines.end(),
+        [] (Line const &a, Line const &b) { return a.power > b.power; });
+
+  // Pulse shapes leave weaker lines at multiples of the rate
+  for (auto const &line : lines) {
+    bool harmonic = false;
+
+    for (auto const &fundamental : accepted) {
+      qreal n = std::round(line.bin / fundamental.bin);
+
+      if (n >= 2 && std::fabs(line.bin - n * fundamental.bin) <= n) {
+        harmonic = true;
+        break;
+      }
+    }
+
+    if (!harmonic) {
+      accepted.push_back(line);
+      excess += line.power - median;
+      if (accepted.size() == SIGDIGGER_BAUD_ESTIMATOR_MAX_CANDIDATES)
+        break;
+    }
+  }
+
+  for (auto const &line : accepted)
+    this->candidates.push_back({
+          line.bin * binWidth,
+          static_cast<qreal>((line.power - median) / excess),
+          10 * std::log10(line.power / median)});
+}
+
+bool
+BaudEstimatorTask::work(void)
+{
+  bool finished;
+
+  if (!this->launched) {
+    if (this->length < SIGDIGGER_BAUD_ESTIMATOR_SEGMENT_MIN) {
+      emit error("Selection is too short to estimate the symbol rate.");
+      return false;
+    }
+
+    if (!this->prepare()) {
+      emit error("Failed to initialize FFT plan.");
+      return false;
+    }
+
+    this->slices.start(
+          static_cast<int>(this->segments),
+          [this] (int index) { this->runSegment(index); });
+
+    this->setProgressCount(0, this->segments);
+    this->setStatusFormat("Estimating symbol rate (%1/%2 segments)...");
+    this->launched = true;
+    return true;
+  }
+
+  finished = this->slices.step(SIGDIGGER_BAUD_ESTIMATOR_POLL_INTERVAL_MS);
+
+  this->setProgressCount(
+        static_cast<quint64>(this->processed.loadAcquire()),
+        this->segments);
+
+  if (!finished)
+    return true;
+
+  if (this->slices.isCancelled())
+    return false;
+
+  if (this->failed.loadAcquire()) {
+    emit error("Failed to allocate segment buffers.");
+    return false;
+  }
+
+  this->findCandidates();
+
+  emit done();
+  return false;
+}
+
+void
+BaudEstimatorTask::cancel(void)
+{
+  this->slices.cancelOwner();
+}
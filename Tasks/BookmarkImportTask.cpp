@@ -0,0 +1,371 @@
+//
+//    BookmarkImportTask.cpp: Parse bookmark lists in the background
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "BookmarkImportTask.h"
+#include <SuWidgetsHelpers.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace SigDigger;
+
+static bool typesRegistered = false;
+
+BookmarkImportTask::BookmarkImportTask(
+    QString const &path,
+    QObject *parent) : CancellableTask(parent)
+{
+  if (!typesRegistered) {
+    qRegisterMetaType<QList<BookmarkInfo>>("QList<BookmarkInfo>");
+    typesRegistered = true;
+  }
+
+  this->path = path;
+  this->file.setFileName(path);
+
+  this->assumeLayout();
+  this->setStatus("Opening " + path);
+}
+
+BookmarkImportTask::~BookmarkImportTask(void)
+{
+}
+
+void
+BookmarkImportTask::assumeLayout(void)
+{
+  this->columns[COLUMN_FREQUENCY]  = 0;
+  this->columns[COLUMN_NAME]       = 1;
+  this->columns[COLUMN_BANDWIDTH]  = 2;
+  this->columns[COLUMN_MODULATION] = 3;
+  this->columns[COLUMN_COLOR]      = 4;
+  this->columns[COLUMN_TAGS]       = -1;
+}
+
+void
+BookmarkImportTask::guessDelimiter(QString const &line)
+{
+  const QChar candidates[] = {';', '\t', ','};
+  int best = 0;
+
+  this->delimiter = ',';
+
+  for (auto c : candidates) {
+    int count = line.count(c);
+
+    if (count > best) {
+      best = count;
+      this->delimiter = c;
+    }
+  }
+}
+
+QStringList
+BookmarkImportTask::split(QString const &line) const
+{
+  QStringList fields;
+  QString current;
+  bool quoted = false;
+  int i;
+
+  for (i = 0; i < line.size(); ++i) {
+    QChar c = line[i];
+
+    if (quoted) {
+      if (c != '"')
+        current += c;
+      else if (i + 1 < line.size() && line[i + 1] == '"')
+        current += line[++i];
+      else
+        quoted = false;
+    } else if (c == '"') {
+      quoted = true;
+    } else if (c == this->delimiter) {
+      fields.append(current.trimmed());
+      current.clear();
+    } else {
+      current += c;
+    }
+  }
+
+  fields.append(current.trimmed());
+
+  return fields;
+}
+
+QString
+BookmarkImportTask::field(QStringList const &fields, Column col) const
+{
+  int index = this->columns[col];
+
+  if (index < 0 || index >= fields.size())
+    return QString();
+
+  return fields[index];
+}
+
+qreal
+BookmarkImportTask::parseQuantity(QString const &text, qreal scale, bool *ok)
+{
+  QString value = text.trimmed();
+  qreal result;
+
+  if (value.endsWith("hz", Qt::CaseInsensitive))
+    value = value.left(value.size() - 2).trimmed();
+
+  if (!value.isEmpty()) {
+    switch (value[value.size() - 1].toLower().toLatin1()) {
+      case 'k':
+        scale = 1e3;
+        value.chop(1);
+        break;
+
+      case 'm':
+        scale = 1e6;
+        value.chop(1);
+        break;
+
+      case 'g':
+        scale = 1e9;
+        value.chop(1);
+        break;
+    }
+  }
+
+  result = value.trimmed().toDouble(ok) * scale;
+
+  if (*ok && !std::isfinite(result))
+    *ok = false;
+
+  return result;
+}
+
+bool
+BookmarkImportTask::parseHeader(QStringList const &fields)
+{
+  int columns[COLUMN_COUNT];
+  qreal scale = 1;
+  bool ok;
+  int i;
+
+  std::fill(columns, columns + COLUMN_COUNT, -1);
+
+  for (i = 0; i < fields.size(); ++i) {
+    QString name = fields[i].toLower();
+    Column col;
+
+    // Numbers mean data, not column names
+    (void) parseQuantity(fields[i], 1, &ok);
+    if (ok)
+      return false;
+
+    if (name.startsWith("freq")) {
+      col = COLUMN_FREQUENCY;
+      if (name.contains("ghz"))
+        scale = 1e9;
+      else if (name.contains("mhz"))
+        scale = 1e6;
+      else if (name.contains("khz"))
+        scale = 1e3;
+    } else if (name.contains("name")
+               || name.startsWith("label")
+               || name.startsWith("desc")) {
+      col = COLUMN_NAME;
+    } else if (name.startsWith("mod")) {
+      col = COLUMN_MODULATION;
+    } else if (name.startsWith("bandw") || name == "bw") {
+      col = COLUMN_BANDWIDTH;
+    } else if (name.startsWith("colo")) {
+      col = COLUMN_COLOR;
+    } else if (name.startsWith("tag")) {
+      col = COLUMN_TAGS;
+    } else {
+      continue;
+    }
+
+    if (columns[col] == -1)
+      columns[col] = i;
+  }
+
+  if (columns[COLUMN_FREQUENCY] == -1)
+    return false;
+
+  std::copy(columns, columns + COLUMN_COUNT, this->columns);
+  this->frequencyScale = scale;
+
+  return true;
+}
+
+void
+BookmarkImportTask::parseTag(QStringList const &fields)
+{
+  QColor color(fields.value(1));
+
+  if (!fields[0].isEmpty() && color.isValid())
+    this->tagColors[fields[0]] = color;
+}
+
+void
+BookmarkImportTask::parseEntry(QStringList const &fields)
+{
+  BookmarkInfo info;
+  QString modulation = this->field(fields, COLUMN_MODULATION).toUpper();
+  QString bandwidth = this->field(fields, COLUMN_BANDWIDTH);
+  qreal frequency;
+  qreal bw = 0;
+  bool ok;
+
+  frequency = parseQuantity(
+        this->field(fields, COLUMN_FREQUENCY),
+        this->frequencyScale,
+        &ok);
+
+  if (!ok) {
+    ++this->rejected;
+    return;
+  }
+
+  if (!bandwidth.isEmpty()) {
+    bw = parseQuantity(bandwidth, 1, &ok);
+    if (!ok || bw < 0)
+      bw = 0;
+  }
+
+  // Other programs have their own names for the demodulators we know
+  if (modulation.contains("USB"))
+    modulation = "USB";
+  else if (modulation.contains("LSB"))
+    modulation = "LSB";
+  else if (modulation.contains("FM"))
+    modulation = "FM";
+  else if (modulation.startsWith("AM"))
+    modulation = "AM";
+  else
+    modulation = this->field(fields, COLUMN_MODULATION);
+
+  info.frequency   = static_cast<qint64>(std::round(frequency));
+  info.name        = this->field(fields, COLUMN_NAME);
+  info.modulation  = modulation;
+  info.lowFreqCut  = -static_cast<qint32>(bw / 2);
+  info.highFreqCut = +static_cast<qint32>(bw / 2);
+  info.color       = QColor(this->field(fields, COLUMN_COLOR));
+
+  if (!info.color.isValid())
+    info.color = this->tagColors.value(
+          this->field(fields, COLUMN_TAGS).section(',', 0, 0).trimmed(),
+          QColor(SIGDIGGER_BOOKMARK_IMPORT_DEFAULT_COLOR));
+
+  // Unnamed bookmarks are dropped when the bookmark file is loaded
+  if (info.name.isEmpty())
+    info.name = SuWidgetsHelpers::formatQuantity(info.frequency, "Hz");
+
+  this->bookmarks.append(info);
+}
+
+void
+BookmarkImportTask::parseLine(QString const &text)
+{
+  QString line = text.trimmed();
+  QStringList fields;
+
+  if (line.startsWith(QChar(0xfeff)))
+    line = line.mid(1).trimmed();
+
+  if (line.isEmpty())
+    return;
+
+  if (line.startsWith('#')) {
+    QString comment = line.mid(1).trimmed();
+    QString lower = comment.toLower();
+
+    if (lower.startsWith("tag name")) {
+      this->guessDelimiter(comment);
+      this->inTagTable = true;
+    } else if (lower.startsWith("freq")) {
+      this->guessDelimiter(comment);
+      this->inTagTable = false;
+      this->haveHeader = this->parseHeader(this->split(comment));
+    }
+
+    return;
+  }
+
+  if (this->delimiter.isNull())
+    this->guessDelimiter(line);
+
+  fields = this->split(line);
+
+  if (this->inTagTable) {
+    this->parseTag(fields);
+    return;
+  }
+
+  // Only the first line may be an uncommented header
+  if (!this->haveHeader
+      && this->bookmarks.isEmpty()
+      && this->rejected == 0
+      && this->parseHeader(fields)) {
+    this->haveHeader = true;
+    return;
+  }
+
+  this->parseEntry(fields);
+}
+
+bool
+BookmarkImportTask::work(void)
+{
+  int i;
+
+  if (this->cancelFlag) {
+    emit cancelled();
+    return false;
+  }
+
+  if (!this->file.isOpen()) {
+    if (!this->file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      emit error(
+            "Cannot open " + this->path + ": " + this->file.errorString());
+      return false;
+    }
+
+    this->setStatusFormat("Reading bookmarks (%1/%2 bytes)...");
+  }
+
+  for (i = 0; i < SIGDIGGER_BOOKMARK_IMPORT_LINES_PER_STEP; ++i) {
+    if (this->file.atEnd()) {
+      this->file.close();
+      emit parsed(this->path, this->bookmarks, this->rejected);
+      emit done();
+      return false;
+    }
+
+    this->parseLine(QString::fromUtf8(this->file.readLine()));
+  }
+
+  this->setProgressCount(
+        static_cast<quint64>(this->file.pos()),
+        static_cast<quint64>(this->file.size()));
+
+  return true;
+}
+
+void
+BookmarkImportTask::cancel(void)
+{
+  this->cancelFlag = true;
+}
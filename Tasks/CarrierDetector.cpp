@@ -17,7 +17,9 @@
 //    <http://www.gnu.org/licenses/>
 //
 #include "CarrierDetector.h"
+#include "FFTPlanCache.h"
 #include <sigutils/taps.h>
+#include <algorithm>
 
 using namespace SigDigger;
 
@@ -26,7 +28,8 @@ CarrierDetector::CarrierDetector(
     size_t len,
     qreal avgRelBw,
     qreal dcNotchRelBw,
-    QObject *parent) : CancellableTask(parent)
+    size_t segmentSize,
+    QObject *parent) : CancellableTask(parent), slices(this)
 {
   this->data = data;
   this->len = len;
@@ -34,26 +37,149 @@ CarrierDetector::CarrierDetector(
   this->setProgress(0);
   this->dcNotchRelBw = qBound(0., dcNotchRelBw, 1.);
 
+  // A segment as long as the selection is just the single FFT
+  if (segmentSize > 0 && segmentSize < len)
+    this->segmentSize = segmentSize;
+
   this->setStatus("Estimating best FFT plan");
 }
 
 CarrierDetector::~CarrierDetector()
 {
-  if (this->plan != nullptr)
-    SU_FFTW(_destroy_plan)(this->plan);
+  this->slices.stop();
 
   if (this->buffer != nullptr)
     SU_FFTW(_free)(this->buffer);
 }
 
+void
+CarrierDetector::startSegments(void)
+{
+  Suscan::TaskPool *pool = Suscan::TaskPool::shared();
+  size_t threads = pool != nullptr
+      ? static_cast<size_t>(pool->threadCount())
+      : 1;
+
+  this->hop      = std::max<size_t>(1, this->allocation / 2);
+  this->segments =
+      1 + (this->len - this->allocation + this->hop - 1) / this->hop;
+  this->batches  = std::min(
+        this->segments,
+        threads * SIGDIGGER_CARRIER_DETECTOR_BATCHES_PER_CPU);
+
+  this->psd.assign(this->allocation, 0);
+
+  this->slices.start(
+        static_cast<int>(this->batches),
+        [this] (int batch) { this->runBatch(batch); });
+}
+
+void
+CarrierDetector::runBatch(int batch)
+{
+  SU_FFTW(_complex) *segment;
+  SUCOMPLEX *asSuComplex;
+  std::vector<SUFLOAT> acc(this->allocation, 0);
+  size_t first = static_cast<size_t>(batch) * this->segments / this->batches;
+  size_t last  =
+      static_cast<size_t>(batch + 1) * this->segments / this->batches;
+  size_t start, count, i, index;
+
+  if ((segment = static_cast<SU_FFTW(_complex) *>(
+         SU_FFTW(_malloc)(this->allocation * sizeof(SUCOMPLEX)))) == nullptr) {
+    this->failed.storeRelease(1);
+    return;
+  }
+
+  asSuComplex = reinterpret_cast<SUCOMPLEX *>(segment);
+
+  for (index = first;
+       index < last
+       && !this->slices.isCancelled()
+       && !this->failed.loadAcquire();
+       ++index) {
+    start = index * this->hop;
+    count = std::min(this->allocation, this->len - start);
+
+    memcpy(segment, this->data + start, count * sizeof(SUCOMPLEX));
+    memset(
+          segment + count,
+          0,
+          (this->allocation - count) * sizeof(SUCOMPLEX));
+
+    su_taps_apply_blackmann_harris_complex(
+          asSuComplex,
+          static_cast<SUSCOUNT>(count));
+
+    FFTPlanCache::execute(this->plan, segment, segment);
+
+    for (i = 0; i < this->allocation; ++i)
+      acc[i] += SU_C_REAL(asSuComplex[i] * SU_C_CONJ(asSuComplex[i]));
+
+    this->processed.fetchAndAddRelaxed(1);
+  }
+
+  this->psdMutex.lock();
+  for (i = 0; i < this->allocation; ++i)
+    this->psd[i] += acc[i];
+  this->psdMutex.unlock();
+
+  SU_FFTW(_free)(segment);
+}
+
+void
+CarrierDetector::computePeak(const SUFLOAT *psd)
+{
+  int i;
+  int maxNdx = 0;
+  int bins = static_cast<int>(this->allocation * this->avgRelBw) + 1;
+  int delta = (bins - 1) / 2;
+  int start;
+  int skipLen = static_cast<int>(.5 * this->dcNotchRelBw * this->allocation);
+  SUFLOAT maxVal = 0;
+  SUCOMPLEX acc = 0;
+
+  // Find maximum
+  for (i = skipLen; i < static_cast<int>(this->allocation) - skipLen; ++i) {
+    if (psd[i] > maxVal) {
+      maxVal = psd[i];
+      maxNdx = i;
+    }
+  }
+
+  // Compute centroid.
+  start = maxNdx - delta;
+
+  for (i = 0; i < bins; ++i) {
+    int j = i + start;
+    if (j < 0)
+      j += this->allocation;
+
+    j %= this->allocation;
+
+    SUFLOAT nFreq = 2.f * j / static_cast<SUFLOAT>(this->allocation);
+
+    acc += psd[j] * SU_C_EXP(I * SU_ASFLOAT(M_PI) * nFreq);
+  }
+
+  // Finish
+  this->peak = SU_C_ARG(acc);
+
+  if (this->peak > M_PI)
+    this->peak -= 2 * M_PI;
+}
+
 bool
 CarrierDetector::work(void)
 {
   // Initializing state
   switch (this->state) {
     case ESTIMATING:
-      while (this->allocation < this->len)
-        this->allocation <<= 1;
+      if (this->segmentSize > 0)
+        this->allocation = this->segmentSize;
+      else
+        while (this->allocation < this->len)
+          this->allocation <<= 1;
 
       if ((this->buffer = static_cast<SU_FFTW(_complex) *>(
              SU_FFTW(_malloc)(this->allocation * sizeof(SUCOMPLEX)))) == nullptr) {
@@ -64,17 +190,25 @@ CarrierDetector::work(void)
         return false;
       }
 
-      if ((this->plan = SU_FFTW(_plan_dft_1d)(
-             this->allocation,
-             this->buffer,
-             this->buffer,
+      if ((this->plan = FFTPlanCache::instance()->get(
+             static_cast<int>(this->allocation),
              FFTW_FORWARD,
-             FFTW_ESTIMATE)) == nullptr) {
+             this->buffer,
+             this->buffer)) == nullptr) {
         emit error("Failed to initialize FFT plan.");
         return false;
       }
 
-      this->transitionTo(COPYING);
+      if (this->segmentSize > 0) {
+        // The buffer was only needed to get an aligned, in-place plan
+        SU_FFTW(_free)(this->buffer);
+        this->buffer = nullptr;
+
+        this->startSegments();
+        this->transitionTo(AVERAGING);
+      } else {
+        this->transitionTo(COPYING);
+      }
       break;
 
     case COPYING:
@@ -91,53 +225,41 @@ CarrierDetector::work(void)
       break;
 
     case EXECUTING:
-      SU_FFTW(_execute)(this->plan);
+      FFTPlanCache::execute(this->plan, this->buffer, this->buffer);
       this->transitionTo(COMPUTING);
       break;
 
-    case COMPUTING:
-      int i;
-      int maxNdx = 0;
-      int bins = static_cast<int>(this->allocation * this->avgRelBw) + 1;
-      int delta = (bins - 1) / 2;
-      int start;
-      int skipLen = static_cast<int>(.5 * this->dcNotchRelBw * this->allocation);
-      SUFLOAT maxVal = 0;
-      SUCOMPLEX *asSuComplex = reinterpret_cast<SUCOMPLEX *>(this->buffer);
-      SUFLOAT psd;
-      SUCOMPLEX acc = 0;
-
-      // Find maximum
-      for (i = skipLen; i < static_cast<int>(this->allocation) - skipLen; ++i) {
-        asSuComplex[i] *= SU_C_CONJ(asSuComplex[i]);
-        psd = SU_C_REAL(asSuComplex[i]);
-        if (psd > maxVal) {
-          maxVal = psd;
-          maxNdx = i;
-        }
-      }
-
-      // Compute centroid.
-      start = maxNdx - delta;
+    case AVERAGING: {
+      bool finished = this->slices.step(
+            SIGDIGGER_CARRIER_DETECTOR_POLL_INTERVAL_MS);
 
-      for (i = 0; i < bins; ++i) {
-        int j = i + start;
-        if (j < 0)
-          j += this->allocation;
+      this->setProgressCount(this->processed.loadAcquire(), this->segments);
 
-        j %= this->allocation;
-
-        psd = SU_C_REAL(asSuComplex[j]);
-        SUFLOAT nFreq = 2.f * j / static_cast<SUFLOAT>(this->allocation);
+      if (finished) {
+        if (this->failed.loadAcquire()) {
+          emit error("Failed to allocate segment buffers.");
+          return false;
+        }
 
-        acc += psd * SU_C_EXP(I * SU_ASFLOAT(M_PI) * nFreq);
+        this->transitionTo(COMPUTING);
       }
+      break;
+    }
 
-      // Finish
-      this->peak = SU_C_ARG(acc);
+    case COMPUTING:
+      if (this->segmentSize > 0) {
+        this->computePeak(this->psd.data());
+      } else {
+        SUCOMPLEX *asSuComplex = reinterpret_cast<SUCOMPLEX *>(this->buffer);
+        SUFLOAT *asPsd = reinterpret_cast<SUFLOAT *>(this->buffer);
+
+        // Squared magnitudes are packed in place, at the start of the
+        // buffer. Element i is written after complex element i is read.
+        for (size_t i = 0; i < this->allocation; ++i)
+          asPsd[i] = SU_C_REAL(asSuComplex[i] * SU_C_CONJ(asSuComplex[i]));
 
-      if (this->peak > M_PI)
-        this->peak -= 2 * M_PI;
+        this->computePeak(asPsd);
+      }
 
       emit done();
       return false;
@@ -149,5 +271,5 @@ CarrierDetector::work(void)
 void
 CarrierDetector::cancel(void)
 {
-  emit cancelled();
+  this->slices.cancelOwner();
 }
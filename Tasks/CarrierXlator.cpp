@@ -33,12 +33,11 @@ CarrierXlator::CarrierXlator(
   this->destination = destination;
   this->length      = length;
 
-  su_ncqo_init(&this->ncqo, -relFreq);
-  su_ncqo_set_phase(&this->ncqo, -phase);
+  this->nco.setFrequency(-relFreq);
+  this->nco.setPhase(-phase);
 
-  this->setProgress(0);
-
-  this->setStatus("Translating...");
+  this->setProgressCount(0, this->length);
+  this->setStatusFormat("Translating (%1/%2)...");
 }
 
 CarrierXlator::~CarrierXlator()
@@ -49,25 +48,18 @@ bool
 CarrierXlator::work(void)
 {
   size_t amount = this->length - this->p;
-  size_t p = this->p;
 
   if (amount > SIGDIGGER_CARRIER_XLATOR_BLOCK_LENGTH)
     amount = SIGDIGGER_CARRIER_XLATOR_BLOCK_LENGTH;
 
-  while (amount--) {
-    this->destination[p] = this->origin[p] * su_ncqo_read(&this->ncqo);
-    ++p;
-  }
-
-  this->p = p;
+  this->nco.mix(
+        this->destination + this->p,
+        this->origin + this->p,
+        amount);
 
-  this->setStatus("Translating ("
-                  + QString::number(p)
-                  + "/"
-                  + QString::number(this->length)
-                  + ")...");
+  this->p += amount;
 
-  this->setProgress(static_cast<qreal>(p) / static_cast<qreal>(this->length));
+  this->setProgressCount(this->p, this->length);
 
   if (this->p < this->length)
     return true;
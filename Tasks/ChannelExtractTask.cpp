@@ -0,0 +1,255 @@
+//
+//    ChannelExtractTask.cpp: Translate, decimate and resample in a single pass
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <ChannelExtractTask.h>
+#include <sigutils/taps.h>
+#include <sigutils/sampling.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace SigDigger;
+
+// Windowed sinc of unit DC gain, cutoff in cycles per sample
+static void
+makeLowPass(std::vector<SUFLOAT> &h, size_t size, qreal fc)
+{
+  std::vector<SUCOMPLEX> window(size, 1);
+  qreal center = static_cast<qreal>(size - 1) / 2;
+  qreal sum = 0;
+
+  su_taps_apply_blackmann_harris_complex(window.data(), size);
+
+  h.resize(size);
+
+  for (size_t i = 0; i < size; ++i) {
+    qreal x = static_cast<qreal>(i) - center;
+    qreal sinc = std::fabs(x) < 1e-9
+        ? 2 * fc
+        : std::sin(2 * M_PI * fc * x) / (M_PI * x);
+
+    h[i] = static_cast<SUFLOAT>(sinc * SU_C_REAL(window[i]));
+    sum += static_cast<qreal>(h[i]);
+  }
+
+  for (size_t i = 0; i < size; ++i)
+    h[i] = static_cast<SUFLOAT>(h[i] / sum);
+}
+
+ChannelExtractTask::ChannelExtractTask(
+    const SUCOMPLEX *data,
+    size_t length,
+    qreal fs,
+    qreal freq,
+    qreal bw,
+    qreal rate,
+    QObject *parent) : CancellableTask(parent)
+{
+  unsigned int phases = SIGDIGGER_CHANNEL_EXTRACT_RESAMPLER_PHASES;
+  unsigned int taps   = SIGDIGGER_CHANNEL_EXTRACT_RESAMPLER_TAPS;
+  std::vector<SUFLOAT> prototype;
+  qreal decimatedRate;
+  size_t decimTaps;
+
+  this->origin = data;
+  this->length = length;
+  this->rate   = std::min(rate, fs);
+  this->bw     = std::min(bw, this->rate);
+
+  this->nco.setFrequency(-SU_ABS2NORM_FREQ(fs, freq));
+
+  // Integer part of the rate change
+  this->decimation = static_cast<unsigned int>(
+        std::max<qreal>(
+          1,
+          std::floor(
+            fs / std::max(
+              this->rate,
+              this->bw * SIGDIGGER_CHANNEL_EXTRACT_DECIM_MARGIN))));
+  decimatedRate = fs / this->decimation;
+
+  decimTaps = SIGDIGGER_CHANNEL_EXTRACT_DECIM_TAPS * this->decimation + 1;
+  makeLowPass(this->decimTaps, decimTaps, .5 * this->bw / fs);
+
+  this->decimLine.assign(decimTaps - 1, 0);
+  this->decimBase = -static_cast<qint64>(decimTaps - 1);
+  this->decimNext = static_cast<qint64>(decimTaps - 1) / 2;
+
+  // Fractional part. The prototype runs at phases times the decimated rate.
+  makeLowPass(
+        prototype,
+        phases * taps,
+        .5 * this->rate / (decimatedRate * phases));
+
+  this->resamplerBank.resize(phases * taps);
+  for (unsigned int ph = 0; ph < phases; ++ph)
+    for (unsigned int k = 0; k < taps; ++k)
+      this->resamplerBank[ph * taps + k] =
+          phases * prototype[(taps - 1 - k) * phases + ph];
+
+  this->resampleStep = decimatedRate / this->rate;
+  this->resampleLine.assign(taps - 1, 0);
+  this->resampleBase = -static_cast<qint64>(taps - 1);
+  this->resampleNext = static_cast<qreal>(phases * taps - 1) / (2 * phases);
+
+  this->expected = static_cast<size_t>(
+        std::ceil(static_cast<qreal>(length) * this->rate / fs));
+  this->buffer = std::make_shared<std::vector<SUCOMPLEX>>();
+  this->buffer->reserve(this->expected);
+
+  this->setProgressCount(0, this->length);
+  this->setStatusFormat("Extracting channel (%1/%2)...");
+}
+
+ChannelExtractTask::~ChannelExtractTask()
+{
+}
+
+std::shared_ptr<std::vector<SUCOMPLEX>>
+ChannelExtractTask::takeBuffer(void)
+{
+  return std::move(this->buffer);
+}
+
+void
+ChannelExtractTask::decimate(void)
+{
+  size_t size = this->decimTaps.size();
+  qint64 end = this->decimBase + static_cast<qint64>(this->decimLine.size());
+  qint64 drop;
+
+  // Only the outputs that survive the decimation are computed
+  while (this->decimNext < end) {
+    const SUCOMPLEX *x = this->decimLine.data()
+        + (this->decimNext - this->decimBase)
+        - static_cast<qint64>(size - 1);
+    SUCOMPLEX y = 0;
+
+    for (size_t k = 0; k < size; ++k)
+      y += x[k] * this->decimTaps[k];
+
+    this->resampleLine.push_back(y);
+    this->decimNext += this->decimation;
+  }
+
+  drop = this->decimNext - static_cast<qint64>(size - 1) - this->decimBase;
+  drop = std::min<qint64>(drop, static_cast<qint64>(this->decimLine.size()));
+
+  if (drop > 0) {
+    this->decimLine.erase(
+          this->decimLine.begin(),
+          this->decimLine.begin() + drop);
+    this->decimBase += drop;
+  }
+}
+
+void
+ChannelExtractTask::resample(void)
+{
+  unsigned int phases = SIGDIGGER_CHANNEL_EXTRACT_RESAMPLER_PHASES;
+  unsigned int taps   = SIGDIGGER_CHANNEL_EXTRACT_RESAMPLER_TAPS;
+  qint64 end = this->resampleBase
+      + static_cast<qint64>(this->resampleLine.size());
+  qint64 drop;
+
+  for (;;) {
+    qint64 i = static_cast<qint64>(std::floor(this->resampleNext));
+    unsigned int ph = static_cast<unsigned int>(
+          std::lround((this->resampleNext - i) * phases));
+    const SUCOMPLEX *x;
+    const SUFLOAT *g;
+    SUCOMPLEX y = 0;
+
+    if (ph == phases) {
+      ++i;
+      ph = 0;
+    }
+
+    if (i >= end)
+      break;
+
+    x = this->resampleLine.data()
+        + (i - this->resampleBase)
+        - static_cast<qint64>(taps - 1);
+    g = this->resamplerBank.data() + ph * taps;
+
+    for (unsigned int k = 0; k < taps; ++k)
+      y += x[k] * g[k];
+
+    if (this->buffer->size() < this->expected)
+      this->buffer->push_back(y);
+
+    this->resampleNext += this->resampleStep;
+  }
+
+  drop = static_cast<qint64>(std::floor(this->resampleNext))
+      - static_cast<qint64>(taps - 1)
+      - this->resampleBase;
+  drop = std::min<qint64>(drop, static_cast<qint64>(this->resampleLine.size()));
+
+  if (drop > 0) {
+    this->resampleLine.erase(
+          this->resampleLine.begin(),
+          this->resampleLine.begin() + drop);
+    this->resampleBase += drop;
+  }
+}
+
+void
+ChannelExtractTask::feed(const SUCOMPLEX *data, size_t size)
+{
+  size_t base = this->decimLine.size();
+
+  this->decimLine.resize(base + size);
+  this->nco.mix(this->decimLine.data() + base, data, size);
+
+  this->decimate();
+  this->resample();
+}
+
+bool
+ChannelExtractTask::work(void)
+{
+  size_t amount = this->length - this->p;
+
+  if (amount > SIGDIGGER_CHANNEL_EXTRACT_BLOCK_LENGTH)
+    amount = SIGDIGGER_CHANNEL_EXTRACT_BLOCK_LENGTH;
+
+  this->feed(this->origin + this->p, amount);
+  this->p += amount;
+
+  this->setProgressCount(this->p, this->length);
+
+  if (this->p < this->length)
+    return true;
+
+  // Push the last samples out of both filters, which are centered
+  std::vector<SUCOMPLEX> zeros(
+        this->decimTaps.size() / 2
+        + (SIGDIGGER_CHANNEL_EXTRACT_RESAMPLER_TAPS / 2 + 2) * this->decimation,
+        0);
+  this->feed(zeros.data(), zeros.size());
+
+  emit done();
+  return false;
+}
+
+void
+ChannelExtractTask::cancel(void)
+{
+  emit cancelled();
+}
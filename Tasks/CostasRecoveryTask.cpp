@@ -42,8 +42,8 @@ CostasRecoveryTask::CostasRecoveryTask(
 
   this->costasInitialized = true;
 
-  this->setProgress(0);
-  this->setStatus("Processing...");
+  this->setProgressCount(0, this->length);
+  this->setStatusFormat("Processing (%1/%2)...");
 }
 
 bool
@@ -62,13 +62,7 @@ CostasRecoveryTask::work(void)
 
   this->p = p;
 
-  this->setStatus("Processing ("
-                  + QString::number(p)
-                  + "/"
-                  + QString::number(this->length)
-                  + ")...");
-
-  this->setProgress(static_cast<qreal>(p) / static_cast<qreal>(this->length));
+  this->setProgressCount(p, this->length);
 
   if (this->p < this->length)
     return true;
@@ -0,0 +1,438 @@
+//
+//    CyclicSpectrumTask.cpp: Spectral correlation by FFT accumulation
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "CyclicSpectrumTask.h"
+#include "FFTPlanCache.h"
+#include <sigutils/taps.h>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+#include <new>
+
+using namespace SigDigger;
+
+/////////////////////////////// CyclicSpectrumResult ///////////////////////////
+CyclicSpectrumResult::CyclicSpectrumResult(
+    unsigned int channels,
+    unsigned int frames,
+    qint64 start,
+    size_t length)
+{
+  size_t span;
+
+  this->channels = channels;
+  this->frames   = frames;
+  this->start    = start;
+  this->length   = length;
+  this->hop      = std::max<size_t>(1, channels / SIGDIGGER_CYCLIC_HOP_DIVISOR);
+
+  span = (frames - 1) * this->hop + channels;
+  this->blockStride = frames * this->hop;
+
+  if (length >= span) {
+    size_t maxBlocks = std::max<size_t>(
+          1,
+          std::min<size_t>(
+            SIGDIGGER_CYCLIC_MAX_BLOCKS,
+            SIGDIGGER_CYCLIC_MEMORY_MAX
+            / (static_cast<size_t>(frames) * channels * sizeof(SUCOMPLEX))));
+
+    this->blocks = 1 + (length - span) / this->blockStride;
+
+    // Average blocks spread over the whole range rather than stopping short
+    if (this->blocks > maxBlocks) {
+      this->blocks = maxBlocks;
+      this->blockStride = maxBlocks > 1 ? (length - span) / (maxBlocks - 1) : 0;
+    }
+  }
+
+  this->alphaBins = static_cast<unsigned int>(
+        std::min<size_t>(
+          frames * this->hop,
+          SIGDIGGER_CYCLIC_MAX_ALPHA_BINS));
+
+  this->surface.assign(
+        static_cast<size_t>(this->alphaBins) * channels,
+        0);
+}
+
+/////////////////////////////// CyclicSpectrumTask /////////////////////////////
+CyclicSpectrumTask::CyclicSpectrumTask(
+    std::shared_ptr<const std::vector<SUCOMPLEX>> const &buffer,
+    std::shared_ptr<CyclicSpectrumResult> const &result,
+    QObject *parent) : CancellableTask(parent), slices(this)
+{
+  this->buffer = buffer;
+  this->result = result;
+
+  this->setStatus("Preparing cyclic spectrum...");
+}
+
+CyclicSpectrumTask::~CyclicSpectrumTask()
+{
+  this->slices.stop();
+}
+
+bool
+CyclicSpectrumTask::prepare(void)
+{
+  const CyclicSpectrumResult *result = this->result.get();
+  unsigned int channels = result->channels;
+  unsigned int frames = result->frames;
+  std::vector<SUCOMPLEX> ones(std::max(channels, frames), 1);
+  SU_FFTW(_complex) *scratch;
+
+  // Channel filter, and the data taper along each channel
+  su_taps_apply_blackmann_harris_complex(ones.data(), channels);
+  this->channelWindow.resize(channels);
+  for (unsigned int i = 0; i < channels; ++i)
+    this->channelWindow[i] = SU_C_REAL(ones[i]);
+
+  std::fill(ones.begin(), ones.end(), 1);
+  su_taps_apply_blackmann_harris_complex(ones.data(), frames);
+  this->frameWindow.resize(frames);
+  for (unsigned int i = 0; i < frames; ++i)
+    this->frameWindow[i] = SU_C_REAL(ones[i]);
+
+  // Frame starts are multiples of the hop, so the phase that brings each
+  // channel down to baseband only takes `channels` different values
+  this->twiddle.resize(channels);
+  for (unsigned int i = 0; i < channels; ++i) {
+    SUFLOAT phase = static_cast<SUFLOAT>(-2 * M_PI * i / channels);
+    this->twiddle[i] = SUCOMPLEX(std::cos(phase), std::sin(phase));
+  }
+
+  try {
+    this->channelized.resize(result->blocks * channels * frames);
+  } catch (std::bad_alloc &) {
+    return false;
+  }
+
+  if ((scratch = static_cast<SU_FFTW(_complex) *>(
+         SU_FFTW(_malloc)(
+           std::max(channels, frames) * sizeof(SUCOMPLEX)))) == nullptr)
+    return false;
+
+  this->channelPlan = FFTPlanCache::instance()->get(
+        static_cast<int>(channels),
+        FFTW_FORWARD,
+        scratch,
+        scratch);
+
+  this->framePlan = FFTPlanCache::instance()->get(
+        static_cast<int>(frames),
+        FFTW_FORWARD,
+        scratch,
+        scratch);
+
+  SU_FFTW(_free)(scratch);
+
+  return this->channelPlan != nullptr && this->framePlan != nullptr;
+}
+
+void
+CyclicSpectrumTask::runChannelizer(int block)
+{
+  const CyclicSpectrumResult *result = this->result.get();
+  unsigned int channels = result->channels;
+  unsigned int frames = result->frames;
+  unsigned int half = channels / 2;
+  SU_FFTW(_complex) *frame;
+  SUCOMPLEX *asSuComplex;
+  const SUCOMPLEX *data = this->buffer->data()
+      + result->start
+      + static_cast<size_t>(block) * result->blockStride;
+  SUCOMPLEX *out = this->channelized.data()
+      + static_cast<size_t>(block) * channels * frames;
+
+  if ((frame = static_cast<SU_FFTW(_complex) *>(
+         SU_FFTW(_malloc)(channels * sizeof(SUCOMPLEX)))) == nullptr) {
+    this->failed.storeRelease(1);
+    return;
+  }
+
+  asSuComplex = reinterpret_cast<SUCOMPLEX *>(frame);
+
+  for (unsigned int n = 0; n < frames; ++n) {
+    const SUCOMPLEX *src = data + n * result->hop;
+
+    for (unsigned int i = 0; i < channels; ++i)
+      asSuComplex[i] = src[i] * this->channelWindow[i];
+
+    FFTPlanCache::execute(this->channelPlan, frame, frame);
+
+    // Channel k is centered at (k - half) / channels. Stored by channel,
+    // so that the correlator reads each one as a contiguous sequence.
+    for (unsigned int k = 0; k < channels; ++k) {
+      qint64 c = static_cast<qint64>(k) - half;
+      qint64 m = (c * n * static_cast<qint64>(result->hop)) % channels;
+
+      if (m < 0)
+        m += channels;
+
+      out[k * frames + n] =
+          asSuComplex[(k + half) % channels]
+          * this->twiddle[static_cast<size_t>(m)];
+    }
+  }
+
+  this->processed.fetchAndAddRelaxed(1);
+
+  SU_FFTW(_free)(frame);
+}
+
+void
+CyclicSpectrumTask::runCorrelator(int batch)
+{
+  CyclicSpectrumResult *result = this->result.get();
+  unsigned int channels = result->channels;
+  unsigned int frames = result->frames;
+  unsigned int alphaBins = result->alphaBins;
+  size_t cyclicLength = frames * result->hop;
+
+  // The product of two channels is only valid within one channel
+  // bandwidth of their difference frequency
+  int qMax = static_cast<int>(cyclicLength / (2 * channels));
+  std::vector<float> acc(static_cast<size_t>(2 * qMax + 1));
+  std::vector<float> grid;
+  SU_FFTW(_complex) *product;
+  SUCOMPLEX *asSuComplex;
+  float norm = 1.f / (
+        static_cast<float>(result->blocks)
+        * channels * channels * frames * frames);
+  unsigned int row;
+
+  try {
+    grid.assign(result->surface.size(), 0);
+  } catch (std::bad_alloc &) {
+    this->failed.storeRelease(1);
+    return;
+  }
+
+  if ((product = static_cast<SU_FFTW(_complex) *>(
+         SU_FFTW(_malloc)(frames * sizeof(SUCOMPLEX)))) == nullptr) {
+    this->failed.storeRelease(1);
+    return;
+  }
+
+  asSuComplex = reinterpret_cast<SUCOMPLEX *>(product);
+
+  // Row k1 correlates k1 + 1 pairs. Batches take every batches-th row,
+  // longest first, so they all get about the same work.
+  for (row = static_cast<unsigned int>(batch);
+       row < channels && !this->slices.isCancelled();
+       row += this->batches) {
+    unsigned int k1 = channels - 1 - row;
+
+    for (unsigned int k2 = 0; k2 <= k1; ++k2) {
+      unsigned int d = k1 - k2;
+      unsigned int fi = (k1 + k2) / 2;
+
+      std::fill(acc.begin(), acc.end(), 0.f);
+
+      for (size_t b = 0; b < result->blocks; ++b) {
+        const SUCOMPLEX *x1 =
+            this->channelized.data() + (b * channels + k1) * frames;
+        const SUCOMPLEX *x2 =
+            this->channelized.data() + (b * channels + k2) * frames;
+
+        for (unsigned int n = 0; n < frames; ++n)
+          asSuComplex[n] = x1[n] * SU_C_CONJ(x2[n]) * this->frameWindow[n];
+
+        FFTPlanCache::execute(this->framePlan, product, product);
+
+        for (int q = -qMax; q <= qMax; ++q) {
+          SUCOMPLEX y = asSuComplex[
+              static_cast<unsigned int>(q + static_cast<int>(frames)) % frames];
+          acc[static_cast<size_t>(q + qMax)] += SU_C_REAL(y * SU_C_CONJ(y));
+        }
+      }
+
+      for (int q = -qMax; q <= qMax; ++q) {
+        qreal alpha = static_cast<qreal>(d) / channels
+            + static_cast<qreal>(q) / cyclicLength;
+        long ai = std::lround(alpha * alphaBins);
+        float value = acc[static_cast<size_t>(q + qMax)] * norm;
+        float *cell;
+
+        if (ai < 0 || ai >= static_cast<long>(alphaBins))
+          continue;
+
+        cell = &grid[static_cast<size_t>(ai) * channels + fi];
+        if (value > *cell)
+          *cell = value;
+      }
+
+      if (this->slices.isCancelled())
+        break;
+    }
+
+    this->processed.fetchAndAddRelaxed(k1 + 1);
+  }
+
+  SU_FFTW(_free)(product);
+
+  // Cells may be hit by several pairs: keep the strongest
+  {
+    QMutexLocker locker(&this->surfaceMutex);
+
+    for (size_t i = 0; i < grid.size(); ++i)
+      if (grid[i] > result->surface[i])
+        result->surface[i] = grid[i];
+  }
+}
+
+void
+CyclicSpectrumTask::finish(void)
+{
+  CyclicSpectrumResult *result = this->result.get();
+  unsigned int channels = result->channels;
+  unsigned int first = result->firstFeatureRow();
+  std::vector<CyclicFeature> candidates;
+  bool havePeak = false;
+  bool haveFeaturePeak = false;
+
+  result->profile.resize(result->alphaBins);
+
+  for (unsigned int a = 0; a < result->alphaBins; ++a) {
+    float *line = result->surface.data() + static_cast<size_t>(a) * channels;
+    float rowMax;
+
+    for (unsigned int f = 0; f < channels; ++f)
+      line[f] = SU_POWER_DB_RAW(line[f] + 1e-20f);
+
+    rowMax = *std::max_element(line, line + channels);
+    result->profile[a] = rowMax;
+
+    if (!havePeak || rowMax > result->peak) {
+      result->peak = rowMax;
+      havePeak = true;
+    }
+
+    if (a >= first && (!haveFeaturePeak || rowMax > result->featurePeak)) {
+      result->featurePeak = rowMax;
+      haveFeaturePeak = true;
+    }
+  }
+
+  if (!haveFeaturePeak)
+    result->featurePeak = result->peak;
+
+  // Local maxima of the cyclic profile, strongest first
+  for (unsigned int a = std::max(first, 1u); a + 1 < result->alphaBins; ++a) {
+    const std::vector<float> &p = result->profile;
+
+    if (p[a] >= p[a - 1] && p[a] > p[a + 1]) {
+      CyclicFeature feature;
+      feature.alpha = static_cast<qreal>(a) / result->alphaBins;
+      feature.level = p[a];
+      candidates.push_back(feature);
+    }
+  }
+
+  std::sort(
+        candidates.begin(),
+        candidates.end(),
+        [] (CyclicFeature const &a, CyclicFeature const &b) {
+          return a.level > b.level;
+        });
+
+  if (candidates.size() > SIGDIGGER_CYCLIC_MAX_FEATURES)
+    candidates.resize(SIGDIGGER_CYCLIC_MAX_FEATURES);
+
+  result->features = std::move(candidates);
+}
+
+void
+CyclicSpectrumTask::launch(Stage stage, int units)
+{
+  this->stage = stage;
+  this->processed.storeRelease(0);
+
+  this->slices.start(units, [this, stage] (int unit) {
+    if (stage == CHANNELIZING)
+      this->runChannelizer(unit);
+    else
+      this->runCorrelator(unit);
+  });
+}
+
+bool
+CyclicSpectrumTask::work(void)
+{
+  quint64 channels = this->result->channels;
+  quint64 pairs = channels * (channels + 1) / 2;
+  Suscan::TaskPool *pool = Suscan::TaskPool::shared();
+  unsigned int threads = pool != nullptr
+      ? static_cast<unsigned int>(pool->threadCount())
+      : 1;
+  bool finished;
+
+  if (this->stage == PREPARING) {
+    if (this->result->blocks == 0) {
+      emit error("Selection is too short for the requested resolution.");
+      return false;
+    }
+
+    if (!this->prepare()) {
+      emit error("Failed to allocate channelizer buffers or FFT plans.");
+      return false;
+    }
+
+    this->setStatusFormat("Channelizing (%1/%2 blocks)...");
+    this->setProgressCount(0, this->result->blocks);
+    this->launch(CHANNELIZING, static_cast<int>(this->result->blocks));
+    return true;
+  }
+
+  finished = this->slices.step(SIGDIGGER_CYCLIC_POLL_INTERVAL_MS);
+
+  this->setProgressCount(
+        this->processed.loadAcquire(),
+        this->stage == CHANNELIZING ? this->result->blocks : pairs);
+
+  if (!finished)
+    return true;
+
+  if (this->failed.loadAcquire()) {
+    emit error("Failed to allocate work buffers.");
+    return false;
+  }
+
+  if (this->stage == CHANNELIZING) {
+    this->setStatusFormat("Correlating channel pairs (%1/%2)...");
+    this->setProgressCount(0, pairs);
+    this->batches = std::min(
+          static_cast<unsigned int>(channels),
+          threads * SIGDIGGER_CYCLIC_BATCHES_PER_CPU);
+    this->launch(CORRELATING, static_cast<int>(this->batches));
+    return true;
+  }
+
+  this->channelized = std::vector<SUCOMPLEX>();
+  this->finish();
+
+  emit done();
+  return false;
+}
+
+void
+CyclicSpectrumTask::cancel(void)
+{
+  this->slices.cancelOwner();
+}
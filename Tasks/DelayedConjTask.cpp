@@ -18,8 +18,10 @@
 //
 #include <DelayedConjTask.h>
 #include <Suscan/Library.h>
+#include <SampleKernels.h>
+#include <algorithm>
 
-#define SIGDIGGER_DELAYEDCONJ_BLOCK_LENGTH 4096
+#define SIGDIGGER_DELAYEDCONJ_EPSILON 1e-3
 
 DelayedConjTask::DelayedConjTask(
     const SUCOMPLEX *data,
@@ -27,20 +29,14 @@ DelayedConjTask::DelayedConjTask(
     size_t length,
     SUSCOUNT delay,
     QObject *parent) :
-  Suscan::CancellableTask(parent)
+  Suscan::ChunkedTask(data, length, delay, parent)
 {
   this->origin = data;
   this->destination = destination;
-  this->length = length;
   this->delay = delay;
 
   if (delay == 0)
     throw Suscan::Exception("Delay is zero samples\n");
-
-  this->delayLine.resize(delay);
-
-  this->setProgress(0);
-  this->setStatus("Processing...");
 }
 
 static inline bool
@@ -55,56 +51,40 @@ isnan(SUCOMPLEX val)
   return isnan(SU_C_REAL(val)) || isnan(SU_C_IMAG(val));
 }
 
-bool
-DelayedConjTask::work(void)
-{
-  size_t amount = this->length - this->p;
-  size_t p = this->p;
-  SUCOMPLEX x, prev;
-  SUSCOUNT delay = this->delay;
-  SUFLOAT kinv;
-
-  if (amount > SIGDIGGER_DELAYEDCONJ_BLOCK_LENGTH)
-    amount = SIGDIGGER_DELAYEDCONJ_BLOCK_LENGTH;
-
-  while (amount--) {
-    x = this->origin[p];
-    if (p < delay) {
-      this->destination[p] = 0;
-    } else {
-      prev = this->delayLine[q];
-      kinv = 1. / (SU_C_ABS(prev) + 1e-3);
-      this->destination[p] = kinv * x * SU_C_CONJ(prev);
-    }
-
-    this->delayLine[q++] = x;
-    if (q == delay)
-      q = 0;
-    ++p;
-  }
-
-  this->p = p;
-  this->setStatus("Processing ("
-                  + QString::number(p)
-                  + "/"
-                  + QString::number(this->length)
-                  + ")...");
-
-  this->setProgress(static_cast<qreal>(p) / static_cast<qreal>(this->length));
-
-  if (this->p < this->length)
-    return true;
-
-  emit done();
-  return false;
-}
-
 void
-DelayedConjTask::cancel(void)
+DelayedConjTask::processChunk(
+    size_t start,
+    size_t end,
+    const SUCOMPLEX *history)
 {
-  emit cancelled();
+  size_t head = std::min<size_t>(this->delay, end - start);
+
+  // Samples whose delayed counterpart lies inside the chunk go first: the
+  // kernel reads origin[start...] before the head below overwrites it.
+  if (end - start > head)
+    SigDigger::SampleKernels::delayedConj(
+          this->destination + start + head,
+          this->origin + start + head,
+          this->origin + start,
+          end - start - head,
+          SIGDIGGER_DELAYEDCONJ_EPSILON);
+
+  if (start < this->delay) {
+    std::fill(
+          this->destination + start,
+          this->destination + start + head,
+          0);
+  } else {
+    SigDigger::SampleKernels::delayedConj(
+          this->destination + start,
+          this->origin + start,
+          history,
+          head,
+          SIGDIGGER_DELAYEDCONJ_EPSILON);
+  }
 }
 
 DelayedConjTask::~DelayedConjTask()
 {
+  this->stop();
 }
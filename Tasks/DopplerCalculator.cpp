@@ -17,8 +17,11 @@
 //    <http://www.gnu.org/licenses/>
 //
 #include "DopplerCalculator.h"
+#include "FFTPlanCache.h"
 #include <sigutils/taps.h>
 #include <sigutils/sampling.h>
+#include <algorithm>
+#include <new>
 
 #define SPEED_OF_LIGHT 299792458.
 
@@ -42,26 +45,28 @@ DopplerCalculator::DopplerCalculator(
 
 DopplerCalculator::~DopplerCalculator()
 {
-  if (this->plan != nullptr)
-    SU_FFTW(_destroy_plan)(this->plan);
-
-  if (this->buffer != nullptr)
-    SU_FFTW(_free)(this->buffer);
 }
 
+//
+// The FFT runs in place in the spectrum vector that is handed over to the
+// Doppler dialog, and the centroid and dispersion are computed on the fly
+// from it. The whole estimation needs a single buffer of the FFT size.
+//
 bool
 DopplerCalculator::work(void)
 {
+  SU_FFTW(_complex) *buffer =
+      reinterpret_cast<SU_FFTW(_complex) *>(this->psd.data());
+
   // Initializing state
   switch (this->state) {
     case ESTIMATING:
       while (this->allocation < this->len)
         this->allocation <<= 1;
 
-      this->psd.resize(this->allocation);
-
-      if ((this->buffer = static_cast<SU_FFTW(_complex) *>(
-             SU_FFTW(_malloc)(this->allocation * sizeof(SUCOMPLEX)))) == nullptr) {
+      try {
+        this->psd.resize(this->allocation);
+      } catch (std::bad_alloc &) {
         emit error(
               "Failed to allocate "
               + QString::number(this->allocation)
@@ -69,12 +74,13 @@ DopplerCalculator::work(void)
         return false;
       }
 
-      if ((this->plan = SU_FFTW(_plan_dft_1d)(
-             this->allocation,
-             this->buffer,
-             this->buffer,
+      buffer = reinterpret_cast<SU_FFTW(_complex) *>(this->psd.data());
+
+      if ((this->plan = FFTPlanCache::instance()->get(
+             static_cast<int>(this->allocation),
              FFTW_FORWARD,
-             FFTW_ESTIMATE)) == nullptr) {
+             buffer,
+             buffer)) == nullptr) {
         emit error("Failed to initialize FFT plan.");
         return false;
       }
@@ -83,20 +89,20 @@ DopplerCalculator::work(void)
       break;
 
     case COPYING:
-      memcpy(this->buffer, this->data, this->len * sizeof(SUCOMPLEX));
+      memcpy(buffer, this->data, this->len * sizeof(SUCOMPLEX));
       memset(
-            this->buffer + this->len,
+            buffer + this->len,
             0,
             (this->allocation - this->len) * sizeof(SUCOMPLEX));
 
       su_taps_apply_blackmann_harris_complex(
-            reinterpret_cast<SUCOMPLEX *>(this->buffer),
+            this->psd.data(),
             static_cast<SUSCOUNT>(this->len));
       this->transitionTo(EXECUTING);
       break;
 
     case EXECUTING:
-      SU_FFTW(_execute)(this->plan);
+      FFTPlanCache::execute(this->plan, buffer, buffer);
       this->transitionTo(COMPUTE);
       break;
 
@@ -107,7 +113,7 @@ DopplerCalculator::work(void)
       int delta = bins / 2;
       int start;
       SUFLOAT maxVal = 0;
-      SUCOMPLEX *asSuComplex = reinterpret_cast<SUCOMPLEX *>(this->buffer);
+      SUCOMPLEX *asSuComplex = this->psd.data();
       SUFLOAT psd;
       SUCOMPLEX acc = 0;
       SUFLOAT peak;
@@ -116,16 +122,18 @@ DopplerCalculator::work(void)
       SUFLOAT totalEnergy = 0;
       SUFLOAT err = 0, t, y;
 
-      // Find maximum
+      // Find maximum, total energy and centroid. The centroid window spans
+      // all the bins, so it does not depend on where the maximum is.
       for (i = 0; i < bins; ++i) {
-        asSuComplex[i] *= SU_C_CONJ(asSuComplex[i]);
-        psd = SU_C_REAL(asSuComplex[i]);
+        psd = SU_C_REAL(asSuComplex[i] * SU_C_CONJ(asSuComplex[i]));
+        asSuComplex[i] = psd;
         if (psd > maxVal) {
           maxVal = psd;
           maxNdx = i;
         }
 
-        this->psd[(static_cast<size_t>(bins - i) + delta) % bins] = psd;
+        acc += psd * SU_C_EXP(
+              I * SU_ASFLOAT(M_PI) * (2.f * i / static_cast<SUFLOAT>(bins)));
 
         // Accumulate with Kahan
         y = psd - err;
@@ -136,7 +144,7 @@ DopplerCalculator::work(void)
 
       this->max = maxVal;
 
-      // Compute centroid and dispersion.
+      // Compute dispersion.
       start = maxNdx - delta;
 
       for (i = 0; i < bins; ++i) {
@@ -147,9 +155,6 @@ DopplerCalculator::work(void)
         j %= this->allocation;
 
         psd = SU_C_REAL(asSuComplex[j]);
-        SUFLOAT nFreq = 2.f * j / static_cast<SUFLOAT>(this->allocation);
-
-        acc += psd * SU_C_EXP(I * SU_ASFLOAT(M_PI) * nFreq);
 
         // Correct j to make it centered around 0
         j = i;
@@ -161,6 +166,14 @@ DopplerCalculator::work(void)
         dispAcc += (j * j * psd / totalEnergy) / (delta * delta);
       }
 
+      // Lay out the spectrum as the dialog expects it: bin i goes to
+      // (bins - i + delta) % bins, which is a reversal and a rotation.
+      std::reverse(this->psd.begin(), this->psd.end());
+      std::rotate(
+            this->psd.begin(),
+            this->psd.begin() + (bins - delta - 1),
+            this->psd.end());
+
       // Finish
       peak = SU_C_ARG(acc);
       if (peak > PI)
@@ -18,16 +18,249 @@
 //
 #include <ExportSamplesTask.h>
 #include <QCoreApplication>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <ThreadPolicy.h>
+#include <SampleStore.h>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace SigDigger;
 
 #define SIGDIGGER_EXPORT_SAMPLES_BREATHE_INTERVAL_MS 100
 #define SIGDIGGER_EXPORT_SAMPLES_BREATHE_BLOCK_SIZE  0x10000
 
+// Each of the two pipeline buffers. Must be a multiple of the alignment.
+#define SIGDIGGER_EXPORT_SAMPLES_PIPELINE_BUFFER_SIZE (4 << 20)
+#define SIGDIGGER_EXPORT_SAMPLES_DIRECT_IO_ALIGN      4096
+
+// Below this size, the page cache is cheaper than bypassing it
+#define SIGDIGGER_EXPORT_SAMPLES_DIRECT_IO_MIN        (64ull << 20)
+#define SIGDIGGER_EXPORT_SAMPLES_ZSTD_LEVEL           3
+
+#ifndef O_BINARY
+#  define O_BINARY 0
+#endif // O_BINARY
+
+namespace SigDigger {
+  //
+  // Double-buffered file writer. The producer fills the current buffer
+  // (through put() or buffer() / produced()) and hands it over when full;
+  // run() writes it while the producer goes on with the other one.
+  //
+  class ExportWriter : public QThread
+  {
+    int fd;
+    bool direct;
+
+    std::vector<uint8_t> storage[2];
+    uint8_t *buffers[2];
+    size_t fill[2] = {0, 0};
+    bool full[2] = {false, false};
+    int current = 0;
+
+    QMutex mutex;
+    QWaitCondition cond;
+    bool finishing = false;
+    bool failed = false;
+    QString error;
+
+    bool writeAll(const uint8_t *data, size_t size);
+    void submit(void);
+
+  public:
+    ExportWriter(int fd, bool direct);
+
+    void put(const void *data, size_t size);
+    uint8_t *buffer(size_t &avail);
+    void produced(size_t size);
+    bool finish(void);
+    QString lastError(void) const;
+
+    void run(void) override;
+  };
+}
+
+ExportWriter::ExportWriter(int fd, bool direct)
+{
+  this->fd     = fd;
+  this->direct = direct;
+
+  for (int i = 0; i < 2; ++i) {
+    uintptr_t addr;
+
+    this->storage[i].resize(
+          SIGDIGGER_EXPORT_SAMPLES_PIPELINE_BUFFER_SIZE
+          + SIGDIGGER_EXPORT_SAMPLES_DIRECT_IO_ALIGN);
+    addr = reinterpret_cast<uintptr_t>(this->storage[i].data());
+    addr = (addr + SIGDIGGER_EXPORT_SAMPLES_DIRECT_IO_ALIGN - 1)
+        & ~static_cast<uintptr_t>(SIGDIGGER_EXPORT_SAMPLES_DIRECT_IO_ALIGN - 1);
+    this->buffers[i] = reinterpret_cast<uint8_t *>(addr);
+  }
+
+  this->start();
+}
+
+bool
+ExportWriter::writeAll(const uint8_t *data, size_t size)
+{
+  while (size > 0) {
+    ssize_t result;
+
+#ifdef O_DIRECT
+    // Direct I/O only accepts whole blocks. The last buffer may not be.
+    if (this->direct && size % SIGDIGGER_EXPORT_SAMPLES_DIRECT_IO_ALIGN != 0) {
+      fcntl(this->fd, F_SETFL, fcntl(this->fd, F_GETFL) & ~O_DIRECT);
+      this->direct = false;
+    }
+#endif // O_DIRECT
+
+    result = ::write(this->fd, data, size);
+
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+
+#ifdef O_DIRECT
+      // Some filesystems accept O_DIRECT on open() but not on write()
+      if (errno == EINVAL && this->direct) {
+        fcntl(this->fd, F_SETFL, fcntl(this->fd, F_GETFL) & ~O_DIRECT);
+        this->direct = false;
+        continue;
+      }
+#endif // O_DIRECT
+
+      this->error = "write() failed: " + QString(strerror(errno));
+      return false;
+    }
+
+    data += result;
+    size -= static_cast<size_t>(result);
+  }
+
+  return true;
+}
+
+void
+ExportWriter::run(void)
+{
+  int i = 0;
+  size_t size;
+  bool ok;
+
+  for (;;) {
+    this->mutex.lock();
+    while (!this->full[i] && !this->finishing)
+      this->cond.wait(&this->mutex);
+
+    if (!this->full[i]) {
+      this->mutex.unlock();
+      break;
+    }
+
+    size = this->fill[i];
+    ok = !this->failed;
+    this->mutex.unlock();
+
+    // After a failure, keep draining so that the producer never blocks
+    if (ok)
+      ok = this->writeAll(this->buffers[i], size);
+
+    this->mutex.lock();
+    if (!ok)
+      this->failed = true;
+    this->full[i] = false;
+    this->fill[i] = 0;
+    this->cond.wakeAll();
+    this->mutex.unlock();
+
+    i ^= 1;
+  }
+}
+
+void
+ExportWriter::submit(void)
+{
+  this->mutex.lock();
+  this->full[this->current] = true;
+  this->cond.wakeAll();
+
+  this->current ^= 1;
+  while (this->full[this->current])
+    this->cond.wait(&this->mutex);
+  this->mutex.unlock();
+}
+
+uint8_t *
+ExportWriter::buffer(size_t &avail)
+{
+  avail = SIGDIGGER_EXPORT_SAMPLES_PIPELINE_BUFFER_SIZE
+      - this->fill[this->current];
+
+  return this->buffers[this->current] + this->fill[this->current];
+}
+
+void
+ExportWriter::produced(size_t size)
+{
+  this->fill[this->current] += size;
+
+  if (this->fill[this->current] == SIGDIGGER_EXPORT_SAMPLES_PIPELINE_BUFFER_SIZE)
+    this->submit();
+}
+
+void
+ExportWriter::put(const void *data, size_t size)
+{
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  size_t avail, chunk;
+  uint8_t *dest;
+
+  while (size > 0) {
+    dest  = this->buffer(avail);
+    chunk = size < avail ? size : avail;
+
+    memcpy(dest, bytes, chunk);
+    this->produced(chunk);
+
+    bytes += chunk;
+    size  -= chunk;
+  }
+}
+
+bool
+ExportWriter::finish(void)
+{
+  if (this->fill[this->current] > 0)
+    this->submit();
+
+  this->mutex.lock();
+  this->finishing = true;
+  this->cond.wakeAll();
+  this->mutex.unlock();
+
+  this->wait();
+
+  return !this->failed;
+}
+
+QString
+ExportWriter::lastError(void) const
+{
+  return this->error;
+}
+
+/////////////////////////////// ExportSamplesTask //////////////////////////////
+
 void
 ExportSamplesTask::breathe(quint64 i)
 {
-  size_t size = this->data.size();
+  size_t size = this->count;
 
   if (this->timer.elapsed() > SIGDIGGER_EXPORT_SAMPLES_BREATHE_INTERVAL_MS) {
     this->timer.restart();
@@ -39,140 +272,343 @@ ExportSamplesTask::breathe(quint64 i)
 }
 
 bool
-ExportSamplesTask::exportToMatlab(void)
+ExportSamplesTask::finishPipeline(ExportSink &sink)
+{
+  bool ok = sink.writer->finish();
+
+  if (!ok)
+    sink.error =
+        "Cannot save data to "
+        + sink.path
+        + ": "
+        + sink.writer->lastError();
+
+  return ok;
+}
+
+bool
+ExportSamplesTask::beginMatlab(ExportSink &sink)
 {
-  size_t size = this->data.size();
+  char line[80];
+  int len;
 
-  of << "%\n";
-  of << "% Time domain capture file generated by SigDigger\n";
-  of << "%\n\n";
+  len = snprintf(
+        line,
+        sizeof(line),
+        "%%\n"
+        "%% Time domain capture file generated by SigDigger\n"
+        "%%\n\n");
+  sink.writer->put(line, static_cast<size_t>(len));
 
-  of << "sampleRate = " << this->fs << ";\n";
-  of << "deltaT = " << 1 / this->fs << ";\n";
-  of << "X = [ ";
+  len = snprintf(line, sizeof(line), "sampleRate = %g;\n", this->fs);
+  sink.writer->put(line, static_cast<size_t>(len));
 
-  of << std::setprecision(std::numeric_limits<float>::digits10);
+  len = snprintf(line, sizeof(line), "deltaT = %g;\n", 1 / this->fs);
+  sink.writer->put(line, static_cast<size_t>(len));
 
+  sink.writer->put("X = [ ", 6);
 
-  for (size_t i = 0; !this->cancelFlag && i < size; ++i) {
-    of
-       << SU_C_REAL(this->data[i]) << " + "
-       << SU_C_IMAG(this->data[i]) << "i, ";
+  return true;
+}
 
-    if (i % SIGDIGGER_EXPORT_SAMPLES_BREATHE_BLOCK_SIZE == 0)
-      this->breathe(i);
+bool
+ExportSamplesTask::writeMatlab(
+    ExportSink &sink,
+    const SUCOMPLEX *data,
+    size_t size)
+{
+  char line[80];
+  int len;
+
+  // Same digits as std::setprecision(digits10) used to give
+  for (size_t i = 0; i < size; ++i) {
+    len = snprintf(
+          line,
+          sizeof(line),
+          "%.*g + %.*gi, ",
+          std::numeric_limits<float>::digits10,
+          static_cast<double>(SU_C_REAL(data[i])),
+          std::numeric_limits<float>::digits10,
+          static_cast<double>(SU_C_IMAG(data[i])));
+    sink.writer->put(line, static_cast<size_t>(len));
   }
 
-  of << "];\n";
+  return true;
+}
+
+bool
+ExportSamplesTask::endMatlab(ExportSink &sink)
+{
+  sink.writer->put("];\n", 3);
+
+  return this->finishPipeline(sink);
+}
+
+bool
+ExportSamplesTask::writeRaw(
+    ExportSink &sink,
+    const SUCOMPLEX *data,
+    size_t size)
+{
+  sink.writer->put(data, size * sizeof(SUCOMPLEX));
 
   return true;
 }
 
 bool
-ExportSamplesTask::exportToMat5(void)
+ExportSamplesTask::endRaw(ExportSink &sink)
+{
+  return this->finishPipeline(sink);
+}
+
+#ifdef HAVE_ZSTD
+bool
+ExportSamplesTask::compressZstd(
+    ExportSink &sink,
+    const SUCOMPLEX *data,
+    size_t size,
+    bool last)
+{
+  ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_continue;
+  size_t remaining, avail;
+  ZSTD_inBuffer in;
+  ZSTD_outBuffer out;
+
+  in.src  = data;
+  in.size = size * sizeof(SUCOMPLEX);
+  in.pos  = 0;
+
+  do {
+    out.dst  = sink.writer->buffer(avail);
+    out.size = avail;
+    out.pos  = 0;
+
+    remaining = ZSTD_compressStream2(sink.zstd, &out, &in, mode);
+    if (ZSTD_isError(remaining)) {
+      sink.error =
+          "Cannot compress data to "
+          + sink.path
+          + ": "
+          + QString(ZSTD_getErrorName(remaining));
+      return false;
+    }
+
+    sink.writer->produced(out.pos);
+  } while (in.pos < in.size || (last && remaining > 0));
+
+  return true;
+}
+#endif // HAVE_ZSTD
+
+bool
+ExportSamplesTask::writeZstd(
+    ExportSink &sink,
+    const SUCOMPLEX *data,
+    size_t size)
+{
+#ifdef HAVE_ZSTD
+  return this->compressZstd(sink, data, size, false);
+#else
+  (void) sink;
+  (void) data;
+  (void) size;
+  return false;
+#endif // HAVE_ZSTD
+}
+
+bool
+ExportSamplesTask::endZstd(ExportSink &sink)
+{
+#ifdef HAVE_ZSTD
+  // Even if cancelled, leave a valid (truncated) frame behind
+  if (!this->compressZstd(sink, nullptr, 0, true)) {
+    sink.writer->finish();
+    return false;
+  }
+
+  return this->finishPipeline(sink);
+#else
+  (void) sink;
+  return false;
+#endif // HAVE_ZSTD
+}
+
+bool
+ExportSamplesTask::writeMat5(
+    ExportSink &sink,
+    const SUCOMPLEX *data,
+    size_t size)
 {
-  size_t size = this->data.size();
   bool ok = false;
 
-  for (size_t i = 0; !this->cancelFlag && i < size; ++i) {
+  for (size_t i = 0; i < size; ++i)
     SU_TRYCATCH(
           su_mat_file_stream_col(
-            this->mf,
-            SU_C_REAL(this->data[i]),
-            SU_C_IMAG(this->data[i])),
+            sink.mf,
+            SU_C_REAL(data[i]),
+            SU_C_IMAG(data[i])),
           goto done);
 
-    if (i % SIGDIGGER_EXPORT_SAMPLES_BREATHE_BLOCK_SIZE == 0) {
-      SU_TRYCATCH(su_mat_file_flush(mf), goto done);
-      this->breathe(i);
-    }
-  }
-
-  SU_TRYCATCH(su_mat_file_flush(mf), goto done);
+  SU_TRYCATCH(su_mat_file_flush(sink.mf), goto done);
 
   ok = true;
 
 done:
   if (!ok)
-    emit error(
+    sink.error =
         "Cannot save data to Mat5 file "
-        + this->path
-        + ". See error log for details.");
+        + sink.path
+        + ". See error log for details.";
 
   return ok;
 }
 
 bool
-ExportSamplesTask::exportToWav(void)
+ExportSamplesTask::writeWav(
+    ExportSink &sink,
+    const SUCOMPLEX *data,
+    size_t size)
 {
-  size_t size = this->data.size();
-  bool ok = false;
-  size_t i = 0;
-  size_t amount;
+  if (sf_write_float(
+        sink.sfp,
+        reinterpret_cast<const SUFLOAT *>(data),
+        2 * static_cast<sf_count_t>(size))
+      != 2 * static_cast<sf_count_t>(size)) {
+    sink.error =
+        "Cannot save data to WAV/RAW file "
+        + sink.path
+        + ": "
+        + QString(sf_strerror(sink.sfp));
+    return false;
+  }
 
-  for (
-       i = 0;
-       !this->cancelFlag && i < size;
-       i += SIGDIGGER_EXPORT_SAMPLES_BREATHE_BLOCK_SIZE) {
+  return true;
+}
 
-    amount = size - i;
-    if (amount > SIGDIGGER_EXPORT_SAMPLES_BREATHE_BLOCK_SIZE)
-      amount = SIGDIGGER_EXPORT_SAMPLES_BREATHE_BLOCK_SIZE;
+bool
+ExportSamplesTask::beginSink(ExportSink &sink)
+{
+  switch (sink.format) {
+    case EXPORT_FORMAT_MATLAB:
+      return this->beginMatlab(sink);
 
-    if (sf_write_float(
-          this->sfp,
-          reinterpret_cast<const SUFLOAT *>(this->data.data() + i),
-          2 * amount)
-        != 2 * static_cast<sf_count_t>(amount))
-        goto done;
+    default:
+      return true;
+  }
+}
 
-    this->breathe(i);
+bool
+ExportSamplesTask::writeSink(
+    ExportSink &sink,
+    const SUCOMPLEX *data,
+    size_t size)
+{
+  switch (sink.format) {
+    case EXPORT_FORMAT_MAT5:
+      return this->writeMat5(sink, data, size);
+
+    case EXPORT_FORMAT_MATLAB:
+      return this->writeMatlab(sink, data, size);
+
+    case EXPORT_FORMAT_WAV:
+      return this->writeWav(sink, data, size);
+
+    case EXPORT_FORMAT_RAW:
+      return this->writeRaw(sink, data, size);
+
+    case EXPORT_FORMAT_ZSTD:
+      return this->writeZstd(sink, data, size);
+
+    default:
+      return false;
   }
+}
 
-  if (i < size)
-    if (sf_write_float(
-        this->sfp,
-        reinterpret_cast<const SUFLOAT *>(this->data.data() + i),
-        2 * static_cast<sf_count_t>(size - i)) !=
-        2 * static_cast<sf_count_t>(size - i))
-      goto done;
+bool
+ExportSamplesTask::endSink(ExportSink &sink)
+{
+  switch (sink.format) {
+    case EXPORT_FORMAT_MATLAB:
+      return this->endMatlab(sink);
 
-  ok = true;
+    case EXPORT_FORMAT_RAW:
+      return this->endRaw(sink);
 
-done:
-  if (!ok)
-    emit error(
-        "Cannot save data to WAV/RAW file "
-        + this->path
-        + ": "
-        + QString(sf_strerror(this->sfp)));
+    case EXPORT_FORMAT_ZSTD:
+      return this->endZstd(sink);
 
-  return ok;
+    default:
+      return true;
+  }
 }
 
+//
+// All sinks are fed from the same pass over the samples: each block is
+// written to every output while it is still in cache, instead of reading
+// the whole selection once per format.
+//
 bool
 ExportSamplesTask::work(void)
 {
-  bool ok = false;
+  size_t size = this->count;
+  size_t amount;
+  bool ok = true;
 
   this->timer.start();
 
-  if (this->format == "mat")
-    ok = this->exportToMat5();
-  else if (this->format == "m")
-    ok = this->exportToMatlab();
-  else if (this->format == "wav" || this->format == "raw")
-    ok = this->exportToWav();
-  else
-    emit error("Unsupported data format " + this->format);
+  for (auto &sink : this->sinks)
+    if (ok && !this->beginSink(sink)) {
+      this->lastError = sink.error;
+      ok = false;
+    }
+
+  // The whole export is a single step: the pool cannot cancel it between
+  // steps, so requests are polled here too
+  for (
+       size_t i = 0;
+       ok && !this->cancelFlag && !this->isCancelRequested() && i < size;
+       i += SIGDIGGER_EXPORT_SAMPLES_BREATHE_BLOCK_SIZE) {
+    const SUCOMPLEX *data = this->samples + i;
 
-  if (ok) {
-    if (this->cancelFlag)
-      emit cancelled();
-    else
-      emit done();
+    amount = size - i;
+    if (amount > SIGDIGGER_EXPORT_SAMPLES_BREATHE_BLOCK_SIZE)
+      amount = SIGDIGGER_EXPORT_SAMPLES_BREATHE_BLOCK_SIZE;
+
+    if (this->store != nullptr) {
+      data = this->block.data();
+      if (this->store->read(
+            this->storeOffset + i,
+            this->block.data(),
+            amount) != amount) {
+        this->lastError = "Cannot read samples back from the sample store";
+        ok = false;
+        break;
+      }
+    }
+
+    for (auto &sink : this->sinks)
+      if (ok && !this->writeSink(sink, data, amount)) {
+        this->lastError = sink.error;
+        ok = false;
+      }
+
+    this->breathe(i);
   }
 
+  // Files are completed even if cancelled or if another sink failed
+  for (auto &sink : this->sinks)
+    if (!this->endSink(sink) && ok) {
+      this->lastError = sink.error;
+      ok = false;
+    }
+
+  if (!ok)
+    emit error(this->lastError);
+  else if (this->cancelFlag || this->isCancelRequested())
+    emit cancelled();
+  else
+    emit done();
+
   return false;
 }
 
@@ -183,27 +619,29 @@ ExportSamplesTask::cancel(void)
 }
 
 bool
-ExportSamplesTask::openMat5(void)
+ExportSamplesTask::openMat5(ExportSink &sink)
 {
   su_mat_matrix_t *mtx = nullptr;
   bool ok = false;
 
-  SU_TRYCATCH(this->mf = su_mat_file_new(), goto done);
+  SU_TRYCATCH(sink.mf = su_mat_file_new(), goto done);
 
   SU_TRYCATCH(
-        mtx = su_mat_file_make_matrix(this->mf, "sampleRate", 1, 1),
+        mtx = su_mat_file_make_matrix(sink.mf, "sampleRate", 1, 1),
         goto done);
   SU_TRYCATCH(su_mat_matrix_write_col(mtx, fs), goto done);
 
   SU_TRYCATCH(
-        mtx = su_mat_file_make_matrix(this->mf, "deltaT", 1, 1),
+        mtx = su_mat_file_make_matrix(sink.mf, "deltaT", 1, 1),
         goto done);
   SU_TRYCATCH(su_mat_matrix_write_col(mtx, 1 / fs), goto done);
 
   SU_TRYCATCH(
-        mtx = su_mat_file_make_streaming_matrix(this->mf, "X", 2, 0),
+        mtx = su_mat_file_make_streaming_matrix(sink.mf, "X", 2, 0),
+        goto done);
+  SU_TRYCATCH(
+        su_mat_file_dump(sink.mf, sink.path.toStdString().c_str()),
         goto done);
-  SU_TRYCATCH(su_mat_file_dump(mf, path.toStdString().c_str()), goto done);
 
   ok = true;
 
@@ -211,7 +649,7 @@ done:
   if (!ok)
     this->lastError =
           "Cannot create Mat5 file "
-          + this->path
+          + sink.path
           + ". See error log for details.";
 
   return ok;
@@ -224,24 +662,54 @@ ExportSamplesTask::getLastError(void) const
 }
 
 bool
-ExportSamplesTask::openMatlab(void)
+ExportSamplesTask::openFile(ExportSink &sink, bool allowDirectIO)
 {
-  this->of = std::ofstream(path.toStdString().c_str(), std::ofstream::binary);
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | O_BINARY;
+  std::string path = sink.path.toStdString();
+
+#ifdef O_DIRECT
+  if (allowDirectIO
+      && this->count * sizeof(SUCOMPLEX)
+      >= SIGDIGGER_EXPORT_SAMPLES_DIRECT_IO_MIN) {
+    sink.fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+    sink.directIO = sink.fd != -1;
+  }
+#else
+  (void) allowDirectIO;
+#endif // O_DIRECT
 
-  if (!of.is_open()) {
+  // Not every filesystem supports O_DIRECT
+  if (sink.fd == -1)
+    sink.fd = ::open(path.c_str(), flags, 0644);
+
+  if (sink.fd == -1) {
     this->lastError =
         "Cannot open "
-        + this->path
+        + sink.path
         + ": "
         + QString(strerror(errno));
     return false;
   }
 
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(sink.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  posix_fadvise(sink.fd, 0, 0, POSIX_FADV_NOREUSE);
+#endif // POSIX_FADV_SEQUENTIAL
+
+  sink.writer = new ExportWriter(sink.fd, sink.directIO);
+  ThreadPolicy::bind(sink.writer, THREAD_ROLE_IO);
+
   return true;
 }
 
 bool
-ExportSamplesTask::openWav(void)
+ExportSamplesTask::openMatlab(ExportSink &sink)
+{
+  return this->openFile(sink, false);
+}
+
+bool
+ExportSamplesTask::openWav(ExportSink &sink)
 {
   SF_INFO sfinfo;
 
@@ -249,13 +717,13 @@ ExportSamplesTask::openWav(void)
   sfinfo.samplerate = static_cast<int>(fs);
   sfinfo.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
 
-  if ((this->sfp = sf_open(
-         path.toStdString().c_str(),
+  if ((sink.sfp = sf_open(
+         sink.path.toStdString().c_str(),
          SFM_WRITE,
          &sfinfo)) == nullptr) {
     this->lastError =
         "Cannot open "
-        + this->path
+        + sink.path
         + ": "
         + QString(strerror(errno));
     return false;
@@ -265,77 +733,184 @@ ExportSamplesTask::openWav(void)
 }
 
 bool
-ExportSamplesTask::openRaw(void)
+ExportSamplesTask::openRaw(ExportSink &sink)
 {
-  SF_INFO sfinfo;
-
-  sfinfo.channels = 2;
-  sfinfo.samplerate = static_cast<int>(fs);
-  sfinfo.format = SF_FORMAT_RAW | SF_FORMAT_FLOAT;
+  return this->openFile(sink, true);
+}
 
-  if ((this->sfp = sf_open(
-         path.toStdString().c_str(),
-         SFM_WRITE,
-         &sfinfo)) == nullptr) {
-    this->lastError =
-        "Cannot open "
-        + this->path
-        + ": "
-        + QString(strerror(errno));
+bool
+ExportSamplesTask::openZstd(ExportSink &sink)
+{
+#ifdef HAVE_ZSTD
+  if ((sink.zstd = ZSTD_createCCtx()) == nullptr) {
+    this->lastError = "Cannot create zstd compression context";
     return false;
   }
 
-  return true;
+  ZSTD_CCtx_setParameter(
+        sink.zstd,
+        ZSTD_c_compressionLevel,
+        SIGDIGGER_EXPORT_SAMPLES_ZSTD_LEVEL);
+
+  // Fails harmlessly if libzstd was built without threads
+  ZSTD_CCtx_setParameter(
+        sink.zstd,
+        ZSTD_c_nbWorkers,
+        QThread::idealThreadCount() > 1 ? QThread::idealThreadCount() - 1 : 0);
+
+  // Compressed output is small: the page cache is fine here
+  return this->openFile(sink, false);
+#else
+  (void) sink;
+  this->lastError = "This build of SigDigger has no zstd support";
+  return false;
+#endif // HAVE_ZSTD
 }
 
+bool
+ExportSamplesTask::openSink(ExportSink &sink)
+{
+  switch (sink.format) {
+    case EXPORT_FORMAT_MAT5:
+      return this->openMat5(sink);
+
+    case EXPORT_FORMAT_MATLAB:
+      return this->openMatlab(sink);
+
+    case EXPORT_FORMAT_WAV:
+      return this->openWav(sink);
+
+    case EXPORT_FORMAT_RAW:
+      return this->openRaw(sink);
+
+    case EXPORT_FORMAT_ZSTD:
+      return this->openZstd(sink);
+
+    default:
+      this->lastError = "Unsupported format \"" + sink.formatName + "\"";
+  }
+
+  return false;
+}
 
 bool
 ExportSamplesTask::attemptOpen(void)
 {
-  if (this->format == "mat")
-    return this->openMat5();
-  else if (this->format == "m")
-    return this->openMatlab();
-  else if (this->format == "wav")
-    return this->openWav();
-  else if (this->format == "raw")
-    return this->openRaw();
-  else
-    this->lastError = "Unsupported format \"" + this->lastError + "\"";
+  if (this->sinks.empty()) {
+    this->lastError = "No output files were given";
+    return false;
+  }
 
-  return false;
+  for (auto &sink : this->sinks)
+    if (!this->openSink(sink))
+      return false;
+
+  return true;
+}
+
+void
+ExportSamplesTask::addSink(QString const &path, QString const &format)
+{
+  ExportSink sink;
+
+  sink.path       = path;
+  sink.formatName = format;
+
+  if (format == "mat")
+    sink.format = EXPORT_FORMAT_MAT5;
+  else if (format == "m")
+    sink.format = EXPORT_FORMAT_MATLAB;
+  else if (format == "wav")
+    sink.format = EXPORT_FORMAT_WAV;
+  else if (format == "raw")
+    sink.format = EXPORT_FORMAT_RAW;
+  else if (format == "zst")
+    sink.format = EXPORT_FORMAT_ZSTD;
+
+  this->sinks.push_back(sink);
 }
 
 ExportSamplesTask::~ExportSamplesTask(void)
 {
-  if (this->sfp != nullptr)
-    sf_close(this->sfp);
+  for (auto &sink : this->sinks) {
+    if (sink.writer != nullptr) {
+      sink.writer->finish();
+      delete sink.writer;
+    }
+
+    if (sink.fd != -1)
+      ::close(sink.fd);
+
+#ifdef HAVE_ZSTD
+    if (sink.zstd != nullptr)
+      ZSTD_freeCCtx(sink.zstd);
+#endif // HAVE_ZSTD
 
-  if (this->mf != nullptr)
-    su_mat_file_destroy(this->mf);
+    if (sink.sfp != nullptr)
+      sf_close(sink.sfp);
+
+    if (sink.mf != nullptr)
+      su_mat_file_destroy(sink.mf);
+  }
 }
 
 ExportSamplesTask::ExportSamplesTask(
-    QString const &path,
-    QString const &format,
-    const SUCOMPLEX *data,
-    size_t length,
+    std::shared_ptr<const std::vector<SUCOMPLEX>> const &buffer,
     qreal fs,
     int start,
     int end)
 {
+  int length = static_cast<int>(buffer->size());
+
   if (start < 0)
     start = 0;
-  if (end > static_cast<int>(length))
-    end = static_cast<int>(length);
+  if (end > length)
+    end = length;
+  if (start > end)
+    start = end;
 
   this->start  = start;
   this->end    = end;
   this->fs     = fs;
-  this->path   = path;
-  this->format = format;
 
-  this->data.resize(static_cast<unsigned>(end - start));
-  this->data.assign(data + start, data + end);
-  this->setDataSize(this->data.size());
+  // No copy: the task only keeps a reference to the buffer it reads from.
+  this->buffer  = buffer;
+  this->samples = buffer->data() + start;
+  this->count   = static_cast<size_t>(end - start);
+  this->setDataSize(this->count);
+}
+
+ExportSamplesTask::ExportSamplesTask(
+    std::shared_ptr<SampleStore> const &store,
+    qreal fs,
+    size_t start,
+    size_t end)
+{
+  size_t length = store->size();
+
+  if (end > length)
+    end = length;
+  if (start > end)
+    start = end;
+
+  this->start  = 0;
+  this->end    = 0;
+  this->fs     = fs;
+
+  this->store       = store;
+  this->storeOffset = start;
+  this->count       = end - start;
+  this->block.resize(SIGDIGGER_EXPORT_SAMPLES_BREATHE_BLOCK_SIZE);
+  this->setDataSize(this->count);
+}
+
+ExportSamplesTask::ExportSamplesTask(
+    QString const &path,
+    QString const &format,
+    std::shared_ptr<const std::vector<SUCOMPLEX>> const &buffer,
+    qreal fs,
+    int start,
+    int end) : ExportSamplesTask(buffer, fs, start, end)
+{
+  this->addSink(path, format);
 }
@@ -18,30 +18,50 @@
 //
 
 #include <HistogramFeeder.h>
+#include <algorithm>
+#include <cmath>
 
 using namespace SigDigger;
 
+Q_DECLARE_METATYPE(SigDigger::HistogramBins);
+
+static bool registered;
+
 HistogramFeeder::HistogramFeeder(
     SamplingProperties const &props,
     QObject *parent) : CancellableTask(parent)
 {
+  if (!registered) {
+    qRegisterMetaType<SigDigger::HistogramBins>();
+    registered = true;
+  }
+
   this->properties = props;
+  this->lanes.resize(
+        SIGDIGGER_HISTOGRAM_FEEDER_LANES * SIGDIGGER_HISTOGRAM_FEEDER_BINS);
+
+  // Amplitude has no natural range: measure it first
+  if (props.space == AMPLITUDE) {
+    this->state = MEASURING;
+    this->setStatusFormat("Measuring range (%1/%2)...");
+  } else {
+    this->min = -PI;
+    this->max = PI;
+    this->startBinning();
+  }
+
+  this->setProgressCount(0, props.length);
 }
 
 HistogramFeeder::~HistogramFeeder()
 {
 }
 
-bool
-HistogramFeeder::work(void)
+unsigned int
+HistogramFeeder::makeBlock(size_t &p, size_t amount)
 {
-  size_t amount = this->properties.length - this->p;
-  size_t p = this->p;
   unsigned int q = 0;
 
-  if (amount > SIGDIGGER_HISTOGRAM_FEEDER_BLOCK_LENGTH)
-    amount = SIGDIGGER_HISTOGRAM_FEEDER_BLOCK_LENGTH;
-
   switch (this->properties.space) {
     case AMPLITUDE:
       while (amount--)
@@ -65,22 +85,112 @@ HistogramFeeder::work(void)
       break;
   }
 
+  return q;
+}
+
+void
+HistogramFeeder::startBinning(void)
+{
+  if (!(this->max > this->min)) {
+    // Empty or constant selection: give it some room
+    if (!std::isfinite(this->min))
+      this->min = this->max = 0;
+    this->max = this->min + 1;
+  }
+
+  this->scale = SIGDIGGER_HISTOGRAM_FEEDER_BINS / (this->max - this->min);
+  this->state = BINNING;
+  this->p     = 0;
+
+  this->setStatusFormat("Computing histogram (%1/%2)...");
+  this->lastUpdate.start();
+}
+
+void
+HistogramFeeder::bin(unsigned int len)
+{
+  const int last = SIGDIGGER_HISTOGRAM_FEEDER_BINS - 1;
+  const SUFLOAT min = this->min;
+  const SUFLOAT scale = this->scale;
+  unsigned int *lanes = this->lanes.data();
+  unsigned int i = 0;
+
+  // Branch-free, so this loop gets vectorized
+  for (unsigned int j = 0; j < len; ++j) {
+    int k = static_cast<int>((this->block[j] - min) * scale);
+    this->index[j] = std::min(std::max(k, 0), last);
+  }
+
+  for (; i + SIGDIGGER_HISTOGRAM_FEEDER_LANES <= len;
+       i += SIGDIGGER_HISTOGRAM_FEEDER_LANES)
+    for (unsigned int l = 0; l < SIGDIGGER_HISTOGRAM_FEEDER_LANES; ++l)
+      ++lanes[l * SIGDIGGER_HISTOGRAM_FEEDER_BINS + this->index[i + l]];
+
+  for (; i < len; ++i)
+    ++lanes[this->index[i]];
 
+  this->samples += len;
+}
+
+void
+HistogramFeeder::emitBins(void)
+{
+  HistogramBins bins;
+
+  bins.counts.assign(
+        this->lanes.begin(),
+        this->lanes.begin() + SIGDIGGER_HISTOGRAM_FEEDER_BINS);
+
+  for (unsigned int l = 1; l < SIGDIGGER_HISTOGRAM_FEEDER_LANES; ++l)
+    for (unsigned int k = 0; k < SIGDIGGER_HISTOGRAM_FEEDER_BINS; ++k)
+      bins.counts[k] += this->lanes[l * SIGDIGGER_HISTOGRAM_FEEDER_BINS + k];
+
+  bins.min     = this->min;
+  bins.max     = this->max;
+  bins.samples = this->samples;
+
+  emit data(bins);
+}
+
+bool
+HistogramFeeder::work(void)
+{
+  size_t amount = this->properties.length - this->p;
+  size_t p = this->p;
+  unsigned int q;
+
+  if (amount > SIGDIGGER_HISTOGRAM_FEEDER_BLOCK_LENGTH)
+    amount = SIGDIGGER_HISTOGRAM_FEEDER_BLOCK_LENGTH;
+
+  q = this->makeBlock(p, amount);
   this->p = p;
 
-  this->setStatus("Measuring ("
-                  + QString::number(p)
-                  + "/"
-                  + QString::number(this->properties.length)
-                  + ")...");
+  this->setProgressCount(p, this->properties.length);
 
-  this->setProgress(
-        static_cast<qreal>(p) / static_cast<qreal>(this->properties.length));
+  if (this->state == MEASURING) {
+    for (unsigned int i = 0; i < q; ++i) {
+      this->min = std::min(this->min, this->block[i]);
+      this->max = std::max(this->max, this->block[i]);
+    }
 
-  emit data(this->block, q);
+    if (this->p >= this->properties.length)
+      this->startBinning();
 
-  if (this->p < this->properties.length)
     return true;
+  }
+
+  this->bin(q);
+
+  if (this->p < this->properties.length) {
+    if (this->lastUpdate.elapsed() >= SIGDIGGER_HISTOGRAM_FEEDER_UPDATE_MS) {
+      this->emitBins();
+      this->lastUpdate.restart();
+    }
+
+    return true;
+  }
+
+  this->emitBins();
 
   emit done();
   return false;
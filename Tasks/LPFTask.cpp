@@ -68,8 +68,8 @@ LPFTask::LPFTask(
 
   SU_ATTEMPT(this->schan  = su_specttuner_open_channel(this->stuner, &cparams));
 
-  this->setProgress(0);
-  this->setStatus("Processing...");
+  this->setProgressCount(0, this->length);
+  this->setStatusFormat("Processing (%1/%2)...");
 }
 
 bool
@@ -88,13 +88,7 @@ LPFTask::work(void)
 
   this->p += amount;
 
-  this->setStatus("Processing ("
-                  + QString::number(p)
-                  + "/"
-                  + QString::number(this->length)
-                  + ")...");
-
-  this->setProgress(static_cast<qreal>(p) / static_cast<qreal>(this->length));
+  this->setProgressCount(this->p, this->length);
 
   if (this->p < this->length)
     return true;
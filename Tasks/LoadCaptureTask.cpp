@@ -0,0 +1,93 @@
+//
+//    LoadCaptureTask.cpp: Load a range of a capture file
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include <LoadCaptureTask.h>
+#include <CaptureFile.h>
+
+using namespace SigDigger;
+
+LoadCaptureTask::LoadCaptureTask(
+    std::shared_ptr<CaptureFile> const &file,
+    quint64 from,
+    size_t count,
+    QObject *parent) : CancellableTask(parent)
+{
+  this->file  = file;
+  this->from  = from;
+  this->count = count;
+
+  this->setProgressCount(0, this->count);
+  this->setStatusFormat("Loading capture (%1/%2)...");
+}
+
+LoadCaptureTask::~LoadCaptureTask()
+{
+}
+
+std::shared_ptr<std::vector<SUCOMPLEX>>
+LoadCaptureTask::takeBuffer(void)
+{
+  return std::move(this->buffer);
+}
+
+bool
+LoadCaptureTask::work(void)
+{
+  size_t amount = this->count - this->p;
+  ssize_t got;
+
+  // Allocated on the first step, so that it happens in the task thread
+  if (!this->buffer) {
+    this->buffer = std::make_shared<std::vector<SUCOMPLEX>>();
+    this->buffer->resize(this->count);
+  }
+
+  if (amount > SIGDIGGER_LOAD_CAPTURE_BLOCK_LENGTH)
+    amount = SIGDIGGER_LOAD_CAPTURE_BLOCK_LENGTH;
+
+  got = this->file->read(
+        this->from + this->p,
+        this->buffer->data() + this->p,
+        amount);
+
+  if (got < 0) {
+    emit error(
+          "Failed to read capture: "
+          + QString::fromStdString(this->file->getError()));
+    return false;
+  }
+
+  this->p += static_cast<size_t>(got);
+  this->setProgressCount(this->p, this->count);
+
+  // Shorter than announced (e.g. a segmented capture with gaps)
+  if (got == 0)
+    this->buffer->resize(this->p);
+
+  if (got > 0 && this->p < this->count)
+    return true;
+
+  emit done();
+  return false;
+}
+
+void
+LoadCaptureTask::cancel(void)
+{
+  emit cancelled();
+}
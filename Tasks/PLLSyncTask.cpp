@@ -37,8 +37,8 @@ PLLSyncTask::PLLSyncTask(
 
   this->pllInitialized = true;
 
-  this->setProgress(0);
-  this->setStatus("Processing...");
+  this->setProgressCount(0, this->length);
+  this->setStatusFormat("Processing (%1/%2)...");
 }
 
 bool
@@ -57,13 +57,7 @@ PLLSyncTask::work(void)
 
   this->p = p;
 
-  this->setStatus("Processing ("
-                  + QString::number(p)
-                  + "/"
-                  + QString::number(this->length)
-                  + ")...");
-
-  this->setProgress(static_cast<qreal>(p) / static_cast<qreal>(this->length));
+  this->setProgressCount(p, this->length);
 
   if (this->p < this->length)
     return true;
@@ -18,69 +18,53 @@
 //
 #include <QuadDemodTask.h>
 #include <Suscan/Library.h>
-
-#define SIGDIGGER_CYCLO_BLOCK_LENGTH 4096
+#include <SampleKernels.h>
 
 QuadDemodTask::QuadDemodTask(
     const SUCOMPLEX *data,
     SUCOMPLEX *destination,
     size_t length,
+    bool fastArg,
     QObject *parent) :
-  Suscan::CancellableTask(parent)
+  Suscan::ChunkedTask(data, length, 1, parent)
 {
   this->origin = data;
   this->destination = destination;
-  this->length = length;
-
-  this->setProgress(0);
-  this->setStatus("Processing...");
+  this->fastArg = fastArg;
 }
 
-bool
-QuadDemodTask::work(void)
+void
+QuadDemodTask::processChunk(
+    size_t start,
+    size_t end,
+    const SUCOMPLEX *history)
 {
-  size_t amount = this->length - this->p;
-  size_t p = this->p;
   SUFLOAT k = 1. / PI;
-  SUCOMPLEX x;
-
-  if (amount > SIGDIGGER_CYCLO_BLOCK_LENGTH)
-    amount = SIGDIGGER_CYCLO_BLOCK_LENGTH;
-
-  while (amount--) {
-    x = this->origin[p];
-    if (p < 1) {
-      this->destination[p] = 0;
-    } else {
-      this->destination[p] = I * k * SU_C_ARG(x * SU_C_CONJ(this->prev));
-    }
-
-    this->prev = x;
-    ++p;
-  }
 
-  this->p = p;
-  this->setStatus("Processing ("
-                  + QString::number(p)
-                  + "/"
-                  + QString::number(this->length)
-                  + ")...");
+  // The kernel runs backwards and never reads what it has written, so
+  // this is safe even if origin and destination are the same buffer.
+  if (end - start > 1)
+    SigDigger::SampleKernels::quadDemod(
+          this->destination + start + 1,
+          this->origin + start + 1,
+          this->origin + start,
+          end - start - 1,
+          k,
+          this->fastArg);
 
-  this->setProgress(static_cast<qreal>(p) / static_cast<qreal>(this->length));
-
-  if (this->p < this->length)
-    return true;
-
-  emit done();
-  return false;
-}
-
-void
-QuadDemodTask::cancel(void)
-{
-  emit cancelled();
+  if (start < 1)
+    this->destination[start] = 0;
+  else
+    SigDigger::SampleKernels::quadDemod(
+          this->destination + start,
+          this->origin + start,
+          history,
+          1,
+          k,
+          this->fastArg);
 }
 
 QuadDemodTask::~QuadDemodTask()
 {
+  this->stop();
 }
@@ -0,0 +1,339 @@
+//
+//    RecordingOverviewTask.cpp: Coarse spectral overview of a recording
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "RecordingOverviewTask.h"
+#include "FFTPlanCache.h"
+#include "CaptureReader.h"
+#include <sigutils/taps.h>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDataStream>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#define SIGDIGGER_RECORDING_OVERVIEW_CACHE_MAGIC   0x53444f56
+#define SIGDIGGER_RECORDING_OVERVIEW_CACHE_VERSION 1
+
+using namespace SigDigger;
+
+//////////////////////////// RecordingOverviewTask /////////////////////////////
+RecordingOverviewTask::RecordingOverviewTask(
+    QString const &path,
+    enum suscan_source_format format,
+    int columns,
+    int bins,
+    QObject *parent) : CancellableTask(parent), slices(this)
+{
+  static bool typesRegistered = false;
+
+  if (!typesRegistered) {
+    qRegisterMetaType<QVector<float>>();
+    typesRegistered = true;
+  }
+
+  this->path    = path;
+  this->format  = format;
+  this->columns = std::max(1, columns);
+  this->bins    = qBound(1, bins, SIGDIGGER_RECORDING_OVERVIEW_FFT_SIZE);
+
+  this->setProgress(0);
+  this->setStatus("Looking for a cached overview");
+}
+
+RecordingOverviewTask::~RecordingOverviewTask()
+{
+  this->slices.stop();
+}
+
+QString
+RecordingOverviewTask::cachePath(void) const
+{
+  QFileInfo fi(this->path);
+
+  return fi.absolutePath()
+      + "/."
+      + fi.fileName()
+      + SIGDIGGER_RECORDING_OVERVIEW_CACHE_SUFFIX;
+}
+
+bool
+RecordingOverviewTask::loadCache(void)
+{
+  QFileInfo fi(this->path);
+  QFile file(this->cachePath());
+  QDataStream stream;
+  quint32 magic, version;
+  quint64 size;
+  qint64 mtime;
+  qint32 format, columns, bins;
+  QVector<float> overview;
+
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+
+  stream.setDevice(&file);
+  stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+  stream >> magic >> version >> size >> mtime >> format >> columns >> bins;
+
+  if (stream.status() != QDataStream::Ok
+      || magic   != SIGDIGGER_RECORDING_OVERVIEW_CACHE_MAGIC
+      || version != SIGDIGGER_RECORDING_OVERVIEW_CACHE_VERSION
+      || size    != static_cast<quint64>(fi.size())
+      || mtime   != fi.lastModified().toMSecsSinceEpoch()
+      || format  != static_cast<qint32>(this->format)
+      || columns != this->columns
+      || bins    != this->bins)
+    return false;
+
+  stream >> overview;
+
+  if (stream.status() != QDataStream::Ok
+      || overview.size() != this->columns * this->bins)
+    return false;
+
+  this->overview = overview;
+
+  return true;
+}
+
+bool
+RecordingOverviewTask::saveCache(void) const
+{
+  QFileInfo fi(this->path);
+  QFile file(this->cachePath());
+  QDataStream stream;
+
+  // Read-only locations are fine, we will just compute it again
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return false;
+
+  stream.setDevice(&file);
+  stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+  stream
+      << static_cast<quint32>(SIGDIGGER_RECORDING_OVERVIEW_CACHE_MAGIC)
+      << static_cast<quint32>(SIGDIGGER_RECORDING_OVERVIEW_CACHE_VERSION)
+      << static_cast<quint64>(fi.size())
+      << static_cast<qint64>(fi.lastModified().toMSecsSinceEpoch())
+      << static_cast<qint32>(this->format)
+      << static_cast<qint32>(this->columns)
+      << static_cast<qint32>(this->bins)
+      << this->overview;
+
+  return stream.status() == QDataStream::Ok;
+}
+
+bool
+RecordingOverviewTask::probe(void)
+{
+  CaptureReader reader;
+  SU_FFTW(_complex) *buffer;
+
+  if (!reader.open(this->path, this->format)) {
+    emit error("Cannot open " + this->path + " to compute its overview");
+    return false;
+  }
+
+  if ((this->samples = reader.getLength()) == 0) {
+    emit error("Capture file " + this->path + " is empty");
+    return false;
+  }
+
+  if ((buffer = static_cast<SU_FFTW(_complex) *>(
+         SU_FFTW(_malloc)(
+           SIGDIGGER_RECORDING_OVERVIEW_FFT_SIZE * sizeof(SUCOMPLEX))))
+      == nullptr) {
+    emit error("Failed to allocate FFT buffer");
+    return false;
+  }
+
+  // The buffer is only needed to get an aligned, in-place plan
+  this->plan = FFTPlanCache::instance()->get(
+        SIGDIGGER_RECORDING_OVERVIEW_FFT_SIZE,
+        FFTW_FORWARD,
+        buffer,
+        buffer);
+
+  SU_FFTW(_free)(buffer);
+
+  if (this->plan == nullptr) {
+    emit error("Failed to initialize FFT plan.");
+    return false;
+  }
+
+  return true;
+}
+
+void
+RecordingOverviewTask::startColumns(void)
+{
+  Suscan::TaskPool *pool = Suscan::TaskPool::shared();
+  int threads = pool != nullptr ? pool->threadCount() : 1;
+
+  this->overview.fill(0, this->columns * this->bins);
+  this->output  = this->overview.data();
+  this->batches = std::min(
+        this->columns,
+        threads * SIGDIGGER_RECORDING_OVERVIEW_BATCHES_PER_CPU);
+
+  this->slices.start(
+        this->batches,
+        [this] (int batch) { this->runBatch(batch); },
+        Suscan::TASK_PRIORITY_BACKGROUND);
+}
+
+void
+RecordingOverviewTask::runBatch(int batch)
+{
+  const size_t fftSize = SIGDIGGER_RECORDING_OVERVIEW_FFT_SIZE;
+  const int ffts = SIGDIGGER_RECORDING_OVERVIEW_FFTS_PER_COLUMN;
+  CaptureReader reader;
+  SU_FFTW(_complex) *window;
+  SUCOMPLEX *asSuComplex;
+  std::vector<SUFLOAT> acc(static_cast<size_t>(this->bins));
+  quint64 spanStart, spanLen, pos;
+  size_t got, i;
+  int first = batch * this->columns / this->batches;
+  int last  = (batch + 1) * this->columns / this->batches;
+  int column, k, count;
+
+  if (!reader.open(this->path, this->format)) {
+    this->failed.storeRelease(1);
+    return;
+  }
+
+  if ((window = static_cast<SU_FFTW(_complex) *>(
+         SU_FFTW(_malloc)(fftSize * sizeof(SUCOMPLEX)))) == nullptr) {
+    this->failed.storeRelease(1);
+    return;
+  }
+
+  asSuComplex = reinterpret_cast<SUCOMPLEX *>(window);
+
+  for (column = first;
+       column < last
+       && !this->slices.isCancelled()
+       && !this->failed.loadAcquire();
+       ++column) {
+    spanStart = this->samples * static_cast<quint64>(column)
+        / static_cast<quint64>(this->columns);
+    spanLen   = this->samples * static_cast<quint64>(column + 1)
+        / static_cast<quint64>(this->columns) - spanStart;
+
+    std::fill(acc.begin(), acc.end(), 0);
+    count = 0;
+
+    // Windows are spread evenly inside the span
+    for (k = 0; k < ffts; ++k) {
+      pos = spanStart;
+      if (spanLen > fftSize)
+        pos += (spanLen - fftSize) * static_cast<quint64>(2 * k + 1)
+            / static_cast<quint64>(2 * ffts);
+
+      if ((got = reader.read(pos, asSuComplex, fftSize)) == 0)
+        continue;
+
+      memset(window + got, 0, (fftSize - got) * sizeof(SUCOMPLEX));
+
+      su_taps_apply_blackmann_harris_complex(
+            asSuComplex,
+            static_cast<SUSCOUNT>(got));
+
+      FFTPlanCache::execute(this->plan, window, window);
+
+      // Negative frequencies first, so bin 0 is the lowest frequency
+      for (i = 0; i < fftSize; ++i) {
+        size_t shifted = (i + fftSize / 2) % fftSize;
+        acc[shifted * static_cast<size_t>(this->bins) / fftSize] +=
+            SU_C_REAL(asSuComplex[i] * SU_C_CONJ(asSuComplex[i]));
+      }
+
+      ++count;
+    }
+
+    // Each column is written by a single thread: no locking needed
+    for (i = 0; i < acc.size(); ++i)
+      this->output[column * this->bins + static_cast<int>(i)] =
+          count > 0
+          ? SU_POWER_DB(acc[i] / (count * fftSize) + 1e-20f)
+          : -200.f;
+
+    this->processed.fetchAndAddRelaxed(1);
+  }
+
+  SU_FFTW(_free)(window);
+}
+
+bool
+RecordingOverviewTask::work(void)
+{
+  switch (this->state) {
+    case LOADING:
+      if (this->loadCache()) {
+        emit ready(this->path, this->overview, this->columns, this->bins);
+        emit done();
+        return false;
+      }
+
+      if (!this->probe())
+        return false;
+
+      this->state = INDEXING;
+      this->setProgressCount(0, static_cast<quint64>(this->columns));
+      this->setStatusFormat("Computing recording overview (%1/%2)...");
+      this->startColumns();
+      break;
+
+    case INDEXING: {
+      bool finished = this->slices.step(
+            SIGDIGGER_RECORDING_OVERVIEW_POLL_INTERVAL_MS);
+
+      this->setProgressCount(
+            this->processed.loadAcquire(),
+            static_cast<quint64>(this->columns));
+
+      if (finished) {
+        if (this->failed.loadAcquire()) {
+          emit error("Failed to read " + this->path);
+          return false;
+        }
+
+        this->state = SAVING;
+        this->setStatus("Saving recording overview");
+      }
+      break;
+    }
+
+    case SAVING:
+      this->saveCache();
+      emit ready(this->path, this->overview, this->columns, this->bins);
+      emit done();
+      return false;
+  }
+
+  return true;
+}
+
+void
+RecordingOverviewTask::cancel(void)
+{
+  this->slices.cancelOwner();
+}
@@ -0,0 +1,234 @@
+//
+//    RecoverySweepTask.cpp: Parallel carrier recovery parameter sweep
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "RecoverySweepTask.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace SigDigger;
+
+std::vector<RecoveryCandidate>
+RecoverySweepTask::costasGrid(SUFLOAT tau, SUFLOAT bw)
+{
+  static const enum sigutils_costas_kind kinds[] = {
+    SU_COSTAS_KIND_BPSK,
+    SU_COSTAS_KIND_QPSK,
+    SU_COSTAS_KIND_8PSK
+  };
+  std::vector<RecoveryCandidate> grid;
+  unsigned int order = 2;
+
+  for (auto kind : kinds) {
+    for (auto candidate : pllGrid(bw)) {
+      candidate.costas = true;
+      candidate.kind   = kind;
+      candidate.order  = order;
+      candidate.tau    = tau;
+      grid.push_back(candidate);
+    }
+
+    order <<= 1;
+  }
+
+  return grid;
+}
+
+std::vector<RecoveryCandidate>
+RecoverySweepTask::pllGrid(SUFLOAT bw)
+{
+  std::vector<RecoveryCandidate> grid;
+  RecoveryCandidate candidate;
+  int half = SIGDIGGER_RECOVERY_SWEEP_BW_STEPS / 2;
+
+  for (int i = -half; i <= half; ++i) {
+    candidate.bw = bw * static_cast<SUFLOAT>(std::ldexp(1., i));
+
+    // Normalized frequencies cannot go beyond 1
+    if (candidate.bw > 0 && candidate.bw < 1)
+      grid.push_back(candidate);
+  }
+
+  return grid;
+}
+
+RecoverySweepTask::RecoverySweepTask(
+    const SUCOMPLEX *data,
+    size_t length,
+    std::vector<RecoveryCandidate> const &candidates,
+    QObject *parent) :
+  Suscan::CancellableTask(parent),
+  candidates(candidates),
+  slices(this)
+{
+  length = std::min<size_t>(length, SIGDIGGER_RECOVERY_SWEEP_MAX_SAMPLES);
+  this->prefix.assign(data, data + length);
+
+  this->setProgressCount(0, this->candidates.size());
+  this->setStatusFormat("Sweeping recovery parameters (%1/%2)...");
+}
+
+RecoverySweepTask::~RecoverySweepTask()
+{
+  this->slices.stop();
+}
+
+//
+// Orders are powers of two, so y^M takes log2(M) squarings
+//
+bool
+RecoverySweepTask::evaluate(RecoveryCandidate &candidate)
+{
+  su_costas_t costas = su_costas_INITIALIZER;
+  su_pll_t pll = su_pll_INITIALIZER;
+  size_t length = this->prefix.size();
+  size_t settle = length / SIGDIGGER_RECOVERY_SWEEP_SETTLE;
+  SUCOMPLEX sum = 0;
+  SUFLOAT norm = 0;
+  SUCOMPLEX y;
+  unsigned int m;
+
+  if (candidate.costas) {
+    if (!su_costas_init(
+          &costas,
+          candidate.kind,
+          0,
+          1 / candidate.tau,
+          3,
+          candidate.bw))
+      return false;
+  } else if (!su_pll_init(&pll, 0, candidate.bw)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < length; ++i) {
+    if (i % SIGDIGGER_RECOVERY_SWEEP_BLOCK_LENGTH == 0
+        && this->slices.isCancelled())
+      break;
+
+    y = candidate.costas
+        ? su_costas_feed(&costas, this->prefix[i])
+        : su_pll_track(&pll, this->prefix[i]);
+
+    if (i >= settle) {
+      for (m = candidate.order; m > 1; m >>= 1)
+        y *= y;
+
+      sum  += y;
+      norm += SU_C_ABS(y);
+    }
+  }
+
+  candidate.score = norm > 0 ? static_cast<qreal>(SU_C_ABS(sum) / norm) : 0;
+
+  if (candidate.costas)
+    su_costas_finalize(&costas);
+  else
+    su_pll_finalize(&pll);
+
+  return true;
+}
+
+void
+RecoverySweepTask::runCandidate(int index)
+{
+  if (!this->evaluate(this->candidates[static_cast<size_t>(index)]))
+    this->failed.storeRelease(1);
+
+  this->processed.fetchAndAddRelaxed(1);
+}
+
+//
+// Any higher order loop also locks to a lower order constellation
+// (8PSK squared 3 times is as compact as BPSK squared once), so the
+// lowest order scoring close to the best one is taken.
+//
+void
+RecoverySweepTask::finish(void)
+{
+  qreal top = 0;
+  bool found = false;
+
+  for (auto const &candidate : this->candidates)
+    top = std::max(top, candidate.score);
+
+  for (auto const &candidate : this->candidates) {
+    if (candidate.score < top - SIGDIGGER_RECOVERY_SWEEP_TOLERANCE)
+      continue;
+
+    if (!found
+        || candidate.order < this->best.order
+        || (candidate.order == this->best.order
+            && candidate.score > this->best.score)) {
+      this->best = candidate;
+      found = true;
+    }
+  }
+}
+
+bool
+RecoverySweepTask::work(void)
+{
+  bool finished;
+
+  if (!this->launched) {
+    if (this->prefix.size() < SIGDIGGER_RECOVERY_SWEEP_MIN_SAMPLES) {
+      emit error("Selection is too short to sweep recovery parameters.");
+      return false;
+    }
+
+    if (this->candidates.empty()) {
+      emit error("No recovery parameters to sweep.");
+      return false;
+    }
+
+    this->slices.start(
+          static_cast<int>(this->candidates.size()),
+          [this] (int index) { this->runCandidate(index); });
+
+    this->launched = true;
+    return true;
+  }
+
+  finished = this->slices.step(SIGDIGGER_RECOVERY_SWEEP_POLL_INTERVAL_MS);
+
+  this->setProgressCount(
+        static_cast<quint64>(this->processed.loadAcquire()),
+        this->candidates.size());
+
+  if (!finished)
+    return true;
+
+  if (this->slices.isCancelled())
+    return false;
+
+  if (this->failed.loadAcquire()) {
+    emit error("Failed to initialize recovery loops.");
+    return false;
+  }
+
+  this->finish();
+
+  emit done();
+  return false;
+}
+
+void
+RecoverySweepTask::cancel(void)
+{
+  this->slices.cancelOwner();
+}
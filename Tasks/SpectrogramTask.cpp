@@ -0,0 +1,219 @@
+//
+//    SpectrogramTask.cpp: Parallel short-time Fourier transform
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "SpectrogramTask.h"
+#include "FFTPlanCache.h"
+#include <sigutils/taps.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace SigDigger;
+
+//////////////////////////////// SpectrogramResult /////////////////////////////
+SpectrogramResult::SpectrogramResult(
+    unsigned int fftSize,
+    size_t hop,
+    qint64 start,
+    size_t length)
+{
+  this->fftSize      = fftSize;
+  this->requestedHop = hop;
+  this->start        = start;
+  this->length       = length;
+
+  if (hop == 0)
+    hop = 1;
+
+  if (length >= fftSize) {
+    this->frames = 1 + (length - fftSize) / hop;
+
+    // Spread the frames over the whole range rather than stopping short
+    if (this->frames > SIGDIGGER_SPECTROGRAM_MAX_FRAMES) {
+      this->frames = SIGDIGGER_SPECTROGRAM_MAX_FRAMES;
+      hop = (length - fftSize) / (this->frames - 1);
+    }
+  }
+
+  this->hop   = hop;
+  this->tiles = (this->frames + SIGDIGGER_SPECTROGRAM_TILE_FRAMES - 1)
+      / SIGDIGGER_SPECTROGRAM_TILE_FRAMES;
+
+  this->power.resize(this->frames * fftSize);
+  this->tilePeak.assign(this->tiles, -std::numeric_limits<float>::infinity());
+  this->tileDone.reset(new std::atomic<bool>[this->tiles]);
+
+  for (size_t i = 0; i < this->tiles; ++i)
+    this->tileDone[i].store(false);
+}
+
+float
+SpectrogramResult::getPeak(void) const
+{
+  float peak = -std::numeric_limits<float>::infinity();
+
+  for (size_t i = 0; i < this->tiles; ++i)
+    if (this->isTileDone(i) && this->tilePeak[i] > peak)
+      peak = this->tilePeak[i];
+
+  return peak;
+}
+
+///////////////////////////////// SpectrogramTask //////////////////////////////
+SpectrogramTask::SpectrogramTask(
+    std::shared_ptr<const std::vector<SUCOMPLEX>> const &buffer,
+    std::shared_ptr<SpectrogramResult> const &result,
+    QObject *parent) : CancellableTask(parent), slices(this)
+{
+  this->buffer = buffer;
+  this->result = result;
+
+  this->setProgressCount(0, this->result->frames);
+  this->setStatusFormat("Computing spectrogram (%1/%2 frames)...");
+}
+
+SpectrogramTask::~SpectrogramTask()
+{
+  this->slices.stop();
+}
+
+bool
+SpectrogramTask::prepare(void)
+{
+  unsigned int size = this->result->fftSize;
+  std::vector<SUCOMPLEX> ones(size, 1);
+  SU_FFTW(_complex) *scratch;
+
+  // Same window as the carrier detector. Computed once, not per frame.
+  su_taps_apply_blackmann_harris_complex(ones.data(), size);
+
+  this->window.resize(size);
+  for (unsigned int i = 0; i < size; ++i)
+    this->window[i] = SU_C_REAL(ones[i]);
+
+  if ((scratch = static_cast<SU_FFTW(_complex) *>(
+         SU_FFTW(_malloc)(size * sizeof(SUCOMPLEX)))) == nullptr)
+    return false;
+
+  this->plan = FFTPlanCache::instance()->get(
+        static_cast<int>(size),
+        FFTW_FORWARD,
+        scratch,
+        scratch);
+
+  SU_FFTW(_free)(scratch);
+
+  return this->plan != nullptr;
+}
+
+void
+SpectrogramTask::runTile(int tile)
+{
+  SpectrogramResult *result = this->result.get();
+  unsigned int size = result->fftSize;
+  unsigned int half = size / 2;
+  const SUCOMPLEX *data = this->buffer->data() + result->start;
+  SU_FFTW(_complex) *frame;
+  SUCOMPLEX *asSuComplex;
+  SUFLOAT norm = 1.f / (static_cast<SUFLOAT>(size) * size);
+  size_t first = static_cast<size_t>(tile) * SIGDIGGER_SPECTROGRAM_TILE_FRAMES;
+  size_t last  = std::min(
+        first + SIGDIGGER_SPECTROGRAM_TILE_FRAMES,
+        result->frames);
+  float peak = -std::numeric_limits<float>::infinity();
+
+  if ((frame = static_cast<SU_FFTW(_complex) *>(
+         SU_FFTW(_malloc)(size * sizeof(SUCOMPLEX)))) == nullptr) {
+    this->failed.storeRelease(1);
+    return;
+  }
+
+  asSuComplex = reinterpret_cast<SUCOMPLEX *>(frame);
+
+  for (size_t f = first; f < last; ++f) {
+    const SUCOMPLEX *src = data + f * result->hop;
+    float *row = result->power.data() + f * size;
+
+    for (unsigned int i = 0; i < size; ++i)
+      asSuComplex[i] = src[i] * this->window[i];
+
+    FFTPlanCache::execute(this->plan, frame, frame);
+
+    // Swap halves, so that DC ends up in the middle
+    for (unsigned int i = 0; i < size; ++i) {
+      SUCOMPLEX x = asSuComplex[(i + half) % size];
+      float db = SU_POWER_DB_RAW(norm * SU_C_REAL(x * SU_C_CONJ(x)) + 1e-20f);
+      row[i] = db;
+      if (db > peak)
+        peak = db;
+    }
+  }
+
+  result->tilePeak[static_cast<size_t>(tile)] = peak;
+  result->tileDone[static_cast<size_t>(tile)].store(
+        true,
+        std::memory_order_release);
+
+  this->processed.fetchAndAddRelaxed(last - first);
+
+  SU_FFTW(_free)(frame);
+}
+
+bool
+SpectrogramTask::work(void)
+{
+  if (!this->started) {
+    if (this->result->frames == 0) {
+      emit error("Selection is shorter than the FFT size.");
+      return false;
+    }
+
+    if (!this->prepare()) {
+      emit error("Failed to initialize FFT plan.");
+      return false;
+    }
+
+    this->slices.start(
+          static_cast<int>(this->result->tiles),
+          [this] (int tile) { this->runTile(tile); });
+
+    this->started = true;
+    return true;
+  }
+
+  bool finished = this->slices.step(SIGDIGGER_SPECTROGRAM_POLL_INTERVAL_MS);
+
+  this->setProgressCount(this->processed.loadAcquire(), this->result->frames);
+
+  if (!finished)
+    return true;
+
+  if (this->failed.loadAcquire()) {
+    emit error("Failed to allocate frame buffers.");
+    return false;
+  }
+
+  emit done();
+  return false;
+}
+
+void
+SpectrogramTask::cancel(void)
+{
+  this->slices.cancelOwner();
+}
@@ -19,6 +19,11 @@
 
 #include <TLEDownloaderTask.h>
 #include <Suscan/Library.h>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
 
 using namespace SigDigger;
 
@@ -31,89 +36,281 @@ TLEDownloaderTask::curl_save_data(
     void *ptr,
     size_t size,
     size_t nmemb,
-    TLEDownloaderTask *self)
+    Transfer *transfer)
 {
   size_t chunksize = size * nmemb;
 
-  if (self->data.size() + chunksize > TLE_DOWNLOADER_MAX_MEMORY_SIZE)
-    chunksize = TLE_DOWNLOADER_MAX_MEMORY_SIZE - self->data.size();
+  if (transfer->data.size() + chunksize > TLE_DOWNLOADER_MAX_MEMORY_SIZE)
+    chunksize = TLE_DOWNLOADER_MAX_MEMORY_SIZE - transfer->data.size();
 
   if (chunksize > 0) {
     const char *asStr = reinterpret_cast<const char *>(ptr);
-    self->data.append(asStr, chunksize);
+    transfer->data.append(asStr, chunksize);
   }
 
   return nmemb;
 }
 
+size_t
+TLEDownloaderTask::curl_save_header(
+    char *buffer,
+    size_t size,
+    size_t nitems,
+    Transfer *transfer)
+{
+  size_t length = size * nitems;
+  std::string line(buffer, length);
+  std::string lower = line;
+  size_t colon;
+
+  // A new response (i.e. after a redirection) starts over
+  if (line.compare(0, 5, "HTTP/") == 0) {
+    transfer->received = Validator();
+    return length;
+  }
+
+  if ((colon = line.find(':')) == std::string::npos)
+    return length;
+
+  for (auto &c : lower)
+    c = static_cast<char>(tolower(c));
+
+  std::string value = line.substr(colon + 1);
+  size_t first = value.find_first_not_of(" \t");
+  size_t last  = value.find_last_not_of(" \t\r\n");
+
+  value = first == std::string::npos
+      ? std::string()
+      : value.substr(first, last - first + 1);
+
+  if (lower.compare(0, colon, "etag") == 0)
+    transfer->received.etag = value;
+  else if (lower.compare(0, colon, "last-modified") == 0)
+    transfer->received.lastModified = value;
+
+  return length;
+}
+
 int
 TLEDownloaderTask::curl_progress(
-    void *self,
+    void *ptr,
     double dltotal,
     double dlnow,
     double,
     double)
 {
-  TLEDownloaderTask *task = reinterpret_cast<TLEDownloaderTask *>(self);
+  Transfer *transfer = reinterpret_cast<Transfer *>(ptr);
 
-  task->setStatus("Downloading data");
-  task->setProgress(dlnow / dltotal);
+  transfer->now   = dlnow;
+  transfer->total = dltotal;
+  transfer->owner->updateProgress();
 
   return 0;
 }
 
+QString
+TLEDownloaderTask::validatorPath(void)
+{
+  const char *local = suscan_confdb_get_local_path();
+
+  if (local == nullptr)
+    return QString();
+
+  return QString(local) + "/cache/" + TLE_DOWNLOADER_VALIDATOR_FILE;
+}
+
+void
+TLEDownloaderTask::loadValidators(void)
+{
+  QFile file(validatorPath());
+
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    return;
+
+  // One source per line: URL, ETag and Last-Modified, tab-separated
+  while (!file.atEnd()) {
+    QStringList fields =
+        QString::fromUtf8(file.readLine()).trimmed().split('\t');
+
+    if (fields.size() == 3) {
+      Validator validator;
+
+      validator.etag         = fields[1].toStdString();
+      validator.lastModified = fields[2].toStdString();
+      this->validators[fields[0].toStdString()] = validator;
+    }
+  }
+}
+
+void
+TLEDownloaderTask::saveValidators(void)
+{
+  QString path = validatorPath();
+
+  if (path.isEmpty() || !QDir().mkpath(QFileInfo(path).absolutePath()))
+    return;
+
+  QSaveFile file(path);
+
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    return;
+
+  QTextStream out(&file);
+
+  for (auto p = this->validators.cbegin(); p != this->validators.cend(); ++p)
+    out << QString::fromStdString(p.key()) << "\t"
+        << QString::fromStdString(p.value().etag) << "\t"
+        << QString::fromStdString(p.value().lastModified) << "\n";
+
+  out.flush();
+  file.commit();
+}
+
+bool
+TLEDownloaderTask::addTransfer(Suscan::TLESource const &src)
+{
+  Transfer *transfer = new Transfer;
+
+  transfer->owner = this;
+  transfer->name  = src.name;
+  transfer->url   = src.url;
+
+  if ((transfer->curl = curl_easy_init()) == nullptr) {
+    delete transfer;
+    return false;
+  }
+
+  this->transfers.push_back(transfer);
+
+  if (this->validators.contains(src.url)) {
+    transfer->sent = this->validators[src.url];
+
+    if (!transfer->sent.etag.empty())
+      transfer->headers = curl_slist_append(
+            transfer->headers,
+            ("If-None-Match: " + transfer->sent.etag).c_str());
+
+    if (!transfer->sent.lastModified.empty())
+      transfer->headers = curl_slist_append(
+            transfer->headers,
+            ("If-Modified-Since: " + transfer->sent.lastModified).c_str());
+  }
+
+  CURL *curl = transfer->curl;
+
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, "SigDigger TLE Downloader/curl");
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10);
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_URL, transfer->url.c_str());
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, transfer);
+  curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0);
+  curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, TLEDownloaderTask::curl_progress);
+  curl_easy_setopt(curl, CURLOPT_PROGRESSDATA, transfer);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, TLEDownloaderTask::curl_save_data);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, TLEDownloaderTask::curl_save_header);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, transfer);
+
+  if (transfer->headers != nullptr)
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer->headers);
+
+  return curl_multi_add_handle(this->multi, curl) == CURLM_OK;
+}
+
 TLEDownloaderTask::TLEDownloaderTask(
-    QString url,
+    QList<Suscan::TLESource> const &sources,
     QObject *parent) : Suscan::CancellableTask(parent)
 {
   this->multi = curl_multi_init();
-  this->curl  = curl_easy_init();
-
-  if (this->curl != nullptr && this->multi) {
-    // curl_easy_setopt(curl, CURLOPT_PROXY, proxy);
-
-    curl_easy_setopt(this->curl, CURLOPT_USERAGENT, "SigDigger TLE Downloader/curl");
-    curl_easy_setopt(this->curl, CURLOPT_CONNECTTIMEOUT, 10);
-    curl_easy_setopt(this->curl, CURLOPT_URL, url.toStdString().c_str());
-    curl_easy_setopt(this->curl, CURLOPT_NOPROGRESS, 0);
-    curl_easy_setopt(this->curl, CURLOPT_PROGRESSFUNCTION, TLEDownloaderTask::curl_progress);
-    curl_easy_setopt(this->curl, CURLOPT_PROGRESSDATA, this);
-    curl_easy_setopt(this->curl, CURLOPT_WRITEFUNCTION, TLEDownloaderTask::curl_save_data);
-    curl_easy_setopt(this->curl, CURLOPT_WRITEDATA, this);
-  }
-
-  curl_multi_add_handle(this->multi, this->curl);
 
   this->setProgress(0);
-  this->setStatus("Performing request...");
+  this->setStatus("Performing requests...");
+
+  if (this->multi == nullptr)
+    return;
+
+  this->loadValidators();
 
   this->ok = true;
+
+  for (auto &src : sources)
+    if (!this->addTransfer(src))
+      this->ok = false;
+}
+
+void
+TLEDownloaderTask::updateProgress(void)
+{
+  double now = 0, total = 0;
+
+  for (auto transfer : this->transfers) {
+    now   += transfer->now;
+    total += transfer->total;
+  }
+
+  this->setStatus(
+        "Downloading "
+        + QString::number(this->running)
+        + " of "
+        + QString::number(this->transfers.size())
+        + " sources");
+
+  if (total > 0)
+    this->setProgress(now / total);
+}
+
+void
+TLEDownloaderTask::finishTransfer(CURL *curl, CURLcode result)
+{
+  Transfer *transfer = nullptr;
+  long code = 0;
+
+  curl_easy_getinfo(curl, CURLINFO_PRIVATE, &transfer);
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+
+  if (transfer == nullptr)
+    return;
+
+  transfer->done = true;
+
+  if (result != CURLE_OK || (code != 200 && code != 304 && code != 0)) {
+    // Forget whatever came with the error
+    transfer->data.clear();
+    ++this->failed;
+  } else if (code == 304) {
+    transfer->data.clear();
+    ++this->unchanged;
+  } else {
+    // Remember what we got, or forget what we sent if there is none
+    this->validators[transfer->url] = transfer->received;
+    ++this->updated;
+  }
 }
 
 void
 TLEDownloaderTask::extractTLEs(void)
 {
-  SUSDIFF got;
-  const char *data = this->data.data();
-  size_t size = this->data.size();
-  orbit_t orbit = orbit_INITIALIZER;
   auto sus = Suscan::Singleton::get_instance();
+  std::string catalog;
 
-  while ((got = orbit_init_from_data(&orbit, data, size)) > 0) {
-    std::string chunk;
-    orbit_finalize(&orbit);
-    chunk.append(data, static_cast<size_t>(got));
-    (void) sus->registerTLE(chunk);
-    data += got;
-    size -= static_cast<size_t>(got);
+  // All at once, so that satellites in several sources are deduplicated
+  for (auto transfer : this->transfers) {
+    if (!transfer->data.empty()) {
+      catalog += transfer->data;
+      if (catalog.back() != '\n')
+        catalog += '\n';
+    }
   }
+
+  this->setStatus("Importing TLEs");
+
+  if (!catalog.empty())
+    (void) sus->registerTLEs(catalog);
 }
 
 bool
 TLEDownloaderTask::work(void)
 {
-  int running = 0;
-  bool downloadFinished = false;
   CURLMcode mc;
   CURLMsg *msg;
   int left;
@@ -121,30 +318,32 @@ TLEDownloaderTask::work(void)
   if (!this->ok) {
     emit error("CURL initialization failed");
     return false;
-  } else {
-    mc = curl_multi_perform(this->multi, &running);
-    if (running) {
-      mc = curl_multi_poll(this->multi, nullptr, 0, 1000, nullptr);
-      if (mc != CURLM_OK) {
-        emit error("CURL poll error: " + QString(curl_multi_strerror(mc)));
-        return false;
-      }
-    }
+  }
 
-    while ((msg = curl_multi_info_read(this->multi, &left)))
-      if (msg->msg == CURLMSG_DONE)
-        downloadFinished = true;
+  mc = curl_multi_perform(this->multi, &this->running);
+  if (this->running) {
+    mc = curl_multi_poll(this->multi, nullptr, 0, 1000, nullptr);
+    if (mc != CURLM_OK) {
+      emit error("CURL poll error: " + QString(curl_multi_strerror(mc)));
+      return false;
+    }
   }
 
-  if (!running) {
-    if (!downloadFinished) {
-      emit error("Download aborted");
+  while ((msg = curl_multi_info_read(this->multi, &left)))
+    if (msg->msg == CURLMSG_DONE)
+      this->finishTransfer(msg->easy_handle, msg->data.result);
+
+  if (!this->running) {
+    if (this->failed == static_cast<unsigned>(this->transfers.size())) {
+      emit error("All TLE sources failed to download");
     } else {
       this->extractTLEs();
+      this->saveValidators();
       emit done();
     }
   }
-  return running != 0;
+
+  return this->running != 0;
 }
 
 void
@@ -155,13 +354,18 @@ TLEDownloaderTask::cancel(void)
 
 TLEDownloaderTask::~TLEDownloaderTask()
 {
-  if (this->multi != nullptr)
-    curl_multi_cleanup(this->multi);
+  for (auto transfer : this->transfers) {
+    if (this->multi != nullptr)
+      curl_multi_remove_handle(this->multi, transfer->curl);
 
-  if (this->curl != nullptr)
-    curl_easy_cleanup(this->curl);
+    curl_easy_cleanup(transfer->curl);
 
-  if (this->fp != nullptr)
-    fclose(this->fp);
-}
+    if (transfer->headers != nullptr)
+      curl_slist_free_all(transfer->headers);
+
+    delete transfer;
+  }
 
+  if (this->multi != nullptr)
+    curl_multi_cleanup(this->multi);
+}
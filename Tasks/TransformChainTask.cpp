@@ -0,0 +1,486 @@
+//
+//    TransformChainTask.cpp: Fused streaming chain of TimeWindow transforms
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include <TransformChainTask.h>
+#include <AGCTask.h>
+#include <SampleKernels.h>
+#include <BlockNCO.h>
+#include <Suscan/Library.h>
+#include <sigutils/agc.h>
+#include <sigutils/specttuner.h>
+#include <QStringList>
+#include <algorithm>
+
+#ifndef NULL
+#  define NULL nullptr
+#endif // NULL
+
+//
+// A stage consumes a block and appends its output to out. Outputs may lag
+// behind inputs (LPF). drain() is then asked to produce the missing ones.
+//
+class TransformStage {
+public:
+  virtual ~TransformStage() { }
+  virtual void feed(
+      const SUCOMPLEX *in,
+      size_t size,
+      std::vector<SUCOMPLEX> &out) = 0;
+
+  virtual void
+  drain(size_t, std::vector<SUCOMPLEX> &)
+  {
+  }
+};
+
+class AGCStage : public TransformStage {
+  su_agc_t agc = su_agc_INITIALIZER;
+  bool initialized = false;
+
+public:
+  AGCStage(SUFLOAT tau)
+  {
+    struct su_agc_params params = su_agc_params_INITIALIZER;
+
+    params.fast_rise_t = tau * SIGDIGGER_AGC_FAST_RISE_FRAC;
+    params.fast_fall_t = tau * SIGDIGGER_AGC_FAST_FALL_FRAC;
+    params.slow_rise_t = tau * SIGDIGGER_AGC_SLOW_RISE_FRAC;
+    params.slow_fall_t = tau * SIGDIGGER_AGC_SLOW_FALL_FRAC;
+    params.hang_max    = tau * SIGDIGGER_AGC_HANG_MAX_FRAC;
+
+    SU_ATTEMPT(su_agc_init(&this->agc, &params));
+    this->initialized = true;
+  }
+
+  ~AGCStage() override
+  {
+    if (this->initialized)
+      su_agc_finalize(&this->agc);
+  }
+
+  void
+  feed(const SUCOMPLEX *in, size_t size, std::vector<SUCOMPLEX> &out) override
+  {
+    while (size-- > 0)
+      out.push_back(su_agc_feed(&this->agc, *in++));
+  }
+};
+
+class CostasStage : public TransformStage {
+  su_costas_t costas = su_costas_INITIALIZER;
+  bool initialized = false;
+
+public:
+  CostasStage(SUFLOAT tau, SUFLOAT loopbw, enum sigutils_costas_kind kind)
+  {
+    SU_ATTEMPT(su_costas_init(&this->costas, kind, 0, 1. / tau, 3, loopbw));
+    this->initialized = true;
+  }
+
+  ~CostasStage() override
+  {
+    if (this->initialized)
+      su_costas_finalize(&this->costas);
+  }
+
+  void
+  feed(const SUCOMPLEX *in, size_t size, std::vector<SUCOMPLEX> &out) override
+  {
+    while (size-- > 0)
+      out.push_back(su_costas_feed(&this->costas, *in++));
+  }
+};
+
+class PLLStage : public TransformStage {
+  su_pll_t pll = su_pll_INITIALIZER;
+  bool initialized = false;
+
+public:
+  PLLStage(SUFLOAT bw)
+  {
+    SU_ATTEMPT(su_pll_init(&this->pll, 0, bw));
+    this->initialized = true;
+  }
+
+  ~PLLStage() override
+  {
+    if (this->initialized)
+      su_pll_finalize(&this->pll);
+  }
+
+  void
+  feed(const SUCOMPLEX *in, size_t size, std::vector<SUCOMPLEX> &out) override
+  {
+    while (size-- > 0)
+      out.push_back(su_pll_track(&this->pll, *in++));
+  }
+};
+
+class LPFStage : public TransformStage {
+  su_specttuner_t *stuner        = nullptr;
+  su_specttuner_channel_t *schan = nullptr;
+  std::vector<SUCOMPLEX> *out = nullptr;
+
+  static SUBOOL
+  onData(
+        const struct sigutils_specttuner_channel *,
+        void *privdata,
+        const SUCOMPLEX *data,
+        SUSCOUNT size)
+  {
+    LPFStage *self = reinterpret_cast<LPFStage *>(privdata);
+
+    self->out->insert(self->out->end(), data, data + size);
+
+    return SU_TRUE;
+  }
+
+public:
+  LPFStage(SUFLOAT bw)
+  {
+    struct sigutils_specttuner_params params =
+        sigutils_specttuner_params_INITIALIZER;
+    struct sigutils_specttuner_channel_params cparams =
+        sigutils_specttuner_channel_params_INITIALIZER;
+
+    SU_ATTEMPT(this->stuner = su_specttuner_new(&params));
+
+    cparams.f0       = 0;
+    cparams.bw       = SU_NORM2ANG_FREQ(bw);
+    cparams.guard    = 2 * PI / cparams.bw;
+    cparams.privdata = this;
+    cparams.on_data  = LPFStage::onData;
+
+    SU_ATTEMPT(
+          this->schan = su_specttuner_open_channel(this->stuner, &cparams));
+  }
+
+  ~LPFStage() override
+  {
+    if (this->stuner != nullptr)
+      su_specttuner_destroy(this->stuner);
+  }
+
+  void
+  feed(const SUCOMPLEX *in, size_t size, std::vector<SUCOMPLEX> &out) override
+  {
+    this->out = &out;
+    SU_ATTEMPT(su_specttuner_feed_bulk(this->stuner, in, size));
+  }
+
+  void
+  drain(size_t pending, std::vector<SUCOMPLEX> &out) override
+  {
+    size_t target = out.size() + pending;
+    SUCOMPLEX zero = 0;
+
+    this->out = &out;
+    while (out.size() < target)
+      SU_ATTEMPT(su_specttuner_feed_bulk(this->stuner, &zero, 1));
+
+    out.resize(target);
+  }
+};
+
+class QuadDemodStage : public TransformStage {
+  SUCOMPLEX prev = 0;
+  bool first = true;
+
+public:
+  void
+  feed(const SUCOMPLEX *in, size_t size, std::vector<SUCOMPLEX> &out) override
+  {
+    size_t base = out.size();
+    SUFLOAT k = 1. / PI;
+
+    if (size == 0)
+      return;
+
+    out.resize(base + size);
+
+    if (this->first) {
+      out[base] = 0;
+      this->first = false;
+    } else {
+      SigDigger::SampleKernels::quadDemod(
+            out.data() + base, in, &this->prev, 1, k, true);
+    }
+
+    SigDigger::SampleKernels::quadDemod(
+          out.data() + base + 1, in + 1, in, size - 1, k, true);
+
+    this->prev = in[size - 1];
+  }
+};
+
+class DelayedConjStage : public TransformStage {
+  std::vector<SUCOMPLEX> line;
+  SUSCOUNT delay;
+  SUSCOUNT consumed = 0;
+
+public:
+  DelayedConjStage(SUSCOUNT delay) : line(delay, 0), delay(delay)
+  {
+    if (delay == 0)
+      throw Suscan::Exception("Delay is zero samples\n");
+  }
+
+  void
+  feed(const SUCOMPLEX *in, size_t size, std::vector<SUCOMPLEX> &out) override
+  {
+    size_t base = out.size();
+    size_t zeros = 0;
+
+    // line holds the last `delay` inputs, followed by the current block
+    this->line.insert(this->line.end(), in, in + size);
+    out.resize(base + size);
+
+    SigDigger::SampleKernels::delayedConj(
+          out.data() + base,
+          this->line.data() + this->delay,
+          this->line.data(),
+          size,
+          1e-3f);
+
+    if (this->consumed < this->delay)
+      zeros = std::min<size_t>(this->delay - this->consumed, size);
+
+    std::fill(out.begin() + static_cast<long>(base),
+              out.begin() + static_cast<long>(base + zeros),
+              0);
+
+    this->consumed += size;
+    this->line.erase(
+          this->line.begin(),
+          this->line.begin() + static_cast<long>(size));
+  }
+};
+
+class XlateStage : public TransformStage {
+  BlockNCO nco;
+
+public:
+  XlateStage(SUFLOAT relFreq, SUFLOAT phase) : nco(-relFreq, -phase)
+  {
+  }
+
+  void
+  feed(const SUCOMPLEX *in, size_t size, std::vector<SUCOMPLEX> &out) override
+  {
+    size_t base = out.size();
+
+    out.resize(base + size);
+    this->nco.mix(out.data() + base, in, size);
+  }
+};
+
+QString
+TransformStep::describe(void) const
+{
+  switch (this->kind) {
+    case AGC:
+      return "AGC";
+
+    case LPF:
+      return "LPF";
+
+    case COSTAS:
+      return "Costas";
+
+    case PLL:
+      return "PLL";
+
+    case QUAD_DEMOD:
+      return "Quad demod";
+
+    case DELAYED_CONJ:
+      return "Delayed conj (" + QString::number(this->delay) + " sp)";
+
+    case XLATE:
+      return "Carrier xlate";
+  }
+
+  return "?";
+}
+
+QString
+TransformRecord::describe(void) const
+{
+  QStringList names;
+
+  for (auto &step : this->steps)
+    names.append(step.describe());
+
+  return names.join(" → ");
+}
+
+TransformChainTask::TransformChainTask(
+    const SUCOMPLEX *data,
+    SUCOMPLEX *destination,
+    size_t length,
+    std::vector<TransformStep> const &steps,
+    QObject *parent) :
+  Suscan::CancellableTask(parent)
+{
+  this->origin = data;
+  this->destination = destination;
+  this->length = length;
+
+  try {
+    for (auto &step : steps) {
+      switch (step.kind) {
+        case TransformStep::AGC:
+          this->stages.push_back(new AGCStage(step.tau));
+          break;
+
+        case TransformStep::LPF:
+          this->stages.push_back(new LPFStage(step.bw));
+          break;
+
+        case TransformStep::COSTAS:
+          this->stages.push_back(
+                new CostasStage(step.tau, step.bw, step.costasKind));
+          break;
+
+        case TransformStep::PLL:
+          this->stages.push_back(new PLLStage(step.bw));
+          break;
+
+        case TransformStep::QUAD_DEMOD:
+          this->stages.push_back(new QuadDemodStage());
+          break;
+
+        case TransformStep::DELAYED_CONJ:
+          this->stages.push_back(new DelayedConjStage(step.delay));
+          break;
+
+        case TransformStep::XLATE:
+          this->stages.push_back(new XlateStage(step.freq, step.phase));
+          break;
+      }
+    }
+  } catch (Suscan::Exception &) {
+    for (auto stage : this->stages)
+      delete stage;
+    throw;
+  }
+
+  this->buffers.resize(this->stages.size());
+  this->consumed.resize(this->stages.size(), 0);
+  this->produced.resize(this->stages.size(), 0);
+  for (auto &buf : this->buffers)
+    buf.reserve(2 * SIGDIGGER_TRANSFORM_CHAIN_BLOCK_LENGTH);
+
+  this->setProgressCount(0, this->length);
+  this->setStatusFormat("Processing (%1/%2)...");
+}
+
+void
+TransformChainTask::runStages(
+    size_t first,
+    const SUCOMPLEX *data,
+    size_t size)
+{
+  size_t i, avail;
+
+  for (i = first; i < this->stages.size(); ++i) {
+    this->buffers[i].clear();
+    this->stages[i]->feed(data, size, this->buffers[i]);
+    this->consumed[i] += size;
+    this->produced[i] += this->buffers[i].size();
+    data = this->buffers[i].data();
+    size = this->buffers[i].size();
+  }
+
+  // Outputs never get ahead of inputs, so this never overwrites samples
+  // that have not been read yet.
+  avail = std::min(size, this->length - this->q);
+  std::copy(data, data + avail, this->destination + this->q);
+  this->q += avail;
+}
+
+void
+TransformChainTask::flush(void)
+{
+  size_t i;
+
+  // Let lagging stages catch up, front to back
+  for (i = 0; i < this->stages.size() && this->q < this->length; ++i) {
+    std::vector<SUCOMPLEX> &buf = this->buffers[i];
+
+    buf.clear();
+    this->stages[i]->drain(this->consumed[i] - this->produced[i], buf);
+    this->produced[i] += buf.size();
+
+    if (!buf.empty())
+      this->runStages(i + 1, buf.data(), buf.size());
+  }
+
+  // Stages without latency already produced everything
+  if (this->q < this->length)
+    std::fill(
+          this->destination + this->q,
+          this->destination + this->length,
+          0);
+}
+
+bool
+TransformChainTask::work(void)
+{
+  size_t amount = this->length - this->p;
+
+  if (amount > SIGDIGGER_TRANSFORM_CHAIN_BLOCK_LENGTH)
+    amount = SIGDIGGER_TRANSFORM_CHAIN_BLOCK_LENGTH;
+
+  if (amount > 0) {
+    if (this->stages.empty()) {
+      std::copy(
+            this->origin + this->p,
+            this->origin + this->p + amount,
+            this->destination + this->q);
+      this->q += amount;
+    } else {
+      this->runStages(0, this->origin + this->p, amount);
+    }
+
+    this->p += amount;
+  }
+
+  this->setProgressCount(this->p, this->length);
+
+  if (this->p < this->length)
+    return true;
+
+  this->flush();
+
+  emit done();
+  return false;
+}
+
+void
+TransformChainTask::cancel(void)
+{
+  emit cancelled();
+}
+
+TransformChainTask::~TransformChainTask()
+{
+  for (auto stage : this->stages)
+    delete stage;
+}
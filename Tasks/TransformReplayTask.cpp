@@ -0,0 +1,95 @@
+//
+//    TransformReplayTask.cpp: Re-apply recorded transforms in place
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include <TransformReplayTask.h>
+#include <Suscan/Library.h>
+
+TransformReplayTask::TransformReplayTask(
+    SUCOMPLEX *buffer,
+    size_t length,
+    std::vector<TransformRecord> const &records,
+    QObject *parent) :
+  Suscan::CancellableTask(parent),
+  records(records)
+{
+  this->buffer = buffer;
+  this->length = length;
+
+  for (auto &record : this->records)
+    if (record.offset + record.length > length)
+      throw Suscan::Exception("Recorded transform exceeds capture length");
+
+  this->setProgress(0);
+  this->setStatus("Replaying...");
+}
+
+bool
+TransformReplayTask::work(void)
+{
+  if (this->current < this->records.size()) {
+    TransformRecord const &record = this->records[this->current];
+    qreal count = static_cast<qreal>(this->records.size());
+
+    if (this->task == nullptr) {
+      this->task = new TransformChainTask(
+            this->buffer + record.offset,
+            this->buffer + record.offset,
+            record.length,
+            record.steps);
+
+      this->setStatus(
+            "Replaying "
+            + record.describe()
+            + " ("
+            + QString::number(this->current + 1)
+            + "/"
+            + QString::number(this->records.size())
+            + ")...");
+    }
+
+    if (!this->task->work()) {
+      delete this->task;
+      this->task = nullptr;
+      ++this->current;
+    }
+
+    this->setProgress(
+          (static_cast<qreal>(this->current)
+           + (this->task != nullptr ? this->task->getProgress() : 0))
+          / count);
+  }
+
+  if (this->current < this->records.size())
+    return true;
+
+  emit done();
+  return false;
+}
+
+void
+TransformReplayTask::cancel(void)
+{
+  emit cancelled();
+}
+
+TransformReplayTask::~TransformReplayTask()
+{
+  if (this->task != nullptr)
+    delete this->task;
+}
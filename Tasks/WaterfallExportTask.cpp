@@ -0,0 +1,451 @@
+//
+//    WaterfallExportTask.cpp: Render long waterfalls to image files
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "WaterfallExportTask.h"
+#include "WaterfallHistory.h"
+#include "CaptureReader.h"
+#include "FFTPlanCache.h"
+#include <sigutils/taps.h>
+#include <QFileInfo>
+#include <algorithm>
+#include <cstring>
+
+using namespace SigDigger;
+
+WaterfallExportTask::WaterfallExportTask(
+    WaterfallHistory const *history,
+    QString const &path,
+    const QRgb *palette,
+    float min,
+    float max,
+    QObject *parent) : CancellableTask(parent)
+{
+  quint64 end;
+  unsigned int size = 0;
+  struct timeval tv;
+
+  this->history = history;
+  this->path    = path;
+  this->init(palette, min, max);
+
+  history->serials(this->firstSerial, end);
+  this->lines = end - this->firstSerial;
+
+  // We are in the GUI thread: the history can be looked at directly
+  if (this->lines > 0)
+    history->frame(history->count() - 1, size, tv);
+
+  this->width = size;
+}
+
+WaterfallExportTask::WaterfallExportTask(
+    QString const &capture,
+    enum suscan_source_format format,
+    QString const &path,
+    const QRgb *palette,
+    float min,
+    float max,
+    unsigned int fftSize,
+    QObject *parent) : CancellableTask(parent)
+{
+  this->capture       = capture;
+  this->captureFormat = format;
+  this->path          = path;
+  this->width         = std::max(2u, fftSize);
+  this->init(palette, min, max);
+}
+
+WaterfallExportTask::~WaterfallExportTask()
+{
+  if (this->window != nullptr)
+    SU_FFTW(_free)(this->window);
+}
+
+void
+WaterfallExportTask::init(const QRgb *palette, float min, float max)
+{
+  memcpy(this->palette, palette, sizeof(this->palette));
+
+  if (min > max)
+    std::swap(min, max);
+  if (max - min < 1)
+    max = min + 1;
+
+  this->minDb = min;
+  this->maxDb = max;
+
+  this->setProgress(0);
+  this->setStatus("Preparing waterfall export");
+}
+
+bool
+WaterfallExportTask::openCapture(void)
+{
+  quint64 samples;
+
+  this->reader.reset(new CaptureReader());
+
+  if (!this->reader->open(this->capture, this->captureFormat)) {
+    this->lastError = "Cannot open capture file " + this->capture;
+    return false;
+  }
+
+  samples = this->reader->getLength();
+  if (samples < this->width) {
+    this->lastError = "Capture file " + this->capture + " is too short";
+    return false;
+  }
+
+  // Long captures are strided. A few FFTs are averaged in each stride,
+  // so that short bursts between lines still have a chance to show.
+  this->hop = this->width;
+  if (samples / this->hop > SIGDIGGER_WATERFALL_EXPORT_MAX_LINES)
+    this->hop = (samples + SIGDIGGER_WATERFALL_EXPORT_MAX_LINES - 1)
+        / SIGDIGGER_WATERFALL_EXPORT_MAX_LINES;
+
+  this->lines    = samples / this->hop;
+  this->averages = static_cast<unsigned int>(
+        std::min<quint64>(
+          this->hop / this->width,
+          SIGDIGGER_WATERFALL_EXPORT_MAX_AVERAGE));
+
+  if ((this->window = static_cast<SU_FFTW(_complex) *>(
+         SU_FFTW(_malloc)(this->width * sizeof(SUCOMPLEX)))) == nullptr) {
+    this->lastError = "Failed to allocate FFT buffer";
+    return false;
+  }
+
+  this->plan = FFTPlanCache::instance()->get(
+        static_cast<int>(this->width),
+        FFTW_FORWARD,
+        this->window,
+        this->window);
+
+  if (this->plan == nullptr) {
+    this->lastError = "Failed to initialize FFT plan";
+    return false;
+  }
+
+  this->acc.resize(this->width);
+
+  return true;
+}
+
+bool
+WaterfallExportTask::attemptOpen(void)
+{
+  QFileInfo info(this->path);
+
+  if (!this->capture.isEmpty()) {
+    if (!this->openCapture())
+      return false;
+  } else if (this->lines == 0 || this->width == 0) {
+    this->lastError = "The waterfall history is empty";
+    return false;
+  }
+
+  this->psd.resize(this->width);
+  this->rgbRow.resize(this->width);
+
+  if (info.suffix().toLower() == "ppm") {
+    this->format = WATERFALL_EXPORT_PPM;
+    this->ppmRow.resize(3 * this->width);
+    this->ppm.setFileName(this->path);
+
+    if (!this->ppm.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      this->lastError = "Cannot open " + this->path + ": "
+          + this->ppm.errorString();
+      return false;
+    }
+
+    if (!this->writePpmHeader(this->lines))
+      return false;
+  } else {
+    this->format = WATERFALL_EXPORT_PNG;
+
+    if (!QFileInfo(info.absolutePath()).isWritable()) {
+      this->lastError = "Cannot write to " + info.absolutePath();
+      return false;
+    }
+
+    this->newTile(0);
+  }
+
+  this->setProgressCount(0, this->lines);
+  this->setStatusFormat("Rendering line %1 of %2");
+
+  return true;
+}
+
+void
+WaterfallExportTask::historyLine(quint64 line)
+{
+  struct timeval tv;
+
+  if (!this->history->copyFrame(
+        this->firstSerial + line,
+        this->psd.data(),
+        this->width,
+        tv))
+    std::fill(this->psd.begin(), this->psd.end(), this->minDb);
+}
+
+void
+WaterfallExportTask::captureLine(quint64 line)
+{
+  SUCOMPLEX *asSuComplex = reinterpret_cast<SUCOMPLEX *>(this->window);
+  quint64 start = line * this->hop;
+  quint64 pos;
+  size_t size = this->width;
+  size_t got, i;
+  unsigned int k, count = 0;
+
+  std::fill(this->acc.begin(), this->acc.end(), 0);
+
+  // Windows are spread evenly inside the stride
+  for (k = 0; k < this->averages; ++k) {
+    pos = start + (this->hop - size) * (2 * k + 1) / (2 * this->averages);
+
+    if ((got = this->reader->read(pos, asSuComplex, size)) == 0)
+      continue;
+
+    memset(this->window + got, 0, (size - got) * sizeof(SUCOMPLEX));
+
+    su_taps_apply_blackmann_harris_complex(
+          asSuComplex,
+          static_cast<SUSCOUNT>(got));
+
+    FFTPlanCache::execute(this->plan, this->window, this->window);
+
+    // Negative frequencies first, as in the waterfall
+    for (i = 0; i < size; ++i)
+      this->acc[(i + size / 2) % size] +=
+          SU_C_REAL(asSuComplex[i] * SU_C_CONJ(asSuComplex[i]));
+
+    ++count;
+  }
+
+  for (i = 0; i < size; ++i)
+    this->psd[i] = count > 0
+        ? SU_POWER_DB(this->acc[i] / (count * size) + 1e-20f)
+        : this->minDb;
+}
+
+void
+WaterfallExportTask::paint(QRgb *dest) const
+{
+  const float scale =
+      (SIGDIGGER_PALETTE_MAX_STOPS - 1) / (this->maxDb - this->minDb);
+  float index;
+
+  for (unsigned int i = 0; i < this->width; ++i) {
+    index = (this->psd[i] - this->minDb) * scale;
+
+    // Written so that NaNs go to the bottom of the palette too
+    if (!(index > 0))
+      dest[i] = this->palette[0];
+    else if (index >= SIGDIGGER_PALETTE_MAX_STOPS - 1)
+      dest[i] = this->palette[SIGDIGGER_PALETTE_MAX_STOPS - 1];
+    else
+      dest[i] = this->palette[static_cast<int>(index)];
+  }
+}
+
+QString
+WaterfallExportTask::tilePath(unsigned int index) const
+{
+  QFileInfo info(this->path);
+
+  if (this->lines <= SIGDIGGER_WATERFALL_EXPORT_TILE_LINES)
+    return this->path;
+
+  return info.path()
+      + "/"
+      + info.completeBaseName()
+      + QString("-%1.png").arg(index, 4, 10, QChar('0'));
+}
+
+void
+WaterfallExportTask::newTile(quint64 first)
+{
+  quint64 height = std::min<quint64>(
+        this->lines - first,
+        SIGDIGGER_WATERFALL_EXPORT_TILE_LINES);
+
+  this->tile = QImage(
+        static_cast<int>(this->width),
+        static_cast<int>(height),
+        QImage::Format_RGB32);
+  this->tileLine = 0;
+}
+
+bool
+WaterfallExportTask::saveTile(void)
+{
+  QString path = this->tilePath(this->tileIndex);
+  QImage image;
+
+  if (this->tileLine == 0)
+    return true;
+
+  // Only a cancelled export leaves a tile half done
+  if (this->tileLine < this->tile.height())
+    image = this->tile.copy(
+          0,
+          0,
+          static_cast<int>(this->width),
+          this->tileLine);
+  else
+    image = this->tile;
+
+  if (!image.save(path, "PNG")) {
+    this->lastError = "Cannot save waterfall tile to " + path;
+    return false;
+  }
+
+  ++this->tileIndex;
+  this->tileLine = 0;
+
+  return true;
+}
+
+bool
+WaterfallExportTask::writePpmHeader(quint64 height)
+{
+  // The height is padded, so that the header can be rewritten in place
+  // with the actual number of lines if the export is cancelled.
+  QByteArray header = QString("P6\n%1 %2\n255\n")
+      .arg(this->width)
+      .arg(height, 20)
+      .toLatin1();
+
+  if (!this->ppm.seek(0)
+      || this->ppm.write(header) != header.size()
+      || !this->ppm.seek(this->ppm.size())) {
+    this->lastError = "Cannot write to " + this->path + ": "
+        + this->ppm.errorString();
+    return false;
+  }
+
+  return true;
+}
+
+bool
+WaterfallExportTask::writeLine(void)
+{
+  if (this->format == WATERFALL_EXPORT_PPM) {
+    qint64 size = static_cast<qint64>(this->ppmRow.size());
+
+    this->paint(this->rgbRow.data());
+
+    for (unsigned int i = 0; i < this->width; ++i) {
+      this->ppmRow[3 * i]     = static_cast<uchar>(qRed(this->rgbRow[i]));
+      this->ppmRow[3 * i + 1] = static_cast<uchar>(qGreen(this->rgbRow[i]));
+      this->ppmRow[3 * i + 2] = static_cast<uchar>(qBlue(this->rgbRow[i]));
+    }
+
+    if (this->ppm.write(
+          reinterpret_cast<const char *>(this->ppmRow.data()),
+          size) != size) {
+      this->lastError = "Cannot write to " + this->path + ": "
+          + this->ppm.errorString();
+      return false;
+    }
+  } else {
+    this->paint(reinterpret_cast<QRgb *>(this->tile.scanLine(this->tileLine)));
+
+    if (++this->tileLine == this->tile.height()) {
+      if (!this->saveTile())
+        return false;
+
+      if (this->line + 1 < this->lines)
+        this->newTile(this->line + 1);
+    }
+  }
+
+  return true;
+}
+
+bool
+WaterfallExportTask::finish(void)
+{
+  bool ok = true;
+
+  if (this->format == WATERFALL_EXPORT_PPM) {
+    if (this->line < this->lines)
+      ok = this->writePpmHeader(this->line);
+
+    this->ppm.close();
+  } else {
+    ok = this->saveTile();
+  }
+
+  this->tile = QImage();
+
+  return ok;
+}
+
+bool
+WaterfallExportTask::work(void)
+{
+  unsigned int n;
+
+  for (
+       n = 0;
+       !this->cancelFlag
+       && n < SIGDIGGER_WATERFALL_EXPORT_STEP_LINES
+       && this->line < this->lines;
+       ++n, ++this->line) {
+    if (this->history != nullptr)
+      this->historyLine(this->line);
+    else
+      this->captureLine(this->line);
+
+    if (!this->writeLine()) {
+      emit error(this->lastError);
+      return false;
+    }
+  }
+
+  this->setProgressCount(this->line, this->lines);
+
+  if (!this->cancelFlag && this->line < this->lines)
+    return true;
+
+  // Whatever was rendered is saved, even if cancelled
+  if (!this->finish())
+    emit error(this->lastError);
+  else if (this->cancelFlag)
+    emit cancelled();
+  else
+    emit done();
+
+  return false;
+}
+
+void
+WaterfallExportTask::cancel(void)
+{
+  this->cancelFlag = true;
+}
+
+QString
+WaterfallExportTask::getLastError(void) const
+{
+  return this->lastError;
+}
@@ -22,6 +22,8 @@
 #include <sigutils/sampling.h>
 #include <sigutils/taps.h>
 #include <SuWidgetsHelpers.h>
+#include <QMutex>
+#include <algorithm>
 
 using namespace SigDigger;
 
@@ -29,10 +31,70 @@ Q_DECLARE_METATYPE(SigDigger::WaveSampleSet);
 
 static bool registered;
 
+static QMutex g_pagePoolMutex;
+static std::vector<void *> g_pagePool;
+
+////////////////////////////// WaveSampleBuffer ////////////////////////////////
+WaveSampleBuffer::Page *
+WaveSampleBuffer::acquirePage(void)
+{
+  {
+    QMutexLocker locker(&g_pagePoolMutex);
+
+    if (!g_pagePool.empty()) {
+      Page *page = static_cast<Page *>(g_pagePool.back());
+      g_pagePool.pop_back();
+      return page;
+    }
+  }
+
+  return new Page;
+}
+
+void
+WaveSampleBuffer::releasePage(Page *page)
+{
+  {
+    QMutexLocker locker(&g_pagePoolMutex);
+
+    if (g_pagePool.size() < SIGDIGGER_WAVESAMPLER_PAGE_POOL_MAX) {
+      g_pagePool.push_back(page);
+      return;
+    }
+  }
+
+  delete page;
+}
+
+WaveSampleBuffer::~WaveSampleBuffer()
+{
+  for (auto page : this->pages)
+    releasePage(page);
+}
+
+size_t
+WaveSampleBuffer::allocate(size_t count)
+{
+  size_t first;
+
+  first = (this->used + SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH - 1)
+      / SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH
+      * SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH;
+  this->used = first + count;
+
+  while (this->pages.size() * SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH
+         < this->used)
+    this->pages.push_back(acquirePage());
+
+  return first;
+}
+
+//////////////////////////////// WaveSampler ///////////////////////////////////
+
 WaveSampler::WaveSampler(
     SamplingProperties const &props,
     const Decider *decider,
-    QObject *parent) : CancellableTask(parent)
+    QObject *parent) : CancellableTask(parent), slices(this)
 {
   if (!registered) {
     qRegisterMetaType<SigDigger::WaveSampleSet>();
@@ -50,6 +112,11 @@ WaveSampler::WaveSampler(
   if (this->bnor > 1)
     this->bnor = 1;
 
+  this->buffer   = std::make_shared<WaveSampleBuffer>();
+  this->parallel =
+      props.sync != SamplingClockSync::GARDNER
+      && props.length >= SIGDIGGER_WAVESAMPLER_PARALLEL_MIN;
+
   // Gardner by default
   if (this->properties.sync == SamplingClockSync::GARDNER) {
 #ifdef SIGDIGGER_WAVESAMPLER_USE_MF
@@ -84,6 +151,8 @@ WaveSampler::WaveSampler(
 
 WaveSampler::~WaveSampler()
 {
+  this->slices.stop();
+
   if (this->cdInit)
     su_clock_detector_finalize(&this->cd);
 
@@ -93,77 +162,128 @@ WaveSampler::~WaveSampler()
 #endif // SIGDIGGER_WAVESAMPLER_USE_MF
 }
 
-bool
-WaveSampler::sampleManual(void)
+SUCOMPLEX
+WaveSampler::sampleSymbol(long p, SUCOMPLEX &prev) const
 {
-  long amount = static_cast<long>(this->properties.symbolCount) - this->p;
-  long p = this->p;
-
-  unsigned int q = 0;
   qreal start, end;
   SUFLOAT tStart, tEnd;
   SUFLOAT deltaInv = 1.f / SCAST(SUFLOAT, this->delta);
   qint64 iStart, iEnd;
 
   SUCOMPLEX avg;
-  SUCOMPLEX x = 0, prev = this->prevSample;
+  SUCOMPLEX x = 0;
 
-  if (amount > SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH)
-    amount = SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH;
+  start = (p - this->sampOffset) * this->delta + this->properties.symbolSync;
 
-  while (amount--) {
-    start =  (p++ - this->sampOffset) * this->delta + this->properties.symbolSync;
+  end = start + this->delta;
+  avg = 0;
 
-    end = start + this->delta;
-    avg = 0;
+  iStart = static_cast<qint64>(std::floor(start));
+  iEnd   = static_cast<qint64>(std::ceil(end));
 
-    iStart = static_cast<qint64>(std::floor(start));
-    iEnd   = static_cast<qint64>(std::ceil(end));
+  tStart = SCAST(SUFLOAT, 1 - (start - SCAST(qreal, iStart)));
+  tEnd   = SCAST(SUFLOAT, 1 - (SCAST(qreal, iEnd)  - end));
 
-    tStart = SCAST(SUFLOAT, 1 - (start - SCAST(qreal, iStart)));
-    tEnd   = SCAST(SUFLOAT, 1 - (SCAST(qreal, iEnd)  - end));
+  // Average all symbols between start and end. This is actually some
+  // terrible filtering algorithm, but it should work
 
-    // Average all symbols between start and end. This is actually some
-    // terrible filtering algorithm, but it should work
+  for (auto i = iStart; i <= iEnd; ++i) {
+    if (i >= 0 && i < SCAST(qint64, this->properties.length)) {
+      if (i == iStart)
+        x = tStart * this->properties.data[i];
+      else if (i == iEnd)
+        x = tEnd * this->properties.data[i];
+      else
+        x = this->properties.data[i];
+    } else {
+      x = 0;
+    }
 
-    for (auto i = iStart; i <= iEnd; ++i) {
-      if (i >= 0 && i < SCAST(qint64, this->properties.length)) {
-        if (i == iStart)
-          x = tStart * this->properties.data[i];
-        else if (i == iEnd)
-          x = tEnd * this->properties.data[i];
-        else
-          x = this->properties.data[i];
-      } else {
-        x = 0;
-      }
+    // Sample averaging is performed differently according to the
+    // decision space.
 
-      // Sample averaging is performed differently according to the
-      // decision space.
-
-      switch (this->properties.space) {
-        // Phase (and frequency, which is encoded in the phase): we perform
-        // an averaged weight by the modulus. This is, we just sum up samples.
-        case FREQUENCY:
-        case PHASE:
-          avg += x * SU_C_CONJ(prev);
-          break;
-
-        // Ampltude: we perform a power estimation over the symbol length and
-        // from there, deduce the amplitude (i.e. RMS)
-        case AMPLITUDE:
-          avg += x * SU_C_CONJ(x);
-      }
+    switch (this->properties.space) {
+      // Phase (and frequency, which is encoded in the phase): we perform
+      // an averaged weight by the modulus. This is, we just sum up samples.
+      case FREQUENCY:
+      case PHASE:
+        avg += x * SU_C_CONJ(prev);
+        break;
 
-      prev = x;
+      // Ampltude: we perform a power estimation over the symbol length and
+      // from there, deduce the amplitude (i.e. RMS)
+      case AMPLITUDE:
+        avg += x * SU_C_CONJ(x);
     }
 
-    if (this->properties.space == AMPLITUDE)
-      this->set.block[q++] = SU_SQRT(deltaInv * SU_C_REAL(avg));
-    else
-      this->set.block[q++] = deltaInv * avg;
+    prev = x;
   }
 
+  if (this->properties.space == AMPLITUDE)
+    return SU_SQRT(deltaInv * SU_C_REAL(avg));
+
+  return deltaInv * avg;
+}
+
+SUFLOAT
+WaveSampler::crossingThreshold(void) const
+{
+  if (this->properties.amplitude)
+    return SU_C_REAL(
+          this->properties.threshold * SU_C_CONJ(this->properties.threshold));
+
+  return SU_C_REAL(
+        this->properties.threshold * this->properties.zeroCrossingAngle);
+}
+
+SUFLOAT
+WaveSampler::crossingVariable(long p, SUFLOAT thres) const
+{
+  const SUCOMPLEX *data = this->properties.data;
+  SUCOMPLEX prev;
+  SUFLOAT var = 0;
+
+  switch (this->properties.space) {
+    case AMPLITUDE:
+      if (this->properties.amplitude)
+        var = SU_C_REAL(data[p] * SU_C_CONJ(data[p]));
+      else
+        var = SU_C_REAL(data[p] * this->properties.zeroCrossingAngle);
+
+      var -= thres;
+      break;
+
+    case PHASE:
+      var = SU_C_ARG(data[p] * this->properties.zeroCrossingAngle);
+      break;
+
+    case FREQUENCY:
+      prev = p > 0 ? data[p - 1] : 0;
+      var = SU_C_ARG(I * data[p] * SU_C_CONJ(prev));
+      break;
+  }
+
+  return var;
+}
+
+bool
+WaveSampler::sampleManual(void)
+{
+  long amount = static_cast<long>(this->properties.symbolCount) - this->p;
+  long p = this->p;
+  unsigned int q = 0;
+  SUCOMPLEX *block;
+  SUCOMPLEX prev = this->prevSample;
+
+  if (amount > SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH)
+    amount = SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH;
+
+  this->base = this->buffer->allocate(SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH);
+  block = this->buffer->block(this->base);
+
+  while (amount--)
+    block[q++] = this->sampleSymbol(p++, prev);
+
   this->prevSample = prev;
 
   this->p = p;
@@ -199,9 +319,11 @@ WaveSampler::sampleGardner(void)
       su_clock_detector_feed(&this->cd, this->properties.data[p++]);
   }
 
+  this->base = this->buffer->allocate(SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH);
+
   count = su_clock_detector_read(
         &this->cd,
-        this->set.block,
+        this->buffer->block(this->base),
         SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH);
 
   this->p = p;
@@ -219,60 +341,34 @@ WaveSampler::sampleZeroCrossing(void)
   long p = this->p;
   bool last = false;
   long i = 0;
-  SUCOMPLEX x = 0, prev = this->prevSample;
   SUFLOAT var = 0, prevVar = this->prevVar;
-  SUFLOAT thres = 0;
+  SUFLOAT thres = this->crossingThreshold();
+  SUCOMPLEX *block;
+  Symbol *symbols;
 
   if (amount > SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH)
     amount = SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH;
 
   last = p + amount >= SCAST(long, this->properties.length);
 
-  this->set.len = 0;
+  this->base = this->buffer->allocate(SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH);
+  block      = this->buffer->block(this->base);
+  symbols    = this->buffer->symbols(this->base);
 
-  if (this->properties.amplitude)
-    thres = SU_C_REAL(
-          this->properties.threshold * SU_C_CONJ(this->properties.threshold));
-  else
-    thres = SU_C_REAL(
-          this->properties.threshold * this->properties.zeroCrossingAngle);
+  this->set.len = 0;
 
   while (amount--) {
-    switch (this->properties.space) {
-      case AMPLITUDE:
-        if (this->properties.amplitude)
-          var = SU_C_REAL(
-                  this->properties.data[p]
-                * SU_C_CONJ(this->properties.data[p]));
-        else
-          var = SU_C_REAL(
-                  this->properties.data[p]
-                * this->properties.zeroCrossingAngle);
-
-        var -= thres;
-        break;
-
-      case PHASE:
-        var = SU_C_ARG(
-              this->properties.data[p] * this->properties.zeroCrossingAngle);
-        break;
-
-      case FREQUENCY:
-        x = this->properties.data[p];
-        var = SU_C_ARG(I * x * SU_C_CONJ(prev));
-        prev = x;
-        break;
-    }
+    var = this->crossingVariable(p, thres);
 
     if ((var > 0 || var < 0) || last) {
       /* Zero crossing? */
       if (var * prevVar < 0 || last) {
         long samples = p - this->lastZc;
-        long symbols = SCAST(long, round(samples * this->bnor));
+        long symbolCount = SCAST(long, round(samples * this->bnor));
 
-        while (symbols-- > 0 && i < SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH) {
-          this->set.block[i]   = var > 0;
-          this->set.symbols[i] = var > 0;
+        while (symbolCount-- > 0 && i < SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH) {
+          block[i]   = var > 0;
+          symbols[i] = var > 0;
           ++i;
         }
 
@@ -285,18 +381,249 @@ WaveSampler::sampleZeroCrossing(void)
     ++p;
   }
 
+  this->prevVar = prevVar;
   this->p = p;
   this->progress = this->p / static_cast<qreal>(this->properties.length);
 
   return this->p < static_cast<long>(this->properties.length);
 }
 
+/////////////////////////////// Parallel mode //////////////////////////////////
+//
+// Manual sync: symbol boundaries are known beforehand, so each segment of
+// symbols is sampled (and decided) on its own. Segments are whole pages
+// of the output buffer and are published in order as they complete.
+//
+// Zero crossing: segments of input samples are scanned in parallel for
+// sign changes. Each segment is scanned as if it started in a run of the
+// sign of its own first sample; the crossings found at segment heads are
+// fixed up afterwards, when expanding them into symbols in order.
+//
+void
+WaveSampler::startParallel(void)
+{
+  Suscan::TaskPool *pool = Suscan::TaskPool::shared();
+  int threads = pool != nullptr ? pool->threadCount() : 1;
+  size_t segmentLen, start;
+
+  if (this->properties.sync == SamplingClockSync::MANUAL) {
+    this->total = static_cast<size_t>(this->properties.symbolCount);
+    this->base  = this->buffer->allocate(this->total);
+    segmentLen  =
+        SIGDIGGER_WAVESAMPLER_PAGES_PER_SEGMENT
+        * SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH;
+  } else {
+    this->total = this->properties.length;
+    segmentLen  = std::max<size_t>(
+          SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH,
+          this->total / (4 * static_cast<size_t>(threads)));
+  }
+
+  for (start = 0; start < this->total; start += segmentLen) {
+    std::unique_ptr<Segment> segment(new Segment);
+
+    segment->start = start;
+    segment->end   = std::min(start + segmentLen, this->total);
+    this->segments.push_back(std::move(segment));
+  }
+
+  this->setProgressCount(0, this->total);
+  this->setStatusFormat("Demodulating (%1/%2)...");
+
+  this->slices.start(
+        static_cast<int>(this->segments.size()),
+        [this] (int index) { this->runSegment(index); });
+}
+
+void
+WaveSampler::runSegment(int index)
+{
+  Segment &segment = *this->segments[static_cast<size_t>(index)];
+
+  if (this->properties.sync == SamplingClockSync::MANUAL)
+    this->sampleManualSegment(segment);
+  else
+    this->findCrossings(segment);
+
+  this->processed.fetchAndAddRelaxed(segment.end - segment.start);
+  segment.finished.storeRelease(1);
+}
+
+void
+WaveSampler::sampleManualSegment(Segment &segment)
+{
+  SUCOMPLEX prev = 0;
+  size_t i, len;
+
+  // The previous symbol leaves its last sample behind
+  if (segment.start > 0)
+    (void) this->sampleSymbol(static_cast<long>(segment.start) - 1, prev);
+
+  for (i = segment.start; i < segment.end; ++i)
+    *this->buffer->block(this->base + i) =
+      this->sampleSymbol(static_cast<long>(i), prev);
+
+  // Segments are made of whole pages: decide page by page
+  for (i = segment.start; i < segment.end; i += len) {
+    len = std::min<size_t>(
+          segment.end - i,
+          SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH);
+
+    this->decider->decide(
+          this->buffer->block(this->base + i),
+          this->buffer->symbols(this->base + i),
+          len);
+  }
+}
+
+void
+WaveSampler::findCrossings(Segment &segment)
+{
+  SUFLOAT thres = this->crossingThreshold();
+  SUFLOAT var, prevVar = 0;
+  long p;
+
+  for (p = static_cast<long>(segment.start);
+       p < static_cast<long>(segment.end);
+       ++p) {
+    var = this->crossingVariable(p, thres);
+
+    if (var > 0 || var < 0) {
+      // The first non-zero sample is a crossing only if the previous
+      // segment ended in a run of the opposite sign. Decided later.
+      if (var * prevVar <= 0)
+        segment.crossings.push_back(std::make_pair(p, var > 0));
+
+      prevVar = var;
+    }
+  }
+}
+
+void
+WaveSampler::expandCrossings(void)
+{
+  long lastZc = 0;
+  long lastSample = static_cast<long>(this->properties.length) - 1;
+  bool lastSign;
+  bool runSign = false; // Like prevVar = -1
+  size_t count = 0;
+  size_t n = 0;
+  long symbols;
+  int pass;
+
+  lastSign = this->crossingVariable(lastSample, this->crossingThreshold()) > 0;
+
+  // First pass counts the symbols, the second one writes them
+  for (pass = 0; pass < 2; ++pass) {
+    lastZc  = 0;
+    runSign = false;
+
+    if (pass == 1)
+      this->base = this->buffer->allocate(count);
+
+    for (auto &segment : this->segments) {
+      for (auto &crossing : segment->crossings) {
+        // Only the head of a segment can repeat the current sign
+        if (crossing.second == runSign)
+          continue;
+
+        symbols = SCAST(long, round((crossing.first - lastZc) * this->bnor));
+
+        for (; symbols > 0; --symbols) {
+          if (pass == 1) {
+            *this->buffer->block(this->base + n)   = crossing.second;
+            *this->buffer->symbols(this->base + n) = crossing.second;
+            ++n;
+          } else {
+            ++count;
+          }
+        }
+
+        lastZc  = crossing.first;
+        runSign = crossing.second;
+      }
+    }
+
+    // Flush the last run
+    symbols = SCAST(long, round((lastSample - lastZc) * this->bnor));
+    for (; symbols > 0; --symbols) {
+      if (pass == 1) {
+        *this->buffer->block(this->base + n)   = lastSign;
+        *this->buffer->symbols(this->base + n) = lastSign;
+        ++n;
+      } else {
+        ++count;
+      }
+    }
+  }
+
+  this->total = count;
+}
+
+void
+WaveSampler::publish(size_t end)
+{
+  WaveSampleSet set;
+  size_t index;
+
+  set.buffer = this->buffer;
+
+  while (this->published < end) {
+    index   = this->base + this->published;
+    set.len = std::min(
+          end - this->published,
+          SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH
+          - index % SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH);
+    set.block   = this->buffer->block(index);
+    set.symbols = this->buffer->symbols(index);
+
+    emit data(set);
+
+    this->published += set.len;
+  }
+}
+
+bool
+WaveSampler::workParallel(void)
+{
+  bool finished;
+
+  if (!this->started) {
+    this->startParallel();
+    this->started = true;
+    return true;
+  }
+
+  finished = this->slices.step(SIGDIGGER_WAVESAMPLER_POLL_INTERVAL_MS);
+
+  if (this->properties.sync == SamplingClockSync::MANUAL)
+    while (this->nextPublished < this->segments.size()
+           && this->segments[this->nextPublished]->finished.loadAcquire())
+      this->publish(this->segments[this->nextPublished++]->end);
+
+  this->setProgressCount(this->processed.loadAcquire(), this->total);
+
+  if (!finished)
+    return true;
+
+  if (this->properties.sync == SamplingClockSync::ZERO_CROSSING) {
+    this->expandCrossings();
+    this->publish(this->total);
+  }
+
+  emit done();
+  return false;
+}
+
 bool
 WaveSampler::work(void)
 {
   bool more = false;
   bool decided = false;
 
+  if (this->parallel)
+    return this->workParallel();
+
   switch (this->properties.sync) {
     case MANUAL:
       more = this->sampleManual();
@@ -314,7 +641,10 @@ WaveSampler::work(void)
 
   // Perform decision, if necessary
   if (!decided)
-    this->decider->decide(this->set.block, this->set.symbols, this->set.len);
+    this->decider->decide(
+          this->buffer->block(this->base),
+          this->buffer->symbols(this->base),
+          this->set.len);
 
   this->setStatus("Demodulating ("
                   + QString::number(static_cast<int>(this->progress * 100))
@@ -323,8 +653,12 @@ WaveSampler::work(void)
   this->setProgress(this->progress);
 
   // Deliver data
-  if (this->set.len > 0)
+  if (this->set.len > 0) {
+    this->set.buffer  = this->buffer;
+    this->set.block   = this->buffer->block(this->base);
+    this->set.symbols = this->buffer->symbols(this->base);
     emit data(this->set);
+  }
 
   if (!more)
     emit done();
@@ -335,5 +669,5 @@ WaveSampler::work(void)
 void
 WaveSampler::cancel(void)
 {
-  emit cancelled();
+  this->slices.cancelOwner();
 }
@@ -23,6 +23,34 @@
 #include <util/compat-in.h>
 #include <util/compat-netdb.h>
 #include <stdexcept>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <time.h>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  define SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+#  define SIGDIGGER_HAVE_SHM_RING
+#endif // _WIN32
+
+#ifdef __linux__
+#  include <sys/uio.h>
+#  include <sys/syscall.h>
+#  include <linux/futex.h>
+#  include <netinet/udp.h>
+#  include <climits>
+#  define SIGDIGGER_HAVE_SENDMMSG
+// Older libc headers lack it, the kernel may still support it (4.18+)
+#  ifndef UDP_SEGMENT
+#    define UDP_SEGMENT 103
+#  endif // UDP_SEGMENT
+#endif // __linux__
 
 #ifndef MSG_NOSIGNAL
 #  define MSG_NOSIGNAL 0
@@ -30,6 +58,155 @@
 
 using namespace SigDigger;
 
+#ifdef SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+/////////////////////////////// SocketSendQueue ////////////////////////////////
+namespace SigDigger {
+  // Bounded queue in front of a non-blocking stream socket. Data that
+  // cannot be sent right away waits here, whole chunks (as passed to
+  // send()) at a time, until the overflow policy decides otherwise. A
+  // partially sent chunk is never dropped: the peer would lose sample
+  // alignment.
+  class SocketSendQueue {
+    std::deque<std::vector<uint8_t>> chunks;
+    size_t offset = 0; // Already sent from the front chunk
+    size_t queued = 0;
+    size_t limit;
+    SocketForwarderOverflow policy;
+    unsigned int arrivals = 0;
+    quint64 dropped = 0;
+
+    bool admit(size_t len);
+
+  public:
+    SocketSendQueue(size_t limit, SocketForwarderOverflow policy);
+
+    // These return false if the peer is gone (errno tells why)
+    bool flush(int fd);
+    bool send(int fd, const uint8_t *data, size_t len);
+
+    size_t
+    getQueued(void) const
+    {
+      return this->queued;
+    }
+
+    quint64
+    getDropped(void) const
+    {
+      return this->dropped;
+    }
+  };
+}
+
+static inline bool
+wouldBlock(void)
+{
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+SocketSendQueue::SocketSendQueue(size_t limit, SocketForwarderOverflow policy) :
+  limit(limit), policy(policy)
+{
+}
+
+bool
+SocketSendQueue::admit(size_t len)
+{
+  switch (this->policy) {
+    case SOCKET_FORWARDER_DROP_OLDEST:
+      while (this->queued + len > this->limit) {
+        size_t victim = this->offset > 0 ? 1 : 0;
+
+        if (victim >= this->chunks.size())
+          break;
+
+        this->queued  -= this->chunks[victim].size();
+        this->dropped += this->chunks[victim].size();
+        this->chunks.erase(this->chunks.begin() + static_cast<long>(victim));
+      }
+      break;
+
+    case SOCKET_FORWARDER_DECIMATE:
+      if (this->queued > this->limit / 2) {
+        if (this->arrivals++ & 1)
+          return false;
+      } else {
+        this->arrivals = 0;
+      }
+      break;
+
+    case SOCKET_FORWARDER_DROP_NEWEST:
+      break;
+  }
+
+  return this->queued + len <= this->limit;
+}
+
+bool
+SocketSendQueue::flush(int fd)
+{
+  while (!this->chunks.empty()) {
+    std::vector<uint8_t> &chunk = this->chunks.front();
+    ssize_t sent = ::send(
+          fd,
+          chunk.data() + this->offset,
+          chunk.size() - this->offset,
+          MSG_NOSIGNAL | MSG_DONTWAIT);
+
+    if (sent < 0)
+      return wouldBlock();
+
+    this->offset += static_cast<size_t>(sent);
+    this->queued -= static_cast<size_t>(sent);
+
+    if (this->offset == chunk.size()) {
+      this->offset = 0;
+      this->chunks.pop_front();
+    }
+  }
+
+  return true;
+}
+
+bool
+SocketSendQueue::send(int fd, const uint8_t *data, size_t len)
+{
+  ssize_t sent = 0;
+
+  if (!this->flush(fd))
+    return false;
+
+  // Keeping up: straight to the socket
+  if (this->chunks.empty()) {
+    sent = ::send(fd, data, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+    if (sent < 0) {
+      if (!wouldBlock())
+        return false;
+      sent = 0;
+    }
+  }
+
+  if (static_cast<size_t>(sent) == len)
+    return true;
+
+  // Partial sends only happen with an empty queue, so the rest of a
+  // partially sent chunk is always the front one
+  if (sent > 0 || this->admit(len)) {
+    if (sent > 0)
+      this->offset = static_cast<size_t>(sent);
+
+    this->queued += len - static_cast<size_t>(sent);
+    this->chunks.emplace_back(data, data + len);
+  } else {
+    this->dropped += len;
+  }
+
+  return true;
+}
+#endif // SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+
+////////////////////////////// SocketDataWriter ////////////////////////////////
 namespace SigDigger {
   class SocketDataWriter : public GenericDataWriter {
     std::string host;
@@ -39,16 +216,43 @@ namespace SigDigger {
     int fd = -1;
     bool solved = false;
     bool tcp = false;
-    char pad2[2];
+    bool header = false;
+    bool gso = false;
     unsigned int size = 0;
+    unsigned int sampleSize = sizeof(SUCOMPLEX);
+    uint32_t sequence = 0;
     std::string lastError;
+    SocketForwarderStats *stats;
+
+#ifdef SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+    // TCP only: the peer never blocks us
+    SocketSendQueue queue;
+    ssize_t sendQueued(const uint8_t *data, size_t len);
+#endif // SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+
+    // Datagrams of the batch being sent
+    std::vector<uint8_t> staging;
+    std::vector<SocketForwarderHeader> headers;
+#ifdef SIGDIGGER_HAVE_SENDMMSG
+    std::vector<struct mmsghdr> messages;
+    std::vector<struct iovec> iovecs;
+#endif // SIGDIGGER_HAVE_SENDMMSG
+
+    void fillHeaders(size_t len, unsigned int count);
+    ssize_t sendSegmented(const uint8_t *data, size_t len);
+    ssize_t sendBatch(const uint8_t *data, size_t len);
+    ssize_t sendSingle(const uint8_t *data, size_t len);
 
   public:
     SocketDataWriter(
         std::string const &host,
         uint16_t port,
         unsigned int size,
-        bool tcp);
+        bool tcp,
+        bool header,
+        unsigned int sampleSize,
+        SocketForwarderOverflow overflow,
+        SocketForwarderStats *stats);
 
     bool prepare(void) override;
     std::string getError(void) const override;
@@ -63,10 +267,28 @@ SocketDataWriter::SocketDataWriter(
     std::string const &host,
     uint16_t port,
     unsigned int size,
-    bool tcp) :
-  host(host), port(port), tcp(tcp), size(size)
+    bool tcp,
+    bool header,
+    unsigned int sampleSize,
+    SocketForwarderOverflow overflow,
+    SocketForwarderStats *stats) :
+  host(host), port(port), tcp(tcp), header(header), size(size),
+  sampleSize(sampleSize), stats(stats)
+#ifdef SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+  , queue(SIGDIGGER_UDPFORWARDER_MAX_SEND_QUEUE, overflow)
+#endif // SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
 {
-  this->pad[0] = this->pad2[0] = 0; // Shut up
+#ifndef SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+  (void) overflow;
+#endif // SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+
+  this->pad[0] = 0; // Shut up
+
+  if (this->size == 0)
+    this->size = 1;
+
+  if (this->sampleSize == 0)
+    this->sampleSize = 1;
 }
 
 bool
@@ -101,6 +323,43 @@ SocketDataWriter::prepare(void)
         this->lastError = "Cannot connect to host: " + std::string(strerror(errno));
         return false;
       }
+
+#ifdef SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+      // Connected. From now on, a slow peer fills the send queue instead
+      fcntl(this->fd, F_SETFL, fcntl(this->fd, F_GETFL) | O_NONBLOCK);
+#endif // SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+    } else {
+      if (IN_MULTICAST(ntohl(this->addr.sin_addr.s_addr))) {
+        int ttl = SIGDIGGER_UDPFORWARDER_MULTICAST_TTL;
+        int loop = 1; // Local subscribers are welcome too
+
+        setsockopt(
+              this->fd,
+              IPPROTO_IP,
+              IP_MULTICAST_TTL,
+              reinterpret_cast<const char *>(&ttl),
+              sizeof(int));
+        setsockopt(
+              this->fd,
+              IPPROTO_IP,
+              IP_MULTICAST_LOOP,
+              reinterpret_cast<const char *>(&loop),
+              sizeof(int));
+      }
+
+#ifdef SIGDIGGER_HAVE_SENDMMSG
+      // Let the kernel split the batch into datagrams, if it can
+      int segment = static_cast<int>(
+            this->size
+            + (this->header ? sizeof(SocketForwarderHeader) : 0));
+
+      this->gso = setsockopt(
+            this->fd,
+            IPPROTO_UDP,
+            UDP_SEGMENT,
+            &segment,
+            sizeof(int)) == 0;
+#endif // SIGDIGGER_HAVE_SENDMMSG
     }
     this->solved = true;
   }
@@ -120,26 +379,213 @@ SocketDataWriter::canWrite(void) const
   return !this->solved || this->fd != -1;
 }
 
+void
+SocketDataWriter::fillHeaders(size_t len, unsigned int count)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+
+  this->headers.resize(count);
+
+  for (unsigned int i = 0; i < count; ++i) {
+    size_t payload = std::min<size_t>(len - i * this->size, this->size);
+
+    this->headers[i].sequence = htonl(this->sequence++);
+    this->headers[i].samples  = htonl(
+          static_cast<uint32_t>(payload / this->sampleSize));
+    this->headers[i].tv_sec   = htonl(static_cast<uint32_t>(ts.tv_sec));
+    this->headers[i].tv_nsec  = htonl(static_cast<uint32_t>(ts.tv_nsec));
+  }
+}
+
 ssize_t
-SocketDataWriter::write(const void *data, size_t len)
+SocketDataWriter::sendSingle(const uint8_t *data, size_t len)
 {
+  const void *buf = data;
   ssize_t sent;
 
   if (len > this->size)
     len = this->size;
 
+  if (this->header && !this->tcp) {
+    this->fillHeaders(len, 1);
+    this->staging.resize(sizeof(SocketForwarderHeader) + len);
+    memcpy(this->staging.data(), this->headers.data(), sizeof(SocketForwarderHeader));
+    memcpy(this->staging.data() + sizeof(SocketForwarderHeader), data, len);
+    buf = this->staging.data();
+  }
+
   sent = sendto(
           this->fd,
-          reinterpret_cast<const char *>(data),
-          len,
+          reinterpret_cast<const char *>(buf),
+          buf == data ? len : this->staging.size(),
           MSG_NOSIGNAL,
           reinterpret_cast<struct sockaddr *>(&this->addr),
           sizeof(struct sockaddr_in));
 
-  if (sent < 1)
+  if (sent < 1) {
     this->lastError = std::string(strerror(errno));
+    return sent;
+  }
 
-  return sent;
+  return buf == data ? sent : static_cast<ssize_t>(len);
+}
+
+#ifdef SIGDIGGER_HAVE_SENDMMSG
+// UDP GSO: one syscall, one buffer, the kernel slices it into datagrams
+ssize_t
+SocketDataWriter::sendSegmented(const uint8_t *data, size_t len)
+{
+  size_t hdrSize = this->header ? sizeof(SocketForwarderHeader) : 0;
+  size_t segment = this->size + hdrSize;
+  unsigned int count = static_cast<unsigned>(
+        std::min<size_t>(
+          SIGDIGGER_UDPFORWARDER_MAX_BATCH,
+          SIGDIGGER_UDPFORWARDER_MAX_GSO_SIZE / segment));
+  const void *buf = data;
+  size_t bufLen;
+  ssize_t sent;
+
+  if (count == 0)
+    return this->sendSingle(data, len);
+
+  len     = std::min<size_t>(len, count * this->size);
+  count   = static_cast<unsigned>((len + this->size - 1) / this->size);
+  bufLen  = len;
+
+  if (this->header) {
+    this->fillHeaders(len, count);
+    this->staging.resize(len + count * hdrSize);
+
+    for (unsigned int i = 0; i < count; ++i) {
+      size_t payload = std::min<size_t>(len - i * this->size, this->size);
+      uint8_t *dest = this->staging.data() + i * segment;
+
+      memcpy(dest, &this->headers[i], hdrSize);
+      memcpy(dest + hdrSize, data + i * this->size, payload);
+    }
+
+    buf    = this->staging.data();
+    bufLen = this->staging.size();
+  }
+
+  sent = sendto(
+        this->fd,
+        buf,
+        bufLen,
+        MSG_NOSIGNAL,
+        reinterpret_cast<struct sockaddr *>(&this->addr),
+        sizeof(struct sockaddr_in));
+
+  if (sent < 0) {
+    // EIO: the NIC (or route) cannot do UDP GSO. Do it ourselves.
+    if (errno == EIO || errno == EINVAL) {
+      int zero = 0;
+      setsockopt(this->fd, IPPROTO_UDP, UDP_SEGMENT, &zero, sizeof(int));
+      this->gso = false;
+      return this->sendBatch(data, len);
+    }
+
+    this->lastError = std::string(strerror(errno));
+    return -1;
+  }
+
+  return static_cast<ssize_t>(len);
+}
+
+// One syscall, one datagram per message
+ssize_t
+SocketDataWriter::sendBatch(const uint8_t *data, size_t len)
+{
+  size_t hdrSize = sizeof(SocketForwarderHeader);
+  unsigned int count = static_cast<unsigned>(
+        std::min<size_t>(
+          SIGDIGGER_UDPFORWARDER_MAX_BATCH,
+          (len + this->size - 1) / this->size));
+  size_t consumed = 0;
+  int sent;
+
+  len = std::min<size_t>(len, count * this->size);
+
+  if (this->header)
+    this->fillHeaders(len, count);
+
+  this->messages.resize(count);
+  this->iovecs.resize(2 * count);
+
+  for (unsigned int i = 0; i < count; ++i) {
+    size_t payload = std::min<size_t>(len - i * this->size, this->size);
+    struct iovec *iov = &this->iovecs[2 * i];
+    struct msghdr *msg = &this->messages[i].msg_hdr;
+
+    memset(&this->messages[i], 0, sizeof(struct mmsghdr));
+
+    iov[0].iov_base = this->header ? &this->headers[i] : nullptr;
+    iov[0].iov_len  = this->header ? hdrSize : 0;
+    iov[1].iov_base = const_cast<uint8_t *>(data + i * this->size);
+    iov[1].iov_len  = payload;
+
+    msg->msg_name    = &this->addr;
+    msg->msg_namelen = sizeof(struct sockaddr_in);
+    msg->msg_iov     = this->header ? iov : iov + 1;
+    msg->msg_iovlen  = this->header ? 2 : 1;
+  }
+
+  sent = sendmmsg(this->fd, this->messages.data(), count, MSG_NOSIGNAL);
+
+  if (sent < 1) {
+    this->lastError = std::string(strerror(errno));
+    return -1;
+  }
+
+  // Partial batches happen when the socket buffer fills up
+  for (int i = 0; i < sent; ++i)
+    consumed += this->iovecs[2 * i + 1].iov_len;
+
+  if (this->header && static_cast<unsigned>(sent) < count)
+    this->sequence -= count - static_cast<unsigned>(sent);
+
+  return static_cast<ssize_t>(consumed);
+}
+#endif // SIGDIGGER_HAVE_SENDMMSG
+
+#ifdef SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+ssize_t
+SocketDataWriter::sendQueued(const uint8_t *data, size_t len)
+{
+  if (!this->queue.send(this->fd, data, len)) {
+    this->lastError = std::string(strerror(errno));
+    return -1;
+  }
+
+  this->stats->queued.storeRelease(this->queue.getQueued());
+  this->stats->dropped.storeRelease(this->queue.getDropped());
+
+  return static_cast<ssize_t>(len);
+}
+#endif // SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+
+ssize_t
+SocketDataWriter::write(const void *data, size_t len)
+{
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+
+#ifdef SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+  if (this->tcp)
+    return this->sendQueued(bytes, len);
+#endif // SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+
+#ifdef SIGDIGGER_HAVE_SENDMMSG
+  if (!this->tcp) {
+    if (this->gso)
+      return this->sendSegmented(bytes, len);
+
+    return this->sendBatch(bytes, len);
+  }
+#endif // SIGDIGGER_HAVE_SENDMMSG
+
+  return this->sendSingle(bytes, len);
 }
 
 bool
@@ -160,15 +606,499 @@ SocketDataWriter::~SocketDataWriter(void)
   this->close();
 }
 
+#ifdef SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+/////////////////////////////// SocketServerWriter /////////////////////////////
+namespace SigDigger {
+  // TCP server fanning the same stream out to every accepted client.
+  // Clients never block the writer, nor each other: each has its own
+  // send queue and overflow policy.
+  class SocketServerWriter : public GenericDataWriter {
+    struct Client {
+      int fd;
+      SocketSendQueue queue;
+    };
+
+    std::string host;
+    uint16_t port;
+    int fd = -1;
+    bool listening = false;
+    SocketForwarderOverflow overflow;
+    SocketForwarderStats *stats;
+    std::vector<Client> clients;
+    quint64 departed = 0; // Dropped by clients already gone
+    std::string lastError;
+
+    void acceptClients(void);
+    void publishStats(void);
+
+  public:
+    SocketServerWriter(
+        std::string const &host,
+        uint16_t port,
+        SocketForwarderOverflow overflow,
+        SocketForwarderStats *stats);
+
+    bool prepare(void) override;
+    std::string getError(void) const override;
+    bool canWrite(void) const override;
+    ssize_t write(const void *data, size_t len) override;
+    bool close(void) override;
+    ~SocketServerWriter() override;
+  };
+}
+
+SocketServerWriter::SocketServerWriter(
+    std::string const &host,
+    uint16_t port,
+    SocketForwarderOverflow overflow,
+    SocketForwarderStats *stats) :
+  host(host), port(port), overflow(overflow), stats(stats)
+{
+}
+bool
+SocketServerWriter::prepare(void)
+{
+  struct sockaddr_in addr;
+  struct hostent *ent;
+  int yes = 1;
+
+  if (this->listening)
+    return true;
+
+  memset(&addr, 0, sizeof(struct sockaddr_in));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(this->port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+  // Host is the address to listen on. Empty means all of them.
+  if (!this->host.empty()) {
+    if ((ent = gethostbyname(this->host.c_str())) == nullptr) {
+      this->lastError = "Failed to resolve hostname " + this->host;
+      return false;
+    }
+    addr.sin_addr = *reinterpret_cast<struct in_addr *>(ent->h_addr);
+  }
+
+  if ((this->fd = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
+    this->lastError = "Failed to open socket: " + std::string(strerror(errno));
+    return false;
+  }
+
+  setsockopt(this->fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int));
+
+  if (bind(
+        this->fd,
+        reinterpret_cast<struct sockaddr *>(&addr),
+        sizeof(struct sockaddr_in)) == -1
+      || listen(this->fd, SIGDIGGER_UDPFORWARDER_MAX_CLIENTS) == -1
+      || fcntl(this->fd, F_SETFL, fcntl(this->fd, F_GETFL) | O_NONBLOCK) == -1) {
+    this->lastError = "Cannot listen for clients: " + std::string(strerror(errno));
+    ::close(this->fd);
+    this->fd = -1;
+    return false;
+  }
+
+  this->listening = true;
+
+  return true;
+}
+
+void
+SocketServerWriter::acceptClients(void)
+{
+  int cfd;
+
+  while ((cfd = accept(this->fd, nullptr, nullptr)) != -1) {
+    if (this->clients.size() >= SIGDIGGER_UDPFORWARDER_MAX_CLIENTS
+        || fcntl(cfd, F_SETFL, fcntl(cfd, F_GETFL) | O_NONBLOCK) == -1) {
+      ::close(cfd);
+      continue;
+    }
+
+    this->clients.push_back(
+          Client {
+            cfd,
+            SocketSendQueue(
+              SIGDIGGER_UDPFORWARDER_MAX_SEND_QUEUE,
+              this->overflow)});
+  }
+}
+
+void
+SocketServerWriter::publishStats(void)
+{
+  quint64 dropped = this->departed;
+  quint64 queued = 0;
+
+  for (auto &client : this->clients) {
+    dropped += client.queue.getDropped();
+    queued   = std::max<quint64>(queued, client.queue.getQueued());
+  }
+
+  this->stats->queued.storeRelease(queued);
+  this->stats->dropped.storeRelease(dropped);
+}
+
+std::string
+SocketServerWriter::getError(void) const
+{
+  return this->lastError;
+}
+
+bool
+SocketServerWriter::canWrite(void) const
+{
+  return !this->listening || this->fd != -1;
+}
+
+ssize_t
+SocketServerWriter::write(const void *data, size_t len)
+{
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+
+  this->acceptClients();
+
+  for (auto it = this->clients.begin(); it != this->clients.end(); ) {
+    if (!it->queue.send(it->fd, bytes, len)) {
+      this->departed += it->queue.getDropped();
+      ::close(it->fd);
+      it = this->clients.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  this->publishStats();
+
+  // With or without clients, the data has been taken care of
+  return static_cast<ssize_t>(len);
+}
+
+bool
+SocketServerWriter::close(void)
+{
+  for (auto &client : this->clients)
+    ::close(client.fd);
+
+  this->clients.clear();
+
+  if (this->fd != -1) {
+    ::close(this->fd);
+    this->fd = -1;
+  }
+
+  return true;
+}
+
+SocketServerWriter::~SocketServerWriter(void)
+{
+  this->close();
+}
+#endif // SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+
+#ifdef SIGDIGGER_HAVE_SHM_RING
+//////////////////////////////// ShmRingWriter /////////////////////////////////
+namespace SigDigger {
+  // Local readers map the segment and read the samples where they are.
+  // The only copy is the one from the saver's slots into the ring.
+  class ShmRingWriter : public GenericDataWriter {
+    std::string name;
+    unsigned int sampleSize;
+    SocketForwarderOverflow overflow;
+    SocketForwarderStats *stats;
+    std::string lastError;
+
+    int fd = -1;
+    void *map = nullptr;
+    size_t mapSize = 0;
+    SocketForwarderShmHeader *header = nullptr;
+    uint8_t *data = nullptr;
+    uint64_t capacity = SIGDIGGER_SHM_RING_DEFAULT_SIZE;
+    quint64 dropped = 0;
+    bool skip = false;
+
+    bool fail(std::string const &what);
+    void wake(void);
+
+  public:
+    ShmRingWriter(
+        std::string const &name,
+        unsigned int sampleSize,
+        SocketForwarderOverflow overflow,
+        SocketForwarderStats *stats);
+
+    bool prepare(void) override;
+    bool canWrite(void) const override;
+    ssize_t write(const void *data, size_t len) override;
+    bool close(void) override;
+    std::string getError(void) const override;
+    ~ShmRingWriter() override;
+  };
+}
+
+ShmRingWriter::ShmRingWriter(
+    std::string const &name,
+    unsigned int sampleSize,
+    SocketForwarderOverflow overflow,
+    SocketForwarderStats *stats)
+{
+  // POSIX wants exactly one slash, at the beginning
+  this->name       = name.empty() ? "/sigdigger" : name;
+  this->sampleSize = sampleSize;
+  this->overflow   = overflow;
+  this->stats      = stats;
+
+  if (this->name[0] != '/')
+    this->name = "/" + this->name;
+}
+
+bool
+ShmRingWriter::fail(std::string const &what)
+{
+  this->lastError = what + ": " + strerror(errno);
+  this->close();
+
+  return false;
+}
+
+bool
+ShmRingWriter::prepare(void)
+{
+  if (this->map != nullptr)
+    return true;
+
+  this->fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+  // Left behind by a writer that did not stop cleanly
+  if (this->fd == -1 && errno == EEXIST) {
+    shm_unlink(this->name.c_str());
+    this->fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  }
+
+  if (this->fd == -1)
+    return this->fail("Cannot create shared memory segment " + this->name);
+
+  this->mapSize = SIGDIGGER_SHM_RING_HEADER_SIZE + this->capacity;
+
+  if (ftruncate(this->fd, static_cast<off_t>(this->mapSize)) == -1)
+    return this->fail("Cannot allocate shared memory ring");
+
+  this->map = mmap(
+        nullptr,
+        this->mapSize,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        this->fd,
+        0);
+
+  if (this->map == MAP_FAILED) {
+    this->map = nullptr;
+    return this->fail("Cannot map shared memory ring");
+  }
+
+  this->header = new (this->map) SocketForwarderShmHeader();
+  this->data   = static_cast<uint8_t *>(this->map)
+      + SIGDIGGER_SHM_RING_HEADER_SIZE;
+
+  this->header->version    = SIGDIGGER_SHM_RING_VERSION;
+  this->header->dataOffset = SIGDIGGER_SHM_RING_HEADER_SIZE;
+  this->header->sampleSize = this->sampleSize;
+  this->header->capacity   = this->capacity;
+  this->header->overwrite  =
+      this->overflow == SOCKET_FORWARDER_DROP_OLDEST ? 1 : 0;
+
+  std::atomic_thread_fence(std::memory_order_release);
+  this->header->magic = SIGDIGGER_SHM_RING_MAGIC;
+
+  return true;
+}
+
+bool
+ShmRingWriter::canWrite(void) const
+{
+  return this->header != nullptr;
+}
+
+void
+ShmRingWriter::wake(void)
+{
+  this->header->wakeSeq.fetch_add(1, std::memory_order_release);
+
+#ifdef __linux__
+  // Not FUTEX_PRIVATE_FLAG: waiters live in other processes
+  if (this->header->waiters.load(std::memory_order_acquire) > 0)
+    syscall(
+          SYS_futex,
+          reinterpret_cast<uint32_t *>(&this->header->wakeSeq),
+          FUTEX_WAKE,
+          INT_MAX,
+          nullptr,
+          nullptr,
+          0);
+#endif // __linux__
+}
+
+ssize_t
+ShmRingWriter::write(const void *data, size_t len)
+{
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  uint64_t head = this->header->head.load(std::memory_order_relaxed);
+  uint64_t used = 0;
+  bool fits = len <= this->capacity;
+
+  if (fits && !this->header->overwrite) {
+    used = head - this->header->tail.load(std::memory_order_acquire);
+
+    // A reader writing nonsense into tail cannot make us overrun it
+    if (used > this->capacity)
+      used = this->capacity;
+
+    if (this->overflow == SOCKET_FORWARDER_DECIMATE
+        && used > this->capacity / 2) {
+      this->skip = !this->skip;
+      fits = !this->skip;
+    }
+
+    if (fits)
+      fits = len <= this->capacity - used;
+  }
+
+  if (!fits) {
+    // Whole chunks only, so readers keep their sample alignment
+    this->dropped += len;
+    this->stats->dropped.storeRelease(this->dropped);
+    return static_cast<ssize_t>(len);
+  }
+
+  size_t offset = static_cast<size_t>(head & (this->capacity - 1));
+  size_t first  = std::min<size_t>(len, this->capacity - offset);
+
+  memcpy(this->data + offset, bytes, first);
+  if (first < len)
+    memcpy(this->data, bytes + first, len - first);
+
+  this->header->head.store(head + len, std::memory_order_release);
+  this->wake();
+
+  this->stats->queued.storeRelease(used + len);
+
+  return static_cast<ssize_t>(len);
+}
+
+bool
+ShmRingWriter::close(void)
+{
+  bool ok = true;
+
+  if (this->header != nullptr) {
+    this->header->closed.store(1, std::memory_order_release);
+    this->wake();
+    this->header = nullptr;
+  }
+
+  // Readers that still have it mapped keep their view of it
+  if (this->map != nullptr) {
+    ok = munmap(this->map, this->mapSize) == 0;
+    this->map = nullptr;
+    shm_unlink(this->name.c_str());
+  }
+
+  if (this->fd != -1) {
+    ::close(this->fd);
+    this->fd = -1;
+  }
+
+  return ok;
+}
+
+std::string
+ShmRingWriter::getError(void) const
+{
+  return this->lastError;
+}
+
+ShmRingWriter::~ShmRingWriter(void)
+{
+  this->close();
+}
+#endif // SIGDIGGER_HAVE_SHM_RING
+
+//////////////////////////////// SocketForwarder ///////////////////////////////
+GenericDataWriter *
+SocketForwarder::makeWriter(
+    std::string const &host,
+    uint16_t port,
+    unsigned int size,
+    SocketForwarderMode mode,
+    bool header,
+    unsigned int sampleSize,
+    SocketForwarderOverflow overflow,
+    SocketForwarderStats *stats)
+{
+#ifdef SIGDIGGER_HAVE_SHM_RING
+  if (mode == SOCKET_FORWARDER_SHM)
+    return new ShmRingWriter(host, sampleSize, overflow, stats);
+#endif // SIGDIGGER_HAVE_SHM_RING
+
+#ifdef SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+  if (mode == SOCKET_FORWARDER_TCP_SERVER)
+    return new SocketServerWriter(host, port, overflow, stats);
+#endif // SIGDIGGER_HAVE_NONBLOCKING_SOCKETS
+
+  return new SocketDataWriter(
+        host,
+        port,
+        size,
+        mode != SOCKET_FORWARDER_UDP,
+        header,
+        sampleSize,
+        overflow,
+        stats);
+}
+
 SocketForwarder::SocketForwarder(
     std::string const &host,
     uint16_t port,
     unsigned int size,
-    bool tcp,
+    SocketForwarderMode mode,
+    bool header,
+    unsigned int sampleSize,
+    SocketForwarderOverflow overflow,
     QObject *parent) :
   GenericDataSaver(
-    this->writer = new SocketDataWriter(host, port, size, tcp),
+    this->writer = makeWriter(
+      host,
+      port,
+      size,
+      mode,
+      header,
+      sampleSize,
+      overflow,
+      this->stats = new SocketForwarderStats),
     parent)
 {
+  // Not worth keeping the process alive for
+  this->tracker.set("UDP forwarder", false);
+}
+
+SocketForwarder::~SocketForwarder()
+{
+  this->finish();
+
+  if (this->writer != nullptr)
+    delete this->writer;
+
+  delete this->stats;
+}
 
+quint64
+SocketForwarder::getQueuedBytes(void) const
+{
+  return this->stats->queued.loadAcquire();
+}
+
+quint64
+SocketForwarder::getDroppedBytes(void) const
+{
+  return this->stats->dropped.loadAcquire();
 }
@@ -19,6 +19,7 @@
 #include "InspectionWidgetFactory.h"
 #include <Suscan/Library.h>
 #include <UIMediator.h>
+#include <Suscan/Analyzer.h>
 
 using namespace SigDigger;
 
@@ -89,6 +90,92 @@ InspectionWidget::samplesMessage(Suscan::SamplesMessage const &)
  // NO-OP
 }
 
+bool
+InspectionWidget::suspend()
+{
+  return false;
+}
+
+void
+InspectionWidget::resume()
+{
+  // NO-OP
+}
+
+QJsonObject
+InspectionWidget::saveSession() const
+{
+  QJsonObject params;
+  QJsonObject obj;
+
+  for (auto const &field : m_config) {
+    QString name = QString::fromStdString(field.getName());
+
+    switch (field.getType()) {
+      case SUSCAN_FIELD_TYPE_STRING:
+      case SUSCAN_FIELD_TYPE_FILE:
+        params[name] = QString::fromStdString(field.getString());
+        break;
+
+      case SUSCAN_FIELD_TYPE_INTEGER:
+        params[name] = static_cast<qint64>(field.getUint64());
+        break;
+
+      case SUSCAN_FIELD_TYPE_FLOAT:
+        params[name] = static_cast<double>(field.getFloat());
+        break;
+
+      case SUSCAN_FIELD_TYPE_BOOLEAN:
+        params[name] = field.getBoolean();
+        break;
+    }
+  }
+
+  obj["params"] = params;
+
+  return obj;
+}
+
+void
+InspectionWidget::restoreSession(QJsonObject const &obj)
+{
+  QJsonObject params = obj.value("params").toObject();
+
+  if (params.isEmpty() || m_config.getInstance() == nullptr)
+    return;
+
+  for (auto it = params.begin(); it != params.end(); ++it) {
+    std::string name = it.key().toStdString();
+    Suscan::FieldValue const *field = m_config.get(name);
+
+    // Configs of other versions of the inspector may not match
+    if (field == nullptr)
+      continue;
+
+    switch (field->getType()) {
+      case SUSCAN_FIELD_TYPE_STRING:
+      case SUSCAN_FIELD_TYPE_FILE:
+        m_config.set(name, it.value().toString().toStdString());
+        break;
+
+      case SUSCAN_FIELD_TYPE_INTEGER:
+        m_config.set(name, static_cast<uint64_t>(it.value().toDouble()));
+        break;
+
+      case SUSCAN_FIELD_TYPE_FLOAT:
+        m_config.set(name, static_cast<SUFLOAT>(it.value().toDouble()));
+        break;
+
+      case SUSCAN_FIELD_TYPE_BOOLEAN:
+        m_config.set(name, it.value().toBool());
+        break;
+    }
+  }
+
+  if (m_analyzer != nullptr)
+    m_analyzer->setInspectorConfig(m_request.handle, m_config);
+}
+
 // Overriden methods
 
 //
@@ -130,10 +217,12 @@ InspectionWidget::closeRequested()
   // Close requests are handled differently, depending on whether we are
   // attached or not.
 
-  if (m_analyzer != nullptr)
-    m_analyzer->closeInspector(m_request.handle, 0);
-  else
+  if (m_analyzer != nullptr) {
+    if (m_mediator == nullptr || !m_mediator->suspendInspectionWidget(this))
+      m_analyzer->closeInspector(m_request.handle, 0);
+  } else {
     this->deleteLater();
+  }
 }
 
 
@@ -18,6 +18,9 @@
 //
 #include "ToolWidgetFactory.h"
 #include <Suscan/Library.h>
+#include <UIMediator.h>
+#include <QVBoxLayout>
+#include <QDynamicPropertyChangeEvent>
 
 using namespace SigDigger;
 
@@ -49,3 +52,72 @@ ToolWidgetFactory::ToolWidgetFactory(Suscan::Plugin *plugin)
 {
 
 }
+
+bool
+ToolWidgetFactory::deferrable(void) const
+{
+  return false;
+}
+
+///////////////////////////// DeferredToolWidget ///////////////////////////////
+DeferredToolWidget::DeferredToolWidget(
+    ToolWidgetFactory *factory,
+    UIMediator *mediator,
+    QWidget *parent) : QWidget(parent)
+{
+  QVBoxLayout *layout = new QVBoxLayout(this);
+
+  layout->setContentsMargins(0, 0, 0, 0);
+
+  m_factory  = factory;
+  m_mediator = mediator;
+}
+
+ToolWidgetFactory *
+DeferredToolWidget::factory(void) const
+{
+  return m_factory;
+}
+
+ToolWidget *
+DeferredToolWidget::widget(void) const
+{
+  return m_widget;
+}
+
+ToolWidget *
+DeferredToolWidget::instantiate(void)
+{
+  if (m_widget == nullptr) {
+    m_widget = m_factory->make(m_mediator);
+    this->layout()->addWidget(m_widget);
+    m_mediator->adoptToolWidget(m_widget);
+
+    // The side panel talks to us, the panel state is ours by now
+    m_widget->setProperty("collapsed", this->property("collapsed"));
+  }
+
+  return m_widget;
+}
+
+bool
+DeferredToolWidget::event(QEvent *event)
+{
+  if (event->type() == QEvent::DynamicPropertyChange && m_widget != nullptr) {
+    QDynamicPropertyChangeEvent *const propEvent =
+        static_cast<QDynamicPropertyChangeEvent*>(event);
+    QString propName = propEvent->propertyName();
+    if (propName == "collapsed")
+      m_widget->setProperty("collapsed", this->property("collapsed"));
+  }
+
+  return QWidget::event(event);
+}
+
+void
+DeferredToolWidget::showEvent(QShowEvent *event)
+{
+  this->instantiate();
+
+  QWidget::showEvent(event);
+}
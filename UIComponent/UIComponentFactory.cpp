@@ -57,6 +57,12 @@ UIComponent::setTimeStamp(struct timeval const &)
   // NO-OP
 }
 
+void
+UIComponent::setSourceInfo(Suscan::AnalyzerSourceInfo const &, unsigned int)
+{
+  // NO-OP
+}
+
 UIComponent::UIComponent(UIComponentFactory *factory, UIMediator *mediator)
   : FeatureObject(factory), PersistentObject(), m_mediator(mediator)
 {
@@ -22,14 +22,21 @@
 
 using namespace SigDigger;
 
-void
-UIMediator::connectDeviceDialog(void)
+// Created the first time the device list is opened
+DeviceDialog *
+UIMediator::deviceDialog(void)
 {
-  connect(
-        this->ui->deviceDialog,
-        SIGNAL(refreshRequest(void)),
-        this,
-        SLOT(onRefreshDevices(void)));
+  if (this->ui->deviceDialog == nullptr) {
+    this->ui->deviceDialog = new DeviceDialog(this->owner);
+
+    connect(
+          this->ui->deviceDialog,
+          SIGNAL(refreshRequest(void)),
+          this,
+          SLOT(onRefreshDevices(void)));
+  }
+
+  return this->ui->deviceDialog;
 }
 
 void
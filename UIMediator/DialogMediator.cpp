@@ -0,0 +1,117 @@
+//
+//    DialogMediator.cpp: Lazy construction of the dialogs of the main window
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "UIMediator.h"
+#include <Suscan/Library.h>
+#include "ConfigDialog.h"
+#include "QuickConnectDialog.h"
+#include "BackgroundTasksDialog.h"
+#include "AddBookmarkDialog.h"
+#include "BookmarkManagerDialog.h"
+
+using namespace SigDigger;
+
+//
+// These dialogs are not needed until the user opens them. They are created
+// the first time they are, connected and brought up to date with the
+// current configuration, and kept afterwards. Code that only keeps them
+// up to date must check whether they exist first.
+//
+ConfigDialog *
+UIMediator::configDialog()
+{
+  if (this->ui->configDialog == nullptr) {
+    this->ui->configDialog = new ConfigDialog(this->owner);
+
+    this->ui->configDialog->setProfile(this->appConfig->profile);
+    this->ui->configDialog->setColors(this->appConfig->colors);
+    this->ui->configDialog->setGuiConfig(this->appConfig->guiConfig);
+    this->ui->configDialog->setTleSourceConfig(
+          this->appConfig->tleSourceConfig);
+    this->ui->configDialog->setThreadConfig(this->appConfig->threadConfig);
+  }
+
+  return this->ui->configDialog;
+}
+
+QuickConnectDialog *
+UIMediator::quickConnectDialog()
+{
+  if (this->ui->quickConnectDialog == nullptr) {
+    this->ui->quickConnectDialog = new QuickConnectDialog(this->owner);
+
+    connect(
+          this->ui->quickConnectDialog,
+          SIGNAL(accepted()),
+          this,
+          SLOT(onQuickConnectAccepted()));
+  }
+
+  return this->ui->quickConnectDialog;
+}
+
+BackgroundTasksDialog *
+UIMediator::backgroundTasksDialog()
+{
+  if (this->ui->backgroundTasksDialog == nullptr) {
+    this->ui->backgroundTasksDialog = new BackgroundTasksDialog(this->owner);
+
+    this->ui->backgroundTasksDialog->setController(
+          Suscan::Singleton::get_instance()->getBackgroundTaskController());
+  }
+
+  return this->ui->backgroundTasksDialog;
+}
+
+AddBookmarkDialog *
+UIMediator::addBookmarkDialog()
+{
+  if (this->ui->addBookmarkDialog == nullptr) {
+    this->ui->addBookmarkDialog = new AddBookmarkDialog(this->owner);
+
+    connect(
+          this->ui->addBookmarkDialog,
+          SIGNAL(accepted()),
+          this,
+          SLOT(onBookmarkAccepted()));
+  }
+
+  return this->ui->addBookmarkDialog;
+}
+
+BookmarkManagerDialog *
+UIMediator::bookmarkManagerDialog()
+{
+  if (this->ui->bookmarkManagerDialog == nullptr) {
+    this->ui->bookmarkManagerDialog = new BookmarkManagerDialog(this->owner);
+
+    connect(
+          this->ui->bookmarkManagerDialog,
+          SIGNAL(bookmarkSelected(BookmarkInfo)),
+          this,
+          SLOT(onJumpToBookmark(BookmarkInfo)));
+
+    connect(
+          this->ui->bookmarkManagerDialog,
+          SIGNAL(bookmarkChanged()),
+          this,
+          SLOT(onBookmarkChanged()));
+  }
+
+  return this->ui->bookmarkManagerDialog;
+}
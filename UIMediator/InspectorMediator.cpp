@@ -48,6 +48,12 @@ UIMediator::connectRequestTracker()
         SIGNAL(error(Suscan::AnalyzerRequest const &, const std::string &)),
         this,
         SLOT(onError(Suscan::AnalyzerRequest const &, const std::string &)));
+
+  connect(
+        this->m_requestTracker,
+        SIGNAL(batchFinished(uint32_t, int, int)),
+        this,
+        SLOT(onBatchFinished(uint32_t, int, int)));
 }
 
 void
@@ -58,12 +64,6 @@ UIMediator::connectAnalyzer()
         SIGNAL(inspector_message(const Suscan::InspectorMessage &)),
         this,
         SLOT(onInspectorMessage(const Suscan::InspectorMessage &)));
-
-  connect(
-        m_analyzer,
-        SIGNAL(samples_message(const Suscan::SamplesMessage &)),
-        this,
-        SLOT(onInspectorSamples(const Suscan::SamplesMessage &)));
 }
 
 void
@@ -76,8 +76,148 @@ UIMediator::detachAllInspectors()
   for (auto p : m_inspectors)
     p->setState(UIMediator::HALTED, nullptr);
 
+  // Nobody can see suspended ones, and they cannot be resumed anymore
+  for (auto p : m_suspendedInspectors)
+    p->deleteLater();
+
+  m_inspectors.clear();
+  m_inspTable.clear();
+  m_suspendedInspectors.clear();
+}
+
+//
+// Restarting the analyzer invalidates all inspector handles. The requests
+// of the top-level inspectors are kept to open them again in the new
+// analyzer, and the old tabs stay (detached) until that happens. They no
+// longer belong to the inspector table, as their ids could be reused.
+//
+void
+UIMediator::saveInspectorsForRestart()
+{
+  for (auto p : m_inspectors) {
+    Suscan::AnalyzerRequest const &req = p->request();
+    SessionInspector insp;
+
+    if (m_suspendedInspectors.contains(p))
+      continue;
+
+    if (this->makeSessionInspector(p, insp)) {
+      m_reopenRequests.push_back(insp);
+      m_restartedInspectors.push_back(p);
+    }
+
+    if (m_analyzer != nullptr)
+      m_analyzer->unregisterSamplesRoute(req.inspectorId);
+  }
+
+  for (auto p : m_suspendedInspectors)
+    p->deleteLater();
+
   m_inspectors.clear();
   m_inspTable.clear();
+  m_suspendedInspectors.clear();
+}
+
+//
+// Old tabs are queued as session inspectors, with the state they have
+// now, and openSessionInspectors() opens them all in a single batch.
+//
+void
+UIMediator::reopenInspectors()
+{
+  // Tabs closed by the user in the meantime are not brought back
+  for (int i = 0; i < m_reopenRequests.size(); ++i) {
+    InspectionWidget *widget = m_restartedInspectors[i];
+
+    if (widget != nullptr) {
+      SessionInspector insp = m_reopenRequests[i];
+
+      insp.state = widget->saveSession();
+      m_sessionInspectors.push_back(insp);
+      widget->deleteLater();
+    }
+  }
+
+  m_reopenRequests.clear();
+  m_restartedInspectors.clear();
+}
+
+void
+UIMediator::routeInspectorSamples(InspectionWidget *widget)
+{
+  // Samples of this inspector go straight to the widget
+  if (m_analyzer != nullptr)
+    m_analyzer->registerSamplesRoute(
+          widget->request().inspectorId,
+          widget,
+          [widget] (Suscan::SamplesMessage const &msg) {
+            widget->samplesMessage(msg);
+          });
+}
+
+InspectionWidget *
+UIMediator::findSuspendedInspector(
+    const char *factoryName,
+    const char *inspClass,
+    Suscan::Channel const &channel,
+    Suscan::Handle parent) const
+{
+  for (auto p : m_suspendedInspectors) {
+    Suscan::AnalyzerRequest const &req = p->request();
+
+    if (req.data.value<QString>() == factoryName
+        && req.inspClass == inspClass
+        && req.parent == parent
+        && fabs(req.channel.fc - channel.fc) < 1
+        && fabs(
+          (req.channel.fHigh - req.channel.fLow)
+          - (channel.fHigh - channel.fLow)) < 1)
+      return p;
+  }
+
+  return nullptr;
+}
+
+bool
+UIMediator::suspendInspectionWidget(InspectionWidget *widget)
+{
+  if (m_analyzer == nullptr || !widget->suspend())
+    return false;
+
+  m_analyzer->unregisterSamplesRoute(widget->request().inspectorId);
+  this->closeTabWidget(widget);
+  m_suspendedInspectors.append(widget);
+
+  // Really close the oldest ones. Their CLOSE reply deletes them.
+  while (m_suspendedInspectors.size()
+         > SIGDIGGER_UI_MEDIATOR_MAX_SUSPENDED_INSPECTORS) {
+    InspectionWidget *oldest = m_suspendedInspectors.takeFirst();
+    m_analyzer->closeInspector(oldest->request().handle, 0);
+  }
+
+  return true;
+}
+
+void
+UIMediator::resumeInspectionWidget(InspectionWidget *widget)
+{
+  int index;
+
+  m_suspendedInspectors.removeAll(widget);
+
+  widget->resume();
+  this->routeInspectorSamples(widget);
+
+  // Not addTabWidget(): the widget keeps its configuration and state
+  m_tabWidgets.push_back(widget);
+
+  index = this->ui->main->mainTab->insertTab(
+        this->ui->main->mainTab->count(),
+        widget,
+        QString::fromStdString(widget->getLabel()));
+
+  widget->setTimeStamp(m_lastTimeStamp);
+  this->ui->main->mainTab->setCurrentIndex(index);
 }
 
 bool
@@ -85,7 +225,7 @@ UIMediator::openInspectorTab(
     const char *factoryName,
     const char *inspClass,
     Suscan::Channel channel,
-    bool precise,
+    Suscan::ChannelPrecision precision,
     Suscan::Handle handle)
 {
   Suscan::Singleton *s = Suscan::Singleton::get_instance();
@@ -104,12 +244,21 @@ UIMediator::openInspectorTab(
     return false;
   }
 
+  // Same inspector closed a moment ago: just bring it back
+  InspectionWidget *suspended =
+      this->findSuspendedInspector(factoryName, inspClass, channel, handle);
+
+  if (suspended != nullptr) {
+    this->resumeInspectionWidget(suspended);
+    return true;
+  }
+
   // And the opening procedure must succeed
   return m_requestTracker->requestOpen(
         inspClass,
         channel,
         QVariant::fromValue<QString>(factoryName),
-        precise,
+        precision,
         handle);
 }
 
@@ -118,11 +267,29 @@ UIMediator::detachInspectionWidget(InspectionWidget *widget)
 {
   Suscan::InspectorId id = widget->request().inspectorId;
 
-  if (m_inspTable.contains(id) && m_inspTable[id] == widget)
+  if (m_inspTable.contains(id) && m_inspTable[id] == widget) {
     m_inspTable.remove(id);
 
+    if (m_analyzer != nullptr)
+      m_analyzer->unregisterSamplesRoute(id);
+  }
+
   if (m_inspectors.contains(widget))
     m_inspectors.removeAt(m_inspectors.indexOf(widget));
+
+  m_suspendedInspectors.removeAll(widget);
+}
+
+QList<InspectionWidget *>
+UIMediator::inspectionWidgets() const
+{
+  QList<InspectionWidget *> list;
+
+  for (auto p : m_inspectors)
+    if (!m_suspendedInspectors.contains(p))
+      list.push_back(p);
+
+  return list;
 }
 
 SUFREQ
@@ -145,15 +312,6 @@ UIMediator::onInspectorMessage(Suscan::InspectorMessage const &msg)
   }
 }
 
-void
-UIMediator::onInspectorSamples(Suscan::SamplesMessage const &msg)
-{
-  if (m_inspTable.contains(msg.getInspectorId())) {
-    InspectionWidget *widget = m_inspTable[msg.getInspectorId()];
-    widget->samplesMessage(msg);
-  }
-}
-
 void
 UIMediator::onOpened(Suscan::AnalyzerRequest const &request)
 {
@@ -171,11 +329,22 @@ UIMediator::onOpened(Suscan::AnalyzerRequest const &request)
       m_analyzer->closeInspector(request.handle);
   } else {
     InspectionWidget *widget = factory->make(request, this);
+    bool restored = request.batchId != 0 && request.batchId == m_sessionBatch;
 
     m_inspectors.push_back(widget);
     m_inspTable[request.inspectorId] = widget;
 
-    this->addTabWidget(widget);
+    this->routeInspectorSamples(widget);
+
+    // Only the first inspector of a session is brought to the front. The
+    // panels of the others are not laid out until their tabs are shown.
+    if (restored) {
+      this->addTabWidget(widget, !m_sessionFocused);
+      m_sessionFocused = true;
+      this->restoreSessionInspector(widget);
+    } else {
+      this->addTabWidget(widget);
+    }
   }
 }
 
@@ -188,6 +357,15 @@ UIMediator::onCancelled(Suscan::AnalyzerRequest const &)
 void
 UIMediator::onError(Suscan::AnalyzerRequest const &r, std::string const &error)
 {
+  // Batched requests are reported all at once, in onBatchFinished()
+  if (r.batchId != 0) {
+    SU_WARNING(
+          "Failed to open inspector (class %s): %s\n",
+          r.inspClass.c_str(),
+          error.c_str());
+    return;
+  }
+
   QMessageBox::critical(
         this,
         "Cannot open inspector",
@@ -195,3 +373,22 @@ UIMediator::onError(Suscan::AnalyzerRequest const &r, std::string const &error)
         + QString::fromStdString(r.inspClass)
         + "). " + QString::fromStdString(error));
 }
+
+void
+UIMediator::onBatchFinished(uint32_t batchId, int opened, int failed)
+{
+  // Whatever is left did not open
+  if (batchId == m_sessionBatch) {
+    m_sessionRestores.clear();
+    m_sessionBatch = 0;
+  }
+
+  if (failed > 0)
+    this->setStatusMessage(
+          QString::asprintf(
+            "Opened %d inspectors (%d could not be opened)",
+            opened,
+            failed));
+  else
+    this->setStatusMessage(QString::asprintf("Opened %d inspectors", opened));
+}
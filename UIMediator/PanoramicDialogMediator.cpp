@@ -28,6 +28,12 @@ UIMediator::getPanSpectrumDevice(Suscan::Source::Device &dev) const
   return this->ui->panoramicDialog->getSelectedDevice(dev);
 }
 
+std::vector<Suscan::Source::Device>
+UIMediator::getPanSpectrumExtraDevices(void) const
+{
+  return this->ui->panoramicDialog->getExtraDevices();
+}
+
 bool
 UIMediator::getPanSpectrumRange(qint64 &min, qint64 &max) const
 {
@@ -46,12 +52,24 @@ UIMediator::getPanSpectrumRttMs(void) const
   return this->ui->panoramicDialog->getRttMs();
 }
 
+unsigned int
+UIMediator::getPanSpectrumSettleMs(Suscan::Source::Device const &dev) const
+{
+  return PanoramicDialog::preferredSettleMs(dev);
+}
+
 float
 UIMediator::getPanSpectrumRelBw(void) const
 {
   return this->ui->panoramicDialog->getRelBw();
 }
 
+unsigned int
+UIMediator::getPanSpectrumResolution(void) const
+{
+  return this->ui->panoramicDialog->getResolution();
+}
+
 float
 UIMediator::getPanSpectrumGain(QString const &name) const
 {
@@ -82,6 +100,24 @@ UIMediator::getPanSpectrumPartition(void) const
   return this->ui->panoramicDialog->getPartitioning();
 }
 
+QString
+UIMediator::getPanSpectrumRelayMode(void) const
+{
+  return this->ui->panoramicDialog->getRelayMode();
+}
+
+QString
+UIMediator::getPanSpectrumRelayHost(void) const
+{
+  return this->ui->panoramicDialog->getRelayHost();
+}
+
+quint16
+UIMediator::getPanSpectrumRelayPort(void) const
+{
+  return this->ui->panoramicDialog->getRelayPort();
+}
+
 void
 UIMediator::setMinPanSpectrumBw(quint64 bw)
 {
@@ -92,10 +128,18 @@ void
 UIMediator::feedPanSpectrum(
     quint64 minFreq,
     quint64 maxFreq,
-    float *data,
-    size_t size)
-{
-  this->ui->panoramicDialog->feed(minFreq, maxFreq, data, size);
+    const float *data,
+    size_t size,
+    size_t dirtyStart,
+    size_t dirtyEnd)
+{
+  this->ui->panoramicDialog->feed(
+        minFreq,
+        maxFreq,
+        data,
+        size,
+        dirtyStart,
+        dirtyEnd);
 }
 
 void
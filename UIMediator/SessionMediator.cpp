@@ -0,0 +1,265 @@
+//
+//    SessionMediator.cpp: Save and restore workspace sessions
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#include "UIMediator.h"
+#include <Suscan/Library.h>
+#include <InspectionWidgetFactory.h>
+#include "ui_MainWindow.h"
+#include "MainSpectrum.h"
+
+#include <QFileDialog>
+#include <QMessageBox>
+#include <cmath>
+
+using namespace SigDigger;
+
+bool
+UIMediator::saveSession(QString const &path, QString &error)
+{
+  SessionSnapshot snapshot;
+  SUFREQ center = this->getCurrentCenterFreq();
+
+  try {
+    Suscan::Object envelope(SUSCAN_OBJECT_TYPE_SET);
+
+    envelope.append(this->getProfile()->serialize());
+
+    std::vector<char> data = envelope.serialize();
+    snapshot.source = QString::fromUtf8(
+          data.data(),
+          static_cast<int>(data.size()));
+  } catch (Suscan::Exception &e) {
+    error = "Serialization of profile data failed: " + QString(e.what());
+    return false;
+  }
+
+  snapshot.profileName   = this->appConfig->profile.label();
+  snapshot.frequency     = center;
+  snapshot.haveFrequency = true;
+  snapshot.geometry      = this->owner->saveGeometry();
+  snapshot.windowState   = this->owner->saveState();
+
+  for (auto widget : this->inspectionWidgets()) {
+    SessionInspector insp;
+
+    if (this->makeSessionInspector(widget, insp))
+      snapshot.inspectors.push_back(insp);
+  }
+
+  return snapshot.save(path, error);
+}
+
+bool
+UIMediator::makeSessionInspector(
+    InspectionWidget *widget,
+    SessionInspector &insp) const
+{
+  Suscan::AnalyzerRequest const &req = widget->request();
+
+  // Subinspectors belong to their parents and are not saved
+  if (req.parent != -1)
+    return false;
+
+  insp.factory = req.data.value<QString>().toStdString();
+  if (insp.factory.empty())
+    return false;
+
+  insp.inspClass = req.inspClass;
+  insp.frequency = this->getCurrentCenterFreq() + req.channel.fc;
+  insp.bandwidth = req.channel.fHigh - req.channel.fLow;
+  insp.precise   = req.precise;
+  insp.state     = widget->saveSession();
+
+  return true;
+}
+
+bool
+UIMediator::loadSession(QString const &path, QString &error)
+{
+  SessionSnapshot snapshot;
+  Suscan::Singleton *sing = Suscan::Singleton::get_instance();
+
+  if (!snapshot.load(path, error))
+    return false;
+
+  // The full profile is preferred: the one by that name may have changed
+  if (!snapshot.source.isEmpty()) {
+    QByteArray data = snapshot.source.toUtf8();
+
+    try {
+      Suscan::Object envelope(
+            path.toStdString(),
+            reinterpret_cast<const uint8_t *>(data.data()),
+            static_cast<size_t>(data.size()));
+      Suscan::Source::Config config(envelope[0]);
+
+      if (snapshot.haveFrequency)
+        config.setFreq(snapshot.frequency);
+
+      this->setProfile(config);
+    } catch (Suscan::Exception &e) {
+      error = "Failed to load the profile of the session: "
+          + QString(e.what());
+      return false;
+    }
+  } else {
+    Suscan::Source::Config *profile = sing->getProfile(snapshot.profileName);
+
+    if (profile == nullptr) {
+      error = "Session refers to an unknown profile ("
+          + QString::fromStdString(snapshot.profileName) + ")";
+      return false;
+    }
+
+    Suscan::Source::Config config = *profile;
+
+    if (snapshot.haveFrequency)
+      config.setFreq(snapshot.frequency);
+
+    this->setProfile(config);
+  }
+
+  if (!snapshot.geometry.isEmpty())
+    this->owner->restoreGeometry(snapshot.geometry);
+
+  if (!snapshot.windowState.isEmpty())
+    this->owner->restoreState(snapshot.windowState);
+
+  // A profile that needs a restart has already taken us out of RUNNING.
+  // Otherwise, inspectors are opened now.
+  m_sessionInspectors = snapshot.inspectors;
+  m_sessionRestores.clear();
+
+  if (m_state == RUNNING && m_analyzer != nullptr)
+    this->openSessionInspectors();
+
+  return true;
+}
+
+void
+UIMediator::openSessionInspectors()
+{
+  SUFREQ center = this->getCurrentCenterFreq();
+
+  if (m_sessionInspectors.isEmpty())
+    return;
+
+  // All of them go in the same batch, so they are pipelined
+  m_sessionBatch   = m_requestTracker->beginBatch();
+  m_sessionFocused = false;
+
+  for (auto const &insp : m_sessionInspectors) {
+    Suscan::Channel ch;
+
+    ch.bw    = insp.bandwidth;
+    ch.ft    = 0;
+    ch.fc    = insp.frequency - center;
+    ch.fLow  = -.5 * insp.bandwidth;
+    ch.fHigh = +.5 * insp.bandwidth;
+
+    m_requestTracker->requestOpen(
+          insp.inspClass,
+          ch,
+          QVariant::fromValue<QString>(QString::fromStdString(insp.factory)),
+          insp.precise,
+          -1);
+  }
+
+  m_requestTracker->endBatch();
+
+  m_sessionRestores = m_sessionInspectors;
+  m_sessionInspectors.clear();
+}
+
+bool
+UIMediator::restoreSessionInspector(InspectionWidget *widget)
+{
+  Suscan::AnalyzerRequest const &req = widget->request();
+  std::string factory = req.data.value<QString>().toStdString();
+  SUFREQ freq = this->getCurrentCenterFreq() + req.channel.fc;
+  SUFREQ bestDist = 0;
+  int best = -1;
+
+  // Channels may have been snapped to the grid: pick the closest one
+  for (int i = 0; i < m_sessionRestores.size(); ++i) {
+    SessionInspector const &insp = m_sessionRestores[i];
+    SUFREQ dist = std::fabs(insp.frequency - freq);
+
+    if (insp.factory != factory || insp.inspClass != req.inspClass)
+      continue;
+
+    if (dist > .5 * insp.bandwidth)
+      continue;
+
+    if (best == -1 || dist < bestDist) {
+      best     = i;
+      bestDist = dist;
+    }
+  }
+
+  if (best == -1)
+    return false;
+
+  widget->restoreSession(m_sessionRestores[best].state);
+  m_sessionRestores.removeAt(best);
+
+  return true;
+}
+
+void
+UIMediator::onTriggerSaveSession(bool)
+{
+  QString error;
+  QString path = QFileDialog::getSaveFileName(
+        this,
+        "Save session",
+        QString(),
+        "SigDigger session files (*.json)");
+
+  if (path.isEmpty())
+    return;
+
+  if (!this->saveSession(path, error))
+    QMessageBox::critical(
+          this->ui->main->centralWidget,
+          "Cannot save session",
+          error,
+          QMessageBox::Ok);
+}
+
+void
+UIMediator::onTriggerLoadSession(bool)
+{
+  QString error;
+  QString path = QFileDialog::getOpenFileName(
+        this,
+        "Load session",
+        QString(),
+        "SigDigger session files (*.json)");
+
+  if (path.isEmpty())
+    return;
+
+  if (!this->loadSession(path, error))
+    QMessageBox::critical(
+          this->ui->main->centralWidget,
+          "Cannot load session",
+          error,
+          QMessageBox::Ok);
+}
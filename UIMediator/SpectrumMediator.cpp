@@ -22,19 +22,48 @@
 #include "MainSpectrum.h"
 #include <InspectionWidgetFactory.h>
 #include <SuWidgetsHelpers.h>
+#include <RenderScheduler.h>
+#include <Tracer.h>
 
 using namespace SigDigger;
 
 void
 UIMediator::feedPSD(const Suscan::PSDMessage &msg)
 {
+  SIGDIGGER_TRACE_SCOPE("UIMediator::feedPSD");
   bool expired = false;
+  bool lagging = false;
+
+  // Statistics cover every PSD, including those the GUI drops below
+  if (this->occupancy.isOpen() && !this->occupancy.feed(msg))
+    SU_WARNING(
+          "Occupancy: %s\n",
+          this->occupancy.getStore().getError().c_str());
+
+  // In batch replay, spectra arrive as fast as the file is read: the
+  // arrival rate says nothing about GUI lag, and most of them are dropped.
+  if (RenderScheduler::instance()->isBatchMode()) {
+    this->setSampleRate(msg.getSampleRate());
+
+    if (RenderScheduler::instance()->acceptData(this->ui->spectrum)) {
+      this->averager.feed(msg);
+      this->ui->spectrum->feed(
+            this->averager.getTraceData(),
+            static_cast<int>(this->averager.size()),
+            msg.getTimeStamp(),
+            msg.hasLooped());
+    }
+
+    return;
+  }
 
   if (this->appConfig->guiConfig.enableMsgTTL) {
     qreal delta;
     qreal psdDelta;
     qreal prevDelta;
-    qreal interval = this->appConfig->analyzerParams.psdUpdateInterval;
+    qreal interval = this->governorSteps > 0
+        ? this->governorInterval
+        : this->appConfig->analyzerParams.psdUpdateInterval;
     qreal selRate = 1. / interval;
     struct timeval now, rttime, diff;
     qreal max_delta;
@@ -78,6 +107,9 @@ UIMediator::feedPSD(const Suscan::PSDMessage &msg)
       /* Subtract the intrinsic time delta */
       delta -= this->rtDeltaReal;
       expired = delta > max_delta;
+      lagging = expired
+          || (this->psdDelta - interval) / interval
+             > SIGDIGGER_UI_MEDIATOR_PSD_MAX_LAG;
 
       if (this->appConfig->profile.isRemote()
           && fabs(this->psdAdj / interval)
@@ -108,18 +140,202 @@ UIMediator::feedPSD(const Suscan::PSDMessage &msg)
     }
   }
 
+  this->governPSD(lagging);
+
   this->setSampleRate(msg.getSampleRate());
 
   if (!expired) {
     this->averager.feed(msg);
     this->ui->spectrum->feed(
-          this->averager.get(),
+          this->averager.getTraceData(),
           static_cast<int>(this->averager.size()),
           msg.getTimeStamp(),
           msg.hasLooped());
   }
 }
 
+/////////////////////////////// PSD governor /////////////////////////////////
+bool
+UIMediator::governedParams(
+    unsigned int steps,
+    Suscan::AnalyzerParams &params) const
+{
+  qreal maxInterval = 1. / SIGDIGGER_UI_MEDIATOR_GOVERNOR_MIN_RATE;
+
+  params = this->appConfig->analyzerParams;
+  this->adjustRemoteParams(params);
+
+  // Halve the spectrum rate first, and the FFT size once the rate
+  // cannot be lowered any further.
+  while (steps-- > 0) {
+    if (2 * params.psdUpdateInterval <= maxInterval)
+      params.psdUpdateInterval *= 2;
+    else if (params.windowSize / 2 >= SIGDIGGER_UI_MEDIATOR_GOVERNOR_MIN_FFT_SIZE)
+      params.windowSize /= 2;
+    else
+      return false;
+  }
+
+  return true;
+}
+
+// Remote analyzers send every PSD bin over the network. Do not ask them
+// for more than the main spectrum can show at its current width and zoom.
+void
+UIMediator::adjustRemoteParams(Suscan::AnalyzerParams &params) const
+{
+  unsigned int size;
+
+  if (!this->appConfig->profile.isRemote()
+      || !this->appConfig->guiConfig.matchRemotePsdSize)
+    return;
+
+  size = this->ui->spectrum->getDisplayFftSize(params.windowSize);
+
+  while (size < params.windowSize
+         && size < SIGDIGGER_UI_MEDIATOR_REMOTE_MIN_FFT_SIZE)
+    size <<= 1;
+
+  params.windowSize = size;
+}
+
+void
+UIMediator::setRequestedParams(Suscan::AnalyzerParams const &params)
+{
+  this->requestedSize     = params.windowSize;
+  this->requestedInterval = params.psdUpdateInterval;
+}
+
+Suscan::AnalyzerParams
+UIMediator::effectiveParams() const
+{
+  Suscan::AnalyzerParams params;
+
+  if (!this->governedParams(this->governorSteps, params)) {
+    params = this->appConfig->analyzerParams;
+    this->adjustRemoteParams(params);
+  }
+
+  return params;
+}
+
+Suscan::AnalyzerParams
+UIMediator::requestAnalyzerParams()
+{
+  Suscan::AnalyzerParams params = this->effectiveParams();
+
+  this->setRequestedParams(params);
+
+  return params;
+}
+
+// The main spectrum was resized or zoomed, or the settings behind the
+// requested parameters changed. Send them again if they differ.
+void
+UIMediator::refreshRequestedParams()
+{
+  Suscan::AnalyzerParams params = this->effectiveParams();
+
+  if (params.windowSize == this->requestedSize
+      && sufeq(params.psdUpdateInterval, this->requestedInterval, 1e-6))
+    return;
+
+  try {
+    m_analyzer->setParams(params);
+  } catch (Suscan::Exception const &) {
+    return;
+  }
+
+  this->setRequestedParams(params);
+}
+
+void
+UIMediator::applyGovernorSteps(unsigned int steps)
+{
+  Suscan::AnalyzerParams params;
+
+  if (m_analyzer == nullptr || !this->governedParams(steps, params))
+    return;
+
+  try {
+    m_analyzer->setParams(params);
+  } catch (Suscan::Exception const &) {
+    return;
+  }
+
+  this->setRequestedParams(params);
+
+  this->governorSteps    = steps;
+  this->governorInterval = params.psdUpdateInterval;
+  this->governorLagging  = 0;
+  this->governorHealthy  = 0;
+
+  // The PSD arrival rate has changed, measure it again
+  this->rtCalibrations = 0;
+  this->haveRtDelta    = false;
+
+  if (steps > 0)
+    this->setStatusMessage(
+          QString::asprintf(
+            "GUI is lagging behind: spectrum reduced to %g fps, %u bins",
+            1. / params.psdUpdateInterval,
+            params.windowSize));
+  else
+    this->setStatusMessage("Spectrum settings restored");
+}
+
+void
+UIMediator::resetGovernor()
+{
+  this->governorSteps        = 0;
+  this->governorLagging      = 0;
+  this->governorHealthy      = 0;
+  this->governorBaseInterval =
+      this->appConfig->analyzerParams.psdUpdateInterval;
+  this->governorBaseSize     = this->appConfig->analyzerParams.windowSize;
+}
+
+void
+UIMediator::governPSD(bool lagging)
+{
+  Suscan::AnalyzerParams const &user = this->appConfig->analyzerParams;
+  qreal rate;
+
+  if (m_analyzer == nullptr)
+    return;
+
+  // Spectrum settings changed by the user. These have already been sent
+  // to the analyzer, so we start over from them.
+  if (!sufeq(user.psdUpdateInterval, this->governorBaseInterval, 1e-6)
+      || user.windowSize != this->governorBaseSize)
+    this->resetGovernor();
+
+  this->refreshRequestedParams();
+
+  if (!this->appConfig->guiConfig.enablePsdGovernor) {
+    if (this->governorSteps > 0)
+      this->applyGovernorSteps(0);
+    return;
+  }
+
+  rate = 1. / (this->governorSteps > 0
+      ? this->governorInterval
+      : user.psdUpdateInterval);
+
+  if (lagging) {
+    this->governorHealthy = 0;
+    if (++this->governorLagging
+        >= SIGDIGGER_UI_MEDIATOR_GOVERNOR_DEGRADE_SECS * rate)
+      this->applyGovernorSteps(this->governorSteps + 1);
+  } else {
+    this->governorLagging = 0;
+    if (this->governorSteps > 0
+        && ++this->governorHealthy
+        >= SIGDIGGER_UI_MEDIATOR_GOVERNOR_RESTORE_SECS * rate)
+      this->applyGovernorSteps(this->governorSteps - 1);
+  }
+}
+
 void
 UIMediator::connectSpectrum(void)
 {
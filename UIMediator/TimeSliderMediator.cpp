@@ -19,6 +19,10 @@
 
 #include "UIMediator.h"
 #include <QTimeSlider.h>
+#include <MainSpectrum.h>
+#include <RecordingOverviewTask.h>
+#include <Suscan/Library.h>
+#include <QFileInfo>
 
 using namespace SigDigger;
 
@@ -41,19 +45,108 @@ UIMediator::setTimeStamp(struct timeval const &tv)
   this->ui->timeSlider->setTimeStamp(tv);
 }
 
+void
+UIMediator::refreshOverview(void)
+{
+  Suscan::Source::Config *profile = this->getProfile();
+  QString path;
+
+  if (!profile->isRemote()
+      && profile->getType() == SUSCAN_SOURCE_TYPE_FILE
+      && profile->fileIsValid())
+    path = QString::fromStdString(profile->getPath());
+
+  if (path == m_overviewPath)
+    return;
+
+  // Nobody is going to look at the old one
+  if (m_overviewTask != nullptr)
+    m_overviewTask->requestCancel();
+
+  m_overviewPath = path;
+  this->ui->timeSlider->clearOverview();
+
+  if (!path.isEmpty()) {
+    Suscan::MultitaskController *mt =
+        Suscan::Singleton::get_instance()->getBackgroundTaskController();
+    RecordingOverviewTask *task =
+        new RecordingOverviewTask(path, profile->getFormat());
+
+    connect(
+          task,
+          SIGNAL(ready(QString, QVector<float>, int, int)),
+          this,
+          SLOT(onOverviewReady(QString, QVector<float>, int, int)));
+
+    m_overviewTask = task;
+
+    mt->pushTask(task, "Recording overview of " + QFileInfo(path).fileName());
+  }
+}
+
 void
 UIMediator::connectTimeSlider(void)
 {
+  m_seekTimer.setSingleShot(true);
+  m_seekTimer.setInterval(SIGDIGGER_UI_MEDIATOR_SEEK_DEBOUNCE_MS);
+
   connect(
         this->ui->timeSlider,
         SIGNAL(valueChanged(int)),
         this,
         SLOT(onTimeStampChanged(void)));
+
+  connect(
+        this->ui->timeSlider,
+        SIGNAL(sliderReleased(void)),
+        this,
+        SLOT(onTimeSliderReleased(void)));
+
+  connect(
+        &m_seekTimer,
+        SIGNAL(timeout(void)),
+        this,
+        SLOT(onSeekTimeout(void)));
 }
 
 void
 UIMediator::onTimeStampChanged(void)
 {
-  emit seek(this->ui->timeSlider->getTimeStamp());
+  // Dragging the slider produces lots of these. Every seek is a trip to
+  // the analyzer (and, for files, to the disk), so only the last position
+  // is sent, once the slider has been still for a while. In the meantime,
+  // the waterfall history gives a cheap preview of the target.
+  m_pendingSeekTimeStamp = this->ui->timeSlider->getTimeStamp();
+
+  if (this->ui->timeSlider->isSliderDown())
+    this->ui->spectrum->previewTimeStamp(m_pendingSeekTimeStamp);
+
+  m_seekTimer.start();
+}
+
+void
+UIMediator::onTimeSliderReleased(void)
+{
+  // The user is done: no point in waiting any longer
+  if (m_seekTimer.isActive()) {
+    m_seekTimer.stop();
+    this->onSeekTimeout();
+  }
+}
+
+void
+UIMediator::onSeekTimeout(void)
+{
+  emit seek(m_pendingSeekTimeStamp);
 }
 
+void
+UIMediator::onOverviewReady(
+    QString path,
+    QVector<float> overview,
+    int columns,
+    int bins)
+{
+  if (path == m_overviewPath)
+    this->ui->timeSlider->setOverview(overview, columns, bins);
+}
@@ -43,6 +43,7 @@
 #include "AddBookmarkDialog.h"
 #include "PanoramicDialog.h"
 #include "LogDialog.h"
+#include "DiagnosticsDialog.h"
 #include "ConfigDialog.h"
 #include "DeviceDialog.h"
 #include "AboutDialog.h"
@@ -50,6 +51,11 @@
 
 // Tool widget controls
 #include <ToolWidgetFactory.h>
+#include <RenderScheduler.h>
+#include <LoadGovernor.h>
+#include <MemoryAccountant.h>
+#include <WaterfallExportTask.h>
+#include <ThreadPolicy.h>
 #include <TabWidgetFactory.h>
 #include <UIListenerFactory.h>
 
@@ -112,8 +118,10 @@ UIMediator::finishRecent()
 }
 
 void
-UIMediator::setProfile(Suscan::Source::Config const &prof, bool restart)
+UIMediator::setProfile(Suscan::Source::Config const &prof)
 {
+  bool restart = this->appConfig->profile.needsRestart(prof);
+
   this->appConfig->profile = prof;
   this->refreshProfile();
   this->refreshUI();
@@ -138,12 +146,61 @@ UIMediator::getSpectrumAverager()
   return &this->averager;
 }
 
+OccupancyAccumulator *
+UIMediator::getOccupancyAccumulator()
+{
+  return &this->occupancy;
+}
+
 AppConfig *
 UIMediator::getAppConfig() const
 {
   return this->appConfig;
 }
 
+// Deferred tool widgets that were expanded last time are created now. The
+// rest are left collapsed, until the user expands them.
+void
+UIMediator::resolveDeferredToolWidgets()
+{
+  for (auto deferred : m_deferredToolWidgets) {
+    bool collapsed = false;
+
+    if (deferred->widget() != nullptr)
+      continue;
+
+    try {
+      Suscan::Object config =
+          this->appConfig->getComponentConfig(deferred->factory()->name());
+      collapsed = config.get("collapsed", false);
+    } catch (Suscan::Exception &) {
+      collapsed = false;
+    }
+
+    if (collapsed)
+      deferred->setProperty("collapsed", true);
+    else
+      deferred->instantiate();
+  }
+}
+
+void
+UIMediator::adoptToolWidget(ToolWidget *widget)
+{
+  Suscan::Singleton *s = Suscan::Singleton::get_instance();
+
+  // Catch up with everything the other components were told so far
+  this->configureUIComponent(widget);
+  widget->setColorConfig(this->appConfig->colors);
+  if (s->haveQth())
+    widget->setQth(s->getQth());
+  widget->setTimeStamp(m_lastTimeStamp);
+  widget->setProfile(this->appConfig->profile);
+  widget->setState(m_state, m_analyzer);
+  if (m_haveSourceInfo)
+    widget->setSourceInfo(m_sourceInfo, Suscan::SOURCE_INFO_ALL);
+}
+
 void
 UIMediator::configureUIComponent(UIComponent *comp)
 {
@@ -180,7 +237,7 @@ UIMediator::unregisterUIComponent(UIComponent *comp)
 
 
 bool
-UIMediator::addTabWidget(TabWidget *tabWidget)
+UIMediator::addTabWidget(TabWidget *tabWidget, bool focus)
 {
   // Adding a tab widget involves:
   // 1. Checking whether it exists.
@@ -188,7 +245,7 @@ UIMediator::addTabWidget(TabWidget *tabWidget)
   // 3. Register a slot to remove it from the tab list when destroyed
   // 4. Sync state
   // 5. Open a tab with the corresponding title
-  // 6. Switch focus
+  // 6. Switch focus (if requested)
   int index;
   Suscan::Singleton *s = Suscan::Singleton::get_instance();
 
@@ -215,8 +272,11 @@ UIMediator::addTabWidget(TabWidget *tabWidget)
   tabWidget->setTimeStamp(m_lastTimeStamp);
   tabWidget->setProfile(this->appConfig->profile);
   tabWidget->setState(m_state, m_analyzer);
+  if (m_haveSourceInfo)
+    tabWidget->setSourceInfo(m_sourceInfo, Suscan::SOURCE_INFO_ALL);
 
-  this->ui->main->mainTab->setCurrentIndex(index);
+  if (focus)
+    this->ui->main->mainTab->setCurrentIndex(index);
 
   return true;
 }
@@ -229,9 +289,12 @@ UIMediator::addUIListener(UIListener *listener)
   if (s->haveQth())
     listener->setQth(s->getQth());
 
+  this->configureUIComponent(listener);
   listener->setTimeStamp(m_lastTimeStamp);
   listener->setProfile(this->appConfig->profile);
   listener->setState(m_state, m_analyzer);
+  if (m_haveSourceInfo)
+    listener->setSourceInfo(m_sourceInfo, Suscan::SOURCE_INFO_ALL);
 
   listener->setParent(this);
 
@@ -444,6 +507,24 @@ UIMediator::connectMainWindow()
         this,
         SLOT(onTriggerExport(bool)));
 
+  connect(
+        this->ui->main->actionExport_waterfall,
+        SIGNAL(triggered(bool)),
+        this,
+        SLOT(onTriggerExportWaterfall(bool)));
+
+  connect(
+        this->ui->main->actionLoad_session,
+        SIGNAL(triggered(bool)),
+        this,
+        SLOT(onTriggerLoadSession(bool)));
+
+  connect(
+        this->ui->main->actionSave_session,
+        SIGNAL(triggered(bool)),
+        this,
+        SLOT(onTriggerSaveSession(bool)));
+
   connect(
         this->ui->main->actionDevices,
         SIGNAL(triggered(bool)),
@@ -456,12 +537,6 @@ UIMediator::connectMainWindow()
         this,
         SLOT(onQuickConnect()));
 
-  connect(
-        this->ui->quickConnectDialog,
-        SIGNAL(accepted()),
-        this,
-        SLOT(onQuickConnectAccepted()));
-
   connect(
         this->ui->main->actionStart_capture,
         SIGNAL(triggered(bool)),
@@ -518,6 +593,12 @@ UIMediator::connectMainWindow()
         this,
         SLOT(onTriggerLogMessages()));
 
+  connect(
+        this->ui->main->actionDiagnostics,
+        SIGNAL(triggered(bool)),
+        this,
+        SLOT(onTriggerDiagnostics()));
+
   connect(
         this->ui->main->action_Background_tasks,
         SIGNAL(triggered(bool)),
@@ -530,30 +611,12 @@ UIMediator::connectMainWindow()
         this,
         SLOT(onAddBookmark()));
 
-  connect(
-        this->ui->addBookmarkDialog,
-        SIGNAL(accepted()),
-        this,
-        SLOT(onBookmarkAccepted()));
-
   connect(
         this->ui->main->actionManageBookmarks,
         SIGNAL(triggered(bool)),
         this,
         SLOT(onOpenBookmarkManager()));
 
-  connect(
-        this->ui->bookmarkManagerDialog,
-        SIGNAL(bookmarkSelected(BookmarkInfo)),
-        this,
-        SLOT(onJumpToBookmark(BookmarkInfo)));
-
-  connect(
-        this->ui->bookmarkManagerDialog,
-        SIGNAL(bookmarkChanged()),
-        this,
-        SLOT(onBookmarkChanged()));
-
   this->ui->main->mainTab->tabBar()->setContextMenuPolicy(
         Qt::CustomContextMenu);
 
@@ -568,16 +631,27 @@ void
 UIMediator::initSidePanel()
 {
   auto s = Suscan::Singleton::get_instance();
+  QList<QPair<QWidget *, QString>> widgets;
 
   for (auto p = s->getFirstToolWidgetFactory();
        p != s->getLastToolWidgetFactory();
        ++p) {
     ToolWidgetFactory *f = *p;
-    ToolWidget *widget = f->make(this);
-    this->ui->spectrum->addToolWidget(
-          widget,
-          f->getTitle().c_str());
+    QWidget *widget;
+
+    // Whether these are collapsed is only known once the config is loaded
+    if (f->deferrable()) {
+      DeferredToolWidget *deferred = new DeferredToolWidget(f, this);
+      m_deferredToolWidgets.push_back(deferred);
+      widget = deferred;
+    } else {
+      widget = f->make(this);
+    }
+
+    widgets.append(qMakePair(widget, QString(f->getTitle().c_str())));
   }
+
+  this->ui->spectrum->addToolWidgets(widgets);
 }
 
 void
@@ -618,18 +692,20 @@ UIMediator::UIMediator(QMainWindow *owner, AppUI *ui)
   // Add baseband analyzer tab
   this->ui->main->mainTab->addTab(this->ui->spectrum, "Radio spectrum");
 
-  // Create background task controller dialog
-  this->ui->backgroundTasksDialog->setController(
-        Suscan::Singleton::get_instance()->getBackgroundTaskController());
-
 
   this->connectRequestTracker();
   this->connectMainWindow();
   this->connectSpectrum();
-
-  this->connectDeviceDialog();
   this->connectPanoramicDialog();
   this->connectTimeSlider();
+
+  RenderScheduler::instance()->attach(this, [this] () { this->flushUpdates(); });
+
+  connect(
+        LoadGovernor::instance(),
+        SIGNAL(levelChanged(int)),
+        this,
+        SLOT(onLoadLevelChanged(int)));
 }
 
 void
@@ -651,6 +727,15 @@ UIMediator::setSampleRate(unsigned int rate)
   }
 }
 
+void
+UIMediator::applyMessageBatching()
+{
+  if (m_analyzer != nullptr)
+    m_analyzer->setMessageBatching(
+          this->appConfig->guiConfig.msgBatchSize,
+          this->appConfig->guiConfig.msgBatchDeadline);
+}
+
 void
 UIMediator::setState(State state, Suscan::Analyzer *analyzer)
 {
@@ -667,44 +752,132 @@ UIMediator::setState(State state, Suscan::Analyzer *analyzer)
         assert(analyzer != nullptr);
     }
 
+    if (m_state == RUNNING && state == RESTARTING)
+      this->saveInspectorsForRestart();
+
     m_state = state;
     m_analyzer = analyzer;
 
-    if (m_analyzer != nullptr)
+    // Source info of the previous analyzer is not diffed against
+    m_pendingSourceInfo = 0;
+    m_haveSourceInfo = false;
+    m_sourceInfo = Suscan::AnalyzerSourceInfo();
+
+    // A new analyzer starts with the user's spectrum settings
+    this->resetGovernor();
+
+    if (m_analyzer != nullptr) {
       this->connectAnalyzer();
+      this->applyMessageBatching();
+    }
 
     m_requestTracker->setAnalyzer(m_analyzer);
+    LoadGovernor::instance()->setAnalyzer(m_analyzer);
+    this->ui->diagnosticsDialog->setAnalyzer(m_analyzer);
+
+    // Components must see the latest profile before the new state
+    this->flushUpdates();
 
     // Propagate state
     for (auto p : m_components)
       p->setState(state, analyzer);
 
+    if (m_analyzer != nullptr) {
+      this->applyCachedSourceInfo();
+      this->reopenInspectors();
+      this->openSessionInspectors();
+    }
+
     this->refreshUI();
   }
 }
 
+std::string
+UIMediator::remoteKey() const
+{
+  return this->appConfig->profile.getParam("host")
+      + ":"
+      + this->appConfig->profile.getParam("port");
+}
+
+//
+// Remote servers take a while to send their source info. Until then,
+// the UI shows what the same server reported last time (gains, limits,
+// frequency). The fresh info is then diffed against it as usual, so
+// only what changed meanwhile is applied again.
+//
+void
+UIMediator::applyCachedSourceInfo()
+{
+  if (!this->appConfig->profile.isRemote())
+    return;
+
+  auto it = m_remoteInfoCache.find(this->remoteKey());
+
+  if (it != m_remoteInfoCache.end()) {
+    Suscan::AnalyzerSourceInfo cached = it->second;
+    this->notifySourceInfo(cached);
+  }
+}
+
+std::string
+UIMediator::takeResolvedHost(std::string const &host)
+{
+  auto it = m_resolvedHosts.find(host);
+  std::string address;
+
+  if (it != m_resolvedHosts.end()) {
+    address = it->second;
+    m_resolvedHosts.erase(it);
+  }
+
+  return address;
+}
+
 UIMediator::State
 UIMediator::getState() const
 {
   return m_state;
 }
 
+//
+// Source info is diffed here, once. Components are told which fields
+// changed (once per frame at most) and never see repeated messages.
+//
 void
 UIMediator::notifySourceInfo(Suscan::AnalyzerSourceInfo const &info)
 {
-  this->ui->spectrum->setFrequencyLimits(
-        static_cast<qint64>(info.getMinFrequency()),
-        static_cast<qint64>(info.getMaxFrequency()));
+  unsigned int changes = m_haveSourceInfo
+      ? info.diff(m_sourceInfo)
+      : Suscan::SOURCE_INFO_ALL;
+
+  if (changes == 0)
+    return;
+
+  m_sourceInfo.update(info, changes);
+  m_haveSourceInfo = true;
+
+  if (this->appConfig->profile.isRemote())
+    m_remoteInfoCache[this->remoteKey()] = m_sourceInfo;
 
-  this->ui->spectrum->setFreqs(
-        static_cast<qint64>(info.getFrequency()),
-        static_cast<qint64>(info.getLnbFrequency()),
-        true); // Silent update (important!)
+  if (changes & Suscan::SOURCE_INFO_FREQ_LIMITS)
+    this->ui->spectrum->setFrequencyLimits(
+          static_cast<qint64>(info.getMinFrequency()),
+          static_cast<qint64>(info.getMaxFrequency()));
 
-  this->ui->spectrum->setLocked(
-        !info.testPermission(SUSCAN_ANALYZER_PERM_SET_FREQ));
+  if (changes & Suscan::SOURCE_INFO_FREQUENCY)
+    this->ui->spectrum->setFreqs(
+          static_cast<qint64>(info.getFrequency()),
+          static_cast<qint64>(info.getLnbFrequency()),
+          true); // Silent update (important!)
+
+  if (changes & Suscan::SOURCE_INFO_PERMISSIONS)
+    this->ui->spectrum->setLocked(
+          !info.testPermission(SUSCAN_ANALYZER_PERM_SET_FREQ));
 
-  if (info.isSeekable()) {
+  if (info.isSeekable()
+      && (changes
+          & (Suscan::SOURCE_INFO_TIME_RANGE | Suscan::SOURCE_INFO_PERMISSIONS))) {
     this->setSourceTimeStart(info.getSourceStartTime());
     this->setSourceTimeEnd(info.getSourceEndTime());
 
@@ -712,6 +885,9 @@ UIMediator::notifySourceInfo(Suscan::AnalyzerSourceInfo const &info)
           info.testPermission(
             SUSCAN_ANALYZER_PERM_SEEK));
   }
+
+  m_pendingSourceInfo |= changes;
+  this->scheduleUpdates();
 }
 
 void
@@ -719,15 +895,53 @@ UIMediator::notifyTimeStamp(struct timeval const &timestamp)
 {
   this->setTimeStamp(timestamp);
 
-  for (auto p : m_components)
-    p->setTimeStamp(timestamp);
+  m_pendingTimeStamp = true;
+  this->scheduleUpdates();
+}
+
+void
+UIMediator::scheduleUpdates()
+{
+  RenderScheduler::instance()->markDirty(this);
+}
+
+//
+// Called once per frame by the render scheduler. Only the last value of
+// each setting reaches the components, no matter how many times it
+// changed since the previous frame.
+//
+void
+UIMediator::flushUpdates()
+{
+  if (m_pendingProfile) {
+    m_pendingProfile = false;
+    for (auto p : m_components)
+      p->setProfile(this->appConfig->profile);
+  }
+
+  if (m_pendingTimeStamp) {
+    m_pendingTimeStamp = false;
+    for (auto p : m_components)
+      p->setTimeStamp(m_lastTimeStamp);
+  }
+
+  if (m_pendingSourceInfo != 0) {
+    unsigned int changes = m_pendingSourceInfo;
+
+    m_pendingSourceInfo = 0;
+    for (auto p : m_components)
+      p->setSourceInfo(m_sourceInfo, changes);
+  }
 }
 
 void
 UIMediator::refreshDevicesDone()
 {
-  this->ui->deviceDialog->refreshDone();
-  this->ui->configDialog->notifySingletonChanges();
+  if (this->ui->deviceDialog != nullptr)
+    this->ui->deviceDialog->refreshDone();
+
+  if (this->ui->configDialog != nullptr)
+    this->ui->configDialog->notifySingletonChanges();
 }
 
 QMessageBox::StandardButton
@@ -793,9 +1007,23 @@ UIMediator::notifyStartupErrors()
 void
 UIMediator::setAnalyzerParams(Suscan::AnalyzerParams const &params)
 {
+  Suscan::AnalyzerParams const user = this->appConfig->analyzerParams;
+
   this->appConfig->analyzerParams = params;
+
+  // Reductions we requested on top of the user's settings are reported
+  // back by the analyzer. They are not the user's settings.
+  if (m_analyzer != nullptr) {
+    if (params.windowSize == this->requestedSize)
+      this->appConfig->analyzerParams.windowSize = user.windowSize;
+    if (sufeq(params.psdUpdateInterval, this->requestedInterval, 1e-6))
+      this->appConfig->analyzerParams.psdUpdateInterval =
+          user.psdUpdateInterval;
+  }
+
   this->ui->spectrum->setExpectedRate(
         static_cast<int>(1.f / params.psdUpdateInterval));
+  m_requestTracker->setChannelGrid(params.channelGrid);
 }
 
 void
@@ -817,7 +1045,8 @@ UIMediator::refreshProfile(bool updateFreqs)
   pass = this->getProfile()->getParam("password");
   interface = this->getProfile()->getInterface();
 
-  this->ui->configDialog->setProfile(this->appConfig->profile);
+  if (this->ui->configDialog != nullptr)
+    this->ui->configDialog->setProfile(this->appConfig->profile);
 
   if (!this->appConfig->profile.isRemote()) {
     if (this->appConfig->profile.getType() == SUSCAN_SOURCE_TYPE_SDR) {
@@ -875,6 +1104,7 @@ UIMediator::refreshProfile(bool updateFreqs)
   this->ui->timeSlider->setEndTime(end);
   this->ui->timeSlider->setTimeStamp(tv);
   this->ui->timeToolbar->setVisible(!isRealTime);
+  this->refreshOverview();
 
   // Configure spectrum
   this->ui->spectrum->setFrequencyLimits(min, max);
@@ -887,8 +1117,8 @@ UIMediator::refreshProfile(bool updateFreqs)
   }
 
   // Apply profile to all UI components
-  for (auto p : m_components)
-    p->setProfile(this->appConfig->profile);
+  m_pendingProfile = true;
+  this->scheduleUpdates();
 }
 
 Suscan::Source::Config *
@@ -958,10 +1188,16 @@ UIMediator::applyConfig()
     this->ui->spectrum->setSidePanelRatio(this->appConfig->sidePanelRatio);
 
   // The following controls reflect elements of the configuration that are
-  // not owned by them. We need to set them manually.
-  this->ui->configDialog->setColors(this->appConfig->colors);
-  this->ui->configDialog->setGuiConfig(this->appConfig->guiConfig);
-  this->ui->configDialog->setTleSourceConfig(this->appConfig->tleSourceConfig);
+  // not owned by them. We need to set them manually. The configuration
+  // dialog takes them when it is first opened.
+  if (this->ui->configDialog != nullptr) {
+    this->ui->configDialog->setColors(this->appConfig->colors);
+    this->ui->configDialog->setGuiConfig(this->appConfig->guiConfig);
+    this->ui->configDialog->setTleSourceConfig(
+          this->appConfig->tleSourceConfig);
+    this->ui->configDialog->setThreadConfig(this->appConfig->threadConfig);
+  }
+
   this->ui->panoramicDialog->setColors(this->appConfig->colors);
   this->ui->spectrum->setColorConfig(this->appConfig->colors);
 
@@ -975,6 +1211,14 @@ UIMediator::applyConfig()
       p->setQth(sus->getQth());
 
   this->ui->spectrum->setGuiConfig(this->appConfig->guiConfig);
+  this->ui->panoramicDialog->setGuiConfig(this->appConfig->guiConfig);
+  RenderScheduler::instance()->setMaxFps(this->appConfig->guiConfig.maxFps);
+  LoadGovernor::instance()->setEnabled(
+        this->appConfig->guiConfig.enableLoadGovernor);
+  MemoryAccountant::instance()->setBudget(
+        static_cast<size_t>(this->appConfig->guiConfig.memoryBudget) << 20);
+
+  ThreadPolicy::instance()->setConfig(this->appConfig->threadConfig);
 
   this->setAnalyzerParams(this->appConfig->analyzerParams);
 
@@ -998,6 +1242,8 @@ UIMediator::applyConfig()
   for (auto p : m_components)
     this->configureUIComponent(p);
 
+  this->resolveDeferredToolWidgets();
+
   this->refreshProfile();
   this->refreshUI();
 
@@ -1019,25 +1265,26 @@ void
 UIMediator::onTriggerSetup(bool)
 {
   auto sus = Suscan::Singleton::get_instance();
+  ConfigDialog *dialog = this->configDialog();
 
-  this->ui->configDialog->setProfile(*this->getProfile());
-  this->ui->configDialog->setAnalyzerParams(*this->getAnalyzerParams());
-  this->ui->configDialog->setColors(this->appConfig->colors);
-  this->ui->configDialog->setTleSourceConfig(this->appConfig->tleSourceConfig);
+  dialog->setProfile(*this->getProfile());
+  dialog->setAnalyzerParams(*this->getAnalyzerParams());
+  dialog->setColors(this->appConfig->colors);
+  dialog->setTleSourceConfig(this->appConfig->tleSourceConfig);
+  dialog->setThreadConfig(this->appConfig->threadConfig);
 
   if (sus->haveQth())
-    this->ui->configDialog->setLocation(sus->getQth());
+    dialog->setLocation(sus->getQth());
 
-  if (this->ui->configDialog->run()) {
-    this->appConfig->analyzerParams = this->ui->configDialog->getAnalyzerParams();
+  if (dialog->run()) {
+    this->appConfig->analyzerParams = dialog->getAnalyzerParams();
+    m_requestTracker->setChannelGrid(this->appConfig->analyzerParams.channelGrid);
 
-    if (this->ui->configDialog->profileChanged())
-      this->setProfile(
-          this->ui->configDialog->getProfile(),
-          this->ui->configDialog->sourceNeedsRestart());
+    if (dialog->profileChanged())
+      this->setProfile(dialog->getProfile());
 
-    if (this->ui->configDialog->colorsChanged()) {
-      this->appConfig->colors = this->ui->configDialog->getColors();
+    if (dialog->colorsChanged()) {
+      this->appConfig->colors = dialog->getColors();
       this->ui->spectrum->setColorConfig(this->appConfig->colors);
 
       // Apply color config to all UI components
@@ -1045,17 +1292,32 @@ UIMediator::onTriggerSetup(bool)
         p->setColorConfig(this->appConfig->colors);
     }
 
-    if (this->ui->configDialog->guiChanged()) {
-      this->appConfig->guiConfig = this->ui->configDialog->getGuiConfig();
+    if (dialog->guiChanged()) {
+      this->appConfig->guiConfig = dialog->getGuiConfig();
       this->ui->spectrum->setGuiConfig(this->appConfig->guiConfig);
+      this->ui->panoramicDialog->setGuiConfig(this->appConfig->guiConfig);
+      RenderScheduler::instance()->setMaxFps(
+            this->appConfig->guiConfig.maxFps);
+      LoadGovernor::instance()->setEnabled(
+            this->appConfig->guiConfig.enableLoadGovernor);
+      MemoryAccountant::instance()->setBudget(
+            static_cast<size_t>(this->appConfig->guiConfig.memoryBudget)
+            << 20);
+      this->applyMessageBatching();
+    }
+
+    if (dialog->threadConfigChanged()) {
+      this->appConfig->threadConfig =
+          dialog->getThreadConfig();
+      ThreadPolicy::instance()->setConfig(this->appConfig->threadConfig);
     }
 
-    if (this->ui->configDialog->tleSourceConfigChanged()) {
+    if (dialog->tleSourceConfigChanged()) {
       this->appConfig->tleSourceConfig =
-          this->ui->configDialog->getTleSourceConfig();
+          dialog->getTleSourceConfig();
     }
-    if (this->ui->configDialog->locationChanged()) {
-      Suscan::Location loc = this->ui->configDialog->getLocation();
+    if (dialog->locationChanged()) {
+      Suscan::Location loc = dialog->getLocation();
       sus->setQth(loc);
 
       // Set QTH of all UI components
@@ -1075,6 +1337,12 @@ UIMediator::onToggleCapture(bool state)
   }
 }
 
+void
+UIMediator::requestRecord(bool state)
+{
+  emit recordRequested(state);
+}
+
 void
 UIMediator::onToggleFullScreen(bool)
 {
@@ -1092,13 +1360,21 @@ UIMediator::onToggleAbout(bool)
 void
 UIMediator::onQuickConnect()
 {
-  this->ui->quickConnectDialog->setProfile(this->appConfig->profile);
-  this->ui->quickConnectDialog->exec();
+  QuickConnectDialog *dialog = this->quickConnectDialog();
+
+  dialog->setProfile(this->appConfig->profile);
+  dialog->exec();
 }
 
 void
 UIMediator::onQuickConnectAccepted()
 {
+  QuickConnectDialog *dialog = this->quickConnectDialog();
+  std::string address = dialog->getResolvedAddress().toStdString();
+
+  if (!address.empty())
+    m_resolvedHosts[dialog->getHost().trimmed().toStdString()] = address;
+
   this->appConfig->profile.setInterface(SUSCAN_SOURCE_REMOTE_INTERFACE);
   this->appConfig->profile.setDevice(this->remoteDevice);
 
@@ -1106,16 +1382,16 @@ UIMediator::onQuickConnectAccepted()
 
   this->appConfig->profile.setParam(
         "host",
-        this->ui->quickConnectDialog->getHost().toStdString());
+        dialog->getHost().trimmed().toStdString());
   this->appConfig->profile.setParam(
         "port",
-        std::to_string(this->ui->quickConnectDialog->getPort()));
+        std::to_string(dialog->getPort()));
   this->appConfig->profile.setParam(
         "user",
-        this->ui->quickConnectDialog->getUser().toStdString());
+        dialog->getUser().toStdString());
   this->appConfig->profile.setParam(
         "password",
-        this->ui->quickConnectDialog->getPassword().toStdString());
+        dialog->getPassword().toStdString());
 
   this->refreshProfile(false);
   this->refreshUI();
@@ -1125,6 +1401,17 @@ UIMediator::onQuickConnectAccepted()
     emit captureStart();
 }
 
+void
+UIMediator::onLoadLevelChanged(int level)
+{
+  if (level == LOAD_LEVEL_NORMAL)
+    this->setStatusMessage("System load back to normal: full display rates");
+  else
+    this->setStatusMessage(
+          QString("System overloaded: ")
+          + LoadGovernor::levelDescription(static_cast<LoadLevel>(level)));
+}
+
 void
 UIMediator::onTriggerStart(bool)
 {
@@ -1280,10 +1567,70 @@ UIMediator::onTriggerExport(bool)
   } while (!done);
 }
 
+void
+UIMediator::onTriggerExportWaterfall(bool)
+{
+  Suscan::Source::Config *profile = this->getProfile();
+  MainSpectrum *spectrum = this->ui->spectrum;
+  QFileDialog dialog(this);
+  QStringList filters;
+  QString path;
+  WaterfallExportTask *task;
+
+  filters << "PNG image (*.png)"
+          << "Portable pixmap (*.ppm)";
+
+  dialog.setFileMode(QFileDialog::FileMode::AnyFile);
+  dialog.setAcceptMode(QFileDialog::AcceptSave);
+  dialog.setWindowTitle(QString("Export waterfall"));
+  dialog.setNameFilters(filters);
+
+  if (!dialog.exec())
+    return;
+
+  path = SuWidgetsHelpers::ensureExtension(
+        dialog.selectedFiles().first(),
+        dialog.selectedNameFilter().contains(".ppm") ? "ppm" : "png");
+
+  // Captures are replayed in full, at a fixed resolution. Anything else
+  // can only be exported from what the history still holds.
+  if (!profile->isRemote()
+      && profile->getType() == SUSCAN_SOURCE_TYPE_FILE
+      && profile->fileIsValid())
+    task = new WaterfallExportTask(
+          QString::fromStdString(profile->getPath()),
+          profile->getFormat(),
+          path,
+          spectrum->getPaletteTable(),
+          spectrum->getWfMin(),
+          spectrum->getWfMax());
+  else
+    task = new WaterfallExportTask(
+          &spectrum->getHistory(),
+          path,
+          spectrum->getPaletteTable(),
+          spectrum->getWfMin(),
+          spectrum->getWfMax());
+
+  if (!task->attemptOpen()) {
+    QMessageBox::critical(
+          this->ui->main->centralWidget,
+          "Export waterfall",
+          task->getLastError(),
+          QMessageBox::Ok);
+    delete task;
+    return;
+  }
+
+  Suscan::Singleton::get_instance()->getBackgroundTaskController()->pushTask(
+        task,
+        "Export waterfall to " + QFileInfo(path).fileName());
+}
+
 void
 UIMediator::onTriggerDevices(bool)
 {
-  this->ui->deviceDialog->run();
+  this->deviceDialog()->run();
 }
 
 void
@@ -1336,19 +1683,27 @@ UIMediator::onTriggerLogMessages()
   this->ui->logDialog->show();
 }
 
+void
+UIMediator::onTriggerDiagnostics()
+{
+  this->ui->diagnosticsDialog->show();
+}
+
 void
 UIMediator::onTriggerBackgroundTasks()
 {
-  this->ui->backgroundTasksDialog->show();
+  this->backgroundTasksDialog()->show();
 }
 
 void
 UIMediator::onAddBookmark()
 {
-  this->ui->addBookmarkDialog->setFrequencyHint(
+  AddBookmarkDialog *dialog = this->addBookmarkDialog();
+
+  dialog->setFrequencyHint(
         this->ui->spectrum->getLoFreq() + this->ui->spectrum->getCenterFreq());
 
-  this->ui->addBookmarkDialog->setNameHint(
+  dialog->setNameHint(
         QString::asprintf(
           "Signal @ %s",
           SuWidgetsHelpers::formatQuantity(
@@ -1356,9 +1711,9 @@ UIMediator::onAddBookmark()
             4,
             "Hz").toStdString().c_str()));
 
-  this->ui->addBookmarkDialog->setBandwidthHint(this->ui->spectrum->getBandwidth());
+  dialog->setBandwidthHint(this->ui->spectrum->getBandwidth());
 
-  this->ui->addBookmarkDialog->show();
+  dialog->show();
 }
 
 void
@@ -1366,15 +1721,16 @@ UIMediator::onBookmarkAccepted()
 {
   Suscan::Singleton *sus = Suscan::Singleton::get_instance();
   BookmarkInfo info;
+  AddBookmarkDialog *dialog = this->addBookmarkDialog();
 
-  info.name = this->ui->addBookmarkDialog->name();
-  info.frequency = this->ui->addBookmarkDialog->frequency();
-  info.color = this->ui->addBookmarkDialog->color();
+  info.name = dialog->name();
+  info.frequency = dialog->frequency();
+  info.color = dialog->color();
   info.lowFreqCut = this->ui->spectrum->computeLowCutFreq(
-        this->ui->addBookmarkDialog->bandwidth());
+        dialog->bandwidth());
   info.highFreqCut = this->ui->spectrum->computeHighCutFreq(
-        this->ui->addBookmarkDialog->bandwidth());
-  info.modulation = this->ui->addBookmarkDialog->modulation();
+        dialog->bandwidth());
+  info.modulation = dialog->modulation();
 
   if (!sus->registerBookmark(info)) {
     QMessageBox *mb = new QMessageBox(
@@ -1395,7 +1751,7 @@ UIMediator::onBookmarkAccepted()
 void
 UIMediator::onOpenBookmarkManager()
 {
-  this->ui->bookmarkManagerDialog->show();
+  this->bookmarkManagerDialog()->show();
 }
 
 void
@@ -26,6 +26,14 @@
 #  define NULL nullptr
 #endif // NULL
 
+#define SIGDIGGER_AGC_FAST_RISE_FRAC   (2 * 3.9062e-1)
+#define SIGDIGGER_AGC_FAST_FALL_FRAC   (2 * SIGDIGGER_AGC_FAST_RISE_FRAC)
+#define SIGDIGGER_AGC_SLOW_RISE_FRAC   (10 * SIGDIGGER_AGC_FAST_RISE_FRAC)
+#define SIGDIGGER_AGC_SLOW_FALL_FRAC   (10 * SIGDIGGER_AGC_FAST_FALL_FRAC)
+#define SIGDIGGER_AGC_HANG_MAX_FRAC    (SIGDIGGER_AGC_FAST_RISE_FRAC * 5)
+#define SIGDIGGER_AGC_DELAY_LINE_FRAC  (SIGDIGGER_AGC_FAST_RISE_FRAC * 10)
+#define SIGDIGGER_AGC_MAG_HISTORY_FRAC (SIGDIGGER_AGC_FAST_RISE_FRAC * 10)
+
 class AGCTask : public Suscan::CancellableTask
 {
   Q_OBJECT
@@ -24,13 +24,23 @@
 
 #define ALSAPLAYER_UNDERRUN_WAIT_PERIOD_MS 150
 
+// Pull mode: device buffer, in periods, and longest wait for one
+#define ALSAPLAYER_PULL_PERIODS            3
+#define ALSAPLAYER_PULL_WAIT_MS            100
+
 namespace SigDigger {
   class AlsaPlayer : public GenericAudioPlayer {
     snd_pcm_t *pcm = nullptr;
 
   public:
-    AlsaPlayer(std::string const &dev, unsigned int rate, size_t bufSiz);
+    AlsaPlayer(
+        std::string const &dev,
+        unsigned int rate,
+        size_t bufSiz,
+        unsigned int channels = 1,
+        AudioSource *source = nullptr);
     bool write(const float *, size_t) override;
+    bool pull(void) override;
     ~AlsaPlayer() override;
   };
 }
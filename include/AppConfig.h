@@ -29,6 +29,7 @@
 #include "Version.h"
 #include "ColorConfig.h"
 #include "TLESourceConfig.h"
+#include "ThreadConfig.h"
 
 #define SIGDIGGER_FFT_WINDOW_SIZE  4096u
 #define SIGDIGGER_FFT_REFRESH_RATE 25u
@@ -48,6 +49,7 @@ namespace SigDigger {
       ColorConfig colors;
       GuiConfig guiConfig;
       TLESourceConfig tleSourceConfig;
+      ThreadConfig threadConfig;
       Suscan::Serializable *panSpectrumConfig = nullptr;
 
       // We cannot keep a pointer to the deserialized object. This is because
@@ -77,7 +79,9 @@ namespace SigDigger {
 
       // Overriden methods
       Suscan::Object getComponentConfig(const char *);
-      void setComponentConfig(const char *, Suscan::Object const &);
+
+      // Takes the tree over. Only borrowed trees are copied.
+      void setComponentConfig(const char *, Suscan::Object &&);
 
       void deserialize(Suscan::Object const &conf) override;
       Suscan::Object &&serialize(void) override;
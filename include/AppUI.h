@@ -34,6 +34,7 @@ namespace SigDigger {
   class AboutDialog;
   class DataSaverUI;
   class LogDialog;
+  class DiagnosticsDialog;
   class BackgroundTasksDialog;
   class AddBookmarkDialog;
   class BookmarkManagerDialog;
@@ -50,6 +51,7 @@ namespace SigDigger {
     AboutDialog *aboutDialog = nullptr;
     DataSaverUI *dataSaverUI = nullptr;
     LogDialog *logDialog = nullptr;
+    DiagnosticsDialog *diagnosticsDialog = nullptr;
     QuickConnectDialog *quickConnectDialog = nullptr;
     BackgroundTasksDialog *backgroundTasksDialog = nullptr;
     AddBookmarkDialog *addBookmarkDialog = nullptr;
@@ -27,6 +27,17 @@
 /* Local includes */
 #include "AppConfig.h"
 #include "UIMediator.h"
+#include "InstanceServer.h"
+
+// Longest wait for device detection before the device list is shown as
+// it is. The detection result is still taken whenever it arrives.
+#define SIGDIGGER_DEVICE_DETECT_TIMEOUT_MS 8000
+
+// Automatic reconnection of lost sources: the delay doubles after every
+// failed attempt, up to a maximum, until the attempts are exhausted
+#define SIGDIGGER_RECONNECT_INITIAL_DELAY_MS 1000
+#define SIGDIGGER_RECONNECT_MAX_DELAY_MS     30000
+#define SIGDIGGER_RECONNECT_MAX_ATTEMPTS     10
 
 namespace SigDigger {
   class Scanner;
@@ -66,6 +77,11 @@ namespace SigDigger {
     QTimer uiTimer;
     bool sourceInfoReceived = false;
 
+    // Reconnection of lost sources
+    QTimer reconnectTimer;
+    unsigned int reconnectAttempts = 0;
+    bool reconnecting = false;
+
     // Panoramic spectrum
     Scanner *scanner = nullptr;
     SUFREQ scanMinFreq;
@@ -74,16 +90,29 @@ namespace SigDigger {
     // Rediscover devices
     QThread *deviceDetectThread;
     DeviceDetectWorker *deviceDetectWorker;
+    QTimer deviceDetectTimer;
+    bool detecting = false;
+    bool detectTimedOut = false;
+    bool detectRequested = false;
+
+    // Later launches with arguments hand them over to us
+    InstanceServer *instanceServer = nullptr;
+    LaunchRequest launchRequest;
 
     // Private methods
     QString getLogText(void);
     void connectUI(void);
     void connectAnalyzer(void);
     void connectDeviceDetect(void);
+    void startDeviceDetect(bool requested);
     void connectScanner(void);
 
-    void hotApplyProfile(Suscan::Source::Config const *);
+    void hotApplyProfile(Suscan::Source::Config *);
+    void applyLaunchRequest(LaunchRequest const &);
     void orderedHalt(void);
+    bool canReconnect(void) const;
+    void scheduleReconnect(void);
+    void cancelReconnect(void);
 
   public:
     // Application methods
@@ -97,6 +126,13 @@ namespace SigDigger {
     void stopCapture(void);
     void setThrottleEnabled(bool);
 
+    // Shutdown, in two steps. The first one only asks the analyzer to
+    // halt, so that a slow source stops while the config is being saved.
+    // The second one tears down every subsystem, flushing recordings.
+    void beginShutdown(void);
+    void shutdown(void);
+    void setLaunchRequest(LaunchRequest const &);
+
     FileDataSaver *getSaver(void) const;
 
     explicit Application(QWidget *parent = nullptr);
@@ -119,11 +155,13 @@ namespace SigDigger {
     void onDeviceRefresh(void);
     void onRecentSelected(QString profile);
     void onRecentCleared(void);
+    void onLaunchRequested(SigDigger::LaunchRequest const &);
     void onTick(void);
     void quit(void);
 
     // Analyzer slots
     void onAnalyzerHalted(void);
+    void onReconnectTimeout(void);
     void onAnalyzerReadError(void);
     void onAnalyzerEos(void);
     void onPSDMessage(const Suscan::PSDMessage &);
@@ -133,6 +171,7 @@ namespace SigDigger {
 
     // Device detect slots
     void onDetectFinished(void);
+    void onDetectTimeout(void);
 
     // Panoramic spectrum slots
     void onPanSpectrumStart(void);
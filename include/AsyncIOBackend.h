@@ -0,0 +1,54 @@
+//
+//    AsyncIOBackend.h: Asynchronous file write backends
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef ASYNCIOBACKEND_H
+#define ASYNCIOBACKEND_H
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <string>
+
+namespace SigDigger {
+  // Keeps several positioned writes to a file descriptor in flight. Each
+  // write carries a tag, handed back by reap() when it completes, in no
+  // particular order. Buffers must remain valid until then.
+  class AsyncIOBackend {
+  public:
+    virtual ~AsyncIOBackend();
+
+    virtual unsigned int getDepth(void) const = 0;
+    virtual const char *getName(void) const = 0;
+    virtual std::string getError(void) const = 0;
+
+    virtual bool submit(
+        int fd,
+        const void *data,
+        size_t len,
+        off_t offset,
+        uintptr_t tag) = 0;
+
+    // Blocks until one write completes. result is the byte count, or
+    // minus the errno value on failure.
+    virtual bool reap(uintptr_t &tag, ssize_t &result) = 0;
+
+    // io_uring if available, POSIX AIO otherwise. nullptr if neither is.
+    static AsyncIOBackend *make(unsigned int depth);
+  };
+}
+
+#endif // ASYNCIOBACKEND_H
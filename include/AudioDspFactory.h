@@ -0,0 +1,93 @@
+//
+//    AudioDspFactory.h: Pluggable audio processing stages
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef AUDIODSPFACTORY_H
+#define AUDIODSPFACTORY_H
+
+#include <FeatureFactory.h>
+#include <vector>
+#include <cstddef>
+#include <QtGlobal>
+
+// Share of the duration of a block the whole chain may spend on it
+#define SIGDIGGER_AUDIO_DSP_BUDGET   .25
+
+// Consecutive blocks over budget before the slowest stage is bypassed
+#define SIGDIGGER_AUDIO_DSP_OVERRUNS 8
+
+namespace SigDigger {
+  class AudioDspFactory;
+
+  // Processes demodulated (mono) audio, in place. Stages are created and
+  // run in the playback feeder thread, one instance per audio channel, so
+  // they need no locking of their own. process() sits in the middle of
+  // the playback path: it must not block, and a stage that keeps going
+  // over budget is taken out of the chain.
+  class AudioDspStage : public Suscan::FeatureObject {
+  protected:
+    AudioDspStage(AudioDspFactory *);
+
+  public:
+    // Called before the first block, and whenever the audio rate changes
+    virtual void setSampleRate(unsigned int rate);
+    virtual void process(float *block, size_t size) = 0;
+
+    virtual ~AudioDspStage();
+  };
+
+  class AudioDspFactory : public Suscan::FeatureFactory {
+  public:
+    // May return nullptr to stay out of the chain
+    virtual AudioDspStage *make(void) = 0;
+
+    // Overriden methods
+    bool registerGlobally(void) override;
+    bool unregisterGlobally(void) override;
+
+    AudioDspFactory(Suscan::Plugin *);
+  };
+
+  // One instance of every registered stage, in registration order.
+  // Factories are expected to be registered (at plugin load) before
+  // audio is enabled.
+  class AudioDspChain {
+    std::vector<AudioDspStage *> stages;
+    std::vector<qint64> elapsed;
+    unsigned int sampRate;
+    unsigned int overruns = 0;
+
+    void bypassSlowest(void);
+
+  public:
+    AudioDspChain(unsigned int rate);
+    AudioDspChain(AudioDspChain const &) = delete;
+    AudioDspChain &operator=(AudioDspChain const &) = delete;
+    ~AudioDspChain();
+
+    inline bool
+    empty(void) const
+    {
+      return this->stages.empty();
+    }
+
+    void setSampleRate(unsigned int rate);
+    void process(float *block, size_t size);
+  };
+}
+
+#endif // AUDIODSPFACTORY_H
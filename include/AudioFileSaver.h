@@ -23,19 +23,39 @@
 #include <string>
 #include <SigDiggerHelpers.h>
 
+// Gated and split recordings: samples below this level are silence (the
+// audio inspector zeroes its output while the squelch is closed), and a
+// transmission is over after this long of it.
+#define SIGDIGGER_AUDIO_SAVER_SILENCE_LEVEL 1e-4f
+#define SIGDIGGER_AUDIO_SAVER_HANG_MS       500
+
 namespace SigDigger {
   class AudioFileWriter;
   class AudioFileSaver : public GenericDataSaver {
     Q_OBJECT
 
-    AudioFileWriter *writer = nullptr;
+    AudioFileWriter *writer;
 
   public:
+    enum RecordMode {
+      RECORD_CONTINUOUS,
+      RECORD_SQUELCH_GATED, // Only while the squelch is open
+      RECORD_SPLIT          // One timestamped file per transmission
+    };
+
+    enum RecordFormat {
+      RECORD_FORMAT_WAV,
+      RECORD_FORMAT_FLAC,
+      RECORD_FORMAT_OPUS
+    };
+
     struct AudioFileParams {
       std::string savePath;
       AudioDemod modulation;
       SUFREQ frequency;
       unsigned int sampRate;
+      RecordMode mode = RECORD_CONTINUOUS;
+      RecordFormat format = RECORD_FORMAT_WAV;
     };
 
     AudioFileParams params;
@@ -21,35 +21,107 @@
 #define AUDIOPLAYBACK_H
 
 #include <QObject>
-#include <QMutex>
+#include <QAtomicInteger>
 #include <QThread>
+#include <QElapsedTimer>
+#include <QMap>
 #include <string>
+#include <vector>
+#include <memory>
 #include <Suscan/Library.h>
+#include <Suscan/Messages/SamplesMessage.h>
+#include <GenericAudioPlayer.h>
+#include <AudioDspFactory.h>
 #include <util/compat-unistd.h>
 
 #define SIGDIGGER_AUDIO_BUFFER_ALLOC static_cast<size_t>(1 << 14)
 #define SIGDIGGER_AUDIO_BUFFER_SIZE (SIGDIGGER_AUDIO_BUFFER_ALLOC / sizeof (float))
 #define SIGDIGGER_AUDIO_SAMPLE_RATE         44100
-#define SIGDIGGER_AUDIO_BUFFER_NUM          20
+#define SIGDIGGER_AUDIO_CHANNELS            2 // Interleaved, left first
+
+// Pull mode: the device asks for samples (PortAudio callbacks, ALSA mmap)
+// and reads them from the buffer ring directly, instead of having them
+// written by the playback worker. Define as 0 to go back to blocking
+// writes. Buffers can be much shorter then: there are more of them.
+#ifndef SIGDIGGER_AUDIO_PULL_MODE
+#  define SIGDIGGER_AUDIO_PULL_MODE         1
+#endif // SIGDIGGER_AUDIO_PULL_MODE
+
+#if SIGDIGGER_AUDIO_PULL_MODE
+#  define SIGDIGGER_AUDIO_BUFFER_NUM        64
+#  define SIGDIGGER_AUDIO_BUFFER_DELAY_MS   5
+#else
+#  define SIGDIGGER_AUDIO_BUFFER_NUM        20
+#  define SIGDIGGER_AUDIO_BUFFER_DELAY_MS   20
+#endif // SIGDIGGER_AUDIO_PULL_MODE
+
 #define SIGDIGGER_AUDIO_BUFFER_MIN          10
 #define SIGDIGGER_AUDIO_BUFFERING_WATERMARK 2
 
 #define SIGDIGGER_AUDIO_BUFFER_SIZE_MIN     256
-#define SIGDIGGER_AUDIO_BUFFER_DELAY_MS     20
+
+// Jitter buffer. The fill level (in buffers) targeted by the feeder starts
+// at SIGDIGGER_AUDIO_BUFFER_MIN and moves between these bounds.
+#define SIGDIGGER_AUDIO_BUFFER_TARGET_MIN   2
+#define SIGDIGGER_AUDIO_BUFFER_TARGET_MAX   (SIGDIGGER_AUDIO_BUFFER_NUM - 2)
+#define SIGDIGGER_AUDIO_BUFFER_SLACK        3    // Above target: drop input
+#define SIGDIGGER_AUDIO_UNDERRUN_GROWTH     2    // Buffers, per underrun
+#define SIGDIGGER_AUDIO_QUIET_SHRINK_MS     5000 // Shrink after no underruns
+#define SIGDIGGER_AUDIO_JITTER_AVERAGE      16
+#define SIGDIGGER_AUDIO_FILL_AVERAGE        32
+
+// Drift correction: resampling ratio per buffer of fill level error, and
+// largest correction allowed.
+#define SIGDIGGER_AUDIO_DRIFT_GAIN_PPM      500
+#define SIGDIGGER_AUDIO_DRIFT_MAX_PPM       2000
+
+// Samples a mixer channel may get ahead of the clock channel
+#define SIGDIGGER_AUDIO_MIXER_BACKLOG       (1 << 15)
 
 namespace SigDigger {
   class AudioBufferList;
-  class GenericAudioPlayer;
+
+  //
+  // Consumer side of the buffer ring in pull mode, called from the device
+  // thread. It plays whole ring buffers in as many device periods as it
+  // takes, and silence while paused or starving. Underruns pause it and
+  // are reported through takeStarved(), so the feeder can buffer again.
+  //
+  class AudioBufferReader : public AudioSource {
+    AudioBufferList *instance; // Weak
+
+    const float *current = nullptr;
+    size_t offset = 0;    // Frames
+    size_t bufferSize = 0;
+
+    QAtomicInteger<int> playing = 0;
+    QAtomicInteger<int> starved = 0;
+
+  public:
+    AudioBufferReader(AudioBufferList *instance = nullptr);
+
+    // Only while the device is not pulling
+    void reset(size_t bufferSize);
+
+    void resume(void);
+    bool takeStarved(void);
+
+    size_t read(float *frames, size_t len) override;
+  };
 
   class PlaybackWorker : public QObject {
       Q_OBJECT
 
       GenericAudioPlayer *player = nullptr;  // Owned
       AudioBufferList *instance; // Weak
-      float gain = 1;
+      AudioBufferReader reader;
       unsigned int bufferSize;
       std::string device;
       unsigned int sampRate;
+      bool pulling = false;
+
+      void pushLoop(void);
+      void pullLoop(void);
 
     public:
       static unsigned int calcBufferSizeForRate(unsigned int rate);
@@ -64,7 +136,6 @@ namespace SigDigger {
       void startPlayback();
       void stopPlayback();
       void setSampleRate(unsigned int rate);
-      void setGain(float);
       void play(void);
       void halt(void);
 
@@ -75,71 +146,175 @@ namespace SigDigger {
       void finished(void);
   };
 
-  // TODO: turn into std::list
   struct AudioBuffer {
-    AudioBuffer *next = nullptr;
-    AudioBuffer *prev = nullptr;
     float *data = nullptr;
 
     AudioBuffer();
     ~AudioBuffer();
   };
 
+  //
+  // Single-producer, single-consumer ring of preallocated buffers. The
+  // producer (PlaybackFeeder) is the only one calling reserve(), commit()
+  // and cancel(), the consumer (PlaybackWorker, or the device thread through
+  // AudioBufferReader in pull mode) is the only one calling next(),
+  // release() and clear(). Each side owns one index and only reads the
+  // other, so neither of them ever waits for the other.
+  //
   class AudioBufferList {
     std::vector<AudioBuffer> allocation;
-
-    // Free list head. All buffers are initially here
-    AudioBuffer *freeList = nullptr;
-    unsigned int freeLen = 0;
     unsigned int totalLen = 0;
 
-    // Current buffer. The one being filled up
-    AudioBuffer *current = nullptr;
+    // Next slot to be filled by the producer. Written by the producer only.
+    QAtomicInteger<unsigned int> head = 0;
 
-    // Playlist head. These buffers are the ones being played by
-    // the playback worker
-    AudioBuffer *playListHead = nullptr;
-    AudioBuffer *playListTail = nullptr;
-    unsigned int playListLen = 0;
+    // Next slot to be played by the consumer. Written by the consumer only.
+    QAtomicInteger<unsigned int> tail = 0;
 
-    // Buffer being played.
-    AudioBuffer *playBuffer = nullptr;
+    // Producer and consumer state, respectively
+    bool reserved = false;
+    bool playing  = false;
 
-    // Mutex to ensure ordered access
-    QMutex listMutex;
+    inline unsigned int
+    advance(unsigned int index) const
+    {
+      return index + 1 == this->allocation.size() ? 0 : index + 1;
+    }
 
   public:
     AudioBufferList(unsigned int num);
 
     unsigned int
-    getFreeLen(void) const
+    getPlayListLen(void) const
     {
-      return this->freeLen;
+      unsigned int head = this->head.loadAcquire();
+      unsigned int tail = this->tail.loadAcquire();
+      unsigned int size = static_cast<unsigned int>(this->allocation.size());
+
+      return head >= tail ? head - tail : head + size - tail;
     }
 
     unsigned int
-    getPlayListLen(void) const
+    getFreeLen(void) const
     {
-      return this->playListLen;
+      return this->totalLen - this->getPlayListLen();
     }
 
+    // Drops every committed buffer. Consumer side.
     void clear(void);
 
-    void reset(void);
-
-    // Takes one from the freelist, replaces current, returns pointer
+    // Returns the next free buffer, or nullptr if the ring is full
     float *reserve(void);
 
-    // Takes current and puts it in the playList
+    // Makes the reserved buffer available to the consumer
     void commit(void);
 
-    // Takes one from the playList
+    // Gives back the reserved buffer without committing it
+    void cancel(void);
+
+    // Returns the oldest committed buffer, or nullptr if starving
     float *next(void);
 
-    // Moves current playing buffer to the freeList
+    // Gives the buffer returned by next() back to the producer
     void release(void);
   };
 
+  //
+  // Producer side of the buffer ring. Lives in its own thread, so that
+  // sample batches are converted and queued for playback no matter how busy
+  // the GUI thread is.
+  //
+  // It is also the mixer: every inspector feeding audio is a channel with
+  // its own panning. One of them (the first one added) is the clock: the
+  // rest are held back until a batch of the clock channel comes, and then
+  // mixed into it sample by sample.
+  //
+  class PlaybackFeeder : public QObject {
+      Q_OBJECT
+
+      struct Channel {
+        float left  = 1;
+        float right = 1;
+        std::vector<float> backlog;
+        std::shared_ptr<AudioDspChain> dsp; // Plugin stages, at inRate
+      };
+
+      AudioBufferList *instance; // Weak
+
+      QMap<unsigned int, Channel> channels;
+      unsigned int clock = 0;
+      bool haveClock = false;
+
+      float *current = nullptr;
+      unsigned int ptr = 0;
+      unsigned int completed = 0;
+      unsigned int bufferSize;
+      unsigned int sampRate; // Of the device
+      unsigned int inRate;   // Of the samples we are fed
+      bool buffering = true;
+      bool ready = false;
+      SUFLOAT gain = 1;
+
+      // Adaptive jitter buffer. target is the fill level we restart the
+      // playback at and steer towards. It never goes below what the
+      // measured arrival jitter requires, nor below starveTarget, which
+      // grows on underruns and decays while there are none.
+      unsigned int target       = SIGDIGGER_AUDIO_BUFFER_MIN;
+      unsigned int starveTarget = SIGDIGGER_AUDIO_BUFFER_MIN;
+      qreal jitter = 0;        // Mean arrival time deviation (seconds)
+      qreal lastDuration = 0;  // Duration of the previous batch (seconds)
+      qreal fill = SIGDIGGER_AUDIO_BUFFER_MIN; // Mean fill level (buffers)
+      QElapsedTimer arrivalTimer;
+      QElapsedTimer quietTimer;
+
+      // Rate conversion and drift correction. step is inRate / sampRate,
+      // ratio the input advance per output frame (step, slightly off to
+      // correct drift), pos the position of the next output frame
+      // relative to the first input frame of the batch (-1 <= pos < 0
+      // interpolates from last).
+      qreal step = 1;
+      qreal ratio = 1;
+      qreal pos = 0;
+      float last[SIGDIGGER_AUDIO_CHANNELS] = {0};
+      std::vector<float> scratch;
+      std::vector<float> mixed;
+      std::vector<float> resampled;
+
+      void measureArrival(SUSCOUNT size);
+      void updateTarget(void);
+      void updateRatio(void);
+      void mix(SUSCOUNT size);
+      SUSCOUNT resample(const float *frames, SUSCOUNT size);
+      void push(const float *frames, SUSCOUNT size);
+      void write(const SUCOMPLEX *samples, SUSCOUNT size);
+
+    public:
+      PlaybackFeeder(
+          AudioBufferList *instance = nullptr,
+          unsigned int sampRate = SIGDIGGER_AUDIO_SAMPLE_RATE);
+
+    public slots:
+      void feed(Suscan::SamplesMessage);
+      void cancel(void);
+      // Device rate. The input rate follows it.
+      void setSampleRate(unsigned int rate);
+
+      // Rate of the samples passed to feed(), if different from the
+      // device's. Keeps the stream going.
+      void setInputRate(unsigned int rate);
+      void setGain(float);
+
+      // pan goes from -1 (left) to +1 (right)
+      void setChannel(unsigned int id, float pan);
+      void removeChannel(unsigned int id);
+
+      void onReady(void);
+      void onStarving(void);
+
+    signals:
+      void restart(void);
+  };
+
   class AudioPlayback : public QObject {
     Q_OBJECT
 
@@ -147,18 +322,15 @@ namespace SigDigger {
     AudioBufferList bufferList;
     QThread *workerThread  = nullptr;
     PlaybackWorker *worker = nullptr;
+    QThread *feederThread  = nullptr;
+    PlaybackFeeder *feeder = nullptr;
 
-    bool buffering = true;
     bool running = false;
-    bool ready = false;
-    float *current_buffer = nullptr;
     float volume = 1;
 
     std::string  device;
-    unsigned int completed = 0;
-    unsigned int ptr = 0;
     unsigned int sampRate;
-    unsigned int bufferSize;
+    unsigned int inRate;
 
     void startWorker(void);
 
@@ -168,14 +340,26 @@ namespace SigDigger {
           unsigned int rate = SIGDIGGER_AUDIO_SAMPLE_RATE);
       virtual ~AudioPlayback();
       unsigned int getSampleRate(void) const;
+
+      // Changing the device rate restarts the playback. Changing the rate
+      // of the samples passed to write() only changes the resampling.
       void setSampleRate(unsigned int);
-      void write(const SUCOMPLEX *samples, SUSCOUNT size);
+      void setInputRate(unsigned int);
+      unsigned int getInputRate(void) const;
+
+      // Hands the batch over to the feeder thread. Cheap: the message
+      // payload is shared, not copied.
+      void write(Suscan::SamplesMessage const &);
       void start(void);
       void stop(void);
       float getVolume(void) const;
       void setVolume(float);
       void cancelPlayBack(void);
 
+      // Samples of inspectors not registered as channels are not played
+      void setChannel(Suscan::InspectorId, SUFLOAT pan = 0);
+      void removeChannel(Suscan::InspectorId);
+
       inline bool
       isRunning(void) const
       {
@@ -184,14 +368,16 @@ namespace SigDigger {
 
     public slots:
       void onError(QString);
-      void onStarving(void);
-      void onReady(void);
 
     signals:
-      void restart(void);
+      void samples(Suscan::SamplesMessage);
+      void channel(unsigned int, float);
+      void channelRemoved(unsigned int);
+      void cancel(void);
       void halt(void);
       void error(QString);
       void sampleRate(unsigned int);
+      void inputRate(unsigned int);
       void gain(float);
       void startPlayback(void);
       void stopPlayback(void);
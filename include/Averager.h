@@ -21,15 +21,77 @@
 
 #include <Suscan/Messages/PSDMessage.h>
 
+// All buffers are aligned to this boundary (enough for AVX)
+#define SIGDIGGER_AVERAGER_ALIGNMENT 32
+
+// Percentile estimates never go below this, as they move by factors
+#define SIGDIGGER_AVERAGER_QUANTILE_FLOOR 1e-30f
+
 namespace SigDigger {
   class Averager {
+  public:
+    // What the spectrum shows: the average, or the peak or min hold of
+    // the incoming PSDs (taken in the same pass)
+    enum Trace {
+      AVERAGE,
+      MAX_HOLD,
+      MIN_HOLD
+    };
+
+  private:
+    // Storage is only ever grown, so that switching back and forth between
+    // FFT sizes does not hit the allocator on every PSD.
+    void *storage = nullptr;
+    unsigned long capacity = 0;
+
     float *last = nullptr;
+    float *peakHold = nullptr;
+    float *minHold  = nullptr;
     unsigned long bufsiz = 0;
     float alpha = 1.;
+    float percentile = 0;
+    float quantileUp = 1;
+    float quantileDown = 1;
+    bool  hold = false;
+    bool  holdValid = false;
+    Trace trace = AVERAGE;
+
+    void assertCapacity(unsigned long size);
+    void rescale(unsigned long size);
+    void updateQuantileSteps(void);
 
   public:
     void feed(Suscan::PSDMessage const &m);
     void setAlpha(float alpha);
+
+    // Instead of the exponential mean, track the given percentile (0 - 1,
+    // 0.5 for the median) of every bin. The estimate moves up or down by
+    // a constant factor on every PSD, depending on which side of it the
+    // new value falls, and settles where the fractions above and below
+    // match the percentile. A single value per bin, unaffected by how
+    // far off outliers are. 0 goes back to the mean.
+    void setPercentile(float percentile);
+
+    float
+    getPercentile(void) const
+    {
+      return this->percentile;
+    }
+    void setHold(bool enabled);
+    void resetHold(void);
+    void reset(void);
+
+    // Selecting a different trace starts the holds over
+    void setTrace(Trace trace);
+
+    Trace
+    getTrace(void) const
+    {
+      return this->trace;
+    }
+
+    // Data of the selected trace. The average until a hold is valid.
+    float *getTraceData(void) const;
     ~Averager(void);
 
     float *
@@ -38,19 +100,24 @@ namespace SigDigger {
       return this->last;
     }
 
-    unsigned long
-    size(void) const
+    // Peak and min hold of the incoming PSD. Only meaningful if hold
+    // has been enabled and at least one PSD has been fed since.
+    float *
+    getPeak(void) const
     {
-      return this->bufsiz;
+      return this->holdValid ? this->peakHold : nullptr;
     }
 
-    void
-    reset(void)
+    float *
+    getMin(void) const
     {
-      if (this->last != nullptr) {
-        delete [] this->last;
-        this->bufsiz = 0;
-      }
+      return this->holdValid ? this->minHold : nullptr;
+    }
+
+    unsigned long
+    size(void) const
+    {
+      return this->bufsiz;
     }
   };
 }
@@ -69,6 +69,7 @@ namespace SigDigger {
       void onClose(void);
       void onCancelAll(void);
       void onLayoutChanged(void);
+      void onDataChanged(void);
       void onCancelClicked(QModelIndex);
       void onError(QString title, QString err);
   };
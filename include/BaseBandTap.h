@@ -0,0 +1,107 @@
+//
+//    BaseBandTap.h: Baseband sample distribution to consumer threads
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef BASEBANDTAP_H
+#define BASEBANDTAP_H
+
+#include <sigutils/types.h>
+#include <QtGlobal>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Default ring length per consumer, in samples (power of two)
+#define SIGDIGGER_BASEBAND_TAP_DEFAULT_RING (1 << 21)
+
+// Longest a consumer sleeps without checking its ring (covers missed
+// wake-ups, the producer never blocks to deliver them)
+#define SIGDIGGER_BASEBAND_TAP_IDLE_MS      50
+
+namespace SigDigger {
+  class BaseBandConsumer {
+  public:
+    // Called from the consumer's own thread, in arrival order. Samples
+    // belong to the tap and are only valid during the call.
+    virtual void baseband(const SUCOMPLEX *samples, SUSCOUNT length) = 0;
+
+    virtual ~BaseBandConsumer();
+  };
+
+  //
+  // Copies every baseband block delivered by the analyzer into one
+  // single-producer single-consumer ring per consumer. Each consumer
+  // drains its ring from a thread of its own, so a slow consumer only
+  // loses its own samples (blocks that do not fit in its ring are dropped
+  // whole) and never holds the DSP thread back.
+  //
+  class BaseBandTap {
+    struct Reader {
+      BaseBandConsumer *consumer;
+      std::vector<SUCOMPLEX> ring;
+      size_t mask;
+
+      // Written by the producer (head) and by the consumer (tail) only
+      std::atomic<size_t> head;
+      std::atomic<size_t> tail;
+      std::atomic<quint64> dropped;
+
+      std::atomic<bool> waiting;
+      std::atomic<bool> exit;
+      std::mutex mutex;
+      std::condition_variable ready;
+      std::thread thread;
+    };
+
+    // Only contended by attach() and detach()
+    std::mutex readersMutex;
+    std::vector<Reader *> readers;
+    std::atomic<unsigned int> readerCount;
+
+    static void run(Reader *);
+    static void stop(Reader *);
+
+  public:
+    BaseBandTap(void);
+    BaseBandTap(BaseBandTap const &) = delete;
+    BaseBandTap &operator=(BaseBandTap const &) = delete;
+    ~BaseBandTap();
+
+    inline bool
+    idle(void) const
+    {
+      return this->readerCount == 0;
+    }
+
+    // Called from the DSP thread
+    void feed(const SUCOMPLEX *samples, SUSCOUNT length);
+
+    // The consumer is borrowed. detach() delivers whatever is left in
+    // its ring and joins its thread before returning.
+    void attach(
+        BaseBandConsumer *consumer,
+        size_t ringLength = SIGDIGGER_BASEBAND_TAP_DEFAULT_RING);
+    bool detach(BaseBandConsumer *consumer);
+
+    // Samples this consumer lost because its ring was full
+    quint64 dropped(BaseBandConsumer *consumer);
+  };
+}
+
+#endif // BASEBANDTAP_H
@@ -0,0 +1,93 @@
+//
+//    BatchTransformTask.h: Run a transform chain over a list of captures
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef BATCHTRANSFORMTASK_H
+#define BATCHTRANSFORMTASK_H
+
+#include <Suscan/CancellableTask.h>
+#include <Suscan/TaskPool.h>
+#include <TransformChainTask.h>
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStringList>
+#include <vector>
+
+// Captures processed at once, and the memory all of them may take
+#define SIGDIGGER_BATCH_MAX_CAPTURES       4
+#define SIGDIGGER_BATCH_MEMORY_MAX         (1ull << 30)
+
+// Longest capture accepted (same bound as TimeWindow's)
+#define SIGDIGGER_BATCH_MAX_SAMPLES        (1 << 27)
+#define SIGDIGGER_BATCH_READ_BLOCK         (1 << 20)
+#define SIGDIGGER_BATCH_POLL_INTERVAL_MS   100
+
+namespace SigDigger {
+  //
+  // Loads every capture, runs the chain over it (in place, with
+  // TransformChainTask) and saves the result with ExportSamplesTask, as
+  // <output dir>/<name>-processed.<format>. Captures are shared with the
+  // task pool, one capture per unit. A capture is only loaded once the
+  // ones in memory leave room for it. Failed captures do not stop the
+  // batch: they are listed once it is over.
+  //
+  class BatchTransformTask : public Suscan::CancellableTask {
+    Q_OBJECT
+
+    QStringList inputs;
+    QString outputDir;
+    QString format;
+    std::vector<TransformStep> steps;
+    qreal defaultRate;
+    bool started = false;
+
+    Suscan::TaskSlices slices;
+    QAtomicInteger<int> processed = 0;
+
+    QMutex memoryMutex;
+    QWaitCondition memoryCond;
+    quint64 memoryInUse = 0;
+
+    QMutex failureMutex;
+    QStringList failures;
+
+    bool acquireMemory(quint64 bytes);
+    void releaseMemory(quint64 bytes);
+    void fail(QString const &path, QString const &reason);
+
+    QString outputPath(QString const &input) const;
+    void processInput(QString const &path);
+    void runInput(int index);
+
+  public:
+    // defaultRate is used for captures that do not carry their own
+    BatchTransformTask(
+        QStringList const &inputs,
+        QString const &outputDir,
+        QString const &format,
+        std::vector<TransformStep> const &steps,
+        qreal defaultRate,
+        QObject *parent = nullptr);
+    virtual ~BatchTransformTask() override;
+
+    virtual bool work(void) override;
+    virtual void cancel(void) override;
+  };
+}
+
+#endif // BATCHTRANSFORMTASK_H
@@ -0,0 +1,120 @@
+//
+//    BaudEstimatorTask.h: Symbol rate estimation from the squared envelope
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef BAUDESTIMATORTASK_H
+#define BAUDESTIMATORTASK_H
+
+#include <Suscan/CancellableTask.h>
+#include <Suscan/TaskPool.h>
+#include <sigutils/types.h>
+#include <QAtomicInteger>
+#include <QMutex>
+#include <memory>
+#include <vector>
+
+// Segment length bounds (the resolution is fs / segment length)
+#define SIGDIGGER_BAUD_ESTIMATOR_SEGMENT_MAX      (1 << 14)
+#define SIGDIGGER_BAUD_ESTIMATOR_SEGMENT_MIN      256
+
+// Long selections are sampled with at most this many segments
+#define SIGDIGGER_BAUD_ESTIMATOR_MAX_SEGMENTS     64
+
+// Bins next to DC, where the window leaks the envelope mean
+#define SIGDIGGER_BAUD_ESTIMATOR_DC_BINS          4
+
+// Lines must be this much above the median of the spectrum (10 dB)
+#define SIGDIGGER_BAUD_ESTIMATOR_MIN_PEAK_RATIO   10.f
+
+#define SIGDIGGER_BAUD_ESTIMATOR_MAX_CANDIDATES   4
+#define SIGDIGGER_BAUD_ESTIMATOR_POLL_INTERVAL_MS 20
+
+namespace SigDigger {
+  struct BaudCandidate {
+    qreal rate;       // Hz
+    qreal confidence; // Share of the line power of all candidates
+    float snr;        // Above the spectrum median, dB
+  };
+
+  //
+  // Linearly modulated signals with a band-limited pulse have a spectral
+  // line at the symbol rate in their squared envelope |x|^2 (the first
+  // cyclic frequency of the cyclic spectrum of x). The envelope of up to
+  // MAX_SEGMENTS segments of the selection is transformed on the task
+  // pool and the power spectra are averaged. The strongest lines which
+  // are not harmonics of a stronger one are the candidates, best first.
+  //
+  class BaudEstimatorTask : public Suscan::CancellableTask {
+    Q_OBJECT
+
+    std::shared_ptr<const std::vector<SUCOMPLEX>> buffer;
+    size_t start;
+    size_t length;
+    qreal fs;
+
+    size_t segmentSize = 0;
+    size_t segments = 0;
+    size_t stride = 0;
+    SU_FFTW(_plan) plan = nullptr;
+    bool launched = false;
+
+    std::vector<SUFLOAT> psd;
+    std::vector<BaudCandidate> candidates;
+
+    Suscan::TaskSlices slices;
+    QMutex psdMutex;
+    QAtomicInteger<int> failed = 0;
+    QAtomicInteger<int> processed = 0;
+
+    bool prepare(void);
+    void runSegment(int index);
+    void findCandidates(void);
+
+  public:
+    // Keeps the buffer alive until destroyed
+    BaudEstimatorTask(
+        std::shared_ptr<const std::vector<SUCOMPLEX>> const &buffer,
+        size_t start,
+        size_t length,
+        qreal fs,
+        QObject *parent = nullptr);
+    virtual ~BaudEstimatorTask() override;
+
+    std::vector<BaudCandidate> const &
+    getCandidates(void) const
+    {
+      return this->candidates;
+    }
+
+    size_t
+    getStart(void) const
+    {
+      return this->start;
+    }
+
+    size_t
+    getLength(void) const
+    {
+      return this->length;
+    }
+
+    virtual bool work(void) override;
+    virtual void cancel(void) override;
+  };
+}
+
+#endif // BAUDESTIMATORTASK_H
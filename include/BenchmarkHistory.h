@@ -0,0 +1,109 @@
+//
+//    BenchmarkHistory.h: Stored benchmark results and regression checks
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef BENCHMARKHISTORY_H
+#define BENCHMARKHISTORY_H
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QJsonObject>
+
+// Relative change of a metric (for the worse) allowed by default
+#define SIGDIGGER_BENCHMARK_HISTORY_DEFAULT_TOLERANCE .1
+
+// Recorded runs the baseline of a metric is the median of
+#define SIGDIGGER_BENCHMARK_HISTORY_BASELINE_RUNS     5
+
+// Set by SigDigger.pro to a directory next to the sources. Builds made
+// without it do not keep a history unless told where to.
+#ifndef SIGDIGGER_BENCHMARK_HISTORY_DIR
+#  define SIGDIGGER_BENCHMARK_HISTORY_DIR ""
+#endif // SIGDIGGER_BENCHMARK_HISTORY_DIR
+
+namespace SigDigger {
+  //
+  // Results of past runs of a benchmark suite, kept in <dir>/<suite>.jsonl
+  // as one JSON object per line, each tagged with the build and host it
+  // came from. Runs are compared only with runs of the same configuration
+  // (suite parameters, host and kernel ISA). The baseline of a metric is
+  // the median of its last few values, from runs that did not regress.
+  // A run regresses when any metric is worse than its baseline by more
+  // than its tolerance, relative to the baseline.
+  //
+  class BenchmarkHistory
+  {
+  public:
+    enum Direction {
+      LOWER_IS_BETTER,
+      HIGHER_IS_BETTER
+    };
+
+  private:
+    struct Metric {
+      qreal value;
+      Direction direction;
+    };
+
+    QString suite;
+    QString directory = SIGDIGGER_BENCHMARK_HISTORY_DIR;
+    QString config;
+    QMap<QString, Metric> metrics;
+    QList<QPair<QString, qreal>> tolerances; // Longest prefix first
+    qreal defaultTolerance = SIGDIGGER_BENCHMARK_HISTORY_DEFAULT_TOLERANCE;
+    bool recording = true;
+    bool regressed = false;
+    QJsonObject comparison;
+
+    qreal toleranceOf(QString const &) const;
+    QString historyPath(void) const;
+    void loadBaselines(QMap<QString, QList<qreal>> &) const;
+    bool record(void) const;
+
+  public:
+    BenchmarkHistory(QString const &suite);
+
+    // Empty: no history, nothing compared
+    void setDirectory(QString const &);
+    void setRecording(bool);
+    void setConfig(QJsonObject const &);
+
+    // Comma-separated [METRIC_PREFIX=]TOLERANCE. Returns false if invalid.
+    bool setTolerances(QString const &spec);
+
+    void addMetric(QString const &name, qreal value, Direction);
+
+    // Compares with the baseline, then records the run. Returns false
+    // on I/O errors only.
+    bool process(void);
+
+    bool
+    isRegressed(void) const
+    {
+      return this->regressed;
+    }
+
+    // Per-metric comparison, for the report
+    QJsonObject toJson(void) const;
+
+    static void help(void);
+  };
+}
+
+#endif // BENCHMARKHISTORY_H
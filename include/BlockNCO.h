@@ -0,0 +1,58 @@
+//
+//    BlockNCO.h: Oscillator and mixer working on blocks
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef BLOCKNCO_H
+#define BLOCKNCO_H
+
+#include <sigutils/types.h>
+#include <vector>
+
+// Samples mixed with each rotation of the oscillator table
+#define SIGDIGGER_BLOCK_NCO_TABLE_LENGTH 2048
+
+namespace SigDigger {
+  //
+  // Mixer for blocks of samples. The oscillator samples e^(j n w) of
+  // one table length are computed once, when the frequency is set. Each
+  // block is then multiplied by the table, rotated by the phase the
+  // oscillator has at the start of the block (SampleKernels::mix). That
+  // phase is advanced in double precision once per block: the rotation
+  // is renormalized every time, so neither phase nor amplitude drift.
+  //
+  // Frequencies and phases are those of su_ncqo_t: frequencies are
+  // normalized to the Nyquist frequency, and the first sample is rotated
+  // by the initial phase.
+  //
+  class BlockNCO
+  {
+    std::vector<SUCOMPLEX> table;
+    double omega = 0;
+    double phase = 0;
+
+  public:
+    BlockNCO(SUFLOAT fnor = 0, SUFLOAT phase = 0);
+
+    void setFrequency(SUFLOAT fnor);
+    void setPhase(SUFLOAT phase);
+
+    // dest[i] = x[i] * e^(j (phase + i w)). dest may be x.
+    void mix(SUCOMPLEX *dest, const SUCOMPLEX *x, size_t size);
+  };
+}
+
+#endif // BLOCKNCO_H
@@ -0,0 +1,95 @@
+//
+//    BookmarkImportTask.h: Parse bookmark lists in the background
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef BOOKMARKIMPORTTASK_H
+#define BOOKMARKIMPORTTASK_H
+
+#include <Suscan/CancellableTask.h>
+#include <WFHelpers.h>
+#include <QColor>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#define SIGDIGGER_BOOKMARK_IMPORT_LINES_PER_STEP 4096
+#define SIGDIGGER_BOOKMARK_IMPORT_DEFAULT_COLOR  "#ffffff"
+
+namespace SigDigger {
+  //
+  // Reads a bookmark list from a delimited text file: comma, semicolon
+  // or tab separated, with an optional header naming the columns
+  // (frequency, name, modulation, bandwidth, color, tags). Channel plans
+  // exported by Gqrx (tag table followed by a "# Frequency; Name; ..."
+  // header) are understood too, taking the color of each entry from its
+  // first tag. Without a header, columns are assumed to be frequency,
+  // name, bandwidth, modulation and color.
+  //
+  // Nothing is registered here: the whole list is handed over at once so
+  // that the caller can insert it in a single pass.
+  //
+  class BookmarkImportTask : public Suscan::CancellableTask {
+    Q_OBJECT
+
+    enum Column {
+      COLUMN_FREQUENCY,
+      COLUMN_NAME,
+      COLUMN_MODULATION,
+      COLUMN_BANDWIDTH,
+      COLUMN_COLOR,
+      COLUMN_TAGS,
+      COLUMN_COUNT
+    };
+
+    QString path;
+    QFile file;
+    QList<BookmarkInfo> bookmarks;
+    QHash<QString, QColor> tagColors;
+    int columns[COLUMN_COUNT];
+    qreal frequencyScale = 1;
+    QChar delimiter;
+    bool haveHeader = false;
+    bool inTagTable = false;
+    bool cancelFlag = false;
+    int rejected = 0;
+
+    QStringList split(QString const &) const;
+    QString field(QStringList const &, Column) const;
+    void guessDelimiter(QString const &);
+    void assumeLayout(void);
+    bool parseHeader(QStringList const &);
+    void parseTag(QStringList const &);
+    void parseEntry(QStringList const &);
+    void parseLine(QString const &);
+
+    static qreal parseQuantity(QString const &, qreal scale, bool *ok);
+
+  public:
+    BookmarkImportTask(QString const &path, QObject *parent = nullptr);
+    virtual ~BookmarkImportTask() override;
+
+    virtual bool work(void) override;
+    virtual void cancel(void) override;
+
+  signals:
+    void parsed(QString path, QList<BookmarkInfo> bookmarks, int rejected);
+  };
+}
+
+#endif // BOOKMARKIMPORTTASK_H
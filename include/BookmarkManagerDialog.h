@@ -21,16 +21,18 @@
 
 #include <QDialog>
 #include <QModelIndex>
+#include <QList>
 #include <WFHelpers.h>
 
+class QPushButton;
+
 namespace Ui {
   class BookmarkManagerDialog;
 }
 
-class QSortFilterProxyModel;
-
 namespace SigDigger {
   class BookmarkTableModel;
+  class BookmarkFilterProxyModel;
   class AddBookmarkDialog;
   class ButtonDelegate;
 
@@ -43,7 +45,8 @@ namespace SigDigger {
 
       AddBookmarkDialog *editDialog = nullptr;
       BookmarkTableModel *model = nullptr;
-      QSortFilterProxyModel *proxy = nullptr;
+      BookmarkFilterProxyModel *proxy = nullptr;
+      QPushButton *importButton = nullptr;
 
       qint64 editingFrequency;
 
@@ -65,6 +68,11 @@ namespace SigDigger {
       void onEditBookmark(QModelIndex);
       void onCellActivated(QModelIndex const &);
       void onEditAccepted(void);
+      void onFilterChanged(QString);
+      void onImport(void);
+      void onImportParsed(QString, QList<BookmarkInfo>, int);
+      void onImportError(QString);
+      void onImportCancelled(void);
 
     signals:
       void bookmarkSelected(BookmarkInfo);
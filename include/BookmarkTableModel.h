@@ -20,8 +20,10 @@
 #define BOOKMARKTABLEMODEL_H
 
 #include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
 #include <Suscan/Library.h>
 #include <QColor>
+#include <QVector>
 
 namespace SigDigger {
   class BookmarkTableModel : public QAbstractTableModel {
@@ -29,6 +31,16 @@ namespace SigDigger {
 
       const QMap<qint64,Suscan::Bookmark> *bookmarkPtr;
 
+      // Row-indexed view of the map, rebuilt whenever it changes. Rows are
+      // in map (i.e. frequency) order. Ranks give the position of each row
+      // when sorted by name or by modulation.
+      QVector<const Suscan::Bookmark *> rows;
+      QVector<int> nameRank;
+      QVector<int> modulationRank;
+      QVector<QString> searchKeys;
+
+      void rebuildRows(void);
+
     public:
       BookmarkTableModel(
           QObject *parent,
@@ -42,9 +54,50 @@ namespace SigDigger {
       void notifyRemovalStart(int);
       void notifyRemovalFinish(void);
 
+      const Suscan::Bookmark *bookmarkAt(int row) const;
+
+      inline int
+      getNameRank(int row) const
+      {
+        return this->nameRank[row];
+      }
+
+      inline int
+      getModulationRank(int row) const
+      {
+        return this->modulationRank[row];
+      }
+
+      // Lowercase name and modulation, for filtering
+      inline QString const &
+      getSearchKey(int row) const
+      {
+        return this->searchKeys[row];
+      }
+
     signals:
       void bookmarkEdited(QString, qint64, QColor);
   };
+
+  //
+  // Sorts and filters through the indexes of BookmarkTableModel, without
+  // asking for (or comparing) any cell contents.
+  //
+  class BookmarkFilterProxyModel : public QSortFilterProxyModel {
+      Q_OBJECT
+
+      BookmarkTableModel *bookmarks;
+      QString filter;
+
+    protected:
+      bool lessThan(QModelIndex const &, QModelIndex const &) const override;
+      bool filterAcceptsRow(int, QModelIndex const &) const override;
+
+    public:
+      BookmarkFilterProxyModel(QObject *parent, BookmarkTableModel *);
+
+      void setFilter(QString const &);
+  };
 }
 
 #endif // BOOKMARKTABLEMODEL_H
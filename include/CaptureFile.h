@@ -0,0 +1,114 @@
+//
+//    CaptureFile.h: Random access to capture files
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef CAPTUREFILE_H
+#define CAPTUREFILE_H
+
+#include <sigutils/types.h>
+#include <QtGlobal>
+#include <string>
+#include <memory>
+
+namespace SigDigger {
+  class SegmentedCaptureReader;
+  class QuantizedCaptureReader;
+
+  enum CaptureFileFormat {
+    CAPTURE_FILE_RAW,       // Headerless float32 IQ, memory-mapped
+    CAPTURE_FILE_SEGMENTED, // SegmentedDataSaver index
+    CAPTURE_FILE_QUANTIZED  // QuantizedDataSaver file
+  };
+
+  //
+  // Reads arbitrary ranges of a capture, whatever its format. Sample
+  // numbers start at 0 for the first readable sample. Raw files are
+  // mapped rather than read, so a range costs what it touches and the
+  // rest of the file may be larger than memory.
+  //
+  class CaptureFile {
+    CaptureFileFormat format = CAPTURE_FILE_RAW;
+    std::string lastError;
+
+    // Raw files
+    int fd = -1;
+    const SUCOMPLEX *map = nullptr;
+    size_t mapSize = 0;
+
+    std::unique_ptr<SegmentedCaptureReader> segmented;
+    std::unique_ptr<QuantizedCaptureReader> quantized;
+
+    quint64 length = 0;
+    unsigned int rate = 0;
+    SUFREQ freq = 0;
+
+    bool openRaw(std::string const &path);
+
+  public:
+    CaptureFile();
+    ~CaptureFile();
+
+    static CaptureFileFormat guessFormat(std::string const &path);
+
+    bool open(std::string const &path);
+    void close(void);
+
+    std::string
+    getError(void) const
+    {
+      return this->lastError;
+    }
+
+    CaptureFileFormat
+    getFormat(void) const
+    {
+      return this->format;
+    }
+
+    quint64
+    getLength(void) const
+    {
+      return this->length;
+    }
+
+    // 0 if the file does not say (raw files)
+    unsigned int
+    getSampleRate(void) const
+    {
+      return this->rate;
+    }
+
+    SUFREQ
+    getFrequency(void) const
+    {
+      return this->freq;
+    }
+
+    // Null for formats that must be decoded
+    const SUCOMPLEX *
+    getMapping(void) const
+    {
+      return this->map;
+    }
+
+    // Reads up to len samples starting at `from`. Returns the number of
+    // samples read, 0 past the end, -1 on error.
+    ssize_t read(quint64 from, SUCOMPLEX *data, size_t len);
+  };
+}
+
+#endif // CAPTUREFILE_H
@@ -0,0 +1,64 @@
+//
+//    CaptureReader.h: Random access to the samples of a capture file
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef CAPTUREREADER_H
+#define CAPTUREREADER_H
+
+#include <sigutils/types.h>
+#include <analyzer/source.h>
+#include <sndfile.h>
+#include <QString>
+#include <vector>
+
+namespace SigDigger {
+  //
+  // Random access to the samples of a capture. Raw files are read with
+  // pread() and converted here, anything else goes through libsndfile.
+  // Handles are not shared: every thread opens its own reader.
+  //
+  class CaptureReader {
+    int fd = -1;
+    SNDFILE *sf = nullptr;
+    int channels = 2;
+    size_t sampleSize = sizeof(SUCOMPLEX);
+    enum suscan_source_format format = SUSCAN_SOURCE_FORMAT_RAW_FLOAT32;
+    quint64 length = 0;
+    std::vector<uint8_t> rawBuffer;
+    std::vector<float> sfBuffer;
+
+    bool openSndFile(QString const &path);
+    bool openRaw(QString const &path);
+
+  public:
+    ~CaptureReader();
+
+    bool open(QString const &path, enum suscan_source_format format);
+
+    quint64
+    getLength(void) const
+    {
+      return this->length;
+    }
+
+    // Reads up to len samples starting at pos. Returns the number of
+    // samples actually read.
+    size_t read(quint64 pos, SUCOMPLEX *out, size_t len);
+  };
+}
+
+#endif // CAPTUREREADER_H
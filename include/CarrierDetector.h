@@ -20,9 +20,28 @@
 #define CARRIERDETECTOR_H
 
 #include <Suscan/CancellableTask.h>
+#include <Suscan/TaskPool.h>
 #include <sigutils/types.h>
+#include <QAtomicInteger>
+#include <QMutex>
+#include <vector>
+
+// Selections longer than this are averaged in segments by default
+#define SIGDIGGER_CARRIER_DETECTOR_MAX_SINGLE_FFT (1 << 20)
+#define SIGDIGGER_CARRIER_DETECTOR_POLL_INTERVAL_MS 100
+
+// Runs of consecutive segments handed out to the task pool, per thread
+#define SIGDIGGER_CARRIER_DETECTOR_BATCHES_PER_CPU  4
 
 namespace SigDigger {
+  //
+  // Finds the dominant frequency of a signal as the centroid of its PSD
+  // around the strongest bin. With a segment size of 0, the PSD is that
+  // of a single FFT over the whole selection (rounded up to a power of
+  // two). Otherwise it is a Welch estimate: windowed segments with 50%
+  // overlap are transformed in the task pool and their periodograms are
+  // averaged. Memory is then bounded by one segment per thread.
+  //
   class CarrierDetector : public Suscan::CancellableTask {
     Q_OBJECT
 
@@ -30,6 +49,7 @@ namespace SigDigger {
       ESTIMATING,
       COPYING,
       EXECUTING,
+      AVERAGING,
       COMPUTING
     };
 
@@ -40,8 +60,24 @@ namespace SigDigger {
     SUFLOAT peak = 0;
     size_t len;
     size_t allocation = 1;
+    size_t segmentSize = 0;
     qreal avgRelBw;
     qreal dcNotchRelBw;
+
+    // Welch mode
+    std::vector<SUFLOAT> psd;
+    QMutex psdMutex;
+    Suscan::TaskSlices slices;
+    size_t segments = 0;
+    size_t batches = 0;
+    size_t hop = 0;
+    QAtomicInteger<int> failed = 0;
+    QAtomicInteger<quint64> processed = 0;
+
+    void startSegments(void);
+    void runBatch(int batch);
+    void computePeak(const SUFLOAT *psd);
+
     State
     getState(void) const
     {
@@ -52,7 +88,7 @@ namespace SigDigger {
     transitionTo(State s)
     {
       this->state = s;
-      this->setProgress(static_cast<qreal>(s) / 3);
+      this->setProgress(static_cast<qreal>(s) / 4);
 
       switch (s) {
         case ESTIMATING:
@@ -67,6 +103,11 @@ namespace SigDigger {
           this->setStatus("Executing FFT");
           break;
 
+        case AVERAGING:
+          this->setProgressCount(0, this->segments);
+          this->setStatusFormat("Averaging segment spectra (%1/%2)...");
+          break;
+
         case COMPUTING:
           this->setStatus("Computing dominant frequency");
       }
@@ -78,6 +119,7 @@ namespace SigDigger {
         size_t len,
         qreal avgRelBw,
         qreal dcNotchRelBw,
+        size_t segmentSize = 0,
         QObject *parent = nullptr);
     virtual ~CarrierDetector() override;
 
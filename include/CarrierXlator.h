@@ -22,9 +22,9 @@
 #include <Suscan/CancellableTask.h>
 
 #include <sigutils/types.h>
-#include <sigutils/ncqo.h>
+#include <BlockNCO.h>
 
-#define SIGDIGGER_CARRIER_XLATOR_BLOCK_LENGTH 4096
+#define SIGDIGGER_CARRIER_XLATOR_BLOCK_LENGTH 65536
 
 namespace SigDigger {
   class CarrierXlator : public Suscan::CancellableTask {
@@ -36,7 +36,7 @@ namespace SigDigger {
     size_t length;
     size_t p = 0;
 
-    su_ncqo_t ncqo;
+    BlockNCO nco;
 
   public:
     CarrierXlator(
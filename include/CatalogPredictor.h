@@ -0,0 +1,103 @@
+//
+//    CatalogPredictor.h: Visibility of a whole TLE catalog
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef CATALOGPREDICTOR_H
+#define CATALOGPREDICTOR_H
+
+#include <QObject>
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QVector>
+#include <QString>
+#include <PassPredictor.h>
+#include <Suscan/TaskPool.h>
+#include <vector>
+
+// Elevation is sampled on a grid of this step. Passes shorter than it may
+// fall between two samples and be missed.
+#define SIGDIGGER_CATALOG_PREDICTOR_STEP      60.0      // s
+#define SIGDIGGER_CATALOG_PREDICTOR_HORIZON   86400.0   // 1 day
+
+// Satellites per unit of work
+#define SIGDIGGER_CATALOG_PREDICTOR_BATCH     32
+
+namespace SigDigger {
+  struct CatalogPass {
+    QString name;
+    bool visible = false; // Up at the time of the request
+    SatellitePass pass;
+  };
+
+  //
+  // Finds the next pass (or the current one) of every satellite of a
+  // catalog over a site, on the task pool. The elevation of each orbit is
+  // evaluated on a coarse time grid, and only the grid steps where the
+  // satellite rises are refined into exact AOS / LOS times. As with
+  // PassPredictor, only the latest request is served.
+  //
+  class CatalogPredictor : public QObject
+  {
+    Q_OBJECT
+
+    struct Entry {
+      QString name;
+      orbit_t orbit;
+    };
+
+    Suscan::TaskSlices slices;
+    std::vector<Entry> entries;
+    xyz_t site;
+    struct timeval from;
+    int steps = 0;
+    int batches = 0;
+
+    QAtomicInteger<int> scanned = 0;
+
+    QMutex mutex;
+    quint64 lastId = 0;
+    quint64 resultId = 0;
+    bool haveResult = false;
+    QVector<CatalogPass> found;
+    QVector<CatalogPass> result;
+
+    void runBatch(int batch);
+    bool scan(Entry const &, CatalogPass &) const;
+    void finish(void);
+    void stop(void);
+
+  public:
+    explicit CatalogPredictor(QObject *parent = nullptr);
+    ~CatalogPredictor() override;
+
+    // Passes of every satellite of the catalog of the Singleton, starting
+    // within `horizon` seconds of `from`. Returns the request identifier.
+    quint64 request(
+        xyz_t const &site,
+        struct timeval const &from,
+        qreal horizon = SIGDIGGER_CATALOG_PREDICTOR_HORIZON);
+
+    // Passes of the last finished request: those in progress first, then
+    // the rest by AOS
+    bool take(quint64 &id, QVector<CatalogPass> &passes);
+
+  signals:
+    void ready(void);
+  };
+}
+
+#endif // CATALOGPREDICTOR_H
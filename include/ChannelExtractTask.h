@@ -0,0 +1,118 @@
+//
+//    ChannelExtractTask.h: Translate, decimate and resample in a single pass
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef CHANNELEXTRACTTASK_H
+#define CHANNELEXTRACTTASK_H
+
+#include <Suscan/CancellableTask.h>
+
+#include <sigutils/types.h>
+#include <BlockNCO.h>
+#include <memory>
+#include <vector>
+
+#define SIGDIGGER_CHANNEL_EXTRACT_BLOCK_LENGTH    16384
+
+// Taps of each polyphase branch of the decimator (it has one per input
+// sample of each output) and of the interpolator of the resampler
+#define SIGDIGGER_CHANNEL_EXTRACT_DECIM_TAPS      16
+#define SIGDIGGER_CHANNEL_EXTRACT_RESAMPLER_TAPS  16
+#define SIGDIGGER_CHANNEL_EXTRACT_RESAMPLER_PHASES 64
+
+// Decimated rate, relative to the bandwidth: keeps aliases out of it
+#define SIGDIGGER_CHANNEL_EXTRACT_DECIM_MARGIN    1.5
+
+namespace SigDigger {
+  //
+  // Brings the channel at `freq` down to baseband, filters it to `bw` and
+  // outputs it at `rate`. An integer decimation by D (the largest one that
+  // keeps the rate above both `rate` and the bandwidth margin) is done by
+  // only computing the outputs that are kept. The remaining fractional
+  // ratio is covered by a polyphase interpolator. Everything runs in a
+  // single pass over the input, so intermediate rates are never stored.
+  //
+  class ChannelExtractTask : public Suscan::CancellableTask {
+    Q_OBJECT
+
+    const SUCOMPLEX *origin = nullptr;
+    size_t length;
+    size_t p = 0;
+
+    BlockNCO nco;
+    qreal rate;
+    qreal bw;
+
+    // Decimator: taps and a delay line starting at input sample decimBase
+    unsigned int decimation = 1;
+    std::vector<SUFLOAT> decimTaps;
+    std::vector<SUCOMPLEX> decimLine;
+    qint64 decimBase = 0;
+    qint64 decimNext = 0;
+
+    // Resampler: bank of time-reversed phases, and its own delay line
+    std::vector<SUFLOAT> resamplerBank;
+    std::vector<SUCOMPLEX> resampleLine;
+    qint64 resampleBase = 0;
+    qreal resampleStep = 1;
+    qreal resampleNext = 0;
+
+    std::shared_ptr<std::vector<SUCOMPLEX>> buffer;
+    size_t expected = 0;
+
+    void feed(const SUCOMPLEX *data, size_t size);
+    void decimate(void);
+    void resample(void);
+
+  public:
+    ChannelExtractTask(
+        const SUCOMPLEX *data,
+        size_t length,
+        qreal fs,
+        qreal freq,
+        qreal bw,
+        qreal rate,
+        QObject *parent = nullptr);
+    virtual ~ChannelExtractTask() override;
+
+    unsigned int
+    getDecimation(void) const
+    {
+      return this->decimation;
+    }
+
+    qreal
+    getRate(void) const
+    {
+      return this->rate;
+    }
+
+    qreal
+    getBandwidth(void) const
+    {
+      return this->bw;
+    }
+
+    // Only valid once done() has been emitted
+    std::shared_ptr<std::vector<SUCOMPLEX>> takeBuffer(void);
+
+    virtual bool work(void) override;
+    virtual void cancel(void) override;
+  };
+}
+
+#endif // CHANNELEXTRACTTASK_H
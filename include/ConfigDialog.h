@@ -26,6 +26,7 @@
 #include <ColorConfig.h>
 #include <GuiConfig.h>
 #include <TLESourceConfig.h>
+#include <ThreadConfig.h>
 #include <SaveProfileDialog.h>
 #include <Suscan/Library.h>
 #include <ConfigTab.h>
@@ -36,6 +37,7 @@ namespace SigDigger {
   class GuiConfigTab;
   class LocationConfigTab;
   class TLESourceTab;
+  class ThreadConfigTab;
 
   class ConfigDialog : public QDialog
   {
@@ -51,6 +53,7 @@ namespace SigDigger {
     GuiConfigTab      *guiTab      = nullptr;
     LocationConfigTab *locationTab = nullptr;
     TLESourceTab      *tleSourceTab   = nullptr;
+    ThreadConfigTab   *threadTab   = nullptr;
     bool accepted = false;
 
     Ui_Config *ui = nullptr;
@@ -65,6 +68,7 @@ namespace SigDigger {
     void setColors(const ColorConfig &config);
     void setTleSourceConfig(const TLESourceConfig &config);
     void setGuiConfig(const GuiConfig &config);
+    void setThreadConfig(const ThreadConfig &config);
     void setGain(std::string const &name, float value);
     void setFrequency(qint64 freq);
     void notifySingletonChanges(void);
@@ -74,16 +78,17 @@ namespace SigDigger {
     bool colorsChanged(void) const;
     bool tleSourceConfigChanged(void) const;
     bool guiChanged(void) const;
+    bool threadConfigChanged(void) const;
 
     Suscan::Location getLocation(void) const;
     void setLocation(Suscan::Location const &);
-    bool sourceNeedsRestart(void) const;
     bool remoteSelected(void) const;
 
     float getGain(std::string const &name) const;
     Suscan::Source::Config getProfile(void) const;
     ColorConfig getColors(void) const;
     GuiConfig getGuiConfig(void) const;
+    ThreadConfig getThreadConfig(void) const;
     TLESourceConfig getTleSourceConfig(void) const;
     Suscan::AnalyzerParams getAnalyzerParams(void) const;
 
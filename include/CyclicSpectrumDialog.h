@@ -0,0 +1,72 @@
+//
+//    CyclicSpectrumDialog.h: Cyclic spectrum of a time window selection
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef CYCLICSPECTRUMDIALOG_H
+#define CYCLICSPECTRUMDIALOG_H
+
+#include <QDialog>
+#include <QImage>
+#include <memory>
+
+namespace Ui {
+  class CyclicSpectrumDialog;
+}
+
+namespace SigDigger {
+  struct CyclicSpectrumResult;
+  class Palette;
+
+  class CyclicSpectrumDialog : public QDialog
+  {
+    Q_OBJECT
+
+    std::shared_ptr<const CyclicSpectrumResult> result;
+    const Palette *palette = nullptr;
+    QImage image;
+    qreal fs = 1;
+
+    void connectAll(void);
+    void redraw(void);
+    void refreshInfo(void);
+
+  public:
+    explicit CyclicSpectrumDialog(QWidget *parent = nullptr);
+    ~CyclicSpectrumDialog() override;
+
+    void setSampleRate(qreal fs);
+    void setPalette(const Palette *palette);
+
+    // Shown once complete. Until then, only the settings are described.
+    void setResult(std::shared_ptr<const CyclicSpectrumResult> const &);
+    void notifyComplete(void);
+
+    unsigned int getChannels(void) const;
+    unsigned int getFrames(void) const;
+
+  signals:
+    void computeRequested(void);
+
+  public slots:
+    void onRangeChanged(void);
+
+  private:
+    Ui::CyclicSpectrumDialog *ui;
+  };
+}
+
+#endif // CYCLICSPECTRUMDIALOG_H
@@ -0,0 +1,150 @@
+//
+//    CyclicSpectrumTask.h: Spectral correlation by FFT accumulation
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef CYCLICSPECTRUMTASK_H
+#define CYCLICSPECTRUMTASK_H
+
+#include <Suscan/CancellableTask.h>
+#include <Suscan/TaskPool.h>
+#include <sigutils/types.h>
+#include <QAtomicInteger>
+#include <QMutex>
+#include <memory>
+#include <vector>
+
+// Channelizer hop, as a fraction of the number of channels (L = Np / 4)
+#define SIGDIGGER_CYCLIC_HOP_DIVISOR       4
+
+// Bounds on the output surface and on the channelized blocks kept in memory
+#define SIGDIGGER_CYCLIC_MAX_ALPHA_BINS    1024
+#define SIGDIGGER_CYCLIC_MAX_BLOCKS        64
+#define SIGDIGGER_CYCLIC_MEMORY_MAX        (64 << 20)
+
+// Strongest cyclic frequencies reported in the result, and the width
+// (in channels) of the a = 0 region excluded from the search
+#define SIGDIGGER_CYCLIC_PSD_CHANNELS      2
+#define SIGDIGGER_CYCLIC_MAX_FEATURES      6
+#define SIGDIGGER_CYCLIC_POLL_INTERVAL_MS  100
+
+// Correlator rows are dealt out in this many interleaved sets per thread
+#define SIGDIGGER_CYCLIC_BATCHES_PER_CPU   4
+
+namespace SigDigger {
+  struct CyclicFeature {
+    qreal alpha; // Cyclic frequency, as a fraction of the sample rate
+    float level; // dB
+  };
+
+  //
+  // Spectral correlation magnitude |S^a(f)| (dB) over 0 <= a < fs and
+  // -fs/2 <= f < fs/2, estimated with the FFT accumulation method. The
+  // range is split in `blocks` of `frames` channelizer frames each, and
+  // the estimates of every block are averaged. The a < 0 half is not
+  // computed, as |S^-a(f)| = |S^a(f)|.
+  //
+  struct CyclicSpectrumResult {
+    unsigned int channels = 0; // Np, frequency resolution fs / Np
+    unsigned int frames = 0;   // P, cyclic resolution fs / (P * hop)
+    size_t hop = 0;
+    qint64 start = 0;
+    size_t length = 0;
+    size_t blocks = 0;
+    size_t blockStride = 0;
+    unsigned int alphaBins = 0;
+
+    std::vector<float> surface;  // alphaBins x channels
+    std::vector<float> profile;  // Max over f of each alpha row
+    std::vector<CyclicFeature> features;
+    float peak = 0;
+    float featurePeak = 0;       // Away from a = 0, where the PSD lies
+    bool complete = false;
+
+    CyclicSpectrumResult(
+        unsigned int channels,
+        unsigned int frames,
+        qint64 start,
+        size_t length);
+
+    // Rows this close to a = 0 only show the PSD, leaking through the
+    // overlap of neighbouring channels
+    unsigned int
+    firstFeatureRow(void) const
+    {
+      return SIGDIGGER_CYCLIC_PSD_CHANNELS
+          * ((this->alphaBins + this->channels - 1) / this->channels) + 1;
+    }
+
+    bool
+    matches(
+        unsigned int channels,
+        unsigned int frames,
+        qint64 start,
+        size_t length) const
+    {
+      return this->channels == channels
+          && this->frames == frames
+          && this->start == start
+          && this->length == length;
+    }
+  };
+
+  class CyclicSpectrumTask : public Suscan::CancellableTask {
+    Q_OBJECT
+
+    enum Stage {
+      PREPARING,
+      CHANNELIZING,
+      CORRELATING
+    };
+
+    std::shared_ptr<const std::vector<SUCOMPLEX>> buffer;
+    std::shared_ptr<CyclicSpectrumResult> result;
+    std::vector<SUFLOAT> channelWindow;
+    std::vector<SUFLOAT> frameWindow;
+    std::vector<SUCOMPLEX> twiddle;     // Channel downconversion phases
+    std::vector<SUCOMPLEX> channelized; // blocks x channels x frames
+    SU_FFTW(_plan) channelPlan = nullptr;
+    SU_FFTW(_plan) framePlan = nullptr;
+    Stage stage = PREPARING;
+
+    Suscan::TaskSlices slices;
+    QMutex surfaceMutex;
+    unsigned int batches = 0;
+    QAtomicInteger<int> failed = 0;
+    QAtomicInteger<quint64> processed = 0;
+
+    bool prepare(void);
+    void launch(Stage stage, int units);
+    void runChannelizer(int block);
+    void runCorrelator(int batch);
+    void finish(void);
+
+  public:
+    // Keeps the buffer alive (and thus shared) until destroyed
+    CyclicSpectrumTask(
+        std::shared_ptr<const std::vector<SUCOMPLEX>> const &buffer,
+        std::shared_ptr<CyclicSpectrumResult> const &result,
+        QObject *parent = nullptr);
+    virtual ~CyclicSpectrumTask() override;
+
+    virtual bool work(void) override;
+    virtual void cancel(void) override;
+  };
+}
+
+#endif // CYCLICSPECTRUMTASK_H
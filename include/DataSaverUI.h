@@ -21,6 +21,7 @@
 #define DATASAVERUI_H
 
 #include <GenericDataSaverUI.h>
+#include <RecordingTrigger.h>
 
 namespace Ui {
   class DataSaverUI;
@@ -30,6 +31,13 @@ namespace SigDigger {
   class DataSaverConfig : public Suscan::Serializable {
   public:
     std::string path;
+    unsigned int segmentMinutes = 0;
+    unsigned int segmentRetention = 0;
+    std::string captureFormat = "float32";
+    bool triggerEnabled = false;
+    bool sharedContainer = false;
+    bool packSymbols = false;
+    RecordingTriggerParams trigger;
 
     // Overriden methods
     void deserialize(Suscan::Object const &conf) override;
@@ -40,7 +48,9 @@ namespace SigDigger {
   {
       Q_OBJECT
     DataSaverConfig *config = nullptr;
+    bool captureControls = false;
       void connectAll(void);
+      void refreshCaptureControls(void);
 
   protected:
       void setDiskUsage(qreal) override;
@@ -51,12 +61,33 @@ namespace SigDigger {
       void setSaveEnabled(bool enabled) override;
       void setCaptureSize(quint64) override;
       void setIORate(qreal) override;
+      void setBufferUsage(qreal usage, qreal highWater) override;
       void setRecordState(bool state) override;
 
       // Getters
       bool getRecordState(void) const override;
       std::string getRecordSavePath(void) const override;
 
+      // IQ capture settings. Segment duration in seconds, 0 for a single
+      // file. Formats: float32, int16, int8, and int16_zstd / int8_zstd
+      // if zstd is available. Segments are float32 only.
+      void setCaptureControlsVisible(bool);
+      unsigned int getSegmentDuration(void) const;
+      unsigned int getSegmentRetention(void) const;
+      std::string getCaptureFormat(void) const;
+
+      // Power trigger. Ignored (off) if capture controls are hidden.
+      bool getTriggerEnabled(void) const;
+      RecordingTriggerParams getTriggerParams(void) const;
+      void setTriggerStatus(QString const &);
+
+      // Inspector recordings only: whether to write into the container
+      // shared by every inspector recording to the same directory
+      bool getSharedContainer(void) const;
+
+      // Inspector recordings only: symbols in SymbolPacker frames
+      bool getPackSymbols(void) const;
+
       // Other overriden methods
       Suscan::Serializable *allocConfig(void) override;
       void applyConfig(void) override;
@@ -67,6 +98,7 @@ namespace SigDigger {
   public slots:
       void onChangeSavePath(void);
       void onRecordStartStop(void);
+      void onCaptureSettingsChanged(void);
 
   private:
       Ui::DataSaverUI *ui;
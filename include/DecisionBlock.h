@@ -0,0 +1,83 @@
+//
+//    DecisionBlock.h: Decision variable of a block of samples
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#ifndef DECISIONBLOCK_H
+#define DECISIONBLOCK_H
+
+#include <vector>
+#include <Decider.h>
+#include <ScratchArena.h>
+
+namespace SigDigger {
+  //
+  // Decision variable (modulus or argument) of a block of samples. Meant
+  // to be computed once per block and read by every consumer of the
+  // block, instead of each of them calling SU_C_ABS / SU_C_ARG again.
+  // With fastArg, arguments come from SampleKernels::fastAtan2.
+  //
+  class DecisionBlock
+  {
+    std::vector<SUFLOAT> values;
+    ScratchArena *arena = nullptr;
+    SUFLOAT *ptr = nullptr;
+    unsigned int count = 0;
+
+    SUFLOAT *prepare(unsigned int size);
+
+  public:
+    // Take the values from this arena instead of owning them. They are
+    // then only valid until the arena is reset.
+    void setArena(ScratchArena *arena);
+
+    void modulus(const SUCOMPLEX *data, unsigned int size);
+
+    // If quadrature is set, the argument is that of I * data
+    void argument(
+        const SUCOMPLEX *data,
+        unsigned int size,
+        bool quadrature = false,
+        bool fastArg = false);
+
+    void compute(
+        const SUCOMPLEX *data,
+        unsigned int size,
+        Decider::DecisionMode mode,
+        bool fastArg = false);
+
+    inline SUFLOAT *
+    data(void)
+    {
+      return this->ptr;
+    }
+
+    inline const SUFLOAT *
+    data(void) const
+    {
+      return this->ptr;
+    }
+
+    inline unsigned int
+    size(void) const
+    {
+      return this->count;
+    }
+  };
+}
+
+#endif // DECISIONBLOCK_H
@@ -19,23 +19,25 @@
 #ifndef DELAYEDCONJTASK_H
 #define DELAYEDCONJTASK_H
 
-#include <Suscan/CancellableTask.h>
+#include <Suscan/ChunkedTask.h>
 #include <sigutils/types.h>
+#include <vector>
 
-class DelayedConjTask : public Suscan::CancellableTask
+class DelayedConjTask : public Suscan::ChunkedTask
 {
   Q_OBJECT
 
   const SUCOMPLEX *origin = nullptr;
   SUCOMPLEX       *destination = nullptr;
 
-  std::vector<SUCOMPLEX> delayLine;
-  SUSCOUNT q = 0;
-
-  size_t length;
-  size_t p = 0;
   SUSCOUNT delay = 0;
 
+protected:
+  virtual void processChunk(
+      size_t start,
+      size_t end,
+      const SUCOMPLEX *history) override;
+
 public:
   explicit DelayedConjTask(
       const SUCOMPLEX *data,
@@ -45,9 +47,6 @@ public:
       QObject *parent = nullptr);
 
   virtual ~DelayedConjTask() override;
-
-  virtual bool work(void) override;
-  virtual void cancel(void) override;
 };
 
 #endif // DELAYEDCONJTASK_H
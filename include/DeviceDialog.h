@@ -53,6 +53,7 @@ namespace SigDigger {
 
     private:
       Ui::DeviceDialog *ui;
+      quint64 deviceRevision = 0; // Listing shown in the table
   };
 }
 
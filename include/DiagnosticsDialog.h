@@ -0,0 +1,73 @@
+//
+//    DiagnosticsDialog.h: Analyzer message path diagnostics
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef DIAGNOSTICSDIALOG_H
+#define DIAGNOSTICSDIALOG_H
+
+#include <QDialog>
+#include <QPointer>
+#include <Suscan/Analyzer.h>
+
+#define SIGDIGGER_DIAGNOSTICS_REFRESH_INTERVAL_MS 1000
+
+namespace Ui {
+  class DiagnosticsDialog;
+}
+
+class QTimer;
+
+namespace SigDigger {
+  class DiagnosticsDialog : public QDialog
+  {
+      Q_OBJECT
+
+      QPointer<Suscan::Analyzer> analyzer;
+      Suscan::AnalyzerStats lastStats;
+      QTimer *timer = nullptr;
+
+      void connectAll(void);
+      void refreshUi(void);
+      void refreshMemory(void);
+      void setCell(int row, int col, QString const &text);
+      void setHistogramCells(
+          int row,
+          int col,
+          Suscan::StatsHistogram const &);
+      void saveStats(QString path);
+
+    protected:
+      void showEvent(QShowEvent *) override;
+      void hideEvent(QHideEvent *) override;
+
+    public:
+      void setAnalyzer(Suscan::Analyzer *);
+
+      explicit DiagnosticsDialog(QWidget *parent = nullptr);
+      ~DiagnosticsDialog() override;
+
+    public slots:
+      void onRefresh(void);
+      void onReset(void);
+      void onSave(void);
+
+    private:
+      Ui::DiagnosticsDialog *ui;
+  };
+}
+
+#endif // DIAGNOSTICSDIALOG_H
@@ -36,8 +36,7 @@ namespace SigDigger {
     State state             = ESTIMATING;
     const SUCOMPLEX   *data = nullptr;
     SU_FFTW(_plan)     plan = nullptr;
-    SU_FFTW(_complex) *buffer = nullptr;
-    std::vector<SUCOMPLEX> psd;
+    std::vector<SUCOMPLEX> psd; // Also the FFT buffer
     SUFLOAT peak = 0;
     SUFLOAT sigma;
     SUFLOAT max;
@@ -22,52 +22,129 @@
 #include <Suscan/CancellableTask.h>
 #include <QElapsedTimer>
 #include <sigutils/matfile.h>
-#include <iomanip>
-#include <fstream>
+#include <memory>
 #include "SigDiggerHelpers.h"
 
+#ifdef HAVE_ZSTD
+#  include <zstd.h>
+#endif // HAVE_ZSTD
+
 namespace SigDigger {
+  class ExportWriter;
+  class SampleStore;
+
+  enum ExportFormat {
+    EXPORT_FORMAT_UNKNOWN,
+    EXPORT_FORMAT_MAT5,
+    EXPORT_FORMAT_MATLAB,
+    EXPORT_FORMAT_WAV,
+    EXPORT_FORMAT_RAW,
+    EXPORT_FORMAT_ZSTD
+  };
+
+  // One output file of an export, and whatever state its format needs
+  struct ExportSink {
+    QString path;
+    QString formatName;
+    ExportFormat format = EXPORT_FORMAT_UNKNOWN;
+    QString error;
+
+    int fd = -1;
+    bool directIO = false;
+    ExportWriter *writer = nullptr;
+#ifdef HAVE_ZSTD
+    ZSTD_CCtx *zstd = nullptr;
+#endif // HAVE_ZSTD
+    SNDFILE *sfp = nullptr;
+    su_mat_file_t *mf = nullptr;
+  };
+
+  //
+  // Raw, zstd and MATLAB script exports are pipelined: samples are
+  // converted (and compressed) in the task thread into one of two
+  // buffers, while an ExportWriter thread writes the other one to disk.
+  // WAV and Mat5 files are written through libsndfile and sigutils.
+  //
+  // A task may write several files (sinks) at once, all of them fed
+  // from a single pass over the samples.
+  //
+  // The task reads straight from a shared sample buffer, which it keeps
+  // alive until it is destroyed. Owners must not modify a buffer while
+  // it is shared, but rather replace it with a copy (see TimeWindow).
+  // Samples may also be read back from a SampleStore, one block at a
+  // time. Stores may keep growing, but must not be cleared while shared.
+  //
   class ExportSamplesTask : public Suscan::CancellableTask
   {
       Q_OBJECT
 
-      std::ofstream of;
-      SNDFILE *sfp = nullptr;
-      su_mat_file_t *mf = nullptr;
+      std::vector<ExportSink> sinks;
 
       QElapsedTimer timer;
-      QString path;
-      QString format;
-      std::vector<SUCOMPLEX> data;
+      std::shared_ptr<const std::vector<SUCOMPLEX>> buffer;
+      const SUCOMPLEX *samples = nullptr;
+      std::shared_ptr<SampleStore> store;
+      size_t storeOffset = 0;
+      std::vector<SUCOMPLEX> block;
+      size_t count = 0;
       qreal fs;
       int start;
       int end;
 
       QString lastError;
 
-      bool openMat5(void);
-      bool openMatlab(void);
-      bool openWav(void);
-      bool openRaw(void);
+      bool openMat5(ExportSink &);
+      bool openMatlab(ExportSink &);
+      bool openWav(ExportSink &);
+      bool openRaw(ExportSink &);
+      bool openZstd(ExportSink &);
+      bool openFile(ExportSink &, bool allowDirectIO);
+      bool openSink(ExportSink &);
+
+      bool beginMatlab(ExportSink &);
+      bool writeMatlab(ExportSink &, const SUCOMPLEX *, size_t);
+      bool endMatlab(ExportSink &);
+      bool writeRaw(ExportSink &, const SUCOMPLEX *, size_t);
+      bool endRaw(ExportSink &);
+#ifdef HAVE_ZSTD
+      bool compressZstd(ExportSink &, const SUCOMPLEX *, size_t, bool last);
+#endif // HAVE_ZSTD
+      bool writeZstd(ExportSink &, const SUCOMPLEX *, size_t);
+      bool endZstd(ExportSink &);
+      bool writeMat5(ExportSink &, const SUCOMPLEX *, size_t);
+      bool writeWav(ExportSink &, const SUCOMPLEX *, size_t);
+      bool finishPipeline(ExportSink &);
 
-      bool exportToMat5(void);
-      bool exportToMatlab(void);
-      bool exportToWav(void);
+      bool beginSink(ExportSink &);
+      bool writeSink(ExportSink &, const SUCOMPLEX *, size_t);
+      bool endSink(ExportSink &);
 
       bool cancelFlag = false;
 
       void breathe(quint64);
 
     public:
+      ExportSamplesTask(
+          std::shared_ptr<const std::vector<SUCOMPLEX>> const &buffer,
+          qreal fs,
+          int start,
+          int end);
+      ExportSamplesTask(
+          std::shared_ptr<SampleStore> const &store,
+          qreal fs,
+          size_t start,
+          size_t end);
       ExportSamplesTask(
           QString const &path,
           QString const &format,
-          const SUCOMPLEX *data,
-          size_t length,
+          std::shared_ptr<const std::vector<SUCOMPLEX>> const &buffer,
           qreal fs,
           int start,
           int end);
       ~ExportSamplesTask() override;
+
+      // Formats are named after their file extension (raw, wav, mat...)
+      void addSink(QString const &path, QString const &format);
       bool attemptOpen(void);
 
       bool work(void) override;
@@ -0,0 +1,83 @@
+//
+//    include/FFTPlanCache.h: Process-wide FFTW plan cache
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef FFTPLANCACHE_H
+#define FFTPLANCACHE_H
+
+#include <QMutex>
+#include <QString>
+#include <sigutils/types.h>
+#include <map>
+#include <tuple>
+
+// Transforms up to this size are planned with FFTW_MEASURE. Bigger ones
+// only get a measured plan if it can be built from existing wisdom.
+#define SIGDIGGER_FFT_PLAN_CACHE_MEASURE_MAX (1 << 20)
+#define SIGDIGGER_FFT_PLAN_CACHE_WISDOM_FILE "fftw-wisdom"
+
+// Transforms of at least this size use FFTW's threaded planner, if
+// available. Smaller plans stay single-threaded, as they may be run
+// concurrently by several workers (e.g. Welch segments).
+#define SIGDIGGER_FFT_PLAN_CACHE_THREADS_MIN (1 << 21)
+
+namespace SigDigger {
+  //
+  // Plans are shared and owned by the cache. They were created on scratch
+  // buffers, so they must be run through execute() (new-array execution)
+  // with the same arrays passed to get(). FFTW's planner is not
+  // thread-safe: all planning and wisdom calls are serialized by the mutex.
+  //
+  class FFTPlanCache {
+    // Size, sign, in-place, SIMD-aligned
+    typedef std::tuple<int, int, bool, bool> Key;
+
+    std::map<Key, SU_FFTW(_plan)> plans;
+    QMutex mutex;
+    bool wisdomChanged = false;
+    int threads = 1;
+
+    FFTPlanCache();
+
+    SU_FFTW(_plan) makePlan(int size, int sign, bool inPlace, bool aligned);
+
+  public:
+    static FFTPlanCache *instance(void);
+    ~FFTPlanCache();
+
+    SU_FFTW(_plan) get(
+        int size,
+        int sign,
+        const SU_FFTW(_complex) *in,
+        const SU_FFTW(_complex) *out);
+
+    static inline void
+    execute(
+        SU_FFTW(_plan) plan,
+        SU_FFTW(_complex) *in,
+        SU_FFTW(_complex) *out)
+    {
+      SU_FFTW(_execute_dft)(plan, in, out);
+    }
+
+    QString wisdomPath(void) const;
+    bool loadWisdom(void);
+    bool saveWisdom(void);
+  };
+}
+
+#endif // FFTPLANCACHE_H
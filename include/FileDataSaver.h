@@ -22,13 +22,20 @@
 
 #include "GenericDataSaver.h"
 
+// Asynchronous writes kept in flight, when io_uring or POSIX AIO exist.
+// Must be smaller than the number of slots of the saver's ring.
+#define SIGDIGGER_FILE_DATA_SAVER_QUEUE_DEPTH 8
+
 namespace SigDigger {
   class FileDataWriter;
 
   class FileDataSaver : public GenericDataSaver {
     Q_OBJECT
 
-    FileDataWriter *writer = nullptr;
+    // Set while calling the parent constructor. A default initializer
+    // would reset it to nullptr right after (this applies to every
+    // GenericDataSaver that owns its writer).
+    FileDataWriter *writer;
 
   public:
     FileDataSaver(int fd, QObject *parent = nullptr);
@@ -23,11 +23,10 @@
 #include <Suscan/Library.h>
 #include <sgdp4/sgdp4.h>
 #include <ColorConfig.h>
+#include <PassPredictor.h>
+#include <CatalogPredictor.h>
 #include <QTimer>
 
-#define FREQUENCY_CORRECTION_DIALOG_TIME_WINDOW_MIN (1 * 86400.0)  // 1 day
-#define FREQUENCY_CORRECTION_DIALOG_TIME_WINDOW_MAX (30 * 86400.0) // 30 days
-
 namespace Ui {
   class FrequencyCorrectionDialog;
 }
@@ -48,6 +47,20 @@ namespace SigDigger {
     QTimer timer;
     ColorConfig colors;
 
+    // Passes are predicted in the background and drawn from here
+    PassPredictor *predictor = nullptr;
+    QVector<SatellitePass> passes;
+    quint64 passRequest = 0;
+    bool passPending = false;
+    bool passesExhausted = false;
+    xyz_t currentAzEl = {{0}, {0}, {0}};
+    int trackerHandle = -1;
+
+    // Next pass of every satellite of the catalog, to mark those up now
+    CatalogPredictor *catalog = nullptr;
+    quint64 catalogRequest = 0;
+    bool catalogStale = true;
+
     bool haveOrbit = false;
     bool realTime  = true;
     bool haveALOS  = false;
@@ -74,11 +87,13 @@ namespace SigDigger {
     void repaintSatellitePlot(void);
     void parseCurrentTLE(void);
     void updatePrediction(void);
-    void recalcALOS(void);
+    void invalidatePasses(void);
+    void refreshPasses(void);
     void connectAll(void);
     void refreshUiState(void);
     void refreshOrbit(void);
     void findNewSatellites(void);
+    void requestCatalog(void);
 
     void setCurrentOrbit(const orbit_t *);
     void paintTextAt(
@@ -87,6 +102,9 @@ namespace SigDigger {
         QString text,
         bool center = false);
 
+  protected:
+    void showEvent(QShowEvent *) override;
+
   public:
     // Setters
     void setColorConfig(ColorConfig const &colors);
@@ -123,6 +141,8 @@ namespace SigDigger {
     void onToggleOrbitType(void);
     void onTLEEdit(void);
     void onTick(void);
+    void onPassesReady(void);
+    void onCatalogReady(void);
 
   private:
     Ui::FrequencyCorrectionDialog *ui;
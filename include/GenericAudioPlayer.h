@@ -24,12 +24,46 @@
 #include <stdexcept>
 
 namespace SigDigger {
+  //
+  // Where pull-mode players get their samples from. read() is called from
+  // the device's own, real-time thread: it must neither block nor allocate.
+  //
+  class AudioSource {
+  public:
+    // Fills up to len frames and returns how many it did. The player plays
+    // silence for the rest.
+    virtual size_t read(float *frames, size_t len) = 0;
+    virtual ~AudioSource();
+  };
+
   class GenericAudioPlayer {
     unsigned int sampleRate;
 
+  protected:
+    unsigned int channels;
+    AudioSource *source; // Weak
+
   public:
-    GenericAudioPlayer(unsigned int sampleRate);
+    // Players constructed with a source run in pull mode: samples are not
+    // written to them, they ask the source for them.
+    GenericAudioPlayer(
+        unsigned int sampleRate,
+        unsigned int channels = 1,
+        AudioSource *source = nullptr);
+
+    // Push mode. len is in frames: samples holds len * channels floats
     virtual bool write(const float *samples, size_t len) = 0;
+
+    // Pull mode. Waits for (at most) one device period and transfers
+    // whatever the device needs. Call in a loop; false means error.
+    virtual bool pull(void) = 0;
+
+    inline bool
+    isPull(void) const
+    {
+      return this->source != nullptr;
+    }
+
     virtual ~GenericAudioPlayer();
   };
 }
@@ -24,11 +24,22 @@
 #include <QObject>
 #include <QThread>
 #include <QMutex>
+#include <QAtomicInteger>
 #include <vector>
 #include <sigutils/types.h>
 #include <util/compat-time.h>
+#include <MemoryAccountant.h>
+#include <ShutdownWatchdog.h>
 #include <stdint.h>
 
+// Number of slots in the ring, and seconds of data it can hold in total
+#define SIGDIGGER_GENERIC_DATA_SAVER_DEFAULT_SLOTS   16
+#define SIGDIGGER_GENERIC_DATA_SAVER_RING_SECONDS    8
+#define SIGDIGGER_GENERIC_DATA_SAVER_MAX_RING_BYTES  (256ul << 20)
+
+// Slots are page-aligned and a whole number of pages long
+#define SIGDIGGER_GENERIC_DATA_SAVER_SLOT_ALIGN      4096
+
 namespace SigDigger {
   class GenericDataSaver;
 
@@ -50,6 +61,14 @@ namespace SigDigger {
     TEMPLATE_FOR_WRITE_NO_MATTER_WHAT(SUFLOAT);
     TEMPLATE_FOR_WRITE_NO_MATTER_WHAT(SUCOMPLEX);
 
+    // Asynchronous writes. Writers with a non-zero queue depth accept up
+    // to that many submit()s before a reap(), which hands back the tag of
+    // some completed write and its result (bytes written, negative on
+    // failure). Buffers must remain untouched until reaped.
+    virtual unsigned int getQueueDepth(void) const;
+    virtual bool submit(const void *data, size_t len, uintptr_t tag);
+    virtual bool reap(uintptr_t &tag, ssize_t &result);
+
     virtual bool close(void) = 0;
     virtual std::string getError(void) const = 0;
     virtual ~GenericDataWriter();
@@ -63,6 +82,19 @@ namespace SigDigger {
       bool writerPrepared = false;
       GenericDataSaver *instance;
 
+      // Asynchronous writer state. Slots from tail on are submitted in
+      // order, but may complete in any. They go back to the producer in
+      // order, as soon as the one at tail is done.
+      std::vector<bool> done;
+      unsigned int next = 0;
+      unsigned int inFlight = 0;
+      unsigned int submitted = 0;
+      struct timeval lastRelease;
+
+      bool writeSlot(const uint8_t *data, size_t size);
+      void fail(std::string const &error);
+      void drainAsync(void);
+
     private slots:
       void onCommit(void);
       void onPrepare(void);
@@ -70,6 +102,10 @@ namespace SigDigger {
     public:
       GenericDataWorker(GenericDataSaver *intance);
 
+      // Writes every committed slot. Called from the worker thread, or
+      // from the saver's once the worker thread is gone.
+      void drain(void);
+
     signals:
       void prepared(void);
       void writeFinished(quint64 usec);
@@ -80,30 +116,70 @@ namespace SigDigger {
   {
       Q_OBJECT
 
-      std::vector<uint8_t>buffers[2];
+      // The producer fills the slot at head and commits it when full.
+      // The worker writes committed slots from tail. A stalling disk
+      // only results in dropped data once every slot is committed.
+      //
+      // write() is called from the DSP thread and never blocks: head and
+      // the slot it points to belong to the producer, tail to the worker,
+      // and the only thing they share is the pending slot counter. The
+      // ring itself can only be reshaped before the first write().
+      struct Slot {
+        uint8_t *data = nullptr;
+        size_t used = 0;
+      };
+
+      std::vector<Slot> slots;
       QString lastError;
 
-      unsigned int rateHint;
-      size_t allocation;
+      unsigned int rateHint = 0;
+      size_t allocation = 0;
+      size_t slotSize = 0;
+      unsigned int slotCount = SIGDIGGER_GENERIC_DATA_SAVER_DEFAULT_SLOTS;
+
+      unsigned int head = 0;
+      unsigned int tail = 0;
+      QAtomicInteger<unsigned int> pending = 0;
+      QAtomicInteger<unsigned int> highWater = 0;
+
+      // Set by the producer when it has committed slots, cleared by the
+      // worker before draining. Only its first setter posts commit().
+      QAtomicInteger<int> commitRequests = 0;
 
-      unsigned int buffer = 0;
-      unsigned int commitedSize;
-      unsigned int ptr = 0;
       GenericDataWriter *writer = nullptr;
-      bool bufferReady = true;
-      bool dataWritten = false;
+      QAtomicInteger<int> dataWritten = 0;
+      bool finished = false;
       QThread workerThread;
       GenericDataWorker workerObject;
 
+      // Protects the writer and the ring allocation, never taken by write()
       QMutex dataMutex;
 
       struct timeval lastCommit;
       quint64 commitTime = 0;
-      quint64 writeTime = 0;
-      quint64 size = 0;
+      QAtomicInteger<quint64> writeTime = 0;
+      QAtomicInteger<quint64> size = 0;
+      QAtomicInteger<quint64> accepted = 0;
+
+      MemoryAccount account;
 
       // Private methods
-      void doCommit(void);
+      static uint8_t *allocSlot(size_t size);
+      static void freeSlot(uint8_t *data, size_t size);
+
+      void allocRing(void);
+      void freeRing(void);
+      bool commitHead(void);
+      bool doCommit(void);
+
+    protected:
+      // Named by the shutdown watchdog if never finished
+      ShutdownTracker tracker;
+
+      // Stops the worker, writes whatever is left in the ring and closes
+      // the writer. Subclasses owning the writer must call it before
+      // deleting it.
+      void finish(void);
 
     public:
       explicit GenericDataSaver(
@@ -111,13 +187,25 @@ namespace SigDigger {
           QObject *parent = nullptr);
       ~GenericDataSaver();
 
+      // Ring size (before page rounding) for a given sample rate, so
+      // callers can check it against the memory budget beforehand
+      static size_t ringBytes(unsigned int rate);
+
       // Public methods
       void setBufferSize(unsigned int size);
       void setSampleRate(unsigned int i);
+      void setRingSlots(unsigned int slots);
       template<typename T> void write(const T *, size_t size);
       QString getLastError(void) const;
       quint64 getSize(void) const;
 
+      // Bytes taken by write() so far, including those still in the ring
+      quint64 getAcceptedSize(void) const;
+
+      // Fraction of the ring waiting to be written, now and at worst
+      qreal getBufferUsage(void);
+      qreal getBufferHighWater(void);
+
       // Friend classes
       friend class GenericDataWorker;
 
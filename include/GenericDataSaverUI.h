@@ -44,6 +44,7 @@ namespace SigDigger {
     virtual void setSaveEnabled(bool enabled) = 0;
     virtual void setCaptureSize(quint64) = 0;
     virtual void setIORate(qreal) = 0;
+    virtual void setBufferUsage(qreal usage, qreal highWater) = 0;
     virtual void setRecordState(bool state) = 0;
 
     // Getters
@@ -35,8 +35,18 @@ namespace SigDigger {
         bool useGLWaterfall;
         bool useMaxBlending;
         bool useGlInWindows;
+        bool useGLConstellation;
+        bool useGLTVDisplay;
         bool enableMsgTTL;
         unsigned int msgTTL;
+        bool enablePsdGovernor;
+        bool enableLoadGovernor;
+        bool matchRemotePsdSize;
+        unsigned int maxFps;
+        unsigned int memoryBudget; // MiB, 0: unlimited
+        unsigned int waterfallSpill; // MiB, 0: disabled
+        unsigned int msgBatchSize;
+        unsigned int msgBatchDeadline; // in milliseconds
 
       GuiConfig();
       GuiConfig(Suscan::Object const &conf);
@@ -0,0 +1,66 @@
+//
+//    HistogramAccumulator.h: Sliding window over a growing histogram
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef HISTOGRAMACCUMULATOR_H
+#define HISTOGRAMACCUMULATOR_H
+
+#include <vector>
+
+#define SIGDIGGER_HISTOGRAM_ACCUMULATOR_DEFAULT_BLOCKS 32
+
+// Per-bin increments past this between updates mean the histogram was reset
+#define SIGDIGGER_HISTOGRAM_ACCUMULATOR_MAX_DELTA      0x80000000u
+
+namespace SigDigger {
+  //
+  // Keeps the recent part of a histogram whose counts only grow (like
+  // the one of the Histogram widget). Each update() stores what was added
+  // since the previous one as a block, in a ring of `blocks` blocks, and
+  // the window is the sum of the ring. Old samples thus fade out, and
+  // every update costs O(bins) no matter how many samples the histogram
+  // has seen. Differences are taken modulo 2^32: counters wrapping around
+  // go unnoticed.
+  //
+  class HistogramAccumulator
+  {
+      std::vector<unsigned int> last; // Counts seen in the previous update
+      std::vector<unsigned int> ring; // blocks x bins
+      std::vector<unsigned int> sum;
+      unsigned int blocks;
+      unsigned int bins = 0;
+      unsigned int next = 0;
+
+    public:
+      HistogramAccumulator(
+          unsigned int blocks = SIGDIGGER_HISTOGRAM_ACCUMULATOR_DEFAULT_BLOCKS);
+
+      void setBlocks(unsigned int blocks);
+
+      // The next update takes the whole histogram as its first block
+      void reset(void);
+      void update(std::vector<unsigned int> const &counts);
+
+      std::vector<unsigned int> const &
+      get(void) const
+      {
+        return this->sum;
+      }
+  };
+}
+
+#endif // HISTOGRAMACCUMULATOR_H
@@ -23,6 +23,10 @@
 #include "SamplingProperties.h"
 #include "Decider.h"
 #include "ColorConfig.h"
+#include "HistogramFeeder.h"
+
+// Height resolution of the histogram built from a HistogramBins
+#define SIGDIGGER_HISTOGRAM_DIALOG_LEVELS 512
 
 namespace Ui {
   class HistogramDialog;
@@ -38,6 +42,7 @@ namespace SigDigger {
 
     SUFLOAT min = INFINITY;
     SUFLOAT max = -INFINITY;
+    std::vector<SUFLOAT> levelBuffer;
 
     bool limits = false;
     SUFLOAT selMin;
@@ -52,7 +57,7 @@ namespace SigDigger {
 
     void reset(void);
     void setProperties(SamplingProperties const &);
-    void feed(const SUFLOAT *data, unsigned int len);
+    void setBins(HistogramBins const &);
 
     void setColorConfig(ColorConfig const &);
 
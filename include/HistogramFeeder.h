@@ -20,18 +20,53 @@
 #define HISTOGRAMFEEDER_H
 
 #include <Suscan/CancellableTask.h>
+#include <QElapsedTimer>
+#include <vector>
 #include "SamplingProperties.h"
 
 #define SIGDIGGER_HISTOGRAM_FEEDER_BLOCK_LENGTH 4096
+#define SIGDIGGER_HISTOGRAM_FEEDER_BINS         1024
+#define SIGDIGGER_HISTOGRAM_FEEDER_LANES        4
+#define SIGDIGGER_HISTOGRAM_FEEDER_UPDATE_MS    250
 
 namespace SigDigger {
+  // Bin counts over [min, max], as computed by a HistogramFeeder
+  struct HistogramBins {
+    std::vector<unsigned int> counts;
+    SUFLOAT min = 0;
+    SUFLOAT max = 0;
+    size_t samples = 0;
+  };
+
   class HistogramFeeder : public Suscan::CancellableTask {
     Q_OBJECT
 
+    enum State {
+      MEASURING,
+      BINNING
+    };
+
     SamplingProperties properties;
+    State state = BINNING;
     size_t p = 0;
 
+    SUFLOAT min = INFINITY;
+    SUFLOAT max = -INFINITY;
+    SUFLOAT scale = 0;
+    size_t samples = 0;
+
+    // Consecutive samples are counted in different lanes, so that close
+    // increments of the same bin do not depend on each other.
+    std::vector<unsigned int> lanes;
+    QElapsedTimer lastUpdate;
+
     SUFLOAT block[SIGDIGGER_HISTOGRAM_FEEDER_BLOCK_LENGTH];
+    int index[SIGDIGGER_HISTOGRAM_FEEDER_BLOCK_LENGTH];
+
+    unsigned int makeBlock(size_t &p, size_t amount);
+    void startBinning(void);
+    void bin(unsigned int len);
+    void emitBins(void);
 
   public:
     HistogramFeeder(
@@ -44,7 +79,7 @@ namespace SigDigger {
 
 
   signals:
-    void data(const float *data, unsigned int size);
+    void data(SigDigger::HistogramBins const &);
   };
 }
 
@@ -0,0 +1,139 @@
+//
+//    HugePages.h: Huge page backing for large sample buffers
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef HUGEPAGES_H
+#define HUGEPAGES_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Buffers below this are left alone
+#define SIGDIGGER_HUGE_PAGES_SIZE            (2 << 20)
+#define SIGDIGGER_HUGE_PAGES_MIN_SIZE        (2 * SIGDIGGER_HUGE_PAGES_SIZE)
+
+// Explicit (hugetlbfs) pages are only tried if this is set. They need a
+// preallocated pool (vm.nr_hugepages), otherwise THP is used.
+#define SIGDIGGER_HUGE_PAGES_EXPLICIT_ENV    "SIGDIGGER_HUGETLB"
+
+namespace SigDigger {
+  //
+  // Multi-gigabyte sample buffers on 4 KiB pages mean TLB pressure and
+  // one page fault per 4 KiB when they are first written. These helpers
+  // put them on 2 MiB pages instead: transparent ones (madvise, works in
+  // THP's "madvise" mode too) or, if requested, explicit ones. Pages can
+  // also be populated ahead of time from a pool thread, without touching
+  // the contents. Everything degrades to the default behavior where the
+  // OS lacks the corresponding API.
+  //
+  class HugePages
+  {
+  public:
+    // Page-aligned buffers, for buffers not held by containers
+    static void *allocate(size_t size);
+    static void release(void *ptr, size_t size);
+
+    // Back the huge page aligned part of an existing buffer with THP
+    static void advise(void *ptr, size_t size);
+
+    // Populate the pages of a buffer from a pool thread. It is safe to
+    // use the buffer (or even free it) meanwhile.
+    static void prefault(void *ptr, size_t size);
+
+    // Reserve room for `count` elements, on huge pages if it is big enough.
+    // Use this before resize() / insert() to make the new storage benefit.
+    template <class T>
+    static void
+    reserve(std::vector<T> &vec, size_t count)
+    {
+      if (vec.capacity() >= count)
+        return;
+
+      vec.reserve(count);
+      advise(vec.data(), vec.capacity() * sizeof(T));
+    }
+  };
+
+  //
+  // For sample containers whose type is not part of any API. Storage comes
+  // from HugePages::allocate() and resize() leaves trivial elements as they
+  // are: fresh pages are zero anyway, and not writing them keeps them
+  // unbacked until they are used (or prefaulted).
+  //
+  template <class T>
+  class HugePageAllocator
+  {
+  public:
+    typedef T value_type;
+
+    HugePageAllocator() = default;
+
+    template <class U>
+    HugePageAllocator(HugePageAllocator<U> const &) { }
+
+    T *
+    allocate(size_t n)
+    {
+      void *ptr = HugePages::allocate(n * sizeof(T));
+
+      if (ptr == nullptr)
+        throw std::bad_alloc();
+
+      return static_cast<T *>(ptr);
+    }
+
+    void
+    deallocate(T *ptr, size_t n)
+    {
+      HugePages::release(ptr, n * sizeof(T));
+    }
+
+    template <class U>
+    void
+    construct(U *ptr)
+    {
+      if (!std::is_trivially_destructible<U>::value)
+        ::new (static_cast<void *>(ptr)) U();
+    }
+
+    template <class U, class... Args>
+    void
+    construct(U *ptr, Args &&... args)
+    {
+      ::new (static_cast<void *>(ptr)) U(std::forward<Args>(args)...);
+    }
+  };
+
+  template <class T, class U>
+  bool
+  operator==(HugePageAllocator<T> const &, HugePageAllocator<U> const &)
+  {
+    return true;
+  }
+
+  template <class T, class U>
+  bool
+  operator!=(HugePageAllocator<T> const &, HugePageAllocator<U> const &)
+  {
+    return false;
+  }
+}
+
+#endif // HUGEPAGES_H
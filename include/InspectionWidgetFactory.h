@@ -21,6 +21,7 @@
 
 #include <TabWidgetFactory.h>
 #include <Suscan/AnalyzerRequestTracker.h>
+#include <QJsonObject>
 
 namespace SigDigger {
   class InspectionWidgetFactory;
@@ -55,6 +56,17 @@ namespace SigDigger {
     virtual void inspectorMessage(Suscan::InspectorMessage const &);
     virtual void samplesMessage(Suscan::SamplesMessage const &);
 
+    // A suspended inspector is out of sight, but keeps its analyzer-side
+    // inspector and all of its state, so reopening it is immediate. Widgets
+    // that cannot be suspended return false and are closed instead.
+    virtual bool suspend();
+    virtual void resume();
+
+    // State kept in session snapshots. The default one is the inspector
+    // config, as the "params" of a daemon channel.
+    virtual QJsonObject saveSession() const;
+    virtual void restoreSession(QJsonObject const &);
+
     // Overriden methods
     virtual void setState(int, Suscan::Analyzer *) override;
     virtual void closeRequested() override;
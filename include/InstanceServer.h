@@ -0,0 +1,93 @@
+//
+//    InstanceServer.h: Single-instance handoff server
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef INSTANCESERVER_H
+#define INSTANCESERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QJsonObject>
+#include <sigutils/types.h>
+
+//
+// A launch with arguments hands them to the instance that is already
+// running, as one JSON object per line, and exits:
+//
+//   -> {"file": "/path/capture.raw", "profile": "...", "freq": 433920000}
+//   <- {"ok": true}
+//
+// Every field is optional. Relative paths are made absolute by the
+// client, as the running instance may have a different working directory.
+//
+#define SIGDIGGER_INSTANCE_SERVER_NAME       "SigDigger-instance"
+#define SIGDIGGER_INSTANCE_HANDOFF_TIMEOUT_MS 2000
+#define SIGDIGGER_INSTANCE_MAX_LINE_SIZE      8192
+
+class QLocalServer;
+class QLocalSocket;
+
+namespace SigDigger {
+  struct LaunchRequest {
+    QString file;
+    QString profile;
+    SUFREQ  freq = 0;
+    bool    haveFreq = false;
+
+    bool
+    isEmpty(void) const
+    {
+      return this->file.isEmpty() && this->profile.isEmpty() && !this->haveFreq;
+    }
+
+    QJsonObject toJson(void) const;
+    static LaunchRequest fromJson(QJsonObject const &);
+  };
+
+  class InstanceServer : public QObject
+  {
+    Q_OBJECT
+
+    QLocalServer *m_server = nullptr;
+    QHash<QLocalSocket *, QByteArray> m_pending;
+
+    void reply(QLocalSocket *, bool ok, QString const &error = QString());
+
+  public:
+    explicit InstanceServer(QObject *parent = nullptr);
+    ~InstanceServer() override;
+
+    // Per-user, so that two users of the same machine do not meet
+    static QString serverName(void);
+
+    // Client side: true if a running instance accepted the request
+    static bool handOff(LaunchRequest const &, QString &error);
+
+    // False if another instance is already listening
+    bool listen(void);
+
+  signals:
+    void launchRequested(SigDigger::LaunchRequest const &);
+
+  public slots:
+    void onNewConnection(void);
+    void onReadyRead(void);
+    void onDisconnected(void);
+  };
+}
+
+#endif // INSTANCESERVER_H
@@ -0,0 +1,57 @@
+//
+//    LoadCaptureTask.h: Load a range of a capture file
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef LOADCAPTURETASK_H
+#define LOADCAPTURETASK_H
+
+#include <Suscan/CancellableTask.h>
+#include <sigutils/types.h>
+#include <memory>
+#include <vector>
+
+#define SIGDIGGER_LOAD_CAPTURE_BLOCK_LENGTH (1 << 20)
+
+namespace SigDigger {
+  class CaptureFile;
+
+  class LoadCaptureTask : public Suscan::CancellableTask {
+    Q_OBJECT
+
+    std::shared_ptr<CaptureFile> file;
+    std::shared_ptr<std::vector<SUCOMPLEX>> buffer;
+    quint64 from;
+    size_t count;
+    size_t p = 0;
+
+  public:
+    LoadCaptureTask(
+        std::shared_ptr<CaptureFile> const &file,
+        quint64 from,
+        size_t count,
+        QObject *parent = nullptr);
+    virtual ~LoadCaptureTask() override;
+
+    // Only valid once done() has been emitted
+    std::shared_ptr<std::vector<SUCOMPLEX>> takeBuffer(void);
+
+    virtual bool work(void) override;
+    virtual void cancel(void) override;
+  };
+}
+
+#endif // LOADCAPTURETASK_H
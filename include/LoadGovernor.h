@@ -0,0 +1,113 @@
+//
+//    LoadGovernor.h: Global load shedding
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef LOADGOVERNOR_H
+#define LOADGOVERNOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QAtomicInteger>
+
+#define SIGDIGGER_LOAD_GOVERNOR_POLL_MS        500
+
+// Signs of overload: event loop latency, time spent redrawing a frame
+// and mean latency of analyzer messages on their way to the GUI
+#define SIGDIGGER_LOAD_GOVERNOR_LAG_MS         100
+#define SIGDIGGER_LOAD_GOVERNOR_FRAME_US       40000
+#define SIGDIGGER_LOAD_GOVERNOR_QUEUE_US       250000
+
+// Polls in a row needed to shed one more level, or to restore one
+#define SIGDIGGER_LOAD_GOVERNOR_ESCALATE_POLLS 2
+#define SIGDIGGER_LOAD_GOVERNOR_RELAX_POLLS    20
+
+namespace Suscan {
+  class Analyzer;
+}
+
+namespace SigDigger {
+  // In shedding order. Every level includes the previous ones.
+  enum LoadLevel {
+    LOAD_LEVEL_NORMAL,
+    LOAD_LEVEL_REDUCED_RATE, // Live views redraw at half the frame rate
+    LOAD_LEVEL_DECIMATED,    // Visual consumers drop most of their data
+    LOAD_LEVEL_SUSPENDED,    // Background inspectors lose spectra and
+                             // estimators
+    LOAD_LEVEL_COUNT
+  };
+
+  //
+  // Central load shedding. Every poll, the governor looks at how far
+  // behind the GUI event loop, the redraw of live views and the analyzer
+  // message queue are. Audio underruns and swamped recordings are
+  // reported by their owners, from any thread. Under sustained overload,
+  // load is shed one level at a time, starting from what matters least.
+  // Audio and recordings are never shed: they are what the rest is shed
+  // for, so their reports shed a level right away. Levels are restored
+  // one at a time as well, after a long healthy period.
+  //
+  // Levels up to LOAD_LEVEL_DECIMATED are applied to the RenderScheduler
+  // here. Inspectors follow levelChanged() for the rest.
+  //
+  class LoadGovernor : public QObject
+  {
+    Q_OBJECT
+
+    QTimer pollTimer;
+    QElapsedTimer lastPoll;
+    QPointer<Suscan::Analyzer> analyzer;
+    quint64 queueCount = 0;
+    quint64 queueTotal = 0;
+
+    LoadLevel level = LOAD_LEVEL_NORMAL;
+    bool enabled = true;
+    unsigned int overloaded = 0;
+    unsigned int healthy = 0;
+
+    static QAtomicInteger<quint32> underruns;
+    static QAtomicInteger<quint32> swamps;
+    static LoadGovernor *currInstance;
+
+    LoadGovernor();
+
+    bool queueLagging(void);
+    void setLevel(LoadLevel level);
+
+  public:
+    static LoadGovernor *instance(void);
+
+    // Can be called from any thread
+    static void notifyUnderrun(void);
+    static void notifySwamp(void);
+
+    void setAnalyzer(Suscan::Analyzer *);
+    void setEnabled(bool);
+    LoadLevel getLevel(void) const;
+
+    static const char *levelDescription(LoadLevel level);
+
+  signals:
+    void levelChanged(int level);
+
+  public slots:
+    void onPoll(void);
+  };
+}
+
+#endif // LOADGOVERNOR_H
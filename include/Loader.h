@@ -23,6 +23,7 @@
 #include <QMainWindow>
 #include <QThread>
 #include <QSplashScreen>
+#include <future>
 
 #include <Suscan/Library.h>
 
@@ -57,6 +58,10 @@ namespace SigDigger {
     // Borrowed pointers
     Application *app;
     Suscan::Singleton *suscan;
+
+    // Error of the config save in progress, empty on success
+    std::shared_future<QString> configSaved;
+
     void showMessage(const QString &message);
 
   public:
@@ -65,6 +70,13 @@ namespace SigDigger {
     void load(void);
     void saveConfig(void);
 
+    // The config is taken from the UI right away, and written to disk in
+    // the background. Copies of the pending save can be waited for from
+    // any thread.
+    void beginSaveConfig(void);
+    std::shared_future<QString> getPendingConfig(void) const;
+    bool endSaveConfig(void);
+
   public slots:
     void handleChange(const QString &state);
     void handleFailure(const QString &state);
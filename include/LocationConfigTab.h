@@ -21,7 +21,7 @@
 
 #include <ConfigTab.h>
 #include <QMap>
-#include <QListWidgetItem>
+#include <QModelIndex>
 #include <Suscan/Library.h>
 
 namespace Ui {
@@ -29,6 +29,8 @@ namespace Ui {
 }
 
 namespace SigDigger {
+  class LocationListModel;
+
   class LocationConfigTab : public ConfigTab
   {
     Q_OBJECT
@@ -36,6 +38,7 @@ namespace SigDigger {
     Suscan::Location current;
     bool modified = false;
     QMap<QString, int> countryList;
+    LocationListModel *locationModel = nullptr;
     void paintMapCoords(double x, double y);
     void populateLocations(void);
     void repaintCountryList(QString searchText = "");
@@ -56,7 +59,7 @@ namespace SigDigger {
 
   public slots:
     void onSearchTextChanged(void);
-    void onLocationSelected(QListWidgetItem *item);
+    void onLocationSelected(QModelIndex const &);
     void onLocationChanged(void);
     void onRegisterLocation(void);
 
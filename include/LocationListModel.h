@@ -0,0 +1,62 @@
+//
+//    LocationListModel.h: Indexed list of known locations
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef LOCATIONLISTMODEL_H
+#define LOCATIONLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QVector>
+
+// Length of the substrings the search index is built from
+#define SIGDIGGER_LOCATION_INDEX_GRAM 3
+
+namespace SigDigger {
+  //
+  // Names of the known locations with a trigram index over their lowercase
+  // forms. A filter with at least three characters only looks at the
+  // locations containing its rarest trigram, and a filter that contains the
+  // previous one only looks at the previous matches.
+  //
+  class LocationListModel : public QAbstractListModel {
+      Q_OBJECT
+
+      QVector<QString> names;
+      QVector<QString> keys;               // Lowercase names
+      QHash<QString, QVector<int>> grams;  // Trigram -> sorted name indices
+      QVector<int> matches;                // Rows, as name indices
+      QString filter;                      // Lowercase
+
+      void indexName(int);
+      bool accepts(int) const;
+
+    public:
+      LocationListModel(QObject *parent = nullptr);
+
+      void rebuild(void);
+      void append(QString const &name);
+      void setFilter(QString const &);
+
+      QString nameAt(int row) const;
+
+      int rowCount(const QModelIndex &) const override;
+      QVariant data(const QModelIndex &, int) const override;
+  };
+}
+
+#endif // LOCATIONLISTMODEL_H
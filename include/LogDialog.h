@@ -39,6 +39,7 @@ namespace SigDigger {
       Suscan::Logger *logger;
       void connectAll(void);
       void saveLog(QString path);
+      void appendMessage(Suscan::LoggerMessage const &);
       static QTableWidgetItem *makeSeverityItem(
           enum sigutils_log_severity);
 
@@ -54,9 +55,11 @@ namespace SigDigger {
       ~LogDialog();
 
     public slots:
-      void onMessage(Suscan::LoggerMessage);
+      void onMessages(QVector<Suscan::LoggerMessage>);
       void onClear(void);
       void onSave(void);
+      void onToggleTrace(void);
+      void onExportTrace(void);
 
     private:
       Ui::LogDialog *ui;
@@ -25,10 +25,16 @@
 #include <GuiConfig.h>
 #include <WFHelpers.h>
 #include <Palette.h>
+#include <PSDPyramid.h>
+#include <WaterfallHistory.h>
 #include <QElapsedTimer>
 #include <QToolBar>
+#include <QTimer>
+#include <QList>
+#include <QPair>
 
 #define SIGDIGGER_MAIN_SPECTRUM_GRACE_PERIOD_MS 1000
+#define SIGDIGGER_MAIN_SPECTRUM_REPLAY_DELAY_MS  100
 
 class QTimeSlider;
 
@@ -42,6 +48,7 @@ class GLWaterfall;
 // Does it make sense to turn this into a PersistentWidget, anyways?
 namespace SigDigger {
   class SuscanBookmarkSource;
+  class FATOverlay;
   class MainSpectrum : public QWidget
   {
     Q_OBJECT
@@ -63,7 +70,12 @@ namespace SigDigger {
     // UI Objects
     Ui::MainSpectrum *ui = nullptr;
     std::vector<FrequencyAllocationTable *> FATs;
+    std::vector<FATOverlay *> overlays;      // One per FAT
+    std::vector<FATOverlay *> shownOverlays; // In drawing order
+    qint64 fatViewStart = 0;
+    qint64 fatViewEnd   = -1;
     SuscanBookmarkSource *bookmarkSource = nullptr;
+    quint64 fatRevision = 0;
     Waterfall   *wf   = nullptr;
     GLWaterfall *glWf = nullptr;
     ColorConfig  lastColorConfig;
@@ -72,7 +84,7 @@ namespace SigDigger {
     CaptureMode mode = UNAVAILABLE;
     Skewness filterSkewness = SYMMETRIC;
     bool throttling = false;
-    bool resAdjusted = false;
+    unsigned int resAdjustedSize = 0; // FFT size of the click resolution
     bool noLimits = false;
     qint64 minFreq = 0;
     qint64 maxFreq = 6000000000;
@@ -81,17 +93,77 @@ namespace SigDigger {
         SIGDIGGER_MAIN_SPECTRUM_GRACE_PERIOD_MS;
     int maxToolWidth = 0;
 
+    // What the overlay (bookmarks, FATs, time stamps) was last drawn
+    // for. Redraw requests are coalesced to one per frame, and dropped
+    // when none of these changed since.
+    struct OverlayState {
+      qint64 centerFreq = 0;
+      qint64 span = 0;
+      quint64 bookmarkRevision = 0;
+      quint64 fatRevision = 0;
+      bool timeStamps = false;
+      bool bookmarks = false;
+      bool fats = false;
+
+      bool
+      operator==(OverlayState const &other) const
+      {
+        return this->centerFreq == other.centerFreq
+            && this->span == other.span
+            && this->bookmarkRevision == other.bookmarkRevision
+            && this->fatRevision == other.fatRevision
+            && this->timeStamps == other.timeStamps
+            && this->bookmarks == other.bookmarks
+            && this->fats == other.fats;
+      }
+    };
+
+    OverlayState drawnOverlay;
+    bool overlayDrawn = false;
+    bool timeStampsShown = false;
+    bool bookmarksShown = false;
+    bool fatsShown = false;
+
     // Cached members (for UI update, etc)
     unsigned int cachedRate = 0;
     unsigned int bandwidth = 0;
     unsigned int zoom = 1;
 
+    // PSD decimation for display
+    PSDPyramid pyramid;
+    qreal visibleZoom = 1;
+
+    // Past frames, as fed to the waterfall
+    WaterfallHistory history;
+    QTimer *replayTimer = nullptr;
+
+    // Bins of the last frame fed to the waterfall. Past frames of other
+    // sizes are resampled to it when replayed.
+    unsigned int displayedSize = 0;
+    std::vector<float> resampled;
+
+    // Frames went to the history only while we were not on screen
+    bool viewStale = false;
+
+    // What the waterfall is drawn with, for exports
+    QRgb paletteTable[SIGDIGGER_PALETTE_MAX_STOPS];
+    float wfMin = -60;
+    float wfMax = 0;
+
     // Private methods
     void connectAll(void);
     void connectWf(void);
     void connectGLWf(void);
     void refreshUi(void);
     void updateLimits(void);
+    int  displayPixels(void) const;
+    int  displayLines(void) const;
+    void scheduleReplay(void);
+    FATOverlay *findOverlay(std::string const &) const;
+    void refreshFATViews(bool force = false);
+    OverlayState currentOverlay(void) const;
+    void invalidateOverlay(void);
+    void flushOverlay(void);
 
     // Static members
     static FrequencyBand deserializeFrequencyBand(Suscan::Object const &);
@@ -109,6 +181,13 @@ namespace SigDigger {
 
     void deserializeFATs(void);
 
+    // History
+    WaterfallHistory const &getHistory(void) const;
+    void setHistoryCapacity(quint64 ram, quint64 disk);
+    void clearHistory(void);
+    void replayHistory(size_t end);
+    bool previewTimeStamp(struct timeval const &tv);
+
     // Setters
     void setThrottling(bool);
     void setFrequencyLimits(qint64 min, qint64 max);
@@ -148,6 +227,7 @@ namespace SigDigger {
     void setUnits(QString const &, float, float);
 
     void addToolWidget(QWidget *widget, QString const &);
+    void addToolWidgets(QList<QPair<QWidget *, QString>> const &);
     void setSidePanelWidth(int);
     void setSidePanelRatio(qreal);
     void setLocked(bool);
@@ -160,6 +240,10 @@ namespace SigDigger {
     qint64 getLnbFreq(void) const;
     unsigned int getBandwidth(void) const;
     unsigned int getZoom(void) const;
+    unsigned int getDisplayFftSize(unsigned int size) const;
+    const QRgb *getPaletteTable(void) const;
+    float getWfMin(void) const;
+    float getWfMax(void) const;
     FrequencyAllocationTable *getFAT(QString const &) const;
     void adjustSizes(void);
     int sidePanelWidth(void) const;
@@ -170,6 +254,9 @@ namespace SigDigger {
     qint32 computeLowCutFreq(int bw) const;
     qint32 computeHighCutFreq(int bw) const;
 
+  protected:
+    void showEvent(QShowEvent *) override;
+
   signals:
     void bandwidthChanged(void);
     void frequencyChanged(qint64);
@@ -192,6 +279,7 @@ namespace SigDigger {
     void onNewModulation(QString);
     void onLnbFrequencyChanged(void);
     void onLockStateChanged(void);
+    void onReplayHistory(void);
   };
 }
 
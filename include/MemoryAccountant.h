@@ -0,0 +1,132 @@
+//
+//    MemoryAccountant.h: Process-wide accounting of large buffers
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef MEMORYACCOUNTANT_H
+#define MEMORYACCOUNTANT_H
+
+#include <QObject>
+#include <QMutex>
+#include <QTimer>
+#include <QVector>
+#include <QString>
+#include <atomic>
+#include <functional>
+
+#define SIGDIGGER_MEMORY_ACCOUNTANT_POLL_MS  1000
+
+// When over budget, caches are reclaimed down to this fraction of it, so
+// the budget is not hit again on the next frame
+#define SIGDIGGER_MEMORY_ACCOUNTANT_HEADROOM 0.9
+
+namespace SigDigger {
+  //
+  // Memory taken by a buffer (or a set of them) of a subsystem. Owners
+  // keep it up to date with set(), which is cheap and can be called from
+  // any thread. Buffers that can give memory back (caches, histories that
+  // can go to disk) also have a reclaimer: it is asked to free about
+  // `wanted` bytes and returns how many it did. Reclaimers always run in
+  // the GUI thread, so accounts having one must live there too.
+  //
+  class MemoryAccount {
+    friend class MemoryAccountant;
+
+    const char *subsystem;
+    std::atomic<size_t> bytes;
+    std::function<size_t (size_t)> reclaimer;
+
+  public:
+    explicit MemoryAccount(const char *subsystem);
+    MemoryAccount(MemoryAccount const &) = delete;
+    MemoryAccount &operator=(MemoryAccount const &) = delete;
+    ~MemoryAccount();
+
+    void setReclaimer(std::function<size_t (size_t wanted)> const &);
+
+    void
+    set(size_t bytes)
+    {
+      this->bytes.store(bytes, std::memory_order_relaxed);
+    }
+
+    size_t
+    get(void) const
+    {
+      return this->bytes.load(std::memory_order_relaxed);
+    }
+  };
+
+  struct MemoryUsage {
+    QString subsystem;
+    size_t  bytes = 0;
+    int     accounts = 0;
+    bool    reclaimable = false;
+  };
+
+  //
+  // Registry of every MemoryAccount of the process. With a budget set,
+  // usage is checked periodically and, when over it, reclaimers are run
+  // from the largest account down. Allocations that can be refused (like
+  // the ring of a new capture) ask admit() first.
+  //
+  class MemoryAccountant : public QObject
+  {
+    Q_OBJECT
+
+    QMutex mutex;
+    QVector<MemoryAccount *> accounts;
+    size_t budget = 0; // 0: no limit
+    quint64 reclaimed = 0;
+    unsigned int refused = 0;
+    QTimer pollTimer;
+
+    static MemoryAccountant *currInstance;
+
+    MemoryAccountant();
+
+    void add(MemoryAccount *);
+    void remove(MemoryAccount *);
+    size_t reclaim(size_t wanted);
+
+  public:
+    static MemoryAccountant *instance(void);
+
+    void setBudget(size_t bytes);
+    size_t getBudget(void) const;
+
+    size_t getTotal(void);
+    quint64 getReclaimed(void) const;
+    unsigned int getRefused(void) const;
+
+    // Per subsystem, largest first
+    QVector<MemoryUsage> getUsage(void);
+
+    // Whether `bytes` more fit in the budget. From the GUI thread, caches
+    // are reclaimed to make room if needed.
+    bool admit(size_t bytes);
+
+    // Reclaims until usage is below the budget. Returns the bytes freed.
+    size_t enforce(void);
+
+    friend class MemoryAccount;
+
+  public slots:
+    void onPoll(void);
+  };
+}
+
+#endif // MEMORYACCOUNTANT_H
@@ -0,0 +1,214 @@
+//
+//    MultiStreamSaver.h: Many recordings interleaved in one file
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef MULTISTREAMSAVER_H
+#define MULTISTREAMSAVER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QAtomicInteger>
+#include <QString>
+#include <FileDataSaver.h>
+#include <sigutils/types.h>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <algorithm>
+#include <stdint.h>
+
+// Ring of the shared container. Every stream writes into it, so it is
+// sized for all of them rather than after a sample rate.
+#define SIGDIGGER_MULTI_STREAM_RING_BYTES     (64ul << 20)
+
+// Payload of a block. Streams are staged up to this size and written as
+// one tagged block each, so the disk sees large sequential writes only.
+#define SIGDIGGER_MULTI_STREAM_BLOCK_BYTES    (256ul << 10)
+
+#define SIGDIGGER_MULTI_STREAM_FILE_MAGIC     "SDMUX01"
+#define SIGDIGGER_MULTI_STREAM_INDEX_MAGIC    "SDMUXIDX"
+#define SIGDIGGER_MULTI_STREAM_BLOCK_MAGIC    0x4b4c4253 // "SBLK"
+#define SIGDIGGER_MULTI_STREAM_EXTENSION      ".sdms"
+
+namespace SigDigger {
+  //
+  // Container layout (host byte order, like the raw captures):
+  //
+  //   MultiStreamFileHeader
+  //   MultiStreamBlockHeader + payload, repeated, streams interleaved
+  //   Stream index (see MultiStreamContainer::writeIndex)
+  //   MultiStreamFileFooter
+  //
+  // The index is written when the last stream closes. Files without it
+  // (e.g. after a crash) are still readable by scanning the blocks.
+  //
+  struct MultiStreamFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t size;      // Of this header, blocks start right after
+  };
+
+  struct MultiStreamBlockHeader {
+    uint32_t magic;
+    uint32_t stream;
+    uint64_t seq;       // Per stream, from 0
+    uint32_t length;    // Payload bytes following this header
+    uint32_t reserved;
+  };
+
+  struct MultiStreamFileFooter {
+    uint64_t index;     // File offset of the stream index
+    char     magic[8];
+  };
+
+  struct MultiStreamInfo {
+    uint32_t id = 0;
+    uint32_t sampleSize = 0;
+    uint32_t sampleRate = 0;
+    std::string name;
+    uint64_t bytes = 0;
+    std::vector<uint64_t> blocks; // File offsets of its block headers
+  };
+
+  class MultiStreamChannel;
+
+  //
+  // One container file per record directory, shared by every channel
+  // recording into it. Channels are created with open() and the
+  // container goes away with the last of them.
+  //
+  class MultiStreamContainer : public QObject {
+    Q_OBJECT
+
+    std::string dir;
+    std::string path;
+    FileDataSaver *saver = nullptr;
+
+    // Channels write from their own threads, the saver takes only one
+    QMutex mutex;
+    uint64_t offset = 0;
+    std::vector<MultiStreamInfo> streams;
+    unsigned int openStreams = 0;
+
+    MultiStreamContainer(std::string const &dir);
+    ~MultiStreamContainer() override;
+
+    bool create(QString &error);
+    bool push(const uint8_t *data, size_t size, uint64_t &offset);
+    bool writeBlock(
+        uint32_t stream,
+        uint8_t *block,
+        size_t length,
+        uint64_t seq);
+    void writeIndex(void);
+    void closeStream(uint32_t stream);
+
+    friend class MultiStreamChannel;
+
+  public:
+    // Adds a stream to the container of `dir`, creating it if needed.
+    // The caller owns the channel.
+    static MultiStreamChannel *open(
+        std::string const &dir,
+        std::string const &name,
+        unsigned int sampleSize,
+        unsigned int sampleRate,
+        QString &error);
+
+    std::string getPath(void) const;
+    qreal getBufferUsage(void);
+    qreal getBufferHighWater(void);
+    QString getLastError(void) const;
+
+  signals:
+    void stopped(void);
+    void dataRate(qreal);
+    void commit(void);
+  };
+
+  //
+  // A stream of a container. Same producer interface as the data savers:
+  // write() is called from a single thread and never blocks. Data is
+  // staged here and goes into the shared ring a whole block at a time.
+  //
+  class MultiStreamChannel : public QObject {
+    Q_OBJECT
+
+    MultiStreamContainer *container;
+    uint32_t id;
+    std::vector<uint8_t> block; // Header room + payload
+    size_t used = 0;
+    uint64_t seq = 0;
+    QAtomicInteger<quint64> size = 0;
+
+    bool flush(void);
+
+    MultiStreamChannel(MultiStreamContainer *container, uint32_t id);
+
+    friend class MultiStreamContainer;
+
+  public:
+    ~MultiStreamChannel() override;
+
+    template<typename T> void write(const T *, size_t size);
+
+    // Bytes of this stream taken by the container
+    quint64 getSize(void) const;
+    qreal getBufferUsage(void);
+    qreal getBufferHighWater(void);
+    QString getLastError(void) const;
+    std::string getPath(void) const;
+
+  signals:
+    void stopped(void);
+    void swamped(void);
+    void dataRate(qreal);
+    void commit(void);
+  };
+
+  //
+  // Demultiplexer for container files
+  //
+  class MultiStreamReader {
+    FILE *fp = nullptr;
+    uint64_t fileSize = 0;
+    std::vector<MultiStreamInfo> streams;
+    std::string lastError;
+
+    bool readIndex(void);
+    bool scan(void);
+
+  public:
+    ~MultiStreamReader();
+
+    bool open(std::string const &path);
+    std::vector<MultiStreamInfo> const &getStreams(void) const;
+
+    // Writes the payload of a stream (raw samples, as recorded) to path
+    bool extract(size_t index, std::string const &path);
+    std::string getLastError(void) const;
+  };
+
+  extern template void
+  MultiStreamChannel::write<SUCOMPLEX>(const SUCOMPLEX *, size_t);
+  extern template void
+  MultiStreamChannel::write<SUFLOAT>(const SUFLOAT *, size_t);
+  extern template void
+  MultiStreamChannel::write<uint8_t>(const uint8_t *, size_t);
+}
+
+#endif // MULTISTREAMSAVER_H
@@ -22,6 +22,7 @@
 
 #include <QWidget>
 #include <WaitingSpinnerWidget.h>
+#include <SocketForwarder.h>
 
 namespace Ui {
   class UDPForwarderUI;
@@ -35,6 +36,7 @@ namespace SigDigger {
     WaitingSpinnerWidget *spinner = nullptr;
 
     void connectAll(void);
+    void refreshFormatControls(void);
 
   public:
     explicit NetForwarderUI(QWidget *parent = nullptr);
@@ -49,17 +51,29 @@ namespace SigDigger {
     void setForwardState(bool state);
     void setForwardEnabled(bool enabled);
     void setCaptureSize(quint64 size);
-    void setTcp(bool);
+    void setMode(SocketForwarderMode);
+    void setHeader(bool);
+    void setFormat(SocketForwarderFormat);
+    void setOverflow(SocketForwarderOverflow);
+    void setQueueState(qreal usage, quint64 dropped);
+    void setFullScale(SUFLOAT);
+    void setDecimation(unsigned int);
 
     // Getters
     std::string getHost(void) const;
     uint16_t getPort(void) const;
     unsigned int getFrameLen(void) const;
     bool getForwardState(void) const;
-    bool getTcp(void) const;
+    SocketForwarderMode getMode(void) const;
+    bool getHeader(void) const;
+    SocketForwarderFormat getFormat(void) const;
+    SocketForwarderOverflow getOverflow(void) const;
+    SUFLOAT getFullScale(void) const;
+    unsigned int getDecimation(void) const;
 
   public slots:
     void onForwardStartStop(void);
+    void onFormatChanged(void);
 
   signals:
     void forwardStateChanged(bool state);
@@ -0,0 +1,205 @@
+//
+//    OccupancyAccumulator.h: Long-term spectrum occupancy statistics
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef OCCUPANCYACCUMULATOR_H
+#define OCCUPANCYACCUMULATOR_H
+
+#include <Suscan/Messages/PSDMessage.h>
+#include <QtGlobal>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define SIGDIGGER_OCCUPANCY_DEFAULT_CHANNELS 1024
+#define SIGDIGGER_OCCUPANCY_MAX_CHANNELS     8192
+#define SIGDIGGER_OCCUPANCY_DEFAULT_BUCKET   60.
+
+// Levels are stored as one byte: 0.5 dB steps from -120 dB
+#define SIGDIGGER_OCCUPANCY_LEVEL_MIN        -120.f
+#define SIGDIGGER_OCCUPANCY_LEVEL_STEP       .5f
+
+// Percentiles come from a per-channel histogram of this many cells over
+// the level range (2 dB each)
+#define SIGDIGGER_OCCUPANCY_SKETCH_CELLS     64
+
+#define SIGDIGGER_OCCUPANCY_MAGIC            "SDOCCUP1"
+#define SIGDIGGER_OCCUPANCY_INDEX_FILE       "occupancy.idx"
+
+namespace SigDigger {
+  enum OccupancyColumn {
+    OCCUPANCY_DUTY,   // Fraction of PSDs over the threshold, 0 - 255
+    OCCUPANCY_MAX,    // Max hold
+    OCCUPANCY_P10,
+    OCCUPANCY_P50,
+    OCCUPANCY_P90,
+    OCCUPANCY_COLUMN_COUNT
+  };
+
+  // One per time bucket, in the index file
+  struct OccupancyBucket {
+    double start;     // PSD timestamps
+    double end;
+    double fc;
+    quint32 fs;
+    quint32 frames;
+    float threshold;  // dB
+    quint32 reserved;
+  };
+
+  static inline float
+  occupancyLevel(uint8_t q)
+  {
+    return SIGDIGGER_OCCUPANCY_LEVEL_MIN + SIGDIGGER_OCCUPANCY_LEVEL_STEP * q;
+  }
+
+  //
+  // Append-only columnar store in a directory. The index holds a header
+  // and one OccupancyBucket per bucket; every column lives in a file of
+  // its own, holding one byte per channel and bucket. Reading a time
+  // range of one column is a single contiguous read. Columns are written
+  // before the index record, so a bucket interrupted halfway is simply
+  // not there after a crash. Host byte order.
+  //
+  class OccupancyStore {
+    std::string path;
+    std::string lastError;
+    FILE *index = nullptr;
+    FILE *columns[OCCUPANCY_COLUMN_COUNT] = {nullptr};
+    std::vector<OccupancyBucket> buckets;
+    unsigned int channels = 0;
+
+    std::string columnPath(int column) const;
+
+  public:
+    OccupancyStore();
+    ~OccupancyStore();
+
+    OccupancyStore(OccupancyStore const &) = delete;
+    OccupancyStore &operator=(OccupancyStore const &) = delete;
+
+    // Creates the store if the index does not exist. Existing stores
+    // keep their number of channels.
+    bool open(std::string const &dir, unsigned int channels);
+    void close(void);
+
+    bool
+    isOpen(void) const
+    {
+      return this->index != nullptr;
+    }
+
+    std::string
+    getError(void) const
+    {
+      return this->lastError;
+    }
+
+    unsigned int
+    getChannels(void) const
+    {
+      return this->channels;
+    }
+
+    size_t
+    count(void) const
+    {
+      return this->buckets.size();
+    }
+
+    OccupancyBucket const &
+    bucket(size_t index) const
+    {
+      return this->buckets[index];
+    }
+
+    quint64 size(void) const;
+
+    // Data holds OCCUPANCY_COLUMN_COUNT x channels bytes
+    bool append(OccupancyBucket const &, const uint8_t *data);
+
+    // First bucket ending after t
+    size_t find(qreal t) const;
+
+    // count x channels bytes of one column, from bucket first on
+    bool read(
+        OccupancyColumn column,
+        size_t first,
+        size_t count,
+        std::vector<uint8_t> &out);
+  };
+
+  struct OccupancyParams {
+    qreal bucket = SIGDIGGER_OCCUPANCY_DEFAULT_BUCKET;
+    SUFLOAT threshold = -80;
+  };
+
+  //
+  // Reduces the PSD stream to per-channel statistics over fixed time
+  // buckets: duty cycle over the threshold, max hold and the 10, 50 and
+  // 90 percentiles of the level. PSD bins are grouped into the channels
+  // of the store by their maximum, so narrow carriers are not averaged
+  // away. A bucket closes when its time is over, or earlier if the
+  // center frequency or the sample rate change.
+  //
+  class OccupancyAccumulator {
+    OccupancyParams params;
+    OccupancyStore store;
+
+    double bucketStart = 0;
+    double lastTime = 0;
+    SUFREQ fc = 0;
+    unsigned int fs = 0;
+    quint32 frames = 0;
+
+    std::vector<quint32> exceed;
+    std::vector<uint8_t> maxHold;
+    std::vector<quint32> sketch;  // channels x cells
+    std::vector<uint8_t> record;
+    std::vector<SUFLOAT> reduced;
+
+    void reduce(const SUFLOAT *psd, size_t size);
+    void reset(void);
+    bool flush(void);
+
+  public:
+    ~OccupancyAccumulator();
+
+    void setParams(OccupancyParams const &);
+    OccupancyParams const &getParams(void) const;
+
+    bool open(std::string const &dir, unsigned int channels);
+    void close(void);
+
+    bool
+    isOpen(void) const
+    {
+      return this->store.isOpen();
+    }
+
+    OccupancyStore &
+    getStore(void)
+    {
+      return this->store;
+    }
+
+    // Returns false if the bucket closed by this PSD could not be saved
+    bool feed(Suscan::PSDMessage const &);
+  };
+}
+
+#endif // OCCUPANCYACCUMULATOR_H
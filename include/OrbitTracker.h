@@ -0,0 +1,86 @@
+//
+//    OrbitTracker.h: Shared orbit propagation
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef ORBITTRACKER_H
+#define ORBITTRACKER_H
+
+#include <QHash>
+#include <QString>
+#include <sgdp4/sgdp4.h>
+#include <sys/time.h>
+
+// Subscribers asking for a state within this time from the last one
+// computed get the last one
+#define SIGDIGGER_ORBIT_TRACKER_RESOLUTION_US 100000
+
+namespace SigDigger {
+  // Everything that shows where a satellite is (and its Doppler) asks
+  // here. Subscribers of the same satellite over the same site share a
+  // single propagation, computed at most once per resolution interval.
+  // Used from the GUI thread only.
+  class OrbitTracker
+  {
+  public:
+    typedef int Handle;
+
+    struct State {
+      xyz_t azel;
+      xyz_t vazel;   // vazel.distance is the range rate, in km/s
+    };
+
+  private:
+    struct Entry {
+      QString key;
+      orbit_t orbit;
+      xyz_t site;
+      sgdp4_prediction_t prediction;
+      unsigned int refs = 0;
+      bool haveState = false;
+      struct timeval stamp;
+      State state;
+    };
+
+    static OrbitTracker *currInstance;
+
+    QHash<QString, Entry *> entries;
+    QHash<Handle, Entry *>  handles;
+    Handle lastHandle = 0;
+
+    static QString makeKey(orbit_t const &, xyz_t const &);
+
+    OrbitTracker();
+
+  public:
+    static OrbitTracker *instance(void);
+
+    // Returns -1 if the orbit cannot be propagated over that site
+    Handle subscribe(orbit_t const *orbit, xyz_t const &site);
+    void unsubscribe(Handle);
+
+    bool getState(Handle, struct timeval const &when, State &state);
+    SUFLOAT getDoppler(Handle, struct timeval const &when, SUFREQ freq);
+
+    unsigned int
+    propagations(void) const
+    {
+      return static_cast<unsigned>(this->entries.size());
+    }
+  };
+}
+
+#endif // ORBITTRACKER_H
@@ -0,0 +1,77 @@
+//
+//    PSDPyramid.h: Multi-resolution PSD decimation
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef PSDPYRAMID_H
+#define PSDPYRAMID_H
+
+#include <QtGlobal>
+#include <vector>
+
+#define SIGDIGGER_PSD_PYRAMID_MAX_LEVELS    16
+#define SIGDIGGER_PSD_PYRAMID_BINS_PER_PIXEL 2
+
+namespace SigDigger {
+  //
+  // Each level halves the number of bins of the previous one. In MAXIMUM
+  // mode every output bin holds the largest of the two bins it replaces,
+  // so narrow carriers survive decimation. In MEAN mode the total power
+  // is preserved instead. MINIMUM is the counterpart of MAXIMUM, for
+  // min holds.
+  //
+  class PSDPyramid {
+  public:
+    enum Mode {
+      MAXIMUM,
+      MEAN,
+      MINIMUM
+    };
+
+  private:
+    std::vector<float> levels[SIGDIGGER_PSD_PYRAMID_MAX_LEVELS];
+    Mode mode = MAXIMUM;
+
+  public:
+    void setMode(Mode mode);
+    Mode getMode(void) const;
+
+    // Returns the requested level of data (level 0 is data itself). Only
+    // the levels up to the requested one are computed.
+    float *compute(
+        float *data,
+        unsigned int size,
+        unsigned int level,
+        unsigned int &outSize);
+
+    // Coarsest level still providing enough bins per pixel
+    static unsigned int levelFor(
+        unsigned int size,
+        qreal zoom,
+        int pixels);
+
+    // Same span, any number of bins. Fewer bins are merged according to
+    // mode, more are interpolated. Used to carry PSDs across FFT sizes.
+    static void resample(
+        const float *data,
+        unsigned int size,
+        float *out,
+        unsigned int outSize,
+        Mode mode = MAXIMUM);
+  };
+}
+
+#endif // PSDPYRAMID_H
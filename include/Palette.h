@@ -39,9 +39,11 @@ namespace SigDigger {
   class Palette {
       std::string name;
       QColor gradient[SIGDIGGER_PALETTE_MAX_STOPS];
+      QRgb   rgbTable[SIGDIGGER_PALETTE_MAX_STOPS]; // Same, packed ARGB
       uint8_t bitmap[SIGDIGGER_PALETTE_BITMAP_SZ];
       QImage thumbnail;
 
+      void updateRgbTable(void);
       void updateThumbnail(void);
 
     public:
@@ -70,6 +72,13 @@ namespace SigDigger {
       {
         return this->gradient;
       }
+
+      // Built by compose(). Mapping a level to a color is a single lookup.
+      const QRgb *
+      getRgbTable(void) const
+      {
+        return this->rgbTable;
+      }
   };
 }
 
@@ -20,6 +20,8 @@
 #define PANORAMICDIALOG_H
 
 #include <QDialog>
+#include <QMenu>
+#include <QTimer>
 #include <map>
 #include <Suscan/Source.h>
 #include <PersistentWidget.h>
@@ -27,12 +29,25 @@
 #include "ui_PanoramicDialog.h"
 #include "DeviceGain.h"
 #include "Palette.h"
+#include "Scanner.h"
+#include "PanoramicRecorder.h"
+#include "PanoramicRelay.h"
+
+#define SIGDIGGER_PANORAMIC_REPLAY_INTERVAL_MS 40
+
+// Live sweeps are shown (and recorded) as one frame per interval, no
+// matter how fast the hops arrive
+#define SIGDIGGER_PANORAMIC_FRAME_INTERVAL_MS  40
+
+class GLWaterfall;
 
 namespace Ui {
   class PanoramicDialog;
 }
 
 namespace SigDigger {
+  class GuiConfig;
+
   struct SavedSpectrum {
     std::vector<float> data;
     qint64 start;
@@ -51,10 +66,15 @@ namespace SigDigger {
     SUFLOAT panRangeMax = 0;
     SUFREQ lnbFreq;
     int sampRate = 20000000;
+    unsigned int resolution = SIGDIGGER_SCANNER_SPECTRUM_SIZE;
     std::string device;
+    std::string extraDevices;
     std::string strategy;
     std::string partitioning;
     std::string palette = "Turbo (Gqrx)";
+    std::string relayMode = "Off";
+    std::string relayHost;
+    unsigned int relayPort = SIGDIGGER_PANORAMIC_RELAY_DEFAULT_PORT;
 
     std::map<std::string, float> gains;
     bool hasGain(std::string const &dev, std::string const &name) const;
@@ -75,11 +95,24 @@ namespace SigDigger {
       QWidget *noGainLabel = nullptr;
       std::vector<DeviceGain *> gainControls;
       std::map<std::string, Suscan::Source::Device> deviceMap;
+      QMenu *extraDevicesMenu = nullptr;
       std::vector<FrequencyAllocationTable *> FATs;
 
       QString bannedDevice;
 
       SavedSpectrum saved;
+      PanoramicRecorder recorder;
+      PanoramicReader reader;
+      PanoramicFrame replayed;
+      QTimer replayTimer;
+      size_t replayFrame = 0;
+
+      // Live frame, updated in place with the dirty range of each hop
+      std::vector<float> liveFrame;
+      qint64 liveStart = 0;
+      qint64 liveEnd = 0;
+      bool livePending = false;
+      QTimer frameTimer;
 
       qint64 freqStart = 0;
       qint64 freqEnd = 0;
@@ -93,6 +126,12 @@ namespace SigDigger {
       bool adjustingRange = false;
       bool fixedFreqMode = false;
 
+      // One of them, depending on the GUI config
+      Waterfall   *wf   = nullptr;
+      GLWaterfall *glWf = nullptr;
+      ColorConfig  lastColors;
+
+      void connectWaterfall(QWidget *);
       void connectAll(void);
       void refreshUi(void);
       void redrawMeasures(void);
@@ -104,6 +143,10 @@ namespace SigDigger {
       void setRanges(Suscan::Source::Device const &);
       void setWfRange(qint64 min, qint64 max);
       void adjustRanges(void);
+      void stopRecording(void);
+      void stopReplay(void);
+      void feedFrame(qint64, qint64, float *, size_t);
+      void populateExtraDevicesMenu(void);
 
       static FrequencyBand deserializeFrequencyBand(Suscan::Object const &);
       static int getFrequencyUnits(qint64);
@@ -113,29 +156,42 @@ namespace SigDigger {
       explicit PanoramicDialog(QWidget *parent = nullptr);
       ~PanoramicDialog() override;
 
+      // Time a device needs after a retune before its samples are good
+      static unsigned int preferredSettleMs(Suscan::Source::Device const &);
+
+      // Only bins dirtyStart to dirtyEnd (exclusive) changed since the
+      // last call, unless the range or the size are different
       void feed(
           qint64 freqStart,
           qint64 freqEnd,
-          float *data,
-          size_t size);
+          const float *data,
+          size_t size,
+          size_t dirtyStart,
+          size_t dirtyEnd);
 
       SUFREQ getMinFreq(void) const;
       SUFREQ getMaxFreq(void) const;
       SUFREQ getLnbOffset(void) const;
       SUFLOAT getPreferredSampleRate(void) const;
 
+      void setGuiConfig(GuiConfig const &config);
       void setColors(ColorConfig const &config);
       void setPaletteGradient(QString const &gradient);
       void populateDeviceCombo(void);
       unsigned int getRttMs(void) const;
       float getRelBw(void) const;
+      unsigned int getResolution(void) const;
       void setRunning(bool);
       void run(void);
       void setMinBwForZoom(quint64 bw);
       bool invalidRange(void) const;
       bool getSelectedDevice(Suscan::Source::Device &) const;
+      std::vector<Suscan::Source::Device> getExtraDevices(void) const;
       QString getStrategy(void) const;
       QString getPartitioning(void) const;
+      QString getRelayMode(void) const;
+      QString getRelayHost(void) const;
+      quint16 getRelayPort(void) const;
       float getGain(QString const &) const;
       void setBannedDevice(QString const &);
       void saveConfig(void);
@@ -168,10 +224,16 @@ namespace SigDigger {
       void onNewCenterFreq(qint64);
       void onPaletteChanged(int);
       void onStrategyChanged(QString);
+      void onRelayModeChanged(void);
       void onLnbOffsetChanged(void);
       void onExport(void);
       void onGainChanged(QString name, float val);
       void onSampleRateSpinChanged(void);
+      void onResolutionChanged(void);
+      void onToggleRecord(void);
+      void onToggleReplay(void);
+      void onReplayTimeout(void);
+      void onFrameTimeout(void);
 
     private:
       Ui::PanoramicDialog *ui;
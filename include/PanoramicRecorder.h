@@ -0,0 +1,118 @@
+//
+//    include/PanoramicRecorder.h: Compact recording of panoramic spectrum frames
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef PANORAMICRECORDER_H
+#define PANORAMICRECORDER_H
+
+#include <QFile>
+#include <QString>
+#include <sys/time.h>
+#include <vector>
+
+#define SIGDIGGER_PANORAMIC_RECORDER_MAGIC        "SDPANREC"
+#define SIGDIGGER_PANORAMIC_RECORDER_VERSION      1
+#define SIGDIGGER_PANORAMIC_RECORDER_FRAME_MAGIC  0x4d415246 // "FRAM"
+#define SIGDIGGER_PANORAMIC_RECORDER_KEY_INTERVAL 64
+#define SIGDIGGER_PANORAMIC_RECORDER_DB_SCALE     10.f       // 0.1 dB units
+#define SIGDIGGER_PANORAMIC_RECORDER_INDEX_EXT    ".idx"
+
+namespace SigDigger {
+  //
+  // Recordings are made of an append-only data file and an index file
+  // next to it (same path, plus SIGDIGGER_PANORAMIC_RECORDER_INDEX_EXT).
+  //
+  // The data file starts with an 8-byte magic and a 32-bit version, and
+  // it is followed by frames with this header (little endian):
+  //
+  //   u32 magic, u32 payload length, u32 bins, u8 flags,
+  //   i64 timestamp (us), i64 freqMin, i64 freqMax
+  //
+  // Power is quantized to 0.1 dB. Key frames (flags & 1) store the
+  // difference between adjacent bins, and the rest store the difference
+  // with the same bin of the previous frame. Differences are zigzag
+  // varints, so quiet spectra take about one byte per bin.
+  //
+  // Every index entry holds the offset, timestamp and flags of a frame. A
+  // reader rebuilds the index from the data file if it is missing or
+  // truncated.
+  //
+  struct PanoramicFrame {
+    struct timeval timeStamp;
+    qint64 freqMin = 0;
+    qint64 freqMax = 0;
+    std::vector<float> psd;
+  };
+
+  struct PanoramicIndexEntry {
+    quint64 offset;
+    qint64  timeStamp;
+    quint32 flags;
+  };
+
+  class PanoramicRecorder {
+    QFile data;
+    QFile index;
+    std::vector<qint32> prev;
+    std::vector<quint8> buffer;
+    qint64 prevMin = 0;
+    qint64 prevMax = 0;
+    quint64 frames = 0;
+    quint64 sinceKey = 0;
+
+  public:
+    ~PanoramicRecorder();
+
+    bool open(QString const &path);
+    void close(void);
+    bool isOpen(void) const;
+
+    bool write(
+        struct timeval const &tv,
+        qint64 freqMin,
+        qint64 freqMax,
+        const float *psd,
+        size_t size);
+
+    quint64 getFrameCount(void) const;
+    qint64 getBytesWritten(void) const;
+  };
+
+  class PanoramicReader {
+    QFile data;
+    std::vector<PanoramicIndexEntry> entries;
+    std::vector<qint32> curr;
+    std::vector<quint8> buffer;
+    qint64 decoded = -1;
+
+    bool loadIndex(QString const &path);
+    bool rebuildIndex(void);
+    bool decodeNext(size_t frame, PanoramicFrame &);
+
+  public:
+    ~PanoramicReader();
+
+    bool open(QString const &path);
+    void close(void);
+    bool isOpen(void) const;
+
+    size_t getFrameCount(void) const;
+    bool read(size_t frame, PanoramicFrame &);
+  };
+}
+
+#endif // PANORAMICRECORDER_H
@@ -0,0 +1,110 @@
+//
+//    PanoramicRelay.h: Exchange of panoramic sweep fragments between nodes
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef PANORAMICRELAY_H
+#define PANORAMICRELAY_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QHash>
+#include "Scanner.h"
+
+//
+// Every hop of a sending node travels as a fragment: a SpectrumView
+// covering the hop only, of the same resolution as the aggregator's view.
+// Only the bins with data are sent. All fields are little endian:
+//
+//   uint32 magic, uint32 size, uint32 first, uint32 count,
+//   double freqMin, double freqMax,
+//   count x (float accum, float count)
+//
+#define SIGDIGGER_PANORAMIC_RELAY_MAGIC        0x46504453 // "SDPF"
+#define SIGDIGGER_PANORAMIC_RELAY_HEADER_SIZE  32
+#define SIGDIGGER_PANORAMIC_RELAY_DEFAULT_PORT 28005
+
+// Sender-side backlog after which fragments are dropped instead of queued
+#define SIGDIGGER_PANORAMIC_RELAY_MAX_BACKLOG  (8 << 20)
+#define SIGDIGGER_PANORAMIC_RELAY_RECONNECT_MS 2000
+
+namespace SigDigger {
+  class PanoramicRelaySender : public QObject
+  {
+    Q_OBJECT
+
+    QTcpSocket socket;
+    QString host;
+    quint16 port;
+    QTimer reconnectTimer;
+    QByteArray packet;
+    quint64 sent = 0;
+    quint64 dropped = 0;
+
+  public:
+    PanoramicRelaySender(
+        QString const &host,
+        quint16 port,
+        QObject *parent = nullptr);
+
+    void send(SpectrumView const &fragment);
+
+    quint64 getSentCount(void) const;
+    quint64 getDroppedCount(void) const;
+
+  public slots:
+    void onDisconnected(void);
+    void onError(QAbstractSocket::SocketError);
+    void onReconnect(void);
+  };
+
+  class PanoramicRelayReceiver : public QObject
+  {
+    Q_OBJECT
+
+    QTcpServer server;
+    QHash<QTcpSocket *, QByteArray> peers; // Pending input of each one
+    SpectrumView fragment;
+    quint64 received = 0;
+    quint64 rejected = 0;
+
+    bool parse(QByteArray &pending);
+
+  public:
+    PanoramicRelayReceiver(unsigned int size, QObject *parent = nullptr);
+    ~PanoramicRelayReceiver() override;
+
+    bool listen(quint16 port);
+    QString errorString(void) const;
+
+    unsigned int getPeerCount(void) const;
+    quint64 getReceivedCount(void) const;
+    quint64 getRejectedCount(void) const;
+
+  signals:
+    // Direct connection only: the fragment is reused
+    void fragmentReceived(SigDigger::SpectrumView const &);
+
+  public slots:
+    void onNewConnection(void);
+    void onReadyRead(void);
+    void onDisconnected(void);
+  };
+}
+
+#endif // PANORAMICRELAY_H
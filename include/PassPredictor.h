@@ -0,0 +1,107 @@
+//
+//    PassPredictor.h: Background satellite pass prediction
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef PASSPREDICTOR_H
+#define PASSPREDICTOR_H
+
+#include <QObject>
+#include <QVector>
+#include <sgdp4/sgdp4.h>
+#include <sys/time.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Points of the az/el track of each pass, AOS and LOS included
+#define SIGDIGGER_PASS_PREDICTOR_TRACK_POINTS 21
+
+// Shortest and longest time spans in which a pass is searched
+#define SIGDIGGER_PASS_PREDICTOR_WINDOW_MIN (1 * 86400.0)  // 1 day
+#define SIGDIGGER_PASS_PREDICTOR_WINDOW_MAX (30 * 86400.0) // 30 days
+
+namespace SigDigger {
+  struct SatellitePass {
+    struct timeval aos;
+    struct timeval los;
+    QVector<xyz_t> track; // Equally spaced in time, from AOS to LOS
+  };
+
+  // Computes passes of an orbit over a site in a background thread. Only
+  // the latest request is served: requests made while another one is
+  // being computed replace whatever was still pending.
+  class PassPredictor : public QObject
+  {
+    Q_OBJECT
+
+    struct Request {
+      quint64 id = 0;
+      orbit_t orbit;
+      xyz_t site;
+      struct timeval from;
+      int count = 0;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::thread thread;
+    bool     exiting = false;
+    bool     havePending = false;
+    quint64  lastId = 0;
+    Request  pending;
+
+    quint64  resultId = 0;
+    bool     haveResult = false;
+    QVector<SatellitePass> result;
+
+    void run(void);
+    static QVector<SatellitePass> predict(Request const &);
+
+  public:
+    // Finds the first pass after origin (or the current one, if first
+    // and the satellite is visible), without its track
+    static bool findPass(
+        sgdp4_prediction_t *,
+        orbit_t const &,
+        struct timeval const &origin,
+        bool first,
+        SatellitePass &);
+
+    // Fills the track of a pass whose AOS and LOS are known
+    static void computeTrack(sgdp4_prediction_t *, SatellitePass &);
+
+    explicit PassPredictor(QObject *parent = nullptr);
+    ~PassPredictor() override;
+
+    // Asks for the next `count` passes after `from`. If the satellite is
+    // visible at `from`, the first pass is the current one. Returns the
+    // identifier of the request.
+    quint64 request(
+        orbit_t const *orbit,
+        xyz_t const &site,
+        struct timeval const &from,
+        int count);
+
+    // Gets the passes of the last finished request
+    bool take(quint64 &id, QVector<SatellitePass> &passes);
+
+  signals:
+    void ready(void);
+  };
+}
+
+#endif // PASSPREDICTOR_H
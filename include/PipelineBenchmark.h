@@ -0,0 +1,170 @@
+//
+//    PipelineBenchmark.h: Headless benchmark of the analyzer pipeline
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef PIPELINEBENCHMARK_H
+#define PIPELINEBENCHMARK_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QStringList>
+#include <QTimer>
+#include <QJsonObject>
+#include <Suscan/Analyzer.h>
+#include <Suscan/AnalyzerRequestTracker.h>
+#include <Suscan/AnalyzerStats.h>
+#include <Averager.h>
+#include <DecisionBlock.h>
+#include <BenchmarkHistory.h>
+
+#define SIGDIGGER_BENCHMARK_DEFAULT_DURATION_S   10
+#define SIGDIGGER_BENCHMARK_DEFAULT_SAMPLE_RATE  1000000
+#define SIGDIGGER_BENCHMARK_DEFAULT_INSPECTORS   4
+#define SIGDIGGER_BENCHMARK_DEFAULT_BANDWIDTH    10000
+#define SIGDIGGER_BENCHMARK_DEFAULT_CLASS        "psk"
+#define SIGDIGGER_BENCHMARK_DEFAULT_FORWARD_PORT 9999
+
+// Length of the looped synthetic recording
+#define SIGDIGGER_BENCHMARK_SYNTHETIC_SAMPLES    (1 << 20)
+
+// Unthrottled, unless told otherwise
+#define SIGDIGGER_BENCHMARK_UNTHROTTLED          1000000000
+
+namespace SigDigger {
+  class FileDataSaver;
+  class SocketForwarder;
+
+  struct BenchmarkParams {
+    QString      path;  // Empty: synthetic source
+    enum suscan_source_format format = SUSCAN_SOURCE_FORMAT_AUTO;
+    unsigned int sampleRate = SIGDIGGER_BENCHMARK_DEFAULT_SAMPLE_RATE;
+    unsigned int throttle   = SIGDIGGER_BENCHMARK_UNTHROTTLED;
+    qreal        duration   = SIGDIGGER_BENCHMARK_DEFAULT_DURATION_S;
+    int          inspectors = SIGDIGGER_BENCHMARK_DEFAULT_INSPECTORS;
+    std::string  inspClass  = SIGDIGGER_BENCHMARK_DEFAULT_CLASS;
+    SUFREQ       bandwidth  = SIGDIGGER_BENCHMARK_DEFAULT_BANDWIDTH;
+    QStringList  consumers;
+    QString      forwardHost = "127.0.0.1";
+    uint16_t     forwardPort = SIGDIGGER_BENCHMARK_DEFAULT_FORWARD_PORT;
+    QString      output; // Empty: standard output
+    QString      history = SIGDIGGER_BENCHMARK_HISTORY_DIR;
+    QString      tolerances;
+    bool         record = true;
+
+    // Returns false (after printing why) on bad arguments
+    bool parse(int argc, char **argv);
+    static void help(const char *argv0);
+  };
+
+  //
+  // Runs the analyzer on a file (or synthetic) source for a fixed time,
+  // with N inspectors and every consumer in M attached to each of them,
+  // and writes a JSON report of the throughput, the message latencies of
+  // the analyzer and the CPU time spent in every stage. These are also
+  // compared with (and recorded to) the benchmark history.
+  //
+  class PipelineBenchmark : public QObject
+  {
+    Q_OBJECT
+
+    struct Stage {
+      uint64_t calls = 0;
+      uint64_t items = 0;
+      uint64_t cpuNs = 0;
+      Suscan::StatsHistogram timeUs;
+
+      QJsonObject toJson(void) const;
+    };
+
+    // Consumers attached to every inspector
+    struct InspectorSinks {
+      Suscan::AnalyzerRequest request;
+      DecisionBlock    decision;
+      FileDataSaver   *saver = nullptr;
+      SocketForwarder *forwarder = nullptr;
+      uint64_t         samples = 0;
+    };
+
+    BenchmarkParams params;
+    QTemporaryDir tempDir;
+    Suscan::Analyzer *analyzer = nullptr;
+    Suscan::AnalyzerRequestTracker *tracker = nullptr;
+    Averager averager;
+    QList<InspectorSinks *> sinks;
+    QMap<QString, Stage> stages;
+    QTimer durationTimer;
+    QElapsedTimer clock;
+    QJsonObject report;
+    BenchmarkHistory history = BenchmarkHistory("pipeline");
+    QString lastError;
+    bool measuring = false;
+    uint64_t psds = 0;
+    uint64_t samples = 0;
+    qreal sourceRate = 0; // Mean of the rates measured by the analyzer
+    int failed = 0;
+    qint64 cpuStartNs = 0;
+    qint64 threadCpuStartNs = 0;
+
+    bool haveConsumer(QString const &name) const;
+    std::string makeSyntheticSource(void);
+    void openInspectors(void);
+    void makeSinks(InspectorSinks *);
+    void feedSinks(InspectorSinks *, Suscan::SamplesMessage const &);
+    void startMeasuring(void);
+    void finish(void);
+    void makeReport(void);
+    void compareReport(void);
+
+    static qint64 processCpuNs(void);
+    static qint64 threadCpuNs(void);
+
+  public:
+    explicit PipelineBenchmark(
+        BenchmarkParams const &params,
+        QObject *parent = nullptr);
+    ~PipelineBenchmark() override;
+
+    bool start(void);
+    bool writeReport(void) const;
+
+    QString
+    getLastError(void) const
+    {
+      return this->lastError;
+    }
+
+    bool
+    isRegressed(void) const
+    {
+      return this->history.isRegressed();
+    }
+
+  signals:
+    void finished(void);
+
+  public slots:
+    void onPSDMessage(Suscan::PSDMessage const &);
+    void onOpened(Suscan::AnalyzerRequest const &);
+    void onOpenError(Suscan::AnalyzerRequest const &, std::string const &);
+    void onDurationExpired(void);
+    void onEndOfStream(void);
+    void onHalted(void);
+  };
+}
+
+#endif // PIPELINEBENCHMARK_H
@@ -26,14 +26,28 @@ namespace SigDigger {
   class PortAudioPlayer : public GenericAudioPlayer
   {
     PaStream *stream = nullptr;
+    unsigned long periodMs = 1;
     static bool initialized;
 
     static bool assertPaInitialization(void);
     static void paFinalizer(void);
+    static int streamCallback(
+        const void *input,
+        void *output,
+        unsigned long frames,
+        const PaStreamCallbackTimeInfo *timeInfo,
+        PaStreamCallbackFlags flags,
+        void *userData);
 
   public:
-    PortAudioPlayer(std::string const &dev, unsigned int rate, size_t bufSiz);
+    PortAudioPlayer(
+        std::string const &dev,
+        unsigned int rate,
+        size_t bufSiz,
+        unsigned int channels = 1,
+        AudioSource *source = nullptr);
     bool write(const float *samples, size_t size) override;
+    bool pull(void) override;
     ~PortAudioPlayer() override;
   };
 }
@@ -42,7 +42,6 @@ namespace SigDigger {
     Ui::ProfileConfigTab *ui;
     DeviceTweaks         *tweaks = nullptr;
     bool modified      = false;
-    bool needsRestart  = false;
     bool refreshing    = true;
     bool hasTweaks     = false;
 
@@ -51,6 +50,10 @@ namespace SigDigger {
 
     int savedLocalDeviceIndex = 0;
 
+    // Listings last shown in the combos (0: none yet)
+    quint64 deviceRevision = 0;
+    quint64 networkProfileRevision = 0;
+
     SaveProfileDialog saveProfileDialog;
 
     void connectAll(void);
@@ -72,7 +75,7 @@ namespace SigDigger {
     void loadProfile(Suscan::Source::Config &config);
     void guessParamsFromFileName(void);
     void updateRemoteParams(void);
-    void configChanged(bool restart = false);
+    void configChanged(void);
     bool shouldDisregardTweaks(void);
 
     int  findRemoteProfileIndex(void);
@@ -87,7 +90,6 @@ namespace SigDigger {
 
     void setUnchanged(void);
     bool hasChanged(void) const override;
-    bool shouldRestart(void) const;
 
     void setProfile(const Suscan::Source::Config &profile);
     void setAnalyzerParams(const Suscan::AnalyzerParams &params);
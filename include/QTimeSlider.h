@@ -21,6 +21,8 @@
 
 #include <QSlider>
 #include <QDateTime>
+#include <QImage>
+#include <QVector>
 #include <util/compat-time.h>
 
 namespace SigDigger {
@@ -33,6 +35,9 @@ namespace SigDigger {
     struct timeval startTime;
     struct timeval endTime;
 
+    // Recording overview, one pixel per column and bin
+    QImage overview;
+
     void adjustTickInterval(void);
 
     protected:
@@ -51,6 +56,11 @@ namespace SigDigger {
 
       void setTimeStamp(struct timeval const &);
 
+      // Heat strip drawn behind the slider. Data is in dB, column by
+      // column, with the lowest frequency first.
+      void setOverview(QVector<float> const &, int columns, int bins);
+      void clearOverview(void);
+
       QDateTime getDateTime(void) const;
       struct timeval getTimeStamp(void) const;
       qint64 getSample(void) const;
@@ -19,33 +19,32 @@
 #ifndef QUADDEMODTASK_H
 #define QUADDEMODTASK_H
 
-#include <Suscan/CancellableTask.h>
+#include <Suscan/ChunkedTask.h>
 #include <sigutils/types.h>
 
-class QuadDemodTask : public Suscan::CancellableTask
+class QuadDemodTask : public Suscan::ChunkedTask
 {
   Q_OBJECT
 
   const SUCOMPLEX *origin = nullptr;
   SUCOMPLEX       *destination = nullptr;
-  SUCOMPLEX prev = 0;
+  bool             fastArg = false;
 
-  size_t length;
-  size_t p = 0;
-
-  bool costasInitialized = false;
+protected:
+  virtual void processChunk(
+      size_t start,
+      size_t end,
+      const SUCOMPLEX *history) override;
 
 public:
   explicit QuadDemodTask(
       const SUCOMPLEX *data,
       SUCOMPLEX *destination,
       size_t length,
+      bool fastArg = false,
       QObject *parent = nullptr);
 
   virtual ~QuadDemodTask() override;
-
-  virtual bool work(void) override;
-  virtual void cancel(void) override;
 };
 
 #endif // QUADDEMODTASK_H
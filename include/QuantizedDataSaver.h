@@ -0,0 +1,48 @@
+//
+//    QuantizedDataSaver.h: Saver of quantized IQ recordings
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef QUANTIZEDDATASAVER_H
+#define QUANTIZEDDATASAVER_H
+
+#include "GenericDataSaver.h"
+#include "QuantizedIQ.h"
+
+namespace SigDigger {
+  class QuantizedDataWriter;
+
+  // Records complex samples as int8 or int16 blocks with their own gain,
+  // optionally zstd-compressed. Quantization and compression happen in
+  // the saver's worker thread. See QuantizedIQ.h for the file layout.
+  class QuantizedDataSaver : public GenericDataSaver {
+    Q_OBJECT
+
+    QuantizedDataWriter *writer;
+
+  public:
+    QuantizedDataSaver(
+        int fd,
+        unsigned int rate,
+        SUFREQ freq,
+        QuantizedIQFormat format,
+        QuantizedIQCompression compression,
+        QObject *parent = nullptr);
+    ~QuantizedDataSaver() override;
+  };
+}
+
+#endif // QUANTIZEDDATASAVER_H
@@ -0,0 +1,180 @@
+//
+//    QuantizedIQ.h: Quantized, optionally compressed IQ recordings
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef QUANTIZEDIQ_H
+#define QUANTIZEDIQ_H
+
+#include <sigutils/types.h>
+#include <QtGlobal>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_ZSTD
+#  include <zstd.h>
+#endif // HAVE_ZSTD
+
+#define SIGDIGGER_QUANTIZED_IQ_MAGIC         "SQIQ"
+#define SIGDIGGER_QUANTIZED_IQ_VERSION       1
+#define SIGDIGGER_QUANTIZED_IQ_EXTENSION     ".qiq"
+
+// Samples per block. Each block has its own gain, so this is also how
+// fast the gain follows the signal level.
+#define SIGDIGGER_QUANTIZED_IQ_BLOCK_SAMPLES 65536
+
+// Fast, the point is to keep up with the source
+#define SIGDIGGER_QUANTIZED_IQ_ZSTD_LEVEL    1
+
+namespace SigDigger {
+  enum QuantizedIQFormat {
+    QUANTIZED_IQ_INT8  = 1,
+    QUANTIZED_IQ_INT16 = 2
+  };
+
+  enum QuantizedIQCompression {
+    QUANTIZED_IQ_UNCOMPRESSED = 0,
+    QUANTIZED_IQ_ZSTD         = 1
+  };
+
+  //
+  // File layout, in host byte order: a QuantizedIQFileHeader, followed
+  // by blocks. Each block is a QuantizedIQBlockHeader and its payload:
+  // `samples` interleaved I/Q integers, zstd-compressed if the block
+  // says so, to be divided by `scale` to get the original values back.
+  //
+  struct QuantizedIQFileHeader {
+    char     magic[4];
+    uint8_t  version;
+    uint8_t  format;
+    uint8_t  compression;
+    uint8_t  reserved;
+    uint32_t rate;
+    uint32_t blockSamples;
+    double   freq;
+    double   startTime;
+  };
+
+  struct QuantizedIQBlockHeader {
+    uint32_t samples;
+    uint32_t payload;
+    float    scale;
+    uint32_t compressed;
+  };
+
+  static_assert(sizeof(QuantizedIQFileHeader) == 32, "Bad file header");
+  static_assert(sizeof(QuantizedIQBlockHeader) == 16, "Bad block header");
+
+  class QuantizedIQEncoder {
+    QuantizedIQFormat format;
+    QuantizedIQCompression compression;
+    std::vector<uint8_t> quantized;
+    std::string lastError;
+
+#ifdef HAVE_ZSTD
+    ZSTD_CCtx *zstd = nullptr;
+#endif // HAVE_ZSTD
+
+  public:
+    QuantizedIQEncoder(QuantizedIQFormat, QuantizedIQCompression);
+    ~QuantizedIQEncoder();
+
+    static bool isCompressionSupported(QuantizedIQCompression);
+    static size_t sampleSize(QuantizedIQFormat);
+
+    std::string
+    getError(void) const
+    {
+      return this->lastError;
+    }
+
+    // Appends a whole block (header and payload) to out
+    bool encode(const SUCOMPLEX *data, size_t len, std::vector<uint8_t> &out);
+  };
+
+  class QuantizedCaptureReader {
+    struct Block {
+      uint64_t offset; // Of the payload
+      uint64_t first;
+      QuantizedIQBlockHeader header;
+    };
+
+    QuantizedIQFileHeader header;
+    std::vector<Block> blocks;
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> quantized;
+    std::vector<SUCOMPLEX> decoded;
+    std::string lastError;
+
+    FILE *fp = nullptr;
+    size_t current = 0;
+    bool loaded = false;
+    uint64_t pos = 0;
+
+#ifdef HAVE_ZSTD
+    ZSTD_DCtx *zstd = nullptr;
+#endif // HAVE_ZSTD
+
+    bool loadBlock(size_t index);
+
+  public:
+    QuantizedCaptureReader();
+    ~QuantizedCaptureReader();
+
+    bool open(std::string const &path);
+    void close(void);
+
+    std::string
+    getError(void) const
+    {
+      return this->lastError;
+    }
+
+    unsigned int
+    getSampleRate(void) const
+    {
+      return this->header.rate;
+    }
+
+    SUFREQ
+    getFrequency(void) const
+    {
+      return this->header.freq;
+    }
+
+    SUDOUBLE
+    getStartTime(void) const
+    {
+      return this->header.startTime;
+    }
+
+    QuantizedIQFormat
+    getFormat(void) const
+    {
+      return static_cast<QuantizedIQFormat>(this->header.format);
+    }
+
+    quint64 getLength(void) const;
+    quint64 tell(void) const;
+    bool seek(quint64 sample);
+
+    // Returns the number of samples read, 0 at the end, -1 on error
+    ssize_t read(SUCOMPLEX *data, size_t len);
+  };
+}
+
+#endif // QUANTIZEDIQ_H
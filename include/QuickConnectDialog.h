@@ -20,17 +20,38 @@
 #define QUICKCONNECTDIALOG_H
 
 #include <QDialog>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHostInfo>
+#include <QTcpSocket>
 #include <Suscan/Source.h>
 
+// Typing pause after which the host is looked up and probed
+#define SIGDIGGER_QUICK_CONNECT_PROBE_DELAY_MS 300
+
 namespace Ui {
   class QuickConnectDialog;
 }
 
 namespace SigDigger {
+  //
+  // The host is resolved and a TCP connection to the server is tried
+  // while the user types, so that Connect finds it resolved already
+  // and any error shows up before.
+  //
   class QuickConnectDialog : public QDialog
   {
     Q_OBJECT
 
+    QTimer probeTimer;
+    QTcpSocket *probe = nullptr;
+    QElapsedTimer probeClock;
+    int lookupId = -1;
+    QString resolvedHost;
+    QString resolvedAddress;
+
+    void cancelProbe(void);
+
   public:
     explicit QuickConnectDialog(QWidget *parent = nullptr);
     ~QuickConnectDialog();
@@ -40,6 +61,17 @@ namespace SigDigger {
     QString getPassword(void) const;
     int getPort(void) const;
 
+    // Address of getHost(), the one that accepted the probe if any.
+    // Empty if it was not resolved (yet).
+    QString getResolvedAddress(void) const;
+
+  private slots:
+    void onHostChanged(void);
+    void onProbeTimeout(void);
+    void onHostResolved(QHostInfo);
+    void onProbeConnected(void);
+    void onProbeError(QAbstractSocket::SocketError);
+
   private:
     Ui::QuickConnectDialog *ui;
   };
@@ -0,0 +1,93 @@
+//
+//    RMSHistory.h: Tiered, bounded history of RMS measurements
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef RMSHISTORY_H
+#define RMSHISTORY_H
+
+#include <sigutils/types.h>
+#include <QtGlobal>
+#include <deque>
+#include <vector>
+
+// Resolution ratio between consecutive tiers
+#define SIGDIGGER_RMS_HISTORY_FACTOR 16
+
+// Full resolution, 1:16, 1:256 and 1:4096
+#define SIGDIGGER_RMS_HISTORY_TIERS  4
+
+namespace SigDigger {
+  //
+  // The newest measurements are kept at full resolution in tier 0. When
+  // a tier exceeds its capacity, its oldest FACTOR entries are folded
+  // into one entry (mean, min and max) of the next tier. The last tier
+  // simply forgets its oldest entries, so memory never exceeds
+  // TIERS * capacity entries, whatever the length of the session.
+  //
+  class RMSHistory {
+  public:
+    struct Bucket {
+      SUFLOAT mean;
+      SUFLOAT min;
+      SUFLOAT max;
+    };
+
+  private:
+    std::vector<std::deque<Bucket>> tiers;
+    size_t capacity;
+    quint64 count = 0;
+
+    void fold(unsigned int tier);
+
+  public:
+    explicit RMSHistory(size_t capacity);
+
+    void setCapacity(size_t capacity);
+    void clear(void);
+    void push(SUFLOAT value);
+
+    // Measurements represented by each entry of a given tier
+    static quint64 getDecimation(unsigned int level);
+
+    bool
+    isEmpty(void) const
+    {
+      return this->count == 0;
+    }
+
+    unsigned int
+    getTierCount(void) const
+    {
+      return static_cast<unsigned int>(this->tiers.size());
+    }
+
+    // Measurements covered by view(level), the newest of them last
+    quint64 getSpan(unsigned int level) const;
+
+    // Uniformly sampled view at the resolution of a tier: its entries,
+    // followed by those of the finer tiers folded to the same resolution.
+    // Real parts are means, imaginary parts their value in dB. The last
+    // entry may cover less measurements than the rest.
+    void view(
+        unsigned int level,
+        std::vector<SUCOMPLEX> &mean,
+        std::vector<SUFLOAT> *min = nullptr,
+        std::vector<SUFLOAT> *max = nullptr) const;
+  };
+}
+
+#endif // RMSHISTORY_H
@@ -0,0 +1,131 @@
+//
+//    RMSIngestor.h: Reception and parsing of RMS reports, off the GUI thread
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef RMSINGESTOR_H
+#define RMSINGESTOR_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QMutex>
+#include <sigutils/types.h>
+#include <vector>
+
+//
+// RMS reports are text lines: "DESC,<title>", "RATE,<Hz>" and
+// "<sec>,<fraction>,<mag>,<dB>". After a "BINARY" line, the rest of the
+// stream is made of fixed-size records, saving the formatting and the
+// parsing at high report rates:
+//
+//   double timestamp (s), float mag, float dB, all little endian
+//
+#define SIGDIGGER_RMS_BINARY_RECORD_SIZE 16
+#define SIGDIGGER_RMS_MAX_LINE_SIZE      4096
+
+// Measurements a stream holds for its tab before dropping the oldest
+#define SIGDIGGER_RMS_MAX_PENDING        (1 << 20)
+
+namespace SigDigger {
+  // Everything a stream received since the last take()
+  struct RMSBatch {
+    std::vector<SUFLOAT> mags;
+    qreal last = 0;          // Timestamp of the last measurement
+    qreal rate = 0;          // Non-zero if the peer announced a rate
+    QString title;           // Non-empty if the peer described itself
+    QString error;           // Non-empty if the stream was shut down
+    quint64 dropped = 0;
+    bool closed = false;
+  };
+
+  //
+  // One connected peer. Lives in the I/O thread, where its socket is
+  // read and parsed. The tab showing it collects the parsed data with
+  // take() at its own pace, from the GUI thread.
+  //
+  class RMSStream : public QObject
+  {
+    Q_OBJECT
+
+    QTcpSocket *socket;
+    QString peer;
+    QByteArray pending;
+    bool binary = false;
+
+    // Parsed, waiting for take()
+    QMutex mutex;
+    RMSBatch batch;
+
+    // Parsed from the current chunk. Published all at once.
+    RMSBatch parsed;
+
+    bool parseLine(const char *line, const char *end);
+    void parseRecord(const char *data);
+    void publish(void);
+
+  public:
+    RMSStream(QTcpSocket *socket, QObject *parent = nullptr);
+    ~RMSStream() override;
+
+    QString
+    getPeer(void) const
+    {
+      return this->peer;
+    }
+
+    // Thread-safe. Swaps out everything received so far.
+    void take(RMSBatch &batch);
+
+    // Thread-safe. The stream is deleted in its own thread.
+    void close(void);
+    void release(void);
+
+  public slots:
+    void onReadyRead(void);
+    void onDisconnected(void);
+    void onClose(void);
+  };
+
+  //
+  // A single event loop for every RMS peer. Owns the TCP server and the
+  // streams, all of them living in the I/O thread.
+  //
+  class RMSIngestor : public QObject
+  {
+    Q_OBJECT
+
+    QTcpServer *server = nullptr;
+
+  public:
+    explicit RMSIngestor(QObject *parent = nullptr);
+
+    // Invoked (blocking) from the GUI thread
+    Q_INVOKABLE bool listen(QString address, quint16 port);
+    Q_INVOKABLE void stop(void);
+    Q_INVOKABLE QString errorString(void) const;
+
+  signals:
+    void newStream(SigDigger::RMSStream *);
+    void acceptError(QString);
+
+  public slots:
+    void onNewConnection(void);
+    void onAcceptError(QAbstractSocket::SocketError);
+  };
+}
+
+#endif // RMSINGESTOR_H
@@ -21,9 +21,17 @@
 
 #include <QWidget>
 #include <QTimer>
-#include <QTcpSocket>
 #include <sigutils/types.h>
 #include <vector>
+#include "RMSHistory.h"
+#include "RMSIngestor.h"
+
+// Integrated points kept at full resolution, in minutes
+#define SIGDIGGER_RMS_HISTORY_FULL_MINUTES 10
+
+// Reports are collected from the stream and the view repainted at this
+// rate, at most
+#define SIGDIGGER_RMS_VIEW_FPS 10
 
 namespace Ui {
   class RMSViewTab;
@@ -34,14 +42,18 @@ namespace SigDigger {
   {
       Q_OBJECT
 
-      QTcpSocket *socket = nullptr;
+      RMSStream *stream = nullptr;
       QTimer timer;
-      std::string line;
-      std::vector<SUCOMPLEX> data;
+      RMSBatch batch;
+      RMSHistory history;
+      std::vector<SUCOMPLEX> data;  // View of the history, as displayed
+      unsigned int level = 0;       // History tier being displayed
+      bool dirty = false;
+      bool fitPending = false;
 
       qreal rate = 1;
-      qreal first;
-      qreal last;
+      qreal first = 0; // Of the view
+      qreal last = 0;
 
       int     accum_ctr = 0;
       SUFLOAT energy_accum = 0;
@@ -49,15 +61,19 @@ namespace SigDigger {
       void refreshSampleRate();
       void connectAll();
       void integrateMeasure(qreal timestamp, SUFLOAT mag);
-      bool parseLine(void);
-      void processSocketData(void);
+      void refreshView(void);
+      void refreshCapacity(void);
+      void collect(void);
       bool saveToMatlab(QString const &);
       void disconnectSocket(void);
       void fitVertical(void);
 
     public:
-      explicit RMSViewTab(QWidget *parent, QTcpSocket *socket);
-      ~RMSViewTab();
+      explicit RMSViewTab(QWidget *parent, RMSStream *stream);
+      ~RMSViewTab() override;
+
+    protected:
+      void showEvent(QShowEvent *) override;
 
     private:
       Ui::RMSViewTab *ui;
@@ -71,8 +87,8 @@ namespace SigDigger {
       void onSave(void);
       void onToggleModes(void);
       void onResetZoom(void);
-      void onSocketDisconnected(void);
       void onValueChanged(int);
+      void onHistoryChanged(int);
   };
 
 }
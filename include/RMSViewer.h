@@ -21,7 +21,7 @@
 #define RMSVIEWER_H
 
 #include <QMainWindow>
-#include <QTcpServer>
+#include <QThread>
 #include <vector>
 #include <QAbstractSocket>
 
@@ -32,19 +32,23 @@ namespace Ui {
 namespace SigDigger {
   class RMSViewTab;
   class RMSViewerSettingsDialog;
+  class RMSIngestor;
+  class RMSStream;
 
   class RMSViewer : public QMainWindow
   {
       Q_OBJECT
 
-      QTcpServer server;
+      // Every peer is received and parsed here, away from the GUI
+      QThread ioThread;
+      RMSIngestor *ingestor = nullptr;
       RMSViewerSettingsDialog *settingsDialog = nullptr;
 
       bool     listening  = false;
       QString  listenAddr = "";
       uint16_t listenPort = 0;
 
-      void openNewView(QTcpSocket *);
+      void openNewView(RMSStream *);
       void connectAll(void);
 
       bool haveAddrData(void) const;
@@ -61,8 +65,8 @@ namespace SigDigger {
       Ui::RMSViewer *ui;
 
     public slots:
-      void onAcceptError(QAbstractSocket::SocketError socketError);
-      void onNewConnection(void);
+      void onAcceptError(QString error);
+      void onNewStream(SigDigger::RMSStream *);
 
       void onToggleListening(void);
       void onOpenSettings(void);
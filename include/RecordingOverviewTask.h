@@ -0,0 +1,101 @@
+//
+//    RecordingOverviewTask.h: Coarse spectral overview of a recording
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef RECORDINGOVERVIEWTASK_H
+#define RECORDINGOVERVIEWTASK_H
+
+#include <Suscan/CancellableTask.h>
+#include <Suscan/TaskPool.h>
+#include <sigutils/types.h>
+#include <analyzer/source.h>
+#include <QAtomicInteger>
+#include <QVector>
+#include <QString>
+
+#define SIGDIGGER_RECORDING_OVERVIEW_COLUMNS          512
+#define SIGDIGGER_RECORDING_OVERVIEW_BINS             32
+#define SIGDIGGER_RECORDING_OVERVIEW_FFT_SIZE         1024
+#define SIGDIGGER_RECORDING_OVERVIEW_FFTS_PER_COLUMN  4
+#define SIGDIGGER_RECORDING_OVERVIEW_POLL_INTERVAL_MS 100
+#define SIGDIGGER_RECORDING_OVERVIEW_BATCHES_PER_CPU  4
+#define SIGDIGGER_RECORDING_OVERVIEW_CACHE_SUFFIX     ".overview"
+
+namespace SigDigger {
+  //
+  // Computes a coarse spectrogram of a whole capture file, to give the
+  // time slider something to show. The file is split in `columns` spans
+  // of equal length. Only a few FFT windows are read from each span
+  // (strided reads), so the cost does not depend on the file size. Runs
+  // of consecutive spans are shared with the task pool, each run with its
+  // own file handle.
+  //
+  // The result is cached next to the file (as a hidden file). The cache
+  // is tied to the size and modification time of the capture.
+  //
+  class RecordingOverviewTask : public Suscan::CancellableTask {
+    Q_OBJECT
+
+    enum State {
+      LOADING,
+      INDEXING,
+      SAVING
+    };
+
+    State state = LOADING;
+    QString path;
+    enum suscan_source_format format;
+    int columns;
+    int bins;
+    quint64 samples = 0;
+    SU_FFTW(_plan) plan = nullptr;
+
+    // Power in dB, column by column. Bin 0 is the lowest frequency.
+    QVector<float> overview;
+    float *output = nullptr; // Each column is written by a single run
+
+    Suscan::TaskSlices slices;
+    int batches = 0;
+    QAtomicInteger<int> failed = 0;
+    QAtomicInteger<quint64> processed = 0;
+
+    QString cachePath(void) const;
+    bool loadCache(void);
+    bool saveCache(void) const;
+
+    bool probe(void);
+    void startColumns(void);
+    void runBatch(int batch);
+
+  public:
+    RecordingOverviewTask(
+        QString const &path,
+        enum suscan_source_format format,
+        int columns = SIGDIGGER_RECORDING_OVERVIEW_COLUMNS,
+        int bins = SIGDIGGER_RECORDING_OVERVIEW_BINS,
+        QObject *parent = nullptr);
+    virtual ~RecordingOverviewTask() override;
+
+    virtual bool work(void) override;
+    virtual void cancel(void) override;
+
+  signals:
+    void ready(QString path, QVector<float> overview, int columns, int bins);
+  };
+}
+
+#endif // RECORDINGOVERVIEWTASK_H
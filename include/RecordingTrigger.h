@@ -0,0 +1,104 @@
+//
+//    RecordingTrigger.h: Power-triggered baseband recording
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef RECORDINGTRIGGER_H
+#define RECORDINGTRIGGER_H
+
+#include <BaseBandTap.h>
+#include <Suscan/Messages/PSDMessage.h>
+#include <mutex>
+#include <vector>
+
+// Extra baseband kept in front of the pre-trigger time, covering the
+// delay between a sample and the PSD that reveals it
+#define SIGDIGGER_RECORDING_TRIGGER_LATENCY_S 0.25
+
+namespace SigDigger {
+  class GenericDataSaver;
+
+  struct RecordingTriggerParams {
+    SUFLOAT level = -60;   // dB, mean PSD over the band
+    SUFREQ  offset = 0;    // Band center, relative to the tuner frequency
+    SUFREQ  width = 0;     // Band width. 0: the whole spectrum
+    qreal   preTrigger = 1;
+    qreal   hang = 2;
+  };
+
+  //
+  // Decides when a triggered capture starts and stops from the PSDs
+  // delivered to the GUI. A capture starts as soon as the band power
+  // exceeds the level, and stops once it stays below it for the hang
+  // time. Times are those of the PSDs, so replays trigger as they would
+  // have live.
+  //
+  class RecordingTrigger {
+    RecordingTriggerParams params;
+    bool active = false;
+    qreal lastAbove = 0;
+    SUFLOAT lastLevel = 0;
+
+  public:
+    enum Event {
+      NONE,
+      START,
+      STOP
+    };
+
+    void setParams(RecordingTriggerParams const &);
+    RecordingTriggerParams const &getParams(void) const;
+
+    Event process(Suscan::PSDMessage const &);
+    void reset(void);
+
+    bool
+    isActive(void) const
+    {
+      return this->active;
+    }
+
+    SUFLOAT
+    getLastLevel(void) const
+    {
+      return this->lastLevel;
+    }
+  };
+
+  //
+  // Baseband consumer kept attached while the trigger is armed. Without
+  // a saver, it keeps the most recent samples in a ring. Once a saver is
+  // set, the ring goes first, followed by the live baseband. setSaver()
+  // returns once the tap thread no longer uses the previous saver.
+  //
+  class PreTriggerBuffer : public BaseBandConsumer {
+    std::mutex mutex;
+    std::vector<SUCOMPLEX> ring;
+    size_t pos = 0;
+    size_t fill = 0;
+    GenericDataSaver *saver = nullptr;
+
+    void flushRing(void);
+
+  public:
+    PreTriggerBuffer(size_t length);
+
+    void setSaver(GenericDataSaver *saver);
+    void baseband(const SUCOMPLEX *samples, SUSCOUNT length) override;
+  };
+}
+
+#endif // RECORDINGTRIGGER_H
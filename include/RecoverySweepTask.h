@@ -0,0 +1,102 @@
+//
+//    RecoverySweepTask.h: Parallel carrier recovery parameter sweep
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef RECOVERYSWEEPTASK_H
+#define RECOVERYSWEEPTASK_H
+
+#include <Suscan/CancellableTask.h>
+#include <Suscan/TaskPool.h>
+#include <sigutils/types.h>
+#include <sigutils/pll.h>
+#include <QAtomicInteger>
+#include <vector>
+
+// Loops are parameter-rate dependent, so the sweep runs on a prefix of
+// the selection (at its own sample rate) rather than on a decimated copy
+#define SIGDIGGER_RECOVERY_SWEEP_MAX_SAMPLES      (1 << 17)
+#define SIGDIGGER_RECOVERY_SWEEP_MIN_SAMPLES      1024
+
+// Loop bandwidths tried per order, one octave apart around the current one
+#define SIGDIGGER_RECOVERY_SWEEP_BW_STEPS         7
+
+// The first 1 / SETTLE of the prefix is left for the loop to lock
+#define SIGDIGGER_RECOVERY_SWEEP_SETTLE           4
+
+// Lower orders win over higher ones scoring less than this above them
+#define SIGDIGGER_RECOVERY_SWEEP_TOLERANCE        .05
+
+#define SIGDIGGER_RECOVERY_SWEEP_BLOCK_LENGTH     4096
+#define SIGDIGGER_RECOVERY_SWEEP_POLL_INTERVAL_MS 100
+
+namespace SigDigger {
+  struct RecoveryCandidate {
+    bool costas = false;
+    enum sigutils_costas_kind kind = SU_COSTAS_KIND_BPSK;
+    unsigned int order = 1; // Phases (1: plain carrier, for the PLL)
+    SUFLOAT tau = 0;        // Costas arm filter time constant
+    SUFLOAT bw = 0;         // Normalized loop bandwidth
+
+    //
+    // Lock metric: |<y^M>| / <|y|^M>, M being the order, once settled.
+    // 1 for a perfectly compact constellation, close to 0 when the loop
+    // does not lock and the phase wanders freely.
+    //
+    qreal score = 0;
+  };
+
+  class RecoverySweepTask : public Suscan::CancellableTask {
+    Q_OBJECT
+
+    std::vector<SUCOMPLEX> prefix;
+    std::vector<RecoveryCandidate> candidates;
+    RecoveryCandidate best;
+    bool launched = false;
+
+    Suscan::TaskSlices slices;
+    QAtomicInteger<int> failed = 0;
+    QAtomicInteger<int> processed = 0;
+
+    bool evaluate(RecoveryCandidate &candidate);
+    void runCandidate(int index);
+    void finish(void);
+
+  public:
+    // Grids around the current settings
+    static std::vector<RecoveryCandidate> costasGrid(SUFLOAT tau, SUFLOAT bw);
+    static std::vector<RecoveryCandidate> pllGrid(SUFLOAT bw);
+
+    // Copies the prefix of data it needs
+    RecoverySweepTask(
+        const SUCOMPLEX *data,
+        size_t length,
+        std::vector<RecoveryCandidate> const &candidates,
+        QObject *parent = nullptr);
+    virtual ~RecoverySweepTask() override;
+
+    RecoveryCandidate const &
+    getBest(void) const
+    {
+      return this->best;
+    }
+
+    virtual bool work(void) override;
+    virtual void cancel(void) override;
+  };
+}
+
+#endif // RECOVERYSWEEPTASK_H
@@ -0,0 +1,108 @@
+//
+//    RenderScheduler.h: Frame-paced redraw of live views
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVector>
+#include <functional>
+
+#define SIGDIGGER_RENDER_SCHEDULER_DEFAULT_FPS 60
+#define SIGDIGGER_RENDER_SCHEDULER_MAX_FPS     240
+#define SIGDIGGER_RENDER_SCHEDULER_BATCH_FPS   10
+
+namespace SigDigger {
+  //
+  // Live views no longer redraw when their data arrives. They mark
+  // themselves dirty instead, and the scheduler runs their redraw callback
+  // at most once per frame. Frames are paced by the configured FPS cap,
+  // never faster than the refresh rate of the primary screen. When
+  // nothing is dirty, the scheduler does not wake up at all.
+  //
+  class RenderScheduler : public QObject
+  {
+    Q_OBJECT
+
+    struct View {
+      std::function<void (void)> redraw;
+      bool dirty = false;
+    };
+
+    QHash<QObject *, View> views;
+    QVector<QObject *> dirtyViews;
+    QVector<QObject *> frameViews;
+
+    QTimer frameTimer;
+    QElapsedTimer lastFrame;
+    unsigned int maxFps = SIGDIGGER_RENDER_SCHEDULER_DEFAULT_FPS;
+    int frameInterval = 1000 / SIGDIGGER_RENDER_SCHEDULER_DEFAULT_FPS;
+
+    // Batch mode: data arrives much faster than real time
+    bool batchMode = false;
+    QHash<const QObject *, QElapsedTimer> lastAccepted;
+
+    // Load shedding (see LoadGovernor)
+    unsigned int fpsDivisor = 1;
+    bool decimated = false;
+    qint64 worstFrameUs = 0;
+
+    static RenderScheduler *currInstance;
+
+    RenderScheduler();
+
+    void refreshFrameInterval(void);
+
+  public:
+    static RenderScheduler *instance(void);
+
+    // Views are forgotten automatically when they are destroyed
+    void attach(QObject *view, std::function<void (void)> const &redraw);
+    void detach(QObject *view);
+
+    // Cheap enough to call on every data update
+    void markDirty(QObject *view);
+
+    void setMaxFps(unsigned int fps);
+    unsigned int getMaxFps(void) const;
+
+    // In batch mode, visual consumers only take data a few times per
+    // second (SIGDIGGER_RENDER_SCHEDULER_BATCH_FPS) and drop the rest.
+    // Outside batch mode, everything is accepted.
+    bool acceptData(const QObject *consumer);
+    void setBatchMode(bool batch);
+    bool isBatchMode(void) const;
+
+    // Under load, frames can be spaced further apart and visual consumers
+    // decimated as in batch mode, without touching the FPS cap.
+    void setFpsDivisor(unsigned int divisor);
+    void setDecimated(bool decimated);
+
+    // Longest time spent redrawing a frame since the last call (us)
+    qint64 takeWorstFrameTime(void);
+
+  public slots:
+    void onFrame(void);
+    void onViewDestroyed(QObject *);
+  };
+}
+
+#endif // RENDERSCHEDULER_H
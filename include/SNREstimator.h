@@ -31,6 +31,11 @@
 #define SNR_ESTIMATOR_DEFAULT_SIGMA (1.f / 8.f)
 #define SNR_ESTIMATOR_DEFAULT_ALPHA 1.f
 
+// Fitting is warm-started from the previous sigma, so a few iterations
+// per histogram update are enough to follow it.
+#define SNR_ESTIMATOR_MAX_ITERATIONS 8
+#define SNR_ESTIMATOR_TOLERANCE      1e-4f
+
 namespace SigDigger {
   class SNREstimator
   {
@@ -43,10 +48,14 @@ namespace SigDigger {
       float delta = 0;
       unsigned int length = 0;
       std::vector<float> gaussian;
+      std::vector<float> moment; // Sum of (x - skip)^2 over all intervals
       std::vector<float> Hi;     // Model histogram
       std::vector<float> Htilde; // Actual histogram
       float sqerr = INFINITY;
       bool dirty = false;
+      bool momentDirty = true;
+      bool converged = false;
+      void recalculateMoments(void);
       void recalculateModel(void);
       void calculateSquareError(void);
       void iterate(void);
@@ -0,0 +1,135 @@
+//
+//    SampleConsumerFactory.h: headless consumers of analyzer data
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SAMPLECONSUMERFACTORY_H
+#define SAMPLECONSUMERFACTORY_H
+
+#include <FeatureFactory.h>
+#include <Suscan/Messages/PSDMessage.h>
+#include <Suscan/Messages/SamplesMessage.h>
+#include <SignalDetector.h>
+#include <QtGlobal>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Messages waiting for a consumer before new ones are dropped
+#define SIGDIGGER_SAMPLE_CONSUMER_QUEUE_LEN 256
+
+// How long the analyzer may wait for room in a full queue of samples
+#define SIGDIGGER_SAMPLE_CONSUMER_WAIT_MS   2
+
+namespace SigDigger {
+  class SampleConsumerFactory;
+
+  // Runs on inspector samples, PSDs and/or the emissions found by the
+  // detector tool, without any widget: decoders,
+  // loggers, and the like. Each consumer gets a thread of its own, and the
+  // messages it receives are shared (not copied) with the rest of the
+  // application. A consumer that falls behind loses messages, it never
+  // holds the analyzer back for long.
+  class SampleConsumer : public Suscan::FeatureObject {
+    std::atomic<quint64> m_dropped;
+
+  protected:
+    SampleConsumer(SampleConsumerFactory *);
+
+  public:
+    enum Kind {
+      SAMPLES   = 1,
+      PSD       = 2,
+      EMISSIONS = 4
+    };
+
+    // Mask of Kind. Asked once, when the consumer is created.
+    virtual unsigned int wants(void) const = 0;
+
+    // Called from the consumer's thread, in arrival order
+    virtual void samples(Suscan::SamplesMessage const &);
+    virtual void psd(Suscan::PSDMessage const &);
+    virtual void emission(SignalDetectorEvent const &);
+
+    // Messages lost because this consumer was too slow
+    quint64 dropped(void) const;
+    void notifyDropped(void);
+
+    virtual ~SampleConsumer();
+  };
+
+  class SampleConsumerFactory : public Suscan::FeatureFactory {
+  public:
+    // Called once per analyzer. May return nullptr to stay out.
+    virtual SampleConsumer *make(void) = 0;
+
+    // Overriden methods
+    bool registerGlobally(void) override;
+    bool unregisterGlobally(void) override;
+
+    SampleConsumerFactory(Suscan::Plugin *);
+  };
+
+  // One consumer of every registered factory, fed from the analyzer's
+  // message thread.
+  class SampleConsumerDispatcher {
+    struct Item {
+      Suscan::SamplesMessage samples;
+      Suscan::PSDMessage psd;
+      SignalDetectorEvent event;
+      unsigned int kind;
+    };
+
+    struct Worker {
+      SampleConsumer *consumer;
+      unsigned int wants;
+      std::mutex mutex;
+      std::condition_variable ready;
+      std::condition_variable space;
+      std::deque<Item> queue;
+      bool exit = false;
+      std::thread thread;
+    };
+
+    std::vector<Worker *> workers;
+    unsigned int wanted = 0;
+
+    static void run(Worker *);
+    void push(Item const &, unsigned int kind, bool wait);
+
+  public:
+    SampleConsumerDispatcher(void);
+    SampleConsumerDispatcher(SampleConsumerDispatcher const &) = delete;
+    SampleConsumerDispatcher &operator=(
+        SampleConsumerDispatcher const &) = delete;
+    ~SampleConsumerDispatcher();
+
+    inline bool
+    wants(unsigned int kind) const
+    {
+      return (this->wanted & kind) != 0;
+    }
+
+    void dispatch(Suscan::SamplesMessage const &);
+    void dispatch(Suscan::PSDMessage const &);
+    void dispatch(SignalDetectorEvent const &);
+  };
+}
+
+#endif // SAMPLECONSUMERFACTORY_H
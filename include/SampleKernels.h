@@ -0,0 +1,113 @@
+//
+//    include/SampleKernels.h: Vectorized element-wise sample kernels
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SAMPLEKERNELS_H
+#define SAMPLEKERNELS_H
+
+#include <sigutils/types.h>
+#include <cstddef>
+#include <cstdint>
+
+// Maximum error of SampleKernels::fastAtan2, in radians
+#define SIGDIGGER_SAMPLE_KERNELS_FAST_ATAN2_MAX_ERROR 1e-5
+
+namespace SigDigger {
+  //
+  // All kernels compute dest[i] from x[i] (and y[i]). They walk the arrays
+  // from the end, so dest may alias x while y aliases x - d (d > 0): the
+  // usual in-place x[n] * conj(x[n - d]) pattern.
+  //
+  class SampleKernels {
+  public:
+    // dest[i] = x[i] * conj(y[i]) / (|y[i]| + eps)
+    static void delayedConj(
+        SUCOMPLEX *dest,
+        const SUCOMPLEX *x,
+        const SUCOMPLEX *y,
+        size_t size,
+        SUFLOAT eps);
+
+    // dest[i] = I * k * arg(x[i] * conj(y[i]))
+    static void quadDemod(
+        SUCOMPLEX *dest,
+        const SUCOMPLEX *x,
+        const SUCOMPLEX *y,
+        size_t size,
+        SUFLOAT k,
+        bool fastArg);
+
+    // dest[i] = k * x[i] * y[i]: mixing with a block of oscillator
+    // samples y, rotated by k
+    static void mix(
+        SUCOMPLEX *dest,
+        const SUCOMPLEX *x,
+        const SUCOMPLEX *y,
+        size_t size,
+        SUCOMPLEX k);
+
+    // dest[i] = |x[i]|
+    static void modulus(SUFLOAT *dest, const SUCOMPLEX *x, size_t size);
+
+    // dest[i] = gain * Re(x[i]), narrowed to float (audio buffers)
+    static void realPart(
+        float *dest,
+        const SUCOMPLEX *x,
+        size_t size,
+        SUFLOAT gain);
+
+    // dest[i] = arg(x[i]), or arg(I * x[i]) if quadrature is set
+    static void argument(
+        SUFLOAT *dest,
+        const SUCOMPLEX *x,
+        size_t size,
+        bool quadrature,
+        bool fastArg);
+
+    // dest[i] = round(x[i] * scale), saturated. Complex arrays are
+    // converted as 2 * size interleaved reals. dest must not alias x.
+    static void toInt16(
+        int16_t *dest,
+        const SUFLOAT *x,
+        size_t size,
+        SUFLOAT scale);
+
+    static void toInt8(
+        int8_t *dest,
+        const SUFLOAT *x,
+        size_t size,
+        SUFLOAT scale);
+
+    // Packs the low bps (1 to 8) bits of every symbol, first symbol in
+    // the least significant bits. The last byte is zero-padded. Returns
+    // the bytes written, (size * bps + 7) / 8.
+    static size_t packSymbols(
+        uint8_t *dest,
+        const uint8_t *symbols,
+        size_t size,
+        unsigned int bps);
+
+    // Polynomial atan2 with octant reduction
+    static SUFLOAT fastAtan2(SUFLOAT y, SUFLOAT x);
+
+    // Instruction set of the kernels in use ("avx2", "sse", "neon"...),
+    // chosen once from the features of the CPU
+    static const char *isaName(void);
+  };
+}
+
+#endif // SAMPLEKERNELS_H
@@ -0,0 +1,95 @@
+//
+//    SampleStatistics.h: Constant-time statistics over sample ranges
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SAMPLESTATISTICS_H
+#define SAMPLESTATISTICS_H
+
+#include <sigutils/types.h>
+#include <QtGlobal>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Samples between two stored prefix sums. A query scans at most twice this.
+#define SIGDIGGER_SAMPLE_STATISTICS_BLOCK 1024
+
+namespace SigDigger {
+  //
+  // Prefix sums of I, Q and energy, stored every few samples, so the mean
+  // and RMS of any range cost the same regardless of its length. Sample
+  // data is not owned: whoever owns the buffer must stop() before
+  // releasing or modifying it.
+  //
+  class SampleStatistics {
+    struct Sums {
+      SUDOUBLE i = 0;
+      SUDOUBLE q = 0;
+      SUDOUBLE energy = 0;
+    };
+
+    const SUCOMPLEX *data;
+    size_t length;
+    std::vector<Sums> prefix; // prefix[k]: sums over [0, k * BLOCK)
+
+    std::atomic<bool> cancelFlag;
+    std::atomic<bool> readyFlag;
+
+    // Whether build() is in progress. A build() that has not started by
+    // the time of a stop() does nothing.
+    std::mutex stateMutex;
+    std::condition_variable stateCond;
+    bool running = false;
+
+    void scan(Sums &, size_t start, size_t end) const;
+
+  public:
+    SampleStatistics(const SUCOMPLEX *data, size_t length);
+
+    // Heavy, meant for a worker thread. onReady is called from that
+    // thread once the statistics are complete, before stop() returns.
+    void build(std::function<void (void)> const &onReady = nullptr);
+    void cancel(void);
+
+    // Cancels, and waits for a build() in progress. Never longer than a
+    // few blocks.
+    void stop(void);
+
+    bool
+    isReady(void) const
+    {
+      return this->readyFlag.load(std::memory_order_acquire);
+    }
+
+    bool
+    isFor(const SUCOMPLEX *data, size_t length) const
+    {
+      return this->data == data && this->length == length;
+    }
+
+    // Over [start, end). Returns false if not ready or the range is empty.
+    bool compute(
+        qint64 start,
+        qint64 end,
+        SUCOMPLEX &mean,
+        SUFLOAT &rms) const;
+  };
+}
+
+#endif // SAMPLESTATISTICS_H
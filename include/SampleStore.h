@@ -0,0 +1,82 @@
+//
+//    include/SampleStore.h: Paged sample storage with disk spill
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SAMPLESTORE_H
+#define SAMPLESTORE_H
+
+#include <sigutils/types.h>
+#include <QtGlobal>
+#include <QMutex>
+#include <memory>
+#include <vector>
+
+class QTemporaryFile;
+
+#define SIGDIGGER_SAMPLE_STORE_PAGE_SAMPLES (1 << 20)
+#define SIGDIGGER_SAMPLE_STORE_DEFAULT_RAM  (256ull << 20)
+
+namespace SigDigger {
+  //
+  // Append-only sample storage made of fixed-size pages. Appending never
+  // moves samples already stored. Once the pages in RAM exceed the RAM
+  // limit, the oldest full pages are written to a temporary file and
+  // released. Reads are served from either place transparently.
+  //
+  // Exports read from the store in their own thread while it is still
+  // being appended to, so every method takes the store mutex.
+  //
+  class SampleStore {
+    struct Page {
+      std::unique_ptr<SUCOMPLEX[]> data;
+      bool spilled = false;
+    };
+
+    std::vector<Page> pages;
+    size_t count = 0;
+    size_t ramPages = 0;
+    size_t firstInRam = 0;
+    quint64 ramLimit = SIGDIGGER_SAMPLE_STORE_DEFAULT_RAM;
+
+    QTemporaryFile *spillFile = nullptr;
+    bool spillFailed = false;
+
+    mutable QMutex mutex;
+
+    bool ensureSpillFile(void);
+    void spill(void);
+
+  public:
+    SampleStore();
+    ~SampleStore();
+
+    // A RAM limit of 0 disables spilling
+    void setRamLimit(quint64 bytes);
+    void append(const SUCOMPLEX *data, size_t size);
+    void clear(void);
+
+    size_t size(void) const;
+    quint64 getRamUsage(void) const;
+    quint64 getSpilledBytes(void) const;
+
+    // Copies up to size samples starting at offset. Returns the number of
+    // samples actually copied.
+    size_t read(size_t offset, SUCOMPLEX *dest, size_t size);
+  };
+}
+
+#endif // SAMPLESTORE_H
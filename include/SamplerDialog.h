@@ -22,6 +22,16 @@
 #include <QDialog>
 #include "WaveSampler.h"
 #include "ColorConfig.h"
+#include "SymbolStore.h"
+
+// Every sampled symbol goes to the store, which keeps this much in memory
+// and spills the rest to disk. The view only holds the most recent ones.
+#define SIGDIGGER_SAMPLER_DIALOG_MEMORY_LIMIT     (64 << 20)
+#define SIGDIGGER_SAMPLER_DIALOG_MAX_VIEW_SYMBOLS (1 << 22)
+
+// Formats written by the view get every symbol by refilling the view for
+// a moment, as long as there are no more than this many
+#define SIGDIGGER_SAMPLER_DIALOG_MAX_SAVE_SYMBOLS (1 << 28)
 
 namespace Ui {
   class SamplerDialog;
@@ -34,6 +44,8 @@ namespace SigDigger {
 
     Decider decider;
     SamplingProperties properties;
+    SymbolStore store;
+    std::vector<Symbol> pending; // Not in the view yet
 
     SUFLOAT minVal = +INFINITY;
     SUFLOAT maxVal = -INFINITY;
@@ -50,6 +62,10 @@ namespace SigDigger {
     unsigned int getHScrollOffset(void) const;
     void refreshHScrollBar(void) const;
     void refreshVScrollBar(void) const;
+    void flushSymbols(void);
+    void trimView(void);
+    bool refillView(void);
+    bool savePacked(QString const &path);
 
   public:
     explicit SamplerDialog(QWidget *parent = nullptr);
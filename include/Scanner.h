@@ -21,19 +21,40 @@
 
 #include <QObject>
 #include <Suscan/Analyzer.h>
+#include <vector>
+#include "SpectrumTileStore.h"
 
 //
 // It does not make much sense to have different spectrum sizes for the
-// PSD and the panoramic view. We use this size for both thigs.
+// PSD and the panoramic view. We use the same size for both things, which
+// defaults to this one.
 //
 #define SIGDIGGER_SCANNER_SPECTRUM_SIZE     8192
+#define SIGDIGGER_SCANNER_MIN_SPECTRUM_SIZE 256
+#define SIGDIGGER_SCANNER_MAX_SPECTRUM_SIZE 65536
 #define SIGDIGGER_SCANNER_DEFAULT_BIN_VALUE -200.0f
 #define SIGDIGGER_SCANNER_MIN_BIN_VALUE     -150.0f
 
 #define SIGDIGGER_SCANNER_COUNT_MAX         5.0f
 #define SIGDIGGER_SCANNER_COUNT_RESET       1.0f
 
+//
+// Adaptive dwell scheduling. Segments are revisited with a priority that
+// grows with the number of rounds since the last visit, weighted by how
+// much the segment has been changing (standard deviation of its mean
+// power, in dB) and how busy it is (fraction of bins well above its
+// mean).
+//
+#define SIGDIGGER_SCANNER_ADAPTIVE_ALPHA        .25f
+#define SIGDIGGER_SCANNER_ADAPTIVE_OCCUPANCY_DB 10.0f
+#define SIGDIGGER_SCANNER_ADAPTIVE_VAR_WEIGHT   1.0f
+#define SIGDIGGER_SCANNER_ADAPTIVE_OCC_WEIGHT   20.0f
+#define SIGDIGGER_SCANNER_ADAPTIVE_DWELL        2
+
 namespace SigDigger {
+  class PanoramicRelaySender;
+  class PanoramicRelayReceiver;
+
   //
   // A SpectrumView represents a portion of the electromagnetic
   // spectrum that is updated through FFT messages. Every FFT message
@@ -42,11 +63,11 @@ namespace SigDigger {
   // - A SpectrumView requires (freqMax - freqMin) / fftBandwidth to be
   // complete. This is the fftCount value. Therefore:
   //
-  // fftCount < SIGDIGGER_SCANNER_SPECTRUM_SIZE.
+  // fftCount < size.
   //   Simple linear interpolation scenario. There is more than one bin
-  //   per FFT (bpfft = SIGDIGGER_SCANNER_SPECTRUM_SIZE / fftCount > 1).
+  //   per FFT (bpfft = size / fftCount > 1).
   //   The FFT must be scaled down to bpfft values, this is, we must average
-  //   SIGDIGGER_SCANNER_SPECTRUM_SIZE / bpfft = fftCount values. Since
+  //   size / bpfft = fftCount values. Since
   //   both fftCount and bpfft are real values, we follow a softened approach:
   //
   //   1. We average linearly the FFT in blocks of fftCount values. The last
@@ -58,10 +79,17 @@ namespace SigDigger {
   //      PSD values contribute with a count of 1, except the last one,
   //      which is smaller than one.
   //
-  // fftCount >= SIGDIGGER_SCANNER_SPECTRUM_SIZE.
+  // fftCount >= size.
   //  Simple histogram scenario. We average the PSD and increment the number
   //  of updates in the count array.
   //
+  // Accumulated power and update count of a bin are always used together,
+  // so they are stored next to each other.
+  struct SpectrumBin {
+      SUFLOAT accum;
+      SUFLOAT count;
+  };
+
   struct SpectrumView {
       SUFREQ freqMin = 0;
       SUFREQ freqMax = 0;
@@ -70,28 +98,28 @@ namespace SigDigger {
       SUFREQ fftBandwidth = 0;
       SUFLOAT fftRelBw = .5f;
 
-      SUFLOAT psd[SIGDIGGER_SCANNER_SPECTRUM_SIZE];
+      // Allocated once, by setSize. Feeding never allocates.
+      unsigned int size = 0;
+      std::vector<SUFLOAT> psd;
+      std::vector<SpectrumBin> bins;
+      std::vector<SpectrumBin> scaled;
 
-      // TODO: Use complex?
-      SUFLOAT psdAccum[SIGDIGGER_SCANNER_SPECTRUM_SIZE];
-      SUFLOAT psdCount[SIGDIGGER_SCANNER_SPECTRUM_SIZE];
+      // Bins of psd changed since the last takeDirty(), [start, end)
+      unsigned int dirtyStart = 0;
+      unsigned int dirtyEnd = 0;
 
-      SUFLOAT scaledPsdAccum[SIGDIGGER_SCANNER_SPECTRUM_SIZE];
-      SUFLOAT scaledPsdCount[SIGDIGGER_SCANNER_SPECTRUM_SIZE];
-
-      SpectrumView();
+      SpectrumView(unsigned int size = SIGDIGGER_SCANNER_SPECTRUM_SIZE);
 
+      void setSize(unsigned int size);
       void setRange(SUFREQ freqMin, SUFREQ freqMax);
 
       void feed(
-          const SUFLOAT *,
           const SUFLOAT *,
           SUFREQ freqMin,
           SUFREQ freqMax,
           bool adjustSides = true);
 
       void feed(
-          const SUFLOAT *,
           const SUFLOAT *,
           SUFREQ center,
           bool adjustSides = true);
@@ -101,24 +129,77 @@ namespace SigDigger {
       void reset(void);
       void interpolate(void); // Interpolate empty bins
 
+      void markDirty(unsigned int start, unsigned int end);
+
+      // Returns false if nothing changed. Clears the dirty range.
+      bool takeDirty(unsigned int &start, unsigned int &end);
+
     private:
+      // Input is either a plain PSD (stride 1, no counts) or the bins
+      // of another view (stride 2, interleaved accum / count).
+      void feed(
+          const SUFLOAT *,
+          const SUFLOAT *,
+          unsigned int stride,
+          SUFREQ freqMin,
+          SUFREQ freqMax,
+          bool adjustSides);
+
       void feedLinearMode(
           const SUFLOAT *,
           const SUFLOAT *,
+          unsigned int stride,
           SUFREQ freqMin,
           SUFREQ freqMax,
           bool adjustSides = true);
 
       void feedHistogramMode(
           const SUFLOAT *,
+          unsigned int stride,
           SUFREQ freqMin,
           SUFREQ freqMax);
   };
 
+  //
+  // A Scanner drives one analyzer per device. Each device sweeps its own
+  // slice of freqMin..freqMax, and all of them feed the same view.
+  //
   class Scanner : public QObject
   {
       Q_OBJECT
 
+      struct ScannerSegment {
+        SUFREQ center = 0;
+        SUFLOAT mean = 0;
+        SUFLOAT var = 0;
+        SUFLOAT occupancy = 0;
+        quint64 lastRound = 0;
+        bool visited = false;
+      };
+
+      struct ScannerDevice {
+        Suscan::Analyzer *analyzer = nullptr;
+        SUFREQ freqMin = 0;
+        SUFREQ freqMax = 0;
+        SUFREQ hopMin = 0;
+        SUFREQ hopMax = 0;
+        unsigned int fs = 0;
+        bool idle = false;
+
+        // Devices with a known settle time only wait that long after
+        // each retune, instead of the whole RTT. Hops taken too soon
+        // after the previous one (by source time) are dropped.
+        unsigned int settleMs = 0;
+        struct timeval lastHop = {0, 0};
+        bool haveLastHop = false;
+
+        // Adaptive scheduling state
+        std::vector<ScannerSegment> segments;
+        SUFREQ segmentWidth = 0;
+        int current = -1;
+        unsigned int dwell = 0;
+      };
+
       SUFREQ freqMin;
       SUFREQ freqMax;
       SUFREQ lnb;
@@ -127,26 +208,66 @@ namespace SigDigger {
       float relBw = .5f;
       unsigned int fs = 0;
       unsigned int rtt = 15;
+      unsigned int size = SIGDIGGER_SCANNER_SPECTRUM_SIZE;
       SpectrumView views[2];
+      SpectrumTileStore store;
       int view = 0;
 
-      Suscan::Analyzer *analyzer = nullptr;
+      bool adaptive = false;
+      quint64 round = 0;
+      quint64 droppedHops = 0;
+
+      // Hops of this node sent to an aggregator, or hops of other nodes
+      // merged into this one
+      PanoramicRelaySender *relaySender = nullptr;
+      PanoramicRelayReceiver *relayReceiver = nullptr;
+      SpectrumView fragment;
+      std::vector<SUFLOAT> fragmentPsd;
+
+      std::vector<ScannerDevice> devices;
+
+      void connectAnalyzer(Suscan::Analyzer *);
+      ScannerDevice *lookupDevice(QObject *);
+      void applyHopRange(ScannerDevice &);
+      void applyBuffering(ScannerDevice &);
+      bool settled(ScannerDevice &, struct timeval const &);
+
+      void buildSegments(ScannerDevice &);
+      void updateSegment(ScannerDevice &, const SUFLOAT *, SUFREQ center);
+      void schedule(ScannerDevice &);
 
     public:
       explicit Scanner(
           QObject *parent,
           SUFREQ freqMin,
           SUFREQ freqMax,
-          Suscan::Source::Config const &cfg);
+          Suscan::Source::Config const &cfg,
+          unsigned int size = SIGDIGGER_SCANNER_SPECTRUM_SIZE);
+
+      explicit Scanner(
+          QObject *parent,
+          SUFREQ freqMin,
+          SUFREQ freqMax,
+          std::vector<Suscan::Source::Config> const &configs,
+          unsigned int size = SIGDIGGER_SCANNER_SPECTRUM_SIZE);
 
       void setRelativeBw(float ratio);
       void setRttMs(unsigned int);
+      void setSettleMs(unsigned int device, unsigned int ms);
       void setViewRange(SUFREQ min, SUFREQ max, bool noHop = false);
       void setStrategy(Suscan::Analyzer::SweepStrategy);
+      void setAdaptive(bool);
       void setPartitioning(Suscan::Analyzer::SpectrumPartitioning);
       void setGain(QString const &, float);
+      void relayTo(QString const &host, quint16 port);
+      bool aggregate(quint16 port);
 
       unsigned int getFs(void) const;
+      unsigned int getSpectrumSize(void) const;
+      unsigned int getDeviceCount(void) const;
+      quint64 getDroppedHops(void) const;
+      bool isAdaptive(void) const;
+      SpectrumTileStore const &getTileStore(void) const;
       void flip(void);
       SpectrumView &getSpectrumView(void);
       SpectrumView const &getSpectrumView(void) const;
@@ -161,6 +282,7 @@ namespace SigDigger {
     public slots:
       void onPSDMessage(const Suscan::PSDMessage &);
       void onAnalyzerHalted(void);
+      void onFragment(SigDigger::SpectrumView const &);
 
   };
 }
@@ -0,0 +1,106 @@
+//
+//    ScratchArena.h: Per-frame scratch memory for sample paths
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SCRATCHARENA_H
+#define SCRATCHARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#define SIGDIGGER_SCRATCH_ARENA_ALIGN         64
+#define SIGDIGGER_SCRATCH_ARENA_INITIAL_SIZE  (64 << 10)
+
+namespace SigDigger {
+  // Typed view of scratch memory. It does not own anything.
+  template <class T>
+  class ScratchSpan
+  {
+    T *ptr = nullptr;
+    size_t count = 0;
+
+  public:
+    ScratchSpan() = default;
+    ScratchSpan(T *ptr, size_t count) : ptr(ptr), count(count) { }
+
+    inline T *data(void) const { return this->ptr; }
+    inline size_t size(void) const { return this->count; }
+    inline bool empty(void) const { return this->count == 0; }
+    inline T *begin(void) const { return this->ptr; }
+    inline T *end(void) const { return this->ptr + this->count; }
+    inline T &operator[](size_t i) const { return this->ptr[i]; }
+  };
+
+  //
+  // Temporary buffers of a feed path, taken one after another from a single
+  // block and all given back at once by reset(), once the frame is done.
+  // Requests that do not fit in the block get blocks of their own, and the
+  // next reset() grows the main block to hold the whole frame. From then
+  // on, frames of the same shape do not allocate at all.
+  //
+  // Not thread-safe: one arena per thread (or per feeding object).
+  //
+  class ScratchArena
+  {
+    std::unique_ptr<uint8_t[]> block;
+    size_t blockSize = 0;
+    size_t used = 0;
+
+    std::vector<std::unique_ptr<uint8_t[]>> overflow;
+    size_t overflowSize = 0;
+
+    void *take(size_t bytes);
+
+  public:
+    // Resets the arena when it goes out of scope
+    class Frame
+    {
+      ScratchArena &arena;
+
+    public:
+      explicit Frame(ScratchArena &arena) : arena(arena) { }
+      ~Frame() { this->arena.reset(); }
+
+      Frame(Frame const &) = delete;
+      Frame &operator=(Frame const &) = delete;
+    };
+
+    explicit ScratchArena(size_t size = SIGDIGGER_SCRATCH_ARENA_INITIAL_SIZE);
+
+    // Contents are undefined. Valid until the next reset().
+    template <class T>
+    ScratchSpan<T>
+    take(size_t count)
+    {
+      static_assert(
+            std::is_trivially_copyable<T>::value,
+            "Scratch memory is for plain sample types");
+
+      return ScratchSpan<T>(
+            static_cast<T *>(this->take(count * sizeof(T))),
+            count);
+    }
+
+    void reset(void);
+    size_t capacity(void) const;
+  };
+}
+
+#endif // SCRATCHARENA_H
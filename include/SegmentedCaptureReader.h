@@ -0,0 +1,116 @@
+//
+//    SegmentedCaptureReader.h: Seekable reader of segmented captures
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SEGMENTEDCAPTUREREADER_H
+#define SEGMENTEDCAPTUREREADER_H
+
+#include <sigutils/types.h>
+#include <QtGlobal>
+#include <string>
+#include <vector>
+
+namespace SigDigger {
+  // Presents the segments listed in a SegmentedDataSaver index as a
+  // single float32 IQ stream. Sample numbers are absolute: segments
+  // removed by the retention policy leave the beginning unreadable.
+  class SegmentedCaptureReader {
+  public:
+    struct Segment {
+      std::string path;
+      quint64 first;
+      quint64 length;
+      SUDOUBLE time;
+    };
+
+    struct Event {
+      quint64 sample;
+      std::string gain; // Empty for frequency changes
+      SUDOUBLE value;
+    };
+
+  private:
+    std::vector<Segment> segments;
+    std::vector<Event> events;
+    std::string lastError;
+
+    unsigned int rate = 0;
+    SUDOUBLE startTime = 0;
+    quint64 pos = 0;
+    size_t current = 0;
+    int fd = -1;
+
+    size_t findSegment(quint64 sample) const;
+    bool openSegment(size_t index);
+
+  public:
+    SegmentedCaptureReader();
+    ~SegmentedCaptureReader();
+
+    bool open(std::string const &indexPath);
+    void close(void);
+
+    std::string
+    getError(void) const
+    {
+      return this->lastError;
+    }
+
+    unsigned int
+    getSampleRate(void) const
+    {
+      return this->rate;
+    }
+
+    SUDOUBLE
+    getStartTime(void) const
+    {
+      return this->startTime;
+    }
+
+    std::vector<Segment> const &
+    getSegments(void) const
+    {
+      return this->segments;
+    }
+
+    std::vector<Event> const &
+    getEvents(void) const
+    {
+      return this->events;
+    }
+
+    quint64 getFirstSample(void) const;
+    quint64 getEndSample(void) const;
+    quint64 tell(void) const;
+
+    SUFREQ getFrequencyAt(quint64 sample) const;
+    bool getGainAt(quint64 sample, std::string const &name, SUFLOAT &) const;
+
+    bool seek(quint64 sample);
+    bool seekTime(SUDOUBLE unixTime);
+
+    // Reads up to len samples, possibly across segments. Returns the
+    // number of samples read, 0 at the end, -1 on error.
+    ssize_t read(SUCOMPLEX *data, size_t len);
+
+    // Copies [from, from + count) to a single raw file
+    bool extract(quint64 from, quint64 count, std::string const &path);
+  };
+}
+
+#endif // SEGMENTEDCAPTUREREADER_H
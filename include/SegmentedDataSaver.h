@@ -0,0 +1,68 @@
+//
+//    SegmentedDataSaver.h: Capture saver writing rotating segments and an index
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SEGMENTEDDATASAVER_H
+#define SEGMENTEDDATASAVER_H
+
+#include "GenericDataSaver.h"
+
+#define SIGDIGGER_SEGMENTED_INDEX_EXTENSION   ".idx"
+#define SIGDIGGER_SEGMENTED_SEGMENT_EXTENSION ".raw"
+#define SIGDIGGER_SEGMENTED_INDEX_VERSION     1
+
+namespace SigDigger {
+  class SegmentedDataWriter;
+
+  //
+  // Writes a float32 IQ capture as a sequence of files named
+  // <base>_NNNNN.raw, each with at most segmentBytes bytes, plus the
+  // text index <base>.idx. Each index line is a record: the capture
+  // header fields, "segment <first sample> <unix time> <file>" for every
+  // new segment, "freq <sample> <Hz>" and "gain <sample> <name> <dB>" for
+  // tuning changes, "drop <file>" for segments removed by the retention
+  // policy and "end <samples>" when the capture is closed.
+  //
+  class SegmentedDataSaver : public GenericDataSaver {
+    Q_OBJECT
+
+    SegmentedDataWriter *writer;
+
+    quint64 currentSample(void) const;
+
+  public:
+    // retention is the number of most recent segments kept on disk,
+    // 0 keeps all of them.
+    SegmentedDataSaver(
+        std::string const &base,
+        unsigned int rate,
+        SUFREQ freq,
+        quint64 segmentBytes,
+        unsigned int retention = 0,
+        QObject *parent = nullptr);
+    ~SegmentedDataSaver() override;
+
+    bool isOpen(void) const;
+    std::string getError(void) const;
+
+    // Tuning changes, stamped with the position of the next sample
+    void noteFrequency(SUFREQ freq);
+    void noteGain(std::string const &name, SUFLOAT value);
+  };
+}
+
+#endif // SEGMENTEDDATASAVER_H
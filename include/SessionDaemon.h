@@ -0,0 +1,163 @@
+//
+//    SessionDaemon.h: Headless recording and forwarding daemon
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SESSIONDAEMON_H
+#define SESSIONDAEMON_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QJsonObject>
+#include <Suscan/Analyzer.h>
+#include <Suscan/AnalyzerRequestTracker.h>
+#include <SocketForwarder.h>
+
+#define SIGDIGGER_DAEMON_DEFAULT_CLASS      "raw"
+#define SIGDIGGER_DAEMON_DEFAULT_MTU        1400
+#define SIGDIGGER_DAEMON_DEFAULT_STATUS_S   10
+
+// How often termination signals are checked for
+#define SIGDIGGER_DAEMON_SIGNAL_POLL_MS     250
+
+namespace SigDigger {
+  class FileDataSaver;
+  struct DaemonSource;
+
+  struct DaemonParams {
+    QString session;
+    QString profile; // Overrides the one of the session
+    qreal   duration = 0; // 0: until interrupted
+    qreal   statusInterval = SIGDIGGER_DAEMON_DEFAULT_STATUS_S;
+
+    // Returns false (after printing why) on bad arguments
+    bool parse(int argc, char **argv);
+    static void help(const char *argv0);
+  };
+
+  //
+  // A channel of the session: opened as an inspector, its samples go to a
+  // file in the record directory and/or to a socket forwarder.
+  //
+  struct DaemonChannel {
+    std::string  inspClass = SIGDIGGER_DAEMON_DEFAULT_CLASS;
+    SUFREQ       frequency = 0; // Absolute
+    SUFREQ       bandwidth = 0;
+    bool         precise = true;
+    QJsonObject  params;        // Inspector config overrides
+
+    QString      recordDir;     // Empty: no recording
+    bool         forward = false;
+    std::string  forwardHost;
+    uint16_t     forwardPort = 0;
+    SocketForwarderMode     forwardMode = SOCKET_FORWARDER_UDP;
+    SocketForwarderOverflow forwardOverflow = SOCKET_FORWARDER_DROP_OLDEST;
+    unsigned int forwardMtu = SIGDIGGER_DAEMON_DEFAULT_MTU;
+    bool         forwardHeader = false;
+
+    // Runtime state
+    DaemonSource *source = nullptr;
+    bool         opened = false;
+    Suscan::AnalyzerRequest request;
+    int          fd = -1;
+    FileDataSaver   *saver = nullptr;
+    SocketForwarder *forwarder = nullptr;
+    uint64_t     samples = 0;
+  };
+
+  //
+  // A source of the session, with its own analyzer and request tracker.
+  // Everything else (plugins, profiles, threads, the I/O of the
+  // recordings) is shared by all sources of the process.
+  //
+  struct DaemonSource {
+    std::string  profileName;
+    SUFREQ       frequency = 0; // Tuner frequency
+    bool         haveFrequency = false;
+
+    Suscan::Analyzer *analyzer = nullptr;
+    Suscan::AnalyzerRequestTracker *tracker = nullptr;
+    bool         halted = false;
+  };
+
+  //
+  // Runs a saved session without any widget: the source profiles are
+  // opened with their analyzers, every channel is requested through the
+  // request tracker of its source and its samples are written and
+  // forwarded straight from the samples route, with no inspector UI in
+  // between.
+  //
+  class SessionDaemon : public QObject
+  {
+    Q_OBJECT
+
+    DaemonParams params;
+    QList<DaemonSource *> sources;
+    QList<DaemonChannel *> channels;
+
+    QTimer durationTimer;
+    QTimer statusTimer;
+    QTimer signalTimer;
+    QElapsedTimer clock;
+    QString lastError;
+    bool stopping = false;
+    int failed = 0;
+
+    bool loadSession(void);
+    bool parseSource(QJsonObject const &, DaemonSource *);
+    bool parseChannel(QJsonObject const &, DaemonChannel *);
+    bool parseThreads(QJsonObject const &);
+    bool startSource(DaemonSource *);
+    DaemonSource *findSource(QObject *analyzer) const;
+    void openChannels(DaemonSource *);
+    bool makeSinks(DaemonChannel *);
+    void applyParams(DaemonChannel *);
+    std::string recordFileName(DaemonChannel const *) const;
+    void printStatus(void) const;
+    void stop(void);
+    void checkFinished(void);
+
+  public:
+    explicit SessionDaemon(
+        DaemonParams const &params,
+        QObject *parent = nullptr);
+    ~SessionDaemon() override;
+
+    bool start(void);
+
+    QString
+    getLastError(void) const
+    {
+      return this->lastError;
+    }
+
+  signals:
+    void finished(void);
+
+  public slots:
+    void onOpened(Suscan::AnalyzerRequest const &);
+    void onOpenError(Suscan::AnalyzerRequest const &, std::string const &);
+    void onSaverStopped(void);
+    void onDurationExpired(void);
+    void onStatusTimeout(void);
+    void onSignalPoll(void);
+    void onEndOfStream(void);
+    void onHalted(void);
+  };
+}
+
+#endif // SESSIONDAEMON_H
@@ -0,0 +1,80 @@
+//
+//    SessionSnapshot.h: Whole-workspace session snapshot
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SESSIONSNAPSHOT_H
+#define SESSIONSNAPSHOT_H
+
+#include <QJsonObject>
+#include <QByteArray>
+#include <QString>
+#include <QList>
+#include <sigutils/types.h>
+#include <SocketForwarder.h>
+#include <string>
+
+#define SIGDIGGER_SESSION_SNAPSHOT_MAX_SIZE (4 << 20)
+
+namespace SigDigger {
+  //
+  // An inspector of the snapshot. Its JSON form is a channel of the
+  // daemon's session files (class, frequency, bandwidth, precise, params,
+  // record, forward) plus what only the UI needs, like the widget factory.
+  //
+  struct SessionInspector {
+    std::string factory;
+    std::string inspClass;
+    SUFREQ      frequency = 0; // Absolute
+    SUFREQ      bandwidth = 0;
+    bool        precise = true;
+    QJsonObject state;         // Given by the inspection widget itself
+
+    QJsonObject toJson(void) const;
+    bool fromJson(QJsonObject const &);
+  };
+
+  //
+  // Everything needed to bring a working setup back at once: the source
+  // profile (by name, and in full), the tuner frequency, every open
+  // top-level inspector and the geometry of the main window. The layout
+  // is that of the daemon's session files, so snapshots of inspectors that
+  // record or forward can also be run headless.
+  //
+  struct SessionSnapshot {
+    std::string profileName;
+    QString     source;        // Serialized source profile
+    SUFREQ      frequency = 0;
+    bool        haveFrequency = false;
+    QByteArray  geometry;
+    QByteArray  windowState;
+    QList<SessionInspector> inspectors;
+
+    QJsonObject toJson(void) const;
+    bool fromJson(QJsonObject const &, QString &error);
+
+    bool save(QString const &path, QString &error) const;
+    bool load(QString const &path, QString &error);
+
+    // Names of the forwarding modes and overflow policies in session files
+    static QString modeName(SocketForwarderMode);
+    static bool parseMode(QString const &, SocketForwarderMode &);
+    static QString overflowName(SocketForwarderOverflow);
+    static bool parseOverflow(QString const &, SocketForwarderOverflow &);
+  };
+}
+
+#endif // SESSIONSNAPSHOT_H
@@ -0,0 +1,85 @@
+//
+//    ShutdownWatchdog.h: Bounded application shutdown
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SHUTDOWNWATCHDOG_H
+#define SHUTDOWNWATCHDOG_H
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+
+// Time given to the whole shutdown (stopping the analyzer, flushing
+// recordings, saving the config) before what is left is abandoned
+#define SIGDIGGER_SHUTDOWN_TIMEOUT_MS 8000
+
+// Extra time given to recorders still flushing their rings to disk
+#define SIGDIGGER_SHUTDOWN_DATA_TIMEOUT_MS 30000
+
+namespace SigDigger {
+  //
+  // Part of the shutdown that the watchdog names if it is still in
+  // progress when the timeout expires. Work holding data (like recorders
+  // with samples still in their rings) is waited for up to its own
+  // deadline before the process is ended.
+  //
+  class ShutdownTracker {
+    unsigned int id;
+
+  public:
+    explicit ShutdownTracker(std::string const &name, bool holdsData = false);
+    ShutdownTracker(ShutdownTracker const &) = delete;
+    ShutdownTracker &operator=(ShutdownTracker const &) = delete;
+    ~ShutdownTracker();
+
+    void set(std::string const &name, bool holdsData);
+  };
+
+  //
+  // Armed when the event loop returns. If it is not destroyed before the
+  // timeout, it runs `beforeExit` (which must only wait for work that
+  // cannot be abandoned, like writing the config), waits for trackers
+  // holding data and ends the process with `exitCode`, leaving every
+  // remaining thread behind.
+  //
+  class ShutdownWatchdog {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool disarmed = false;
+
+    bool waitForData(void);
+
+    void run(
+        unsigned int timeoutMs,
+        int exitCode,
+        std::function<void (void)> beforeExit);
+
+  public:
+    ShutdownWatchdog(
+        unsigned int timeoutMs,
+        int exitCode,
+        std::function<void (void)> const &beforeExit = nullptr);
+    ShutdownWatchdog(ShutdownWatchdog const &) = delete;
+    ShutdownWatchdog &operator=(ShutdownWatchdog const &) = delete;
+    ~ShutdownWatchdog();
+  };
+}
+
+#endif // SHUTDOWNWATCHDOG_H
@@ -21,6 +21,8 @@
 #define SIGDIGGERHELPERS_H
 
 #include <vector>
+#include <memory>
+#include <functional>
 #include <Suscan/Library.h>
 #include <Palette.h>
 #include <QStyledItemDelegate>
@@ -28,9 +30,12 @@
 #include <list>
 
 class QComboBox;
+class QWidget;
 
 namespace SigDigger {
   class MultitaskController;
+  class ExportSamplesTask;
+  class SampleStore;
 
   enum AudioDemod {
     AM,
@@ -56,25 +61,43 @@ namespace SigDigger {
 
     Palette *getGqrxPalette(void);
 
+    // Asks for the output files and pushes the task made for them
+    static void runSaveSamplesDialog(
+        QWidget *root,
+        std::function<ExportSamplesTask *(void)> const &makeTask,
+        Suscan::MultitaskController *);
+
   public:
     static unsigned int abiVersion(void);
     static QString version(void);
     static QString pkgversion(void);
     static void timerdup(struct timeval *);
 
+    // False for widgets in a background tab, a closed dock or a minimized
+    // window. Views use it to skip drawing work nobody would see.
+    static bool isOnScreen(const QWidget *);
+
     // Demod helpers
     static AudioDemod strToDemod(std::string const &str);
     static std::string demodToStr(AudioDemod);
 
     static void openSaveSamplesDialog(
         QWidget *root,
-        const SUCOMPLEX *data,
-        size_t len,
+        std::shared_ptr<const std::vector<SUCOMPLEX>> const &buffer,
         qreal fs,
         int start,
         int end,
         Suscan::MultitaskController *);
 
+    // Samples are read back from the store as they are exported
+    static void openSaveSamplesDialog(
+        QWidget *root,
+        std::shared_ptr<SampleStore> const &store,
+        qreal fs,
+        size_t start,
+        size_t end,
+        Suscan::MultitaskController *);
+
     static SigDiggerHelpers *instance(void);
     int getPaletteIndex(std::string const &) const;
     const Palette *getPalette(std::string const &) const;
@@ -90,6 +113,10 @@ namespace SigDigger {
 
     void pushTZ(const char *);
     bool popTZ(void);
+
+    // Sample rate, frequency and start time from the naming conventions
+    // of SigDigger, gqrx, SDR# and HDSDR. False if nothing was found.
+    bool guessCaptureParams(Suscan::Source::Config &profile);
   };
 }
 
@@ -0,0 +1,187 @@
+//
+//    SignalDetector.h: Emission detection on the PSD stream
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SIGNALDETECTOR_H
+#define SIGNALDETECTOR_H
+
+#include <Suscan/Messages/PSDMessage.h>
+#include <QObject>
+#include <QAtomicInteger>
+#include <QVector>
+#include <QMetaType>
+#include <vector>
+
+// Noise floor adaptation in bins holding an emission, as a fraction of
+// the rate elsewhere. Lets the floor follow gain changes, at the price
+// of absorbing carriers that stay on for thousands of PSDs.
+#define SIGDIGGER_SIGNAL_DETECTOR_FLOOR_LEAK 0.02
+
+namespace SigDigger {
+  struct SignalDetectorParams {
+    SUFLOAT threshold = 10;        // dB over the noise estimate
+    unsigned int guardBins = 2;    // On each side of the bin under test
+    unsigned int trainingBins = 16;
+    SUFLOAT floorAlpha = 0.05;     // Floor adaptation, per PSD
+    unsigned int minBins = 1;
+    unsigned int mergeGap = 1;     // Bins below threshold within an emission
+    qreal minDuration = 0.2;       // Before an emission is reported
+    qreal hold = 0.5;              // Missing time before it is over
+  };
+
+  struct SignalEmission {
+    quint64 id = 0;
+    SUFREQ  fLow = 0;              // Absolute frequencies
+    SUFREQ  fHigh = 0;
+    SUFLOAT peak = 0;              // dB
+    SUFLOAT snr = 0;               // dB, peak over the noise estimate
+    qreal   start = 0;             // PSD timestamps
+    qreal   end = 0;
+
+    SUFREQ
+    center(void) const
+    {
+      return .5 * (this->fLow + this->fHigh);
+    }
+
+    SUFREQ
+    bandwidth(void) const
+    {
+      return this->fHigh - this->fLow;
+    }
+
+    qreal
+    duration(void) const
+    {
+      return this->end - this->start;
+    }
+  };
+
+  struct SignalDetectorEvent {
+    enum Kind {
+      STARTED,
+      ENDED
+    };
+
+    Kind kind = STARTED;
+    SignalEmission emission;
+  };
+
+  //
+  // Turns the PSD stream into emission start / end events. Every bin
+  // keeps a noise floor, adapted only where no emission was found. The
+  // threshold of each bin comes from the floor of its neighbours
+  // (smallest-of CA-CFAR, excluding the guard bins), so emissions already
+  // present when the detector starts are found as well, as long as they
+  // are narrower than the training window. Adjacent detected bins make
+  // up an emission, which is followed from one PSD to the next by
+  // frequency overlap. Emissions shorter than the minimum duration are
+  // never reported.
+  //
+  class SignalDetector {
+    struct Track {
+      SignalEmission emission;
+      qreal lastSeen;
+      bool matched;
+      bool reported;
+    };
+
+    SignalDetectorParams params;
+    std::vector<SUFLOAT> floor;
+    std::vector<SUFLOAT> noise;
+    std::vector<double> sums;
+    std::vector<uint8_t> detected;
+    std::vector<Track> tracks;
+    quint64 lastId = 0;
+    unsigned int frames = 0;
+    SUFREQ lastFc = 0;
+    unsigned int lastFs = 0;
+    qreal lastTime = 0;
+
+    void updateThresholds(const SUFLOAT *psd, size_t size);
+    void updateFloor(const SUFLOAT *psd, size_t size);
+    void track(SignalEmission const &);
+    void endAll(std::vector<SignalDetectorEvent> &);
+
+  public:
+    void setParams(SignalDetectorParams const &);
+    SignalDetectorParams const &getParams(void) const;
+
+    // Events are appended. A change of center frequency, sample rate or
+    // FFT size ends all emissions and starts over.
+    void process(
+        const SUFLOAT *psd,
+        size_t size,
+        SUFREQ fc,
+        unsigned int fs,
+        qreal timeStamp,
+        std::vector<SignalDetectorEvent> &events);
+
+    void process(
+        Suscan::PSDMessage const &,
+        std::vector<SignalDetectorEvent> &events);
+
+    // Ends all emissions
+    void reset(std::vector<SignalDetectorEvent> &events);
+
+    std::vector<SignalEmission> getActive(void) const;
+
+    // dB, median of the per-bin floor
+    SUFLOAT getNoiseFloor(void) const;
+  };
+
+  //
+  // Runs a SignalDetector out of the GUI thread. PSDs arriving while the
+  // previous one is still being processed are dropped: the detector
+  // keeps its own state, it only loses time resolution.
+  //
+  class SignalDetectorWorker : public QObject {
+    Q_OBJECT
+
+    SignalDetector detector;
+    QAtomicInteger<int> busy = 0;
+    QAtomicInteger<quint64> dropped = 0;
+
+  public:
+    explicit SignalDetectorWorker(QObject *parent = nullptr);
+
+    // Called from the GUI thread. Returns false if the PSD was dropped.
+    bool offer(Suscan::PSDMessage const &);
+
+    quint64
+    getDropped(void) const
+    {
+      return this->dropped.loadAcquire();
+    }
+
+  signals:
+    void queuedPSD(Suscan::PSDMessage);
+    void processed(QVector<SigDigger::SignalDetectorEvent>, qreal floor);
+
+  public slots:
+    void onPSD(Suscan::PSDMessage);
+    void onParams(SigDigger::SignalDetectorParams);
+    void onReset(void);
+  };
+}
+
+Q_DECLARE_METATYPE(SigDigger::SignalEmission);
+Q_DECLARE_METATYPE(SigDigger::SignalDetectorEvent);
+Q_DECLARE_METATYPE(QVector<SigDigger::SignalDetectorEvent>);
+Q_DECLARE_METATYPE(SigDigger::SignalDetectorParams);
+
+#endif // SIGNALDETECTOR_H
@@ -20,26 +20,137 @@
 #define UDPFORWARDER_H
 
 #include "GenericDataSaver.h"
+#include <QAtomicInteger>
+#include <atomic>
 
 #define SIGDIGGER_UDPFORWARDER_MAX_UDP_PAYLOAD_SIZE 508
 #define SIGDIGGER_UDPFORWARDER_MAX_UDP_SAMPLES \
   (SIGDIGGER_UDPFORWARDER_MAX_UDP_PAYLOAD_SIZE / static_cast<ssize_t>(sizeof(float _Complex)))
 
+// Datagrams handed to the kernel per syscall, and the largest UDP GSO
+// buffer (the kernel refuses more than 64 segments or 64 KiB)
+#define SIGDIGGER_UDPFORWARDER_MAX_BATCH            64
+#define SIGDIGGER_UDPFORWARDER_MAX_GSO_SIZE         65000
+
+// Hops of multicast datagrams (1: local network only)
+#define SIGDIGGER_UDPFORWARDER_MULTICAST_TTL        1
+
+// Data a TCP peer may fall behind by before the overflow policy applies
+#define SIGDIGGER_UDPFORWARDER_MAX_SEND_QUEUE       (4 << 20)
+#define SIGDIGGER_UDPFORWARDER_MAX_CLIENTS          32
+
+// Shared memory ring: data area size (power of two) and header size
+#define SIGDIGGER_SHM_RING_DEFAULT_SIZE             (64 << 20)
+#define SIGDIGGER_SHM_RING_HEADER_SIZE              4096
+#define SIGDIGGER_SHM_RING_MAGIC                    0x52534453 // "SDSR"
+#define SIGDIGGER_SHM_RING_VERSION                  1
+
 namespace SigDigger {
-  class SocketDataWriter;
+  class GenericDataWriter;
+
+  enum SocketForwarderMode {
+    SOCKET_FORWARDER_UDP,        // Unicast or multicast, depending on host
+    SOCKET_FORWARDER_TCP,        // Connect to host
+    SOCKET_FORWARDER_TCP_SERVER, // Listen on host:port, serve every client
+    SOCKET_FORWARDER_SHM         // POSIX shared memory ring named host
+  };
+
+  // What to do with a TCP peer's data once its send queue is full
+  enum SocketForwarderOverflow {
+    SOCKET_FORWARDER_DROP_OLDEST, // Discard queued data, keep latency low
+    SOCKET_FORWARDER_DROP_NEWEST, // Keep queued data, discard incoming
+    SOCKET_FORWARDER_DECIMATE     // Past half full, queue every other chunk
+  };
+
+  // Published by the writer (worker thread) for the GUI. With several
+  // TCP clients, queued is that of the slowest one.
+  struct SocketForwarderStats {
+    QAtomicInteger<quint64> queued = 0;
+    QAtomicInteger<quint64> dropped = 0;
+  };
+
+  // Sample format on the wire. Integer formats are converted by the
+  // producer, the forwarder only needs to know their size. Packed
+  // applies to symbols (SymbolPacker frames), other data goes as float32.
+  enum SocketForwarderFormat {
+    SOCKET_FORWARDER_FLOAT32,
+    SOCKET_FORWARDER_INT16,
+    SOCKET_FORWARDER_INT8,
+    SOCKET_FORWARDER_PACKED
+  };
+
+  // Optional header in front of every UDP datagram, in network byte
+  // order. Gaps in the sequence number are lost datagrams.
+  struct SocketForwarderHeader {
+    uint32_t sequence;
+    uint32_t samples;
+    uint32_t tv_sec;
+    uint32_t tv_nsec;
+  };
+
+  //
+  // Shared memory ring, at the start of the segment. The data area
+  // starts at dataOffset and holds capacity bytes. head and tail count
+  // bytes since the ring was created: data lives at dataOffset +
+  // (position % capacity), and may wrap around the end of the area.
+  //
+  // Readers shm_open() the segment and read samples in place. In
+  // overwrite mode, the writer never looks at tail: a reader must check
+  // that head - position <= capacity after reading, or the data it just
+  // used was overwritten meanwhile. Otherwise a single reader advances
+  // tail, and chunks that do not fit are dropped by the writer.
+  //
+  // On Linux, the writer increments wakeSeq after every chunk, and wakes
+  // (FUTEX_WAKE, shared) anyone waiting on it if waiters is non-zero.
+  // The segment is unlinked when forwarding stops, after setting closed.
+  //
+  struct SocketForwarderShmHeader {
+    uint32_t magic;       // Written last, once the rest is valid
+    uint32_t version;
+    uint32_t dataOffset;
+    uint32_t sampleSize;
+    uint64_t capacity;
+    uint32_t overwrite;
+    std::atomic<uint32_t> closed;
+
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint32_t> wakeSeq;
+    std::atomic<uint32_t> waiters;
+  };
 
   class SocketForwarder : public GenericDataSaver {
     Q_OBJECT
 
-    SocketDataWriter *writer = nullptr;
+    GenericDataWriter *writer;
+    SocketForwarderStats *stats;
+
+    static GenericDataWriter *makeWriter(
+        std::string const &host,
+        uint16_t port,
+        unsigned int size,
+        SocketForwarderMode mode,
+        bool header,
+        unsigned int sampleSize,
+        SocketForwarderOverflow overflow,
+        SocketForwarderStats *stats);
 
   public:
     SocketForwarder(
         std::string const &host,
         uint16_t port,
         unsigned int size,
-        bool tcp,
+        SocketForwarderMode mode,
+        bool header = false,
+        unsigned int sampleSize = sizeof(SUCOMPLEX),
+        SocketForwarderOverflow overflow = SOCKET_FORWARDER_DROP_OLDEST,
         QObject *parent = nullptr);
+    ~SocketForwarder() override;
+
+    // Bytes waiting in the TCP send queue(s), and bytes discarded by the
+    // overflow policy so far
+    quint64 getQueuedBytes(void) const;
+    quint64 getDroppedBytes(void) const;
   };
 }
 
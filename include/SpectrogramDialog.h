@@ -0,0 +1,85 @@
+//
+//    SpectrogramDialog.h: Spectrogram of a time window selection
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SPECTROGRAMDIALOG_H
+#define SPECTROGRAMDIALOG_H
+
+#include <QDialog>
+#include <QImage>
+#include <QTimer>
+#include <memory>
+#include <vector>
+
+#define SIGDIGGER_SPECTROGRAM_DIALOG_REFRESH_MS   100
+
+// Peak increase (dB) over the one used so far that forces a full redraw
+#define SIGDIGGER_SPECTROGRAM_DIALOG_RESCALE_DB   3
+
+namespace Ui {
+  class SpectrogramDialog;
+}
+
+namespace SigDigger {
+  struct SpectrogramResult;
+  class Palette;
+
+  class SpectrogramDialog : public QDialog
+  {
+    Q_OBJECT
+
+    std::shared_ptr<const SpectrogramResult> result;
+    const Palette *palette = nullptr;
+    QImage image;
+    std::vector<bool> drawn;
+    float drawnPeak = 0;
+    bool haveDrawnPeak = false;
+    qreal fs = 1;
+    QTimer refreshTimer;
+
+    void connectAll(void);
+    void drawTile(size_t tile);
+    void redraw(bool all);
+    void refreshInfo(void);
+
+  public:
+    explicit SpectrogramDialog(QWidget *parent = nullptr);
+    ~SpectrogramDialog() override;
+
+    void setSampleRate(qreal fs);
+    void setPalette(const Palette *palette);
+
+    // Tiles are shown as they complete, until notifyComplete()
+    void setResult(std::shared_ptr<const SpectrogramResult> const &);
+    void notifyComplete(void);
+
+    unsigned int getFftSize(void) const;
+    size_t getHop(void) const;
+
+  signals:
+    void computeRequested(void);
+
+  public slots:
+    void onRefresh(void);
+    void onRangeChanged(void);
+
+  private:
+    Ui::SpectrogramDialog *ui;
+  };
+}
+
+#endif // SPECTROGRAMDIALOG_H
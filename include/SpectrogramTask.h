@@ -0,0 +1,115 @@
+//
+//    SpectrogramTask.h: Parallel short-time Fourier transform
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SPECTROGRAMTASK_H
+#define SPECTROGRAMTASK_H
+
+#include <Suscan/CancellableTask.h>
+#include <Suscan/TaskPool.h>
+#include <sigutils/types.h>
+#include <QAtomicInteger>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Frames handed to a worker at once, and published together
+#define SIGDIGGER_SPECTROGRAM_TILE_FRAMES      32
+
+// Longer ranges are covered with a longer hop than the overlap asks for
+#define SIGDIGGER_SPECTROGRAM_MAX_FRAMES       2048
+#define SIGDIGGER_SPECTROGRAM_POLL_INTERVAL_MS 100
+
+namespace SigDigger {
+  //
+  // Power spectra (in dB, DC in the middle) of `frames` windows of fftSize
+  // samples, `hop` samples apart. Workers fill it tile by tile: a tile may
+  // be read as soon as its flag is set, while the others are in progress.
+  //
+  struct SpectrogramResult {
+    unsigned int fftSize = 0;
+    size_t requestedHop = 0;
+    size_t hop = 0;
+    qint64 start = 0;
+    size_t length = 0;
+    size_t frames = 0;
+    size_t tiles = 0;
+
+    std::vector<float> power;    // frames x fftSize
+    std::vector<float> tilePeak; // Strongest bin of each tile
+    std::unique_ptr<std::atomic<bool>[]> tileDone;
+    bool complete = false;
+
+    SpectrogramResult(
+        unsigned int fftSize,
+        size_t hop,
+        qint64 start,
+        size_t length);
+
+    bool
+    isTileDone(size_t tile) const
+    {
+      return this->tileDone[tile].load(std::memory_order_acquire);
+    }
+
+    // Over the tiles done so far
+    float getPeak(void) const;
+
+    bool
+    matches(
+        unsigned int fftSize,
+        size_t hop,
+        qint64 start,
+        size_t length) const
+    {
+      return this->fftSize == fftSize
+          && this->requestedHop == hop
+          && this->start == start
+          && this->length == length;
+    }
+  };
+
+  class SpectrogramTask : public Suscan::CancellableTask {
+    Q_OBJECT
+
+    std::shared_ptr<const std::vector<SUCOMPLEX>> buffer;
+    std::shared_ptr<SpectrogramResult> result;
+    std::vector<SUFLOAT> window;
+    SU_FFTW(_plan) plan = nullptr;
+    bool started = false;
+
+    Suscan::TaskSlices slices;
+    QAtomicInteger<int> failed = 0;
+    QAtomicInteger<quint64> processed = 0;
+
+    bool prepare(void);
+    void runTile(int tile);
+
+  public:
+    // Keeps the buffer alive (and thus shared) until destroyed
+    SpectrogramTask(
+        std::shared_ptr<const std::vector<SUCOMPLEX>> const &buffer,
+        std::shared_ptr<SpectrogramResult> const &result,
+        QObject *parent = nullptr);
+    virtual ~SpectrogramTask() override;
+
+    virtual bool work(void) override;
+    virtual void cancel(void) override;
+  };
+}
+
+#endif // SPECTROGRAMTASK_H
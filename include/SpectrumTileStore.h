@@ -0,0 +1,124 @@
+//
+//    include/SpectrumTileStore.h: Multi-resolution store of panoramic spectrum data
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SPECTRUMTILESTORE_H
+#define SPECTRUMTILESTORE_H
+
+#include <sigutils/types.h>
+#include <QtGlobal>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#define SIGDIGGER_TILE_STORE_TILE_BINS      256
+#define SIGDIGGER_TILE_STORE_MAX_LEVELS     24
+#define SIGDIGGER_TILE_STORE_DEFAULT_MEMORY (64 << 20)
+#define SIGDIGGER_TILE_STORE_COUNT_MAX      16.0f
+#define SIGDIGGER_TILE_STORE_COUNT_RESET    4.0f
+
+namespace SigDigger {
+  //
+  // The SpectrumTileStore keeps the accumulated PSD of a frequency range
+  // at several resolutions. Level 0 covers the whole range with a single
+  // tile of SIGDIGGER_TILE_STORE_TILE_BINS bins, and every level doubles
+  // the number of tiles of the previous one.
+  //
+  // Every PSD is accumulated in the level that matches its own resolution
+  // and in all the coarser ones. Views are rendered from the finest level
+  // that is not coarser than the view, falling back to coarser levels
+  // wherever there is no data yet. Tiles are evicted in LRU order once
+  // the memory limit is reached.
+  //
+  class SpectrumTileStore {
+    struct Tile {
+      SUFLOAT accum[SIGDIGGER_TILE_STORE_TILE_BINS];
+      SUFLOAT count[SIGDIGGER_TILE_STORE_TILE_BINS];
+      std::list<quint64>::iterator lru;
+    };
+
+    SUFREQ freqMin = 0;
+    SUFREQ freqMax = 0;
+    SUFREQ freqRange = 0;
+    unsigned int maxLevel = 0;
+    size_t maxTiles = 0;
+
+    std::unordered_map<quint64, Tile> tiles;
+    std::list<quint64> lru;
+
+    // Per-feed scratch buffers, reused across feeds
+    std::vector<SUFLOAT> levelAccum;
+    std::vector<SUFLOAT> levelCount;
+    std::vector<SUFLOAT> mergeAccum;
+    std::vector<SUFLOAT> mergeCount;
+
+    static inline quint64
+    key(unsigned int level, quint64 index)
+    {
+      return (static_cast<quint64>(level) << 40) | index;
+    }
+
+    SUFREQ binWidth(unsigned int level) const;
+    unsigned int levelFor(SUFREQ binWidth, bool coarser) const;
+    Tile *findTile(unsigned int level, quint64 index);
+    Tile *assertTile(unsigned int level, quint64 index);
+
+    void commitLevel(
+        unsigned int level,
+        qint64 first,
+        const SUFLOAT *accum,
+        const SUFLOAT *count,
+        size_t len);
+
+    unsigned int renderLevel(
+        unsigned int level,
+        SUFREQ freqMin,
+        SUFREQ freqMax,
+        SUFLOAT *accum,
+        SUFLOAT *count,
+        unsigned int size,
+        unsigned int stride);
+
+  public:
+    SpectrumTileStore(size_t memory = SIGDIGGER_TILE_STORE_DEFAULT_MEMORY);
+
+    void setRange(SUFREQ freqMin, SUFREQ freqMax);
+    void setMemoryLimit(size_t bytes);
+    void clear(void);
+
+    void feed(
+        const SUFLOAT *psd,
+        unsigned int size,
+        SUFREQ freqMin,
+        SUFREQ freqMax);
+
+    // Fills the empty bins of a view (accum and count are read every
+    // stride floats). Returns the number of bins that were filled.
+    unsigned int render(
+        SUFREQ freqMin,
+        SUFREQ freqMax,
+        SUFLOAT *accum,
+        SUFLOAT *count,
+        unsigned int size,
+        unsigned int stride = 1);
+
+    size_t getTileCount(void) const;
+    size_t getMemoryUsage(void) const;
+  };
+}
+
+#endif // SPECTRUMTILESTORE_H
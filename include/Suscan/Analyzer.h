@@ -22,6 +22,15 @@
 
 #include <QObject>
 #include <QThread>
+#include <QHash>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include <Suscan/Compat.h>
 #include <Suscan/Source.h>
@@ -29,6 +38,7 @@
 #include <Suscan/Message.h>
 #include <Suscan/Channel.h>
 #include <Suscan/AnalyzerParams.h>
+#include <Suscan/AnalyzerStats.h>
 
 #include <Suscan/Messages/ChannelMessage.h>
 #include <Suscan/Messages/InspectorMessage.h>
@@ -40,9 +50,60 @@
 
 #include <analyzer/analyzer.h>
 
+namespace SigDigger {
+  class SampleConsumerDispatcher;
+  class BaseBandTap;
+  struct SignalDetectorEvent;
+}
+
+//
+// Messages read by the async thread are delivered to the GUI thread in
+// batches. A batch is closed when there are no more messages in the queue,
+// when it reaches the maximum size or when the deadline since its first
+// message expires, whatever happens first.
+//
+#define SIGDIGGER_ANALYZER_DEFAULT_BATCH_SIZE        64
+#define SIGDIGGER_ANALYZER_DEFAULT_BATCH_DEADLINE_MS 5
+
+//
+// Estimators report at their own rate. The async thread lets at most one
+// update per estimator (and inspector) through every interval. Only the
+// latest of the rest is kept, and delivered when the interval expires.
+//
+#define SIGDIGGER_ANALYZER_DEFAULT_ESTIMATOR_INTERVAL_MS 100
+
+//
+// Control commands (tuning, gains, inspector frequency...) are rate
+// limited per parameter. The first change goes through immediately, and
+// changes arriving within the next interval only keep their latest value,
+// sent when the interval expires.
+//
+#define SIGDIGGER_ANALYZER_DEFAULT_CONTROL_INTERVAL_MS 50
+
 namespace Suscan {
   struct Orbit;
 
+  //
+  // Fields of the source info, as reported by AnalyzerSourceInfo::diff.
+  // Components are told which of them changed since the last message.
+  //
+  enum AnalyzerSourceInfoField {
+    SOURCE_INFO_PERMISSIONS   = 1 << 0,
+    SOURCE_INFO_SAMPLE_RATE   = 1 << 1,  // Source and effective
+    SOURCE_INFO_MEASURED_RATE = 1 << 2,
+    SOURCE_INFO_FREQUENCY     = 1 << 3,  // Frequency and LNB
+    SOURCE_INFO_FREQ_LIMITS   = 1 << 4,
+    SOURCE_INFO_BANDWIDTH     = 1 << 5,
+    SOURCE_INFO_ANTENNA       = 1 << 6,  // Current and the list
+    SOURCE_INFO_DC_REMOVE     = 1 << 7,
+    SOURCE_INFO_IQ_REVERSE    = 1 << 8,
+    SOURCE_INFO_AGC           = 1 << 9,
+    SOURCE_INFO_PPM           = 1 << 10,
+    SOURCE_INFO_TIME_RANGE    = 1 << 11, // Seekable, start and end
+    SOURCE_INFO_GAINS         = 1 << 12, // Names, ranges and values
+    SOURCE_INFO_ALL           = (1 << 13) - 1
+  };
+
   struct AnalyzerSourceInfo {
     bool loan = false;
     struct suscan_analyzer_source_info local_info;
@@ -239,6 +300,13 @@ namespace Suscan {
       for (i = 0; i < this->c_info->antenna_count; ++i)
         vec.push_back(this->c_info->antenna_list[i]);
     }
+
+    // Mask of AnalyzerSourceInfoFields that differ from prev
+    unsigned int diff(AnalyzerSourceInfo const &prev) const;
+
+    // Brings an owned copy up to date. The gain and antenna lists are
+    // only copied again when they are part of the changes.
+    void update(AnalyzerSourceInfo const &info, unsigned int changes);
   };
 
   class Analyzer: public QObject {
@@ -246,7 +314,22 @@ namespace Suscan {
 
     class AsyncThread;
 
+    // PSDs, and samples wanted by sample consumers, are wrapped by the
+    // async thread already (data is then nullptr), so that consumers can
+    // share them.
+    struct AsyncMessage {
+      quint32        type;
+      void          *data;
+      qint64         readNs;
+      PSDMessage     psd;
+      SamplesMessage samples;
+    };
+
+    typedef std::vector<AsyncMessage> MessageBatch;
+
   public:
+    typedef std::function<void (SamplesMessage const &)> SamplesHandler;
+
     enum SweepStrategy {
       STOCHASTIC = SUSCAN_ANALYZER_SWEEP_STRATEGY_STOCHASTIC,
       PROGRESSIVE = SUSCAN_ANALYZER_SWEEP_STRATEGY_PROGRESSIVE
@@ -265,6 +348,84 @@ namespace Suscan {
 
     MQ mq;
 
+    std::atomic<unsigned int> batchSize;
+    std::atomic<unsigned int> batchDeadlineMs;
+
+    // PSD coalescing: only the newest PSD is kept pending for delivery
+    std::atomic<bool> psdCoalescing;
+    std::mutex psdMutex;
+    PSDMessage pendingPSD;
+    bool havePendingPSD = false;
+
+    bool stashPSD(PSDMessage const &);
+    bool takePendingPSD(PSDMessage &);
+
+    // Estimator rate limiting. Held updates are delivered by the GUI
+    // thread through the estimator timer.
+    std::atomic<unsigned int> estimatorIntervalMs;
+    std::mutex estimatorMutex;
+    QHash<quint64, qint64> estimatorLastNs;
+    QHash<quint64, InspectorMessage> heldEstimators;
+    QTimer estimatorTimer;
+
+    bool throttleEstimator(
+        struct suscan_analyzer_inspector_msg *,
+        qint64 now,
+        bool &firstHeld);
+
+    // Control coalescing. GUI thread only. Pending commands are kept in
+    // the order they were first queued, one per parameter key.
+    struct PendingControl {
+      std::string key;
+      std::function<void (void)> send;
+    };
+
+    unsigned int controlIntervalMs;
+    QTimer controlTimer;
+    std::vector<PendingControl> pendingControls;
+
+    // Latest config requested for each inspector, to skip no-op updates
+    QHash<Handle, std::shared_ptr<Config>> inspectorConfigs;
+
+    void queueControl(
+        std::string const &key,
+        std::function<void (void)> const &send);
+    void dropControls(void);
+
+    // Headless consumers, fed from the async thread
+    SigDigger::SampleConsumerDispatcher *consumers = nullptr;
+
+    // Baseband consumers, fed from the DSP thread through their own rings.
+    // The filter is only registered once somebody asks for the tap.
+    SigDigger::BaseBandTap *baseBandTap = nullptr;
+    bool baseBandTapInstalled = false;
+
+    static SUBOOL onBaseBand(
+        void *privdata,
+        suscan_analyzer_t *,
+        const SUCOMPLEX *samples,
+        SUSCOUNT length);
+
+    // Sample routing: each inspector delivers its samples to one receiver
+    struct SamplesRoute {
+      QPointer<QObject> receiver;
+      SamplesHandler    handler;
+      StatsHistogram    dispatchTime;
+    };
+
+    QHash<InspectorId, SamplesRoute> samplesRoutes;
+
+    void routeSamples(SamplesMessage const &);
+
+    // Message path instrumentation. Read counters are updated from the
+    // async thread, everything else from the GUI thread.
+    QElapsedTimer         statsClock;
+    qint64                statsEpochNs = 0;
+    std::atomic<uint64_t> statsRead[ANALYZER_STATS_CLASS_COUNT];
+    std::atomic<uint64_t> statsCoalesced;
+    std::atomic<uint64_t> statsEstimatorsDropped;
+    AnalyzerStats         stats;
+
     static bool registered;
     static void assertTypeRegistration(void);
 
@@ -281,6 +442,11 @@ namespace Suscan {
 
   public slots:
     void captureMessage(quint32 type, void *data);
+    void captureMessageBatch(void *batch);
+
+  private slots:
+    void onControlTimeout(void);
+    void onEstimatorTimeout(void);
 
   public:
     uint32_t allocateRequestId(void);
@@ -292,6 +458,8 @@ namespace Suscan {
 
     void *read(uint32_t &type);
     void registerBaseBandFilter(suscan_analyzer_baseband_filter_func_t, void *);
+    SigDigger::BaseBandTap *getBaseBandTap(void);
+    void dispatchEmission(SigDigger::SignalDetectorEvent const &);
     void setFrequency(SUFREQ freq, SUFREQ lnbFreq = 0);
     void setGain(std::string const &name, SUFLOAT val);
     void seek(struct timeval const &tv);
@@ -307,6 +475,16 @@ namespace Suscan {
     void setAGC(bool enabled);
     void setHopRange(SUFREQ min, SUFREQ max);
     void setBufferingSize(SUSCOUNT len);
+    void setMessageBatching(unsigned int maxSize, unsigned int deadlineMs);
+    void setPSDCoalescing(bool enabled);
+    void setEstimatorUpdateInterval(unsigned int ms);
+    void setControlCoalescing(unsigned int ms);
+    void flushControls(void);
+    void registerSamplesRoute(InspectorId, QObject *, SamplesHandler);
+    void unregisterSamplesRoute(InspectorId);
+
+    AnalyzerStats getStats(void) const;
+    void resetStats(void);
     void halt(void);
 
     // Analyzer asynchronous requests
@@ -331,7 +509,10 @@ namespace Suscan {
     void closeInspector(Handle handle, RequestId id = 0);
 
     // Constructors
-    Analyzer(AnalyzerParams &params, Source::Config const& config);
+    Analyzer(
+        AnalyzerParams &params,
+        Source::Config const& config,
+        bool psdCoalescing = true);
     ~Analyzer();
   };
 
@@ -342,13 +523,14 @@ namespace Suscan {
 
   private:
     Analyzer *owner;
+    bool collect(MessageBatch *batch, uint32_t type, void *data);
     void run() override;
 
   public:
     AsyncThread(Analyzer *);
 
   signals:
-    void message(quint32 type, void *data);
+    void messageBatch(void *batch);
   };
 
 };
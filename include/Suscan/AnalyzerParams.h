@@ -59,6 +59,10 @@ namespace Suscan {
       WindowFunction windowFunction;
       Mode mode;
 
+      // Not an analyzer setting. Spacing (in Hz) of the channel grid used
+      // by AnalyzerRequestTracker, 0 to open inspectors where requested.
+      double channelGrid = 0;
+
       struct suscan_analyzer_params const &getCParams(void);
 
       void deserialize(Object const &conf) override;
@@ -25,10 +25,35 @@
 #include <Suscan/Channel.h>
 #include <QVariant>
 #include <QMap>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <deque>
+
+// Requests not acknowledged by the analyzer within this time are failed
+#define SIGDIGGER_ANALYZER_REQUEST_TIMEOUT_MS      5000
+#define SIGDIGGER_ANALYZER_REQUEST_POLL_MS         250
+
+// Requests sent to the analyzer before waiting for any of them to finish
+#define SIGDIGGER_ANALYZER_REQUEST_MAX_IN_FLIGHT   32
+
+// Automatic channel precision: channels narrower than this fraction of
+// the sample rate are always precise, wider ones are never precise. In
+// between, they are precise unless the analyzer is falling behind (its
+// measured rate is under this fraction of the nominal one).
+#define SIGDIGGER_ANALYZER_PRECISE_NARROW_RATIO    2e-3
+#define SIGDIGGER_ANALYZER_PRECISE_WIDE_RATIO      5e-2
+#define SIGDIGGER_ANALYZER_PRECISE_LAG_RATIO       .95
 
 namespace Suscan {
   class Analyzer;
 
+  enum ChannelPrecision {
+    CHANNEL_PRECISION_AUTO,
+    CHANNEL_PRECISION_PRECISE,
+    CHANNEL_PRECISION_FAST
+  };
+
   struct AnalyzerRequest {
     // Request fields
     uint32_t    requestId = 0;
@@ -42,6 +67,8 @@ namespace Suscan {
     // Request state
     bool opened = false;
     bool idSet  = false;
+    uint32_t batchId = 0;
+    QElapsedTimer sent;
 
     // Response fields
     Handle      handle = -1;
@@ -68,9 +95,32 @@ namespace Suscan {
     Analyzer *m_analyzer = nullptr;
 
     QMap<uint32_t, AnalyzerRequest> m_pendingRequests;
+    std::deque<AnalyzerRequest> m_queuedRequests;
+    QSet<uint32_t> m_expiredRequests;
+    QTimer m_timeoutTimer;
+
+    // Batches: requests made between beginBatch() and endBatch()
+    struct Batch {
+      int remaining = 0;
+      int opened = 0;
+      int failed = 0;
+      bool closed = false;
+    };
+
+    QMap<uint32_t, Batch> m_batches;
+    uint32_t m_currentBatch = 0;
+    uint32_t m_lastBatch = 0;
+
+    SUFREQ m_channelGrid = 0;
+
+    void snapToGrid(AnalyzerRequest &) const;
+    bool choosePrecise(AnalyzerRequest const &) const;
 
-    bool executeOpenRequest(AnalyzerRequest const &);
+    bool executeOpenRequest(AnalyzerRequest &);
     bool executeSetInspectorId(AnalyzerRequest const &);
+    void dispatchQueued();
+    void finishRequest(AnalyzerRequest const &, bool success);
+    void checkBatch(uint32_t);
 
   public:
     bool requestOpen(
@@ -79,9 +129,37 @@ namespace Suscan {
         QVariant v = QVariant(),
         bool precise = true,
         Handle parent = -1);
+
+    // Same, but precise centering is only used if worth its cost, with
+    // CHANNEL_PRECISION_AUTO. Fine tuning is what makes precise channels
+    // expensive, and it runs at the channel rate: wide channels (where
+    // the centering error is negligible anyway) are opened as fast ones,
+    // and so are mid-sized ones while the analyzer cannot keep up.
+    bool requestOpen(
+        std::string const &inspClass,
+        Channel const &ch,
+        QVariant v,
+        ChannelPrecision precision,
+        Handle parent = -1);
     void setAnalyzer(Analyzer *);
     void cancelAll();
 
+    // Requests are pipelined: they are all sent at once (up to
+    // SIGDIGGER_ANALYZER_REQUEST_MAX_IN_FLIGHT) and every one of them
+    // goes on with its own replies. Requests made inside a batch still
+    // report through opened() and error(), and batchFinished() is emitted
+    // once all of them are done.
+    uint32_t beginBatch();
+    void endBatch();
+
+    // All inspectors of an analyzer are fed by the same spectral tuner.
+    // What makes extra channels expensive is the fine tuning of precise
+    // inspectors. With a grid, channels that fit in a grid cell are moved
+    // to the nearest grid frequency and opened as non-precise: the shared
+    // channelizer output is used as is. Subinspectors are left alone.
+    void setChannelGrid(SUFREQ spacing);
+    SUFREQ getChannelGrid() const;
+
     AnalyzerRequestTracker(QObject *parent = nullptr);
     ~AnalyzerRequestTracker() override;
 
@@ -90,9 +168,11 @@ namespace Suscan {
     void opened(Suscan::AnalyzerRequest const &);
     void cancelled(Suscan::AnalyzerRequest const &);
     void error(Suscan::AnalyzerRequest const &, const std::string &);
+    void batchFinished(uint32_t batchId, int opened, int failed);
 
   public slots:
     void onInspectorMessage(const Suscan::InspectorMessage &message);
+    void onTimeout();
   };
 
 }
@@ -0,0 +1,94 @@
+//
+//    AnalyzerStats.h: Analyzer message path statistics
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+#ifndef CPP_ANALYZER_STATS_H
+#define CPP_ANALYZER_STATS_H
+
+#include <QString>
+#include <QVector>
+#include <QJsonObject>
+#include <cstdint>
+
+#define SIGDIGGER_STATS_HISTOGRAM_BUCKETS 32
+
+namespace Suscan {
+  //
+  // Logarithmic histogram. Bucket 0 counts zeroes, bucket i > 0 counts
+  // values in [2^(i - 1), 2^i). Durations are fed in microseconds.
+  //
+  struct StatsHistogram {
+    uint64_t buckets[SIGDIGGER_STATS_HISTOGRAM_BUCKETS] = {};
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t max   = 0;
+
+    void     feed(uint64_t value);
+    void     reset(void);
+    qreal    mean(void) const;
+    uint64_t percentile(qreal p) const;
+
+    QJsonObject toJson(void) const;
+  };
+
+  enum AnalyzerStatsClass {
+    ANALYZER_STATS_PSD,
+    ANALYZER_STATS_INSPECTOR,
+    ANALYZER_STATS_SAMPLES,
+    ANALYZER_STATS_SOURCE_INFO,
+    ANALYZER_STATS_STATUS,
+    ANALYZER_STATS_PARAMS,
+    ANALYZER_STATS_OTHER,
+    ANALYZER_STATS_CLASS_COUNT
+  };
+
+  struct MessageClassStats {
+    uint64_t       read      = 0; // Read from the MQ by the async thread
+    uint64_t       delivered = 0; // Dispatched in the GUI thread
+    uint64_t       coalesced = 0; // Discarded before reaching the GUI thread
+    StatsHistogram queueLatency;  // Async thread read -> GUI dispatch (us)
+    StatsHistogram dispatchTime;  // Time spent in connected slots (us)
+
+    QJsonObject toJson(void) const;
+  };
+
+  struct SamplesRouteStats {
+    QString        receiver;
+    uint32_t       inspectorId = 0;
+    StatsHistogram dispatchTime;
+
+    QJsonObject toJson(void) const;
+  };
+
+  struct AnalyzerStats {
+    qint64            uptimeMs = 0;
+    uint64_t          batches  = 0;
+    StatsHistogram    backlog; // Messages drained from the MQ per batch
+    MessageClassStats classes[ANALYZER_STATS_CLASS_COUNT];
+    QVector<SamplesRouteStats> routes;
+
+    static AnalyzerStatsClass classOf(uint32_t type);
+    static const char *className(int);
+
+    void reset(void);
+    QJsonObject toJson(void) const;
+    QByteArray dump(void) const;
+  };
+};
+
+#endif // CPP_ANALYZER_STATS_H
@@ -21,14 +21,33 @@
 
 #include <QObject>
 #include <QThread>
+#include <QTimer>
+#include <QMutex>
+#include <QAtomicInteger>
+
+// Longest run of work() steps between two visits to the event loop
+#define SIGDIGGER_CANCELLABLE_TASK_SLICE_MS      10
+
+// Rate at which the controller publishes the progress of its task
+#define SIGDIGGER_CANCELLABLE_CONTROLLER_POLL_MS 50
 
 namespace Suscan {
   class CancellableTask : public QObject
   {
     Q_OBJECT
 
-    qreal prog;
+    // Progress is written by the task's thread and read from the
+    // controller's. Counters are atomic; strings are behind statusMutex.
+    QAtomicInteger<quint64> progDone = 0;
+    QAtomicInteger<quint64> progTotal = 0;
+    QAtomicInteger<quint32> progPpm = 0;
+
+    // Set from any thread. Acted upon by the thread running the task.
+    QAtomicInteger<int> cancelRequest = 0;
+
+    mutable QMutex statusMutex;
     QString status;
+    QString statusFormat;
     quint64 dataSize = 0;
 
   protected:
@@ -36,24 +55,34 @@ namespace Suscan {
     void setProgress(qreal progress);
     void setStatus(QString status);
 
+    // Cheap enough to call on every block: `done` out of `total` units,
+    // two atomic stores. If a status format was given, its %1 and %2 are
+    // only replaced by done and total when somebody reads the status.
+    void setProgressCount(quint64 done, quint64 total);
+    void setStatusFormat(QString const &format);
+
   public:
     explicit CancellableTask(QObject *parent = nullptr);
     virtual ~CancellableTask(void) override;
 
     virtual bool work(void) = 0;
+
+    // Only ever called from the thread that calls work(), between two
+    // steps. Other threads go through requestCancel().
     virtual void cancel(void) = 0;
 
-    QString
-    getStatus(void) const
-    {
-      return status;
-    }
+    // Never blocks: the thread running the task calls cancel() before
+    // its next step
+    void requestCancel(void);
+    bool isCancelRequested(void) const;
 
-    qreal
-    getProgress(void) const
-    {
-      return prog;
-    }
+    // Runs one work() step, reporting exceptions through error(). Returns
+    // true if more steps are needed.
+    bool step(void);
+    void notifyProgress(void);
+
+    QString getStatus(void) const;
+    qreal getProgress(void) const;
 
     quint64
     getDataSize(void) const
@@ -79,6 +108,7 @@ namespace Suscan {
     Q_OBJECT
 
     QThread worker;
+    QTimer pollTimer;
     CancellableTask *task = nullptr;
 
     bool cancelledState = false;
@@ -125,6 +155,7 @@ namespace Suscan {
     void onCancelled(void);
     void onError(QString);
     void onProgress(qreal, QString);
+    void onPollTimeout(void);
   };
 }
 
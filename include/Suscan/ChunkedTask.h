@@ -0,0 +1,91 @@
+//
+//    ChunkedTask.h: Cancellable task processed in parallel chunks
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef CHUNKEDTASK_H
+#define CHUNKEDTASK_H
+
+#include <Suscan/CancellableTask.h>
+#include <Suscan/TaskPool.h>
+#include <sigutils/types.h>
+#include <QAtomicInteger>
+#include <vector>
+
+#define SIGDIGGER_CHUNKED_TASK_MIN_CHUNK       (1 << 16)
+#define SIGDIGGER_CHUNKED_TASK_CHUNKS_PER_CPU  4
+#define SIGDIGGER_CHUNKED_TASK_POLL_INTERVAL_MS 100
+
+namespace Suscan {
+  //
+  // A task whose output at sample n only depends on the input samples
+  // [n - overlap, n]. The buffer is split in chunks that are processed by
+  // the task thread and the shared TaskPool. Each chunk receives a copy of
+  // the `overlap` samples preceding it, taken before any chunk runs, so
+  // origin and destination may be the same buffer.
+  //
+  // Destructors of derived classes must call stop() first: chunks still
+  // in progress call processChunk().
+  //
+  class ChunkedTask : public CancellableTask
+  {
+    Q_OBJECT
+
+    struct Chunk {
+      size_t start;
+      size_t end;
+      std::vector<SUCOMPLEX> history;
+    };
+
+    const SUCOMPLEX *chunkOrigin = nullptr;
+    size_t chunkLength = 0;
+    size_t overlap = 0;
+    bool started = false;
+
+    std::vector<Chunk> chunks;
+    TaskSlices slices;
+    QAtomicInteger<quint64> processed = 0;
+
+    void prepare(void);
+    void runChunk(int index);
+    void updateStatus(void);
+
+  protected:
+    // Waits for the chunks in progress. No chunk starts after this.
+    void stop(void);
+
+    // Compute the output samples [start, end). history points to the
+    // `overlap` input samples preceding start, zero-padded at the
+    // beginning of the buffer. Called concurrently for different chunks.
+    virtual void processChunk(
+        size_t start,
+        size_t end,
+        const SUCOMPLEX *history) = 0;
+
+  public:
+    ChunkedTask(
+        const SUCOMPLEX *origin,
+        size_t length,
+        size_t overlap,
+        QObject *parent = nullptr);
+    virtual ~ChunkedTask() override;
+
+    virtual bool work(void) override;
+    virtual void cancel(void) override;
+  };
+}
+
+#endif // CHUNKEDTASK_H
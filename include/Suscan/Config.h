@@ -33,6 +33,8 @@ namespace Suscan {
     public:
       FieldValue(struct suscan_field_value *inst);
 
+      bool sameValue(FieldValue const &other) const;
+
       enum suscan_field_type
       getType(void) const
       {
@@ -91,6 +93,10 @@ namespace Suscan {
 
       FieldValue const *get(std::string const &name) const;
 
+      // Names of the fields whose value differs from those of `other`.
+      // Configs of different descriptors differ in every field.
+      std::vector<std::string> changedFields(Config const &other) const;
+
       const suscan_config_t *
       getInstance(void) const
       {
@@ -0,0 +1,125 @@
+//
+//    ConfigCache.h: Binary cache of parsed configuration files
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef CPP_CONFIGCACHE_H
+#define CPP_CONFIGCACHE_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <string>
+#include <vector>
+
+#define SUSCAN_CONFIG_CACHE_MAGIC   0x43434453 // "SDCC"
+#define SUSCAN_CONFIG_CACHE_VERSION 1
+
+namespace Suscan {
+  // Little-endian, length-prefixed records. Nothing clever: the point is
+  // not having to parse text.
+  class ConfigCacheWriter {
+    QByteArray data;
+
+  public:
+    void putU32(quint32);
+    void putU64(quint64);
+    void putString(std::string const &);
+    void putString(QString const &);
+
+    inline QByteArray const &
+    bytes(void) const
+    {
+      return this->data;
+    }
+  };
+
+  // Reads records back. Reading past the end (a truncated or corrupt
+  // cache) returns zeroes and clears good().
+  class ConfigCacheReader {
+    const uchar *ptr = nullptr;
+    const uchar *end = nullptr;
+    bool ok = true;
+
+    bool take(size_t);
+
+  public:
+    ConfigCacheReader(void) = default;
+    ConfigCacheReader(const uchar *data, size_t size);
+
+    quint32 getU32(void);
+    quint64 getU64(void);
+    std::string getString(void);
+    QString getQString(void);
+
+    inline bool
+    good(void) const
+    {
+      return this->ok;
+    }
+
+    inline size_t
+    remaining(void) const
+    {
+      return static_cast<size_t>(this->end - this->ptr);
+    }
+  };
+
+  // Binary snapshot of whatever was parsed from a set of files. It is
+  // valid while the files keep their mtimes and sizes. If only the mtimes
+  // changed (e.g. the file was saved again as it was), a hash of the
+  // contents settles it.
+  class ConfigCache {
+    struct Stamp {
+      QString path;
+      quint64 mtime;
+      quint64 size;
+    };
+
+    QString path;
+    std::vector<Stamp> stamps;
+    QFile file;
+    uchar *map = nullptr;
+    bool touched = false;
+
+    QByteArray hashSources(void) const;
+
+  public:
+    ConfigCache(std::string const &name, QStringList const &sources);
+    ~ConfigCache();
+
+    // Maps the cache and points the reader to its payload. False if
+    // there is no cache or it is stale.
+    bool open(ConfigCacheReader &reader);
+
+    // True if open() succeeded only thanks to the hash: the payload is
+    // fine, but it should be saved again with the new mtimes.
+    inline bool
+    needsRefresh(void) const
+    {
+      return this->touched;
+    }
+
+    // Replaces the cache, atomically
+    bool save(QByteArray const &payload);
+
+    // Files the configuration database reads the given context from
+    static QStringList confDbSources(std::string const &context);
+  };
+}
+
+#endif // CPP_CONFIGCACHE_H
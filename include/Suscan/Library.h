@@ -38,21 +38,40 @@
 
 #include <map>
 #include <list>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include <QMap>
 
 #include <QHash>
+#include <QSet>
+
+// Changes to persistent collections arriving within this window are
+// written together
+#define SIGDIGGER_SYNC_COALESCE_MS 1000
+
+// Smallest part of a TLE catalog worth a parsing thread of its own
+#define SIGDIGGER_TLE_PARSE_MIN_SLICE (64 << 10)
+
+// Devices found by the last detection, under the local cache directory
+#define SIGDIGGER_KNOWN_DEVICES_FILE "known_devices.txt"
 
 namespace SigDigger {
   class ToolWidgetFactory;
   class TabWidgetFactory;
   class InspectionWidgetFactory;
   class UIListenerFactory;
+  class AudioDspFactory;
+  class SampleConsumerFactory;
 };
 
 namespace Suscan {
   uint qHash(const Suscan::Source::Device &dev);
 
   class MultitaskController;
+  class Plugin;
 
   typedef std::map<std::string, Source::Config> ConfigMap;
 
@@ -71,6 +90,12 @@ namespace Suscan {
     Suscan::Object &&serialize(void) override;
   };
 
+  // What is remembered of a device between sessions
+  struct DeviceSummary {
+    std::string desc;
+    std::string driver;
+  };
+
   struct SpectrumUnit {
     std::string name = "dBFS";
     float dBPerUnit  = 1.0f;
@@ -205,18 +230,95 @@ namespace Suscan {
     void debug(void) const;
   };
 
+  class ConfigCache;
+
   class Singleton {
+  public:
+    // Startup is split in steps. init() runs the eager ones concurrently,
+    // as far as their dependencies (and the configuration database, which
+    // is not thread-safe) allow, and leaves the deferred ones to a
+    // background thread. Accessors of deferred data wait for the step
+    // they need on first use.
+    enum InitStep {
+      INIT_SOURCES,
+      INIT_SPECTRUM_SOURCES,
+      INIT_ESTIMATORS,
+      INIT_INSPECTORS,
+      INIT_PALETTES,
+      INIT_FATS,
+      INIT_BOOKMARKS,
+      INIT_LOCATIONS,
+      INIT_TLE_SOURCES,
+      INIT_TLE,
+      INIT_AUTOGAINS,
+      INIT_UI_CONFIG,
+      INIT_RECENT_LIST,
+      INIT_STEP_COUNT
+    };
+
+  private:
+    enum InitState {
+      INIT_PENDING,
+      INIT_RUNNING,
+      INIT_DONE
+    };
+
+    struct InitStepInfo {
+      const char *message;
+      void (Singleton::*run)(void);
+      unsigned int deps;   // Mask of (1 << InitStep)
+      bool confDb;         // Touches the configuration database
+      bool deferred;
+    };
+
+    static const InitStepInfo initSteps[INIT_STEP_COUNT];
+
     static Singleton *instance;
     static Logger *logger;
 
+    // Init graph state
+    mutable std::mutex initMutex;
+    mutable std::condition_variable initCond;
+    std::mutex confDbMutex;
+    InitState initState[INIT_STEP_COUNT];
+    std::exception_ptr initError;
+    std::function<void (std::string const &)> initProgress;
+    std::thread deferredThread;
+
+    // Write-behind persistence. Collections are modified by the GUI thread
+    // only, under syncMutex; the writer thread copies the dirty ones under
+    // the same lock and does everything else without it.
+    enum SyncItem {
+      SYNC_RECENT,
+      SYNC_UI,
+      SYNC_BOOKMARKS,
+      SYNC_LOCATIONS,
+      SYNC_TLE_SOURCES,
+      SYNC_ITEM_COUNT
+    };
+
+    std::mutex syncMutex;
+    std::condition_variable syncCond;
+    std::mutex flushMutex;     // One flush at a time
+    unsigned int dirty = 0;    // Mask of (1 << SyncItem)
+    bool syncExit = false;
+    std::thread syncThread;
+
     // Background tasks
     MultitaskController *backgroundTaskController = nullptr;
     std::vector<Source::Device> devices;
+    std::vector<Source::Device> devicesScratch; // Previous listing, reused
+
+    // Local devices found by the last completed detection, persisted so
+    // that they can be listed before this session's detection is over.
+    std::vector<DeviceSummary> knownDevices;
+    bool devicesDetected = false;
     ConfigMap profiles;
     std::vector<Object> palettes;
     std::vector<Object> autoGains;
     std::vector<Object> uiConfig;
     std::vector<Object> FATs;
+    Object cachedFATs; // Owns the FATs loaded from the cache
 
     // Singleton config
     Location                        qth;
@@ -224,18 +326,42 @@ namespace Suscan {
     QMap<QString, Location>         locations;
     QMap<std::string, TLESource>    tleSources;
     QMap<qint64, Bookmark>          bookmarks;
+    quint64                         bookmarkRevision = 0;
     QMap<std::string, SpectrumUnit> spectrumUnits;
-    QHash<QString, Source::Config>  networkProfiles;
+    QMap<QString, Source::Config>   networkProfiles;
+    QSet<QString>                   networkProfilesSeen;
+
+    // Bumped only when a refresh actually changes the listing, so that
+    // views can skip repopulating (or diff) on hotplug and discovery noise.
+    quint64                         deviceRevision = 1;
+    quint64                         networkProfileRevision = 1;
 
     // Feature object factories
     QList<SigDigger::ToolWidgetFactory *>       toolWidgetFactories;
     QList<SigDigger::TabWidgetFactory *>        tabWidgetFactories;
     QList<SigDigger::InspectionWidgetFactory *> inspectionWidgetFactories;
     QList<SigDigger::UIListenerFactory *>       uiListenerFactories;
+    QList<SigDigger::AudioDspFactory *>         audioDspFactories;
+    QList<SigDigger::SampleConsumerFactory *>   sampleConsumerFactories;
 
-    // Used for search only
+    // Used for search only, and to tell repeated registrations apart
+    QHash<QString, SigDigger::ToolWidgetFactory *>       toolWidgetFactoryTable;
     QHash<QString, SigDigger::TabWidgetFactory *>        tabWidgetFactoryTable;
     QHash<QString, SigDigger::InspectionWidgetFactory *> inspectionWidgetFactoryTable;
+    QHash<QString, SigDigger::UIListenerFactory *>       uiListenerFactoryTable;
+
+    // Factories announced by the manifests of plugins not opened yet. The
+    // plugin is loaded the first time one of them is looked up.
+    struct DeferredFactory {
+      Plugin *plugin;
+      QString description;
+    };
+
+    mutable QMap<QString, DeferredFactory> deferredTabFactories;
+    mutable QMap<QString, DeferredFactory> deferredInspectionFactories;
+
+    bool loadDeferredPlugin(Plugin *) const;
+    bool registerPlugin(std::string const &path);
 
     std::list<std::string> recentProfiles;
 
@@ -251,17 +377,44 @@ namespace Suscan {
     bool havePalette(std::string const &name);
     bool haveAutoGain(std::string const &name);
     bool haveFAT(std::string const &name);
+    void markDirty(SyncItem);
+    unsigned int takeDirty(void);
+    void flush(unsigned int mask);
+    void writeBehind(void);
+    bool writeContext(std::string const &name);
     void syncUI(void);
-    void syncRecent(void);
-    void syncLocations(void);
-    void syncTLESources(void);
-    void syncBookmarks(void);
+    void syncRecent(std::list<std::string> const &);
+    void syncLocations(QMap<QString, Location> const &, Location const *);
+    void syncTLESources(QMap<std::string, TLESource> const &);
+    void syncBookmarks(QMap<qint64, Bookmark> const &);
     void initLocationsFromContext(ConfigContext &ctx, bool user);
     void initTLESourcesFromContext(ConfigContext &ctx, bool user);
+    void parseBookmarks(void);
+    bool loadBookmarkCache(ConfigCache &);
+    void saveBookmarkCache(ConfigCache &);
+    bool loadFATCache(ConfigCache &);
+    void saveFATCache(ConfigCache &);
 
     static QString normalizeTLEName(QString const &);
+    static bool saveTLE(QString const &, Orbit const &, std::string const &);
+
+    static QString knownDevicesPath(void);
+    void loadKnownDevices(void);
+    void saveKnownDevices(void);
+
+    void runStep(InitStep);
+    void require(InitStep) const;
+    bool isInitDone(InitStep) const;
 
   public:
+    // Runs the eager init steps, calling progress (from any thread) as
+    // each one starts, and starts the deferred ones in the background.
+    // Rethrows the first exception of an eager step.
+    void init(std::function<void (std::string const &)> const &progress);
+
+    // Waits for every step, deferred ones included
+    void waitForInit(void);
+
     void init_sources(void);
     void init_estimators(void);
     void init_spectrum_sources(void);
@@ -276,8 +429,15 @@ namespace Suscan {
     void init_tle_sources(void);
     void init_tle(void);
     void init_plugins(void);
+
+    // Enumerates devices. Some drivers take seconds to answer, so this is
+    // meant to run off the GUI thread, followed by commitDetectedDevices()
+    // from the GUI thread.
     void detect_devices(void);
+    void commitDetectedDevices(void);
 
+    // Writes every pending change now, from the calling thread. Changes
+    // are otherwise written in the background, shortly after they happen.
     void sync(void);
 
     void killBackgroundTaskController(void);
@@ -294,6 +454,10 @@ namespace Suscan {
     void saveProfile(Suscan::Source::Config const &name);
 
     bool registerBookmark(BookmarkInfo const& info);
+    // All at once: one revision change and one write of the bookmark file.
+    // Frequencies already bookmarked are left alone. Returns how many were
+    // actually added.
+    int registerBookmarks(QList<BookmarkInfo> const &list);
     void replaceBookmark(BookmarkInfo const& info);
     void removeBookmark(qint64);
 
@@ -310,6 +474,11 @@ namespace Suscan {
 
     bool registerTLE(std::string const &);
 
+    // Registers every TLE in a catalog, parsed and saved in parallel.
+    // Duplicates (same catalog number) keep the newest epoch only.
+    // Returns the number of satellites updated.
+    unsigned int registerTLEs(std::string const &catalog);
+
     bool haveQth() const;
     Location getQth(void) const;
     void setQth(Location const &);
@@ -336,6 +505,13 @@ namespace Suscan {
     QMap<qint64, Bookmark>::const_iterator getFirstBookmark(void) const;
     QMap<qint64, Bookmark>::const_iterator getLastBookmark(void) const;
     QMap<qint64, Bookmark>::const_iterator getBookmarkFrom(qint64 bm) const;
+    QList<BookmarkInfo> getBookmarksInRange(qint64 start, qint64 end) const;
+    quint64 getBookmarkRevision(void) const;
+    quint64 getDeviceRevision(void) const;
+
+    // Known from a previous session, but not detected (yet) in this one
+    std::vector<DeviceSummary> getMissingDevices(void) const;
+    quint64 getNetworkProfileRevision(void) const;
 
     QMap<QString, Location> const &getLocationMap(void) const;
     QMap<QString, Location>::const_iterator getFirstLocation(void) const;
@@ -354,15 +530,16 @@ namespace Suscan {
     QMap<std::string, SpectrumUnit>::const_iterator getLastSpectrumUnit(void) const;
     QMap<std::string, SpectrumUnit>::const_iterator getSpectrumUnitFrom(std::string const &) const;
 
-    QHash<QString, Source::Config> const &getNetworkProfileMap(void) const;
-    QHash<QString, Source::Config>::const_iterator getFirstNetworkProfile(void) const;
-    QHash<QString, Source::Config>::const_iterator getLastNetworkProfile(void) const;
-    QHash<QString, Source::Config>::const_iterator getNetworkProfileFrom(QString const &) const;
+    QMap<QString, Source::Config> const &getNetworkProfileMap(void) const;
+    QMap<QString, Source::Config>::const_iterator getFirstNetworkProfile(void) const;
+    QMap<QString, Source::Config>::const_iterator getLastNetworkProfile(void) const;
+    QMap<QString, Source::Config>::const_iterator getNetworkProfileFrom(QString const &) const;
 
     bool registerToolWidgetFactory(SigDigger::ToolWidgetFactory *);
     bool unregisterToolWidgetFactory(SigDigger::ToolWidgetFactory *);
     QList<SigDigger::ToolWidgetFactory *>::const_iterator getFirstToolWidgetFactory() const;
     QList<SigDigger::ToolWidgetFactory *>::const_iterator getLastToolWidgetFactory() const;
+    SigDigger::ToolWidgetFactory *findToolWidgetFactory(QString const &) const;
 
     bool registerTabWidgetFactory(SigDigger::TabWidgetFactory *);
     bool unregisterTabWidgetFactory(SigDigger::TabWidgetFactory *);
@@ -376,10 +553,25 @@ namespace Suscan {
     QList<SigDigger::InspectionWidgetFactory *>::const_iterator getLastInspectionWidgetFactory() const;
     SigDigger::InspectionWidgetFactory *findInspectionWidgetFactory(QString const &) const;
 
+    // Name and description of every inspection widget factory, including
+    // those of plugins that have not been loaded yet
+    QList<QPair<QString, QString>> getInspectionWidgetFactoryList(void) const;
+
     bool registerUIListenerFactory(SigDigger::UIListenerFactory *);
     bool unregisterUIListenerFactory(SigDigger::UIListenerFactory *);
     QList<SigDigger::UIListenerFactory *>::const_iterator getFirstUIListenerFactory() const;
     QList<SigDigger::UIListenerFactory *>::const_iterator getLastUIListenerFactory() const;
+    SigDigger::UIListenerFactory *findUIListenerFactory(QString const &) const;
+
+    bool registerAudioDspFactory(SigDigger::AudioDspFactory *);
+    bool unregisterAudioDspFactory(SigDigger::AudioDspFactory *);
+    QList<SigDigger::AudioDspFactory *>::const_iterator getFirstAudioDspFactory() const;
+    QList<SigDigger::AudioDspFactory *>::const_iterator getLastAudioDspFactory() const;
+
+    bool registerSampleConsumerFactory(SigDigger::SampleConsumerFactory *);
+    bool unregisterSampleConsumerFactory(SigDigger::SampleConsumerFactory *);
+    QList<SigDigger::SampleConsumerFactory *>::const_iterator getFirstSampleConsumerFactory() const;
+    QList<SigDigger::SampleConsumerFactory *>::const_iterator getLastSampleConsumerFactory() const;
 
     bool notifyRecent(std::string const &name);
     bool removeRecent(std::string const &name);
@@ -20,20 +20,42 @@
 #ifndef LOG_H
 #define LOG_H
 
-#include <vector>
+#include <deque>
 #include <mutex>
+#include <atomic>
+#include <string>
+#include <unordered_set>
 
 #include <Suscan/Compat.h>
 #include <sigutils/log.h>
 
 #include <QObject>
+#include <QTimer>
+#include <QVector>
+
+// Messages that can wait in the ring before the next delivery. Push never
+// blocks: once it is full, new messages are dropped (and counted).
+#define SIGDIGGER_LOGGER_RING_SIZE             4096
+
+// Messages kept for getLogText() and friends
+#define SIGDIGGER_LOGGER_HISTORY_SIZE          10000
+
+// Rate at which pending messages are handed to the UI
+#define SIGDIGGER_LOGGER_DELIVERY_INTERVAL_MS  100
+
+// Messages per second accepted for each severity (0 means no limit)
+#define SIGDIGGER_LOGGER_RATE_DEBUG            50
+#define SIGDIGGER_LOGGER_RATE_INFO             100
+#define SIGDIGGER_LOGGER_RATE_WARNING          100
+#define SIGDIGGER_LOGGER_RATE_ERROR            0
+#define SIGDIGGER_LOGGER_RATE_CRITICAL         0
 
 namespace Suscan {
   struct LoggerMessage {
     enum sigutils_log_severity severity;
     struct timeval time;
-    std::string domain;
-    std::string function;
+    const char *domain;   // Interned, valid for the life of the program
+    const char *function; // Interned, valid for the life of the program
     unsigned int line;
     std::string message;
   };
@@ -43,16 +65,49 @@ namespace Suscan {
       Q_OBJECT
 
   private:
+    // Bounded multi-producer, single-consumer queue. A slot is free for
+    // the producer at position p when its sequence is p, and ready for the
+    // consumer when it is p + 1.
+    struct RingSlot {
+      std::atomic<size_t> sequence;
+      LoggerMessage msg;
+    };
+
+    struct RateWindow {
+      std::atomic<time_t> second;
+      std::atomic<unsigned int> count;
+    };
+
     static Logger *instance; // Singleton instance
+
+    RingSlot *ring = nullptr;
+    std::atomic<size_t> head;
+    size_t tail = 0;
+    std::atomic<unsigned int> dropped;
+    std::atomic<unsigned int> suppressed;
+    RateWindow rates[SU_LOG_SEVERITY_CRITICAL + 1];
+
+    std::mutex internMutex;
+    std::unordered_set<std::string> interned;
+
+    // History, and drain of the ring into it, are behind this one
     std::mutex mutex;
-    std::vector<LoggerMessage> messages;
+    std::deque<LoggerMessage> messages;
+    QVector<LoggerMessage> pending; // Drained, not yet delivered
+
+    QTimer deliveryTimer;
 
     static void log_func(
         void *privdata,
         const struct sigutils_log_message *message);
 
     Logger(void);
+    const char *intern(const char *);
+    bool admit(enum sigutils_log_severity, time_t);
     void push(const struct sigutils_log_message *message);
+    void store(LoggerMessage const &);
+    void storeNote(enum sigutils_log_severity, std::string const &);
+    void drain(void);
     virtual ~Logger();
 
   public:
@@ -60,14 +115,20 @@ namespace Suscan {
 
     void flush(void);
 
+    // While locked, begin() and end() walk the history, including every
+    // message pushed up to the call to lock().
     void lock(void);
     void unlock(void);
 
-    std::vector<LoggerMessage>::const_iterator begin(void);
-    std::vector<LoggerMessage>::const_iterator end(void);
+    std::deque<LoggerMessage>::const_iterator begin(void);
+    std::deque<LoggerMessage>::const_iterator end(void);
 
   signals:
-    void messageEmitted(Suscan::LoggerMessage);
+    // Every message since the previous delivery, in order
+    void messagesEmitted(QVector<Suscan::LoggerMessage>);
+
+  public slots:
+    void onDeliveryTimeout(void);
   };
 };
 
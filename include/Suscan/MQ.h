@@ -36,6 +36,7 @@ namespace Suscan {
 
   public:
     void *read(uint32_t &type);
+    bool poll(uint32_t &type, void *&data);
 
     MQ();
     ~MQ();
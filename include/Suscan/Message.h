@@ -31,17 +31,28 @@ namespace Suscan {
   typedef uint32_t InspectorId;
   typedef SUHANDLE Handle;
 
+  //
+  // Messages share their C payload through an intrusive reference counter.
+  // Reference blocks are recycled through a free list, so steady message
+  // traffic does not hit the allocator.
+  //
+  struct MessageRef;
+
   class Message {
   private:
     uint32_t type;
+    MessageRef *ref = nullptr;
+
+    void release(void);
 
     // These constructors are to be called by derivate classes
   protected:
-    std::shared_ptr<void> c_message;
+    void *getCMessage(void) const;
     Message(uint32_t type, void *c_message);
 
   public:
     uint32_t getType(void) const;
+    bool isNull(void) const;
 
     Message(const Message &);
     Message(Message &&);
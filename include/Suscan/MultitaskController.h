@@ -21,20 +21,24 @@
 
 #include <QObject>
 #include <Suscan/CancellableTask.h>
+#include <Suscan/TaskPool.h>
 #include <list>
 #include <QMap>
+#include <QSet>
 #include <QVector>
-#include <QThread>
 #include <QDateTime>
+#include <QTimer>
+
+// Progress of every task is reported at most once per interval
+#define SIGDIGGER_MULTITASK_PROGRESS_INTERVAL_MS 250
 
 namespace Suscan {
   //
-  // CancellableTaskContext acquires ownership on
-  // CancellableTask and the thread in which runs
+  // CancellableTaskContext keeps the bookkeeping of a task pushed to the
+  // controller. The task itself is owned (and deleted) by the pool.
   //
 
   class CancellableTaskContext {
-      QThread *mThread = nullptr;
       CancellableTask *mTask = nullptr;
       QDateTime mCreationTime;
       QDateTime mLastUpdate;
@@ -42,15 +46,12 @@ namespace Suscan {
       QString mTitle;
       QString mLastProgressMessage;
       qreal mLastProgressValue = 0;
+      qreal mRateProgressValue = 0; // At mLastUpdate
       int mIndex = -1;
 
-      void connectAll(void);
-
     public:
       CancellableTaskContext(CancellableTask *, QString const &);
-      ~CancellableTaskContext();
 
-      void start(void);
       CancellableTask *task(void) const;
       QString title(void) const;
 
@@ -72,6 +73,11 @@ namespace Suscan {
       std::list<CancellableTaskContext *> deadList;
       QVector<CancellableTaskContext *> taskVec;
       QMap<CancellableTask *, CancellableTaskContext *> reverseTaskMap;
+      TaskPool pool;
+
+      // Tasks whose progress changed since the last taskProgress()
+      QSet<CancellableTaskContext *> progressed;
+      QTimer progressTimer;
 
       CancellableTaskContext *findTask(CancellableTask *) const;
       void connectNewTask(CancellableTask *);
@@ -85,25 +91,33 @@ namespace Suscan {
 
       void pushTask(
           CancellableTask *,
-          QString const &);
+          QString const &,
+          TaskPriority priority = TASK_PRIORITY_BACKGROUND,
+          qint64 sliceMs = 0);
       void getTaskVector(QVector<CancellableTaskContext *> &) const;
       void cancelAll(void);
       void cancelByIndex(int);
       void cleanup(void);
 
+      TaskPool *
+      getPool(void)
+      {
+        return &this->pool;
+      }
+
     signals:
       void taskAdded(CancellableTask *);
       void taskRemoved(CancellableTask *);
 
+      // Coalesced: once per task and SIGDIGGER_MULTITASK_PROGRESS_INTERVAL_MS
       void taskProgress(int, qreal, QString);
       void taskDone(int);
       void taskCancelled(int);
       void taskError(int, QString);
 
-      void cancel(void);
-
     public slots:
       void onProgress(qreal, QString);
+      void onProgressTimeout(void);
       void onDone(void);
       void onCancelled(void);
       void onError(QString);
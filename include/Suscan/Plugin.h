@@ -25,6 +25,12 @@
 #include <sigutils/version.h>
 
 #include <QSet>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+// Read next to the plugin (libfoo.so.manifest) instead of opening it
+#define SUSCAN_PLUGIN_MANIFEST_SUFFIX ".manifest"
 
 #define SUSCAN_SYM_PFX  SUSCAN_CPP_
 
@@ -68,6 +74,33 @@ namespace Suscan {
 
   typedef bool (*PluginEntryFunc) (Plugin *);
 
+  // What a plugin provides, as announced by its manifest. An INI file:
+  //
+  //   [plugin]
+  //   name=...
+  //   version=x.y.z
+  //   description=...
+  //
+  //   [tab]
+  //   factory_name=Factory description
+  //
+  //   [inspection]
+  //   factory_name=Factory description
+  //
+  // Plugins with tool widgets, UI listeners, audio DSPs or sample
+  // consumers ([tool], [listener], [audiodsp] and [consumer] sections) are
+  // used from startup, and are loaded right away.
+  struct PluginManifest {
+    std::string name;
+    std::string version;
+    std::string description;
+    QList<QPair<QString, QString>> tabFactories;
+    QList<QPair<QString, QString>> inspectionFactories;
+    bool eager = false;
+
+    static bool read(PluginManifest &, std::string const &path);
+  };
+
   class Plugin {
       static Plugin *m_default;
       void *m_handle = nullptr;
@@ -78,6 +111,7 @@ namespace Suscan {
       std::string m_description;
 
       bool m_loaded = false;
+      bool m_deferred = false; // Opened on first load()
 
       void *resolveSym(std::string const &sym);
 
@@ -93,12 +127,21 @@ namespace Suscan {
 
     public:
       static Plugin *make(const char *path);
+      static Plugin *makeDeferred(
+          const char *path,
+          PluginManifest const &manifest);
       static Plugin *getDefaultPlugin();
 
       bool load(void);
       bool canBeUnloaded(void) const;
       bool unload(void);
 
+      inline std::string const &
+      path(void) const
+      {
+        return this->m_path;
+      }
+
       ~Plugin();
 
       // Internal
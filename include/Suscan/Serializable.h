@@ -47,6 +47,10 @@ namespace Suscan {
       }
 
       virtual void deserialize(Object const &conf) = 0;
+
+      // Hands over the tree it just built (through persist()). Move it
+      // to its final place (setField, append, putUIConfig) right away:
+      // a copy would only borrow it.
       virtual Object &&serialize(void) = 0;
       virtual ~Serializable();
   };
@@ -343,6 +343,10 @@ namespace Suscan {
     bool isRemote(void) const;
     SUFLOAT getPPM(void) const;
 
+    // Whether an analyzer running on this profile must be restarted to
+    // take the other one, or it can be applied in place
+    bool needsRestart(Config const &other) const;
+
     const Source::Device &getDevice(void);
     enum suscan_source_format getFormat(void) const;
 
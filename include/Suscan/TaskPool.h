@@ -0,0 +1,226 @@
+//
+//    TaskPool.h: Bounded work-stealing pool for cancellable tasks
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <Suscan/CancellableTask.h>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInteger>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#define SIGDIGGER_TASK_POOL_INTERACTIVE_SLICE_MS 50
+#define SIGDIGGER_TASK_POOL_BACKGROUND_SLICE_MS  20
+#define SIGDIGGER_TASK_POOL_IDLE_WAIT_MS         100
+
+namespace Suscan {
+  class TaskPool;
+
+  enum TaskPriority {
+    TASK_PRIORITY_INTERACTIVE,
+    TASK_PRIORITY_BACKGROUND
+  };
+
+  struct TaskPoolEntry {
+    CancellableTask *task = nullptr; // Null for plain jobs
+    std::function<bool (void)> job;
+    TaskPriority priority = TASK_PRIORITY_BACKGROUND;
+    qint64 sliceMs = SIGDIGGER_TASK_POOL_BACKGROUND_SLICE_MS;
+    bool cancelled = false; // cancel() was called
+
+    // Set (from the emitting thread) once the task reports done,
+    // cancelled or error. No further work() calls are made after that.
+    // Shared with the signal handlers, which may outlive the entry.
+    std::shared_ptr<QAtomicInteger<int>> finished;
+  };
+
+  class TaskPoolWorker : public QThread
+  {
+    TaskPool *pool;
+    int id;
+
+  public:
+    TaskPoolWorker(TaskPool *pool, int id);
+    void run(void) override;
+  };
+
+  //
+  // Runs CancellableTask::work() steps on a fixed set of threads. Every
+  // worker owns a queue per priority and takes tasks from its front; idle
+  // workers steal from the back of other queues. A task keeps its worker
+  // for at most its time slice (its CPU budget) before going back to the
+  // queue, so many tasks share the CPUs instead of each getting a thread.
+  // Interactive tasks are always picked before background ones, and
+  // background tasks never occupy every worker at once.
+  //
+  // Tasks keep the affinity of the thread that pushed them, so their
+  // deleteLater() runs there. Cancellation requests (requestCancel()) are
+  // served by the worker that runs the task, between two steps, so
+  // cancel() never runs concurrently with work().
+  //
+  class TaskPool
+  {
+    friend class TaskPoolWorker;
+
+    struct Queue {
+      QMutex mutex;
+      std::deque<TaskPoolEntry *> entries[2];
+    };
+
+    std::vector<TaskPoolWorker *> workers;
+    std::vector<Queue *> queues;
+
+    QMutex sleepMutex;
+    QWaitCondition wakeUp;
+    quint64 generation = 0; // Bumped on every queue change
+
+    QAtomicInteger<int> queued = 0;
+    QAtomicInteger<int> runningBackground = 0;
+    QAtomicInteger<quint32> nextQueue = 0;
+    QAtomicInteger<int> stopFlag = 0;
+
+    static TaskPool *sharedPool;
+
+    TaskPoolEntry *take(int id, int priority);
+    TaskPoolEntry *next(int id);
+    void enqueue(int id, TaskPoolEntry *entry);
+    void runEntry(int id, TaskPoolEntry *entry);
+    void retire(TaskPoolEntry *entry);
+    void notify(void);
+
+  public:
+    explicit TaskPool(int threads = 0);
+    ~TaskPool();
+
+    // Takes ownership of the task. sliceMs = 0 selects the default slice
+    // of the given priority.
+    void push(
+        CancellableTask *task,
+        TaskPriority priority = TASK_PRIORITY_BACKGROUND,
+        qint64 sliceMs = 0);
+
+    // Plain jobs are called over and over (in slices, like tasks) until
+    // they return false. They are not cancelled, nor reported: whoever
+    // submitted them keeps track of their work.
+    void submit(
+        std::function<bool (void)> job,
+        TaskPriority priority = TASK_PRIORITY_BACKGROUND,
+        qint64 sliceMs = 0);
+
+    int threadCount(void) const;
+
+    // The pool behind the background task controller, if any. This is
+    // the one that tasks share their work with.
+    static TaskPool *shared(void);
+    static void setShared(TaskPool *);
+  };
+
+  //
+  // Units of work of a single task, shared with the pool. The thread
+  // running the task takes units too (runOne()), so it never depends on
+  // the pool having room, and up to threadCount() - 1 workers join it.
+  // cancel() never waits. Owners call stop() before anything used by the
+  // units goes away: it returns once no unit is in progress, and no unit
+  // starts after it. A cancellation request made to the owning task
+  // (requestCancel()) counts as cancel(), so that long units see it
+  // before the task's next step.
+  //
+  class TaskSlices
+  {
+    struct State {
+      CancellableTask *owner = nullptr;
+      std::function<void (int)> body;
+      int count = 0;
+      QAtomicInteger<int> next = 0;
+      QAtomicInteger<int> completed = 0;
+      QAtomicInteger<int> active = 0;
+      QAtomicInteger<int> stopFlag = 0;
+      QMutex mutex;
+      QWaitCondition idle;
+
+      bool isCancelled(void) const;
+      bool runOne(void);
+    };
+
+    CancellableTask *owner = nullptr;
+
+    // Shared with the jobs, which may start after stop()
+    std::shared_ptr<State> state;
+
+    void launch(
+        int count,
+        std::function<void (int)> body,
+        TaskPriority priority,
+        int threads,
+        bool takesUnits);
+
+  public:
+    explicit TaskSlices(CancellableTask *owner = nullptr);
+    ~TaskSlices();
+
+    // Units are numbered from 0 to count - 1. Starting again discards
+    // the units of the previous run that were not taken yet. threads
+    // bounds the units in progress at once (caller included), 0 leaves
+    // it to the size of the pool.
+    void start(
+        int count,
+        std::function<void (int)> body,
+        TaskPriority priority = TASK_PRIORITY_INTERACTIVE,
+        int threads = 0);
+
+    // As start(), for owners that do not take units themselves (no task
+    // thread). Without a pool, all units are run before returning.
+    void submit(
+        int count,
+        std::function<void (int)> body,
+        TaskPriority priority = TASK_PRIORITY_BACKGROUND,
+        int threads = 0);
+
+    // Runs one unit in the calling thread. False if none was left.
+    bool runOne(void);
+
+    // Waits (at most ms) for the units in progress. True if all are done.
+    bool wait(unsigned long ms);
+
+    // One step of the owner's work(): runs one unit in the calling thread
+    // or, once all are taken, waits (at most pollMs) for the last ones,
+    // still in progress in the pool. True once all units are finished.
+    bool step(unsigned long pollMs);
+
+    bool isFinished(void) const;
+    int completed(void) const;
+
+    // For long units, to give up half way
+    bool isCancelled(void) const;
+
+    void cancel(void);
+    void stop(void);
+
+    // The owner's cancel(): units in progress give up on their own (see
+    // isCancelled()) and the destructor waits for them. Emits cancelled()
+    // on behalf of the owner.
+    void cancelOwner(void);
+  };
+}
+
+#endif // TASKPOOL_H
@@ -0,0 +1,67 @@
+//
+//    SymbolPacker.h: Bit-packed, framed symbol streams
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SYMBOLPACKER_H
+#define SYMBOLPACKER_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#define SIGDIGGER_SYMBOL_PACKER_SYNC        0x53594d50 // "SYMP"
+#define SIGDIGGER_SYMBOL_PACKER_MAX_SYMBOLS 4096
+
+namespace SigDigger {
+  //
+  // Frame header, in network byte order. The payload that follows holds
+  // `symbols` symbols of `bps` bits each, packed as in
+  // SampleKernels::packSymbols, (symbols * bps + 7) / 8 bytes.
+  //
+  // To resync, receivers look for the sync word followed by a header
+  // whose check byte is the XOR of its first 11 bytes. Gaps in the
+  // sequence number are lost frames.
+  //
+  struct PackedSymbolHeader {
+    uint32_t sync;
+    uint32_t sequence;
+    uint16_t symbols;
+    uint8_t  bps;
+    uint8_t  check;
+  };
+
+  class SymbolPacker
+  {
+    std::vector<uint8_t> frames;
+    uint32_t sequence = 0;
+
+    void appendFrame(const uint8_t *symbols, size_t size, unsigned int bps);
+
+  public:
+    // Numbers frames from 0 again
+    void reset(void);
+
+    // Frames for these symbols, valid until the next call. bps is
+    // clamped to 1..8.
+    std::vector<uint8_t> const &pack(
+        const uint8_t *symbols,
+        size_t size,
+        unsigned int bps);
+  };
+}
+
+#endif // SYMBOLPACKER_H
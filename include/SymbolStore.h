@@ -0,0 +1,116 @@
+//
+//    SymbolStore.h: Bit-packed symbol storage
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SYMBOLSTORE_H
+#define SYMBOLSTORE_H
+
+#include <Decider.h>
+#include <MemoryAccountant.h>
+#include <QtGlobal>
+#include <memory>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+#define SIGDIGGER_SYMBOL_STORE_PAGE_BYTES (1 << 20)
+#define SIGDIGGER_SYMBOL_STORE_MAX_PATTERN 64
+
+namespace SigDigger {
+  //
+  // Append-only symbol storage, packed at bps bits per symbol into
+  // fixed-size pages. Symbols form a single MSB-first bit stream across
+  // pages, so exporting it is a matter of writing the pages as they are.
+  //
+  // With a memory limit, the oldest pages past it are moved to an
+  // anonymous temporary file. They are still readable, only slower.
+  // Over the process memory budget, all complete pages may be spilled.
+  //
+  class SymbolStore {
+    std::vector<std::unique_ptr<quint8[]>> pages; // Null once spilled
+    unsigned int bps = 1;
+    size_t count = 0;
+    quint64 bytes = 0;   // Complete bytes in the stream
+
+    quint32 acc = 0;     // Bits of the last, incomplete byte
+    unsigned int accBits = 0;
+
+    // Spilled pages are always the first ones, in order
+    size_t maxResidentPages = 0; // 0: no limit
+    size_t spilledPages = 0;
+    bool spillFailed = false;
+    FILE *spill = nullptr;
+
+    // Last spilled page read back
+    mutable std::unique_ptr<quint8[]> readPage;
+    mutable size_t readPageIndex = SIZE_MAX;
+
+    MemoryAccount account;
+
+    void pushByte(quint8);
+    void spillPage(void);
+    size_t reclaim(size_t wanted);
+    const quint8 *pageData(size_t) const;
+    quint8 byteAt(quint64) const;
+
+  public:
+    SymbolStore();
+    SymbolStore(SymbolStore const &) = delete;
+    SymbolStore &operator=(SymbolStore const &) = delete;
+    ~SymbolStore();
+
+    // Bytes of pages kept in memory (0 keeps everything in memory)
+    void setMemoryLimit(quint64 bytes);
+
+    // Changing the number of bits per symbol clears the store
+    void setBitsPerSymbol(unsigned int bps);
+    void append(const Symbol *data, size_t size);
+    void clear(void);
+
+    size_t size(void) const;
+    quint64 getBitCount(void) const;
+    quint64 getMemoryUsage(void) const;
+    quint64 getSpilledBytes(void) const;
+
+    unsigned int
+    getBitsPerSymbol(void) const
+    {
+      return this->bps;
+    }
+
+    // Copies up to size symbols starting at offset. Returns the number of
+    // symbols actually copied.
+    size_t read(size_t offset, Symbol *dest, size_t size) const;
+
+    // Writes the packed bit stream. The last byte is padded with zeros.
+    bool writePacked(FILE *fp) const;
+
+    // Finds every symbol offset where the stream matches `length` bits
+    // of `pattern` (MSB first, at most 64) with up to maxErrors wrong
+    // bits. Bits cleared in `care` are wildcards. Returns false if the
+    // pattern is not valid. No more than maxHits (if nonzero) are found.
+    bool find(
+        quint64 pattern,
+        quint64 care,
+        unsigned int length,
+        unsigned int maxErrors,
+        std::vector<size_t> &hits,
+        size_t maxHits = 0) const;
+  };
+}
+
+#endif // SYMBOLSTORE_H
@@ -20,41 +20,105 @@
 #define TLEDOWNLOADERTASK_H
 
 #include <Suscan/CancellableTask.h>
+#include <Suscan/Library.h>
+#include <QList>
+#include <QMap>
 #include <curl/curl.h>
 
-#define TLE_DOWNLOADER_MAX_MEMORY_SIZE (1 << 24) // 16 MiB
+#define TLE_DOWNLOADER_MAX_MEMORY_SIZE (1 << 24) // 16 MiB, per source
+
+// ETags and modification dates of the last download of every source,
+// kept in the cache directory of the configuration
+#define TLE_DOWNLOADER_VALIDATOR_FILE "tle_validators.txt"
 
 namespace SigDigger {
+  // Downloads every TLE source at once, on a single curl multi handle.
+  // Sources are requested conditionally: those unchanged since the last
+  // download (HTTP 304) are skipped.
   class TLEDownloaderTask : public Suscan::CancellableTask {
     Q_OBJECT
 
+    struct Validator {
+      std::string etag;
+      std::string lastModified;
+    };
+
+    struct Transfer {
+      TLEDownloaderTask *owner = nullptr;
+      std::string name;
+      std::string url;
+      std::string data;
+      Validator sent;
+      Validator received;
+      CURL *curl = nullptr;
+      struct curl_slist *headers = nullptr;
+      double now = 0;
+      double total = 0;
+      bool done = false;
+    };
+
     CURLM *multi = nullptr;
-    CURL  *curl = nullptr;
-    FILE  *fp = nullptr;
     bool   ok = false;
-    std::string data;
+    int    running = 0;
+    QList<Transfer *> transfers;
+    QMap<std::string, Validator> validators; // By URL
+
+    unsigned int updated = 0;
+    unsigned int unchanged = 0;
+    unsigned int failed = 0;
 
     static size_t curl_save_data(
         void *ptr,
         size_t,
         size_t nmemb,
-        TLEDownloaderTask *self);
+        Transfer *transfer);
+
+    static size_t curl_save_header(
+        char *buffer,
+        size_t size,
+        size_t nitems,
+        Transfer *transfer);
 
     static int curl_progress(
-        void *self,
+        void *transfer,
         double dltotal,
         double dlnow,
         double ultotal,
         double ulnow);
 
+    static QString validatorPath(void);
+    void loadValidators(void);
+    void saveValidators(void);
+    bool addTransfer(Suscan::TLESource const &);
+    void finishTransfer(CURL *, CURLcode);
+    void updateProgress(void);
     void extractTLEs(void);
+
   public:
     TLEDownloaderTask(
-        QString url,
+        QList<Suscan::TLESource> const &sources,
         QObject *parent = nullptr);
 
     ~TLEDownloaderTask() override;
 
+    unsigned int
+    getUpdated(void) const
+    {
+      return this->updated;
+    }
+
+    unsigned int
+    getUnchanged(void) const
+    {
+      return this->unchanged;
+    }
+
+    unsigned int
+    getFailed(void) const
+    {
+      return this->failed;
+    }
+
     virtual bool work(void) override;
     virtual void cancel(void) override;
   };
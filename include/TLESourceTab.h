@@ -44,15 +44,14 @@ namespace SigDigger {
 
     // Background tasks
     Suscan::CancellableController *taskController;
-    unsigned srcCount;
-    unsigned srcNum = 0;
+    unsigned srcCount = 0;
+    unsigned srcUpdated = 0;
+    unsigned srcUnchanged = 0;
     unsigned srcFailed = 0;
-    QMap<std::string, Suscan::TLESource>::const_iterator currSrc;
-    QMap<std::string, Suscan::TLESource>::const_iterator endSrc;
 
     bool pushDownloadTask(void);
     void triggerDownloadTLEs(void);
-    void downloadNext(void);
+    void finishDownload(void);
     void refreshDownloadStatus(void);
     void populateTLESourceTable(void);
     void refreshUi(void);
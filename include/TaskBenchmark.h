@@ -0,0 +1,95 @@
+//
+//    TaskBenchmark.h: Microbenchmarks of the Tasks kernels
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef TASKBENCHMARK_H
+#define TASKBENCHMARK_H
+
+#include <QStringList>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <Decider.h>
+#include <BenchmarkHistory.h>
+#include <sigutils/types.h>
+#include <functional>
+#include <vector>
+
+#define SIGDIGGER_TASK_BENCHMARK_DEFAULT_SEED    0x5eed
+#define SIGDIGGER_TASK_BENCHMARK_DEFAULT_REPEAT  3
+#define SIGDIGGER_TASK_BENCHMARK_DEFAULT_RATE    48000
+
+// Bins of each hop of the sweep benchmark
+#define SIGDIGGER_TASK_BENCHMARK_SWEEP_PSD_SIZE  8192
+
+namespace Suscan {
+  class CancellableTask;
+}
+
+namespace SigDigger {
+  //
+  // Drives the work() loop of every task in Tasks/ to completion, in the
+  // calling thread, over the same fixed-seed signal (a noisy BPSK carrier)
+  // at several sizes. Reports the best wall and CPU time per sample out of
+  // a few runs, and the heap high-water mark of each run. Wall times are
+  // compared with (and recorded to) the benchmark history.
+  //
+  class TaskBenchmark
+  {
+    struct Kernel {
+      QString name;
+      std::function<Suscan::CancellableTask *(
+          const SUCOMPLEX *,
+          SUCOMPLEX *,
+          size_t)> make;
+    };
+
+    QStringList tasks;
+    std::vector<size_t> sizes = {1 << 12, 1 << 16, 1 << 20};
+    unsigned int seed   = SIGDIGGER_TASK_BENCHMARK_DEFAULT_SEED;
+    unsigned int repeat = SIGDIGGER_TASK_BENCHMARK_DEFAULT_REPEAT;
+    SUFLOAT fs = SIGDIGGER_TASK_BENCHMARK_DEFAULT_RATE;
+    QString output;
+
+    std::vector<SUCOMPLEX> input;
+    std::vector<SUCOMPLEX> destination;
+    Decider decider;
+    std::vector<Kernel> kernels;
+    QJsonArray results;
+    BenchmarkHistory history = BenchmarkHistory("tasks");
+
+    void makeInput(size_t size);
+    void makeKernels(void);
+    QJsonObject run(Kernel const &, size_t size);
+
+    static size_t heapInUse(void);
+
+  public:
+    bool parse(int argc, char **argv);
+    static void help(const char *argv0);
+
+    bool run(void);
+    bool writeReport(void) const;
+
+    bool
+    isRegressed(void) const
+    {
+      return this->history.isRegressed();
+    }
+  };
+}
+
+#endif // TASKBENCHMARK_H
@@ -0,0 +1,63 @@
+//
+//    ThreadConfig.h: Thread placement settings
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef THREADCONFIG_H
+#define THREADCONFIG_H
+
+#include <Suscan/Serializable.h>
+#include <string>
+#include <vector>
+
+namespace SigDigger {
+  enum ThreadRole {
+    THREAD_ROLE_ANALYZER, // Analyzer message loop
+    THREAD_ROLE_AUDIO,    // Audio playback and feeding
+    THREAD_ROLE_IO,       // Data savers and sample exporters
+    THREAD_ROLE_DSP,      // Inspector-side processing (TV, FAC, detector)
+    THREAD_ROLE_TASKS,    // Background tasks (and the pools they start)
+    THREAD_ROLE_COUNT
+  };
+
+  struct ThreadRolePolicy {
+    std::string cpus;  // e.g. "0-3,6". Empty: wherever the OS wants
+    int priority = 0;  // SCHED_FIFO priority. 0: default scheduling
+
+    bool isDefault(void) const;
+  };
+
+  class ThreadConfig : public Suscan::Serializable
+  {
+  public:
+    ThreadRolePolicy roles[THREAD_ROLE_COUNT];
+
+    ThreadConfig();
+    ThreadConfig(Suscan::Object const &conf);
+
+    static const char *roleName(ThreadRole);
+
+    // Accepts comma-separated CPU numbers and ranges
+    static bool parseCpus(std::string const &, std::vector<int> &);
+
+    // Overriden methods
+    void loadDefaults(void);
+    void deserialize(Suscan::Object const &conf) override;
+    Suscan::Object &&serialize(void) override;
+  };
+}
+
+#endif // THREADCONFIG_H
@@ -0,0 +1,61 @@
+//
+//    ThreadConfigTab.h: Thread placement settings tab
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef THREADCONFIGTAB_H
+#define THREADCONFIGTAB_H
+
+#include <ConfigTab.h>
+#include <ThreadConfig.h>
+
+class QLineEdit;
+class QSpinBox;
+
+namespace Ui {
+  class ThreadConfigTab;
+}
+
+namespace SigDigger {
+  class ThreadConfigTab : public ConfigTab
+  {
+    Q_OBJECT
+
+    ThreadConfig threadConfig;
+    QLineEdit *cpusEdits[THREAD_ROLE_COUNT];
+    QSpinBox *prioritySpins[THREAD_ROLE_COUNT];
+    bool modified = false;
+    void refreshUi();
+    void connectAll(void);
+
+  public:
+    void save(void) override;
+    bool hasChanged(void) const override;
+    void setThreadConfig(const ThreadConfig &config);
+    ThreadConfig getThreadConfig() const;
+
+    explicit ThreadConfigTab(QWidget *parent = nullptr);
+    ~ThreadConfigTab() override;
+
+  public slots:
+    void onConfigChanged(void);
+
+  private:
+    Ui::ThreadConfigTab *ui;
+  };
+}
+
+#endif // THREADCONFIGTAB_H
@@ -0,0 +1,74 @@
+//
+//    ThreadPolicy.h: Per-role thread placement
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef THREADPOLICY_H
+#define THREADPOLICY_H
+
+#include <ThreadConfig.h>
+#include <QMutex>
+#include <QHash>
+
+#ifdef __linux__
+#  include <sched.h>
+#endif // __linux__
+
+class QThread;
+
+namespace SigDigger {
+  //
+  // Registry of the long-lived worker threads, by role. Each role may be
+  // pinned to a set of CPUs and run with SCHED_FIFO at a given priority.
+  // Threads register themselves as soon as they start, before they
+  // allocate or touch their buffers: under Linux' first-touch policy,
+  // this is also what keeps their memory on the NUMA node of their CPUs.
+  // Changes to the configuration apply to running threads too.
+  //
+  class ThreadPolicy
+  {
+    ThreadConfig config;
+    QMutex mutex;
+    QHash<Qt::HANDLE, ThreadRole> threads;
+    bool warned = false;
+
+#ifdef __linux__
+    cpu_set_t processMask;
+#endif // __linux__
+
+    static ThreadPolicy *currInstance;
+
+    ThreadPolicy();
+
+    void applyTo(Qt::HANDLE, ThreadRolePolicy const &);
+    void warn(const char *what, int error);
+
+  public:
+    static ThreadPolicy *instance(void);
+
+    void setConfig(ThreadConfig const &);
+    ThreadConfig getConfig(void);
+
+    // The calling thread joins or leaves the given role
+    void enter(ThreadRole);
+    void leave(void);
+
+    // Make a QThread enter the role when started, and leave it when done
+    static void bind(QThread *, ThreadRole);
+  };
+}
+
+#endif // THREADPOLICY_H
@@ -20,6 +20,7 @@
 #define TIMEWINDOW_H
 
 #include <QMainWindow>
+#include <memory>
 
 #include "SamplingProperties.h"
 #include <Suscan/CancellableTask.h>
@@ -30,27 +31,46 @@
 #include "DopplerDialog.h"
 
 #include "WaveSampler.h"
+#include "TransformChainTask.h"
+#include "TransformHistory.h"
+#include "BaudEstimatorTask.h"
 
 #define TIME_WINDOW_MAX_SELECTION     4096
 #define TIME_WINDOW_MAX_DOPPLER_ITERS 200
 #define TIME_WINDOW_SPEED_OF_LIGHT    3e8
 #define TIME_WINDOW_EXTRA_WIDTH       72
 
+// Longest range of a capture file loaded at once (1 GiB)
+#define TIME_WINDOW_MAX_LOAD_SAMPLES  (1 << 27)
+
+// Spectrograms kept for the displayed buffer
+#define TIME_WINDOW_SPECTROGRAM_CACHE 8
+
 namespace Ui {
   class TimeWindow;
 }
 
 namespace SigDigger {
+  class CaptureFile;
+  class SampleStatistics;
+  class SpectrogramDialog;
+  struct SpectrogramResult;
+  class CyclicSpectrumDialog;
+  struct CyclicSpectrumResult;
+
   class TimeWindow : public QMainWindow
   {
     Q_OBJECT
 
-    // Ui members
+    // Ui members. The histogram dialog is created when first needed.
     HistogramDialog *histogramDialog = nullptr;
     SamplerDialog *samplerDialog = nullptr;
     DopplerDialog *dopplerDialog = nullptr;
+    SpectrogramDialog *spectrogramDialog = nullptr;
+    CyclicSpectrumDialog *cyclicDialog = nullptr;
 
     Ui::TimeWindow *ui = nullptr;
+    ColorConfig colorConfig;
 
     bool hadSelectionBefore = true; // Yep. This must be true.
     bool adjusting = false;
@@ -59,10 +79,15 @@ namespace SigDigger {
     qreal     fs = 0;
     qreal     bw = 0;
 
-    std::vector<SUCOMPLEX> const *data;
-    std::vector<SUCOMPLEX> processedData;
+    // Sample buffers are shared with the export tasks reading from them.
+    // The processed buffer is copied before it is modified if any export
+    // still holds it.
+    std::shared_ptr<const std::vector<SUCOMPLEX>> data;
+    std::shared_ptr<std::vector<SUCOMPLEX>> processedData;
 
-    std::vector<SUCOMPLEX> const *displayData = &processedData;
+    std::shared_ptr<const std::vector<SUCOMPLEX>> displayData;
+    bool displayPending = false;  // displayData not handed to the waveforms
+    bool displayKeepView = false;
 
     SUFREQ    centerFreq;
 
@@ -70,11 +95,58 @@ namespace SigDigger {
 
     Suscan::CancellableController taskController;
 
+    // Transforms recorded while chaining is enabled
+    std::vector<TransformStep> chain;
+
+    // Undo history. pendingRecord describes the transform being run
+    TransformHistory history;
+    TransformRecord pendingRecord;
+    bool recordPending = false;
+    size_t replayTarget = 0;
+
+    // Capture file being loaded, if any
+    std::shared_ptr<CaptureFile> captureFile;
+    qreal captureRate = 0;
+
+    // Offset of the channel being extracted, the new center frequency
+    SUFREQ extractFreq = 0;
+
+    // Range statistics of the displayed buffer, built in the task pool.
+    // They point into displayData: cancelStatistics() before touching it.
+    std::shared_ptr<SampleStatistics> stats;
+
+    void buildStatistics(void);
+    void cancelStatistics(void);
+
+    // Spectrograms of the displayed buffer, most recent last. Any change
+    // of the buffer invalidates them.
+    std::vector<std::shared_ptr<SpectrogramResult>> spectrograms;
+    std::shared_ptr<SpectrogramResult> pendingSpectrogram;
+    qint64 spectrogramStart = 0;
+    size_t spectrogramLength = 0;
+
+    // Last cyclic spectrum of the displayed buffer, and the one in progress
+    std::shared_ptr<CyclicSpectrumResult> cyclicSpectrum;
+    std::shared_ptr<CyclicSpectrumResult> pendingCyclicSpectrum;
+    qint64 cyclicStart = 0;
+    size_t cyclicLength = 0;
+
+    // Symbol rate estimates of the current selection, run in the
+    // background on each new selection. Selections made while one is
+    // being estimated cancel it and are estimated next.
+    Suscan::CancellableController baudController;
+    std::vector<BaudCandidate> baudCandidates;
+    bool baudPending = false;
+
+    void estimateBaud(void);
+    void refreshBaudEstimate(void);
+
     int getPeriodicDivision(void) const;
 
     void connectFineTuneSelWidgets(void);
     void connectTransformWidgets(void);
     void connectAll(void);
+    HistogramDialog *getHistogramDialog(void);
 
     void refreshMeasures(void);
     void refreshUi(void);
@@ -97,14 +169,29 @@ namespace SigDigger {
         SUSCOUNT &length,
         bool selection);
 
+    bool chainStep(TransformStep const &step);
+    void refreshChainLabel(void);
+
+    void recordTransform(
+        std::vector<TransformStep> const &steps,
+        const SUCOMPLEX *destination,
+        SUSCOUNT length);
+    void commitTransform(void);
+    void historySeek(size_t pos);
+    void historyAbort(void);
+    void refreshHistoryUi(void);
+
     void populateSamplingProperties(SamplingProperties &prop);
     void startSampling(void);
 
     void setDisplayData(
-        std::vector<SUCOMPLEX> const *displayData,
+        std::shared_ptr<const std::vector<SUCOMPLEX>> const &displayData,
         bool keepView = false);
+    void refreshProcessedData(void);
+    void detachProcessedData(bool preserve);
     const SUCOMPLEX *getDisplayData(void) const;
     size_t getDisplayDataLength(void) const;
+    size_t getCarrierSegmentSize(size_t length) const;
 
     static void adjustButtonToSize(
             QPushButton *button,
@@ -116,7 +203,7 @@ namespace SigDigger {
 
     void setCenterFreq(SUFREQ center);
     void setData(
-        std::vector<SUCOMPLEX> const &data,
+        std::shared_ptr<const std::vector<SUCOMPLEX>> const &data,
         qreal fs,
         qreal bw);
     void setPalette(std::string const &);
@@ -147,6 +234,10 @@ namespace SigDigger {
     void onTogglePeriodicSelection(void);
     void onPeriodicDivisionsChanged(void);
 
+    void onOpenCapture(void);
+    void onStatisticsReady(void);
+    void onShowSpectrogram(void);
+    void onComputeSpectrogram(void);
     void onSaveAll(void);
     void onSaveSelection(void);
     void onFit(void);
@@ -168,6 +259,9 @@ namespace SigDigger {
     void onTaskDone(void);
     void onTaskCancelled(void);
     void onTaskError(QString);
+    void onBaudEstimatorDone(void);
+    void onBaudEstimatorIdle(void);
+    void onUseBaudEstimate(void);
 
     void onGuessCarrier(void);
     void onSyncCarrier(void);
@@ -175,11 +269,11 @@ namespace SigDigger {
 
     void onTriggerHistogram(void);
     void onHistogramBlanked(void);
-    void onHistogramSamples(const float *data, unsigned int len);
+    void onHistogramBins(SigDigger::HistogramBins const &);
 
     void onTriggerSampler(void);
     void onResample(void);
-    void onSampleSet(SigDigger::WaveSampleSet);
+    void onSampleSet(SigDigger::WaveSampleSet const &);
 
     void onCarrierSlidersChanged(void);
 
@@ -189,11 +283,20 @@ namespace SigDigger {
 
     void onCostasRecovery(void);
     void onPLLRecovery(void);
+    void onCostasSweep(void);
+    void onPLLSweep(void);
     void onCycloAnalysis(void);
+    void onComputeCyclicSpectrum(void);
     void onQuadDemod(void);
     void onAGC(void);
     void onLPF(void);
+    void onExtractChannel(void);
     void onDelayedConjugate(void);
+    void onChainRun(void);
+    void onChainClear(void);
+    void onChainBatch(void);
+    void onUndo(void);
+    void onRedo(void);
 
     void onAGCRateChanged(void);
     void onDelayedConjChanged(void);
@@ -44,6 +44,37 @@ namespace SigDigger {
     ToolWidgetFactory(Suscan::Plugin *);
 
     virtual std::string getTitle() const = 0; // Returns the title in the side panel
+
+    // Whether the widget may be created only when its panel is first
+    // expanded. Only for widgets that do nothing while collapsed, and
+    // whose config keeps the `collapsed' property.
+    virtual bool deferrable(void) const;
+  };
+
+  // Stands in the side panel for a collapsed, deferrable tool widget, and
+  // creates it the first time it is shown.
+  class DeferredToolWidget : public QWidget {
+    Q_OBJECT
+
+    ToolWidgetFactory *m_factory;
+    UIMediator *m_mediator;
+    ToolWidget *m_widget = nullptr;
+
+  protected:
+    bool event(QEvent *) override;
+    void showEvent(QShowEvent *) override;
+
+  public:
+    DeferredToolWidget(
+        ToolWidgetFactory *,
+        UIMediator *,
+        QWidget *parent = nullptr);
+
+    ToolWidgetFactory *factory(void) const;
+    ToolWidget *widget(void) const;
+
+    // Creates the widget now, if it was not already
+    ToolWidget *instantiate(void);
   };
 }
 
@@ -0,0 +1,121 @@
+//
+//    Tracer.h: Low overhead scoped tracing of hot paths
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+// Events kept per thread. Older ones are overwritten.
+#define SIGDIGGER_TRACER_RING_SIZE 65536
+
+// Set this environment variable to start with tracing enabled
+#define SIGDIGGER_TRACER_ENV       "SIGDIGGER_TRACE"
+
+//
+// Usage: SIGDIGGER_TRACE_SCOPE("Class::method") at the top of the scope.
+// The name must be a string literal (only the pointer is stored). When
+// tracing is off, each scope costs a relaxed atomic load.
+//
+#define SIGDIGGER_TRACE_CONCAT_(a, b) a ## b
+#define SIGDIGGER_TRACE_CONCAT(a, b) SIGDIGGER_TRACE_CONCAT_(a, b)
+#define SIGDIGGER_TRACE_SCOPE(name)                      \
+  SigDigger::TraceScope SIGDIGGER_TRACE_CONCAT(          \
+    _traceScope, __LINE__)(name)
+
+namespace SigDigger {
+  struct TraceEvent {
+    const char *name;
+    int64_t     startNs;
+    int64_t     durationNs;
+  };
+
+  // Single producer (its thread), read by Tracer::snapshot()
+  struct TraceRing {
+    std::vector<TraceEvent> events;
+    std::atomic<uint64_t>   head;
+    uint32_t                tid;
+    QString                 threadName;
+
+    TraceRing(uint32_t tid);
+  };
+
+  class Tracer {
+    static std::atomic<bool> enabled;
+
+    std::mutex          ringMutex;
+    QVector<TraceRing *> rings; // Never freed: threads may still hold them
+    uint32_t            lastTid = 0;
+
+    Tracer();
+
+    TraceRing *makeRing(void);
+
+  public:
+    static Tracer *instance(void);
+
+    static inline bool
+    isEnabled(void)
+    {
+      return enabled.load(std::memory_order_relaxed);
+    }
+
+    static int64_t now(void);
+
+    void setEnabled(bool);
+    void record(const char *name, int64_t startNs, int64_t durationNs);
+
+    // Chrome trace event format, also understood by Perfetto
+    QByteArray exportChromeTrace(void);
+    bool saveChromeTrace(QString const &path, QString &error);
+    void clear(void);
+  };
+
+  class TraceScope {
+    const char *name;
+    int64_t     start;
+
+  public:
+    inline
+    TraceScope(const char *name)
+    {
+      this->name  = Tracer::isEnabled() ? name : nullptr;
+      this->start = this->name != nullptr ? Tracer::now() : 0;
+    }
+
+    inline
+    ~TraceScope()
+    {
+      if (this->name != nullptr)
+        Tracer::instance()->record(
+              this->name,
+              this->start,
+              Tracer::now() - this->start);
+    }
+
+    TraceScope(TraceScope const &) = delete;
+    TraceScope &operator=(TraceScope const &) = delete;
+  };
+}
+
+#endif // TRACER_H
@@ -0,0 +1,106 @@
+//
+//    TransformChainTask.h: Fused streaming chain of TimeWindow transforms
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef TRANSFORMCHAINTASK_H
+#define TRANSFORMCHAINTASK_H
+
+#include <Suscan/CancellableTask.h>
+#include <sigutils/types.h>
+#include <sigutils/pll.h>
+#include <QString>
+#include <vector>
+
+// Samples per pass through the chain. Small enough for every stage's
+// buffers to stay in cache.
+#define SIGDIGGER_TRANSFORM_CHAIN_BLOCK_LENGTH 16384
+
+class TransformStage;
+
+struct TransformStep {
+  enum Kind {
+    AGC,
+    LPF,
+    COSTAS,
+    PLL,
+    QUAD_DEMOD,
+    DELAYED_CONJ,
+    XLATE
+  };
+
+  Kind kind = AGC;
+  SUFLOAT tau = 0;
+  SUFLOAT bw = 0;
+  SUSCOUNT delay = 0;
+  SUFLOAT freq = 0;  // Normalized, XLATE only
+  SUFLOAT phase = 0; // Radians, XLATE only
+  enum sigutils_costas_kind costasKind = SU_COSTAS_KIND_BPSK;
+
+  QString describe(void) const;
+};
+
+//
+// What a transform did to the capture: the steps it ran and the region of
+// the processed buffer they were applied to (in place).
+//
+struct TransformRecord {
+  std::vector<TransformStep> steps;
+  SUSCOUNT offset = 0;
+  SUSCOUNT length = 0;
+
+  QString describe(void) const;
+};
+
+//
+// Runs a list of transforms in a single pass. Every block of input goes
+// through all stages before the next one is read, so only the final
+// output is written to destination (which may be the origin buffer).
+//
+class TransformChainTask : public Suscan::CancellableTask
+{
+  Q_OBJECT
+
+  const SUCOMPLEX *origin = nullptr;
+  SUCOMPLEX       *destination = nullptr;
+
+  size_t length;
+  size_t p = 0; // Read pointer
+  size_t q = 0; // Write pointer
+
+  std::vector<TransformStage *> stages;
+  std::vector<std::vector<SUCOMPLEX>> buffers;
+  std::vector<size_t> consumed;
+  std::vector<size_t> produced;
+
+  void runStages(size_t first, const SUCOMPLEX *data, size_t size);
+  void flush(void);
+
+public:
+  explicit TransformChainTask(
+      const SUCOMPLEX *data,
+      SUCOMPLEX *destination,
+      size_t length,
+      std::vector<TransformStep> const &steps,
+      QObject *parent = nullptr);
+
+  virtual ~TransformChainTask() override;
+
+  virtual bool work(void) override;
+  virtual void cancel(void) override;
+};
+
+#endif // TRANSFORMCHAINTASK_H
@@ -0,0 +1,88 @@
+//
+//    include/TransformHistory.h: Recipe-based undo history of TimeWindow transforms
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef TRANSFORMHISTORY_H
+#define TRANSFORMHISTORY_H
+
+#include <QtGlobal>
+#include <QString>
+#include <TransformChainTask.h>
+#include <MemoryAccountant.h>
+#include <vector>
+
+#define SIGDIGGER_TRANSFORM_HISTORY_DEFAULT_RAM (512ull << 20)
+
+namespace SigDigger {
+  //
+  // Keeps the list of transforms applied to a capture as recipes, so any
+  // earlier state can be rebuilt by replaying them on the original data.
+  // Intermediate results are kept as checkpoints while they fit in the
+  // RAM budget; when it runs out (or the process goes over its memory
+  // budget), the checkpoints farthest from the current position are
+  // dropped first.
+  //
+  // Positions count applied transforms: 0 is the original capture and
+  // count() is the state after the last transform.
+  //
+  class TransformHistory {
+    struct Entry {
+      TransformRecord record;
+      std::vector<SUCOMPLEX> checkpoint;
+    };
+
+    std::vector<Entry> entries;
+    size_t  cursor = 0;
+    quint64 ramBytes = 0;
+    quint64 ramCapacity = SIGDIGGER_TRANSFORM_HISTORY_DEFAULT_RAM;
+    MemoryAccount account;
+
+    static quint64 bytes(std::vector<SUCOMPLEX> const &);
+    void dropCheckpoint(size_t index);
+    size_t farthestCheckpoint(size_t keep) const;
+    bool makeRoom(quint64 size, size_t keep);
+    size_t reclaim(size_t wanted);
+
+  public:
+    TransformHistory();
+    void setCapacity(quint64 ram);
+    void clear(void);
+
+    // Appends a transform at the current position, discarding anything
+    // that could have been redone. result is the state it produced.
+    void push(TransformRecord const &record, std::vector<SUCOMPLEX> const &result);
+
+    // Saves the state at pos as a checkpoint, if the budget allows it.
+    void checkpoint(size_t pos, std::vector<SUCOMPLEX> const &state);
+
+    // Finds the closest saved state at or before pos. Returns nullptr
+    // (and base = 0) if the only option is the original capture.
+    const std::vector<SUCOMPLEX> *nearest(size_t pos, size_t &base) const;
+
+    // Transforms needed to go from state `from` to state `to`
+    std::vector<TransformRecord> records(size_t from, size_t to) const;
+
+    void seek(size_t pos);
+    size_t position(void) const;
+    size_t count(void) const;
+    bool canUndo(void) const;
+    bool canRedo(void) const;
+    QString describe(size_t pos) const;
+  };
+}
+
+#endif // TRANSFORMHISTORY_H
@@ -0,0 +1,55 @@
+//
+//    TransformReplayTask.h: Re-apply recorded transforms in place
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef TRANSFORMREPLAYTASK_H
+#define TRANSFORMREPLAYTASK_H
+
+#include <Suscan/CancellableTask.h>
+#include <TransformChainTask.h>
+#include <vector>
+
+//
+// Applies a list of recorded transforms, in order, on the buffer they
+// were originally applied to. Used to rebuild states that are no longer
+// kept in memory.
+//
+class TransformReplayTask : public Suscan::CancellableTask
+{
+  Q_OBJECT
+
+  SUCOMPLEX *buffer = nullptr;
+  size_t length;
+
+  std::vector<TransformRecord> records;
+  size_t current = 0;
+  TransformChainTask *task = nullptr;
+
+public:
+  explicit TransformReplayTask(
+      SUCOMPLEX *buffer,
+      size_t length,
+      std::vector<TransformRecord> const &records,
+      QObject *parent = nullptr);
+
+  virtual ~TransformReplayTask() override;
+
+  virtual bool work(void) override;
+  virtual void cancel(void) override;
+};
+
+#endif // TRANSFORMREPLAYTASK_H
@@ -46,6 +46,12 @@ namespace SigDigger {
     virtual void setQth(Suscan::Location const &);
     virtual void setTimeStamp(struct timeval const &);
 
+    // changes: mask of Suscan::AnalyzerSourceInfoFields. Not called when
+    // nothing changed.
+    virtual void setSourceInfo(
+        Suscan::AnalyzerSourceInfo const &,
+        unsigned int changes);
+
     virtual ~UIComponent() override;
   };
 
@@ -29,21 +29,41 @@
 #include <WFHelpers.h>
 #include <PersistentWidget.h>
 #include <Averager.h>
+#include <OccupancyAccumulator.h>
 #include <QMessageBox>
+#include <QTimer>
+#include <QPointer>
+#include <SessionSnapshot.h>
+#include <QVector>
 
 #define SIGDIGGER_UI_MEDIATOR_DEFAULT_MIN_FREQ  0
 #define SIGDIGGER_UI_MEDIATOR_DEFAULT_MAX_FREQ  6000000000
 #define SIGDIGGER_UI_MEDIATOR_PSD_CAL_LEN       10
 #define SIGDIGGER_UI_MEDIATOR_PSD_MAX_LAG       .3
 #define SIGDIGGER_UI_MEDIATOR_PSD_LAG_THRESHOLD 5e-3
+#define SIGDIGGER_UI_MEDIATOR_GOVERNOR_DEGRADE_SECS  2
+#define SIGDIGGER_UI_MEDIATOR_GOVERNOR_RESTORE_SECS  10
+#define SIGDIGGER_UI_MEDIATOR_GOVERNOR_MIN_RATE      5
+#define SIGDIGGER_UI_MEDIATOR_GOVERNOR_MIN_FFT_SIZE  1024
+#define SIGDIGGER_UI_MEDIATOR_REMOTE_MIN_FFT_SIZE    512
 #define SIGDIGGER_UI_MEDIATOR_LOCAL_GRACE_PERIOD_MS  -1
 #define SIGDIGGER_UI_MEDIATOR_REMOTE_GRACE_PERIOD_MS 1000
+#define SIGDIGGER_UI_MEDIATOR_SEEK_DEBOUNCE_MS       150
+#define SIGDIGGER_UI_MEDIATOR_MAX_SUSPENDED_INSPECTORS 8
 
 namespace SigDigger {
   class UIComponent;
   class TabWidget;
   class InspectionWidget;
   class UIListener;
+  class ToolWidget;
+  class DeferredToolWidget;
+  class ConfigDialog;
+  class DeviceDialog;
+  class QuickConnectDialog;
+  class BackgroundTasksDialog;
+  class AddBookmarkDialog;
+  class BookmarkManagerDialog;
 
   class UIMediator : public PersistentWidget {
     Q_OBJECT
@@ -74,6 +94,7 @@ namespace SigDigger {
 
     // UI Data
     Averager averager;
+    OccupancyAccumulator occupancy;
     unsigned int rate = 0;
     unsigned int recentCount = 0;
 
@@ -87,21 +108,54 @@ namespace SigDigger {
     unsigned int rtCalibrations = 0;
     qreal rtDeltaReal = 0;
 
+    // PSD rate governor: number of degradation steps currently applied on
+    // top of the user's spectrum settings, and how long we have been
+    // lagging (or not) in PSD frames.
+    unsigned int governorSteps = 0;
+    unsigned int governorLagging = 0;
+    unsigned int governorHealthy = 0;
+    qreal        governorInterval = 0;
+    qreal        governorBaseInterval = 0;
+    unsigned int governorBaseSize = 0;
+
+    // Spectrum settings last sent to the analyzer, after the governor and
+    // the remote size limit. Analyzers report these back.
+    unsigned int requestedSize = 0;
+    qreal        requestedInterval = 0;
+
     // Private methods
     void connectMainWindow();
     void connectTimeSlider();
     void connectSpectrum();
-    void connectDeviceDialog();
     void connectPanoramicDialog();
     void connectAnalyzer();
+    void applyMessageBatching();
     void connectRequestTracker();
 
+    // Dialogs made on first use
+    ConfigDialog *configDialog();
+    DeviceDialog *deviceDialog();
+    QuickConnectDialog *quickConnectDialog();
+    BackgroundTasksDialog *backgroundTasksDialog();
+    AddBookmarkDialog *addBookmarkDialog();
+    BookmarkManagerDialog *bookmarkManagerDialog();
+
     // Behavioral methods
     void setSampleRate(unsigned int rate);
     void setBandwidth(unsigned int bandwidth);
     void refreshProfile(bool updateFreqs = true);
     void setCurrentAutoGain();
 
+    // PSD rate governor
+    bool governedParams(unsigned int steps, Suscan::AnalyzerParams &) const;
+    void adjustRemoteParams(Suscan::AnalyzerParams &) const;
+    Suscan::AnalyzerParams effectiveParams() const;
+    void setRequestedParams(Suscan::AnalyzerParams const &);
+    void refreshRequestedParams();
+    void applyGovernorSteps(unsigned int steps);
+    void resetGovernor();
+    void governPSD(bool lagging);
+
     // Other setters
     void setSourceTimeStart(struct timeval const &);
     void setSourceTimeEnd(struct timeval const &);
@@ -110,24 +164,83 @@ namespace SigDigger {
     State                              m_state = HALTED;
     Suscan::Analyzer                  *m_analyzer = nullptr;
     QList<UIComponent *>               m_components;
+    QList<DeferredToolWidget *>        m_deferredToolWidgets;
     QList<TabWidget *>                 m_tabWidgets;
     QMap<TabWidget *, QDialog *>       m_floatingTabs;
     struct timeval                     m_lastTimeStamp;
     Suscan::Object                     m_hollowConfig;
 
+    // State changes are coalesced and dispatched once per UI frame
+    bool                               m_pendingProfile = false;
+    bool                               m_pendingTimeStamp = false;
+    unsigned int                       m_pendingSourceInfo = 0;
+
+    // Last source info of the current analyzer, diffed against new ones
+    Suscan::AnalyzerSourceInfo         m_sourceInfo;
+    bool                               m_haveSourceInfo = false;
+
+    // Last source info of every remote server (host:port) seen in this
+    // session, applied as soon as we connect to it again, and addresses
+    // the quick connect dialog resolved for the next connection
+    std::map<std::string, Suscan::AnalyzerSourceInfo> m_remoteInfoCache;
+    std::map<std::string, std::string> m_resolvedHosts;
+    struct timeval                     m_pendingSeekTimeStamp;
+
+    // Seeks requested while dragging the time slider are debounced: only
+    // the last position is sent to the analyzer
+    QTimer                             m_seekTimer;
+
+    // Background indexer of the capture file behind the time slider
+    QPointer<Suscan::CancellableTask>  m_overviewTask;
+    QString                            m_overviewPath;
+
     Suscan::AnalyzerRequestTracker    *m_requestTracker = nullptr;
     QList<InspectionWidget *>          m_inspectors;
     QMap<uint32_t, InspectionWidget *> m_inspTable;
 
+    // Closed inspector tabs kept alive, oldest first
+    QList<InspectionWidget *>          m_suspendedInspectors;
+
+    // Inspectors of an analyzer being restarted (or reconnected), and
+    // their old tabs. They are reopened as session inspectors, so they
+    // get their previous configuration back.
+    QList<SessionInspector>            m_reopenRequests;
+    QList<QPointer<InspectionWidget>>  m_restartedInspectors;
+
+    // Inspectors of a session being restored: those waiting for an
+    // analyzer, and those requested whose state is yet to be applied
+    QList<SessionInspector>            m_sessionInspectors;
+    QList<SessionInspector>            m_sessionRestores;
+    uint32_t                           m_sessionBatch = 0;
+    bool                               m_sessionFocused = false;
+
     // Refactored methods
     void initSidePanel();
     void initUIListeners();
+    std::string remoteKey() const;
+    void applyCachedSourceInfo();
     void registerUIComponent(UIComponent *);
     void unregisterUIComponent(UIComponent *);
     void configureUIComponent(UIComponent *);
+    void resolveDeferredToolWidgets();
+    void scheduleUpdates();
+    void flushUpdates();
+    void refreshOverview();
 
     // Other private methods
     void detachAllInspectors();
+    void saveInspectorsForRestart();
+    void reopenInspectors();
+    void openSessionInspectors();
+    bool restoreSessionInspector(InspectionWidget *);
+    bool makeSessionInspector(InspectionWidget *, SessionInspector &) const;
+    void routeInspectorSamples(InspectionWidget *);
+    InspectionWidget *findSuspendedInspector(
+        const char *factoryName,
+        const char *inspClass,
+        Suscan::Channel const &channel,
+        Suscan::Handle parent) const;
+    void resumeInspectionWidget(InspectionWidget *);
 
     friend class UIComponent;
 
@@ -136,12 +249,16 @@ namespace SigDigger {
     QMainWindow  *getMainWindow() const;
     MainSpectrum *getMainSpectrum() const;
     Averager     *getSpectrumAverager();
+    OccupancyAccumulator *getOccupancyAccumulator();
     AppConfig    *getAppConfig() const;
-    bool          addTabWidget(TabWidget *);
+    bool          addTabWidget(TabWidget *, bool focus = true);
     bool          addUIListener(UIListener *);
+    void          adoptToolWidget(ToolWidget *);
     bool          closeTabWidget(TabWidget *);
     bool          floatTabWidget(TabWidget *);
     void          detachInspectionWidget(InspectionWidget *);
+    bool          suspendInspectionWidget(InspectionWidget *);
+    QList<InspectionWidget *> inspectionWidgets() const; // Open tabs only
 
     // Shortcut methods
     SUFREQ        getCurrentCenterFreq() const;
@@ -151,15 +268,26 @@ namespace SigDigger {
         const char *factoryName,
         const char *inspClass,
         Suscan::Channel,
-        bool precise = true,
+        Suscan::ChannelPrecision = Suscan::CHANNEL_PRECISION_AUTO,
         Suscan::Handle = -1);
 
+    // Session snapshots of the whole workspace
+    bool          saveSession(QString const &path, QString &error);
+    bool          loadSession(QString const &path, QString &error);
+
+    // Ask the component in charge of baseband recordings to start or stop
+    void          requestRecord(bool);
+
     void setState(enum State, Suscan::Analyzer *analyzer = nullptr);
 
     // UI State
     void refreshUI();
     State getState() const;
     void notifySourceInfo(Suscan::AnalyzerSourceInfo const &);
+
+    // Address the quick connect dialog resolved for a remote host, if any.
+    // It is only handed out once.
+    std::string takeResolvedHost(std::string const &host);
     void notifyTimeStamp(struct timeval const &timestamp);
 
     // Recent list handling
@@ -176,8 +304,10 @@ namespace SigDigger {
     void feedPanSpectrum(
         quint64 freqStart,
         quint64 freqEnd,
-        float *data,
-        size_t size);
+        const float *data,
+        size_t size,
+        size_t dirtyStart,
+        size_t dirtyEnd);
     void refreshDevicesDone();
 
     QMessageBox::StandardButton shouldReduceRate(
@@ -190,24 +320,31 @@ namespace SigDigger {
     // Convenience getters
     Suscan::Source::Config *getProfile() const;
     Suscan::AnalyzerParams *getAnalyzerParams() const;
+    Suscan::AnalyzerParams requestAnalyzerParams();
 
     // panSpectrum functions
     bool         getPanSpectrumDevice(Suscan::Source::Device &) const;
+    std::vector<Suscan::Source::Device> getPanSpectrumExtraDevices() const;
     bool         getPanSpectrumRange(qint64 &min, qint64 &max) const;
     unsigned int getPanSpectrumRttMs() const;
+    unsigned int getPanSpectrumSettleMs(Suscan::Source::Device const &) const;
     float        getPanSpectrumRelBw() const;
+    unsigned int getPanSpectrumResolution() const;
     float        getPanSpectrumGain(QString const &) const;
     SUFREQ       getPanSpectrumLnbOffset() const;
     float        getPanSpectrumPreferredSampleRate() const;
     QString      getPanSpectrumStrategy() const;
     QString      getPanSpectrumPartition() const;
+    QString      getPanSpectrumRelayMode() const;
+    QString      getPanSpectrumRelayHost() const;
+    quint16      getPanSpectrumRelayPort() const;
     void         setPanSpectrumRunning(bool state);
 
     // Mediated setters
     void setAnalyzerParams(Suscan::AnalyzerParams const &params);
     void setStatusMessage(QString const &);
     void saveUIConfig();
-    void setProfile(Suscan::Source::Config const &config, bool restart = false);
+    void setProfile(Suscan::Source::Config const &config);
     void setTimeStamp(struct timeval const &);
 
     // Overriden methods
@@ -220,6 +357,7 @@ namespace SigDigger {
   signals:
     void captureStart();
     void captureEnd();
+    void recordRequested(bool);
     void seek(struct timeval tv);
     void refreshDevices();
     void uiQuit();
@@ -247,10 +385,14 @@ namespace SigDigger {
     void onToggleAbout(bool);
     void onQuickConnect();
     void onQuickConnectAccepted();
+    void onLoadLevelChanged(int);
     void onTriggerStart(bool);
     void onTriggerStop(bool);
     void onTriggerImport(bool);
     void onTriggerExport(bool);
+    void onTriggerExportWaterfall(bool);
+    void onTriggerSaveSession(bool);
+    void onTriggerLoadSession(bool);
     void onTriggerDevices(bool);
     void onTriggerQuit(bool);
     void onTriggerClear(bool);
@@ -258,6 +400,7 @@ namespace SigDigger {
     void onTriggerPanoramicSpectrum(bool);
     void onTriggerBandPlan();
     void onTriggerLogMessages();
+    void onTriggerDiagnostics();
     void onTriggerBackgroundTasks();
     void onAddBookmark();
     void onBookmarkAccepted();
@@ -267,6 +410,9 @@ namespace SigDigger {
 
     // Time Slider slots
     void onTimeStampChanged();
+    void onTimeSliderReleased();
+    void onSeekTimeout();
+    void onOverviewReady(QString, QVector<float>, int, int);
 
     // Spectrum slots
     void onSpectrumBandwidthChanged();
@@ -290,10 +436,10 @@ namespace SigDigger {
 
     // Inspector handling
     void onInspectorMessage(Suscan::InspectorMessage const &);
-    void onInspectorSamples(Suscan::SamplesMessage const &);
     void onOpened(Suscan::AnalyzerRequest const &);
     void onCancelled(Suscan::AnalyzerRequest const &);
     void onError(Suscan::AnalyzerRequest const &, std::string const &);
+    void onBatchFinished(uint32_t, int, int);
   };
 };
 
@@ -0,0 +1,149 @@
+//
+//    WaterfallExportTask.h: Render long waterfalls to image files
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef WATERFALLEXPORTTASK_H
+#define WATERFALLEXPORTTASK_H
+
+#include <Suscan/CancellableTask.h>
+#include <sigutils/types.h>
+#include <analyzer/source.h>
+#include <Palette.h>
+#include <QImage>
+#include <QFile>
+#include <memory>
+#include <vector>
+
+// Lines of each PNG tile, and lines rendered per step
+#define SIGDIGGER_WATERFALL_EXPORT_TILE_LINES  1024
+#define SIGDIGGER_WATERFALL_EXPORT_STEP_LINES  64
+
+// File replay: FFT size, bound on the number of lines and on the FFTs
+// averaged into each of them when the capture has to be strided
+#define SIGDIGGER_WATERFALL_EXPORT_FFT_SIZE    2048
+#define SIGDIGGER_WATERFALL_EXPORT_MAX_LINES   (1 << 20)
+#define SIGDIGGER_WATERFALL_EXPORT_MAX_AVERAGE 8
+
+namespace SigDigger {
+  class WaterfallHistory;
+  class CaptureReader;
+
+  enum WaterfallExportFormat {
+    WATERFALL_EXPORT_PNG,  // PNG tiles
+    WATERFALL_EXPORT_PPM   // One binary PPM, written row by row
+  };
+
+  //
+  // Renders a waterfall (oldest line at the top) through a palette table
+  // and writes it to disk as it goes. Lines come either from the history
+  // of the main spectrum or from an FFT replay of a capture file.
+  //
+  // Only one tile (PNG) or one row (PPM) is kept in memory, so the image
+  // can be as long as the source. Exports longer than a tile are split in
+  // several PNG files, name-0000.png, name-0001.png and so on. A PPM is a
+  // single image of any size.
+  //
+  // Frames that leave the history before being rendered are drawn with
+  // the lowest color of the palette.
+  //
+  class WaterfallExportTask : public Suscan::CancellableTask
+  {
+      Q_OBJECT
+
+      // History source
+      WaterfallHistory const *history = nullptr;
+      quint64 firstSerial = 0;
+
+      // Capture source
+      QString capture;
+      enum suscan_source_format captureFormat;
+      std::unique_ptr<CaptureReader> reader;
+      SU_FFTW(_plan) plan = nullptr;
+      SU_FFTW(_complex) *window = nullptr;
+      quint64 hop = 0;
+      unsigned int averages = 1;
+
+      // Output
+      QString path;
+      WaterfallExportFormat format = WATERFALL_EXPORT_PNG;
+      QRgb palette[SIGDIGGER_PALETTE_MAX_STOPS];
+      float minDb;
+      float maxDb;
+      unsigned int width = 0;
+      quint64 lines = 0;
+      quint64 line = 0;
+
+      std::vector<float> psd;
+      std::vector<float> acc;
+      QImage tile;
+      int tileLine = 0;
+      unsigned int tileIndex = 0;
+      QFile ppm;
+      std::vector<QRgb> rgbRow;
+      std::vector<uchar> ppmRow;
+
+      bool cancelFlag = false;
+      QString lastError;
+
+      void init(const QRgb *palette, float min, float max);
+      bool openCapture(void);
+      void historyLine(quint64 line);
+      void captureLine(quint64 line);
+      void paint(QRgb *dest) const;
+
+      QString tilePath(unsigned int index) const;
+      void newTile(quint64 first);
+      bool saveTile(void);
+      bool writePpmHeader(quint64 height);
+      bool writeLine(void);
+      bool finish(void);
+
+    public:
+      // Everything the history holds now. Lines are as wide as the
+      // newest frame.
+      WaterfallExportTask(
+          WaterfallHistory const *history,
+          QString const &path,
+          const QRgb *palette,
+          float min,
+          float max,
+          QObject *parent = nullptr);
+
+      // The whole capture, one line every `fftSize` samples (or more,
+      // for long captures)
+      WaterfallExportTask(
+          QString const &capture,
+          enum suscan_source_format format,
+          QString const &path,
+          const QRgb *palette,
+          float min,
+          float max,
+          unsigned int fftSize = SIGDIGGER_WATERFALL_EXPORT_FFT_SIZE,
+          QObject *parent = nullptr);
+      ~WaterfallExportTask() override;
+
+      // The format follows the extension of the path (.ppm or .png)
+      bool attemptOpen(void);
+
+      bool work(void) override;
+      void cancel(void) override;
+
+      QString getLastError(void) const;
+  };
+}
+
+#endif // WATERFALLEXPORTTASK_H
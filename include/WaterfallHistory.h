@@ -0,0 +1,122 @@
+//
+//    WaterfallHistory.h: PSD history with disk spill
+//    Copyright (C) 2022 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef WATERFALLHISTORY_H
+#define WATERFALLHISTORY_H
+
+#include <QtGlobal>
+#include <MemoryAccountant.h>
+#include <QMutex>
+#include <sys/time.h>
+#include <deque>
+#include <vector>
+
+class QTemporaryFile;
+
+#define SIGDIGGER_WATERFALL_HISTORY_DEFAULT_RAM  (64ull << 20)
+
+// Spill files smaller than this are not worth it
+#define SIGDIGGER_WATERFALL_HISTORY_MIN_DISK     (16ull << 20)
+
+namespace SigDigger {
+  //
+  // Keeps past PSD frames in a RAM ring. If enabled (setCapacity()),
+  // frames evicted from RAM are spilled to a memory-mapped temporary
+  // file, which is itself used as a ring: once full, the oldest spilled
+  // frames are overwritten. The file never takes more than half of the
+  // free space of the temporary directory. Over the memory budget,
+  // frames are spilled before the RAM ring is full.
+  //
+  // The history is fed from the GUI thread. Other threads may only read
+  // it through copyFrame(), which refers to frames by serial number: it
+  // grows by one with every frame pushed and never goes back.
+  //
+  class WaterfallHistory {
+    struct Frame {
+      struct timeval tv;
+      std::vector<float> data;
+    };
+
+    struct SpilledFrame {
+      struct timeval tv;
+      quint64 offset;
+      unsigned int size;
+    };
+
+    std::deque<Frame>  frames;
+    std::vector<float> spare;
+    quint64            ramBytes = 0;
+    quint64            ramCapacity  = SIGDIGGER_WATERFALL_HISTORY_DEFAULT_RAM;
+
+    std::deque<SpilledFrame> spilled;
+    QTemporaryFile          *spillFile = nullptr;
+    uchar                   *spillMap  = nullptr;
+    quint64                  spillLimit    = 0; // As requested
+    quint64                  spillCapacity = 0; // As fits on disk
+    quint64                  spillOffset = 0;
+    bool                     spillFailed = false;
+
+    MemoryAccount            account;
+
+    // Held by writers and by copyFrame()
+    mutable QMutex           mutex;
+    quint64                  firstSerial = 0; // Serial of the oldest frame
+
+    bool ensureSpillFile(void);
+    void closeSpillFile(void);
+    void spill(Frame const &frame);
+    quint64 evictOldest(void);
+    size_t reclaim(size_t wanted);
+
+  public:
+    WaterfallHistory();
+    ~WaterfallHistory();
+
+    // Capacities in bytes. A disk capacity of 0 disables spilling.
+    void setCapacity(quint64 ram, quint64 disk);
+    void push(const float *data, unsigned int size, struct timeval const &tv);
+    void clear(void);
+
+    // Frames are indexed from the oldest (0) to the newest (count() - 1).
+    // The returned pointer stays valid until the next push or clear (or
+    // until memory is reclaimed, which happens in the GUI thread).
+    size_t count(void) const;
+    const float *frame(
+        size_t index,
+        unsigned int &size,
+        struct timeval &tv) const;
+
+    // Index of the frame closest in time to tv. Fails if tv is outside
+    // the time span covered by the history.
+    bool find(struct timeval const &tv, size_t &index) const;
+
+    // Serial numbers of the frames currently held, [first, end). Can be
+    // called from any thread.
+    void serials(quint64 &first, quint64 &end) const;
+
+    // Copies a frame (resampled to `size` bins) if it is still in the
+    // history. Can be called from any thread.
+    bool copyFrame(
+        quint64 serial,
+        float *out,
+        unsigned int size,
+        struct timeval &tv) const;
+  };
+}
+
+#endif // WATERFALLHISTORY_H
@@ -20,25 +20,92 @@
 #define WAVESAMPLER_H
 
 #include <Suscan/CancellableTask.h>
+#include <Suscan/TaskPool.h>
 #include "SamplingProperties.h"
 #include "Decider.h"
 #include <sigutils/clock.h>
 #include <sigutils/iir.h>
+#include <QAtomicInteger>
+#include <memory>
+#include <vector>
 
 #define SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH 4096
 #define SIGDIGGER_WAVESAMPLER_MAX_MF_SPAN         1024
 #define SIGDIGGER_WAVESAMPLER_MF_PERIODS          6
 
+// Manual and zero-crossing sampling of inputs at least this long is split
+// in segments that are sampled in parallel.
+#define SIGDIGGER_WAVESAMPLER_PARALLEL_MIN        (1 << 20)
+#define SIGDIGGER_WAVESAMPLER_PAGES_PER_SEGMENT   16
+#define SIGDIGGER_WAVESAMPLER_POLL_INTERVAL_MS    100
+
+// Pages released by destroyed buffers are kept (up to this many) for the
+// next sampler, instead of going back to the allocator.
+#define SIGDIGGER_WAVESAMPLER_PAGE_POOL_MAX       256
+
 namespace SigDigger {
+  //
+  // Output of a WaveSampler: sampled symbols and their decisions, stored
+  // in fixed-size pages. Pages are only added by the sampler and never
+  // move, so WaveSampleSets pointing into them stay valid for as long as
+  // they hold a reference to the buffer. Pages are taken from and
+  // returned to a process-wide pool.
+  //
+  class WaveSampleBuffer {
+    struct Page {
+      SUCOMPLEX block[SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH];
+      Symbol symbols[SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH];
+    };
+
+    std::vector<Page *> pages;
+    size_t used = 0;
+
+    static Page *acquirePage(void);
+    static void releasePage(Page *);
+
+  public:
+    WaveSampleBuffer() = default;
+    WaveSampleBuffer(WaveSampleBuffer const &) = delete;
+    WaveSampleBuffer &operator=(WaveSampleBuffer const &) = delete;
+    ~WaveSampleBuffer();
+
+    // Make room for `count` more symbols, starting at a new page. Returns
+    // the index of the first one.
+    size_t allocate(size_t count);
+
+    SUCOMPLEX *
+    block(size_t index)
+    {
+      return this->pages[index / SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH]
+          ->block + index % SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH;
+    }
+
+    Symbol *
+    symbols(size_t index)
+    {
+      return this->pages[index / SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH]
+          ->symbols + index % SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH;
+    }
+  };
+
+  // A view of (at most a page of) a WaveSampleBuffer
   struct WaveSampleSet {
-    SUCOMPLEX block[SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH];
-    Symbol symbols[SIGDIGGER_WAVESAMPLER_FEEDER_BLOCK_LENGTH];
-    size_t len;
+    std::shared_ptr<const WaveSampleBuffer> buffer;
+    const SUCOMPLEX *block = nullptr;
+    const Symbol *symbols = nullptr;
+    size_t len = 0;
   };
 
   class WaveSampler : public Suscan::CancellableTask {
     Q_OBJECT
 
+    struct Segment {
+      size_t start;  // Symbols (manual) or samples (zero crossing)
+      size_t end;
+      std::vector<std::pair<long, bool>> crossings;
+      QAtomicInteger<int> finished = 0;
+    };
+
     const Decider *decider;
     SamplingProperties properties;
     su_clock_detector_t cd;
@@ -58,12 +125,36 @@ namespace SigDigger {
 
     SUCOMPLEX prevSample = 0;
 
+    std::shared_ptr<WaveSampleBuffer> buffer;
     WaveSampleSet set;
 
+    // Parallel sampling
+    bool parallel = false;
+    bool started = false;
+    size_t base = 0;
+    size_t total = 0;
+    size_t published = 0;
+    size_t nextPublished = 0;
+    std::vector<std::unique_ptr<Segment>> segments;
+    Suscan::TaskSlices slices;
+    QAtomicInteger<quint64> processed = 0;
+
+    SUCOMPLEX sampleSymbol(long p, SUCOMPLEX &prev) const;
+    SUFLOAT crossingVariable(long p, SUFLOAT thres) const;
+    SUFLOAT crossingThreshold(void) const;
+
     bool sampleManual(void);
     bool sampleGardner(void);
     bool sampleZeroCrossing(void);
 
+    void startParallel(void);
+    void runSegment(int index);
+    void sampleManualSegment(Segment &);
+    void findCrossings(Segment &);
+    void expandCrossings(void);
+    void publish(size_t end);
+    bool workParallel(void);
+
   public:
     WaveSampler(
         SamplingProperties const &props,
@@ -76,7 +167,7 @@ namespace SigDigger {
 
 
   signals:
-    void data(SigDigger::WaveSampleSet);
+    void data(SigDigger::WaveSampleSet const &);
   };
 }
 
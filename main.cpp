@@ -23,12 +23,19 @@
 #include <QFont>
 #include <QSurface>
 #include "Loader.h"
+#include <PipelineBenchmark.h>
+#include <TaskBenchmark.h>
+#include <SessionDaemon.h>
+#include <MultiStreamSaver.h>
+#include <InstanceServer.h>
+#include <ShutdownWatchdog.h>
 #include <QtGlobal>
 
 #include <sigutils/version.h>
 #include <analyzer/version.h>
 
 #include <cstring>
+#include <algorithm>
 #include <getopt.h>
 
 #define MAX_LOG_MESSAGES 20
@@ -47,6 +54,191 @@ runRMSViewer(QApplication &app)
   return ret;
 }
 
+static int
+runBenchmark(int argc, char **argv)
+{
+  BenchmarkParams params;
+  int ret = EXIT_FAILURE;
+
+  if (!params.parse(argc, argv))
+    return EXIT_FAILURE;
+
+  try {
+    Suscan::Singleton::get_instance()->init(
+          [] (std::string const &) { });
+
+    PipelineBenchmark benchmark(params);
+
+    QObject::connect(
+          &benchmark,
+          SIGNAL(finished(void)),
+          qApp,
+          SLOT(quit(void)));
+
+    if (!benchmark.start()) {
+      fprintf(
+            stderr,
+            "%s: %s\n",
+            argv[0],
+            benchmark.getLastError().toStdString().c_str());
+      return EXIT_FAILURE;
+    }
+
+    qApp->exec();
+
+    if (!benchmark.getLastError().isEmpty())
+      fprintf(
+            stderr,
+            "%s: %s\n",
+            argv[0],
+            benchmark.getLastError().toStdString().c_str());
+    else if (benchmark.writeReport() && !benchmark.isRegressed())
+      ret = EXIT_SUCCESS;
+  } catch (Suscan::Exception const &e) {
+    fprintf(stderr, "%s: %s\n", argv[0], e.what());
+  }
+
+  return ret;
+}
+
+static int
+runTaskBenchmark(int argc, char **argv)
+{
+  TaskBenchmark benchmark;
+
+  if (!benchmark.parse(argc, argv))
+    return EXIT_FAILURE;
+
+  if (!benchmark.run() || !benchmark.writeReport())
+    return EXIT_FAILURE;
+
+  // The report is written nonetheless, with the offending metrics in it
+  if (benchmark.isRegressed())
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
+
+static int
+runDaemon(int argc, char **argv)
+{
+  DaemonParams params;
+  int ret = EXIT_FAILURE;
+
+  if (!params.parse(argc, argv))
+    return EXIT_FAILURE;
+
+  try {
+    Suscan::Singleton::get_instance()->init(
+          [] (std::string const &message) {
+            fprintf(stderr, "Daemon: %s\n", message.c_str());
+          });
+
+    SessionDaemon daemon(params);
+
+    QObject::connect(
+          &daemon,
+          SIGNAL(finished(void)),
+          qApp,
+          SLOT(quit(void)));
+
+    if (!daemon.start()) {
+      fprintf(
+            stderr,
+            "%s: %s\n",
+            argv[0],
+            daemon.getLastError().toStdString().c_str());
+      return EXIT_FAILURE;
+    }
+
+    qApp->exec();
+
+    if (!daemon.getLastError().isEmpty())
+      fprintf(
+            stderr,
+            "%s: %s\n",
+            argv[0],
+            daemon.getLastError().toStdString().c_str());
+    else
+      ret = EXIT_SUCCESS;
+  } catch (Suscan::Exception const &e) {
+    fprintf(stderr, "%s: %s\n", argv[0], e.what());
+  }
+
+  return ret;
+}
+
+static int
+runDemux(int argc, char **argv)
+{
+  MultiStreamReader reader;
+  std::string dir = ".";
+
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "Usage: %s CONTAINER [OUTPUT DIRECTORY]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (argc == 3)
+    dir = argv[2];
+
+  if (!reader.open(argv[1])) {
+    fprintf(stderr, "%s: %s\n", argv[0], reader.getLastError().c_str());
+    return EXIT_FAILURE;
+  }
+
+  auto const &streams = reader.getStreams();
+
+  for (size_t i = 0; i < streams.size(); ++i) {
+    std::string name = streams[i].name;
+    char prefix[16];
+    std::string path;
+
+    // Names come from the inspector titles
+    std::replace(name.begin(), name.end(), '/', '_');
+
+    snprintf(prefix, sizeof(prefix), "%04u-", streams[i].id);
+    path = dir + "/" + prefix + name + ".raw";
+
+    if (!reader.extract(i, path)) {
+      fprintf(stderr, "%s: %s\n", argv[0], reader.getLastError().c_str());
+      return EXIT_FAILURE;
+    }
+
+    fprintf(
+          stdout,
+          "%s: %llu bytes, %u bytes per sample at %u sps\n",
+          path.c_str(),
+          static_cast<unsigned long long>(streams[i].bytes),
+          streams[i].sampleSize,
+          streams[i].sampleRate);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static bool
+wantsTool(int argc, char *argv[], const char *name)
+{
+  QString shortOpt = QString("-t") + name;
+  QString longOpt  = QString("--tool=") + name;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--") == 0)
+      break;
+
+    if (shortOpt == argv[i] || longOpt == argv[i])
+      return true;
+
+    if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--tool") == 0)
+        && i + 1 < argc
+        && strcmp(argv[i + 1], name) == 0)
+      return true;
+  }
+
+  return false;
+}
+
 static QString
 getLogText(void)
 {
@@ -93,7 +285,7 @@ getLogText(void)
 }
 
 static int
-runSigDigger(QApplication &app)
+runSigDigger(QApplication &app, LaunchRequest const &req)
 {
   int ret = 1;
 
@@ -101,6 +293,8 @@ runSigDigger(QApplication &app)
     Application main_app;
     Loader loader(&main_app);
 
+    main_app.setLaunchRequest(req);
+
     QSurfaceFormat fmt;
     fmt.setSamples(16);
     QSurfaceFormat::setDefaultFormat(fmt);
@@ -109,11 +303,32 @@ runSigDigger(QApplication &app)
 
     ret = app.exec();
 
-    Suscan::Singleton::get_instance()->killBackgroundTaskController();
+    // Every subsystem is told to stop first, and the config is written
+    // while they do. Whatever is still running when the watchdog fires
+    // is left behind (and named), but never before the config is on disk
+    // and recorders got their own deadline to flush.
+    main_app.beginShutdown();
 
     std::cout << "Saving config..." << std::endl;
 
-    loader.saveConfig();
+    loader.beginSaveConfig();
+
+    ShutdownWatchdog watchdog(
+          SIGDIGGER_SHUTDOWN_TIMEOUT_MS,
+          ret,
+          [config = loader.getPendingConfig()] () {
+            if (config.valid())
+              config.wait();
+          });
+
+    {
+      ShutdownTracker stage("Background tasks");
+      Suscan::Singleton::get_instance()->killBackgroundTaskController();
+    }
+
+    main_app.shutdown();
+
+    loader.endSaveConfig();
   } catch (Suscan::Exception const &e) {
     (void) QMessageBox::critical(
           nullptr,
@@ -133,14 +348,29 @@ help(const char *argv0)
 {
   fprintf(stderr, "%s: SigDigger launcher binary\n", argv0);
   fprintf(stderr, "Usage:\n");
-  fprintf(stderr, "  %s [options] \n\n", argv0);
+  fprintf(stderr, "  %s [options] [CAPTURE]\n\n", argv0);
 
   fprintf(stderr, "Options:\n\n");
   fprintf(stderr, "     -t, --tool=\"tool name\"  Tool to launch\n");
+  fprintf(stderr, "     -p, --profile=NAME      Source profile to open\n");
+  fprintf(stderr, "     -f, --frequency=HZ      Tune to this frequency\n");
+  fprintf(stderr, "     -n, --new-instance      Do not hand over to a running SigDigger\n");
   fprintf(stderr, "     -h, --help              This help\n\n");
   fprintf(
         stderr,
-        "Tool name can be either one of SigDigger (default) and RMSViewer\n\n");
+        "A capture file, a profile or a frequency given to SigDigger are\n");
+  fprintf(
+        stderr,
+        "passed to the instance that is already running, if any.\n\n");
+  fprintf(
+        stderr,
+        "Tool name can be either one of SigDigger (default), RMSViewer,\n");
+  fprintf(
+        stderr,
+        "Benchmark, TaskBenchmark, Daemon and Demux. Options of these go\n");
+  fprintf(
+        stderr,
+        "after `--' (e.g. -t Daemon -- --help)\n\n");
 
   fprintf(
       stderr,
@@ -161,9 +391,12 @@ help(const char *argv0)
 }
 
 static struct option long_options[] = {
-  {"tool",  required_argument, nullptr, 't' },
-  {"help",  no_argument,       nullptr, 'h' },
-  {nullptr, 0,                 nullptr, 0 }
+  {"tool",         required_argument, nullptr, 't' },
+  {"profile",      required_argument, nullptr, 'p' },
+  {"frequency",    required_argument, nullptr, 'f' },
+  {"new-instance", no_argument,       nullptr, 'n' },
+  {"help",         no_argument,       nullptr, 'h' },
+  {nullptr,        0,                 nullptr, 0 }
 };
 
 
@@ -179,9 +412,21 @@ main(int argc, char *argv[])
 #ifdef Q_OS_MACOS
   qputenv("QT_MAC_WANTS_LAYER", "1");
 #endif // Q_OS_MACOS
+
+  // Benchmarks, the daemon and the demuxer must run without a display
+  if ((wantsTool(argc, argv, "Benchmark")
+       || wantsTool(argc, argv, "TaskBenchmark")
+       || wantsTool(argc, argv, "Daemon")
+       || wantsTool(argc, argv, "Demux"))
+      && qgetenv("QT_QPA_PLATFORM").isEmpty())
+    qputenv("QT_QPA_PLATFORM", "offscreen");
   
   QApplication app(argc, argv);
   QString appName = "SigDigger";
+  LaunchRequest request;
+  QString error;
+  bool newInstance = false;
+  bool ok;
   int ret = EXIT_FAILURE;
   int c;
 
@@ -192,7 +437,7 @@ main(int argc, char *argv[])
   while (true) {
     int option_index = 0;
 
-    c = getopt_long(argc, argv, "t:h", long_options, &option_index);
+    c = getopt_long(argc, argv, "t:p:f:nh", long_options, &option_index);
     if (c == -1)
       break;
 
@@ -201,6 +446,23 @@ main(int argc, char *argv[])
         appName = optarg;
         break;
 
+      case 'p':
+        request.profile = optarg;
+        break;
+
+      case 'f':
+        request.freq = QString(optarg).toDouble(&ok);
+        if (!ok) {
+          fprintf(stderr, "%s: invalid frequency `%s'\n", argv[0], optarg);
+          exit(EXIT_FAILURE);
+        }
+        request.haveFreq = true;
+        break;
+
+      case 'n':
+        newInstance = true;
+        break;
+
       case 'h':
         help(argv[0]);
         exit(EXIT_SUCCESS);
@@ -216,9 +478,38 @@ main(int argc, char *argv[])
   }
 
   if (appName == "SigDigger") {
-    ret = runSigDigger(app);
+    if (optind < argc)
+      request.file = QString::fromLocal8Bit(argv[optind]);
+
+    // A warm instance opens it in no time. Skip our own initialization.
+    if (!newInstance && !request.isEmpty()) {
+      if (InstanceServer::handOff(request, error))
+        exit(EXIT_SUCCESS);
+
+      if (!error.isEmpty())
+        fprintf(
+              stderr,
+              "%s: cannot hand over to the running instance: %s\n",
+              argv[0],
+              error.toStdString().c_str());
+    }
+
+    ret = runSigDigger(app, request);
   } else if (appName == "RMSViewer") {
     ret = runRMSViewer(app);
+  } else if (appName == "Benchmark") {
+    // Everything after -- belongs to the benchmark
+    argv[optind - 1] = argv[0];
+    ret = runBenchmark(argc - optind + 1, argv + optind - 1);
+  } else if (appName == "TaskBenchmark") {
+    argv[optind - 1] = argv[0];
+    ret = runTaskBenchmark(argc - optind + 1, argv + optind - 1);
+  } else if (appName == "Daemon") {
+    argv[optind - 1] = argv[0];
+    ret = runDaemon(argc - optind + 1, argv + optind - 1);
+  } else if (appName == "Demux") {
+    argv[optind - 1] = argv[0];
+    ret = runDemux(argc - optind + 1, argv + optind - 1);
   } else {
     fprintf(
           stderr,